@@ -0,0 +1,390 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace dxf {
+
+// The configuration of the C API (the TOML of dxf_load_config_from_string) validated once and kept as the compact
+// binary blob: the flat list of the dotted keys and the TOML values. The blob is loaded without the parsing, and only
+// the entries of the config are passed to the C API, so the process that starts often (e.g. the process per job)
+// doesn't parse the whole TOML file every time, and the empty config doesn't call the C API at all. The C API parses
+// the minimal dotted text (see toToml) when the config is applied.
+//
+// The supported TOML is the flat subset that the C API configs use: the [section] tables, the key = value pairs with
+// the strings, the booleans, the integers and the floats, and the comments.
+//
+// Usage:
+//   auto config = ApiConfig::load("dxfeed.toml");   // parses the TOML once, then loads "dxfeed.toml.bin"
+//
+//   if (config) config->apply();
+class ApiConfig final {
+  static constexpr char MAGIC[4] = {'D', 'X', 'C', 'F'};
+  static constexpr std::uint32_t VERSION = 1;
+
+  // The dotted keys and the TOML values (the strings are quoted)
+  std::vector<std::pair<std::string, std::string>> entries_{};
+
+  static std::string_view trim(std::string_view s) {
+    auto begin = s.find_first_not_of(" \t\r");
+
+    if (begin == std::string_view::npos) {
+      return {};
+    }
+
+    return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+  }
+
+  // Removes the comment (the # outside the quotes)
+  static std::string_view stripComment(std::string_view line) {
+    auto isQuoted = false;
+
+    for (std::size_t i = 0; i < line.size(); i++) {
+      if (line[i] == '\\' && isQuoted) {
+        i++;
+      } else if (line[i] == '"') {
+        isQuoted = !isQuoted;
+      } else if (line[i] == '#' && !isQuoted) {
+        return line.substr(0, i);
+      }
+    }
+
+    return line;
+  }
+
+  static bool isKey(std::string_view key) {
+    if (key.empty() || key.front() == '.' || key.back() == '.') {
+      return false;
+    }
+
+    for (auto c : key) {
+      if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' ||
+            c == '.')) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  static bool isValue(std::string_view value) {
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+      // The escaped characters are skipped, the closing quote must not be escaped
+      for (std::size_t i = 1; i + 1 < value.size(); i++) {
+        if (value[i] == '\\') {
+          i++;
+        } else if (value[i] == '"') {
+          return false;
+        }
+
+        if (i + 1 >= value.size()) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    if (value == "true" || value == "false") {
+      return true;
+    }
+
+    // The integer or the float
+    double number{};
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), number);
+
+    return !value.empty() && ec == std::errc{} && ptr == value.data() + value.size();
+  }
+
+  static void writeString(std::string& blob, std::string_view s) {
+    auto size = static_cast<std::uint32_t>(s.size());
+
+    blob.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    blob.append(s);
+  }
+
+  static bool readString(std::string_view& blob, std::string& s) {
+    std::uint32_t size = 0;
+
+    if (blob.size() < sizeof(size)) {
+      return false;
+    }
+
+    std::memcpy(&size, blob.data(), sizeof(size));
+    blob.remove_prefix(sizeof(size));
+
+    if (blob.size() < size) {
+      return false;
+    }
+
+    s.assign(blob.substr(0, size));
+    blob.remove_prefix(size);
+
+    return true;
+  }
+
+  // The stamp of the source file, so the blob of the changed file is not used
+  static std::optional<std::pair<std::uint64_t, std::uint64_t>> getStamp(const std::string& path) {
+    std::error_code error{};
+    auto size = std::filesystem::file_size(path, error);
+
+    if (error) {
+      return std::nullopt;
+    }
+
+    auto time = std::filesystem::last_write_time(path, error);
+
+    if (error) {
+      return std::nullopt;
+    }
+
+    return std::make_pair(static_cast<std::uint64_t>(size),
+                          static_cast<std::uint64_t>(time.time_since_epoch().count()));
+  }
+
+  static std::optional<std::string> readFile(const std::string& path) {
+    std::ifstream file{path, std::ios::binary};
+
+    if (!file) {
+      return std::nullopt;
+    }
+
+    return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+  }
+
+ public:
+  ApiConfig() = default;
+
+  // Parses and validates the TOML. Returns std::nullopt if it's invalid (the error is the line number and the reason).
+  static std::optional<ApiConfig> parse(std::string_view toml, std::string* error = nullptr) {
+    ApiConfig result{};
+    std::string section{};
+    std::size_t lineNumber = 0;
+    auto fail = [&](std::string_view reason) {
+      if (error != nullptr) {
+        *error = "line " + std::to_string(lineNumber) + ": " + std::string(reason);
+      }
+
+      return std::nullopt;
+    };
+
+    while (!toml.empty()) {
+      auto end = toml.find('\n');
+      auto line = trim(stripComment(toml.substr(0, end)));
+
+      toml.remove_prefix(end == std::string_view::npos ? toml.size() : end + 1);
+      lineNumber++;
+
+      if (line.empty()) {
+        continue;
+      }
+
+      if (line.front() == '[') {
+        if (line.back() != ']' || !isKey(trim(line.substr(1, line.size() - 2)))) {
+          return fail("invalid section");
+        }
+
+        section = std::string(trim(line.substr(1, line.size() - 2))) + ".";
+
+        continue;
+      }
+
+      auto equals = line.find('=');
+
+      if (equals == std::string_view::npos) {
+        return fail("no value");
+      }
+
+      auto key = trim(line.substr(0, equals));
+      auto value = trim(line.substr(equals + 1));
+
+      if (!isKey(key)) {
+        return fail("invalid key");
+      }
+
+      if (!isValue(value)) {
+        return fail("invalid value");
+      }
+
+      result.set(section + std::string(key), std::string(value));
+    }
+
+    return result;
+  }
+
+  // Restores the config from the blob without the parsing. Returns std::nullopt if the blob is invalid.
+  static std::optional<ApiConfig> deserialize(std::string_view blob) {
+    ApiConfig result{};
+    std::uint32_t version = 0;
+    std::uint32_t size = 0;
+    auto headerSize = sizeof(MAGIC) + sizeof(version) + 2 * sizeof(std::uint64_t) + sizeof(size);
+
+    if (blob.size() < headerSize || std::memcmp(blob.data(), MAGIC, sizeof(MAGIC)) != 0) {
+      return std::nullopt;
+    }
+
+    std::memcpy(&version, blob.data() + sizeof(MAGIC), sizeof(version));
+    std::memcpy(&size, blob.data() + headerSize - sizeof(size), sizeof(size));
+
+    blob.remove_prefix(headerSize);
+
+    // Every entry takes two sizes at least
+    if (version != VERSION || size > blob.size() / (2 * sizeof(size))) {
+      return std::nullopt;
+    }
+
+    result.entries_.resize(size);
+
+    for (auto& [key, value] : result.entries_) {
+      if (!readString(blob, key) || !readString(blob, value)) {
+        return std::nullopt;
+      }
+    }
+
+    return result;
+  }
+
+  // The blob of the config. The stamp is the size and the modification time of the source file (0 - none).
+  [[nodiscard]] std::string serialize(std::pair<std::uint64_t, std::uint64_t> stamp = {}) const {
+    std::string result{MAGIC, sizeof(MAGIC)};
+    auto size = static_cast<std::uint32_t>(entries_.size());
+
+    result.append(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+    result.append(reinterpret_cast<const char*>(&stamp.first), sizeof(stamp.first));
+    result.append(reinterpret_cast<const char*>(&stamp.second), sizeof(stamp.second));
+    result.append(reinterpret_cast<const char*>(&size), sizeof(size));
+
+    for (const auto& [key, value] : entries_) {
+      writeString(result, key);
+      writeString(result, value);
+    }
+
+    return result;
+  }
+
+  // Loads the config of the TOML file: from the blob of the file (<path>.bin) if it's made from the same version of the
+  // file, otherwise the file is parsed and the blob is written (the failure of the write is ignored). Returns
+  // std::nullopt if the file can't be read or is invalid.
+  static std::optional<ApiConfig> load(const std::string& path, std::string* error = nullptr) {
+    auto stamp = getStamp(path);
+
+    if (!stamp) {
+      if (error != nullptr) {
+        *error = "can't read " + path;
+      }
+
+      return std::nullopt;
+    }
+
+    auto blobPath = path + ".bin";
+
+    if (auto blob = readFile(blobPath); blob && blob->size() >= sizeof(MAGIC) + sizeof(VERSION) + 16) {
+      std::uint64_t blobStamp[2]{};
+
+      std::memcpy(blobStamp, blob->data() + sizeof(MAGIC) + sizeof(VERSION), sizeof(blobStamp));
+
+      if (blobStamp[0] == stamp->first && blobStamp[1] == stamp->second) {
+        if (auto result = deserialize(*blob)) {
+          return result;
+        }
+      }
+    }
+
+    auto toml = readFile(path);
+
+    if (!toml) {
+      if (error != nullptr) {
+        *error = "can't read " + path;
+      }
+
+      return std::nullopt;
+    }
+
+    auto result = parse(*toml, error);
+
+    if (result) {
+      std::ofstream blob{blobPath, std::ios::binary | std::ios::trunc};
+      auto data = result->serialize(*stamp);
+
+      blob.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    return result;
+  }
+
+  // Sets the entry. value - the TOML value (the strings are quoted, e.g. "\"debug\"").
+  void set(std::string key, std::string value) {
+    for (auto& entry : entries_) {
+      if (entry.first == key) {
+        entry.second = std::move(value);
+
+        return;
+      }
+    }
+
+    entries_.emplace_back(std::move(key), std::move(value));
+  }
+
+  // Returns the TOML value of the key (std::nullopt - the key is not set)
+  [[nodiscard]] std::optional<std::string_view> get(std::string_view key) const {
+    for (const auto& [k, v] : entries_) {
+      if (k == key) {
+        return v;
+      }
+    }
+
+    return std::nullopt;
+  }
+
+  [[nodiscard]] bool isEmpty() const { return entries_.empty(); }
+
+  [[nodiscard]] const std::vector<std::pair<std::string, std::string>>& getEntries() const { return entries_; }
+
+  // The minimal text of the C API: one "key = value" line per entry
+  [[nodiscard]] std::string toToml() const {
+    std::string result{};
+
+    for (const auto& [key, value] : entries_) {
+      result += key;
+      result += " = ";
+      result += value;
+      result += '\n';
+    }
+
+    return result;
+  }
+
+  // Passes the config to the C API (the empty config is not passed). Returns false if the C API rejects it.
+  [[nodiscard]] bool apply() const {
+    if (entries_.empty()) {
+      return true;
+    }
+
+    return dxf_load_config_from_string(toToml().c_str()) != DXF_FAILURE;
+  }
+
+  // Initializes the logger of the C API only if the config enables it (the logger.level is set), so the process with
+  // the disabled logger doesn't open the log file. Returns false if the logger is disabled or can't be initialized.
+  bool initializeLogger(const std::string& fileName, bool isDataTransferLogged = false) const {
+    if (!get("logger.level")) {
+      return false;
+    }
+
+    return dxf_initialize_logger_v2(fileName.c_str(), true, true, true, isDataTransferLogged) != DXF_FAILURE;
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,924 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "SnapshotDataCapture.hpp"
+#include "TimeAndSaleColumns.hpp"
+
+// The structs of the Arrow C data interface (https://arrow.apache.org/docs/format/CDataInterface.html). They are ABI
+// stable, so the arrays are passed to the Arrow implementations (e.g. pyarrow.RecordBatch._import_from_c) without the
+// Arrow library.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ArrowSchema {
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+  void (*release)(struct ArrowSchema*);
+  void* private_data;
+};
+
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+  void (*release)(struct ArrowArray*);
+  void* private_data;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+namespace dxf {
+
+namespace detail {
+
+// The minimal builder of the flatbuffers of the Arrow IPC metadata (the tables, the vectors and the strings). The
+// buffer is built from the end, as by the flatbuffers library, so the offsets are the distances from the end.
+class ArrowFlatBufferBuilder final {
+  std::vector<std::uint8_t> buffer_ = std::vector<std::uint8_t>(1024);
+  std::size_t size_ = 0;
+  std::size_t minAlignment_ = 1;
+  // The ids and the offsets of the fields of the table being built
+  std::vector<std::pair<std::uint16_t, std::uint32_t>> fields_{};
+  std::uint32_t tableStart_ = 0;
+
+  void reserve(std::size_t size) {
+    if (size_ + size <= buffer_.size()) {
+      return;
+    }
+
+    std::vector<std::uint8_t> buffer((std::max)(buffer_.size() * 2, size_ + size + 256));
+
+    std::memcpy(buffer.data() + buffer.size() - size_, buffer_.data() + buffer_.size() - size_, size_);
+    buffer_.swap(buffer);
+  }
+
+  void push(const void* data, std::size_t size) {
+    reserve(size);
+    size_ += size;
+    std::memcpy(buffer_.data() + buffer_.size() - size_, data, size);
+  }
+
+  // Pads the buffer, so it's aligned after the next size bytes
+  void align(std::size_t size, std::size_t alignment) {
+    auto padding = (~(size_ + size) + 1) & (alignment - 1);
+
+    minAlignment_ = (std::max)(minAlignment_, alignment);
+    reserve(padding);
+    std::memset(buffer_.data() + buffer_.size() - size_ - padding, 0, padding);
+    size_ += padding;
+  }
+
+  template <typename T>
+  void pushScalar(T value) {
+    align(sizeof(T), sizeof(T));
+    push(&value, sizeof(T));
+  }
+
+  // The offset to the object, relative to its own position
+  void pushOffset(std::uint32_t offset) {
+    align(sizeof(std::uint32_t), sizeof(std::uint32_t));
+    pushScalar(static_cast<std::uint32_t>(size_ + sizeof(std::uint32_t) - offset));
+  }
+
+ public:
+  std::uint32_t createString(std::string_view string) {
+    align(string.size() + 1, sizeof(std::uint32_t));
+    pushScalar(std::uint8_t{0});
+    push(string.data(), string.size());
+    pushScalar(static_cast<std::uint32_t>(string.size()));
+
+    return static_cast<std::uint32_t>(size_);
+  }
+
+  // The vector of the structs (8-byte aligned)
+  template <typename T>
+  std::uint32_t createStructVector(std::span<const T> items) {
+    align(items.size() * sizeof(T), 8);
+
+    for (auto i = items.size(); i > 0; i--) {
+      push(&items[i - 1], sizeof(T));
+    }
+
+    pushScalar(static_cast<std::uint32_t>(items.size()));
+
+    return static_cast<std::uint32_t>(size_);
+  }
+
+  std::uint32_t createOffsetVector(std::span<const std::uint32_t> offsets) {
+    align(offsets.size() * sizeof(std::uint32_t), sizeof(std::uint32_t));
+
+    for (auto i = offsets.size(); i > 0; i--) {
+      pushOffset(offsets[i - 1]);
+    }
+
+    pushScalar(static_cast<std::uint32_t>(offsets.size()));
+
+    return static_cast<std::uint32_t>(size_);
+  }
+
+  // The objects that the table refers to are created before the start of the table
+  void startTable() {
+    fields_.clear();
+    tableStart_ = static_cast<std::uint32_t>(size_);
+  }
+
+  template <typename T>
+  void addScalar(std::uint16_t id, T value) {
+    pushScalar(value);
+    fields_.emplace_back(id, static_cast<std::uint32_t>(size_));
+  }
+
+  void addOffset(std::uint16_t id, std::uint32_t offset) {
+    pushOffset(offset);
+    fields_.emplace_back(id, static_cast<std::uint32_t>(size_));
+  }
+
+  // Writes the table and its vtable (right before the table)
+  std::uint32_t endTable() {
+    pushScalar(std::int32_t{0});
+
+    auto table = static_cast<std::uint32_t>(size_);
+    std::size_t fieldsNumber = 0;
+
+    for (auto [id, offset] : fields_) {
+      fieldsNumber = (std::max)(fieldsNumber, std::size_t{id} + 1);
+    }
+
+    std::vector<std::uint16_t> vtable(2 + fieldsNumber, 0);
+
+    vtable[0] = static_cast<std::uint16_t>(vtable.size() * sizeof(std::uint16_t));
+    vtable[1] = static_cast<std::uint16_t>(table - tableStart_);
+
+    for (auto [id, offset] : fields_) {
+      vtable[2 + id] = static_cast<std::uint16_t>(table - offset);
+    }
+
+    for (auto i = vtable.size(); i > 0; i--) {
+      pushScalar(vtable[i - 1]);
+    }
+
+    auto vtableOffset = static_cast<std::int32_t>(size_) - static_cast<std::int32_t>(table);
+
+    std::memcpy(buffer_.data() + buffer_.size() - table, &vtableOffset, sizeof(vtableOffset));
+
+    return table;
+  }
+
+  // Returns the buffer of the root table, its size is a multiple of 8
+  std::span<const std::uint8_t> finish(std::uint32_t root) {
+    align(sizeof(std::uint32_t), (std::max)(minAlignment_, std::size_t{8}));
+    pushOffset(root);
+
+    return {buffer_.data() + buffer_.size() - size_, size_};
+  }
+};
+
+}  // namespace detail
+
+// The record batch of the Arrow columns that refer to the columnar storage it owns (e.g. the TimeAndSaleColumns of
+// the provider), so the columns are exported without the copying: by the Arrow C data interface (exportTo, the
+// consumer takes the ownership of the buffers) or to the Arrow IPC file (writeFile, the Feather V2 file that is read
+// by pyarrow.feather, pandas.read_feather, Spark, etc.). The columns have no nulls. The string columns are
+// dictionary-encoded (the ids of the StringDictionary are the indexes, the dictionary is converted once).
+//
+// Usage:
+//   auto columns = SimpleTimeAndSaleDataProvider::runColumnar(address, symbols).get();
+//
+//   for (auto& [symbol, c] : columns) {
+//     ArrowBatch::fromColumns(std::move(c)).addMetadata("symbol", symbol.getName()).writeFile(path);
+//   }
+class ArrowBatch final {
+ public:
+  enum class Type {
+    INT32,
+    UINT32,
+    INT64,
+    DOUBLE,
+    // The bitmap of the values
+    BOOL,
+    // The one-byte values (e.g. the chars)
+    FIXED_BINARY_1,
+    // The int64 milliseconds since the epoch (UTC)
+    TIMESTAMP_MS,
+    // The int32 indexes of the utf8 dictionary
+    DICTIONARY_UTF8
+  };
+
+  struct Dictionary {
+    // The int32 offsets of the strings (the number of the strings + 1) and the UTF-8 bytes
+    std::vector<std::int32_t> offsets{};
+    std::string data{};
+
+    [[nodiscard]] std::size_t getSize() const { return offsets.size() - 1; }
+  };
+
+  struct Column {
+    std::string name{};
+    Type type = Type::INT64;
+    const void* data = nullptr;
+    std::size_t dataSize = 0;
+    // DICTIONARY_UTF8
+    const Dictionary* dictionary = nullptr;
+  };
+
+ private:
+  // The Arrow IPC metadata version (V5)
+  static constexpr std::int16_t METADATA_VERSION = 4;
+  static constexpr char MAGIC[6] = {'A', 'R', 'R', 'O', 'W', '1'};
+
+  // The flatbuffers structs of the Arrow IPC metadata
+  struct FieldNode {
+    std::int64_t length;
+    std::int64_t nullCount;
+  };
+
+  struct BufferSpec {
+    std::int64_t offset;
+    std::int64_t length;
+  };
+
+  struct Block {
+    std::int64_t offset;
+    std::int32_t metadataLength;
+    std::int32_t padding;
+    std::int64_t bodyLength;
+  };
+
+  static_assert(sizeof(FieldNode) == 16 && sizeof(BufferSpec) == 16 && sizeof(Block) == 24);
+
+  // The data of the exported structs of the C data interface, shared by them, so every struct can be released
+  // independently (e.g. the children moved out by the consumer)
+  struct Export {
+    std::shared_ptr<const ArrowBatch> batch;
+    std::string metadata{};
+    std::vector<ArrowSchema> schemas{};
+    std::vector<ArrowArray> arrays{};
+    std::vector<ArrowSchema*> schemaChildren{};
+    std::vector<ArrowArray*> arrayChildren{};
+    // The buffers of the arrays: the validity (nullptr) and the data of every column, then the dictionaries
+    std::vector<const void*> buffers{};
+  };
+
+  std::size_t length_;
+  std::vector<Column> columns_{};
+  std::vector<std::pair<std::string, std::string>> metadata_{};
+  // The storage of the columns
+  std::shared_ptr<const void> owner_{};
+  std::vector<std::unique_ptr<Dictionary>> dictionaries_{};
+  std::vector<std::unique_ptr<std::vector<std::uint8_t>>> bitmaps_{};
+
+  // The data of the empty buffers (the Arrow implementations don't accept nullptr as the data buffer)
+  static const void* getEmptyData() {
+    alignas(8) static const std::int64_t empty = 0;
+
+    return &empty;
+  }
+
+  static const char* getFormat(Type type) {
+    switch (type) {
+      case Type::INT32:
+        return "i";
+      case Type::UINT32:
+        return "I";
+      case Type::INT64:
+        return "l";
+      case Type::DOUBLE:
+        return "g";
+      case Type::BOOL:
+        return "b";
+      case Type::FIXED_BINARY_1:
+        return "w:1";
+      case Type::TIMESTAMP_MS:
+        return "tsm:UTC";
+      case Type::DICTIONARY_UTF8:
+        return "i";
+    }
+
+    return "";
+  }
+
+  // The metadata of the C data interface: the number of the pairs, then the length and the bytes of every key and value
+  // (int32 lengths)
+  std::string encodeMetadata() const {
+    std::string result{};
+
+    if (metadata_.empty()) {
+      return result;
+    }
+
+    auto append = [&result](std::int32_t value) {
+      result.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+    append(static_cast<std::int32_t>(metadata_.size()));
+
+    for (const auto& [key, value] : metadata_) {
+      append(static_cast<std::int32_t>(key.size()));
+      result += key;
+      append(static_cast<std::int32_t>(value.size()));
+      result += value;
+    }
+
+    return result;
+  }
+
+  // Releases the children and the dictionary that aren't moved out by the consumer, then the structure
+  template <typename T>
+  static void release(T* structure) {
+    for (std::int64_t i = 0; i < structure->n_children; i++) {
+      if (structure->children[i]->release != nullptr) {
+        structure->children[i]->release(structure->children[i]);
+      }
+    }
+
+    if (structure->dictionary != nullptr && structure->dictionary->release != nullptr) {
+      structure->dictionary->release(structure->dictionary);
+    }
+
+    delete static_cast<std::shared_ptr<Export>*>(structure->private_data);
+    structure->release = nullptr;
+  }
+
+  // The Arrow IPC Field of the column, the dictionary id is the position of the column
+  std::uint32_t createField(detail::ArrowFlatBufferBuilder& builder, std::size_t position) const {
+    const auto& column = columns_[position];
+    auto name = builder.createString(column.name);
+    auto createInt = [&builder](std::int32_t bitWidth, bool isSigned) {
+      builder.startTable();
+      builder.addScalar(0, bitWidth);
+      builder.addScalar(1, static_cast<std::uint8_t>(isSigned));
+
+      return builder.endTable();
+    };
+
+    // The Type union: Int = 2, FloatingPoint = 3, Utf8 = 5, Bool = 6, Timestamp = 10, FixedSizeBinary = 15
+    std::uint8_t typeType = 2;
+    std::uint32_t type = 0;
+    std::uint32_t dictionary = 0;
+
+    switch (column.type) {
+      case Type::INT32:
+        type = createInt(32, true);
+        break;
+      case Type::UINT32:
+        type = createInt(32, false);
+        break;
+      case Type::INT64:
+        type = createInt(64, true);
+        break;
+      case Type::DOUBLE:
+        typeType = 3;
+        builder.startTable();
+        // DOUBLE precision
+        builder.addScalar(0, std::int16_t{2});
+        type = builder.endTable();
+        break;
+      case Type::BOOL:
+        typeType = 6;
+        builder.startTable();
+        type = builder.endTable();
+        break;
+      case Type::FIXED_BINARY_1:
+        typeType = 15;
+        builder.startTable();
+        builder.addScalar(0, std::int32_t{1});
+        type = builder.endTable();
+        break;
+      case Type::TIMESTAMP_MS: {
+        auto timezone = builder.createString("UTC");
+
+        typeType = 10;
+        builder.startTable();
+        // MILLISECOND unit
+        builder.addScalar(0, std::int16_t{1});
+        builder.addOffset(1, timezone);
+        type = builder.endTable();
+        break;
+      }
+      case Type::DICTIONARY_UTF8: {
+        auto indexType = createInt(32, true);
+
+        typeType = 5;
+        builder.startTable();
+        type = builder.endTable();
+        builder.startTable();
+        builder.addScalar(0, static_cast<std::int64_t>(position));
+        builder.addOffset(1, indexType);
+        builder.addScalar(2, std::uint8_t{0});
+        dictionary = builder.endTable();
+        break;
+      }
+    }
+
+    auto children = builder.createOffsetVector({});
+
+    builder.startTable();
+    builder.addOffset(0, name);
+    builder.addScalar(1, std::uint8_t{0});
+    builder.addScalar(2, typeType);
+    builder.addOffset(3, type);
+
+    if (dictionary != 0) {
+      builder.addOffset(4, dictionary);
+    }
+
+    builder.addOffset(5, children);
+
+    return builder.endTable();
+  }
+
+  std::uint32_t createSchema(detail::ArrowFlatBufferBuilder& builder) const {
+    std::vector<std::uint32_t> fields{};
+    std::vector<std::uint32_t> keyValues{};
+
+    for (std::size_t i = 0; i < columns_.size(); i++) {
+      fields.push_back(createField(builder, i));
+    }
+
+    for (const auto& [key, value] : metadata_) {
+      auto keyOffset = builder.createString(key);
+      auto valueOffset = builder.createString(value);
+
+      builder.startTable();
+      builder.addOffset(0, keyOffset);
+      builder.addOffset(1, valueOffset);
+      keyValues.push_back(builder.endTable());
+    }
+
+    auto fieldsOffset = builder.createOffsetVector(fields);
+    auto metadataOffset = builder.createOffsetVector(keyValues);
+
+    builder.startTable();
+    // Little endian
+    builder.addScalar(0, std::int16_t{0});
+    builder.addOffset(1, fieldsOffset);
+    builder.addOffset(2, metadataOffset);
+
+    return builder.endTable();
+  }
+
+  // The RecordBatch of the buffers (they are laid out in the body in this order, 8-byte aligned)
+  static std::uint32_t createRecordBatch(detail::ArrowFlatBufferBuilder& builder, std::int64_t length,
+                                         std::span<const FieldNode> nodes, std::span<const std::size_t> bufferSizes) {
+    std::vector<BufferSpec> buffers{};
+    std::int64_t offset = 0;
+
+    for (auto size : bufferSizes) {
+      buffers.push_back({offset, static_cast<std::int64_t>(size)});
+      offset += static_cast<std::int64_t>((size + 7U) & ~std::size_t{7});
+    }
+
+    auto nodesOffset = builder.createStructVector(nodes);
+    auto buffersOffset = builder.createStructVector(std::span<const BufferSpec>{buffers});
+
+    builder.startTable();
+    builder.addScalar(0, length);
+    builder.addOffset(1, nodesOffset);
+    builder.addOffset(2, buffersOffset);
+
+    return builder.endTable();
+  }
+
+  // The encapsulated message: the continuation marker, the metadata size, the Message and the body
+  class IpcFile {
+    std::FILE* file_;
+    std::int64_t position_ = 0;
+    bool isFailed_ = false;
+
+   public:
+    explicit IpcFile(std::FILE* file) : file_{file} {}
+
+    void write(const void* data, std::size_t size) {
+      if (size != 0 && !isFailed_) {
+        isFailed_ = std::fwrite(data, 1, size, file_) != size;
+      }
+
+      position_ += static_cast<std::int64_t>(size);
+    }
+
+    void pad() {
+      static constexpr char ZEROS[8]{};
+
+      write(ZEROS, static_cast<std::size_t>(-position_ & 7));
+    }
+
+    // Writes the metadata of the message (headerType: Schema = 1, DictionaryBatch = 2, RecordBatch = 3). Returns the
+    // block of the message.
+    Block writeMessage(std::uint8_t headerType,
+                       const std::function<std::uint32_t(detail::ArrowFlatBufferBuilder&)>& createHeader,
+                       std::int64_t bodyLength) {
+      detail::ArrowFlatBufferBuilder builder{};
+      auto header = createHeader(builder);
+
+      builder.startTable();
+      builder.addScalar(0, METADATA_VERSION);
+      builder.addScalar(1, headerType);
+      builder.addOffset(2, header);
+      builder.addScalar(3, bodyLength);
+
+      auto metadata = builder.finish(builder.endTable());
+      Block block{position_, static_cast<std::int32_t>(8 + metadata.size()), 0, bodyLength};
+      std::int32_t prefix[2] = {-1, static_cast<std::int32_t>(metadata.size())};
+
+      write(prefix, sizeof(prefix));
+      write(metadata.data(), metadata.size());
+
+      return block;
+    }
+
+    // Writes the buffers of the body, every one is padded to 8 bytes
+    void writeBody(std::span<const std::pair<const void*, std::size_t>> buffers) {
+      for (auto [data, size] : buffers) {
+        write(data, size);
+        pad();
+      }
+    }
+
+    [[nodiscard]] std::int64_t getPosition() const { return position_; }
+
+    [[nodiscard]] bool isFailed() const { return isFailed_; }
+  };
+
+  static std::int64_t getBodyLength(std::span<const std::pair<const void*, std::size_t>> buffers) {
+    std::int64_t result = 0;
+
+    for (auto [data, size] : buffers) {
+      result += static_cast<std::int64_t>((size + 7U) & ~std::size_t{7});
+    }
+
+    return result;
+  }
+
+  const Dictionary* addDictionary(const StringDictionary& strings) {
+    auto dictionary = std::make_unique<Dictionary>();
+
+    dictionary->offsets.reserve(strings.getSize() + 1);
+    dictionary->offsets.push_back(0);
+
+    for (std::uint32_t id = 0; id < strings.getSize(); id++) {
+      dictionary->data += strings.decode(id);
+      dictionary->offsets.push_back(static_cast<std::int32_t>(dictionary->data.size()));
+    }
+
+    dictionaries_.push_back(std::move(dictionary));
+
+    return dictionaries_.back().get();
+  }
+
+  // The bitmap of the bits of the values (e.g. the attributes of the TimeAndSaleColumns)
+  const std::vector<std::uint8_t>& addBitmap(const std::vector<std::uint8_t>& values, std::uint8_t mask) {
+    auto bitmap = std::make_unique<std::vector<std::uint8_t>>((values.size() + 7) / 8, 0);
+
+    for (std::size_t i = 0; i < values.size(); i++) {
+      if ((values[i] & mask) != 0) {
+        (*bitmap)[i / 8] |= static_cast<std::uint8_t>(1U << (i % 8));
+      }
+    }
+
+    bitmaps_.push_back(std::move(bitmap));
+
+    return *bitmaps_.back();
+  }
+
+  template <typename T>
+  void addVector(std::string name, Type type, const std::vector<T>& values) {
+    columns_.push_back({std::move(name), type, values.data(), values.size() * sizeof(T), nullptr});
+  }
+
+ public:
+  // length - the number of the rows, owner - the storage of the data of the columns (see addColumn)
+  explicit ArrowBatch(std::size_t length, std::shared_ptr<const void> owner = nullptr)
+      : length_{length}, owner_{std::move(owner)} {}
+
+  // The columns of the TimeAndSale events. The attributes are the bool columns (the bitmaps are built), the strings
+  // are the dictionary-encoded columns (the dictionary is built once), the other columns refer to the vectors.
+  static ArrowBatch fromColumns(TimeAndSaleColumns columns) {
+    auto owner = std::make_shared<const TimeAndSaleColumns>(std::move(columns));
+    const auto& c = *owner;
+    ArrowBatch result{c.getSize(), owner};
+    auto strings = result.addDictionary(c.strings);
+
+    static_assert(sizeof(OrderSide) == 4 && sizeof(TimeAndSaleType) == 4 && sizeof(OrderScope) == 4);
+
+    result.addVector("time", Type::TIMESTAMP_MS, c.time);
+    result.addVector("index", Type::INT64, c.index);
+    result.addVector("price", Type::DOUBLE, c.price);
+    result.addVector("size", Type::DOUBLE, c.size);
+    result.addVector("bidPrice", Type::DOUBLE, c.bidPrice);
+    result.addVector("askPrice", Type::DOUBLE, c.askPrice);
+    result.addVector("eventFlags", Type::UINT32, c.eventFlags);
+    result.addVector("flags", Type::INT32, c.flags);
+    result.addVector("exchangeCode", Type::FIXED_BINARY_1, c.exchangeCode);
+    result.addVector("tradeThroughExempt", Type::FIXED_BINARY_1, c.tradeThroughExempt);
+    result.addVector("side", Type::INT32, c.side);
+    result.addVector("type", Type::INT32, c.type);
+    result.addVector("scope", Type::INT32, c.scope);
+    result.addVector("validTick", Type::BOOL, result.addBitmap(c.attributes, TimeAndSaleColumns::VALID_TICK));
+    result.addVector("ethTrade", Type::BOOL, result.addBitmap(c.attributes, TimeAndSaleColumns::ETH_TRADE));
+    result.addVector("spreadLeg", Type::BOOL, result.addBitmap(c.attributes, TimeAndSaleColumns::SPREAD_LEG));
+
+    // The ids fit the int32 indexes
+    for (auto [name, ids] : {std::pair{"exchangeSaleConditions", &c.exchangeSaleConditions},
+                             std::pair{"buyer", &c.buyer}, std::pair{"seller", &c.seller}}) {
+      result.addColumn(name, Type::DICTIONARY_UTF8, ids->data(), ids->size() * sizeof(std::uint32_t), strings);
+    }
+
+    return result;
+  }
+
+  // The order records of the history of the book (see SnapshotDataColumns)
+  static ArrowBatch fromColumns(SnapshotDataColumns columns) {
+    auto owner = std::make_shared<const SnapshotDataColumns>(std::move(columns));
+    const auto& c = *owner;
+    ArrowBatch result{c.getSize(), owner};
+
+    result.addVector("chunk", Type::UINT32, c.chunk);
+    result.addVector("newSnapshot", Type::BOOL, result.addBitmap(c.newSnapshot, 1));
+    result.addVector("index", Type::INT64, c.index);
+    result.addVector("time", Type::TIMESTAMP_MS, c.time);
+    result.addVector("price", Type::DOUBLE, c.price);
+    result.addVector("size", Type::DOUBLE, c.size);
+    result.addVector("eventFlags", Type::UINT32, c.eventFlags);
+    result.addVector("side", Type::INT32, c.side);
+
+    return result;
+  }
+
+  // The file name of the batch of the symbol: the chars other than the letters, the digits, '.', '-' and '_' are
+  // replaced by "%XX" (e.g. "/ESZ21:XCME" -> "%2FESZ21%3AXCME.arrow")
+  static std::string getFileName(const std::string& symbol) {
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    std::string result{};
+
+    for (auto c : symbol) {
+      auto u = static_cast<unsigned char>(c);
+
+      if ((u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '.' || u == '-' ||
+          u == '_') {
+        result += c;
+      } else {
+        result += '%';
+        result += HEX[u >> 4U];
+        result += HEX[u & 0xFU];
+      }
+    }
+
+    return result + ".arrow";
+  }
+
+  // Adds the column of the data (the Arrow layout of the type: the values or the bitmap of the BOOL, the length
+  // values). The data must be owned by the owner of the batch. The dictionary must outlive the batch.
+  ArrowBatch& addColumn(std::string name, Type type, const void* data, std::size_t dataSize,
+                        const Dictionary* dictionary = nullptr) & {
+    columns_.push_back({std::move(name), type, data, dataSize, dictionary});
+
+    return *this;
+  }
+
+  ArrowBatch&& addColumn(std::string name, Type type, const void* data, std::size_t dataSize,
+                         const Dictionary* dictionary = nullptr) && {
+    return std::move(addColumn(std::move(name), type, data, dataSize, dictionary));
+  }
+
+  // The key-value metadata of the schema (e.g. the symbol)
+  ArrowBatch& addMetadata(std::string key, std::string value) & {
+    metadata_.emplace_back(std::move(key), std::move(value));
+
+    return *this;
+  }
+
+  ArrowBatch&& addMetadata(std::string key, std::string value) && {
+    return std::move(addMetadata(std::move(key), std::move(value)));
+  }
+
+  [[nodiscard]] std::size_t getLength() const { return length_; }
+
+  [[nodiscard]] const std::vector<Column>& getColumns() const { return columns_; }
+
+  // Exports the batch as the struct array of the columns by the Arrow C data interface: the consumer owns the array
+  // and the schema (and releases them by their release callbacks), the buffers are the ones of the batch. The batch is
+  // moved to the export.
+  void exportTo(ArrowArray* array, ArrowSchema* schema) && {
+    auto exported = std::make_shared<Export>(Export{std::make_shared<const ArrowBatch>(std::move(*this))});
+    auto& e = *exported;
+    const auto& columns = e.batch->columns_;
+    auto length = static_cast<std::int64_t>(e.batch->length_);
+    std::size_t dictionariesNumber = 0;
+
+    for (const auto& column : columns) {
+      dictionariesNumber += column.type == Type::DICTIONARY_UTF8 ? 1 : 0;
+    }
+
+    e.metadata = e.batch->encodeMetadata();
+    // The columns, the dictionaries and the struct (the last one)
+    e.schemas.resize(columns.size() + dictionariesNumber + 1);
+    e.arrays.resize(columns.size() + dictionariesNumber + 1);
+    e.buffers.resize(columns.size() * 2 + dictionariesNumber * 3 + 1);
+
+    auto privateData = [exported] { return static_cast<void*>(new std::shared_ptr<Export>(exported)); };
+    auto buffers = e.buffers.data();
+    auto dictionaryPosition = columns.size();
+
+    for (std::size_t i = 0; i < columns.size(); i++) {
+      const auto& column = columns[i];
+      auto& childSchema = e.schemas[i];
+      auto& childArray = e.arrays[i];
+
+      buffers[0] = nullptr;
+      buffers[1] = column.dataSize != 0 ? column.data : getEmptyData();
+      childSchema = {getFormat(column.type), column.name.c_str(), nullptr, 0, 0, nullptr, nullptr,
+                     &release<ArrowSchema>, privateData()};
+      childArray = {length, 0, 0, 2, 0, buffers, nullptr, nullptr, &release<ArrowArray>, privateData()};
+      buffers += 2;
+
+      if (column.type == Type::DICTIONARY_UTF8) {
+        auto& dictionarySchema = e.schemas[dictionaryPosition];
+        auto& dictionaryArray = e.arrays[dictionaryPosition];
+
+        buffers[0] = nullptr;
+        buffers[1] = column.dictionary->offsets.data();
+        buffers[2] = column.dictionary->data.empty() ? getEmptyData() : column.dictionary->data.data();
+        dictionarySchema = {"u", "", nullptr, 0, 0, nullptr, nullptr, &release<ArrowSchema>, privateData()};
+        dictionaryArray = {static_cast<std::int64_t>(column.dictionary->getSize()),
+                           0,
+                           0,
+                           3,
+                           0,
+                           buffers,
+                           nullptr,
+                           nullptr,
+                           &release<ArrowArray>,
+                           privateData()};
+        childSchema.dictionary = &dictionarySchema;
+        childArray.dictionary = &dictionaryArray;
+        buffers += 3;
+        dictionaryPosition++;
+      }
+
+      e.schemaChildren.push_back(&childSchema);
+      e.arrayChildren.push_back(&childArray);
+    }
+
+    buffers[0] = nullptr;
+    *schema = {"+s",
+               "",
+               e.metadata.empty() ? nullptr : e.metadata.c_str(),
+               0,
+               static_cast<std::int64_t>(columns.size()),
+               e.schemaChildren.data(),
+               nullptr,
+               &release<ArrowSchema>,
+               privateData()};
+    *array = {length, 0, 0, 1, static_cast<std::int64_t>(columns.size()), buffers, e.arrayChildren.data(), nullptr,
+              &release<ArrowArray>, privateData()};
+  }
+
+  // Writes the batch to the Arrow IPC file (Feather V2): the schema, the dictionaries and the record batch, the buffers
+  // are written from the columns as is. The file is written to the temporary file and renamed to the path. Returns
+  // false if the file can't be written.
+  bool writeFile(const std::string& path) const {
+    auto temporaryPath = path + ".tmp";
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> file{std::fopen(temporaryPath.c_str(), "wb"), &std::fclose};
+
+    if (!file) {
+      return false;
+    }
+
+    IpcFile ipc{file.get()};
+    std::vector<Block> dictionaryBlocks{};
+    std::vector<FieldNode> nodes{};
+    std::vector<std::pair<const void*, std::size_t>> buffers{};
+    std::vector<std::size_t> bufferSizes{};
+    auto length = static_cast<std::int64_t>(length_);
+
+    ipc.write(MAGIC, sizeof(MAGIC));
+    ipc.pad();
+    ipc.writeMessage(1, [this](auto& builder) { return createSchema(builder); }, 0);
+
+    for (std::size_t i = 0; i < columns_.size(); i++) {
+      const auto& column = columns_[i];
+
+      nodes.push_back({length, 0});
+      buffers.emplace_back(nullptr, 0);
+      buffers.emplace_back(column.data, column.dataSize);
+
+      if (column.type != Type::DICTIONARY_UTF8) {
+        continue;
+      }
+
+      // The dictionary batch of the column
+      const auto& dictionary = *column.dictionary;
+      FieldNode dictionaryNode{static_cast<std::int64_t>(dictionary.getSize()), 0};
+      std::pair<const void*, std::size_t> dictionaryBuffers[] = {
+        {nullptr, 0},
+        {dictionary.offsets.data(), dictionary.offsets.size() * sizeof(std::int32_t)},
+        {dictionary.data.data(), dictionary.data.size()}};
+      std::size_t dictionaryBufferSizes[] = {0, dictionaryBuffers[1].second, dictionaryBuffers[2].second};
+
+      dictionaryBlocks.push_back(ipc.writeMessage(
+        2,
+        [i, &dictionaryNode, &dictionaryBufferSizes](auto& builder) {
+          auto data = createRecordBatch(builder, dictionaryNode.length, {&dictionaryNode, 1}, dictionaryBufferSizes);
+
+          builder.startTable();
+          builder.addScalar(0, static_cast<std::int64_t>(i));
+          builder.addOffset(1, data);
+          builder.addScalar(2, std::uint8_t{0});
+
+          return builder.endTable();
+        },
+        getBodyLength(dictionaryBuffers)));
+      ipc.writeBody(dictionaryBuffers);
+    }
+
+    for (auto [data, size] : buffers) {
+      bufferSizes.push_back(size);
+    }
+
+    auto batchBlock = ipc.writeMessage(
+      3,
+      [length, &nodes, &bufferSizes](auto& builder) { return createRecordBatch(builder, length, nodes, bufferSizes); },
+      getBodyLength(buffers));
+
+    ipc.writeBody(buffers);
+
+    // The end of the stream, then the footer
+    std::int32_t endOfStream[2] = {-1, 0};
+
+    ipc.write(endOfStream, sizeof(endOfStream));
+
+    detail::ArrowFlatBufferBuilder builder{};
+    auto schema = createSchema(builder);
+    auto dictionaries = builder.createStructVector(std::span<const Block>{dictionaryBlocks});
+    auto recordBatches = builder.createStructVector(std::span<const Block>{&batchBlock, 1});
+
+    builder.startTable();
+    builder.addScalar(0, METADATA_VERSION);
+    builder.addOffset(1, schema);
+    builder.addOffset(2, dictionaries);
+    builder.addOffset(3, recordBatches);
+
+    auto footer = builder.finish(builder.endTable());
+    auto footerSize = static_cast<std::int32_t>(footer.size());
+
+    ipc.write(footer.data(), footer.size());
+    ipc.write(&footerSize, sizeof(footerSize));
+    ipc.write(MAGIC, sizeof(MAGIC));
+
+    auto isWritten = !ipc.isFailed();
+
+    isWritten = std::fclose(file.release()) == 0 && isWritten;
+
+    std::error_code ec{};
+
+    if (isWritten) {
+      std::filesystem::rename(temporaryPath, path, ec);
+    }
+
+    if (!isWritten || ec) {
+      std::filesystem::remove(temporaryPath, ec);
+
+      return false;
+    }
+
+    return true;
+  }
+};
+
+}  // namespace dxf
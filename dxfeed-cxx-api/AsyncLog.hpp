@@ -0,0 +1,359 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace dxf {
+
+// The formats of the log records (the format id of the binary record)
+enum class LogEvent : std::uint32_t {
+  // event type, symbols number
+  SUBSCRIBED = 0,
+  // event type, symbols number
+  SUBSCRIPTION_FAILED = 1,
+  // event type, symbol id, events number
+  EVENTS = 2,
+  // event type, symbol id (the requested symbol is caught up)
+  SYMBOL_COMPLETED = 3,
+  // event type
+  UNSUBSCRIBED = 4,
+};
+
+struct LogRecord {
+  // The microseconds since the epoch
+  std::uint64_t timestamp{};
+  LogEvent event{};
+  std::uint64_t args[4]{};
+};
+
+// The ring of the log records of one thread: the writer never blocks, the record is dropped (and counted) if the ring
+// is full. The records are read and formatted by the thread of the AsyncLog.
+class LogRing final {
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  std::unique_ptr<LogRecord[]> records_;
+  std::size_t mask_;
+
+  // The number of the read records. Written by the reader only.
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> head_{};
+  // The number of the written records. Written by the writer only.
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> tail_{};
+  std::atomic<std::uint64_t> droppedNumber_{};
+  // The thread of the ring is finished, so the ring may be taken by the next thread
+  std::atomic<bool> isReleased_{false};
+
+  template <typename T>
+  static std::uint64_t toArg(T value) {
+    if constexpr (std::is_floating_point_v<T>) {
+      return std::bit_cast<std::uint64_t>(static_cast<double>(value));
+    } else {
+      return static_cast<std::uint64_t>(value);
+    }
+  }
+
+ public:
+  // capacity - the number of the records (rounded up to the power of 2)
+  explicit LogRing(std::size_t capacity)
+      : records_{new LogRecord[std::bit_ceil(capacity)]}, mask_{std::bit_ceil(capacity) - 1} {}
+
+  // Writer. Returns false if the record is dropped.
+  template <typename... Args>
+  bool write(LogEvent event, Args... args) {
+    static_assert(sizeof...(Args) <= 4);
+
+    auto tail = tail_.load(std::memory_order_relaxed);
+
+    if (tail - head_.load(std::memory_order_acquire) > mask_) {
+      droppedNumber_.store(droppedNumber_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+      return false;
+    }
+
+    auto& record = records_[tail & mask_];
+
+    record.timestamp = static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count());
+    record.event = event;
+
+    std::size_t i = 0;
+    ((record.args[i++] = toArg(args)), ...);
+
+    tail_.store(tail + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  // Reader. Appends the written records to the batch.
+  void read(std::vector<LogRecord>& batch) {
+    auto head = head_.load(std::memory_order_relaxed);
+    auto tail = tail_.load(std::memory_order_acquire);
+
+    for (; head != tail; head++) {
+      batch.push_back(records_[head & mask_]);
+    }
+
+    head_.store(head, std::memory_order_release);
+  }
+
+  [[nodiscard]] std::uint64_t getDroppedNumber() const { return droppedNumber_.load(std::memory_order_relaxed); }
+
+  [[nodiscard]] bool isReleased() const { return isReleased_.load(std::memory_order_acquire); }
+
+  void setReleased(bool isReleased) { isReleased_.store(isReleased, std::memory_order_release); }
+};
+
+// The process-wide asynchronous log of the binary records: every writing thread has its own ring (taken on the first
+// write), the records are formatted and written to the file by the background thread, so the writers (e.g. the
+// connection threads of the C API) don't format and don't do the I/O. The records of every drain are ordered by the
+// time. The dropped records are counted and reported in the log.
+//
+// Usage:
+//   AsyncLog::enable("app.log");
+//   logEvent(LogEvent::EVENTS, eventType, symbol.getId(), count);
+//   AsyncLog::disable();   // drains the rings and closes the file
+//
+// The call costs an atomic load until the log is enabled.
+class AsyncLog final {
+  struct State {
+    std::mutex mutex{};
+    std::condition_variable stopped{};
+    std::vector<std::unique_ptr<LogRing>> rings{};
+    // The dropped numbers of the rings that are already reported
+    std::vector<std::uint64_t> reportedDroppedNumbers{};
+    std::size_t ringCapacity = 0;
+    std::FILE* file = nullptr;
+    std::thread thread{};
+    bool isStopping = false;
+  };
+
+  // Releases the ring of the thread when the thread is finished
+  struct ThreadRing {
+    LogRing* ring = nullptr;
+
+    ~ThreadRing() {
+      if (ring != nullptr) {
+        ring->setReleased(true);
+      }
+    }
+  };
+
+  static std::atomic<bool>& enabled() {
+    static std::atomic<bool> enabled{false};
+
+    return enabled;
+  }
+
+  static State& state() {
+    static State state{};
+
+    return state;
+  }
+
+  static std::atomic<std::uint64_t>& totalDroppedNumber() {
+    static std::atomic<std::uint64_t> totalDroppedNumber{};
+
+    return totalDroppedNumber;
+  }
+
+  // Takes the released ring or adds the new one
+  static LogRing* acquireRing() {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    for (auto& ring : s.rings) {
+      if (ring->isReleased()) {
+        ring->setReleased(false);
+
+        return ring.get();
+      }
+    }
+
+    return s.rings.emplace_back(std::make_unique<LogRing>(s.ringCapacity)).get();
+  }
+
+  static void format(std::string& buffer, const LogRecord& record) {
+    auto out = std::back_inserter(buffer);
+
+    fmt::format_to(out, "{}.{:06} ", record.timestamp / 1000000, record.timestamp % 1000000);
+
+    switch (record.event) {
+      case LogEvent::SUBSCRIBED:
+        fmt::format_to(out, "Subscribed: type={},symbols={}\n", record.args[0], record.args[1]);
+        break;
+      case LogEvent::SUBSCRIPTION_FAILED:
+        fmt::format_to(out, "Subscription failed: type={},symbols={}\n", record.args[0], record.args[1]);
+        break;
+      case LogEvent::EVENTS:
+        fmt::format_to(out, "Events: type={},symbol={},count={}\n", record.args[0], record.args[1], record.args[2]);
+        break;
+      case LogEvent::SYMBOL_COMPLETED:
+        fmt::format_to(out, "Symbol completed: type={},symbol={}\n", record.args[0], record.args[1]);
+        break;
+      case LogEvent::UNSUBSCRIBED:
+        fmt::format_to(out, "Unsubscribed: type={}\n", record.args[0]);
+        break;
+    }
+  }
+
+  // Reads the rings, formats the records and writes them. Returns false if there were no records.
+  static bool drain(std::vector<LogRecord>& batch, std::string& buffer) {
+    auto& s = state();
+    std::uint64_t newDroppedNumber = 0;
+
+    batch.clear();
+
+    {
+      std::lock_guard<std::mutex> lock(s.mutex);
+
+      s.reportedDroppedNumbers.resize(s.rings.size());
+
+      for (std::size_t i = 0; i < s.rings.size(); i++) {
+        s.rings[i]->read(batch);
+
+        auto droppedNumber = s.rings[i]->getDroppedNumber();
+
+        newDroppedNumber += droppedNumber - s.reportedDroppedNumbers[i];
+        s.reportedDroppedNumbers[i] = droppedNumber;
+      }
+    }
+
+    if (batch.empty() && newDroppedNumber == 0) {
+      return false;
+    }
+
+    std::stable_sort(batch.begin(), batch.end(),
+                     [](const LogRecord& a, const LogRecord& b) { return a.timestamp < b.timestamp; });
+    buffer.clear();
+
+    for (const auto& record : batch) {
+      format(buffer, record);
+    }
+
+    if (newDroppedNumber != 0) {
+      totalDroppedNumber().fetch_add(newDroppedNumber, std::memory_order_relaxed);
+      fmt::format_to(std::back_inserter(buffer), "Dropped records: {}\n", newDroppedNumber);
+    }
+
+    std::fwrite(buffer.data(), 1, buffer.size(), s.file);
+
+    return true;
+  }
+
+  static void run(std::chrono::milliseconds interval) {
+    auto& s = state();
+    std::vector<LogRecord> batch{};
+    std::string buffer{};
+
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(s.mutex);
+
+        if (s.stopped.wait_for(lock, interval, [&s] { return s.isStopping; })) {
+          break;
+        }
+      }
+
+      if (drain(batch, buffer)) {
+        std::fflush(s.file);
+      }
+    }
+
+    drain(batch, buffer);
+    std::fflush(s.file);
+  }
+
+ public:
+  // Opens the file (appends to it) and starts the thread that writes the records every interval. ringCapacity - the
+  // number of the records of the ring of every thread. Returns false if the file can't be opened or the log is enabled.
+  static bool enable(const std::string& path, std::size_t ringCapacity = 1 << 14,
+                     std::chrono::milliseconds interval = std::chrono::milliseconds(10)) {
+    auto& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+
+    if (s.file != nullptr) {
+      return false;
+    }
+
+    s.file = std::fopen(path.c_str(), "ab");
+
+    if (s.file == nullptr) {
+      return false;
+    }
+
+    // The rings of the previous enable are kept: the threads still own them
+    s.ringCapacity = ringCapacity;
+    s.isStopping = false;
+    s.thread = std::thread(&AsyncLog::run, interval);
+    enabled().store(true, std::memory_order_release);
+
+    return true;
+  }
+
+  // Stops the writes, drains the rings and closes the file
+  static void disable() {
+    auto& s = state();
+    std::unique_lock<std::mutex> lock(s.mutex);
+
+    if (s.file == nullptr) {
+      return;
+    }
+
+    enabled().store(false, std::memory_order_release);
+    s.isStopping = true;
+    s.stopped.notify_one();
+    lock.unlock();
+    s.thread.join();
+    lock.lock();
+    std::fclose(s.file);
+    s.file = nullptr;
+  }
+
+  [[nodiscard]] static bool isEnabled() { return enabled().load(std::memory_order_acquire); }
+
+  // The number of the records dropped because the rings were full (counted by the background thread)
+  [[nodiscard]] static std::uint64_t getDroppedNumber() {
+    return totalDroppedNumber().load(std::memory_order_relaxed);
+  }
+
+  // Returns the ring of the current thread (takes it on the first call)
+  static LogRing& getThreadRing() {
+    thread_local ThreadRing threadRing{};
+
+    if (threadRing.ring == nullptr) {
+      threadRing.ring = acquireRing();
+    }
+
+    return *threadRing.ring;
+  }
+
+  // Returns false if the record is dropped
+  template <typename... Args>
+  static bool write(LogEvent event, Args... args) {
+    return getThreadRing().write(event, args...);
+  }
+};
+
+template <typename... Args>
+inline void logEvent(LogEvent event, Args... args) {
+  if (AsyncLog::isEnabled()) {
+    AsyncLog::write(event, args...);
+  }
+}
+
+}  // namespace dxf
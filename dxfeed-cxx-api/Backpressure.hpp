@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "Metrics.hpp"
+
+namespace dxf {
+
+// What the producer (the connection thread) does when the queue of the slow consumer is full
+enum class BackpressurePolicy : int {
+  // Waits for the consumer (the connection thread is blocked, nothing is lost)
+  BLOCK = 0,
+  // Drops the oldest queued data, so the consumer sees the latest data
+  DROP_OLDEST = 1,
+  // Folds the new data into the queued data (e.g. the latest event of the same key, the merged order book records), so
+  // the consumer sees the net result
+  CONFLATE = 2,
+  // Stops the delivery (e.g. closes the subscription) and drops the data, so the consumer is recreated
+  DISCONNECT = 3
+};
+
+// The bound of the queue of one consumer path (e.g. EventStream, the async PriceLevelBook)
+struct BackpressureConfig {
+  // The maximum number of the queued items (the events, the snapshot data chunks). 0 - unbounded (the stream) or the
+  // queue depth (the book).
+  std::size_t capacity = 0;
+  BackpressurePolicy policy = BackpressurePolicy::BLOCK;
+};
+
+// The copy of the backpressure counters of one consumer path (see BackpressureCounters::getStats)
+struct BackpressureStats {
+  // The number of the queued items now and the maximum so far
+  std::size_t queueDepth = 0;
+  std::size_t highWaterMark = 0;
+  // The items (the events, the order records) dropped by the DROP_OLDEST and the DISCONNECT policies
+  std::uint64_t droppedNumber = 0;
+  // The items folded by the CONFLATE policy
+  std::uint64_t conflatedNumber = 0;
+  // The number of the times the producer has found the queue full and the time it was blocked by the BLOCK policy
+  std::uint64_t overflowsNumber = 0;
+  std::chrono::nanoseconds blockedTime{0};
+  // The DISCONNECT policy has stopped the delivery
+  bool isDisconnected = false;
+};
+
+// The backpressure counters of one consumer path: written by the producer and the consumer, read by any thread. The
+// capacity problems show up as the growing high-water mark, the drops or the blocked time.
+class BackpressureCounters final {
+  std::atomic<std::size_t> queueDepth_{0};
+  std::atomic<std::size_t> highWaterMark_{0};
+  std::atomic<std::uint64_t> droppedNumber_{0};
+  std::atomic<std::uint64_t> conflatedNumber_{0};
+  std::atomic<std::uint64_t> overflowsNumber_{0};
+  std::atomic<std::int64_t> blockedNanos_{0};
+  std::atomic<bool> isDisconnected_{false};
+
+ public:
+  void recordDepth(std::size_t depth) {
+    queueDepth_.store(depth, std::memory_order_relaxed);
+
+    auto highWaterMark = highWaterMark_.load(std::memory_order_relaxed);
+
+    while (depth > highWaterMark &&
+           !highWaterMark_.compare_exchange_weak(highWaterMark, depth, std::memory_order_relaxed)) {
+    }
+  }
+
+  void recordOverflow() { overflowsNumber_.fetch_add(1, std::memory_order_relaxed); }
+
+  void recordDropped(std::uint64_t number) { droppedNumber_.fetch_add(number, std::memory_order_relaxed); }
+
+  void recordConflated(std::uint64_t number) { conflatedNumber_.fetch_add(number, std::memory_order_relaxed); }
+
+  void recordBlocked(std::chrono::nanoseconds time) {
+    blockedNanos_.fetch_add(static_cast<std::int64_t>(time.count()), std::memory_order_relaxed);
+  }
+
+  // Returns false if the delivery is already stopped
+  bool setDisconnected() { return !isDisconnected_.exchange(true, std::memory_order_acq_rel); }
+
+  [[nodiscard]] bool isDisconnected() const { return isDisconnected_.load(std::memory_order_acquire); }
+
+  // Resumes the delivery (e.g. the consumer is resynchronized)
+  void resetDisconnected() { isDisconnected_.store(false, std::memory_order_release); }
+
+  [[nodiscard]] BackpressureStats getStats() const {
+    return {queueDepth_.load(std::memory_order_relaxed),
+            highWaterMark_.load(std::memory_order_relaxed),
+            droppedNumber_.load(std::memory_order_relaxed),
+            conflatedNumber_.load(std::memory_order_relaxed),
+            overflowsNumber_.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds{blockedNanos_.load(std::memory_order_relaxed)},
+            isDisconnected_.load(std::memory_order_acquire)};
+  }
+};
+
+// Writes the backpressure counters of one consumer path as the metrics <prefix>_queue_depth, <prefix>_dropped_total,
+// etc.
+inline void collectBackpressureMetrics(MetricsWriter& writer, std::string_view prefix, const MetricLabels& labels,
+                                       const BackpressureStats& stats) {
+  auto name = [prefix](std::string_view suffix) { return std::string{prefix} + std::string{suffix}; };
+
+  writer.gauge(name("_queue_depth"), "The number of the queued items", labels, static_cast<double>(stats.queueDepth));
+  writer.gauge(name("_queue_high_water_mark"), "The maximum number of the queued items", labels,
+               static_cast<double>(stats.highWaterMark));
+  writer.counter(name("_dropped_total"), "The items dropped by the backpressure policy", labels,
+                 static_cast<double>(stats.droppedNumber));
+  writer.counter(name("_conflated_total"), "The items conflated by the backpressure policy", labels,
+                 static_cast<double>(stats.conflatedNumber));
+  writer.counter(name("_queue_overflows_total"), "The times the producer has found the queue full", labels,
+                 static_cast<double>(stats.overflowsNumber));
+  writer.counter(name("_blocked_seconds_total"), "The time the producer was blocked by the full queue", labels,
+                 std::chrono::duration<double>(stats.blockedTime).count());
+  writer.gauge(name("_disconnected"), "1 if the delivery is stopped by the backpressure policy", labels,
+               stats.isDisconnected ? 1.0 : 0.0);
+}
+
+}  // namespace dxf
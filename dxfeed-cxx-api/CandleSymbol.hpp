@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+enum class CandleType {
+  TICK,
+  SECOND,
+  MINUTE,
+  HOUR,
+  DAY,
+  WEEK,
+  MONTH,
+  OPTEXP,
+  YEAR,
+  VOLUME,
+  PRICE,
+  PRICE_MOMENTUM,
+  PRICE_RENKO
+};
+
+enum class CandlePrice { LAST, BID, ASK, MARK, SETTLEMENT };
+
+enum class CandleSession { ANY, REGULAR };
+
+enum class CandleAlignment { MIDNIGHT, SESSION };
+
+struct CandlePeriod {
+  double value = 1.0;
+  CandleType type = CandleType::TICK;
+
+  friend bool operator==(const CandlePeriod&, const CandlePeriod&) = default;
+};
+
+// The attributes of the candle symbol, e.g. "AAPL&Q{=5m,price=mark,tho=true}": the base symbol, the exchange, the
+// period (the "" key), the price ("price"), the session ("tho"), the alignment ("a") and the price level ("pl"). The
+// unknown attributes and the invalid values are ignored (the defaults are used).
+//
+// The parsed attributes are memoised by the interned symbol (see CandleSymbol::valueOf), so the subscriptions and the
+// events of the same candle symbol don't parse the string again.
+struct CandleSymbol {
+  // The interned candle symbol as it's subscribed
+  Symbol symbol{};
+  std::string baseSymbol{};
+  // '\0' - the composite
+  char exchange = '\0';
+  CandlePeriod period{};
+  CandlePrice price = CandlePrice::LAST;
+  CandleSession session = CandleSession::ANY;
+  CandleAlignment alignment = CandleAlignment::MIDNIGHT;
+  // NaN - the default
+  double priceLevel = std::numeric_limits<double>::quiet_NaN();
+
+ private:
+  struct TypeName {
+    std::string_view name;
+    CandleType type;
+  };
+
+  static constexpr TypeName TYPE_NAMES[] = {
+    {"t", CandleType::TICK},     {"s", CandleType::SECOND},   {"m", CandleType::MINUTE},
+    {"h", CandleType::HOUR},     {"d", CandleType::DAY},      {"w", CandleType::WEEK},
+    {"mo", CandleType::MONTH},   {"o", CandleType::OPTEXP},   {"y", CandleType::YEAR},
+    {"v", CandleType::VOLUME},   {"p", CandleType::PRICE},    {"pm", CandleType::PRICE_MOMENTUM},
+    {"pr", CandleType::PRICE_RENKO}};
+
+  static constexpr std::string_view PRICE_NAMES[] = {"last", "bid", "ask", "mark", "s"};
+
+  static bool parseDouble(std::string_view s, double& value) {
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+
+    return ec == std::errc{} && ptr == s.data() + s.size();
+  }
+
+  static void appendDouble(std::string& result, double value) {
+    char buffer[32]{};
+    auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+
+    result.append(buffer, ptr);
+  }
+
+  // "5m", "d" (the value 1), "1.5h"
+  static bool parsePeriod(std::string_view s, CandlePeriod& period) {
+    auto typeStart = s.find_first_not_of("0123456789.");
+
+    if (typeStart == std::string_view::npos) {
+      return false;
+    }
+
+    auto value = 1.0;
+
+    if (typeStart != 0 && !parseDouble(s.substr(0, typeStart), value)) {
+      return false;
+    }
+
+    for (const auto& typeName : TYPE_NAMES) {
+      if (typeName.name == s.substr(typeStart)) {
+        period = {value, typeName.type};
+
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void parseAttribute(std::string_view key, std::string_view value) {
+    if (key.empty()) {
+      parsePeriod(value, period);
+    } else if (key == "price") {
+      for (std::size_t i = 0; i < std::size(PRICE_NAMES); i++) {
+        if (PRICE_NAMES[i] == value) {
+          price = static_cast<CandlePrice>(i);
+        }
+      }
+    } else if (key == "tho") {
+      session = value == "true" ? CandleSession::REGULAR : CandleSession::ANY;
+    } else if (key == "a") {
+      alignment = value == "s" ? CandleAlignment::SESSION : CandleAlignment::MIDNIGHT;
+    } else if (key == "pl") {
+      double level{};
+
+      if (parseDouble(value, level)) {
+        priceLevel = level;
+      }
+    }
+  }
+
+ public:
+  // Parses the attributes of the candle symbol (doesn't intern it, see valueOf)
+  static CandleSymbol parse(std::string_view candleSymbol) {
+    CandleSymbol result{};
+    auto attributesStart = candleSymbol.find('{');
+    auto base = candleSymbol.substr(0, attributesStart);
+
+    // The exchange suffix, e.g. "AAPL&Q"
+    if (base.size() >= 3 && base[base.size() - 2] == '&') {
+      result.exchange = base.back();
+      base.remove_suffix(2);
+    }
+
+    result.baseSymbol = base;
+
+    if (attributesStart == std::string_view::npos || candleSymbol.back() != '}') {
+      return result;
+    }
+
+    auto attributes = candleSymbol.substr(attributesStart + 1, candleSymbol.size() - attributesStart - 2);
+
+    while (!attributes.empty()) {
+      auto end = (std::min)(attributes.find(','), attributes.size());
+      auto attribute = attributes.substr(0, end);
+      auto equals = attribute.find('=');
+
+      if (equals != std::string_view::npos) {
+        result.parseAttribute(attribute.substr(0, equals), attribute.substr(equals + 1));
+      }
+
+      attributes.remove_prefix((std::min)(end + 1, attributes.size()));
+    }
+
+    return result;
+  }
+
+  // Returns the attributes of the interned candle symbol. The symbol is parsed once, the next calls return the same
+  // object (it's never removed, as the symbol).
+  static const CandleSymbol& valueOf(const Symbol& symbol);
+
+  static const CandleSymbol& valueOf(std::string_view candleSymbol) { return valueOf(Symbol::valueOf(candleSymbol)); }
+
+  // The normalized name: the default attributes are omitted, the rest are ordered by the keys
+  [[nodiscard]] std::string toString() const {
+    std::string result{baseSymbol};
+    std::string attributes{};
+
+    if (exchange != '\0') {
+      result += '&';
+      result += exchange;
+    }
+
+    auto addKey = [&attributes](std::string_view key) {
+      attributes += attributes.empty() ? "{" : ",";
+      attributes += key;
+      attributes += '=';
+    };
+
+    if (period != CandlePeriod{}) {
+      addKey("");
+
+      if (period.value != 1.0) {
+        appendDouble(attributes, period.value);
+      }
+
+      attributes += TYPE_NAMES[static_cast<std::size_t>(period.type)].name;
+    }
+
+    if (alignment == CandleAlignment::SESSION) {
+      addKey("a");
+      attributes += 's';
+    }
+
+    if (!std::isnan(priceLevel)) {
+      addKey("pl");
+      appendDouble(attributes, priceLevel);
+    }
+
+    if (price != CandlePrice::LAST) {
+      addKey("price");
+      attributes += PRICE_NAMES[static_cast<std::size_t>(price)];
+    }
+
+    if (session == CandleSession::REGULAR) {
+      addKey("tho");
+      attributes += "true";
+    }
+
+    if (!attributes.empty()) {
+      result += attributes;
+      result += '}';
+    }
+
+    return result;
+  }
+
+  // The candle symbols of every base symbol with every attributes set (e.g. {"AAPL", "IBM"} x {"=5m", "=d,price=mark"}
+  // -> "AAPL{=5m}", "AAPL{=d,price=mark}", "IBM{=5m}", "IBM{=d,price=mark}"; the empty attributes give the base
+  // symbol). The symbols are interned and parsed at once, so all of them are subscribed by one request (e.g.
+  // HistoryDataProvider<Candle>::run) and their events are resolved by the memoised attributes.
+  static std::vector<std::string> makeSymbols(const std::vector<std::string>& baseSymbols,
+                                              const std::vector<std::string>& attributes) {
+    std::vector<std::string> result{};
+
+    result.reserve(baseSymbols.size() * attributes.size());
+
+    for (const auto& baseSymbol : baseSymbols) {
+      for (const auto& attribute : attributes) {
+        auto& candleSymbol = result.emplace_back(baseSymbol);
+
+        if (!attribute.empty()) {
+          candleSymbol += '{';
+          candleSymbol += attribute;
+          candleSymbol += '}';
+        }
+
+        valueOf(candleSymbol);
+      }
+    }
+
+    return result;
+  }
+};
+
+// The process-wide table of the parsed candle symbols by the ids of the interned symbols
+class CandleSymbolTable final {
+  std::mutex mutex_{};
+  std::vector<const CandleSymbol*> byId_{};
+  std::deque<CandleSymbol> candleSymbols_{};
+
+  CandleSymbolTable() = default;
+
+ public:
+  static CandleSymbolTable& getInstance() {
+    static CandleSymbolTable instance{};
+
+    return instance;
+  }
+
+  // Parses the symbol on the first call only
+  const CandleSymbol& get(const Symbol& symbol) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto id = symbol.getId();
+
+    if (id < byId_.size() && byId_[id] != nullptr) {
+      return *byId_[id];
+    }
+
+    auto& candleSymbol = candleSymbols_.emplace_back(CandleSymbol::parse(symbol.getName()));
+
+    candleSymbol.symbol = symbol;
+
+    if (id >= byId_.size()) {
+      byId_.resize(static_cast<std::size_t>(id) + 1, nullptr);
+    }
+
+    byId_[id] = &candleSymbol;
+
+    return candleSymbol;
+  }
+
+  [[nodiscard]] std::size_t getSize() {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return candleSymbols_.size();
+  }
+};
+
+inline const CandleSymbol& CandleSymbol::valueOf(const Symbol& symbol) {
+  return CandleSymbolTable::getInstance().get(symbol);
+}
+
+}  // namespace dxf
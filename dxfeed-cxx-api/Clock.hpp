@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace dxf {
+
+// The source of the time of the C++ API: the timers of the Executor (the timeouts of the fetches, the rates of the
+// conflated subscriptions), the waits for the disconnect, the conflation windows of the books, the live lag of the
+// completions and the times of the checkpoints. The default one is the real time (SystemClock). The SimulatedClock is
+// moved by the replay (e.g. by the times of the tape records), so the replays run faster than the real time and every
+// run sees the same times.
+//
+// Usage:
+//   SimulatedClock clock{firstRecordTime};
+//   Clock::setDefault(&clock);  // Before the executors and the books are created
+//
+//   reader->forEachRecord([&](const TimeAndSaleRecord &record) {
+//     clock.advanceTo(record.time);
+//     ...
+//   });
+//
+//   Clock::setDefault(nullptr);
+class Clock {
+ public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  virtual ~Clock() = default;
+
+  // The monotonic time
+  [[nodiscard]] virtual TimePoint now() const = 0;
+
+  // The wall clock time (milliseconds since the epoch)
+  [[nodiscard]] virtual std::int64_t currentTimeMillis() const = 0;
+
+  // The time is moved by the calls (the advance handlers are called), not by the real time
+  [[nodiscard]] virtual bool isSimulated() const { return false; }
+
+  // Adds the handler that is called after every advance of the simulated time. Returns the id of the handler (0 - the
+  // clock isn't simulated, the handler is never called).
+  virtual std::uint64_t addAdvanceHandler(std::function<void()> handler) {
+    (void)handler;
+
+    return 0;
+  }
+
+  // The handler isn't called after the removal (waits for its running call)
+  virtual void removeAdvanceHandler(std::uint64_t id) { (void)id; }
+
+  // Waits on the condition variable until the predicate is true or the time of the clock comes. The waits on the
+  // simulated clock must be woken by the advance handler that locks the mutex of the wait and notifies the condition
+  // variable (see AdvanceHandler). Returns the predicate.
+  template <typename Predicate>
+  bool waitUntil(std::unique_lock<std::mutex> &lock, std::condition_variable &cv, TimePoint time,
+                 Predicate isDone) const {
+    if (!isSimulated()) {
+      return cv.wait_until(lock, time, isDone);
+    }
+
+    while (!isDone()) {
+      if (now() >= time) {
+        return false;
+      }
+
+      cv.wait(lock);
+    }
+
+    return true;
+  }
+
+  // The installed clock (SystemClock by default)
+  static Clock &getDefault();
+
+  // Installs the clock of the API (nullptr - SystemClock), the clock must outlive its users. The components take the
+  // clock when they are created, so it is installed before them (e.g. at the start of the replay).
+  static void setDefault(Clock *clock);
+
+  // Installs the clock of the current thread (nullptr - the default one) that getDefault returns on this thread, e.g.
+  // the simulated clock of the shard of the parallel replay: the synchronous books of the shard follow its time.
+  static void setThreadDefault(Clock *clock);
+};
+
+// The real time: std::chrono::steady_clock and std::chrono::system_clock
+class SystemClock final : public Clock {
+ public:
+  [[nodiscard]] TimePoint now() const override { return std::chrono::steady_clock::now(); }
+
+  [[nodiscard]] std::int64_t currentTimeMillis() const override {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+      .count();
+  }
+
+  static SystemClock &getInstance() {
+    static SystemClock instance{};
+
+    return instance;
+  }
+};
+
+namespace detail {
+
+inline std::atomic<Clock *> &getDefaultClock() {
+  static std::atomic<Clock *> clock{&SystemClock::getInstance()};
+
+  return clock;
+}
+
+inline Clock *&getThreadClock() {
+  static thread_local Clock *clock = nullptr;
+
+  return clock;
+}
+
+}  // namespace detail
+
+inline Clock &Clock::getDefault() {
+  if (auto *threadClock = detail::getThreadClock(); threadClock != nullptr) {
+    return *threadClock;
+  }
+
+  return *detail::getDefaultClock().load(std::memory_order_acquire);
+}
+
+inline void Clock::setDefault(Clock *clock) {
+  detail::getDefaultClock().store(clock != nullptr ? clock : &SystemClock::getInstance(), std::memory_order_release);
+}
+
+inline void Clock::setThreadDefault(Clock *clock) { detail::getThreadClock() = clock; }
+
+// The time that is moved only by the calls (advanceTo, advanceBy): the wall clock time is the time of the data (e.g.
+// of the replayed events), the monotonic time moves by the same amounts. The time never moves back: the earlier times
+// are ignored. The handlers of the advance (the executors, the waits) are called on the advancing thread.
+class SimulatedClock final : public Clock {
+  std::atomic<std::int64_t> timeMillis_;
+  std::atomic<std::int64_t> nanos_;
+  // Guards the handlers, held while they are called
+  mutable std::mutex mutex_{};
+  std::vector<std::pair<std::uint64_t, std::function<void()>>> handlers_{};
+  std::uint64_t lastHandlerId_ = 0;
+
+  void notifyHandlers() {
+    std::lock_guard lock{mutex_};
+
+    for (const auto &[id, handler] : handlers_) {
+      handler();
+    }
+  }
+
+ public:
+  // timeMillis - the initial wall clock time (milliseconds since the epoch)
+  explicit SimulatedClock(std::int64_t timeMillis = 0) : timeMillis_{timeMillis}, nanos_{0} {}
+
+  SimulatedClock(const SimulatedClock &) = delete;
+  SimulatedClock &operator=(const SimulatedClock &) = delete;
+
+  [[nodiscard]] TimePoint now() const override {
+    return TimePoint{std::chrono::nanoseconds{nanos_.load(std::memory_order_acquire)}};
+  }
+
+  [[nodiscard]] std::int64_t currentTimeMillis() const override {
+    return timeMillis_.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] bool isSimulated() const override { return true; }
+
+  std::uint64_t addAdvanceHandler(std::function<void()> handler) override {
+    std::lock_guard lock{mutex_};
+
+    handlers_.emplace_back(++lastHandlerId_, std::move(handler));
+
+    return lastHandlerId_;
+  }
+
+  void removeAdvanceHandler(std::uint64_t id) override {
+    std::lock_guard lock{mutex_};
+
+    std::erase_if(handlers_, [id](const auto &handler) { return handler.first == id; });
+  }
+
+  // Moves the time to the wall clock time (e.g. the time of the replayed event). Returns false if the time is earlier
+  // than the current one (the time isn't changed).
+  bool advanceTo(std::int64_t timeMillis) {
+    auto current = timeMillis_.load(std::memory_order_relaxed);
+
+    if (timeMillis <= current) {
+      return timeMillis == current;
+    }
+
+    // The single advancing thread is expected (the replay), the concurrent advances keep the latest time
+    while (current < timeMillis &&
+           !timeMillis_.compare_exchange_weak(current, timeMillis, std::memory_order_acq_rel)) {
+    }
+
+    if (current < timeMillis) {
+      nanos_.fetch_add((timeMillis - current) * 1000000, std::memory_order_acq_rel);
+      notifyHandlers();
+    }
+
+    return true;
+  }
+
+  void advanceBy(std::chrono::milliseconds duration) {
+    if (duration.count() > 0) {
+      advanceTo(currentTimeMillis() + duration.count());
+    }
+  }
+};
+
+// The advance handler of the wait on the simulated clock (see Clock::waitUntil): locks the mutex and notifies the
+// condition variable, so the advance between the check of the time and the wait isn't missed. It's added before the
+// mutex is locked by the waiter and removed after it is unlocked.
+class AdvanceHandler final {
+  Clock *clock_;
+  std::uint64_t id_;
+
+ public:
+  AdvanceHandler(Clock &clock, std::mutex &mutex, std::condition_variable &cv)
+      : clock_{&clock}, id_{clock.addAdvanceHandler([&mutex, &cv] {
+          {
+            std::lock_guard lock{mutex};
+          }
+
+          cv.notify_all();
+        })} {}
+
+  AdvanceHandler(const AdvanceHandler &) = delete;
+  AdvanceHandler &operator=(const AdvanceHandler &) = delete;
+
+  ~AdvanceHandler() { clock_->removeAdvanceHandler(id_); }
+};
+
+}  // namespace dxf
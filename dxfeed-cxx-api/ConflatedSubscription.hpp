@@ -0,0 +1,215 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ConnectionPool.hpp"
+#include "EventCodec.hpp"
+#include "EventReceiver.hpp"
+#include "Executor.hpp"
+#include "MarketEvents.hpp"
+
+namespace dxf {
+
+// The latest-value subscription of the plain events that are not the time series (e.g. Quote, Summary, Profile): the
+// listener keeps only the latest event of every requested symbol and marks the symbol dirty, the consumer takes the
+// latest events of the dirty symbols by the poll or gets them from the executor at the fixed rate. So the work of the
+// consumer is bounded by the number of the symbols and the rate, however often the market ticks. Only the last event of
+// the symbol of every listener call is decoded.
+//
+// Usage:
+//   auto quotes = ConflatedSubscription<Quote>::create(executor, address, symbols);
+//
+//   quotes->poll([](std::size_t symbolIndex, const Quote& quote) { ... });
+//   ...
+//   quotes->close();
+//
+// The subscription is closed by the close() or the disconnect. The events of the symbols that are not requested are
+// ignored.
+template <typename Event>
+class ConflatedSubscription final : public std::enable_shared_from_this<ConflatedSubscription<Event>> {
+  static_assert(!Event::IS_TIME_SERIES, "The events of the time series can't be conflated");
+
+  using CEventType = typename Event::CEventType;
+
+ public:
+  // The handler of the delivery: the index of the requested symbol and its latest event
+  using HandlerType = std::function<void(std::size_t, const Event &)>;
+
+  struct Stats {
+    // The events received by the listener
+    std::uint64_t receivedNumber = 0;
+    // The latest events taken by the consumer
+    std::uint64_t deliveredNumber = 0;
+  };
+
+ private:
+  struct Slot {
+    std::optional<Event> event{};
+    bool isDirty = false;
+  };
+
+  Executor *executor_;
+  // Guards the slots and the dirty symbols
+  std::mutex mutex_{};
+  std::vector<Slot> slots_;
+  // The indexes of the dirty symbols in the order they became dirty
+  std::vector<std::size_t> dirtySymbols_{};
+  // The dirty symbols taken by the consumer (the capacity is kept)
+  std::vector<std::size_t> takenSymbols_{};
+  std::vector<std::pair<std::size_t, Event>> takenEvents_{};
+  std::atomic<std::uint64_t> receivedNumber_{0};
+  std::atomic<std::uint64_t> deliveredNumber_{0};
+  std::function<void()> stop_{};
+  std::atomic<bool> isFinished_{false};
+  bool isReceived_ = true;
+
+  ConflatedSubscription(Executor &executor, std::size_t symbolsNumber)
+      : executor_{&executor}, slots_(symbolsNumber) {}
+
+  // The listener (the connection thread)
+  void store(std::size_t symbolIndex, const Symbol &symbol, const CEventType *cEvents, std::size_t count) {
+    if (symbolIndex == EventReceiver::UNKNOWN_SYMBOL || count == 0) {
+      return;
+    }
+
+    auto event = EventCodec<Event>::decode(symbol, cEvents[count - 1]);
+
+    receivedNumber_.fetch_add(count, std::memory_order_relaxed);
+
+    std::lock_guard guard(mutex_);
+    auto &slot = slots_[symbolIndex];
+
+    slot.event = std::move(event);
+
+    if (!slot.isDirty) {
+      slot.isDirty = true;
+      dirtySymbols_.push_back(symbolIndex);
+    }
+  }
+
+  // Delivers the dirty symbols and schedules the next delivery until the subscription is finished
+  static void scheduleDelivery(const std::weak_ptr<ConflatedSubscription> &weakSelf, std::chrono::milliseconds interval,
+                               HandlerType handler) {
+    auto self = weakSelf.lock();
+
+    if (!self || self->isFinished_.load()) {
+      return;
+    }
+
+    self->executor_->schedule(interval, [weakSelf, interval, handler = std::move(handler)]() mutable {
+      if (auto self = weakSelf.lock()) {
+        self->poll(handler);
+        scheduleDelivery(weakSelf, interval, std::move(handler));
+      }
+    });
+  }
+
+ public:
+  // Subscribes to the events of the symbols on the connection (from the pool if it's set). If the interval is not 0,
+  // the latest events of the dirty symbols are passed to the handler on the executor every interval (the deliveries
+  // are the consumer then, so the poll is not called). The executor and the pool must outlive the subscription.
+  static std::shared_ptr<ConflatedSubscription> create(Executor &executor, const std::string &address,
+                                                       const std::vector<std::string> &symbols,
+                                                       ConnectionPool *pool = nullptr,
+                                                       std::chrono::milliseconds interval = {},
+                                                       HandlerType handler = {}) {
+    auto subscription =
+      std::shared_ptr<ConflatedSubscription>(new ConflatedSubscription(executor, symbols.size()));
+
+    subscription->stop_ = EventReceiver::receiveBatchesAsync<CEventType>(
+      executor, Event::EVENT_TYPE, false, address, symbols,
+      [subscription](std::size_t symbolIndex, const Symbol &symbol, const CEventType *cEvents, std::size_t count) {
+        subscription->store(symbolIndex, symbol, cEvents, count);
+      },
+      0, pool, std::nullopt, [weakSelf = subscription->weak_from_this()](bool isReceived) {
+        if (auto self = weakSelf.lock()) {
+          {
+            std::lock_guard guard(self->mutex_);
+
+            self->isReceived_ = isReceived;
+          }
+
+          self->isFinished_.store(true);
+        }
+      });
+
+    if (interval.count() > 0 && handler) {
+      scheduleDelivery(subscription->weak_from_this(), interval, std::move(handler));
+    }
+
+    return subscription;
+  }
+
+  ConflatedSubscription(const ConflatedSubscription &) = delete;
+  ConflatedSubscription &operator=(const ConflatedSubscription &) = delete;
+
+  // Passes the latest events of the symbols that are updated since the previous poll to the handler (in the order the
+  // symbols became dirty) and clears the dirty symbols. The handler is called without the lock of the listener. Is
+  // called by one consumer at a time. Returns the number of the delivered events.
+  std::size_t poll(const HandlerType &handler) {
+    takenEvents_.clear();
+
+    {
+      std::lock_guard guard(mutex_);
+
+      takenSymbols_.swap(dirtySymbols_);
+
+      for (auto symbolIndex : takenSymbols_) {
+        slots_[symbolIndex].isDirty = false;
+        takenEvents_.emplace_back(symbolIndex, *slots_[symbolIndex].event);
+      }
+
+      takenSymbols_.clear();
+    }
+
+    for (const auto &[symbolIndex, event] : takenEvents_) {
+      handler(symbolIndex, event);
+    }
+
+    deliveredNumber_.fetch_add(takenEvents_.size(), std::memory_order_relaxed);
+
+    return takenEvents_.size();
+  }
+
+  // The latest event of the requested symbol (std::nullopt - there were no events). Doesn't change the dirty symbols.
+  [[nodiscard]] std::optional<Event> getLatest(std::size_t symbolIndex) {
+    std::lock_guard guard(mutex_);
+
+    return symbolIndex < slots_.size() ? slots_[symbolIndex].event : std::nullopt;
+  }
+
+  [[nodiscard]] Stats getStats() const {
+    return {receivedNumber_.load(std::memory_order_relaxed), deliveredNumber_.load(std::memory_order_relaxed)};
+  }
+
+  // The subscription is closed (by the close or the disconnect) or can't be created
+  [[nodiscard]] bool isFinished() const { return isFinished_.load(); }
+
+  // Returns false if the subscription is finished because the connection or the subscription can't be created
+  [[nodiscard]] bool isReceived() {
+    std::lock_guard guard(mutex_);
+
+    return isReceived_;
+  }
+
+  // Closes the subscription (asynchronously, on the executor). The latest events stay available.
+  void close() {
+    if (stop_) {
+      stop_();
+    }
+  }
+};
+
+}  // namespace dxf
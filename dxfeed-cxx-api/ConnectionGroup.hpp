@@ -0,0 +1,464 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ConnectionPool.hpp"
+#include "EventFilter.hpp"
+#include "EventReceiver.hpp"
+#include "Executor.hpp"
+#include "Metrics.hpp"
+
+namespace dxf {
+
+// The subscription of one event type that is sharded across several connections (the shards), so the symbols are read
+// and parsed by the connection threads of all shards in parallel instead of one TCP stream and one thread. The shards
+// are the endpoints (the repeated endpoint is the several connections to it, the different lanes of the pool). The
+// symbols are distributed by the consistent hashing: every shard has VIRTUAL_NODES_NUMBER points on the ring of the
+// hashes, the symbol belongs to the first live shard at or after its hash. When the shard loses its connection, only
+// its symbols are moved (to the next live shards of their ring positions) and are subscribed there; when the shard is
+// reconnected (every reconnectDelay), its symbols are moved back. The symbols of the group are unassigned only while
+// all shards are lost.
+//
+// The sink gets the events of all shards as of one subscription: the symbolIndex is the position in the symbols of the
+// group. It's called on the connection threads of the shards concurrently (the events of one symbol come from one
+// shard at a time, except for the short overlap of the move), so it must be thread-safe. The moved symbol of the time
+// series is subscribed again from the fromTime, so its snapshot is delivered again.
+//
+// Usage:
+//   auto group = ConnectionGroup<dxf_quote_t>::create(executor, pool, DXF_ET_QUOTE, false,
+//                                                     {"host1:7300", "host1:7300", "host2:7300"}, symbols, sink,
+//                                                     std::chrono::seconds(5));
+//   ...
+//   group->close();
+template <typename CEvent>
+class ConnectionGroup final : public std::enable_shared_from_this<ConnectionGroup<CEvent>> {
+ public:
+  using SinkType = EventReceiver::BatchSinkType<CEvent>;
+
+  // The points of every shard on the ring: the more points, the more even the distribution of the symbols and of the
+  // symbols of the lost shard among the live ones
+  static constexpr std::size_t VIRTUAL_NODES_NUMBER = 64;
+
+  // The shard of the unassigned symbol (all shards are lost)
+  static constexpr std::size_t NO_SHARD = static_cast<std::size_t>(-1);
+
+  struct ShardStats {
+    std::string address{};
+    std::size_t lane = 0;
+    bool isLive = false;
+    // The symbols that are subscribed on the shard now (its own and the moved ones)
+    std::size_t symbolsNumber = 0;
+  };
+
+  struct Stats {
+    std::vector<ShardStats> shards{};
+    // The losses of the connections of the shards (including the failed connects) and the reconnects
+    std::uint64_t lostNumber = 0;
+    std::uint64_t reconnectsNumber = 0;
+    // The moves of the symbols between the shards
+    std::uint64_t movedSymbolsNumber = 0;
+    std::size_t unassignedSymbolsNumber = 0;
+  };
+
+ private:
+  struct Shard {
+    std::string address{};
+    std::size_t lane = 0;
+    ConnectionPool::Lease lease{};
+    std::uint64_t disconnectHandlerId = 0;
+    // The connects of the shard, so the disconnect and the failures of the previous connection are ignored
+    std::uint64_t generation = 0;
+    bool isLive = false;
+  };
+
+  // The subscription of the symbols of one home shard on one shard
+  struct Receive {
+    std::size_t shard = 0;
+    std::size_t home = 0;
+    std::function<void()> stop{};
+  };
+
+  Executor *executor_;
+  ConnectionPool *pool_;
+  int eventType_;
+  bool isTimeSeries_;
+  dxf_long_t fromTime_;
+  std::vector<std::string> symbols_;
+  std::shared_ptr<const SinkType> sink_;
+  std::chrono::milliseconds reconnectDelay_;
+  EventFilter<CEvent> filter_;
+  // The sorted points of the shards on the ring
+  std::vector<std::pair<std::uint64_t, std::size_t>> ring_{};
+  // The ring positions of the symbols, their home (the first shard of the position) and current shards
+  std::vector<std::uint64_t> positions_{};
+  std::vector<std::size_t> homes_{};
+  std::vector<std::size_t> owners_{};
+  // Guards the shards, the receives, the owners and the stats (is locked by the tasks of the executor)
+  std::mutex mutex_{};
+  std::vector<Shard> shards_{};
+  std::vector<Receive> receives_{};
+  bool isClosed_ = false;
+  std::uint64_t lostNumber_ = 0;
+  std::uint64_t reconnectsNumber_ = 0;
+  std::uint64_t movedSymbolsNumber_ = 0;
+
+  ConnectionGroup(Executor &executor, ConnectionPool &pool, int eventType, bool isTimeSeries,
+                  const std::vector<std::string> &endpoints, std::vector<std::string> symbols, SinkType sink,
+                  std::chrono::milliseconds reconnectDelay, EventFilter<CEvent> filter, dxf_long_t fromTime)
+      : executor_{&executor},
+        pool_{&pool},
+        eventType_{eventType},
+        isTimeSeries_{isTimeSeries},
+        fromTime_{fromTime},
+        symbols_{std::move(symbols)},
+        sink_{std::make_shared<const SinkType>(std::move(sink))},
+        reconnectDelay_{reconnectDelay},
+        filter_{std::move(filter)} {
+    std::map<std::string_view, std::size_t> lanes{};
+
+    for (const auto &endpoint : endpoints) {
+      shards_.push_back(Shard{endpoint, lanes[endpoint]++});
+    }
+
+    for (std::size_t i = 0; i < shards_.size(); i++) {
+      auto seed = mix(std::hash<std::string>{}(shards_[i].address) + shards_[i].lane);
+
+      for (std::size_t v = 0; v < VIRTUAL_NODES_NUMBER; v++) {
+        ring_.emplace_back(mix(seed + v), i);
+      }
+    }
+
+    std::sort(ring_.begin(), ring_.end());
+
+    for (const auto &symbol : symbols_) {
+      positions_.push_back(mix(std::hash<std::string>{}(symbol)));
+      homes_.push_back(findOwner(positions_.back(), false));
+    }
+
+    owners_.assign(symbols_.size(), NO_SHARD);
+  }
+
+  // The finalizer of the splitmix64, so the close hashes are spread over the ring
+  static std::uint64_t mix(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30U)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27U)) * 0x94D049BB133111EBULL;
+
+    return x ^ (x >> 31U);
+  }
+
+  // The first (live) shard at or after the position of the ring
+  [[nodiscard]] std::size_t findOwner(std::uint64_t position, bool isLiveOnly) const {
+    auto start = static_cast<std::size_t>(
+      std::lower_bound(ring_.begin(), ring_.end(), std::make_pair(position, std::size_t{0})) - ring_.begin());
+
+    for (std::size_t i = 0; i < ring_.size(); i++) {
+      auto shard = ring_[(start + i) % ring_.size()].second;
+
+      if (!isLiveOnly || shards_[shard].isLive) {
+        return shard;
+      }
+    }
+
+    return NO_SHARD;
+  }
+
+  // Connects the shard (under the lock). Returns false if the connection can't be created.
+  bool connect(std::size_t shardIndex) {
+    auto &shard = shards_[shardIndex];
+
+    shard.lease = pool_->acquire(shard.address, shard.lane);
+
+    if (!shard.lease.isValid()) {
+      return false;
+    }
+
+    shard.generation++;
+    shard.isLive = true;
+    // The handler is called on the connection thread (or at once under the lock), so the loss is handled by the task
+    shard.disconnectHandlerId = shard.lease.addDisconnectHandler(
+      [executor = executor_, weakSelf = this->weak_from_this(), shardIndex, generation = shard.generation] {
+        executor->post([weakSelf, shardIndex, generation] {
+          if (auto self = weakSelf.lock()) {
+            self->lose(shardIndex, generation);
+          }
+        });
+      });
+
+    return true;
+  }
+
+  // Releases the connection of the shard (under the lock)
+  void disconnect(Shard &shard) {
+    shard.lease.removeDisconnectHandler(shard.disconnectHandlerId);
+    shard.lease.reset();
+    shard.disconnectHandlerId = 0;
+    shard.isLive = false;
+  }
+
+  // Stops the receives that match the predicate (under the lock)
+  template <typename Predicate>
+  void stopReceives(Predicate predicate) {
+    auto it = std::stable_partition(receives_.begin(), receives_.end(),
+                                    [&predicate](const Receive &receive) { return !predicate(receive); });
+
+    for (auto i = it; i != receives_.end(); ++i) {
+      i->stop();
+    }
+
+    receives_.erase(it, receives_.end());
+  }
+
+  // Subscribes the symbols on the shard (under the lock)
+  void startReceive(std::size_t shardIndex, std::size_t home, std::vector<std::size_t> symbolIndexes) {
+    std::vector<std::string> symbols{};
+
+    symbols.reserve(symbolIndexes.size());
+
+    for (auto symbolIndex : symbolIndexes) {
+      symbols.push_back(symbols_[symbolIndex]);
+    }
+
+    auto indexes = std::make_shared<const std::vector<std::size_t>>(std::move(symbolIndexes));
+    const auto &shard = shards_[shardIndex];
+
+    receives_.push_back(Receive{
+      shardIndex, home,
+      EventReceiver::receiveBatchesAsync<CEvent>(
+        *executor_, eventType_, isTimeSeries_, shard.address, symbols,
+        [sink = sink_, indexes](std::size_t symbolIndex, const Symbol &symbol, const CEvent *cEvents,
+                                std::size_t count) {
+          (*sink)(symbolIndex == EventReceiver::UNKNOWN_SYMBOL ? symbolIndex : (*indexes)[symbolIndex], symbol,
+                  cEvents, count);
+        },
+        0, pool_, std::nullopt,
+        [weakSelf = this->weak_from_this(), shardIndex, generation = shard.generation](bool isReceived) {
+          // The subscription can't be created on the live connection
+          if (auto self = weakSelf.lock(); self && !isReceived) {
+            self->lose(shardIndex, generation);
+          }
+        },
+        filter_, shard.lane, fromTime_)});
+  }
+
+  // Assigns the symbols without the live shards to the live shards and subscribes them by the receive per the shard and
+  // the home shard, so the receives of the home shard can be stopped when it's reconnected (under the lock). isMove -
+  // the symbols are moved from the other shard.
+  void assign(bool isMove) {
+    std::map<std::pair<std::size_t, std::size_t>, std::vector<std::size_t>> moves{};
+
+    for (std::size_t i = 0; i < symbols_.size(); i++) {
+      if (owners_[i] != NO_SHARD && shards_[owners_[i]].isLive) {
+        continue;
+      }
+
+      auto owner = findOwner(positions_[i], true);
+
+      if (owner == NO_SHARD) {
+        owners_[i] = NO_SHARD;
+
+        continue;
+      }
+
+      if (isMove) {
+        movedSymbolsNumber_++;
+      }
+
+      owners_[i] = owner;
+      moves[{owner, homes_[i]}].push_back(i);
+    }
+
+    for (auto &[key, symbolIndexes] : moves) {
+      startReceive(key.first, key.second, std::move(symbolIndexes));
+    }
+  }
+
+  void scheduleReconnect(std::size_t shardIndex) {
+    if (reconnectDelay_.count() <= 0) {
+      return;
+    }
+
+    executor_->schedule(reconnectDelay_, [weakSelf = this->weak_from_this(), shardIndex] {
+      if (auto self = weakSelf.lock()) {
+        self->reconnect(shardIndex);
+      }
+    });
+  }
+
+  void start() {
+    std::lock_guard guard(mutex_);
+
+    if (isClosed_) {
+      return;
+    }
+
+    for (std::size_t i = 0; i < shards_.size(); i++) {
+      if (!connect(i)) {
+        lostNumber_++;
+        scheduleReconnect(i);
+      }
+    }
+
+    assign(false);
+  }
+
+  // Moves the symbols of the lost shard to the live ones
+  void lose(std::size_t shardIndex, std::uint64_t generation) {
+    std::lock_guard guard(mutex_);
+    auto &shard = shards_[shardIndex];
+
+    if (isClosed_ || !shard.isLive || shard.generation != generation) {
+      return;
+    }
+
+    disconnect(shard);
+    lostNumber_++;
+    stopReceives([shardIndex](const Receive &receive) { return receive.shard == shardIndex; });
+    assign(true);
+    scheduleReconnect(shardIndex);
+  }
+
+  // Moves the symbols of the reconnected shard back to it (and assigns the unassigned ones)
+  void reconnect(std::size_t shardIndex) {
+    std::lock_guard guard(mutex_);
+
+    if (isClosed_ || shards_[shardIndex].isLive) {
+      return;
+    }
+
+    if (!connect(shardIndex)) {
+      scheduleReconnect(shardIndex);
+
+      return;
+    }
+
+    reconnectsNumber_++;
+    stopReceives([shardIndex](const Receive &receive) { return receive.home == shardIndex; });
+
+    for (std::size_t i = 0; i < symbols_.size(); i++) {
+      if (homes_[i] == shardIndex) {
+        owners_[i] = NO_SHARD;
+      }
+    }
+
+    assign(true);
+  }
+
+ public:
+  // Subscribes to the events of the eventType (the C API DXF_ET_* constant, CEvent - its C struct) of the symbols on
+  // the connections of the endpoints (one shard per endpoint) from the pool. isTimeSeries - the time subscription from
+  // the fromTime (ms, 0 - the beginning of the history) is created. reconnectDelay - the delay of the reconnects of
+  // the lost shards (0 - the lost shards are not reconnected). filter - the events that are passed to the sink (see
+  // EventFilter). The connections are created on the executor. The executor and the pool (of at least the number of
+  // the endpoints of connections) must outlive the group.
+  static std::shared_ptr<ConnectionGroup> create(Executor &executor, ConnectionPool &pool, int eventType,
+                                                 bool isTimeSeries, const std::vector<std::string> &endpoints,
+                                                 std::vector<std::string> symbols, SinkType sink,
+                                                 std::chrono::milliseconds reconnectDelay = {},
+                                                 EventFilter<CEvent> filter = {}, dxf_long_t fromTime = 0) {
+    auto group = std::shared_ptr<ConnectionGroup>(new ConnectionGroup(executor, pool, eventType, isTimeSeries,
+                                                                      endpoints, std::move(symbols), std::move(sink),
+                                                                      reconnectDelay, std::move(filter), fromTime));
+
+    executor.post([weakSelf = group->weak_from_this()] {
+      if (auto self = weakSelf.lock()) {
+        self->start();
+      }
+    });
+
+    return group;
+  }
+
+  ConnectionGroup(const ConnectionGroup &) = delete;
+  ConnectionGroup &operator=(const ConnectionGroup &) = delete;
+
+  ~ConnectionGroup() { close(); }
+
+  // Closes the subscriptions (asynchronously, on the executor) and releases the connections of the shards
+  void close() {
+    std::lock_guard guard(mutex_);
+
+    if (isClosed_) {
+      return;
+    }
+
+    isClosed_ = true;
+    stopReceives([](const Receive &) { return true; });
+
+    for (auto &shard : shards_) {
+      disconnect(shard);
+    }
+  }
+
+  // The home shard of the symbol (the one it's subscribed on while the shard is live)
+  [[nodiscard]] std::size_t getHomeShard(std::size_t symbolIndex) const { return homes_[symbolIndex]; }
+
+  // The shard the symbol is subscribed on now (NO_SHARD - all shards are lost or the group isn't started yet)
+  [[nodiscard]] std::size_t getShard(std::size_t symbolIndex) {
+    std::lock_guard guard(mutex_);
+
+    return owners_[symbolIndex];
+  }
+
+  [[nodiscard]] Stats getStats() {
+    std::lock_guard guard(mutex_);
+    Stats result{};
+
+    for (const auto &shard : shards_) {
+      result.shards.push_back(ShardStats{shard.address, shard.lane, shard.isLive, 0});
+    }
+
+    for (auto owner : owners_) {
+      if (owner == NO_SHARD) {
+        result.unassignedSymbolsNumber++;
+      } else {
+        result.shards[owner].symbolsNumber++;
+      }
+    }
+
+    result.lostNumber = lostNumber_;
+    result.reconnectsNumber = reconnectsNumber_;
+    result.movedSymbolsNumber = movedSymbolsNumber_;
+
+    return result;
+  }
+
+  void collectMetrics(MetricsWriter &writer, const MetricLabels &labels = {}) {
+    auto stats = getStats();
+
+    for (const auto &shard : stats.shards) {
+      auto shardLabels = labels;
+
+      shardLabels.emplace_back("address", shard.address);
+      shardLabels.emplace_back("lane", std::to_string(shard.lane));
+      writer.gauge("dxf_connection_group_shard_live", "1 if the connection of the shard is live", shardLabels,
+                   shard.isLive ? 1.0 : 0.0);
+      writer.gauge("dxf_connection_group_shard_symbols", "The symbols subscribed on the shard", shardLabels,
+                   static_cast<double>(shard.symbolsNumber));
+    }
+
+    writer.counter("dxf_connection_group_lost_total", "The losses of the connections of the shards", labels,
+                   static_cast<double>(stats.lostNumber));
+    writer.counter("dxf_connection_group_reconnects_total", "The reconnects of the lost shards", labels,
+                   static_cast<double>(stats.reconnectsNumber));
+    writer.counter("dxf_connection_group_moved_symbols_total", "The moves of the symbols between the shards", labels,
+                   static_cast<double>(stats.movedSymbolsNumber));
+    writer.gauge("dxf_connection_group_unassigned_symbols", "The symbols without the live shards", labels,
+                 static_cast<double>(stats.unassignedSymbolsNumber));
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Metrics.hpp"
+
+namespace dxf {
+
+// What the consumers of the connection do while its memory is over the quota (see ConnectionMemoryAccount)
+enum class MemoryQuotaAction {
+  // The async books of the connection merge their queued data into one overflow chunk instead of queueing the chunks
+  // or blocking the connection thread (as BackpressurePolicy::CONFLATE)
+  CONFLATE = 0,
+  // The EventDispatcher drops the new batches of the connection (the events are lost and counted)
+  DROP = 1,
+  // The PriceLevelBookManager refuses the books of the new symbols (the create returns nullptr), the existing ones are
+  // kept
+  REFUSE_SYMBOLS = 2
+};
+
+struct ConnectionMemoryQuota {
+  // The memory of the connection (the charged bytes and the sources). 0 - no quota.
+  std::size_t bytes = 0;
+  MemoryQuotaAction action = MemoryQuotaAction::REFUSE_SYMBOLS;
+};
+
+// The memory of one connection (see ConnectionMemoryAccount::getStats)
+struct ConnectionMemoryStats {
+  std::string name{};
+  // The charged bytes plus the bytes of the sources at the last refresh
+  std::size_t bytes = 0;
+  // The bytes of the queued data (charged and released by the consumers)
+  std::size_t chargedBytes = 0;
+  // The bytes of the sources (e.g. the books) at the last refresh
+  std::size_t sourceBytes = 0;
+  // The maximum of the bytes
+  std::size_t peakBytes = 0;
+  ConnectionMemoryQuota quota{};
+  bool isOverQuota = false;
+  // The degradations: the refused new symbols, the dropped events and the conflated chunks
+  std::uint64_t refusedSymbolsNumber = 0;
+  std::uint64_t droppedEventsNumber = 0;
+  std::uint64_t conflatedChunksNumber = 0;
+  // The record buffers of the consumers (e.g. the batches of the EventDispatcher): reused from their pools and
+  // allocated. Their idle bytes are the sources.
+  std::uint64_t reusedBuffersNumber = 0;
+  std::uint64_t allocatedBuffersNumber = 0;
+};
+
+// The memory accounting of one connection: the consumers of its data charge the bytes they queue and release them when
+// the data is handled (e.g. the batches of the EventDispatcher), and register the sources of the bytes they keep (e.g.
+// the books of the PriceLevelBookManager), which are polled by the refresh. So the connection whose subscription set
+// has exploded, or whose consumer lags, is found by its bytes instead of the memory of the whole process.
+//
+// The optional quota defines the degradation instead of the unbounded growth: while the bytes are over the quota, the
+// consumers of the connection act by its action (see MemoryQuotaAction). The charges check the quota in O(1) by the
+// bytes of the sources at the last refresh, so the sources are refreshed periodically (e.g. every second by the
+// ConnectionMemoryRegistry::refresh or by the metrics collector).
+//
+// Usage:
+//   ConnectionMemoryAccount account{connection, "demo", {512 << 20, MemoryQuotaAction::REFUSE_SYMBOLS}};
+//
+//   manager.setMemoryAccount(&account);     // The books are the source, the new symbols are refused
+//   dispatcher.setMemoryAccount(&account);  // The queued batches are charged
+//   account.refresh();                      // Periodically
+//
+// The account must outlive its consumers (or they are detached first). All methods can be called from any thread.
+class ConnectionMemoryAccount final {
+  struct Source {
+    std::uint64_t id;
+    std::function<std::size_t()> getBytes;
+  };
+
+  dxf_connection_t connection_;
+  std::string name_;
+  std::atomic<std::size_t> quotaBytes_;
+  std::atomic<MemoryQuotaAction> action_;
+  std::atomic<std::int64_t> chargedBytes_{0};
+  std::atomic<std::size_t> sourceBytes_{0};
+  std::atomic<std::size_t> peakBytes_{0};
+  std::atomic<bool> isOverQuota_{false};
+  std::atomic<std::uint64_t> refusedSymbolsNumber_{0};
+  std::atomic<std::uint64_t> droppedEventsNumber_{0};
+  std::atomic<std::uint64_t> conflatedChunksNumber_{0};
+  std::atomic<std::uint64_t> reusedBuffersNumber_{0};
+  std::atomic<std::uint64_t> allocatedBuffersNumber_{0};
+  // Guards the sources. Held during the refresh, so the removed source isn't called after the removal.
+  std::mutex mutex_{};
+  std::vector<Source> sources_{};
+  std::uint64_t lastSourceId_ = 0;
+
+  [[nodiscard]] std::size_t getChargedBytes() const {
+    return static_cast<std::size_t>((std::max)(chargedBytes_.load(std::memory_order_relaxed), std::int64_t{0}));
+  }
+
+  // Updates the peak and the over-quota flag by the total bytes. The flag is written only when it changes, so the
+  // charges of the many threads don't contend for its cache line.
+  void update(std::size_t bytes) {
+    auto peak = peakBytes_.load(std::memory_order_relaxed);
+
+    while (bytes > peak && !peakBytes_.compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {
+    }
+
+    auto quota = quotaBytes_.load(std::memory_order_relaxed);
+    auto isOverQuota = quota != 0 && bytes > quota;
+
+    if (isOverQuota_.load(std::memory_order_relaxed) != isOverQuota) {
+      isOverQuota_.store(isOverQuota, std::memory_order_relaxed);
+    }
+  }
+
+ public:
+  explicit ConnectionMemoryAccount(dxf_connection_t connection, std::string name = {},
+                                   const ConnectionMemoryQuota& quota = {})
+      : connection_{connection}, name_{std::move(name)}, quotaBytes_{quota.bytes}, action_{quota.action} {}
+
+  ConnectionMemoryAccount(const ConnectionMemoryAccount&) = delete;
+  ConnectionMemoryAccount& operator=(const ConnectionMemoryAccount&) = delete;
+
+  [[nodiscard]] dxf_connection_t getConnection() const { return connection_; }
+
+  [[nodiscard]] const std::string& getName() const { return name_; }
+
+  // Changes the quota, it's applied by the next charge or refresh
+  void setQuota(const ConnectionMemoryQuota& quota) {
+    quotaBytes_.store(quota.bytes, std::memory_order_relaxed);
+    action_.store(quota.action, std::memory_order_relaxed);
+    update(getChargedBytes() + sourceBytes_.load(std::memory_order_relaxed));
+  }
+
+  // Adds the bytes of the data queued by the consumer (released by the release when the data is handled)
+  void charge(std::size_t bytes) {
+    auto charged = chargedBytes_.fetch_add(static_cast<std::int64_t>(bytes), std::memory_order_relaxed) +
+                   static_cast<std::int64_t>(bytes);
+
+    update(static_cast<std::size_t>((std::max)(charged, std::int64_t{0})) +
+           sourceBytes_.load(std::memory_order_relaxed));
+  }
+
+  void release(std::size_t bytes) {
+    auto charged = chargedBytes_.fetch_sub(static_cast<std::int64_t>(bytes), std::memory_order_relaxed) -
+                   static_cast<std::int64_t>(bytes);
+
+    update(static_cast<std::size_t>((std::max)(charged, std::int64_t{0})) +
+           sourceBytes_.load(std::memory_order_relaxed));
+  }
+
+  // Adds the source of the bytes the consumer keeps (e.g. the books), it's called by the refresh on its thread. Returns
+  // the id of the source for the removeSource.
+  std::uint64_t addSource(std::function<std::size_t()> getBytes) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    sources_.push_back({++lastSourceId_, std::move(getBytes)});
+
+    return lastSourceId_;
+  }
+
+  // Removes the source, it isn't called after the return. Must not be called by the source.
+  void removeSource(std::uint64_t id) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    std::erase_if(sources_, [id](const Source& source) { return source.id == id; });
+  }
+
+  // Polls the sources and applies the quota to the total. Returns the total bytes.
+  std::size_t refresh() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::size_t sourceBytes = 0;
+
+    for (const auto& source : sources_) {
+      sourceBytes += source.getBytes();
+    }
+
+    sourceBytes_.store(sourceBytes, std::memory_order_relaxed);
+
+    auto bytes = getChargedBytes() + sourceBytes;
+
+    update(bytes);
+
+    return bytes;
+  }
+
+  // The bytes are over the quota (at the last charge or refresh)
+  [[nodiscard]] bool isOverQuota() const { return isOverQuota_.load(std::memory_order_relaxed); }
+
+  // The bytes are over the quota and the consumers degrade by the action
+  [[nodiscard]] bool isDegraded(MemoryQuotaAction action) const {
+    return isOverQuota_.load(std::memory_order_relaxed) && action_.load(std::memory_order_relaxed) == action;
+  }
+
+  void recordRefusedSymbol() { refusedSymbolsNumber_.fetch_add(1, std::memory_order_relaxed); }
+
+  void recordDroppedEvents(std::size_t eventsNumber) {
+    droppedEventsNumber_.fetch_add(eventsNumber, std::memory_order_relaxed);
+  }
+
+  void recordConflatedChunk() { conflatedChunksNumber_.fetch_add(1, std::memory_order_relaxed); }
+
+  // The consumer has acquired the record buffer (see RecordBufferPool): isReused - taken from its pool
+  void recordBuffer(bool isReused) {
+    (isReused ? reusedBuffersNumber_ : allocatedBuffersNumber_).fetch_add(1, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] ConnectionMemoryStats getStats() const {
+    auto chargedBytes = getChargedBytes();
+    auto sourceBytes = sourceBytes_.load(std::memory_order_relaxed);
+
+    return {name_,
+            chargedBytes + sourceBytes,
+            chargedBytes,
+            sourceBytes,
+            peakBytes_.load(std::memory_order_relaxed),
+            {quotaBytes_.load(std::memory_order_relaxed), action_.load(std::memory_order_relaxed)},
+            isOverQuota_.load(std::memory_order_relaxed),
+            refusedSymbolsNumber_.load(std::memory_order_relaxed),
+            droppedEventsNumber_.load(std::memory_order_relaxed),
+            conflatedChunksNumber_.load(std::memory_order_relaxed),
+            reusedBuffersNumber_.load(std::memory_order_relaxed),
+            allocatedBuffersNumber_.load(std::memory_order_relaxed)};
+  }
+
+  // Writes the stats as the dxf_connection_memory_* metrics (the sources aren't refreshed)
+  void collectMetrics(MetricsWriter& writer, const MetricLabels& labels = {}) const {
+    auto stats = getStats();
+
+    writer.gauge("dxf_connection_memory_bytes", "The memory of the connection", labels,
+                 static_cast<double>(stats.bytes));
+    writer.gauge("dxf_connection_memory_queued_bytes", "The memory of the queued data of the connection", labels,
+                 static_cast<double>(stats.chargedBytes));
+    writer.gauge("dxf_connection_memory_peak_bytes", "The maximum memory of the connection", labels,
+                 static_cast<double>(stats.peakBytes));
+    writer.gauge("dxf_connection_memory_quota_bytes", "The memory quota of the connection (0 - no quota)", labels,
+                 static_cast<double>(stats.quota.bytes));
+    writer.gauge("dxf_connection_memory_over_quota", "The memory of the connection is over the quota", labels,
+                 stats.isOverQuota ? 1.0 : 0.0);
+    writer.counter("dxf_connection_memory_refused_symbols_total", "The new symbols refused over the quota", labels,
+                   static_cast<double>(stats.refusedSymbolsNumber));
+    writer.counter("dxf_connection_memory_dropped_events_total", "The events dropped over the quota", labels,
+                   static_cast<double>(stats.droppedEventsNumber));
+    writer.counter("dxf_connection_memory_conflated_chunks_total", "The chunks conflated over the quota", labels,
+                   static_cast<double>(stats.conflatedChunksNumber));
+    writer.counter("dxf_connection_memory_buffers_reused_total", "The record buffers reused from the pools", labels,
+                   static_cast<double>(stats.reusedBuffersNumber));
+    writer.counter("dxf_connection_memory_buffers_allocated_total", "The record buffers allocated by the pools", labels,
+                   static_cast<double>(stats.allocatedBuffersNumber));
+  }
+};
+
+// The memory accounts of the connections of the process, so the bytes are reported per connection (e.g. by the
+// metrics labeled by the names of the connections).
+//
+// Usage:
+//   ConnectionMemoryRegistry registry{};
+//   auto& account = registry.getAccount(connection, "demo", {512 << 20, MemoryQuotaAction::CONFLATE});
+//
+//   metrics.addCollector([&registry](MetricsWriter& writer) { registry.collectMetrics(writer); });
+class ConnectionMemoryRegistry final {
+  // Guards the accounts
+  mutable std::mutex mutex_{};
+  std::vector<std::unique_ptr<ConnectionMemoryAccount>> accounts_{};
+
+ public:
+  // Returns the account of the connection. The new one is created with the name (e.g. the address of the connection)
+  // and the quota. The account is valid until it is removed.
+  ConnectionMemoryAccount& getAccount(dxf_connection_t connection, const std::string& name = {},
+                                      const ConnectionMemoryQuota& quota = {}) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto found = std::find_if(accounts_.begin(), accounts_.end(),
+                              [connection](const auto& account) { return account->getConnection() == connection; });
+
+    if (found != accounts_.end()) {
+      return **found;
+    }
+
+    return *accounts_.emplace_back(std::make_unique<ConnectionMemoryAccount>(connection, name, quota));
+  }
+
+  // Removes the account of the connection (after its consumers are destroyed or detached from it)
+  void remove(dxf_connection_t connection) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    std::erase_if(accounts_, [connection](const auto& account) { return account->getConnection() == connection; });
+  }
+
+  // Refreshes all accounts (see ConnectionMemoryAccount::refresh) and returns their stats
+  std::vector<ConnectionMemoryStats> refresh() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::vector<ConnectionMemoryStats> result{};
+
+    result.reserve(accounts_.size());
+
+    for (const auto& account : accounts_) {
+      account->refresh();
+      result.push_back(account->getStats());
+    }
+
+    return result;
+  }
+
+  // Refreshes all accounts and writes their metrics labeled by the names of the connections
+  void collectMetrics(MetricsWriter& writer, const MetricLabels& labels = {}) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    for (const auto& account : accounts_) {
+      auto accountLabels = labels;
+
+      account->refresh();
+      accountLabels.emplace_back("connection", account->getName());
+      account->collectMetrics(writer, accountLabels);
+    }
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "LatencyStats.hpp"
+#include "Metrics.hpp"
+
+namespace dxf {
+
+// The copy of the health metrics of one connection (see ConnectionMetrics::getSnapshot)
+struct ConnectionMetricsSnapshot {
+  // The RTT of the last heartbeat of the server (0 - there were no heartbeats)
+  std::chrono::microseconds latestRtt{0};
+  // The exponentially weighted moving average of the RTTs (the weight of the new RTT is 1/8)
+  std::chrono::microseconds averageRtt{0};
+  // The lag mark of the last heartbeat: the time the server spent on the data that is not sent yet, i.e. the backlog of
+  // the connection on the server side
+  std::chrono::microseconds serverLag{0};
+  std::uint64_t heartbeatsNumber = 0;
+  // The time since the last heartbeat (or since the attach if there were no heartbeats)
+  std::chrono::milliseconds sinceLastHeartbeat{0};
+  // The calls of the event listeners (the records of the C API delivered at once) and the events
+  std::uint64_t messagesNumber = 0;
+  std::uint64_t eventsNumber = 0;
+  std::uint64_t eventBytesNumber = 0;
+  // The rates of the last full second (the seconds without the messages are 0)
+  double messagesPerSecond = 0.0;
+  double eventsPerSecond = 0.0;
+  double eventBytesPerSecond = 0.0;
+  // The time since the last message (or since the attach if there were no messages)
+  std::chrono::milliseconds sinceLastMessage{0};
+  // The depth of the queue of the events of the connection (see ConnectionMetrics::setQueueDepth)
+  std::size_t queueDepth = 0;
+};
+
+// The health metrics of one connection: the RTTs of the heartbeats of the server (the latest one, the average and the
+// histogram), the server lag, the numbers and the rates of the received messages and the depth of the queue of the
+// application. The lagging connection has the growing server lag or the queue depth, the stale one has no heartbeats.
+//
+// The heartbeats and the messages are recorded by the connection thread (all listeners and notifiers of the connection
+// are called by it), so the counters are written without the atomic read-modify-write operations. The snapshot may be
+// read by any thread at any time (it may miss the concurrent records).
+//
+// Usage:
+//   ConnectionMetrics metrics{};
+//
+//   metrics.attach(connection);           // the heartbeat notifier of the connection
+//   metrics.recordMessage(eventsNumber);  // in the event listener
+//   auto rtt = metrics.getSnapshot().averageRtt;
+class ConnectionMetrics final {
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::int64_t RATE_WINDOW_NANOS = 1'000'000'000;
+
+  LatencyHistogram rttHistogram_{};
+  std::atomic<std::int64_t> latestRttMicros_{0};
+  std::atomic<std::int64_t> averageRttMicros_{0};
+  std::atomic<std::int64_t> serverLagMicros_{0};
+  std::atomic<std::uint64_t> heartbeatsNumber_{0};
+  std::atomic<std::int64_t> lastHeartbeatNanos_{0};
+  std::atomic<std::uint64_t> messagesNumber_{0};
+  std::atomic<std::uint64_t> eventsNumber_{0};
+  std::atomic<std::uint64_t> eventBytesNumber_{0};
+  std::atomic<std::int64_t> lastMessageNanos_{0};
+  std::atomic<std::size_t> queueDepth_{0};
+
+  // The rates of the last full window (written by the connection thread)
+  std::atomic<double> messagesPerSecond_{0.0};
+  std::atomic<double> eventsPerSecond_{0.0};
+  std::atomic<double> eventBytesPerSecond_{0.0};
+  // Used by the connection thread only
+  bool hasRtt_ = false;
+  // The window of the rates (used by the connection thread only)
+  std::int64_t windowStartNanos_ = 0;
+  std::uint64_t windowMessagesNumber_ = 0;
+  std::uint64_t windowEventsNumber_ = 0;
+  std::uint64_t windowEventBytesNumber_ = 0;
+
+  static std::int64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+  }
+
+  static void increase(std::atomic<std::uint64_t>& value, std::uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+  }
+
+  static std::chrono::milliseconds since(std::int64_t nanos, std::int64_t now) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::nanoseconds{now - nanos});
+  }
+
+  // Publishes the rates of the window if it's finished. The window without the messages gives the zero rates.
+  void updateRates(std::int64_t now) {
+    auto elapsed = now - windowStartNanos_;
+
+    if (elapsed < RATE_WINDOW_NANOS) {
+      return;
+    }
+
+    auto seconds = static_cast<double>(elapsed) / static_cast<double>(RATE_WINDOW_NANOS);
+
+    messagesPerSecond_.store(static_cast<double>(windowMessagesNumber_) / seconds, std::memory_order_relaxed);
+    eventsPerSecond_.store(static_cast<double>(windowEventsNumber_) / seconds, std::memory_order_relaxed);
+    eventBytesPerSecond_.store(static_cast<double>(windowEventBytesNumber_) / seconds, std::memory_order_relaxed);
+    windowStartNanos_ = now;
+    windowMessagesNumber_ = 0;
+    windowEventsNumber_ = 0;
+    windowEventBytesNumber_ = 0;
+  }
+
+  static void onServerHeartbeat(dxf_connection_t, dxf_long_t, dxf_int_t serverLagMark, dxf_int_t connectionRtt,
+                                void* userData) {
+    static_cast<ConnectionMetrics*>(userData)->recordHeartbeat(std::chrono::microseconds{connectionRtt},
+                                                               std::chrono::microseconds{serverLagMark});
+  }
+
+ public:
+  ConnectionMetrics() {
+    auto now = nowNanos();
+
+    lastHeartbeatNanos_.store(now, std::memory_order_relaxed);
+    lastMessageNanos_.store(now, std::memory_order_relaxed);
+    windowStartNanos_ = now;
+  }
+
+  ConnectionMetrics(const ConnectionMetrics&) = delete;
+  ConnectionMetrics& operator=(const ConnectionMetrics&) = delete;
+
+  // Sets the heartbeat notifier of the connection (the previous notifier is replaced). The metrics must outlive the
+  // connection. Returns false if the notifier can't be set.
+  bool attach(dxf_connection_t connection) {
+    return dxf_set_on_server_heartbeat_notifier(connection, &ConnectionMetrics::onServerHeartbeat,
+                                                static_cast<void*>(this)) != DXF_FAILURE;
+  }
+
+  // The connection thread. The negative (unknown) values are not recorded.
+  void recordHeartbeat(std::chrono::microseconds rtt, std::chrono::microseconds serverLag) {
+    auto now = nowNanos();
+
+    if (rtt.count() >= 0) {
+      auto average = averageRttMicros_.load(std::memory_order_relaxed);
+
+      average = hasRtt_ ? average + (rtt.count() - average) / 8 : rtt.count();
+      hasRtt_ = true;
+      rttHistogram_.record(static_cast<std::uint64_t>(rtt.count()) * 1000);
+      latestRttMicros_.store(rtt.count(), std::memory_order_relaxed);
+      averageRttMicros_.store(average, std::memory_order_relaxed);
+    }
+
+    if (serverLag.count() >= 0) {
+      serverLagMicros_.store(serverLag.count(), std::memory_order_relaxed);
+    }
+
+    increase(heartbeatsNumber_, 1);
+    lastHeartbeatNanos_.store(now, std::memory_order_relaxed);
+    updateRates(now);
+  }
+
+  // The connection thread. One call of the event listener: eventsNumber events of eventBytesNumber bytes (e.g. the
+  // size of the C structs of the events).
+  void recordMessage(std::size_t eventsNumber, std::size_t eventBytesNumber = 0) {
+    auto now = nowNanos();
+
+    updateRates(now);
+    windowMessagesNumber_++;
+    windowEventsNumber_ += eventsNumber;
+    windowEventBytesNumber_ += eventBytesNumber;
+    increase(messagesNumber_, 1);
+    increase(eventsNumber_, eventsNumber);
+    increase(eventBytesNumber_, eventBytesNumber);
+    lastMessageNanos_.store(now, std::memory_order_relaxed);
+  }
+
+  // Any thread. The depth of the queue the events of the connection wait in before the processing.
+  void setQueueDepth(std::size_t depth) { queueDepth_.store(depth, std::memory_order_relaxed); }
+
+  [[nodiscard]] ConnectionMetricsSnapshot getSnapshot() const {
+    auto now = nowNanos();
+    ConnectionMetricsSnapshot result{};
+
+    result.latestRtt = std::chrono::microseconds{latestRttMicros_.load(std::memory_order_relaxed)};
+    result.averageRtt = std::chrono::microseconds{averageRttMicros_.load(std::memory_order_relaxed)};
+    result.serverLag = std::chrono::microseconds{serverLagMicros_.load(std::memory_order_relaxed)};
+    result.heartbeatsNumber = heartbeatsNumber_.load(std::memory_order_relaxed);
+    result.sinceLastHeartbeat = since(lastHeartbeatNanos_.load(std::memory_order_relaxed), now);
+    result.messagesNumber = messagesNumber_.load(std::memory_order_relaxed);
+    result.eventsNumber = eventsNumber_.load(std::memory_order_relaxed);
+    result.eventBytesNumber = eventBytesNumber_.load(std::memory_order_relaxed);
+    result.messagesPerSecond = messagesPerSecond_.load(std::memory_order_relaxed);
+    result.eventsPerSecond = eventsPerSecond_.load(std::memory_order_relaxed);
+    result.eventBytesPerSecond = eventBytesPerSecond_.load(std::memory_order_relaxed);
+    result.sinceLastMessage = since(lastMessageNanos_.load(std::memory_order_relaxed), now);
+    result.queueDepth = queueDepth_.load(std::memory_order_relaxed);
+
+    return result;
+  }
+
+  // The histogram of the RTTs in nanoseconds
+  [[nodiscard]] LatencyHistogramSnapshot getRttHistogram() const { return rttHistogram_.getSnapshot(); }
+
+  // Writes the metrics of the connection as the dxf_connection_* metrics labeled by the labels (e.g. the address). Can
+  // be called from any thread (see MetricsRegistry::addCollector).
+  void collectMetrics(MetricsWriter& writer, const MetricLabels& labels = {}) const {
+    auto snapshot = getSnapshot();
+    auto seconds = [](auto duration) { return std::chrono::duration<double>(duration).count(); };
+
+    writer.gauge("dxf_connection_rtt_seconds", "The RTT of the last heartbeat", labels, seconds(snapshot.latestRtt));
+    writer.gauge("dxf_connection_average_rtt_seconds", "The moving average of the RTTs", labels,
+                 seconds(snapshot.averageRtt));
+    writer.gauge("dxf_connection_server_lag_seconds", "The lag mark of the last heartbeat", labels,
+                 seconds(snapshot.serverLag));
+    writer.counter("dxf_connection_heartbeats_total", "The heartbeats of the server", labels,
+                   static_cast<double>(snapshot.heartbeatsNumber));
+    writer.gauge("dxf_connection_since_last_heartbeat_seconds", "The time since the last heartbeat", labels,
+                 seconds(snapshot.sinceLastHeartbeat));
+    writer.counter("dxf_connection_messages_total", "The calls of the event listeners", labels,
+                   static_cast<double>(snapshot.messagesNumber));
+    writer.counter("dxf_connection_events_total", "The received events", labels,
+                   static_cast<double>(snapshot.eventsNumber));
+    writer.counter("dxf_connection_event_bytes_total", "The bytes of the received events", labels,
+                   static_cast<double>(snapshot.eventBytesNumber));
+    writer.gauge("dxf_connection_events_per_second", "The events of the last full second", labels,
+                 snapshot.eventsPerSecond);
+    writer.gauge("dxf_connection_since_last_message_seconds", "The time since the last message", labels,
+                 seconds(snapshot.sinceLastMessage));
+    writer.gauge("dxf_connection_queue_depth", "The depth of the queue of the events of the connection", labels,
+                 static_cast<double>(snapshot.queueDepth));
+    writer.histogram("dxf_connection_rtt_nanoseconds", "The RTTs of the heartbeats", labels, getRttHistogram());
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,547 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Clock.hpp"
+#include "ConnectionMetrics.hpp"
+#include "Error.hpp"
+#include "SmallVector.hpp"
+#include "ThreadPlacement.hpp"
+
+namespace dxf {
+
+// The pool of the connections keyed by the address. The concurrent and the successive users of the same address share
+// one live connection (every user creates its own subscriptions). The connection that is not used by anyone is closed
+// after the idle timeout. The disconnected connection is never reused.
+class ConnectionPool final {
+  using Clock = std::chrono::steady_clock;
+
+  // The handlers of the disconnect of one connection: a receive adds one, so there are few of them
+  using DisconnectHandlers = SmallVector<std::pair<std::uint64_t, std::function<void()>>, 2>;
+
+  // The state of the connection of the entry (guarded by the mutex of the entry)
+  enum class ConnectionState { CONNECTING, CONNECTED, FAILED };
+
+  struct Entry {
+    std::string address{};
+    // The users of the different lanes of one address get the different connections (see acquire)
+    std::size_t lane = 0;
+    dxf_connection_t connection = nullptr;
+    // The placement of the socket thread of the connection (owned by the pool)
+    const ThreadPlacement* placement = nullptr;
+    std::size_t leasesNumber = 0;
+    Clock::time_point idleSince{};
+    std::atomic<bool> disconnected = false;
+    std::mutex mutex{};
+    std::condition_variable cv{};
+    // The entry is added to the pool before its connection is created (outside the pool mutex), the acquires of its
+    // address and lane wait for the connection by the cv
+    ConnectionState state = ConnectionState::CONNECTING;
+    // The handlers of the disconnect (see Lease::addDisconnectHandler)
+    std::uint64_t lastHandlerId = 0;
+    DisconnectHandlers disconnectHandlers{};
+    // The heartbeats of the connection and the messages of the listeners of the users
+    ConnectionMetrics metrics{};
+  };
+
+ public:
+  // The contention of the pool mutex
+  struct LockWaitStats {
+    std::uint64_t locksNumber = 0;
+    std::uint64_t contendedLocksNumber = 0;
+    std::chrono::nanoseconds waitTime{};
+  };
+
+  // The creations of the connections (outside the pool mutex) and the waits of the concurrent acquires of the same
+  // address for them
+  struct ConnectStats {
+    std::uint64_t connectsNumber = 0;
+    std::uint64_t failedConnectsNumber = 0;
+    std::chrono::nanoseconds connectTime{};
+    std::uint64_t connectWaitsNumber = 0;
+    std::chrono::nanoseconds connectWaitTime{};
+  };
+
+  // The right to use the connection. The connection is returned to the pool when the lease is destroyed.
+  class Lease final {
+    friend class ConnectionPool;
+
+    ConnectionPool* pool_ = nullptr;
+    std::shared_ptr<Entry> entry_{};
+
+    Lease(ConnectionPool* pool, std::shared_ptr<Entry> entry) : pool_{pool}, entry_{std::move(entry)} {}
+
+   public:
+    Lease() = default;
+
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    Lease(Lease&& other) noexcept : pool_{other.pool_}, entry_{std::move(other.entry_)} { other.pool_ = nullptr; }
+
+    Lease& operator=(Lease&& other) noexcept {
+      if (this != &other) {
+        reset();
+        pool_ = other.pool_;
+        entry_ = std::move(other.entry_);
+        other.pool_ = nullptr;
+      }
+
+      return *this;
+    }
+
+    ~Lease() { reset(); }
+
+    void reset() {
+      if (pool_ != nullptr && entry_) {
+        pool_->release(entry_);
+      }
+
+      pool_ = nullptr;
+      entry_.reset();
+    }
+
+    // Returns false if the connection can't be created or the pool is full
+    [[nodiscard]] bool isValid() const { return entry_ != nullptr; }
+
+    [[nodiscard]] dxf_connection_t getConnection() const { return entry_ ? entry_->connection : nullptr; }
+
+    [[nodiscard]] bool isDisconnected() const { return !entry_ || entry_->disconnected.load(); }
+
+    // The metrics of the connection (nullptr if the lease is invalid). The listeners of the users record their messages
+    // to them (see ConnectionMetrics::recordMessage).
+    [[nodiscard]] ConnectionMetrics* getMetrics() const { return entry_ ? &entry_->metrics : nullptr; }
+
+    // Waits for the disconnect or the isDone (timeout in ms of the default clock, 0 - no timeout). The isDone is
+    // checked again after every notify call. Returns true if the connection is disconnected or isDone returns true.
+    template <typename Predicate>
+    bool waitForDisconnect(int timeout, Predicate isDone) const {
+      if (!entry_) {
+        return true;
+      }
+
+      auto& clock = dxf::Clock::getDefault();
+      auto deadline = clock.now() + std::chrono::milliseconds(timeout);
+      // The advance of the simulated time wakes the wait up (the handler is added before the lock)
+      std::optional<AdvanceHandler> advanceHandler{};
+
+      if (timeout != 0 && clock.isSimulated()) {
+        advanceHandler.emplace(clock, entry_->mutex, entry_->cv);
+      }
+
+      std::unique_lock lk(entry_->mutex);
+      auto isFinished = [e = entry_.get(), &isDone] { return e->disconnected.load() || isDone(); };
+
+      if (timeout == 0) {
+        entry_->cv.wait(lk, isFinished);
+
+        return true;
+      }
+
+      return clock.waitUntil(lk, entry_->cv, deadline, isFinished);
+    }
+
+    // Waits for the disconnect (timeout in ms, 0 - no timeout). Returns true if the connection is disconnected.
+    bool waitForDisconnect(int timeout) const {
+      return waitForDisconnect(timeout, [] { return false; });
+    }
+
+    // Calls the handler once on the disconnect (on the connection thread), or at once if the connection is already
+    // disconnected. Returns the id of the handler (0 - the handler is already called).
+    std::uint64_t addDisconnectHandler(std::function<void()> handler) const {
+      if (entry_) {
+        std::lock_guard lk(entry_->mutex);
+
+        if (!entry_->disconnected.load()) {
+          entry_->disconnectHandlers.emplace_back(++entry_->lastHandlerId, std::move(handler));
+
+          return entry_->lastHandlerId;
+        }
+      }
+
+      handler();
+
+      return 0;
+    }
+
+    // The handler is not called after the removal, unless it is being called
+    void removeDisconnectHandler(std::uint64_t id) const {
+      if (!entry_ || id == 0) {
+        return;
+      }
+
+      std::lock_guard lk(entry_->mutex);
+
+      entry_->disconnectHandlers.eraseIf([id](const auto& handler) { return handler.first == id; });
+    }
+
+    // Wakes up the waiters of the connection, so they check their isDone predicates
+    void notify() const {
+      if (!entry_) {
+        return;
+      }
+
+      {
+        std::lock_guard lk(entry_->mutex);
+      }
+
+      entry_->cv.notify_all();
+    }
+  };
+
+ private:
+  std::size_t maxConnectionsNumber_;
+  std::chrono::milliseconds idleTimeout_;
+  ThreadPlacement placement_;
+  std::mutex mutex_{};
+  std::condition_variable reaperCv_{};
+  std::vector<std::shared_ptr<Entry>> entries_{};
+  bool stop_ = false;
+  std::thread reaper_{};
+  std::atomic<std::uint64_t> locksNumber_{0};
+  std::atomic<std::uint64_t> contendedLocksNumber_{0};
+  std::atomic<std::int64_t> lockWaitNanoseconds_{0};
+  std::atomic<std::uint64_t> connectsNumber_{0};
+  std::atomic<std::uint64_t> failedConnectsNumber_{0};
+  std::atomic<std::int64_t> connectNanoseconds_{0};
+  std::atomic<std::uint64_t> connectWaitsNumber_{0};
+  std::atomic<std::int64_t> connectWaitNanoseconds_{0};
+
+  static std::int64_t toNanoseconds(Clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  }
+
+  // Locks the pool mutex by the users of the pool (acquire, release). The waits of the contended locks are accounted
+  // (see getLockWaitStats).
+  std::unique_lock<std::mutex> lockPool() {
+    std::unique_lock lk(mutex_, std::try_to_lock);
+
+    locksNumber_.fetch_add(1, std::memory_order_relaxed);
+
+    if (!lk.owns_lock()) {
+      auto start = Clock::now();
+
+      lk.lock();
+      contendedLocksNumber_.fetch_add(1, std::memory_order_relaxed);
+      lockWaitNanoseconds_.fetch_add(toNanoseconds(Clock::now() - start), std::memory_order_relaxed);
+    }
+
+    return lk;
+  }
+
+  static void closeEntry(const std::shared_ptr<Entry>& entry) {
+    if (entry->connection != nullptr) {
+      dxf_close_connection(entry->connection);
+      entry->connection = nullptr;
+    }
+  }
+
+  // Removes the unused connections that are disconnected or idle for the timeout (or all unused ones if force)
+  std::vector<std::shared_ptr<Entry>> takeUnused(Clock::time_point now, bool force) {
+    std::vector<std::shared_ptr<Entry>> result{};
+
+    auto isUnused = [this, now, force](const std::shared_ptr<Entry>& e) {
+      return e->leasesNumber == 0 && (force || e->disconnected.load() || now - e->idleSince >= idleTimeout_);
+    };
+
+    for (const auto& entry : entries_) {
+      if (isUnused(entry)) {
+        result.push_back(entry);
+      }
+    }
+
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(), isUnused), entries_.end());
+
+    return result;
+  }
+
+  void runReaper() {
+    std::unique_lock lk(mutex_);
+
+    while (!stop_) {
+      auto next = Clock::time_point::max();
+
+      for (const auto& entry : entries_) {
+        if (entry->leasesNumber == 0) {
+          next = (std::min)(next, entry->idleSince + idleTimeout_);
+        }
+      }
+
+      if (next == Clock::time_point::max()) {
+        reaperCv_.wait(lk);
+      } else {
+        reaperCv_.wait_until(lk, next);
+      }
+
+      if (stop_) {
+        break;
+      }
+
+      auto unused = takeUnused(Clock::now(), false);
+
+      lk.unlock();
+
+      for (const auto& entry : unused) {
+        closeEntry(entry);
+      }
+
+      lk.lock();
+    }
+  }
+
+  // Waits until the connection of the entry (the lease of the caller is already counted) is created by the other
+  // acquire. Returns the invalid lease if it's failed.
+  Lease waitForConnection(const std::shared_ptr<Entry>& entry) {
+    bool isConnected = false;
+
+    {
+      std::unique_lock entryLock(entry->mutex);
+
+      if (entry->state == ConnectionState::CONNECTING) {
+        auto start = Clock::now();
+
+        entry->cv.wait(entryLock, [&entry] { return entry->state != ConnectionState::CONNECTING; });
+        connectWaitsNumber_.fetch_add(1, std::memory_order_relaxed);
+        connectWaitNanoseconds_.fetch_add(toNanoseconds(Clock::now() - start), std::memory_order_relaxed);
+      }
+
+      isConnected = entry->state == ConnectionState::CONNECTED;
+    }
+
+    if (!isConnected) {
+      release(entry);
+
+      return {};
+    }
+
+    return {this, entry};
+  }
+
+  void release(const std::shared_ptr<Entry>& entry) {
+    auto lk = lockPool();
+
+    if (--entry->leasesNumber != 0) {
+      return;
+    }
+
+    entry->idleSince = Clock::now();
+
+    if (entry->disconnected.load() || idleTimeout_.count() == 0) {
+      entries_.erase(std::remove(entries_.begin(), entries_.end(), entry), entries_.end());
+      lk.unlock();
+      closeEntry(entry);
+
+      return;
+    }
+
+    if (!reaper_.joinable()) {
+      reaper_ = std::thread([this] { runReaper(); });
+    }
+
+    reaperCv_.notify_one();
+  }
+
+ public:
+  // idleTimeout - the time the unused connection stays open (0 - closed at once). placement - the placement of the
+  // socket threads of the connections (applied by the socket thread when it starts, the failure is ignored).
+  explicit ConnectionPool(std::size_t maxConnectionsNumber = 16,
+                          std::chrono::milliseconds idleTimeout = std::chrono::seconds(30),
+                          ThreadPlacement placement = {})
+      : maxConnectionsNumber_{(std::max)(maxConnectionsNumber, std::size_t{1})},
+        idleTimeout_{idleTimeout},
+        placement_{std::move(placement)} {}
+
+  ConnectionPool(const ConnectionPool&) = delete;
+  ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+  // The leases must be destroyed before the pool
+  ~ConnectionPool() {
+    {
+      std::lock_guard lk(mutex_);
+
+      stop_ = true;
+    }
+
+    reaperCv_.notify_one();
+
+    if (reaper_.joinable()) {
+      reaper_.join();
+    }
+
+    for (const auto& entry : takeUnused(Clock::now(), true)) {
+      closeEntry(entry);
+    }
+  }
+
+  // Returns the lease of the live connection to the address (creates it if there is none). The lease is invalid if the
+  // connection can't be created or all maxConnectionsNumber connections are in use. lane - the users of the different
+  // lanes of the address get the different connections, so their events are read by the different connection threads
+  // (e.g. the time windows of SimpleTimeAndSaleDataProvider::runPartitioned).
+  //
+  // The connection is created outside the pool mutex, so the slow or unreachable address doesn't block the users of the
+  // other addresses. The concurrent acquires of the connection that is being created wait for it.
+  Lease acquire(const std::string& address, std::size_t lane = 0) {
+    std::vector<std::shared_ptr<Entry>> unused{};
+    std::shared_ptr<Entry> entry{};
+
+    {
+      auto lk = lockPool();
+
+      for (const auto& e : entries_) {
+        if (e->address == address && e->lane == lane && !e->disconnected.load()) {
+          // The entries may change after the unlock
+          auto found = e;
+
+          found->leasesNumber++;
+          lk.unlock();
+
+          return waitForConnection(found);
+        }
+      }
+
+      unused = takeUnused(Clock::now(), false);
+
+      if (entries_.size() >= maxConnectionsNumber_) {
+        // Evicts the least recently used idle connection
+        auto lru = entries_.end();
+
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+          if ((*it)->leasesNumber == 0 && (lru == entries_.end() || (*it)->idleSince < (*lru)->idleSince)) {
+            lru = it;
+          }
+        }
+
+        if (lru != entries_.end()) {
+          unused.push_back(*lru);
+          entries_.erase(lru);
+        }
+      }
+
+      if (entries_.size() < maxConnectionsNumber_) {
+        // The placeholder of the connection: the lease of the creator keeps it from the reaper and the eviction
+        entry = std::make_shared<Entry>();
+        entry->address = address;
+        entry->lane = lane;
+        entry->placement = placement_.isEmpty() ? nullptr : &placement_;
+        entry->leasesNumber = 1;
+        entries_.push_back(entry);
+      }
+    }
+
+    for (const auto& e : unused) {
+      closeEntry(e);
+    }
+
+    if (!entry) {
+      return {};
+    }
+
+    auto connectStart = Clock::now();
+    auto res = dxf_create_connection(
+      address.c_str(),
+      [](dxf_connection_t, void* data) {
+        auto e = static_cast<Entry*>(data);
+        DisconnectHandlers handlers{};
+
+        {
+          std::lock_guard entryLock(e->mutex);
+
+          e->disconnected = true;
+          handlers.swap(e->disconnectHandlers);
+        }
+
+        e->cv.notify_all();
+
+        for (const auto& handler : handlers) {
+          handler.second();
+        }
+      },
+      nullptr,
+      [](dxf_connection_t, void* data) {
+        if (auto placement = static_cast<Entry*>(data)->placement; placement != nullptr) {
+          placement->applyToCurrentThread();
+        }
+      },
+      nullptr, static_cast<void*>(entry.get()), &entry->connection);
+
+    connectsNumber_.fetch_add(1, std::memory_order_relaxed);
+    connectNanoseconds_.fetch_add(toNanoseconds(Clock::now() - connectStart), std::memory_order_relaxed);
+
+    if (res == DXF_FAILURE) {
+      failedConnectsNumber_.fetch_add(1, std::memory_order_relaxed);
+      ErrorCode::getLast();
+    } else {
+      entry->metrics.attach(entry->connection);
+    }
+
+    {
+      std::lock_guard entryLock(entry->mutex);
+
+      entry->state = res != DXF_FAILURE ? ConnectionState::CONNECTED : ConnectionState::FAILED;
+
+      // The failed entry is removed by the releases of its waiters and the creator
+      if (res == DXF_FAILURE) {
+        entry->disconnected = true;
+      }
+    }
+
+    entry->cv.notify_all();
+
+    if (res == DXF_FAILURE) {
+      release(entry);
+
+      return {};
+    }
+
+    return {this, entry};
+  }
+
+  [[nodiscard]] std::size_t getConnectionsNumber() {
+    std::lock_guard lk(mutex_);
+
+    return entries_.size();
+  }
+
+  // The addresses and the metrics of the connections of the pool
+  [[nodiscard]] std::vector<std::pair<std::string, ConnectionMetricsSnapshot>> getMetrics() {
+    std::lock_guard lk(mutex_);
+    std::vector<std::pair<std::string, ConnectionMetricsSnapshot>> result{};
+
+    result.reserve(entries_.size());
+
+    for (const auto& entry : entries_) {
+      result.emplace_back(entry->address, entry->metrics.getSnapshot());
+    }
+
+    return result;
+  }
+
+  [[nodiscard]] LockWaitStats getLockWaitStats() const {
+    return {locksNumber_.load(std::memory_order_relaxed), contendedLocksNumber_.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds(lockWaitNanoseconds_.load(std::memory_order_relaxed))};
+  }
+
+  [[nodiscard]] ConnectStats getConnectStats() const {
+    return {connectsNumber_.load(std::memory_order_relaxed), failedConnectsNumber_.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds(connectNanoseconds_.load(std::memory_order_relaxed)),
+            connectWaitsNumber_.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds(connectWaitNanoseconds_.load(std::memory_order_relaxed))};
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "IndexedEventSource.hpp"
+#include "PriceLevel.hpp"
+#include "PriceLevelBookEngine.hpp"
+#include "PriceLevelBookView.hpp"
+#include "PriceLevelLadder.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The price level book of one symbol consolidated from the order snapshots of several sources. The levels of the
+// different sources with the same price are merged (the sizes are summed).
+//
+// Every source keeps its own order index and all its levels (the contributions of the source). The size deltas of a
+// source transaction are applied both to the levels of the source and to the merged levels, so only the affected
+// merged levels are updated and the merged book is never rebuilt from the sources. The handlers receive the same
+// PriceLevelChangesSet deltas of the visible merged levels as the PriceLevelBook ones. A new snapshot of a source is
+// delivered as the incremental change from the old contribution of the source to the new one.
+class ConsolidatedPriceLevelBook final {
+  using Engine = PriceLevelBookEngine<FlatPriceLevelLadder>;
+
+  struct SourceBook {
+    ConsolidatedPriceLevelBook* book = nullptr;
+    IndexedEventSource source{};
+    dxf_snapshot_t snapshot = nullptr;
+    // All levels of the source
+    Engine engine{0};
+  };
+
+  std::string symbol_;
+  std::vector<std::unique_ptr<SourceBook>> sources_;
+  // The merged visible levels
+  Engine merged_;
+  bool isValid_;
+  std::mutex mutex_;
+
+  std::function<void(const PriceLevelChanges&)> onBookUpdate_;
+  std::function<void(const PriceLevelBookView&)> onBookUpdateView_;
+  std::function<void(const PriceLevelChangesSet&)> onIncrementalChange_;
+
+  ConsolidatedPriceLevelBook(std::string symbol, const std::vector<std::string>& sources, std::size_t levelsNumber)
+      : symbol_{std::move(symbol)}, sources_{}, merged_{levelsNumber}, isValid_{false}, mutex_{} {
+    for (const auto& source : sources) {
+      auto sourceBook = std::make_unique<SourceBook>();
+
+      sourceBook->book = this;
+      sourceBook->source = IndexedEventSource::valueOf(source);
+      sources_.push_back(std::move(sourceBook));
+    }
+  }
+
+  void processOrders(SourceBook& sourceBook, const dxf_order_t* orders, std::size_t recordsCount, bool newSnap) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (newSnap) {
+      // The old contribution of the source is removed by the updates of the new snapshot
+      sourceBook.engine.forgetOrders();
+    }
+
+    if (recordsCount == 0 && !newSnap) {
+      return;
+    }
+
+    sourceBook.engine.accumulateOrders(orders, recordsCount);
+
+    if (recordsCount != 0 && (orders[recordsCount - 1].event_flags & dxf_ef_tx_pending) != 0) {
+      return;
+    }
+
+    const auto& updates = sourceBook.engine.takeUpdates();
+
+    if (updates.asks.empty() && updates.bids.empty()) {
+      return;
+    }
+
+    sourceBook.engine.applyUpdates(updates);
+
+    const auto& resultingChangesSet = merged_.applyUpdates(updates);
+
+    if (onIncrementalChange_) {
+      onIncrementalChange_(resultingChangesSet);
+    }
+
+    if (onBookUpdate_) {
+      onBookUpdate_(merged_.getBook());
+    }
+
+    if (onBookUpdateView_) {
+      onBookUpdateView_(merged_.getBookView());
+    }
+  }
+
+  void closeSnapshots() {
+    for (auto& sourceBook : sources_) {
+      if (sourceBook->snapshot != nullptr) {
+        dxf_close_snapshot(sourceBook->snapshot);
+        sourceBook->snapshot = nullptr;
+      }
+    }
+
+    isValid_ = false;
+  }
+
+ public:
+  ~ConsolidatedPriceLevelBook() { closeSnapshots(); }
+
+  // Creates the book that subscribes to the order snapshots of the sources. The book is valid if all the snapshots are
+  // created.
+  static std::unique_ptr<ConsolidatedPriceLevelBook> create(dxf_connection_t connection, const std::string& symbol,
+                                                            const std::vector<std::string>& sources,
+                                                            std::size_t levelsNumber) {
+    auto book =
+      std::unique_ptr<ConsolidatedPriceLevelBook>(new ConsolidatedPriceLevelBook(symbol, sources, levelsNumber));
+    const auto& wSymbol = Symbol::valueOf(symbol).getWideName();
+
+    for (auto& sourceBook : book->sources_) {
+      dxf_snapshot_t snapshot = nullptr;
+
+      if (dxf_create_order_snapshot(connection, wSymbol.c_str(), sourceBook->source.getName().c_str(), 0, &snapshot) ==
+          DXF_FAILURE) {
+        book->closeSnapshots();
+
+        return book;
+      }
+
+      sourceBook->snapshot = snapshot;
+    }
+
+    book->isValid_ = !book->sources_.empty();
+
+    for (auto& sourceBook : book->sources_) {
+      dxf_attach_snapshot_inc_listener(
+        sourceBook->snapshot,
+        [](const dxf_snapshot_data_ptr_t snapshot_data, int new_snapshot, void* user_data) {
+          auto sb = static_cast<SourceBook*>(user_data);
+
+          sb->book->processOrders(*sb, reinterpret_cast<const dxf_order_t*>(snapshot_data->records),
+                                  static_cast<std::size_t>(snapshot_data->records_count), new_snapshot != 0);
+        },
+        sourceBook.get());
+    }
+
+    return book;
+  }
+
+  // Creates the book without the snapshot subscriptions. The snapshot data of the sources is passed to the
+  // processSnapshotData by the caller.
+  static std::unique_ptr<ConsolidatedPriceLevelBook> createDetached(const std::string& symbol,
+                                                                    const std::vector<std::string>& sources,
+                                                                    std::size_t levelsNumber) {
+    return std::unique_ptr<ConsolidatedPriceLevelBook>(new ConsolidatedPriceLevelBook(symbol, sources, levelsNumber));
+  }
+
+  // sourceIndex - the position of the source in the sources of the book
+  void processSnapshotData(std::size_t sourceIndex, const dxf_snapshot_data_ptr_t snapshotData, int newSnapshot) {
+    assert(sourceIndex < sources_.size());
+    assert(snapshotData->records_count == 0 || snapshotData->event_type == dx_eid_order);
+
+    processOrders(*sources_[sourceIndex], reinterpret_cast<const dxf_order_t*>(snapshotData->records),
+                  static_cast<std::size_t>(snapshotData->records_count), newSnapshot != 0);
+  }
+
+  [[nodiscard]] bool isValid() const { return isValid_; }
+
+  [[nodiscard]] const std::string& getSymbol() const { return symbol_; }
+
+  [[nodiscard]] std::vector<std::string> getSources() const {
+    std::vector<std::string> result{};
+
+    for (const auto& sourceBook : sources_) {
+      result.push_back(sourceBook->source.getName());
+    }
+
+    return result;
+  }
+
+  // Returns all levels of the source (its contributions to the merged levels) or the empty book if there is no such
+  // source.
+  [[nodiscard]] PriceLevelChanges getSourceBook(IndexedEventSource source) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    for (const auto& sourceBook : sources_) {
+      if (sourceBook->source == source) {
+        return {sourceBook->engine.getAsks(), sourceBook->engine.getBids()};
+      }
+    }
+
+    return {};
+  }
+
+  [[nodiscard]] PriceLevelChanges getSourceBook(const std::string& source) {
+    return getSourceBook(IndexedEventSource::valueOf(source));
+  }
+
+  void setOnBookUpdate(std::function<void(const PriceLevelChanges&)> onBookUpdateHandler) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onBookUpdate_ = std::move(onBookUpdateHandler);
+  }
+
+  // The view is valid only during the handler call (see PriceLevelBook::setOnBookUpdateView)
+  void setOnBookUpdateView(std::function<void(const PriceLevelBookView&)> onBookUpdateViewHandler) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onBookUpdateView_ = std::move(onBookUpdateViewHandler);
+  }
+
+  void setOnIncrementalChange(std::function<void(const PriceLevelChangesSet&)> onIncrementalChangeHandler) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onIncrementalChange_ = std::move(onIncrementalChangeHandler);
+  }
+};
+
+}  // namespace dxf
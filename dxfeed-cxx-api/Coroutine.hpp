@@ -0,0 +1,221 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "Executor.hpp"
+
+namespace dxf {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+// The common part of the promises of the tasks: the task starts when it is awaited and resumes the awaiting coroutine
+// when it is finished
+struct TaskPromiseBase {
+  struct FinalAwaiter {
+    [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      auto continuation = handle.promise().continuation_;
+
+      return continuation ? continuation : std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  std::coroutine_handle<> continuation_{};
+  std::exception_ptr exception_{};
+
+  [[nodiscard]] std::suspend_always initial_suspend() const noexcept { return {}; }
+
+  [[nodiscard]] FinalAwaiter final_suspend() const noexcept { return {}; }
+
+  void unhandled_exception() { exception_ = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+  std::optional<T> value_{};
+
+  Task<T> get_return_object();
+
+  template <typename U>
+  void return_value(U &&value) {
+    value_.emplace(std::forward<U>(value));
+  }
+
+  T takeResult() {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+
+    return std::move(*value_);
+  }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+  Task<void> get_return_object();
+
+  void return_void() const noexcept {}
+
+  void takeResult() const {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+  }
+};
+
+// The coroutine that is started by the executor and destroys itself when it is finished (see startTask)
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+
+    [[nodiscard]] std::suspend_always initial_suspend() const noexcept { return {}; }
+
+    [[nodiscard]] std::suspend_never final_suspend() const noexcept { return {}; }
+
+    void return_void() const noexcept {}
+
+    void unhandled_exception() const noexcept { std::terminate(); }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+}  // namespace detail
+
+// The lazy coroutine that returns the T: the body starts when the task is awaited (co_await task) and the awaiting
+// coroutine is resumed on the thread that finishes the task. The exception of the body is rethrown to the awaiting
+// coroutine. The top-level task is run by startTask.
+template <typename T>
+class Task final {
+ public:
+  using promise_type = detail::TaskPromise<T>;
+
+ private:
+  std::coroutine_handle<promise_type> handle_{};
+
+ public:
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_{handle} {}
+
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+
+  Task(Task &&other) noexcept : handle_{std::exchange(other.handle_, {})} {}
+
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+
+      handle_ = std::exchange(other.handle_, {});
+    }
+
+    return *this;
+  }
+
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  auto operator co_await() && noexcept {
+    struct Awaiter {
+      std::coroutine_handle<promise_type> handle;
+
+      [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept {
+        handle.promise().continuation_ = continuation;
+
+        return handle;
+      }
+
+      T await_resume() { return handle.promise().takeResult(); }
+    };
+
+    return Awaiter{handle_};
+  }
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+  return Task<T>{std::coroutine_handle<TaskPromise<T>>::from_promise(*this)};
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+  return Task<void>{std::coroutine_handle<TaskPromise<void>>::from_promise(*this)};
+}
+
+}  // namespace detail
+
+// The awaitable of the callback-based operation: the start is called with the callback when the coroutine is
+// suspended, the coroutine is resumed with the value of the callback on the thread that calls it.
+template <typename T>
+class CallbackAwaitable final {
+ public:
+  using StartType = std::function<void(std::function<void(T)>)>;
+
+ private:
+  StartType start_;
+  std::optional<T> value_{};
+
+ public:
+  explicit CallbackAwaitable(StartType start) : start_{std::move(start)} {}
+
+  [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    // The coroutine can be resumed (and the awaitable destroyed) before the start returns
+    auto start = std::move(start_);
+
+    start([this, handle](T value) {
+      value_.emplace(std::move(value));
+      handle.resume();
+    });
+  }
+
+  T await_resume() { return std::move(*value_); }
+};
+
+// Runs the task on the executor. The future is ready when the task is finished (the exception of the task is stored
+// in the future).
+template <typename T>
+std::future<T> startTask(Executor &executor, Task<T> task) {
+  auto result = std::make_shared<std::promise<T>>();
+  auto future = result->get_future();
+  auto run = [](Task<T> task, std::shared_ptr<std::promise<T>> result) -> detail::DetachedTask {
+    try {
+      if constexpr (std::is_void_v<T>) {
+        co_await std::move(task);
+        result->set_value();
+      } else {
+        result->set_value(co_await std::move(task));
+      }
+    } catch (...) {
+      result->set_exception(std::current_exception());
+    }
+  };
+
+  executor.post([handle = run(std::move(task), std::move(result)).handle] { handle.resume(); });
+
+  return future;
+}
+
+}  // namespace dxf
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DXFCXX_CPU_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define DXFCXX_CPU_ARM64 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// The NEON (Advanced SIMD) code of AArch64. NEON is the mandatory part of the architecture, so the functions with it
+// are compiled and called without the run time detection.
+#if defined(DXFCXX_CPU_ARM64) && (defined(__ARM_NEON) || defined(_M_ARM64))
+#define DXFCXX_CPU_NEON 1
+#include <arm_neon.h>
+#endif
+
+// The functions with the AVX2 code are compiled for the AVX2 and are called only if the CPU supports it
+#if defined(DXFCXX_CPU_X86) && (defined(__GNUC__) || defined(__clang__))
+#define DXFCXX_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DXFCXX_TARGET_AVX2
+#endif
+
+namespace dxf {
+
+// The run time detection of the CPU features that are used by the vector code paths
+struct CpuFeatures {
+ private:
+  static bool detectAvx2() {
+#if defined(DXFCXX_CPU_X86) && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2");
+#elif defined(DXFCXX_CPU_X86) && defined(_MSC_VER)
+    int info[4]{};
+
+    __cpuid(info, 1);
+
+    // OSXSAVE and AVX, then the OS saves the YMM registers
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+      return false;
+    }
+
+    __cpuidex(info, 7, 0);
+
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+  }
+
+  // The TSC runs at the constant rate in all the power states and is synchronized between the cores (CPUID
+  // 0x80000007, EDX bit 8)
+  static bool detectInvariantTsc() {
+#if defined(DXFCXX_CPU_X86) && (defined(__GNUC__) || defined(__clang__))
+    unsigned eax = 0;
+    unsigned ebx = 0;
+    unsigned ecx = 0;
+    unsigned edx = 0;
+
+    return __get_cpuid(0x80000007U, &eax, &ebx, &ecx, &edx) != 0 && (edx & (1U << 8U)) != 0;
+#elif defined(DXFCXX_CPU_X86) && defined(_MSC_VER)
+    int info[4]{};
+
+    __cpuid(info, static_cast<int>(0x80000000U));
+
+    if (static_cast<unsigned>(info[0]) < 0x80000007U) {
+      return false;
+    }
+
+    __cpuid(info, static_cast<int>(0x80000007U));
+
+    return (info[3] & (1 << 8)) != 0;
+#elif defined(DXFCXX_CPU_ARM64) && (defined(__GNUC__) || defined(__clang__))
+    // The generic timer (CNTVCT_EL0) of ARMv8 has the constant frequency by the architecture
+    return true;
+#else
+    return false;
+#endif
+  }
+
+ public:
+  static bool hasAvx2() {
+    static const bool result = detectAvx2();
+
+    return result;
+  }
+
+  // The invariant TSC (x86) or the generic timer (ARM64) that TscClock reads
+  static bool hasInvariantTsc() {
+    static const bool result = detectInvariantTsc();
+
+    return result;
+  }
+
+  static constexpr bool hasNeon() {
+#ifdef DXFCXX_CPU_NEON
+    return true;
+#else
+    return false;
+#endif
+  }
+};
+
+#ifdef DXFCXX_CPU_NEON
+namespace detail {
+
+// The bit masks of the lanes of the NEON comparisons (the lanes are all ones or zeros), as the movemask of SSE/AVX:
+// the bit i is the lane i. NEON has no such instruction, so every lane keeps its bit and the lanes are summed.
+inline std::uint32_t movemaskNeon(uint8x16_t lanes) {
+  static constexpr std::uint8_t BITS[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+  auto bits = vandq_u8(lanes, vld1q_u8(BITS));
+
+  return static_cast<std::uint32_t>(vaddv_u8(vget_low_u8(bits))) |
+         (static_cast<std::uint32_t>(vaddv_u8(vget_high_u8(bits))) << 8U);
+}
+
+inline std::uint32_t movemaskNeon(uint32x4_t lanes) {
+  static constexpr std::uint32_t BITS[4] = {1, 2, 4, 8};
+
+  return vaddvq_u32(vandq_u32(lanes, vld1q_u32(BITS)));
+}
+
+inline std::uint32_t movemaskNeon(uint64x2_t lanes) {
+  static constexpr std::uint64_t BITS[2] = {1, 2};
+
+  return static_cast<std::uint32_t>(vaddvq_u64(vandq_u64(lanes, vld1q_u64(BITS))));
+}
+
+}  // namespace detail
+#endif
+
+}  // namespace dxf
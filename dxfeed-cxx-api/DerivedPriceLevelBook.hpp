@@ -0,0 +1,458 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "PriceLevel.hpp"
+#include "PriceLevelBook.hpp"
+#include "PriceLevelBookView.hpp"
+
+namespace dxf {
+
+// The leg of the derived book: the book and the signed ratio of the leg (the number of the leg units per unit of the
+// derived instrument, negative - the leg is sold when the derived instrument is bought). E.g. the calendar spread is
+// {{front, 1.0}, {back, -1.0}}.
+struct DerivedBookLeg {
+  PriceLevelBook* book = nullptr;
+  double ratio = 1.0;
+};
+
+// The implied price level book of the spread or the basket of the legs. The implied bid is the price of selling one
+// unit of the derived instrument against the legs (the bids of the bought legs, the asks of the sold ones), the
+// implied ask is the price of buying it; the price is the sum of the ratios multiplied by the leg prices and the size
+// is the number of the units the legs can fill. The implied levels are found by the sweep of the leg levels from the
+// best ones, the consecutive units of the same price make one level.
+//
+// The derived book keeps the visible levels of the legs and the state of the sweep at the start of every implied
+// level. The leg delta (PriceLevelChangesSet) is applied to the leg levels, and the sweep is resumed from the first
+// implied level that has used the changed leg level, so the changes of the deep leg levels recompute only the deep
+// implied levels, and the implied book is never rebuilt from all level pairs. The handlers receive the same
+// PriceLevelChangesSet deltas of the visible implied levels as the PriceLevelBook ones (the diff of the resumed part
+// with the old levels). A new book of the leg is delivered as the incremental change.
+class DerivedPriceLevelBook final {
+  // The state of the sweep of one leg: the position of its current level and the size taken from it
+  struct Cursor {
+    std::size_t position = 0;
+    double taken = 0.0;
+  };
+
+  struct Leg {
+    PriceLevelBook* book = nullptr;
+    double ratio = 1.0;
+    // The visible levels of the leg (best-first)
+    std::vector<PriceLevel> asks{};
+    std::vector<PriceLevel> bids{};
+  };
+
+  // The implied levels of one side and the cursors of the legs at the start of every level (legsNumber per level)
+  struct ImpliedSide {
+    bool isBid = false;
+    std::vector<PriceLevel> levels{};
+    std::vector<Cursor> starts{};
+    // The previous levels of the resumed sweep (reused)
+    std::vector<PriceLevel> previousLevels{};
+  };
+
+  std::vector<Leg> legs_;
+  std::size_t levelsNumber_;
+  ImpliedSide asks_;
+  ImpliedSide bids_;
+  PriceLevelChangesSet changes_;
+  PriceLevelChanges book_;
+  std::mutex mutex_;
+
+  std::function<void(const PriceLevelChanges&)> onBookUpdate_;
+  std::function<void(const PriceLevelBookView&)> onBookUpdateView_;
+  std::function<void(const PriceLevelChangesSet&)> onIncrementalChange_;
+
+  DerivedPriceLevelBook(const std::vector<DerivedBookLeg>& legs, std::size_t levelsNumber)
+      : legs_{},
+        levelsNumber_{levelsNumber},
+        asks_{false},
+        bids_{true},
+        changes_{},
+        book_{},
+        mutex_{},
+        onBookUpdate_{},
+        onBookUpdateView_{},
+        onIncrementalChange_{} {
+    for (const auto& leg : legs) {
+      assert(leg.ratio != 0.0);
+
+      legs_.push_back(Leg{leg.book, leg.ratio});
+    }
+  }
+
+  // The levels of the leg that make the implied side (the bought legs make the implied bids of their bids)
+  std::vector<PriceLevel>& getLegLevels(Leg& leg, bool isImpliedBid) {
+    return (leg.ratio > 0.0) == isImpliedBid ? leg.bids : leg.asks;
+  }
+
+  // The implied side that is made by the side of the leg
+  ImpliedSide& getImpliedSide(const Leg& leg, bool isLegBid) { return (leg.ratio > 0.0) == isLegBid ? bids_ : asks_; }
+
+  template <typename Side>
+  static std::size_t findLevel(const std::vector<PriceLevel>& levels, double price) {
+    return static_cast<std::size_t>(
+      std::partition_point(levels.begin(), levels.end(),
+                           [price](const PriceLevel& pl) { return Side::isBetter(pl.price, price); }) -
+      levels.begin());
+  }
+
+  static bool isSamePrice(double price1, double price2) {
+    return price1 == price2 || (std::isnan(price1) && std::isnan(price2));
+  }
+
+  // The sums of the leg prices of the same price may differ by the rounding errors
+  static bool isSameImpliedPrice(double price1, double price2) {
+    return std::abs(price1 - price2) <= 1e-9 * (std::max)(1.0, std::abs(price1));
+  }
+
+  // Applies the changes of one leg side. Returns the first changed position (the size of the levels - no changes).
+  template <typename Side>
+  static std::size_t applyLegChanges(std::vector<PriceLevel>& levels, const std::vector<PriceLevel>& removals,
+                                     const std::vector<PriceLevel>& additions,
+                                     const std::vector<PriceLevel>& updates) {
+    auto result = (std::numeric_limits<std::size_t>::max)();
+
+    for (const auto& removal : removals) {
+      auto position = findLevel<Side>(levels, removal.price);
+
+      if (position < levels.size() && isSamePrice(levels[position].price, removal.price)) {
+        levels.erase(levels.begin() + static_cast<std::ptrdiff_t>(position));
+        result = (std::min)(result, position);
+      }
+    }
+
+    auto upsert = [&levels, &result](const PriceLevel& level) {
+      auto position = findLevel<Side>(levels, level.price);
+
+      if (position < levels.size() && isSamePrice(levels[position].price, level.price)) {
+        levels[position] = level;
+      } else {
+        levels.insert(levels.begin() + static_cast<std::ptrdiff_t>(position), level);
+      }
+
+      result = (std::min)(result, position);
+    };
+
+    for (const auto& addition : additions) {
+      upsert(addition);
+    }
+
+    for (const auto& update : updates) {
+      upsert(update);
+    }
+
+    return (std::min)(result, levels.size());
+  }
+
+  // The first implied level whose sweep may have used the leg level at the position (or a later one)
+  std::size_t findResumeLevel(const ImpliedSide& side, std::size_t legIndex, std::size_t legPosition) const {
+    auto legsNumber = legs_.size();
+    std::size_t first = 0;
+    std::size_t last = side.levels.size();
+
+    // The first level that starts at or after the leg position
+    while (first < last) {
+      auto middle = first + (last - first) / 2;
+
+      if (side.starts[middle * legsNumber + legIndex].position < legPosition) {
+        first = middle + 1;
+      } else {
+        last = middle;
+      }
+    }
+
+    return first == 0 ? 0 : first - 1;
+  }
+
+  // Resumes the sweep of the implied side from the level and collects the differences with the previous levels
+  void resumeSweep(ImpliedSide& side, std::size_t fromLevel, std::vector<PriceLevel>& additions,
+                   std::vector<PriceLevel>& updates, std::vector<PriceLevel>& removals) {
+    auto legsNumber = legs_.size();
+
+    fromLevel = (std::min)(fromLevel, side.levels.size());
+    side.previousLevels.assign(side.levels.begin() + static_cast<std::ptrdiff_t>(fromLevel), side.levels.end());
+
+    std::vector<Cursor> cursors(legsNumber);
+
+    if (fromLevel < side.levels.size()) {
+      std::copy_n(side.starts.begin() + static_cast<std::ptrdiff_t>(fromLevel * legsNumber), legsNumber,
+                  cursors.begin());
+    } else if (fromLevel != 0) {
+      // The sweep is resumed after the last level: its cursors are found by the sweep of the last level again
+      fromLevel--;
+      side.previousLevels.insert(side.previousLevels.begin(), side.levels.back());
+      std::copy_n(side.starts.begin() + static_cast<std::ptrdiff_t>(fromLevel * legsNumber), legsNumber,
+                  cursors.begin());
+    }
+
+    side.levels.resize(fromLevel);
+    side.starts.resize(fromLevel * legsNumber);
+    sweep(side, cursors);
+
+    if (side.isBid) {
+      diff<BidSide>(side.previousLevels, side.levels, fromLevel, additions, updates, removals);
+    } else {
+      diff<AskSide>(side.previousLevels, side.levels, fromLevel, additions, updates, removals);
+    }
+  }
+
+  // Sweeps the leg levels from the cursors and appends the implied levels
+  void sweep(ImpliedSide& side, std::vector<Cursor>& cursors) {
+    auto legsNumber = legs_.size();
+
+    while (true) {
+      auto price = 0.0;
+      auto units = (std::numeric_limits<double>::infinity)();
+      std::int64_t time = 0;
+
+      for (std::size_t i = 0; i < legsNumber; i++) {
+        const auto& levels = getLegLevels(legs_[i], side.isBid);
+
+        if (cursors[i].position >= levels.size()) {
+          return;
+        }
+
+        const auto& level = levels[cursors[i].position];
+
+        price += legs_[i].ratio * level.price;
+        units = (std::min)(units, (level.size - cursors[i].taken) / std::abs(legs_[i].ratio));
+        time = (std::max)(time, level.time);
+      }
+
+      if (std::isnan(price) || !(units > 0.0)) {
+        return;
+      }
+
+      if (!side.levels.empty() && isSameImpliedPrice(side.levels.back().price, price)) {
+        side.levels.back().size += units;
+        side.levels.back().time = (std::max)(side.levels.back().time, time);
+      } else {
+        if (levelsNumber_ != 0 && side.levels.size() == levelsNumber_) {
+          return;
+        }
+
+        side.levels.push_back({price, units, time});
+        side.starts.insert(side.starts.end(), cursors.begin(), cursors.end());
+      }
+
+      // The legs whose levels are filled move to their next levels
+      for (std::size_t i = 0; i < legsNumber; i++) {
+        const auto& level = getLegLevels(legs_[i], side.isBid)[cursors[i].position];
+        auto taken = cursors[i].taken + units * std::abs(legs_[i].ratio);
+
+        if (taken >= level.size * (1.0 - 1e-12)) {
+          cursors[i] = {cursors[i].position + 1, 0.0};
+        } else {
+          cursors[i].taken = taken;
+        }
+      }
+    }
+  }
+
+  // The differences of the resumed levels (best-first) with the previous ones
+  template <typename Side>
+  void diff(const std::vector<PriceLevel>& previousLevels, const std::vector<PriceLevel>& levels,
+            std::size_t fromLevel, std::vector<PriceLevel>& additions, std::vector<PriceLevel>& updates,
+            std::vector<PriceLevel>& removals) const {
+    auto previous = previousLevels.begin();
+    auto current = levels.begin() + static_cast<std::ptrdiff_t>(fromLevel);
+
+    while (previous != previousLevels.end() || current != levels.end()) {
+      if (current == levels.end() ||
+          (previous != previousLevels.end() && Side::isBetter(previous->price, current->price))) {
+        removals.push_back(*previous++);
+      } else if (previous == previousLevels.end() || Side::isBetter(current->price, previous->price)) {
+        additions.push_back(*current++);
+      } else {
+        if (previous->size != current->size || previous->time != current->time) {
+          updates.push_back(*current);
+        }
+
+        ++previous;
+        ++current;
+      }
+    }
+  }
+
+  void clearChanges() {
+    for (auto* changes : {&changes_.additions, &changes_.updates, &changes_.removals}) {
+      changes->asks.clear();
+      changes->bids.clear();
+    }
+  }
+
+  void resumeSide(ImpliedSide& side, std::size_t fromLevel) {
+    if (side.isBid) {
+      resumeSweep(side, fromLevel, changes_.additions.bids, changes_.updates.bids, changes_.removals.bids);
+    } else {
+      resumeSweep(side, fromLevel, changes_.additions.asks, changes_.updates.asks, changes_.removals.asks);
+    }
+  }
+
+  // Called under the mutex
+  void notify() {
+    if (changes_.additions.asks.empty() && changes_.additions.bids.empty() && changes_.updates.asks.empty() &&
+        changes_.updates.bids.empty() && changes_.removals.asks.empty() && changes_.removals.bids.empty()) {
+      return;
+    }
+
+    if (onIncrementalChange_) {
+      onIncrementalChange_(changes_);
+    }
+
+    if (onBookUpdate_) {
+      book_.asks = asks_.levels;
+      book_.bids = bids_.levels;
+      onBookUpdate_(book_);
+    }
+
+    if (onBookUpdateView_) {
+      onBookUpdateView_(getBookView());
+    }
+  }
+
+  [[nodiscard]] PriceLevelBookView getBookView() const {
+    auto accessor = [](const void* levels, std::size_t position) {
+      return (*static_cast<const std::vector<PriceLevel>*>(levels))[position];
+    };
+
+    return {PriceLevelSideView{&asks_.levels, asks_.levels.size(), accessor},
+            PriceLevelSideView{&bids_.levels, bids_.levels.size(), accessor}};
+  }
+
+ public:
+  // Resets the handlers of the attached legs (see create)
+  ~DerivedPriceLevelBook() {
+    for (auto& leg : legs_) {
+      if (leg.book != nullptr) {
+        leg.book->setOnNewBook({});
+        leg.book->setOnIncrementalChange({});
+      }
+    }
+  }
+
+  // Creates the derived book of the legs (see DerivedBookLeg) that receives the new books and the deltas of the leg
+  // books by their OnNewBook and OnIncrementalChange handlers (the handlers of the legs are replaced). The leg books
+  // must outlive the derived book. levelsNumber - the number of the implied levels of every side (0 - all levels the
+  // legs can fill).
+  static std::unique_ptr<DerivedPriceLevelBook> create(const std::vector<DerivedBookLeg>& legs,
+                                                       std::size_t levelsNumber) {
+    auto book = std::unique_ptr<DerivedPriceLevelBook>(new DerivedPriceLevelBook(legs, levelsNumber));
+
+    for (std::size_t i = 0; i < legs.size(); i++) {
+      if (legs[i].book == nullptr) {
+        continue;
+      }
+
+      auto* derived = book.get();
+
+      legs[i].book->setOnNewBook(
+        [derived, i](const PriceLevelChanges& legBook) { derived->processNewBook(i, legBook); });
+      legs[i].book->setOnIncrementalChange(
+        [derived, i](const PriceLevelChangesSet& changes) { derived->processChanges(i, changes); });
+    }
+
+    return book;
+  }
+
+  // Creates the book without the leg books (the books of the legs are ignored): the new books and the deltas of the
+  // legs are passed to the processNewBook and the processChanges by the caller. ratios - the signed ratios of the legs.
+  static std::unique_ptr<DerivedPriceLevelBook> createDetached(const std::vector<double>& ratios,
+                                                               std::size_t levelsNumber) {
+    std::vector<DerivedBookLeg> legs{};
+
+    for (auto ratio : ratios) {
+      legs.push_back({nullptr, ratio});
+    }
+
+    return std::unique_ptr<DerivedPriceLevelBook>(new DerivedPriceLevelBook(legs, levelsNumber));
+  }
+
+  // The new book of the leg (legIndex - the position of the leg): the implied sides are swept again from the best
+  // levels, the differences are delivered as the incremental change
+  void processNewBook(std::size_t legIndex, const PriceLevelChanges& legBook) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    assert(legIndex < legs_.size());
+
+    legs_[legIndex].asks = legBook.asks;
+    legs_[legIndex].bids = legBook.bids;
+    clearChanges();
+    resumeSide(asks_, 0);
+    resumeSide(bids_, 0);
+    notify();
+  }
+
+  // The delta of the visible levels of the leg: only the implied levels from the first one that has used a changed
+  // leg level are swept again
+  void processChanges(std::size_t legIndex, const PriceLevelChangesSet& changes) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    assert(legIndex < legs_.size());
+
+    auto& leg = legs_[legIndex];
+    auto askPosition = applyLegChanges<AskSide>(leg.asks, changes.removals.asks, changes.additions.asks,
+                                                changes.updates.asks);
+    auto bidPosition = applyLegChanges<BidSide>(leg.bids, changes.removals.bids, changes.additions.bids,
+                                                changes.updates.bids);
+
+    clearChanges();
+
+    // The position past the levels means the changes are beyond them (e.g. the removals of the unknown levels)
+    if (askPosition < leg.asks.size() || !changes.removals.asks.empty() || !changes.additions.asks.empty()) {
+      auto& side = getImpliedSide(leg, false);
+
+      resumeSide(side, findResumeLevel(side, legIndex, askPosition));
+    }
+
+    if (bidPosition < leg.bids.size() || !changes.removals.bids.empty() || !changes.additions.bids.empty()) {
+      auto& side = getImpliedSide(leg, true);
+
+      resumeSide(side, findResumeLevel(side, legIndex, bidPosition));
+    }
+
+    notify();
+  }
+
+  [[nodiscard]] std::size_t getLegsNumber() const { return legs_.size(); }
+
+  // Returns the implied levels (best-first)
+  [[nodiscard]] PriceLevelChanges getBook() {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return {asks_.levels, bids_.levels};
+  }
+
+  void setOnBookUpdate(std::function<void(const PriceLevelChanges&)> onBookUpdateHandler) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onBookUpdate_ = std::move(onBookUpdateHandler);
+  }
+
+  // The view is valid only during the handler call (see PriceLevelBook::setOnBookUpdateView)
+  void setOnBookUpdateView(std::function<void(const PriceLevelBookView&)> onBookUpdateViewHandler) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onBookUpdateView_ = std::move(onBookUpdateViewHandler);
+  }
+
+  void setOnIncrementalChange(std::function<void(const PriceLevelChangesSet&)> onIncrementalChangeHandler) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onIncrementalChange_ = std::move(onIncrementalChangeHandler);
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#ifndef _WIN32
+#include <signal.h>
+#endif
+
+#include "PriceLevelBook.hpp"
+#include "PriceLevelBookManager.hpp"
+#include "ThreadPlacement.hpp"
+
+namespace dxf {
+
+namespace detail {
+
+// The number of the diagnostics requests of the process (the signal handler only increments it)
+inline std::atomic<std::uint64_t> diagnosticsRequestsNumber{0};
+
+inline void appendJsonString(std::string& out, std::string_view s) {
+  out += '"';
+
+  for (auto c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    } else if (static_cast<unsigned char>(c) < 0x20U) {
+      fmt::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<unsigned>(c));
+    } else {
+      out += c;
+    }
+  }
+
+  out += '"';
+}
+
+inline void appendJson(std::string& out, const PriceLevelBookDiagnostics& book) {
+  const auto& backpressure = book.backpressure;
+
+  out += "{\"symbol\":";
+  appendJsonString(out, book.symbol);
+  out += ",\"source\":";
+  appendJsonString(out, book.source);
+  fmt::format_to(std::back_inserter(out),
+                 ",\"priority\":{},\"ready\":{},\"stale\":{},\"orders\":{},\"memory\":{},\"snapshotData\":{},"
+                 "\"records\":{},\"resyncs\":{},\"queueDepth\":{},\"queueHighWaterMark\":{},\"dropped\":{},"
+                 "\"conflated\":{},\"overflows\":{},\"blockedNanos\":{},\"disconnected\":{}}}",
+                 book.priority, book.isReady, book.isStale, book.ordersNumber, book.memoryUsage,
+                 book.snapshotDataNumber, book.recordsNumber, book.resyncsNumber, backpressure.queueDepth,
+                 backpressure.highWaterMark, backpressure.droppedNumber, backpressure.conflatedNumber,
+                 backpressure.overflowsNumber, backpressure.blockedTime.count(), backpressure.isDisconnected);
+}
+
+}  // namespace detail
+
+// The compact JSON of the state of the book
+inline std::string toJson(const PriceLevelBookDiagnostics& book) {
+  std::string result{};
+
+  detail::appendJson(result, book);
+
+  return result;
+}
+
+// The compact JSON of the diagnostics of the manager: the time, the collection time and the shards with their load
+// counters and the states of their books
+inline std::string toJson(const PriceLevelBookManagerDiagnostics& diagnostics) {
+  std::string result{};
+  auto out = std::back_inserter(result);
+
+  fmt::format_to(out, "{{\"time\":{},\"collectionNanos\":{},\"shards\":[", diagnostics.time,
+                 diagnostics.collectionTime.count());
+
+  for (std::size_t i = 0; i < diagnostics.shards.size(); i++) {
+    const auto& shard = diagnostics.shards[i];
+
+    fmt::format_to(out,
+                   "{}{{\"shard\":{},\"responded\":{},\"booksNumber\":{},\"records\":{},\"busyNanos\":{},"
+                   "\"passes\":{},\"helpedRebuilds\":{},\"books\":[",
+                   i == 0 ? "" : ",", i, shard.isResponded, shard.load.booksNumber, shard.load.recordsNumber,
+                   shard.load.busyTime.count(), shard.load.passesNumber, shard.load.helpedRebuildsNumber);
+
+    for (std::size_t j = 0; j < shard.books.size(); j++) {
+      if (j != 0) {
+        result += ',';
+      }
+
+      detail::appendJson(result, shard.books[j]);
+    }
+
+    result += "]}";
+  }
+
+  result += "]}\n";
+
+  return result;
+}
+
+// Writes the diagnostics report (e.g. the JSON of PriceLevelBookManager::collectDiagnostics) to the new file on its
+// background thread when it's requested: by request() from any thread or by the signal (see installSignalHandler,
+// e.g. `kill -USR1 <pid>`). The report is collected and written on the thread of the dump, the threads of the feed are
+// not stopped, so the state of the overloaded process is seen without the debugger. The file is
+// <directory>/<prefix>-<ms since the epoch>.json, written to the temporary file and renamed.
+//
+// Usage:
+//   DiagnosticsDump::installSignalHandler();
+//
+//   DiagnosticsDump dump{[&manager] { return toJson(manager.collectDiagnostics()); }, "/var/tmp"};
+class DiagnosticsDump final {
+  // The requests are checked this often
+  static constexpr std::chrono::milliseconds POLL_INTERVAL{100};
+
+  std::function<std::string()> report_;
+  std::string directory_;
+  std::string prefix_;
+  std::uint64_t seenRequestsNumber_;
+  std::atomic<bool> stop_{false};
+  std::atomic<std::uint64_t> dumpsNumber_{0};
+  std::atomic<std::uint64_t> failuresNumber_{0};
+  // Guards the lastPath_
+  mutable std::mutex mutex_{};
+  std::string lastPath_{};
+  std::thread thread_{};
+
+  void run() {
+    ThreadPlacement::setCurrentThreadName("dxf-diagnostics");
+
+    while (!stop_.load(std::memory_order_acquire)) {
+      std::this_thread::sleep_for(POLL_INTERVAL);
+
+      auto requestsNumber = detail::diagnosticsRequestsNumber.load(std::memory_order_acquire);
+
+      if (requestsNumber != seenRequestsNumber_) {
+        seenRequestsNumber_ = requestsNumber;
+        dump();
+      }
+    }
+  }
+
+ public:
+  // report - returns the text of the report (is called on the thread of the dump). The directory must exist.
+  explicit DiagnosticsDump(std::function<std::string()> report, std::string directory = ".",
+                           std::string prefix = "diagnostics")
+      : report_{std::move(report)},
+        directory_{std::move(directory)},
+        prefix_{std::move(prefix)},
+        seenRequestsNumber_{detail::diagnosticsRequestsNumber.load(std::memory_order_acquire)},
+        thread_{[this] { run(); }} {}
+
+  DiagnosticsDump(const DiagnosticsDump&) = delete;
+  DiagnosticsDump& operator=(const DiagnosticsDump&) = delete;
+
+  ~DiagnosticsDump() {
+    stop_.store(true, std::memory_order_release);
+    thread_.join();
+  }
+
+  // Requests the reports of all the dumps of the process. Is async-signal-safe.
+  static void request() { detail::diagnosticsRequestsNumber.fetch_add(1, std::memory_order_release); }
+
+  // Installs the handler of the signal (SIGUSR1 by default) that requests the reports. Returns false if it can't be
+  // installed (or on Windows, where there are no such signals).
+  static bool installSignalHandler(int signalNumber = 0) {
+#ifdef _WIN32
+    (void)signalNumber;
+
+    return false;
+#else
+    struct sigaction action {};
+
+    action.sa_handler = [](int) { request(); };
+    // The interrupted system calls of the other threads are restarted
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    return sigaction(signalNumber != 0 ? signalNumber : SIGUSR1, &action, nullptr) == 0;
+#endif
+  }
+
+  // Collects the report and writes it now (on the calling thread). Returns the path of the file or the empty string
+  // if it can't be written.
+  std::string dump() {
+    auto text = report_();
+    auto time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::system_clock::now().time_since_epoch())
+                  .count();
+    auto path = (std::filesystem::path(directory_) / fmt::format("{}-{}.json", prefix_, time)).string();
+    auto temporaryPath = path + ".tmp";
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> file{std::fopen(temporaryPath.c_str(), "wb"), &std::fclose};
+    auto isWritten = file && std::fwrite(text.data(), 1, text.size(), file.get()) == text.size();
+
+    isWritten = file && std::fclose(file.release()) == 0 && isWritten;
+
+    std::error_code ec{};
+
+    if (isWritten) {
+      std::filesystem::rename(temporaryPath, path, ec);
+    }
+
+    if (!isWritten || ec) {
+      std::filesystem::remove(temporaryPath, ec);
+      failuresNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      return {};
+    }
+
+    dumpsNumber_.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    lastPath_ = path;
+
+    return path;
+  }
+
+  [[nodiscard]] std::uint64_t getDumpsNumber() const { return dumpsNumber_.load(std::memory_order_relaxed); }
+
+  [[nodiscard]] std::uint64_t getFailuresNumber() const { return failuresNumber_.load(std::memory_order_relaxed); }
+
+  // The path of the last written report (empty - none yet)
+  [[nodiscard]] std::string getLastPath() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return lastPath_;
+  }
+};
+
+}  // namespace dxf
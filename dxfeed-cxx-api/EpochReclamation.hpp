@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dxf {
+
+// The epoch-based reclamation of the objects that one writer replaces while the readers on the other threads may still
+// read them. A reader pins the current epoch for the time of its reading (EpochDomain::pin), the writer retires the
+// replaced objects with the current epoch and advances it; the retired object is reclaimed when no reader has pinned
+// its epoch or an earlier one. The readers never block the writer and never wait for it, the writer never waits for
+// the readers (the objects of the long reading are reclaimed later).
+//
+// Usage:
+//   // The writer
+//   auto* old = current.exchange(next, std::memory_order_acq_rel);
+//   domain.retire(old);
+//   domain.advance();
+//   domain.reclaim([](void* object, EpochDomain::Deleter deleter) { deleter(object); });
+//
+//   // The reader (any thread)
+//   auto guard = domain.pin();
+//   const auto* version = current.load(std::memory_order_acquire);
+//   ... read the version until the guard is destroyed ...
+class EpochDomain final {
+ public:
+  // The maximum number of the concurrent readers (the pins of the other readers wait for a free slot)
+  static constexpr std::size_t MAX_READERS = 64;
+
+  using Deleter = void (*)(void* object);
+
+ private:
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+  // The slot is not used by a reader
+  static constexpr std::uint64_t FREE_SLOT = 0;
+
+  struct alignas(CACHE_LINE_SIZE) Slot {
+    // The pinned epoch of the reader (FREE_SLOT - no reader)
+    std::atomic<std::uint64_t> epoch{FREE_SLOT};
+  };
+
+  struct Retired {
+    std::uint64_t epoch;
+    void* object;
+    Deleter deleter;
+  };
+
+  // Starts from 1, so the pinned epoch is never FREE_SLOT
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> epoch_{1};
+  std::array<Slot, MAX_READERS> slots_{};
+  // The writer only
+  std::vector<Retired> retired_{};
+
+  void unpin(std::size_t slot) { slots_[slot].epoch.store(FREE_SLOT, std::memory_order_release); }
+
+  // The earliest pinned epoch (the max of uint64 - no readers)
+  [[nodiscard]] std::uint64_t getMinPinnedEpoch() const {
+    auto result = (std::numeric_limits<std::uint64_t>::max)();
+
+    for (const auto& slot : slots_) {
+      auto epoch = slot.epoch.load(std::memory_order_seq_cst);
+
+      if (epoch != FREE_SLOT) {
+        result = (std::min)(result, epoch);
+      }
+    }
+
+    return result;
+  }
+
+ public:
+  // The pinned epoch of the reader, unpins it on the destruction
+  class Guard final {
+    EpochDomain* domain_ = nullptr;
+    std::size_t slot_ = 0;
+
+   public:
+    Guard() = default;
+
+    Guard(EpochDomain* domain, std::size_t slot) : domain_{domain}, slot_{slot} {}
+
+    Guard(Guard&& other) noexcept : domain_{std::exchange(other.domain_, nullptr)}, slot_{other.slot_} {}
+
+    Guard& operator=(Guard&& other) noexcept {
+      if (this != &other) {
+        reset();
+        domain_ = std::exchange(other.domain_, nullptr);
+        slot_ = other.slot_;
+      }
+
+      return *this;
+    }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+    ~Guard() { reset(); }
+
+    [[nodiscard]] bool isPinned() const { return domain_ != nullptr; }
+
+    void reset() {
+      if (domain_ != nullptr) {
+        domain_->unpin(slot_);
+        domain_ = nullptr;
+      }
+    }
+  };
+
+  EpochDomain() = default;
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  // Frees the retired objects (there must be no readers)
+  ~EpochDomain() {
+    for (const auto& retired : retired_) {
+      retired.deleter(retired.object);
+    }
+  }
+
+  // The reader. Pins the current epoch: the objects that are retired since are not reclaimed until the guard is
+  // destroyed. Takes a free slot (yields while all MAX_READERS slots are taken).
+  [[nodiscard]] Guard pin() {
+    for (std::size_t attempt = 0;; attempt++) {
+      for (std::size_t i = 0; i < MAX_READERS; i++) {
+        auto& slot = slots_[i];
+        auto epoch = epoch_.load(std::memory_order_seq_cst);
+        auto expected = FREE_SLOT;
+
+        if (!slot.epoch.compare_exchange_strong(expected, epoch, std::memory_order_seq_cst)) {
+          continue;
+        }
+
+        // The epoch has been advanced (and the writer may have missed the slot) before the pin is visible
+        while (true) {
+          auto current = epoch_.load(std::memory_order_seq_cst);
+
+          if (current == epoch) {
+            return {this, i};
+          }
+
+          epoch = current;
+          slot.epoch.store(epoch, std::memory_order_seq_cst);
+        }
+      }
+
+      if (attempt != 0) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // The writer. Retires the object that is not reachable by the new readers (it's replaced by the published one).
+  template <typename T>
+  void retire(T* object) {
+    retire(object, [](void* o) { delete static_cast<T*>(o); });
+  }
+
+  // The writer. Retires the object with the custom deleter (e.g. the return to the pool of the writer)
+  void retire(void* object, Deleter deleter) {
+    retired_.push_back({epoch_.load(std::memory_order_relaxed), object, deleter});
+  }
+
+  // The writer. Advances the epoch after the retires of one publication.
+  void advance() { epoch_.fetch_add(1, std::memory_order_seq_cst); }
+
+  // The writer. Passes the retired objects that no reader can read to the reclaimer (object, deleter) instead of the
+  // deleters (e.g. to reuse them). Returns the number of the reclaimed objects.
+  template <typename Reclaimer>
+  std::size_t reclaim(Reclaimer&& reclaimer) {
+    if (retired_.empty()) {
+      return 0;
+    }
+
+    auto minPinnedEpoch = getMinPinnedEpoch();
+    // The retired ones are in the order of their epochs
+    auto end = std::find_if(retired_.begin(), retired_.end(),
+                            [minPinnedEpoch](const Retired& retired) { return retired.epoch >= minPinnedEpoch; });
+    auto result = static_cast<std::size_t>(end - retired_.begin());
+
+    for (auto it = retired_.begin(); it != end; ++it) {
+      reclaimer(it->object, it->deleter);
+    }
+
+    retired_.erase(retired_.begin(), end);
+
+    return result;
+  }
+
+  // The writer. Frees the retired objects that no reader can read.
+  std::size_t reclaim() {
+    return reclaim([](void* object, Deleter deleter) { deleter(object); });
+  }
+
+  [[nodiscard]] std::uint64_t getEpoch() const { return epoch_.load(std::memory_order_relaxed); }
+
+  // The number of the retired objects that are not reclaimed yet (the writer only)
+  [[nodiscard]] std::size_t getRetiredNumber() const { return retired_.size(); }
+};
+
+}  // namespace dxf
@@ -3,8 +3,15 @@
 #include <DXFeed.h>
 #include <fmt/format.h>
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <string>
+#include <string_view>
 
+#include "Metrics.hpp"
 #include "StringConverter.hpp"
 
 namespace dxf {
@@ -29,7 +36,7 @@ struct Error {
       return "";
     }
 
-    return fmt::format("[{}] {}", code, StringConverter::wStringToUtf8(description));
+    return fmt::format("[{}] {}", code, StringConverter::wStringToUtf8View(description));
   }
 
   template <typename OutStream>
@@ -40,4 +47,116 @@ struct Error {
   }
 };
 
-}  // namespace dxf
\ No newline at end of file
+// The per-code numbers of the errors of the process (see ErrorCode::getLast). The codes of the C API are small, the
+// others are counted together (OTHER_CODE).
+class ErrorCounters final {
+ public:
+  static constexpr std::size_t CODES_NUMBER = 1024;
+  static constexpr int OTHER_CODE = -1;
+
+ private:
+  std::array<std::atomic<std::uint64_t>, CODES_NUMBER> counts_{};
+  std::atomic<std::uint64_t> otherCount_{0};
+
+  ErrorCounters() = default;
+
+ public:
+  static ErrorCounters &getInstance() {
+    static ErrorCounters instance{};
+
+    return instance;
+  }
+
+  void record(int code) {
+    if (code >= 0 && static_cast<std::size_t>(code) < CODES_NUMBER) {
+      counts_[static_cast<std::size_t>(code)].fetch_add(1, std::memory_order_relaxed);
+    } else {
+      otherCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  [[nodiscard]] std::uint64_t getCount(int code) const {
+    if (code >= 0 && static_cast<std::size_t>(code) < CODES_NUMBER) {
+      return counts_[static_cast<std::size_t>(code)].load(std::memory_order_relaxed);
+    }
+
+    return otherCount_.load(std::memory_order_relaxed);
+  }
+
+  // The codes that have occurred only
+  void collectMetrics(MetricsWriter &writer, const MetricLabels &labels = {}) const {
+    auto write = [&writer, &labels](int code, std::uint64_t count) {
+      auto codeLabels = labels;
+
+      codeLabels.emplace_back("code", std::to_string(code));
+      writer.counter("dxf_errors_total", "The errors of the C API by the code", codeLabels, static_cast<double>(count));
+    };
+
+    for (std::size_t code = 0; code < CODES_NUMBER; code++) {
+      if (auto count = counts_[code].load(std::memory_order_relaxed); count != 0) {
+        write(static_cast<int>(code), count);
+      }
+    }
+
+    if (auto count = otherCount_.load(std::memory_order_relaxed); count != 0) {
+      write(OTHER_CODE, count);
+    }
+  }
+};
+
+// The lightweight error of the C API: the code and the description of the C library (the static string of the code),
+// so it is got and passed without the allocations and is formatted only when it is printed. The checks of the return
+// codes in the loops (e.g. the bulk subscription) use it instead of Error.
+struct ErrorCode {
+  int code = -1;
+  // The static description of the C library (nullptr - there is no error)
+  dxf_const_string_t description = nullptr;
+
+  // Gets the last error of the thread and counts it (see ErrorCounters)
+  static ErrorCode getLast() {
+    ErrorCode error{};
+
+    if (dxf_get_last_error(&error.code, &error.description) != DXF_SUCCESS) {
+      return {};
+    }
+
+    ErrorCounters::getInstance().record(error.code);
+
+    return error;
+  }
+
+  [[nodiscard]] bool isError() const { return description != nullptr; }
+
+  // Formats the error to the output iterator (e.g. of fmt::memory_buffer) without the allocations
+  template <typename OutputIt>
+  OutputIt formatTo(OutputIt out) const {
+    if (!isError()) {
+      return out;
+    }
+
+    return fmt::format_to(out, "[{}] {}", code, StringConverter::wStringToUtf8View(description));
+  }
+
+  [[nodiscard]] std::string toString() const {
+    std::string result{};
+
+    formatTo(std::back_inserter(result));
+
+    return result;
+  }
+
+  // The copy of the description
+  [[nodiscard]] Error toError() const { return {code, isError() ? std::wstring{description} : std::wstring{}}; }
+
+  template <typename OutStream>
+  friend OutStream &operator<<(OutStream &os, const ErrorCode &error) {
+    fmt::memory_buffer buffer{};
+
+    error.formatTo(std::back_inserter(buffer));
+    os << std::string_view{buffer.data(), buffer.size()};
+
+    return os;
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "InlineString.hpp"
+#include "StringConverter.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The mapping of the field of the plain event (e.g. Quote::bidPrice) to the field of its C API struct
+// (dxf_quote_t::bid_price)
+template <typename Event, typename Value, typename CEvent, typename CValue>
+struct FieldMapping {
+  Value Event::*member;
+  CValue CEvent::*cMember;
+};
+
+template <typename Event, typename Value, typename CEvent, typename CValue>
+constexpr FieldMapping<Event, Value, CEvent, CValue> field(Value Event::*member, CValue CEvent::*cMember) {
+  return {member, cMember};
+}
+
+namespace detail {
+
+template <typename T>
+struct IsInlineString : std::false_type {};
+
+template <std::size_t Capacity>
+struct IsInlineString<InlineString<Capacity>> : std::true_type {};
+
+// The conversion of the C API field value: the chars and the strings are converted to UTF-8, the numbers and the enums
+// are cast
+template <typename Value, typename CValue>
+inline Value convertField(const CValue &cValue) {
+  if constexpr (std::is_same_v<Value, char> && std::is_same_v<CValue, dxf_char_t>) {
+    return StringConverter::wCharToUtf8(cValue);
+  } else if constexpr (IsInlineString<Value>::value) {
+    return Value::fromUtf16(cValue);
+  } else if constexpr (std::is_same_v<Value, std::string>) {
+    return StringConverter::wStringToUtf8(cValue);
+  } else if constexpr (std::is_same_v<Value, bool>) {
+    return cValue != 0;
+  } else {
+    return static_cast<Value>(cValue);
+  }
+}
+
+}  // namespace detail
+
+// The decoding of the C API struct to the plain event. The Event provides the eventSymbol member, the C API struct type
+// (CEventType) and the constexpr tuple of the field mappings (FIELDS), so the decoding is unrolled at the compile time
+// to the copy of every field without the calls of the setters.
+template <typename Event>
+struct EventCodec {
+  using CEventType = typename Event::CEventType;
+
+  static Event decode(std::shared_ptr<const std::string> eventSymbol, const CEventType &cEvent) {
+    Event event{};
+
+    event.eventSymbol = std::move(eventSymbol);
+    decodeFields(event, cEvent);
+
+    return event;
+  }
+
+  // Decodes to the existing event (e.g. the preallocated slot of the EventRing): the strings keep their capacity and
+  // the same shared symbol is not copied. The fields that are not mapped (e.g. the eventTime) keep their values.
+  static void decode(Event &event, const Symbol &eventSymbol, const CEventType &cEvent) {
+    if (event.eventSymbol != eventSymbol.getSharedName()) {
+      event.eventSymbol = eventSymbol.getSharedName();
+    }
+
+    decodeFields(event, cEvent);
+  }
+
+  static void decodeFields(Event &event, const CEventType &cEvent) {
+    std::apply(
+      [&event, &cEvent](const auto &...fields) {
+        ((event.*(fields.member) =
+            detail::convertField<std::remove_cvref_t<decltype(event.*(fields.member))>>(cEvent.*(fields.cMember))),
+         ...);
+      },
+      Event::FIELDS);
+  }
+
+  // The event of the interned symbol (shares its name)
+  static Event decode(const Symbol &eventSymbol, const CEventType &cEvent) {
+    return decode(eventSymbol.getSharedName(), cEvent);
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,483 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ConnectionMemory.hpp"
+#include "EventProjection.hpp"
+#include "Metrics.hpp"
+#include "MpscQueue.hpp"
+#include "RecordBufferPool.hpp"
+#include "SpscRing.hpp"
+#include "SymbolCache.hpp"
+#include "SymbolTable.hpp"
+#include "ThreadPlacement.hpp"
+#include "TraceSpans.hpp"
+#include "WaitStrategy.hpp"
+
+namespace dxf {
+
+// The counters of one shard of the EventDispatcher
+struct EventDispatcherShardStats {
+  // The batches (the listener calls) and the events queued to the shard
+  std::uint64_t batchesNumber = 0;
+  std::uint64_t eventsNumber = 0;
+  // The batches processed by the handler
+  std::uint64_t processedBatchesNumber = 0;
+  // The time spent in the handler
+  std::chrono::nanoseconds busyTime{0};
+  // The waits of the worker for the new batches
+  WaitStats wait{};
+  // The recycling of the buffers of the events of the batches
+  RecordBufferPoolStats buffers{};
+};
+
+// Moves the processing of the events of one C API type off the connection thread. The listener only copies the events
+// of the call (the batch of one symbol) to the Event objects and queues them to the shard of the symbol (by the hash of
+// the interned symbol), and the handler runs on the worker thread of the shard. So the events of one symbol are
+// handled in the order of their arrival one batch at a time, and the different symbols are handled in parallel.
+//
+// Event is the C++ event that owns its data (e.g. TimeAndSale): it is made by Event(const Symbol&, const CEvent&), so
+// the strings of the C event are copied before the listener returns. The plain CEvent (Event = CEvent) is copied as
+// is and must not be read through its string pointers. The compact struct of the consumer that declares the projection
+// of the CEvent (Event::Projection, see project) is filled from the members it needs only.
+//
+// The events of the batch (the C events, the C++ events or the projections) are copied to the buffer of the pool of its
+// shard (see RecordBufferPool) that is returned after the handler, so the steady-state dispatch doesn't allocate the
+// event buffers. The reuses and the allocations of the buffers are counted by the memory account of the connection
+// (see setMemoryAccount) and its idle bytes are the source of the account.
+//
+// The handler must not throw. The dispatcher must outlive the subscriptions it's attached to (or be detached first).
+// The listener calls of the C API that are running when the subscription is detached may still read its source, so
+// the detach (and the destructor) waits for them, and the detached source is kept (with the cleared symbol cache)
+// until the dispatcher is destroyed: the late calls of the detached listener find it detached and return.
+//
+// Usage:
+//   EventDispatcher<dxf_time_and_sale_t, TimeAndSale> dispatcher{DXF_ET_TIME_AND_SALE, 4,
+//     [](const Symbol& symbol, TimeAndSale* events, std::size_t count) { ... }};
+//
+//   dispatcher.attach(subscription);
+template <typename CEvent, typename Event = CEvent>
+class EventDispatcher final {
+  static_assert(std::constructible_from<Event, const Symbol&, const CEvent&> || std::same_as<Event, CEvent> ||
+                  ProjectedFrom<Event, CEvent>,
+                "Event must be constructible from (const Symbol&, const CEvent&) or be projected from the CEvent");
+
+ public:
+  // Called on the worker thread of the shard of the symbol. The events are owned by the dispatcher until the handler
+  // returns (they may be moved out).
+  using HandlerType = std::function<void(const Symbol& symbol, Event* events, std::size_t count)>;
+
+ private:
+  // The idle buffers of the pool of the shard (the worker that lags behind by more batches makes the dispatch allocate)
+  static constexpr std::size_t POOLED_BUFFERS_NUMBER = 256;
+
+  struct Batch {
+    Symbol symbol{};
+    std::vector<Event> events{};
+    SpanFlow flow{};
+    // The account the batch is charged to (released after the handler)
+    ConnectionMemoryAccount* memoryAccount = nullptr;
+    std::size_t chargedBytes = 0;
+  };
+
+  struct Shard {
+    MpscQueue<Batch> queue{};
+    // The buffers of the events of the batches of the shard (acquired by the dispatch, released by the worker)
+    RecordBufferPool<Event> buffers{POOLED_BUFFERS_NUMBER};
+    WorkSignal signal{};
+    // The wait of the worker for the new batches (ThreadPlacement::spin, yield and adaptiveSpin)
+    WaitStrategy waiting{};
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> batchesNumber{0};
+    std::atomic<std::uint64_t> eventsNumber{0};
+    std::atomic<std::uint64_t> processedBatchesNumber{0};
+    std::atomic<std::uint64_t> busyNanos{0};
+    std::thread worker{};
+
+    void run(const HandlerType& handler) {
+      while (true) {
+        auto seen = signal.get();
+        auto start = std::chrono::steady_clock::now();
+        auto processedNumber = queue.popAll([this, &handler](Batch& batch) {
+          SpanTracer::recordSince(SpanKind::QUEUE_WAIT, batch.flow, batch.flow.startNanos);
+
+          SpanScope span{SpanKind::HANDLER, batch.flow, batch.events.size()};
+
+          handler(batch.symbol, batch.events.data(), batch.events.size());
+
+          if (batch.memoryAccount != nullptr) {
+            batch.memoryAccount->release(batch.chargedBytes);
+          }
+
+          // The buffer isn't kept when the connection is over its memory quota
+          buffers.release(std::move(batch.events),
+                          batch.memoryAccount == nullptr || !batch.memoryAccount->isOverQuota());
+        });
+
+        if (processedNumber != 0) {
+          processedBatchesNumber.fetch_add(processedNumber, std::memory_order_release);
+          busyNanos.fetch_add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                           std::chrono::steady_clock::now() - start)
+                                                           .count()),
+                              std::memory_order_relaxed);
+
+          continue;
+        }
+
+        // The batches queued before the stop are processed
+        if (stop.load(std::memory_order_acquire) && queue.isEmpty()) {
+          return;
+        }
+
+        signal.wait(seen, waiting);
+      }
+    }
+  };
+
+  // The state of the listener of one subscription: the symbols of the connection thread are resolved by the cache
+  struct Source {
+    EventDispatcher* dispatcher = nullptr;
+    dxf_subscription_t subscription = nullptr;
+    SymbolCache symbolCache{};
+    // The running listener calls
+    std::atomic<int> inFlightNumber{0};
+    std::atomic<bool> isDetached{false};
+  };
+
+  int eventType_;
+  HandlerType handler_;
+  std::vector<std::unique_ptr<Shard>> shards_{};
+  // Guards the sources
+  std::mutex mutex_{};
+  std::vector<std::unique_ptr<Source>> sources_{};
+  // The detached sources, they are destroyed with the dispatcher
+  std::vector<std::unique_ptr<Source>> detachedSources_{};
+  std::atomic<ConnectionMemoryAccount*> memoryAccount_{nullptr};
+  // The id of the source of the pooled buffers in the memory account (guarded by the mutex)
+  std::uint64_t memorySourceId_ = 0;
+
+  Shard& getShard(const Symbol& symbol) { return *shards_[getShardIndex(symbol)]; }
+
+  // Marks the source detached and waits for its listener calls. The call that starts after the return sees the flag.
+  static void waitForListeners(Source& source) {
+    source.isDetached.store(true, std::memory_order_seq_cst);
+
+    while (source.inFlightNumber.load(std::memory_order_seq_cst) != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  static void onEvents(int eventType, dxf_const_string_t symbolName, const dxf_event_data_t* eventData, int dataCount,
+                       void* userData) {
+    auto* source = static_cast<Source*>(userData);
+
+    // Pairs with the waitForListeners: either the call is waited for or it sees the detached source
+    source->inFlightNumber.fetch_add(1, std::memory_order_seq_cst);
+
+    if (!source->isDetached.load(std::memory_order_seq_cst)) {
+      processEvents(*source, eventType, symbolName, eventData, dataCount);
+    }
+
+    source->inFlightNumber.fetch_sub(1, std::memory_order_release);
+  }
+
+  static void processEvents(Source& source, int eventType, dxf_const_string_t symbolName,
+                            const dxf_event_data_t* eventData, int dataCount) {
+    if (eventType != source.dispatcher->eventType_ || dataCount <= 0) {
+      return;
+    }
+
+    const auto& entry = source.symbolCache.get(std::wstring_view{symbolName}, [symbolName] {
+      return SymbolCache::Entry{Symbol::valueOf(std::wstring_view{symbolName}), 0};
+    });
+
+    source.dispatcher->dispatch(entry.symbol, reinterpret_cast<const CEvent*>(eventData),
+                                static_cast<std::size_t>(dataCount));
+  }
+
+ public:
+  // shardsNumber - the number of the worker threads (0 - the number of the hardware threads). placement - the placement
+  // of the workers (the failure is ignored).
+  EventDispatcher(int eventType, std::size_t shardsNumber, HandlerType handler, const ThreadPlacement& placement = {})
+      : eventType_{eventType}, handler_{std::move(handler)} {
+    if (shardsNumber == 0) {
+      shardsNumber = (std::max)(1U, std::thread::hardware_concurrency());
+    }
+
+    for (std::size_t i = 0; i < shardsNumber; i++) {
+      auto shard = std::make_unique<Shard>();
+
+      shard->waiting.configure(placement);
+      shard->worker = std::thread([this, s = shard.get(), placement] {
+        ThreadPlacement::setCurrentThreadName("dxf-dispatcher");
+        placement.applyToCurrentThread();
+        s->run(handler_);
+      });
+      shards_.push_back(std::move(shard));
+    }
+  }
+
+  EventDispatcher(const EventDispatcher&) = delete;
+  EventDispatcher& operator=(const EventDispatcher&) = delete;
+
+  // Detaches the listeners and waits for their running calls, then handles the queued batches and stops the workers
+  ~EventDispatcher() {
+    setMemoryAccount(nullptr);
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+
+      for (const auto& source : sources_) {
+        dxf_detach_event_listener(source->subscription, &EventDispatcher::onEvents);
+      }
+    }
+
+    // The running calls dispatch to the shards, so the workers are stopped after them
+    for (const auto& source : sources_) {
+      waitForListeners(*source);
+    }
+
+    for (auto& shard : shards_) {
+      shard->stop.store(true, std::memory_order_release);
+      shard->signal.notify();
+      shard->worker.join();
+    }
+  }
+
+  // Attaches the listener to the subscription (one dispatcher of the same types per subscription: the C API detaches
+  // the listener by the function). Returns false if the C API fails.
+  bool attach(dxf_subscription_t subscription) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto source = std::make_unique<Source>();
+
+    source->dispatcher = this;
+    source->subscription = subscription;
+
+    if (dxf_attach_event_listener(subscription, &EventDispatcher::onEvents, static_cast<void*>(source.get())) ==
+        DXF_FAILURE) {
+      return false;
+    }
+
+    sources_.push_back(std::move(source));
+
+    return true;
+  }
+
+  // Detaches the listener from the subscription and waits for its running calls (the queued batches are still
+  // handled). Returns false if the dispatcher is not attached to it.
+  bool detach(dxf_subscription_t subscription) {
+    std::unique_ptr<Source> detached{};
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      auto found = std::find_if(sources_.begin(), sources_.end(),
+                                [subscription](const auto& source) { return source->subscription == subscription; });
+
+      if (found == sources_.end()) {
+        return false;
+      }
+
+      dxf_detach_event_listener(subscription, &EventDispatcher::onEvents);
+      detached = std::move(*found);
+      sources_.erase(found);
+    }
+
+    // Outside the lock, so the attaches and the detaches of the other subscriptions don't wait
+    waitForListeners(*detached);
+    detached->symbolCache.clear();
+
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    detachedSources_.push_back(std::move(detached));
+
+    return true;
+  }
+
+  // Charges the queued batches (the sizes of their events) to the memory account of the connection and applies its
+  // quota: DROP - the new batches are dropped (counted by the account, see ConnectionMemoryAccount::getStats). The idle
+  // buffers of the pools are the source of the account, and the buffers aren't pooled while it's over the quota.
+  // nullptr - no account. The account must outlive the dispatcher (or be replaced first).
+  void setMemoryAccount(ConnectionMemoryAccount* account) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto* oldAccount = memoryAccount_.load(std::memory_order_relaxed);
+
+    if (oldAccount == account) {
+      return;
+    }
+
+    if (oldAccount != nullptr) {
+      oldAccount->removeSource(memorySourceId_);
+      memorySourceId_ = 0;
+    }
+
+    if (account != nullptr) {
+      memorySourceId_ = account->addSource([this] { return getPooledBytes(); });
+    }
+
+    memoryAccount_.store(account, std::memory_order_release);
+  }
+
+  // Copies the events of the symbol and queues them to its shard (e.g. the events of the other listener or the replay).
+  // The events of one symbol must be dispatched by one thread at a time to keep their order.
+  void dispatch(const Symbol& symbol, const CEvent* cEvents, std::size_t count) {
+    if (count == 0) {
+      return;
+    }
+
+    auto* memoryAccount = memoryAccount_.load(std::memory_order_acquire);
+
+    if (memoryAccount != nullptr && memoryAccount->isDegraded(MemoryQuotaAction::DROP)) {
+      memoryAccount->recordDroppedEvents(count);
+
+      return;
+    }
+
+    auto& shard = getShard(symbol);
+    auto isReused = false;
+    Batch batch{symbol, shard.buffers.acquire(count, isReused), SpanTracer::sample()};
+    SpanScope span{SpanKind::DISPATCH, batch.flow, count};
+
+    for (std::size_t i = 0; i < count; i++) {
+      if constexpr (std::same_as<Event, CEvent>) {
+        batch.events.push_back(cEvents[i]);
+      } else if constexpr (ProjectedFrom<Event, CEvent>) {
+        batch.events.push_back(Event::Projection::template to<Event>(cEvents[i]));
+      } else {
+        batch.events.emplace_back(symbol, cEvents[i]);
+      }
+    }
+
+    if (memoryAccount != nullptr) {
+      batch.memoryAccount = memoryAccount;
+      batch.chargedBytes = sizeof(Batch) + batch.events.capacity() * sizeof(Event);
+      memoryAccount->charge(batch.chargedBytes);
+      memoryAccount->recordBuffer(isReused);
+    }
+
+    shard.batchesNumber.fetch_add(1, std::memory_order_relaxed);
+    shard.eventsNumber.fetch_add(count, std::memory_order_relaxed);
+    batch.flow = SpanTracer::handOver(batch.flow);
+
+    // The worker that found the queue empty is woken up, the one that has the batches to process will take this one too
+    if (shard.queue.push(std::move(batch))) {
+      shard.signal.notify();
+    }
+  }
+
+  [[nodiscard]] std::size_t getShardsNumber() const { return shards_.size(); }
+
+  // The shard of the symbol: all its batches are handled by the worker of the shard
+  [[nodiscard]] std::size_t getShardIndex(const Symbol& symbol) const { return symbol.getHash() % shards_.size(); }
+
+  // Waits until the batches dispatched before the call are handled
+  void flush() const {
+    for (const auto& shard : shards_) {
+      auto batchesNumber = shard->batchesNumber.load(std::memory_order_relaxed);
+
+      while (shard->processedBatchesNumber.load(std::memory_order_acquire) < batchesNumber) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // The capacity of the idle buffers of the pools of the shards in bytes
+  [[nodiscard]] std::size_t getPooledBytes() const {
+    std::size_t result = 0;
+
+    for (const auto& shard : shards_) {
+      result += shard->buffers.getPooledBytes();
+    }
+
+    return result;
+  }
+
+  [[nodiscard]] std::vector<EventDispatcherShardStats> getStats() const {
+    std::vector<EventDispatcherShardStats> result{};
+
+    result.reserve(shards_.size());
+
+    for (const auto& shard : shards_) {
+      result.push_back({shard->batchesNumber.load(std::memory_order_relaxed),
+                        shard->eventsNumber.load(std::memory_order_relaxed),
+                        shard->processedBatchesNumber.load(std::memory_order_relaxed),
+                        std::chrono::nanoseconds{shard->busyNanos.load(std::memory_order_relaxed)},
+                        shard->waiting.getStats(),
+                        shard->buffers.getStats()});
+    }
+
+    return result;
+  }
+
+  // Writes the counters of the shards as the dxf_dispatcher_* metrics labeled by the shard index and the labels (e.g.
+  // the event type). Can be called from any thread (see MetricsRegistry::addCollector).
+  void collectMetrics(MetricsWriter& writer, const MetricLabels& labels = {}) const {
+    auto stats = getStats();
+
+    for (std::size_t i = 0; i < stats.size(); i++) {
+      auto shardLabels = labels;
+      // The counters are read one by one, so the processed batches may outrun the queued ones
+      auto pendingNumber = stats[i].batchesNumber > stats[i].processedBatchesNumber
+                             ? stats[i].batchesNumber - stats[i].processedBatchesNumber
+                             : 0;
+
+      shardLabels.emplace_back("shard", std::to_string(i));
+      writer.counter("dxf_dispatcher_batches_total", "The batches queued to the shard", shardLabels,
+                     static_cast<double>(stats[i].batchesNumber));
+      writer.counter("dxf_dispatcher_events_total", "The events queued to the shard", shardLabels,
+                     static_cast<double>(stats[i].eventsNumber));
+      writer.gauge("dxf_dispatcher_queue_depth", "The batches of the shard that are not handled yet", shardLabels,
+                   static_cast<double>(pendingNumber));
+      writer.counter("dxf_dispatcher_busy_seconds_total", "The time spent in the handler of the shard", shardLabels,
+                     std::chrono::duration<double>(stats[i].busyTime).count());
+
+      const auto& buffers = stats[i].buffers;
+
+      writer.counter("dxf_dispatcher_buffers_reused_total", "The event buffers of the shard taken from the pool",
+                     shardLabels, static_cast<double>(buffers.reusedNumber));
+      writer.counter("dxf_dispatcher_buffers_allocated_total", "The event buffers of the shard allocated",
+                     shardLabels, static_cast<double>(buffers.allocatedNumber));
+      writer.counter("dxf_dispatcher_buffers_discarded_total", "The released event buffers of the shard freed",
+                     shardLabels, static_cast<double>(buffers.discardedNumber));
+      writer.gauge("dxf_dispatcher_buffers_pooled", "The idle event buffers of the pool of the shard", shardLabels,
+                   static_cast<double>(buffers.pooledNumber));
+      writer.gauge("dxf_dispatcher_buffers_pooled_bytes", "The capacity of the idle event buffers of the shard",
+                   shardLabels, static_cast<double>(buffers.pooledBytes));
+      writer.gauge("dxf_dispatcher_buffer_capacity", "The capacity of the new event buffers of the shard (events)",
+                   shardLabels, static_cast<double>(buffers.capacity));
+
+      const auto& wait = stats[i].wait;
+
+      for (const auto& [phase, time, wakeupsNumber] :
+           {std::tuple{"spin", wait.spinTime, wait.spinWakeupsNumber},
+            std::tuple{"yield", wait.yieldTime, wait.yieldWakeupsNumber},
+            std::tuple{"park", wait.parkTime, wait.parksNumber}}) {
+        auto phaseLabels = shardLabels;
+
+        phaseLabels.emplace_back("phase", phase);
+        writer.counter("dxf_dispatcher_wait_seconds_total", "The time the worker of the shard waited in the phase",
+                       phaseLabels, std::chrono::duration<double>(time).count());
+        writer.counter("dxf_dispatcher_wakeups_total", "The waits of the worker of the shard ended in the phase",
+                       phaseLabels, static_cast<double>(wakeupsNumber));
+      }
+    }
+  }
+};
+
+}  // namespace dxf
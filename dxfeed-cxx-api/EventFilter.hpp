@@ -0,0 +1,451 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "CpuFeatures.hpp"
+
+namespace dxf {
+
+// The predicate on the raw fields of the C API events (CEvent - the C struct, e.g. dxf_time_and_sale_t) that is
+// evaluated on the listener thread before the events are converted, so the rejected events are never wrapped or
+// copied. The filter is the conjunction of the simple conditions on the fields:
+//
+//   EventFilter<dxf_time_and_sale_t> filter{};
+//
+//   filter.whereIn(&dxf_time_and_sale_t::scope, {dxf_osc_order})
+//     .whereBits(&dxf_time_and_sale_t::raw_flags, 0x4, 0x4)  // the valid tick
+//     .whereBetween(&dxf_time_and_sale_t::price, 100.0, 200.0);
+//
+// The events are evaluated by the blocks of 64: every condition is evaluated over the block into the bit mask (one
+// condition at a time, so the field is read with the stride of the struct by the AVX2 gathers, 4 doubles or 8 32-bit
+// fields at once, if the CPU supports it, or compared by 2 or 4 NEON lanes on AArch64), and the masks are combined. The
+// consecutive accepted events are passed on as the runs of the original array (see forEachRun), without the copying.
+//
+// The compile-time predicates (any callable on the const CEvent&) are inlined into the loop instead (see
+// filterBatches with the predicate).
+template <typename CEvent>
+class EventFilter final {
+ public:
+  static constexpr std::size_t BLOCK_SIZE = 64;
+
+ private:
+  enum class FieldType : int { DOUBLE, INT16, INT32, INT64 };
+
+  enum class Test : int {
+    // min <= value <= max (the NaN is rejected)
+    BETWEEN,
+    // value is one of the values
+    IN,
+    // (value & mask) == bits
+    BITS
+  };
+
+  struct Condition {
+    FieldType fieldType = FieldType::INT32;
+    Test test = Test::IN;
+    std::size_t offset = 0;
+    double min = 0.0;
+    double max = 0.0;
+    std::int64_t mask = 0;
+    std::int64_t bits = 0;
+    std::vector<std::int64_t> values{};
+  };
+
+  std::vector<Condition> conditions_{};
+
+  template <typename T>
+  static constexpr FieldType getFieldType() {
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "The field must be the number, the char or the enum");
+
+    if constexpr (std::is_floating_point_v<T>) {
+      static_assert(sizeof(T) == 8, "The floating point field must be double");
+
+      return FieldType::DOUBLE;
+    } else if constexpr (sizeof(T) == 8) {
+      return FieldType::INT64;
+    } else if constexpr (sizeof(T) == 4) {
+      return FieldType::INT32;
+    } else {
+      static_assert(sizeof(T) == 2, "The integer field must be 16, 32 or 64-bit");
+
+      return FieldType::INT16;
+    }
+  }
+
+  template <typename T>
+  static std::size_t getOffset(T CEvent::*field) {
+    static const CEvent probe{};
+
+    return static_cast<std::size_t>(reinterpret_cast<const char *>(&(probe.*field)) -
+                                    reinterpret_cast<const char *>(&probe));
+  }
+
+  static const char *getField(const CEvent *event, std::size_t offset) {
+    return reinterpret_cast<const char *>(event) + offset;
+  }
+
+  static std::int64_t readInteger(const CEvent &event, const Condition &condition) {
+    auto field = getField(&event, condition.offset);
+
+    switch (condition.fieldType) {
+      case FieldType::INT16: {
+        std::uint16_t value = 0;
+
+        std::memcpy(&value, field, sizeof(value));
+
+        return value;
+      }
+      case FieldType::INT32: {
+        std::int32_t value = 0;
+
+        std::memcpy(&value, field, sizeof(value));
+
+        return value;
+      }
+      default: {
+        std::int64_t value = 0;
+
+        std::memcpy(&value, field, sizeof(value));
+
+        return value;
+      }
+    }
+  }
+
+  static bool testScalar(const CEvent &event, const Condition &condition) {
+    if (condition.fieldType == FieldType::DOUBLE) {
+      double value = 0.0;
+
+      std::memcpy(&value, getField(&event, condition.offset), sizeof(value));
+
+      return value >= condition.min && value <= condition.max;
+    }
+
+    auto value = readInteger(event, condition);
+
+    switch (condition.test) {
+      case Test::BETWEEN:
+        return static_cast<double>(value) >= condition.min && static_cast<double>(value) <= condition.max;
+      case Test::IN:
+        return std::find(condition.values.begin(), condition.values.end(), value) != condition.values.end();
+      default:
+        return (value & condition.mask) == condition.bits;
+    }
+  }
+
+  static std::uint64_t selectScalar(const CEvent *events, std::size_t count, const Condition &condition) {
+    std::uint64_t result = 0;
+
+    for (std::size_t i = 0; i < count; i++) {
+      result |= static_cast<std::uint64_t>(testScalar(events[i], condition)) << i;
+    }
+
+    return result;
+  }
+
+#ifdef DXFCXX_CPU_X86
+  static constexpr int STRIDE = static_cast<int>(sizeof(CEvent));
+
+  // The doubles of the range, 4 events at a time
+  DXFCXX_TARGET_AVX2 static std::uint64_t selectDoublesAvx2(const CEvent *events, std::size_t count,
+                                                            const Condition &condition) {
+    const auto offsets = _mm_setr_epi32(0, STRIDE, 2 * STRIDE, 3 * STRIDE);
+    const auto min = _mm256_set1_pd(condition.min);
+    const auto max = _mm256_set1_pd(condition.max);
+    std::uint64_t result = 0;
+    std::size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+      auto values = _mm256_i32gather_pd(reinterpret_cast<const double *>(getField(events + i, condition.offset)),
+                                        offsets, 1);
+      auto isAccepted = _mm256_and_pd(_mm256_cmp_pd(values, min, _CMP_GE_OQ), _mm256_cmp_pd(values, max, _CMP_LE_OQ));
+
+      result |= static_cast<std::uint64_t>(_mm256_movemask_pd(isAccepted)) << i;
+    }
+
+    return i == count ? result : result | (selectScalar(events + i, count - i, condition) << i);
+  }
+
+  // The 32-bit values of the set or of the bits, 8 events at a time
+  DXFCXX_TARGET_AVX2 static std::uint64_t selectIntsAvx2(const CEvent *events, std::size_t count,
+                                                         const Condition &condition) {
+    const auto offsets =
+      _mm256_setr_epi32(0, STRIDE, 2 * STRIDE, 3 * STRIDE, 4 * STRIDE, 5 * STRIDE, 6 * STRIDE, 7 * STRIDE);
+    const auto mask = _mm256_set1_epi32(static_cast<std::int32_t>(condition.mask));
+    const auto bits = _mm256_set1_epi32(static_cast<std::int32_t>(condition.bits));
+    std::uint64_t result = 0;
+    std::size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+      auto values =
+        _mm256_i32gather_epi32(reinterpret_cast<const int *>(getField(events + i, condition.offset)), offsets, 1);
+      auto isAccepted = _mm256_setzero_si256();
+
+      if (condition.test == Test::BITS) {
+        isAccepted = _mm256_cmpeq_epi32(_mm256_and_si256(values, mask), bits);
+      } else {
+        for (auto value : condition.values) {
+          isAccepted = _mm256_or_si256(isAccepted,
+                                       _mm256_cmpeq_epi32(values, _mm256_set1_epi32(static_cast<std::int32_t>(value))));
+        }
+      }
+
+      result |= static_cast<std::uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(isAccepted))) << i;
+    }
+
+    return i == count ? result : result | (selectScalar(events + i, count - i, condition) << i);
+  }
+#elif defined(DXFCXX_CPU_NEON)
+  // NEON has no gathers: the fields of the events are loaded into the lanes one by one and compared at once
+
+  // The doubles of the range, 4 events at a time
+  static std::uint64_t selectDoublesNeon(const CEvent *events, std::size_t count, const Condition &condition) {
+    const auto min = vdupq_n_f64(condition.min);
+    const auto max = vdupq_n_f64(condition.max);
+    std::uint64_t result = 0;
+    std::size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+      double values[4]{};
+
+      for (std::size_t j = 0; j < 4; j++) {
+        std::memcpy(&values[j], getField(events + i + j, condition.offset), sizeof(double));
+      }
+
+      for (std::size_t j = 0; j < 4; j += 2) {
+        auto pair = vld1q_f64(values + j);
+        auto isAccepted = vandq_u64(vcgeq_f64(pair, min), vcleq_f64(pair, max));
+
+        result |= static_cast<std::uint64_t>(detail::movemaskNeon(isAccepted)) << (i + j);
+      }
+    }
+
+    return i == count ? result : result | (selectScalar(events + i, count - i, condition) << i);
+  }
+
+  // The 32-bit values of the set or of the bits, 4 events at a time
+  static std::uint64_t selectIntsNeon(const CEvent *events, std::size_t count, const Condition &condition) {
+    const auto mask = vdupq_n_u32(static_cast<std::uint32_t>(condition.mask));
+    const auto bits = vdupq_n_u32(static_cast<std::uint32_t>(condition.bits));
+    std::uint64_t result = 0;
+    std::size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+      std::uint32_t lanes[4]{};
+
+      for (std::size_t j = 0; j < 4; j++) {
+        std::memcpy(&lanes[j], getField(events + i + j, condition.offset), sizeof(std::uint32_t));
+      }
+
+      auto values = vld1q_u32(lanes);
+      auto isAccepted = vdupq_n_u32(0);
+
+      if (condition.test == Test::BITS) {
+        isAccepted = vceqq_u32(vandq_u32(values, mask), bits);
+      } else {
+        for (auto value : condition.values) {
+          isAccepted = vorrq_u32(isAccepted, vceqq_u32(values, vdupq_n_u32(static_cast<std::uint32_t>(value))));
+        }
+      }
+
+      result |= static_cast<std::uint64_t>(detail::movemaskNeon(isAccepted)) << i;
+    }
+
+    return i == count ? result : result | (selectScalar(events + i, count - i, condition) << i);
+  }
+#endif
+
+  static std::uint64_t select(const CEvent *events, std::size_t count, const Condition &condition) {
+#ifdef DXFCXX_CPU_X86
+    static const bool hasAvx2 = CpuFeatures::hasAvx2();
+
+    if (hasAvx2 && condition.fieldType == FieldType::DOUBLE) {
+      return selectDoublesAvx2(events, count, condition);
+    }
+
+    // The values of the set are the 32-bit ones (the wider ones are never equal to the field)
+    if (hasAvx2 && condition.fieldType == FieldType::INT32 && condition.test != Test::BETWEEN) {
+      return selectIntsAvx2(events, count, condition);
+    }
+#elif defined(DXFCXX_CPU_NEON)
+    if (condition.fieldType == FieldType::DOUBLE) {
+      return selectDoublesNeon(events, count, condition);
+    }
+
+    if (condition.fieldType == FieldType::INT32 && condition.test != Test::BETWEEN) {
+      return selectIntsNeon(events, count, condition);
+    }
+#endif
+
+    return selectScalar(events, count, condition);
+  }
+
+  // Calls the onRun(first, count) for the runs of the consecutive events of the bits of the selectBlock(first, count)
+  // masks of the blocks. The run that continues in the next block is passed once.
+  template <typename SelectBlock, typename OnRun>
+  static void forEachSelectedRun(const CEvent *events, std::size_t count, SelectBlock &&selectBlock, OnRun &&onRun) {
+    std::size_t runBegin = 0;
+    std::size_t runSize = 0;
+
+    for (std::size_t block = 0; block < count; block += BLOCK_SIZE) {
+      auto blockSize = (std::min)(BLOCK_SIZE, count - block);
+
+      for (std::uint64_t mask = selectBlock(events + block, blockSize); mask != 0;) {
+        auto first = static_cast<std::size_t>(std::countr_zero(mask));
+        auto size = static_cast<std::size_t>(std::countr_one(mask >> first));
+
+        if (runSize != 0 && runBegin + runSize == block + first) {
+          runSize += size;
+        } else {
+          if (runSize != 0) {
+            onRun(events + runBegin, runSize);
+          }
+
+          runBegin = block + first;
+          runSize = size;
+        }
+
+        mask = first + size >= BLOCK_SIZE ? 0 : mask & ~((std::uint64_t{1} << (first + size)) - 1);
+      }
+    }
+
+    if (runSize != 0) {
+      onRun(events + runBegin, runSize);
+    }
+  }
+
+  template <typename T>
+  Condition &addCondition(T CEvent::*field, Test test) {
+    auto &condition = conditions_.emplace_back();
+
+    condition.fieldType = getFieldType<T>();
+    condition.test = test;
+    condition.offset = getOffset(field);
+
+    return condition;
+  }
+
+ public:
+  // The empty filter accepts all events
+  [[nodiscard]] bool isEmpty() const { return conditions_.empty(); }
+
+  // Accepts the events with min <= field <= max (e.g. the price band; the NaN price is rejected)
+  template <typename T>
+  EventFilter &whereBetween(T CEvent::*field, double min, double max) {
+    auto &condition = addCondition(field, Test::BETWEEN);
+
+    condition.min = min;
+    condition.max = max;
+
+    return *this;
+  }
+
+  // Accepts the events with the field (the integer, the char or the enum, e.g. the scope or the exchange code) equal
+  // to one of the values
+  template <typename T>
+  EventFilter &whereIn(T CEvent::*field, std::initializer_list<T> values) {
+    auto &condition = addCondition(field, Test::IN);
+
+    for (auto value : values) {
+      condition.values.push_back(static_cast<std::int64_t>(value));
+    }
+
+    return *this;
+  }
+
+  // Accepts the events with the (field & mask) == bits (e.g. the flags of the raw_flags)
+  template <typename T>
+  EventFilter &whereBits(T CEvent::*field, std::int64_t mask, std::int64_t bits) {
+    static_assert(std::is_integral_v<T>, "The field of the bits must be the integer");
+
+    auto &condition = addCondition(field, Test::BITS);
+
+    condition.mask = mask;
+    condition.bits = bits & mask;
+
+    return *this;
+  }
+
+  // Returns true if the event is accepted
+  [[nodiscard]] bool accepts(const CEvent &event) const {
+    return std::all_of(conditions_.begin(), conditions_.end(),
+                       [&event](const Condition &condition) { return testScalar(event, condition); });
+  }
+
+  // Returns the bit mask of the accepted events of the block (count <= BLOCK_SIZE)
+  [[nodiscard]] std::uint64_t selectBlock(const CEvent *events, std::size_t count) const {
+    auto result = count == BLOCK_SIZE ? ~std::uint64_t{0} : (std::uint64_t{1} << count) - 1;
+
+    for (const auto &condition : conditions_) {
+      if (result == 0) {
+        break;
+      }
+
+      result &= select(events, count, condition);
+    }
+
+    return result;
+  }
+
+  // Calls the onRun(const CEvent *first, std::size_t count) for the runs of the consecutive accepted events
+  template <typename OnRun>
+  void forEachRun(const CEvent *events, std::size_t count, OnRun &&onRun) const {
+    if (conditions_.empty()) {
+      if (count != 0) {
+        onRun(events, count);
+      }
+
+      return;
+    }
+
+    forEachSelectedRun(
+      events, count, [this](const CEvent *block, std::size_t size) { return selectBlock(block, size); }, onRun);
+  }
+
+  // The same as forEachRun with the compile-time predicate (the callable on the const CEvent &)
+  template <typename Predicate, typename OnRun>
+  static void forEachRun(Predicate &&predicate, const CEvent *events, std::size_t count, OnRun &&onRun) {
+    forEachSelectedRun(
+      events, count,
+      [&predicate](const CEvent *block, std::size_t size) {
+        std::uint64_t result = 0;
+
+        for (std::size_t i = 0; i < size; i++) {
+          result |= static_cast<std::uint64_t>(static_cast<bool>(predicate(block[i]))) << i;
+        }
+
+        return result;
+      },
+      onRun);
+  }
+
+  // Wraps the batch sink (see EventReceiver::BatchSinkType) into the one that passes the runs of the accepted events
+  // only (the sink is not called for the batch without them)
+  template <typename BatchSink>
+  auto filterBatches(BatchSink sink) const {
+    return [filter = *this, sink = std::move(sink)](std::size_t symbolIndex, const auto &symbol, const CEvent *events,
+                                                    std::size_t count) {
+      filter.forEachRun(events, count, [&](const CEvent *run, std::size_t size) { sink(symbolIndex, symbol, run, size); });
+    };
+  }
+
+  // The same as filterBatches with the compile-time predicate
+  template <typename Predicate, typename BatchSink>
+  static auto filterBatches(Predicate predicate, BatchSink sink) {
+    return [predicate = std::move(predicate), sink = std::move(sink)](std::size_t symbolIndex, const auto &symbol,
+                                                                      const CEvent *events, std::size_t count) {
+      forEachRun(predicate, events, count,
+                 [&](const CEvent *run, std::size_t size) { sink(symbolIndex, symbol, run, size); });
+    };
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace dxf {
+
+// The class and the type of the member of the pointer to the data member
+template <typename MemberPointer>
+struct MemberPointerTraits;
+
+template <typename Class, typename Member>
+struct MemberPointerTraits<Member Class::*> {
+  using ClassType = Class;
+  using MemberType = Member;
+};
+
+// The compile-time projection of the members of the C event (e.g. dxf_time_and_sale_t) to the compact struct of the
+// consumer that needs only a few fields: the fields of the target are initialized by the members in their order (the
+// aggregate initialization, so the narrowing conversions don't compile), without the TimeAndSale object, the strings
+// and the virtual interfaces. So the memory per event and the conversion cost are what the consumer uses.
+//
+// The pointer members (the strings of the C event) are valid only during the listener call, so they aren't projected.
+//
+// Usage:
+//   struct LastTrade {
+//     double price;
+//     double size;
+//     dxf_long_t time;
+//
+//     using Projection = project<&dxf_time_and_sale_t::price, &dxf_time_and_sale_t::size, &dxf_time_and_sale_t::time>;
+//   };
+//
+//   auto trade = LastTrade::Projection::to<LastTrade>(tns);
+//
+//   EventDispatcher<dxf_time_and_sale_t, LastTrade> dispatcher{...};  // The batches of the LastTrade
+//   SimpleTimeAndSaleDataProvider::runProjected<LastTrade>(address, symbols);
+template <auto First, auto... Rest>
+struct project {
+  using SourceType = typename MemberPointerTraits<decltype(First)>::ClassType;
+  // The default target: the values of the members in their order
+  using Fields = std::tuple<typename MemberPointerTraits<decltype(First)>::MemberType,
+                            typename MemberPointerTraits<decltype(Rest)>::MemberType...>;
+
+  static_assert(std::is_member_object_pointer_v<decltype(First)> &&
+                  (std::is_member_object_pointer_v<decltype(Rest)> && ...),
+                "The projection maps the data members");
+  static_assert((std::same_as<SourceType, typename MemberPointerTraits<decltype(Rest)>::ClassType> && ...),
+                "The members of the projection belong to one event type");
+  static_assert(!std::is_pointer_v<typename MemberPointerTraits<decltype(First)>::MemberType> &&
+                  (!std::is_pointer_v<typename MemberPointerTraits<decltype(Rest)>::MemberType> && ...),
+                "The pointer members are valid only during the listener call");
+
+  static constexpr std::size_t SIZE = 1 + sizeof...(Rest);
+
+  template <typename Target = Fields>
+  [[nodiscard]] static constexpr Target to(const SourceType& event) {
+    return Target{event.*First, event.*Rest...};
+  }
+
+  // Projects the array of the events (e.g. of the listener call) to the result (count elements)
+  template <typename Target = Fields>
+  static void to(const SourceType* events, std::size_t count, Target* result) {
+    for (std::size_t i = 0; i < count; i++) {
+      result[i] = to<Target>(events[i]);
+    }
+  }
+
+  // Appends the projections of the array of the events to the result
+  template <typename Target = Fields>
+  static void append(const SourceType* events, std::size_t count, std::vector<Target>& result) {
+    result.reserve(result.size() + count);
+
+    for (std::size_t i = 0; i < count; i++) {
+      result.push_back(to<Target>(events[i]));
+    }
+  }
+};
+
+// The Event declares the projection of the members of the CEvent (the Event::Projection, see project)
+template <typename Event, typename CEvent>
+concept ProjectedFrom = requires { typename Event::Projection::SourceType; } &&
+                        std::same_as<typename Event::Projection::SourceType, CEvent> &&
+                        requires(const CEvent& event) {
+                          { Event::Projection::template to<Event>(event) } -> std::same_as<Event>;
+                        };
+
+}  // namespace dxf
@@ -0,0 +1,676 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "AsyncLog.hpp"
+#include "Clock.hpp"
+#include "ConnectionPool.hpp"
+#include "Error.hpp"
+#include "EventFilter.hpp"
+#include "Executor.hpp"
+#include "SmallVector.hpp"
+#include "SymbolCache.hpp"
+#include "SymbolIndex.hpp"
+#include "SymbolSubscription.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The receiving of the C API events of one type (or several types of one subscription) that is shared by the data
+// providers (see SimpleTimeAndSaleDataProvider, HistoryDataProvider)
+struct EventReceiver {
+  // The early completion of the fetch: the requested symbol is caught up when its snapshot is delivered (the event
+  // with the SNAPSHOT_END or SNAPSHOT_SNIP flag) or the event time is within the liveLag of the current time. The
+  // symbol of the event type without the event flags (e.g. Quote, Summary) is caught up on its first event. The fetch
+  // is completed as soon as all requested symbols are caught up, the timeout is only the upper bound.
+  struct HistoryCompletion {
+    // 0 - only the snapshot flags are used
+    std::chrono::milliseconds liveLag{0};
+    // Called once per requested symbol when it is caught up (on the connection thread)
+    std::function<void(const std::string &symbol)> onSymbolCompleted{};
+    // Called once per requested symbol on its first event (on the connection thread), before its onSymbolCompleted
+    std::function<void(const std::string &symbol)> onSymbolFirstEvent{};
+  };
+
+  // The position of the event symbol that is not one of the requested symbols
+  static constexpr std::size_t UNKNOWN_SYMBOL = SymbolIndex::NOT_FOUND;
+
+  // symbolIndex - the position of the event symbol in the requested symbols (or UNKNOWN_SYMBOL), symbol - the interned
+  // event symbol (its shared name is kept by the events)
+  template <typename CEvent>
+  using SinkType = std::function<void(std::size_t symbolIndex, const Symbol &symbol,
+                                      const CEvent &cEvent)>;
+
+  // The receiver of the arrays of the events of one symbol (the listener data), e.g. for the batch conversion
+  template <typename CEvent>
+  using BatchSinkType = std::function<void(std::size_t symbolIndex, const Symbol &symbol,
+                                           const CEvent *cEvents, std::size_t count)>;
+
+  // The stop of the receives of one fetch (e.g. the endpoints of runMerged)
+  class StopSignal final {
+    std::mutex mutex_{};
+    // The receives of one fetch are few (e.g. the endpoints), so they are kept in place
+    SmallVector<const ConnectionPool::Lease *, 4> leases_{};
+    std::atomic<bool> isStopped_{false};
+
+   public:
+    void add(const ConnectionPool::Lease *lease) {
+      std::lock_guard guard(mutex_);
+
+      leases_.push_back(lease);
+    }
+
+    void remove(const ConnectionPool::Lease *lease) {
+      std::lock_guard guard(mutex_);
+
+      leases_.eraseIf([lease](const ConnectionPool::Lease *l) { return l == lease; });
+    }
+
+    [[nodiscard]] bool isStopped() const { return isStopped_.load(); }
+
+    // Wakes up the receives, so they return
+    void stop() {
+      isStopped_ = true;
+
+      std::lock_guard guard(mutex_);
+
+      for (const auto *lease : leases_) {
+        lease->notify();
+      }
+    }
+  };
+
+  // The state of the event listener of one receive: the interned requested symbols, the sink and the completion of the
+  // symbols
+  template <typename CEvent>
+  class Listener final {
+    int eventType_ = 0;
+    // The interned requested symbols, so the events share them
+    std::vector<Symbol> symbols_{};
+    const BatchSinkType<CEvent> *sink_ = nullptr;
+    // The positions of the requested symbols, so the event symbol is found without the conversion and the lock
+    SymbolIndex requestedSymbols_{};
+    // The resolved event symbols by their wide names, so the repeated symbols are not hashed by the code points and
+    // the unknown ones are not interned again (used on the connection thread only)
+    SymbolCache symbolCache_{};
+    const HistoryCompletion *completion_ = nullptr;
+    // The flags of the caught up symbols (used on the connection thread only)
+    std::vector<bool> completed_{};
+    // The flags of the symbols that have received the events (used on the connection thread only)
+    std::vector<bool> received_{};
+    std::atomic<std::size_t> remainingSymbolsNumber_{0};
+    // Called once when all symbols are caught up (on the connection thread)
+    std::function<void()> onCompleted_{};
+    // The metrics of the connection the listener records its calls to
+    ConnectionMetrics *metrics_ = nullptr;
+    // The events that are passed to the sink (the completion and the metrics see all events)
+    EventFilter<CEvent> filter_{};
+
+    void checkCompletion(std::size_t symbolIndex, const CEvent &cEvent) {
+      if (completed_[symbolIndex]) {
+        return;
+      }
+
+      if (!received_[symbolIndex]) {
+        received_[symbolIndex] = true;
+
+        if (completion_->onSymbolFirstEvent) {
+          completion_->onSymbolFirstEvent(symbols_[symbolIndex].getName());
+        }
+      }
+
+      auto isCaughtUp = true;
+
+      if constexpr (requires { cEvent.event_flags; }) {
+        isCaughtUp = (cEvent.event_flags & (dxf_ef_snapshot_end | dxf_ef_snapshot_snip)) != 0;
+
+        if constexpr (requires { cEvent.time; }) {
+          if (!isCaughtUp && completion_->liveLag.count() > 0) {
+            auto now = Clock::getDefault().currentTimeMillis();
+
+            isCaughtUp = static_cast<std::int64_t>(cEvent.time) >= now - completion_->liveLag.count();
+          }
+        }
+      }
+
+      if (!isCaughtUp) {
+        return;
+      }
+
+      completed_[symbolIndex] = true;
+      logEvent(LogEvent::SYMBOL_COMPLETED, eventType_, symbols_[symbolIndex].getId());
+
+      if (completion_->onSymbolCompleted) {
+        completion_->onSymbolCompleted(symbols_[symbolIndex].getName());
+      }
+
+      if (remainingSymbolsNumber_.fetch_sub(1) == 1 && onCompleted_) {
+        onCompleted_();
+      }
+    }
+
+   public:
+    // The C API listener of the subscription (userData - the listener). The events of the other types are ignored.
+    static void onEvents(int eventType, dxf_const_string_t symbolName, const dxf_event_data_t *eventData,
+                         int dataCount, void *userData) {
+      auto *listener = static_cast<Listener *>(userData);
+
+      if (eventType != listener->eventType_) {
+        return;
+      }
+
+      const auto *cEvents = reinterpret_cast<const CEvent *>(eventData);
+      const auto &entry = listener->symbolCache_.get(std::wstring_view{symbolName}, [listener, symbolName] {
+        auto symbolIndex = listener->requestedSymbols_.find(std::wstring_view{symbolName});
+
+        return SymbolCache::Entry{
+          symbolIndex != UNKNOWN_SYMBOL ? listener->symbols_[symbolIndex] : Symbol::valueOf(symbolName), symbolIndex};
+      });
+      auto symbolIndex = entry.value;
+      const auto &symbol = entry.symbol;
+
+      if (dataCount <= 0) {
+        return;
+      }
+
+      if (listener->metrics_ != nullptr) {
+        listener->metrics_->recordMessage(static_cast<std::size_t>(dataCount),
+                                          static_cast<std::size_t>(dataCount) * sizeof(CEvent));
+      }
+
+      logEvent(LogEvent::EVENTS, eventType, symbol.getId(), dataCount);
+      listener->filter_.forEachRun(cEvents, static_cast<std::size_t>(dataCount),
+                                   [listener, symbolIndex, &symbol](const CEvent *run, std::size_t count) {
+                                     (*listener->sink_)(symbolIndex, symbol, run, count);
+                                   });
+
+      if (listener->completion_ != nullptr && symbolIndex != UNKNOWN_SYMBOL) {
+        for (int i = 0; i < dataCount; i++) {
+          listener->checkCompletion(symbolIndex, cEvents[i]);
+        }
+      }
+    }
+
+    // The sink and the completion must outlive the listener
+    Listener(int eventType, const std::vector<std::string> &symbols, const BatchSinkType<CEvent> &sink,
+             const std::optional<HistoryCompletion> &completion)
+        : eventType_{eventType}, symbols_{SymbolSubscription::toSymbols(symbols)}, sink_{&sink} {
+      // The duplicated symbol keeps its first position
+      requestedSymbols_.add(symbols_);
+
+      if (completion) {
+        completion_ = &*completion;
+        completed_.assign(symbols.size(), false);
+        received_.assign(symbols.size(), false);
+
+        // The events of the duplicated symbol are found at its first position
+        std::unordered_set<std::string_view> uniqueSymbols{};
+
+        for (std::size_t i = 0; i < symbols.size(); i++) {
+          if (!uniqueSymbols.insert(symbols[i]).second) {
+            completed_[i] = true;
+          }
+        }
+
+        remainingSymbolsNumber_ = static_cast<std::size_t>(std::count(completed_.begin(), completed_.end(), false));
+      }
+    }
+
+    Listener(const Listener &) = delete;
+    Listener &operator=(const Listener &) = delete;
+
+    // The handler of the completion of all symbols, must be set before the subscription
+    void setOnCompleted(std::function<void()> onCompleted) { onCompleted_ = std::move(onCompleted); }
+
+    // The metrics of the connection (may be nullptr), must be set before the subscription
+    void setMetrics(ConnectionMetrics *metrics) { metrics_ = metrics; }
+
+    // The filter of the events of the sink (see EventFilter), must be set before the subscription
+    void setFilter(EventFilter<CEvent> filter) { filter_ = std::move(filter); }
+
+    // The hits and the misses of the event symbols
+    [[nodiscard]] SymbolCache::Stats getSymbolCacheStats() const { return symbolCache_.getStats(); }
+
+    [[nodiscard]] int getEventType() const { return eventType_; }
+
+    // Returns true if the completion is set and all symbols are caught up
+    [[nodiscard]] bool isCompleted() const {
+      return completion_ != nullptr && remainingSymbolsNumber_.load() == 0;
+    }
+
+    // Creates the subscription of the listener to the requested symbols. Returns nullptr if the subscription can't be
+    // created. isTimeSeries - the time subscription from the fromTime (ms, 0 - the beginning of the history) is
+    // created.
+    dxf_subscription_t subscribe(dxf_connection_t connection, bool isTimeSeries, dxf_long_t fromTime = 0) {
+      dxf_subscription_t sub = nullptr;
+      auto res = isTimeSeries ? dxf_create_subscription_timed(connection, eventType_, fromTime, &sub)
+                              : dxf_create_subscription(connection, eventType_, &sub);
+
+      if (res == DXF_FAILURE) {
+        ErrorCode::getLast();
+        logEvent(LogEvent::SUBSCRIPTION_FAILED, eventType_, symbols_.size());
+
+        return nullptr;
+      }
+
+      dxf_attach_event_listener(sub, &Listener::onEvents, static_cast<void *>(this));
+
+      if (!SymbolSubscription::addSymbols(sub, symbols_)) {
+        ErrorCode::getLast();
+        logEvent(LogEvent::SUBSCRIPTION_FAILED, eventType_, symbols_.size());
+        dxf_close_subscription(sub);
+
+        return nullptr;
+      }
+
+      logEvent(LogEvent::SUBSCRIBED, eventType_, symbols_.size());
+
+      return sub;
+    }
+
+    // Closes the subscription created by the subscribe
+    void unsubscribe(dxf_subscription_t sub) {
+      logEvent(LogEvent::UNSUBSCRIBED, eventType_);
+      dxf_close_subscription(sub);
+    }
+  };
+
+  // The listener of the events of several types of one subscription (the mask of the types): the events are passed to
+  // the Listener of their type (CEvents - the C structs of the eventTypes in the same order), the dispatch is done
+  // once per call of the C API (the events of one call are of one type). The symbol is caught up when it is caught up
+  // by all types, the completion handlers are called once per symbol.
+  template <typename... CEvents>
+  class MultiListener final {
+   public:
+    static constexpr std::size_t TYPES_NUMBER = sizeof...(CEvents);
+
+   private:
+    std::array<int, TYPES_NUMBER> eventTypes_;
+    // The interned requested symbols
+    std::vector<Symbol> symbols_{};
+    const HistoryCompletion *completion_ = nullptr;
+    // The completions of the listeners of the types: they count the types of every symbol and call the completion
+    // handlers of the user once
+    std::array<std::optional<HistoryCompletion>, TYPES_NUMBER> typeCompletions_{};
+    // The numbers of the types that have received the events and the caught up types by the symbols (used on the
+    // connection thread only)
+    std::unordered_map<std::string, std::size_t> receivedTypesNumbers_{};
+    std::unordered_map<std::string, std::size_t> completedTypesNumbers_{};
+    // The listeners are not movable, so they are kept by the pointers
+    std::tuple<std::unique_ptr<Listener<CEvents>>...> listeners_{};
+    std::function<void()> onCompleted_{};
+
+    static int getEventTypesMask(const std::array<int, TYPES_NUMBER> &eventTypes) {
+      int result = 0;
+
+      for (auto eventType : eventTypes) {
+        result |= eventType;
+      }
+
+      return result;
+    }
+
+    void initTypeCompletions() {
+      for (auto &typeCompletion : typeCompletions_) {
+        typeCompletion = HistoryCompletion{completion_->liveLag};
+        typeCompletion->onSymbolFirstEvent = [this](const std::string &symbol) {
+          if (++receivedTypesNumbers_[symbol] == 1 && completion_->onSymbolFirstEvent) {
+            completion_->onSymbolFirstEvent(symbol);
+          }
+        };
+        typeCompletion->onSymbolCompleted = [this](const std::string &symbol) {
+          if (++completedTypesNumbers_[symbol] == TYPES_NUMBER && completion_->onSymbolCompleted) {
+            completion_->onSymbolCompleted(symbol);
+          }
+        };
+      }
+    }
+
+    template <std::size_t... Is>
+    void initListeners(const std::vector<std::string> &symbols, const std::tuple<BatchSinkType<CEvents>...> &sinks,
+                       std::index_sequence<Is...>) {
+      ((std::get<Is>(listeners_) = std::make_unique<Listener<CEvents>>(eventTypes_[Is], symbols, std::get<Is>(sinks),
+                                                                       typeCompletions_[Is])),
+       ...);
+    }
+
+    // The Listener of the type of the call (the events of the other types are ignored by the listeners)
+    static void onEvents(int eventType, dxf_const_string_t symbolName, const dxf_event_data_t *eventData,
+                         int dataCount, void *userData) {
+      auto *multiListener = static_cast<MultiListener *>(userData);
+
+      std::apply(
+        [&](const auto &...listeners) {
+          (void)((listeners->getEventType() == eventType &&
+                  (listeners->onEvents(eventType, symbolName, eventData, dataCount, listeners.get()), true)) ||
+                 ...);
+        },
+        multiListener->listeners_);
+    }
+
+   public:
+    // The sinks and the completion must outlive the listener
+    MultiListener(const std::array<int, TYPES_NUMBER> &eventTypes, const std::vector<std::string> &symbols,
+                  const std::tuple<BatchSinkType<CEvents>...> &sinks,
+                  const std::optional<HistoryCompletion> &completion)
+        : eventTypes_{eventTypes},
+          symbols_{SymbolSubscription::toSymbols(symbols)},
+          completion_{completion ? &*completion : nullptr} {
+      if (completion_ != nullptr) {
+        initTypeCompletions();
+      }
+
+      initListeners(symbols, sinks, std::index_sequence_for<CEvents...>{});
+      std::apply(
+        [this](const auto &...listeners) {
+          (listeners->setOnCompleted([this] {
+            if (isCompleted() && onCompleted_) {
+              onCompleted_();
+            }
+          }),
+           ...);
+        },
+        listeners_);
+    }
+
+    MultiListener(const MultiListener &) = delete;
+    MultiListener &operator=(const MultiListener &) = delete;
+
+    // The handler of the completion of all symbols by all types, must be set before the subscription
+    void setOnCompleted(std::function<void()> onCompleted) { onCompleted_ = std::move(onCompleted); }
+
+    // The metrics of the connection (may be nullptr), must be set before the subscription
+    void setMetrics(ConnectionMetrics *metrics) {
+      std::apply([metrics](const auto &...listeners) { (listeners->setMetrics(metrics), ...); }, listeners_);
+    }
+
+    // Returns true if the completion is set and all symbols are caught up by all types
+    [[nodiscard]] bool isCompleted() const {
+      return std::apply([](const auto &...listeners) { return (listeners->isCompleted() && ...); }, listeners_);
+    }
+
+    // Creates the one subscription of all types (the mask) to the requested symbols. Returns nullptr if the
+    // subscription can't be created. isTimeSeries - the time subscription from the fromTime (ms, 0 - the beginning of
+    // the history) is created.
+    dxf_subscription_t subscribe(dxf_connection_t connection, bool isTimeSeries, dxf_long_t fromTime = 0) {
+      auto eventTypesMask = getEventTypesMask(eventTypes_);
+      dxf_subscription_t sub = nullptr;
+      auto res = isTimeSeries ? dxf_create_subscription_timed(connection, eventTypesMask, fromTime, &sub)
+                              : dxf_create_subscription(connection, eventTypesMask, &sub);
+
+      if (res == DXF_FAILURE) {
+        ErrorCode::getLast();
+        logEvent(LogEvent::SUBSCRIPTION_FAILED, eventTypesMask, symbols_.size());
+
+        return nullptr;
+      }
+
+      dxf_attach_event_listener(sub, &MultiListener::onEvents, static_cast<void *>(this));
+
+      if (!SymbolSubscription::addSymbols(sub, symbols_)) {
+        ErrorCode::getLast();
+        logEvent(LogEvent::SUBSCRIPTION_FAILED, eventTypesMask, symbols_.size());
+        dxf_close_subscription(sub);
+
+        return nullptr;
+      }
+
+      logEvent(LogEvent::SUBSCRIBED, eventTypesMask, symbols_.size());
+
+      return sub;
+    }
+
+    // Closes the subscription created by the subscribe
+    void unsubscribe(dxf_subscription_t sub) {
+      logEvent(LogEvent::UNSUBSCRIBED, getEventTypesMask(eventTypes_));
+      dxf_close_subscription(sub);
+    }
+  };
+
+ private:
+  // Connects (or takes the connection from the pool), subscribes the listener (Listener or MultiListener) and waits
+  // for the disconnect, the timeout, the completion (if isCompletionSet) or the stop. Returns false if the connection
+  // or the subscription can't be created.
+  template <typename ListenerType>
+  static bool receiveBy(ListenerType &listener, bool isTimeSeries, const std::string &address, int timeout,
+                        ConnectionPool *pool, bool isCompletionSet, StopSignal *stopSignal, dxf_long_t fromTime,
+                        std::size_t lane) {
+    // Without the pool the connection is closed as soon as the lease is released
+    ConnectionPool ownPool{1, std::chrono::milliseconds(0)};
+    auto lease = (pool != nullptr ? *pool : ownPool).acquire(address, lane);
+
+    if (!lease.isValid()) {
+      return false;
+    }
+
+    listener.setOnCompleted([&lease] { lease.notify(); });
+    listener.setMetrics(lease.getMetrics());
+
+    auto sub = listener.subscribe(lease.getConnection(), isTimeSeries, fromTime);
+
+    if (sub == nullptr) {
+      return false;
+    }
+
+    if (stopSignal != nullptr) {
+      stopSignal->add(&lease);
+    }
+
+    if (isCompletionSet || stopSignal != nullptr) {
+      lease.waitForDisconnect(timeout, [&listener, stopSignal] {
+        return listener.isCompleted() || (stopSignal != nullptr && stopSignal->isStopped());
+      });
+    } else {
+      lease.waitForDisconnect(timeout);
+    }
+
+    if (stopSignal != nullptr) {
+      stopSignal->remove(&lease);
+    }
+
+    listener.unsubscribe(sub);
+
+    return true;
+  }
+
+ public:
+  // Connects (or takes the connection from the pool), subscribes to the events of the eventType (the C API DXF_ET_*
+  // constant, CEvent - its C struct) and passes every event to the sink until the disconnect, the timeout, the
+  // completion of all symbols (if the completion is set) or the stop (if the stopSignal is set). isTimeSeries - the
+  // time subscription from the fromTime (ms, 0 - the beginning of the history) is created. lane - the lane of the
+  // pooled connection (see ConnectionPool::acquire). filter - the events that are passed to the sink, it's evaluated
+  // on the raw events before the sink (see EventFilter). Returns false if the connection or the subscription can't be
+  // created.
+  template <typename CEvent>
+  static bool receive(int eventType, bool isTimeSeries, const std::string &address,
+                      const std::vector<std::string> &symbols, const SinkType<CEvent> &sink, int timeout,
+                      ConnectionPool *pool, const std::optional<HistoryCompletion> &completion,
+                      StopSignal *stopSignal = nullptr, dxf_long_t fromTime = 0, std::size_t lane = 0,
+                      EventFilter<CEvent> filter = {}) {
+    return receiveBatches<CEvent>(
+      eventType, isTimeSeries, address, symbols,
+      [&sink](std::size_t symbolIndex, const Symbol &symbol, const CEvent *cEvents,
+              std::size_t count) {
+        for (std::size_t i = 0; i < count; i++) {
+          sink(symbolIndex, symbol, cEvents[i]);
+        }
+      },
+      timeout, pool, completion, stopSignal, fromTime, lane, std::move(filter));
+  }
+
+  // The same as receive, but passes the whole arrays of the events to the sink
+  template <typename CEvent>
+  static bool receiveBatches(int eventType, bool isTimeSeries, const std::string &address,
+                             const std::vector<std::string> &symbols, const BatchSinkType<CEvent> &sink, int timeout,
+                             ConnectionPool *pool, const std::optional<HistoryCompletion> &completion,
+                             StopSignal *stopSignal = nullptr, dxf_long_t fromTime = 0, std::size_t lane = 0,
+                             EventFilter<CEvent> filter = {}) {
+    Listener<CEvent> listener{eventType, symbols, sink, completion};
+
+    listener.setFilter(std::move(filter));
+
+    return receiveBy(listener, isTimeSeries, address, timeout, pool, completion.has_value(), stopSignal, fromTime,
+                     lane);
+  }
+
+  // The same as receiveBatches, but receives the events of several types (eventTypes, CEvents - their C structs in the
+  // same order) by one subscription of the mask of the types, so the types share one connection and one subscription.
+  // Every type has its own sink. The completion is the completion of all types.
+  template <typename... CEvents>
+  static bool receiveMultiple(const std::array<int, sizeof...(CEvents)> &eventTypes, bool isTimeSeries,
+                              const std::string &address, const std::vector<std::string> &symbols,
+                              const std::tuple<BatchSinkType<CEvents>...> &sinks, int timeout, ConnectionPool *pool,
+                              const std::optional<HistoryCompletion> &completion, StopSignal *stopSignal = nullptr,
+                              dxf_long_t fromTime = 0, std::size_t lane = 0) {
+    MultiListener<CEvents...> listener{eventTypes, symbols, sinks, completion};
+
+    return receiveBy(listener, isTimeSeries, address, timeout, pool, completion.has_value(), stopSignal, fromTime,
+                     lane);
+  }
+
+  // The event-driven receiveBatches: no thread waits for the events. The connection and the subscription are created
+  // by the task of the executor; the disconnect (the handler of the connection), the completion of all symbols (the
+  // listener) and the timeout (the timer of the executor) post the task that closes the subscription and calls the
+  // onDone with the result (false if the connection or the subscription can't be created) on the executor thread.
+  // Returns the stop of the receive (finishes it as the timeout does). The executor and the pool must outlive the
+  // receive. lane - the lane of the pooled connection (see ConnectionPool::acquire). fromTime - the start of the time
+  // subscription (ms, 0 - the beginning of the history).
+  template <typename CEvent>
+  static std::function<void()> receiveBatchesAsync(Executor &executor, int eventType, bool isTimeSeries, const std::string &address,
+                                  const std::vector<std::string> &symbols, BatchSinkType<CEvent> sink, int timeout,
+                                  ConnectionPool *pool, std::optional<HistoryCompletion> completion,
+                                  std::function<void(bool)> onDone, EventFilter<CEvent> filter = {},
+                                  std::size_t lane = 0, dxf_long_t fromTime = 0) {
+    struct AsyncReceive {
+      Executor *executor_ = nullptr;
+      BatchSinkType<CEvent> sink_;
+      std::optional<HistoryCompletion> completion_;
+      std::function<void(bool)> onDone_;
+      Listener<CEvent> listener_;
+      // Without the pool the connection is closed as soon as the lease is released. The lease is released before the
+      // pool is destroyed.
+      std::unique_ptr<ConnectionPool> ownPool_{};
+      ConnectionPool::Lease lease_{};
+      // Guards the start against the concurrent finish
+      std::mutex mutex_{};
+      dxf_subscription_t subscription_ = nullptr;
+      std::uint64_t disconnectHandlerId_ = 0;
+      std::atomic<bool> isFinished_{false};
+      // Keeps the receive alive until it is finished
+      std::shared_ptr<AsyncReceive> self_{};
+
+      AsyncReceive(Executor &executor, int eventType, const std::vector<std::string> &symbols,
+                   BatchSinkType<CEvent> &&sink, std::optional<HistoryCompletion> &&completion,
+                   std::function<void(bool)> &&onDone)
+          : executor_{&executor},
+            sink_{std::move(sink)},
+            completion_{std::move(completion)},
+            onDone_{std::move(onDone)},
+            listener_{eventType, symbols, sink_, completion_} {}
+
+      // Called under the mutex
+      void release(bool result) {
+        lease_.removeDisconnectHandler(disconnectHandlerId_);
+
+        if (subscription_ != nullptr) {
+          listener_.unsubscribe(subscription_);
+          subscription_ = nullptr;
+        }
+
+        lease_.reset();
+        ownPool_.reset();
+
+        if (onDone_) {
+          onDone_(result);
+        }
+      }
+
+      // The subscription can't be closed in its own listener, so it is closed by the task
+      static void finish(const std::weak_ptr<AsyncReceive> &weakSelf) {
+        auto asyncReceive = weakSelf.lock();
+
+        if (!asyncReceive || asyncReceive->isFinished_.exchange(true)) {
+          return;
+        }
+
+        asyncReceive->executor_->post([asyncReceive] {
+          std::lock_guard guard(asyncReceive->mutex_);
+
+          asyncReceive->release(true);
+          asyncReceive->self_.reset();
+        });
+      }
+
+      void start(const std::string &address, bool isTimeSeries, int timeout, ConnectionPool *pool, std::size_t lane,
+                 dxf_long_t fromTime) {
+        std::lock_guard guard(mutex_);
+        std::weak_ptr<AsyncReceive> weakSelf = self_;
+
+        // Stopped before the start
+        if (isFinished_) {
+          return;
+        }
+
+        if (pool == nullptr) {
+          ownPool_ = std::make_unique<ConnectionPool>(1, std::chrono::milliseconds(0));
+        }
+
+        lease_ = (pool != nullptr ? *pool : *ownPool_).acquire(address, lane);
+
+        if (lease_.isValid()) {
+          listener_.setOnCompleted([weakSelf] { finish(weakSelf); });
+          listener_.setMetrics(lease_.getMetrics());
+          subscription_ = listener_.subscribe(lease_.getConnection(), isTimeSeries, fromTime);
+        }
+
+        if (subscription_ == nullptr) {
+          isFinished_ = true;
+          release(false);
+          self_.reset();
+
+          return;
+        }
+
+        disconnectHandlerId_ = lease_.addDisconnectHandler([weakSelf] { finish(weakSelf); });
+
+        if (timeout > 0) {
+          executor_->schedule(std::chrono::milliseconds(timeout), [weakSelf] { finish(weakSelf); });
+        }
+
+        if (listener_.isCompleted()) {
+          finish(weakSelf);
+        }
+      }
+    };
+
+    auto asyncReceive = std::make_shared<AsyncReceive>(executor, eventType, symbols, std::move(sink),
+                                                       std::move(completion), std::move(onDone));
+
+    asyncReceive->self_ = asyncReceive;
+    asyncReceive->listener_.setFilter(std::move(filter));
+    executor.post([asyncReceive, address, isTimeSeries, timeout, pool, lane, fromTime] {
+      asyncReceive->start(address, isTimeSeries, timeout, pool, lane, fromTime);
+    });
+
+    return [weakSelf = std::weak_ptr<AsyncReceive>(asyncReceive)] { AsyncReceive::finish(weakSelf); };
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "EventCodec.hpp"
+#include "LargePages.hpp"
+#include "SpscRing.hpp"
+#include "SymbolCache.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The bounded single-producer multiple-consumer ring of the preallocated slots (the Disruptor pattern). Every consumer
+// reads all the published slots by its own cursor, so several consumers (e.g. the persistence, the analytics and the
+// strategy) read the same stream that is converted once. The slots are filled and read in place (the strings and the
+// vectors of the slots keep their capacity), so the steady state doesn't allocate or lock. The producer doesn't
+// overwrite the slot until every consumer has read it: the slowest consumer holds the producer back.
+//
+// The number of the consumers is fixed at the construction, every consumer must read (or the producer stops when the
+// ring is full). The consumers read the batches: the cursor is advanced once per batch.
+//
+// The plain events of the C API types (e.g. TimeAndSaleData, Order, see MarketEvents) are published by the listener of
+// the subscription (attach) or by publish(symbol, cEvents, count).
+//
+// Producer:
+//   auto* slot = ring.claim();   // waits while the slot is not read by all the consumers
+//   fill(*slot);
+//   ring.publish();              // publishes all the claimed slots
+//
+// Consumer i:
+//   auto consumer = ring.getConsumer(i);
+//   while (consumer.wait()) consumer.poll([](const T& event, bool isEndOfBatch) { ... });
+template <typename T>
+class EventRing final {
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+  // The bit of the published_ that is set by the close()
+  static constexpr std::uint64_t CLOSED_BIT = std::uint64_t{1} << 63U;
+
+  struct alignas(CACHE_LINE_SIZE) Cursor {
+    // The number of the slots read by the consumer
+    std::atomic<std::uint64_t> value{};
+  };
+
+  // The large rings are the large page buffers (see LargePages)
+  std::vector<T, LargePageAllocator<T>> slots_;
+  std::size_t mask_;
+  std::unique_ptr<Cursor[]> cursors_;
+  std::size_t consumersNumber_;
+
+  // The number of the published slots (and the CLOSED_BIT). Written by the producer only.
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> published_{};
+  // The number of the times the producer has found the ring full
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> overflowsNumber_{};
+
+  // The state of the producer
+  alignas(CACHE_LINE_SIZE) std::uint64_t claimed_ = 0;
+  // The cached number of the slots read by the slowest consumer, so the cursors are not read by every claim
+  std::uint64_t gate_ = 0;
+  // The symbols of the listener are resolved on the connection thread
+  SymbolCache symbolCache_{};
+
+  [[nodiscard]] std::uint64_t getMinCursor() const {
+    auto result = std::numeric_limits<std::uint64_t>::max();
+
+    for (std::size_t i = 0; i < consumersNumber_; i++) {
+      result = (std::min)(result, cursors_[i].value.load(std::memory_order_acquire));
+    }
+
+    return result;
+  }
+
+  static void onEvents(int eventType, dxf_const_string_t symbolName, const dxf_event_data_t* eventData, int dataCount,
+                       void* userData) {
+    if constexpr (requires { typename T::CEventType; }) {
+      auto* ring = static_cast<EventRing*>(userData);
+
+      if (eventType != T::EVENT_TYPE || dataCount <= 0) {
+        return;
+      }
+
+      const auto& entry = ring->symbolCache_.get(std::wstring_view{symbolName}, [symbolName] {
+        return SymbolCache::Entry{Symbol::valueOf(std::wstring_view{symbolName}), 0};
+      });
+
+      ring->publish(entry.symbol, reinterpret_cast<const typename T::CEventType*>(eventData),
+                    static_cast<std::size_t>(dataCount));
+    }
+  }
+
+ public:
+  // The reader of the ring by one cursor. Used by one thread at a time.
+  class Consumer final {
+    EventRing* ring_;
+    Cursor* cursor_;
+
+   public:
+    Consumer(EventRing* ring, Cursor* cursor) : ring_{ring}, cursor_{cursor} {}
+
+    // Waits for the unread slots: busy-polls for the spin time, then blocks. Returns false if the ring is closed and all
+    // its slots are read.
+    bool wait(std::chrono::nanoseconds spin = std::chrono::nanoseconds{0}) const {
+      auto next = cursor_->value.load(std::memory_order_relaxed);
+
+      spinUntil(spin, [this, next] { return ring_->published_.load(std::memory_order_acquire) != next; });
+      ring_->published_.wait(next, std::memory_order_acquire);
+
+      return (ring_->published_.load(std::memory_order_acquire) & ~CLOSED_BIT) != next;
+    }
+
+    // Calls the f(const T&, bool isEndOfBatch) for the unread slots (at most maxBatchSize) without the waiting, then
+    // releases them. Returns the number of the read slots.
+    template <typename F>
+    std::size_t poll(F&& f, std::size_t maxBatchSize = std::numeric_limits<std::size_t>::max()) {
+      auto next = cursor_->value.load(std::memory_order_relaxed);
+      auto published = ring_->published_.load(std::memory_order_acquire) & ~CLOSED_BIT;
+      auto count = static_cast<std::size_t>((std::min<std::uint64_t>)(published - next, maxBatchSize));
+
+      if (count == 0) {
+        return 0;
+      }
+
+      for (std::size_t i = 0; i < count; i++) {
+        f(static_cast<const T&>(ring_->slots_[(next + i) & ring_->mask_]), i + 1 == count);
+      }
+
+      cursor_->value.store(next + count, std::memory_order_release);
+      cursor_->value.notify_one();
+
+      return count;
+    }
+
+    // The number of the slots read by the consumer
+    [[nodiscard]] std::uint64_t getSequence() const { return cursor_->value.load(std::memory_order_relaxed); }
+
+    // The number of the published slots that are not read yet
+    [[nodiscard]] std::uint64_t getLag() const {
+      return (ring_->published_.load(std::memory_order_acquire) & ~CLOSED_BIT) -
+             cursor_->value.load(std::memory_order_relaxed);
+    }
+  };
+
+  // capacity - the number of the slots (rounded up to the power of 2)
+  EventRing(std::size_t capacity, std::size_t consumersNumber)
+      : slots_(std::bit_ceil((std::max)(capacity, std::size_t{2}))),
+        mask_{slots_.size() - 1},
+        cursors_{std::make_unique<Cursor[]>((std::max)(consumersNumber, std::size_t{1}))},
+        consumersNumber_{(std::max)(consumersNumber, std::size_t{1})} {}
+
+  EventRing(const EventRing&) = delete;
+  EventRing& operator=(const EventRing&) = delete;
+
+  [[nodiscard]] std::size_t capacity() const { return slots_.size(); }
+
+  [[nodiscard]] std::size_t getConsumersNumber() const { return consumersNumber_; }
+
+  // index - from 0 to getConsumersNumber() - 1
+  [[nodiscard]] Consumer getConsumer(std::size_t index) { return Consumer{this, &cursors_[index]}; }
+
+  // Producer. Returns the next free slot (it's not visible to the consumers until the publish). If the ring is full,
+  // counts the overflow, publishes the claimed slots (the consumers can't free the slots they don't see, so the batch
+  // that is larger than the ring is published in parts) and waits for the slowest consumer.
+  T* claim() {
+    if (claimed_ - gate_ == slots_.size()) {
+      gate_ = getMinCursor();
+
+      if (claimed_ - gate_ == slots_.size()) {
+        overflowsNumber_.fetch_add(1, std::memory_order_relaxed);
+
+        if ((published_.load(std::memory_order_relaxed) & ~CLOSED_BIT) != claimed_) {
+          publish();
+        }
+
+        do {
+          for (std::size_t i = 0; i < consumersNumber_; i++) {
+            cursors_[i].value.wait(gate_, std::memory_order_acquire);
+          }
+
+          gate_ = getMinCursor();
+        } while (claimed_ - gate_ == slots_.size());
+      }
+    }
+
+    return &slots_[claimed_++ & mask_];
+  }
+
+  // Producer. Makes all the claimed slots visible to the consumers.
+  void publish() {
+    published_.store(claimed_, std::memory_order_release);
+    published_.notify_all();
+  }
+
+  // Producer. Decodes the events of the C API to the slots (T is the plain event, e.g. TimeAndSaleData) and publishes
+  // them at once (in parts, if the ring is full, see claim).
+  template <typename CEvent>
+  void publish(const Symbol& symbol, const CEvent* cEvents, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      EventCodec<T>::decode(*claim(), symbol, cEvents[i]);
+    }
+
+    publish();
+  }
+
+  // Attaches the producer listener to the subscription (T is the plain event of its type). The ring has one producer,
+  // so it's attached to one subscription. Returns false if the C API fails.
+  bool attach(dxf_subscription_t subscription) {
+    return dxf_attach_event_listener(subscription, &EventRing::onEvents, static_cast<void*>(this)) != DXF_FAILURE;
+  }
+
+  // Producer. Wakes up the consumers: their wait returns false when they read all the published slots.
+  void close() {
+    published_.store(claimed_ | CLOSED_BIT, std::memory_order_release);
+    published_.notify_all();
+  }
+
+  [[nodiscard]] std::uint64_t getOverflowsNumber() const { return overflowsNumber_.load(std::memory_order_relaxed); }
+};
+
+}  // namespace dxf
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "Backpressure.hpp"
+#include "Executor.hpp"
+#include "MpscQueue.hpp"
+
+namespace dxf {
+
+// The asynchronous stream of the events of the subscription for one consumer coroutine:
+//
+//   while (auto event = co_await stream->next()) { ... }
+//
+// The listener of the subscription pushes the events (on the connection thread) and the waiting consumer is resumed on
+// the executor, so the consumers don't block the threads. The events are buffered until the consumer takes them. The
+// stream ends (next returns std::nullopt) after the subscription is closed (the disconnect, the timeout, the
+// completion or the close) and the buffered events are taken.
+//
+// The events are handed over by the lock-free queue (MpscQueue): the consumer takes all the pushed events at once and
+// the waiting consumer is taken by the exchange, so the producers and the consumer never wait for each other.
+//
+// The bounded stream (BackpressureConfig::capacity) buffers at most the capacity of the events that are not taken by
+// the consumer in the deque guarded by the mutex, and the producer acts by the policy when it's full: BLOCK - waits
+// for the consumer (the connection thread is blocked until the consumer takes the events), DROP_OLDEST - drops the
+// oldest buffered event, CONFLATE - replaces the buffered event of the same key (see the conflationKey, the oldest one
+// is dropped if there is none), DISCONNECT - closes the subscription and drops the events. The counters are returned
+// by getBackpressureStats.
+template <typename T>
+class EventStream final {
+  Executor *executor_;
+  MpscQueue<T> events_{};
+  BackpressureConfig backpressure_;
+  std::function<std::size_t(const T &)> conflationKey_;
+  BackpressureCounters counters_{};
+  // The number of the events of the unbounded queue that are not taken by the consumer
+  std::atomic<std::size_t> depth_{0};
+  // The events of the bounded stream that are not taken by the consumer (guarded by the mutex)
+  std::deque<T> boundedEvents_{};
+  std::atomic<std::size_t> boundedSize_{0};
+  std::condition_variable notFull_{};
+  // The events taken by the consumer. Used by the consumer only.
+  std::deque<T> takenEvents_{};
+  // The waiting consumer (the address of the coroutine frame)
+  std::atomic<void *> consumer_{nullptr};
+  std::atomic<bool> isFinished_{false};
+  std::mutex mutex_{};
+  bool isReceived_ = true;
+  std::function<void()> stop_{};
+
+  // Resumes the waiting consumer, if any. Called after the event or the end is published: the publication, the
+  // exchange and the operations of the consumer are sequentially consistent, so either the consumer sees the event or
+  // the end, or the consumer is seen here.
+  void resumeConsumer() {
+    if (auto *consumer = consumer_.exchange(nullptr, std::memory_order_seq_cst)) {
+      executor_->post([consumer] { std::coroutine_handle<>::from_address(consumer).resume(); });
+    }
+  }
+
+  [[nodiscard]] bool isBufferEmpty() const {
+    return backpressure_.capacity == 0 ? events_.isEmpty() : boundedSize_.load(std::memory_order_seq_cst) == 0;
+  }
+
+  enum class PushResult { PUSHED, DROPPED, DISCONNECTED };
+
+  // Called under the mutex
+  PushResult pushBounded(T &&event, std::unique_lock<std::mutex> &lock) {
+    if (counters_.isDisconnected()) {
+      counters_.recordDropped(1);
+
+      return PushResult::DROPPED;
+    }
+
+    if (boundedEvents_.size() >= backpressure_.capacity) {
+      counters_.recordOverflow();
+
+      switch (backpressure_.policy) {
+        case BackpressurePolicy::BLOCK: {
+          auto start = std::chrono::steady_clock::now();
+
+          notFull_.wait(lock, [this] {
+            return boundedEvents_.size() < backpressure_.capacity || isFinished_.load(std::memory_order_relaxed);
+          });
+          counters_.recordBlocked(std::chrono::steady_clock::now() - start);
+
+          break;
+        }
+        case BackpressurePolicy::CONFLATE:
+          if (conflationKey_) {
+            auto key = conflationKey_(event);
+
+            for (auto it = boundedEvents_.rbegin(); it != boundedEvents_.rend(); ++it) {
+              if (conflationKey_(*it) == key) {
+                *it = std::move(event);
+                counters_.recordConflated(1);
+
+                return PushResult::PUSHED;
+              }
+            }
+          }
+
+          [[fallthrough]];
+        case BackpressurePolicy::DROP_OLDEST:
+          boundedEvents_.pop_front();
+          counters_.recordDropped(1);
+
+          break;
+        case BackpressurePolicy::DISCONNECT:
+          counters_.setDisconnected();
+          counters_.recordDropped(1);
+
+          return PushResult::DISCONNECTED;
+      }
+    }
+
+    boundedEvents_.push_back(std::move(event));
+    boundedSize_.store(boundedEvents_.size(), std::memory_order_seq_cst);
+    counters_.recordDepth(boundedEvents_.size());
+
+    return PushResult::PUSHED;
+  }
+
+ public:
+ public:
+  // backpressure - the bound of the buffered events (the capacity 0 - unbounded). conflationKey - the key of the events
+  // that replace each other by the CONFLATE policy (e.g. the symbol).
+  explicit EventStream(Executor &executor, BackpressureConfig backpressure = {},
+                       std::function<std::size_t(const T &)> conflationKey = {})
+      : executor_{&executor}, backpressure_{backpressure}, conflationKey_{std::move(conflationKey)} {}
+
+  EventStream(const EventStream &) = delete;
+  EventStream &operator=(const EventStream &) = delete;
+
+  // The producer
+  void push(T &&event) {
+    if (backpressure_.capacity == 0) {
+      events_.push(std::move(event));
+      counters_.recordDepth(depth_.fetch_add(1, std::memory_order_relaxed) + 1);
+      resumeConsumer();
+
+      return;
+    }
+
+    std::unique_lock lock(mutex_);
+    auto result = pushBounded(std::move(event), lock);
+
+    lock.unlock();
+
+    if (result == PushResult::PUSHED) {
+      resumeConsumer();
+    } else if (result == PushResult::DISCONNECTED) {
+      // The subscription is closed out of the mutex (the close takes it)
+      close();
+    }
+  }
+
+  // The producer. isReceived - false if the connection or the subscription can't be created.
+  void finish(bool isReceived) {
+    {
+      std::lock_guard guard(mutex_);
+
+      isReceived_ = isReceived;
+      // Under the mutex, so the blocked producer sees it
+      isFinished_.store(true, std::memory_order_seq_cst);
+    }
+
+    notFull_.notify_all();
+    resumeConsumer();
+  }
+
+  // The producer: the stop of the subscription (see close)
+  void setStop(std::function<void()> stop) {
+    std::lock_guard guard(mutex_);
+
+    stop_ = std::move(stop);
+  }
+
+  // Closes the subscription before the end (e.g. the consumer doesn't need more events). The stream ends after the
+  // buffered events.
+  void close() {
+    std::function<void()> stop{};
+
+    {
+      std::lock_guard guard(mutex_);
+
+      stop = std::move(stop_);
+    }
+
+    if (stop) {
+      stop();
+    }
+  }
+
+  // Returns false if the stream is finished because the connection or the subscription can't be created
+  [[nodiscard]] bool isReceived() {
+    std::lock_guard guard(mutex_);
+
+    return isReceived_;
+  }
+
+  // Returns the counters of the buffer: the depth (the events that are not taken by the consumer) and its high-water
+  // mark, the dropped and the conflated events, the time the producer was blocked
+  [[nodiscard]] BackpressureStats getBackpressureStats() const {
+    auto result = counters_.getStats();
+
+    result.queueDepth = backpressure_.capacity == 0 ? depth_.load(std::memory_order_relaxed)
+                                                    : boundedSize_.load(std::memory_order_relaxed);
+
+    return result;
+  }
+
+  // Writes the backpressure counters of the stream as the dxf_stream_* metrics labeled by the labels (e.g. the
+  // subscription). Can be called from any thread (see MetricsRegistry::addCollector).
+  void collectMetrics(MetricsWriter &writer, const MetricLabels &labels = {}) const {
+    collectBackpressureMetrics(writer, "dxf_stream", labels, getBackpressureStats());
+  }
+
+  // The awaitable of the next event (std::nullopt - the end of the stream)
+  auto next() {
+    struct Awaiter {
+      EventStream *stream;
+
+      [[nodiscard]] bool await_ready() const noexcept { return !stream->takenEvents_.empty(); }
+
+      // Returns false (no suspension) if there is the event or the end of the stream
+      bool await_suspend(std::coroutine_handle<> consumer) {
+        stream->consumer_.store(consumer.address(), std::memory_order_seq_cst);
+
+        if (stream->isBufferEmpty() && !stream->isFinished_.load(std::memory_order_seq_cst)) {
+          return true;
+        }
+
+        // The producer that has taken the consumer resumes it
+        return stream->consumer_.exchange(nullptr, std::memory_order_seq_cst) == nullptr;
+      }
+
+      std::optional<T> await_resume() {
+        auto &takenEvents = stream->takenEvents_;
+
+        if (takenEvents.empty()) {
+          if (stream->backpressure_.capacity == 0) {
+            auto takenNumber =
+              stream->events_.popAll([&takenEvents](T &event) { takenEvents.push_back(std::move(event)); });
+
+            stream->depth_.fetch_sub(takenNumber, std::memory_order_relaxed);
+          } else {
+            {
+              std::lock_guard guard(stream->mutex_);
+
+              takenEvents.swap(stream->boundedEvents_);
+              stream->boundedSize_.store(0, std::memory_order_seq_cst);
+            }
+
+            stream->notFull_.notify_all();
+          }
+        }
+
+        if (takenEvents.empty()) {
+          return std::nullopt;
+        }
+
+        auto event = std::move(takenEvents.front());
+
+        takenEvents.pop_front();
+
+        return event;
+      }
+    };
+
+    return Awaiter{this};
+  }
+};
+
+}  // namespace dxf
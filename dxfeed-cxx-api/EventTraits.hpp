@@ -0,0 +1,57 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <string>
+
+#include "IndexedEvent.hpp"
+
+namespace dxf {
+
+// The static access to the fields of the event type E. The specializations are the alternative of the virtual
+// interfaces (EventType, IndexedEvent): the calls are resolved at the compile time and inlined, so the loops over the
+// plain event structs (e.g. TimeAndSaleData) have no indirect calls.
+//
+// The specialization of the indexed event provides getIndex(const E&) and getEventFlags(const E&), the one of the time
+// series event provides getTime(const E&) too.
+template <typename E>
+struct EventTraits;
+
+template <typename E>
+concept IndexedEventLike = requires(const E& e) {
+  { EventTraits<E>::getIndex(e) } -> std::convertible_to<std::uint64_t>;
+  { EventTraits<E>::getEventFlags(e) } -> std::convertible_to<std::uint32_t>;
+};
+
+template <typename E>
+concept TimeSeriesEventLike = IndexedEventLike<E> && requires(const E& e) {
+  { EventTraits<E>::getTime(e) } -> std::convertible_to<std::uint64_t>;
+};
+
+// The helpers of the event flags
+struct EventFlags {
+  using Flags = IndexedEvent<std::string>;
+
+  template <IndexedEventLike E>
+  [[nodiscard]] static bool isRemoveEvent(const E& e) {
+    return (EventTraits<E>::getEventFlags(e) & Flags::REMOVE_EVENT) != 0;
+  }
+
+  template <IndexedEventLike E>
+  [[nodiscard]] static bool isTxPending(const E& e) {
+    return (EventTraits<E>::getEventFlags(e) & Flags::TX_PENDING) != 0;
+  }
+
+  template <IndexedEventLike E>
+  [[nodiscard]] static bool isSnapshotBegin(const E& e) {
+    return (EventTraits<E>::getEventFlags(e) & Flags::SNAPSHOT_BEGIN) != 0;
+  }
+
+  // Returns true if the snapshot ends with the event (SNAPSHOT_END or SNAPSHOT_SNIP)
+  template <IndexedEventLike E>
+  [[nodiscard]] static bool isSnapshotEnd(const E& e) {
+    return (EventTraits<E>::getEventFlags(e) & (Flags::SNAPSHOT_END | Flags::SNAPSHOT_SNIP)) != 0;
+  }
+};
+
+}  // namespace dxf
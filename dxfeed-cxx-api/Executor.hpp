@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Clock.hpp"
+#include "ThreadPlacement.hpp"
+
+namespace dxf {
+
+// The fixed pool of the threads that runs the tasks and the delayed tasks (the timers). The fetches of the data
+// providers that take the executor (e.g. SimpleTimeAndSaleDataProvider::run) don't block a thread while the events
+// arrive: the executor runs only their starts (the connection and the subscription) and their completions, so any
+// number of the concurrent fetches needs only the threads of the executor. The timers run by the time of the default
+// clock of the API at the creation (see dxf::Clock), so the timeouts of the replays follow the simulated time.
+class Executor final {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using TaskType = std::function<void()>;
+
+ private:
+  struct Timer {
+    Clock::time_point time{};
+    // The timers of the same time are run in the order of the scheduling
+    std::uint64_t order = 0;
+    TaskType task{};
+
+    // The heap of the timers is the max-heap, so the earliest timer is the greatest one
+    bool operator<(const Timer &other) const {
+      return time != other.time ? time > other.time : order > other.order;
+    }
+  };
+
+  std::mutex mutex_{};
+  std::condition_variable cv_{};
+  std::deque<TaskType> tasks_{};
+  std::vector<Timer> timers_{};
+  std::uint64_t timersNumber_ = 0;
+  bool stop_ = false;
+  dxf::Clock &clock_;
+  // The wake-up of the workers on the advance of the simulated clock
+  std::uint64_t advanceHandlerId_;
+  std::vector<std::thread> threads_{};
+
+  void runWorker() {
+    std::unique_lock lk(mutex_);
+
+    while (true) {
+      auto now = clock_.now();
+
+      while (!timers_.empty() && timers_.front().time <= now) {
+        std::pop_heap(timers_.begin(), timers_.end());
+        tasks_.push_back(std::move(timers_.back().task));
+        timers_.pop_back();
+      }
+
+      if (!tasks_.empty()) {
+        auto task = std::move(tasks_.front());
+
+        tasks_.pop_front();
+        lk.unlock();
+        task();
+        lk.lock();
+
+        continue;
+      }
+
+      if (stop_) {
+        return;
+      }
+
+      if (timers_.empty()) {
+        cv_.wait(lk);
+      } else {
+        // The copy: the heap may be reallocated during the wait
+        auto time = timers_.front().time;
+
+        // The new task, the earlier timer and the stop end the wait too
+        clock_.waitUntil(lk, cv_, time, [this, time] {
+          return stop_ || !tasks_.empty() || timers_.empty() || timers_.front().time < time;
+        });
+      }
+    }
+  }
+
+ public:
+  // threadsNumber - the number of the threads (0 - the number of the cores). placement - the placement of the threads
+  // (the failure is ignored).
+  explicit Executor(std::size_t threadsNumber = 0, const ThreadPlacement &placement = {})
+      : clock_{dxf::Clock::getDefault()}, advanceHandlerId_{clock_.addAdvanceHandler([this] {
+          {
+            std::lock_guard lk(mutex_);
+          }
+
+          cv_.notify_all();
+        })} {
+    if (threadsNumber == 0) {
+      threadsNumber = (std::max)(std::thread::hardware_concurrency(), 1U);
+    }
+
+    threads_.reserve(threadsNumber);
+
+    for (std::size_t i = 0; i < threadsNumber; i++) {
+      threads_.emplace_back([this, placement] {
+        ThreadPlacement::setCurrentThreadName("dxf-executor");
+        placement.applyToCurrentThread();
+        runWorker();
+      });
+    }
+  }
+
+  Executor(const Executor &) = delete;
+  Executor &operator=(const Executor &) = delete;
+
+  // Runs the queued tasks and drops the timers. The executor must outlive the fetches that use it.
+  ~Executor() {
+    {
+      std::lock_guard lk(mutex_);
+
+      stop_ = true;
+    }
+
+    cv_.notify_all();
+
+    for (auto &thread : threads_) {
+      thread.join();
+    }
+
+    clock_.removeAdvanceHandler(advanceHandlerId_);
+  }
+
+  [[nodiscard]] std::size_t getThreadsNumber() const { return threads_.size(); }
+
+  // Runs the task on one of the threads. The task must not block for long: the blocked thread doesn't run the other
+  // tasks.
+  void post(TaskType task) {
+    {
+      std::lock_guard lk(mutex_);
+
+      tasks_.push_back(std::move(task));
+    }
+
+    cv_.notify_one();
+  }
+
+  // Runs the task on one of the threads not before the time
+  void schedule(Clock::time_point time, TaskType task) {
+    {
+      std::lock_guard lk(mutex_);
+
+      timers_.push_back(Timer{time, timersNumber_++, std::move(task)});
+      std::push_heap(timers_.begin(), timers_.end());
+    }
+
+    // Every waiting thread may wait for the later timer
+    cv_.notify_all();
+  }
+
+  // Runs the task on one of the threads after the delay
+  void schedule(std::chrono::milliseconds delay, TaskType task) { schedule(clock_.now() + delay, std::move(task)); }
+
+  // The clock of the timers
+  [[nodiscard]] dxf::Clock &getClock() const { return clock_; }
+};
+
+}  // namespace dxf
@@ -0,0 +1,425 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "EpochReclamation.hpp"
+#include "PriceLevel.hpp"
+#include "PriceLevelBookView.hpp"
+
+namespace dxf {
+
+// The full depth of the book (all levels of the ladders) for the lock-free reading from the other threads. The levels
+// of every side are kept in the blocks of up to BLOCK_CAPACITY levels (best-first), the version of the book is the
+// lists of the blocks. One writer (the thread that applies the book) publishes the new version after every
+// transaction: the changed blocks are copied and changed (copy-on-write), the others are shared with the previous
+// version, so the publication copies the changed blocks and the lists of the block pointers only. The readers pin the
+// epoch (see EpochDomain) and walk the consistent version at their own pace; the replaced versions and blocks are
+// reused by the writer when no reader holds their epoch. The readers never block the writer.
+//
+// Usage:
+//   // The writer
+//   levels.beginUpdate();
+//   levels.setLevel(false, {100.5, 10.0, time});  // The ask level is added or updated
+//   levels.removeLevel(true, 99.5);               // The bid level is removed
+//   levels.publish();
+//
+//   // The reader (any thread)
+//   auto book = levels.read();
+//   book.forEachBid([](const PriceLevel& pl) { ... });
+class FullDepthPriceLevels final {
+ public:
+  static constexpr std::size_t BLOCK_CAPACITY = 32;
+  // The levels of the blocks of the rebuild (the rest is left for the insertions)
+  static constexpr std::size_t BLOCK_FILL = BLOCK_CAPACITY * 3 / 4;
+  // The maximum number of the reclaimed blocks that are kept for the reuse
+  static constexpr std::size_t MAX_FREE_BLOCKS = 4096;
+
+ private:
+  struct Block {
+    // The sequence of the version that has created the block: the block of the version that is being built is changed
+    // in place
+    std::uint64_t sequence = 0;
+    std::size_t size = 0;
+    std::array<PriceLevel, BLOCK_CAPACITY> levels{};
+  };
+
+  struct Version {
+    std::uint64_t sequence = 0;
+    std::vector<Block*> asks{};
+    std::vector<Block*> bids{};
+    std::size_t asksNumber = 0;
+    std::size_t bidsNumber = 0;
+  };
+
+  mutable EpochDomain domain_{};
+  std::atomic<const Version*> current_;
+  // The version that is being built by the writer (between beginUpdate and publish)
+  Version* next_ = nullptr;
+  std::vector<Block*> freeBlocks_{};
+  std::vector<Version*> freeVersions_{};
+
+  static void deleteBlock(void* block) { delete static_cast<Block*>(block); }
+
+  static void deleteVersion(void* version) { delete static_cast<Version*>(version); }
+
+  static bool isSamePrice(double price1, double price2) {
+    return price1 == price2 || (std::isnan(price1) && std::isnan(price2));
+  }
+
+  Block* takeBlock() {
+    if (freeBlocks_.empty()) {
+      return new Block{};
+    }
+
+    auto* block = freeBlocks_.back();
+
+    freeBlocks_.pop_back();
+
+    return block;
+  }
+
+  Block* createBlock() {
+    auto* block = takeBlock();
+
+    block->sequence = next_->sequence;
+    block->size = 0;
+
+    return block;
+  }
+
+  // The replaced block: the block of the published versions is retired, the new one is reused at once
+  void releaseBlock(Block* block) {
+    if (block->sequence == next_->sequence) {
+      freeBlocks_.push_back(block);
+    } else {
+      domain_.retire(block, &deleteBlock);
+    }
+  }
+
+  // The block that can be changed in place (copied if it belongs to the published versions)
+  Block* getWritableBlock(std::vector<Block*>& blocks, std::size_t blockIndex) {
+    auto* block = blocks[blockIndex];
+
+    if (block->sequence == next_->sequence) {
+      return block;
+    }
+
+    auto* copy = createBlock();
+
+    std::copy_n(block->levels.begin(), block->size, copy->levels.begin());
+    copy->size = block->size;
+    releaseBlock(block);
+    blocks[blockIndex] = copy;
+
+    return copy;
+  }
+
+  // The position of the first block whose worst level is not better than the price
+  template <typename Side>
+  static std::size_t findBlock(const std::vector<Block*>& blocks, double price) {
+    auto found = std::partition_point(blocks.begin(), blocks.end(), [price](const Block* block) {
+      return Side::isBetter(block->levels[block->size - 1].price, price);
+    });
+
+    return static_cast<std::size_t>(found - blocks.begin());
+  }
+
+  // The position of the first level of the block that is not better than the price
+  template <typename Side>
+  static std::size_t findLevel(const Block& block, double price) {
+    auto end = block.levels.begin() + static_cast<std::ptrdiff_t>(block.size);
+    auto found = std::partition_point(block.levels.begin(), end,
+                                      [price](const PriceLevel& pl) { return Side::isBetter(pl.price, price); });
+
+    return static_cast<std::size_t>(found - block.levels.begin());
+  }
+
+  template <typename Side>
+  void setSideLevel(std::vector<Block*>& blocks, std::size_t& levelsNumber, const PriceLevel& level) {
+    if (blocks.empty()) {
+      auto* block = createBlock();
+
+      block->levels[0] = level;
+      block->size = 1;
+      blocks.push_back(block);
+      levelsNumber++;
+
+      return;
+    }
+
+    auto blockIndex = (std::min)(findBlock<Side>(blocks, level.price), blocks.size() - 1);
+    auto position = findLevel<Side>(*blocks[blockIndex], level.price);
+
+    if (position < blocks[blockIndex]->size && isSamePrice(blocks[blockIndex]->levels[position].price, level.price)) {
+      getWritableBlock(blocks, blockIndex)->levels[position] = level;
+
+      return;
+    }
+
+    if (blocks[blockIndex]->size == BLOCK_CAPACITY) {
+      // The full block is split in halves
+      auto* first = getWritableBlock(blocks, blockIndex);
+      auto* second = createBlock();
+      constexpr auto half = BLOCK_CAPACITY / 2;
+
+      std::copy(first->levels.begin() + half, first->levels.end(), second->levels.begin());
+      second->size = BLOCK_CAPACITY - half;
+      first->size = half;
+      blocks.insert(blocks.begin() + static_cast<std::ptrdiff_t>(blockIndex) + 1, second);
+
+      if (position > half) {
+        blockIndex++;
+        position -= half;
+      }
+    }
+
+    auto* block = getWritableBlock(blocks, blockIndex);
+
+    std::copy_backward(block->levels.begin() + static_cast<std::ptrdiff_t>(position),
+                       block->levels.begin() + static_cast<std::ptrdiff_t>(block->size),
+                       block->levels.begin() + static_cast<std::ptrdiff_t>(block->size) + 1);
+    block->levels[position] = level;
+    block->size++;
+    levelsNumber++;
+  }
+
+  template <typename Side>
+  void removeSideLevel(std::vector<Block*>& blocks, std::size_t& levelsNumber, double price) {
+    auto blockIndex = findBlock<Side>(blocks, price);
+
+    if (blockIndex == blocks.size()) {
+      return;
+    }
+
+    auto position = findLevel<Side>(*blocks[blockIndex], price);
+
+    if (position == blocks[blockIndex]->size || !isSamePrice(blocks[blockIndex]->levels[position].price, price)) {
+      return;
+    }
+
+    levelsNumber--;
+
+    if (blocks[blockIndex]->size == 1) {
+      releaseBlock(blocks[blockIndex]);
+      blocks.erase(blocks.begin() + static_cast<std::ptrdiff_t>(blockIndex));
+
+      return;
+    }
+
+    auto* block = getWritableBlock(blocks, blockIndex);
+
+    std::copy(block->levels.begin() + static_cast<std::ptrdiff_t>(position) + 1,
+              block->levels.begin() + static_cast<std::ptrdiff_t>(block->size),
+              block->levels.begin() + static_cast<std::ptrdiff_t>(position));
+    block->size--;
+
+    // The small neighbours are merged, so the removals don't leave the many almost empty blocks
+    if (blockIndex + 1 < blocks.size() && block->size + blocks[blockIndex + 1]->size <= BLOCK_CAPACITY / 2) {
+      auto* nextBlock = blocks[blockIndex + 1];
+
+      std::copy_n(nextBlock->levels.begin(), nextBlock->size,
+                  block->levels.begin() + static_cast<std::ptrdiff_t>(block->size));
+      block->size += nextBlock->size;
+      releaseBlock(nextBlock);
+      blocks.erase(blocks.begin() + static_cast<std::ptrdiff_t>(blockIndex) + 1);
+    }
+  }
+
+  void rebuildSide(std::vector<Block*>& blocks, std::size_t& levelsNumber, const PriceLevelSideView& side) {
+    for (auto* block : blocks) {
+      releaseBlock(block);
+    }
+
+    blocks.clear();
+    levelsNumber = side.size();
+
+    for (std::size_t i = 0; i < side.size(); i += BLOCK_FILL) {
+      auto* block = createBlock();
+
+      block->size = (std::min)(BLOCK_FILL, side.size() - i);
+
+      for (std::size_t j = 0; j < block->size; j++) {
+        block->levels[j] = side[i + j];
+      }
+
+      blocks.push_back(block);
+    }
+  }
+
+  // The reclaimed versions and blocks are kept for the reuse
+  void reclaim() {
+    domain_.reclaim([this](void* object, EpochDomain::Deleter deleter) {
+      if (deleter == &deleteVersion) {
+        freeVersions_.push_back(static_cast<Version*>(object));
+      } else if (freeBlocks_.size() < MAX_FREE_BLOCKS) {
+        freeBlocks_.push_back(static_cast<Block*>(object));
+      } else {
+        deleter(object);
+      }
+    });
+  }
+
+  template <typename Consumer>
+  static void forEachLevel(const std::vector<Block*>& blocks, Consumer&& consumer) {
+    for (const auto* block : blocks) {
+      for (std::size_t i = 0; i < block->size; i++) {
+        consumer(block->levels[i]);
+      }
+    }
+  }
+
+ public:
+  // The pinned version of the book. The version is kept (not reused by the writer) until the object is destroyed, so
+  // the long reading delays the reuse of the memory of the replaced versions.
+  class ReadGuard final {
+    EpochDomain::Guard guard_{};
+    const Version* version_ = nullptr;
+
+   public:
+    ReadGuard() = default;
+
+    ReadGuard(EpochDomain::Guard&& guard, const Version* version) : guard_{std::move(guard)}, version_{version} {}
+
+    // The number of the publications of the version (0 - nothing is published yet)
+    [[nodiscard]] std::uint64_t getSequence() const { return version_ != nullptr ? version_->sequence : 0; }
+
+    [[nodiscard]] std::size_t getAsksNumber() const { return version_ != nullptr ? version_->asksNumber : 0; }
+
+    [[nodiscard]] std::size_t getBidsNumber() const { return version_ != nullptr ? version_->bidsNumber : 0; }
+
+    // Calls the consumer with every ask level (best-first)
+    template <typename Consumer>
+    void forEachAsk(Consumer&& consumer) const {
+      if (version_ != nullptr) {
+        forEachLevel(version_->asks, consumer);
+      }
+    }
+
+    // Calls the consumer with every bid level (best-first)
+    template <typename Consumer>
+    void forEachBid(Consumer&& consumer) const {
+      if (version_ != nullptr) {
+        forEachLevel(version_->bids, consumer);
+      }
+    }
+
+    // Copies the levels to the result (the vectors keep their capacity)
+    void copyTo(PriceLevelChanges& result) const {
+      result.asks.clear();
+      result.bids.clear();
+      result.asks.reserve(getAsksNumber());
+      result.bids.reserve(getBidsNumber());
+      forEachAsk([&result](const PriceLevel& pl) { result.asks.push_back(pl); });
+      forEachBid([&result](const PriceLevel& pl) { result.bids.push_back(pl); });
+    }
+  };
+
+  FullDepthPriceLevels() : current_{new Version{}} {}
+
+  FullDepthPriceLevels(const FullDepthPriceLevels&) = delete;
+  FullDepthPriceLevels& operator=(const FullDepthPriceLevels&) = delete;
+
+  // There must be no readers
+  ~FullDepthPriceLevels() {
+    const auto* current = current_.load(std::memory_order_relaxed);
+
+    for (auto* block : current->asks) {
+      delete block;
+    }
+
+    for (auto* block : current->bids) {
+      delete block;
+    }
+
+    delete current;
+
+    for (auto* block : freeBlocks_) {
+      delete block;
+    }
+
+    for (auto* version : freeVersions_) {
+      delete version;
+    }
+  }
+
+  // The writer. Starts the new version from the current one.
+  void beginUpdate() {
+    if (next_ != nullptr) {
+      return;
+    }
+
+    const auto* current = current_.load(std::memory_order_relaxed);
+
+    if (freeVersions_.empty()) {
+      next_ = new Version{};
+    } else {
+      next_ = freeVersions_.back();
+      freeVersions_.pop_back();
+    }
+
+    next_->sequence = current->sequence + 1;
+    next_->asks = current->asks;
+    next_->bids = current->bids;
+    next_->asksNumber = current->asksNumber;
+    next_->bidsNumber = current->bidsNumber;
+  }
+
+  // The writer (after beginUpdate). Adds or updates the level of the side.
+  void setLevel(bool isBid, const PriceLevel& level) {
+    if (isBid) {
+      setSideLevel<BidSide>(next_->bids, next_->bidsNumber, level);
+    } else {
+      setSideLevel<AskSide>(next_->asks, next_->asksNumber, level);
+    }
+  }
+
+  // The writer (after beginUpdate). Removes the level of the price of the side (if any).
+  void removeLevel(bool isBid, double price) {
+    if (isBid) {
+      removeSideLevel<BidSide>(next_->bids, next_->bidsNumber, price);
+    } else {
+      removeSideLevel<AskSide>(next_->asks, next_->asksNumber, price);
+    }
+  }
+
+  // The writer (after beginUpdate). Replaces all levels by the levels of the view (best-first), e.g. of the new book.
+  void rebuild(const PriceLevelBookView& view) {
+    rebuildSide(next_->asks, next_->asksNumber, view.asks);
+    rebuildSide(next_->bids, next_->bidsNumber, view.bids);
+  }
+
+  // The writer. Publishes the new version, retires the replaced one and reuses the versions and the blocks that no
+  // reader can read.
+  void publish() {
+    if (next_ == nullptr) {
+      return;
+    }
+
+    const auto* previous = current_.exchange(next_, std::memory_order_acq_rel);
+
+    next_ = nullptr;
+    domain_.retire(const_cast<Version*>(previous), &deleteVersion);
+    domain_.advance();
+    reclaim();
+  }
+
+  // The reader. Pins the current version. Can be called from any thread at any time.
+  [[nodiscard]] ReadGuard read() const {
+    auto guard = domain_.pin();
+    const auto* version = current_.load(std::memory_order_acquire);
+
+    return {std::move(guard), version};
+  }
+
+  // The number of the replaced versions and blocks that are not reused yet (the writer only)
+  [[nodiscard]] std::size_t getRetiredNumber() const { return domain_.getRetiredNumber(); }
+};
+
+}  // namespace dxf
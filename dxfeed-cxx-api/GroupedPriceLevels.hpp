@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "PriceLevel.hpp"
+
+namespace dxf {
+
+// The levels of the book grouped into the price buckets of one size (e.g. 0.25 or 1.00 for the depth charts). The
+// bucket of the bid level is the price rounded down to the bucket size, the bucket of the ask level is the price
+// rounded up, so the bucket is never better than its levels. The view is changed by the size deltas of the levels of
+// every transaction (see PriceLevelBookEngine::groupUpdates), so the regroup costs O(changed levels) instead of
+// O(depth), and takeChanges returns the net changes of the buckets since its previous call (as the changes of the
+// visible levels: the additions, the updates and the removals, best-first; the removals have the last reported sizes).
+// The moves of the levels inside one bucket that don't change its size are not reported.
+//
+// Usage:
+//   GroupedPriceLevels view{0.25};
+//
+//   view.addDelta(false, {100.13, 10.0, time});  // The ask bucket 100.25 grows by 10
+//   view.addDelta(true, {99.99, -5.0, time});    // The bid bucket 99.75 shrinks by 5
+//
+//   const auto& changes = view.takeChanges();
+class GroupedPriceLevels final {
+  // The sum of the sizes of the bucket is zero below it (the sums of the many deltas are not exact)
+  static constexpr double SIZE_EPSILON = 1e-9;
+  // The price is on the bucket boundary within this share of the bucket size
+  static constexpr double BOUNDARY_EPSILON = 1e-9;
+
+  struct Bucket {
+    double size = 0.0;
+    std::int64_t time = 0;
+    // The size of the last takeChanges (NaN - the bucket wasn't reported)
+    double reportedSize = std::numeric_limits<double>::quiet_NaN();
+    bool isTouched = false;
+  };
+
+  // The buckets by the index (the price / the bucket size), the empty ones are kept until the takeChanges
+  using Buckets = std::map<std::int64_t, Bucket>;
+
+  struct TouchedBucket {
+    bool isBid;
+    std::int64_t index;
+  };
+
+  double bucketSize_;
+  Buckets asks_{};
+  Buckets bids_{};
+  std::vector<TouchedBucket> touched_{};
+  PriceLevelChangesSet changes_{};
+
+  static bool isEmpty(double size) { return !(std::abs(size) >= SIZE_EPSILON); }
+
+  [[nodiscard]] PriceLevel toPriceLevel(std::int64_t index, double size, std::int64_t time) const {
+    return {static_cast<double>(index) * bucketSize_, size, time};
+  }
+
+  template <typename Side>
+  static void sort(std::vector<PriceLevel>& levels) {
+    std::sort(levels.begin(), levels.end(), Side{});
+  }
+
+  void collectBuckets(const Buckets& buckets, std::vector<PriceLevel>& result, bool isBid) const {
+    result.clear();
+
+    auto add = [this, &result](const auto& entry) {
+      if (!isEmpty(entry.second.size)) {
+        result.push_back(toPriceLevel(entry.first, entry.second.size, entry.second.time));
+      }
+    };
+
+    if (isBid) {
+      std::for_each(buckets.rbegin(), buckets.rend(), add);
+    } else {
+      std::for_each(buckets.begin(), buckets.end(), add);
+    }
+  }
+
+ public:
+  explicit GroupedPriceLevels(double bucketSize) : bucketSize_{bucketSize > 0.0 ? bucketSize : 1.0} {}
+
+  [[nodiscard]] double getBucketSize() const { return bucketSize_; }
+
+  // The index of the bucket of the price of the side
+  [[nodiscard]] std::int64_t getBucketIndex(bool isBid, double price) const {
+    auto quotient = price / bucketSize_;
+    auto nearest = std::round(quotient);
+
+    if (std::abs(quotient - nearest) < BOUNDARY_EPSILON) {
+      return static_cast<std::int64_t>(nearest);
+    }
+
+    return static_cast<std::int64_t>(isBid ? std::floor(quotient) : std::ceil(quotient));
+  }
+
+  // Adds the size delta of the level (the price, the signed change of the size, the time) to its bucket. Not a finite
+  // price is skipped.
+  void addDelta(bool isBid, const PriceLevel& delta) {
+    if (!std::isfinite(delta.price)) {
+      return;
+    }
+
+    auto index = getBucketIndex(isBid, delta.price);
+    auto& bucket = (isBid ? bids_ : asks_)[index];
+
+    bucket.size += delta.size;
+    bucket.time = (std::max)(bucket.time, delta.time);
+
+    if (!bucket.isTouched) {
+      bucket.isTouched = true;
+      touched_.push_back({isBid, index});
+    }
+  }
+
+  // Replaces the levels of the view (the full regroup, e.g. after the restore of the book), the difference from the
+  // previous buckets is reported by the next takeChanges
+  void rebuild(const std::vector<PriceLevel>& asks, const std::vector<PriceLevel>& bids) {
+    for (auto* buckets : {&asks_, &bids_}) {
+      auto isBid = buckets == &bids_;
+
+      for (auto& [index, bucket] : *buckets) {
+        bucket.size = 0.0;
+
+        if (!bucket.isTouched) {
+          bucket.isTouched = true;
+          touched_.push_back({isBid, index});
+        }
+      }
+    }
+
+    for (const auto& level : asks) {
+      addDelta(false, level);
+    }
+
+    for (const auto& level : bids) {
+      addDelta(true, level);
+    }
+  }
+
+  // The buckets are changed since the last takeChanges
+  [[nodiscard]] bool hasChanges() const { return !touched_.empty(); }
+
+  // Returns the net changes of the buckets since the previous call. The result is valid until the next call.
+  const PriceLevelChangesSet& takeChanges() {
+    for (auto* side : {&changes_.additions, &changes_.updates, &changes_.removals}) {
+      side->asks.clear();
+      side->bids.clear();
+    }
+
+    for (const auto& touched : touched_) {
+      auto& buckets = touched.isBid ? bids_ : asks_;
+      auto found = buckets.find(touched.index);
+      auto& bucket = found->second;
+      auto wasReported = !std::isnan(bucket.reportedSize);
+
+      bucket.isTouched = false;
+
+      if (isEmpty(bucket.size)) {
+        if (wasReported) {
+          auto& removals = touched.isBid ? changes_.removals.bids : changes_.removals.asks;
+
+          removals.push_back(toPriceLevel(touched.index, bucket.reportedSize, bucket.time));
+        }
+
+        buckets.erase(found);
+
+        continue;
+      }
+
+      if (!wasReported) {
+        (touched.isBid ? changes_.additions.bids : changes_.additions.asks)
+          .push_back(toPriceLevel(touched.index, bucket.size, bucket.time));
+      } else if (bucket.size != bucket.reportedSize) {
+        (touched.isBid ? changes_.updates.bids : changes_.updates.asks)
+          .push_back(toPriceLevel(touched.index, bucket.size, bucket.time));
+      }
+
+      bucket.reportedSize = bucket.size;
+    }
+
+    touched_.clear();
+
+    for (auto* side : {&changes_.additions, &changes_.updates, &changes_.removals}) {
+      sort<AskSide>(side->asks);
+      sort<BidSide>(side->bids);
+    }
+
+    return changes_;
+  }
+
+  // The non-empty buckets of the sides, best-first (O(buckets))
+  void getBuckets(std::vector<PriceLevel>& asks, std::vector<PriceLevel>& bids) const {
+    collectBuckets(asks_, asks, false);
+    collectBuckets(bids_, bids, true);
+  }
+
+  [[nodiscard]] PriceLevelChanges getBuckets() const {
+    PriceLevelChanges result{};
+
+    getBuckets(result.asks, result.bids);
+
+    return result;
+  }
+
+  // Groups the levels of the side (best-first) into the buckets of the size: the full O(depth) regroup (e.g. for the
+  // comparison with the view). The result is best-first.
+  static void group(const std::vector<PriceLevel>& levels, bool isBid, double bucketSize,
+                    std::vector<PriceLevel>& result) {
+    GroupedPriceLevels grouping{bucketSize};
+
+    result.clear();
+
+    for (const auto& level : levels) {
+      auto price = static_cast<double>(grouping.getBucketIndex(isBid, level.price)) * grouping.bucketSize_;
+
+      if (!result.empty() && result.back().price == price) {
+        result.back().size += level.size;
+        result.back().time = (std::max)(result.back().time, level.time);
+      } else {
+        result.push_back({price, level.size, level.time});
+      }
+    }
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <array>
+#include <concepts>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ConnectionPool.hpp"
+#include "EventCodec.hpp"
+#include "EventReceiver.hpp"
+#include "MarketEvents.hpp"
+
+namespace dxf {
+
+// The events of several types fetched together (see HistoryDataProvider), by the type and the symbol
+template <typename... Events>
+struct HistoryData {
+  std::tuple<SymbolMap<std::vector<Events>>...> events{};
+
+  template <typename Event>
+  [[nodiscard]] SymbolMap<std::vector<Event>> &get() {
+    return std::get<SymbolMap<std::vector<Event>>>(events);
+  }
+
+  template <typename Event>
+  [[nodiscard]] const SymbolMap<std::vector<Event>> &get() const {
+    return std::get<SymbolMap<std::vector<Event>>>(events);
+  }
+};
+
+namespace detail {
+
+template <typename... Events>
+struct HistoryResult {
+  using Type = HistoryData<Events...>;
+};
+
+// The result of one type is the map of its events (the same as before the several types)
+template <typename Event>
+struct HistoryResult<Event> {
+  using Type = SymbolMap<std::vector<Event>>;
+};
+
+template <typename... Events>
+constexpr bool hasUniqueEventTypes() {
+  constexpr std::array<int, sizeof...(Events)> eventTypes{Events::EVENT_TYPE...};
+
+  for (std::size_t i = 0; i < eventTypes.size(); i++) {
+    for (std::size_t j = i + 1; j < eventTypes.size(); j++) {
+      if (eventTypes[i] == eventTypes[j]) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+}  // namespace detail
+
+// The provider of the events of any plain event types with the field mapping (see MarketEvents.hpp, e.g.
+// HistoryDataProvider<Candle> or HistoryDataProvider<Candle, Order, Series, Greeks>). The events are decoded by the
+// EventCodec on the connection thread. The several types are received by one connection and one subscription of the
+// mask of the types (the time subscription if any of them is the time series): the events are passed to the typed
+// containers by the listener of their type, the type is chosen once per call of the C API, not per event.
+template <typename... Events>
+struct HistoryDataProvider {
+  static_assert(sizeof...(Events) > 0, "At least one event type is required");
+  static_assert(detail::hasUniqueEventTypes<Events...>(), "The event types must be unique");
+
+  // The mask of the C API types of the subscription
+  static constexpr int EVENT_TYPES = (Events::EVENT_TYPE | ...);
+  static constexpr bool IS_TIME_SERIES = (Events::IS_TIME_SERIES || ...);
+
+  // SymbolMap<std::vector<Event>> for one type, HistoryData<Events...> for several types
+  using ResultType = typename detail::HistoryResult<Events...>::Type;
+  using ResultFutureType = std::future<ResultType>;
+  // The receiver of the events of the streaming mode of one type
+  using SinkType = std::function<void(std::tuple_element_t<0, std::tuple<Events...>> &&)>;
+  using HistoryCompletion = EventReceiver::HistoryCompletion;
+
+ private:
+  template <typename Event>
+  using BatchSinkType = EventReceiver::BatchSinkType<typename Event::CEventType>;
+
+  // The collected events of one type: the requested symbols are found by their positions, so their events are appended
+  // under their own locks
+  template <typename Event>
+  struct Collector {
+    struct Slot {
+      std::mutex mutex{};
+      std::vector<Event> events{};
+    };
+
+    std::vector<Slot> slots{};
+    std::mutex unknownEventsMutex{};
+    SymbolMap<std::vector<Event>> events{};
+
+    // The collectors are not movable, so they are created in place and sized after
+    void init(std::size_t symbolsNumber) { slots = std::vector<Slot>(symbolsNumber); }
+
+    BatchSinkType<Event> getSink() {
+      return [this](std::size_t symbolIndex, const Symbol &symbol, const typename Event::CEventType *cEvents,
+                    std::size_t count) {
+        if (symbolIndex != EventReceiver::UNKNOWN_SYMBOL) {
+          std::lock_guard guard(slots[symbolIndex].mutex);
+
+          for (std::size_t i = 0; i < count; i++) {
+            slots[symbolIndex].events.push_back(EventCodec<Event>::decode(symbol, cEvents[i]));
+          }
+        } else {
+          std::lock_guard guard(unknownEventsMutex);
+          auto &symbolEvents = events[symbol];
+
+          for (std::size_t i = 0; i < count; i++) {
+            symbolEvents.push_back(EventCodec<Event>::decode(symbol, cEvents[i]));
+          }
+        }
+      };
+    }
+
+    // Moves the events of the requested symbols to the result
+    SymbolMap<std::vector<Event>> takeEvents(const std::vector<std::string> &symbols) {
+      for (std::size_t i = 0; i < symbols.size(); i++) {
+        if (!slots[i].events.empty()) {
+          auto &symbolEvents = events[Symbol::valueOf(symbols[i])];
+
+          std::move(slots[i].events.begin(), slots[i].events.end(), std::back_inserter(symbolEvents));
+        }
+      }
+
+      return std::move(events);
+    }
+  };
+
+  static bool receive(const std::string &address, const std::vector<std::string> &symbols,
+                      const std::tuple<BatchSinkType<Events>...> &sinks, int timeout, ConnectionPool *pool,
+                      const std::optional<HistoryCompletion> &completion) {
+    if constexpr (sizeof...(Events) == 1) {
+      using Event = std::tuple_element_t<0, std::tuple<Events...>>;
+
+      return EventReceiver::receiveBatches<typename Event::CEventType>(
+        Event::EVENT_TYPE, Event::IS_TIME_SERIES, address, symbols, std::get<0>(sinks), timeout, pool, completion);
+    } else {
+      return EventReceiver::receiveMultiple<typename Events::CEventType...>(
+        {Events::EVENT_TYPE...}, IS_TIME_SERIES, address, symbols, sinks, timeout, pool, completion);
+    }
+  }
+
+ public:
+  // Collects all events of the symbols until the disconnect or the timeout (ms, 0 - no timeout). pool - the pool that
+  // shares the connection with the other runs (nullptr - the run has its own connection); it must outlive the run.
+  // completion - complete the run as soon as all symbols are caught up by all types (see HistoryCompletion).
+  static ResultFutureType run(const std::string &address, const std::vector<std::string> &symbols, int timeout = 0,
+                              ConnectionPool *pool = nullptr,
+                              std::optional<HistoryCompletion> completion = std::nullopt) {
+    return std::async(std::launch::async, [address, symbols, timeout, pool, completion = std::move(completion)]() {
+      std::tuple<Collector<Events>...> collectors{};
+      auto sinks = std::apply(
+        [&symbols](auto &...typeCollectors) {
+          (typeCollectors.init(symbols.size()), ...);
+
+          return std::tuple<BatchSinkType<Events>...>{typeCollectors.getSink()...};
+        },
+        collectors);
+
+      receive(address, symbols, sinks, timeout, pool, completion);
+
+      if constexpr (sizeof...(Events) == 1) {
+        return std::get<0>(collectors).takeEvents(symbols);
+      } else {
+        return ResultType{{std::get<Collector<Events>>(collectors).takeEvents(symbols)...}};
+      }
+    });
+  }
+
+  // The streaming mode: passes every event to the sink (on the connection thread) as it arrives instead of collecting
+  // the events. The sink is called with the events of every type (e.g. the overloaded lambdas or the generic one). The
+  // future returns false if the connection or the subscription can't be created. The other arguments are the same as
+  // the run ones.
+  template <typename Sink>
+    requires(std::invocable<Sink &, Events &&> && ...)
+  static std::future<bool> runStreaming(const std::string &address, const std::vector<std::string> &symbols,
+                                        Sink sink, int timeout = 0, ConnectionPool *pool = nullptr,
+                                        std::optional<HistoryCompletion> completion = std::nullopt) {
+    return std::async(std::launch::async, [address, symbols, sink = std::move(sink), timeout, pool,
+                                           completion = std::move(completion)]() mutable {
+      std::tuple<BatchSinkType<Events>...> sinks{
+        [&sink](std::size_t, const Symbol &symbol, const typename Events::CEventType *cEvents, std::size_t count) {
+          for (std::size_t i = 0; i < count; i++) {
+            sink(EventCodec<Events>::decode(symbol, cEvents[i]));
+          }
+        }...};
+
+      return receive(address, symbols, sinks, timeout, pool, completion);
+    });
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace dxf {
+
+// The seen event indexes of one symbol for the de-duplication at ingest (e.g. the events that arrive from several
+// endpoints or are resent after the reconnect): the sliding bitmap of the WINDOW_SIZE indexes up to the highest seen
+// one, and the hash of the 64-index blocks (the bitmap words) of the older indexes. The index in the window is tested
+// and set in O(1) without hashing; the window moves up with the highest index, and its words that leave it are moved
+// to the hash, so the de-duplication stays exact. The dense indexes take about 1 bit each; the sparse ones (e.g. the
+// time-based indexes of the different milliseconds) take one hash entry per block. Not thread-safe.
+class IndexDeduplicator final {
+ public:
+  static constexpr std::size_t WINDOW_WORDS = 4;
+  static constexpr std::uint64_t WINDOW_SIZE = WINDOW_WORDS * 64;
+
+ private:
+  // The block (index / 64) of the first word of the window
+  std::uint64_t baseBlock_ = 0;
+  bool isEmpty_ = true;
+  // window_[i] - the indexes of the block baseBlock_ + i
+  std::array<std::uint64_t, WINDOW_WORDS> window_{};
+  // The words of the blocks below the window
+  std::unordered_map<std::uint64_t, std::uint64_t> blocks_{};
+  std::size_t duplicatesNumber_ = 0;
+
+  // Moves the window up to the block, the words that leave it are moved to the hash
+  void slide(std::uint64_t baseBlock) {
+    auto shift = baseBlock - baseBlock_;
+    auto leavingWordsNumber = static_cast<std::size_t>((std::min)(shift, std::uint64_t{WINDOW_WORDS}));
+
+    for (std::size_t i = 0; i < leavingWordsNumber; i++) {
+      if (window_[i] != 0) {
+        blocks_[baseBlock_ + i] |= window_[i];
+      }
+    }
+
+    for (std::size_t i = 0; i < WINDOW_WORDS; i++) {
+      window_[i] = i + leavingWordsNumber < WINDOW_WORDS ? window_[i + leavingWordsNumber] : 0;
+    }
+
+    baseBlock_ = baseBlock;
+  }
+
+  bool testAndSet(std::uint64_t &word, std::uint64_t bit) {
+    if ((word & bit) != 0) {
+      duplicatesNumber_++;
+
+      return false;
+    }
+
+    word |= bit;
+
+    return true;
+  }
+
+ public:
+  // Returns true if the index is seen first time (the event is kept), false - the duplicate (the event is dropped)
+  bool insert(std::uint64_t index) {
+    auto block = index >> 6;
+    auto bit = std::uint64_t{1} << (index & 63);
+
+    if (isEmpty_) {
+      // The first index is the top of the window: the history arrives from the newest events
+      baseBlock_ = block >= WINDOW_WORDS - 1 ? block - (WINDOW_WORDS - 1) : 0;
+      isEmpty_ = false;
+    } else if (block >= baseBlock_ + WINDOW_WORDS) {
+      slide(block - (WINDOW_WORDS - 1));
+    }
+
+    if (block >= baseBlock_) {
+      return testAndSet(window_[block - baseBlock_], bit);
+    }
+
+    return testAndSet(blocks_[block], bit);
+  }
+
+  // The number of the dropped duplicates
+  [[nodiscard]] std::size_t getDuplicatesNumber() const { return duplicatesNumber_; }
+
+  // The heap bytes held by the hash of the blocks (approximately)
+  [[nodiscard]] std::size_t getMemoryUsage() const {
+    return blocks_.size() * (sizeof(std::pair<const std::uint64_t, std::uint64_t>) + 2 * sizeof(void *)) +
+           blocks_.bucket_count() * sizeof(void *);
+  }
+};
+
+}  // namespace dxf
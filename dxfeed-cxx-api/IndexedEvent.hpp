@@ -1,21 +1,12 @@
 #pragma once
 
 #include <cstdint>
-#include <string>
 
 #include "EventType.hpp"
+#include "IndexedEventSource.hpp"
 
 namespace dxf {
 
-struct IndexedEventSource {
-  static const IndexedEventSource DEFAULT;
-
-  std::uint32_t id;
-  std::string name;
-};
-
-const IndexedEventSource IndexedEventSource::DEFAULT = IndexedEventSource{0, "DEFAULT"};
-
 template <typename SymbolType>
 struct IndexedEvent : public virtual EventType<SymbolType> {
   static const std::uint32_t TX_PENDING = 0x01;
@@ -25,6 +16,7 @@ struct IndexedEvent : public virtual EventType<SymbolType> {
   static const std::uint32_t SNAPSHOT_SNIP = 0x10;
   static const std::uint32_t SNAPSHOT_MODE = 0x40;
 
+  // The interned source (see IndexedEventSource)
   virtual IndexedEventSource getSource() = 0;
 
   virtual std::uint32_t getEventFlags() = 0;
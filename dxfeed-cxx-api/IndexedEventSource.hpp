@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace dxf {
+
+// The process-wide registry of the names of the event sources (e.g. "NTV", "DEX"). Every distinct name is kept once,
+// the sources are never removed (the set of the sources is small). The id 0 is the DEFAULT source.
+class EventSourceRegistry final {
+  struct NameHash {
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+  };
+
+  mutable std::mutex mutex_{};
+  // The references to the names are stable
+  std::deque<std::string> names_{};
+  std::unordered_map<std::string_view, std::uint32_t, NameHash, std::equal_to<>> ids_{};
+
+  EventSourceRegistry() { intern("DEFAULT"); }
+
+ public:
+  static EventSourceRegistry& getInstance() {
+    static EventSourceRegistry instance{};
+
+    return instance;
+  }
+
+  // Returns the id of the name, registers the new name
+  std::uint32_t intern(std::string_view name) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (auto found = ids_.find(name); found != ids_.end()) {
+      return found->second;
+    }
+
+    auto id = static_cast<std::uint32_t>(names_.size());
+
+    ids_.emplace(names_.emplace_back(name), id);
+
+    return id;
+  }
+
+  // Returns the empty name if there is no such id
+  [[nodiscard]] const std::string& getName(std::uint32_t id) const {
+    static const std::string emptyName{};
+
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return id < names_.size() ? names_[id] : emptyName;
+  }
+
+  [[nodiscard]] std::size_t getSize() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return names_.size();
+  }
+};
+
+// The interned source of the indexed events: the id in the EventSourceRegistry. The source is copied and compared as
+// the integer, the name is looked up only on request.
+class IndexedEventSource final {
+  std::uint32_t id_ = 0;
+
+  explicit constexpr IndexedEventSource(std::uint32_t id) : id_{id} {}
+
+ public:
+  static const IndexedEventSource DEFAULT;
+
+  constexpr IndexedEventSource() = default;
+
+  // Returns the source of the name (registers the new name)
+  static IndexedEventSource valueOf(std::string_view name) {
+    return IndexedEventSource{EventSourceRegistry::getInstance().intern(name)};
+  }
+
+  [[nodiscard]] constexpr std::uint32_t getId() const { return id_; }
+
+  [[nodiscard]] const std::string& getName() const { return EventSourceRegistry::getInstance().getName(id_); }
+
+  friend constexpr bool operator==(IndexedEventSource a, IndexedEventSource b) { return a.id_ == b.id_; }
+};
+
+inline constexpr IndexedEventSource IndexedEventSource::DEFAULT{};
+
+}  // namespace dxf
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "StringConverter.hpp"
+
+namespace dxf {
+
+// The string that keeps up to Capacity chars in place (the short field values such as the sale conditions or the
+// MPIDs), so the object that holds it is one contiguous block. The longer strings are kept on the heap.
+template <std::size_t Capacity>
+class InlineString final {
+  static_assert(Capacity > 0 && Capacity < 255, "The capacity must be in [1, 254]");
+
+  // The size of the heap string
+  static constexpr std::uint8_t OVERFLOW_SIZE = 255;
+
+  // The chars and the terminating zero
+  char data_[Capacity + 1]{};
+  std::uint8_t size_ = 0;
+  std::unique_ptr<std::string> overflow_{};
+
+  void setOverflow(std::string s) {
+    overflow_ = std::make_unique<std::string>(std::move(s));
+    size_ = OVERFLOW_SIZE;
+    data_[0] = '\0';
+  }
+
+ public:
+  InlineString() = default;
+
+  InlineString(std::string_view s) { assign(s); }
+
+  explicit InlineString(const char* s) : InlineString(std::string_view{s}) {}
+
+  explicit InlineString(const std::string& s) : InlineString(std::string_view{s}) {}
+
+  InlineString(const InlineString& other) { assign(other.view()); }
+
+  InlineString(InlineString&& other) noexcept : size_{other.size_}, overflow_{std::move(other.overflow_)} {
+    std::memcpy(data_, other.data_, sizeof(data_));
+    other.clear();
+  }
+
+  InlineString& operator=(const InlineString& other) {
+    if (this != &other) {
+      assign(other.view());
+    }
+
+    return *this;
+  }
+
+  InlineString& operator=(InlineString&& other) noexcept {
+    if (this != &other) {
+      std::memcpy(data_, other.data_, sizeof(data_));
+      size_ = other.size_;
+      overflow_ = std::move(other.overflow_);
+      other.clear();
+    }
+
+    return *this;
+  }
+
+  InlineString& operator=(std::string_view s) {
+    assign(s);
+
+    return *this;
+  }
+
+  void clear() {
+    overflow_.reset();
+    size_ = 0;
+    data_[0] = '\0';
+  }
+
+  void assign(std::string_view s) {
+    if (s.size() > Capacity) {
+      setOverflow(std::string(s));
+
+      return;
+    }
+
+    overflow_.reset();
+    std::memcpy(data_, s.data(), s.size());
+    data_[s.size()] = '\0';
+    size_ = static_cast<std::uint8_t>(s.size());
+  }
+
+  // Converts the UTF-16 (or UTF-32 if the wchar_t is 32-bit) string to UTF-8 in place (nullptr - the empty string).
+  // The invalid string is converted to the empty one.
+  void assignUtf16(const wchar_t* utf16) {
+    clear();
+
+    if (utf16 == nullptr) {
+      return;
+    }
+
+    std::size_t size = 0;
+
+    for (const auto* c = utf16; *c != L'\0'; c++) {
+      auto codePoint = static_cast<std::uint32_t>(*c);
+
+      if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+        auto low = static_cast<std::uint32_t>(c[1]);
+
+        if (low < 0xDC00 || low > 0xDFFF) {
+          data_[0] = '\0';
+
+          return;
+        }
+
+        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+        c++;
+      } else if ((codePoint >= 0xDC00 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF) {
+        data_[0] = '\0';
+
+        return;
+      }
+
+      auto length = codePoint < 0x80 ? 1 : codePoint < 0x800 ? 2 : codePoint < 0x10000 ? 3 : 4;
+
+      if (size + length > Capacity) {
+        // The rare long string is converted by the generic converter
+        setOverflow(StringConverter::wStringToUtf8(utf16));
+
+        return;
+      }
+
+      if (length == 1) {
+        data_[size++] = static_cast<char>(codePoint);
+      } else if (length == 2) {
+        data_[size++] = static_cast<char>(0xC0 | (codePoint >> 6));
+        data_[size++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+      } else if (length == 3) {
+        data_[size++] = static_cast<char>(0xE0 | (codePoint >> 12));
+        data_[size++] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        data_[size++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+      } else {
+        data_[size++] = static_cast<char>(0xF0 | (codePoint >> 18));
+        data_[size++] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        data_[size++] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        data_[size++] = static_cast<char>(0x80 | (codePoint & 0x3F));
+      }
+    }
+
+    data_[size] = '\0';
+    size_ = static_cast<std::uint8_t>(size);
+  }
+
+  static InlineString fromUtf16(const wchar_t* utf16) {
+    InlineString result{};
+
+    result.assignUtf16(utf16);
+
+    return result;
+  }
+
+  // Returns true if the string is kept in place
+  [[nodiscard]] bool isInline() const { return size_ != OVERFLOW_SIZE; }
+
+  [[nodiscard]] std::size_t size() const { return isInline() ? size_ : overflow_->size(); }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+  [[nodiscard]] const char* c_str() const { return isInline() ? data_ : overflow_->c_str(); }
+
+  [[nodiscard]] std::string_view view() const {
+    return isInline() ? std::string_view{data_, size_} : std::string_view{*overflow_};
+  }
+
+  operator std::string_view() const { return view(); }
+
+  [[nodiscard]] std::string toString() const { return std::string(view()); }
+
+  friend bool operator==(const InlineString& a, const InlineString& b) { return a.view() == b.view(); }
+
+  friend bool operator==(const InlineString& a, std::string_view b) { return a.view() == b; }
+
+  template <typename OutStream>
+  friend OutStream& operator<<(OutStream& os, const InlineString& s) {
+    os << s.view();
+
+    return os;
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,570 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CpuFeatures.hpp"
+#include "MappedFile.hpp"
+#include "SymbolSubscription.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The records of the IPF file that are loaded: the empty list is any type or any exchange
+struct IpfSymbolFilter {
+  // The record types (the first field, e.g. STOCK, ETF, FUTURE)
+  std::vector<std::string> types{};
+  // The exchanges of the record: the MIC of the primary listing (OPOL) or any of the EXCHANGES list (e.g. XNAS)
+  std::vector<std::string> exchanges{};
+
+  // Parses the "types=STOCK,ETF;exchanges=XNAS,ARCX" (any part may be omitted)
+  static IpfSymbolFilter parse(std::string_view filter) {
+    IpfSymbolFilter result{};
+
+    auto split = [](std::string_view list, char separator, auto&& onItem) {
+      while (!list.empty()) {
+        auto next = list.find(separator);
+
+        if (auto item = list.substr(0, next); !item.empty()) {
+          onItem(item);
+        }
+
+        list = next == std::string_view::npos ? std::string_view{} : list.substr(next + 1);
+      }
+    };
+
+    split(filter, ';', [&result, &split](std::string_view option) {
+      if (option.starts_with("types=")) {
+        split(option.substr(6), ',', [&result](std::string_view type) { result.types.emplace_back(type); });
+      } else if (option.starts_with("exchanges=")) {
+        split(option.substr(10), ',', [&result](std::string_view mic) { result.exchanges.emplace_back(mic); });
+      }
+    });
+
+    return result;
+  }
+
+  [[nodiscard]] bool acceptsType(std::string_view type) const {
+    return types.empty() || std::find(types.begin(), types.end(), type) != types.end();
+  }
+
+  // opol - the primary listing, exchanges - the ';'-separated list of the record
+  [[nodiscard]] bool acceptsExchanges(std::string_view opol, std::string_view recordExchanges) const {
+    if (exchanges.empty()) {
+      return true;
+    }
+
+    for (const auto& mic : exchanges) {
+      if (mic == opol) {
+        return true;
+      }
+
+      for (auto list = recordExchanges; !list.empty();) {
+        auto next = list.find(';');
+
+        if (list.substr(0, next) == mic) {
+          return true;
+        }
+
+        list = next == std::string_view::npos ? std::string_view{} : list.substr(next + 1);
+      }
+    }
+
+    return false;
+  }
+};
+
+// Finds the delimiters of the IPF lines (',', '\n' and '"') by the blocks of 32 bytes: the block is compared at once
+// (AVX2, two SSE2 or two NEON comparisons, the scalar loop on the other CPUs and for the tail) into the bit mask, and
+// the delimiters are taken from the mask one by one, so the fields are found without the byte loop.
+class IpfDelimiterScanner final {
+  static constexpr std::size_t BLOCK_SIZE = 32;
+
+  const char* block_;
+  const char* end_;
+  // The delimiters of the block that are not taken yet
+  std::uint32_t mask_;
+
+  static std::uint32_t scanScalar(const char* block, std::size_t size) {
+    std::uint32_t result = 0;
+
+    for (std::size_t i = 0; i < size; i++) {
+      if (block[i] == ',' || block[i] == '\n' || block[i] == '"') {
+        result |= 1U << i;
+      }
+    }
+
+    return result;
+  }
+
+#ifdef DXFCXX_CPU_X86
+  static std::uint32_t scanSse2(const char* block) {
+    auto scanHalf = [](const char* half) {
+      auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(half));
+      auto delimiters = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(',')),
+                                                  _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))),
+                                     _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')));
+
+      return static_cast<std::uint32_t>(_mm_movemask_epi8(delimiters)) & 0xFFFFU;
+    };
+
+    return scanHalf(block) | (scanHalf(block + 16) << 16U);
+  }
+
+  DXFCXX_TARGET_AVX2 static std::uint32_t scanAvx2(const char* block) {
+    auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    auto delimiters = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(',')),
+                                                      _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'))),
+                                      _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('"')));
+
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(delimiters));
+  }
+#elif defined(DXFCXX_CPU_NEON)
+  static std::uint32_t scanNeon(const char* block) {
+    auto scanHalf = [](const char* half) {
+      auto bytes = vld1q_u8(reinterpret_cast<const std::uint8_t*>(half));
+      auto delimiters =
+        vorrq_u8(vorrq_u8(vceqq_u8(bytes, vdupq_n_u8(',')), vceqq_u8(bytes, vdupq_n_u8('\n'))),
+                 vceqq_u8(bytes, vdupq_n_u8('"')));
+
+      return detail::movemaskNeon(delimiters);
+    };
+
+    return scanHalf(block) | (scanHalf(block + 16) << 16U);
+  }
+#endif
+
+  [[nodiscard]] std::uint32_t scan(const char* block) const {
+    auto size = static_cast<std::size_t>(end_ - block);
+
+    if (size < BLOCK_SIZE) {
+      return scanScalar(block, size);
+    }
+
+#ifdef DXFCXX_CPU_X86
+    static const bool hasAvx2 = CpuFeatures::hasAvx2();
+
+    return hasAvx2 ? scanAvx2(block) : scanSse2(block);
+#elif defined(DXFCXX_CPU_NEON)
+    return scanNeon(block);
+#else
+    return scanScalar(block, BLOCK_SIZE);
+#endif
+  }
+
+ public:
+  IpfDelimiterScanner(const char* begin, const char* end) : block_{begin}, end_{end}, mask_{0} { reset(begin); }
+
+  // Continues the scan from the position
+  void reset(const char* position) {
+    block_ = position;
+    mask_ = position < end_ ? scan(position) : 0;
+  }
+
+  // Returns the next delimiter or the end
+  const char* next() {
+    while (mask_ == 0) {
+      block_ += BLOCK_SIZE;
+
+      if (block_ >= end_) {
+        block_ = end_;
+
+        return end_;
+      }
+
+      mask_ = scan(block_);
+    }
+
+    auto result = block_ + std::countr_zero(mask_);
+
+    mask_ &= mask_ - 1;
+
+    return result;
+  }
+};
+
+// The symbol universe of the IPF file (the instrument profiles): the distinct symbols of the records that pass the
+// filter, in the order of the file, interned (see SymbolTable) and ready for the bulk subscription.
+//
+// The columns are located by the names of the headers of the record types ("#STOCK::=TYPE,SYMBOL,...,OPOL,EXCHANGES"),
+// the records of the types without the header have the symbol in the second field. The quoted fields ("...") may have
+// the commas. The file is mapped (see MappedFile) and split into the line-aligned chunks parsed on the threads by the
+// headers at the beginning of the file; the file that redefines the headers later is parsed again on the calling
+// thread.
+class IpfSymbolUniverse final {
+  static constexpr std::size_t NO_COLUMN = static_cast<std::size_t>(-1);
+  // The chunks are not smaller, so the small files are parsed on the calling thread
+  static constexpr std::size_t MIN_CHUNK_SIZE = 1U << 20U;
+
+  // The columns of the record type
+  struct RecordLayout {
+    std::string type{};
+    std::size_t symbolColumn = 1;
+    std::size_t opolColumn = NO_COLUMN;
+    std::size_t exchangesColumn = NO_COLUMN;
+    // The last column that is read (the rest of the line is skipped)
+    std::size_t lastColumn = 1;
+
+    friend bool operator==(const RecordLayout&, const RecordLayout&) = default;
+  };
+
+  std::vector<Symbol> symbols_;
+  std::size_t recordsNumber_;
+
+  IpfSymbolUniverse() : symbols_{}, recordsNumber_{0} {}
+
+  static std::string_view trimLine(std::string_view line) {
+    while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) {
+      line.remove_suffix(1);
+    }
+
+    return line;
+  }
+
+  static const char* skipLine(const char* begin, const char* end) {
+    auto newline = static_cast<const char*>(std::memchr(begin, '\n', static_cast<std::size_t>(end - begin)));
+
+    return newline == nullptr ? end : newline + 1;
+  }
+
+  // Parses the header line ("#TYPE::=COLUMN,COLUMN,..."). Returns false if the line is the comment.
+  static bool parseHeader(std::string_view line, RecordLayout& layout) {
+    auto definition = line.find("::=");
+
+    if (definition == std::string_view::npos || definition < 2) {
+      return false;
+    }
+
+    layout = RecordLayout{std::string(line.substr(1, definition - 1)), NO_COLUMN, NO_COLUMN, NO_COLUMN, 0};
+
+    auto columns = trimLine(line.substr(definition + 3));
+
+    for (std::size_t column = 0; !columns.empty(); column++) {
+      auto next = columns.find(',');
+      auto name = columns.substr(0, next);
+
+      // The typed column ("NAME:TYPE")
+      name = name.substr(0, name.find(':'));
+
+      if (name == "SYMBOL") {
+        layout.symbolColumn = column;
+      } else if (name == "OPOL") {
+        layout.opolColumn = column;
+      } else if (name == "EXCHANGES") {
+        layout.exchangesColumn = column;
+      }
+
+      columns = next == std::string_view::npos ? std::string_view{} : columns.substr(next + 1);
+    }
+
+    for (auto column : {layout.symbolColumn, layout.opolColumn, layout.exchangesColumn}) {
+      if (column != NO_COLUMN) {
+        layout.lastColumn = (std::max)(layout.lastColumn, column);
+      }
+    }
+
+    return layout.symbolColumn != NO_COLUMN;
+  }
+
+  static const RecordLayout* findLayout(const std::vector<RecordLayout>& layouts, std::string_view type) {
+    for (const auto& layout : layouts) {
+      if (layout.type == type) {
+        return &layout;
+      }
+    }
+
+    return nullptr;
+  }
+
+  // Parses the lines of the [begin, end) into the symbols. The headers update the layouts if canDefine, otherwise
+  // the header that differs from the layouts stops the parsing and false is returned.
+  template <typename OnSymbol>
+  static bool parseLines(const char* begin, const char* end, const IpfSymbolFilter& filter,
+                         std::vector<RecordLayout>& layouts, bool canDefine, OnSymbol&& onSymbol,
+                         std::size_t& recordsNumber) {
+    static const RecordLayout defaultLayout{};
+
+    IpfDelimiterScanner scanner{begin, end};
+    std::vector<std::string_view> fields{};
+
+    for (auto line = begin; line < end;) {
+      if (*line == '\n' || *line == '\r') {
+        line = skipLine(line, end);
+        scanner.reset(line);
+
+        continue;
+      }
+
+      if (*line == '#') {
+        auto next = skipLine(line, end);
+        RecordLayout layout{};
+
+        if (parseHeader(std::string_view(line, static_cast<std::size_t>(next - line)), layout)) {
+          auto found = std::find_if(layouts.begin(), layouts.end(),
+                                    [&layout](const RecordLayout& known) { return known.type == layout.type; });
+
+          if (found != layouts.end() && *found == layout) {
+            // The same header
+          } else if (!canDefine) {
+            return false;
+          } else if (found != layouts.end()) {
+            *found = std::move(layout);
+          } else {
+            layouts.push_back(std::move(layout));
+          }
+        }
+
+        line = next;
+        scanner.reset(line);
+
+        continue;
+      }
+
+      const RecordLayout* layout = nullptr;
+      auto isAccepted = true;
+
+      fields.clear();
+
+      // The fields up to the last needed one: the delimiter closes the field, the quotes are skipped in pairs
+      for (auto field = line;;) {
+        auto delimiter = scanner.next();
+        auto value = field;
+
+        if (delimiter != end && *delimiter == '"' && delimiter == field) {
+          for (value = field + 1;;) {
+            delimiter = scanner.next();
+
+            // The commas of the value
+            while (delimiter != end && *delimiter == ',') {
+              delimiter = scanner.next();
+            }
+
+            if (delimiter == end || *delimiter != '"') {
+              // The unclosed quote
+              break;
+            }
+
+            // The doubled quote is the quote of the value
+            if (delimiter + 1 < end && delimiter[1] == '"') {
+              scanner.next();
+
+              continue;
+            }
+
+            auto close = delimiter;
+
+            delimiter = scanner.next();
+            fields.push_back(std::string_view(value, static_cast<std::size_t>(close - value)));
+            value = nullptr;
+
+            break;
+          }
+        }
+
+        // The quote inside the unquoted field is the part of the value
+        while (delimiter != end && *delimiter == '"') {
+          delimiter = scanner.next();
+        }
+
+        if (value != nullptr) {
+          fields.push_back(trimLine(std::string_view(value, static_cast<std::size_t>(delimiter - value))));
+        }
+
+        if (fields.size() == 1) {
+          layout = findLayout(layouts, fields[0]);
+          layout = layout != nullptr ? layout : &defaultLayout;
+          isAccepted = filter.acceptsType(fields[0]);
+        }
+
+        if (delimiter == end || *delimiter == '\n' || !isAccepted || fields.size() > layout->lastColumn) {
+          line = delimiter == end ? end : delimiter + 1;
+
+          if (delimiter != end && *delimiter != '\n') {
+            line = skipLine(delimiter, end);
+            scanner.reset(line);
+          }
+
+          break;
+        }
+
+        field = delimiter + 1;
+      }
+
+      if (!isAccepted || layout == nullptr || layout->symbolColumn >= fields.size()) {
+        continue;
+      }
+
+      recordsNumber++;
+
+      auto getField = [&fields](std::size_t column) {
+        return column < fields.size() ? fields[column] : std::string_view{};
+      };
+
+      if (!filter.acceptsExchanges(getField(layout->opolColumn), getField(layout->exchangesColumn))) {
+        continue;
+      }
+
+      if (auto symbol = fields[layout->symbolColumn]; !symbol.empty()) {
+        onSymbol(symbol);
+      }
+    }
+
+    return true;
+  }
+
+  // Interns the symbols of the file that the universe has not yet
+  void intern(const std::vector<std::string_view>& symbols) {
+    auto interned = SymbolTable::getInstance().intern(symbols);
+    std::vector<bool> isAdded(SymbolTable::getInstance().getSize());
+
+    symbols_.reserve(interned.size());
+
+    for (const auto& symbol : interned) {
+      if (!isAdded[symbol.getId()]) {
+        isAdded[symbol.getId()] = true;
+        symbols_.push_back(symbol);
+      }
+    }
+  }
+
+ public:
+  // Parses the IPF data (e.g. the downloaded one). threadsNumber - the maximum number of the threads (0 - the number
+  // of the cores).
+  static IpfSymbolUniverse parse(std::string_view data, const IpfSymbolFilter& filter = {},
+                                 std::size_t threadsNumber = 0) {
+    IpfSymbolUniverse result{};
+    std::vector<RecordLayout> layouts{};
+    auto begin = data.data();
+    auto end = data.data() + data.size();
+    auto dataBegin = begin;
+
+    // The headers at the beginning of the file
+    while (dataBegin < end && (*dataBegin == '#' || *dataBegin == '\n' || *dataBegin == '\r')) {
+      dataBegin = skipLine(dataBegin, end);
+    }
+
+    std::vector<std::string_view> symbols{};
+    std::size_t recordsNumber = 0;
+    auto addTo = [](std::vector<std::string_view>& to) {
+      return [&to](std::string_view symbol) { to.push_back(symbol); };
+    };
+
+    parseLines(begin, dataBegin, filter, layouts, true, addTo(symbols), recordsNumber);
+
+    if (threadsNumber == 0) {
+      threadsNumber = (std::max)(1U, std::thread::hardware_concurrency());
+    }
+
+    auto size = static_cast<std::size_t>(end - dataBegin);
+    auto chunksNumber = (std::max)(std::size_t{1}, (std::min)(threadsNumber, size / MIN_CHUNK_SIZE));
+    std::vector<const char*> bounds{dataBegin};
+
+    for (std::size_t i = 1; i < chunksNumber; i++) {
+      bounds.push_back(skipLine((std::max)(bounds.back(), dataBegin + size * i / chunksNumber - 1), end));
+    }
+
+    bounds.push_back(end);
+
+    std::vector<std::vector<std::string_view>> chunkSymbols(chunksNumber);
+    std::vector<std::size_t> chunkRecordsNumbers(chunksNumber);
+    std::vector<char> isParsed(chunksNumber);
+    std::vector<std::thread> threads{};
+
+    for (std::size_t i = 1; i < chunksNumber; i++) {
+      threads.emplace_back([&, i, chunkLayouts = layouts]() mutable {
+        isParsed[i] = parseLines(bounds[i], bounds[i + 1], filter, chunkLayouts, false, addTo(chunkSymbols[i]),
+                                 chunkRecordsNumbers[i]);
+      });
+    }
+
+    auto chunkLayouts = layouts;
+
+    isParsed[0] =
+      parseLines(bounds[0], bounds[1], filter, chunkLayouts, false, addTo(chunkSymbols[0]), chunkRecordsNumbers[0]);
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    if (std::find(isParsed.begin(), isParsed.end(), 0) == isParsed.end()) {
+      for (std::size_t i = 0; i < chunksNumber; i++) {
+        symbols.insert(symbols.end(), chunkSymbols[i].begin(), chunkSymbols[i].end());
+        recordsNumber += chunkRecordsNumbers[i];
+      }
+    } else {
+      // The headers are redefined in the middle of the file
+      parseLines(dataBegin, end, filter, layouts, true, addTo(symbols), recordsNumber);
+    }
+
+    result.recordsNumber_ = recordsNumber;
+    result.intern(symbols);
+
+    return result;
+  }
+
+  // Calls the onSymbol for the symbol of every record of the lines that passes the filter (in the order of the lines,
+  // with the duplicates and without the interning) on the calling thread. The lines that are the part of the file
+  // (e.g. its chunk or its block) are parsed by their own headers only.
+  template <typename OnSymbol>
+  static void forEachSymbol(std::string_view lines, OnSymbol&& onSymbol, const IpfSymbolFilter& filter = {}) {
+    std::vector<RecordLayout> layouts{};
+    std::size_t recordsNumber = 0;
+
+    parseLines(lines.data(), lines.data() + lines.size(), filter, layouts, true, onSymbol, recordsNumber);
+  }
+
+  // Maps and parses the IPF file. Returns nullptr if the file can't be mapped.
+  static std::unique_ptr<IpfSymbolUniverse> load(const std::string& path, const IpfSymbolFilter& filter = {},
+                                                 std::size_t threadsNumber = 0) {
+    auto file = MappedFile::open(path, false);
+
+    if (!file) {
+      return nullptr;
+    }
+
+    return std::make_unique<IpfSymbolUniverse>(parse(
+      std::string_view(static_cast<const char*>(file->getData()), file->getSize()), filter, threadsNumber));
+  }
+
+  // The distinct symbols (in the order of the file)
+  [[nodiscard]] const std::vector<Symbol>& getSymbols() const { return symbols_; }
+
+  [[nodiscard]] std::vector<std::string> getNames() const {
+    std::vector<std::string> result{};
+
+    result.reserve(symbols_.size());
+
+    for (const auto& symbol : symbols_) {
+      result.push_back(symbol.getName());
+    }
+
+    return result;
+  }
+
+  // The number of the records of the accepted types (before the filter of the exchanges and the deduplication)
+  [[nodiscard]] std::size_t getRecordsNumber() const { return recordsNumber_; }
+
+  [[nodiscard]] std::size_t getSize() const { return symbols_.size(); }
+
+  // Adds the symbols to the subscription in bulk (see SymbolSubscription). Returns false if any batch can't be added.
+  bool subscribe(dxf_subscription_t subscription) const {
+    return SymbolSubscription::addSymbols(subscription, symbols_);
+  }
+
+  // Replaces the symbols of the set by the universe, e.g. after the reload of the IPF: only the difference is
+  // subscribed (see SymbolSubscriptionSet). Returns false if any batch fails.
+  bool subscribe(SymbolSubscriptionSet& set) const { return set.setSymbols(symbols_); }
+};
+
+}  // namespace dxf
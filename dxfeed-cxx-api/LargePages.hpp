@@ -0,0 +1,372 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <optional>
+#include <string_view>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Metrics.hpp"
+
+namespace dxf {
+
+// How the large buffers are backed (see LargePages)
+struct LargePageConfig {
+  enum class Pages : int {
+    // The regular pages
+    NORMAL = 0,
+    // The regular mappings aligned to the huge pages with the transparent huge page hint (Linux, MADV_HUGEPAGE)
+    TRANSPARENT = 1,
+    // The explicit huge pages (MAP_HUGETLB of the reserved pool on Linux, the large pages on Windows: the process
+    // needs SeLockMemoryPrivilege). The regular pages with the hint are used if they can't be allocated.
+    EXPLICIT = 2
+  };
+
+  Pages pages = Pages::NORMAL;
+  // The pages are touched at the allocation, so the first writes on the hot path don't fault
+  bool prefault = false;
+  // The pages are locked in the memory (mlock, VirtualLock), so they are never swapped out. The failures (e.g. by
+  // RLIMIT_MEMLOCK) are counted and ignored.
+  bool lock = false;
+
+  // Parses the config of the "<item>[;<item>...]" format. The items: pages=<normal | transparent | explicit>, prefault
+  // and lock. Returns std::nullopt if the config is invalid.
+  static std::optional<LargePageConfig> parse(std::string_view spec) {
+    LargePageConfig result{};
+
+    while (!spec.empty()) {
+      auto end = (std::min)(spec.find(';'), spec.size());
+      auto item = spec.substr(0, end);
+
+      spec.remove_prefix((std::min)(end + 1, spec.size()));
+
+      if (item.empty()) {
+        continue;
+      }
+
+      if (item == "prefault") {
+        result.prefault = true;
+      } else if (item == "lock") {
+        result.lock = true;
+      } else if (item == "pages=normal") {
+        result.pages = Pages::NORMAL;
+      } else if (item == "pages=transparent") {
+        result.pages = Pages::TRANSPARENT;
+      } else if (item == "pages=explicit") {
+        result.pages = Pages::EXPLICIT;
+      } else {
+        return std::nullopt;
+      }
+    }
+
+    return result;
+  }
+};
+
+// The counters of the large buffers (see LargePages::getStats)
+struct LargePageStats {
+  // The bytes of the live buffers
+  std::uint64_t mappedBytes = 0;
+  std::uint64_t allocationsNumber = 0;
+  // The allocations backed by the explicit huge pages and the ones that fell back to the regular pages
+  std::uint64_t explicitNumber = 0;
+  std::uint64_t fallbacksNumber = 0;
+  std::uint64_t lockFailuresNumber = 0;
+};
+
+// The allocation backend of the large long-lived buffers: the rings (SpscRing, EventRing, the receive ring of
+// feed-server), the order indexes (OrderDataMap) and the blocks of the event arenas (getResource). The buffers of at
+// least MIN_SIZE bytes are mapped directly, whole huge pages, by the process-wide config, so the hot paths that sweep
+// them don't miss the TLB and (with the prefault) don't fault on the first market burst. The smaller buffers are
+// allocated by the operator new. The config is set at the startup, before the buffers are allocated (configure).
+class LargePages final {
+ public:
+  // The size of the huge page the buffers are rounded to (x86-64 and the default of arm64 with the 4 KiB pages)
+  static constexpr std::size_t HUGE_PAGE_SIZE = std::size_t{2} << 20U;
+  static constexpr std::size_t MIN_SIZE = HUGE_PAGE_SIZE;
+
+ private:
+  // The regular page size the prefault touches by (the smallest one of the supported platforms)
+  static constexpr std::size_t REGULAR_PAGE_SIZE = 4096;
+
+  struct State {
+    std::atomic<int> pages{0};
+    std::atomic<bool> prefault{false};
+    std::atomic<bool> lock{false};
+    std::atomic<std::uint64_t> mappedBytes{0};
+    std::atomic<std::uint64_t> allocationsNumber{0};
+    std::atomic<std::uint64_t> explicitNumber{0};
+    std::atomic<std::uint64_t> fallbacksNumber{0};
+    std::atomic<std::uint64_t> lockFailuresNumber{0};
+  };
+
+  static State& getState() {
+    static State state{};
+
+    return state;
+  }
+
+  static std::size_t getMappedSize(std::size_t size) { return (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1); }
+
+  static void prefault(void* data, std::size_t size) {
+    auto bytes = static_cast<volatile char*>(data);
+
+    for (std::size_t offset = 0; offset < size; offset += REGULAR_PAGE_SIZE) {
+      bytes[offset] = 0;
+    }
+  }
+
+#ifdef _WIN32
+  static void* map(std::size_t size, const LargePageConfig& config) {
+    auto& state = getState();
+
+    if (config.pages == LargePageConfig::Pages::EXPLICIT) {
+      // The large pages are always committed and locked
+      auto largePageSize = GetLargePageMinimum();
+
+      if (largePageSize != 0 && size % largePageSize == 0) {
+        if (auto data = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE)) {
+          state.explicitNumber.fetch_add(1, std::memory_order_relaxed);
+
+          return data;
+        }
+      }
+
+      state.fallbacksNumber.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto data = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+
+    if (data == nullptr) {
+      return nullptr;
+    }
+
+    if (config.prefault) {
+      prefault(data, size);
+    }
+
+    if (config.lock && VirtualLock(data, size) == 0) {
+      state.lockFailuresNumber.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return data;
+  }
+
+  static void unmap(void* data, std::size_t) { VirtualFree(data, 0, MEM_RELEASE); }
+#else
+  static void* map(std::size_t size, const LargePageConfig& config) {
+    auto& state = getState();
+    void* data = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    if (config.pages == LargePageConfig::Pages::EXPLICIT) {
+      data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+      if (data != MAP_FAILED) {
+        state.explicitNumber.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+#endif
+
+    if (data == MAP_FAILED) {
+      if (config.pages == LargePageConfig::Pages::EXPLICIT) {
+        state.fallbacksNumber.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      if (config.pages == LargePageConfig::Pages::NORMAL) {
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      } else {
+        // The transparent huge pages back the aligned ranges only, so the mapping is trimmed to the aligned one
+        auto mapping = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (mapping == MAP_FAILED) {
+          return nullptr;
+        }
+
+        auto address = reinterpret_cast<std::uintptr_t>(mapping);
+        auto aligned = (address + HUGE_PAGE_SIZE - 1) & ~std::uintptr_t{HUGE_PAGE_SIZE - 1};
+
+        if (aligned != address) {
+          munmap(mapping, aligned - address);
+        }
+
+        munmap(reinterpret_cast<void*>(aligned + size), address + HUGE_PAGE_SIZE - aligned);
+        data = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+        madvise(data, size, MADV_HUGEPAGE);
+#endif
+      }
+
+      if (data == MAP_FAILED) {
+        return nullptr;
+      }
+    }
+
+    // After the hint, so the touched pages are the huge ones
+    if (config.prefault) {
+      prefault(data, size);
+    }
+
+    if (config.lock && mlock(data, size) != 0) {
+      state.lockFailuresNumber.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return data;
+  }
+
+  static void unmap(void* data, std::size_t size) { munmap(data, size); }
+#endif
+
+ public:
+  // Sets the config of the buffers allocated later (the allocated ones are not changed)
+  static void configure(const LargePageConfig& config) {
+    auto& state = getState();
+
+    state.pages.store(static_cast<int>(config.pages), std::memory_order_relaxed);
+    state.prefault.store(config.prefault, std::memory_order_relaxed);
+    state.lock.store(config.lock, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static LargePageConfig getConfig() {
+    auto& state = getState();
+
+    return {static_cast<LargePageConfig::Pages>(state.pages.load(std::memory_order_relaxed)),
+            state.prefault.load(std::memory_order_relaxed), state.lock.load(std::memory_order_relaxed)};
+  }
+
+  // Maps the buffer of at least MIN_SIZE bytes (the whole huge pages, zeroed). Returns nullptr if it can't be mapped.
+  static void* allocate(std::size_t size) {
+    auto mappedSize = getMappedSize(size);
+    auto data = map(mappedSize, getConfig());
+
+    if (data != nullptr) {
+      auto& state = getState();
+
+      state.mappedBytes.fetch_add(mappedSize, std::memory_order_relaxed);
+      state.allocationsNumber.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return data;
+  }
+
+  // Unmaps the buffer allocated with the same size
+  static void deallocate(void* data, std::size_t size) {
+    auto mappedSize = getMappedSize(size);
+
+    unmap(data, mappedSize);
+    getState().mappedBytes.fetch_sub(mappedSize, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] static LargePageStats getStats() {
+    auto& state = getState();
+
+    return {state.mappedBytes.load(std::memory_order_relaxed), state.allocationsNumber.load(std::memory_order_relaxed),
+            state.explicitNumber.load(std::memory_order_relaxed), state.fallbacksNumber.load(std::memory_order_relaxed),
+            state.lockFailuresNumber.load(std::memory_order_relaxed)};
+  }
+
+  static void collectMetrics(MetricsWriter& writer, const MetricLabels& labels = {}) {
+    auto stats = getStats();
+
+    writer.gauge("dxf_large_pages_mapped_bytes", "The bytes of the live large buffers", labels,
+                 static_cast<double>(stats.mappedBytes));
+    writer.counter("dxf_large_pages_allocations_total", "The large buffers mapped", labels,
+                   static_cast<double>(stats.allocationsNumber));
+    writer.counter("dxf_large_pages_explicit_total", "The large buffers backed by the explicit huge pages", labels,
+                   static_cast<double>(stats.explicitNumber));
+    writer.counter("dxf_large_pages_fallbacks_total", "The explicit huge page allocations that fell back", labels,
+                   static_cast<double>(stats.fallbacksNumber));
+    writer.counter("dxf_large_pages_lock_failures_total", "The large buffers that can't be locked in the memory",
+                   labels, static_cast<double>(stats.lockFailuresNumber));
+  }
+
+  // The upstream of the arenas (e.g. std::pmr::monotonic_buffer_resource): the blocks of at least MIN_SIZE bytes are
+  // the large buffers, the smaller ones are allocated by the operator new.
+  static std::pmr::memory_resource* getResource() {
+    class Resource final : public std::pmr::memory_resource {
+      void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        if (bytes < MIN_SIZE || alignment > REGULAR_PAGE_SIZE) {
+          return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        auto data = LargePages::allocate(bytes);
+
+        if (data == nullptr) {
+          throw std::bad_alloc();
+        }
+
+        return data;
+      }
+
+      void do_deallocate(void* data, std::size_t bytes, std::size_t alignment) override {
+        if (bytes < MIN_SIZE || alignment > REGULAR_PAGE_SIZE) {
+          std::pmr::new_delete_resource()->deallocate(data, bytes, alignment);
+        } else {
+          LargePages::deallocate(data, bytes);
+        }
+      }
+
+      [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+      }
+    };
+
+    static Resource resource{};
+
+    return &resource;
+  }
+};
+
+// The allocator of the containers of the large buffers (see LargePages)
+template <typename T>
+struct LargePageAllocator {
+  using value_type = T;
+
+  LargePageAllocator() = default;
+
+  template <typename U>
+  LargePageAllocator(const LargePageAllocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    if (n * sizeof(T) < LargePages::MIN_SIZE) {
+      return std::allocator<T>{}.allocate(n);
+    }
+
+    auto data = LargePages::allocate(n * sizeof(T));
+
+    if (data == nullptr) {
+      throw std::bad_alloc();
+    }
+
+    return static_cast<T*>(data);
+  }
+
+  void deallocate(T* data, std::size_t n) noexcept {
+    if (n * sizeof(T) < LargePages::MIN_SIZE) {
+      std::allocator<T>{}.deallocate(data, n);
+    } else {
+      LargePages::deallocate(data, n * sizeof(T));
+    }
+  }
+
+  template <typename U>
+  friend bool operator==(const LargePageAllocator&, const LargePageAllocator<U>&) {
+    return true;
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "TscClock.hpp"
+
+// 1 - the PriceLevelBook measures the latencies of its processing stages (see dxf::LatencyStage). 0 - the measurements
+// are compiled out completely.
+#ifndef DXFCXX_LATENCY_STATS
+#define DXFCXX_LATENCY_STATS 0
+#endif
+
+namespace dxf {
+
+enum class LatencyStage : int {
+  // From the snapshot listener call to the start of the processing (includes the queue wait of the async mode)
+  RECEIVE = 0,
+  // The conversion of the order records to the price level updates (PriceLevelBookEngine::accumulateOrders and
+  // takeUpdates)
+  CONVERT = 1,
+  // The application of the updates to the levels (PriceLevelBookEngine::applyUpdates) and the publishing
+  APPLY = 2,
+  // The handlers (the std::function one and the listener)
+  ON_NEW_BOOK = 3,
+  ON_INCREMENTAL_CHANGE = 4,
+  ON_BOOK_UPDATE = 5,
+  ON_BOOK_UPDATE_VIEW = 6,
+  // From the time of the last order record of the transaction to the return of the handlers (the wall clock, the order
+  // time has the millisecond precision)
+  END_TO_END = 7
+};
+
+// The copy of the histogram counts (see LatencyHistogram). Can be merged to aggregate the books.
+struct LatencyHistogramSnapshot {
+  // 16 sub-buckets per power of 2 (the precision is 1/16 of the value), the values up to 2^40 ns
+  static constexpr int SUB_BUCKET_BITS = 4;
+  static constexpr std::size_t SUB_BUCKETS_NUMBER = std::size_t{1} << SUB_BUCKET_BITS;
+  static constexpr std::size_t BUCKETS_NUMBER = (40 - SUB_BUCKET_BITS) * SUB_BUCKETS_NUMBER + SUB_BUCKETS_NUMBER;
+
+  std::array<std::uint64_t, BUCKETS_NUMBER> counts{};
+  std::uint64_t count = 0;
+  std::uint64_t sum = 0;
+  std::uint64_t max = 0;
+
+  [[nodiscard]] static std::size_t getBucket(std::uint64_t value) {
+    if (value < 2 * SUB_BUCKETS_NUMBER) {
+      return static_cast<std::size_t>(value);
+    }
+
+    // Keeps the SUB_BUCKET_BITS + 1 highest bits of the value
+    auto shift = static_cast<std::size_t>(std::bit_width(value)) - SUB_BUCKET_BITS - 1;
+    auto bucket = shift * SUB_BUCKETS_NUMBER + static_cast<std::size_t>(value >> shift);
+
+    return bucket < BUCKETS_NUMBER ? bucket : BUCKETS_NUMBER - 1;
+  }
+
+  // The lowest value of the bucket
+  [[nodiscard]] static std::uint64_t getBucketValue(std::size_t bucket) {
+    if (bucket < 2 * SUB_BUCKETS_NUMBER) {
+      return bucket;
+    }
+
+    auto shift = bucket / SUB_BUCKETS_NUMBER - 1;
+
+    return static_cast<std::uint64_t>(bucket % SUB_BUCKETS_NUMBER + SUB_BUCKETS_NUMBER) << shift;
+  }
+
+  [[nodiscard]] double getMean() const {
+    return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+  }
+
+  // Returns the lowest value of the bucket that contains the percentile (0.0 - 100.0)
+  [[nodiscard]] std::uint64_t getPercentile(double percentile) const {
+    if (count == 0) {
+      return 0;
+    }
+
+    auto rank = static_cast<std::uint64_t>(percentile / 100.0 * static_cast<double>(count));
+    std::uint64_t seen = 0;
+
+    for (std::size_t bucket = 0; bucket < BUCKETS_NUMBER; bucket++) {
+      seen += counts[bucket];
+
+      if (seen > rank) {
+        return getBucketValue(bucket);
+      }
+    }
+
+    return max;
+  }
+
+  // The values recorded after the previous snapshot of the same histogram (e.g. the last interval). The max is the
+  // lowest value of the highest non-empty bucket of the interval.
+  [[nodiscard]] LatencyHistogramSnapshot since(const LatencyHistogramSnapshot& previous) const {
+    LatencyHistogramSnapshot result{};
+
+    for (std::size_t bucket = 0; bucket < BUCKETS_NUMBER; bucket++) {
+      result.counts[bucket] = counts[bucket] - previous.counts[bucket];
+
+      if (result.counts[bucket] != 0) {
+        result.max = getBucketValue(bucket);
+      }
+    }
+
+    result.count = count - previous.count;
+    result.sum = sum - previous.sum;
+
+    return result;
+  }
+
+  void merge(const LatencyHistogramSnapshot& other) {
+    for (std::size_t bucket = 0; bucket < BUCKETS_NUMBER; bucket++) {
+      counts[bucket] += other.counts[bucket];
+    }
+
+    count += other.count;
+    sum += other.sum;
+    max = max > other.max ? max : other.max;
+  }
+};
+
+// The log-linear (HDR-style) histogram of the latencies in nanoseconds. One writer records the values without the
+// atomic read-modify-write operations, any thread can read the snapshot at any time (the snapshot may miss the
+// concurrent records).
+class LatencyHistogram final {
+  std::array<std::atomic<std::uint64_t>, LatencyHistogramSnapshot::BUCKETS_NUMBER> counts_{};
+  std::atomic<std::uint64_t> count_{0};
+  std::atomic<std::uint64_t> sum_{0};
+  std::atomic<std::uint64_t> max_{0};
+
+  static void increase(std::atomic<std::uint64_t>& value, std::uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+  }
+
+ public:
+  // The writer
+  void record(std::uint64_t nanoseconds) {
+    increase(counts_[LatencyHistogramSnapshot::getBucket(nanoseconds)], 1);
+    increase(count_, 1);
+    increase(sum_, nanoseconds);
+
+    if (nanoseconds > max_.load(std::memory_order_relaxed)) {
+      max_.store(nanoseconds, std::memory_order_relaxed);
+    }
+  }
+
+  [[nodiscard]] LatencyHistogramSnapshot getSnapshot() const {
+    LatencyHistogramSnapshot result{};
+
+    for (std::size_t bucket = 0; bucket < LatencyHistogramSnapshot::BUCKETS_NUMBER; bucket++) {
+      result.counts[bucket] = counts_[bucket].load(std::memory_order_relaxed);
+    }
+
+    result.count = count_.load(std::memory_order_relaxed);
+    result.sum = sum_.load(std::memory_order_relaxed);
+    result.max = max_.load(std::memory_order_relaxed);
+
+    return result;
+  }
+};
+
+// The latency histograms of the stages of one book.
+//
+// Usage:
+//   auto start = LatencyStats::now();
+//   ...
+//   stats.record(LatencyStage::APPLY, start);
+//
+// If DXFCXX_LATENCY_STATS is 0, the object is empty and the calls compile to nothing.
+class LatencyStats final {
+  static constexpr std::size_t STAGES_NUMBER = 8;
+
+  // Is empty if the measurements are compiled out
+  [[no_unique_address]] std::array<LatencyHistogram, DXFCXX_LATENCY_STATS != 0 ? STAGES_NUMBER : 0> histograms_{};
+
+ public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  static constexpr bool isCompiled() { return DXFCXX_LATENCY_STATS != 0; }
+
+  static TimePoint now() {
+    if constexpr (isCompiled()) {
+      return TscClock::now();
+    } else {
+      return {};
+    }
+  }
+
+  void record(LatencyStage stage, std::uint64_t nanoseconds) {
+    if constexpr (isCompiled()) {
+      histograms_[static_cast<std::size_t>(stage)].record(nanoseconds);
+    }
+  }
+
+  // Records the time since the start
+  void record(LatencyStage stage, TimePoint start) {
+    if constexpr (isCompiled()) {
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(TscClock::now() - start);
+
+      record(stage, static_cast<std::uint64_t>(elapsed.count() < 0 ? 0 : elapsed.count()));
+    }
+  }
+
+  // Records the wall clock time since the order time (milliseconds since the epoch)
+  void recordSinceEventTime(LatencyStage stage, std::int64_t eventTime) {
+    if constexpr (isCompiled()) {
+      auto elapsed = TscClock::currentTimeNanos() - eventTime * 1000000;
+
+      record(stage, static_cast<std::uint64_t>(elapsed < 0 ? 0 : elapsed));
+    }
+  }
+
+  // Returns the empty snapshot if the measurements are compiled out
+  [[nodiscard]] LatencyHistogramSnapshot getSnapshot(LatencyStage stage) const {
+    if constexpr (isCompiled()) {
+      return histograms_[static_cast<std::size_t>(stage)].getSnapshot();
+    } else {
+      return {};
+    }
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "OrderDataMap.hpp"
+#include "PriceLevel.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The price level of the LazyPriceLevelBookEngine in the table of its side (by the bits of the price)
+struct LazyPriceLevel {
+  dxf_long_t priceBits = 0;
+  double price = std::numeric_limits<double>::quiet_NaN();
+  double size = 0.0;
+  std::int64_t time = 0;
+};
+
+// The order-to-price-level aggregation for the deep books that receive many updates but are read rarely (e.g. by the
+// risk check once a second). The levels of every side are the open addressing table by the price (see
+// BasicOrderDataMap), so every order record changes its level in O(1) and nothing is kept sorted. The best levels are
+// selected (std::nth_element) and sorted only by the read, O(levels + N log N), and the result is cached until the
+// next change of the side.
+//
+// There are no incremental changes of the visible levels: the PriceLevelBookEngine keeps the sorted ladders for them.
+class LazyPriceLevelBookEngine final {
+  using LevelMap = BasicOrderDataMap<LazyPriceLevel, &LazyPriceLevel::priceBits>;
+
+  std::size_t levelsNumber_;
+  OrderDataMap orders_{};
+  LevelMap asks_{};
+  LevelMap bids_{};
+  // The sorted best levels of the sides of the last read
+  PriceLevelChanges book_{};
+  bool isAskBookValid_ = false;
+  bool isBidBookValid_ = false;
+  std::uint64_t sortsNumber_ = 0;
+
+  static dxf_long_t getPriceBits(double price) {
+    // +0.0 and -0.0 are the same level
+    return std::bit_cast<dxf_long_t>(price == 0.0 ? 0.0 : price);
+  }
+
+  void changeLevel(dxf_order_side_t side, double price, double size, std::int64_t time) {
+    auto isBid = side == dxf_osd_buy;
+    auto& levels = isBid ? bids_ : asks_;
+    auto priceBits = getPriceBits(price);
+
+    (isBid ? isBidBookValid_ : isAskBookValid_) = false;
+
+    if (auto* found = levels.find(priceBits); found != nullptr) {
+      found->size += size;
+      found->time = time;
+
+      if (isZeroPriceLevel(*found)) {
+        levels.erase(priceBits);
+      }
+
+      return;
+    }
+
+    levels.insert(LazyPriceLevel{priceBits, price, size, time});
+  }
+
+  template <typename Side>
+  void sortSide(const LevelMap& levels, std::vector<PriceLevel>& result) {
+    result.clear();
+    levels.forEach([&result](const LazyPriceLevel& level) {
+      result.push_back(PriceLevel{level.price, level.size, level.time});
+    });
+
+    if (levelsNumber_ != 0 && result.size() > levelsNumber_) {
+      auto last = result.begin() + static_cast<std::ptrdiff_t>(levelsNumber_);
+
+      std::nth_element(result.begin(), last, result.end(), Side{});
+      result.erase(last, result.end());
+    }
+
+    std::sort(result.begin(), result.end(), Side{});
+    sortsNumber_++;
+  }
+
+ public:
+  // levelsNumber - the number of the best levels of every side that are read (0 - all levels)
+  explicit LazyPriceLevelBookEngine(std::size_t levelsNumber = 0) : levelsNumber_{levelsNumber} {}
+
+  // Prepares the order index for the given number of the live orders
+  void reserveOrders(std::size_t ordersNumber) { orders_.reserve(ordersNumber); }
+
+  // Applies the order records (the snapshot or the transaction). The removals are the records with the REMOVE_EVENT
+  // flag, the zero or the NaN size.
+  void apply(const dxf_order_t* orders, std::size_t recordsCount) {
+    for (std::size_t i = 0; i < recordsCount; i++) {
+      const auto& record = orders[i];
+      auto isRemoval = (record.event_flags & dxf_ef_remove_event) != 0 || record.size == 0 || std::isnan(record.size);
+      auto* found = orders_.find(record.index);
+
+      if (found == nullptr) {
+        if (isRemoval) {
+          continue;
+        }
+
+        changeLevel(record.side, record.price, record.size, record.time);
+        orders_.insert(OrderData{record.index, record.price, record.size, record.side});
+
+        continue;
+      }
+
+      // The order is replaced or removed: its old size leaves its old level (of any side)
+      changeLevel(found->side, found->price, -found->size, record.time);
+
+      if (isRemoval) {
+        orders_.erase(record.index);
+      } else {
+        changeLevel(record.side, record.price, record.size, record.time);
+        *found = OrderData{record.index, record.price, record.size, record.side};
+      }
+    }
+  }
+
+  // Removes all orders and levels (e.g. before the new snapshot). Keeps the capacity.
+  void clear() {
+    orders_.clear();
+    asks_.clear();
+    bids_.clear();
+    isAskBookValid_ = false;
+    isBidBookValid_ = false;
+  }
+
+  // Returns the best levels of both sides (best-first). Only the sides changed since the last call are sorted. The
+  // result is valid until the next call.
+  const PriceLevelChanges& getBook() {
+    if (!isAskBookValid_) {
+      sortSide<AskSide>(asks_, book_.asks);
+      isAskBookValid_ = true;
+    }
+
+    if (!isBidBookValid_) {
+      sortSide<BidSide>(bids_, book_.bids);
+      isBidBookValid_ = true;
+    }
+
+    return book_;
+  }
+
+  [[nodiscard]] std::size_t getLevelsNumber() const { return levelsNumber_; }
+
+  [[nodiscard]] std::size_t getOrdersNumber() const { return orders_.size(); }
+
+  // The numbers of all levels of the sides
+  [[nodiscard]] std::size_t getAsksNumber() const { return asks_.size(); }
+
+  [[nodiscard]] std::size_t getBidsNumber() const { return bids_.size(); }
+
+  // The number of the sorts of the sides made by the reads
+  [[nodiscard]] std::uint64_t getSortsNumber() const { return sortsNumber_; }
+
+  // The heap bytes held by the book
+  [[nodiscard]] std::size_t getMemoryUsage() const {
+    return orders_.getMemoryUsage() + asks_.getMemoryUsage() + bids_.getMemoryUsage() +
+           (book_.asks.capacity() + book_.bids.capacity()) * sizeof(PriceLevel);
+  }
+};
+
+// The order snapshot subscription aggregated by the LazyPriceLevelBookEngine: the C-API listener thread only changes
+// the tables of the levels, the reader sorts the best levels when it copies them (e.g. once a second). There are no
+// handlers.
+//
+// Usage:
+//   auto book = LazyPriceLevelBook::create(connection, "AAPL", "NTV", 10);
+//
+//   PriceLevelChanges levels{};
+//
+//   if (book->copyBook(levels)) { ... }
+class LazyPriceLevelBook final {
+  dxf_snapshot_t snapshot_ = nullptr;
+  std::string symbol_;
+  std::string source_;
+  bool isValid_ = false;
+  std::mutex mutex_{};
+  LazyPriceLevelBookEngine engine_;
+  // The snapshot is being received (it's not complete yet)
+  bool snapshotPending_ = false;
+  // The first snapshot is complete
+  bool isReady_ = false;
+
+  LazyPriceLevelBook(std::string symbol, std::string source, std::size_t levelsNumber, std::size_t ordersNumberHint)
+      : symbol_{std::move(symbol)}, source_{std::move(source)}, engine_{levelsNumber} {
+    engine_.reserveOrders(ordersNumberHint);
+  }
+
+ public:
+  static std::unique_ptr<LazyPriceLevelBook> create(dxf_connection_t connection, const std::string& symbol,
+                                                    const std::string& source, std::size_t levelsNumber,
+                                                    std::size_t ordersNumberHint = 0) {
+    auto book = createDetached(symbol, source, levelsNumber, ordersNumberHint);
+    const auto& wSymbol = Symbol::valueOf(symbol).getWideName();
+    dxf_snapshot_t snapshot = nullptr;
+
+    if (dxf_create_order_snapshot(connection, wSymbol.c_str(), source.c_str(), 0, &snapshot) == DXF_FAILURE) {
+      return book;
+    }
+
+    book->snapshot_ = snapshot;
+    book->isValid_ = true;
+
+    dxf_attach_snapshot_inc_listener(
+      snapshot,
+      [](const dxf_snapshot_data_ptr_t snapshotData, int newSnapshot, void* userData) {
+        static_cast<LazyPriceLevelBook*>(userData)->processSnapshotData(snapshotData, newSnapshot);
+      },
+      book.get());
+
+    return book;
+  }
+
+  // Creates the book without the snapshot subscription. The snapshot data is passed to the processSnapshotData by the
+  // caller (e.g. replayed from a capture file).
+  static std::unique_ptr<LazyPriceLevelBook> createDetached(const std::string& symbol, const std::string& source,
+                                                            std::size_t levelsNumber,
+                                                            std::size_t ordersNumberHint = 0) {
+    return std::unique_ptr<LazyPriceLevelBook>(
+      new LazyPriceLevelBook(symbol, source, levelsNumber, ordersNumberHint));
+  }
+
+  LazyPriceLevelBook(const LazyPriceLevelBook&) = delete;
+  LazyPriceLevelBook& operator=(const LazyPriceLevelBook&) = delete;
+
+  ~LazyPriceLevelBook() {
+    if (isValid_) {
+      dxf_close_snapshot(snapshot_);
+      isValid_ = false;
+    }
+  }
+
+  void processSnapshotData(const dxf_snapshot_data_ptr_t snapshotData, int newSnapshot) {
+    assert(snapshotData->records_count == 0 || snapshotData->event_type == dx_eid_order);
+
+    auto orders = reinterpret_cast<const dxf_order_t*>(snapshotData->records);
+    auto recordsCount = static_cast<std::size_t>(snapshotData->records_count);
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (newSnapshot != 0) {
+      engine_.clear();
+      snapshotPending_ = true;
+    }
+
+    engine_.apply(orders, recordsCount);
+
+    if (recordsCount != 0 && (orders[recordsCount - 1].event_flags & dxf_ef_tx_pending) != 0) {
+      return;
+    }
+
+    if (snapshotPending_) {
+      snapshotPending_ = false;
+      isReady_ = true;
+    }
+  }
+
+  [[nodiscard]] bool isValid() const { return isValid_; }
+
+  [[nodiscard]] const std::string& getSymbol() const { return symbol_; }
+
+  [[nodiscard]] const std::string& getSource() const { return source_; }
+
+  // Copies the best levels of both sides (sorted by this call if they have changed since the last one). Returns false
+  // if the first snapshot is not complete yet.
+  bool copyBook(PriceLevelChanges& result) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (!isReady_) {
+      return false;
+    }
+
+    const auto& book = engine_.getBook();
+
+    result.asks.assign(book.asks.begin(), book.asks.end());
+    result.bids.assign(book.bids.begin(), book.bids.end());
+
+    return true;
+  }
+
+  // Calls the function with the engine under the lock and returns its result
+  template <typename F>
+  auto read(F&& f) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return f(engine_);
+  }
+};
+
+}  // namespace dxf
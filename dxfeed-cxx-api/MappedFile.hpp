@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "LargePages.hpp"
+
+namespace dxf {
+
+// The read-only memory mapping of the whole file. The pages are read by the OS on the first access, or at the mapping
+// if the LargePages config has the prefault (and are locked if it has the lock), e.g. so the replays of the tapes don't
+// fault on the hot path.
+class MappedFile final {
+  std::string path_;
+  const void* data_;
+  std::size_t size_;
+  bool removeOnClose_;
+
+#ifdef _WIN32
+  HANDLE file_;
+  HANDLE mapping_;
+
+  MappedFile(std::string path, const void* data, std::size_t size, bool removeOnClose, HANDLE file, HANDLE mapping)
+      : path_{std::move(path)},
+        data_{data},
+        size_{size},
+        removeOnClose_{removeOnClose},
+        file_{file},
+        mapping_{mapping} {}
+#else
+  MappedFile(std::string path, const void* data, std::size_t size, bool removeOnClose)
+      : path_{std::move(path)}, data_{data}, size_{size}, removeOnClose_{removeOnClose} {}
+#endif
+
+  // Reads the pages in advance and locks them by the LargePages config
+  static void prepare(const void* data, std::size_t size) {
+    auto config = LargePages::getConfig();
+
+    if (config.prefault) {
+      auto bytes = static_cast<const volatile char*>(data);
+      char sum = 0;
+
+      for (std::size_t offset = 0; offset < size; offset += 4096) {
+        sum = static_cast<char>(sum + bytes[offset]);
+      }
+
+      static_cast<void>(sum);
+    }
+
+    if (config.lock) {
+#ifdef _WIN32
+      VirtualLock(const_cast<void*>(data), size);
+#else
+      mlock(data, size);
+#endif
+    }
+  }
+
+ public:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+#ifdef _WIN32
+    if (data_ != nullptr) {
+      UnmapViewOfFile(data_);
+    }
+
+    if (mapping_ != nullptr) {
+      CloseHandle(mapping_);
+    }
+
+    CloseHandle(file_);
+#else
+    if (data_ != nullptr) {
+      munmap(const_cast<void*>(data_), size_);
+    }
+#endif
+
+    if (removeOnClose_) {
+      std::remove(path_.c_str());
+    }
+  }
+
+  // Maps the file. removeOnClose - remove the file when the mapping is destroyed (e.g. the temporary file). Returns
+  // nullptr if the file can't be mapped.
+  static std::unique_ptr<MappedFile> open(const std::string& path, bool removeOnClose) {
+#ifdef _WIN32
+    auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+      return nullptr;
+    }
+
+    LARGE_INTEGER fileSize{};
+
+    if (GetFileSizeEx(file, &fileSize) == 0) {
+      CloseHandle(file);
+
+      return nullptr;
+    }
+
+    auto size = static_cast<std::size_t>(fileSize.QuadPart);
+
+    if (size == 0) {
+      return std::unique_ptr<MappedFile>(new MappedFile(path, nullptr, 0, removeOnClose, file, nullptr));
+    }
+
+    auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    auto data = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+    if (data == nullptr) {
+      if (mapping != nullptr) {
+        CloseHandle(mapping);
+      }
+
+      CloseHandle(file);
+
+      return nullptr;
+    }
+
+    prepare(data, size);
+
+    return std::unique_ptr<MappedFile>(new MappedFile(path, data, size, removeOnClose, file, mapping));
+#else
+    auto fd = ::open(path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+      return nullptr;
+    }
+
+    struct stat info {};
+
+    if (fstat(fd, &info) != 0) {
+      close(fd);
+
+      return nullptr;
+    }
+
+    auto size = static_cast<std::size_t>(info.st_size);
+
+    if (size == 0) {
+      close(fd);
+
+      return std::unique_ptr<MappedFile>(new MappedFile(path, nullptr, 0, removeOnClose));
+    }
+
+    auto data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (data == MAP_FAILED) {
+      return nullptr;
+    }
+
+    prepare(data, size);
+
+    return std::unique_ptr<MappedFile>(new MappedFile(path, data, size, removeOnClose));
+#endif
+  }
+
+  [[nodiscard]] const std::string& getPath() const { return path_; }
+
+  [[nodiscard]] const void* getData() const { return data_; }
+
+  [[nodiscard]] std::size_t getSize() const { return size_; }
+};
+
+}  // namespace dxf
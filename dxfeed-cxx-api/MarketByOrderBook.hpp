@@ -0,0 +1,491 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "OrderDataMap.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The live order of the MarketByOrderBook in the pooled array: the links of the FIFO queue of its level are the slots
+// of the neighbours (48 bytes)
+struct BookOrder {
+  static constexpr std::uint32_t NONE = std::numeric_limits<std::uint32_t>::max();
+
+  dxf_long_t index = 0;
+  double price = std::numeric_limits<double>::quiet_NaN();
+  double size = std::numeric_limits<double>::quiet_NaN();
+  // The time of the last change
+  dxf_long_t time = 0;
+  dxf_order_side_t side = dxf_osd_undefined;
+  // The slot of the level
+  std::uint32_t level = NONE;
+  // The previous (closer to the head) and the next orders of the queue of the level, the next free slot of the pool
+  std::uint32_t prev = NONE;
+  std::uint32_t next = NONE;
+};
+
+// The price level of the MarketByOrderBook: the sums of the orders and their FIFO queue (the head is the first in the
+// queue)
+struct BookLevel {
+  double price = std::numeric_limits<double>::quiet_NaN();
+  double size = 0.0;
+  std::uint32_t ordersNumber = 0;
+  std::uint32_t head = BookOrder::NONE;
+  std::uint32_t tail = BookOrder::NONE;
+};
+
+// The position of the order in the queue of its level
+struct QueuePosition {
+  // The orders before it
+  std::size_t ordersAhead = 0;
+  // The sum of their sizes
+  double sizeAhead = 0.0;
+};
+
+// The market-by-order book of the order snapshot: every live order is kept in the FIFO queue of its price level, so the
+// queue positions and the orders of every level are available (the PriceLevelBookEngine keeps the sums only).
+//
+// The orders and the levels are the slots of the pooled arrays (the freed slots are reused first, so the hot slots
+// stay in the cache), the queues are the intrusive doubly-linked lists of the slots. The order and the level of the
+// price are found by the open addressing tables (BasicOrderDataMap), so the addition to the existing level, the
+// modification and the cancel are O(1). Only the new and the emptied levels change the sorted levels of the side
+// (the binary search and the shift of the levels that are better, the best level is the last one).
+//
+// The modification keeps the queue position of the order if the price and the side are the same and the size is not
+// increased, otherwise the order goes to the tail of the queue of its (new) level.
+class MarketByOrderEngine final {
+  // The slot of the order by the index
+  struct OrderRef {
+    dxf_long_t index = 0;
+    std::uint32_t slot = 0;
+  };
+
+  // The slot of the level by the bits of the price
+  struct LevelRef {
+    dxf_long_t priceBits = 0;
+    std::uint32_t slot = 0;
+  };
+
+  std::vector<BookOrder> orders_{};
+  std::uint32_t freeOrder_ = BookOrder::NONE;
+  std::vector<BookLevel> levels_{};
+  std::uint32_t freeLevel_ = BookOrder::NONE;
+  BasicOrderDataMap<OrderRef> orderSlots_{};
+  BasicOrderDataMap<LevelRef, &LevelRef::priceBits> askSlots_{};
+  BasicOrderDataMap<LevelRef, &LevelRef::priceBits> bidSlots_{};
+  // The slots of the levels from the worst to the best
+  std::vector<std::uint32_t> asks_{};
+  std::vector<std::uint32_t> bids_{};
+  std::size_t ordersNumber_ = 0;
+
+  static bool isBid(dxf_order_side_t side) { return side == dxf_osd_buy; }
+
+  static dxf_long_t getPriceBits(double price) {
+    // +0.0 and -0.0 are the same level
+    return std::bit_cast<dxf_long_t>(price == 0.0 ? 0.0 : price);
+  }
+
+  // The side is ordered from the worst to the best
+  bool isWorse(bool isBidSide, double price1, double price2) const {
+    return isBidSide ? price1 < price2 : price1 > price2;
+  }
+
+  std::uint32_t allocateOrder() {
+    if (freeOrder_ != BookOrder::NONE) {
+      auto slot = freeOrder_;
+
+      freeOrder_ = orders_[slot].next;
+
+      return slot;
+    }
+
+    orders_.emplace_back();
+
+    return static_cast<std::uint32_t>(orders_.size() - 1);
+  }
+
+  void freeOrder(std::uint32_t slot) {
+    orders_[slot].next = freeOrder_;
+    orders_[slot].level = BookOrder::NONE;
+    freeOrder_ = slot;
+  }
+
+  std::uint32_t findOrCreateLevel(bool isBidSide, double price) {
+    auto& slots = isBidSide ? bidSlots_ : askSlots_;
+    auto priceBits = getPriceBits(price);
+
+    if (auto found = slots.find(priceBits)) {
+      return found->slot;
+    }
+
+    std::uint32_t slot{};
+
+    if (freeLevel_ != BookOrder::NONE) {
+      slot = freeLevel_;
+      freeLevel_ = levels_[slot].head;
+    } else {
+      levels_.emplace_back();
+      slot = static_cast<std::uint32_t>(levels_.size() - 1);
+    }
+
+    levels_[slot] = BookLevel{price};
+    slots.insert(LevelRef{priceBits, slot});
+
+    auto& side = isBidSide ? bids_ : asks_;
+    auto position = std::lower_bound(side.begin(), side.end(), price, [this, isBidSide](std::uint32_t s, double p) {
+      return isWorse(isBidSide, levels_[s].price, p);
+    });
+
+    side.insert(position, slot);
+
+    return slot;
+  }
+
+  void removeLevel(bool isBidSide, std::uint32_t slot) {
+    auto price = levels_[slot].price;
+    auto& side = isBidSide ? bids_ : asks_;
+    auto position = std::lower_bound(side.begin(), side.end(), price, [this, isBidSide](std::uint32_t s, double p) {
+      return isWorse(isBidSide, levels_[s].price, p);
+    });
+
+    assert(position != side.end() && *position == slot);
+    side.erase(position);
+    (isBidSide ? bidSlots_ : askSlots_).erase(getPriceBits(price));
+    levels_[slot].head = freeLevel_;
+    freeLevel_ = slot;
+  }
+
+  // Appends the order to the tail of the queue of the level
+  void link(std::uint32_t slot) {
+    auto& order = orders_[slot];
+    auto levelSlot = findOrCreateLevel(isBid(order.side), order.price);
+    auto& level = levels_[levelSlot];
+
+    order.level = levelSlot;
+    order.prev = level.tail;
+    order.next = BookOrder::NONE;
+
+    if (level.tail != BookOrder::NONE) {
+      orders_[level.tail].next = slot;
+    } else {
+      level.head = slot;
+    }
+
+    level.tail = slot;
+    level.size += order.size;
+    level.ordersNumber++;
+  }
+
+  // Removes the order from the queue of the level (the empty level is removed)
+  void unlink(std::uint32_t slot) {
+    auto& order = orders_[slot];
+    auto& level = levels_[order.level];
+
+    if (order.prev != BookOrder::NONE) {
+      orders_[order.prev].next = order.next;
+    } else {
+      level.head = order.next;
+    }
+
+    if (order.next != BookOrder::NONE) {
+      orders_[order.next].prev = order.prev;
+    } else {
+      level.tail = order.prev;
+    }
+
+    level.size -= order.size;
+    level.ordersNumber--;
+
+    if (level.ordersNumber == 0) {
+      removeLevel(isBid(order.side), order.level);
+    }
+  }
+
+ public:
+  MarketByOrderEngine() = default;
+
+  // Prepares the pools and the tables for the given number of the live orders
+  void reserveOrders(std::size_t ordersNumber) {
+    orders_.reserve(ordersNumber);
+    orderSlots_.reserve(ordersNumber);
+  }
+
+  // Applies the order records (the snapshot or the transaction). The removals are the records with the REMOVE_EVENT
+  // flag, the zero or the NaN size.
+  void apply(const dxf_order_t* orders, std::size_t recordsCount) {
+    for (std::size_t i = 0; i < recordsCount; i++) {
+      const auto& record = orders[i];
+      auto isRemoval = (record.event_flags & dxf_ef_remove_event) != 0 || record.size == 0 || std::isnan(record.size);
+      auto found = orderSlots_.find(record.index);
+
+      if (found == nullptr) {
+        if (isRemoval || std::isnan(record.price)) {
+          continue;
+        }
+
+        auto slot = allocateOrder();
+
+        orders_[slot] = BookOrder{record.index, record.price, record.size, record.time, record.side};
+        orderSlots_.insert(OrderRef{record.index, slot});
+        link(slot);
+        ordersNumber_++;
+
+        continue;
+      }
+
+      auto slot = found->slot;
+      auto& order = orders_[slot];
+
+      if (isRemoval || std::isnan(record.price)) {
+        unlink(slot);
+        freeOrder(slot);
+        orderSlots_.erase(record.index);
+        ordersNumber_--;
+      } else if (record.side == order.side && getPriceBits(record.price) == getPriceBits(order.price) &&
+                 record.size <= order.size) {
+        // The same level and the reduced size: the queue position is kept
+        levels_[order.level].size += record.size - order.size;
+        order.size = record.size;
+        order.time = record.time;
+      } else {
+        unlink(slot);
+        order.price = record.price;
+        order.size = record.size;
+        order.time = record.time;
+        order.side = record.side;
+        link(slot);
+      }
+    }
+  }
+
+  // Removes all orders (e.g. before the new snapshot). Keeps the capacity.
+  void clear() {
+    orders_.clear();
+    levels_.clear();
+    freeOrder_ = BookOrder::NONE;
+    freeLevel_ = BookOrder::NONE;
+    orderSlots_.clear();
+    askSlots_.clear();
+    bidSlots_.clear();
+    asks_.clear();
+    bids_.clear();
+    ordersNumber_ = 0;
+  }
+
+  [[nodiscard]] std::size_t getOrdersNumber() const { return ordersNumber_; }
+
+  [[nodiscard]] std::size_t getLevelsNumber(bool isBidSide) const { return (isBidSide ? bids_ : asks_).size(); }
+
+  // The order of the index or nullptr. The pointer is valid until the next change of the book.
+  [[nodiscard]] const BookOrder* findOrder(dxf_long_t index) const {
+    auto found = orderSlots_.find(index);
+
+    return found == nullptr ? nullptr : &orders_[found->slot];
+  }
+
+  // The level of the position from the best one (0 - the best) or nullptr. The pointer is valid until the next change
+  // of the book.
+  [[nodiscard]] const BookLevel* getLevel(bool isBidSide, std::size_t position) const {
+    const auto& side = isBidSide ? bids_ : asks_;
+
+    return position < side.size() ? &levels_[side[side.size() - 1 - position]] : nullptr;
+  }
+
+  // The level of the price or nullptr
+  [[nodiscard]] const BookLevel* findLevel(bool isBidSide, double price) const {
+    auto found = (isBidSide ? bidSlots_ : askSlots_).find(getPriceBits(price));
+
+    return found == nullptr ? nullptr : &levels_[found->slot];
+  }
+
+  // Calls the function with every order of the level from the head of the queue. Returns the number of the orders.
+  template <typename F>
+  std::size_t forEachOrder(const BookLevel& level, F&& f) const {
+    std::size_t result = 0;
+
+    for (auto slot = level.head; slot != BookOrder::NONE; slot = orders_[slot].next) {
+      f(orders_[slot]);
+      result++;
+    }
+
+    return result;
+  }
+
+  // Calls the function with the best levels of the side (up to the depth, 0 - all) from the best one
+  template <typename F>
+  void forEachLevel(bool isBidSide, std::size_t depth, F&& f) const {
+    const auto& side = isBidSide ? bids_ : asks_;
+    auto number = depth == 0 ? side.size() : (std::min)(depth, side.size());
+
+    for (std::size_t i = 0; i < number; i++) {
+      f(levels_[side[side.size() - 1 - i]]);
+    }
+  }
+
+  // The position of the order in the queue of its level (O(position)) or std::nullopt if there is no such order
+  [[nodiscard]] std::optional<QueuePosition> getQueuePosition(dxf_long_t index) const {
+    auto found = orderSlots_.find(index);
+
+    if (found == nullptr) {
+      return std::nullopt;
+    }
+
+    QueuePosition result{};
+
+    for (auto slot = orders_[found->slot].prev; slot != BookOrder::NONE; slot = orders_[slot].prev) {
+      result.ordersAhead++;
+      result.sizeAhead += orders_[slot].size;
+    }
+
+    return result;
+  }
+
+  // The heap bytes held by the book
+  [[nodiscard]] std::size_t getMemoryUsage() const {
+    return orders_.capacity() * sizeof(BookOrder) + levels_.capacity() * sizeof(BookLevel) +
+           orderSlots_.getMemoryUsage() + askSlots_.getMemoryUsage() + bidSlots_.getMemoryUsage() +
+           (asks_.capacity() + bids_.capacity()) * sizeof(std::uint32_t);
+  }
+};
+
+// The market-by-order book of the order snapshot of the symbol and the source (the same subscription as the
+// PriceLevelBook). The records are applied on the C-API listener thread under the lock. The handlers are called once
+// per complete transaction (the records with the TX_PENDING flag are accumulated): onNewBook after the snapshot,
+// onUpdate after the incremental transaction. The book is read by the handlers or by read() from the other threads.
+//
+// Usage:
+//   auto book = MarketByOrderBook::create(connection, "AAPL", "NTV");
+//
+//   book->setOnUpdate([](const MarketByOrderEngine& engine) { auto best = engine.getLevel(true, 0); ... });
+//   book->read([](const MarketByOrderEngine& engine) { return engine.getQueuePosition(myOrderIndex); });
+class MarketByOrderBook final {
+  dxf_snapshot_t snapshot_ = nullptr;
+  std::string symbol_;
+  std::string source_;
+  bool isValid_ = false;
+  std::mutex mutex_{};
+  MarketByOrderEngine engine_{};
+  // The snapshot is being received (it's not complete yet)
+  bool snapshotPending_ = false;
+  std::function<void(const MarketByOrderEngine&)> onNewBook_{};
+  std::function<void(const MarketByOrderEngine&)> onUpdate_{};
+
+  MarketByOrderBook(std::string symbol, std::string source, std::size_t ordersNumberHint)
+      : symbol_{std::move(symbol)}, source_{std::move(source)} {
+    engine_.reserveOrders(ordersNumberHint);
+  }
+
+ public:
+  static std::unique_ptr<MarketByOrderBook> create(dxf_connection_t connection, const std::string& symbol,
+                                                   const std::string& source, std::size_t ordersNumberHint = 0) {
+    auto book = createDetached(symbol, source, ordersNumberHint);
+    const auto& wSymbol = Symbol::valueOf(symbol).getWideName();
+    dxf_snapshot_t snapshot = nullptr;
+
+    if (dxf_create_order_snapshot(connection, wSymbol.c_str(), source.c_str(), 0, &snapshot) == DXF_FAILURE) {
+      return book;
+    }
+
+    book->snapshot_ = snapshot;
+    book->isValid_ = true;
+
+    dxf_attach_snapshot_inc_listener(
+      snapshot,
+      [](const dxf_snapshot_data_ptr_t snapshotData, int newSnapshot, void* userData) {
+        static_cast<MarketByOrderBook*>(userData)->processSnapshotData(snapshotData, newSnapshot);
+      },
+      book.get());
+
+    return book;
+  }
+
+  // Creates the book without the snapshot subscription. The snapshot data is passed to the processSnapshotData by the
+  // caller (e.g. replayed from a capture file).
+  static std::unique_ptr<MarketByOrderBook> createDetached(const std::string& symbol, const std::string& source,
+                                                           std::size_t ordersNumberHint = 0) {
+    return std::unique_ptr<MarketByOrderBook>(new MarketByOrderBook(symbol, source, ordersNumberHint));
+  }
+
+  MarketByOrderBook(const MarketByOrderBook&) = delete;
+  MarketByOrderBook& operator=(const MarketByOrderBook&) = delete;
+
+  ~MarketByOrderBook() {
+    if (isValid_) {
+      dxf_close_snapshot(snapshot_);
+      isValid_ = false;
+    }
+  }
+
+  void processSnapshotData(const dxf_snapshot_data_ptr_t snapshotData, int newSnapshot) {
+    assert(snapshotData->records_count == 0 || snapshotData->event_type == dx_eid_order);
+
+    auto orders = reinterpret_cast<const dxf_order_t*>(snapshotData->records);
+    auto recordsCount = static_cast<std::size_t>(snapshotData->records_count);
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (newSnapshot != 0) {
+      engine_.clear();
+      snapshotPending_ = true;
+    }
+
+    engine_.apply(orders, recordsCount);
+
+    if (recordsCount != 0 && (orders[recordsCount - 1].event_flags & dxf_ef_tx_pending) != 0) {
+      return;
+    }
+
+    if (snapshotPending_) {
+      snapshotPending_ = false;
+
+      if (onNewBook_) {
+        onNewBook_(engine_);
+      }
+    } else if (onUpdate_ && recordsCount != 0) {
+      onUpdate_(engine_);
+    }
+  }
+
+  [[nodiscard]] bool isValid() const { return isValid_; }
+
+  [[nodiscard]] const std::string& getSymbol() const { return symbol_; }
+
+  [[nodiscard]] const std::string& getSource() const { return source_; }
+
+  // Calls the function with the book under the lock and returns its result
+  template <typename F>
+  auto read(F&& f) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return f(static_cast<const MarketByOrderEngine&>(engine_));
+  }
+
+  void setOnNewBook(std::function<void(const MarketByOrderEngine&)> onNewBookHandler) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onNewBook_ = std::move(onNewBookHandler);
+  }
+
+  void setOnUpdate(std::function<void(const MarketByOrderEngine&)> onUpdateHandler) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onUpdate_ = std::move(onUpdateHandler);
+  }
+};
+
+}  // namespace dxf
@@ -1,25 +1,51 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <utility>
 
 #include "EventType.hpp"
+#include "SymbolTable.hpp"
 
 namespace dxf {
 
 class MarketEvent : public virtual EventType<std::string> {
-  std::string eventSymbol_{};
+  // The immutable symbol is shared by the copies of the event (and by the events of the interned symbol, see
+  // SymbolTable)
+  std::shared_ptr<const std::string> eventSymbol_{};
   std::uint64_t eventTime_{};
 
+  static const std::string &getEmptySymbol() {
+    static const std::string emptySymbol{};
+
+    return emptySymbol;
+  }
+
  protected:
   MarketEvent() = default;
 
-  explicit MarketEvent(std::string eventSymbol) : eventSymbol_{std::move(eventSymbol)} {}
+  explicit MarketEvent(std::string eventSymbol)
+      : eventSymbol_{std::make_shared<const std::string>(std::move(eventSymbol))} {}
+
+  explicit MarketEvent(std::shared_ptr<const std::string> eventSymbol) : eventSymbol_{std::move(eventSymbol)} {}
 
  public:
-  [[nodiscard]] const std::string &getEventSymbol() const override { return eventSymbol_; }
+  [[nodiscard]] const std::string &getEventSymbol() const override {
+    return eventSymbol_ ? *eventSymbol_ : getEmptySymbol();
+  }
+
+  void setEventSymbol(const std::string &eventSymbol) override {
+    eventSymbol_ = std::make_shared<const std::string>(eventSymbol);
+  }
+
+  void setEventSymbol(std::shared_ptr<const std::string> eventSymbol) { eventSymbol_ = std::move(eventSymbol); }
+
+  // Shares the name of the interned symbol
+  void setEventSymbol(const Symbol &eventSymbol) { eventSymbol_ = eventSymbol.getSharedName(); }
 
-  void setEventSymbol(const std::string &eventSymbol) override { eventSymbol_ = eventSymbol; }
+  // The shared symbol (nullptr if it is not set)
+  [[nodiscard]] const std::shared_ptr<const std::string> &getSharedEventSymbol() const { return eventSymbol_; }
 
   std::uint64_t getEventTime() override { return eventTime_; }
 
@@ -0,0 +1,362 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <tuple>
+
+#include "EventCodec.hpp"
+#include "EventTraits.hpp"
+#include "OrderScope.hpp"
+#include "OrderSide.hpp"
+
+namespace dxf {
+
+// The plain (aggregate, non-virtual) events of the C API types. Every event describes its C API struct (CEventType,
+// EVENT_TYPE) and the mapping of its fields (FIELDS), so it's decoded by the EventCodec and fetched by the
+// HistoryDataProvider. IS_TIME_SERIES - the history of the event is subscribed from the beginning of the time.
+
+enum class Direction : int { UNDEFINED = 0, DOWN, ZERO_DOWN, ZERO, ZERO_UP, UP };
+
+enum class PriceType : int { UNDEFINED = 0, REGULAR, INDICATIVE, PRELIMINARY, FINAL };
+
+// REMOVE - the C API dxf_oa_delete (DELETE is the macro of the Windows headers)
+enum class OrderAction : int { UNDEFINED = 0, NEW, REPLACE, MODIFY, REMOVE, PARTIAL, EXECUTE, TRADE, BUST };
+
+enum class TradingStatus : int { UNDEFINED = 0, HALTED, ACTIVE };
+
+enum class ShortSaleRestriction : int { UNDEFINED = 0, ACTIVE, INACTIVE };
+
+namespace detail {
+
+inline const std::string &getEventSymbol(const std::shared_ptr<const std::string> &eventSymbol) {
+  static const std::string emptySymbol{};
+
+  return eventSymbol ? *eventSymbol : emptySymbol;
+}
+
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+}  // namespace detail
+
+struct Trade {
+  using CEventType = dxf_trade_t;
+  static constexpr int EVENT_TYPE = DXF_ET_TRADE;
+  static constexpr bool IS_TIME_SERIES = false;
+
+  std::shared_ptr<const std::string> eventSymbol{};
+  std::uint64_t time{};
+  std::int32_t sequence{};
+  std::int32_t timeNanos{};
+  char exchangeCode{};
+  double price{detail::NaN};
+  double size{detail::NaN};
+  std::int32_t tick{};
+  double change{detail::NaN};
+  std::int32_t dayId{};
+  double dayVolume{detail::NaN};
+  double dayTurnover{detail::NaN};
+  std::int32_t flags{};
+  Direction direction{};
+  bool isEth = false;
+  OrderScope scope{};
+
+  static constexpr auto FIELDS = std::make_tuple(
+    field(&Trade::time, &dxf_trade_t::time), field(&Trade::sequence, &dxf_trade_t::sequence),
+    field(&Trade::timeNanos, &dxf_trade_t::time_nanos), field(&Trade::exchangeCode, &dxf_trade_t::exchange_code),
+    field(&Trade::price, &dxf_trade_t::price), field(&Trade::size, &dxf_trade_t::size),
+    field(&Trade::tick, &dxf_trade_t::tick), field(&Trade::change, &dxf_trade_t::change),
+    field(&Trade::dayId, &dxf_trade_t::day_id), field(&Trade::dayVolume, &dxf_trade_t::day_volume),
+    field(&Trade::dayTurnover, &dxf_trade_t::day_turnover), field(&Trade::flags, &dxf_trade_t::raw_flags),
+    field(&Trade::direction, &dxf_trade_t::direction), field(&Trade::isEth, &dxf_trade_t::is_eth),
+    field(&Trade::scope, &dxf_trade_t::scope));
+
+  [[nodiscard]] const std::string &getEventSymbol() const { return detail::getEventSymbol(eventSymbol); }
+};
+
+struct Quote {
+  using CEventType = dxf_quote_t;
+  static constexpr int EVENT_TYPE = DXF_ET_QUOTE;
+  static constexpr bool IS_TIME_SERIES = false;
+
+  std::shared_ptr<const std::string> eventSymbol{};
+  std::uint64_t time{};
+  std::int32_t sequence{};
+  std::int32_t timeNanos{};
+  std::uint64_t bidTime{};
+  char bidExchangeCode{};
+  double bidPrice{detail::NaN};
+  double bidSize{detail::NaN};
+  std::uint64_t askTime{};
+  char askExchangeCode{};
+  double askPrice{detail::NaN};
+  double askSize{detail::NaN};
+  OrderScope scope{};
+
+  static constexpr auto FIELDS = std::make_tuple(
+    field(&Quote::time, &dxf_quote_t::time), field(&Quote::sequence, &dxf_quote_t::sequence),
+    field(&Quote::timeNanos, &dxf_quote_t::time_nanos), field(&Quote::bidTime, &dxf_quote_t::bid_time),
+    field(&Quote::bidExchangeCode, &dxf_quote_t::bid_exchange_code), field(&Quote::bidPrice, &dxf_quote_t::bid_price),
+    field(&Quote::bidSize, &dxf_quote_t::bid_size), field(&Quote::askTime, &dxf_quote_t::ask_time),
+    field(&Quote::askExchangeCode, &dxf_quote_t::ask_exchange_code), field(&Quote::askPrice, &dxf_quote_t::ask_price),
+    field(&Quote::askSize, &dxf_quote_t::ask_size), field(&Quote::scope, &dxf_quote_t::scope));
+
+  [[nodiscard]] const std::string &getEventSymbol() const { return detail::getEventSymbol(eventSymbol); }
+};
+
+struct Summary {
+  using CEventType = dxf_summary_t;
+  static constexpr int EVENT_TYPE = DXF_ET_SUMMARY;
+  static constexpr bool IS_TIME_SERIES = false;
+
+  std::shared_ptr<const std::string> eventSymbol{};
+  std::int32_t dayId{};
+  double dayOpenPrice{detail::NaN};
+  double dayHighPrice{detail::NaN};
+  double dayLowPrice{detail::NaN};
+  double dayClosePrice{detail::NaN};
+  PriceType dayClosePriceType{};
+  std::int32_t prevDayId{};
+  double prevDayClosePrice{detail::NaN};
+  PriceType prevDayClosePriceType{};
+  double prevDayVolume{detail::NaN};
+  double openInterest{detail::NaN};
+  std::int32_t flags{};
+  char exchangeCode{};
+  OrderScope scope{};
+
+  static constexpr auto FIELDS = std::make_tuple(
+    field(&Summary::dayId, &dxf_summary_t::day_id), field(&Summary::dayOpenPrice, &dxf_summary_t::day_open_price),
+    field(&Summary::dayHighPrice, &dxf_summary_t::day_high_price),
+    field(&Summary::dayLowPrice, &dxf_summary_t::day_low_price),
+    field(&Summary::dayClosePrice, &dxf_summary_t::day_close_price),
+    field(&Summary::dayClosePriceType, &dxf_summary_t::day_close_price_type),
+    field(&Summary::prevDayId, &dxf_summary_t::prev_day_id),
+    field(&Summary::prevDayClosePrice, &dxf_summary_t::prev_day_close_price),
+    field(&Summary::prevDayClosePriceType, &dxf_summary_t::prev_day_close_price_type),
+    field(&Summary::prevDayVolume, &dxf_summary_t::prev_day_volume),
+    field(&Summary::openInterest, &dxf_summary_t::open_interest), field(&Summary::flags, &dxf_summary_t::raw_flags),
+    field(&Summary::exchangeCode, &dxf_summary_t::exchange_code), field(&Summary::scope, &dxf_summary_t::scope));
+
+  [[nodiscard]] const std::string &getEventSymbol() const { return detail::getEventSymbol(eventSymbol); }
+};
+
+struct Profile {
+  using CEventType = dxf_profile_t;
+  static constexpr int EVENT_TYPE = DXF_ET_PROFILE;
+  static constexpr bool IS_TIME_SERIES = false;
+
+  std::shared_ptr<const std::string> eventSymbol{};
+  double beta{detail::NaN};
+  double eps{detail::NaN};
+  double divFreq{detail::NaN};
+  double exdDivAmount{detail::NaN};
+  std::int32_t exdDivDate{};
+  double high52WeekPrice{detail::NaN};
+  double low52WeekPrice{detail::NaN};
+  double shares{detail::NaN};
+  double freeFloat{detail::NaN};
+  double highLimitPrice{detail::NaN};
+  double lowLimitPrice{detail::NaN};
+  std::uint64_t haltStartTime{};
+  std::uint64_t haltEndTime{};
+  std::int32_t flags{};
+  std::string description{};
+  std::string statusReason{};
+  TradingStatus tradingStatus{};
+  ShortSaleRestriction shortSaleRestriction{};
+
+  static constexpr auto FIELDS = std::make_tuple(
+    field(&Profile::beta, &dxf_profile_t::beta), field(&Profile::eps, &dxf_profile_t::eps),
+    field(&Profile::divFreq, &dxf_profile_t::div_freq), field(&Profile::exdDivAmount, &dxf_profile_t::exd_div_amount),
+    field(&Profile::exdDivDate, &dxf_profile_t::exd_div_date),
+    field(&Profile::high52WeekPrice, &dxf_profile_t::high_52_week_price),
+    field(&Profile::low52WeekPrice, &dxf_profile_t::low_52_week_price), field(&Profile::shares, &dxf_profile_t::shares),
+    field(&Profile::freeFloat, &dxf_profile_t::free_float),
+    field(&Profile::highLimitPrice, &dxf_profile_t::high_limit_price),
+    field(&Profile::lowLimitPrice, &dxf_profile_t::low_limit_price),
+    field(&Profile::haltStartTime, &dxf_profile_t::halt_start_time),
+    field(&Profile::haltEndTime, &dxf_profile_t::halt_end_time), field(&Profile::flags, &dxf_profile_t::raw_flags),
+    field(&Profile::description, &dxf_profile_t::description),
+    field(&Profile::statusReason, &dxf_profile_t::status_reason),
+    field(&Profile::tradingStatus, &dxf_profile_t::trading_status),
+    field(&Profile::shortSaleRestriction, &dxf_profile_t::ssr));
+
+  [[nodiscard]] const std::string &getEventSymbol() const { return detail::getEventSymbol(eventSymbol); }
+};
+
+// The source and the market maker of the order (the union of the C API struct) are not mapped: the active member
+// depends on the record of the order
+struct Order {
+  using CEventType = dxf_order_t;
+  static constexpr int EVENT_TYPE = DXF_ET_ORDER;
+  static constexpr bool IS_TIME_SERIES = false;
+
+  std::shared_ptr<const std::string> eventSymbol{};
+  std::uint32_t eventFlags{};
+  std::uint64_t index{};
+  std::uint64_t time{};
+  std::int32_t timeNanos{};
+  std::int32_t sequence{};
+  std::uint64_t actionTime{};
+  std::int64_t orderId{};
+  std::int64_t auxOrderId{};
+  double price{detail::NaN};
+  double size{detail::NaN};
+  double executedSize{detail::NaN};
+  double count{detail::NaN};
+  OrderAction action{};
+  std::int64_t tradeId{};
+  double tradePrice{detail::NaN};
+  double tradeSize{detail::NaN};
+  char exchangeCode{};
+  OrderSide side{};
+  OrderScope scope{};
+  std::string spreadSymbol{};
+
+  static constexpr auto FIELDS = std::make_tuple(
+    field(&Order::eventFlags, &dxf_order_t::event_flags), field(&Order::index, &dxf_order_t::index),
+    field(&Order::time, &dxf_order_t::time), field(&Order::timeNanos, &dxf_order_t::time_nanos),
+    field(&Order::sequence, &dxf_order_t::sequence), field(&Order::actionTime, &dxf_order_t::action_time),
+    field(&Order::orderId, &dxf_order_t::order_id), field(&Order::auxOrderId, &dxf_order_t::aux_order_id),
+    field(&Order::price, &dxf_order_t::price), field(&Order::size, &dxf_order_t::size),
+    field(&Order::executedSize, &dxf_order_t::executed_size), field(&Order::count, &dxf_order_t::count),
+    field(&Order::action, &dxf_order_t::action), field(&Order::tradeId, &dxf_order_t::trade_id),
+    field(&Order::tradePrice, &dxf_order_t::trade_price), field(&Order::tradeSize, &dxf_order_t::trade_size),
+    field(&Order::exchangeCode, &dxf_order_t::exchange_code), field(&Order::side, &dxf_order_t::side),
+    field(&Order::scope, &dxf_order_t::scope), field(&Order::spreadSymbol, &dxf_order_t::spread_symbol));
+
+  [[nodiscard]] const std::string &getEventSymbol() const { return detail::getEventSymbol(eventSymbol); }
+};
+
+struct Candle {
+  using CEventType = dxf_candle_t;
+  static constexpr int EVENT_TYPE = DXF_ET_CANDLE;
+  static constexpr bool IS_TIME_SERIES = true;
+
+  std::shared_ptr<const std::string> eventSymbol{};
+  std::uint32_t eventFlags{};
+  std::uint64_t index{};
+  std::uint64_t time{};
+  std::int32_t sequence{};
+  double count{detail::NaN};
+  double open{detail::NaN};
+  double high{detail::NaN};
+  double low{detail::NaN};
+  double close{detail::NaN};
+  double volume{detail::NaN};
+  double vwap{detail::NaN};
+  double bidVolume{detail::NaN};
+  double askVolume{detail::NaN};
+  double impVolatility{detail::NaN};
+  double openInterest{detail::NaN};
+
+  static constexpr auto FIELDS = std::make_tuple(
+    field(&Candle::eventFlags, &dxf_candle_t::event_flags), field(&Candle::index, &dxf_candle_t::index),
+    field(&Candle::time, &dxf_candle_t::time), field(&Candle::sequence, &dxf_candle_t::sequence),
+    field(&Candle::count, &dxf_candle_t::count), field(&Candle::open, &dxf_candle_t::open),
+    field(&Candle::high, &dxf_candle_t::high), field(&Candle::low, &dxf_candle_t::low),
+    field(&Candle::close, &dxf_candle_t::close), field(&Candle::volume, &dxf_candle_t::volume),
+    field(&Candle::vwap, &dxf_candle_t::vwap), field(&Candle::bidVolume, &dxf_candle_t::bid_volume),
+    field(&Candle::askVolume, &dxf_candle_t::ask_volume), field(&Candle::impVolatility, &dxf_candle_t::imp_volatility),
+    field(&Candle::openInterest, &dxf_candle_t::open_interest));
+
+  [[nodiscard]] const std::string &getEventSymbol() const { return detail::getEventSymbol(eventSymbol); }
+};
+
+// The option greeks and the theoretical price of the option (the time series of the calculations)
+struct Greeks {
+  using CEventType = dxf_greeks_t;
+  static constexpr int EVENT_TYPE = DXF_ET_GREEKS;
+  static constexpr bool IS_TIME_SERIES = true;
+
+  std::shared_ptr<const std::string> eventSymbol{};
+  std::uint32_t eventFlags{};
+  std::uint64_t index{};
+  std::uint64_t time{};
+  double price{detail::NaN};
+  double volatility{detail::NaN};
+  double delta{detail::NaN};
+  double gamma{detail::NaN};
+  double theta{detail::NaN};
+  double rho{detail::NaN};
+  double vega{detail::NaN};
+
+  static constexpr auto FIELDS = std::make_tuple(
+    field(&Greeks::eventFlags, &dxf_greeks_t::event_flags), field(&Greeks::index, &dxf_greeks_t::index),
+    field(&Greeks::time, &dxf_greeks_t::time), field(&Greeks::price, &dxf_greeks_t::price),
+    field(&Greeks::volatility, &dxf_greeks_t::volatility), field(&Greeks::delta, &dxf_greeks_t::delta),
+    field(&Greeks::gamma, &dxf_greeks_t::gamma), field(&Greeks::theta, &dxf_greeks_t::theta),
+    field(&Greeks::rho, &dxf_greeks_t::rho), field(&Greeks::vega, &dxf_greeks_t::vega));
+
+  [[nodiscard]] const std::string &getEventSymbol() const { return detail::getEventSymbol(eventSymbol); }
+};
+
+// The properties of the option series of the underlying (indexed by the expiration, not the time series)
+struct Series {
+  using CEventType = dxf_series_t;
+  static constexpr int EVENT_TYPE = DXF_ET_SERIES;
+  static constexpr bool IS_TIME_SERIES = false;
+
+  std::shared_ptr<const std::string> eventSymbol{};
+  std::uint32_t eventFlags{};
+  std::uint64_t index{};
+  std::uint64_t time{};
+  std::int32_t sequence{};
+  std::int32_t expiration{};
+  double volatility{detail::NaN};
+  double callVolume{detail::NaN};
+  double putVolume{detail::NaN};
+  double putCallRatio{detail::NaN};
+  double forwardPrice{detail::NaN};
+  double dividend{detail::NaN};
+  double interest{detail::NaN};
+
+  static constexpr auto FIELDS = std::make_tuple(
+    field(&Series::eventFlags, &dxf_series_t::event_flags), field(&Series::index, &dxf_series_t::index),
+    field(&Series::time, &dxf_series_t::time), field(&Series::sequence, &dxf_series_t::sequence),
+    field(&Series::expiration, &dxf_series_t::expiration), field(&Series::volatility, &dxf_series_t::volatility),
+    field(&Series::callVolume, &dxf_series_t::call_volume), field(&Series::putVolume, &dxf_series_t::put_volume),
+    field(&Series::putCallRatio, &dxf_series_t::put_call_ratio),
+    field(&Series::forwardPrice, &dxf_series_t::forward_price), field(&Series::dividend, &dxf_series_t::dividend),
+    field(&Series::interest, &dxf_series_t::interest));
+
+  [[nodiscard]] const std::string &getEventSymbol() const { return detail::getEventSymbol(eventSymbol); }
+};
+
+template <>
+struct EventTraits<Order> {
+  static std::uint64_t getIndex(const Order& e) { return e.index; }
+
+  static std::uint32_t getEventFlags(const Order& e) { return e.eventFlags; }
+};
+
+template <>
+struct EventTraits<Candle> {
+  static std::uint64_t getIndex(const Candle& e) { return e.index; }
+
+  static std::uint32_t getEventFlags(const Candle& e) { return e.eventFlags; }
+
+  static std::uint64_t getTime(const Candle& e) { return e.time; }
+};
+
+template <>
+struct EventTraits<Greeks> {
+  static std::uint64_t getIndex(const Greeks& e) { return e.index; }
+
+  static std::uint32_t getEventFlags(const Greeks& e) { return e.eventFlags; }
+
+  static std::uint64_t getTime(const Greeks& e) { return e.time; }
+};
+
+template <>
+struct EventTraits<Series> {
+  static std::uint64_t getIndex(const Series& e) { return e.index; }
+
+  static std::uint32_t getEventFlags(const Series& e) { return e.eventFlags; }
+};
+
+}  // namespace dxf
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace dxf {
+
+// The pool of the small short-lived blocks (e.g. the nodes of the MpscQueue): the free lists of the size classes of
+// every thread. The block is returned to the free list of the thread that has allocated it: the block freed by another
+// thread is pushed to the lock-free list of the owner, and the owner takes them all when its own list of the class is
+// empty. The caches of the exited threads are adopted by the new threads, the blocks are never returned to the system.
+//
+// The pool is disabled by default (setEnabled): the blocks are allocated by the operator new. The blocks of both modes
+// can be freed in any mode.
+class MemoryPool final {
+ public:
+  // The blocks of the larger sizes are allocated by the operator new
+  static constexpr std::size_t MAX_BLOCK_SIZE = 512;
+
+  struct Stats {
+    // The allocations from the free lists
+    std::uint64_t hits = 0;
+    // The allocations of the new blocks
+    std::uint64_t misses = 0;
+    // The blocks freed by the threads that haven't allocated them
+    std::uint64_t remoteFrees = 0;
+  };
+
+ private:
+  // The classes: 16, 32, 64, 128, 256 and 512 bytes
+  static constexpr std::size_t CLASSES_NUMBER = 6;
+  static constexpr std::size_t MIN_BLOCK_SIZE = 16;
+  // The header keeps the block aligned as the operator new does
+  static constexpr std::size_t HEADER_SIZE = alignof(std::max_align_t);
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct ThreadCache {
+    std::array<FreeBlock*, CLASSES_NUMBER> freeBlocks{};
+    std::array<std::atomic<FreeBlock*>, CLASSES_NUMBER> remoteFreeBlocks{};
+    // Written by the thread of the cache only
+    std::atomic<std::uint64_t> hits{};
+    std::atomic<std::uint64_t> misses{};
+    std::atomic<std::uint64_t> remoteFrees{};
+  };
+
+  // The owner is nullptr if the block is allocated by the operator new
+  struct Header {
+    ThreadCache* owner;
+    std::size_t sizeClass;
+  };
+
+  static_assert(sizeof(Header) <= HEADER_SIZE);
+
+  struct Registry {
+    std::mutex mutex{};
+    std::vector<std::unique_ptr<ThreadCache>> caches{};
+    // The caches of the exited threads
+    std::vector<ThreadCache*> orphans{};
+    std::atomic<bool> isEnabled{false};
+  };
+
+  // Gives the cache of the thread back to the registry when the thread exits
+  class CacheHolder final {
+    ThreadCache* cache_;
+
+   public:
+    CacheHolder() : cache_{adoptCache()} {}
+
+    CacheHolder(const CacheHolder&) = delete;
+    CacheHolder& operator=(const CacheHolder&) = delete;
+
+    ~CacheHolder() {
+      auto& registry = getRegistry();
+      std::lock_guard guard(registry.mutex);
+
+      registry.orphans.push_back(cache_);
+    }
+
+    [[nodiscard]] ThreadCache& get() const { return *cache_; }
+  };
+
+  // Never destroyed: the blocks can be freed by the destructors of the other static objects
+  static Registry& getRegistry() {
+    static auto* registry = new Registry{};
+
+    return *registry;
+  }
+
+  static ThreadCache* adoptCache() {
+    auto& registry = getRegistry();
+    std::lock_guard guard(registry.mutex);
+
+    if (!registry.orphans.empty()) {
+      auto* cache = registry.orphans.back();
+
+      registry.orphans.pop_back();
+
+      return cache;
+    }
+
+    return registry.caches.emplace_back(std::make_unique<ThreadCache>()).get();
+  }
+
+  static ThreadCache& getThreadCache() {
+    thread_local CacheHolder holder{};
+
+    return holder.get();
+  }
+
+  static std::size_t getSizeClass(std::size_t size) {
+    std::size_t result = 0;
+
+    for (auto blockSize = MIN_BLOCK_SIZE; blockSize < size; blockSize <<= 1U) {
+      result++;
+    }
+
+    return result;
+  }
+
+  static void increment(std::atomic<std::uint64_t>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  static void* allocateBlock(std::size_t size, ThreadCache* owner, std::size_t sizeClass) {
+    auto* raw = static_cast<std::byte*>(::operator new(HEADER_SIZE + size));
+
+    new (raw) Header{owner, sizeClass};
+
+    return raw + HEADER_SIZE;
+  }
+
+ public:
+  static void setEnabled(bool isEnabled) { getRegistry().isEnabled.store(isEnabled, std::memory_order_relaxed); }
+
+  [[nodiscard]] static bool isEnabled() { return getRegistry().isEnabled.load(std::memory_order_relaxed); }
+
+  // Throws std::bad_alloc as the operator new
+  static void* allocate(std::size_t size) {
+    if (size > MAX_BLOCK_SIZE || !isEnabled()) {
+      return allocateBlock(size, nullptr, CLASSES_NUMBER);
+    }
+
+    auto sizeClass = getSizeClass(size);
+    auto& cache = getThreadCache();
+    auto* block = cache.freeBlocks[sizeClass];
+
+    if (block == nullptr) {
+      block = cache.remoteFreeBlocks[sizeClass].exchange(nullptr, std::memory_order_acquire);
+    }
+
+    if (block == nullptr) {
+      increment(cache.misses);
+
+      return allocateBlock(MIN_BLOCK_SIZE << sizeClass, &cache, sizeClass);
+    }
+
+    cache.freeBlocks[sizeClass] = block->next;
+    increment(cache.hits);
+
+    return block;
+  }
+
+  static void deallocate(void* pointer) noexcept {
+    if (pointer == nullptr) {
+      return;
+    }
+
+    auto* raw = static_cast<std::byte*>(pointer) - HEADER_SIZE;
+    auto* header = reinterpret_cast<Header*>(raw);
+
+    if (header->owner == nullptr) {
+      ::operator delete(raw);
+
+      return;
+    }
+
+    auto& cache = getThreadCache();
+    auto* block = new (pointer) FreeBlock{};
+    auto sizeClass = header->sizeClass;
+
+    if (header->owner == &cache) {
+      block->next = cache.freeBlocks[sizeClass];
+      cache.freeBlocks[sizeClass] = block;
+
+      return;
+    }
+
+    auto& remoteFreeBlocks = header->owner->remoteFreeBlocks[sizeClass];
+
+    block->next = remoteFreeBlocks.load(std::memory_order_relaxed);
+
+    while (!remoteFreeBlocks.compare_exchange_weak(block->next, block, std::memory_order_release,
+                                                   std::memory_order_relaxed)) {
+    }
+
+    increment(cache.remoteFrees);
+  }
+
+  // The sums of the statistics of all the threads
+  static Stats getStats() {
+    auto& registry = getRegistry();
+    std::lock_guard guard(registry.mutex);
+    Stats result{};
+
+    for (const auto& cache : registry.caches) {
+      result.hits += cache->hits.load(std::memory_order_relaxed);
+      result.misses += cache->misses.load(std::memory_order_relaxed);
+      result.remoteFrees += cache->remoteFrees.load(std::memory_order_relaxed);
+    }
+
+    return result;
+  }
+};
+
+}  // namespace dxf
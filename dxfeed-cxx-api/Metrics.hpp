@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "LatencyStats.hpp"
+
+namespace dxf {
+
+// The labels of the metric (e.g. {"symbol", "AAPL"}, {"source", "NTV"})
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+enum class MetricKind : int {
+  // The monotonic number (e.g. the events, the drops)
+  COUNTER = 0,
+  // The current value (e.g. the queue depth, the RTT)
+  GAUGE = 1,
+  // The distribution of the values (the HDR-style buckets of the LatencyHistogramSnapshot)
+  HISTOGRAM = 2
+};
+
+// One value of the scrape (see MetricsRegistry::scrape)
+struct MetricSample {
+  std::string name{};
+  std::string help{};
+  MetricLabels labels{};
+  MetricKind kind = MetricKind::GAUGE;
+  // The counter or the gauge
+  double value = 0.0;
+  // The histogram
+  LatencyHistogramSnapshot histogram{};
+};
+
+// Adds the samples of the collector (see MetricsRegistry::addCollector and the collectMetrics of the components)
+class MetricsWriter final {
+  std::vector<MetricSample>& samples_;
+
+ public:
+  explicit MetricsWriter(std::vector<MetricSample>& samples) : samples_{samples} {}
+
+  void counter(std::string name, std::string help, const MetricLabels& labels, double value) {
+    samples_.push_back({std::move(name), std::move(help), labels, MetricKind::COUNTER, value, {}});
+  }
+
+  void gauge(std::string name, std::string help, const MetricLabels& labels, double value) {
+    samples_.push_back({std::move(name), std::move(help), labels, MetricKind::GAUGE, value, {}});
+  }
+
+  void histogram(std::string name, std::string help, const MetricLabels& labels,
+                 const LatencyHistogramSnapshot& histogram) {
+    samples_.push_back({std::move(name), std::move(help), labels, MetricKind::HISTOGRAM, 0.0, histogram});
+  }
+};
+
+namespace detail {
+
+// The shards of the metrics: the threads are spread over them round-robin, so the threads of different shards don't
+// share the cache lines of the counters
+inline constexpr std::size_t METRIC_SHARDS_NUMBER = 16;
+inline constexpr std::size_t METRIC_CACHE_LINE_SIZE = 64;
+
+inline std::size_t getMetricShardIndex() {
+  static std::atomic<std::size_t> nextIndex{0};
+  thread_local const std::size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARDS_NUMBER;
+
+  return index;
+}
+
+}  // namespace detail
+
+// The counter that is incremented by any thread: one relaxed increment of the shard of the thread. The shards are
+// summed by the scrape.
+class MetricCounter final {
+  struct alignas(detail::METRIC_CACHE_LINE_SIZE) Shard {
+    std::atomic<std::uint64_t> value{0};
+  };
+
+  std::array<Shard, detail::METRIC_SHARDS_NUMBER> shards_{};
+
+ public:
+  void increase(std::uint64_t delta = 1) {
+    shards_[detail::getMetricShardIndex()].value.fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] std::uint64_t get() const {
+    std::uint64_t result = 0;
+
+    for (const auto& shard : shards_) {
+      result += shard.value.load(std::memory_order_relaxed);
+    }
+
+    return result;
+  }
+};
+
+// The current value: one relaxed store (or increment)
+class MetricGauge final {
+  std::atomic<std::int64_t> value_{0};
+
+ public:
+  void set(std::int64_t value) { value_.store(value, std::memory_order_relaxed); }
+
+  void add(std::int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+
+  [[nodiscard]] std::int64_t get() const { return value_.load(std::memory_order_relaxed); }
+};
+
+// The HDR-style histogram that is recorded by any thread: two relaxed increments (the bucket and the sum) of the shard
+// of the thread. The shards are merged by the scrape, the count and the max are taken from the buckets.
+class MetricHistogram final {
+  struct alignas(detail::METRIC_CACHE_LINE_SIZE) Shard {
+    std::array<std::atomic<std::uint64_t>, LatencyHistogramSnapshot::BUCKETS_NUMBER> counts{};
+    std::atomic<std::uint64_t> sum{0};
+  };
+
+  std::unique_ptr<Shard[]> shards_ = std::make_unique<Shard[]>(detail::METRIC_SHARDS_NUMBER);
+
+ public:
+  void record(std::uint64_t value) {
+    auto& shard = shards_[detail::getMetricShardIndex()];
+
+    shard.counts[LatencyHistogramSnapshot::getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] LatencyHistogramSnapshot getSnapshot() const {
+    LatencyHistogramSnapshot result{};
+
+    for (std::size_t i = 0; i < detail::METRIC_SHARDS_NUMBER; i++) {
+      for (std::size_t bucket = 0; bucket < LatencyHistogramSnapshot::BUCKETS_NUMBER; bucket++) {
+        auto count = shards_[i].counts[bucket].load(std::memory_order_relaxed);
+
+        result.counts[bucket] += count;
+        result.count += count;
+
+        if (count != 0) {
+          result.max = (std::max)(result.max, LatencyHistogramSnapshot::getBucketValue(bucket));
+        }
+      }
+
+      result.sum += shards_[i].sum.load(std::memory_order_relaxed);
+    }
+
+    return result;
+  }
+};
+
+// The registry of the metrics of the process. The owned metrics (counter, gauge, histogram) are created once (e.g. at
+// the start) and updated by the hot paths without the locks. The components that keep their own counters (the
+// PriceLevelBook, the EventDispatcher, the ConnectionMetrics, the EventStream) are registered by the collectors that
+// read the counters only when the metrics are scraped, so their hot paths are not changed.
+//
+// The scrape (the exporters of MetricsExport.hpp, e.g. the Prometheus endpoint or the StatsD push) takes the registry
+// lock and may run concurrently with the updates.
+//
+// Usage:
+//   MetricsRegistry registry{};
+//   auto& events = registry.counter("dxf_events_total", "The received events", {{"type", "Quote"}});
+//
+//   events.increase(count);   // the listener
+//
+//   auto id = registry.addCollector([&book](MetricsWriter& writer) { book.collectMetrics(writer, {}); });
+//   ...
+//   registry.removeCollector(id);  // before the book is destroyed
+class MetricsRegistry final {
+  template <typename Metric>
+  struct Entry {
+    std::string name;
+    std::string help;
+    MetricLabels labels;
+    Metric metric{};
+  };
+
+  mutable std::mutex mutex_{};
+  // The deques keep the addresses of the metrics
+  std::deque<Entry<MetricCounter>> counters_{};
+  std::deque<Entry<MetricGauge>> gauges_{};
+  std::deque<Entry<MetricHistogram>> histograms_{};
+  std::vector<std::pair<std::size_t, std::function<void(MetricsWriter&)>>> collectors_{};
+  std::size_t lastCollectorId_ = 0;
+
+  template <typename Metric>
+  static Metric& getOrAdd(std::deque<Entry<Metric>>& entries, std::string_view name, std::string_view help,
+                          const MetricLabels& labels) {
+    for (auto& entry : entries) {
+      if (entry.name == name && entry.labels == labels) {
+        return entry.metric;
+      }
+    }
+
+    return entries.emplace_back(std::string{name}, std::string{help}, labels).metric;
+  }
+
+ public:
+  MetricsRegistry() = default;
+  MetricsRegistry(const MetricsRegistry&) = delete;
+  MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+  // Returns the counter of the name and the labels (the existing one or the new one). The reference is valid while the
+  // registry exists.
+  MetricCounter& counter(std::string_view name, std::string_view help, const MetricLabels& labels = {}) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return getOrAdd(counters_, name, help, labels);
+  }
+
+  MetricGauge& gauge(std::string_view name, std::string_view help, const MetricLabels& labels = {}) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return getOrAdd(gauges_, name, help, labels);
+  }
+
+  MetricHistogram& histogram(std::string_view name, std::string_view help, const MetricLabels& labels = {}) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return getOrAdd(histograms_, name, help, labels);
+  }
+
+  // Adds the collector that is called by every scrape (on the thread of the exporter). Returns the id for the
+  // removeCollector.
+  std::size_t addCollector(std::function<void(MetricsWriter&)> collector) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    collectors_.emplace_back(++lastCollectorId_, std::move(collector));
+
+    return lastCollectorId_;
+  }
+
+  // After the return, the collector is not called (e.g. the component can be destroyed)
+  void removeCollector(std::size_t id) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    std::erase_if(collectors_, [id](const auto& collector) { return collector.first == id; });
+  }
+
+  // The values of all the metrics and the collectors
+  [[nodiscard]] std::vector<MetricSample> scrape() const {
+    std::vector<MetricSample> result{};
+    MetricsWriter writer{result};
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    for (const auto& entry : counters_) {
+      writer.counter(entry.name, entry.help, entry.labels, static_cast<double>(entry.metric.get()));
+    }
+
+    for (const auto& entry : gauges_) {
+      writer.gauge(entry.name, entry.help, entry.labels, static_cast<double>(entry.metric.get()));
+    }
+
+    for (const auto& entry : histograms_) {
+      writer.histogram(entry.name, entry.help, entry.labels, entry.metric.getSnapshot());
+    }
+
+    for (const auto& collector : collectors_) {
+      collector.second(writer);
+    }
+
+    return result;
+  }
+};
+
+}  // namespace dxf
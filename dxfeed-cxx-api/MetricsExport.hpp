@@ -0,0 +1,502 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "Metrics.hpp"
+
+namespace dxf {
+
+namespace detail {
+
+#ifdef _WIN32
+using MetricsSocket = SOCKET;
+
+inline const MetricsSocket INVALID_METRICS_SOCKET = INVALID_SOCKET;
+
+inline void closeMetricsSocket(MetricsSocket s) { closesocket(s); }
+
+inline int pollMetricsSocket(MetricsSocket s, int timeoutMillis) {
+  WSAPOLLFD descriptor{s, POLLIN, 0};
+
+  return WSAPoll(&descriptor, 1, timeoutMillis);
+}
+#else
+using MetricsSocket = int;
+
+inline const MetricsSocket INVALID_METRICS_SOCKET = -1;
+
+inline void closeMetricsSocket(MetricsSocket s) { close(s); }
+
+inline int pollMetricsSocket(MetricsSocket s, int timeoutMillis) {
+  pollfd descriptor{s, POLLIN, 0};
+
+  return poll(&descriptor, 1, timeoutMillis);
+}
+#endif
+
+// The closed connection of the scraper is detected by the result of the send instead of the SIGPIPE
+#ifdef MSG_NOSIGNAL
+inline constexpr int METRICS_SEND_FLAGS = MSG_NOSIGNAL;
+#else
+inline constexpr int METRICS_SEND_FLAGS = 0;
+#endif
+
+// The integral values are written without the exponent (e.g. the counters above 1e6)
+inline void appendMetricValue(std::string& out, double value) {
+  if (std::isfinite(value) && value == std::floor(value) && std::fabs(value) < 9007199254740992.0) {
+    fmt::format_to(std::back_inserter(out), "{}", static_cast<std::int64_t>(value));
+  } else {
+    fmt::format_to(std::back_inserter(out), "{}", value);
+  }
+}
+
+inline void appendPrometheusLabels(std::string& out, const MetricLabels& labels, std::string_view extraName = {},
+                                   std::string_view extraValue = {}) {
+  if (labels.empty() && extraName.empty()) {
+    return;
+  }
+
+  auto appendLabel = [&out, isFirst = true](std::string_view name, std::string_view value) mutable {
+    out += isFirst ? "{" : ",";
+    out += name;
+    out += "=\"";
+
+    for (auto c : value) {
+      if (c == '\\' || c == '"') {
+        out += '\\';
+        out += c;
+      } else if (c == '\n') {
+        out += "\\n";
+      } else {
+        out += c;
+      }
+    }
+
+    out += '"';
+    isFirst = false;
+  };
+
+  for (const auto& [name, value] : labels) {
+    appendLabel(name, value);
+  }
+
+  if (!extraName.empty()) {
+    appendLabel(extraName, extraValue);
+  }
+
+  out += '}';
+}
+
+}  // namespace detail
+
+// The quantiles of the histograms in the Prometheus summaries and the StatsD gauges
+inline constexpr std::array<double, 4> METRIC_QUANTILES{0.5, 0.9, 0.99, 0.999};
+
+// Writes the samples in the Prometheus text exposition format (version 0.0.4). The histograms are written as the
+// summaries (the quantiles, the sum and the count) instead of the hundreds of the HDR buckets.
+inline std::string toPrometheusText(const std::vector<MetricSample>& samples) {
+  std::string result{};
+  // The samples of one name are written in a row (e.g. the metrics of the books are collected book by book), in the
+  // order of the first samples of the names
+  std::unordered_map<std::string_view, std::size_t> groups{};
+  std::vector<std::pair<std::size_t, const MetricSample*>> ordered{};
+
+  ordered.reserve(samples.size());
+
+  for (const auto& sample : samples) {
+    ordered.emplace_back(groups.try_emplace(sample.name, groups.size()).first->second, &sample);
+  }
+
+  std::stable_sort(ordered.begin(), ordered.end(),
+                   [](const auto& left, const auto& right) { return left.first < right.first; });
+
+  for (std::size_t i = 0; i < ordered.size(); i++) {
+    const auto& sample = *ordered[i].second;
+
+    if (i == 0 || ordered[i - 1].first != ordered[i].first) {
+      static constexpr std::array<const char*, 3> TYPES{"counter", "gauge", "summary"};
+
+      fmt::format_to(std::back_inserter(result), "# HELP {} {}\n# TYPE {} {}\n", sample.name, sample.help,
+                     sample.name, TYPES[static_cast<std::size_t>(sample.kind)]);
+    }
+
+    if (sample.kind != MetricKind::HISTOGRAM) {
+      result += sample.name;
+      detail::appendPrometheusLabels(result, sample.labels);
+      result += ' ';
+      detail::appendMetricValue(result, sample.value);
+      result += '\n';
+
+      continue;
+    }
+
+    for (auto quantile : METRIC_QUANTILES) {
+      result += sample.name;
+      detail::appendPrometheusLabels(result, sample.labels, "quantile", fmt::format("{}", quantile));
+      fmt::format_to(std::back_inserter(result), " {}\n", sample.histogram.getPercentile(quantile * 100.0));
+    }
+
+    result += sample.name;
+    result += "_sum";
+    detail::appendPrometheusLabels(result, sample.labels);
+    fmt::format_to(std::back_inserter(result), " {}\n", sample.histogram.sum);
+    result += sample.name;
+    result += "_count";
+    detail::appendPrometheusLabels(result, sample.labels);
+    fmt::format_to(std::back_inserter(result), " {}\n", sample.histogram.count);
+  }
+
+  return result;
+}
+
+// Serves the metrics of the registry by HTTP (GET /metrics in the Prometheus text format) on its thread. The
+// connections are served one at a time, so the scrapes don't compete with the application threads. GET /diagnostics
+// serves the JSON report of the diagnostics handler if it's set (see setDiagnostics).
+//
+// Windows: WSAStartup must be called by the application.
+class MetricsHttpServer final {
+  const MetricsRegistry& registry_;
+  detail::MetricsSocket socket_ = detail::INVALID_METRICS_SOCKET;
+  std::atomic<bool> stop_{false};
+  // Guards the diagnostics_
+  mutable std::mutex diagnosticsMutex_{};
+  std::function<std::string()> diagnostics_{};
+  std::thread thread_{};
+
+  void serve(detail::MetricsSocket client) const {
+    std::string request{};
+    char buffer[1024];
+
+    // Reads the request line and the headers (the body of the GET is ignored)
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 16 * 1024 &&
+           detail::pollMetricsSocket(client, 1000) > 0) {
+      auto size = recv(client, buffer, static_cast<int>(sizeof(buffer)), 0);
+
+      if (size <= 0) {
+        break;
+      }
+
+      request.append(buffer, static_cast<std::size_t>(size));
+    }
+
+    std::string body{};
+    std::string_view status = "404 Not Found";
+    std::string_view contentType = "text/plain; version=0.0.4; charset=utf-8";
+
+    if (request.rfind("GET /metrics ", 0) == 0 || request.rfind("GET /metrics?", 0) == 0) {
+      body = toPrometheusText(registry_.scrape());
+      status = "200 OK";
+    } else if (request.rfind("GET /diagnostics ", 0) == 0 || request.rfind("GET /diagnostics?", 0) == 0) {
+      std::function<std::string()> diagnostics{};
+
+      {
+        std::lock_guard<std::mutex> lk(diagnosticsMutex_);
+
+        diagnostics = diagnostics_;
+      }
+
+      if (diagnostics) {
+        body = diagnostics();
+        status = "200 OK";
+        contentType = "application/json";
+      }
+    }
+
+    auto response = fmt::format(
+      "HTTP/1.1 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}", status,
+      contentType, body.size(), body);
+    std::size_t sent = 0;
+
+    while (sent < response.size()) {
+      auto result = send(client, response.data() + sent, static_cast<int>(response.size() - sent),
+                         detail::METRICS_SEND_FLAGS);
+
+      if (result <= 0) {
+        break;
+      }
+
+      sent += static_cast<std::size_t>(result);
+    }
+  }
+
+  void run() const {
+    while (!stop_.load(std::memory_order_acquire)) {
+      // The stop is checked every 200 ms
+      if (detail::pollMetricsSocket(socket_, 200) <= 0) {
+        continue;
+      }
+
+      auto client = accept(socket_, nullptr, nullptr);
+
+      if (client == detail::INVALID_METRICS_SOCKET) {
+        continue;
+      }
+
+      serve(client);
+      detail::closeMetricsSocket(client);
+    }
+  }
+
+ public:
+  // Listens the port of the address (e.g. "127.0.0.1", "0.0.0.0"). The registry must outlive the server.
+  MetricsHttpServer(const MetricsRegistry& registry, std::uint16_t port, const std::string& address = "127.0.0.1")
+      : registry_{registry} {
+    auto server = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    sockaddr_in socketAddress{};
+
+    if (server == detail::INVALID_METRICS_SOCKET) {
+      return;
+    }
+
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    socketAddress.sin_family = AF_INET;
+    socketAddress.sin_port = htons(port);
+
+    if (inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) != 1 ||
+        bind(server, reinterpret_cast<sockaddr*>(&socketAddress), sizeof(socketAddress)) != 0 ||
+        listen(server, 16) != 0) {
+      detail::closeMetricsSocket(server);
+
+      return;
+    }
+
+    socket_ = server;
+    thread_ = std::thread([this] { run(); });
+  }
+
+  MetricsHttpServer(const MetricsHttpServer&) = delete;
+  MetricsHttpServer& operator=(const MetricsHttpServer&) = delete;
+
+  ~MetricsHttpServer() {
+    stop_.store(true, std::memory_order_release);
+
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+
+    if (socket_ != detail::INVALID_METRICS_SOCKET) {
+      detail::closeMetricsSocket(socket_);
+    }
+  }
+
+  // Sets the handler of GET /diagnostics (e.g. the JSON of PriceLevelBookManager::collectDiagnostics, see
+  // DiagnosticsDump.hpp). It's called on the thread of the server.
+  void setDiagnostics(std::function<std::string()> diagnostics) {
+    std::lock_guard<std::mutex> lk(diagnosticsMutex_);
+
+    diagnostics_ = std::move(diagnostics);
+  }
+
+  // Returns false if the port can't be listened
+  [[nodiscard]] bool isListening() const { return socket_ != detail::INVALID_METRICS_SOCKET; }
+};
+
+// Pushes the metrics of the registry to the StatsD server by UDP every interval on its thread. The counters are sent
+// as the deltas since the previous push ("|c"), the gauges as is ("|g"), the histograms as the gauges of the quantiles
+// and the max (<name>.p50, <name>.p99_9, <name>.max, ...) and the counter of the count. The labels are sent as the tags
+// ("|#name:value", DogStatsD and Telegraf).
+//
+// Windows: WSAStartup must be called by the application.
+class StatsDExporter final {
+  // The payload of one datagram that fits the Ethernet MTU
+  static constexpr std::size_t MAX_PACKET_SIZE = 1432;
+
+  const MetricsRegistry& registry_;
+  std::string prefix_;
+  std::chrono::milliseconds interval_;
+  detail::MetricsSocket socket_ = detail::INVALID_METRICS_SOCKET;
+  // Guards the push
+  std::mutex mutex_{};
+  // The previous values of the counters by the name and the tags
+  std::unordered_map<std::string, double> previousCounters_{};
+  std::atomic<bool> stop_{false};
+  std::thread thread_{};
+
+  void flush(std::string& packet) const {
+    if (!packet.empty()) {
+      send(socket_, packet.data(), static_cast<int>(packet.size()), 0);
+      packet.clear();
+    }
+  }
+
+  void append(std::string& packet, const std::string& line) const {
+    if (!packet.empty() && packet.size() + 1 + line.size() > MAX_PACKET_SIZE) {
+      flush(packet);
+    }
+
+    if (!packet.empty()) {
+      packet += '\n';
+    }
+
+    packet += line;
+  }
+
+  static std::string getTags(const MetricLabels& labels) {
+    std::string result{};
+
+    for (const auto& [name, value] : labels) {
+      result += result.empty() ? "|#" : ",";
+      result += name;
+      result += ':';
+      result += value;
+    }
+
+    return result;
+  }
+
+  void appendCounter(std::string& packet, const std::string& name, const std::string& tags, double value) {
+    auto& previous = previousCounters_[name + tags];
+    // The reset counter (e.g. the recreated component) is sent as is
+    auto delta = value >= previous ? value - previous : value;
+    std::string line = name + ":";
+
+    previous = value;
+    detail::appendMetricValue(line, delta);
+    append(packet, line + "|c" + tags);
+  }
+
+  void appendGauge(std::string& packet, const std::string& name, const std::string& tags, double value) const {
+    std::string line = name + ":";
+
+    detail::appendMetricValue(line, value);
+    append(packet, line + "|g" + tags);
+  }
+
+ public:
+  // Pushes the metrics of the registry to the host:port (e.g. "127.0.0.1", 8125). The names are prefixed by the prefix
+  // (e.g. "app."). The registry must outlive the exporter.
+  StatsDExporter(const MetricsRegistry& registry, const std::string& host, std::uint16_t port,
+                 std::chrono::milliseconds interval = std::chrono::seconds{10}, std::string prefix = {})
+      : registry_{registry}, prefix_{std::move(prefix)}, interval_{interval} {
+    addrinfo hints{};
+    addrinfo* addresses = nullptr;
+
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+      return;
+    }
+
+    for (auto* a = addresses; a != nullptr && socket_ == detail::INVALID_METRICS_SOCKET; a = a->ai_next) {
+      socket_ = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+
+      if (socket_ != detail::INVALID_METRICS_SOCKET &&
+          connect(socket_, a->ai_addr, static_cast<int>(a->ai_addrlen)) != 0) {
+        detail::closeMetricsSocket(socket_);
+        socket_ = detail::INVALID_METRICS_SOCKET;
+      }
+    }
+
+    freeaddrinfo(addresses);
+
+    if (socket_ == detail::INVALID_METRICS_SOCKET) {
+      return;
+    }
+
+    thread_ = std::thread([this] {
+      auto next = std::chrono::steady_clock::now() + interval_;
+
+      while (!stop_.load(std::memory_order_acquire)) {
+        // The stop is checked every 200 ms
+        if (std::chrono::steady_clock::now() < next) {
+          std::this_thread::sleep_for((std::min)(std::chrono::milliseconds{200}, interval_));
+
+          continue;
+        }
+
+        push();
+        next += interval_;
+      }
+    });
+  }
+
+  StatsDExporter(const StatsDExporter&) = delete;
+  StatsDExporter& operator=(const StatsDExporter&) = delete;
+
+  // Stops the thread (the last interval is not pushed)
+  ~StatsDExporter() {
+    stop_.store(true, std::memory_order_release);
+
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+
+    if (socket_ != detail::INVALID_METRICS_SOCKET) {
+      detail::closeMetricsSocket(socket_);
+    }
+  }
+
+  // Returns false if the address can't be resolved
+  [[nodiscard]] bool isConnected() const { return socket_ != detail::INVALID_METRICS_SOCKET; }
+
+  // Sends the metrics now (e.g. before the exit). Called by the thread of the exporter every interval.
+  void push() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::string packet{};
+
+    for (const auto& sample : registry_.scrape()) {
+      auto name = prefix_ + sample.name;
+      auto tags = getTags(sample.labels);
+
+      switch (sample.kind) {
+        case MetricKind::COUNTER:
+          appendCounter(packet, name, tags, sample.value);
+          break;
+        case MetricKind::GAUGE:
+          appendGauge(packet, name, tags, sample.value);
+          break;
+        case MetricKind::HISTOGRAM:
+          for (auto quantile : METRIC_QUANTILES) {
+            // p50, p90, p99, p99_9
+            auto suffix = fmt::format("{}", quantile * 100.0);
+
+            std::replace(suffix.begin(), suffix.end(), '.', '_');
+            appendGauge(packet, name + ".p" + suffix, tags,
+                        static_cast<double>(sample.histogram.getPercentile(quantile * 100.0)));
+          }
+
+          appendGauge(packet, name + ".max", tags, static_cast<double>(sample.histogram.max));
+          appendCounter(packet, name + ".count", tags, static_cast<double>(sample.histogram.count));
+          break;
+      }
+    }
+
+    flush(packet);
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+#include "MemoryPool.hpp"
+
+namespace dxf {
+
+// The unbounded lock-free multiple-producer single-consumer queue. The producers push the nodes to the lock-free stack,
+// the consumer takes all the pushed nodes by one exchange (the batched dequeue) and restores their order. The consumer
+// never pops the single nodes, so there is no ABA problem. The values of every producer are taken in the push order.
+// The nodes are allocated by the MemoryPool (if it's enabled, the nodes return to the free lists of the producers).
+//
+// Producers:
+//   queue.push(value);
+//
+// Consumer:
+//   queue.popAll([](T& value) { process(value); });
+template <typename T>
+class MpscQueue final {
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  struct Node {
+    T value;
+    Node* next;
+
+    static void* operator new(std::size_t size) { return MemoryPool::allocate(size); }
+
+    static void operator delete(void* pointer) noexcept { MemoryPool::deallocate(pointer); }
+  };
+
+  // The last pushed node
+  alignas(CACHE_LINE_SIZE) std::atomic<Node*> head_{nullptr};
+
+  static void deleteNodes(Node* node) {
+    while (node != nullptr) {
+      delete std::exchange(node, node->next);
+    }
+  }
+
+ public:
+  MpscQueue() = default;
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  ~MpscQueue() { deleteNodes(head_.load(std::memory_order_acquire)); }
+
+  // Producer. Returns true if the queue was empty (e.g. the consumer should be woken up). The push and the isEmpty are
+  // sequentially consistent, so they can be paired with the flag of the waiting consumer.
+  bool push(T value) {
+    auto* node = new Node{std::move(value), head_.load(std::memory_order_relaxed)};
+
+    auto* next = node->next;
+
+    while (!head_.compare_exchange_weak(next, node, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      node->next = next;
+    }
+
+    // The node belongs to the consumer once it's pushed, so its next is not read again
+    return next == nullptr;
+  }
+
+  [[nodiscard]] bool isEmpty() const { return head_.load(std::memory_order_seq_cst) == nullptr; }
+
+  // Consumer. Takes all the pushed values and calls the f(T&) for each of them in the push order. Returns the number of
+  // the values. The values left after the exception of the f are dropped.
+  template <typename F>
+  std::size_t popAll(F&& f) {
+    auto* node = head_.exchange(nullptr, std::memory_order_acquire);
+    Node* first = nullptr;
+
+    while (node != nullptr) {
+      first = std::exchange(node, std::exchange(node->next, first));
+    }
+
+    std::size_t result = 0;
+
+    try {
+      for (; first != nullptr; result++) {
+        f(first->value);
+        delete std::exchange(first, first->next);
+      }
+    } catch (...) {
+      deleteNodes(first);
+
+      throw;
+    }
+
+    return result;
+  }
+};
+
+}  // namespace dxf
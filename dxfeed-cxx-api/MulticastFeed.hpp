@@ -0,0 +1,1537 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "EventReceiver.hpp"
+#include "OrderDataMap.hpp"
+#include "PriceLevel.hpp"
+#include "PriceLevelBook.hpp"
+#include "SymbolIndex.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The packets of the multicast redistribution of the normalized events: one process keeps the upstream connection
+// and publishes the orders, the quotes and the trades of its symbols to the multicast groups of the data center, the
+// receivers of the hosts join the groups of their symbols and rebuild the books, so the upstream load and the parsing
+// of the feed don't grow with the number of the hosts. The symbols are spread over the groups by the hash of the name.
+//
+// Layout (native byte order, the hosts of the data center are of the same platform):
+//   packet:  magic "DXMC" (uint32), version (uint16), type (uint16), group (uint32), records number (uint32),
+//            sequence (uint64), send time (int64, ns since the epoch), session (uint64), the records
+//   record:  type (uint16), flags (uint16), length (uint32, a multiple of 8), symbol (32 bytes) and source (16 bytes)
+//            with the terminating zeros, the payload (OrderPayload, QuotePayload or TradePayload)
+//
+// The data packets of a group are numbered by its sequence (from 1), the heartbeat packets carry the sequence of the
+// last data packet of the group, so the lost tail is detected too. The receivers request the lost packets by the
+// unicast requests to the publisher (the records number of the retransmit request is the number of the packets); the
+// packets that are not kept anymore are answered by the unavailable packet and the receiver requests the snapshot of
+// the group. The snapshots are published to the group as the usual data packets. The session is the start time of the
+// publisher, so its restart (the sequences from 1 again) resets the groups of the receivers.
+struct MulticastFeed {
+  static constexpr std::uint32_t MAGIC = 0x434D5844U;  // "DXMC"
+  static constexpr std::uint16_t VERSION = 1;
+  // The datagram fits the Ethernet MTU with the IP and the UDP headers, so it's never fragmented
+  static constexpr std::size_t MAX_PACKET_SIZE = 1400;
+  static constexpr std::size_t SYMBOL_SIZE = 32;
+  static constexpr std::size_t SOURCE_SIZE = 16;
+
+  enum class PacketType : std::uint16_t {
+    DATA = 0,
+    HEARTBEAT = 1,
+    RETRANSMIT_REQUEST = 2,
+    SNAPSHOT_REQUEST = 3,
+    UNAVAILABLE = 4
+  };
+
+  enum class RecordType : std::uint16_t { ORDER = 1, QUOTE = 2, TRADE = 3 };
+
+  // The order record starts the new snapshot of the book
+  static constexpr std::uint16_t NEW_SNAPSHOT = 1;
+  // The new snapshot is empty (the record has no order)
+  static constexpr std::uint16_t EMPTY_SNAPSHOT = 2;
+
+  struct PacketHeader {
+    std::uint32_t magic = MAGIC;
+    std::uint16_t version = VERSION;
+    PacketType type = PacketType::DATA;
+    std::uint32_t group = 0;
+    std::uint32_t recordsNumber = 0;
+    std::uint64_t sequence = 0;
+    std::int64_t sendTime = 0;
+    std::uint64_t session = 0;
+  };
+
+  struct RecordHeader {
+    RecordType type = RecordType::ORDER;
+    std::uint16_t flags = 0;
+    std::uint32_t length = 0;
+    char symbol[SYMBOL_SIZE]{};
+    char source[SOURCE_SIZE]{};
+  };
+
+  // The fields of the OrderRecord
+  struct OrderPayload {
+    std::int64_t index = 0;
+    std::int64_t time = 0;
+    double price = 0.0;
+    double size = 0.0;
+    std::uint32_t eventFlags = 0;
+    std::int32_t side = 0;
+  };
+
+  struct QuotePayload {
+    std::int64_t time = 0;
+    std::int64_t bidTime = 0;
+    std::int64_t askTime = 0;
+    double bidPrice = 0.0;
+    double bidSize = 0.0;
+    double askPrice = 0.0;
+    double askSize = 0.0;
+    std::int32_t sequence = 0;
+    std::int32_t timeNanos = 0;
+    std::uint16_t bidExchangeCode = 0;
+    std::uint16_t askExchangeCode = 0;
+    std::int32_t scope = 0;
+  };
+
+  struct TradePayload {
+    std::int64_t time = 0;
+    double price = 0.0;
+    double size = 0.0;
+    double change = 0.0;
+    double dayVolume = 0.0;
+    double dayTurnover = 0.0;
+    std::int32_t sequence = 0;
+    std::int32_t timeNanos = 0;
+    std::int32_t tick = 0;
+    std::int32_t dayId = 0;
+    std::int32_t rawFlags = 0;
+    std::uint16_t exchangeCode = 0;
+    std::uint8_t direction = 0;
+    std::uint8_t isEth = 0;
+    std::int32_t scope = 0;
+    std::uint32_t reserved = 0;
+  };
+
+  static_assert(sizeof(PacketHeader) == 40 && sizeof(RecordHeader) == 56 && sizeof(OrderPayload) == 40 &&
+                  sizeof(QuotePayload) == 72 && sizeof(TradePayload) == 80,
+                "The packet layout is fixed");
+  static_assert(std::is_trivially_copyable_v<PacketHeader> && std::is_trivially_copyable_v<RecordHeader>,
+                "The headers are copied as is");
+
+  // The group of the symbol (all the sources and the events of the symbol are published to the same group)
+  static std::uint32_t getGroup(std::string_view symbol, std::uint32_t groupsNumber) {
+    return static_cast<std::uint32_t>(Symbol::hashOf(symbol) % (std::max)(groupsNumber, std::uint32_t{1}));
+  }
+
+  static std::int64_t getSendTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+      .count();
+  }
+
+  // Copies the name to the fixed field. Returns false if it doesn't fit (the terminating zero is kept).
+  template <std::size_t Size>
+  static bool copyName(char (&field)[Size], std::string_view name) {
+    if (name.size() >= Size) {
+      return false;
+    }
+
+    std::memcpy(field, name.data(), name.size());
+
+    return true;
+  }
+
+  template <std::size_t Size>
+  static std::string_view getName(const char (&field)[Size]) {
+    return {field, static_cast<std::size_t>(std::find(field, field + Size, '\0') - field)};
+  }
+};
+
+using MulticastPacketType = MulticastFeed::PacketType;
+using MulticastRecordType = MulticastFeed::RecordType;
+
+// The addresses and the recovery parameters of the feed (the same for the publisher and its receivers)
+struct MulticastFeedConfig {
+  // The address of the group 0, the group i is the address + i (e.g. 239.255.0.0 - 239.255.0.15)
+  std::string groupAddress = "239.255.0.0";
+  std::uint16_t port = 31000;
+  std::uint32_t groupsNumber = 16;
+  // The address of the local interface of the multicast (empty - the default one)
+  std::string interfaceAddress{};
+  // The publisher: the hops of the multicast packets (1 - the local network only)
+  int ttl = 1;
+  // The publisher: the data packets of every group that are kept for the retransmits
+  std::size_t retransmitPackets = 4096;
+  // The publisher: the heartbeat of the idle group is sent this often
+  std::chrono::milliseconds heartbeatInterval{1000};
+  // The publisher: the snapshot of the group is sent at most this often (the requests of the receivers are merged)
+  std::chrono::milliseconds snapshotInterval{1000};
+  // The host of the publisher that serves the retransmit and the snapshot requests (the receiver: empty - the gaps are
+  // not recovered and the books wait for the new snapshots of the upstream)
+  std::string publisherAddress{};
+  // The unicast port of the requests (the publisher: 0 - the requests are not served)
+  std::uint16_t requestPort = 31001;
+  // The receiver: the lost packets are requested again after this timeout
+  std::chrono::milliseconds retransmitTimeout{50};
+  // The receiver: the gap is unrecoverable after this number of the retransmit requests
+  int maxRetransmitAttempts = 3;
+  // The receiver: the socket buffer of the packets (the bursts of the snapshots are not lost, 0 - the system default)
+  int receiveBufferSize = 8 * 1024 * 1024;
+  // The receiver: the packets after the gap that are kept until it's filled (more - the gap is unrecoverable)
+  std::size_t maxPendingPackets = 1024;
+};
+
+namespace detail {
+
+#ifdef _WIN32
+using MulticastSocket = SOCKET;
+
+inline const MulticastSocket INVALID_MULTICAST_SOCKET = INVALID_SOCKET;
+
+inline void closeMulticastSocket(MulticastSocket s) { closesocket(s); }
+
+// The readable sockets of the two (the invalid socket is never readable)
+inline int pollMulticastSockets(MulticastSocket s1, MulticastSocket s2, int timeoutMillis, bool& readable1,
+                                bool& readable2) {
+  WSAPOLLFD descriptors[2]{{s1, POLLIN, 0}, {s2, POLLIN, 0}};
+  auto result = WSAPoll(descriptors, s2 == INVALID_MULTICAST_SOCKET ? 1 : 2, timeoutMillis);
+
+  readable1 = result > 0 && (descriptors[0].revents & POLLIN) != 0;
+  readable2 = result > 0 && (descriptors[1].revents & POLLIN) != 0;
+
+  return result;
+}
+#else
+using MulticastSocket = int;
+
+inline const MulticastSocket INVALID_MULTICAST_SOCKET = -1;
+
+inline void closeMulticastSocket(MulticastSocket s) { close(s); }
+
+inline int pollMulticastSockets(MulticastSocket s1, MulticastSocket s2, int timeoutMillis, bool& readable1,
+                                bool& readable2) {
+  pollfd descriptors[2]{{s1, POLLIN, 0}, {s2, POLLIN, 0}};
+  auto result = poll(descriptors, s2 == INVALID_MULTICAST_SOCKET ? 1 : 2, timeoutMillis);
+
+  readable1 = result > 0 && (descriptors[0].revents & POLLIN) != 0;
+  readable2 = result > 0 && (descriptors[1].revents & POLLIN) != 0;
+
+  return result;
+}
+#endif
+
+// The address of the group: the base address + group
+inline bool getMulticastGroupAddress(const MulticastFeedConfig& config, std::uint32_t group, sockaddr_in& address) {
+  in_addr base{};
+
+  if (inet_pton(AF_INET, config.groupAddress.c_str(), &base) != 1) {
+    return false;
+  }
+
+  address = sockaddr_in{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(config.port);
+  address.sin_addr.s_addr = htonl(ntohl(base.s_addr) + group);
+
+  return true;
+}
+
+inline bool resolveMulticastAddress(const std::string& host, std::uint16_t port, sockaddr_in& address) {
+  addrinfo hints{};
+  addrinfo* addresses = nullptr;
+
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0 || addresses == nullptr) {
+    return false;
+  }
+
+  std::memcpy(&address, addresses->ai_addr, sizeof(address));
+  freeaddrinfo(addresses);
+
+  return true;
+}
+
+inline bool readMulticastHeader(const char* data, std::size_t size, MulticastFeed::PacketHeader& header) {
+  if (size < sizeof(header)) {
+    return false;
+  }
+
+  std::memcpy(&header, data, sizeof(header));
+
+  return header.magic == MulticastFeed::MAGIC && header.version == MulticastFeed::VERSION;
+}
+
+}  // namespace detail
+
+struct MulticastPublisherStats {
+  std::uint64_t packetsNumber = 0;
+  std::uint64_t recordsNumber = 0;
+  // The events of the symbols or the sources that don't fit the fixed fields
+  std::uint64_t skippedNumber = 0;
+  std::uint64_t retransmittedNumber = 0;
+  std::uint64_t unavailableNumber = 0;
+  std::uint64_t snapshotsNumber = 0;
+};
+
+// Publishes the normalized events to the multicast groups (see MulticastFeed) and serves the retransmit and the
+// snapshot requests of the receivers on its thread. The live orders of every book are kept, so the snapshot of the
+// group is published without the upstream. The publish* are called by the listeners of the upstream connection: the
+// records are collected into the packet of the group, the packet is sent when it's full or by the flush (e.g. at the
+// end of the listener call, the thread of the publisher flushes the idle groups with the heartbeats). The order chunk
+// that is split between the packets has the dxf_ef_tx_pending flag on the last record of every part but the last, so
+// the books of the receivers accumulate the parts.
+//
+// Usage:
+//   MulticastPublisher publisher{config};
+//
+//   dxf_attach_snapshot_inc_listener(snapshot, [](const dxf_snapshot_data_ptr_t data, int newSnapshot, void* p) {
+//     publisher.publishOrders("AAPL", "NTV", static_cast<const dxf_order_t*>(data->records), data->records_count,
+//                             newSnapshot != 0);
+//     publisher.flush();
+//   }, nullptr);
+//
+// Windows: WSAStartup must be called by the application.
+class MulticastPublisher final {
+  struct Group {
+    std::uint64_t nextSequence = 1;
+    // The packet that is being filled (the header is written by the send)
+    std::vector<char> packet{};
+    std::uint32_t recordsNumber = 0;
+    // The sent packets and their sequences by the sequence % retransmitPackets
+    std::vector<std::vector<char>> sentPackets{};
+    std::vector<std::uint64_t> sentSequences{};
+    std::chrono::steady_clock::time_point lastSendTime{};
+    std::chrono::steady_clock::time_point lastSnapshotTime{};
+    bool isSnapshotRequested = false;
+  };
+
+  // The live order of the book: the payload of its last record keyed by the index
+  struct LiveOrder {
+    dxf_long_t index = 0;
+    MulticastFeed::OrderPayload payload{};
+  };
+
+  // The live orders of the book by the index. They are kept in the flat table (see BasicOrderDataMap), so the chunk
+  // of the listener changes only its own orders without the node allocations, and the new snapshot reuses the table.
+  struct Book {
+    std::string symbol{};
+    std::string source{};
+    std::uint32_t group = 0;
+    BasicOrderDataMap<LiveOrder> orders{};
+  };
+
+  MulticastFeedConfig config_;
+  std::uint64_t session_;
+  detail::MulticastSocket socket_ = detail::INVALID_MULTICAST_SOCKET;
+  detail::MulticastSocket requestSocket_ = detail::INVALID_MULTICAST_SOCKET;
+  std::vector<sockaddr_in> groupAddresses_{};
+  // Guards the groups and the books
+  std::mutex mutex_{};
+  std::vector<Group> groups_{};
+  // By the symbol and the source separated by the zero
+  std::unordered_map<std::string, Book> books_{};
+  std::vector<MulticastFeed::OrderPayload> payloads_{};
+  std::atomic<std::uint64_t> packetsNumber_{0};
+  std::atomic<std::uint64_t> recordsNumber_{0};
+  std::atomic<std::uint64_t> skippedNumber_{0};
+  std::atomic<std::uint64_t> retransmittedNumber_{0};
+  std::atomic<std::uint64_t> unavailableNumber_{0};
+  std::atomic<std::uint64_t> snapshotsNumber_{0};
+  std::atomic<bool> stop_{false};
+  std::thread thread_{};
+
+  static MulticastFeed::OrderPayload toPayload(const OrderRecord& order) {
+    return {order.index,
+            order.time,
+            order.price,
+            order.size,
+            static_cast<std::uint32_t>(order.event_flags),
+            static_cast<std::int32_t>(order.side)};
+  }
+
+  // Called under the mutex
+  void send(std::uint32_t groupIndex) {
+    auto& group = groups_[groupIndex];
+
+    if (group.recordsNumber == 0) {
+      return;
+    }
+
+    MulticastFeed::PacketHeader header{};
+
+    header.group = groupIndex;
+    header.recordsNumber = group.recordsNumber;
+    header.sequence = group.nextSequence++;
+    header.sendTime = MulticastFeed::getSendTime();
+    header.session = session_;
+    std::memcpy(group.packet.data(), &header, sizeof(header));
+
+    const auto& address = groupAddresses_[groupIndex];
+
+    sendto(socket_, group.packet.data(), static_cast<int>(group.packet.size()), 0,
+           reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+
+    auto slot = header.sequence % group.sentPackets.size();
+
+    // The packet buffers are swapped, so the ring doesn't allocate after its warmup
+    std::swap(group.sentPackets[slot], group.packet);
+    group.sentSequences[slot] = header.sequence;
+    group.packet.clear();
+    group.recordsNumber = 0;
+    group.lastSendTime = std::chrono::steady_clock::now();
+    packetsNumber_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Appends the record to the packet of the group (the full packet is sent first). Returns the offset of the record.
+  // Called under the mutex.
+  std::size_t append(std::uint32_t groupIndex, const MulticastFeed::RecordHeader& header, const void* payload,
+                     std::size_t payloadSize) {
+    auto& group = groups_[groupIndex];
+
+    if (group.packet.size() + header.length > MulticastFeed::MAX_PACKET_SIZE) {
+      send(groupIndex);
+    }
+
+    if (group.packet.empty()) {
+      group.packet.resize(sizeof(MulticastFeed::PacketHeader));
+    }
+
+    auto offset = group.packet.size();
+
+    group.packet.resize(offset + header.length);
+    std::memcpy(group.packet.data() + offset, &header, sizeof(header));
+    std::memcpy(group.packet.data() + offset + sizeof(header), payload, payloadSize);
+    group.recordsNumber++;
+    recordsNumber_.fetch_add(1, std::memory_order_relaxed);
+
+    return offset;
+  }
+
+  // Appends the order chunk of the book (the payloads_). Called under the mutex.
+  void appendOrders(const Book& book, bool newSnapshot) {
+    constexpr std::uint32_t length = sizeof(MulticastFeed::RecordHeader) + sizeof(MulticastFeed::OrderPayload);
+    MulticastFeed::RecordHeader header{MulticastRecordType::ORDER, 0, length};
+
+    MulticastFeed::copyName(header.symbol, book.symbol);
+    MulticastFeed::copyName(header.source, book.source);
+
+    if (payloads_.empty()) {
+      if (newSnapshot) {
+        MulticastFeed::OrderPayload empty{};
+
+        header.flags = MulticastFeed::NEW_SNAPSHOT | MulticastFeed::EMPTY_SNAPSHOT;
+        append(book.group, header, &empty, sizeof(empty));
+      }
+
+      return;
+    }
+
+    auto& group = groups_[book.group];
+    // The offset of the previous record of the chunk in the packet
+    std::size_t previousOffset = 0;
+
+    for (std::size_t i = 0; i < payloads_.size(); i++) {
+      header.flags = i == 0 && newSnapshot ? MulticastFeed::NEW_SNAPSHOT : 0;
+
+      if (i != 0 && group.packet.size() + length > MulticastFeed::MAX_PACKET_SIZE) {
+        // The last record of the part: the receivers accumulate the parts of the chunk
+        auto* previous = group.packet.data() + previousOffset + sizeof(MulticastFeed::RecordHeader);
+        MulticastFeed::OrderPayload payload{};
+
+        std::memcpy(&payload, previous, sizeof(payload));
+        payload.eventFlags |= static_cast<std::uint32_t>(dxf_ef_tx_pending);
+        std::memcpy(previous, &payload, sizeof(payload));
+      }
+
+      previousOffset = append(book.group, header, &payloads_[i], sizeof(payloads_[i]));
+    }
+  }
+
+  Book* findBook(std::string_view symbol, std::string_view source) {
+    auto key = std::string(symbol);
+
+    key += '\0';
+    key += source;
+
+    auto found = books_.find(key);
+
+    if (found != books_.end()) {
+      return &found->second;
+    }
+
+    if (symbol.size() >= MulticastFeed::SYMBOL_SIZE || source.size() >= MulticastFeed::SOURCE_SIZE) {
+      return nullptr;
+    }
+
+    auto& book = books_[key];
+
+    book.symbol = std::string(symbol);
+    book.source = std::string(source);
+    book.group = MulticastFeed::getGroup(symbol, config_.groupsNumber);
+
+    return &book;
+  }
+
+  // Publishes the live orders of the books of the group as the new snapshots. Called under the mutex.
+  void publishSnapshot(std::uint32_t groupIndex) {
+    for (const auto& [key, book] : books_) {
+      if (book.group != groupIndex) {
+        continue;
+      }
+
+      payloads_.clear();
+      payloads_.reserve(book.orders.size());
+      book.orders.forEach([this](const LiveOrder& order) { payloads_.push_back(order.payload); });
+
+      appendOrders(book, true);
+    }
+
+    send(groupIndex);
+    snapshotsNumber_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Called under the mutex
+  void retransmit(const MulticastFeed::PacketHeader& request, const sockaddr_in& requester) {
+    auto& group = groups_[request.group];
+    auto count = (std::min)(static_cast<std::size_t>(request.recordsNumber), group.sentPackets.size());
+
+    for (std::size_t i = 0; i < count; i++) {
+      auto sequence = request.sequence + i;
+      auto slot = sequence % group.sentPackets.size();
+
+      if (group.sentSequences[slot] != sequence) {
+        MulticastFeed::PacketHeader unavailable{};
+
+        unavailable.type = MulticastPacketType::UNAVAILABLE;
+        unavailable.group = request.group;
+        unavailable.sequence = sequence;
+        unavailable.session = session_;
+        sendto(requestSocket_, reinterpret_cast<const char*>(&unavailable), sizeof(unavailable), 0,
+               reinterpret_cast<const sockaddr*>(&requester), sizeof(requester));
+        unavailableNumber_.fetch_add(1, std::memory_order_relaxed);
+
+        return;
+      }
+
+      const auto& packet = group.sentPackets[slot];
+
+      sendto(requestSocket_, packet.data(), static_cast<int>(packet.size()), 0,
+             reinterpret_cast<const sockaddr*>(&requester), sizeof(requester));
+      retransmittedNumber_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void serveRequest() {
+    char data[MulticastFeed::MAX_PACKET_SIZE];
+    sockaddr_in requester{};
+    socklen_t requesterSize = sizeof(requester);
+    auto size = recvfrom(requestSocket_, data, static_cast<int>(sizeof(data)), 0,
+                         reinterpret_cast<sockaddr*>(&requester), &requesterSize);
+    MulticastFeed::PacketHeader request{};
+
+    if (size <= 0 || !detail::readMulticastHeader(data, static_cast<std::size_t>(size), request) ||
+        request.group >= groups_.size()) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (request.type == MulticastPacketType::RETRANSMIT_REQUEST) {
+      retransmit(request, requester);
+    } else if (request.type == MulticastPacketType::SNAPSHOT_REQUEST) {
+      groups_[request.group].isSnapshotRequested = true;
+    }
+  }
+
+  // Sends the requested snapshots, flushes the idle groups and sends their heartbeats
+  void maintain() {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    for (std::uint32_t i = 0; i < groups_.size(); i++) {
+      auto& group = groups_[i];
+
+      if (group.isSnapshotRequested && now - group.lastSnapshotTime >= config_.snapshotInterval) {
+        group.isSnapshotRequested = false;
+        group.lastSnapshotTime = now;
+        publishSnapshot(i);
+      }
+
+      if (now - group.lastSendTime < config_.heartbeatInterval) {
+        continue;
+      }
+
+      if (group.recordsNumber != 0) {
+        send(i);
+
+        continue;
+      }
+
+      MulticastFeed::PacketHeader heartbeat{};
+
+      heartbeat.type = MulticastPacketType::HEARTBEAT;
+      heartbeat.group = i;
+      heartbeat.sequence = group.nextSequence - 1;
+      heartbeat.sendTime = MulticastFeed::getSendTime();
+      heartbeat.session = session_;
+      sendto(socket_, reinterpret_cast<const char*>(&heartbeat), sizeof(heartbeat), 0,
+             reinterpret_cast<const sockaddr*>(&groupAddresses_[i]), sizeof(groupAddresses_[i]));
+      group.lastSendTime = now;
+    }
+  }
+
+  void run() {
+    while (!stop_.load(std::memory_order_acquire)) {
+      if (requestSocket_ == detail::INVALID_MULTICAST_SOCKET) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+      } else {
+        bool isRequest = false;
+        bool unused = false;
+
+        if (detail::pollMulticastSockets(requestSocket_, detail::INVALID_MULTICAST_SOCKET, 10, isRequest, unused) >
+              0 &&
+            isRequest) {
+          serveRequest();
+        }
+      }
+
+      maintain();
+    }
+  }
+
+  void close() {
+    if (socket_ != detail::INVALID_MULTICAST_SOCKET) {
+      detail::closeMulticastSocket(socket_);
+      socket_ = detail::INVALID_MULTICAST_SOCKET;
+    }
+
+    if (requestSocket_ != detail::INVALID_MULTICAST_SOCKET) {
+      detail::closeMulticastSocket(requestSocket_);
+      requestSocket_ = detail::INVALID_MULTICAST_SOCKET;
+    }
+  }
+
+  bool open() {
+    for (std::uint32_t i = 0; i < config_.groupsNumber; i++) {
+      if (!detail::getMulticastGroupAddress(config_, i, groupAddresses_.emplace_back())) {
+        return false;
+      }
+    }
+
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (socket_ == detail::INVALID_MULTICAST_SOCKET) {
+      return false;
+    }
+
+    auto ttl = config_.ttl;
+
+    setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_TTL, reinterpret_cast<const char*>(&ttl), sizeof(ttl));
+
+    if (!config_.interfaceAddress.empty()) {
+      in_addr interfaceAddress{};
+
+      if (inet_pton(AF_INET, config_.interfaceAddress.c_str(), &interfaceAddress) != 1 ||
+          setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, reinterpret_cast<const char*>(&interfaceAddress),
+                     sizeof(interfaceAddress)) != 0) {
+        return false;
+      }
+    }
+
+    if (config_.requestPort == 0) {
+      return true;
+    }
+
+    requestSocket_ = socket(AF_INET, SOCK_DGRAM, 0);
+
+    sockaddr_in requestAddress{};
+
+    requestAddress.sin_family = AF_INET;
+    requestAddress.sin_port = htons(config_.requestPort);
+    requestAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    return requestSocket_ != detail::INVALID_MULTICAST_SOCKET &&
+           bind(requestSocket_, reinterpret_cast<const sockaddr*>(&requestAddress), sizeof(requestAddress)) == 0;
+  }
+
+ public:
+  explicit MulticastPublisher(MulticastFeedConfig config)
+      : config_{std::move(config)}, session_{static_cast<std::uint64_t>(MulticastFeed::getSendTime())} {
+    config_.groupsNumber = (std::max)(config_.groupsNumber, std::uint32_t{1});
+    groups_.resize(config_.groupsNumber);
+
+    for (auto& group : groups_) {
+      group.packet.reserve(MulticastFeed::MAX_PACKET_SIZE);
+      group.sentPackets.resize((std::max)(config_.retransmitPackets, std::size_t{1}));
+      group.sentSequences.resize(group.sentPackets.size());
+    }
+
+    if (!open()) {
+      close();
+
+      return;
+    }
+
+    thread_ = std::thread([this] { run(); });
+  }
+
+  MulticastPublisher(const MulticastPublisher&) = delete;
+  MulticastPublisher& operator=(const MulticastPublisher&) = delete;
+
+  // Sends the pending packets and stops the thread
+  ~MulticastPublisher() {
+    stop_.store(true, std::memory_order_release);
+
+    if (thread_.joinable()) {
+      thread_.join();
+      flush();
+    }
+
+    close();
+  }
+
+  // Returns false if the sockets can't be opened (e.g. the invalid address or the request port is used)
+  [[nodiscard]] bool isOpen() const { return thread_.joinable(); }
+
+  // Publishes the order chunk of the snapshot listener of the book (Record - dxf_order_t or OrderRecord). Returns
+  // false if the symbol or the source doesn't fit the fixed fields (the chunk is skipped).
+  template <typename Record>
+  bool publishOrders(std::string_view symbol, std::string_view source, const Record* orders, std::size_t count,
+                     bool newSnapshot) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto* book = findBook(symbol, source);
+
+    if (book == nullptr) {
+      skippedNumber_.fetch_add(count, std::memory_order_relaxed);
+
+      return false;
+    }
+
+    if (newSnapshot) {
+      // The table keeps its capacity and grows at most once for the new snapshot
+      book->orders.clear();
+      book->orders.reserve(count);
+    }
+
+    payloads_.clear();
+
+    for (std::size_t i = 0; i < count; i++) {
+      const auto& payload = payloads_.emplace_back(toPayload(orders[i]));
+
+      if ((payload.eventFlags & dxf_ef_remove_event) != 0 || !(payload.size > 0.0)) {
+        book->orders.erase(payload.index);
+      } else {
+        LiveOrder live{payload.index, payload};
+
+        // The snapshot of the group is the complete transaction
+        live.payload.eventFlags = 0;
+        book->orders.insert(live);
+      }
+    }
+
+    appendOrders(*book, newSnapshot);
+
+    return true;
+  }
+
+  bool publishQuote(std::string_view symbol, const dxf_quote_t& quote) {
+    constexpr std::uint32_t length = sizeof(MulticastFeed::RecordHeader) + sizeof(MulticastFeed::QuotePayload);
+    MulticastFeed::RecordHeader header{MulticastRecordType::QUOTE, 0, length};
+
+    if (!MulticastFeed::copyName(header.symbol, symbol)) {
+      skippedNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      return false;
+    }
+
+    MulticastFeed::QuotePayload payload{quote.time,
+                                        quote.bid_time,
+                                        quote.ask_time,
+                                        quote.bid_price,
+                                        quote.bid_size,
+                                        quote.ask_price,
+                                        quote.ask_size,
+                                        quote.sequence,
+                                        quote.time_nanos,
+                                        static_cast<std::uint16_t>(quote.bid_exchange_code),
+                                        static_cast<std::uint16_t>(quote.ask_exchange_code),
+                                        static_cast<std::int32_t>(quote.scope)};
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    append(MulticastFeed::getGroup(symbol, config_.groupsNumber), header, &payload, sizeof(payload));
+
+    return true;
+  }
+
+  bool publishTrade(std::string_view symbol, const dxf_trade_t& trade) {
+    constexpr std::uint32_t length = sizeof(MulticastFeed::RecordHeader) + sizeof(MulticastFeed::TradePayload);
+    MulticastFeed::RecordHeader header{MulticastRecordType::TRADE, 0, length};
+
+    if (!MulticastFeed::copyName(header.symbol, symbol)) {
+      skippedNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      return false;
+    }
+
+    MulticastFeed::TradePayload payload{};
+
+    payload.time = trade.time;
+    payload.price = trade.price;
+    payload.size = trade.size;
+    payload.change = trade.change;
+    payload.dayVolume = trade.day_volume;
+    payload.dayTurnover = trade.day_turnover;
+    payload.sequence = trade.sequence;
+    payload.timeNanos = trade.time_nanos;
+    payload.tick = trade.tick;
+    payload.dayId = trade.day_id;
+    payload.rawFlags = trade.raw_flags;
+    payload.exchangeCode = static_cast<std::uint16_t>(trade.exchange_code);
+    payload.direction = static_cast<std::uint8_t>(trade.direction);
+    payload.isEth = trade.is_eth != 0 ? 1 : 0;
+    payload.scope = static_cast<std::int32_t>(trade.scope);
+
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    append(MulticastFeed::getGroup(symbol, config_.groupsNumber), header, &payload, sizeof(payload));
+
+    return true;
+  }
+
+  // Sends the pending packets of all the groups
+  void flush() {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    for (std::uint32_t i = 0; i < groups_.size(); i++) {
+      send(i);
+    }
+  }
+
+  [[nodiscard]] MulticastPublisherStats getStats() const {
+    return {packetsNumber_.load(std::memory_order_relaxed),      recordsNumber_.load(std::memory_order_relaxed),
+            skippedNumber_.load(std::memory_order_relaxed),      retransmittedNumber_.load(std::memory_order_relaxed),
+            unavailableNumber_.load(std::memory_order_relaxed), snapshotsNumber_.load(std::memory_order_relaxed)};
+  }
+};
+
+struct MulticastReceiverStats {
+  std::uint64_t packetsNumber = 0;
+  std::uint64_t recordsNumber = 0;
+  std::uint64_t duplicatesNumber = 0;
+  std::uint64_t gapsNumber = 0;
+  std::uint64_t retransmitRequestsNumber = 0;
+  std::uint64_t retransmittedNumber = 0;
+  // The packets of the unrecoverable gaps
+  std::uint64_t lostNumber = 0;
+  std::uint64_t snapshotRequestsNumber = 0;
+  // The order records of the books that wait for their new snapshots
+  std::uint64_t droppedNumber = 0;
+};
+
+// Receives the multicast feed (see MulticastFeed) of the symbols: joins their groups, orders the packets by the
+// sequences, requests the lost packets from the publisher and passes the events to the books (the detached
+// PriceLevelBook instances, so the application uses the same interface as with the upstream connection) and to the
+// sinks of the quotes and the trades (as the EventReceiver sinks, the symbol index is the position of the symbol in the
+// symbols of the receiver). After the unrecoverable gap the books of the group keep their levels and wait for the new
+// snapshots, which are requested from the publisher. The books and the sinks are called on the thread of the
+// receiver.
+//
+// Usage:
+//   MulticastReceiver receiver{config, {"AAPL", "IBM"}};
+//   auto book = receiver.createBook("AAPL", "NTV", 10);
+//
+//   book->setOnNewBook(...);
+//   receiver.start();
+//
+// Windows: WSAStartup must be called by the application.
+class MulticastReceiver final {
+  struct BookEntry {
+    std::string source{};
+    PriceLevelBook* book = nullptr;
+    bool isWaitingSnapshot = true;
+  };
+
+  struct Group {
+    bool isJoined = false;
+    // The session of the publisher (0 - the first packet is not received yet)
+    std::uint64_t session = 0;
+    // 0 - the first packet is not received yet
+    std::uint64_t expectedSequence = 0;
+    // The highest sequence of the data and the heartbeat packets
+    std::uint64_t lastSequence = 0;
+    // The packets after the gap by the sequence
+    std::map<std::uint64_t, std::vector<char>> pendingPackets{};
+    int retransmitAttempts = 0;
+    std::chrono::steady_clock::time_point retransmitTime{};
+    std::chrono::steady_clock::time_point snapshotRequestTime{};
+  };
+
+  MulticastFeedConfig config_;
+  std::vector<Symbol> symbols_{};
+  SymbolIndex symbolIndex_{};
+  // By the symbol index
+  std::vector<std::vector<BookEntry>> books_{};
+  std::vector<std::unique_ptr<PriceLevelBook>> ownedBooks_{};
+  EventReceiver::BatchSinkType<dxf_quote_t> quoteSink_{};
+  EventReceiver::BatchSinkType<dxf_trade_t> tradeSink_{};
+  detail::MulticastSocket socket_ = detail::INVALID_MULTICAST_SOCKET;
+  detail::MulticastSocket requestSocket_ = detail::INVALID_MULTICAST_SOCKET;
+  sockaddr_in publisherAddress_{};
+  bool hasPublisher_ = false;
+  // Guards the books, the sinks and the groups
+  std::mutex mutex_{};
+  std::vector<Group> groups_{};
+  // The order chunk that is being collected
+  std::vector<dxf_order_t> orders_{};
+  BookEntry* ordersBook_ = nullptr;
+  bool isNewSnapshot_ = false;
+  std::atomic<std::uint64_t> packetsNumber_{0};
+  std::atomic<std::uint64_t> recordsNumber_{0};
+  std::atomic<std::uint64_t> duplicatesNumber_{0};
+  std::atomic<std::uint64_t> gapsNumber_{0};
+  std::atomic<std::uint64_t> retransmitRequestsNumber_{0};
+  std::atomic<std::uint64_t> retransmittedNumber_{0};
+  std::atomic<std::uint64_t> lostNumber_{0};
+  std::atomic<std::uint64_t> snapshotRequestsNumber_{0};
+  std::atomic<std::uint64_t> droppedNumber_{0};
+  std::atomic<bool> stop_{false};
+  std::thread thread_{};
+
+  std::size_t addSymbol(const std::string& symbol) {
+    auto index = symbolIndex_.find(symbol);
+
+    if (index != SymbolIndex::NOT_FOUND) {
+      return index;
+    }
+
+    index = symbols_.size();
+    symbols_.push_back(Symbol::valueOf(symbol));
+    symbolIndex_.add(symbols_.back(), index);
+    books_.emplace_back();
+
+    return index;
+  }
+
+  void sendRequest(MulticastPacketType type, std::uint32_t group, std::uint64_t sequence, std::uint32_t count) {
+    if (!hasPublisher_) {
+      return;
+    }
+
+    MulticastFeed::PacketHeader request{};
+
+    request.type = type;
+    request.group = group;
+    request.sequence = sequence;
+    request.recordsNumber = count;
+    request.sendTime = MulticastFeed::getSendTime();
+    sendto(requestSocket_, reinterpret_cast<const char*>(&request), sizeof(request), 0,
+           reinterpret_cast<const sockaddr*>(&publisherAddress_), sizeof(publisherAddress_));
+  }
+
+  // Called under the mutex
+  void flushOrders() {
+    if (ordersBook_ == nullptr) {
+      return;
+    }
+
+    dxf_snapshot_data_t snapshotData{};
+
+    snapshotData.event_type = dx_eid_order;
+    snapshotData.records_count = orders_.size();
+    snapshotData.records = orders_.data();
+    ordersBook_->book->processSnapshotData(&snapshotData, isNewSnapshot_ ? 1 : 0);
+    orders_.clear();
+    ordersBook_ = nullptr;
+    isNewSnapshot_ = false;
+  }
+
+  // Called under the mutex
+  void processOrder(std::vector<BookEntry>& books, const MulticastFeed::RecordHeader& header, const char* data) {
+    auto source = MulticastFeed::getName(header.source);
+    auto found = std::find_if(books.begin(), books.end(), [source](const auto& e) { return e.source == source; });
+
+    if (found == books.end()) {
+      return;
+    }
+
+    auto isNewSnapshot = (header.flags & MulticastFeed::NEW_SNAPSHOT) != 0;
+
+    if (isNewSnapshot) {
+      found->isWaitingSnapshot = false;
+    } else if (found->isWaitingSnapshot) {
+      droppedNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      return;
+    }
+
+    if (ordersBook_ != &*found || isNewSnapshot) {
+      flushOrders();
+      ordersBook_ = &*found;
+      isNewSnapshot_ = isNewSnapshot;
+    }
+
+    if ((header.flags & MulticastFeed::EMPTY_SNAPSHOT) != 0) {
+      return;
+    }
+
+    MulticastFeed::OrderPayload payload{};
+    auto& order = orders_.emplace_back();
+
+    std::memcpy(&payload, data, sizeof(payload));
+    order.index = payload.index;
+    order.time = payload.time;
+    order.price = payload.price;
+    order.size = payload.size;
+    order.event_flags = static_cast<dxf_event_flags_t>(payload.eventFlags);
+    order.side = static_cast<dxf_order_side_t>(payload.side);
+  }
+
+  // Called under the mutex
+  void processQuote(std::size_t symbolIndex, const char* data) {
+    if (!quoteSink_) {
+      return;
+    }
+
+    MulticastFeed::QuotePayload payload{};
+    dxf_quote_t quote{};
+
+    std::memcpy(&payload, data, sizeof(payload));
+    quote.time = payload.time;
+    quote.sequence = payload.sequence;
+    quote.time_nanos = payload.timeNanos;
+    quote.bid_time = payload.bidTime;
+    quote.bid_exchange_code = static_cast<dxf_char_t>(payload.bidExchangeCode);
+    quote.bid_price = payload.bidPrice;
+    quote.bid_size = payload.bidSize;
+    quote.ask_time = payload.askTime;
+    quote.ask_exchange_code = static_cast<dxf_char_t>(payload.askExchangeCode);
+    quote.ask_price = payload.askPrice;
+    quote.ask_size = payload.askSize;
+    quote.scope = static_cast<dxf_order_scope_t>(payload.scope);
+    quoteSink_(symbolIndex, symbols_[symbolIndex], &quote, 1);
+  }
+
+  // Called under the mutex
+  void processTrade(std::size_t symbolIndex, const char* data) {
+    if (!tradeSink_) {
+      return;
+    }
+
+    MulticastFeed::TradePayload payload{};
+    dxf_trade_t trade{};
+
+    std::memcpy(&payload, data, sizeof(payload));
+    trade.time = payload.time;
+    trade.sequence = payload.sequence;
+    trade.time_nanos = payload.timeNanos;
+    trade.exchange_code = static_cast<dxf_char_t>(payload.exchangeCode);
+    trade.price = payload.price;
+    trade.size = payload.size;
+    trade.tick = payload.tick;
+    trade.change = payload.change;
+    trade.day_id = payload.dayId;
+    trade.day_volume = payload.dayVolume;
+    trade.day_turnover = payload.dayTurnover;
+    trade.raw_flags = payload.rawFlags;
+    trade.direction = static_cast<dxf_direction_t>(payload.direction);
+    trade.is_eth = payload.isEth;
+    trade.scope = static_cast<dxf_order_scope_t>(payload.scope);
+    tradeSink_(symbolIndex, symbols_[symbolIndex], &trade, 1);
+  }
+
+  // Passes the records of the data packet to the books and the sinks. Called under the mutex.
+  void deliver(const char* data, std::size_t size) {
+    MulticastFeed::PacketHeader packet{};
+
+    std::memcpy(&packet, data, sizeof(packet));
+
+    auto offset = sizeof(packet);
+
+    for (std::uint32_t i = 0; i < packet.recordsNumber && offset + sizeof(MulticastFeed::RecordHeader) <= size; i++) {
+      MulticastFeed::RecordHeader header{};
+
+      std::memcpy(&header, data + offset, sizeof(header));
+
+      auto payloadSize = header.type == MulticastRecordType::ORDER   ? sizeof(MulticastFeed::OrderPayload)
+                         : header.type == MulticastRecordType::QUOTE ? sizeof(MulticastFeed::QuotePayload)
+                                                                     : sizeof(MulticastFeed::TradePayload);
+
+      if (header.length < sizeof(header) + payloadSize || offset + header.length > size) {
+        break;
+      }
+
+      const auto* payload = data + offset + sizeof(header);
+      auto symbolIndex = symbolIndex_.find(MulticastFeed::getName(header.symbol));
+
+      offset += header.length;
+      recordsNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      // The other symbols of the group
+      if (symbolIndex == SymbolIndex::NOT_FOUND) {
+        continue;
+      }
+
+      if (header.type == MulticastRecordType::ORDER) {
+        processOrder(books_[symbolIndex], header, payload);
+      } else if (header.type == MulticastRecordType::QUOTE) {
+        processQuote(symbolIndex, payload);
+      } else if (header.type == MulticastRecordType::TRADE) {
+        processTrade(symbolIndex, payload);
+      }
+    }
+
+    flushOrders();
+  }
+
+  // Passes the pending packets that follow the expected sequence. Called under the mutex.
+  void drain(Group& group) {
+    while (!group.pendingPackets.empty() && group.pendingPackets.begin()->first <= group.expectedSequence) {
+      auto pending = group.pendingPackets.begin();
+
+      if (pending->first == group.expectedSequence) {
+        deliver(pending->second.data(), pending->second.size());
+        group.expectedSequence++;
+      }
+
+      group.pendingPackets.erase(pending);
+    }
+
+    if (group.pendingPackets.empty() && group.lastSequence < group.expectedSequence) {
+      group.retransmitAttempts = 0;
+    }
+  }
+
+  // Skips the lost packets, the books of the group wait for their new snapshots. Called under the mutex.
+  void skipGap(std::uint32_t groupIndex) {
+    auto& group = groups_[groupIndex];
+    auto next = group.pendingPackets.empty() ? group.lastSequence + 1 : group.pendingPackets.begin()->first;
+
+    if (next > group.expectedSequence) {
+      lostNumber_.fetch_add(next - group.expectedSequence, std::memory_order_relaxed);
+      group.expectedSequence = next;
+    }
+
+    group.retransmitAttempts = 0;
+    waitSnapshots(groupIndex);
+    drain(group);
+  }
+
+  // The books of the group drop the order records until their new snapshots. Called under the mutex.
+  void waitSnapshots(std::uint32_t groupIndex) {
+    for (std::size_t i = 0; i < symbols_.size(); i++) {
+      if (MulticastFeed::getGroup(symbols_[i].getName(), config_.groupsNumber) == groupIndex) {
+        for (auto& entry : books_[i]) {
+          entry.isWaitingSnapshot = true;
+        }
+      }
+    }
+
+    // The new snapshots are requested by the maintain at once
+    groups_[groupIndex].snapshotRequestTime = {};
+  }
+
+  void processPacket(const char* data, std::size_t size, bool isRetransmit) {
+    MulticastFeed::PacketHeader header{};
+
+    if (!detail::readMulticastHeader(data, size, header)) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (header.group >= groups_.size() || !groups_[header.group].isJoined) {
+      return;
+    }
+
+    auto& group = groups_[header.group];
+
+    // The late packets of the previous publisher
+    if (header.session < group.session) {
+      return;
+    }
+
+    if (header.session != group.session) {
+      // The restarted publisher numbers the packets from 1 again
+      if (group.session != 0) {
+        group = Group{true, header.session};
+        waitSnapshots(header.group);
+      }
+
+      group.session = header.session;
+    }
+
+    if (header.type == MulticastPacketType::HEARTBEAT) {
+      group.lastSequence = (std::max)(group.lastSequence, header.sequence);
+
+      return;
+    }
+
+    if (header.type == MulticastPacketType::UNAVAILABLE) {
+      if (group.expectedSequence != 0 && header.sequence >= group.expectedSequence) {
+        skipGap(header.group);
+      }
+
+      return;
+    }
+
+    if (header.type != MulticastPacketType::DATA) {
+      return;
+    }
+
+    packetsNumber_.fetch_add(1, std::memory_order_relaxed);
+
+    if (isRetransmit) {
+      retransmittedNumber_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    group.lastSequence = (std::max)(group.lastSequence, header.sequence);
+
+    if (group.expectedSequence == 0) {
+      group.expectedSequence = header.sequence;
+    }
+
+    if (header.sequence < group.expectedSequence || group.pendingPackets.count(header.sequence) != 0) {
+      duplicatesNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      return;
+    }
+
+    if (header.sequence == group.expectedSequence) {
+      deliver(data, size);
+      group.expectedSequence++;
+      drain(group);
+
+      return;
+    }
+
+    if (group.pendingPackets.empty()) {
+      gapsNumber_.fetch_add(1, std::memory_order_relaxed);
+      // The retransmit is requested by the maintain at once
+      group.retransmitTime = {};
+    }
+
+    group.pendingPackets.emplace(header.sequence, std::vector<char>(data, data + size));
+
+    if (group.pendingPackets.size() > config_.maxPendingPackets) {
+      skipGap(header.group);
+    }
+  }
+
+  // Requests the lost packets and the snapshots of the waiting books
+  void maintain() {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    for (std::uint32_t i = 0; i < groups_.size(); i++) {
+      auto& group = groups_[i];
+
+      if (!group.isJoined || group.expectedSequence == 0 || group.lastSequence < group.expectedSequence ||
+          now - group.retransmitTime < config_.retransmitTimeout) {
+        continue;
+      }
+
+      if (!hasPublisher_ || group.retransmitAttempts >= config_.maxRetransmitAttempts) {
+        skipGap(i);
+
+        continue;
+      }
+
+      auto next = group.pendingPackets.empty() ? group.lastSequence + 1 : group.pendingPackets.begin()->first;
+
+      if (group.retransmitAttempts == 0 && group.pendingPackets.empty()) {
+        // The lost tail (seen by the heartbeat)
+        gapsNumber_.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      group.retransmitAttempts++;
+      group.retransmitTime = now;
+      sendRequest(MulticastPacketType::RETRANSMIT_REQUEST, i, group.expectedSequence,
+                  static_cast<std::uint32_t>(next - group.expectedSequence));
+      retransmitRequestsNumber_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    for (std::size_t i = 0; hasPublisher_ && i < symbols_.size(); i++) {
+      auto isWaiting = std::any_of(books_[i].begin(), books_[i].end(), [](const auto& e) {
+        return e.isWaitingSnapshot;
+      });
+
+      if (!isWaiting) {
+        continue;
+      }
+
+      auto groupIndex = MulticastFeed::getGroup(symbols_[i].getName(), config_.groupsNumber);
+      auto& group = groups_[groupIndex];
+
+      // The snapshots are published by the publisher at most every snapshotInterval
+      if (now - group.snapshotRequestTime >= config_.snapshotInterval) {
+        group.snapshotRequestTime = now;
+        sendRequest(MulticastPacketType::SNAPSHOT_REQUEST, groupIndex, 0, 0);
+        snapshotRequestsNumber_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void run() {
+    std::vector<char> data(MulticastFeed::MAX_PACKET_SIZE);
+
+    while (!stop_.load(std::memory_order_acquire)) {
+      bool isData = false;
+      bool isResponse = false;
+      auto timeout = static_cast<int>((std::max)(config_.retransmitTimeout.count() / 5, std::int64_t{1}));
+
+      if (detail::pollMulticastSockets(socket_, requestSocket_, timeout, isData, isResponse) > 0) {
+        if (isData) {
+          auto size = recv(socket_, data.data(), static_cast<int>(data.size()), 0);
+
+          if (size > 0) {
+            processPacket(data.data(), static_cast<std::size_t>(size), false);
+          }
+        }
+
+        if (isResponse) {
+          auto size = recv(requestSocket_, data.data(), static_cast<int>(data.size()), 0);
+
+          if (size > 0) {
+            processPacket(data.data(), static_cast<std::size_t>(size), true);
+          }
+        }
+      }
+
+      maintain();
+    }
+  }
+
+  bool join(std::uint32_t groupIndex) {
+    if (groups_[groupIndex].isJoined) {
+      return true;
+    }
+
+    sockaddr_in address{};
+    ip_mreq membership{};
+
+    if (!detail::getMulticastGroupAddress(config_, groupIndex, address)) {
+      return false;
+    }
+
+    membership.imr_multiaddr = address.sin_addr;
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+
+    if (!config_.interfaceAddress.empty() &&
+        inet_pton(AF_INET, config_.interfaceAddress.c_str(), &membership.imr_interface) != 1) {
+      return false;
+    }
+
+    if (setsockopt(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, reinterpret_cast<const char*>(&membership),
+                   sizeof(membership)) != 0) {
+      return false;
+    }
+
+    groups_[groupIndex].isJoined = true;
+
+    return true;
+  }
+
+  void close() {
+    if (socket_ != detail::INVALID_MULTICAST_SOCKET) {
+      detail::closeMulticastSocket(socket_);
+      socket_ = detail::INVALID_MULTICAST_SOCKET;
+    }
+
+    if (requestSocket_ != detail::INVALID_MULTICAST_SOCKET) {
+      detail::closeMulticastSocket(requestSocket_);
+      requestSocket_ = detail::INVALID_MULTICAST_SOCKET;
+    }
+
+    for (auto& group : groups_) {
+      group.isJoined = false;
+    }
+  }
+
+  bool open() {
+    socket_ = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (socket_ == detail::INVALID_MULTICAST_SOCKET) {
+      return false;
+    }
+
+    // The receivers of the host share the port
+    int reuse = 1;
+
+    setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+#ifdef SO_REUSEPORT
+    setsockopt(socket_, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+#endif
+
+    if (config_.receiveBufferSize > 0) {
+      auto size = config_.receiveBufferSize;
+
+      setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&size), sizeof(size));
+    }
+
+    sockaddr_in address{};
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons(config_.port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (bind(socket_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+      return false;
+    }
+
+    // The responses of the publisher are received by the own socket (the port of the group is shared)
+    requestSocket_ = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (requestSocket_ == detail::INVALID_MULTICAST_SOCKET) {
+      return false;
+    }
+
+    if (!config_.publisherAddress.empty()) {
+      hasPublisher_ = detail::resolveMulticastAddress(config_.publisherAddress, config_.requestPort, publisherAddress_);
+
+      if (!hasPublisher_) {
+        return false;
+      }
+    }
+
+    for (const auto& symbol : symbols_) {
+      if (!join(MulticastFeed::getGroup(symbol.getName(), config_.groupsNumber))) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+ public:
+  MulticastReceiver(MulticastFeedConfig config, const std::vector<std::string>& symbols)
+      : config_{std::move(config)} {
+    config_.groupsNumber = (std::max)(config_.groupsNumber, std::uint32_t{1});
+    groups_.resize(config_.groupsNumber);
+
+    for (const auto& symbol : symbols) {
+      addSymbol(symbol);
+    }
+  }
+
+  MulticastReceiver(const MulticastReceiver&) = delete;
+  MulticastReceiver& operator=(const MulticastReceiver&) = delete;
+
+  ~MulticastReceiver() { stop(); }
+
+  // Attaches the detached book (PriceLevelBook::createDetached) of the symbol and the source, the book waits for its
+  // snapshot. The book must outlive the receiver. Returns false if the group of the new symbol can't be joined.
+  bool attachBook(PriceLevelBook& book) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto symbolIndex = addSymbol(book.getSymbol());
+
+    books_[symbolIndex].push_back({book.getSource(), &book, true});
+
+    return socket_ == detail::INVALID_MULTICAST_SOCKET ||
+           join(MulticastFeed::getGroup(book.getSymbol(), config_.groupsNumber));
+  }
+
+  // Creates the detached book that is owned by the receiver and attaches it
+  PriceLevelBook* createBook(const std::string& symbol, const std::string& source, std::size_t levelsNumber,
+                             const PriceLevelBookConfig& config = {}) {
+    auto& book = ownedBooks_.emplace_back(PriceLevelBook::createDetached(symbol, source, levelsNumber, config));
+
+    attachBook(*book);
+
+    return book.get();
+  }
+
+  void setQuoteSink(EventReceiver::BatchSinkType<dxf_quote_t> sink) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    quoteSink_ = std::move(sink);
+  }
+
+  void setTradeSink(EventReceiver::BatchSinkType<dxf_trade_t> sink) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    tradeSink_ = std::move(sink);
+  }
+
+  // Opens the sockets, joins the groups of the symbols and starts the thread. Returns false if the sockets can't be
+  // opened or the groups can't be joined.
+  bool start() {
+    if (thread_.joinable()) {
+      return true;
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+
+      if (!open()) {
+        close();
+
+        return false;
+      }
+    }
+
+    stop_.store(false, std::memory_order_release);
+    thread_ = std::thread([this] { run(); });
+
+    return true;
+  }
+
+  // Stops the thread and closes the sockets (the groups are left)
+  void stop() {
+    stop_.store(true, std::memory_order_release);
+
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+
+    close();
+  }
+
+  [[nodiscard]] MulticastReceiverStats getStats() const {
+    return {packetsNumber_.load(std::memory_order_relaxed),
+            recordsNumber_.load(std::memory_order_relaxed),
+            duplicatesNumber_.load(std::memory_order_relaxed),
+            gapsNumber_.load(std::memory_order_relaxed),
+            retransmitRequestsNumber_.load(std::memory_order_relaxed),
+            retransmittedNumber_.load(std::memory_order_relaxed),
+            lostNumber_.load(std::memory_order_relaxed),
+            snapshotRequestsNumber_.load(std::memory_order_relaxed),
+            droppedNumber_.load(std::memory_order_relaxed)};
+  }
+};
+
+}  // namespace dxf
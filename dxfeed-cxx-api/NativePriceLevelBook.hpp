@@ -0,0 +1,225 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "PriceLevel.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The price level book of the native C API (dxf_create_price_level_book) with the incremental changes. The native book
+// is built by the C API from the orders of the sources and delivers the whole book on every change. This book keeps the
+// previous levels and diffs them with the new ones by one merge pass over the sorted sides, so the handlers receive the
+// same PriceLevelChangesSet deltas as the PriceLevelBook ones without the order snapshots and the order index of the
+// C++ engine. The levels beyond the levelsNumber best ones are ignored, so the deep levels don't produce the deltas.
+class NativePriceLevelBook final {
+  std::string symbol_;
+  std::vector<std::string> sources_;
+  // 0 - all levels of the native book
+  std::size_t levelsNumber_;
+  dxf_price_level_book_t book_;
+  bool isValid_;
+  std::mutex mutex_;
+  // The current levels (best-first) and the buffer of the next ones, they are swapped on every change
+  PriceLevelChanges levels_;
+  PriceLevelChanges nextLevels_;
+  bool hasBook_;
+  PriceLevelChangesSet changes_;
+
+  std::function<void(const PriceLevelChanges&)> onNewBook_;
+  std::function<void(const PriceLevelChanges&)> onBookUpdate_;
+  std::function<void(const PriceLevelChangesSet&)> onIncrementalChange_;
+
+  NativePriceLevelBook(std::string symbol, std::vector<std::string> sources, std::size_t levelsNumber)
+      : symbol_{std::move(symbol)},
+        sources_{std::move(sources)},
+        levelsNumber_{levelsNumber},
+        book_{nullptr},
+        isValid_{false},
+        mutex_{},
+        levels_{},
+        nextLevels_{},
+        hasBook_{false},
+        changes_{},
+        onNewBook_{},
+        onBookUpdate_{},
+        onIncrementalChange_{} {}
+
+  void copyLevels(const dxf_price_level_element_t* elements, std::size_t count, std::vector<PriceLevel>& levels) const {
+    levels.clear();
+
+    for (std::size_t i = 0; i < count && (levelsNumber_ == 0 || levels.size() < levelsNumber_); i++) {
+      PriceLevel level{elements[i].price, elements[i].size, static_cast<std::int64_t>(elements[i].time)};
+
+      if (!isZeroPriceLevel(level)) {
+        levels.push_back(level);
+      }
+    }
+  }
+
+  void closeBook() {
+    if (book_ != nullptr) {
+      dxf_close_price_level_book(book_);
+      book_ = nullptr;
+    }
+
+    isValid_ = false;
+  }
+
+ public:
+  ~NativePriceLevelBook() { closeBook(); }
+
+  // The changes from the old levels of the side to the new ones (both are best-first): the additions and the updates
+  // are the new levels, the removals are the old ones. The results are appended.
+  template <typename Side>
+  static void diffSide(const std::vector<PriceLevel>& oldLevels, const std::vector<PriceLevel>& newLevels,
+                       std::vector<PriceLevel>& additions, std::vector<PriceLevel>& updates,
+                       std::vector<PriceLevel>& removals) {
+    std::size_t i = 0;
+    std::size_t j = 0;
+
+    while (i < oldLevels.size() || j < newLevels.size()) {
+      if (j == newLevels.size() ||
+          (i < oldLevels.size() && Side::isBetter(oldLevels[i].price, newLevels[j].price) &&
+           !areEqualPrices(oldLevels[i].price, newLevels[j].price))) {
+        removals.push_back(oldLevels[i++]);
+      } else if (i == oldLevels.size() || !areEqualPrices(oldLevels[i].price, newLevels[j].price)) {
+        additions.push_back(newLevels[j++]);
+      } else {
+        if (oldLevels[i].size != newLevels[j].size) {
+          updates.push_back(newLevels[j]);
+        }
+
+        i++;
+        j++;
+      }
+    }
+  }
+
+  // Creates the book of the orders of the sources (empty - all sources). The book is valid if the native book is
+  // created.
+  static std::unique_ptr<NativePriceLevelBook> create(dxf_connection_t connection, const std::string& symbol,
+                                                      const std::vector<std::string>& sources,
+                                                      std::size_t levelsNumber) {
+    auto book = createDetached(symbol, sources, levelsNumber);
+    const auto& wSymbol = Symbol::valueOf(symbol).getWideName();
+    // The NULL-terminated list
+    std::vector<const char*> cSources{};
+
+    for (const auto& source : book->sources_) {
+      cSources.push_back(source.c_str());
+    }
+
+    cSources.push_back(nullptr);
+
+    if (dxf_create_price_level_book(connection, wSymbol.c_str(), cSources.data(), &book->book_) == DXF_FAILURE) {
+      book->book_ = nullptr;
+
+      return book;
+    }
+
+    book->isValid_ = true;
+    dxf_attach_price_level_book_listener(
+      book->book_,
+      [](dxf_price_level_book_const_data_ptr_t bookData, void* userData) {
+        static_cast<NativePriceLevelBook*>(userData)->processBook(bookData);
+      },
+      book.get());
+
+    return book;
+  }
+
+  // Creates the book without the native book. The books are passed to the processBook by the caller.
+  static std::unique_ptr<NativePriceLevelBook> createDetached(const std::string& symbol,
+                                                              const std::vector<std::string>& sources,
+                                                              std::size_t levelsNumber) {
+    return std::unique_ptr<NativePriceLevelBook>(new NativePriceLevelBook(symbol, sources, levelsNumber));
+  }
+
+  // The first book is passed to the onNewBook handler, the next ones are passed as the changes from the previous one
+  // (the handlers are not called if the visible levels are not changed)
+  void processBook(dxf_price_level_book_const_data_ptr_t bookData) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    copyLevels(bookData->asks, bookData->asks_count, nextLevels_.asks);
+    copyLevels(bookData->bids, bookData->bids_count, nextLevels_.bids);
+
+    if (!hasBook_) {
+      hasBook_ = true;
+      std::swap(levels_, nextLevels_);
+
+      if (onNewBook_) {
+        onNewBook_(levels_);
+      }
+
+      return;
+    }
+
+    changes_.additions.asks.clear();
+    changes_.additions.bids.clear();
+    changes_.updates.asks.clear();
+    changes_.updates.bids.clear();
+    changes_.removals.asks.clear();
+    changes_.removals.bids.clear();
+    diffSide<AskSide>(levels_.asks, nextLevels_.asks, changes_.additions.asks, changes_.updates.asks,
+                      changes_.removals.asks);
+    diffSide<BidSide>(levels_.bids, nextLevels_.bids, changes_.additions.bids, changes_.updates.bids,
+                      changes_.removals.bids);
+    std::swap(levels_, nextLevels_);
+
+    if (changes_.additions.asks.empty() && changes_.additions.bids.empty() && changes_.updates.asks.empty() &&
+        changes_.updates.bids.empty() && changes_.removals.asks.empty() && changes_.removals.bids.empty()) {
+      return;
+    }
+
+    if (onIncrementalChange_) {
+      onIncrementalChange_(changes_);
+    }
+
+    if (onBookUpdate_) {
+      onBookUpdate_(levels_);
+    }
+  }
+
+  [[nodiscard]] bool isValid() const { return isValid_; }
+
+  [[nodiscard]] const std::string& getSymbol() const { return symbol_; }
+
+  [[nodiscard]] const std::vector<std::string>& getSources() const { return sources_; }
+
+  // The copy of the current levels
+  [[nodiscard]] PriceLevelChanges getBook() {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return levels_;
+  }
+
+  void setOnNewBook(std::function<void(const PriceLevelChanges&)> onNewBookHandler) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onNewBook_ = std::move(onNewBookHandler);
+  }
+
+  void setOnBookUpdate(std::function<void(const PriceLevelChanges&)> onBookUpdateHandler) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onBookUpdate_ = std::move(onBookUpdateHandler);
+  }
+
+  void setOnIncrementalChange(std::function<void(const PriceLevelChangesSet&)> onIncrementalChangeHandler) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onIncrementalChange_ = std::move(onIncrementalChangeHandler);
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "LargePages.hpp"
+#include "PriceLevel.hpp"
+
+namespace dxf {
+
+// The open addressing (Robin Hood) hash table of the live orders keyed by the order index. The OrderData values are
+// stored inline in one contiguous array of slots, so the lookups don't chase the node pointers and the steady-state
+// additions and removals don't allocate. The removals use the backward shift, so there are no tombstones.
+//
+// The probe distances are kept in the separate byte array, so a slot is exactly one OrderData (32 bytes, two slots per
+// cache line). The table grows if a distance doesn't fit in a byte. The large tables are the large page buffers (see
+// LargePages).
+//
+// Value - the stored value, Key - its dxf_long_t key member (e.g. the slot of the order in the pooled array of the
+// MarketByOrderBook by the order index)
+template <typename Value, dxf_long_t Value::*Key = &Value::index>
+class BasicOrderDataMap final {
+  static constexpr std::size_t MIN_CAPACITY = 16;
+  static constexpr std::uint32_t MAX_DISTANCE = 255;
+
+  std::vector<Value, LargePageAllocator<Value>> slots_{};
+  // 0 - the slot is empty, otherwise the distance from the home slot + 1
+  std::vector<std::uint8_t, LargePageAllocator<std::uint8_t>> distances_{};
+  std::size_t mask_ = 0;
+  // 64 - log2(capacity)
+  int shift_ = 64;
+  std::size_t size_ = 0;
+
+  [[nodiscard]] std::size_t home(dxf_long_t index) const {
+    // Fibonacci hashing (the high bits of the product): the indexes are often sequential or differ in the high bits
+    auto hash = static_cast<std::uint64_t>(index) * 0x9E3779B97F4A7C15ULL;
+
+    return static_cast<std::size_t>(hash >> shift_);
+  }
+
+  [[nodiscard]] std::size_t findPosition(dxf_long_t index) const {
+    if (size_ == 0) {
+      return slots_.size();
+    }
+
+    auto position = home(index);
+
+    for (std::uint32_t distance = 1;; distance++) {
+      // The Robin Hood invariant: the key would have displaced any slot that is closer to its home
+      if (distances_[position] < distance) {
+        return slots_.size();
+      }
+
+      if (slots_[position].*Key == index) {
+        return position;
+      }
+
+      position = (position + 1) & mask_;
+    }
+  }
+
+  void rehash(std::size_t capacity) {
+    auto oldSlots = std::move(slots_);
+    auto oldDistances = std::move(distances_);
+
+    slots_.assign(capacity, Value{});
+    distances_.assign(capacity, 0);
+    mask_ = capacity - 1;
+    shift_ = 64 - std::countr_zero(capacity);
+    size_ = 0;
+
+    for (std::size_t i = 0; i < oldSlots.size(); i++) {
+      if (oldDistances[i] != 0) {
+        insertNew(oldSlots[i]);
+      }
+    }
+  }
+
+  // The key must be absent
+  void insertNew(Value data) {
+    auto position = home(data.*Key);
+    std::uint32_t distance = 1;
+
+    while (true) {
+      if (distance > MAX_DISTANCE) {
+        // The carried data is not in the table after the swaps
+        rehash(slots_.size() * 2);
+        insertNew(data);
+
+        return;
+      }
+
+      if (distances_[position] == 0) {
+        slots_[position] = data;
+        distances_[position] = static_cast<std::uint8_t>(distance);
+        size_++;
+
+        return;
+      }
+
+      if (distances_[position] < distance) {
+        std::uint32_t slotDistance = distances_[position];
+
+        std::swap(slots_[position], data);
+        distances_[position] = static_cast<std::uint8_t>(distance);
+        distance = slotDistance;
+      }
+
+      position = (position + 1) & mask_;
+      distance++;
+    }
+  }
+
+  // The maximum load factor is 7/8
+  [[nodiscard]] static std::size_t capacityFor(std::size_t size) {
+    return std::bit_ceil((std::max)(MIN_CAPACITY, size + size / 7 + 1));
+  }
+
+ public:
+  BasicOrderDataMap() = default;
+
+  explicit BasicOrderDataMap(std::size_t ordersNumberHint) { reserve(ordersNumberHint); }
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+
+  [[nodiscard]] bool empty() const { return size_ == 0; }
+
+  // Prepares the table for the given number of the orders without the rehashing.
+  void reserve(std::size_t ordersNumber) {
+    if (auto capacity = capacityFor(ordersNumber); capacity > slots_.size()) {
+      rehash(capacity);
+    }
+  }
+
+  // Returns the order data or nullptr. The pointer is valid until the next modification of the map.
+  [[nodiscard]] const Value* find(dxf_long_t index) const {
+    auto position = findPosition(index);
+
+    return position == slots_.size() ? nullptr : &slots_[position];
+  }
+
+  [[nodiscard]] Value* find(dxf_long_t index) {
+    auto position = findPosition(index);
+
+    return position == slots_.size() ? nullptr : &slots_[position];
+  }
+
+  // Inserts the order data or replaces the order data with the same index.
+  void insert(const Value& data) {
+    if (auto found = find(data.*Key)) {
+      *found = data;
+
+      return;
+    }
+
+    if (capacityFor(size_ + 1) > slots_.size()) {
+      rehash(capacityFor(size_ + 1));
+    }
+
+    insertNew(data);
+  }
+
+  // Returns true if the order data was erased
+  bool erase(dxf_long_t index) {
+    auto position = findPosition(index);
+
+    if (position == slots_.size()) {
+      return false;
+    }
+
+    // The backward shift: the following displaced slots are moved one step closer to their home
+    while (true) {
+      auto next = (position + 1) & mask_;
+
+      if (distances_[next] <= 1) {
+        distances_[position] = 0;
+
+        break;
+      }
+
+      slots_[position] = slots_[next];
+      distances_[position] = static_cast<std::uint8_t>(distances_[next] - 1);
+      position = next;
+    }
+
+    size_--;
+
+    return true;
+  }
+
+  // Calls the f with every value (in the order of the slots)
+  template <typename F>
+  void forEach(F&& f) const {
+    for (std::size_t i = 0; i < slots_.size(); i++) {
+      if (distances_[i] != 0) {
+        f(slots_[i]);
+      }
+    }
+  }
+
+  // Keeps the capacity
+  void clear() {
+    std::fill(distances_.begin(), distances_.end(), std::uint8_t{0});
+    size_ = 0;
+  }
+
+  // The heap bytes held by the table
+  [[nodiscard]] std::size_t getMemoryUsage() const {
+    return slots_.capacity() * sizeof(Value) + distances_.capacity() * sizeof(std::uint8_t);
+  }
+};
+
+using OrderDataMap = BasicOrderDataMap<OrderData>;
+
+}  // namespace dxf
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace dxf {
+
+// The parameters of the synthetic order flow. The weights of the actions are relative (0 - never).
+struct OrderFlowConfig {
+  std::uint64_t seed = 42;
+  double midPrice = 100.0;
+  double tickSize = 0.01;
+  // The distance of the new order from the mid price is 1 + geometric ticks with this mean, limited by the depth
+  double meanDistanceTicks = 10.0;
+  std::size_t depthTicks = 1000;
+  // The probability of the move of the mid price by one tick before every transaction
+  double midMoveProbability = 0.0;
+  // The sizes are the integers from 1
+  int maxOrderSize = 100;
+  std::size_t snapshotOrdersNumber = 10000;
+  std::size_t recordsPerTransaction = 4;
+  double addWeight = 40.0;
+  // The new size at the same price
+  double modifyWeight = 30.0;
+  // The new price at the same side
+  double moveWeight = 0.0;
+  // The new price at the other side (the replaced order leaves the level of its old side)
+  double sideFlipWeight = 0.0;
+  double cancelWeight = 30.0;
+  // The removals of the orders that the book doesn't have (e.g. the late removals after the snapshot)
+  double unknownCancelWeight = 0.0;
+  // The share of the cancels by the zero size instead of the REMOVE_EVENT flag
+  double zeroSizeCancelShare = 0.0;
+  // The probability of the transaction that cancels the massCancelShare of the orders of one side
+  double massCancelProbability = 0.0;
+  double massCancelShare = 0.5;
+  // The probability of the new snapshot instead of the transaction: half of the live orders are sent again (with the
+  // new sizes) and the rest are replaced by the new ones, as after the resync
+  double snapshotResetProbability = 0.0;
+
+  // The mix of every path of the book at the rates far above the real markets: the deep book, the random walk of the
+  // mid price, the moves, the side flips, the zero size and the unknown removals, the mass cancels and the resets
+  static OrderFlowConfig adversarial() {
+    OrderFlowConfig config{};
+
+    config.meanDistanceTicks = 50.0;
+    config.depthTicks = 5000;
+    config.midMoveProbability = 0.2;
+    config.recordsPerTransaction = 16;
+    config.addWeight = 30.0;
+    config.modifyWeight = 20.0;
+    config.moveWeight = 15.0;
+    config.sideFlipWeight = 5.0;
+    config.cancelWeight = 25.0;
+    config.unknownCancelWeight = 5.0;
+    config.zeroSizeCancelShare = 0.5;
+    config.massCancelProbability = 0.001;
+    config.snapshotResetProbability = 0.0001;
+
+    return config;
+  }
+};
+
+// The chunk of the flow as the snapshot listener receives it
+struct OrderFlowChunk {
+  std::vector<dxf_order_t> orders{};
+  bool newSnapshot = false;
+
+  // The view of the chunk for the processSnapshotData of the books (valid while the chunk is not changed)
+  [[nodiscard]] dxf_snapshot_data_t toSnapshotData() const {
+    dxf_snapshot_data_t snapshotData{};
+
+    snapshotData.event_type = dx_eid_order;
+    snapshotData.records_count = orders.size();
+    snapshotData.records = const_cast<dxf_order_t*>(orders.data());
+
+    return snapshotData;
+  }
+};
+
+// Generates the deterministic (by the seed) synthetic order flow of one book: the first chunk is the snapshot, the next
+// ones are the transactions of the incremental records (the additions, the modifications, the moves, the side flips
+// and the removals of the orders), the mass cancels and the new snapshots. The flow covers the conditions that the
+// captured tapes don't, so the books can be benchmarked and fuzzed (e.g. with the PriceLevelBookIntegrityChecker) under
+// the worst-case loads.
+//
+// Usage:
+//   OrderFlowGenerator generator{OrderFlowConfig::adversarial()};
+//
+//   for (std::size_t i = 0; i < 1000000; i++) {
+//     const auto& chunk = generator.next();
+//     auto snapshotData = chunk.toSnapshotData();
+//
+//     book->processSnapshotData(&snapshotData, chunk.newSnapshot ? 1 : 0);
+//   }
+class OrderFlowGenerator final {
+  enum Action : int { ADD = 0, MODIFY = 1, MOVE = 2, SIDE_FLIP = 3, CANCEL = 4, UNKNOWN_CANCEL = 5 };
+
+  OrderFlowConfig config_;
+  std::mt19937_64 rng_;
+  std::geometric_distribution<int> distanceDistribution_;
+  std::uniform_int_distribution<int> sizeDistribution_;
+  std::uniform_real_distribution<double> probabilityDistribution_;
+  std::discrete_distribution<int> actionDistribution_;
+  // The mid price in ticks
+  std::int64_t midTicks_;
+  std::vector<dxf_order_t> liveOrders_{};
+  dxf_long_t nextIndex_ = 1;
+  dxf_long_t time_ = 0;
+  bool isStarted_ = false;
+  OrderFlowChunk chunk_{};
+
+  bool isHit(double probability) { return probability > 0.0 && probabilityDistribution_(rng_) < probability; }
+
+  double getPrice(dxf_order_side_t side) {
+    auto distance = (std::min)(static_cast<std::int64_t>(1 + distanceDistribution_(rng_)),
+                               static_cast<std::int64_t>((std::max)(config_.depthTicks, std::size_t{1})));
+    auto ticks = side == dxf_osd_buy ? midTicks_ - distance : midTicks_ + distance;
+
+    return static_cast<double>(ticks) * config_.tickSize;
+  }
+
+  dxf_order_t newOrder() {
+    dxf_order_t order{};
+
+    order.index = nextIndex_++;
+    order.side = (rng_() & 1U) == 0 ? dxf_osd_buy : dxf_osd_sell;
+    order.price = getPrice(order.side);
+    order.size = sizeDistribution_(rng_);
+    order.time = ++time_;
+
+    return order;
+  }
+
+  dxf_order_t removal(dxf_order_t order) {
+    order.time = ++time_;
+
+    if (isHit(config_.zeroSizeCancelShare)) {
+      order.size = 0;
+    } else {
+      order.event_flags = dxf_ef_remove_event;
+    }
+
+    return order;
+  }
+
+  void removeLiveOrder(std::size_t position) {
+    liveOrders_[position] = liveOrders_.back();
+    liveOrders_.pop_back();
+  }
+
+  void addRecord() {
+    auto action = liveOrders_.empty() ? ADD : static_cast<Action>(actionDistribution_(rng_));
+
+    if (action == ADD) {
+      chunk_.orders.push_back(liveOrders_.emplace_back(newOrder()));
+
+      return;
+    }
+
+    if (action == UNKNOWN_CANCEL) {
+      dxf_order_t order{};
+
+      order.index = nextIndex_++;
+      order.side = (rng_() & 1U) == 0 ? dxf_osd_buy : dxf_osd_sell;
+      order.price = getPrice(order.side);
+      chunk_.orders.push_back(removal(order));
+
+      return;
+    }
+
+    auto position = static_cast<std::size_t>(rng_() % liveOrders_.size());
+    auto& order = liveOrders_[position];
+
+    if (action == CANCEL) {
+      chunk_.orders.push_back(removal(order));
+      removeLiveOrder(position);
+
+      return;
+    }
+
+    if (action == SIDE_FLIP) {
+      order.side = order.side == dxf_osd_buy ? dxf_osd_sell : dxf_osd_buy;
+    }
+
+    if (action != MODIFY) {
+      order.price = getPrice(order.side);
+    }
+
+    order.size = sizeDistribution_(rng_);
+    order.time = ++time_;
+    chunk_.orders.push_back(order);
+  }
+
+  void addMassCancel() {
+    auto side = (rng_() & 1U) == 0 ? dxf_osd_buy : dxf_osd_sell;
+
+    for (std::size_t i = 0; i < liveOrders_.size();) {
+      if (liveOrders_[i].side == side && isHit(config_.massCancelShare)) {
+        chunk_.orders.push_back(removal(liveOrders_[i]));
+        removeLiveOrder(i);
+      } else {
+        i++;
+      }
+    }
+  }
+
+  void addSnapshot() {
+    std::size_t kept = 0;
+
+    for (auto& order : liveOrders_) {
+      if ((rng_() & 1U) == 0) {
+        order.size = sizeDistribution_(rng_);
+        order.time = ++time_;
+        liveOrders_[kept++] = order;
+      }
+    }
+
+    liveOrders_.resize(kept);
+
+    while (liveOrders_.size() < config_.snapshotOrdersNumber) {
+      liveOrders_.push_back(newOrder());
+    }
+
+    chunk_.orders.assign(liveOrders_.begin(), liveOrders_.end());
+    chunk_.newSnapshot = true;
+  }
+
+ public:
+  explicit OrderFlowGenerator(OrderFlowConfig config = {})
+      : config_{config},
+        rng_{config.seed},
+        distanceDistribution_{1.0 / (std::max)(config.meanDistanceTicks, 1.0)},
+        sizeDistribution_{1, (std::max)(config.maxOrderSize, 1)},
+        probabilityDistribution_{0.0, 1.0},
+        actionDistribution_{config.addWeight,    config.modifyWeight, config.moveWeight,
+                            config.sideFlipWeight, config.cancelWeight, config.unknownCancelWeight},
+        midTicks_{std::llround(config.midPrice / config.tickSize)} {}
+
+  // The next chunk: the snapshot first, then the transactions (never empty). The chunk is valid until the next call.
+  const OrderFlowChunk& next() {
+    chunk_.orders.clear();
+    chunk_.newSnapshot = false;
+
+    if (!isStarted_ || isHit(config_.snapshotResetProbability)) {
+      isStarted_ = true;
+      addSnapshot();
+
+      return chunk_;
+    }
+
+    if (isHit(config_.midMoveProbability)) {
+      midTicks_ += (rng_() & 1U) == 0 ? 1 : -1;
+    }
+
+    if (isHit(config_.massCancelProbability)) {
+      addMassCancel();
+    }
+
+    if (chunk_.orders.empty()) {
+      for (std::size_t i = 0; i < (std::max)(config_.recordsPerTransaction, std::size_t{1}); i++) {
+        addRecord();
+      }
+    }
+
+    return chunk_;
+  }
+
+  // The snapshot and the transactionsNumber next chunks
+  std::vector<OrderFlowChunk> generate(std::size_t transactionsNumber) {
+    std::vector<OrderFlowChunk> result{};
+
+    result.reserve(transactionsNumber + 1);
+
+    for (std::size_t i = 0; i <= transactionsNumber; i++) {
+      result.push_back(next());
+    }
+
+    return result;
+  }
+
+  [[nodiscard]] std::size_t getLiveOrdersNumber() const { return liveOrders_.size(); }
+
+  [[nodiscard]] double getMidPrice() const { return static_cast<double>(midTicks_) * config_.tickSize; }
+};
+
+}  // namespace dxf
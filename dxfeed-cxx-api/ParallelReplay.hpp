@@ -0,0 +1,415 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Clock.hpp"
+#include "SnapshotDataCapture.hpp"
+#include "ThreadPlacement.hpp"
+#include "TimeAndSaleTape.hpp"
+
+namespace dxf {
+
+// The records of one symbol in the time order (e.g. of its tape or its capture) replayed by the shard of the symbol
+class ReplayStream {
+ public:
+  static constexpr std::int64_t END = (std::numeric_limits<std::int64_t>::max)();
+
+  virtual ~ReplayStream() = default;
+
+  // The time of the next record (ms since the epoch), END - there are no more records
+  [[nodiscard]] virtual std::int64_t getNextTime() const = 0;
+
+  // Replays the next record on the thread of the shard (the clock of the shard is at the time of the record)
+  virtual void replayNext() = 0;
+};
+
+// The captured snapshot data of one book (see SnapshotDataWriter) passed to the consumer, e.g. to
+// PriceLevelBook::processSnapshotData of the detached book. The time of the chunk is the latest time of its orders (the
+// chunks without the times keep the previous one).
+class SnapshotCaptureReplayStream final : public ReplayStream {
+ public:
+  using Consumer = std::function<void(const dxf_snapshot_data_ptr_t, int)>;
+
+ private:
+  std::unique_ptr<std::FILE, decltype(&std::fclose)> file_;
+  SnapshotDataReader reader_;
+  Consumer consumer_;
+  std::vector<dxf_order_t> orders_;
+  bool isNewSnapshot_;
+  std::int64_t nextTime_;
+
+  SnapshotCaptureReplayStream(std::unique_ptr<std::FILE, decltype(&std::fclose)> file, Consumer consumer)
+      : file_{std::move(file)},
+        reader_{file_.get()},
+        consumer_{std::move(consumer)},
+        orders_{},
+        isNewSnapshot_{false},
+        nextTime_{0} {}
+
+  void readNext() {
+    if (!reader_.read(orders_, isNewSnapshot_)) {
+      nextTime_ = END;
+
+      return;
+    }
+
+    for (const auto& order : orders_) {
+      nextTime_ = (std::max)(nextTime_, static_cast<std::int64_t>(order.time));
+    }
+  }
+
+ public:
+  // Opens the capture. Returns nullptr if the file can't be opened or it's not a capture of the supported version
+  static std::unique_ptr<SnapshotCaptureReplayStream> open(const std::string& path, Consumer consumer) {
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> file{std::fopen(path.c_str(), "rb"), &std::fclose};
+
+    if (!file) {
+      return nullptr;
+    }
+
+    auto stream = std::unique_ptr<SnapshotCaptureReplayStream>(
+      new SnapshotCaptureReplayStream(std::move(file), std::move(consumer)));
+
+    if (!stream->reader_.isValid()) {
+      return nullptr;
+    }
+
+    stream->readNext();
+
+    return stream;
+  }
+
+  [[nodiscard]] std::int64_t getNextTime() const override { return nextTime_; }
+
+  void replayNext() override {
+    dxf_snapshot_data_t snapshotData{};
+
+    snapshotData.event_type = dx_eid_order;
+    snapshotData.records_count = orders_.size();
+    snapshotData.records = orders_.data();
+    consumer_(&snapshotData, isNewSnapshot_ ? 1 : 0);
+    readNext();
+  }
+};
+
+// The records of the tape (see TimeAndSaleTapeWriter) passed to the consumer in the time order: the blocks are decoded
+// one by one in the order of their first times and the records of the block are sorted by the time and the index, so
+// the tapes written in the time order or in the reverse one (e.g. the history received from the newest event) are
+// replayed in the time order.
+class TimeAndSaleTapeReplayStream final : public ReplayStream {
+ public:
+  // f(reader, record): the strings of the record are the ids of the reader (see TimeAndSaleTapeReader::getString)
+  using Consumer = std::function<void(const TimeAndSaleTapeReader&, const TimeAndSaleRecord&)>;
+
+ private:
+  std::unique_ptr<TimeAndSaleTapeReader> reader_;
+  Consumer consumer_;
+  std::vector<std::size_t> blockOrder_;
+  std::size_t nextBlock_;
+  std::vector<TimeAndSaleRecord> records_;
+  std::size_t nextRecord_;
+
+  TimeAndSaleTapeReplayStream(std::unique_ptr<TimeAndSaleTapeReader> reader, Consumer consumer)
+      : reader_{std::move(reader)},
+        consumer_{std::move(consumer)},
+        blockOrder_(reader_->getBlocks().size()),
+        nextBlock_{0},
+        records_{},
+        nextRecord_{0} {
+    const auto& blocks = reader_->getBlocks();
+
+    std::iota(blockOrder_.begin(), blockOrder_.end(), std::size_t{0});
+    std::stable_sort(blockOrder_.begin(), blockOrder_.end(),
+                     [&blocks](std::size_t a, std::size_t b) { return blocks[a].minTime < blocks[b].minTime; });
+  }
+
+  void loadNextBlock() {
+    records_.clear();
+    nextRecord_ = 0;
+
+    while (records_.empty() && nextBlock_ < blockOrder_.size()) {
+      // The corrupt block ends the tape
+      if (!reader_->forEachRecordInBlock(blockOrder_[nextBlock_++],
+                                         [this](const TimeAndSaleRecord& record) { records_.push_back(record); })) {
+        records_.clear();
+        nextBlock_ = blockOrder_.size();
+
+        return;
+      }
+    }
+
+    std::stable_sort(records_.begin(), records_.end(), [](const TimeAndSaleRecord& a, const TimeAndSaleRecord& b) {
+      return a.time != b.time ? a.time < b.time : a.index < b.index;
+    });
+  }
+
+ public:
+  // Maps the tape. Returns nullptr if it's not a complete tape of the supported version
+  static std::unique_ptr<TimeAndSaleTapeReplayStream> open(const std::string& path, Consumer consumer) {
+    auto reader = TimeAndSaleTapeReader::open(path);
+
+    if (!reader) {
+      return nullptr;
+    }
+
+    auto stream = std::unique_ptr<TimeAndSaleTapeReplayStream>(
+      new TimeAndSaleTapeReplayStream(std::move(reader), std::move(consumer)));
+
+    stream->loadNextBlock();
+
+    return stream;
+  }
+
+  [[nodiscard]] const TimeAndSaleTapeReader& getReader() const { return *reader_; }
+
+  [[nodiscard]] std::int64_t getNextTime() const override {
+    return nextRecord_ < records_.size() ? records_[nextRecord_].time : END;
+  }
+
+  void replayNext() override {
+    consumer_(*reader_, records_[nextRecord_++]);
+
+    if (nextRecord_ == records_.size()) {
+      loadNextBlock();
+    }
+  }
+};
+
+struct ReplaySymbol {
+  std::string symbol{};
+
+  // The relative cost of the replay of the symbol (e.g. the size of its tapes), the shards are balanced by it
+  std::uint64_t weight = 1;
+};
+
+struct ParallelReplayConfig {
+  // The number of the shards (the threads), 0 - the number of the cores
+  std::size_t shardsNumber = 0;
+
+  // 0 - the shards replay independently, every shard follows its own simulated clock. Otherwise the cross-symbol time
+  // barrier: the shards replay the records of the interval, wait for each other and the barrier handler is called, so
+  // the records of the different symbols are ordered up to the interval.
+  std::chrono::milliseconds barrierInterval{0};
+};
+
+struct ParallelReplayResult {
+  std::uint64_t recordsNumber = 0;
+  std::size_t streamsNumber = 0;
+
+  // The number of the passed barriers (0 - the shards are independent)
+  std::uint64_t barriersNumber = 0;
+  std::chrono::nanoseconds duration{};
+
+  // The numbers of the records replayed by the shards
+  std::vector<std::uint64_t> shardRecordsNumbers{};
+};
+
+// The offline replay of the captured tapes of many symbols (e.g. the full day through the books and the TnS consumers)
+// on all cores: the symbols are sharded by their weights, every shard thread creates the streams of its symbols (and
+// their independent detached books) and replays them merged by the time. The shard thread has its own SimulatedClock
+// (Clock::setThreadDefault) moved to the time of every record, so the synchronous books of the shard see the time of
+// the data.
+//
+// Usage:
+//   auto result = ParallelReplay::run(symbols, [&](std::size_t shard, const std::string& symbol) {
+//     auto book = std::shared_ptr<PriceLevelBook>(
+//       PriceLevelBook::createDetached(symbol, "", 10, {.lockPolicy = PriceLevelBookLockPolicy::NONE}));
+//     std::vector<std::unique_ptr<ReplayStream>> streams{};
+//
+//     streams.push_back(SnapshotCaptureReplayStream::open(directory + "/" + symbol + ".plbc",
+//       [book](const dxf_snapshot_data_ptr_t data, int isNew) { book->processSnapshotData(data, isNew); }));
+//
+//     return streams;
+//   });
+class ParallelReplay final {
+  struct Shard {
+    std::vector<std::string> symbols{};
+    std::vector<std::unique_ptr<ReplayStream>> streams{};
+    // The time of the next record of the shard (set before the barrier)
+    std::int64_t nextTime = ReplayStream::END;
+    std::size_t streamsNumber = 0;
+    std::uint64_t recordsNumber = 0;
+  };
+
+  using Queue = std::priority_queue<std::pair<std::int64_t, std::size_t>,
+                                    std::vector<std::pair<std::int64_t, std::size_t>>, std::greater<>>;
+
+  // Replays the records of the shard before the time
+  static void replayUntil(Shard& shard, Queue& queue, SimulatedClock& clock, std::int64_t time) {
+    while (!queue.empty() && queue.top().first < time) {
+      auto [recordTime, index] = queue.top();
+      auto& stream = *shard.streams[index];
+
+      queue.pop();
+      clock.advanceTo(recordTime);
+      stream.replayNext();
+      shard.recordsNumber++;
+
+      if (auto nextTime = stream.getNextTime(); nextTime != ReplayStream::END) {
+        queue.emplace(nextTime, index);
+      }
+    }
+
+    shard.nextTime = queue.empty() ? ReplayStream::END : queue.top().first;
+  }
+
+ public:
+  // Creates the streams of the symbol on the thread of its shard (e.g. opens its tapes and creates its books, so their
+  // memory is local to the shard). The nullptr streams are skipped.
+  using StreamFactory =
+    std::function<std::vector<std::unique_ptr<ReplayStream>>(std::size_t shard, const std::string& symbol)>;
+
+  // Called by one shard thread while the others wait at the barrier: all records before the time are replayed
+  using BarrierHandler = std::function<void(std::int64_t time)>;
+
+  // Assigns the symbols to the shards: the heaviest symbol to the least loaded shard
+  static std::vector<std::vector<std::string>> assignShards(std::vector<ReplaySymbol> symbols,
+                                                            std::size_t shardsNumber) {
+    std::vector<std::vector<std::string>> shards((std::max)(shardsNumber, std::size_t{1}));
+    std::vector<std::uint64_t> loads(shards.size());
+
+    std::stable_sort(symbols.begin(), symbols.end(),
+                     [](const ReplaySymbol& a, const ReplaySymbol& b) { return a.weight > b.weight; });
+
+    for (auto& symbol : symbols) {
+      auto shard = static_cast<std::size_t>(std::min_element(loads.begin(), loads.end()) - loads.begin());
+
+      loads[shard] += (std::max)(symbol.weight, std::uint64_t{1});
+      shards[shard].push_back(std::move(symbol.symbol));
+    }
+
+    return shards;
+  }
+
+  // Replays the symbols, returns when all streams end
+  static ParallelReplayResult run(const std::vector<ReplaySymbol>& symbols, const StreamFactory& factory,
+                                  const ParallelReplayConfig& config = {}, const BarrierHandler& onBarrier = {}) {
+    auto shardsNumber = config.shardsNumber != 0 ? config.shardsNumber
+                                                  : (std::max)(std::thread::hardware_concurrency(), 1U);
+
+    shardsNumber = (std::max)((std::min)(shardsNumber, symbols.size()), std::size_t{1});
+
+    auto assignment = assignShards(symbols, shardsNumber);
+    std::vector<Shard> shards(shardsNumber);
+    auto interval = static_cast<std::int64_t>(config.barrierInterval.count());
+    // The barrier state is changed by the completion only (all shards wait)
+    std::int64_t stepEnd = 0;
+    auto isDone = false;
+    auto isFirstStep = true;
+    std::uint64_t barriersNumber = 0;
+
+    for (std::size_t i = 0; i < shardsNumber; i++) {
+      shards[i].symbols = std::move(assignment[i]);
+    }
+
+    auto completion = [&]() noexcept {
+      if (!isFirstStep) {
+        barriersNumber++;
+
+        if (onBarrier) {
+          onBarrier(stepEnd);
+        }
+      }
+
+      isFirstStep = false;
+
+      auto nextTime = std::min_element(shards.begin(), shards.end(), [](const Shard& a, const Shard& b) {
+                        return a.nextTime < b.nextTime;
+                      })->nextTime;
+
+      if (nextTime == ReplayStream::END) {
+        isDone = true;
+
+        return;
+      }
+
+      // The empty intervals are skipped
+      stepEnd = nextTime - ((nextTime % interval) + interval) % interval + interval;
+    };
+    std::barrier barrier{static_cast<std::ptrdiff_t>(shardsNumber), completion};
+
+    auto runShard = [&](std::size_t index) {
+      ThreadPlacement::setCurrentThreadName("dxf-replay-" + std::to_string(index));
+
+      auto& shard = shards[index];
+      SimulatedClock clock{};
+      Queue queue{};
+
+      Clock::setThreadDefault(&clock);
+
+      for (const auto& symbol : shard.symbols) {
+        for (auto& stream : factory(index, symbol)) {
+          if (stream) {
+            shard.streams.push_back(std::move(stream));
+          }
+        }
+      }
+
+      shard.streamsNumber = shard.streams.size();
+
+      for (std::size_t i = 0; i < shard.streams.size(); i++) {
+        if (auto nextTime = shard.streams[i]->getNextTime(); nextTime != ReplayStream::END) {
+          queue.emplace(nextTime, i);
+        }
+      }
+
+      if (interval <= 0) {
+        replayUntil(shard, queue, clock, ReplayStream::END);
+      } else {
+        shard.nextTime = queue.empty() ? ReplayStream::END : queue.top().first;
+        barrier.arrive_and_wait();
+
+        while (!isDone) {
+          replayUntil(shard, queue, clock, stepEnd);
+          barrier.arrive_and_wait();
+        }
+      }
+
+      // The books of the streams are destroyed with the clock of the shard
+      shard.streams.clear();
+      Clock::setThreadDefault(nullptr);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads{};
+
+    for (std::size_t i = 0; i < shardsNumber; i++) {
+      threads.emplace_back(runShard, i);
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    ParallelReplayResult result{};
+
+    result.duration = std::chrono::steady_clock::now() - start;
+    result.barriersNumber = barriersNumber;
+
+    for (const auto& shard : shards) {
+      result.recordsNumber += shard.recordsNumber;
+      result.streamsNumber += shard.streamsNumber;
+      result.shardRecordsNumbers.push_back(shard.recordsNumber);
+    }
+
+    return result;
+  }
+};
+
+}  // namespace dxf
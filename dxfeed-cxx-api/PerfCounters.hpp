@@ -0,0 +1,324 @@
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_set>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace dxf {
+
+// The hardware counters of the threads: the cycles, the retired instructions, the last level cache misses and the
+// branch misses (the user space only, so they are counted with the default perf_event_paranoid of 2). The values
+// of the multiplexed counters are scaled by the time they ran.
+struct PerfCounterValues {
+  std::uint64_t cycles = 0;
+  std::uint64_t instructions = 0;
+  std::uint64_t cacheMisses = 0;
+  std::uint64_t branchMisses = 0;
+
+  // The instructions per cycle (0 - no cycles)
+  [[nodiscard]] double getIpc() const {
+    return cycles == 0 ? 0.0 : static_cast<double>(instructions) / static_cast<double>(cycles);
+  }
+
+  PerfCounterValues& operator+=(const PerfCounterValues& other) {
+    cycles += other.cycles;
+    instructions += other.instructions;
+    cacheMisses += other.cacheMisses;
+    branchMisses += other.branchMisses;
+
+    return *this;
+  }
+
+  // The values of the interval since the previous sample (the counters are monotonic)
+  [[nodiscard]] PerfCounterValues since(const PerfCounterValues& previous) const {
+    auto delta = [](std::uint64_t current, std::uint64_t previous) {
+      return current > previous ? current - previous : 0;
+    };
+
+    return {delta(cycles, previous.cycles), delta(instructions, previous.instructions),
+            delta(cacheMisses, previous.cacheMisses), delta(branchMisses, previous.branchMisses)};
+  }
+};
+
+// The hardware counters of the threads of the process by perf_event_open (Linux only): one group of the counters per
+// thread, the groups are summed by the scope of the thread. The library threads are the threads of the C API (the
+// socket threads parse the data and call the listeners), the processing threads are the C++ threads of the API (the
+// workers of the async books, the book shards, the executor, the dispatcher), they are told by their names ("dxf-...",
+// see ThreadPlacement::setCurrentThreadName).
+//
+// Usage:
+//   PerfCounters counters{};
+//
+//   counters.ignoreExistingThreads();  // The main thread
+//   ... create the connections and the books ...
+//   counters.attachNewThreads();       // Periodically, the threads may be created later
+//   auto library = counters.read(PerfCounters::Scope::LIBRARY);
+//
+// The counters of the exited threads keep their final values, so the sums stay monotonic. The counters are read by
+// the thread of the reports, the measured threads are not interrupted.
+class PerfCounters final {
+ public:
+  enum class Scope : std::size_t { LIBRARY = 0, PROCESSING = 1 };
+
+  static constexpr std::size_t SCOPES_NUMBER = 2;
+  static constexpr std::string_view PROCESSING_THREAD_PREFIX = "dxf-";
+
+ private:
+  static constexpr std::size_t COUNTERS_NUMBER = 4;
+
+  struct Group {
+    int threadId = 0;
+    Scope scope = Scope::LIBRARY;
+    // The leader (the cycles) is the first
+    std::array<int, COUNTERS_NUMBER> fds{-1, -1, -1, -1};
+  };
+
+  mutable std::mutex mutex_{};
+  std::vector<Group> groups_{};
+  // The attached and the ignored threads
+  std::unordered_set<int> knownThreads_{};
+  // The errno of the last failed perf_event_open (0 - none)
+  int lastError_ = 0;
+
+#ifdef __linux__
+  static int open(std::uint64_t config, int threadId, int groupFd) {
+    perf_event_attr attr{};
+
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = groupFd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, threadId, -1, groupFd, 0));
+  }
+
+  static void close(Group& group) {
+    for (auto& fd : group.fds) {
+      if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+  }
+
+  static PerfCounterValues read(const Group& group) {
+    // nr, time_enabled, time_running, the values
+    std::array<std::uint64_t, 3 + COUNTERS_NUMBER> data{};
+
+    if (::read(group.fds[0], data.data(), sizeof(data)) != static_cast<ssize_t>(sizeof(data)) ||
+        data[0] != COUNTERS_NUMBER || data[2] == 0) {
+      return {};
+    }
+
+    auto scale = [enabled = data[1], running = data[2]](std::uint64_t value) {
+      return running >= enabled ? value
+                                : static_cast<std::uint64_t>(static_cast<double>(value) *
+                                                             static_cast<double>(enabled) /
+                                                             static_cast<double>(running));
+    };
+
+    return {scale(data[3]), scale(data[4]), scale(data[5]), scale(data[6])};
+  }
+
+  // The ids of the threads of the process
+  static std::vector<int> getThreadIds() {
+    std::vector<int> result{};
+    std::error_code ec{};
+
+    for (const auto& entry : std::filesystem::directory_iterator("/proc/self/task", ec)) {
+      result.push_back(std::atoi(entry.path().filename().c_str()));
+    }
+
+    return result;
+  }
+
+  static std::string getThreadName(int threadId) {
+    std::ifstream comm{"/proc/self/task/" + std::to_string(threadId) + "/comm"};
+    std::string result{};
+
+    std::getline(comm, result);
+
+    return result;
+  }
+#endif
+
+  bool attachThreadImpl(int threadId, Scope scope) {
+#ifdef __linux__
+    if (!knownThreads_.insert(threadId).second) {
+      return false;
+    }
+
+    Group group{threadId, scope};
+    static constexpr std::array<std::uint64_t, COUNTERS_NUMBER> CONFIGS{
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+    for (std::size_t i = 0; i < COUNTERS_NUMBER; i++) {
+      group.fds[i] = open(CONFIGS[i], threadId, i == 0 ? -1 : group.fds[0]);
+
+      if (group.fds[i] == -1) {
+        lastError_ = errno;
+        close(group);
+
+        return false;
+      }
+    }
+
+    ioctl(group.fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group.fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    groups_.push_back(group);
+
+    return true;
+#else
+    (void)threadId;
+    (void)scope;
+
+    return false;
+#endif
+  }
+
+ public:
+  PerfCounters() = default;
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  ~PerfCounters() {
+#ifdef __linux__
+    for (auto& group : groups_) {
+      close(group);
+    }
+#endif
+  }
+
+  // Returns false if the counters can't be opened (not Linux, no PMU, e.g. in some VMs, or forbidden by
+  // perf_event_paranoid)
+  [[nodiscard]] static bool isSupported() {
+#ifdef __linux__
+    auto fd = open(PERF_COUNT_HW_CPU_CYCLES, 0, -1);
+
+    if (fd == -1) {
+      return false;
+    }
+
+    ::close(fd);
+
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // The existing threads are not counted (e.g. the main thread and the thread of the reports)
+  void ignoreExistingThreads() {
+#ifdef __linux__
+    std::lock_guard lock{mutex_};
+
+    for (auto threadId : getThreadIds()) {
+      knownThreads_.insert(threadId);
+    }
+#endif
+  }
+
+  // The current thread is not counted
+  void ignoreCurrentThread() {
+#ifdef __linux__
+    std::lock_guard lock{mutex_};
+
+    knownThreads_.insert(static_cast<int>(syscall(SYS_gettid)));
+#endif
+  }
+
+  // Counts the current thread in the scope. Returns false if it's already known or the counters can't be opened.
+  bool attachCurrentThread(Scope scope) {
+#ifdef __linux__
+    std::lock_guard lock{mutex_};
+
+    return attachThreadImpl(static_cast<int>(syscall(SYS_gettid)), scope);
+#else
+    (void)scope;
+
+    return false;
+#endif
+  }
+
+  // Counts the threads created since the previous call: the threads named "dxf-..." are the processing ones, the
+  // others are the library ones. Returns the number of the attached threads.
+  std::size_t attachNewThreads() {
+    std::size_t result = 0;
+
+#ifdef __linux__
+    std::lock_guard lock{mutex_};
+
+    for (auto threadId : getThreadIds()) {
+      if (knownThreads_.contains(threadId)) {
+        continue;
+      }
+
+      auto scope =
+        getThreadName(threadId).starts_with(PROCESSING_THREAD_PREFIX) ? Scope::PROCESSING : Scope::LIBRARY;
+
+      result += attachThreadImpl(threadId, scope) ? 1 : 0;
+    }
+#endif
+
+    return result;
+  }
+
+  // The sums of the counters of the threads of the scope since they are attached
+  [[nodiscard]] PerfCounterValues read(Scope scope) const {
+    PerfCounterValues result{};
+
+#ifdef __linux__
+    std::lock_guard lock{mutex_};
+
+    for (const auto& group : groups_) {
+      if (group.scope == scope) {
+        result += read(group);
+      }
+    }
+#else
+    (void)scope;
+#endif
+
+    return result;
+  }
+
+  [[nodiscard]] std::size_t getThreadsNumber(Scope scope) const {
+    std::lock_guard lock{mutex_};
+    std::size_t result = 0;
+
+    for (const auto& group : groups_) {
+      result += group.scope == scope ? 1 : 0;
+    }
+
+    return result;
+  }
+
+  // The errno of the last failed open of the counters (0 - none)
+  [[nodiscard]] int getLastError() const {
+    std::lock_guard lock{mutex_};
+
+    return lastError_;
+  }
+};
+
+}  // namespace dxf
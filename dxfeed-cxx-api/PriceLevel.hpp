@@ -0,0 +1,167 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace dxf {
+
+// The data of the live order that is needed to remove its contribution from the price level (32 bytes). The time of
+// the removal is taken from the removing record, so the order time is not kept.
+struct OrderData {
+  dxf_long_t index = 0;
+  double price = std::numeric_limits<double>::quiet_NaN();
+  double size = std::numeric_limits<double>::quiet_NaN();
+  dxf_order_side_t side = dxf_osd_undefined;
+};
+
+// The fields of the order record that are used by the books (40 bytes instead of the whole dxf_order_t). The queued
+// chunks of the async books keep them, so the handoff to the worker copies only them. The fields are named as in the
+// dxf_order_t, so the books process both kinds of the records.
+struct OrderRecord {
+  dxf_long_t index = 0;
+  dxf_long_t time = 0;
+  double price = std::numeric_limits<double>::quiet_NaN();
+  double size = std::numeric_limits<double>::quiet_NaN();
+  dxf_event_flags_t event_flags = 0;
+  dxf_order_side_t side = dxf_osd_undefined;
+
+  OrderRecord() = default;
+
+  // Implicit, so the records are assigned to the vectors of the chunks as they are
+  OrderRecord(const dxf_order_t& order)
+      : index{order.index},
+        time{order.time},
+        price{order.price},
+        size{order.size},
+        event_flags{order.event_flags},
+        side{order.side} {}
+};
+
+struct PriceLevel {
+  double price = std::numeric_limits<double>::quiet_NaN();
+  double size = std::numeric_limits<double>::quiet_NaN();
+  std::int64_t time = 0;
+
+  friend bool operator<(const PriceLevel& a, const PriceLevel& b) {
+    if (std::isnan(b.price)) return true;
+    if (std::isnan(a.price)) return false;
+
+    return a.price < b.price;
+  }
+};
+
+// The price level with the price in ticks (the tick price mode of the PriceLevelBook)
+struct TickPriceLevel {
+  std::int64_t price = 0;
+  double size = std::numeric_limits<double>::quiet_NaN();
+  std::int64_t time = 0;
+};
+
+template <typename Level>
+struct BasicPriceLevelChanges {
+  std::vector<Level> asks{};
+  std::vector<Level> bids{};
+};
+
+using PriceLevelChanges = BasicPriceLevelChanges<PriceLevel>;
+
+struct PriceLevelChangesSet {
+  PriceLevelChanges additions{};
+  PriceLevelChanges updates{};
+  PriceLevelChanges removals{};
+};
+
+// The best levels of both sides (the NaN price - the side is empty)
+struct TopOfBook {
+  PriceLevel ask{};
+  PriceLevel bid{};
+
+  // The prices and the sizes of the best levels are the same (the times are not compared)
+  [[nodiscard]] bool isSameAs(const TopOfBook& other) const {
+    auto isSame = [](double a, double b) { return a == b || (std::isnan(a) && std::isnan(b)); };
+
+    return isSame(ask.price, other.ask.price) && isSame(ask.size, other.ask.size) &&
+           isSame(bid.price, other.bid.price) && isSame(bid.size, other.bid.size);
+  }
+};
+
+// Orders the price levels of one book side from the best price to the worst one. NaN prices are always the worst.
+struct AskSide {
+  static bool isBetter(double price1, double price2) {
+    if (std::isnan(price2)) return !std::isnan(price1);
+    if (std::isnan(price1)) return false;
+
+    return price1 < price2;
+  }
+
+  static bool isBetter(std::int64_t price1, std::int64_t price2) { return price1 < price2; }
+
+  template <typename Level>
+  bool operator()(const Level& a, const Level& b) const {
+    return isBetter(a.price, b.price);
+  }
+};
+
+struct BidSide {
+  static bool isBetter(double price1, double price2) {
+    if (std::isnan(price2)) return !std::isnan(price1);
+    if (std::isnan(price1)) return false;
+
+    return price1 > price2;
+  }
+
+  static bool isBetter(std::int64_t price1, std::int64_t price2) { return price1 > price2; }
+
+  template <typename Level>
+  bool operator()(const Level& a, const Level& b) const {
+    return isBetter(a.price, b.price);
+  }
+};
+
+template <typename Level>
+bool isZeroPriceLevel(const Level& pl) {
+  return std::abs(pl.size) < std::numeric_limits<double>::epsilon();
+}
+
+inline bool areEqualPrices(double price1, double price2) {
+  return std::abs(price1 - price2) < std::numeric_limits<double>::epsilon();
+}
+
+inline bool areEqualPrices(std::int64_t price1, std::int64_t price2) { return price1 == price2; }
+
+// The book keeps the prices as is.
+struct DoublePriceModel {
+  using Price = double;
+  using Level = PriceLevel;
+
+  [[nodiscard]] Price toPrice(double price) const { return price; }
+
+  [[nodiscard]] const PriceLevel& toPriceLevel(const Level& level) const { return level; }
+};
+
+// The book keeps the prices as the integer number of ticks. The keys are exact, and the comparisons have no NaN
+// checks. The double prices are produced only for the callbacks. Not a finite price is mapped to 0 ticks.
+struct TickPriceModel {
+  using Price = std::int64_t;
+  using Level = TickPriceLevel;
+
+  double tickSize = 0.01;
+
+  [[nodiscard]] Price toPrice(double price) const {
+    if (!std::isfinite(price)) {
+      return 0;
+    }
+
+    return static_cast<Price>(std::llround(price / tickSize));
+  }
+
+  [[nodiscard]] PriceLevel toPriceLevel(const Level& level) const {
+    return {static_cast<double>(level.price) * tickSize, level.size, level.time};
+  }
+};
+
+}  // namespace dxf
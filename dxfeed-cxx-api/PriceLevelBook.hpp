@@ -1,425 +1,1678 @@
 #pragma once
 
 #include <DXFeed.h>
-#include <fmt/format.h>
-
-#include <algorithm>
-#include <boost/multi_index/identity.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/random_access_index.hpp>
-#include <boost/multi_index_container.hpp>
+
+#include <array>
+#include <atomic>
 #include <cassert>
-#include <cmath>
-#include <deque>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
 #include <functional>
-#include <limits>
 #include <memory>
 #include <mutex>
-#include <set>
 #include <string>
+#include <thread>
 #include <utility>
+#include <variant>
 #include <vector>
 
-#include "StringConverter.hpp"
+#include "Backpressure.hpp"
+#include "Clock.hpp"
+#include "ConnectionMemory.hpp"
+#include "GroupedPriceLevels.hpp"
+#include "IndexedEventSource.hpp"
+#include "LatencyStats.hpp"
+#include "Metrics.hpp"
+#include "PriceLevel.hpp"
+#include "PriceLevelConflator.hpp"
+#include "PriceLevelBookAnalytics.hpp"
+#include "PriceLevelBookCheckpoint.hpp"
+#include "PriceLevelBookEngine.hpp"
+#include "PriceLevelBookHistory.hpp"
+#include "PriceLevelBookTape.hpp"
+#include "PriceLevelBookIntegrityChecker.hpp"
+#include "PriceLevelBookListener.hpp"
+#include "PriceLevelBookView.hpp"
+#include "PriceLevelLadder.hpp"
+#include "PublishedPriceLevels.hpp"
+#include "SpscRing.hpp"
+#include "SymbolTable.hpp"
+#include "ThreadPlacement.hpp"
+#include "Trace.hpp"
+#include "TraceSpans.hpp"
+#include "WaitStrategy.hpp"
 
 namespace dxf {
 
-struct OrderData {
-  dxf_long_t index = 0;
-  double price = std::numeric_limits<double>::quiet_NaN();
-  double size = std::numeric_limits<double>::quiet_NaN();
-  dxf_long_t time = 0;
-  dxf_order_side_t side = dxf_osd_undefined;
+enum class PriceLevelStorage : int {
+  // boost::multi_index_container with the random access and the ordered indexes
+  MULTI_INDEX = 0,
+  // The sorted vector with the best price at the back
+  FLAT = 1,
+  // The array of the visible levels with the compile-time depth (5, 10 or 20 levels) and the sorted vector of the rest.
+  // Other numbers of levels use FLAT.
+  FIXED_DEPTH = 2
 };
 
-struct PriceLevel {
-  double price = std::numeric_limits<double>::quiet_NaN();
-  double size = std::numeric_limits<double>::quiet_NaN();
-  std::int64_t time = 0;
+// The synchronization of the book (PriceLevelBookConfig::lockPolicy)
+enum class PriceLevelBookLockPolicy : int {
+  // The mutex guards the processing, the handlers and the reads of the book
+  MUTEX = 0,
+  // No lock: all calls of the book are made from one thread (or serialized by the application)
+  NONE = 1
+};
 
-  friend bool operator<(const PriceLevel& a, const PriceLevel& b) {
-    if (std::isnan(b.price)) return true;
-    if (std::isnan(a.price)) return false;
+// The mutex of the book that is locked only by the MUTEX policy (the predictable branch instead of the atomic
+// operations of the uncontended mutex for the books of one thread)
+class PriceLevelBookMutex final {
+  std::mutex mutex_;
+  bool isEnabled_;
 
-    return a.price < b.price;
+ public:
+  explicit PriceLevelBookMutex(PriceLevelBookLockPolicy policy = PriceLevelBookLockPolicy::MUTEX)
+      : mutex_{}, isEnabled_{policy == PriceLevelBookLockPolicy::MUTEX} {}
+
+  void lock() {
+    if (isEnabled_) {
+      mutex_.lock();
+    }
+  }
+
+  bool try_lock() { return !isEnabled_ || mutex_.try_lock(); }
+
+  void unlock() {
+    if (isEnabled_) {
+      mutex_.unlock();
+    }
   }
 };
 
-struct PriceLevelChanges {
-  std::vector<PriceLevel> asks{};
-  std::vector<PriceLevel> bids{};
+class PriceLevelBook;
+
+// The managed books whose new snapshots are queued and not applied yet (e.g. all books after the reconnect), so the
+// idle shards of the PriceLevelBookManager help their shards to rebuild them. Guarded by the mutex.
+struct PriceLevelBookRebuilds {
+  std::mutex mutex{};
+  std::vector<PriceLevelBook*> books{};
+  // The signals of the shards, they are notified when the book is added
+  std::vector<WorkSignal*> signals{};
 };
 
-struct PriceLevelChangesSet {
-  PriceLevelChanges additions{};
-  PriceLevelChanges updates{};
-  PriceLevelChanges removals{};
+struct PriceLevelBookConfig {
+  // The default is the multi_index ladder, the FLAT and FIXED_DEPTH ladders are opt-in
+  PriceLevelStorage storage = PriceLevelStorage::MULTI_INDEX;
+
+  // The price tick size. If it is greater than 0, the book keeps the prices as the integer number of ticks.
+  // The order prices are rounded to the nearest tick.
+  double tickSize = 0.0;
+
+  // If true, the snapshot listener only copies the records to the queue, and the dedicated worker thread of the book
+  // applies them and calls the handlers. Otherwise, everything is done on the C-API listener thread.
+  bool async = false;
+
+  // The capacity of the queue of the snapshot data chunks in the async mode (rounded up to the power of 2). If the
+  // queue is full, the listener thread acts by the backpressurePolicy.
+  std::size_t queueDepth = 1024;
+
+  // The async mode only. What the listener thread does when the queue is full (see getBackpressureStats):
+  // BLOCK - waits for the worker. CONFLATE - merges the chunks into one overflow chunk that the worker applies as one
+  // transaction after the queue (the new snapshot replaces it), so the listener never waits. DROP_OLDEST is the same
+  // as CONFLATE: the records of the book can't be skipped. DISCONNECT - stops the book: the queued data is applied, the
+  // later data is dropped, and the application recreates the book.
+  BackpressurePolicy backpressurePolicy = BackpressurePolicy::BLOCK;
+
+  // The async mode only. If true, the transactions that arrive while the handlers are busy are folded into one net
+  // changes set, and the handlers are called once for all of them.
+  bool conflate = false;
+
+  // The minimum interval between the conflated deliveries. 0 - deliver as soon as the queue is drained.
+  std::chrono::microseconds conflationWindow{0};
+
+  // The expected number of the live orders of the book. The order index is allocated for them at the book creation.
+  std::size_t ordersNumberHint = 0;
+
+  // The number of the best levels of every side that are published for the lock-free reading from the other threads
+  // (see PriceLevelBook::readPublishedLevels). 0 - the levels are not published.
+  std::size_t publishedLevelsNumber = 0;
+
+  // If true, the full depth of the book (all levels of the ladders) is published after every transaction for the
+  // lock-free reading from the other threads (see PriceLevelBook::readFullDepth): the changed blocks of the levels are
+  // copied, the replaced ones are reused when no reader holds them (see FullDepthPriceLevels).
+  bool publishFullDepth = false;
+
+  // The bucket sizes of the grouped views of the book (see GroupedPriceLevels), e.g. {0.25, 1.0} for the depth charts:
+  // every view is changed by the level deltas of the transactions (all levels, not limited by the price band) and its
+  // bucket changes are passed to the OnGroupedChange handler with the changes of the visible levels.
+  std::vector<double> groupBucketSizes{};
+
+  // The memory of the history of the visible levels of the book (bytes, see PriceLevelBook::getBookAt): the deltas of
+  // every transaction and the keyframes after every historyKeyframeInterval deltas are kept in the ring, the oldest
+  // ones are evicted. The times are taken from Clock::getDefault(). 0 - the history is disabled.
+  std::size_t historyMemoryBudget = 0;
+
+  // The maximum number of the deltas the restore of the book at some time applies to the keyframe
+  std::size_t historyKeyframeInterval = 64;
+
+  // If set, the deltas and the new books of the visible levels are archived to the book tape in the directory (see
+  // PriceLevelBookTape::getFileName, the existing file is replaced). The tape is encoded and written by its own thread,
+  // the book only copies the changes to its queue. The times are taken from Clock::getDefault().
+  std::string tapeDirectory{};
+
+  // The time of the block of the tape that starts with the keyframe (ms)
+  std::int64_t tapeKeyframeInterval = PriceLevelBookTape::DEFAULT_KEYFRAME_INTERVAL;
+
+  // The depth of the incremental analytics of the book (see PriceLevelBook::readAnalytics): the best levels, the sums
+  // of the sizes within the depth of every side, the spread, the microprice and the imbalance. They are changed in O(1)
+  // by every changed level during the apply and published for the lock-free reading. 0 - the analytics are disabled.
+  std::size_t analyticsDepth = 0;
+
+  // The price band of the ladders (see PriceLevelBand), e.g. for the illiquid instruments with thousands of the far
+  // levels: only the levels whose distance to the best price of their side is not greater than bandTicks ticks (with
+  // tickSize > 0) plus bandPercent percent of the best price are kept in the ladders, the rest of the levels are kept
+  // in the contiguous cold store and are promoted when the best price moves towards them. So the work of the
+  // transaction depends on the band and not on the whole depth. The visible levels, the full depth and the analytics
+  // are limited by the band, the checkpoints and the integrity checks have all levels. 0, 0 - no band.
+  std::size_t bandTicks = 0;
+  double bandPercent = 0.0;
+
+  // If true, the chunks whose last record has the TX_PENDING flag are accumulated, and the transaction is applied
+  // (and the handlers are called) once, when its last chunk arrives. The chunks of the new snapshot are accumulated
+  // anyway. Off by default: the handlers are called for every chunk.
+  bool batchPendingTransactions = false;
+
+  // Is called with every snapshot data chunk on the C-API listener thread before the processing (e.g. to capture the
+  // data with SnapshotDataWriter).
+  std::function<void(const dxf_snapshot_data_ptr_t, int)> onSnapshotData{};
+
+  // NONE - the book isn't locked: the processing, the handler setters and the reads are made from one thread, e.g. the
+  // detached book of the offline replay (see ParallelReplay) or the book whose every call is made by the C-API listener
+  // thread. The books with the other threads (the async and the managed ones) are always locked.
+  PriceLevelBookLockPolicy lockPolicy = PriceLevelBookLockPolicy::MUTEX;
+
+  // The async mode only. The placement of the worker thread of the book (the failure is ignored) and the wait of the
+  // worker for the empty queue (ThreadPlacement::spin, yield and adaptiveSpin, see getWorkerWaitStats).
+  ThreadPlacement workerPlacement{};
+
+  // The books of the PriceLevelBookManager only. The shard applies the queued data of its books in the descending order
+  // of the priorities, so after the reconnect (when the snapshots of all books are resent at once) the books of the
+  // higher priority are recovered first (see PriceLevelBookManager::setPriority).
+  int priority = 0;
+
+  // Is called once with isReady = false on the first snapshot data chunk of the book (on the C-API listener thread),
+  // and once with isReady = true when the first snapshot is applied (on the thread that applies it, before the
+  // onNewBook handler), e.g. to track the startup readiness (see ReadinessTracker::trackBooks).
+  std::function<void(const PriceLevelBook& book, bool isReady)> onReadiness{};
+
+  // If set, the book restores its checkpoint from the directory (see PriceLevelBook::writeCheckpoint) at the creation,
+  // before the subscription. The restored book serves the checkpointed levels (copyBook, the published levels and the
+  // analytics) marked stale (see PriceLevelBook::isStale) until the first fresh snapshot replaces them, so the restart
+  // doesn't wait for the full snapshot. The handlers are called with the fresh snapshot only.
+  std::string checkpointDirectory{};
+
+  // If set, the book hands off the copies of its state to the checker at the sampled transaction boundaries, and the
+  // checker compares the incremental ladders with the ones rebuilt from the orders (see
+  // PriceLevelBookIntegrityChecker). The checker must outlive the book.
+  PriceLevelBookIntegrityChecker* integrityChecker = nullptr;
+
+  // The async mode only. The memory account of the connection of the book (see ConnectionMemoryAccount): while it's
+  // over its quota with the CONFLATE action, the chunks are merged into the overflow chunk (as the CONFLATE policy)
+  // until the queue is drained. The account must outlive the book.
+  ConnectionMemoryAccount* memoryAccount = nullptr;
 };
 
-namespace bmi = boost::multi_index;
+// The state of the book in the diagnostics report (see PriceLevelBook::getDiagnostics)
+struct PriceLevelBookDiagnostics {
+  std::string symbol{};
+  std::string source{};
+  int priority = 0;
+  bool isReady = false;
+  bool isStale = false;
+  std::size_t ordersNumber = 0;
+  std::size_t memoryUsage = 0;
+  std::uint64_t snapshotDataNumber = 0;
+  std::uint64_t recordsNumber = 0;
+  std::uint64_t resyncsNumber = 0;
+  // The queue of the async mode (the depth, the overflows, the drops)
+  BackpressureStats backpressure{};
+};
 
-using PriceLevelContainer = bmi::multi_index_container<
-  PriceLevel,
-  bmi::indexed_by<bmi::random_access<>, bmi::ordered_unique<bmi::member<PriceLevel, double, &PriceLevel::price>>>>;
+class PriceLevelBookManager;
 
 class PriceLevelBook final {
+  friend class PriceLevelBookManager;
+
+  // The worker polls the queue at least this often while it holds the conflated changes (the real clock).
+  static constexpr std::chrono::steady_clock::duration MAX_CONFLATION_SLEEP = std::chrono::microseconds{100};
+
+  using Engine = std::variant<PriceLevelBookEngine<MultiIndexPriceLevelLadder>,
+                              PriceLevelBookEngine<FlatPriceLevelLadder>,
+                              PriceLevelBookEngine<FixedDepthPriceLevelLadder<5>::Type>,
+                              PriceLevelBookEngine<FixedDepthPriceLevelLadder<10>::Type>,
+                              PriceLevelBookEngine<FixedDepthPriceLevelLadder<20>::Type>,
+                              PriceLevelBookEngine<MultiIndexPriceLevelLadder, TickPriceModel>,
+                              PriceLevelBookEngine<FlatPriceLevelLadder, TickPriceModel>,
+                              PriceLevelBookEngine<FixedDepthPriceLevelLadder<5>::Type, TickPriceModel>,
+                              PriceLevelBookEngine<FixedDepthPriceLevelLadder<10>::Type, TickPriceModel>,
+                              PriceLevelBookEngine<FixedDepthPriceLevelLadder<20>::Type, TickPriceModel>>;
+
+  // The copy of the snapshot data chunk that is passed to the worker thread. The string fields of the orders are not
+  // used by the engine and are not valid on the worker thread.
+  struct SnapshotDataChunk {
+    // The used fields only, so the handoff copies a fraction of the records
+    std::vector<OrderRecord> orders{};
+    bool newSnapshot = false;
+    bool stop = false;
+    LatencyStats::TimePoint receiveTime{};
+    SpanFlow flow{};
+  };
+
+  // The connection of the snapshot (nullptr - the detached book), so the snapshot can be created again (see resync)
+  dxf_connection_t connection_;
   dxf_snapshot_t snapshot_;
   std::string symbol_;
   std::string source_;
+  IndexedEventSource eventSource_;
   std::size_t levelsNumber_;
-  PriceLevelContainer asks_;
-  PriceLevelContainer bids_;
-  std::unordered_map<dxf_long_t, OrderData> orderDataSnapshot_;
+  Engine engine_;
   bool isValid_;
-  std::mutex mutex_;
+  PriceLevelBookMutex mutex_;
+  // Guards the snapshot against the concurrent resyncs and the close
+  std::mutex snapshotMutex_;
+  std::atomic<std::uint64_t> resyncsNumber_;
+  std::unique_ptr<SpscRing<SnapshotDataChunk>> queue_;
+  BackpressurePolicy backpressurePolicy_;
+  BackpressureCounters backpressure_;
+  // The CONFLATE policy: the chunks that haven't fit the queue, merged. The producers of the queue (the listener and
+  // the worker that moves the overflow chunk to the drained queue) hold the mutex.
+  std::mutex overflowMutex_;
+  SnapshotDataChunk overflowChunk_;
+  std::atomic<bool> hasOverflow_;
+  std::thread worker_;
+  // The signal of the manager shard that processes the queue instead of the own worker (the book is managed)
+  WorkSignal* workSignal_;
+  // The managed book: the rebuilds of the manager, the shard that processes the queue (the own one or the helping one,
+  // so the queue has one consumer at a time), the helping shard uses the book, the new snapshot is queued (the hint,
+  // it's cleared when the new book is applied) and the book is in the rebuilds (under their mutex). The queue of the
+  // managed book is claimed until the manager starts the book, so its data isn't processed before the book is set up
+  // (see PriceLevelBookManager::setOnBookCreated).
+  PriceLevelBookRebuilds* rebuilds_;
+  std::atomic<bool> isConsumed_;
+  std::atomic<bool> isHelped_;
+  std::atomic<bool> isRebuilding_;
+  bool isListed_;
+  // The wait of the worker for the empty queue (ThreadPlacement::spin, yield and adaptiveSpin)
+  WaitStrategy workerWait_;
+  bool conflate_;
+  std::chrono::steady_clock::duration conflationWindow_;
+  // The clock of the conflation windows (the default one at the creation) and the wake-up of the worker that waits for
+  // the window on the simulated clock: the listener notifies it after the queued chunk, the clock after the advance
+  Clock& conflationClock_;
+  WorkSignal conflationSignal_;
+  PriceLevelChangesConflator conflator_;
+  std::atomic<std::uint64_t> conflatedTransactionsNumber_;
+  // The managed book with the batch handler of the manager (set before the queue is released by the manager): the
+  // delivered changes are folded until the shard takes them after the processing (see takeBatchChanges)
+  bool isBatched_;
+  bool isBatchNewBook_;
+  PriceLevelChangesConflator batchChanges_;
+  // The snapshot data chunks and the order records received by the listener (see collectMetrics)
+  std::atomic<std::uint64_t> snapshotDataNumber_;
+  std::atomic<std::uint64_t> recordsNumber_;
+  std::unique_ptr<PublishedPriceLevels> publishedLevels_;
+  std::unique_ptr<PublishedBookAnalytics> publishedAnalytics_;
+  std::unique_ptr<FullDepthPriceLevels> fullDepthLevels_;
+  std::vector<GroupedPriceLevels> groupedLevels_;
+  std::unique_ptr<PriceLevelBookHistory> history_;
+  std::unique_ptr<PriceLevelBookTapeWriter> tape_;
+  std::function<void(const dxf_snapshot_data_ptr_t, int)> onSnapshotData_;
+  std::function<void(const PriceLevelBook&, bool)> onReadiness_;
+  // The first snapshot data chunk is received (on the listener thread) and the first snapshot is applied
+  std::atomic<bool> hasFirstData_;
+  std::atomic<bool> isReady_;
+  // The levels are restored from the checkpoint and not replaced by the fresh snapshot yet
+  std::atomic<bool> isStale_;
+  // The time the restored checkpoint was written (ms since the epoch, 0 - not restored)
+  std::int64_t checkpointTime_;
+  bool batchPendingTransactions_;
+  // Is changed by the manager under the mutex of the shard
+  std::atomic<int> priority_;
+  // The pending transaction that is being accumulated has started with the new snapshot
+  bool snapshotPending_;
+  PriceLevelBookIntegrityChecker* integrityChecker_;
+  ConnectionMemoryAccount* memoryAccount_;
+  // The transactions applied by the book and since its last integrity sample (under the mutex)
+  std::uint64_t transactionsNumber_;
+  std::uint64_t transactionsSinceSample_;
+  std::chrono::steady_clock::time_point lastSampleTime_;
 
   std::function<void(const PriceLevelChanges&)> onNewBook_;
   std::function<void(const PriceLevelChanges&)> onBookUpdate_;
+  std::function<void(const PriceLevelBookView&)> onBookUpdateView_;
   std::function<void(const PriceLevelChangesSet&)> onIncrementalChange_;
+  std::function<void(const TopOfBook&)> onTopOfBookChange_;
+  std::function<void(const GroupedPriceLevels&, const PriceLevelChangesSet&)> onGroupedChange_;
+  PriceLevelBookListenerRef listener_;
+  // The best levels of the last top of book delivery and whether the applied transactions have changed the best levels
+  // since it (under the mutex)
+  TopOfBook deliveredTopOfBook_;
+  bool isTopOfBookPending_;
+  // Is written under the mutex
+  LatencyStats latencyStats_;
+  // The sampled transaction that is being processed (under the mutex)
+  SpanFlow spanFlow_;
+
+  template <typename PriceModel>
+  static Engine createEngine(const PriceLevelBookConfig& config, std::size_t levelsNumber, PriceModel priceModel) {
+    if (config.storage == PriceLevelStorage::MULTI_INDEX) {
+      return Engine{std::in_place_type<PriceLevelBookEngine<MultiIndexPriceLevelLadder, PriceModel>>, levelsNumber,
+                    priceModel};
+    }
 
-  static bool isZeroPriceLevel(const PriceLevel& pl) {
-    return std::abs(pl.size) < std::numeric_limits<double>::epsilon();
-  };
+    if (config.storage == PriceLevelStorage::FIXED_DEPTH) {
+      switch (levelsNumber) {
+        case 5:
+          return Engine{std::in_place_type<PriceLevelBookEngine<FixedDepthPriceLevelLadder<5>::Type, PriceModel>>,
+                        levelsNumber, priceModel};
+        case 10:
+          return Engine{std::in_place_type<PriceLevelBookEngine<FixedDepthPriceLevelLadder<10>::Type, PriceModel>>,
+                        levelsNumber, priceModel};
+        case 20:
+          return Engine{std::in_place_type<PriceLevelBookEngine<FixedDepthPriceLevelLadder<20>::Type, PriceModel>>,
+                        levelsNumber, priceModel};
+        default:
+          break;
+      }
+    }
 
-  static bool areEqualPrices(double price1, double price2) {
-    return std::abs(price1 - price2) < std::numeric_limits<double>::epsilon();
+    return Engine{std::in_place_type<PriceLevelBookEngine<FlatPriceLevelLadder, PriceModel>>, levelsNumber,
+                  priceModel};
   }
 
-  PriceLevelBook(std::string symbol, std::string source, std::size_t levelsNumber = 0)
-      : snapshot_{nullptr},
+  static Engine createEngine(const PriceLevelBookConfig& config, std::size_t levelsNumber) {
+    if (config.tickSize > 0.0) {
+      return createEngine(config, levelsNumber, TickPriceModel{config.tickSize});
+    }
+
+    return createEngine(config, levelsNumber, DoublePriceModel{});
+  }
+
+  PriceLevelBook(std::string symbol, std::string source, std::size_t levelsNumber, const PriceLevelBookConfig& config,
+                 WorkSignal* workSignal, PriceLevelBookRebuilds* rebuilds)
+      : connection_{nullptr},
+        snapshot_{nullptr},
         symbol_{std::move(symbol)},
         source_{std::move(source)},
+        eventSource_{IndexedEventSource::valueOf(source_)},
         levelsNumber_{levelsNumber},
-        asks_{},
-        bids_{},
-        orderDataSnapshot_{},
+        engine_{createEngine(config, levelsNumber)},
         isValid_{false},
-        mutex_{} {}
+        mutex_{config.async || workSignal != nullptr ? PriceLevelBookLockPolicy::MUTEX : config.lockPolicy},
+        snapshotMutex_{},
+        resyncsNumber_{0},
+        queue_{config.async || workSignal != nullptr ? std::make_unique<SpscRing<SnapshotDataChunk>>(config.queueDepth)
+                                                     : nullptr},
+        backpressurePolicy_{config.backpressurePolicy == BackpressurePolicy::DROP_OLDEST ? BackpressurePolicy::CONFLATE
+                                                                                         : config.backpressurePolicy},
+        backpressure_{},
+        overflowMutex_{},
+        overflowChunk_{},
+        hasOverflow_{false},
+        worker_{},
+        workSignal_{workSignal},
+        rebuilds_{rebuilds},
+        isConsumed_{workSignal != nullptr},
+        isHelped_{false},
+        isRebuilding_{false},
+        isListed_{false},
+        workerWait_{config.workerPlacement},
+        conflate_{(config.async || workSignal != nullptr) && config.conflate},
+        conflationWindow_{config.conflationWindow},
+        conflationClock_{Clock::getDefault()},
+        conflationSignal_{},
+        conflator_{},
+        conflatedTransactionsNumber_{0},
+        isBatched_{false},
+        isBatchNewBook_{false},
+        batchChanges_{},
+        snapshotDataNumber_{0},
+        recordsNumber_{0},
+        publishedLevels_{config.publishedLevelsNumber != 0
+                           ? std::make_unique<PublishedPriceLevels>(config.publishedLevelsNumber)
+                           : nullptr},
+        publishedAnalytics_{config.analyticsDepth != 0 ? std::make_unique<PublishedBookAnalytics>() : nullptr},
+        fullDepthLevels_{config.publishFullDepth ? std::make_unique<FullDepthPriceLevels>() : nullptr},
+        groupedLevels_{config.groupBucketSizes.begin(), config.groupBucketSizes.end()},
+        history_{config.historyMemoryBudget != 0
+                   ? std::make_unique<PriceLevelBookHistory>(config.historyMemoryBudget, config.historyKeyframeInterval)
+                   : nullptr},
+        tape_{!config.tapeDirectory.empty()
+                ? PriceLevelBookTapeWriter::open(
+                    (std::filesystem::path(config.tapeDirectory) / PriceLevelBookTape::getFileName(symbol_, source_))
+                      .string(),
+                    symbol_, source_, config.tickSize, config.tapeKeyframeInterval)
+                : nullptr},
+        onSnapshotData_{config.onSnapshotData},
+        onReadiness_{config.onReadiness},
+        hasFirstData_{false},
+        isReady_{false},
+        isStale_{false},
+        checkpointTime_{0},
+        batchPendingTransactions_{config.batchPendingTransactions},
+        priority_{config.priority},
+        snapshotPending_{false},
+        integrityChecker_{config.integrityChecker},
+        memoryAccount_{config.memoryAccount},
+        transactionsNumber_{0},
+        transactionsSinceSample_{0},
+        lastSampleTime_{Clock::getDefault().now()},
+        listener_{},
+        deliveredTopOfBook_{},
+        isTopOfBookPending_{false},
+        latencyStats_{},
+        spanFlow_{} {
+    if (config.ordersNumberHint != 0) {
+      std::visit([&config](auto& engine) { engine.reserveOrders(config.ordersNumberHint); }, engine_);
+    }
 
-  // Process the tx\snapshot data, converts it to PL changes. Also, changes the orderDataSnapshot_
-  PriceLevelChanges convertToUpdates(const dxf_snapshot_data_ptr_t snapshotData) {
-    assert(snapshotData->records_count != 0);
-    assert(snapshotData->event_type != dx_eid_order);
+    if (config.analyticsDepth != 0) {
+      std::visit([&config](auto& engine) { engine.setAnalyticsDepth(config.analyticsDepth); }, engine_);
+    }
 
-    std::set<PriceLevel> askUpdates{};
-    std::set<PriceLevel> bidUpdates{};
+    if (auto band = PriceLevelBand{static_cast<double>(config.bandTicks) * config.tickSize, config.bandPercent};
+        band.isEnabled()) {
+      std::visit([&band](auto& engine) { engine.setPriceBand(band); }, engine_);
+    }
+  }
 
-    auto orders = reinterpret_cast<const dxf_order_t*>(snapshotData->records);
+  // Called under the mutex at the transaction boundary. Copies the live orders and the ladders to the sample of the
+  // integrity checker when it is due.
+  template <typename BookEngine>
+  void sampleIntegrity(const BookEngine& engine) {
+    transactionsNumber_++;
+    transactionsSinceSample_++;
 
-    auto isOrderRemoval = [](const dxf_order_t& o) {
-      return (o.event_flags & dxf_ef_remove_event) != 0 || o.size == 0 || std::isnan(o.size);
-    };
+    if (!integrityChecker_->isDue(transactionsSinceSample_, lastSampleTime_)) {
+      return;
+    }
 
-    auto processOrderAddition = [&bidUpdates, &askUpdates](const dxf_order_t& order) {
-      auto& updatesSide = order.side == dxf_osd_buy ? bidUpdates : askUpdates;
-      auto priceLevelChange = PriceLevel{order.price, order.size, order.time};
-      auto foundPriceLevel = updatesSide.find(priceLevelChange);
+    transactionsSinceSample_ = 0;
+    lastSampleTime_ = Clock::getDefault().now();
 
-      if (foundPriceLevel != updatesSide.end()) {
-        priceLevelChange.size = foundPriceLevel->size + priceLevelChange.size;
-        updatesSide.erase(foundPriceLevel);
-      }
+    auto sample = integrityChecker_->acquire();
 
-      updatesSide.insert(priceLevelChange);
-    };
+    if (!sample) {
+      return;
+    }
+
+    sample->symbol = symbol_;
+    sample->source = source_;
+    sample->transactionsNumber = transactionsNumber_;
+    sample->orders.clear();
+    engine.forEachOrder([&orders = sample->orders](const OrderData& orderData) { orders.push_back(orderData); });
+    engine.copyLadders(sample->asks, sample->bids);
+    integrityChecker_->submit(std::move(sample));
+  }
+
+  // Called under the mutex after the apply. Records the transaction to the history and the tape.
+  template <typename BookEngine>
+  void recordHistory(BookEngine& engine, bool isNewBook, const PriceLevelChangesSet& changesSet) {
+    auto time = Clock::getDefault().currentTimeMillis();
 
-    auto processOrderRemoval = [&bidUpdates, &askUpdates](const dxf_order_t& order, const OrderData& foundOrderData) {
-      auto& updatesSide = foundOrderData.side == dxf_osd_buy ? bidUpdates : askUpdates;
-      auto priceLevelChange = PriceLevel{foundOrderData.price, -foundOrderData.size, order.time};
-      auto foundPriceLevel = updatesSide.find(priceLevelChange);
+    if (isNewBook) {
+      const auto& book = engine.getBook();
 
-      if (foundPriceLevel != updatesSide.end()) {
-        priceLevelChange.size = foundPriceLevel->size + priceLevelChange.size;
-        updatesSide.erase(foundPriceLevel);
+      if (history_) {
+        history_->recordNewBook(time, book);
       }
 
-      if (!isZeroPriceLevel(priceLevelChange)) {
-        updatesSide.insert(priceLevelChange);
+      if (tape_) {
+        tape_->recordNewBook(time, book);
+      }
+    } else {
+      if (history_) {
+        history_->recordChanges(time, changesSet);
       }
-    };
 
-    for (std::size_t i = 0; i < snapshotData->records_count; i++) {
-      auto order = orders[i];
+      if (tape_) {
+        tape_->recordChanges(time, changesSet);
+      }
+    }
+  }
 
-      fmt::print("O:ind={},pr={},sz={},sd={}\n", order.index, order.price, order.size,
-                 order.side == dxf_osd_buy ? "buy" : "sell");
+  // Delivers the best levels if the transactions applied since the last delivery have changed them
+  template <typename BookEngine>
+  void notifyTopOfBook(BookEngine& engine) {
+    if (!isTopOfBookPending_) {
+      return;
+    }
 
-      auto removal = isOrderRemoval(order);
-      auto foundOrderDataIt = orderDataSnapshot_.find(order.index);
+    isTopOfBookPending_ = false;
 
-      if (foundOrderDataIt == orderDataSnapshot_.end()) {
-        if (removal) {
-          continue;
-        }
+    const auto& topOfBook = engine.getTopOfBook();
 
-        processOrderAddition(order);
-        orderDataSnapshot_[order.index] = OrderData{order.index, order.price, order.size, order.time, order.side};
-      } else {
-        const auto& foundOrderData = foundOrderDataIt->second;
+    // E.g. the conflated changes that have returned the best levels back
+    if (topOfBook.isSameAs(deliveredTopOfBook_)) {
+      return;
+    }
 
-        if (removal) {
-          processOrderRemoval(order, foundOrderData);
-          orderDataSnapshot_.erase(foundOrderData.index);
-        } else {
-          if (order.side != foundOrderData.side) {
-            processOrderRemoval(order, foundOrderData);
-          }
+    deliveredTopOfBook_ = topOfBook;
 
-          processOrderAddition(order);
-          orderDataSnapshot_[foundOrderData.index] =
-            OrderData{order.index, order.price, order.size, order.time, order.side};
-        }
-      }
+    if (onTopOfBookChange_) {
+      onTopOfBookChange_(topOfBook);
     }
 
-    return {std::vector<PriceLevel>{askUpdates.begin(), askUpdates.end()},
-            std::vector<PriceLevel>{bidUpdates.rbegin(), bidUpdates.rend()}};
+    listener_.onTopOfBookChange(topOfBook);
   }
 
-  // TODO: price levels number
-  PriceLevelChangesSet applyUpdates(const PriceLevelChanges& priceLevelUpdates) {
-    PriceLevelChanges additions{};
-    PriceLevelChanges updates{};
-    PriceLevelChanges removals{};
+  // Delivers the bucket changes of the grouped views changed since their last delivery
+  void notifyGroupedChanges() {
+    for (auto& view : groupedLevels_) {
+      if (!view.hasChanges()) {
+        continue;
+      }
 
-    // We generate lists of additions, updates, removals
-    for (const auto& updateAsk : priceLevelUpdates.asks) {
-      auto found = std::lower_bound(asks_.begin(), asks_.end(), updateAsk);
+      const auto& changesSet = view.takeChanges();
 
-      if (found == asks_.end() || !areEqualPrices(found->price, updateAsk.price)) {
-        additions.asks.push_back(updateAsk);
-      } else {
-        auto newPriceLevelChange = *found;
+      if (onGroupedChange_) {
+        onGroupedChange_(view, changesSet);
+      }
+    }
+  }
 
-        newPriceLevelChange.size += updateAsk.size;
-        newPriceLevelChange.time = updateAsk.time;
+  template <typename BookEngine>
+  void notifyNewBook(BookEngine& engine) {
+    // The new book supersedes the batched changes, its levels are the additions
+    if (isBatched_) {
+      const auto& book = engine.getBook();
+      PriceLevelChangesSet changesSet{};
+
+      changesSet.additions.asks.assign(book.asks.begin(), book.asks.end());
+      changesSet.additions.bids.assign(book.bids.begin(), book.bids.end());
+      batchChanges_.clear();
+      batchChanges_.fold(changesSet);
+      isBatchNewBook_ = true;
+    }
 
-        if (isZeroPriceLevel(newPriceLevelChange)) {
-          removals.asks.push_back(*found);
-        } else {
-          updates.asks.push_back(newPriceLevelChange);
-        }
-      }
+    notifyTopOfBook(engine);
+    notifyGroupedChanges();
+
+    if (!onNewBook_ && !listener_.hasOnNewBook()) {
+      return;
     }
 
-    for (const auto& updateBid : priceLevelUpdates.bids) {
-      auto found = std::lower_bound(bids_.begin(), bids_.end(), updateBid);
+    auto start = LatencyStats::now();
+    auto spanStart = SpanTracer::startOf(spanFlow_);
+    const auto& book = engine.getBook();
 
-      if (found == bids_.end() || !areEqualPrices(found->price, updateBid.price)) {
-        additions.bids.push_back(updateBid);
-      } else {
-        auto newPriceLevelChange = *found;
+    if (onNewBook_) {
+      onNewBook_(book);
+    }
 
-        newPriceLevelChange.size += updateBid.size;
-        newPriceLevelChange.time = updateBid.time;
+    listener_.onNewBook(book);
+    latencyStats_.record(LatencyStage::ON_NEW_BOOK, start);
+    SpanTracer::recordSince(SpanKind::ON_NEW_BOOK, spanFlow_, spanStart);
+  }
 
-        if (isZeroPriceLevel(newPriceLevelChange)) {
-          removals.bids.push_back(*found);
-        } else {
-          updates.bids.push_back(newPriceLevelChange);
-        }
-      }
+  template <typename BookEngine>
+  void notifyUpdate(BookEngine& engine, const PriceLevelChangesSet& changesSet) {
+    if (isBatched_) {
+      batchChanges_.fold(changesSet);
     }
 
-    std::set<PriceLevel> askRemovals{};
-    std::set<PriceLevel> bidRemovals{};
-    std::set<PriceLevel> askAdditions{};
-    std::set<PriceLevel> bidAdditions{};
-    std::set<PriceLevel> askUpdates{};
-    std::set<PriceLevel> bidUpdates{};
+    notifyTopOfBook(engine);
+    notifyGroupedChanges();
 
-    for (const auto& askRemoval : removals.asks) {
-      if (asks_.empty()) continue;
+    if (onIncrementalChange_ || listener_.hasOnIncrementalChange()) {
+      auto start = LatencyStats::now();
+      auto spanStart = SpanTracer::startOf(spanFlow_);
 
-      // Determine what will be the removal given the number of price levels.
-      if (levelsNumber_ == 0 || asks_.size() <= levelsNumber_ || askRemoval.price < asks_[levelsNumber_].price) {
-        askRemovals.insert(askRemoval);
+      if (onIncrementalChange_) {
+        onIncrementalChange_(changesSet);
       }
 
-      // Determine what will be the shift in price levels after removal.
-      if (levelsNumber_ != 0 && asks_.size() > levelsNumber_ && askRemoval.price < asks_[levelsNumber_].price) {
-        askAdditions.insert(asks_[levelsNumber_]);
+      listener_.onIncrementalChange(changesSet);
+      latencyStats_.record(LatencyStage::ON_INCREMENTAL_CHANGE, start);
+      SpanTracer::recordSince(SpanKind::ON_INCREMENTAL_CHANGE, spanFlow_, spanStart);
+    }
+
+    if (onBookUpdate_ || listener_.hasOnBookUpdate()) {
+      auto start = LatencyStats::now();
+      auto spanStart = SpanTracer::startOf(spanFlow_);
+      const auto& book = engine.getBook();
+
+      if (onBookUpdate_) {
+        onBookUpdate_(book);
       }
 
-      // remove price level by price
-      asks_.get<1>().erase(askRemoval.price);
+      listener_.onBookUpdate(book);
+      latencyStats_.record(LatencyStage::ON_BOOK_UPDATE, start);
+      SpanTracer::recordSince(SpanKind::ON_BOOK_UPDATE, spanFlow_, spanStart);
     }
 
-    for (const auto& askAddition : additions.asks) {
-      // We determine what will be the addition of the price level, taking into account the possible quantity.
-      if (levelsNumber_ == 0 || asks_.size() < levelsNumber_ || askAddition.price < asks_[levelsNumber_ - 1].price) {
-        askAdditions.insert(askAddition);
+    if (onBookUpdateView_ || listener_.hasOnBookUpdateView()) {
+      auto start = LatencyStats::now();
+      auto spanStart = SpanTracer::startOf(spanFlow_);
+      auto view = engine.getBookView();
+
+      if (onBookUpdateView_) {
+        onBookUpdateView_(view);
       }
 
-      // We determine what will be the shift after adding
-      if (levelsNumber_ != 0 && asks_.size() >= levelsNumber_ && askAddition.price < asks_[levelsNumber_ - 1].price) {
-        const auto& toRemove = asks_[levelsNumber_ - 1];
+      listener_.onBookUpdateView(view);
+      latencyStats_.record(LatencyStage::ON_BOOK_UPDATE_VIEW, start);
+      SpanTracer::recordSince(SpanKind::ON_BOOK_UPDATE_VIEW, spanFlow_, spanStart);
+    }
+  }
+
+  // The records of the C API (the synchronous books, by reference) or of the queued chunks
+  template <typename Record>
+  void processOrders(const Record* orders, std::size_t recordsCount, bool newSnap, LatencyStats::TimePoint receiveTime,
+                     const SpanFlow& flow) {
+    if (queue_ || workSignal_ != nullptr) {
+      SpanTracer::recordSince(SpanKind::QUEUE_WAIT, flow, flow.startNanos);
+    }
+
+    // Includes the wait for the lock
+    SpanScope processSpan{SpanKind::PROCESS, flow, recordsCount};
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    latencyStats_.record(LatencyStage::RECEIVE, receiveTime);
+    spanFlow_ = flow;
+
+    std::visit(
+      [this, orders, recordsCount, newSnap](auto& engine) {
+        if (newSnap) {
+          // The old levels stay in place (and visible) until the new snapshot is complete, then the net changes from
+          // the old book to the new one are applied at once. So the book is never empty or partial, and the storage
+          // of the unchanged levels is reused.
+          engine.forgetOrders();
+          snapshotPending_ = false;
+
+          // The folded changes are superseded by the new book
+          conflatedTransactionsNumber_.fetch_add(conflator_.getTransactionsNumber(), std::memory_order_relaxed);
+          conflator_.clear();
+        }
+
+        if (recordsCount == 0 && !newSnap) {
+          return;
+        }
+
+        trace<TraceLevel::TRANSACTION>(TraceEvent::SNAPSHOT_DATA, recordsCount, newSnap);
+
+        if constexpr (Trace::isCompiled(TraceLevel::RECORD)) {
+          for (std::size_t i = 0; i < recordsCount; i++) {
+            trace<TraceLevel::RECORD>(TraceEvent::ORDER, orders[i].index, orders[i].price, orders[i].size,
+                                      orders[i].side);
+          }
+        }
+
+        auto convertStart = LatencyStats::now();
+        auto convertSpanStart = SpanTracer::startOf(spanFlow_);
+
+        engine.accumulateOrders(orders, recordsCount);
+
+        // The new snapshot is always applied when it is complete
+        if ((batchPendingTransactions_ || newSnap || snapshotPending_) && recordsCount != 0 &&
+            (orders[recordsCount - 1].event_flags & dxf_ef_tx_pending) != 0) {
+          // The new snapshot flag is kept until the transaction is complete
+          snapshotPending_ = snapshotPending_ || newSnap;
+          latencyStats_.record(LatencyStage::CONVERT, convertStart);
+          SpanTracer::recordSince(SpanKind::CONVERT, spanFlow_, convertSpanStart, recordsCount);
+
+          return;
+        }
+
+        auto newBook = newSnap || snapshotPending_;
+
+        snapshotPending_ = false;
+
+        const auto& updates = engine.takeUpdates();
+
+        latencyStats_.record(LatencyStage::CONVERT, convertStart);
+        SpanTracer::recordSince(SpanKind::CONVERT, spanFlow_, convertSpanStart, recordsCount);
+
+        auto applyStart = LatencyStats::now();
+        auto applySpanStart = SpanTracer::startOf(spanFlow_);
+        const auto& resultingChangesSet = engine.applyUpdates(updates);
+
+        isTopOfBookPending_ = isTopOfBookPending_ || engine.isTopOfBookChanged();
+
+        if (publishedLevels_) {
+          publishedLevels_->publish(engine.getBookView());
+        }
+
+        if (fullDepthLevels_) {
+          engine.publishFullDepth(*fullDepthLevels_, updates, newBook);
+        }
+
+        for (auto& view : groupedLevels_) {
+          engine.groupUpdates(view, updates);
+        }
+
+        // Every transaction is recorded, the conflated deliveries are not
+        if (history_ || tape_) {
+          recordHistory(engine, newBook, resultingChangesSet);
+        }
+
+        if (publishedAnalytics_) {
+          if (newBook) {
+            engine.recomputeAnalytics();
+          }
+
+          publishedAnalytics_->publish(engine.getAnalytics());
+        }
+
+        latencyStats_.record(LatencyStage::APPLY, applyStart);
+        SpanTracer::recordSince(SpanKind::APPLY, spanFlow_, applySpanStart,
+                                updates.asks.size() + updates.bids.size());
+
+        if (integrityChecker_ != nullptr) {
+          sampleIntegrity(engine);
+        }
+
+        if (newBook) {
+          isStale_.store(false, std::memory_order_release);
+          isRebuilding_.store(false, std::memory_order_relaxed);
 
-        // We take into account the possibility that the previously added price level will be deleted.
-        if (askAdditions.contains(toRemove)) {
-          askAdditions.erase(toRemove);
+          if (!isReady_.exchange(true, std::memory_order_acq_rel) && onReadiness_) {
+            onReadiness_(*this, true);
+          }
+
+          notifyNewBook(engine);
+        } else if (conflate_) {
+          conflator_.fold(resultingChangesSet);
+
+          return;
         } else {
-          askRemovals.insert(toRemove);
+          notifyUpdate(engine, resultingChangesSet);
         }
-      }
 
-      asks_.get<1>().insert(askAddition);
+        if (recordsCount != 0) {
+          latencyStats_.recordSinceEventTime(LatencyStage::END_TO_END, orders[recordsCount - 1].time);
+        }
+      },
+      engine_);
+  }
+
+  void deliverConflatedChanges() {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    if (conflator_.empty()) {
+      // The grouped views are changed by the levels out of the visible ones too
+      notifyGroupedChanges();
+
+      return;
     }
 
-    for (const auto& askUpdate : updates.asks) {
-      if (levelsNumber_ == 0 || asks_.get<1>().count(askUpdate.price) > 0) {
-        askUpdates.insert(askUpdate);
-      }
+    // The conflated delivery is sampled as the separate transaction
+    spanFlow_ = SpanTracer::sample();
 
-      asks_.get<1>().erase(askUpdate.price);
-      asks_.get<1>().insert(askUpdate);
+    conflatedTransactionsNumber_.fetch_add(conflator_.getTransactionsNumber() - 1, std::memory_order_relaxed);
+
+    const auto& changesSet = conflator_.flush();
+
+    std::visit([this, &changesSet](auto& engine) { notifyUpdate(engine, changesSet); }, engine_);
+  }
+
+  // Moves the overflow chunk to the queue if there is a free slot. Returns true if it's moved.
+  bool moveOverflowToQueue() {
+    auto chunk = queue_->tryAcquire();
+
+    if (chunk == nullptr) {
+      return false;
+    }
+
+    // The swap keeps the capacities of both vectors
+    std::swap(chunk->orders, overflowChunk_.orders);
+    chunk->newSnapshot = overflowChunk_.newSnapshot;
+    chunk->stop = false;
+    chunk->receiveTime = overflowChunk_.receiveTime;
+    chunk->flow = overflowChunk_.flow;
+    overflowChunk_.orders.clear();
+    overflowChunk_.flow = {};
+    queue_->publish();
+    hasOverflow_.store(false, std::memory_order_release);
+
+    return true;
+  }
+
+  // The worker. Moves the overflow chunk to the drained queue, so it's applied after the queued chunks.
+  bool takeOverflow() {
+    if (!hasOverflow_.load(std::memory_order_acquire) || queue_->tryFront() != nullptr) {
+      return false;
     }
 
-    for (const auto& bidRemoval : removals.bids) {
-      if (bids_.empty()) continue;
+    std::lock_guard<std::mutex> lk(overflowMutex_);
 
-      // Determine what will be the removal given the number of price levels.
-      if (levelsNumber_ == 0 || bids_.size() <= levelsNumber_ ||
-          bidRemoval.price > bids_[bids_.size() - 1 - levelsNumber_].price) {
-        bidRemovals.insert(bidRemoval);
+    return hasOverflow_.load(std::memory_order_relaxed) && moveOverflowToQueue();
+  }
+
+  // The listener (the CONFLATE policy). The chunk goes to the queue if there is no overflow and a free slot, otherwise
+  // it's merged into the overflow chunk. The merged chunk (the connection is over its memory quota) goes to the
+  // overflow chunk until the queue is drained.
+  void conflateChunk(const dxf_order_t* orders, std::size_t recordsCount, bool newSnapshot,
+                     LatencyStats::TimePoint receiveTime, const SpanFlow& flow, bool isMerged = false) {
+    std::lock_guard<std::mutex> lk(overflowMutex_);
+
+    if (!hasOverflow_.load(std::memory_order_relaxed) && (!isMerged || queue_->size() == 0)) {
+      if (auto chunk = queue_->tryAcquire()) {
+        chunk->orders.assign(orders, orders + recordsCount);
+        chunk->newSnapshot = newSnapshot;
+        chunk->stop = false;
+        chunk->receiveTime = receiveTime;
+        chunk->flow = SpanTracer::handOver(flow);
+        queue_->publish();
+
+        return;
       }
 
-      // Determine what will be the shift in price levels after removal.
-      if (levelsNumber_ != 0 && bids_.size() > levelsNumber_ &&
-          bidRemoval.price > bids_[bids_.size() - 1 - levelsNumber_].price) {
-        bidAdditions.insert(bids_[bids_.size() - 1 - levelsNumber_]);
+      backpressure_.recordOverflow();
+      overflowChunk_.orders.assign(orders, orders + recordsCount);
+      overflowChunk_.newSnapshot = newSnapshot;
+      overflowChunk_.receiveTime = receiveTime;
+      overflowChunk_.flow = SpanTracer::handOver(flow);
+      hasOverflow_.store(true, std::memory_order_release);
+    } else if (newSnapshot) {
+      // The new snapshot supersedes the merged records
+      backpressure_.recordDropped(overflowChunk_.orders.size());
+      overflowChunk_.orders.assign(orders, orders + recordsCount);
+      overflowChunk_.newSnapshot = true;
+      overflowChunk_.receiveTime = receiveTime;
+      overflowChunk_.flow = SpanTracer::handOver(flow);
+    } else {
+      overflowChunk_.orders.insert(overflowChunk_.orders.end(), orders, orders + recordsCount);
+
+      // The merged chunk is traced by the first sampled chunk
+      if (!overflowChunk_.flow) {
+        overflowChunk_.flow = SpanTracer::handOver(flow);
       }
+    }
+
+    backpressure_.recordConflated(1);
 
-      // remove price level by price
-      bids_.get<1>().erase(bidRemoval.price);
+    if (isMerged) {
+      memoryAccount_->recordConflatedChunk();
     }
 
-    for (const auto& bidAddition : additions.bids) {
-      // We determine what will be the addition of the price level, taking into account the possible quantity.
-      if (levelsNumber_ == 0 || bids_.size() < levelsNumber_ ||
-          bidAddition.price > bids_[bids_.size() - levelsNumber_].price) {
-        bidAdditions.insert(bidAddition);
-      }
+    // The worker may have drained the queue meanwhile
+    if (!isMerged || queue_->size() == 0) {
+      moveOverflowToQueue();
+    }
+  }
 
-      // We determine what will be the shift after adding
-      if (levelsNumber_ != 0 && bids_.size() >= levelsNumber_ &&
-          bidAddition.price > bids_[bids_.size() - levelsNumber_].price) {
-        const auto& toRemove = bids_[bids_.size() - levelsNumber_];
+  // The worker with the conflated changes. Waits for the next chunk until the end of the conflation window: the real
+  // time is slept (the queue is polled at least every MAX_CONFLATION_SLEEP), the simulated time doesn't move while the
+  // worker waits, so the wait ends when the listener queues the chunk or the clock is advanced.
+  void waitForConflationWindow(Clock::TimePoint deadline) {
+    if (!conflationClock_.isSimulated()) {
+      std::this_thread::sleep_until((std::min)(deadline, conflationClock_.now() + MAX_CONFLATION_SLEEP));
 
-        // We take into account the possibility that the previously added price level will be deleted.
-        if (bidAdditions.contains(toRemove)) {
-          bidAdditions.erase(toRemove);
-        } else {
-          bidRemovals.insert(toRemove);
+      return;
+    }
+
+    // The chunk or the advance after the get() changes the signal
+    auto seen = conflationSignal_.get();
+
+    if (queue_->tryFront() == nullptr && !hasOverflow_.load(std::memory_order_acquire) &&
+        conflationClock_.now() < deadline) {
+      conflationSignal_.wait(seen);
+    }
+  }
+
+  // The conflation window is measured by the default clock (the replays are conflated by the simulated time)
+  void runWorker() {
+    auto& clock = conflationClock_;
+    auto advanceHandlerId = clock.addAdvanceHandler([this] { conflationSignal_.notify(); });
+    auto lastDelivery = clock.now();
+
+    while (true) {
+      takeOverflow();
+
+      auto chunk = conflate_ && !conflator_.empty() ? queue_->tryFront() : &queue_->front(workerWait_);
+
+      if (conflate_ && !conflator_.empty()) {
+        auto now = clock.now();
+        auto deadline = lastDelivery + conflationWindow_;
+
+        if (now >= deadline) {
+          // The queue is drained or the window is over
+          if (chunk == nullptr || conflationWindow_.count() != 0) {
+            deliverConflatedChanges();
+            lastDelivery = now;
+
+            continue;
+          }
+        } else if (chunk == nullptr) {
+          waitForConflationWindow(deadline);
+
+          continue;
         }
       }
 
-      bids_.get<1>().insert(bidAddition);
+      if (chunk->stop) {
+        clock.removeAdvanceHandler(advanceHandlerId);
+        deliverConflatedChanges();
+        queue_->pop();
+
+        return;
+      }
+
+      processOrders(chunk->orders.data(), chunk->orders.size(), chunk->newSnapshot, chunk->receiveTime,
+                    chunk->flow);
+      queue_->pop();
     }
+  }
+
+  // Processes the queued chunks (the managed book). Returns the number of the processed records.
+  std::size_t processQueued() {
+    std::size_t recordsNumber = 0;
 
-    for (const auto& bidUpdate : updates.bids) {
-      if (levelsNumber_ == 0 || bids_.get<1>().count(bidUpdate.price) > 0) {
-        bidUpdates.insert(bidUpdate);
+    do {
+      while (auto chunk = queue_->tryFront()) {
+        recordsNumber += chunk->orders.size();
+        processOrders(chunk->orders.data(), chunk->orders.size(), chunk->newSnapshot, chunk->receiveTime,
+                      chunk->flow);
+        queue_->pop();
       }
+    } while (takeOverflow());
 
-      bids_.get<1>().erase(bidUpdate.price);
-      bids_.get<1>().insert(bidUpdate);
+    if (conflate_) {
+      deliverConflatedChanges();
     }
 
-    return {PriceLevelChanges{std::vector<PriceLevel>{askAdditions.begin(), askAdditions.end()},
-                              std::vector<PriceLevel>{bidAdditions.rbegin(), bidAdditions.rend()}},
-            PriceLevelChanges{std::vector<PriceLevel>{askUpdates.begin(), askUpdates.end()},
-                              std::vector<PriceLevel>{bidUpdates.rbegin(), bidUpdates.rend()}},
-            PriceLevelChanges{std::vector<PriceLevel>{askRemovals.begin(), askRemovals.end()},
-                              std::vector<PriceLevel>{bidRemovals.rbegin(), bidRemovals.rend()}}};
+    return recordsNumber;
   }
 
-  [[nodiscard]] std::vector<PriceLevel> getAsks() const {
-    return {asks_.begin(),
-            (levelsNumber_ == 0 || asks_.size() <= levelsNumber_) ? asks_.end() : asks_.begin() + levelsNumber_};
-  }
+  // The managed book. Called by the shard that has processed the claimed queue before it's released: moves the batched
+  // changes to the result. Returns false if there are no changes.
+  bool takeBatchChanges(PriceLevelChangesSet& result, bool& isNewBook) {
+    if (batchChanges_.empty() && !isBatchNewBook_) {
+      return false;
+    }
+
+    const auto& changesSet = batchChanges_.flush();
+
+    result.additions = changesSet.additions;
+    result.updates = changesSet.updates;
+    result.removals = changesSet.removals;
+    isNewBook = isBatchNewBook_;
+    isBatchNewBook_ = false;
 
-  [[nodiscard]] std::vector<PriceLevel> getBids() const {
-    return {bids_.rbegin(),
-            (levelsNumber_ == 0 || bids_.size() <= levelsNumber_) ? bids_.rend() : bids_.rbegin() + levelsNumber_};
+    return true;
   }
 
- public:
-  // TODO: move to another thread
-  void processSnapshotData(const dxf_snapshot_data_ptr_t snapshotData, int newSnapshot) {
-    std::lock_guard<std::mutex> lk(mutex_);
+  // The managed book. Takes the queue for the processing (see processClaimed). Returns false if the other shard is
+  // processing it.
+  bool claimQueue() { return !isConsumed_.exchange(true, std::memory_order_acquire); }
+
+  // Processes the queued chunks of the claimed queue, calls the onProcessed() (e.g. takes the batched changes) and
+  // releases the queue. The shard of the book is notified if the chunks are queued after the last check (e.g. while the
+  // helping shard is processing them). Returns the number of the processed records.
+  template <typename OnProcessed>
+  std::size_t processClaimed(OnProcessed&& onProcessed) {
+    auto recordsNumber = processQueued();
 
-    auto newSnap = newSnapshot != 0;
+    onProcessed();
+    isConsumed_.store(false, std::memory_order_release);
 
-    if (newSnap) {
-      asks_.clear();
-      bids_.clear();
-      orderDataSnapshot_.clear();
+    if (queue_->size() != 0) {
+      workSignal_->notify();
     }
 
-    if (snapshotData->records_count == 0) {
-      if (newSnap && onNewBook_) {
-        onNewBook_({});
-      }
+    return recordsNumber;
+  }
 
+  // The listener. Adds the book with the queued new snapshot to the rebuilds and wakes the shards.
+  void addToRebuilds() {
+    if (isRebuilding_.exchange(true, std::memory_order_relaxed)) {
       return;
     }
 
-    auto updates = convertToUpdates(snapshotData);
-    auto resultingChangesSet = applyUpdates(updates);
+    std::lock_guard<std::mutex> lk(rebuilds_->mutex);
 
-    if (newSnap) {
-      if (onNewBook_) {
-        onNewBook_(PriceLevelChanges{getAsks(), getBids()});
-      }
-    } else {
-      if (onIncrementalChange_) {
-        onIncrementalChange_(resultingChangesSet);
-      }
+    if (!isListed_) {
+      isListed_ = true;
+      rebuilds_->books.push_back(this);
+    }
 
-      if (onBookUpdate_) {
-        onBookUpdate_(PriceLevelChanges{getAsks(), getBids()});
-      }
+    for (auto signal : rebuilds_->signals) {
+      signal->notify();
     }
   }
 
-  ~PriceLevelBook() {
+  // Called under the snapshot mutex
+  void closeSnapshotLocked() {
     if (isValid_) {
-      dxf_close_price_level_book(snapshot_);
+      dxf_close_snapshot(snapshot_);
+      isValid_ = false;
     }
   }
 
-  static std::unique_ptr<PriceLevelBook> create(dxf_connection_t connection, const std::string& symbol,
-                                                const std::string& source, std::size_t levelsNumber) {
-    auto plb = std::unique_ptr<PriceLevelBook>(new PriceLevelBook(symbol, source, levelsNumber));
-    auto wSymbol = StringConverter::utf8ToWString(symbol);
+  void closeSnapshot() {
+    std::lock_guard<std::mutex> lk(snapshotMutex_);
+
+    closeSnapshotLocked();
+  }
+
+  // Creates the order snapshot of the book on its connection (under the snapshot mutex). Returns false if it can't be
+  // created.
+  bool createSnapshot() {
+    const auto& wSymbol = Symbol::valueOf(symbol_).getWideName();
     dxf_snapshot_t snapshot = nullptr;
 
-    dxf_create_order_snapshot(connection, wSymbol.c_str(), source.c_str(), 0, &snapshot);
+    if (dxf_create_order_snapshot(connection_, wSymbol.c_str(), source_.c_str(), 0, &snapshot) == DXF_FAILURE) {
+      return false;
+    }
+
+    snapshot_ = snapshot;
+    isValid_ = true;
+
+    return true;
+  }
 
+  // Called under the snapshot mutex
+  void attachSnapshotListener() {
     dxf_attach_snapshot_inc_listener(
-      snapshot,
+      snapshot_,
       [](const dxf_snapshot_data_ptr_t snapshot_data, int new_snapshot, void* user_data) {
         static_cast<PriceLevelBook*>(user_data)->processSnapshotData(snapshot_data, new_snapshot);
       },
-      plb.get());
-    plb->isValid_ = true;
+      this);
+  }
+
+  // Restores the order index and the ladders of the book from its checkpoint (see
+  // PriceLevelBookConfig::checkpointDirectory). Is called at the creation, before the subscription. Returns false if
+  // there is no valid checkpoint of the book.
+  bool restoreCheckpoint(const std::string& directory) {
+    auto reader = PriceLevelBookCheckpointReader::open(
+      (std::filesystem::path(directory) / PriceLevelBookCheckpoint::getFileName(symbol_, source_)).string());
+
+    if (!reader || reader->getSymbol() != symbol_ || reader->getSource() != source_) {
+      return false;
+    }
+
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    std::visit(
+      [this, &reader](auto& engine) {
+        engine.restore(reader->getOrders(), reader->getAsks(), reader->getBids());
+        isTopOfBookPending_ = true;
+
+        if (publishedLevels_) {
+          publishedLevels_->publish(engine.getBookView());
+        }
+
+        if (fullDepthLevels_) {
+          engine.publishFullDepth(*fullDepthLevels_, {}, true);
+        }
+
+        if (!groupedLevels_.empty()) {
+          std::vector<PriceLevel> asks{};
+          std::vector<PriceLevel> bids{};
+
+          engine.copyLadders(asks, bids);
+
+          for (auto& view : groupedLevels_) {
+            view.rebuild(asks, bids);
+          }
+        }
+
+        if (history_ || tape_) {
+          recordHistory(engine, true, {});
+        }
+
+        if (publishedAnalytics_) {
+          engine.recomputeAnalytics();
+          publishedAnalytics_->publish(engine.getAnalytics());
+        }
+      },
+      engine_);
+
+    checkpointTime_ = reader->getTime();
+    isStale_.store(true, std::memory_order_release);
+
+    return true;
+  }
+
+  static std::unique_ptr<PriceLevelBook> create(dxf_connection_t connection, const std::string& symbol,
+                                                const std::string& source, std::size_t levelsNumber,
+                                                const PriceLevelBookConfig& config, WorkSignal* workSignal,
+                                                PriceLevelBookRebuilds* rebuilds) {
+    auto plb = std::unique_ptr<PriceLevelBook>(
+      new PriceLevelBook(symbol, source, levelsNumber, config, workSignal, rebuilds));
+
+    if (!config.checkpointDirectory.empty()) {
+      plb->restoreCheckpoint(config.checkpointDirectory);
+    }
+
+    std::lock_guard<std::mutex> lk(plb->snapshotMutex_);
+
+    plb->connection_ = connection;
+
+    if (!plb->createSnapshot()) {
+      return plb;
+    }
+
+    if (plb->queue_ && workSignal == nullptr) {
+      plb->worker_ = std::thread([book = plb.get(), placement = config.workerPlacement] {
+        ThreadPlacement::setCurrentThreadName("dxf-plb-worker");
+        placement.applyToCurrentThread();
+        book->runWorker();
+      });
+    }
+
+    plb->attachSnapshotListener();
+
+    return plb;
+  }
+
+  void stopWorker() {
+    if (!worker_.joinable()) {
+      return;
+    }
+
+    // The snapshot is closed, so the worker is the only other producer: the overflow is dropped
+    std::lock_guard<std::mutex> lk(overflowMutex_);
+
+    hasOverflow_.store(false, std::memory_order_release);
+
+    auto chunk = queue_->acquire();
+
+    chunk->orders.clear();
+    chunk->stop = true;
+    queue_->publish();
+    conflationSignal_.notify();
+    worker_.join();
+  }
+
+ public:
+  void processSnapshotData(const dxf_snapshot_data_ptr_t snapshotData, int newSnapshot) {
+    assert(snapshotData->records_count == 0 || snapshotData->event_type == dx_eid_order);
+
+    auto receiveTime = LatencyStats::now();
+
+    if (onSnapshotData_) {
+      onSnapshotData_(snapshotData, newSnapshot);
+    }
+
+    auto orders = reinterpret_cast<const dxf_order_t*>(snapshotData->records);
+    auto recordsCount = static_cast<std::size_t>(snapshotData->records_count);
+
+    auto flow = SpanTracer::sample();
+    SpanScope span{SpanKind::SNAPSHOT_DATA, flow, recordsCount};
+
+    snapshotDataNumber_.fetch_add(1, std::memory_order_relaxed);
+    recordsNumber_.fetch_add(recordsCount, std::memory_order_relaxed);
+
+    if (onReadiness_ && !hasFirstData_.load(std::memory_order_relaxed) &&
+        !hasFirstData_.exchange(true, std::memory_order_relaxed)) {
+      onReadiness_(*this, false);
+    }
+
+    if (!queue_) {
+      processOrders(orders, recordsCount, newSnapshot != 0, receiveTime, flow);
+
+      return;
+    }
+
+    if (backpressure_.isDisconnected()) {
+      backpressure_.recordDropped(recordsCount);
+
+      return;
+    }
+
+    // The connection is over its memory quota. The chunks after the merged ones go to the overflow chunk too (it's set
+    // by this thread only), so the order of the chunks is kept.
+    auto isMerged = memoryAccount_ != nullptr && memoryAccount_->isDegraded(MemoryQuotaAction::CONFLATE);
+
+    if (isMerged || backpressurePolicy_ == BackpressurePolicy::CONFLATE ||
+        hasOverflow_.load(std::memory_order_relaxed)) {
+      conflateChunk(orders, recordsCount, newSnapshot != 0, receiveTime, flow, isMerged);
+    } else {
+      auto chunk = queue_->tryAcquire();
+
+      if (chunk == nullptr) {
+        backpressure_.recordOverflow();
+
+        if (backpressurePolicy_ == BackpressurePolicy::DISCONNECT) {
+          backpressure_.setDisconnected();
+          backpressure_.recordDropped(recordsCount);
+
+          return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        chunk = queue_->acquire();
+        backpressure_.recordBlocked(std::chrono::steady_clock::now() - start);
+      }
+
+      chunk->orders.assign(orders, orders + recordsCount);
+      chunk->newSnapshot = newSnapshot != 0;
+      chunk->stop = false;
+      chunk->receiveTime = receiveTime;
+      chunk->flow = SpanTracer::handOver(flow);
+      queue_->publish();
+    }
+
+    backpressure_.recordDepth(queue_->size());
+
+    // The worker that waits for the conflation window on the simulated clock
+    if (conflate_ && conflationClock_.isSimulated()) {
+      conflationSignal_.notify();
+    }
+
+    if (rebuilds_ != nullptr && newSnapshot != 0) {
+      addToRebuilds();
+    }
+
+    if (workSignal_ != nullptr) {
+      workSignal_->notify();
+    }
+  }
+
+  ~PriceLevelBook() {
+    closeSnapshot();
+    stopWorker();
+  }
+
+  static std::unique_ptr<PriceLevelBook> create(dxf_connection_t connection, const std::string& symbol,
+                                                const std::string& source, std::size_t levelsNumber,
+                                                const PriceLevelBookConfig& config = {}) {
+    return create(connection, symbol, source, levelsNumber, config, nullptr, nullptr);
+  }
+
+  // Creates the book without the snapshot subscription. The snapshot data is passed to the processSnapshotData by the
+  // caller (e.g. replayed from a capture file).
+  static std::unique_ptr<PriceLevelBook> createDetached(const std::string& symbol, const std::string& source,
+                                                        std::size_t levelsNumber,
+                                                        const PriceLevelBookConfig& config = {}) {
+    auto plb =
+      std::unique_ptr<PriceLevelBook>(new PriceLevelBook(symbol, source, levelsNumber, config, nullptr, nullptr));
+
+    if (!config.checkpointDirectory.empty()) {
+      plb->restoreCheckpoint(config.checkpointDirectory);
+    }
+
+    if (plb->queue_) {
+      plb->worker_ = std::thread([book = plb.get(), placement = config.workerPlacement] {
+        ThreadPlacement::setCurrentThreadName("dxf-plb-worker");
+        placement.applyToCurrentThread();
+        book->runWorker();
+      });
+    }
 
     return plb;
   }
 
+  [[nodiscard]] bool isValid() const { return isValid_; }
+
+  // Requests the fresh snapshot of the book only (e.g. on the gap or the integrity mismatch), instead of recreating the
+  // book or the connection: the snapshot is closed and created again on the same connection. Until the new snapshot is
+  // complete, the book keeps serving its last levels (copyBook, the published levels and the analytics) marked stale
+  // (see isStale), and the order index is rebuilt aside of them; then the new book is delivered by the onNewBook, as
+  // the first one. The book stopped by the DISCONNECT policy is resumed. Returns false if the book is detached or the
+  // snapshot can't be created (the book is invalid then). Can be called from any thread (e.g. the onMismatch of the
+  // PriceLevelBookIntegrityChecker), but not concurrently with the destruction of the book.
+  bool resync() {
+    std::lock_guard<std::mutex> lk(snapshotMutex_);
+
+    if (connection_ == nullptr) {
+      return false;
+    }
+
+    // The listener of the closed snapshot isn't called anymore, its queued data is applied before the new snapshot
+    closeSnapshotLocked();
+    resyncsNumber_.fetch_add(1, std::memory_order_relaxed);
+    isStale_.store(true, std::memory_order_release);
+    backpressure_.resetDisconnected();
+
+    if (!createSnapshot()) {
+      return false;
+    }
+
+    attachSnapshotListener();
+
+    return true;
+  }
+
+  // The number of the resyncs of the book
+  [[nodiscard]] std::uint64_t getResyncsNumber() const { return resyncsNumber_.load(std::memory_order_relaxed); }
+
+  // Returns true if the first snapshot of the book is applied (the book is complete)
+  [[nodiscard]] bool isReady() const { return isReady_.load(std::memory_order_acquire); }
+
+  // Returns true if the book serves the levels restored from the checkpoint (see
+  // PriceLevelBookConfig::checkpointDirectory) and the fresh snapshot hasn't replaced them yet
+  [[nodiscard]] bool isStale() const { return isStale_.load(std::memory_order_acquire); }
+
+  // The time the restored checkpoint was written (ms since the epoch, 0 - the book isn't restored)
+  [[nodiscard]] std::int64_t getCheckpointTime() const { return checkpointTime_; }
+
+  // Writes the checkpoint of the live orders and the ladders of the book to the directory (the file name is
+  // PriceLevelBookCheckpoint::getFileName). The state is copied under the lock and written after it. Returns false if
+  // the book has no fresh snapshot (the stale book doesn't overwrite its checkpoint) or the file can't be written.
+  bool writeCheckpoint(const std::string& directory) {
+    std::vector<PriceLevelBookCheckpoint::Order> orders{};
+    std::vector<PriceLevel> asks{};
+    std::vector<PriceLevel> bids{};
+
+    {
+      std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+      if (!isReady_.load(std::memory_order_acquire)) {
+        return false;
+      }
+
+      std::visit(
+        [&](const auto& engine) {
+          orders.reserve(engine.getOrdersNumber());
+          engine.forEachOrder([&orders](const OrderData& order) {
+            orders.push_back({order.index, order.price, order.size, static_cast<std::int32_t>(order.side), 0});
+          });
+          engine.copyLadders(asks, bids);
+        },
+        engine_);
+    }
+
+    auto time = Clock::getDefault().currentTimeMillis();
+
+    return PriceLevelBookCheckpoint::write(
+      (std::filesystem::path(directory) / PriceLevelBookCheckpoint::getFileName(symbol_, source_)).string(), symbol_,
+      source_, static_cast<std::int64_t>(time), orders, asks, bids);
+  }
+
+  // Copies the visible levels of the book under the lock, e.g. to serve the restored book before the handlers are set
+  void copyBook(PriceLevelChanges& result) {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    std::visit(
+      [&result](auto& engine) {
+        const auto& book = engine.getBook();
+
+        result.asks.assign(book.asks.begin(), book.asks.end());
+        result.bids.assign(book.bids.begin(), book.bids.end());
+      },
+      engine_);
+  }
+
+  // Calls the f with the view of the visible levels under the lock, so no transaction is applied and no handler is
+  // called meanwhile (e.g. to attach the consumer to the book at the transaction boundary)
+  template <typename F>
+  void visitBook(F&& f) {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    std::visit([&f](const auto& engine) { f(engine.getBookView()); }, engine_);
+  }
+
+  [[nodiscard]] const std::string& getSymbol() const { return symbol_; }
+
+  [[nodiscard]] const std::string& getSource() const { return source_; }
+
+  // Is read by the thread that sets the priorities (see PriceLevelBookManager::setPriority)
+  [[nodiscard]] int getPriority() const { return priority_.load(std::memory_order_relaxed); }
+
+  // The interned source, so the books are filtered by the source with the integer compare
+  [[nodiscard]] IndexedEventSource getEventSource() const { return eventSource_; }
+
+  // Returns the numbers of the snapshot data chunks and the order records received by the book so far
+  [[nodiscard]] std::uint64_t getSnapshotDataNumber() const {
+    return snapshotDataNumber_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] std::uint64_t getRecordsNumber() const { return recordsNumber_.load(std::memory_order_relaxed); }
+
+  // Returns the number of the transactions whose changes were folded into the other conflated deliveries (the
+  // conflation mode only).
+  [[nodiscard]] std::uint64_t getConflatedTransactionsNumber() const {
+    return conflatedTransactionsNumber_.load(std::memory_order_relaxed);
+  }
+
+  // Copies the published best levels (see PriceLevelBookConfig::publishedLevelsNumber) to the result. Can be called
+  // from any thread at any time: it doesn't block the book and doesn't write to the memory shared with it. Returns the
+  // number of the publications so far (0 - nothing is published yet or the publishing is disabled).
+  std::uint64_t readPublishedLevels(PriceLevelChanges& result) const {
+    if (!publishedLevels_) {
+      result.asks.clear();
+      result.bids.clear();
+
+      return 0;
+    }
+
+    return publishedLevels_->read(result);
+  }
+
+  // Pins the published full depth of the book (see PriceLevelBookConfig::publishFullDepth): the reader walks the
+  // consistent version of all levels while the book keeps changing. Can be called from any thread at any time without
+  // blocking the book; the memory of the replaced versions is reused after the guard is destroyed, so it's not kept
+  // for long. The guard is empty (the sequence 0) if nothing is published yet or the publishing is disabled.
+  [[nodiscard]] FullDepthPriceLevels::ReadGuard readFullDepth() const {
+    if (!fullDepthLevels_) {
+      return {};
+    }
+
+    return fullDepthLevels_->read();
+  }
+
+  // Restores the visible levels of the book at the time (ms since the epoch, see
+  // PriceLevelBookConfig::historyMemoryBudget) from one keyframe and the bounded number of the deltas. Can be called
+  // from any thread without blocking the book. Returns false if the time is before the window of the history or the
+  // history is disabled.
+  bool getBookAt(std::int64_t time, PriceLevelChanges& result) const {
+    if (!history_) {
+      return false;
+    }
+
+    return history_->getBookAt(time, result);
+  }
+
+  // The times of the oldest and the newest records of the history (0, 0 - nothing is recorded or it's disabled)
+  [[nodiscard]] std::pair<std::int64_t, std::int64_t> getHistoryWindow() const {
+    if (!history_) {
+      return {0, 0};
+    }
+
+    return history_->getWindow();
+  }
+
+  // Copies the analytics of the book (see PriceLevelBookConfig::analyticsDepth) to the result. Can be called from any
+  // thread at any time without blocking the book. Returns the number of the publications so far (0 - nothing is
+  // published yet or the analytics are disabled).
+  std::uint64_t readAnalytics(PriceLevelBookAnalytics& result) const {
+    if (!publishedAnalytics_) {
+      result = {};
+
+      return 0;
+    }
+
+    return publishedAnalytics_->read(result);
+  }
+
   void setOnNewBook(std::function<void(const PriceLevelChanges&)> onNewBookHandler) {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
     onNewBook_ = std::move(onNewBookHandler);
   }
 
   void setOnBookUpdate(std::function<void(const PriceLevelChanges&)> onBookUpdateHandler) {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
     onBookUpdate_ = std::move(onBookUpdateHandler);
   }
 
+  // The handler receives the non-owning view of the visible levels after every update. Unlike the OnBookUpdate
+  // handler, it doesn't copy the levels. The view is valid only during the handler call. The book copies the levels
+  // only if the OnNewBook or OnBookUpdate handlers are set, so the delta-only consumers set just OnIncrementalChange.
+  void setOnBookUpdateView(std::function<void(const PriceLevelBookView&)> onBookUpdateViewHandler) {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    onBookUpdateView_ = std::move(onBookUpdateViewHandler);
+  }
+
   void setOnIncrementalChange(std::function<void(const PriceLevelChangesSet&)> onIncrementalChangeHandler) {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
     onIncrementalChange_ = std::move(onIncrementalChangeHandler);
   }
+
+  // The handler receives the best levels of both sides only when the price or the size of any of them changes (with
+  // the new book too). The best levels are checked in O(1) and only by the transactions that reach them, so the
+  // updates of the deep levels cost the top of book consumers nothing. Under the conflation the changes are delivered
+  // with the conflated ones, the best levels that have returned back are not delivered.
+  void setOnTopOfBookChange(std::function<void(const TopOfBook&)> onTopOfBookChangeHandler) {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    onTopOfBookChange_ = std::move(onTopOfBookChangeHandler);
+  }
+
+  // The handler receives the view (see PriceLevelBookConfig::groupBucketSizes) and the net changes of its buckets after
+  // every transaction that changes them (with the changes of the visible levels, or with the conflated ones). The
+  // buckets are changed by the level deltas, so the cost is O(changed levels) of the transaction for every view.
+  void setOnGroupedChange(
+    std::function<void(const GroupedPriceLevels&, const PriceLevelChangesSet&)> onGroupedChangeHandler) {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    onGroupedChange_ = std::move(onGroupedChangeHandler);
+  }
+
+  // The non-empty buckets of the grouped view (the index of PriceLevelBookConfig::groupBucketSizes), best-first. Empty
+  // if there is no such view.
+  [[nodiscard]] PriceLevelChanges getGroupedBook(std::size_t viewIndex) {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    if (viewIndex >= groupedLevels_.size()) {
+      return {};
+    }
+
+    return groupedLevels_[viewIndex].getBuckets();
+  }
+
+  // The best levels of both sides
+  [[nodiscard]] TopOfBook getTopOfBook() {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    return std::visit([](const auto& engine) { return engine.getTopOfBook(); }, engine_);
+  }
+
+  // Sets the listener object whose handlers (see PriceLevelBookListenerRef) are called after the std::function
+  // handlers. The listener is not owned by the book and must outlive it (or be reset). Unlike the std::function
+  // handlers, it never allocates.
+  template <typename Listener>
+  void setListener(Listener& listener) {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    listener_ = PriceLevelBookListenerRef{listener};
+  }
+
+  void resetListener() {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    listener_ = {};
+  }
+
+  // Returns the bytes held by the price levels, the order index and the buffers of the book (the queue of the async
+  // mode is not included). Is used for the capacity planning.
+  [[nodiscard]] PriceLevelBookMemoryUsage getMemoryUsage() {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    return std::visit([](const auto& engine) { return engine.getMemoryUsage(); }, engine_);
+  }
+
+  // Returns the number of the live orders of the book (e.g. the ordersNumberHint of the recreated book)
+  [[nodiscard]] std::size_t getOrdersNumber() {
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    return std::visit([](const auto& engine) { return engine.getOrdersNumber(); }, engine_);
+  }
+
+  // Returns the latency histogram of the processing stage of the book (empty if the project is configured without
+  // -DDXFCXX_LATENCY_STATS=1). The snapshots of the books can be merged.
+  [[nodiscard]] LatencyHistogramSnapshot getLatency(LatencyStage stage) const {
+    return latencyStats_.getSnapshot(stage);
+  }
+
+  // Returns the number of the times the listener thread has found the queue full and waited for the worker (the async
+  // mode only).
+  [[nodiscard]] std::uint64_t getQueueOverflowsNumber() const { return queue_ ? queue_->getOverflowsNumber() : 0; }
+
+  // Returns the backpressure counters of the queue (the async mode only): the depth and its high-water mark, the
+  // overflows, the time the listener thread was blocked, the merged chunks and the dropped records (see
+  // PriceLevelBookConfig::backpressurePolicy).
+  [[nodiscard]] BackpressureStats getBackpressureStats() const {
+    auto result = backpressure_.getStats();
+
+    result.queueDepth = queue_ ? queue_->size() : 0;
+
+    return result;
+  }
+
+  // Returns the counters of the waits of the worker for the empty queue (the async mode only): the wake-ups and the
+  // times of the spin, the yield and the park phases, and the current spin (see PriceLevelBookConfig::workerPlacement)
+  [[nodiscard]] WaitStats getWorkerWaitStats() const { return workerWait_.getStats(); }
+
+  // Returns true if the book is stopped by the DISCONNECT policy
+  [[nodiscard]] bool isDisconnected() const { return backpressure_.isDisconnected(); }
+
+  // Returns the state of the book for the diagnostics report. The counters are read without the lock, the number of
+  // the orders and the memory are read under the lock of the book (between its transactions).
+  [[nodiscard]] PriceLevelBookDiagnostics getDiagnostics() {
+    PriceLevelBookDiagnostics result{};
+
+    result.symbol = symbol_;
+    result.source = source_;
+    result.priority = getPriority();
+    result.isReady = isReady();
+    result.isStale = isStale();
+    result.snapshotDataNumber = getSnapshotDataNumber();
+    result.recordsNumber = getRecordsNumber();
+    result.resyncsNumber = getResyncsNumber();
+    result.backpressure = getBackpressureStats();
+
+    std::lock_guard<PriceLevelBookMutex> lk(mutex_);
+
+    std::visit(
+      [&result](const auto& engine) {
+        result.ordersNumber = engine.getOrdersNumber();
+        result.memoryUsage = engine.getMemoryUsage().getTotal();
+      },
+      engine_);
+
+    return result;
+  }
+
+  // Writes the counters of the book (the received data, the conflation, the backpressure and the latencies of the
+  // stages if they are compiled) labeled by the symbol, the source and the labels. Can be called from any thread (see
+  // MetricsRegistry::addCollector).
+  void collectMetrics(MetricsWriter& writer, MetricLabels labels = {}) const {
+    labels.emplace_back("symbol", symbol_);
+    labels.emplace_back("source", source_);
+    writer.counter("dxf_book_snapshot_data_total", "The snapshot data chunks received by the book", labels,
+                   static_cast<double>(snapshotDataNumber_.load(std::memory_order_relaxed)));
+    writer.counter("dxf_book_records_total", "The order records received by the book", labels,
+                   static_cast<double>(recordsNumber_.load(std::memory_order_relaxed)));
+    writer.counter("dxf_book_conflated_transactions_total", "The transactions folded into the conflated deliveries",
+                   labels, static_cast<double>(getConflatedTransactionsNumber()));
+    writer.gauge("dxf_book_stale", "1 if the book serves the levels restored from the checkpoint or before the resync",
+                 labels, isStale() ? 1.0 : 0.0);
+    writer.counter("dxf_book_resyncs_total", "The fresh snapshots requested by the resyncs", labels,
+                   static_cast<double>(getResyncsNumber()));
+    collectBackpressureMetrics(writer, "dxf_book", labels, getBackpressureStats());
+
+    if constexpr (LatencyStats::isCompiled()) {
+      static constexpr std::array<const char*, 8> STAGES{
+        "receive", "convert", "apply", "on_new_book", "on_incremental_change", "on_book_update", "on_book_update_view",
+        "end_to_end"};
+
+      for (std::size_t i = 0; i < STAGES.size(); i++) {
+        auto stageLabels = labels;
+
+        stageLabels.emplace_back("stage", STAGES[i]);
+        writer.histogram("dxf_book_latency_nanoseconds", "The latencies of the processing stages of the book",
+                         stageLabels, getLatency(static_cast<LatencyStage>(i)));
+      }
+    }
+  }
 };
 
 }  // namespace dxf
\ No newline at end of file
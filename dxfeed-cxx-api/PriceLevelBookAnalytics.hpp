@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "PriceLevel.hpp"
+
+namespace dxf {
+
+// The analytics of the book that are maintained by the engine incrementally (see
+// PriceLevelBookConfig::analyticsDepth): the best levels and the sums of the sizes of the best levels of every side
+// within the depth. The derived values are computed from them in O(1).
+struct PriceLevelBookAnalytics {
+  // NaN price and size - the side is empty
+  PriceLevel bestAsk{};
+  PriceLevel bestBid{};
+  // The sums of the sizes of the best levels within the depth
+  double askDepthSize = 0.0;
+  double bidDepthSize = 0.0;
+  // The numbers of the levels within the depth
+  std::size_t askDepthLevels = 0;
+  std::size_t bidDepthLevels = 0;
+
+  [[nodiscard]] bool isTwoSided() const { return !std::isnan(bestAsk.price) && !std::isnan(bestBid.price); }
+
+  // NaN if the book is not two-sided
+  [[nodiscard]] double getSpread() const {
+    return isTwoSided() ? bestAsk.price - bestBid.price : std::numeric_limits<double>::quiet_NaN();
+  }
+
+  [[nodiscard]] double getMid() const {
+    return isTwoSided() ? (bestAsk.price + bestBid.price) / 2.0 : std::numeric_limits<double>::quiet_NaN();
+  }
+
+  // The mid weighted by the sizes of the opposite best levels (the microprice): it's closer to the side with the larger
+  // size on the other side. NaN if the book is not two-sided or the sizes are 0.
+  [[nodiscard]] double getMicroprice() const {
+    auto sizes = bestAsk.size + bestBid.size;
+
+    if (!isTwoSided() || !(sizes > 0.0)) {
+      return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    return (bestBid.price * bestAsk.size + bestAsk.price * bestBid.size) / sizes;
+  }
+
+  // (bids - asks) / (bids + asks) of the sizes within the depth: from -1 (the asks only) to 1 (the bids only). NaN if
+  // the book is empty.
+  [[nodiscard]] double getImbalance() const {
+    auto sizes = bidDepthSize + askDepthSize;
+
+    return sizes > 0.0 ? (bidDepthSize - askDepthSize) / sizes : std::numeric_limits<double>::quiet_NaN();
+  }
+};
+
+// The seqlock-protected copy of the analytics of the book (see PublishedPriceLevels): one writer publishes them after
+// every change, any number of the readers on the other threads copy them out without the locks.
+class PublishedBookAnalytics final {
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+  static constexpr std::size_t WORDS_NUMBER = 10;
+
+  // Odd - the writer is changing the analytics
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> sequence_{0};
+  std::atomic<std::uint64_t> words_[WORDS_NUMBER]{};
+
+  void store(std::size_t word, double value) {
+    words_[word].store(std::bit_cast<std::uint64_t>(value), std::memory_order_relaxed);
+  }
+
+  void store(std::size_t word, std::uint64_t value) { words_[word].store(value, std::memory_order_relaxed); }
+
+  [[nodiscard]] double loadDouble(std::size_t word) const {
+    return std::bit_cast<double>(words_[word].load(std::memory_order_relaxed));
+  }
+
+  [[nodiscard]] std::uint64_t load(std::size_t word) const { return words_[word].load(std::memory_order_relaxed); }
+
+ public:
+  // The writer
+  void publish(const PriceLevelBookAnalytics& analytics) {
+    auto sequence = sequence_.load(std::memory_order_relaxed);
+
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    store(0, analytics.bestAsk.price);
+    store(1, analytics.bestAsk.size);
+    store(2, static_cast<std::uint64_t>(analytics.bestAsk.time));
+    store(3, analytics.bestBid.price);
+    store(4, analytics.bestBid.size);
+    store(5, static_cast<std::uint64_t>(analytics.bestBid.time));
+    store(6, analytics.askDepthSize);
+    store(7, analytics.bidDepthSize);
+    store(8, static_cast<std::uint64_t>(analytics.askDepthLevels));
+    store(9, static_cast<std::uint64_t>(analytics.bidDepthLevels));
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  // The reader. Copies the consistent analytics to the result. Returns the number of the publications so far.
+  std::uint64_t read(PriceLevelBookAnalytics& result) const {
+    while (true) {
+      auto sequence = sequence_.load(std::memory_order_acquire);
+
+      if ((sequence & 1) != 0) {
+        continue;
+      }
+
+      result.bestAsk = {loadDouble(0), loadDouble(1), static_cast<std::int64_t>(load(2))};
+      result.bestBid = {loadDouble(3), loadDouble(4), static_cast<std::int64_t>(load(5))};
+      result.askDepthSize = loadDouble(6);
+      result.bidDepthSize = loadDouble(7);
+      result.askDepthLevels = static_cast<std::size_t>(load(8));
+      result.bidDepthLevels = static_cast<std::size_t>(load(9));
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      if (sequence_.load(std::memory_order_relaxed) == sequence) {
+        return sequence / 2;
+      }
+    }
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "PriceLevel.hpp"
+
+namespace dxf {
+
+// The checkpoint of one PriceLevelBook: the live orders (the order index) and the price levels (the ladders) at the
+// checkpoint time in the compact file that is read by the memory mapping. The book restored from the checkpoint serves
+// the checkpointed state (marked stale) after the restart until the fresh snapshot replaces it (see
+// PriceLevelBookConfig::checkpointDirectory, PriceLevelBook::writeCheckpoint).
+//
+// Format (native byte order, every section is 8-byte aligned):
+//   header: the Header
+//   names:  the symbol and the source (UTF-8), padded with zeros
+//   orders: the Order of every live order
+//   asks:   the PriceLevel of every ask level (the ones beyond the number of the levels of the book too), the best first
+//   bids:   the PriceLevel of every bid level, the best first
+struct PriceLevelBookCheckpoint {
+  static constexpr char MAGIC[4] = {'P', 'L', 'B', 'C'};
+  static constexpr std::uint32_t VERSION = 1;
+
+  struct Header {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t symbolLength;
+    std::uint32_t sourceLength;
+    std::uint64_t ordersNumber;
+    std::uint64_t asksNumber;
+    std::uint64_t bidsNumber;
+    // The time the checkpoint is written (ms since the epoch)
+    std::int64_t time;
+  };
+
+  struct Order {
+    std::int64_t index;
+    double price;
+    double size;
+    std::int32_t side;
+    std::uint32_t reserved;
+  };
+
+  static_assert(sizeof(Header) % 8 == 0 && std::is_trivially_copyable_v<Header>);
+  static_assert(sizeof(Order) == 32 && std::is_trivially_copyable_v<Order>);
+  static_assert(sizeof(PriceLevel) == 24 && std::is_trivially_copyable_v<PriceLevel>);
+
+  static constexpr std::size_t align(std::size_t size) { return (size + 7U) & ~std::size_t{7}; }
+
+  // The file name of the checkpoint of the book: the symbol and the source with the characters that are not safe in
+  // the file names percent-encoded (e.g. "%2FESZ21%3AXCME#NTV.plbc")
+  static std::string getFileName(const std::string& symbol, const std::string& source) {
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    std::string result{};
+
+    auto append = [&result](const std::string& name) {
+      for (auto c : name) {
+        auto u = static_cast<unsigned char>(c);
+
+        if ((u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '.' || u == '-' ||
+            u == '_') {
+          result += c;
+        } else {
+          result += '%';
+          result += HEX[u >> 4U];
+          result += HEX[u & 0xFU];
+        }
+      }
+    };
+
+    append(symbol);
+    result += '#';
+    append(source);
+
+    return result + ".plbc";
+  }
+
+  // Writes the checkpoint to the temporary file and renames it to the path, so the readers never see the partial
+  // checkpoint. Returns false if the file can't be written.
+  static bool write(const std::string& path, const std::string& symbol, const std::string& source, std::int64_t time,
+                    const std::vector<Order>& orders, const std::vector<PriceLevel>& asks,
+                    const std::vector<PriceLevel>& bids) {
+    auto temporaryPath = path + ".tmp";
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> file{std::fopen(temporaryPath.c_str(), "wb"), &std::fclose};
+
+    if (!file) {
+      return false;
+    }
+
+    Header header{};
+
+    std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.symbolLength = static_cast<std::uint32_t>(symbol.size());
+    header.sourceLength = static_cast<std::uint32_t>(source.size());
+    header.ordersNumber = orders.size();
+    header.asksNumber = asks.size();
+    header.bidsNumber = bids.size();
+    header.time = time;
+
+    std::vector<char> names(align(symbol.size() + source.size()), '\0');
+
+    std::memcpy(names.data(), symbol.data(), symbol.size());
+    std::memcpy(names.data() + symbol.size(), source.data(), source.size());
+
+    auto isWritten = std::fwrite(&header, sizeof(header), 1, file.get()) == 1 &&
+                     std::fwrite(names.data(), 1, names.size(), file.get()) == names.size() &&
+                     std::fwrite(orders.data(), sizeof(Order), orders.size(), file.get()) == orders.size() &&
+                     std::fwrite(asks.data(), sizeof(PriceLevel), asks.size(), file.get()) == asks.size() &&
+                     std::fwrite(bids.data(), sizeof(PriceLevel), bids.size(), file.get()) == bids.size();
+
+    isWritten = std::fclose(file.release()) == 0 && isWritten;
+
+    std::error_code ec{};
+
+    if (isWritten) {
+      std::filesystem::rename(temporaryPath, path, ec);
+    }
+
+    if (!isWritten || ec) {
+      std::filesystem::remove(temporaryPath, ec);
+
+      return false;
+    }
+
+    return true;
+  }
+};
+
+// The reader of the checkpoint. The orders and the levels are read from the mapping in place.
+class PriceLevelBookCheckpointReader final {
+  std::unique_ptr<MappedFile> file_;
+  PriceLevelBookCheckpoint::Header header_{};
+  std::string_view symbol_{};
+  std::string_view source_{};
+  const PriceLevelBookCheckpoint::Order* orders_ = nullptr;
+  const PriceLevel* asks_ = nullptr;
+  const PriceLevel* bids_ = nullptr;
+
+  explicit PriceLevelBookCheckpointReader(std::unique_ptr<MappedFile> file) : file_{std::move(file)} {}
+
+  bool load() {
+    const auto* data = static_cast<const char*>(file_->getData());
+    auto size = file_->getSize();
+
+    if (data == nullptr || size < sizeof(header_)) {
+      return false;
+    }
+
+    std::memcpy(&header_, data, sizeof(header_));
+
+    if (std::memcmp(header_.magic, PriceLevelBookCheckpoint::MAGIC, sizeof(header_.magic)) != 0 ||
+        header_.version != PriceLevelBookCheckpoint::VERSION) {
+      return false;
+    }
+
+    // The numbers are bounded by the file size first, so the corrupt ones can't overflow the sum
+    auto namesSize = PriceLevelBookCheckpoint::align(std::size_t{header_.symbolLength} + header_.sourceLength);
+
+    if (header_.ordersNumber > size / sizeof(PriceLevelBookCheckpoint::Order) ||
+        header_.asksNumber > size / sizeof(PriceLevel) || header_.bidsNumber > size / sizeof(PriceLevel) ||
+        sizeof(header_) + namesSize + header_.ordersNumber * sizeof(PriceLevelBookCheckpoint::Order) +
+            (header_.asksNumber + header_.bidsNumber) * sizeof(PriceLevel) !=
+          size) {
+      return false;
+    }
+
+    const auto* position = data + sizeof(header_);
+
+    symbol_ = std::string_view{position, header_.symbolLength};
+    source_ = std::string_view{position + header_.symbolLength, header_.sourceLength};
+    position += namesSize;
+    orders_ = reinterpret_cast<const PriceLevelBookCheckpoint::Order*>(position);
+    position += header_.ordersNumber * sizeof(PriceLevelBookCheckpoint::Order);
+    asks_ = reinterpret_cast<const PriceLevel*>(position);
+    bids_ = asks_ + header_.asksNumber;
+
+    return true;
+  }
+
+ public:
+  // Returns nullptr if the file can't be mapped or isn't the checkpoint
+  static std::unique_ptr<PriceLevelBookCheckpointReader> open(const std::string& path) {
+    auto file = MappedFile::open(path, false);
+
+    if (!file) {
+      return nullptr;
+    }
+
+    auto reader = std::unique_ptr<PriceLevelBookCheckpointReader>(new PriceLevelBookCheckpointReader(std::move(file)));
+
+    if (!reader->load()) {
+      return nullptr;
+    }
+
+    return reader;
+  }
+
+  [[nodiscard]] std::string_view getSymbol() const { return symbol_; }
+
+  [[nodiscard]] std::string_view getSource() const { return source_; }
+
+  // The time the checkpoint is written (ms since the epoch)
+  [[nodiscard]] std::int64_t getTime() const { return header_.time; }
+
+  [[nodiscard]] std::span<const PriceLevelBookCheckpoint::Order> getOrders() const {
+    return {orders_, static_cast<std::size_t>(header_.ordersNumber)};
+  }
+
+  [[nodiscard]] std::span<const PriceLevel> getAsks() const {
+    return {asks_, static_cast<std::size_t>(header_.asksNumber)};
+  }
+
+  [[nodiscard]] std::span<const PriceLevel> getBids() const {
+    return {bids_, static_cast<std::size_t>(header_.bidsNumber)};
+  }
+};
+
+}  // namespace dxf
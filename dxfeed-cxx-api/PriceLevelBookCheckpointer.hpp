@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "PriceLevelBook.hpp"
+
+namespace dxf {
+
+// Writes the checkpoints of the books (see PriceLevelBook::writeCheckpoint) to the directory periodically on its own
+// thread, so the books created with the same PriceLevelBookConfig::checkpointDirectory after the restart serve the
+// recent state at once. The books are added after the creation and removed before the close (the remove waits for the
+// pass that writes them).
+class PriceLevelBookCheckpointer final {
+  std::string directory_;
+  std::chrono::milliseconds interval_;
+  // Guards the books and the stop. Held during the pass.
+  std::mutex mutex_;
+  std::condition_variable stopCondition_;
+  std::vector<PriceLevelBook*> books_;
+  bool stop_;
+  std::atomic<std::uint64_t> writtenNumber_;
+  std::atomic<std::uint64_t> failedNumber_;
+  std::thread worker_;
+
+  // Called under the mutex. The books without the fresh snapshot are skipped.
+  std::size_t writeBooks() {
+    std::size_t result = 0;
+
+    for (auto* book : books_) {
+      if (!book->isReady()) {
+        continue;
+      }
+
+      if (book->writeCheckpoint(directory_)) {
+        result++;
+      } else {
+        failedNumber_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+
+    writtenNumber_.fetch_add(result, std::memory_order_relaxed);
+
+    return result;
+  }
+
+  // The passes are timed by the default clock (see Clock)
+  void run() {
+    auto& clock = Clock::getDefault();
+    AdvanceHandler advanceHandler{clock, mutex_, stopCondition_};
+    std::unique_lock<std::mutex> lk(mutex_);
+
+    while (!clock.waitUntil(lk, stopCondition_, clock.now() + interval_, [this] { return stop_; })) {
+      writeBooks();
+    }
+  }
+
+ public:
+  // The directory is created if it doesn't exist. interval - the time between the passes over all books.
+  PriceLevelBookCheckpointer(std::string directory, std::chrono::milliseconds interval)
+      : directory_{std::move(directory)},
+        interval_{interval},
+        mutex_{},
+        stopCondition_{},
+        books_{},
+        stop_{false},
+        writtenNumber_{0},
+        failedNumber_{0},
+        worker_{} {
+    std::error_code ec{};
+
+    std::filesystem::create_directories(directory_, ec);
+    worker_ = std::thread([this] { run(); });
+  }
+
+  PriceLevelBookCheckpointer(const PriceLevelBookCheckpointer&) = delete;
+  PriceLevelBookCheckpointer& operator=(const PriceLevelBookCheckpointer&) = delete;
+
+  ~PriceLevelBookCheckpointer() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+
+      stop_ = true;
+    }
+
+    stopCondition_.notify_one();
+    worker_.join();
+  }
+
+  [[nodiscard]] const std::string& getDirectory() const { return directory_; }
+
+  void add(PriceLevelBook& book) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    books_.push_back(&book);
+  }
+
+  void remove(const PriceLevelBook& book) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    books_.erase(std::remove(books_.begin(), books_.end(), &book), books_.end());
+  }
+
+  // Writes the checkpoints of all books now (e.g. at the shutdown). Returns the number of the written checkpoints.
+  std::size_t writeAll() {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return writeBooks();
+  }
+
+  // The numbers of the checkpoints written and failed so far
+  [[nodiscard]] std::uint64_t getWrittenNumber() const { return writtenNumber_.load(std::memory_order_relaxed); }
+
+  [[nodiscard]] std::uint64_t getFailedNumber() const { return failedNumber_.load(std::memory_order_relaxed); }
+};
+
+}  // namespace dxf
@@ -0,0 +1,925 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "FullDepthPriceLevels.hpp"
+#include "GroupedPriceLevels.hpp"
+#include "OrderDataMap.hpp"
+#include "PriceLevel.hpp"
+#include "PriceLevelBookAnalytics.hpp"
+#include "PriceLevelBookView.hpp"
+#include "PriceLevelBuffer.hpp"
+#include "PriceLevelLadder.hpp"
+
+// 1 - the engines of the PriceLevelBook are instantiated by the dxfeed-cxx library (src/PriceLevelBookEngine.cpp) and
+// not by every translation unit of the user. 0 - the header-only use.
+#ifndef DXFCXX_EXTERN_TEMPLATES
+#define DXFCXX_EXTERN_TEMPLATES 0
+#endif
+
+namespace dxf {
+
+// The bytes held by the storage of the book
+struct PriceLevelBookMemoryUsage {
+  // The price levels of both sides
+  std::size_t ladders = 0;
+  // The live orders
+  std::size_t orderIndex = 0;
+  // The reusable scratch and result buffers
+  std::size_t buffers = 0;
+
+  [[nodiscard]] std::size_t getTotal() const { return ladders + orderIndex + buffers; }
+};
+
+// The band of the prices around the best price of every side whose levels are kept in the ladders of the engine: the
+// level is in the band if its distance to the best price is not greater than the width plus the percent of the best
+// price. The levels out of the band are kept in the cold store of the side, are not visible and don't change the
+// analytics. They are moved to the ladder when the best price moves towards them. The empty band keeps all levels in
+// the ladders.
+struct PriceLevelBand {
+  double width = 0.0;
+  double percent = 0.0;
+
+  [[nodiscard]] bool isEnabled() const { return width > 0.0 || percent > 0.0; }
+};
+
+// The order-to-price-level aggregation algorithm of the PriceLevelBook. It knows nothing about the connection,
+// the locking and the callbacks, so it can be driven directly by benchmarks.
+//
+// Ladder - the price level storage template (MultiIndexPriceLevelLadder, FlatPriceLevelLadder or
+//          FixedDepthPriceLevelLadder<N>::Type)
+// PriceModel - the internal price representation (DoublePriceModel or TickPriceModel)
+template <template <typename, typename> class Ladder, typename PriceModel = DoublePriceModel>
+class PriceLevelBookEngine final {
+  using Level = typename PriceModel::Level;
+  using Price = typename PriceModel::Price;
+  using LevelChanges = BasicPriceLevelChanges<Level>;
+
+  // The per-side scratch buffers. They keep their capacity between the transactions.
+  template <typename Side>
+  struct SideScratch {
+    PriceLevelDeltaBuffer<Level, Side> deltas{};
+    std::vector<Level> additions{};
+    std::vector<Level> updates{};
+    std::vector<Level> removals{};
+    // The levels of the side after the merged updates (best-first)
+    std::vector<Level> merged{};
+    SortedPriceLevelBuffer<Level, Side> resultingAdditions{};
+    SortedPriceLevelBuffer<Level, Side> resultingUpdates{};
+    SortedPriceLevelBuffer<Level, Side> resultingRemovals{};
+  };
+
+  // The cold store of the levels out of the price band (the contiguous ladder: its best levels are at the back)
+  template <typename Side>
+  using ColdLadder = FlatPriceLevelLadder<Side, Level>;
+
+  // The compile-time depth of the fixed-depth ladders (0 - the depth is set at run time)
+  static constexpr std::size_t FIXED_DEPTH = FixedLadderDepth<Ladder<AskSide, Level>>::VALUE;
+
+  // The updates of the side are merged if there are at least 1/MERGE_RATIO of its levels (and the threshold)
+  static constexpr std::size_t MERGE_RATIO = 16;
+
+  std::size_t levelsNumber_;
+  PriceModel priceModel_;
+  // The minimal number of the updates of the side that are merged in one pass (see mergeSideUpdates)
+  std::size_t mergeThreshold_;
+  Ladder<AskSide, Level> asks_{};
+  Ladder<BidSide, Level> bids_{};
+  PriceLevelBand band_{};
+  ColdLadder<AskSide> coldAsks_{};
+  ColdLadder<BidSide> coldBids_{};
+  // The updates of the ladders routed by the band (the updates in the band, the promotions and the demotions)
+  LevelChanges bandUpdates_{};
+  OrderDataMap orderDataSnapshot_{};
+
+  SideScratch<AskSide> askScratch_{};
+  SideScratch<BidSide> bidScratch_{};
+  LevelChanges updates_{};
+  PriceLevelChangesSet changes_{};
+  PriceLevelChanges book_{};
+
+  // The depth of the incremental analytics (0 - disabled) and the running sums of the sizes of the best levels within
+  // it. The sums are changed by every changed level in O(1) and recomputed at every new book (see recomputeAnalytics).
+  std::size_t analyticsDepth_ = 0;
+  double askDepthSize_ = 0.0;
+  double bidDepthSize_ = 0.0;
+
+  // The best levels after the last applyUpdates and whether it has changed them. They are read again only if the first
+  // (the best) update of the side is at or better than its best level, so the deep updates cost nothing.
+  TopOfBook topOfBook_{};
+  bool isTopOfBookChanged_ = false;
+
+  // The number of the visible levels (0 - all levels). Is a constant for the fixed-depth ladders.
+  [[nodiscard]] std::size_t getLevelsLimit() const {
+    if constexpr (FIXED_DEPTH != 0) {
+      return FIXED_DEPTH;
+    } else {
+      return levelsNumber_;
+    }
+  }
+
+  [[nodiscard]] bool isVisible(std::size_t position) const {
+    return getLevelsLimit() == 0 || position < getLevelsLimit();
+  }
+
+  // Applies the sorted (best-first) price level updates of one side by one pass over the ladder and the updates, O(n +
+  // m) for the large transactions (e.g. the snapshot chunks and the mass cancels): the levels after the updates are
+  // merged into the scratch ladder that replaces the levels of the ladder. The visible changes are the differences of
+  // the visible levels before and after the updates, so they are the same as the ones of the level by level apply.
+  template <typename Side>
+  void mergeSideUpdates(Ladder<Side, Level>& ladder, SideScratch<Side>& scratch,
+                        const std::vector<Level>& priceLevelUpdates, std::vector<PriceLevel>& resultingAdditions,
+                        std::vector<PriceLevel>& resultingUpdates, std::vector<PriceLevel>& resultingRemovals,
+                        double& depthSize) {
+    auto& merged = scratch.merged;
+    std::size_t position = 0;
+    std::size_t u = 0;
+
+    merged.clear();
+    resultingAdditions.clear();
+    resultingUpdates.clear();
+    resultingRemovals.clear();
+
+    while (position < ladder.size() || u < priceLevelUpdates.size()) {
+      if (position < ladder.size() && u < priceLevelUpdates.size() &&
+          areEqualPrices(ladder[position].price, priceLevelUpdates[u].price)) {
+        const auto& oldLevel = ladder[position];
+        auto level = oldLevel;
+        auto wasVisible = isVisible(position++);
+
+        level.size += priceLevelUpdates[u].size;
+        level.time = priceLevelUpdates[u++].time;
+
+        if (isZeroPriceLevel(level)) {
+          if (wasVisible) {
+            resultingRemovals.push_back(priceModel_.toPriceLevel(oldLevel));
+          }
+
+          continue;
+        }
+
+        if (auto isVisibleAfter = isVisible(merged.size()); wasVisible && isVisibleAfter) {
+          resultingUpdates.push_back(priceModel_.toPriceLevel(level));
+        } else if (wasVisible) {
+          resultingRemovals.push_back(priceModel_.toPriceLevel(oldLevel));
+        } else if (isVisibleAfter) {
+          resultingAdditions.push_back(priceModel_.toPriceLevel(level));
+        }
+
+        merged.push_back(level);
+      } else if (u == priceLevelUpdates.size() ||
+                 (position < ladder.size() && Side::isBetter(ladder[position].price, priceLevelUpdates[u].price))) {
+        // The level is not updated, but it may be shifted into the visible depth or out of it
+        const auto& level = ladder[position];
+        auto wasVisible = isVisible(position++);
+
+        if (auto isVisibleAfter = isVisible(merged.size()); wasVisible && !isVisibleAfter) {
+          resultingRemovals.push_back(priceModel_.toPriceLevel(level));
+        } else if (!wasVisible && isVisibleAfter) {
+          resultingAdditions.push_back(priceModel_.toPriceLevel(level));
+        }
+
+        merged.push_back(level);
+      } else {
+        const auto& level = priceLevelUpdates[u++];
+
+        if (isVisible(merged.size())) {
+          resultingAdditions.push_back(priceModel_.toPriceLevel(level));
+        }
+
+        merged.push_back(level);
+      }
+    }
+
+    ladder.assign(merged.begin(), merged.end());
+    depthSize = computeDepthSize(ladder);
+  }
+
+  // Applies the sorted (best-first) price level updates of one side and collects the resulting visible changes.
+  template <typename Side>
+  void applySideUpdates(Ladder<Side, Level>& ladder, SideScratch<Side>& scratch,
+                        const std::vector<Level>& priceLevelUpdates, std::vector<PriceLevel>& resultingAdditions,
+                        std::vector<PriceLevel>& resultingUpdates, std::vector<PriceLevel>& resultingRemovals,
+                        double& depthSize) {
+    // Every update of the large transaction would look up the ladder and shift its levels or relink its nodes
+    if (priceLevelUpdates.size() >= mergeThreshold_ && priceLevelUpdates.size() * MERGE_RATIO >= ladder.size()) {
+      mergeSideUpdates(ladder, scratch, priceLevelUpdates, resultingAdditions, resultingUpdates, resultingRemovals,
+                       depthSize);
+
+      return;
+    }
+
+    auto& additions = scratch.additions;
+    auto& updates = scratch.updates;
+    auto& removals = scratch.removals;
+    auto& sideAdditions = scratch.resultingAdditions;
+    auto& sideUpdates = scratch.resultingUpdates;
+    auto& sideRemovals = scratch.resultingRemovals;
+
+    additions.clear();
+    updates.clear();
+    removals.clear();
+    sideAdditions.clear();
+    sideUpdates.clear();
+    sideRemovals.clear();
+
+    // We generate lists of additions, updates, removals
+    for (const auto& update : priceLevelUpdates) {
+      auto found = ladder.find(update.price);
+
+      if (found == ladder.size()) {
+        additions.push_back(update);
+      } else {
+        auto newPriceLevelChange = ladder[found];
+
+        newPriceLevelChange.size += update.size;
+        newPriceLevelChange.time = update.time;
+
+        if (isZeroPriceLevel(newPriceLevelChange)) {
+          removals.push_back(ladder[found]);
+        } else {
+          updates.push_back(newPriceLevelChange);
+        }
+      }
+    }
+
+    for (const auto& removal : removals) {
+      auto position = ladder.find(removal.price);
+
+      // Determine what will be the removal given the number of price levels.
+      if (isVisible(position)) {
+        // The level that was shifted into the visible depth by this transaction has never been reported
+        if (!sideAdditions.erase(removal.price)) {
+          sideRemovals.insert(removal);
+        }
+
+        // Determine what will be the shift in price levels after removal.
+        if (getLevelsLimit() != 0 && ladder.size() > getLevelsLimit()) {
+          sideAdditions.insert(ladder[getLevelsLimit()]);
+        }
+      }
+
+      // The next level is shifted into the depth of the analytics
+      if (position < analyticsDepth_) {
+        depthSize -= ladder[position].size;
+
+        if (ladder.size() > analyticsDepth_) {
+          depthSize += ladder[analyticsDepth_].size;
+        }
+      }
+
+      // remove price level by price
+      ladder.erase(removal.price);
+    }
+
+    for (const auto& addition : additions) {
+      // We determine what will be the addition of the price level, taking into account the possible quantity.
+      if (getLevelsLimit() == 0 || ladder.size() < getLevelsLimit()) {
+        sideAdditions.insert(addition);
+      } else if (Side::isBetter(addition.price, ladder[getLevelsLimit() - 1].price)) {
+        sideAdditions.insert(addition);
+
+        // We determine what will be the shift after adding
+        const auto& toRemove = ladder[getLevelsLimit() - 1];
+
+        // We take into account the possibility that the previously added price level will be deleted.
+        if (!sideAdditions.erase(toRemove.price)) {
+          sideRemovals.insert(toRemove);
+        }
+      }
+
+      ladder.insert(addition);
+
+      // The last level is shifted out of the depth of the analytics
+      if (analyticsDepth_ != 0) {
+        if (auto position = ladder.find(addition.price); position < analyticsDepth_) {
+          depthSize += addition.size;
+
+          if (ladder.size() > analyticsDepth_) {
+            depthSize -= ladder[analyticsDepth_].size;
+          }
+        }
+      }
+    }
+
+    for (const auto& update : updates) {
+      auto position = ladder.find(update.price);
+
+      if (position < analyticsDepth_) {
+        depthSize += update.size - ladder[position].size;
+      }
+
+      if (isVisible(position)) {
+        // The update of the level that was shifted into the visible depth by this transaction is still an addition
+        if (sideAdditions.erase(update.price)) {
+          sideAdditions.insert(update);
+        } else {
+          sideUpdates.insert(update);
+        }
+      }
+
+      ladder.insert(update);
+    }
+
+    // The drift of the running sum ends with the side
+    if (ladder.size() == 0) {
+      depthSize = 0.0;
+    }
+
+    toPriceLevels(sideAdditions.begin(), sideAdditions.end(), resultingAdditions);
+    toPriceLevels(sideUpdates.begin(), sideUpdates.end(), resultingUpdates);
+    toPriceLevels(sideRemovals.begin(), sideRemovals.end(), resultingRemovals);
+  }
+
+  template <typename It>
+  void toPriceLevels(It begin, It end, std::vector<PriceLevel>& result) const {
+    result.clear();
+
+    for (auto it = begin; it != end; ++it) {
+      result.push_back(priceModel_.toPriceLevel(*it));
+    }
+  }
+
+  template <typename Side>
+  [[nodiscard]] double computeDepthSize(const Ladder<Side, Level>& ladder) const {
+    auto depthSize = 0.0;
+
+    for (std::size_t i = 0; i < analyticsDepth_ && i < ladder.size(); i++) {
+      depthSize += ladder[i].size;
+    }
+
+    return depthSize;
+  }
+
+  template <typename Side>
+  [[nodiscard]] std::size_t getVisibleSize(const Ladder<Side, Level>& ladder) const {
+    return (getLevelsLimit() == 0 || ladder.size() <= getLevelsLimit()) ? ladder.size() : getLevelsLimit();
+  }
+
+  template <typename Side>
+  void publishFullDepthSide(FullDepthPriceLevels& levels, const Ladder<Side, Level>& ladder,
+                            const std::vector<Level>& appliedUpdates, bool isBid) const {
+    for (const auto& update : appliedUpdates) {
+      auto found = ladder.find(update.price);
+
+      if (found == ladder.size()) {
+        levels.removeLevel(isBid, priceModel_.toPriceLevel(Level{update.price}).price);
+      } else {
+        levels.setLevel(isBid, priceModel_.toPriceLevel(ladder[found]));
+      }
+    }
+  }
+
+  template <typename Side>
+  void getLevels(const Ladder<Side, Level>& ladder, std::vector<PriceLevel>& result) const {
+    toPriceLevels(ladder.begin(), ladder.begin() + static_cast<std::ptrdiff_t>(getVisibleSize(ladder)), result);
+  }
+
+  // The sorted (best-first) updates of the side may change its best level: the first one is at or better than it
+  template <typename Side>
+  [[nodiscard]] static bool touchesBestLevel(const Ladder<Side, Level>& ladder,
+                                             const std::vector<Level>& priceLevelUpdates) {
+    return !priceLevelUpdates.empty() &&
+           (ladder.size() == 0 || !Side::isBetter(ladder[0].price, priceLevelUpdates.front().price));
+  }
+
+  template <typename Side>
+  [[nodiscard]] PriceLevel getBestLevel(const Ladder<Side, Level>& ladder) const {
+    return ladder.size() == 0 ? PriceLevel{} : priceModel_.toPriceLevel(ladder[0]);
+  }
+
+  // Finds the best price of the side after the sorted (best-first) updates. The cold levels are worse than the levels
+  // of the ladder, so the levels of the side are the ladder followed by the cold store. Usually stops at the first
+  // levels.
+  template <typename Side>
+  [[nodiscard]] bool findBestPrice(const Ladder<Side, Level>& ladder, const ColdLadder<Side>& cold,
+                                   const std::vector<Level>& priceLevelUpdates, Price& bestPrice) const {
+    auto levelsNumber = ladder.size() + cold.size();
+    auto getLevel = [&ladder, &cold](std::size_t position) -> const Level& {
+      return position < ladder.size() ? ladder[position] : cold[position - ladder.size()];
+    };
+    std::size_t position = 0;
+    std::size_t u = 0;
+
+    while (position < levelsNumber || u < priceLevelUpdates.size()) {
+      if (u == priceLevelUpdates.size()) {
+        bestPrice = getLevel(position).price;
+
+        return true;
+      }
+
+      const auto& update = priceLevelUpdates[u];
+
+      if (position < levelsNumber && areEqualPrices(getLevel(position).price, update.price)) {
+        if (!isZeroPriceLevel(Level{update.price, getLevel(position).size + update.size, update.time})) {
+          bestPrice = update.price;
+
+          return true;
+        }
+
+        position++;
+        u++;
+      } else if (position < levelsNumber && Side::isBetter(getLevel(position).price, update.price)) {
+        bestPrice = getLevel(position).price;
+
+        return true;
+      } else {
+        if (!isZeroPriceLevel(update)) {
+          bestPrice = update.price;
+
+          return true;
+        }
+
+        u++;
+      }
+    }
+
+    return false;
+  }
+
+  // Routes the sorted (best-first) updates of one side by the price band around the best price after them: the cold
+  // store is changed in place, the updates of the ladder (including the demotions of its levels out of the band and the
+  // promotions of the cold levels into the band) are collected into the result (best-first). The work of the levels in
+  // the band doesn't depend on the size of the cold store.
+  template <typename Side>
+  void routeBandUpdates(const Ladder<Side, Level>& ladder, ColdLadder<Side>& cold,
+                        const std::vector<Level>& priceLevelUpdates, std::vector<Level>& result) const {
+    result.clear();
+
+    Price bestPrice{};
+    auto hasBest = findBestPrice(ladder, cold, priceLevelUpdates, bestPrice);
+    auto bestValue = priceModel_.toPriceLevel(Level{bestPrice}).price;
+    auto width = band_.width + band_.percent / 100.0 * std::abs(bestValue);
+    auto isInBand = [this, hasBest, bestValue, width](Price price) {
+      if (!hasBest) {
+        return false;
+      }
+
+      // The NaN prices have no distance
+      if (!std::isfinite(bestValue)) {
+        return true;
+      }
+
+      return std::abs(priceModel_.toPriceLevel(Level{price}).price - bestValue) <= width * (1.0 + 1e-9);
+    };
+    // The cold levels are worse than the ladder, so the better prices are not searched in the cold store and vice versa
+    auto findCold = [&cold](Price price) {
+      return cold.empty() || Side::isBetter(price, cold[0].price) ? cold.size() : cold.find(price);
+    };
+    auto findInLadder = [&ladder](Price price) {
+      return ladder.empty() || Side::isBetter(ladder[ladder.size() - 1].price, price) ? ladder.size()
+                                                                                       : ladder.find(price);
+    };
+    auto isUpdated = [&priceLevelUpdates](Price price) {
+      auto found = std::lower_bound(priceLevelUpdates.begin(), priceLevelUpdates.end(), price,
+                                    [](const Level& pl, Price p) { return Side::isBetter(pl.price, p); });
+
+      return found != priceLevelUpdates.end() && areEqualPrices(found->price, price);
+    };
+    auto changeCold = [&cold, &findCold](const Level& change) {
+      if (auto found = findCold(change.price); found != cold.size()) {
+        auto level = Level{change.price, cold[found].size + change.size, change.time};
+
+        if (isZeroPriceLevel(level)) {
+          cold.erase(change.price);
+        } else {
+          cold.insert(level);
+        }
+      } else if (!isZeroPriceLevel(change)) {
+        cold.insert(change);
+      }
+    };
+
+    for (const auto& update : priceLevelUpdates) {
+      if (isInBand(update.price)) {
+        // The cold level is promoted with the update (or removed)
+        if (auto found = findCold(update.price); found != cold.size()) {
+          auto level = Level{update.price, cold[found].size + update.size, update.time};
+
+          if (!isZeroPriceLevel(level)) {
+            result.push_back(level);
+          }
+
+          cold.erase(update.price);
+        } else {
+          result.push_back(update);
+        }
+      } else if (auto found = findInLadder(update.price); found != ladder.size()) {
+        // The level of the ladder is demoted with the update
+        changeCold(Level{update.price, ladder[found].size + update.size, update.time});
+        result.push_back(Level{update.price, -ladder[found].size, update.time});
+      } else {
+        changeCold(update);
+      }
+    }
+
+    // The band moved towards the best price: the worst levels of the ladder are demoted
+    for (auto position = ladder.size(); position > 0 && !isInBand(ladder[position - 1].price); position--) {
+      const auto& level = ladder[position - 1];
+
+      if (!isUpdated(level.price)) {
+        cold.insert(level);
+        result.push_back(Level{level.price, -level.size, level.time});
+      }
+    }
+
+    // The band moved away from the best price: the best cold levels are promoted
+    while (!cold.empty() && isInBand(cold[0].price)) {
+      result.push_back(cold[0]);
+      cold.erase(cold[0].price);
+    }
+
+    std::sort(result.begin(), result.end(), Side{});
+  }
+
+ public:
+  // The default minimal number of the updates of the side that are merged in one pass (see setMergeThreshold)
+  static constexpr std::size_t DEFAULT_MERGE_THRESHOLD = 32;
+
+  explicit PriceLevelBookEngine(std::size_t levelsNumber = 0, PriceModel priceModel = {})
+      : levelsNumber_{FIXED_DEPTH != 0 ? FIXED_DEPTH : levelsNumber},
+        priceModel_{priceModel},
+        mergeThreshold_{DEFAULT_MERGE_THRESHOLD} {}
+
+  // Prepares the order index for the given number of the live orders
+  void reserveOrders(std::size_t ordersNumber) { orderDataSnapshot_.reserve(ordersNumber); }
+
+  void clear() {
+    asks_.clear();
+    bids_.clear();
+    coldAsks_.clear();
+    coldBids_.clear();
+    orderDataSnapshot_.clear();
+    askScratch_.deltas.clear();
+    bidScratch_.deltas.clear();
+    topOfBook_ = {};
+    isTopOfBookChanged_ = false;
+  }
+
+  // Forgets the live orders, but keeps the levels and accumulates their removal (until the takeUpdates() call). So the
+  // updates of the new snapshot that follows are the net changes from the old book to the new one.
+  void forgetOrders() {
+    orderDataSnapshot_.clear();
+    askScratch_.deltas.clear();
+    bidScratch_.deltas.clear();
+
+    for (const auto& pl : asks_) {
+      askScratch_.deltas.add(Level{pl.price, -pl.size, pl.time});
+    }
+
+    for (const auto& pl : bids_) {
+      bidScratch_.deltas.add(Level{pl.price, -pl.size, pl.time});
+    }
+
+    for (const auto& pl : coldAsks_) {
+      askScratch_.deltas.add(Level{pl.price, -pl.size, pl.time});
+    }
+
+    for (const auto& pl : coldBids_) {
+      bidScratch_.deltas.add(Level{pl.price, -pl.size, pl.time});
+    }
+  }
+
+  // The number of the live orders and the call of the f with the OrderData of every one (e.g. to write the checkpoint)
+  [[nodiscard]] std::size_t getOrdersNumber() const { return orderDataSnapshot_.size(); }
+
+  template <typename F>
+  void forEachOrder(F&& f) const {
+    orderDataSnapshot_.forEach(std::forward<F>(f));
+  }
+
+  // Copies the whole ladders (the levels beyond the number of the levels and the cold levels out of the price band
+  // too), the best first
+  void copyLadders(std::vector<PriceLevel>& asks, std::vector<PriceLevel>& bids) const {
+    toPriceLevels(asks_.begin(), asks_.end(), asks);
+    toPriceLevels(bids_.begin(), bids_.end(), bids);
+
+    for (const auto& pl : coldAsks_) {
+      asks.push_back(priceModel_.toPriceLevel(pl));
+    }
+
+    for (const auto& pl : coldBids_) {
+      bids.push_back(priceModel_.toPriceLevel(pl));
+    }
+  }
+
+  // Replaces the state with the live orders (the values with the index, the price, the size and the side) and the whole
+  // ladders (the best first), e.g. of the checkpoint. The changes are not reported.
+  template <typename Orders, typename Levels>
+  void restore(const Orders& orders, const Levels& asks, const Levels& bids) {
+    clear();
+    orderDataSnapshot_.reserve(std::size(orders));
+
+    for (const auto& order : orders) {
+      orderDataSnapshot_.insert(
+        OrderData{order.index, order.price, order.size, static_cast<dxf_order_side_t>(order.side)});
+    }
+
+    updates_.asks.clear();
+    updates_.bids.clear();
+
+    for (const auto& pl : asks) {
+      updates_.asks.push_back(Level{priceModel_.toPrice(pl.price), pl.size, pl.time});
+    }
+
+    for (const auto& pl : bids) {
+      updates_.bids.push_back(Level{priceModel_.toPrice(pl.price), pl.size, pl.time});
+    }
+
+    applyUpdates(updates_);
+  }
+
+  // Process the tx\snapshot order records and accumulates their PL changes until the takeUpdates() call. Also, changes
+  // the orderDataSnapshot_. The records of one transaction can be accumulated in several calls. The records are the
+  // dxf_order_t or the OrderRecord.
+  template <typename Record>
+  void accumulateOrders(const Record* orders, std::size_t recordsCount) {
+    auto& askDeltas = askScratch_.deltas;
+    auto& bidDeltas = bidScratch_.deltas;
+
+    auto isOrderRemoval = [](const Record& o) {
+      return (o.event_flags & dxf_ef_remove_event) != 0 || o.size == 0 || std::isnan(o.size);
+    };
+
+    auto processOrderAddition = [this, &bidDeltas, &askDeltas](const Record& order) {
+      auto priceLevelChange = Level{priceModel_.toPrice(order.price), order.size, order.time};
+
+      if (order.side == dxf_osd_buy) {
+        bidDeltas.add(priceLevelChange);
+      } else {
+        askDeltas.add(priceLevelChange);
+      }
+    };
+
+    auto processOrderRemoval = [this, &bidDeltas, &askDeltas](const Record& order, const OrderData& foundOrderData) {
+      auto priceLevelChange = Level{priceModel_.toPrice(foundOrderData.price), -foundOrderData.size, order.time};
+
+      if (foundOrderData.side == dxf_osd_buy) {
+        bidDeltas.add(priceLevelChange);
+      } else {
+        askDeltas.add(priceLevelChange);
+      }
+    };
+
+    for (std::size_t i = 0; i < recordsCount; i++) {
+      const auto& order = orders[i];
+      auto removal = isOrderRemoval(order);
+      auto foundOrderData = orderDataSnapshot_.find(order.index);
+
+      if (foundOrderData == nullptr) {
+        if (removal) {
+          continue;
+        }
+
+        processOrderAddition(order);
+        orderDataSnapshot_.insert(OrderData{order.index, order.price, order.size, order.side});
+      } else {
+        if (removal) {
+          processOrderRemoval(order, *foundOrderData);
+          orderDataSnapshot_.erase(order.index);
+        } else {
+          // The order is replaced: its old size leaves its old level (of any side)
+          processOrderRemoval(order, *foundOrderData);
+          processOrderAddition(order);
+          *foundOrderData = OrderData{order.index, order.price, order.size, order.side};
+        }
+      }
+    }
+  }
+
+  // Converts the accumulated changes to PL changes (best-first, in the internal price representation) and starts a new
+  // accumulation. The result is valid until the next call.
+  const LevelChanges& takeUpdates() {
+    const auto& askUpdates = askScratch_.deltas.merge();
+    const auto& bidUpdates = bidScratch_.deltas.merge();
+
+    updates_.asks.assign(askUpdates.begin(), askUpdates.end());
+    updates_.bids.assign(bidUpdates.begin(), bidUpdates.end());
+    askScratch_.deltas.clear();
+    bidScratch_.deltas.clear();
+
+    return updates_;
+  }
+
+  // Process the tx\snapshot order records, converts them to PL changes (best-first, in the internal price
+  // representation). Also, changes the orderDataSnapshot_
+  //
+  // The result is valid until the next call.
+  const LevelChanges& convertToUpdates(const dxf_order_t* orders, std::size_t recordsCount) {
+    assert(recordsCount != 0);
+
+    accumulateOrders(orders, recordsCount);
+
+    return takeUpdates();
+  }
+
+  // Applies the updates and returns the resulting visible changes. The result is valid until the next call.
+  const PriceLevelChangesSet& applyUpdates(const LevelChanges& updates) {
+    if (band_.isEnabled()) {
+      routeBandUpdates(asks_, coldAsks_, updates.asks, bandUpdates_.asks);
+      routeBandUpdates(bids_, coldBids_, updates.bids, bandUpdates_.bids);
+    }
+
+    const auto& priceLevelUpdates = band_.isEnabled() ? bandUpdates_ : updates;
+    auto isAskTouched = touchesBestLevel(asks_, priceLevelUpdates.asks);
+    auto isBidTouched = touchesBestLevel(bids_, priceLevelUpdates.bids);
+
+    applySideUpdates(asks_, askScratch_, priceLevelUpdates.asks, changes_.additions.asks, changes_.updates.asks,
+                     changes_.removals.asks, askDepthSize_);
+    applySideUpdates(bids_, bidScratch_, priceLevelUpdates.bids, changes_.additions.bids, changes_.updates.bids,
+                     changes_.removals.bids, bidDepthSize_);
+
+    isTopOfBookChanged_ = false;
+
+    if (isAskTouched || isBidTouched) {
+      auto previous = topOfBook_;
+
+      topOfBook_.ask = getBestLevel(asks_);
+      topOfBook_.bid = getBestLevel(bids_);
+      isTopOfBookChanged_ = !topOfBook_.isSameAs(previous);
+    }
+
+    return changes_;
+  }
+
+  // The best levels of both sides, O(1)
+  [[nodiscard]] const TopOfBook& getTopOfBook() const { return topOfBook_; }
+
+  // The last applyUpdates has changed the price or the size of the best level of any side
+  [[nodiscard]] bool isTopOfBookChanged() const { return isTopOfBookChanged_; }
+
+  [[nodiscard]] std::vector<PriceLevel> getAsks() const {
+    std::vector<PriceLevel> result{};
+
+    getLevels(asks_, result);
+
+    return result;
+  }
+
+  [[nodiscard]] std::vector<PriceLevel> getBids() const {
+    std::vector<PriceLevel> result{};
+
+    getLevels(bids_, result);
+
+    return result;
+  }
+
+  // Returns the visible levels of both sides collected into the reusable buffer. The result is valid until the next
+  // call.
+  const PriceLevelChanges& getBook() {
+    getLevels(asks_, book_.asks);
+    getLevels(bids_, book_.bids);
+
+    return book_;
+  }
+
+  // Returns the non-owning view of the visible levels. It is valid until the next change of the engine.
+  [[nodiscard]] PriceLevelBookView getBookView() const {
+    return {PriceLevelSideView{this, getVisibleSize(asks_),
+                               [](const void* engine, std::size_t position) {
+                                 auto self = static_cast<const PriceLevelBookEngine*>(engine);
+
+                                 return self->priceModel_.toPriceLevel(self->asks_[position]);
+                               }},
+            PriceLevelSideView{this, getVisibleSize(bids_), [](const void* engine, std::size_t position) {
+                                 auto self = static_cast<const PriceLevelBookEngine*>(engine);
+
+                                 return self->priceModel_.toPriceLevel(self->bids_[position]);
+                               }}};
+  }
+
+  // Publishes the full depth of the ladders (not limited by the number of the visible levels, but limited by the price
+  // band) after the apply of the updates (see applyUpdates): the levels of the prices of the updates are set or
+  // removed, the new book replaces all levels.
+  void publishFullDepth(FullDepthPriceLevels& levels, const LevelChanges& updates, bool isNewBook) const {
+    const auto& appliedUpdates = band_.isEnabled() ? bandUpdates_ : updates;
+
+    levels.beginUpdate();
+
+    if (isNewBook) {
+      levels.rebuild(
+        {PriceLevelSideView{this, asks_.size(),
+                            [](const void* engine, std::size_t position) {
+                              auto self = static_cast<const PriceLevelBookEngine*>(engine);
+
+                              return self->priceModel_.toPriceLevel(self->asks_[position]);
+                            }},
+         PriceLevelSideView{this, bids_.size(), [](const void* engine, std::size_t position) {
+                              auto self = static_cast<const PriceLevelBookEngine*>(engine);
+
+                              return self->priceModel_.toPriceLevel(self->bids_[position]);
+                            }}});
+    } else {
+      publishFullDepthSide(levels, asks_, appliedUpdates.asks, false);
+      publishFullDepthSide(levels, bids_, appliedUpdates.bids, true);
+    }
+
+    levels.publish();
+  }
+
+  // Adds the level deltas of the updates (see takeUpdates, all levels of the book, not limited by the price band) to
+  // the grouped view
+  void groupUpdates(GroupedPriceLevels& view, const LevelChanges& updates) const {
+    for (const auto& update : updates.asks) {
+      view.addDelta(false, priceModel_.toPriceLevel(update));
+    }
+
+    for (const auto& update : updates.bids) {
+      view.addDelta(true, priceModel_.toPriceLevel(update));
+    }
+  }
+
+  [[nodiscard]] std::size_t getLevelsNumber() const { return levelsNumber_; }
+
+  // Sets the price band of the ladders (the empty band - all levels). Is called before the first updates.
+  void setPriceBand(const PriceLevelBand& band) { band_ = band; }
+
+  [[nodiscard]] const PriceLevelBand& getPriceBand() const { return band_; }
+
+  // The number of the levels of both sides out of the price band
+  [[nodiscard]] std::size_t getColdLevelsNumber() const { return coldAsks_.size() + coldBids_.size(); }
+
+  // Sets the minimal number of the updates of the side (and at least 1/16 of its levels) that are merged into the
+  // ladder in one pass instead of the level by level apply (SIZE_MAX - never, e.g. for the comparison)
+  void setMergeThreshold(std::size_t updatesNumber) { mergeThreshold_ = updatesNumber; }
+
+  [[nodiscard]] std::size_t getMergeThreshold() const { return mergeThreshold_; }
+
+  // Enables the incremental analytics of the best levels within the depth (0 - disables them)
+  void setAnalyticsDepth(std::size_t depth) {
+    analyticsDepth_ = depth;
+    recomputeAnalytics();
+  }
+
+  [[nodiscard]] std::size_t getAnalyticsDepth() const { return analyticsDepth_; }
+
+  // Recomputes the running sums of the analytics from the levels (drops the accumulated rounding errors), O(depth)
+  void recomputeAnalytics() {
+    askDepthSize_ = computeDepthSize(asks_);
+    bidDepthSize_ = computeDepthSize(bids_);
+  }
+
+  // The analytics in O(1) (the sums are 0 if the analytics are disabled)
+  [[nodiscard]] PriceLevelBookAnalytics getAnalytics() const {
+    PriceLevelBookAnalytics result{};
+
+    if (asks_.size() != 0) {
+      result.bestAsk = priceModel_.toPriceLevel(asks_[0]);
+    }
+
+    if (bids_.size() != 0) {
+      result.bestBid = priceModel_.toPriceLevel(bids_[0]);
+    }
+
+    result.askDepthSize = askDepthSize_;
+    result.bidDepthSize = bidDepthSize_;
+    result.askDepthLevels = (std::min)(asks_.size(), analyticsDepth_);
+    result.bidDepthLevels = (std::min)(bids_.size(), analyticsDepth_);
+
+    return result;
+  }
+
+  [[nodiscard]] PriceLevelBookMemoryUsage getMemoryUsage() const {
+    auto getScratchMemoryUsage = [](const auto& scratch) {
+      return scratch.deltas.getMemoryUsage() +
+             (scratch.additions.capacity() + scratch.updates.capacity() + scratch.removals.capacity() +
+              scratch.merged.capacity()) *
+               sizeof(Level) +
+             scratch.resultingAdditions.getMemoryUsage() + scratch.resultingUpdates.getMemoryUsage() +
+             scratch.resultingRemovals.getMemoryUsage();
+    };
+    auto getChangesMemoryUsage = [](const auto& changes) {
+      return (changes.asks.capacity() + changes.bids.capacity()) * sizeof(changes.asks.front());
+    };
+
+    return {asks_.getMemoryUsage() + bids_.getMemoryUsage() + coldAsks_.getMemoryUsage() + coldBids_.getMemoryUsage(),
+            orderDataSnapshot_.getMemoryUsage(),
+            getScratchMemoryUsage(askScratch_) + getScratchMemoryUsage(bidScratch_) + getChangesMemoryUsage(updates_) +
+              getChangesMemoryUsage(changes_.additions) + getChangesMemoryUsage(changes_.updates) +
+              getChangesMemoryUsage(changes_.removals) + getChangesMemoryUsage(book_) +
+              getChangesMemoryUsage(bandUpdates_)};
+  }
+};
+
+#if DXFCXX_EXTERN_TEMPLATES
+extern template class PriceLevelBookEngine<MultiIndexPriceLevelLadder>;
+extern template class PriceLevelBookEngine<FlatPriceLevelLadder>;
+extern template class PriceLevelBookEngine<FixedDepthPriceLevelLadder<5>::Type>;
+extern template class PriceLevelBookEngine<FixedDepthPriceLevelLadder<10>::Type>;
+extern template class PriceLevelBookEngine<FixedDepthPriceLevelLadder<20>::Type>;
+extern template class PriceLevelBookEngine<MultiIndexPriceLevelLadder, TickPriceModel>;
+extern template class PriceLevelBookEngine<FlatPriceLevelLadder, TickPriceModel>;
+extern template class PriceLevelBookEngine<FixedDepthPriceLevelLadder<5>::Type, TickPriceModel>;
+extern template class PriceLevelBookEngine<FixedDepthPriceLevelLadder<10>::Type, TickPriceModel>;
+extern template class PriceLevelBookEngine<FixedDepthPriceLevelLadder<20>::Type, TickPriceModel>;
+#endif
+
+}  // namespace dxf
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "PriceLevel.hpp"
+
+namespace dxf {
+
+// The history of the visible levels of one book in the fixed memory: the ring of the deltas (PriceLevelChangesSet)
+// with the keyframes (the whole visible book) after every keyframeInterval deltas and at every new book. The book at
+// any time of the window is restored from one keyframe and at most keyframeInterval deltas. When the ring is full, the
+// oldest keyframe is evicted with its deltas, so the window is the last minutes that fit the budget.
+//
+// The records are written by the book (under its mutex), the queries are made from any thread (the history has its own
+// mutex, the restore doesn't block the book).
+class PriceLevelBookHistory final {
+  // The record: the header and the levels (the keyframe: asks, bids; the delta: the additions, the updates and the
+  // removals of the asks and the bids)
+  struct RecordHeader {
+    std::int64_t time;
+    std::uint32_t isKeyframe;
+    std::uint32_t counts[6];
+  };
+
+  struct Entry {
+    std::int64_t time;
+    std::size_t offset;
+    std::size_t size;
+    bool isKeyframe;
+  };
+
+  static constexpr std::size_t KEYFRAME_PARTS = 2;
+  static constexpr std::size_t DELTA_PARTS = 6;
+
+  std::vector<std::byte> buffer_;
+  std::size_t keyframeInterval_;
+  std::deque<Entry> entries_;
+  // The visible levels after the last record (the source of the periodic keyframes)
+  PriceLevelChanges book_;
+  std::size_t deltasSinceKeyframe_;
+  std::int64_t lastTime_;
+  std::uint64_t recordsNumber_;
+  std::uint64_t evictedNumber_;
+  // The records that don't fit the whole budget
+  std::uint64_t droppedNumber_;
+  mutable std::mutex mutex_;
+
+  template <typename Side>
+  static void apply(std::vector<PriceLevel>& levels, const PriceLevel* removals, std::size_t removalsNumber,
+                    const PriceLevel* additions, std::size_t additionsNumber, const PriceLevel* updates,
+                    std::size_t updatesNumber) {
+    auto find = [&levels](double price) {
+      return std::partition_point(levels.begin(), levels.end(),
+                                  [price](const PriceLevel& pl) { return Side::isBetter(pl.price, price); });
+    };
+    auto isFound = [&levels](auto it, double price) {
+      return it != levels.end() && (it->price == price || (std::isnan(it->price) && std::isnan(price)));
+    };
+
+    for (std::size_t i = 0; i < removalsNumber; i++) {
+      auto it = find(removals[i].price);
+
+      if (isFound(it, removals[i].price)) {
+        levels.erase(it);
+      }
+    }
+
+    auto upsert = [&](const PriceLevel& level) {
+      auto it = find(level.price);
+
+      if (isFound(it, level.price)) {
+        *it = level;
+      } else {
+        levels.insert(it, level);
+      }
+    };
+
+    for (std::size_t i = 0; i < additionsNumber; i++) {
+      upsert(additions[i]);
+    }
+
+    for (std::size_t i = 0; i < updatesNumber; i++) {
+      upsert(updates[i]);
+    }
+  }
+
+  static void applyDelta(PriceLevelChanges& book, const RecordHeader& header, const PriceLevel* levels) {
+    const auto* askAdditions = levels;
+    const auto* bidAdditions = askAdditions + header.counts[0];
+    const auto* askUpdates = bidAdditions + header.counts[1];
+    const auto* bidUpdates = askUpdates + header.counts[2];
+    const auto* askRemovals = bidUpdates + header.counts[3];
+    const auto* bidRemovals = askRemovals + header.counts[4];
+
+    apply<AskSide>(book.asks, askRemovals, header.counts[4], askAdditions, header.counts[0], askUpdates,
+                   header.counts[2]);
+    apply<BidSide>(book.bids, bidRemovals, header.counts[5], bidAdditions, header.counts[1], bidUpdates,
+                   header.counts[3]);
+  }
+
+  // Evicts the oldest keyframe and its deltas
+  void evictSegment() {
+    do {
+      entries_.pop_front();
+      evictedNumber_++;
+    } while (!entries_.empty() && !entries_.front().isKeyframe);
+  }
+
+  // Finds the place of the record of the size, evicts the oldest segments that overlap it. Returns false if the
+  // record is greater than the buffer.
+  bool allocate(std::size_t size, std::size_t& offset) {
+    if (size > buffer_.size()) {
+      return false;
+    }
+
+    while (!entries_.empty()) {
+      auto head = entries_.front().offset;
+      auto tail = entries_.back().offset + entries_.back().size;
+
+      if (tail > head) {
+        // Not wrapped: the free space is after the tail and before the head
+        if (buffer_.size() - tail >= size) {
+          offset = tail;
+
+          return true;
+        }
+
+        if (head >= size) {
+          offset = 0;
+
+          return true;
+        }
+      } else if (head - tail >= size) {
+        offset = tail;
+
+        return true;
+      }
+
+      evictSegment();
+    }
+
+    offset = 0;
+
+    return true;
+  }
+
+  template <std::size_t N>
+  bool append(std::int64_t time, bool isKeyframe, const std::vector<PriceLevel>* const (&parts)[N]) {
+    RecordHeader header{time, isKeyframe ? 1u : 0u, {}};
+    auto size = sizeof(RecordHeader);
+
+    for (std::size_t i = 0; i < N; i++) {
+      header.counts[i] = static_cast<std::uint32_t>(parts[i]->size());
+      size += parts[i]->size() * sizeof(PriceLevel);
+    }
+
+    std::size_t offset = 0;
+
+    if (!allocate(size, offset)) {
+      droppedNumber_++;
+
+      return false;
+    }
+
+    // The delta without its keyframe (evicted to fit the delta) is useless
+    if (!isKeyframe && entries_.empty()) {
+      return false;
+    }
+
+    auto* data = buffer_.data() + offset;
+
+    std::memcpy(data, &header, sizeof(RecordHeader));
+    data += sizeof(RecordHeader);
+
+    for (std::size_t i = 0; i < N; i++) {
+      if (!parts[i]->empty()) {
+        std::memcpy(data, parts[i]->data(), parts[i]->size() * sizeof(PriceLevel));
+        data += parts[i]->size() * sizeof(PriceLevel);
+      }
+    }
+
+    entries_.push_back({time, offset, size, isKeyframe});
+    recordsNumber_++;
+
+    return true;
+  }
+
+  void appendKeyframe(std::int64_t time) {
+    const std::vector<PriceLevel>* const parts[KEYFRAME_PARTS] = {&book_.asks, &book_.bids};
+
+    // The later deltas can't be restored from the earlier keyframes
+    if (!append(time, true, parts)) {
+      evictedNumber_ += entries_.size();
+      entries_.clear();
+    }
+
+    deltasSinceKeyframe_ = 0;
+  }
+
+  // The times never move back (e.g. the corrections of the system clock), so the entries are ordered by the time
+  std::int64_t toRecordTime(std::int64_t time) {
+    lastTime_ = (std::max)(lastTime_, time);
+
+    return lastTime_;
+  }
+
+  [[nodiscard]] RecordHeader getHeader(const Entry& entry) const {
+    RecordHeader header{};
+
+    std::memcpy(&header, buffer_.data() + entry.offset, sizeof(RecordHeader));
+
+    return header;
+  }
+
+  [[nodiscard]] const PriceLevel* getLevels(const Entry& entry) const {
+    return reinterpret_cast<const PriceLevel*>(buffer_.data() + entry.offset + sizeof(RecordHeader));
+  }
+
+ public:
+  // memoryBudget - the size of the ring of the records (bytes), keyframeInterval - the maximum number of the deltas
+  // between the keyframes (the maximum number of the deltas applied by the restore)
+  explicit PriceLevelBookHistory(std::size_t memoryBudget, std::size_t keyframeInterval = 64)
+      : buffer_(memoryBudget / alignof(PriceLevel) * alignof(PriceLevel)),
+        keyframeInterval_{(std::max)(keyframeInterval, std::size_t{1})},
+        entries_{},
+        book_{},
+        deltasSinceKeyframe_{0},
+        lastTime_{0},
+        recordsNumber_{0},
+        evictedNumber_{0},
+        droppedNumber_{0},
+        mutex_{} {}
+
+  PriceLevelBookHistory(const PriceLevelBookHistory&) = delete;
+  PriceLevelBookHistory& operator=(const PriceLevelBookHistory&) = delete;
+
+  // Records the new book (the keyframe). time - the time of the book (ms since the epoch)
+  void recordNewBook(std::int64_t time, const PriceLevelChanges& book) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    book_.asks = book.asks;
+    book_.bids = book.bids;
+    appendKeyframe(toRecordTime(time));
+  }
+
+  // Records the changes of the visible levels. The keyframe is written instead of the delta after keyframeInterval
+  // deltas or when the keyframe of the delta has been evicted.
+  void recordChanges(std::int64_t time, const PriceLevelChangesSet& changes) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    time = toRecordTime(time);
+
+    apply<AskSide>(book_.asks, changes.removals.asks.data(), changes.removals.asks.size(),
+                   changes.additions.asks.data(), changes.additions.asks.size(), changes.updates.asks.data(),
+                   changes.updates.asks.size());
+    apply<BidSide>(book_.bids, changes.removals.bids.data(), changes.removals.bids.size(),
+                   changes.additions.bids.data(), changes.additions.bids.size(), changes.updates.bids.data(),
+                   changes.updates.bids.size());
+
+    if (entries_.empty() || deltasSinceKeyframe_ >= keyframeInterval_) {
+      appendKeyframe(time);
+
+      return;
+    }
+
+    const std::vector<PriceLevel>* const parts[DELTA_PARTS] = {
+      &changes.additions.asks, &changes.additions.bids, &changes.updates.asks,
+      &changes.updates.bids,   &changes.removals.asks,  &changes.removals.bids};
+
+    if (append(time, false, parts)) {
+      deltasSinceKeyframe_++;
+    } else {
+      appendKeyframe(time);
+    }
+  }
+
+  // Restores the visible levels of the book at the time (after all records of the time and before it). Returns false
+  // if the time is before the window (or nothing is recorded).
+  bool getBookAt(std::int64_t time, PriceLevelChanges& result) const {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (entries_.empty() || time < entries_.front().time) {
+      return false;
+    }
+
+    // The last record of the time
+    auto last = static_cast<std::size_t>(
+      std::upper_bound(entries_.begin(), entries_.end(), time,
+                       [](std::int64_t t, const Entry& entry) { return t < entry.time; }) -
+      entries_.begin() - 1);
+    auto keyframe = last;
+
+    while (!entries_[keyframe].isKeyframe) {
+      keyframe--;
+    }
+
+    auto header = getHeader(entries_[keyframe]);
+    const auto* levels = getLevels(entries_[keyframe]);
+
+    result.asks.assign(levels, levels + header.counts[0]);
+    result.bids.assign(levels + header.counts[0], levels + header.counts[0] + header.counts[1]);
+
+    for (auto i = keyframe + 1; i <= last; i++) {
+      applyDelta(result, getHeader(entries_[i]), getLevels(entries_[i]));
+    }
+
+    return true;
+  }
+
+  // The times of the oldest and the newest records (0, 0 - nothing is recorded)
+  [[nodiscard]] std::pair<std::int64_t, std::int64_t> getWindow() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (entries_.empty()) {
+      return {0, 0};
+    }
+
+    return {entries_.front().time, entries_.back().time};
+  }
+
+  [[nodiscard]] std::size_t getMemoryBudget() const { return buffer_.size(); }
+
+  // The numbers of the written, the evicted and the dropped (greater than the budget) records
+  [[nodiscard]] std::uint64_t getRecordsNumber() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return recordsNumber_;
+  }
+
+  [[nodiscard]] std::uint64_t getEvictedNumber() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return evictedNumber_;
+  }
+
+  [[nodiscard]] std::uint64_t getDroppedNumber() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return droppedNumber_;
+  }
+};
+
+}  // namespace dxf
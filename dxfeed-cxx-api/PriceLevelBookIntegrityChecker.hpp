@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Clock.hpp"
+#include "Metrics.hpp"
+#include "PriceLevel.hpp"
+
+namespace dxf {
+
+// The mismatch of the incrementally maintained ladders of the book with the ones rebuilt from its live orders
+struct PriceLevelBookIntegrityMismatch {
+  std::string symbol{};
+  std::string source{};
+  // The number of the transactions applied by the book when it was sampled
+  std::uint64_t transactionsNumber = 0;
+  // true - the ask side
+  bool isAsk = false;
+  // The first mismatching position (the best first) and the levels at it (NaN - there is no level at the position)
+  std::size_t position = 0;
+  PriceLevel incremental{};
+  PriceLevel rebuilt{};
+};
+
+// Checks that the incremental ladders of the books match the full recomputation. Every transactionsInterval
+// transactions or every timeInterval (whichever comes first) the book copies its live orders and its whole ladders at
+// the transaction boundary into the reusable sample buffer (the only cost of the check on the hot path) and hands it
+// off to the thread of the checker, which rebuilds the ladders from the orders and compares them. If the checker is
+// busy with the other samples, the sample is skipped. The books use the checker by the
+// PriceLevelBookConfig::integrityChecker and must be destroyed before it.
+class PriceLevelBookIntegrityChecker final {
+ public:
+  // The state of the book at the transaction boundary
+  struct Sample {
+    std::string symbol{};
+    std::string source{};
+    std::uint64_t transactionsNumber = 0;
+    std::vector<OrderData> orders{};
+    std::vector<PriceLevel> asks{};
+    std::vector<PriceLevel> bids{};
+  };
+
+ private:
+  // The sizes of the levels are the sums of the deltas, so they may differ from the rebuilt ones by the rounding
+  static constexpr double RELATIVE_TOLERANCE = 1e-9;
+
+  std::size_t transactionsInterval_;
+  std::chrono::steady_clock::duration timeInterval_;
+  std::function<void(const PriceLevelBookIntegrityMismatch&)> onMismatch_;
+  std::size_t samplesNumber_;
+  // Guards the samples and the stop
+  std::mutex mutex_;
+  std::condition_variable sampleCondition_;
+  std::condition_variable checkedCondition_;
+  std::vector<std::unique_ptr<Sample>> freeSamples_;
+  std::deque<std::unique_ptr<Sample>> submittedSamples_;
+  bool stop_;
+  std::atomic<std::uint64_t> checksNumber_;
+  std::atomic<std::uint64_t> mismatchesNumber_;
+  std::atomic<std::uint64_t> skippedNumber_;
+  std::vector<PriceLevel> rebuiltAsks_;
+  std::vector<PriceLevel> rebuiltBids_;
+  std::thread worker_;
+
+  static bool areClose(double a, double b) {
+    return std::abs(a - b) <= RELATIVE_TOLERANCE * (std::max)({1.0, std::abs(a), std::abs(b)});
+  }
+
+  // Sums the sizes of the orders of the side by the price (the prices that differ by the rounding are one level)
+  template <typename IsBetter>
+  static void rebuild(const std::vector<OrderData>& orders, bool isBuy, IsBetter isBetter,
+                      std::vector<PriceLevel>& result) {
+    result.clear();
+
+    for (const auto& order : orders) {
+      if ((order.side == dxf_osd_buy) == isBuy) {
+        result.push_back(PriceLevel{order.price, order.size, 0});
+      }
+    }
+
+    std::sort(result.begin(), result.end(), [&isBetter](const PriceLevel& a, const PriceLevel& b) {
+      return isBetter(a.price, b.price);
+    });
+
+    std::size_t size = 0;
+
+    for (const auto& pl : result) {
+      if (size != 0 && areClose(result[size - 1].price, pl.price)) {
+        result[size - 1].size += pl.size;
+      } else {
+        result[size++] = pl;
+      }
+    }
+
+    result.resize(size);
+    result.erase(
+      std::remove_if(result.begin(), result.end(), [](const PriceLevel& pl) { return isZeroPriceLevel(pl); }),
+      result.end());
+  }
+
+  bool compare(const Sample& sample, bool isAsk, const std::vector<PriceLevel>& incremental,
+               const std::vector<PriceLevel>& rebuilt) {
+    auto size = (std::max)(incremental.size(), rebuilt.size());
+
+    for (std::size_t i = 0; i < size; i++) {
+      auto incrementalLevel = i < incremental.size() ? incremental[i] : PriceLevel{};
+      auto rebuiltLevel = i < rebuilt.size() ? rebuilt[i] : PriceLevel{};
+
+      if (i < incremental.size() && i < rebuilt.size() && areClose(incrementalLevel.price, rebuiltLevel.price) &&
+          areClose(incrementalLevel.size, rebuiltLevel.size)) {
+        continue;
+      }
+
+      mismatchesNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      if (onMismatch_) {
+        onMismatch_(PriceLevelBookIntegrityMismatch{sample.symbol, sample.source, sample.transactionsNumber, isAsk, i,
+                                                    incrementalLevel, rebuiltLevel});
+      }
+
+      return false;
+    }
+
+    return true;
+  }
+
+  void check(const Sample& sample) {
+    rebuild(sample.orders, false, [](double a, double b) { return a < b; }, rebuiltAsks_);
+    rebuild(sample.orders, true, [](double a, double b) { return a > b; }, rebuiltBids_);
+
+    // One mismatch is reported per side
+    compare(sample, true, sample.asks, rebuiltAsks_);
+    compare(sample, false, sample.bids, rebuiltBids_);
+    checksNumber_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lk(mutex_);
+
+    while (true) {
+      sampleCondition_.wait(lk, [this] { return stop_ || !submittedSamples_.empty(); });
+
+      if (submittedSamples_.empty()) {
+        return;
+      }
+
+      auto sample = std::move(submittedSamples_.front());
+
+      submittedSamples_.pop_front();
+      lk.unlock();
+      check(*sample);
+      lk.lock();
+      freeSamples_.push_back(std::move(sample));
+      checkedCondition_.notify_all();
+    }
+  }
+
+ public:
+  // transactionsInterval - sample every book after this number of its transactions (0 - by the time only).
+  // timeInterval - sample every book at its first transaction after this time since its last sample (0 - by the number
+  // only). samplesNumber - the number of the samples that can be checked or queued at once (the memory of every one is
+  // the copy of the book). onMismatch - is called on the thread of the checker.
+  PriceLevelBookIntegrityChecker(std::size_t transactionsInterval, std::chrono::milliseconds timeInterval,
+                                 std::size_t samplesNumber = 2,
+                                 std::function<void(const PriceLevelBookIntegrityMismatch&)> onMismatch = {})
+      : transactionsInterval_{transactionsInterval},
+        timeInterval_{timeInterval},
+        onMismatch_{std::move(onMismatch)},
+        samplesNumber_{(std::max)(samplesNumber, std::size_t{1})},
+        mutex_{},
+        sampleCondition_{},
+        checkedCondition_{},
+        freeSamples_{},
+        submittedSamples_{},
+        stop_{false},
+        checksNumber_{0},
+        mismatchesNumber_{0},
+        skippedNumber_{0},
+        rebuiltAsks_{},
+        rebuiltBids_{},
+        worker_{} {
+    for (std::size_t i = 0; i < samplesNumber_; i++) {
+      freeSamples_.push_back(std::make_unique<Sample>());
+    }
+
+    worker_ = std::thread([this] { run(); });
+  }
+
+  PriceLevelBookIntegrityChecker(const PriceLevelBookIntegrityChecker&) = delete;
+  PriceLevelBookIntegrityChecker& operator=(const PriceLevelBookIntegrityChecker&) = delete;
+
+  // The submitted samples are checked before the stop
+  ~PriceLevelBookIntegrityChecker() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+
+      stop_ = true;
+    }
+
+    sampleCondition_.notify_one();
+    worker_.join();
+  }
+
+  // Returns true if the book that has applied the transactionsSinceSample transactions since its last sample taken at
+  // the lastSampleTime is sampled now
+  [[nodiscard]] bool isDue(std::uint64_t transactionsSinceSample,
+                           std::chrono::steady_clock::time_point lastSampleTime) const {
+    return (transactionsInterval_ != 0 && transactionsSinceSample >= transactionsInterval_) ||
+           (timeInterval_.count() != 0 && Clock::getDefault().now() - lastSampleTime >= timeInterval_);
+  }
+
+  // Returns the free sample buffer for the book to fill, or nullptr if all of them are busy (the sample is skipped)
+  std::unique_ptr<Sample> acquire() {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (freeSamples_.empty()) {
+      skippedNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      return nullptr;
+    }
+
+    auto result = std::move(freeSamples_.back());
+
+    freeSamples_.pop_back();
+
+    return result;
+  }
+
+  // Hands off the filled sample to the thread of the checker
+  void submit(std::unique_ptr<Sample> sample) {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+
+      submittedSamples_.push_back(std::move(sample));
+    }
+
+    sampleCondition_.notify_one();
+  }
+
+  // Waits until the submitted samples are checked (e.g. before the report of the offline run)
+  void waitChecked() {
+    std::unique_lock<std::mutex> lk(mutex_);
+
+    checkedCondition_.wait(lk, [this] { return freeSamples_.size() == samplesNumber_; });
+  }
+
+  // The numbers of the checked samples, the mismatching sides and the samples skipped because the checker was busy
+  [[nodiscard]] std::uint64_t getChecksNumber() const { return checksNumber_.load(std::memory_order_relaxed); }
+
+  [[nodiscard]] std::uint64_t getMismatchesNumber() const { return mismatchesNumber_.load(std::memory_order_relaxed); }
+
+  [[nodiscard]] std::uint64_t getSkippedNumber() const { return skippedNumber_.load(std::memory_order_relaxed); }
+
+  void collectMetrics(MetricsWriter& writer, const MetricLabels& labels = {}) const {
+    writer.counter("dxf_book_integrity_checks_total", "The sampled books checked against the rebuild from the orders",
+                   labels, static_cast<double>(getChecksNumber()));
+    writer.counter("dxf_book_integrity_mismatches_total", "The ladders that don't match the rebuild from the orders",
+                   labels, static_cast<double>(getMismatchesNumber()));
+    writer.counter("dxf_book_integrity_skipped_total", "The samples skipped because the checker was busy", labels,
+                   static_cast<double>(getSkippedNumber()));
+  }
+};
+
+}  // namespace dxf
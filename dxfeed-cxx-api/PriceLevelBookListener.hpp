@@ -0,0 +1,97 @@
+#pragma once
+
+#include "PriceLevel.hpp"
+#include "PriceLevelBookView.hpp"
+
+namespace dxf {
+
+// The non-owning reference to the listener object whose handlers are known at compile time. The listener may have any
+// of the member functions:
+//
+//   void onNewBook(const PriceLevelChanges&)
+//   void onBookUpdate(const PriceLevelChanges&)
+//   void onBookUpdateView(const PriceLevelBookView&)
+//   void onIncrementalChange(const PriceLevelChangesSet&)
+//   void onTopOfBookChange(const TopOfBook&)
+//
+// Every present handler is called through the plain function pointer to the thunk that calls the member function
+// directly (so it is inlined into the thunk). The missing handlers are not called. Unlike std::function, the reference
+// never allocates and doesn't check the target type.
+class PriceLevelBookListenerRef final {
+  void* listener_ = nullptr;
+  void (*onNewBook_)(void*, const PriceLevelChanges&) = nullptr;
+  void (*onBookUpdate_)(void*, const PriceLevelChanges&) = nullptr;
+  void (*onBookUpdateView_)(void*, const PriceLevelBookView&) = nullptr;
+  void (*onIncrementalChange_)(void*, const PriceLevelChangesSet&) = nullptr;
+  void (*onTopOfBookChange_)(void*, const TopOfBook&) = nullptr;
+
+ public:
+  PriceLevelBookListenerRef() = default;
+
+  template <typename Listener>
+  explicit PriceLevelBookListenerRef(Listener& listener) : listener_{&listener} {
+    if constexpr (requires(Listener& l, const PriceLevelChanges& c) { l.onNewBook(c); }) {
+      onNewBook_ = [](void* l, const PriceLevelChanges& c) { static_cast<Listener*>(l)->onNewBook(c); };
+    }
+
+    if constexpr (requires(Listener& l, const PriceLevelChanges& c) { l.onBookUpdate(c); }) {
+      onBookUpdate_ = [](void* l, const PriceLevelChanges& c) { static_cast<Listener*>(l)->onBookUpdate(c); };
+    }
+
+    if constexpr (requires(Listener& l, const PriceLevelBookView& v) { l.onBookUpdateView(v); }) {
+      onBookUpdateView_ = [](void* l, const PriceLevelBookView& v) { static_cast<Listener*>(l)->onBookUpdateView(v); };
+    }
+
+    if constexpr (requires(Listener& l, const PriceLevelChangesSet& s) { l.onIncrementalChange(s); }) {
+      onIncrementalChange_ = [](void* l, const PriceLevelChangesSet& s) {
+        static_cast<Listener*>(l)->onIncrementalChange(s);
+      };
+    }
+
+    if constexpr (requires(Listener& l, const TopOfBook& t) { l.onTopOfBookChange(t); }) {
+      onTopOfBookChange_ = [](void* l, const TopOfBook& t) { static_cast<Listener*>(l)->onTopOfBookChange(t); };
+    }
+  }
+
+  [[nodiscard]] bool hasOnNewBook() const { return onNewBook_ != nullptr; }
+
+  [[nodiscard]] bool hasOnBookUpdate() const { return onBookUpdate_ != nullptr; }
+
+  [[nodiscard]] bool hasOnBookUpdateView() const { return onBookUpdateView_ != nullptr; }
+
+  [[nodiscard]] bool hasOnIncrementalChange() const { return onIncrementalChange_ != nullptr; }
+
+  [[nodiscard]] bool hasOnTopOfBookChange() const { return onTopOfBookChange_ != nullptr; }
+
+  void onNewBook(const PriceLevelChanges& book) const {
+    if (onNewBook_ != nullptr) {
+      onNewBook_(listener_, book);
+    }
+  }
+
+  void onBookUpdate(const PriceLevelChanges& book) const {
+    if (onBookUpdate_ != nullptr) {
+      onBookUpdate_(listener_, book);
+    }
+  }
+
+  void onBookUpdateView(const PriceLevelBookView& view) const {
+    if (onBookUpdateView_ != nullptr) {
+      onBookUpdateView_(listener_, view);
+    }
+  }
+
+  void onIncrementalChange(const PriceLevelChangesSet& changesSet) const {
+    if (onIncrementalChange_ != nullptr) {
+      onIncrementalChange_(listener_, changesSet);
+    }
+  }
+
+  void onTopOfBookChange(const TopOfBook& topOfBook) const {
+    if (onTopOfBookChange_ != nullptr) {
+      onTopOfBookChange_(listener_, topOfBook);
+    }
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,950 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ConnectionMemory.hpp"
+#include "PriceLevelBook.hpp"
+#include "SpscRing.hpp"
+#include "WaitStrategy.hpp"
+
+namespace dxf {
+
+struct PriceLevelBookShardLoad {
+  std::size_t booksNumber = 0;
+  // The number of the processed order records
+  std::uint64_t recordsNumber = 0;
+  // The time spent in the processing and the handlers
+  std::chrono::nanoseconds busyTime{0};
+  // The number of the processing passes over the books of the shard
+  std::uint64_t passesNumber = 0;
+  // The number of the passes over the queued new snapshots of the books of the other shards
+  std::uint64_t helpedRebuildsNumber = 0;
+  // The waits of the worker for the new data
+  WaitStats wait{};
+};
+
+// The changes of one book of the batch (see PriceLevelBookManager::setOnBatchChanges)
+struct PriceLevelBookBatchChange {
+  PriceLevelBook* book;
+  // The book is new (the first or the new snapshot): the additions are all its visible levels
+  bool isNewBook;
+  const PriceLevelChangesSet* changes;
+};
+
+using PriceLevelBookBatchHandler = std::function<void(std::span<const PriceLevelBookBatchChange>)>;
+
+// When the books are evicted (see PriceLevelBookManager::setEvictionPolicy)
+struct PriceLevelBookEvictionPolicy {
+  // The books that are not accessed (created or got by the access) for this time are evicted. 0 - no idle eviction.
+  std::chrono::milliseconds idleTime{0};
+  // The total memory of the live books (see PriceLevelBook::getMemoryUsage). The least recently accessed books are
+  // evicted while the total is greater. 0 - unbounded.
+  std::size_t memoryBudget = 0;
+};
+
+// The counters of the eviction (see PriceLevelBookManager::getEvictionStats)
+struct PriceLevelBookEvictionStats {
+  std::size_t liveBooksNumber = 0;
+  std::size_t evictedBooksNumber = 0;
+  // The memory of the live books at the last eviction check
+  std::size_t memoryUsage = 0;
+  std::uint64_t evictionsNumber = 0;
+  std::uint64_t recreationsNumber = 0;
+};
+
+// The state of one shard in the diagnostics report (see PriceLevelBookManager::collectDiagnostics)
+struct PriceLevelBookShardDiagnostics {
+  // The worker has answered within the timeout. The shard that hasn't (e.g. stuck in a long pass) has only the load
+  // counters (booksNumber is 0).
+  bool isResponded = false;
+  PriceLevelBookShardLoad load{};
+  std::vector<PriceLevelBookDiagnostics> books{};
+};
+
+// The diagnostics report of the manager
+struct PriceLevelBookManagerDiagnostics {
+  // The time of the report (ms since the epoch)
+  std::int64_t time = 0;
+  // The time the shards took to answer
+  std::chrono::nanoseconds collectionTime{0};
+  std::vector<PriceLevelBookShardDiagnostics> shards{};
+};
+
+// Owns many books and processes them on a fixed set of the worker threads (shards). Every book is assigned to the
+// shard by the symbol hash, so all its transactions and handlers run on the same thread. The snapshot listeners only
+// copy the records to the queues of the books.
+//
+// Conflation (PriceLevelBookConfig::conflate) delivers the folded changes when the queue of the book is drained, the
+// conflation window is not used. The handlers must not create or close the books of the manager.
+//
+// The shard processes its books in the descending order of the priorities (PriceLevelBookConfig::priority, equal
+// priorities keep the creation order), and the bulk create subscribes the books in the same order. So when the
+// connection is restored and the snapshots of all books are resent at once, the most important books are recovered
+// first. The rebuilds of the new snapshots are spread over all shards: the idle shard processes the queued new snapshot
+// of the most important book of the busy shards (the queue of the book is processed by one shard at a time, in order),
+// so the recovery of all books takes about the time of the rebuilds divided by the number of the shards. The new book
+// (and the transactions that are queued with it) may be delivered on the thread of the helping shard then. The order
+// indexes and the buffers of the books keep their capacities over the new snapshots, so the rebuild doesn't grow them
+// again.
+//
+// The books that are opened on demand (e.g. for the symbols the users look at) are bounded by the eviction policy: the
+// idle books and the least recently accessed ones over the memory budget are evicted (their snapshots are closed and
+// they are destroyed), and are recreated by the next access with the number of their live orders as the
+// ordersNumberHint (and restored from their checkpoint if PriceLevelBookConfig::checkpointDirectory is set).
+class PriceLevelBookManager final {
+  using Clock = std::chrono::steady_clock;
+
+  struct Shard {
+    WorkSignal signal{};
+    // The wait of the worker for the new data (ThreadPlacement::spin, yield and adaptiveSpin)
+    WaitStrategy waiting{};
+    // Guards the books. Held by the worker during the processing pass.
+    std::mutex mutex{};
+    // In the descending order of the priorities
+    std::vector<std::unique_ptr<PriceLevelBook>> books{};
+    std::atomic<bool> stop{false};
+    std::atomic<std::uint64_t> recordsNumber{0};
+    std::atomic<std::uint64_t> busyNanos{0};
+    std::atomic<std::uint64_t> passesNumber{0};
+    std::atomic<std::uint64_t> helpedRebuildsNumber{0};
+    PriceLevelBookRebuilds* rebuilds = nullptr;
+    // The worker is pinned: the books of the shard are created by it, so their memory is first touched on its node
+    bool isPinned = false;
+    // The batch handler of the manager and the batch of the pass (its storage is reused by the passes)
+    const PriceLevelBookBatchHandler* onBatchChanges = nullptr;
+    std::vector<PriceLevelChangesSet> batchChanges{};
+    std::vector<PriceLevelBookBatchChange> batch{};
+    // The tasks the worker runs between the passes (see runOnWorker)
+    std::mutex tasksMutex{};
+    std::vector<std::function<void()>> tasks{};
+    std::thread worker{};
+
+    void runTasks() {
+      std::vector<std::function<void()>> pendingTasks{};
+
+      {
+        std::lock_guard<std::mutex> lk(tasksMutex);
+
+        pendingTasks.swap(tasks);
+      }
+
+      for (auto& task : pendingTasks) {
+        task();
+      }
+    }
+
+    // Runs the task on the worker between its passes, doesn't wait for it
+    void post(std::function<void()> task) {
+      {
+        std::lock_guard<std::mutex> lk(tasksMutex);
+
+        tasks.push_back(std::move(task));
+      }
+
+      signal.notify();
+    }
+
+    // Runs the f on the worker and waits for it
+    template <typename F>
+    void runOnWorker(F& f) {
+      std::promise<void> done{};
+      auto isDone = done.get_future();
+
+      {
+        std::lock_guard<std::mutex> lk(tasksMutex);
+
+        tasks.emplace_back([&f, &done] {
+          f();
+          done.set_value();
+        });
+      }
+
+      signal.notify();
+      isDone.wait();
+    }
+
+    // Called under the mutex
+    void insert(std::unique_ptr<PriceLevelBook> book) {
+      auto position = std::upper_bound(books.begin(), books.end(), book->getPriority(),
+                                       [](int priority, const std::unique_ptr<PriceLevelBook>& b) {
+                                         return priority > b->getPriority();
+                                       });
+
+      books.insert(position, std::move(book));
+    }
+
+    // Called under the mutex
+    std::unique_ptr<PriceLevelBook> remove(const PriceLevelBook* book) {
+      auto position = std::find_if(books.begin(), books.end(),
+                                   [book](const std::unique_ptr<PriceLevelBook>& b) { return b.get() == book; });
+      auto result = std::move(*position);
+
+      books.erase(position);
+
+      return result;
+    }
+
+    // Called by the worker that has processed the claimed queue of the book
+    void takeBatchChanges(PriceLevelBook& book) {
+      if (batch.size() == batchChanges.size()) {
+        batchChanges.emplace_back();
+      }
+
+      auto isNewBook = false;
+
+      if (book.takeBatchChanges(batchChanges[batch.size()], isNewBook)) {
+        batch.push_back({&book, isNewBook, nullptr});
+      }
+    }
+
+    // Called while the books of the batch can't be destroyed
+    void deliverBatch() {
+      if (batch.empty()) {
+        return;
+      }
+
+      for (std::size_t i = 0; i < batch.size(); i++) {
+        batch[i].changes = &batchChanges[i];
+      }
+
+      (*onBatchChanges)(batch);
+      batch.clear();
+    }
+
+    // Claims the queue of the most important book of the other shards whose new snapshot is queued, and prunes the
+    // rebuilt books. The book is helped until the isHelped_ is reset. Returns nullptr if there is no such book.
+    PriceLevelBook* claimRebuild() {
+      std::lock_guard<std::mutex> lk(rebuilds->mutex);
+      PriceLevelBook* result = nullptr;
+
+      std::erase_if(rebuilds->books, [](PriceLevelBook* book) {
+        if (book->isRebuilding_.load(std::memory_order_relaxed)) {
+          return false;
+        }
+
+        book->isListed_ = false;
+
+        return true;
+      });
+
+      for (auto book : rebuilds->books) {
+        // The own books are processed by the pass
+        if (book->workSignal_ == &signal || book->queue_->size() == 0) {
+          continue;
+        }
+
+        if (result == nullptr || book->getPriority() > result->getPriority()) {
+          result = book;
+        }
+      }
+
+      if (result == nullptr || !result->claimQueue()) {
+        return nullptr;
+      }
+
+      result->isHelped_.store(true, std::memory_order_relaxed);
+
+      return result;
+    }
+
+    void run() {
+      while (true) {
+        auto seen = signal.get();
+
+        if (stop.load(std::memory_order_acquire)) {
+          return;
+        }
+
+        runTasks();
+
+        auto start = std::chrono::steady_clock::now();
+        std::size_t processedRecordsNumber = 0;
+
+        {
+          std::lock_guard<std::mutex> lk(mutex);
+
+          for (const auto& book : books) {
+            // The book may be rebuilt by the helping shard
+            if (book->claimQueue()) {
+              processedRecordsNumber += book->processClaimed([this, &book] { takeBatchChanges(*book); });
+            }
+          }
+
+          deliverBatch();
+        }
+
+        passesNumber.fetch_add(1, std::memory_order_relaxed);
+
+        if (processedRecordsNumber == 0) {
+          if (auto book = claimRebuild()) {
+            processedRecordsNumber = book->processClaimed([this, book] { takeBatchChanges(*book); });
+            deliverBatch();
+            helpedRebuildsNumber.fetch_add(1, std::memory_order_relaxed);
+            // The last access to the book (see stopBook)
+            book->isHelped_.store(false, std::memory_order_release);
+          }
+        }
+
+        if (processedRecordsNumber == 0) {
+          signal.wait(seen, waiting);
+
+          continue;
+        }
+
+        recordsNumber.fetch_add(processedRecordsNumber, std::memory_order_relaxed);
+        busyNanos.fetch_add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                         std::chrono::steady_clock::now() - start)
+                                                         .count()),
+                            std::memory_order_relaxed);
+      }
+    }
+  };
+
+  dxf_connection_t connection_;
+  PriceLevelBookRebuilds rebuilds_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  // Guards the index of the books
+  std::mutex mutex_;
+  // The book is found by the symbol and the id of the interned source
+  struct BookKey {
+    std::string symbol{};
+    std::uint32_t sourceId = 0;
+
+    friend bool operator==(const BookKey&, const BookKey&) = default;
+  };
+
+  struct BookKeyHash {
+    std::size_t operator()(const BookKey& key) const {
+      return std::hash<std::string>{}(key.symbol) ^
+             static_cast<std::size_t>(static_cast<std::uint64_t>(key.sourceId) * 0x9E3779B97F4A7C15ULL);
+    }
+  };
+
+  // The book and what it is recreated with after the eviction
+  struct BookEntry {
+    // nullptr - the book is evicted
+    PriceLevelBook* book = nullptr;
+    std::string source{};
+    std::size_t levelsNumber = 0;
+    PriceLevelBookConfig config{};
+    Clock::time_point lastAccessTime{};
+  };
+
+  std::unordered_map<BookKey, BookEntry, BookKeyHash> books_;
+  PriceLevelBookEvictionPolicy evictionPolicy_{};
+  // Is called for every created book (the recreated ones too)
+  std::function<void(PriceLevelBook&)> onBookCreated_{};
+  PriceLevelBookBatchHandler onBatchChanges_{};
+  std::size_t memoryUsage_ = 0;
+  // The memory account of the connection (see setMemoryAccount) and the id of the source of the books in it
+  ConnectionMemoryAccount* memoryAccount_ = nullptr;
+  std::uint64_t memorySourceId_ = 0;
+  std::uint64_t evictionsNumber_ = 0;
+  std::uint64_t recreationsNumber_ = 0;
+
+  static BookKey makeKey(const std::string& symbol, const std::string& source) {
+    return {symbol, IndexedEventSource::valueOf(source).getId()};
+  }
+
+  Shard& getShard(const std::string& symbol) {
+    return *shards_[std::hash<std::string>{}(symbol) % shards_.size()];
+  }
+
+  // Called under the mutex
+  PriceLevelBook* startBook(const std::string& symbol, const std::string& source, std::size_t levelsNumber,
+                            const PriceLevelBookConfig& config) {
+    auto& shard = getShard(symbol);
+    std::unique_ptr<PriceLevelBook> book{};
+    auto createBook = [&] {
+      if (memoryAccount_ == nullptr || config.memoryAccount != nullptr) {
+        book = PriceLevelBook::create(connection_, symbol, source, levelsNumber, config, &shard.signal, &rebuilds_);
+
+        return;
+      }
+
+      auto bookConfig = config;
+
+      bookConfig.memoryAccount = memoryAccount_;
+      book = PriceLevelBook::create(connection_, symbol, source, levelsNumber, bookConfig, &shard.signal, &rebuilds_);
+    };
+
+    // The order index, the ladders and the queue of the book are allocated on the node of the worker that uses them
+    if (shard.isPinned) {
+      shard.runOnWorker(createBook);
+    } else {
+      createBook();
+    }
+
+    if (!book->isValid()) {
+      return nullptr;
+    }
+
+    auto result = book.get();
+
+    if (onBookCreated_) {
+      onBookCreated_(*result);
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(shard.mutex);
+
+      shard.insert(std::move(book));
+    }
+
+    result->isBatched_ = static_cast<bool>(onBatchChanges_);
+    // The data queued meanwhile is processed by the next pass
+    result->isConsumed_.store(false, std::memory_order_release);
+    shard.signal.notify();
+
+    return result;
+  }
+
+  // Called under the mutex. Recreates the evicted book.
+  PriceLevelBook* accessBook(const std::string& symbol, BookEntry& entry) {
+    entry.lastAccessTime = Clock::now();
+
+    if (entry.book != nullptr) {
+      return entry.book;
+    }
+
+    entry.book = startBook(symbol, entry.source, entry.levelsNumber, entry.config);
+
+    if (entry.book != nullptr) {
+      recreationsNumber_++;
+      evictBooks(entry.book);
+    }
+
+    return entry.book;
+  }
+
+  PriceLevelBook* createBook(const std::string& symbol, const std::string& source, std::size_t levelsNumber,
+                             const PriceLevelBookConfig& config) {
+    auto key = makeKey(symbol, source);
+
+    if (auto found = books_.find(key); found != books_.end()) {
+      return accessBook(symbol, found->second);
+    }
+
+    if (memoryAccount_ != nullptr && memoryAccount_->isDegraded(MemoryQuotaAction::REFUSE_SYMBOLS)) {
+      memoryAccount_->recordRefusedSymbol();
+
+      return nullptr;
+    }
+
+    auto result = startBook(symbol, source, levelsNumber, config);
+
+    if (result == nullptr) {
+      return nullptr;
+    }
+
+    books_[key] = BookEntry{result, source, levelsNumber, config, Clock::now()};
+    evictBooks(result);
+
+    return result;
+  }
+
+  // Called under the mutex. Closes the snapshot of the book and destroys it.
+  void stopBook(PriceLevelBook* book) {
+    auto& shard = getShard(book->getSymbol());
+
+    // The listener may wait for the queue space, so the shard keeps processing the book until the snapshot is closed
+    book->closeSnapshot();
+
+    {
+      std::lock_guard<std::mutex> lk(rebuilds_.mutex);
+
+      if (book->isListed_) {
+        std::erase(rebuilds_.books, book);
+      }
+    }
+
+    std::unique_ptr<PriceLevelBook> removedBook{};
+
+    {
+      std::lock_guard<std::mutex> lk(shard.mutex);
+
+      removedBook = shard.remove(book);
+    }
+
+    // The helping shard may be finishing the rebuild of the book (it isn't claimed again after the removal)
+    while (removedBook->isHelped_.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+
+  // Called under the mutex. The book is recreated with its current number of the orders and from its checkpoint.
+  void evictBook(BookEntry& entry) {
+    auto* book = entry.book;
+
+    entry.config.ordersNumberHint = (std::max)(entry.config.ordersNumberHint, book->getOrdersNumber());
+
+    if (!entry.config.checkpointDirectory.empty()) {
+      book->writeCheckpoint(entry.config.checkpointDirectory);
+    }
+
+    entry.book = nullptr;
+    stopBook(book);
+    evictionsNumber_++;
+  }
+
+  // Called under the mutex. Evicts the idle books and the least recently accessed ones over the memory budget, except
+  // the keptBook. Returns the number of the evicted books.
+  std::size_t evictBooks(const PriceLevelBook* keptBook) {
+    if (evictionPolicy_.idleTime.count() == 0 && evictionPolicy_.memoryBudget == 0) {
+      return 0;
+    }
+
+    struct Candidate {
+      BookEntry* entry;
+      std::size_t memoryUsage;
+    };
+
+    std::vector<Candidate> candidates{};
+    std::size_t memoryUsage = 0;
+
+    for (auto& [key, entry] : books_) {
+      if (entry.book != nullptr) {
+        candidates.push_back({&entry, entry.book->getMemoryUsage().getTotal()});
+        memoryUsage += candidates.back().memoryUsage;
+      }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+      return a.entry->lastAccessTime < b.entry->lastAccessTime;
+    });
+
+    auto now = Clock::now();
+    std::size_t result = 0;
+
+    for (const auto& candidate : candidates) {
+      auto isIdle = evictionPolicy_.idleTime.count() != 0 &&
+                    now - candidate.entry->lastAccessTime >= evictionPolicy_.idleTime;
+      auto isOverBudget = evictionPolicy_.memoryBudget != 0 && memoryUsage > evictionPolicy_.memoryBudget;
+
+      // The rest are accessed later
+      if (!isIdle && !isOverBudget) {
+        break;
+      }
+
+      if (candidate.entry->book == keptBook) {
+        continue;
+      }
+
+      evictBook(*candidate.entry);
+      memoryUsage -= candidate.memoryUsage;
+      result++;
+    }
+
+    memoryUsage_ = memoryUsage;
+
+    return result;
+  }
+
+  void closeBook(const std::string& symbol, const std::string& source) {
+    auto found = books_.find(makeKey(symbol, source));
+
+    if (found == books_.end()) {
+      return;
+    }
+
+    auto book = found->second.book;
+
+    books_.erase(found);
+
+    if (book != nullptr) {
+      stopBook(book);
+    }
+  }
+
+ public:
+  // shardsNumber - the number of the worker threads (0 - the number of the hardware threads). placement - the placement
+  // of the worker threads (the failure is ignored).
+  explicit PriceLevelBookManager(dxf_connection_t connection, std::size_t shardsNumber = 0,
+                                 const ThreadPlacement& placement = {})
+      : PriceLevelBookManager(connection,
+                              std::vector<ThreadPlacement>(
+                                shardsNumber != 0 ? shardsNumber : (std::max)(1U, std::thread::hardware_concurrency()),
+                                placement)) {}
+
+  // The worker of every shard has its own placement, e.g. the shards of every NUMA node pinned to its CPUs
+  // (ThreadPlacement::getNumaPlacements, the hardware threads without the placements if it is empty). The books of the
+  // pinned shards are created by their workers, so the memory of the books is local to the node of the shard (their
+  // handlers must not call the manager: the creation waits for the worker under the lock of the manager).
+  PriceLevelBookManager(dxf_connection_t connection, std::vector<ThreadPlacement> shardPlacements)
+      : connection_{connection}, rebuilds_{}, shards_{}, mutex_{}, books_{} {
+    if (shardPlacements.empty()) {
+      shardPlacements.resize((std::max)(1U, std::thread::hardware_concurrency()));
+    }
+
+    for (const auto& placement : shardPlacements) {
+      auto shard = std::make_unique<Shard>();
+
+      shard->waiting.configure(placement);
+      shard->rebuilds = &rebuilds_;
+      shard->isPinned = !placement.cpus.empty();
+      shard->onBatchChanges = &onBatchChanges_;
+      rebuilds_.signals.push_back(&shard->signal);
+      shard->worker = std::thread([s = shard.get(), placement] {
+        ThreadPlacement::setCurrentThreadName("dxf-plb-shard");
+        placement.applyToCurrentThread();
+        s->run();
+      });
+      shards_.push_back(std::move(shard));
+    }
+  }
+
+  PriceLevelBookManager(const PriceLevelBookManager&) = delete;
+  PriceLevelBookManager& operator=(const PriceLevelBookManager&) = delete;
+
+  ~PriceLevelBookManager() {
+    setMemoryAccount(nullptr);
+    closeAll();
+
+    for (auto& shard : shards_) {
+      shard->stop.store(true, std::memory_order_release);
+      shard->signal.notify();
+      shard->worker.join();
+    }
+  }
+
+  // Returns the book or nullptr if the snapshot can't be created (or the new symbol is refused by the memory quota, see
+  // setMemoryAccount). The book is owned by the manager and is valid until it is closed or evicted. If the book already
+  // exists, it is returned as is (the evicted one is recreated with its first config).
+  PriceLevelBook* create(const std::string& symbol, const std::string& source, std::size_t levelsNumber,
+                         const PriceLevelBookConfig& config = {}) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return createBook(symbol, source, levelsNumber, config);
+  }
+
+  // Creates the books of the symbols. The result contains the book (or nullptr) for every symbol.
+  std::vector<PriceLevelBook*> create(const std::vector<std::string>& symbols, const std::string& source,
+                                      std::size_t levelsNumber, const PriceLevelBookConfig& config = {}) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::vector<PriceLevelBook*> result{};
+
+    result.reserve(symbols.size());
+
+    for (const auto& symbol : symbols) {
+      result.push_back(createBook(symbol, source, levelsNumber, config));
+    }
+
+    return result;
+  }
+
+  // Creates the books of the symbols in the descending order of the priorities (priorities[i] is the priority of the
+  // symbols[i], the rest are 0), so the subscriptions of the most important books are sent first. The result contains
+  // the book (or nullptr) for every symbol in the order of the symbols.
+  std::vector<PriceLevelBook*> create(const std::vector<std::string>& symbols, const std::string& source,
+                                      std::size_t levelsNumber, const PriceLevelBookConfig& config,
+                                      const std::vector<int>& priorities) {
+    auto getPriority = [&priorities](std::size_t i) { return i < priorities.size() ? priorities[i] : 0; };
+    std::vector<std::size_t> order(symbols.size());
+
+    for (std::size_t i = 0; i < order.size(); i++) {
+      order[i] = i;
+    }
+
+    std::stable_sort(order.begin(), order.end(),
+                     [&getPriority](std::size_t a, std::size_t b) { return getPriority(a) > getPriority(b); });
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::vector<PriceLevelBook*> result(symbols.size());
+    auto bookConfig = config;
+
+    for (auto i : order) {
+      bookConfig.priority = getPriority(i);
+      result[i] = createBook(symbols[i], source, levelsNumber, bookConfig);
+    }
+
+    return result;
+  }
+
+  // Returns the book (recreates the evicted one) and marks it as accessed, or nullptr if there is no such book (or the
+  // snapshot can't be recreated). The pointer is valid until the book is closed or evicted, so the users of the evicted
+  // books get the book by the access every time.
+  PriceLevelBook* access(const std::string& symbol, const std::string& source) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto found = books_.find(makeKey(symbol, source));
+
+    if (found == books_.end()) {
+      return nullptr;
+    }
+
+    return accessBook(symbol, found->second);
+  }
+
+  // Sets the eviction policy and applies it at once. The policy is also applied at every book creation, so the idle
+  // time eviction needs the periodic evict calls.
+  void setEvictionPolicy(const PriceLevelBookEvictionPolicy& policy) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    evictionPolicy_ = policy;
+    evictBooks(nullptr);
+  }
+
+  // Evicts the idle books and the least recently accessed books over the memory budget. Returns the number of the
+  // evicted books.
+  std::size_t evict() {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return evictBooks(nullptr);
+  }
+
+  // Accounts the memory of the live books to the memory account of the connection (the books are its source, see
+  // ConnectionMemoryAccount::addSource) and applies its quota: REFUSE_SYMBOLS - the create refuses the books of the
+  // new symbols (the existing and the evicted ones are still returned), CONFLATE - the books created after the call
+  // merge their queued data (see PriceLevelBookConfig::memoryAccount). nullptr - no account. The account must outlive
+  // the manager (or be replaced first). Must not be called by the refresh of the account.
+  void setMemoryAccount(ConnectionMemoryAccount* account) {
+    ConnectionMemoryAccount* previousAccount = nullptr;
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+
+      previousAccount = std::exchange(memoryAccount_, account);
+    }
+
+    // The refresh of the account calls the source under the lock of the account, so it's not called under the lock of
+    // the manager
+    if (previousAccount != nullptr) {
+      previousAccount->removeSource(memorySourceId_);
+    }
+
+    if (account != nullptr) {
+      memorySourceId_ = account->addSource([this] { return getMemoryUsage(); });
+    }
+  }
+
+  // Returns the memory of the live books (see PriceLevelBook::getMemoryUsage)
+  [[nodiscard]] std::size_t getMemoryUsage() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::size_t result = 0;
+
+    for (const auto& [key, entry] : books_) {
+      if (entry.book != nullptr) {
+        result += entry.book->getMemoryUsage().getTotal();
+      }
+    }
+
+    return result;
+  }
+
+  // The handler is called for every created book (the books recreated after the eviction too) before it receives the
+  // data, e.g. to set the handlers of the book. It must not call the manager.
+  void setOnBookCreated(std::function<void(PriceLevelBook&)> onBookCreated) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onBookCreated_ = std::move(onBookCreated);
+  }
+
+  // The handler is called by the shard once per processing pass with the net changes of all its books changed by the
+  // pass (the data of the books that has arrived since the previous pass, e.g. of one network message), so the
+  // downstream (e.g. the serializer) publishes them at once instead of once per book. Is called on the thread of the
+  // shard after the handlers of the books, the changes are valid during the call. The books created before the handler
+  // is set are not batched, so it's set before the books are created. It must not call the manager.
+  void setOnBatchChanges(PriceLevelBookBatchHandler onBatchChanges) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    onBatchChanges_ = std::move(onBatchChanges);
+  }
+
+  [[nodiscard]] PriceLevelBookEvictionStats getEvictionStats() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    PriceLevelBookEvictionStats result{0, 0, memoryUsage_, evictionsNumber_, recreationsNumber_};
+
+    for (const auto& [key, entry] : books_) {
+      (entry.book != nullptr ? result.liveBooksNumber : result.evictedBooksNumber)++;
+    }
+
+    return result;
+  }
+
+  // Changes the priority of the book (the evicted one is recreated with it). Returns false if there is no such book.
+  bool setPriority(const std::string& symbol, const std::string& source, int priority) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto found = books_.find(makeKey(symbol, source));
+
+    if (found == books_.end()) {
+      return false;
+    }
+
+    found->second.config.priority = priority;
+
+    if (found->second.book == nullptr) {
+      return true;
+    }
+
+    auto& shard = getShard(symbol);
+    std::lock_guard<std::mutex> shardLock(shard.mutex);
+    auto book = shard.remove(found->second.book);
+
+    book->priority_.store(priority, std::memory_order_relaxed);
+    shard.insert(std::move(book));
+
+    return true;
+  }
+
+  // Requests the fresh snapshot of the book (see PriceLevelBook::resync). The evicted book is recreated with the fresh
+  // snapshot anyway. Returns false if the book isn't found or its snapshot can't be created.
+  bool resync(const std::string& symbol, const std::string& source) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto found = books_.find(makeKey(symbol, source));
+
+    if (found == books_.end()) {
+      return false;
+    }
+
+    if (found->second.book == nullptr) {
+      return true;
+    }
+
+    return found->second.book->resync();
+  }
+
+  void close(const std::string& symbol, const std::string& source) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    closeBook(symbol, source);
+  }
+
+  void close(const std::vector<std::string>& symbols, const std::string& source) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    for (const auto& symbol : symbols) {
+      closeBook(symbol, source);
+    }
+  }
+
+  void closeAll() {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    while (!books_.empty()) {
+      auto symbol = books_.begin()->first.symbol;
+      auto source = books_.begin()->second.source;
+
+      closeBook(symbol, source);
+    }
+  }
+
+  [[nodiscard]] std::size_t getShardsNumber() const { return shards_.size(); }
+
+  [[nodiscard]] std::vector<PriceLevelBookShardLoad> getShardLoads() {
+    std::vector<PriceLevelBookShardLoad> result{};
+
+    result.reserve(shards_.size());
+
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> lk(shard->mutex);
+
+      result.push_back({shard->books.size(), shard->recordsNumber.load(std::memory_order_relaxed),
+                        std::chrono::nanoseconds{shard->busyNanos.load(std::memory_order_relaxed)},
+                        shard->passesNumber.load(std::memory_order_relaxed),
+                        shard->helpedRebuildsNumber.load(std::memory_order_relaxed), shard->waiting.getStats()});
+    }
+
+    return result;
+  }
+
+  // Collects the state of all books for the diagnostics: every worker copies the state of its books between its passes
+  // (by the task of its queue), so the lock of the manager isn't taken and the feed isn't stopped. Waits for the shards
+  // up to the timeout: the shards that don't answer are reported by their load counters, their late answers are
+  // dropped.
+  [[nodiscard]] PriceLevelBookManagerDiagnostics collectDiagnostics(
+    std::chrono::milliseconds timeout = std::chrono::milliseconds{1000}) {
+    struct Collection {
+      std::mutex mutex{};
+      std::condition_variable cv{};
+      std::vector<PriceLevelBookShardDiagnostics> shards{};
+      std::size_t respondedNumber = 0;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    // The late answers outlive the call
+    auto collection = std::make_shared<Collection>();
+
+    collection->shards.resize(shards_.size());
+
+    for (std::size_t i = 0; i < shards_.size(); i++) {
+      shards_[i]->post([collection, i, shard = shards_[i].get()] {
+        std::vector<PriceLevelBookDiagnostics> books{};
+
+        {
+          std::lock_guard<std::mutex> lk(shard->mutex);
+
+          books.reserve(shard->books.size());
+
+          for (const auto& book : shard->books) {
+            books.push_back(book->getDiagnostics());
+          }
+        }
+
+        std::lock_guard<std::mutex> lk(collection->mutex);
+
+        collection->shards[i].isResponded = true;
+        collection->shards[i].books = std::move(books);
+        collection->respondedNumber++;
+        collection->cv.notify_all();
+      });
+    }
+
+    PriceLevelBookManagerDiagnostics result{};
+
+    {
+      std::unique_lock<std::mutex> lk(collection->mutex);
+
+      collection->cv.wait_for(lk, timeout, [this, &collection] {
+        return collection->respondedNumber == shards_.size();
+      });
+      result.shards = collection->shards;
+    }
+
+    result.time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count();
+    result.collectionTime = std::chrono::steady_clock::now() - start;
+
+    for (std::size_t i = 0; i < shards_.size(); i++) {
+      const auto& shard = *shards_[i];
+
+      result.shards[i].load = {result.shards[i].books.size(), shard.recordsNumber.load(std::memory_order_relaxed),
+                               std::chrono::nanoseconds{shard.busyNanos.load(std::memory_order_relaxed)},
+                               shard.passesNumber.load(std::memory_order_relaxed),
+                               shard.helpedRebuildsNumber.load(std::memory_order_relaxed), shard.waiting.getStats()};
+    }
+
+    return result;
+  }
+
+  // Returns the latency histogram of the processing stage merged over all books (see PriceLevelBook::getLatency)
+  [[nodiscard]] LatencyHistogramSnapshot getLatency(LatencyStage stage) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    LatencyHistogramSnapshot result{};
+
+    for (const auto& [key, entry] : books_) {
+      if (entry.book != nullptr) {
+        result.merge(entry.book->getLatency(stage));
+      }
+    }
+
+    return result;
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,859 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "PriceLevel.hpp"
+#include "PriceLevelBookCheckpoint.hpp"
+#include "PriceLevelConflator.hpp"
+#include "SpscRing.hpp"
+#include "ThreadPlacement.hpp"
+
+namespace dxf {
+
+// The compact binary file of the visible levels history of one book (the book tape): the deltas of the books
+// (PriceLevelChangesSet) with the keyframes, so the book at any time of the day is restored from one keyframe and the
+// deltas after it. The file is read by the memory mapping.
+//
+// Format (native byte order):
+//   header: "PLBT" (4 bytes), version (uint32), price scale (double), symbol length (uint32), symbol (UTF-8), source
+//           length (uint32), source (UTF-8)
+//   blocks: the records of the keyframeInterval, every block starts with the keyframe and is decoded independently
+//   index:  (8-byte aligned) the Block of every block (the seek index)
+//   footer: index offset, blocks number, records number (uint64), "PLBT" (4 bytes), padding
+//
+// The record: the header varint (the zigzag time delta shifted by 2 and the record kind), then the keyframe - the
+// numbers of the asks and the bids (varints) and the levels, or the delta - the numbers of the removals, the additions
+// and the updates of the asks and the bids (varints) and the levels. The level: the varint of the zigzag delta of the
+// price ticks from the previous level of the block shifted by 1 and the RAW bit (the double follows if the price isn't
+// a whole number of ticks), then (not for the removals) the same of the delta of the size from the size of the level
+// in the book (0 - a new level), and the zigzag varint of the level time relative to the record time.
+struct PriceLevelBookTape {
+  static constexpr char MAGIC[4] = {'P', 'L', 'B', 'T'};
+  static constexpr std::uint32_t VERSION = 1;
+  // The 1e-8 ticks when the tick size is unknown
+  static constexpr double DEFAULT_PRICE_SCALE = 1e8;
+  static constexpr std::int64_t DEFAULT_KEYFRAME_INTERVAL = 60000;
+
+  // The kinds of the records
+  static constexpr std::uint64_t DELTA = 0;
+  // The new book of the book (e.g. the snapshot)
+  static constexpr std::uint64_t NEW_BOOK = 1;
+  // The periodic keyframe at the start of the block (the book isn't changed by it)
+  static constexpr std::uint64_t KEYFRAME = 2;
+
+  // The block of the records: the byte offset in the file, the length, the number of the records and the time range
+  struct Block {
+    std::uint64_t offset;
+    std::uint32_t size;
+    std::uint32_t recordsNumber;
+    std::int64_t startTime;
+    std::int64_t endTime;
+  };
+
+  struct Footer {
+    std::uint64_t indexOffset;
+    std::uint64_t blocksNumber;
+    std::uint64_t recordsNumber;
+    char magic[4];
+    std::uint32_t padding;
+  };
+
+  static_assert(std::is_trivially_copyable_v<Block> && sizeof(Block) == 32 && sizeof(Footer) == 32,
+                "The layout is fixed");
+
+  static std::uint64_t toZigzag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1U) ^ static_cast<std::uint64_t>(value >> 63);
+  }
+
+  static std::int64_t fromZigzag(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1U) ^ -static_cast<std::int64_t>(value & 1U);
+  }
+
+  // Returns true if the value is the whole number (of the ticks) that is exact in the double
+  static bool toWhole(double value, std::int64_t& result) {
+    // NaN and the values out of the exact integers range are not converted
+    if (!(std::fabs(value) < 9007199254740992.0) || std::trunc(value) != value) {
+      return false;
+    }
+
+    result = static_cast<std::int64_t>(value);
+
+    return true;
+  }
+
+  // The position of the level of the price in the levels of the side (best-first) or of its insertion
+  template <typename Side>
+  static std::size_t findLevel(const std::vector<PriceLevel>& levels, double price) {
+    return static_cast<std::size_t>(
+      std::partition_point(levels.begin(), levels.end(),
+                           [price](const PriceLevel& pl) { return Side::isBetter(pl.price, price); }) -
+      levels.begin());
+  }
+
+  static bool isSamePrice(double price1, double price2) {
+    return price1 == price2 || (std::isnan(price1) && std::isnan(price2));
+  }
+
+  // The file name of the tape of the book (the same encoding as the checkpoint one, e.g. "%2FESZ21%3AXCME#NTV.plbt")
+  static std::string getFileName(const std::string& symbol, const std::string& source) {
+    auto result = PriceLevelBookCheckpoint::getFileName(symbol, source);
+
+    return result.replace(result.size() - 1, 1, "t");
+  }
+};
+
+// The writer of the book tape. The deltas and the new books are copied to the ring by the thread of the book, the
+// background thread encodes them, cuts the blocks by the keyframeInterval and writes the file by the large batches, so
+// the book never waits for the disk. When the ring is full, the changes are folded into one net delta (or into the
+// pending new book) that is queued with the next record, so the book isn't blocked and the tape stays consistent (the
+// intermediate states of the folded deltas are not recorded, see getConflatedNumber).
+class PriceLevelBookTapeWriter final {
+  enum class Kind : std::uint8_t { NEW_BOOK, CHANGES, STOP };
+
+  // The slot of the ring. The new book is kept in the additions.
+  struct Record {
+    Kind kind = Kind::CHANGES;
+    std::int64_t time = 0;
+    PriceLevelChangesSet changes{};
+  };
+
+  // The size of the encoded data that is written at once
+  static constexpr std::size_t WRITE_BATCH_SIZE = 1U << 20U;
+
+  std::FILE* file_;
+  double priceScale_;
+  std::int64_t keyframeInterval_;
+  SpscRing<Record> ring_;
+  std::thread thread_;
+  bool isFinished_ = false;
+  std::atomic<bool> isFailed_{false};
+  std::atomic<std::uint64_t> recordsNumber_{0};
+  std::atomic<std::uint64_t> conflatedNumber_{0};
+
+  // The producer (the thread of the book): the records that haven't fit the ring
+  bool hasPendingBook_ = false;
+  std::int64_t pendingBookTime_ = 0;
+  std::int64_t pendingTime_ = 0;
+  PriceLevelChanges pendingBook_{};
+  PriceLevelChangesConflator pendingChanges_{};
+  std::int64_t lastTime_ = 0;
+
+  // The background thread: the encoded data, the book and the state of the block
+  std::vector<unsigned char> buffer_{};
+  std::uint64_t fileSize_ = 0;
+  PriceLevelChanges book_{};
+  std::vector<PriceLevelBookTape::Block> blocks_{};
+  PriceLevelBookTape::Block block_{};
+  // The time of the previous record of the block (the records of the block start from 0)
+  std::int64_t previousTime_ = 0;
+  std::int64_t previousTicks_ = 0;
+
+  PriceLevelBookTapeWriter(std::FILE* file, double priceScale, std::int64_t keyframeInterval,
+                           std::size_t queueCapacity)
+      : file_{file}, priceScale_{priceScale}, keyframeInterval_{keyframeInterval}, ring_{queueCapacity}, thread_{} {}
+
+  template <typename T>
+  void put(T value) {
+    auto position = buffer_.size();
+
+    buffer_.resize(position + sizeof(T));
+    std::memcpy(buffer_.data() + position, &value, sizeof(T));
+  }
+
+  void putVarint(std::uint64_t value) {
+    while (value >= 0x80U) {
+      buffer_.push_back(static_cast<unsigned char>(value | 0x80U));
+      value >>= 7U;
+    }
+
+    buffer_.push_back(static_cast<unsigned char>(value));
+  }
+
+  void writeBuffer() {
+    if (!isFailed_.load(std::memory_order_relaxed) &&
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+      isFailed_.store(true, std::memory_order_relaxed);
+    }
+
+    fileSize_ += buffer_.size();
+    buffer_.clear();
+  }
+
+  // The price ticks delta from the previous level or the raw double
+  void putPrice(double price) {
+    std::int64_t ticks = 0;
+
+    if (PriceLevelBookTape::toWhole(price * priceScale_, ticks) && static_cast<double>(ticks) / priceScale_ == price) {
+      putVarint(PriceLevelBookTape::toZigzag(ticks - previousTicks_) << 1U);
+      previousTicks_ = ticks;
+    } else {
+      putVarint(1);
+      put(price);
+    }
+  }
+
+  void putLevel(const PriceLevel& level, double previousSize, std::int64_t time) {
+    std::int64_t size = 0;
+    std::int64_t previous = 0;
+
+    putPrice(level.price);
+
+    if (PriceLevelBookTape::toWhole(level.size, size) && PriceLevelBookTape::toWhole(previousSize, previous)) {
+      putVarint(PriceLevelBookTape::toZigzag(size - previous) << 1U);
+    } else {
+      putVarint(1);
+      put(level.size);
+    }
+
+    putVarint(PriceLevelBookTape::toZigzag(level.time - time));
+  }
+
+  void putHeader(std::int64_t time, std::uint64_t kind) {
+    putVarint(PriceLevelBookTape::toZigzag(time - previousTime_) << 2U | kind);
+    previousTime_ = time;
+    block_.endTime = time;
+    block_.recordsNumber++;
+    recordsNumber_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void putKeyframe(std::int64_t time, std::uint64_t kind) {
+    putHeader(time, kind);
+    putVarint(book_.asks.size());
+    putVarint(book_.bids.size());
+
+    for (const auto* levels : {&book_.asks, &book_.bids}) {
+      for (const auto& level : *levels) {
+        putLevel(level, 0.0, time);
+      }
+    }
+  }
+
+  template <typename Side>
+  void applyAndPut(std::vector<PriceLevel>& levels, const std::vector<PriceLevel>& changes, std::int64_t time) {
+    for (const auto& level : changes) {
+      auto position = PriceLevelBookTape::findLevel<Side>(levels, level.price);
+
+      if (position < levels.size() && PriceLevelBookTape::isSamePrice(levels[position].price, level.price)) {
+        putLevel(level, levels[position].size, time);
+        levels[position] = level;
+      } else {
+        putLevel(level, 0.0, time);
+        levels.insert(levels.begin() + static_cast<std::ptrdiff_t>(position), level);
+      }
+    }
+  }
+
+  template <typename Side>
+  void removeAndPut(std::vector<PriceLevel>& levels, const std::vector<PriceLevel>& removals) {
+    for (const auto& level : removals) {
+      auto position = PriceLevelBookTape::findLevel<Side>(levels, level.price);
+
+      putPrice(level.price);
+
+      if (position < levels.size() && PriceLevelBookTape::isSamePrice(levels[position].price, level.price)) {
+        levels.erase(levels.begin() + static_cast<std::ptrdiff_t>(position));
+      }
+    }
+  }
+
+  void putDelta(std::int64_t time, const PriceLevelChangesSet& changes) {
+    putHeader(time, PriceLevelBookTape::DELTA);
+
+    for (const auto* levels : {&changes.removals.asks, &changes.removals.bids, &changes.additions.asks,
+                               &changes.additions.bids, &changes.updates.asks, &changes.updates.bids}) {
+      putVarint(levels->size());
+    }
+
+    removeAndPut<AskSide>(book_.asks, changes.removals.asks);
+    removeAndPut<BidSide>(book_.bids, changes.removals.bids);
+    applyAndPut<AskSide>(book_.asks, changes.additions.asks, time);
+    applyAndPut<BidSide>(book_.bids, changes.additions.bids, time);
+    applyAndPut<AskSide>(book_.asks, changes.updates.asks, time);
+    applyAndPut<BidSide>(book_.bids, changes.updates.bids, time);
+  }
+
+  void flushBlock() {
+    if (block_.recordsNumber == 0) {
+      return;
+    }
+
+    block_.size = static_cast<std::uint32_t>(fileSize_ + buffer_.size() - block_.offset);
+    blocks_.push_back(block_);
+    block_ = {};
+  }
+
+  // Starts the block (its records are decoded from the zero state)
+  void startBlock(std::int64_t time) {
+    flushBlock();
+    block_.offset = fileSize_ + buffer_.size();
+    block_.startTime = time;
+    block_.endTime = time;
+    previousTime_ = 0;
+    previousTicks_ = 0;
+  }
+
+  void encode(const Record& record) {
+    if (record.kind == Kind::NEW_BOOK) {
+      book_.asks = record.changes.additions.asks;
+      book_.bids = record.changes.additions.bids;
+      startBlock(record.time);
+      putKeyframe(record.time, PriceLevelBookTape::NEW_BOOK);
+
+      return;
+    }
+
+    if (block_.recordsNumber == 0 || record.time - block_.startTime >= keyframeInterval_) {
+      startBlock(record.time);
+      putKeyframe(record.time, PriceLevelBookTape::KEYFRAME);
+    }
+
+    putDelta(record.time, record.changes);
+  }
+
+  void run() {
+    ThreadPlacement::setCurrentThreadName("dxf-plb-tape");
+
+    while (true) {
+      auto& record = ring_.front();
+
+      if (record.kind == Kind::STOP) {
+        ring_.pop();
+
+        break;
+      }
+
+      encode(record);
+      ring_.pop();
+
+      // The blocks are cut at the records, the data is written by the batches
+      if (buffer_.size() >= WRITE_BATCH_SIZE) {
+        writeBuffer();
+      }
+    }
+
+    flushBlock();
+
+    while ((fileSize_ + buffer_.size()) % 8 != 0) {
+      buffer_.push_back(0);
+    }
+
+    PriceLevelBookTape::Footer footer{fileSize_ + buffer_.size(), blocks_.size(),
+                                      recordsNumber_.load(std::memory_order_relaxed), {}, 0};
+
+    for (const auto& block : blocks_) {
+      put(block);
+    }
+
+    std::memcpy(footer.magic, PriceLevelBookTape::MAGIC, sizeof(footer.magic));
+    put(footer);
+    writeBuffer();
+  }
+
+  // The producer. Queues the pending records if the ring has the slots. Returns true if nothing is pending.
+  bool tryQueuePending() {
+    if (hasPendingBook_) {
+      auto* slot = ring_.tryAcquire();
+
+      if (slot == nullptr) {
+        return false;
+      }
+
+      slot->kind = Kind::NEW_BOOK;
+      slot->time = pendingBookTime_;
+      slot->changes.additions.asks.swap(pendingBook_.asks);
+      slot->changes.additions.bids.swap(pendingBook_.bids);
+      ring_.publish();
+      hasPendingBook_ = false;
+    }
+
+    if (!pendingChanges_.empty()) {
+      auto* slot = ring_.tryAcquire();
+
+      if (slot == nullptr) {
+        return false;
+      }
+
+      slot->kind = Kind::CHANGES;
+      slot->time = pendingTime_;
+      slot->changes = pendingChanges_.flush();
+      ring_.publish();
+    }
+
+    return true;
+  }
+
+  std::int64_t toRecordTime(std::int64_t time) {
+    lastTime_ = (std::max)(lastTime_, time);
+
+    return lastTime_;
+  }
+
+ public:
+  PriceLevelBookTapeWriter(const PriceLevelBookTapeWriter&) = delete;
+  PriceLevelBookTapeWriter& operator=(const PriceLevelBookTapeWriter&) = delete;
+
+  ~PriceLevelBookTapeWriter() { finish(); }
+
+  // Creates the file and starts the thread of the writer. tickSize - the tick size of the prices (0 - unknown, the
+  // 1e-8 ticks), keyframeInterval - the time of the block (ms, the keyframe starts every block), queueCapacity - the
+  // number of the records the book may queue before they are folded. Returns nullptr if the file can't be created.
+  static std::unique_ptr<PriceLevelBookTapeWriter> open(
+    const std::string& path, const std::string& symbol, const std::string& source, double tickSize = 0.0,
+    std::int64_t keyframeInterval = PriceLevelBookTape::DEFAULT_KEYFRAME_INTERVAL, std::size_t queueCapacity = 4096) {
+    auto file = std::fopen(path.c_str(), "wb");
+
+    if (file == nullptr) {
+      return nullptr;
+    }
+
+    auto priceScale = tickSize > 0.0 ? 1.0 / tickSize : PriceLevelBookTape::DEFAULT_PRICE_SCALE;
+    auto writer = std::unique_ptr<PriceLevelBookTapeWriter>(new PriceLevelBookTapeWriter(
+      file, priceScale, keyframeInterval > 0 ? keyframeInterval : PriceLevelBookTape::DEFAULT_KEYFRAME_INTERVAL,
+      queueCapacity));
+
+    writer->buffer_.insert(writer->buffer_.end(), std::begin(PriceLevelBookTape::MAGIC),
+                           std::end(PriceLevelBookTape::MAGIC));
+    writer->put(PriceLevelBookTape::VERSION);
+    writer->put(priceScale);
+
+    for (const auto* name : {&symbol, &source}) {
+      writer->put(static_cast<std::uint32_t>(name->size()));
+      writer->buffer_.insert(writer->buffer_.end(), name->begin(), name->end());
+    }
+
+    writer->writeBuffer();
+    writer->thread_ = std::thread(&PriceLevelBookTapeWriter::run, writer.get());
+
+    return writer;
+  }
+
+  // The producer. Records the new book. time - the time of the book (ms since the epoch). Never blocks.
+  void recordNewBook(std::int64_t time, const PriceLevelChanges& book) {
+    time = toRecordTime(time);
+
+    // The new book replaces the pending records
+    pendingChanges_.clear();
+    hasPendingBook_ = false;
+
+    if (auto* slot = ring_.tryAcquire(); slot != nullptr) {
+      slot->kind = Kind::NEW_BOOK;
+      slot->time = time;
+      slot->changes.additions.asks.assign(book.asks.begin(), book.asks.end());
+      slot->changes.additions.bids.assign(book.bids.begin(), book.bids.end());
+      ring_.publish();
+
+      return;
+    }
+
+    hasPendingBook_ = true;
+    pendingBookTime_ = time;
+    pendingBook_.asks = book.asks;
+    pendingBook_.bids = book.bids;
+    conflatedNumber_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // The producer. Records the changes of the visible levels. Never blocks.
+  void recordChanges(std::int64_t time, const PriceLevelChangesSet& changes) {
+    time = toRecordTime(time);
+
+    if (tryQueuePending()) {
+      if (auto* slot = ring_.tryAcquire(); slot != nullptr) {
+        slot->kind = Kind::CHANGES;
+        slot->time = time;
+        slot->changes = changes;
+        ring_.publish();
+
+        return;
+      }
+    }
+
+    pendingTime_ = time;
+    pendingChanges_.fold(changes);
+    conflatedNumber_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // The producer. Queues the pending records (waits for the ring), stops the thread, writes the index and the footer
+  // and closes the file. Returns false if the file can't be written (the file is not a valid tape).
+  bool finish() {
+    if (isFinished_) {
+      return !isFailed_.load(std::memory_order_relaxed);
+    }
+
+    isFinished_ = true;
+
+    while (!tryQueuePending()) {
+      std::this_thread::yield();
+    }
+
+    ring_.acquire()->kind = Kind::STOP;
+    ring_.publish();
+    thread_.join();
+
+    if (std::fclose(file_) != 0) {
+      isFailed_.store(true, std::memory_order_relaxed);
+    }
+
+    file_ = nullptr;
+
+    return !isFailed_.load(std::memory_order_relaxed);
+  }
+
+  // The number of the records written by the thread (the deltas, the new books and the keyframes)
+  [[nodiscard]] std::uint64_t getRecordsNumber() const { return recordsNumber_.load(std::memory_order_relaxed); }
+
+  // The number of the records that are folded into the next ones because the ring was full
+  [[nodiscard]] std::uint64_t getConflatedNumber() const { return conflatedNumber_.load(std::memory_order_relaxed); }
+
+  // Returns true if the file can't be written
+  [[nodiscard]] bool isFailed() const { return isFailed_.load(std::memory_order_relaxed); }
+};
+
+// The reader of the book tape. The file is mapped; the book at the time is restored by the seek of the block by the
+// index and the decoding of its keyframe and the deltas up to the time.
+class PriceLevelBookTapeReader final {
+  std::unique_ptr<MappedFile> file_;
+  std::string symbol_{};
+  std::string source_{};
+  double priceScale_ = PriceLevelBookTape::DEFAULT_PRICE_SCALE;
+  std::uint64_t recordsNumber_ = 0;
+  std::vector<PriceLevelBookTape::Block> blocks_{};
+
+  explicit PriceLevelBookTapeReader(std::unique_ptr<MappedFile> file) : file_{std::move(file)} {}
+
+  [[nodiscard]] const unsigned char* getData() const { return static_cast<const unsigned char*>(file_->getData()); }
+
+  // The bounds-checked reader of the block
+  struct Cursor {
+    const unsigned char* position;
+    const unsigned char* end;
+    bool isValid = true;
+
+    template <typename T>
+    T get() {
+      T value{};
+
+      if (static_cast<std::size_t>(end - position) < sizeof(T)) {
+        isValid = false;
+
+        return value;
+      }
+
+      std::memcpy(&value, position, sizeof(T));
+      position += sizeof(T);
+
+      return value;
+    }
+
+    std::uint64_t getVarint() {
+      std::uint64_t value = 0;
+
+      for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (position == end) {
+          isValid = false;
+
+          return 0;
+        }
+
+        auto byte = *position++;
+
+        value |= static_cast<std::uint64_t>(byte & 0x7FU) << shift;
+
+        if ((byte & 0x80U) == 0) {
+          return value;
+        }
+      }
+
+      isValid = false;
+
+      return value;
+    }
+  };
+
+  // The state of the decoding of the block
+  struct State {
+    std::int64_t time = 0;
+    std::int64_t previousTicks = 0;
+  };
+
+  bool getString(Cursor& cursor, std::string& result) {
+    auto length = cursor.get<std::uint32_t>();
+
+    if (!cursor.isValid || static_cast<std::size_t>(cursor.end - cursor.position) < length) {
+      return false;
+    }
+
+    result.assign(reinterpret_cast<const char*>(cursor.position), length);
+    cursor.position += length;
+
+    return true;
+  }
+
+  bool load() {
+    auto size = file_->getSize();
+
+    if (size < sizeof(PriceLevelBookTape::MAGIC) + sizeof(PriceLevelBookTape::Footer) ||
+        std::memcmp(getData(), PriceLevelBookTape::MAGIC, sizeof(PriceLevelBookTape::MAGIC)) != 0) {
+      return false;
+    }
+
+    Cursor header{getData() + sizeof(PriceLevelBookTape::MAGIC), getData() + size};
+    auto version = header.get<std::uint32_t>();
+
+    priceScale_ = header.get<double>();
+
+    if (!header.isValid || version != PriceLevelBookTape::VERSION || !getString(header, symbol_) ||
+        !getString(header, source_)) {
+      return false;
+    }
+
+    PriceLevelBookTape::Footer footer{};
+    auto footerOffset = size - sizeof(footer);
+
+    std::memcpy(&footer, getData() + footerOffset, sizeof(footer));
+
+    if (std::memcmp(footer.magic, PriceLevelBookTape::MAGIC, sizeof(footer.magic)) != 0 ||
+        footer.indexOffset > footerOffset ||
+        footer.blocksNumber > (footerOffset - footer.indexOffset) / sizeof(PriceLevelBookTape::Block)) {
+      return false;
+    }
+
+    recordsNumber_ = footer.recordsNumber;
+    blocks_.resize(footer.blocksNumber);
+
+    if (!blocks_.empty()) {
+      std::memcpy(blocks_.data(), getData() + footer.indexOffset, blocks_.size() * sizeof(PriceLevelBookTape::Block));
+    }
+
+    for (const auto& block : blocks_) {
+      if (block.offset > footer.indexOffset || block.size > footer.indexOffset - block.offset) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  double getPrice(Cursor& cursor, State& state) const {
+    auto head = cursor.getVarint();
+
+    if ((head & 1U) != 0) {
+      return cursor.get<double>();
+    }
+
+    state.previousTicks += PriceLevelBookTape::fromZigzag(head >> 1U);
+
+    return static_cast<double>(state.previousTicks) / priceScale_;
+  }
+
+  PriceLevel getLevel(Cursor& cursor, State& state, double previousSize) const {
+    PriceLevel result{};
+
+    result.price = getPrice(cursor, state);
+
+    auto head = cursor.getVarint();
+
+    if ((head & 1U) != 0) {
+      result.size = cursor.get<double>();
+    } else {
+      result.size = previousSize + static_cast<double>(PriceLevelBookTape::fromZigzag(head >> 1U));
+    }
+
+    result.time = state.time + PriceLevelBookTape::fromZigzag(cursor.getVarint());
+
+    return result;
+  }
+
+  template <typename Side>
+  void applyLevels(Cursor& cursor, State& state, std::vector<PriceLevel>& levels, std::uint64_t number) const {
+    for (std::uint64_t i = 0; i < number && cursor.isValid; i++) {
+      // The price is decoded first to find the previous size
+      auto saved = cursor;
+      auto savedState = state;
+      auto price = getPrice(cursor, state);
+      auto position = PriceLevelBookTape::findLevel<Side>(levels, price);
+      auto isFound = position < levels.size() && PriceLevelBookTape::isSamePrice(levels[position].price, price);
+
+      cursor = saved;
+      state = savedState;
+
+      auto level = getLevel(cursor, state, isFound ? levels[position].size : 0.0);
+
+      if (isFound) {
+        levels[position] = level;
+      } else {
+        levels.insert(levels.begin() + static_cast<std::ptrdiff_t>(position), level);
+      }
+    }
+  }
+
+  template <typename Side>
+  void removeLevels(Cursor& cursor, State& state, std::vector<PriceLevel>& levels, std::uint64_t number) const {
+    for (std::uint64_t i = 0; i < number && cursor.isValid; i++) {
+      auto price = getPrice(cursor, state);
+      auto position = PriceLevelBookTape::findLevel<Side>(levels, price);
+
+      if (position < levels.size() && PriceLevelBookTape::isSamePrice(levels[position].price, price)) {
+        levels.erase(levels.begin() + static_cast<std::ptrdiff_t>(position));
+      }
+    }
+  }
+
+  // Decodes the next record of the block to the book. Returns the kind of the record.
+  std::uint64_t decodeRecord(Cursor& cursor, State& state, PriceLevelChanges& book) const {
+    auto header = cursor.getVarint();
+    auto kind = header & 3U;
+
+    state.time += PriceLevelBookTape::fromZigzag(header >> 2U);
+
+    if (kind != PriceLevelBookTape::DELTA) {
+      auto asksNumber = cursor.getVarint();
+      auto bidsNumber = cursor.getVarint();
+
+      book.asks.clear();
+      book.bids.clear();
+
+      for (std::uint64_t i = 0; i < asksNumber && cursor.isValid; i++) {
+        book.asks.push_back(getLevel(cursor, state, 0.0));
+      }
+
+      for (std::uint64_t i = 0; i < bidsNumber && cursor.isValid; i++) {
+        book.bids.push_back(getLevel(cursor, state, 0.0));
+      }
+
+      return kind;
+    }
+
+    std::uint64_t numbers[6]{};
+
+    for (auto& number : numbers) {
+      number = cursor.getVarint();
+    }
+
+    removeLevels<AskSide>(cursor, state, book.asks, numbers[0]);
+    removeLevels<BidSide>(cursor, state, book.bids, numbers[1]);
+    applyLevels<AskSide>(cursor, state, book.asks, numbers[2]);
+    applyLevels<BidSide>(cursor, state, book.bids, numbers[3]);
+    applyLevels<AskSide>(cursor, state, book.asks, numbers[4]);
+    applyLevels<BidSide>(cursor, state, book.bids, numbers[5]);
+
+    return kind;
+  }
+
+  // The last block that starts at the time or before it (the size of the blocks - none)
+  [[nodiscard]] std::size_t findBlock(std::int64_t time) const {
+    auto it =
+      std::upper_bound(blocks_.begin(), blocks_.end(), time,
+                       [](std::int64_t t, const PriceLevelBookTape::Block& block) { return t < block.startTime; });
+
+    return it == blocks_.begin() ? blocks_.size() : static_cast<std::size_t>(it - blocks_.begin() - 1);
+  }
+
+ public:
+  // Maps the tape. Returns nullptr if the file can't be mapped or it's not a complete tape of the supported version
+  static std::unique_ptr<PriceLevelBookTapeReader> open(const std::string& path) {
+    auto file = MappedFile::open(path, false);
+
+    if (!file) {
+      return nullptr;
+    }
+
+    auto reader = std::unique_ptr<PriceLevelBookTapeReader>(new PriceLevelBookTapeReader(std::move(file)));
+
+    return reader->load() ? std::move(reader) : nullptr;
+  }
+
+  [[nodiscard]] const std::string& getSymbol() const { return symbol_; }
+
+  [[nodiscard]] const std::string& getSource() const { return source_; }
+
+  [[nodiscard]] std::uint64_t getRecordsNumber() const { return recordsNumber_; }
+
+  [[nodiscard]] const std::vector<PriceLevelBookTape::Block>& getBlocks() const { return blocks_; }
+
+  // Restores the visible levels of the book at the time (after all records of the time and before it). Returns false
+  // if the time is before the first record or the block is corrupt.
+  bool getBookAt(std::int64_t time, PriceLevelChanges& result) const {
+    auto blockIndex = findBlock(time);
+
+    if (blockIndex == blocks_.size()) {
+      return false;
+    }
+
+    const auto& block = blocks_[blockIndex];
+    Cursor cursor{getData() + block.offset, getData() + block.offset + block.size};
+    State state{};
+
+    for (std::uint32_t i = 0; i < block.recordsNumber; i++) {
+      auto next = cursor;
+      auto nextState = state;
+
+      nextState.time += PriceLevelBookTape::fromZigzag(next.getVarint() >> 2U);
+
+      if (i != 0 && nextState.time > time) {
+        break;
+      }
+
+      decodeRecord(cursor, state, result);
+
+      if (!cursor.isValid) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Passes the book after every new book and delta of the time range [fromTime, toTime) to the f(time, const
+  // PriceLevelChanges&), the blocks before the range are skipped by the index. Returns false if the file is corrupt.
+  template <typename F>
+  bool forEachBook(std::int64_t fromTime, std::int64_t toTime, F&& f) const {
+    auto first = findBlock(fromTime);
+    PriceLevelChanges book{};
+
+    for (auto blockIndex = first == blocks_.size() ? 0 : first; blockIndex < blocks_.size(); blockIndex++) {
+      const auto& block = blocks_[blockIndex];
+
+      if (block.startTime >= toTime) {
+        break;
+      }
+
+      Cursor cursor{getData() + block.offset, getData() + block.offset + block.size};
+      State state{};
+
+      for (std::uint32_t i = 0; i < block.recordsNumber; i++) {
+        auto kind = decodeRecord(cursor, state, book);
+
+        if (!cursor.isValid) {
+          return false;
+        }
+
+        if (state.time >= toTime) {
+          break;
+        }
+
+        if (kind != PriceLevelBookTape::KEYFRAME && state.time >= fromTime) {
+          f(state.time, static_cast<const PriceLevelChanges&>(book));
+        }
+      }
+    }
+
+    return true;
+  }
+};
+
+}  // namespace dxf
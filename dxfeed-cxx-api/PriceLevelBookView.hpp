@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+
+#include "PriceLevel.hpp"
+
+namespace dxf {
+
+// The non-owning view of the visible price levels of one book side (best-first). It reads the live storage of the
+// book, so it is valid only during the handler call. The levels are converted to PriceLevel on access.
+class PriceLevelSideView final {
+  using Accessor = PriceLevel (*)(const void* source, std::size_t position);
+
+  const void* source_ = nullptr;
+  std::size_t size_ = 0;
+  Accessor accessor_ = nullptr;
+
+ public:
+  class ConstIterator final {
+    const PriceLevelSideView* view_ = nullptr;
+    std::size_t position_ = 0;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = PriceLevel;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = PriceLevel;
+
+    ConstIterator() = default;
+
+    ConstIterator(const PriceLevelSideView* view, std::size_t position) : view_{view}, position_{position} {}
+
+    PriceLevel operator*() const { return (*view_)[position_]; }
+
+    ConstIterator& operator++() {
+      position_++;
+
+      return *this;
+    }
+
+    ConstIterator operator++(int) {
+      auto result = *this;
+
+      position_++;
+
+      return result;
+    }
+
+    friend bool operator==(const ConstIterator& a, const ConstIterator& b) { return a.position_ == b.position_; }
+
+    friend bool operator!=(const ConstIterator& a, const ConstIterator& b) { return !(a == b); }
+  };
+
+  PriceLevelSideView() = default;
+
+  PriceLevelSideView(const void* source, std::size_t size, Accessor accessor)
+      : source_{source}, size_{size}, accessor_{accessor} {}
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+
+  [[nodiscard]] bool empty() const { return size_ == 0; }
+
+  PriceLevel operator[](std::size_t position) const { return accessor_(source_, position); }
+
+  [[nodiscard]] ConstIterator begin() const { return {this, 0}; }
+
+  [[nodiscard]] ConstIterator end() const { return {this, size_}; }
+};
+
+struct PriceLevelBookView {
+  PriceLevelSideView asks{};
+  PriceLevelSideView bids{};
+};
+
+}  // namespace dxf
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "PriceLevel.hpp"
+
+namespace dxf {
+
+// The reusable flat set of the price levels ordered by Side (best-first) and unique by price. Clearing keeps the
+// capacity, so the steady-state use doesn't allocate.
+template <typename Level, typename Side>
+class SortedPriceLevelBuffer final {
+  using Price = decltype(Level::price);
+
+  std::vector<Level> levels_{};
+
+  auto lowerBound(Price price) {
+    return std::lower_bound(levels_.begin(), levels_.end(), price,
+                            [](const Level& pl, Price p) { return Side::isBetter(pl.price, p); });
+  }
+
+ public:
+  [[nodiscard]] std::size_t size() const { return levels_.size(); }
+
+  [[nodiscard]] bool empty() const { return levels_.empty(); }
+
+  [[nodiscard]] auto begin() const { return levels_.begin(); }
+
+  [[nodiscard]] auto end() const { return levels_.end(); }
+
+  // Inserts the level or replaces the level with the same price.
+  void insert(const Level& level) {
+    auto found = lowerBound(level.price);
+
+    if (found != levels_.end() && areEqualPrices(found->price, level.price)) {
+      *found = level;
+    } else {
+      levels_.insert(found, level);
+    }
+  }
+
+  // Returns true if the level was erased
+  bool erase(Price price) {
+    auto found = lowerBound(price);
+
+    if (found != levels_.end() && areEqualPrices(found->price, price)) {
+      levels_.erase(found);
+
+      return true;
+    }
+
+    return false;
+  }
+
+  void clear() { levels_.clear(); }
+
+  // The heap bytes held by the buffer
+  [[nodiscard]] std::size_t getMemoryUsage() const { return levels_.capacity() * sizeof(Level); }
+};
+
+// The reusable accumulator of the price level size deltas of one side. The deltas are appended in the arrival order
+// and then sorted (best-first) and merged by price: the sizes are summed, the time of the latest delta is kept and the
+// zero-sum levels are dropped.
+template <typename Level, typename Side>
+class PriceLevelDeltaBuffer final {
+  struct Delta {
+    Level level;
+    std::uint32_t ordinal;
+  };
+
+  std::vector<Delta> deltas_{};
+  std::vector<Level> merged_{};
+
+ public:
+  void add(const Level& level) { deltas_.push_back({level, static_cast<std::uint32_t>(deltas_.size())}); }
+
+  // Sorts and merges the accumulated deltas. The result is valid until the next call of the clear()
+  const std::vector<Level>& merge() {
+    std::sort(deltas_.begin(), deltas_.end(), [](const Delta& a, const Delta& b) {
+      if (Side::isBetter(a.level.price, b.level.price)) return true;
+      if (Side::isBetter(b.level.price, a.level.price)) return false;
+
+      return a.ordinal < b.ordinal;
+    });
+
+    merged_.clear();
+
+    for (const auto& delta : deltas_) {
+      if (!merged_.empty() && areEqualPrices(merged_.back().price, delta.level.price)) {
+        merged_.back().size += delta.level.size;
+        merged_.back().time = delta.level.time;
+      } else {
+        if (!merged_.empty() && isZeroPriceLevel(merged_.back())) {
+          merged_.pop_back();
+        }
+
+        merged_.push_back(delta.level);
+      }
+    }
+
+    if (!merged_.empty() && isZeroPriceLevel(merged_.back())) {
+      merged_.pop_back();
+    }
+
+    return merged_;
+  }
+
+  void clear() {
+    deltas_.clear();
+    merged_.clear();
+  }
+
+  // The heap bytes held by the buffer
+  [[nodiscard]] std::size_t getMemoryUsage() const {
+    return deltas_.capacity() * sizeof(Delta) + merged_.capacity() * sizeof(Level);
+  }
+};
+
+}  // namespace dxf
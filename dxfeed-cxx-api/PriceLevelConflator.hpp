@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "PriceLevel.hpp"
+
+namespace dxf {
+
+// Folds the successive changes sets into one net changes set relative to the last flushed state of the book:
+// addition + update -> addition, addition + removal -> nothing, removal + addition -> update, etc.
+class PriceLevelChangesConflator final {
+  enum class ChangeKind : int { ADDITION = 0, UPDATE = 1, REMOVAL = 2 };
+
+  struct Change {
+    PriceLevel level;
+    ChangeKind kind;
+  };
+
+  // The net changes of one side ordered by Side (best-first) and unique by price.
+  template <typename Side>
+  class SideChanges final {
+    std::vector<Change> changes_{};
+
+   public:
+    void add(const PriceLevel& level, ChangeKind kind) {
+      auto found = std::lower_bound(changes_.begin(), changes_.end(), level.price,
+                                    [](const Change& c, double p) { return Side::isBetter(c.level.price, p); });
+
+      if (found == changes_.end() || !areEqualPrices(found->level.price, level.price)) {
+        changes_.insert(found, Change{level, kind});
+
+        return;
+      }
+
+      switch (found->kind) {
+        case ChangeKind::ADDITION:
+          if (kind == ChangeKind::REMOVAL) {
+            // The consumer has never seen this level
+            changes_.erase(found);
+          } else {
+            found->level = level;
+          }
+
+          break;
+        case ChangeKind::UPDATE:
+          *found = Change{level, kind == ChangeKind::REMOVAL ? ChangeKind::REMOVAL : ChangeKind::UPDATE};
+
+          break;
+        case ChangeKind::REMOVAL:
+          // The consumer still has the old level
+          *found = Change{level, kind == ChangeKind::REMOVAL ? ChangeKind::REMOVAL : ChangeKind::UPDATE};
+
+          break;
+      }
+    }
+
+    void collect(std::vector<PriceLevel>& additions, std::vector<PriceLevel>& updates,
+                 std::vector<PriceLevel>& removals) const {
+      additions.clear();
+      updates.clear();
+      removals.clear();
+
+      for (const auto& change : changes_) {
+        switch (change.kind) {
+          case ChangeKind::ADDITION:
+            additions.push_back(change.level);
+            break;
+          case ChangeKind::UPDATE:
+            updates.push_back(change.level);
+            break;
+          case ChangeKind::REMOVAL:
+            removals.push_back(change.level);
+            break;
+        }
+      }
+    }
+
+    void clear() { changes_.clear(); }
+  };
+
+  SideChanges<AskSide> asks_{};
+  SideChanges<BidSide> bids_{};
+  std::size_t transactionsNumber_ = 0;
+  PriceLevelChangesSet result_{};
+
+ public:
+  // The changes are folded in the order the engine produces them: removals, additions, updates.
+  void fold(const PriceLevelChangesSet& changesSet) {
+    for (const auto& pl : changesSet.removals.asks) asks_.add(pl, ChangeKind::REMOVAL);
+    for (const auto& pl : changesSet.removals.bids) bids_.add(pl, ChangeKind::REMOVAL);
+    for (const auto& pl : changesSet.additions.asks) asks_.add(pl, ChangeKind::ADDITION);
+    for (const auto& pl : changesSet.additions.bids) bids_.add(pl, ChangeKind::ADDITION);
+    for (const auto& pl : changesSet.updates.asks) asks_.add(pl, ChangeKind::UPDATE);
+    for (const auto& pl : changesSet.updates.bids) bids_.add(pl, ChangeKind::UPDATE);
+
+    transactionsNumber_++;
+  }
+
+  // Returns the number of the folded transactions since the last flush.
+  [[nodiscard]] std::size_t getTransactionsNumber() const { return transactionsNumber_; }
+
+  [[nodiscard]] bool empty() const { return transactionsNumber_ == 0; }
+
+  // Returns the net changes and starts a new folding. The result is valid until the next call.
+  const PriceLevelChangesSet& flush() {
+    asks_.collect(result_.additions.asks, result_.updates.asks, result_.removals.asks);
+    bids_.collect(result_.additions.bids, result_.updates.bids, result_.removals.bids);
+    clear();
+
+    return result_;
+  }
+
+  void clear() {
+    asks_.clear();
+    bids_.clear();
+    transactionsNumber_ = 0;
+  }
+};
+
+}  // namespace dxf
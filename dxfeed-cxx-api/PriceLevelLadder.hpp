@@ -0,0 +1,445 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/random_access_index.hpp>
+#include <boost/multi_index_container.hpp>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "PriceLevel.hpp"
+#include "PriceLevelSearch.hpp"
+
+namespace dxf {
+
+namespace bmi = boost::multi_index;
+
+// The storage of the price levels of one book side. Both ladders give random access to the levels in the best-first
+// order: ladder[0] is the best ask (bid), ladder[1] is the next one, etc.
+//
+// Side - AskSide or BidSide
+// Level - PriceLevel or TickPriceLevel
+
+// Node-based ladder: the ordered index is used to look up the levels by price, the random access index is kept in the
+// best-first order by positional insertion.
+template <typename Side, typename Level = PriceLevel>
+class MultiIndexPriceLevelLadder final {
+  using Price = decltype(Level::price);
+
+  struct PriceCompare {
+    bool operator()(Price price1, Price price2) const { return Side::isBetter(price1, price2); }
+  };
+
+  using Container = bmi::multi_index_container<
+    Level, bmi::indexed_by<bmi::random_access<>,
+                           bmi::ordered_unique<bmi::member<Level, Price, &Level::price>, PriceCompare>>>;
+
+  Container levels_{};
+  // The prices of the levels that are removed by the assign (keeps the capacity)
+  std::vector<Price> removedPrices_{};
+
+  auto findByPrice(Price price) const {
+    const auto& byPrice = levels_.template get<1>();
+    auto found = byPrice.lower_bound(price);
+
+    if (found != byPrice.end() && !areEqualPrices(found->price, price)) {
+      return byPrice.end();
+    }
+
+    return found;
+  }
+
+ public:
+  using ConstIterator = typename Container::const_iterator;
+
+  [[nodiscard]] std::size_t size() const { return levels_.size(); }
+
+  [[nodiscard]] bool empty() const { return levels_.empty(); }
+
+  const Level& operator[](std::size_t position) const { return levels_[position]; }
+
+  [[nodiscard]] ConstIterator begin() const { return levels_.begin(); }
+
+  [[nodiscard]] ConstIterator end() const { return levels_.end(); }
+
+  // Returns the best-first position of the level with the given price or size() if there is no such level.
+  [[nodiscard]] std::size_t find(Price price) const {
+    auto found = findByPrice(price);
+
+    if (found == levels_.template get<1>().end()) {
+      return levels_.size();
+    }
+
+    return static_cast<std::size_t>(levels_.template project<0>(found) - levels_.begin());
+  }
+
+  [[nodiscard]] bool contains(Price price) const { return findByPrice(price) != levels_.template get<1>().end(); }
+
+  // Inserts the level or replaces the level with the same price.
+  void insert(const Level& priceLevel) {
+    auto& byPrice = levels_.template get<1>();
+
+    if (auto found = findByPrice(priceLevel.price); found != byPrice.end()) {
+      byPrice.replace(found, priceLevel);
+
+      return;
+    }
+
+    levels_.insert(levels_.template project<0>(byPrice.lower_bound(priceLevel.price)), priceLevel);
+  }
+
+  void erase(Price price) {
+    if (auto found = findByPrice(price); found != levels_.template get<1>().end()) {
+      levels_.template get<1>().erase(found);
+    }
+  }
+
+  // Replaces the levels by the sorted (best-first) levels of the range in one pass: the levels of the same prices are
+  // changed in place, the new levels are inserted by the hints, so only the nodes of the new and the removed prices are
+  // allocated and freed. The removed levels are dropped and the best-first order is restored by one linear pass each.
+  template <typename It>
+  void assign(It begin, It end) {
+    auto& byPrice = levels_.template get<1>();
+    auto current = byPrice.begin();
+    auto isInserted = false;
+
+    removedPrices_.clear();
+
+    for (auto it = begin; it != end; ++it) {
+      while (current != byPrice.end() && !areEqualPrices(current->price, it->price) &&
+             Side::isBetter(current->price, it->price)) {
+        removedPrices_.push_back(current->price);
+        ++current;
+      }
+
+      if (current != byPrice.end() && areEqualPrices(current->price, it->price)) {
+        if (current->size != it->size || current->time != it->time) {
+          byPrice.replace(current, Level{current->price, it->size, it->time});
+        }
+
+        ++current;
+      } else {
+        byPrice.insert(current, *it);
+        isInserted = true;
+      }
+    }
+
+    for (; current != byPrice.end(); ++current) {
+      removedPrices_.push_back(current->price);
+    }
+
+    if (!removedPrices_.empty()) {
+      levels_.remove_if([this](const Level& level) {
+        return std::binary_search(removedPrices_.begin(), removedPrices_.end(), level.price, PriceCompare{});
+      });
+    }
+
+    // The inserted levels are at the end of the random access index
+    if (isInserted) {
+      levels_.rearrange(byPrice.begin());
+    }
+  }
+
+  void clear() { levels_.clear(); }
+
+  // The estimated heap bytes held by the ladder: every node holds the level, the ordered index links (3 pointers) and
+  // the random access back pointer, the random access index holds the array of the node pointers.
+  [[nodiscard]] std::size_t getMemoryUsage() const {
+    return levels_.size() * (sizeof(Level) + 4 * sizeof(void*)) + levels_.capacity() * sizeof(void*) +
+           removedPrices_.capacity() * sizeof(Price);
+  }
+};
+
+// Contiguous ladder: the levels are kept in a sorted vector in the worst-first order, so the best price is at the back.
+// Most of the changes happen near the best price and shift only a few adjacent levels, and the top of the book stays
+// in a few cache lines.
+template <typename Side, typename Level = PriceLevel>
+class FlatPriceLevelLadder final {
+  using Price = decltype(Level::price);
+
+  std::vector<Level> levels_{};
+
+  auto lowerBound(Price price) const {
+    return std::lower_bound(levels_.begin(), levels_.end(), price,
+                            [](const Level& pl, Price p) { return Side::isBetter(p, pl.price); });
+  }
+
+  auto lowerBound(Price price) {
+    return std::lower_bound(levels_.begin(), levels_.end(), price,
+                            [](const Level& pl, Price p) { return Side::isBetter(p, pl.price); });
+  }
+
+ public:
+  using ConstIterator = typename std::vector<Level>::const_reverse_iterator;
+
+  [[nodiscard]] std::size_t size() const { return levels_.size(); }
+
+  [[nodiscard]] bool empty() const { return levels_.empty(); }
+
+  const Level& operator[](std::size_t position) const { return levels_[levels_.size() - 1 - position]; }
+
+  [[nodiscard]] ConstIterator begin() const { return levels_.rbegin(); }
+
+  [[nodiscard]] ConstIterator end() const { return levels_.rend(); }
+
+  // Returns the best-first position of the level with the given price or size() if there is no such level.
+  [[nodiscard]] std::size_t find(Price price) const {
+    auto found = lowerBound(price);
+
+    if (found == levels_.end() || !areEqualPrices(found->price, price)) {
+      return levels_.size();
+    }
+
+    return static_cast<std::size_t>(levels_.end() - found) - 1;
+  }
+
+  [[nodiscard]] bool contains(Price price) const { return find(price) != levels_.size(); }
+
+  // Inserts the level or replaces the level with the same price.
+  void insert(const Level& priceLevel) {
+    auto found = lowerBound(priceLevel.price);
+
+    if (found != levels_.end() && areEqualPrices(found->price, priceLevel.price)) {
+      *found = priceLevel;
+    } else {
+      levels_.insert(found, priceLevel);
+    }
+  }
+
+  void erase(Price price) {
+    auto found = lowerBound(price);
+
+    if (found != levels_.end() && areEqualPrices(found->price, price)) {
+      levels_.erase(found);
+    }
+  }
+
+  // Replaces the levels by the sorted (best-first) levels of the range in one pass. Keeps the capacity.
+  template <typename It>
+  void assign(It begin, It end) {
+    levels_.assign(std::make_reverse_iterator(end), std::make_reverse_iterator(begin));
+  }
+
+  // Keeps the capacity
+  void clear() { levels_.clear(); }
+
+  // The heap bytes held by the ladder
+  [[nodiscard]] std::size_t getMemoryUsage() const { return levels_.capacity() * sizeof(Level); }
+};
+
+// Fixed-depth ladder: the best Depth levels are kept in the array in the best-first order, the rest of the levels are
+// kept in the contiguous ladder. The depth is known at compile time, so the engine's depth checks are folded. The top
+// is searched by the vector comparison of all its prices (see PriceLevelSearch).
+template <std::size_t Depth, typename Side, typename Level = PriceLevel>
+class FixedDepthPriceLevelLadderImpl final {
+  static_assert(Depth > 0);
+
+  using Price = decltype(Level::price);
+
+  static constexpr std::size_t SEARCH_DEPTH =
+    (Depth + PriceLevelSearch::LANES - 1) / PriceLevelSearch::LANES * PriceLevelSearch::LANES;
+
+  std::array<Level, Depth> top_{};
+  // The copy of the top prices for the vector search (padded with the sentinel prices)
+  std::array<Price, SEARCH_DEPTH> topPrices_{};
+  std::size_t topSize_ = 0;
+  // Is not empty only if the top is full
+  FlatPriceLevelLadder<Side, Level> rest_{};
+
+  // The position of the first top level that is not better than the price
+  [[nodiscard]] std::size_t topLowerBound(Price price) const {
+    return PriceLevelSearch::countBetter<Side>(topPrices_.data(), SEARCH_DEPTH, price);
+  }
+
+  void setTop(std::size_t position, const Level& priceLevel) {
+    top_[position] = priceLevel;
+    topPrices_[position] = priceLevel.price;
+  }
+
+ public:
+  static constexpr std::size_t DEPTH = Depth;
+
+  FixedDepthPriceLevelLadderImpl() { topPrices_.fill(PriceLevelSearch::getSentinelPrice<Side, Price>()); }
+
+  class ConstIterator final {
+    const FixedDepthPriceLevelLadderImpl* ladder_ = nullptr;
+    std::size_t position_ = 0;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Level;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Level*;
+    using reference = const Level&;
+
+    ConstIterator() = default;
+
+    ConstIterator(const FixedDepthPriceLevelLadderImpl* ladder, std::size_t position)
+        : ladder_{ladder}, position_{position} {}
+
+    const Level& operator*() const { return (*ladder_)[position_]; }
+
+    const Level* operator->() const { return &(*ladder_)[position_]; }
+
+    ConstIterator& operator++() {
+      position_++;
+
+      return *this;
+    }
+
+    ConstIterator operator++(int) {
+      auto result = *this;
+
+      position_++;
+
+      return result;
+    }
+
+    ConstIterator operator+(std::ptrdiff_t n) const {
+      return {ladder_, static_cast<std::size_t>(static_cast<std::ptrdiff_t>(position_) + n)};
+    }
+
+    friend bool operator==(const ConstIterator& a, const ConstIterator& b) { return a.position_ == b.position_; }
+
+    friend bool operator!=(const ConstIterator& a, const ConstIterator& b) { return !(a == b); }
+  };
+
+  [[nodiscard]] std::size_t size() const { return topSize_ + rest_.size(); }
+
+  [[nodiscard]] bool empty() const { return topSize_ == 0; }
+
+  const Level& operator[](std::size_t position) const {
+    return position < Depth ? top_[position] : rest_[position - Depth];
+  }
+
+  [[nodiscard]] ConstIterator begin() const { return {this, 0}; }
+
+  [[nodiscard]] ConstIterator end() const { return {this, size()}; }
+
+  // Returns the best-first position of the level with the given price or size() if there is no such level.
+  [[nodiscard]] std::size_t find(Price price) const {
+    auto position = topLowerBound(price);
+
+    if (position < topSize_) {
+      return areEqualPrices(top_[position].price, price) ? position : size();
+    }
+
+    if (topSize_ < Depth) {
+      return size();
+    }
+
+    auto restPosition = rest_.find(price);
+
+    return restPosition == rest_.size() ? size() : Depth + restPosition;
+  }
+
+  [[nodiscard]] bool contains(Price price) const { return find(price) != size(); }
+
+  // Inserts the level or replaces the level with the same price.
+  void insert(const Level& priceLevel) {
+    auto position = topLowerBound(priceLevel.price);
+
+    if (position < topSize_ && areEqualPrices(top_[position].price, priceLevel.price)) {
+      setTop(position, priceLevel);
+
+      return;
+    }
+
+    if (position == Depth) {
+      rest_.insert(priceLevel);
+
+      return;
+    }
+
+    if (topSize_ == Depth) {
+      // The worst top level becomes the best level of the rest
+      rest_.insert(top_[Depth - 1]);
+      topSize_--;
+    }
+
+    for (auto i = topSize_; i > position; i--) {
+      setTop(i, top_[i - 1]);
+    }
+
+    setTop(position, priceLevel);
+    topSize_++;
+  }
+
+  void erase(Price price) {
+    auto position = topLowerBound(price);
+
+    if (position == topSize_ || !areEqualPrices(top_[position].price, price)) {
+      if (position == Depth) {
+        rest_.erase(price);
+      }
+
+      return;
+    }
+
+    for (auto i = position; i + 1 < topSize_; i++) {
+      setTop(i, top_[i + 1]);
+    }
+
+    topSize_--;
+
+    if (!rest_.empty()) {
+      // The best level of the rest moves to the top
+      setTop(topSize_, rest_[0]);
+      topSize_++;
+      rest_.erase(rest_[0].price);
+    } else {
+      topPrices_[topSize_] = PriceLevelSearch::getSentinelPrice<Side, Price>();
+    }
+  }
+
+  // Replaces the levels by the sorted (best-first) levels of the range in one pass
+  template <typename It>
+  void assign(It begin, It end) {
+    clear();
+
+    for (auto it = begin; it != end; ++it) {
+      if (topSize_ == Depth) {
+        rest_.assign(it, end);
+
+        return;
+      }
+
+      setTop(topSize_++, *it);
+    }
+  }
+
+  void clear() {
+    topSize_ = 0;
+    topPrices_.fill(PriceLevelSearch::getSentinelPrice<Side, Price>());
+    rest_.clear();
+  }
+
+  // The bytes held by the ladder (the inline top arrays and the heap storage of the rest)
+  [[nodiscard]] std::size_t getMemoryUsage() const {
+    return sizeof(top_) + sizeof(topPrices_) + rest_.getMemoryUsage();
+  }
+};
+
+// Adapts the fixed-depth ladder to the Ladder template parameter of the PriceLevelBookEngine:
+//   PriceLevelBookEngine<FixedDepthPriceLevelLadder<10>::Type>
+template <std::size_t Depth>
+struct FixedDepthPriceLevelLadder {
+  template <typename Side, typename Level = PriceLevel>
+  using Type = FixedDepthPriceLevelLadderImpl<Depth, Side, Level>;
+};
+
+// The compile-time depth of the ladder, 0 - the depth is not fixed
+template <typename Ladder>
+struct FixedLadderDepth {
+  static constexpr std::size_t VALUE = 0;
+};
+
+template <std::size_t Depth, typename Side, typename Level>
+struct FixedLadderDepth<FixedDepthPriceLevelLadderImpl<Depth, Side, Level>> {
+  static constexpr std::size_t VALUE = Depth;
+};
+
+}  // namespace dxf
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "CpuFeatures.hpp"
+#include "PriceLevel.hpp"
+
+#if defined(DXFCXX_CPU_X86)
+#define DXFCXX_PRICE_SEARCH_X86 1
+#elif defined(DXFCXX_CPU_NEON)
+#define DXFCXX_PRICE_SEARCH_NEON 1
+#endif
+
+namespace dxf {
+
+enum class PriceLevelSearchStrategy : int {
+  // The loop of the scalar comparisons
+  SCALAR = 0,
+  // 4 prices per the 256-bit comparison (x86-64 with AVX2)
+  AVX2 = 1,
+  // 2 prices per the 128-bit comparison (AArch64)
+  NEON = 2
+};
+
+// The branchless search in the short best-first array of the prices (the top of the ladder): counts the prices that
+// are better than the given one, i.e. returns the lower bound position. The array is padded to the multiple of LANES
+// with the sentinel prices that are never better (see getSentinelPrice).
+//
+// The vector strategy is selected at run time by the CPU feature detection, the scalar one is the fallback.
+struct PriceLevelSearch {
+  static constexpr std::size_t LANES = 4;
+
+ private:
+  static std::atomic<PriceLevelSearchStrategy>& strategy() {
+    static std::atomic<PriceLevelSearchStrategy> strategy{getSupportedStrategy()};
+
+    return strategy;
+  }
+
+  template <typename Side, typename Price>
+  static std::size_t countBetterScalar(const Price* prices, std::size_t size, Price price) {
+    std::size_t result = 0;
+
+    for (std::size_t i = 0; i < size; i++) {
+      result += Side::isBetter(prices[i], price) ? 1 : 0;
+    }
+
+    return result;
+  }
+
+#ifdef DXFCXX_PRICE_SEARCH_X86
+  template <typename Side>
+  DXFCXX_TARGET_AVX2 static std::size_t countBetterAvx2(const double* prices, std::size_t size, double price) {
+    auto value = _mm256_set1_pd(price);
+    std::size_t result = 0;
+
+    for (std::size_t i = 0; i < size; i += LANES) {
+      auto block = _mm256_loadu_pd(prices + i);
+      // The ordered comparisons are false for the NaN prices (the worst ones)
+      auto better = std::is_same_v<Side, AskSide> ? _mm256_cmp_pd(block, value, _CMP_LT_OQ)
+                                                  : _mm256_cmp_pd(block, value, _CMP_GT_OQ);
+
+      result += static_cast<std::size_t>(std::popcount(static_cast<unsigned>(_mm256_movemask_pd(better))));
+    }
+
+    return result;
+  }
+
+  template <typename Side>
+  DXFCXX_TARGET_AVX2 static std::size_t countBetterAvx2(const std::int64_t* prices, std::size_t size,
+                                                        std::int64_t price) {
+    auto value = _mm256_set1_epi64x(price);
+    std::size_t result = 0;
+
+    for (std::size_t i = 0; i < size; i += LANES) {
+      auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prices + i));
+      auto better =
+        std::is_same_v<Side, AskSide> ? _mm256_cmpgt_epi64(value, block) : _mm256_cmpgt_epi64(block, value);
+
+      result +=
+        static_cast<std::size_t>(std::popcount(static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(better)))));
+    }
+
+    return result;
+  }
+#endif
+
+#ifdef DXFCXX_PRICE_SEARCH_NEON
+  template <typename Side>
+  static std::size_t countBetterNeon(const double* prices, std::size_t size, double price) {
+    auto value = vdupq_n_f64(price);
+    // Every better lane is all ones, i.e. -1
+    auto result = vdupq_n_s64(0);
+
+    for (std::size_t i = 0; i < size; i += 2) {
+      auto block = vld1q_f64(prices + i);
+      auto better = std::is_same_v<Side, AskSide> ? vcltq_f64(block, value) : vcgtq_f64(block, value);
+
+      result = vaddq_s64(result, vreinterpretq_s64_u64(better));
+    }
+
+    return static_cast<std::size_t>(-vaddvq_s64(result));
+  }
+
+  template <typename Side>
+  static std::size_t countBetterNeon(const std::int64_t* prices, std::size_t size, std::int64_t price) {
+    auto value = vdupq_n_s64(price);
+    auto result = vdupq_n_s64(0);
+
+    for (std::size_t i = 0; i < size; i += 2) {
+      auto block = vld1q_s64(prices + i);
+      auto better = std::is_same_v<Side, AskSide> ? vcltq_s64(block, value) : vcgtq_s64(block, value);
+
+      result = vaddq_s64(result, vreinterpretq_s64_u64(better));
+    }
+
+    return static_cast<std::size_t>(-vaddvq_s64(result));
+  }
+#endif
+
+ public:
+  // Returns the best strategy that is supported by the CPU
+  static PriceLevelSearchStrategy getSupportedStrategy() {
+#if defined(DXFCXX_PRICE_SEARCH_X86)
+    return CpuFeatures::hasAvx2() ? PriceLevelSearchStrategy::AVX2 : PriceLevelSearchStrategy::SCALAR;
+#elif defined(DXFCXX_PRICE_SEARCH_NEON)
+    return PriceLevelSearchStrategy::NEON;
+#else
+    return PriceLevelSearchStrategy::SCALAR;
+#endif
+  }
+
+  [[nodiscard]] static PriceLevelSearchStrategy getStrategy() { return strategy().load(std::memory_order_relaxed); }
+
+  // Selects the strategy for all the books (e.g. to compare them). The unsupported strategy is replaced by SCALAR.
+  static void setStrategy(PriceLevelSearchStrategy newStrategy) {
+    if (newStrategy != PriceLevelSearchStrategy::SCALAR && newStrategy != getSupportedStrategy()) {
+      newStrategy = PriceLevelSearchStrategy::SCALAR;
+    }
+
+    strategy().store(newStrategy, std::memory_order_relaxed);
+  }
+
+  // The padding price that is never better than any price of the side
+  template <typename Side, typename Price>
+  static constexpr Price getSentinelPrice() {
+    if constexpr (std::numeric_limits<Price>::has_quiet_NaN) {
+      return std::numeric_limits<Price>::quiet_NaN();
+    } else {
+      return std::is_same_v<Side, AskSide> ? std::numeric_limits<Price>::max() : std::numeric_limits<Price>::min();
+    }
+  }
+
+  // Returns the number of the prices that are better than the price. size - the multiple of LANES
+  template <typename Side, typename Price>
+  static std::size_t countBetter(const Price* prices, std::size_t size, Price price) {
+    if constexpr (std::numeric_limits<Price>::has_quiet_NaN) {
+      // The NaN price is the worst one, so all the not NaN prices are better (the vector comparisons are false)
+      if (std::isnan(price)) {
+        return countBetterScalar<Side>(prices, size, price);
+      }
+    }
+
+    switch (getStrategy()) {
+#ifdef DXFCXX_PRICE_SEARCH_X86
+      case PriceLevelSearchStrategy::AVX2:
+        return countBetterAvx2<Side>(prices, size, price);
+#endif
+#ifdef DXFCXX_PRICE_SEARCH_NEON
+      case PriceLevelSearchStrategy::NEON:
+        return countBetterNeon<Side>(prices, size, price);
+#endif
+      default:
+        return countBetterScalar<Side>(prices, size, price);
+    }
+  }
+};
+
+}  // namespace dxf
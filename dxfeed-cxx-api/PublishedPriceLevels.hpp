@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "PriceLevel.hpp"
+#include "PriceLevelBookView.hpp"
+
+namespace dxf {
+
+// The seqlock-protected copy of the best price levels of the book. One writer publishes the levels after every change,
+// any number of the readers on the other threads copy them out. The readers never block the writer and never write to
+// the shared memory: a reader retries if the writer has changed the levels during the copying.
+class PublishedPriceLevels final {
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+  // price, size, time
+  static constexpr std::size_t WORDS_PER_LEVEL = 3;
+
+  std::size_t levelsNumber_;
+  // Odd - the writer is changing the levels
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> sequence_{0};
+  std::atomic<std::size_t> asksNumber_{0};
+  std::atomic<std::size_t> bidsNumber_{0};
+  // The asks, then the bids. The words are atomic, so the concurrent copying is not a data race.
+  std::unique_ptr<std::atomic<std::uint64_t>[]> words_;
+
+  void store(std::size_t word, const PriceLevel& pl) {
+    words_[word].store(std::bit_cast<std::uint64_t>(pl.price), std::memory_order_relaxed);
+    words_[word + 1].store(std::bit_cast<std::uint64_t>(pl.size), std::memory_order_relaxed);
+    words_[word + 2].store(static_cast<std::uint64_t>(pl.time), std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] PriceLevel load(std::size_t word) const {
+    return {std::bit_cast<double>(words_[word].load(std::memory_order_relaxed)),
+            std::bit_cast<double>(words_[word + 1].load(std::memory_order_relaxed)),
+            static_cast<std::int64_t>(words_[word + 2].load(std::memory_order_relaxed))};
+  }
+
+ public:
+  // levelsNumber - the number of the published best levels of every side
+  explicit PublishedPriceLevels(std::size_t levelsNumber)
+      : levelsNumber_{levelsNumber}, words_{new std::atomic<std::uint64_t>[2 * levelsNumber * WORDS_PER_LEVEL]} {}
+
+  [[nodiscard]] std::size_t getLevelsNumber() const { return levelsNumber_; }
+
+  // The writer
+  void publish(const PriceLevelBookView& view) {
+    auto sequence = sequence_.load(std::memory_order_relaxed);
+
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto asksNumber = (std::min)(view.asks.size(), levelsNumber_);
+    auto bidsNumber = (std::min)(view.bids.size(), levelsNumber_);
+
+    for (std::size_t i = 0; i < asksNumber; i++) {
+      store(i * WORDS_PER_LEVEL, view.asks[i]);
+    }
+
+    for (std::size_t i = 0; i < bidsNumber; i++) {
+      store((levelsNumber_ + i) * WORDS_PER_LEVEL, view.bids[i]);
+    }
+
+    asksNumber_.store(asksNumber, std::memory_order_relaxed);
+    bidsNumber_.store(bidsNumber, std::memory_order_relaxed);
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  // The reader. Copies the consistent best levels to the result (the vectors keep their capacity). Returns the
+  // number of the publications so far, so the reader can skip the unchanged book.
+  std::uint64_t read(PriceLevelChanges& result) const {
+    while (true) {
+      auto sequence = sequence_.load(std::memory_order_acquire);
+
+      if ((sequence & 1) != 0) {
+        continue;
+      }
+
+      auto asksNumber = (std::min)(asksNumber_.load(std::memory_order_relaxed), levelsNumber_);
+      auto bidsNumber = (std::min)(bidsNumber_.load(std::memory_order_relaxed), levelsNumber_);
+
+      result.asks.resize(asksNumber);
+      result.bids.resize(bidsNumber);
+
+      for (std::size_t i = 0; i < asksNumber; i++) {
+        result.asks[i] = load(i * WORDS_PER_LEVEL);
+      }
+
+      for (std::size_t i = 0; i < bidsNumber; i++) {
+        result.bids[i] = load((levelsNumber_ + i) * WORDS_PER_LEVEL);
+      }
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      if (sequence_.load(std::memory_order_relaxed) == sequence) {
+        return sequence / 2;
+      }
+    }
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ConnectionPool.hpp"
+#include "EventReceiver.hpp"
+#include "Executor.hpp"
+#include "Metrics.hpp"
+#include "StringConverter.hpp"
+#include "SymbolPerfectHash.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The top of the book of the symbol (the latest Quote)
+struct CachedQuote {
+  std::int64_t time = 0;
+  // NaN - the side is empty
+  double bidPrice = std::numeric_limits<double>::quiet_NaN();
+  double bidSize = std::numeric_limits<double>::quiet_NaN();
+  double askPrice = std::numeric_limits<double>::quiet_NaN();
+  double askSize = std::numeric_limits<double>::quiet_NaN();
+  char bidExchangeCode = '\0';
+  char askExchangeCode = '\0';
+  // The number of the updates of the symbol so far
+  std::uint64_t updatesNumber = 0;
+
+  [[nodiscard]] bool isTwoSided() const { return !std::isnan(bidPrice) && !std::isnan(askPrice); }
+
+  // NaN if the quote is not two-sided
+  [[nodiscard]] double getMid() const {
+    return isTwoSided() ? (bidPrice + askPrice) / 2.0 : std::numeric_limits<double>::quiet_NaN();
+  }
+};
+
+// The latest bid and ask of every symbol for the readers on any thread: the flat array of the seqlock-protected slots
+// of one cache line, indexed by the id of the interned symbol (see Symbol::getId). The listener threads update the
+// slots (see subscribe), the readers copy them out without the locks and the allocations; the reader retries only
+// while the slot it reads is being written. The writers of the same symbol (e.g. the redundant connections) are
+// serialized by the sequence of the slot.
+//
+// Usage:
+//   QuoteCache quotes{SymbolTable::getInstance().getSize() + 1000};
+//   auto stop = quotes.subscribe(executor, address, symbols);
+//
+//   if (auto quote = quotes.read(Symbol::valueOf("AAPL"))) { ... quote->bidPrice ... }
+//
+// The capacity is fixed at the creation (64 bytes per slot), the quotes of the symbols with the larger ids are dropped
+// and counted (see getDroppedNumber).
+//
+// The cache of the day's symbol universe is indexed by the dense ids of the SymbolUniverseIndex instead (the positions
+// of the perfect hash of the universe and the ids of the symbols added intraday), so the capacity is the size of the
+// universe plus the expected additions, and the ids of the snapshot are the ids of the index:
+//   QuoteCache quotes{index, 1000};
+class QuoteCache final {
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  struct alignas(CACHE_LINE_SIZE) Slot {
+    // Odd - the writer is changing the slot. sequence / 2 - the number of the updates (0 - no quote yet).
+    std::atomic<std::uint64_t> sequence{0};
+    std::atomic<std::uint64_t> time{0};
+    std::atomic<std::uint64_t> bidPrice{0};
+    std::atomic<std::uint64_t> bidSize{0};
+    std::atomic<std::uint64_t> askPrice{0};
+    std::atomic<std::uint64_t> askSize{0};
+    // The bid exchange code in the low byte, the ask one in the next byte
+    std::atomic<std::uint64_t> exchangeCodes{0};
+  };
+
+  static_assert(sizeof(Slot) == CACHE_LINE_SIZE);
+
+  std::unique_ptr<Slot[]> slots_;
+  std::size_t capacity_;
+  // The highest id of the updated symbol + 1 (bounds the scan of the snapshot)
+  std::atomic<std::size_t> usedSize_{0};
+  std::atomic<std::uint64_t> updatesNumber_{0};
+  std::atomic<std::uint64_t> droppedNumber_{0};
+  // nullptr - the slots are indexed by the ids of the interned symbols
+  SymbolUniverseIndex *index_;
+
+  static void store(std::atomic<std::uint64_t> &word, double value) {
+    word.store(std::bit_cast<std::uint64_t>(value), std::memory_order_relaxed);
+  }
+
+  static double loadDouble(const std::atomic<std::uint64_t> &word) {
+    return std::bit_cast<double>(word.load(std::memory_order_relaxed));
+  }
+
+  // Returns false if the slot has no quote yet
+  static bool read(const Slot &slot, CachedQuote &result) {
+    while (true) {
+      auto sequence = slot.sequence.load(std::memory_order_acquire);
+
+      if (sequence == 0) {
+        return false;
+      }
+
+      if ((sequence & 1) != 0) {
+        continue;
+      }
+
+      auto exchangeCodes = slot.exchangeCodes.load(std::memory_order_relaxed);
+
+      result.time = static_cast<std::int64_t>(slot.time.load(std::memory_order_relaxed));
+      result.bidPrice = loadDouble(slot.bidPrice);
+      result.bidSize = loadDouble(slot.bidSize);
+      result.askPrice = loadDouble(slot.askPrice);
+      result.askSize = loadDouble(slot.askSize);
+      result.bidExchangeCode = static_cast<char>(exchangeCodes & 0xFFU);
+      result.askExchangeCode = static_cast<char>((exchangeCodes >> 8) & 0xFFU);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+        result.updatesNumber = sequence / 2;
+
+        return true;
+      }
+    }
+  }
+
+ public:
+  // capacity - the number of the slots, the symbols with the ids less than the capacity are cached
+  explicit QuoteCache(std::size_t capacity)
+      : slots_{std::make_unique<Slot[]>(capacity)}, capacity_{capacity}, index_{nullptr} {}
+
+  // The slots are indexed by the ids of the index, the new symbols are added to the index by the writers. The index
+  // must outlive the cache.
+  QuoteCache(SymbolUniverseIndex &index, std::size_t addedCapacity)
+      : slots_{std::make_unique<Slot[]>(index.getUniverseSize() + addedCapacity)},
+        capacity_{index.getUniverseSize() + addedCapacity},
+        index_{&index} {}
+
+  QuoteCache(const QuoteCache &) = delete;
+  QuoteCache &operator=(const QuoteCache &) = delete;
+
+  // The writer (e.g. the listener thread). Stores the latest quote of the symbol.
+  void update(const Symbol &symbol, const dxf_quote_t &quote) {
+    auto id = index_ != nullptr ? index_->add(symbol) : static_cast<std::size_t>(symbol.getId());
+
+    if (id >= capacity_) {
+      droppedNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      return;
+    }
+
+    auto &slot = slots_[id];
+    auto sequence = slot.sequence.load(std::memory_order_relaxed);
+
+    // Takes the slot from the other writers of the symbol
+    while ((sequence & 1) != 0 ||
+           !slot.sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_relaxed)) {
+      sequence = slot.sequence.load(std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.time.store(static_cast<std::uint64_t>(quote.time), std::memory_order_relaxed);
+    store(slot.bidPrice, quote.bid_price);
+    store(slot.bidSize, quote.bid_size);
+    store(slot.askPrice, quote.ask_price);
+    store(slot.askSize, quote.ask_size);
+    slot.exchangeCodes.store(
+      static_cast<std::uint64_t>(static_cast<unsigned char>(StringConverter::wCharToUtf8(quote.bid_exchange_code))) |
+        (static_cast<std::uint64_t>(static_cast<unsigned char>(StringConverter::wCharToUtf8(quote.ask_exchange_code)))
+         << 8),
+      std::memory_order_relaxed);
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+
+    auto usedSize = usedSize_.load(std::memory_order_relaxed);
+
+    while (usedSize <= id && !usedSize_.compare_exchange_weak(usedSize, id + 1, std::memory_order_relaxed)) {
+    }
+
+    updatesNumber_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Subscribes to the quotes of the symbols on the connection (from the pool if it's set) and updates the cache by the
+  // latest quote of every listener call. Returns the stop of the subscription (see EventReceiver::receiveBatchesAsync).
+  // The executor, the pool and the cache must outlive the subscription.
+  std::function<void()> subscribe(Executor &executor, const std::string &address,
+                                  const std::vector<std::string> &symbols, ConnectionPool *pool = nullptr) {
+    return EventReceiver::receiveBatchesAsync<dxf_quote_t>(
+      executor, DXF_ET_QUOTE, false, address, symbols,
+      [this](std::size_t, const Symbol &symbol, const dxf_quote_t *quotes, std::size_t count) {
+        if (count != 0) {
+          update(symbol, quotes[count - 1]);
+        }
+      },
+      0, pool, std::nullopt, [](bool) {});
+  }
+
+  // The reader (any thread). std::nullopt - there is no quote of the symbol yet.
+  [[nodiscard]] std::optional<CachedQuote> read(const Symbol &symbol) const {
+    CachedQuote result{};
+
+    if (!read(symbol, result)) {
+      return std::nullopt;
+    }
+
+    return result;
+  }
+
+  // Returns false if there is no quote of the symbol yet
+  bool read(const Symbol &symbol, CachedQuote &result) const {
+    // The symbol that is not in the index is NOT_FOUND, so it's past the capacity
+    auto id = index_ != nullptr ? index_->find(symbol) : static_cast<std::size_t>(symbol.getId());
+
+    return id < capacity_ && read(slots_[id], result);
+  }
+
+  // The bulk read of the symbols: result[i] is the quote of the symbols[i] (std::nullopt - no quote yet). Every quote
+  // is consistent, the quotes of the different symbols are read one after another. Returns the number of the quotes.
+  std::size_t snapshot(std::span<const Symbol> symbols, std::vector<std::optional<CachedQuote>> &result) const {
+    std::size_t quotesNumber = 0;
+    CachedQuote quote{};
+
+    result.clear();
+    result.reserve(symbols.size());
+
+    for (const auto &symbol : symbols) {
+      if (read(symbol, quote)) {
+        result.emplace_back(quote);
+        quotesNumber++;
+      } else {
+        result.emplace_back(std::nullopt);
+      }
+    }
+
+    return quotesNumber;
+  }
+
+  // The bulk read of all cached quotes: the ids of the symbols (see SymbolTable::getSymbol, or the ids of the index)
+  // and their quotes in the order of the ids. The capacity of the result is kept.
+  void snapshotAll(std::vector<std::pair<std::uint32_t, CachedQuote>> &result) const {
+    auto usedSize = usedSize_.load(std::memory_order_relaxed);
+    CachedQuote quote{};
+
+    result.clear();
+
+    for (std::size_t id = 0; id < usedSize; id++) {
+      if (read(slots_[id], quote)) {
+        result.emplace_back(static_cast<std::uint32_t>(id), quote);
+      }
+    }
+  }
+
+  [[nodiscard]] std::size_t getCapacity() const { return capacity_; }
+
+  [[nodiscard]] std::uint64_t getUpdatesNumber() const { return updatesNumber_.load(std::memory_order_relaxed); }
+
+  // The quotes of the symbols whose ids don't fit the capacity
+  [[nodiscard]] std::uint64_t getDroppedNumber() const { return droppedNumber_.load(std::memory_order_relaxed); }
+
+  void collectMetrics(MetricsWriter &writer, const MetricLabels &labels = {}) const {
+    writer.counter("dxf_quote_cache_updates_total", "The quotes stored to the cache", labels,
+                   static_cast<double>(getUpdatesNumber()));
+    writer.counter("dxf_quote_cache_dropped_total", "The quotes of the symbols whose ids don't fit the capacity",
+                   labels, static_cast<double>(getDroppedNumber()));
+  }
+};
+
+}  // namespace dxf
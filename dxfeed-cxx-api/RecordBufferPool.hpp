@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace dxf {
+
+// The counters of the RecordBufferPool
+struct RecordBufferPoolStats {
+  // The acquired buffers: taken from the pool with the enough capacity and the allocated ones
+  std::uint64_t reusedNumber = 0;
+  std::uint64_t allocatedNumber = 0;
+  // The released buffers: returned to the pool and freed (the pool is full, the buffer is too large or not wanted)
+  std::uint64_t recycledNumber = 0;
+  std::uint64_t discardedNumber = 0;
+  // The idle buffers of the pool and their capacity in bytes
+  std::size_t pooledNumber = 0;
+  std::size_t pooledBytes = 0;
+  // The capacity of the new buffers (the records), it follows the observed batch sizes
+  std::size_t capacity = 0;
+};
+
+// The recycling pool of the record buffers: the vectors of the records of one type that are filled by one thread and
+// read by the other (e.g. the batches of the EventDispatcher). The buffer is acquired before it's filled and released
+// after it's read, so the steady-state processing doesn't allocate. The released buffer is cleared by the releasing
+// thread (the records are destroyed there) and keeps its capacity.
+//
+// The capacity adapts to the observed batch sizes: the new buffers are reserved for the moving average of the sizes
+// rounded up to the power of 2 (or the size, if it's larger), and the released buffers that are larger than
+// MAX_CAPACITY_FACTOR capacities are freed, so the burst doesn't pin its large buffers. At most maxPooledNumber idle
+// buffers are kept.
+//
+// Usage:
+//   RecordBufferPool<TimeAndSale> pool{64};
+//
+//   auto buffer = pool.acquire(count);  // Filled by the producer
+//   ...                                 // Read by the consumer
+//   pool.release(std::move(buffer));
+//
+// Thread-safe: the idle buffers are guarded by the mutex (the critical sections only move the vectors).
+template <typename T>
+class RecordBufferPool final {
+  // The weight of the new size in the moving average is 1/2^AVERAGE_SHIFT
+  static constexpr int AVERAGE_SHIFT = 3;
+  // The released buffers larger than the capacity multiplied by it are freed
+  static constexpr std::size_t MAX_CAPACITY_FACTOR = 4;
+  static constexpr std::size_t MIN_CAPACITY = 4;
+
+  std::size_t maxPooledNumber_;
+  // Guards the buffers and the pooled bytes
+  mutable std::mutex mutex_{};
+  std::vector<std::vector<T>> buffers_{};
+  std::size_t pooledBytes_ = 0;
+  // The moving average of the sizes multiplied by 2^AVERAGE_SHIFT. The concurrent acquires may lose the updates, the
+  // average stays approximate.
+  std::atomic<std::size_t> scaledAverageSize_{MIN_CAPACITY << AVERAGE_SHIFT};
+  std::atomic<std::uint64_t> reusedNumber_{0};
+  std::atomic<std::uint64_t> allocatedNumber_{0};
+  std::atomic<std::uint64_t> recycledNumber_{0};
+  std::atomic<std::uint64_t> discardedNumber_{0};
+
+ public:
+  // maxPooledNumber - the maximum of the idle buffers (the producer that is ahead of the consumer by more buffers
+  // allocates the new ones)
+  explicit RecordBufferPool(std::size_t maxPooledNumber) : maxPooledNumber_{maxPooledNumber} {
+    buffers_.reserve(maxPooledNumber_);
+  }
+
+  RecordBufferPool(const RecordBufferPool&) = delete;
+  RecordBufferPool& operator=(const RecordBufferPool&) = delete;
+
+  // The capacity of the new buffers
+  [[nodiscard]] std::size_t getCapacity() const {
+    return std::bit_ceil((std::max)(scaledAverageSize_.load(std::memory_order_relaxed) >> AVERAGE_SHIFT, MIN_CAPACITY));
+  }
+
+  // Returns the empty buffer with the capacity of at least the size records: the idle one or the new one
+  [[nodiscard]] std::vector<T> acquire(std::size_t size) {
+    bool isReused = false;
+
+    return acquire(size, isReused);
+  }
+
+  // The same as acquire, isReused - the buffer is taken from the pool (e.g. for the counters of the connection, see
+  // ConnectionMemoryAccount::recordBuffer)
+  [[nodiscard]] std::vector<T> acquire(std::size_t size, bool& isReused) {
+    auto scaledAverageSize = scaledAverageSize_.load(std::memory_order_relaxed);
+
+    scaledAverageSize_.store(scaledAverageSize + size - (scaledAverageSize >> AVERAGE_SHIFT),
+                             std::memory_order_relaxed);
+
+    std::vector<T> buffer{};
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+
+      if (!buffers_.empty()) {
+        buffer = std::move(buffers_.back());
+        buffers_.pop_back();
+        pooledBytes_ -= buffer.capacity() * sizeof(T);
+      }
+    }
+
+    isReused = buffer.capacity() >= size;
+
+    if (isReused) {
+      reusedNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      return buffer;
+    }
+
+    allocatedNumber_.fetch_add(1, std::memory_order_relaxed);
+    buffer.reserve((std::max)(size, getCapacity()));
+
+    return buffer;
+  }
+
+  // Clears the buffer and returns it to the pool. isKept - false to free the buffer (e.g. under the memory quota).
+  void release(std::vector<T>&& buffer, bool isKept = true) {
+    std::vector<T> released = std::move(buffer);
+
+    released.clear();
+
+    if (isKept && released.capacity() != 0 && released.capacity() <= getCapacity() * MAX_CAPACITY_FACTOR) {
+      std::lock_guard<std::mutex> lk(mutex_);
+
+      if (buffers_.size() < maxPooledNumber_) {
+        pooledBytes_ += released.capacity() * sizeof(T);
+        buffers_.push_back(std::move(released));
+        recycledNumber_.fetch_add(1, std::memory_order_relaxed);
+
+        return;
+      }
+    }
+
+    // Freed outside the lock
+    discardedNumber_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Frees the idle buffers
+  void clear() {
+    std::vector<std::vector<T>> buffers{};
+
+    buffers.reserve(maxPooledNumber_);
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+
+      std::swap(buffers, buffers_);
+      pooledBytes_ = 0;
+    }
+  }
+
+  // The capacity of the idle buffers in bytes
+  [[nodiscard]] std::size_t getPooledBytes() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return pooledBytes_;
+  }
+
+  [[nodiscard]] RecordBufferPoolStats getStats() const {
+    RecordBufferPoolStats stats{reusedNumber_.load(std::memory_order_relaxed),
+                                allocatedNumber_.load(std::memory_order_relaxed),
+                                recycledNumber_.load(std::memory_order_relaxed),
+                                discardedNumber_.load(std::memory_order_relaxed)};
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+
+      stats.pooledNumber = buffers_.size();
+      stats.pooledBytes = pooledBytes_;
+    }
+
+    stats.capacity = getCapacity();
+
+    return stats;
+  }
+};
+
+}  // namespace dxf
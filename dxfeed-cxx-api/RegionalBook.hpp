@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "CpuFeatures.hpp"
+#include "PriceLevel.hpp"
+
+namespace dxf {
+
+enum class RegionalBookStrategy : int {
+  // The loop over the exchanges
+  SCALAR = 0,
+  // 4 exchanges per the 256-bit min/max (x86-64 with AVX2)
+  AVX2 = 1,
+  // 2 exchanges per the 128-bit min/max (AArch64)
+  NEON = 2
+};
+
+// The composite best bid and offer of one symbol
+struct CompositeQuote {
+  // NaN - no bids
+  double bidPrice = std::numeric_limits<double>::quiet_NaN();
+  // The sum of the sizes of all exchanges at the best price
+  double bidSize = 0.0;
+  // The first exchange at the best price (0 - no bids)
+  char bidExchangeCode = 0;
+  double askPrice = std::numeric_limits<double>::quiet_NaN();
+  double askSize = 0.0;
+  char askExchangeCode = 0;
+
+  friend bool operator==(const CompositeQuote& a, const CompositeQuote& b) {
+    auto equals = [](double x, double y) { return x == y || (std::isnan(x) && std::isnan(y)); };
+
+    return equals(a.bidPrice, b.bidPrice) && a.bidSize == b.bidSize && a.bidExchangeCode == b.bidExchangeCode &&
+           equals(a.askPrice, b.askPrice) && a.askSize == b.askSize && a.askExchangeCode == b.askExchangeCode;
+  }
+};
+
+// The regional quotes of one symbol and their composite best bid and offer. Every exchange has the fixed slot of the
+// arrays of the prices and the sizes of both sides (the exchange codes '@' - '_', i.e. 'A' - 'Z'), the empty slot has
+// the price that is never the best (-inf for the bids, +inf for the asks). So the best prices are the max/min
+// reductions over the whole arrays without the branches, and the composite sizes are the masked sums of the sizes at
+// the best prices. The update reports the change of the composite quote only, so the unchanged composite isn't
+// delivered.
+//
+// The vector strategy is selected at run time by the CPU feature detection, the scalar one is the fallback.
+class RegionalBook final {
+ public:
+  static constexpr std::size_t EXCHANGES_NUMBER = 32;
+  static constexpr char FIRST_EXCHANGE_CODE = '@';
+
+ private:
+  static constexpr std::size_t LANES = 4;
+
+  alignas(32) double bidPrices_[EXCHANGES_NUMBER];
+  alignas(32) double bidSizes_[EXCHANGES_NUMBER];
+  alignas(32) double askPrices_[EXCHANGES_NUMBER];
+  alignas(32) double askSizes_[EXCHANGES_NUMBER];
+  CompositeQuote composite_{};
+
+  static std::atomic<RegionalBookStrategy>& strategy() {
+    static std::atomic<RegionalBookStrategy> strategy{getSupportedStrategy()};
+
+    return strategy;
+  }
+
+  template <typename Side>
+  static constexpr double getEmptyPrice() {
+    return std::is_same_v<Side, AskSide> ? std::numeric_limits<double>::infinity()
+                                         : -std::numeric_limits<double>::infinity();
+  }
+
+  // The best price, the sum of the sizes at it and the mask of the exchanges at it
+  template <typename Side>
+  static void findBestScalar(const double* prices, const double* sizes, double& price, double& size,
+                             std::uint32_t& mask) {
+    price = getEmptyPrice<Side>();
+
+    for (std::size_t i = 0; i < EXCHANGES_NUMBER; i++) {
+      price = std::is_same_v<Side, AskSide> ? (std::min)(price, prices[i]) : (std::max)(price, prices[i]);
+    }
+
+    size = 0.0;
+    mask = 0;
+
+    for (std::size_t i = 0; i < EXCHANGES_NUMBER; i++) {
+      auto isBest = prices[i] == price;
+
+      size += isBest ? sizes[i] : 0.0;
+      mask |= static_cast<std::uint32_t>(isBest) << i;
+    }
+  }
+
+#ifdef DXFCXX_CPU_X86
+  template <typename Side>
+  DXFCXX_TARGET_AVX2 static void findBestAvx2(const double* prices, const double* sizes, double& price, double& size,
+                                              std::uint32_t& mask) {
+    auto best = _mm256_load_pd(prices);
+
+    for (std::size_t i = LANES; i < EXCHANGES_NUMBER; i += LANES) {
+      best = std::is_same_v<Side, AskSide> ? _mm256_min_pd(best, _mm256_load_pd(prices + i))
+                                           : _mm256_max_pd(best, _mm256_load_pd(prices + i));
+    }
+
+    // The reduction of the 4 lanes
+    auto half = std::is_same_v<Side, AskSide>
+                  ? _mm_min_pd(_mm256_castpd256_pd128(best), _mm256_extractf128_pd(best, 1))
+                  : _mm_max_pd(_mm256_castpd256_pd128(best), _mm256_extractf128_pd(best, 1));
+
+    half = std::is_same_v<Side, AskSide> ? _mm_min_sd(half, _mm_unpackhi_pd(half, half))
+                                         : _mm_max_sd(half, _mm_unpackhi_pd(half, half));
+    price = _mm_cvtsd_f64(half);
+
+    auto value = _mm256_set1_pd(price);
+    auto sum = _mm256_setzero_pd();
+
+    mask = 0;
+
+    for (std::size_t i = 0; i < EXCHANGES_NUMBER; i += LANES) {
+      auto isBest = _mm256_cmp_pd(_mm256_load_pd(prices + i), value, _CMP_EQ_OQ);
+
+      sum = _mm256_add_pd(sum, _mm256_and_pd(isBest, _mm256_load_pd(sizes + i)));
+      mask |= static_cast<std::uint32_t>(_mm256_movemask_pd(isBest)) << i;
+    }
+
+    auto sumHalf = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+
+    size = _mm_cvtsd_f64(_mm_add_sd(sumHalf, _mm_unpackhi_pd(sumHalf, sumHalf)));
+  }
+#elif defined(DXFCXX_CPU_NEON)
+  template <typename Side>
+  static void findBestNeon(const double* prices, const double* sizes, double& price, double& size,
+                           std::uint32_t& mask) {
+    auto best = vld1q_f64(prices);
+
+    for (std::size_t i = 2; i < EXCHANGES_NUMBER; i += 2) {
+      best = std::is_same_v<Side, AskSide> ? vminq_f64(best, vld1q_f64(prices + i))
+                                           : vmaxq_f64(best, vld1q_f64(prices + i));
+    }
+
+    price = std::is_same_v<Side, AskSide> ? vminvq_f64(best) : vmaxvq_f64(best);
+
+    auto value = vdupq_n_f64(price);
+    auto sum = vdupq_n_f64(0.0);
+
+    mask = 0;
+
+    for (std::size_t i = 0; i < EXCHANGES_NUMBER; i += 2) {
+      auto isBest = vceqq_f64(vld1q_f64(prices + i), value);
+
+      sum = vaddq_f64(sum, vreinterpretq_f64_u64(vandq_u64(isBest, vreinterpretq_u64_f64(vld1q_f64(sizes + i)))));
+      mask |= detail::movemaskNeon(isBest) << i;
+    }
+
+    size = vaddvq_f64(sum);
+  }
+#endif
+
+  template <typename Side>
+  static void findBest(const double* prices, const double* sizes, double& price, double& size, char& exchangeCode) {
+    std::uint32_t mask = 0;
+
+#if defined(DXFCXX_CPU_X86)
+    if (getStrategy() == RegionalBookStrategy::AVX2) {
+      findBestAvx2<Side>(prices, sizes, price, size, mask);
+    } else {
+      findBestScalar<Side>(prices, sizes, price, size, mask);
+    }
+#elif defined(DXFCXX_CPU_NEON)
+    if (getStrategy() == RegionalBookStrategy::NEON) {
+      findBestNeon<Side>(prices, sizes, price, size, mask);
+    } else {
+      findBestScalar<Side>(prices, sizes, price, size, mask);
+    }
+#else
+    findBestScalar<Side>(prices, sizes, price, size, mask);
+#endif
+
+    if (std::isinf(price)) {
+      price = std::numeric_limits<double>::quiet_NaN();
+      size = 0.0;
+      exchangeCode = 0;
+    } else {
+      exchangeCode = static_cast<char>(FIRST_EXCHANGE_CODE + std::countr_zero(mask));
+    }
+  }
+
+  template <typename Side>
+  static void store(double* prices, double* sizes, std::size_t slot, double price, double size) {
+    auto isEmpty = !std::isfinite(price) || std::isnan(size) || size <= 0.0;
+
+    prices[slot] = isEmpty ? getEmptyPrice<Side>() : price;
+    sizes[slot] = isEmpty ? 0.0 : size;
+  }
+
+ public:
+  RegionalBook() { clear(); }
+
+  // Returns the best strategy that is supported by the CPU
+  static RegionalBookStrategy getSupportedStrategy() {
+#if defined(DXFCXX_CPU_X86)
+    return CpuFeatures::hasAvx2() ? RegionalBookStrategy::AVX2 : RegionalBookStrategy::SCALAR;
+#elif defined(DXFCXX_CPU_NEON)
+    return RegionalBookStrategy::NEON;
+#else
+    return RegionalBookStrategy::SCALAR;
+#endif
+  }
+
+  [[nodiscard]] static RegionalBookStrategy getStrategy() { return strategy().load(std::memory_order_relaxed); }
+
+  // Selects the strategy for all the books (e.g. to compare them). The unsupported strategy is replaced by SCALAR.
+  static void setStrategy(RegionalBookStrategy newStrategy) {
+    if (newStrategy != RegionalBookStrategy::SCALAR && newStrategy != getSupportedStrategy()) {
+      newStrategy = RegionalBookStrategy::SCALAR;
+    }
+
+    strategy().store(newStrategy, std::memory_order_relaxed);
+  }
+
+  // Returns false if the exchange code has no slot
+  static bool isValidExchangeCode(char exchangeCode) {
+    return static_cast<unsigned char>(exchangeCode - FIRST_EXCHANGE_CODE) < EXCHANGES_NUMBER;
+  }
+
+  // Replaces the regional quote of the exchange (the price that is not finite or the size that is not positive - the
+  // side is empty). Returns true if the composite quote is changed, false if it's not or the exchange code has no slot.
+  bool update(char exchangeCode, double bidPrice, double bidSize, double askPrice, double askSize) {
+    if (!isValidExchangeCode(exchangeCode)) {
+      return false;
+    }
+
+    auto slot = static_cast<std::size_t>(exchangeCode - FIRST_EXCHANGE_CODE);
+
+    store<BidSide>(bidPrices_, bidSizes_, slot, bidPrice, bidSize);
+    store<AskSide>(askPrices_, askSizes_, slot, askPrice, askSize);
+
+    CompositeQuote composite{};
+
+    findBest<BidSide>(bidPrices_, bidSizes_, composite.bidPrice, composite.bidSize, composite.bidExchangeCode);
+    findBest<AskSide>(askPrices_, askSizes_, composite.askPrice, composite.askSize, composite.askExchangeCode);
+
+    if (composite == composite_) {
+      return false;
+    }
+
+    composite_ = composite;
+
+    return true;
+  }
+
+  // Removes the regional quote of the exchange. Returns true if the composite quote is changed.
+  bool remove(char exchangeCode) {
+    return update(exchangeCode, std::numeric_limits<double>::quiet_NaN(), 0.0, std::numeric_limits<double>::quiet_NaN(),
+                  0.0);
+  }
+
+  void clear() {
+    for (std::size_t i = 0; i < EXCHANGES_NUMBER; i++) {
+      bidPrices_[i] = getEmptyPrice<BidSide>();
+      bidSizes_[i] = 0.0;
+      askPrices_[i] = getEmptyPrice<AskSide>();
+      askSizes_[i] = 0.0;
+    }
+
+    composite_ = CompositeQuote{};
+  }
+
+  [[nodiscard]] const CompositeQuote& getComposite() const { return composite_; }
+};
+
+}  // namespace dxf
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
+
+namespace dxf {
+
+// The resources used by the process: the CPU time, the resident memory and the context switches. The samples are
+// monotonic (except the resident memory), so the usage of an interval is the difference of two samples.
+struct ResourceUsage {
+  std::uint64_t userCpuNanos = 0;
+  std::uint64_t systemCpuNanos = 0;
+  // The current resident set size (the peak one if the current one is not available)
+  std::uint64_t residentBytes = 0;
+  // Not counted on Windows
+  std::uint64_t voluntaryContextSwitches = 0;
+  std::uint64_t involuntaryContextSwitches = 0;
+
+  [[nodiscard]] std::uint64_t getCpuNanos() const { return userCpuNanos + systemCpuNanos; }
+
+  [[nodiscard]] std::uint64_t getContextSwitches() const {
+    return voluntaryContextSwitches + involuntaryContextSwitches;
+  }
+
+  // The usage of the process: getrusage and /proc/self/statm (Linux) or GetProcessTimes and GetProcessMemoryInfo
+  // (Windows)
+  static ResourceUsage sample() {
+    ResourceUsage result{};
+
+#ifdef _WIN32
+    FILETIME creationTime{};
+    FILETIME exitTime{};
+    FILETIME kernelTime{};
+    FILETIME userTime{};
+    // The FILETIME is in 100 ns units
+    auto toNanos = [](const FILETIME& time) {
+      return ((static_cast<std::uint64_t>(time.dwHighDateTime) << 32U) | time.dwLowDateTime) * 100;
+    };
+
+    if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+      result.userCpuNanos = toNanos(userTime);
+      result.systemCpuNanos = toNanos(kernelTime);
+    }
+
+    PROCESS_MEMORY_COUNTERS counters{};
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+      result.residentBytes = counters.WorkingSetSize;
+    }
+#else
+    rusage usage{};
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+      auto toNanos = [](const timeval& time) {
+        return static_cast<std::uint64_t>(time.tv_sec) * 1000000000 + static_cast<std::uint64_t>(time.tv_usec) * 1000;
+      };
+
+      result.userCpuNanos = toNanos(usage.ru_utime);
+      result.systemCpuNanos = toNanos(usage.ru_stime);
+      result.voluntaryContextSwitches = static_cast<std::uint64_t>(usage.ru_nvcsw);
+      result.involuntaryContextSwitches = static_cast<std::uint64_t>(usage.ru_nivcsw);
+      // The peak: KiB on Linux, bytes on macOS
+#ifdef __APPLE__
+      result.residentBytes = static_cast<std::uint64_t>(usage.ru_maxrss);
+#else
+      result.residentBytes = static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+
+    // The second number of the statm is the resident pages
+    if (auto* f = std::fopen("/proc/self/statm", "r")) {
+      unsigned long long size = 0;
+      unsigned long long resident = 0;
+
+      if (std::fscanf(f, "%llu %llu", &size, &resident) == 2) {
+        result.residentBytes = resident * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+      }
+
+      std::fclose(f);
+    }
+#endif
+
+    return result;
+  }
+};
+
+// The heap of the allocator of the process: the bytes it has taken from the system and the bytes of the live blocks.
+// The rest are the free blocks the allocator keeps, so the growing share of them over the long run (with the same live
+// bytes) is the fragmentation.
+struct AllocatorUsage {
+  // The heap taken from the system (the arenas and the mapped blocks)
+  std::uint64_t heapBytes = 0;
+  // The live blocks
+  std::uint64_t inUseBytes = 0;
+  // false - the allocator isn't queried on the platform (the numbers are 0)
+  bool isSupported = false;
+
+  [[nodiscard]] std::uint64_t getFreeBytes() const { return heapBytes > inUseBytes ? heapBytes - inUseBytes : 0; }
+
+  // The share of the free bytes in the heap (%)
+  [[nodiscard]] double getFragmentation() const {
+    return heapBytes != 0 ? static_cast<double>(getFreeBytes()) * 100.0 / static_cast<double>(heapBytes) : 0.0;
+  }
+
+  // The usage of the allocator: mallinfo2 (glibc 2.33+, it walks the arenas under their locks, so it's sampled once per
+  // interval) or malloc_zone_statistics (macOS)
+  static AllocatorUsage sample() {
+    AllocatorUsage result{};
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    auto info = mallinfo2();
+
+    result.heapBytes = static_cast<std::uint64_t>(info.arena + info.hblkhd);
+    result.inUseBytes = static_cast<std::uint64_t>(info.uordblks + info.hblkhd);
+    result.isSupported = true;
+#elif defined(__APPLE__)
+    malloc_statistics_t statistics{};
+
+    malloc_zone_statistics(nullptr, &statistics);
+    result.heapBytes = static_cast<std::uint64_t>(statistics.size_allocated);
+    result.inUseBytes = static_cast<std::uint64_t>(statistics.size_in_use);
+    result.isSupported = true;
+#endif
+
+    return result;
+  }
+};
+
+}  // namespace dxf
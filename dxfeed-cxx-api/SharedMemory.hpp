@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dxf {
+
+// The named shared memory region of the host mapped to the address space of the process. The creator owns the name:
+// the name is removed when the creator's region is destroyed, the already opened regions stay mapped.
+class SharedMemory final {
+  std::string name_;
+  void* data_;
+  std::size_t size_;
+  bool isOwner_;
+
+#ifdef _WIN32
+  HANDLE mapping_;
+
+  SharedMemory(std::string name, void* data, std::size_t size, bool isOwner, HANDLE mapping)
+      : name_{std::move(name)}, data_{data}, size_{size}, isOwner_{isOwner}, mapping_{mapping} {}
+#else
+  SharedMemory(std::string name, void* data, std::size_t size, bool isOwner)
+      : name_{std::move(name)}, data_{data}, size_{size}, isOwner_{isOwner} {}
+
+  // The portable POSIX name has the only leading slash
+  static std::string toPosixName(const std::string& name) { return "/" + name; }
+#endif
+
+ public:
+  SharedMemory(const SharedMemory&) = delete;
+  SharedMemory& operator=(const SharedMemory&) = delete;
+
+  ~SharedMemory() {
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+#else
+    munmap(data_, size_);
+
+    if (isOwner_) {
+      shm_unlink(toPosixName(name_).c_str());
+    }
+#endif
+  }
+
+  // Creates (or recreates) the read-write region of the size. Returns nullptr if the region can't be created.
+  static std::unique_ptr<SharedMemory> create(const std::string& name, std::size_t size) {
+#ifdef _WIN32
+    auto mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                      static_cast<DWORD>(static_cast<unsigned long long>(size) >> 32),
+                                      static_cast<DWORD>(size & 0xFFFFFFFFULL), name.c_str());
+
+    if (mapping == nullptr) {
+      return nullptr;
+    }
+
+    auto data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+
+    if (data == nullptr) {
+      CloseHandle(mapping);
+
+      return nullptr;
+    }
+
+    return std::unique_ptr<SharedMemory>(new SharedMemory(name, data, size, true, mapping));
+#else
+    auto fd = shm_open(toPosixName(name).c_str(), O_CREAT | O_RDWR, 0644);
+
+    if (fd < 0) {
+      return nullptr;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      close(fd);
+
+      return nullptr;
+    }
+
+    auto data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (data == MAP_FAILED) {
+      return nullptr;
+    }
+
+    return std::unique_ptr<SharedMemory>(new SharedMemory(name, data, size, true));
+#endif
+  }
+
+  // Opens the existing region read-only. Returns nullptr if there is no such region.
+  static std::unique_ptr<SharedMemory> open(const std::string& name) {
+#ifdef _WIN32
+    auto mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+
+    if (mapping == nullptr) {
+      return nullptr;
+    }
+
+    auto data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info{};
+
+    if (data == nullptr || VirtualQuery(data, &info, sizeof(info)) == 0) {
+      if (data != nullptr) {
+        UnmapViewOfFile(data);
+      }
+
+      CloseHandle(mapping);
+
+      return nullptr;
+    }
+
+    return std::unique_ptr<SharedMemory>(new SharedMemory(name, data, info.RegionSize, false, mapping));
+#else
+    auto fd = shm_open(toPosixName(name).c_str(), O_RDONLY, 0);
+
+    if (fd < 0) {
+      return nullptr;
+    }
+
+    struct stat info {};
+
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+      close(fd);
+
+      return nullptr;
+    }
+
+    auto size = static_cast<std::size_t>(info.st_size);
+    auto data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (data == MAP_FAILED) {
+      return nullptr;
+    }
+
+    return std::unique_ptr<SharedMemory>(new SharedMemory(name, data, size, false));
+#endif
+  }
+
+  [[nodiscard]] const std::string& getName() const { return name_; }
+
+  [[nodiscard]] void* getData() const { return data_; }
+
+  [[nodiscard]] std::size_t getSize() const { return size_; }
+};
+
+}  // namespace dxf
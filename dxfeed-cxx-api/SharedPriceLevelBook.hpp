@@ -0,0 +1,402 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "NativePriceLevelBook.hpp"
+#include "PriceLevel.hpp"
+#include "PriceLevelBook.hpp"
+#include "PriceLevelBookView.hpp"
+
+namespace dxf {
+
+class PriceLevelBookDepthView;
+
+// The full-depth PriceLevelBook of one symbol and source that is shared by the depth views of the different numbers of
+// levels (see SharedPriceLevelBooks): one order snapshot, one order index and one ladder per side are maintained for
+// all consumers. The book is closed when its last view is destroyed.
+class SharedPriceLevelBook final {
+  friend class PriceLevelBookDepthView;
+  friend class SharedPriceLevelBooks;
+
+  std::unique_ptr<PriceLevelBook> book_;
+  // Guards the views and their handlers. Is locked by the handlers of the book (under the lock of the book).
+  std::mutex viewsMutex_;
+  std::vector<PriceLevelBookDepthView*> views_;
+
+  SharedPriceLevelBook() : book_{}, viewsMutex_{}, views_{} {}
+
+  void attach(PriceLevelBookDepthView* view);
+
+  void detach(PriceLevelBookDepthView* view) {
+    std::lock_guard<std::mutex> lk(viewsMutex_);
+
+    views_.erase(std::remove(views_.begin(), views_.end(), view), views_.end());
+  }
+
+ public:
+  SharedPriceLevelBook(const SharedPriceLevelBook&) = delete;
+  SharedPriceLevelBook& operator=(const SharedPriceLevelBook&) = delete;
+
+  // The handlers of the full-depth book (see PriceLevelBookListenerRef)
+  void onNewBook(const PriceLevelChanges& book);
+
+  void onIncrementalChange(const PriceLevelChangesSet& changesSet);
+
+  void onBookUpdateView(const PriceLevelBookView& view);
+
+  [[nodiscard]] PriceLevelBook& getBook() { return *book_; }
+
+  [[nodiscard]] std::size_t getViewsNumber() {
+    std::lock_guard<std::mutex> lk(viewsMutex_);
+
+    return views_.size();
+  }
+};
+
+// The best levelsNumber levels of the shared full-depth book (see SharedPriceLevelBooks). The view keeps only its
+// visible levels and computes its own deltas from them: the changes of the full book that are all beyond its depth are
+// skipped by one compare per change, otherwise its visible levels are taken from the full ladder and diffed with the
+// previous ones by one merge pass (O(levelsNumber)). So the handlers are called only when the visible levels change,
+// with the same PriceLevelChangesSet deltas as the book of the same depth. The view of 0 levels passes all changes of
+// the full book through.
+//
+// The handlers are called on the thread of the shared book (see PriceLevelBookConfig::async) under its lock. The view
+// that is created for the book that already has its levels gets them at once (see copyBook), the handlers get the
+// changes from them.
+class PriceLevelBookDepthView final {
+  friend class SharedPriceLevelBook;
+  friend class SharedPriceLevelBooks;
+
+  std::shared_ptr<SharedPriceLevelBook> shared_;
+  std::size_t levelsNumber_;
+  // The visible levels (best-first), the buffer of the next ones and the changes between them (under the views mutex)
+  PriceLevelChanges levels_;
+  PriceLevelChanges nextLevels_;
+  PriceLevelChangesSet changes_;
+  // The sides that have the changes within the depth in the current transaction
+  bool isAskTouched_;
+  bool isBidTouched_;
+
+  std::function<void(const PriceLevelChanges&)> onNewBook_;
+  std::function<void(const PriceLevelChanges&)> onBookUpdate_;
+  std::function<void(const PriceLevelBookView&)> onBookUpdateView_;
+  std::function<void(const PriceLevelChangesSet&)> onIncrementalChange_;
+
+  PriceLevelBookDepthView(std::shared_ptr<SharedPriceLevelBook> shared, std::size_t levelsNumber)
+      : shared_{std::move(shared)},
+        levelsNumber_{levelsNumber},
+        levels_{},
+        nextLevels_{},
+        changes_{},
+        isAskTouched_{false},
+        isBidTouched_{false},
+        onNewBook_{},
+        onBookUpdate_{},
+        onBookUpdateView_{},
+        onIncrementalChange_{} {}
+
+  static PriceLevelSideView toSideView(const std::vector<PriceLevel>& levels) {
+    return {&levels, levels.size(), [](const void* source, std::size_t position) {
+              return (*static_cast<const std::vector<PriceLevel>*>(source))[position];
+            }};
+  }
+
+  template <typename Levels>
+  void copyVisible(const Levels& levels, std::vector<PriceLevel>& result) const {
+    auto size = levelsNumber_ == 0 ? levels.size() : (std::min)(levels.size(), levelsNumber_);
+
+    result.clear();
+
+    for (std::size_t i = 0; i < size; i++) {
+      result.push_back(levels[i]);
+    }
+  }
+
+  // The side has the change within the depth: the change of the level that is not worse than the worst visible one,
+  // or any change if the side has less than levelsNumber levels
+  template <typename Side>
+  [[nodiscard]] bool isTouched(const std::vector<PriceLevel>& levels, const std::vector<PriceLevel>& additions,
+                               const std::vector<PriceLevel>& updates,
+                               const std::vector<PriceLevel>& removals) const {
+    if (levels.size() < levelsNumber_) {
+      return !additions.empty() || !updates.empty() || !removals.empty();
+    }
+
+    auto worstPrice = levels.back().price;
+    auto isWithin = [worstPrice](const PriceLevel& pl) { return !Side::isBetter(worstPrice, pl.price); };
+
+    return std::any_of(additions.begin(), additions.end(), isWithin) ||
+           std::any_of(updates.begin(), updates.end(), isWithin) ||
+           std::any_of(removals.begin(), removals.end(), isWithin);
+  }
+
+  // Called under the views mutex
+  void processNewBook(const PriceLevelChanges& book) {
+    isAskTouched_ = false;
+    isBidTouched_ = false;
+
+    if (levelsNumber_ == 0) {
+      if (onNewBook_) {
+        onNewBook_(book);
+      }
+
+      return;
+    }
+
+    copyVisible(book.asks, levels_.asks);
+    copyVisible(book.bids, levels_.bids);
+
+    if (onNewBook_) {
+      onNewBook_(levels_);
+    }
+  }
+
+  // Called under the views mutex, before the processBookView of the same transaction
+  void processIncrementalChange(const PriceLevelChangesSet& changesSet) {
+    // All changes of the full book are passed through
+    if (levelsNumber_ == 0) {
+      if (onIncrementalChange_) {
+        onIncrementalChange_(changesSet);
+      }
+
+      isAskTouched_ = true;
+
+      return;
+    }
+
+    isAskTouched_ = isAskTouched_ || isTouched<AskSide>(levels_.asks, changesSet.additions.asks,
+                                                        changesSet.updates.asks, changesSet.removals.asks);
+    isBidTouched_ = isBidTouched_ || isTouched<BidSide>(levels_.bids, changesSet.additions.bids,
+                                                        changesSet.updates.bids, changesSet.removals.bids);
+  }
+
+  // Called under the views mutex with the full levels after the transaction
+  void processBookView(const PriceLevelBookView& view) {
+    auto isAskTouched = std::exchange(isAskTouched_, false);
+    auto isBidTouched = std::exchange(isBidTouched_, false);
+
+    if (!isAskTouched && !isBidTouched) {
+      return;
+    }
+
+    // The full levels are copied only for the onBookUpdate
+    if (levelsNumber_ == 0) {
+      if (onBookUpdate_) {
+        copyVisible(view.asks, levels_.asks);
+        copyVisible(view.bids, levels_.bids);
+        onBookUpdate_(levels_);
+      }
+
+      if (onBookUpdateView_) {
+        onBookUpdateView_(view);
+      }
+
+      return;
+    }
+
+    changes_.additions.asks.clear();
+    changes_.additions.bids.clear();
+    changes_.updates.asks.clear();
+    changes_.updates.bids.clear();
+    changes_.removals.asks.clear();
+    changes_.removals.bids.clear();
+
+    if (isAskTouched) {
+      copyVisible(view.asks, nextLevels_.asks);
+      NativePriceLevelBook::diffSide<AskSide>(levels_.asks, nextLevels_.asks, changes_.additions.asks,
+                                              changes_.updates.asks, changes_.removals.asks);
+      std::swap(levels_.asks, nextLevels_.asks);
+    }
+
+    if (isBidTouched) {
+      copyVisible(view.bids, nextLevels_.bids);
+      NativePriceLevelBook::diffSide<BidSide>(levels_.bids, nextLevels_.bids, changes_.additions.bids,
+                                              changes_.updates.bids, changes_.removals.bids);
+      std::swap(levels_.bids, nextLevels_.bids);
+    }
+
+    if (changes_.additions.asks.empty() && changes_.additions.bids.empty() && changes_.updates.asks.empty() &&
+        changes_.updates.bids.empty() && changes_.removals.asks.empty() && changes_.removals.bids.empty()) {
+      return;
+    }
+
+    if (onIncrementalChange_) {
+      onIncrementalChange_(changes_);
+    }
+
+    if (onBookUpdate_) {
+      onBookUpdate_(levels_);
+    }
+
+    if (onBookUpdateView_) {
+      onBookUpdateView_(PriceLevelBookView{toSideView(levels_.asks), toSideView(levels_.bids)});
+    }
+  }
+
+ public:
+  PriceLevelBookDepthView(const PriceLevelBookDepthView&) = delete;
+  PriceLevelBookDepthView& operator=(const PriceLevelBookDepthView&) = delete;
+
+  // No handler of the view is called after the destructor returns
+  ~PriceLevelBookDepthView() { shared_->detach(this); }
+
+  [[nodiscard]] std::size_t getLevelsNumber() const { return levelsNumber_; }
+
+  // The shared full-depth book (e.g. for its metrics, isReady or isValid)
+  [[nodiscard]] PriceLevelBook& getBook() const { return shared_->getBook(); }
+
+  [[nodiscard]] bool isValid() const { return shared_->getBook().isValid(); }
+
+  [[nodiscard]] bool isReady() const { return shared_->getBook().isReady(); }
+
+  // Copies the visible levels of the view
+  void copyBook(PriceLevelChanges& result) {
+    if (levelsNumber_ == 0) {
+      shared_->getBook().copyBook(result);
+
+      return;
+    }
+
+    std::lock_guard<std::mutex> lk(shared_->viewsMutex_);
+
+    result.asks.assign(levels_.asks.begin(), levels_.asks.end());
+    result.bids.assign(levels_.bids.begin(), levels_.bids.end());
+  }
+
+  void setOnNewBook(std::function<void(const PriceLevelChanges&)> onNewBookHandler) {
+    std::lock_guard<std::mutex> lk(shared_->viewsMutex_);
+
+    onNewBook_ = std::move(onNewBookHandler);
+  }
+
+  void setOnBookUpdate(std::function<void(const PriceLevelChanges&)> onBookUpdateHandler) {
+    std::lock_guard<std::mutex> lk(shared_->viewsMutex_);
+
+    onBookUpdate_ = std::move(onBookUpdateHandler);
+  }
+
+  // The view is valid only during the handler call
+  void setOnBookUpdateView(std::function<void(const PriceLevelBookView&)> onBookUpdateViewHandler) {
+    std::lock_guard<std::mutex> lk(shared_->viewsMutex_);
+
+    onBookUpdateView_ = std::move(onBookUpdateViewHandler);
+  }
+
+  void setOnIncrementalChange(std::function<void(const PriceLevelChangesSet&)> onIncrementalChangeHandler) {
+    std::lock_guard<std::mutex> lk(shared_->viewsMutex_);
+
+    onIncrementalChange_ = std::move(onIncrementalChangeHandler);
+  }
+};
+
+inline void SharedPriceLevelBook::attach(PriceLevelBookDepthView* view) {
+  // The levels are taken at the transaction boundary, so the view misses no change after them
+  book_->visitBook([this, view](const PriceLevelBookView& bookView) {
+    std::lock_guard<std::mutex> lk(viewsMutex_);
+
+    if (view->levelsNumber_ != 0) {
+      view->copyVisible(bookView.asks, view->levels_.asks);
+      view->copyVisible(bookView.bids, view->levels_.bids);
+    }
+
+    views_.push_back(view);
+  });
+}
+
+inline void SharedPriceLevelBook::onNewBook(const PriceLevelChanges& book) {
+  std::lock_guard<std::mutex> lk(viewsMutex_);
+
+  for (auto view : views_) {
+    view->processNewBook(book);
+  }
+}
+
+inline void SharedPriceLevelBook::onIncrementalChange(const PriceLevelChangesSet& changesSet) {
+  std::lock_guard<std::mutex> lk(viewsMutex_);
+
+  for (auto view : views_) {
+    view->processIncrementalChange(changesSet);
+  }
+}
+
+inline void SharedPriceLevelBook::onBookUpdateView(const PriceLevelBookView& view) {
+  std::lock_guard<std::mutex> lk(viewsMutex_);
+
+  for (auto depthView : views_) {
+    depthView->processBookView(view);
+  }
+}
+
+// The registry of the shared full-depth books of one connection. The books of the same symbol and source that are
+// acquired with the different numbers of levels share one order snapshot and one ladder per side (see
+// SharedPriceLevelBook), so the memory and the processing grow with the symbols and not with the consumers.
+//
+// Usage:
+//   SharedPriceLevelBooks books{connection};
+//   auto top5 = books.acquire("AAPL", "NTV", 5);
+//   auto top20 = books.acquire("AAPL", "NTV", 20);  // the same snapshot
+//
+//   top5->setOnIncrementalChange([](const dxf::PriceLevelChangesSet& changes) { ... });
+//
+// The registry is not needed by the acquired views, they keep their shared book.
+class SharedPriceLevelBooks final {
+  dxf_connection_t connection_;
+  // The config of all shared books (the full depth, the storage of the depth is not used)
+  PriceLevelBookConfig config_;
+  std::mutex mutex_;
+  std::map<std::pair<std::string, std::string>, std::weak_ptr<SharedPriceLevelBook>> books_;
+
+ public:
+  explicit SharedPriceLevelBooks(dxf_connection_t connection, PriceLevelBookConfig config = {})
+      : connection_{connection}, config_{std::move(config)}, mutex_{}, books_{} {}
+
+  SharedPriceLevelBooks(const SharedPriceLevelBooks&) = delete;
+  SharedPriceLevelBooks& operator=(const SharedPriceLevelBooks&) = delete;
+
+  // Returns the view of the best levelsNumber levels (0 - all levels) of the shared book of the symbol and the source.
+  // The book is created (and subscribed) by the first view. The view is invalid if the snapshot can't be created.
+  std::shared_ptr<PriceLevelBookDepthView> acquire(const std::string& symbol, const std::string& source,
+                                                   std::size_t levelsNumber) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    for (auto it = books_.begin(); it != books_.end();) {
+      it = it->second.expired() ? books_.erase(it) : std::next(it);
+    }
+
+    auto& weakShared = books_[{symbol, source}];
+    auto shared = weakShared.lock();
+
+    if (!shared) {
+      shared = std::shared_ptr<SharedPriceLevelBook>(new SharedPriceLevelBook());
+      shared->book_ = PriceLevelBook::create(connection_, symbol, source, 0, config_);
+      shared->book_->setListener(*shared);
+      weakShared = shared;
+    }
+
+    auto view = std::shared_ptr<PriceLevelBookDepthView>(new PriceLevelBookDepthView(shared, levelsNumber));
+
+    shared->attach(view.get());
+
+    return view;
+  }
+
+  // The number of the shared books that have the views
+  [[nodiscard]] std::size_t getBooksNumber() {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return static_cast<std::size_t>(
+      std::count_if(books_.begin(), books_.end(), [](const auto& entry) { return !entry.second.expired(); }));
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,417 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "PriceLevel.hpp"
+#include "PriceLevelBookView.hpp"
+#include "SharedMemory.hpp"
+
+namespace dxf {
+
+// The broadcast ring of the price level records in the shared memory of the host. One publisher process writes the
+// records of any number of books, any number of subscriber processes read them without writing to the ring, so the
+// subscribers never slow down the publisher. A subscriber that falls behind by more than the ring capacity is
+// overrun: it skips to the newest records and rebuilds its books from the next full book records.
+//
+// Layout (native byte order):
+//   ring header: magic "PLBR" (uint32), version (uint32), capacity (uint64, a power of 2), the reserve position and
+//                the commit position (uint64, on their own cache lines)
+//   data:        the records, a record never wraps (the padding record fills the end of the ring)
+//   record:      length (uint32, a multiple of 8), type (uint32), sequence (uint64), symbol (48 bytes) and source
+//                (16 bytes) with the terminating zeros, the levels numbers (6 x uint32), the levels
+//   level:       price (double), size (double), time (int64), i.e. PriceLevel
+//
+// The levels numbers are the asks and the bids of the additions, the updates and the removals (the changes records)
+// or the asks and the bids of the book (the book records).
+struct SharedPriceLevelRing {
+  static constexpr std::uint32_t MAGIC = 0x52424C50U;  // "PLBR"
+  static constexpr std::uint32_t VERSION = 1;
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+  static constexpr std::size_t SYMBOL_SIZE = 48;
+  static constexpr std::size_t SOURCE_SIZE = 16;
+  static constexpr std::size_t LEVELS_NUMBERS = 6;
+  static constexpr std::size_t MIN_CAPACITY = 64 * 1024;
+
+  enum class RecordType : std::uint32_t { PADDING = 0, CHANGES = 1, BOOK = 2 };
+
+  struct Header {
+    std::atomic<std::uint32_t> magic{0};
+    std::uint32_t version = VERSION;
+    std::uint64_t capacity = 0;
+    // The writer is overwriting the data up to this position
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> reservePosition{0};
+    // The records up to this position are complete
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> commitPosition{0};
+  };
+
+  struct RecordHeader {
+    std::uint32_t length = 0;
+    RecordType type = RecordType::PADDING;
+    std::uint64_t sequence = 0;
+    char symbol[SYMBOL_SIZE]{};
+    char source[SOURCE_SIZE]{};
+    std::uint32_t levelsNumbers[LEVELS_NUMBERS]{};
+  };
+
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+                "The ring positions are shared between the processes");
+  static_assert(std::is_trivially_copyable_v<PriceLevel> && sizeof(PriceLevel) == 24 && sizeof(RecordHeader) % 8 == 0,
+                "The record layout is fixed");
+
+  static constexpr std::size_t DATA_OFFSET = (sizeof(Header) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+  // The padding record has only the length and the type
+  static constexpr std::size_t MIN_RECORD_LENGTH = 8;
+};
+
+using SharedPriceLevelRecordType = SharedPriceLevelRing::RecordType;
+
+// The levels of both sides of the record. The levels point into the ring.
+struct SharedPriceLevelSides {
+  std::span<const PriceLevel> asks{};
+  std::span<const PriceLevel> bids{};
+};
+
+// The record of the ring read by the subscriber. It points into the shared memory, so it is valid only during the
+// handler call.
+struct SharedPriceLevelRecord {
+  SharedPriceLevelRecordType type = SharedPriceLevelRecordType::CHANGES;
+  // The number of the record in the ring (the books of all symbols)
+  std::uint64_t sequence = 0;
+  std::string_view symbol{};
+  std::string_view source{};
+  // The visible levels of the book (the book records)
+  SharedPriceLevelSides book{};
+  // The changes set of the transaction (the changes records)
+  SharedPriceLevelSides additions{};
+  SharedPriceLevelSides updates{};
+  SharedPriceLevelSides removals{};
+};
+
+// The writer of the ring. Can be called from several threads (the writes are serialized).
+class SharedPriceLevelPublisher final {
+  std::unique_ptr<SharedMemory> memory_;
+  SharedPriceLevelRing::Header* header_;
+  unsigned char* data_;
+  std::uint64_t capacity_;
+  std::uint64_t position_;
+  std::uint64_t sequence_;
+  std::mutex mutex_;
+
+  SharedPriceLevelPublisher(std::unique_ptr<SharedMemory> memory, std::uint64_t capacity)
+      : memory_{std::move(memory)},
+        header_{nullptr},
+        data_{static_cast<unsigned char*>(memory_->getData()) + SharedPriceLevelRing::DATA_OFFSET},
+        capacity_{capacity},
+        position_{0},
+        sequence_{0},
+        mutex_{} {
+    header_ = new (memory_->getData()) SharedPriceLevelRing::Header{};
+    header_->capacity = capacity_;
+    header_->magic.store(SharedPriceLevelRing::MAGIC, std::memory_order_release);
+  }
+
+  // The subscribers check the reserve position after reading a record, so it is stored before the data
+  void reserve(std::uint64_t position) {
+    header_->reservePosition.store(position, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  void commit() { header_->commitPosition.store(position_, std::memory_order_release); }
+
+  template <typename Side>
+  std::size_t copyLevels(std::size_t offset, const Side& side) {
+    for (std::size_t i = 0; i < side.size(); i++) {
+      PriceLevel level = side[i];
+
+      std::memcpy(data_ + offset, &level, sizeof(PriceLevel));
+      offset += sizeof(PriceLevel);
+    }
+
+    return offset;
+  }
+
+  // sides - the levels of the record in the order of the levels numbers (std::vector<PriceLevel> or PriceLevelSideView)
+  template <typename... Sides>
+  bool write(SharedPriceLevelRecordType type, std::string_view symbol, std::string_view source, const Sides&... sides) {
+    static_assert(sizeof...(Sides) <= SharedPriceLevelRing::LEVELS_NUMBERS);
+
+    auto length = sizeof(SharedPriceLevelRing::RecordHeader) + (sides.size() + ... + 0) * sizeof(PriceLevel);
+
+    if (symbol.size() >= SharedPriceLevelRing::SYMBOL_SIZE || source.size() >= SharedPriceLevelRing::SOURCE_SIZE ||
+        length > capacity_ / 2) {
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto offset = static_cast<std::size_t>(position_ & (capacity_ - 1));
+
+    if (offset + length > capacity_) {
+      auto padding = static_cast<std::uint32_t>(capacity_ - offset);
+      auto paddingType = SharedPriceLevelRecordType::PADDING;
+
+      reserve(position_ + padding);
+      std::memcpy(data_ + offset, &padding, sizeof(padding));
+      std::memcpy(data_ + offset + sizeof(padding), &paddingType, sizeof(paddingType));
+      position_ += padding;
+      commit();
+      offset = 0;
+    }
+
+    SharedPriceLevelRing::RecordHeader header{};
+    std::size_t levelsNumbersIndex = 0;
+
+    header.length = static_cast<std::uint32_t>(length);
+    header.type = type;
+    header.sequence = sequence_;
+    symbol.copy(header.symbol, symbol.size());
+    source.copy(header.source, source.size());
+    ((header.levelsNumbers[levelsNumbersIndex++] = static_cast<std::uint32_t>(sides.size())), ...);
+
+    reserve(position_ + length);
+    std::memcpy(data_ + offset, &header, sizeof(header));
+
+    auto levelsOffset = offset + sizeof(header);
+
+    ((levelsOffset = copyLevels(levelsOffset, sides)), ...);
+
+    position_ += length;
+    sequence_++;
+    commit();
+
+    return true;
+  }
+
+ public:
+  // Creates (or recreates) the ring. capacity - the size of the data in bytes (rounded up to a power of 2). Returns
+  // nullptr if the shared memory can't be created.
+  static std::unique_ptr<SharedPriceLevelPublisher> create(const std::string& name, std::size_t capacity) {
+    auto ringCapacity = std::bit_ceil((std::max)(capacity, SharedPriceLevelRing::MIN_CAPACITY));
+    auto memory = SharedMemory::create(name, SharedPriceLevelRing::DATA_OFFSET + ringCapacity);
+
+    if (!memory) {
+      return nullptr;
+    }
+
+    return std::unique_ptr<SharedPriceLevelPublisher>(new SharedPriceLevelPublisher(std::move(memory), ringCapacity));
+  }
+
+  [[nodiscard]] std::uint64_t getCapacity() const { return capacity_; }
+
+  // Returns false if the symbol or the source is too long or the record doesn't fit the half of the ring
+  bool publishChanges(std::string_view symbol, std::string_view source, const PriceLevelChangesSet& changesSet) {
+    return write(SharedPriceLevelRecordType::CHANGES, symbol, source, changesSet.additions.asks,
+                 changesSet.additions.bids, changesSet.updates.asks, changesSet.updates.bids, changesSet.removals.asks,
+                 changesSet.removals.bids);
+  }
+
+  bool publishBook(std::string_view symbol, std::string_view source, const PriceLevelChanges& book) {
+    return write(SharedPriceLevelRecordType::BOOK, symbol, source, book.asks, book.bids);
+  }
+
+  bool publishBook(std::string_view symbol, std::string_view source, const PriceLevelBookView& view) {
+    return write(SharedPriceLevelRecordType::BOOK, symbol, source, view.asks, view.bids);
+  }
+};
+
+// The PriceLevelBook listener (see PriceLevelBook::setListener) that publishes the changes of the book and the full
+// book: the new books and every fullBookInterval-th update, so the new and the overrun subscribers can resync.
+class SharedPriceLevelBookListener final {
+  SharedPriceLevelPublisher* publisher_;
+  std::string symbol_;
+  std::string source_;
+  std::size_t fullBookInterval_;
+  std::size_t updatesNumber_;
+
+ public:
+  // fullBookInterval - the number of the updates between the full books (0 - the new books only)
+  SharedPriceLevelBookListener(SharedPriceLevelPublisher& publisher, std::string symbol, std::string source,
+                               std::size_t fullBookInterval)
+      : publisher_{&publisher},
+        symbol_{std::move(symbol)},
+        source_{std::move(source)},
+        fullBookInterval_{fullBookInterval},
+        updatesNumber_{0} {}
+
+  void onNewBook(const PriceLevelChanges& book) {
+    publisher_->publishBook(symbol_, source_, book);
+    updatesNumber_ = 0;
+  }
+
+  void onIncrementalChange(const PriceLevelChangesSet& changesSet) {
+    publisher_->publishChanges(symbol_, source_, changesSet);
+  }
+
+  // Is called after the incremental change, so the full book includes it
+  void onBookUpdateView(const PriceLevelBookView& view) {
+    if (fullBookInterval_ == 0 || ++updatesNumber_ < fullBookInterval_) {
+      return;
+    }
+
+    publisher_->publishBook(symbol_, source_, view);
+    updatesNumber_ = 0;
+  }
+};
+
+struct SharedPriceLevelPollResult {
+  std::size_t recordsNumber = 0;
+  // The subscriber has been overrun (or the publisher has been restarted) and has skipped the records. The last record
+  // passed to the handler may have been overwritten during the call, so the books must be rebuilt from the next full
+  // book records.
+  bool isOverrun = false;
+};
+
+// The reader of the ring. Reads the records in place (zero-copy). One subscriber is used by one thread.
+class SharedPriceLevelSubscriber final {
+  std::unique_ptr<SharedMemory> memory_;
+  const SharedPriceLevelRing::Header* header_;
+  const unsigned char* data_;
+  std::uint64_t capacity_;
+  std::uint64_t position_;
+  std::uint64_t overrunsNumber_;
+
+  SharedPriceLevelSubscriber(std::unique_ptr<SharedMemory> memory, std::uint64_t capacity)
+      : memory_{std::move(memory)},
+        header_{static_cast<const SharedPriceLevelRing::Header*>(memory_->getData())},
+        data_{static_cast<const unsigned char*>(memory_->getData()) + SharedPriceLevelRing::DATA_OFFSET},
+        capacity_{capacity},
+        position_{header_->commitPosition.load(std::memory_order_acquire)},
+        overrunsNumber_{0} {}
+
+  // Returns true if the writer hasn't started to overwrite the record at the position
+  [[nodiscard]] bool isIntact() const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    return header_->reservePosition.load(std::memory_order_relaxed) - position_ <= capacity_;
+  }
+
+  static std::string_view toStringView(const char* chars, std::size_t size) {
+    return {chars, static_cast<std::size_t>(std::find(chars, chars + size, '\0') - chars)};
+  }
+
+ public:
+  // Opens the ring. The subscriber reads the records that are published after the opening. Returns nullptr if there
+  // is no ring with this name.
+  static std::unique_ptr<SharedPriceLevelSubscriber> open(const std::string& name) {
+    auto memory = SharedMemory::open(name);
+
+    if (!memory || memory->getSize() < SharedPriceLevelRing::DATA_OFFSET) {
+      return nullptr;
+    }
+
+    auto header = static_cast<const SharedPriceLevelRing::Header*>(memory->getData());
+
+    if (header->magic.load(std::memory_order_acquire) != SharedPriceLevelRing::MAGIC ||
+        header->version != SharedPriceLevelRing::VERSION || !std::has_single_bit(header->capacity) ||
+        header->capacity > memory->getSize() - SharedPriceLevelRing::DATA_OFFSET) {
+      return nullptr;
+    }
+
+    auto capacity = header->capacity;
+
+    return std::unique_ptr<SharedPriceLevelSubscriber>(new SharedPriceLevelSubscriber(std::move(memory), capacity));
+  }
+
+  [[nodiscard]] std::uint64_t getOverrunsNumber() const { return overrunsNumber_; }
+
+  // Passes the new records to the handler (void(const SharedPriceLevelRecord&)) and returns without waiting when there
+  // are no more records.
+  template <typename Handler>
+  SharedPriceLevelPollResult poll(Handler&& handler,
+                                  std::size_t maxRecordsNumber = (std::numeric_limits<std::size_t>::max)()) {
+    SharedPriceLevelPollResult result{};
+
+    while (result.recordsNumber < maxRecordsNumber) {
+      auto commitPosition = header_->commitPosition.load(std::memory_order_acquire);
+
+      if (commitPosition == position_) {
+        break;
+      }
+
+      auto offset = static_cast<std::size_t>(position_ & (capacity_ - 1));
+      SharedPriceLevelRing::RecordHeader header{};
+
+      std::memcpy(&header.length, data_ + offset, sizeof(header.length));
+      std::memcpy(&header.type, data_ + offset + sizeof(header.length), sizeof(header.type));
+
+      auto isValid = commitPosition - position_ <= capacity_ &&
+                     header.length >= SharedPriceLevelRing::MIN_RECORD_LENGTH && header.length % 8 == 0 &&
+                     offset + header.length <= capacity_;
+
+      if (isValid && header.type != SharedPriceLevelRecordType::PADDING) {
+        std::memcpy(&header, data_ + offset, (std::min)(sizeof(header), capacity_ - offset));
+
+        std::size_t levelsNumber = 0;
+
+        for (auto number : header.levelsNumbers) {
+          levelsNumber += number;
+        }
+
+        isValid = header.length == sizeof(header) + levelsNumber * sizeof(PriceLevel);
+      }
+
+      if (!isValid || !isIntact()) {
+        overrunsNumber_++;
+        result.isOverrun = true;
+        position_ = commitPosition;
+
+        continue;
+      }
+
+      if (header.type != SharedPriceLevelRecordType::PADDING) {
+        auto levels = reinterpret_cast<const PriceLevel*>(data_ + offset + sizeof(header));
+        std::span<const PriceLevel> sides[SharedPriceLevelRing::LEVELS_NUMBERS]{};
+
+        for (std::size_t i = 0; i < SharedPriceLevelRing::LEVELS_NUMBERS; i++) {
+          sides[i] = {levels, header.levelsNumbers[i]};
+          levels += header.levelsNumbers[i];
+        }
+
+        SharedPriceLevelRecord record{};
+
+        record.type = header.type;
+        record.sequence = header.sequence;
+        record.symbol = toStringView(header.symbol, SharedPriceLevelRing::SYMBOL_SIZE);
+        record.source = toStringView(header.source, SharedPriceLevelRing::SOURCE_SIZE);
+
+        if (header.type == SharedPriceLevelRecordType::BOOK) {
+          record.book = {sides[0], sides[1]};
+        } else {
+          record.additions = {sides[0], sides[1]};
+          record.updates = {sides[2], sides[3]};
+          record.removals = {sides[4], sides[5]};
+        }
+
+        handler(record);
+
+        if (!isIntact()) {
+          overrunsNumber_++;
+          result.isOverrun = true;
+          position_ = header_->commitPosition.load(std::memory_order_acquire);
+
+          continue;
+        }
+
+        result.recordsNumber++;
+      }
+
+      position_ += header.length;
+    }
+
+    return result;
+  }
+};
+
+}  // namespace dxf
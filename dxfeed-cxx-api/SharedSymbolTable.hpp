@@ -0,0 +1,269 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+#include "SharedMemory.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The read-only table of the symbol universe in the shared memory of the host: the first process builds it once (the
+// names, their hashes and the hash index), the other processes attach it and look the symbols up in place, without the
+// conversions, the hashing of the universe and the copies. The ids are the positions of the symbols in the table, so
+// they are the same in all processes of the host (e.g. to index the per-symbol arrays of the subscribers of the
+// SharedPriceLevelRing by the record symbol). The hashes are the ones of the SymbolTable (see Symbol::hashOf).
+//
+// Layout (native byte order):
+//   header:  magic "SYMT" (uint32, stored when the table is complete), version (uint32), the entries number, the
+//            symbols number (the distinct ones, the rest entries are unused), the slots number (a power of 2) and the
+//            size of the names (uint64)
+//   symbols: the entries: the hash (uint64), the offset of the name in the names (uint32) and the length of the name
+//            (uint32)
+//   slots:   the open-addressing index with the linear probing: the id + 1 of the symbol (uint32, 0 - the free slot)
+//   names:   the UTF-8 names
+struct SharedSymbolTableLayout {
+  static constexpr std::uint32_t MAGIC = 0x544D5953U;  // "SYMT"
+  static constexpr std::uint32_t VERSION = 1;
+
+  struct Header {
+    std::atomic<std::uint32_t> magic{0};
+    std::uint32_t version = VERSION;
+    std::uint64_t entriesNumber = 0;
+    std::uint64_t symbolsNumber = 0;
+    std::uint64_t slotsNumber = 0;
+    std::uint64_t namesSize = 0;
+  };
+
+  struct SymbolEntry {
+    std::uint64_t hash = 0;
+    std::uint32_t nameOffset = 0;
+    std::uint32_t nameLength = 0;
+  };
+
+  static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "The magic is shared between the processes");
+  static_assert(std::is_trivially_copyable_v<SymbolEntry> && sizeof(SymbolEntry) == 16 && sizeof(Header) == 40,
+                "The table layout is fixed");
+
+  static constexpr std::size_t SYMBOLS_OFFSET = sizeof(Header);
+
+  static std::size_t getSlotsOffset(std::uint64_t entriesNumber) {
+    return SYMBOLS_OFFSET + static_cast<std::size_t>(entriesNumber) * sizeof(SymbolEntry);
+  }
+
+  static std::size_t getNamesOffset(std::uint64_t entriesNumber, std::uint64_t slotsNumber) {
+    return getSlotsOffset(entriesNumber) + static_cast<std::size_t>(slotsNumber) * sizeof(std::uint32_t);
+  }
+};
+
+class SharedSymbolTable final {
+ public:
+  static constexpr std::uint32_t NOT_FOUND = static_cast<std::uint32_t>(-1);
+
+ private:
+  std::unique_ptr<SharedMemory> memory_;
+  const SharedSymbolTableLayout::Header* header_;
+  const SharedSymbolTableLayout::SymbolEntry* symbols_;
+  const std::uint32_t* slots_;
+  const char* names_;
+  std::uint64_t symbolsNumber_;
+  std::uint64_t slotsMask_;
+
+  explicit SharedSymbolTable(std::unique_ptr<SharedMemory> memory)
+      : memory_{std::move(memory)},
+        header_{static_cast<const SharedSymbolTableLayout::Header*>(memory_->getData())},
+        symbols_{nullptr},
+        slots_{nullptr},
+        names_{nullptr},
+        symbolsNumber_{header_->symbolsNumber},
+        slotsMask_{header_->slotsNumber - 1} {
+    auto data = static_cast<const unsigned char*>(memory_->getData());
+
+    symbols_ = reinterpret_cast<const SharedSymbolTableLayout::SymbolEntry*>(
+      data + SharedSymbolTableLayout::SYMBOLS_OFFSET);
+    slots_ = reinterpret_cast<const std::uint32_t*>(
+      data + SharedSymbolTableLayout::getSlotsOffset(header_->entriesNumber));
+    names_ = reinterpret_cast<const char*>(
+      data + SharedSymbolTableLayout::getNamesOffset(header_->entriesNumber, header_->slotsNumber));
+  }
+
+  // Returns false if the table isn't complete or doesn't fit the region
+  static bool isValid(const SharedMemory& memory) {
+    if (memory.getSize() < sizeof(SharedSymbolTableLayout::Header)) {
+      return false;
+    }
+
+    auto header = static_cast<const SharedSymbolTableLayout::Header*>(memory.getData());
+
+    return header->magic.load(std::memory_order_acquire) == SharedSymbolTableLayout::MAGIC &&
+           header->version == SharedSymbolTableLayout::VERSION && std::has_single_bit(header->slotsNumber) &&
+           header->symbolsNumber <= header->entriesNumber && header->entriesNumber < header->slotsNumber &&
+           SharedSymbolTableLayout::getNamesOffset(header->entriesNumber, header->slotsNumber) + header->namesSize <=
+             memory.getSize();
+  }
+
+ public:
+  // Builds the table of the distinct symbols (the repeated ones are added once) in the new region of the host, the
+  // region is removed when the created table is destroyed (the attached tables stay valid). Returns nullptr if the
+  // region can't be created or the names don't fit the 32-bit offsets.
+  static std::unique_ptr<SharedSymbolTable> create(const std::string& name, std::span<const std::string_view> symbols) {
+    std::uint64_t namesSize = 0;
+
+    for (auto symbol : symbols) {
+      namesSize += symbol.size();
+    }
+
+    // The load factor is at most 0.5
+    auto slotsNumber = std::bit_ceil(static_cast<std::uint64_t>(symbols.size()) * 2 + 1);
+
+    if (namesSize > static_cast<std::uint64_t>(NOT_FOUND) || slotsNumber > static_cast<std::uint64_t>(NOT_FOUND)) {
+      return nullptr;
+    }
+
+    auto memory = SharedMemory::create(
+      name, SharedSymbolTableLayout::getNamesOffset(symbols.size(), slotsNumber) + static_cast<std::size_t>(namesSize));
+
+    if (!memory) {
+      return nullptr;
+    }
+
+    auto data = static_cast<unsigned char*>(memory->getData());
+    auto header = new (data) SharedSymbolTableLayout::Header{};
+    auto entries =
+      reinterpret_cast<SharedSymbolTableLayout::SymbolEntry*>(data + SharedSymbolTableLayout::SYMBOLS_OFFSET);
+    auto slots = reinterpret_cast<std::uint32_t*>(data + SharedSymbolTableLayout::getSlotsOffset(symbols.size()));
+    auto names = reinterpret_cast<char*>(data + SharedSymbolTableLayout::getNamesOffset(symbols.size(), slotsNumber));
+    std::uint64_t symbolsNumber = 0;
+    std::uint32_t nameOffset = 0;
+
+    std::memset(slots, 0, static_cast<std::size_t>(slotsNumber) * sizeof(std::uint32_t));
+
+    for (auto symbol : symbols) {
+      auto hash = static_cast<std::uint64_t>(Symbol::hashOf(symbol));
+      auto slot = hash & (slotsNumber - 1);
+      auto isRepeated = false;
+
+      for (; slots[slot] != 0; slot = (slot + 1) & (slotsNumber - 1)) {
+        const auto& entry = entries[slots[slot] - 1];
+
+        if (entry.hash == hash && std::string_view{names + entry.nameOffset, entry.nameLength} == symbol) {
+          isRepeated = true;
+
+          break;
+        }
+      }
+
+      if (isRepeated) {
+        continue;
+      }
+
+      symbol.copy(names + nameOffset, symbol.size());
+      entries[symbolsNumber] = {hash, nameOffset, static_cast<std::uint32_t>(symbol.size())};
+      slots[slot] = static_cast<std::uint32_t>(symbolsNumber + 1);
+      nameOffset += static_cast<std::uint32_t>(symbol.size());
+      symbolsNumber++;
+    }
+
+    // The entries of the repeated symbols are left unused at the end of the symbols
+    header->entriesNumber = symbols.size();
+    header->symbolsNumber = symbolsNumber;
+    header->slotsNumber = slotsNumber;
+    header->namesSize = nameOffset;
+    header->magic.store(SharedSymbolTableLayout::MAGIC, std::memory_order_release);
+
+    return std::unique_ptr<SharedSymbolTable>(new SharedSymbolTable(std::move(memory)));
+  }
+
+  // Attaches the table of the region read-only. Waits up to the timeout for the creator to complete the table. Returns
+  // nullptr if there is no such region or the table isn't complete by the timeout.
+  static std::unique_ptr<SharedSymbolTable> open(const std::string& name,
+                                                 std::chrono::milliseconds timeout = std::chrono::milliseconds{0}) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while (true) {
+      auto memory = SharedMemory::open(name);
+
+      if (memory && isValid(*memory)) {
+        return std::unique_ptr<SharedSymbolTable>(new SharedSymbolTable(std::move(memory)));
+      }
+
+      if (std::chrono::steady_clock::now() >= deadline) {
+        return nullptr;
+      }
+
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+  }
+
+  // Attaches the table of the region if it exists, otherwise builds it (see create). isCreated - the table is built by
+  // this process (it owns the region then).
+  static std::unique_ptr<SharedSymbolTable> openOrCreate(const std::string& name,
+                                                         std::span<const std::string_view> symbols,
+                                                         bool* isCreated = nullptr) {
+    if (auto table = open(name)) {
+      if (isCreated != nullptr) {
+        *isCreated = false;
+      }
+
+      return table;
+    }
+
+    if (isCreated != nullptr) {
+      *isCreated = true;
+    }
+
+    return create(name, symbols);
+  }
+
+  SharedSymbolTable(const SharedSymbolTable&) = delete;
+  SharedSymbolTable& operator=(const SharedSymbolTable&) = delete;
+
+  // The id of the symbol (NOT_FOUND - the symbol isn't in the table)
+  [[nodiscard]] std::uint32_t find(std::string_view symbol) const {
+    return find(symbol, static_cast<std::uint64_t>(Symbol::hashOf(symbol)));
+  }
+
+  // The interned symbol keeps its hash, so it isn't hashed again
+  [[nodiscard]] std::uint32_t find(const Symbol& symbol) const {
+    return find(symbol.getName(), static_cast<std::uint64_t>(symbol.getHash()));
+  }
+
+  [[nodiscard]] std::uint32_t find(std::string_view symbol, std::uint64_t hash) const {
+    for (auto slot = hash & slotsMask_; slots_[slot] != 0; slot = (slot + 1) & slotsMask_) {
+      const auto& entry = symbols_[slots_[slot] - 1];
+
+      if (entry.hash == hash && std::string_view{names_ + entry.nameOffset, entry.nameLength} == symbol) {
+        return slots_[slot] - 1;
+      }
+    }
+
+    return NOT_FOUND;
+  }
+
+  // The name of the symbol in the shared memory (the id must be less than the size)
+  [[nodiscard]] std::string_view getName(std::uint32_t id) const {
+    const auto& entry = symbols_[id];
+
+    return {names_ + entry.nameOffset, entry.nameLength};
+  }
+
+  [[nodiscard]] std::uint64_t getHash(std::uint32_t id) const { return symbols_[id].hash; }
+
+  [[nodiscard]] std::size_t getSize() const { return static_cast<std::size_t>(symbolsNumber_); }
+
+  // The bytes of the shared region (shared by all processes of the host)
+  [[nodiscard]] std::size_t getSharedSize() const { return memory_->getSize(); }
+};
+
+}  // namespace dxf
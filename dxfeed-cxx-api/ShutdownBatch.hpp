@@ -0,0 +1,148 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dxf {
+
+// The bulk close of the handles of the C API and the objects that use them (e.g. the books) by one operation, without
+// blocking the caller: the stops (e.g. the stop flags of the listeners, PriceLevelBook::resetListener) are run at
+// once, so the dispatch to the application stops immediately, and the rest is torn down on the background thread in
+// the order: the subscriptions, the snapshots and the price level books, the owned objects, the connections. The
+// connections are closed in parallel (every dxf_close_connection joins the threads of its connection), so the close of
+// many connections takes as long as the slowest one.
+//
+// Usage:
+//   auto closed = ShutdownBatch{}.addStop([&] { isStopped = true; }).addOwned(std::move(books))
+//                   .addConnections(connections).closeAsync();
+//   ...
+//   closed.wait();
+class ShutdownBatch final {
+  std::vector<std::function<void()>> stops_{};
+  std::vector<dxf_subscription_t> subscriptions_{};
+  std::vector<dxf_snapshot_t> snapshots_{};
+  std::vector<dxf_price_level_book_t> priceLevelBooks_{};
+  std::vector<std::function<void()>> teardowns_{};
+  std::vector<dxf_connection_t> connections_{};
+
+  void tearDown() {
+    for (auto subscription : subscriptions_) {
+      dxf_close_subscription(subscription);
+    }
+
+    for (auto snapshot : snapshots_) {
+      dxf_close_snapshot(snapshot);
+    }
+
+    for (auto book : priceLevelBooks_) {
+      dxf_close_price_level_book(book);
+    }
+
+    for (auto &teardown : teardowns_) {
+      teardown();
+    }
+
+    teardowns_.clear();
+
+    std::vector<std::thread> closes{};
+
+    closes.reserve(connections_.size());
+
+    for (auto connection : connections_) {
+      closes.emplace_back([connection] { dxf_close_connection(connection); });
+    }
+
+    for (auto &close : closes) {
+      close.join();
+    }
+  }
+
+ public:
+  // The stop is run by the closeAsync on the calling thread, before the teardown
+  ShutdownBatch &addStop(std::function<void()> stop) {
+    stops_.push_back(std::move(stop));
+
+    return *this;
+  }
+
+  ShutdownBatch &addSubscription(dxf_subscription_t subscription) {
+    if (subscription != nullptr) {
+      subscriptions_.push_back(subscription);
+    }
+
+    return *this;
+  }
+
+  ShutdownBatch &addSnapshot(dxf_snapshot_t snapshot) {
+    if (snapshot != nullptr) {
+      snapshots_.push_back(snapshot);
+    }
+
+    return *this;
+  }
+
+  ShutdownBatch &addPriceLevelBook(dxf_price_level_book_t book) {
+    if (book != nullptr) {
+      priceLevelBooks_.push_back(book);
+    }
+
+    return *this;
+  }
+
+  // The object is destroyed on the background thread before the connections are closed (e.g. the books, whose
+  // destructors close their snapshots and join their workers)
+  template <typename T>
+  ShutdownBatch &addOwned(T object) {
+    teardowns_.emplace_back([owned = std::make_shared<T>(std::move(object))]() mutable { owned.reset(); });
+
+    return *this;
+  }
+
+  ShutdownBatch &addConnection(dxf_connection_t connection) {
+    if (connection != nullptr) {
+      connections_.push_back(connection);
+    }
+
+    return *this;
+  }
+
+  ShutdownBatch &addConnections(const std::vector<dxf_connection_t> &connections) {
+    for (auto connection : connections) {
+      addConnection(connection);
+    }
+
+    return *this;
+  }
+
+  // Runs the stops and starts the teardown on the background thread, the batch is empty after the call. The future is
+  // ready when everything is closed (it doesn't block on the destruction, so the teardown may be left to finish after
+  // the caller is done).
+  std::future<void> closeAsync() {
+    for (auto &stop : stops_) {
+      stop();
+    }
+
+    auto done = std::make_shared<std::promise<void>>();
+    auto future = done->get_future();
+
+    stops_.clear();
+
+    std::thread([batch = std::move(*this), done]() mutable {
+      batch.tearDown();
+      done->set_value();
+    }).detach();
+
+    return future;
+  }
+
+  // The same as closeAsync, but waits for the teardown
+  void close() { closeAsync().wait(); }
+};
+
+}  // namespace dxf
@@ -1,104 +1,1166 @@
 #pragma once
 
 #include <DXFeed.h>
-#include <unordered_map>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
 #include <future>
-#include <thread>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "ConnectionPool.hpp"
+#include "Coroutine.hpp"
+#include "EventFilter.hpp"
+#include "EventProjection.hpp"
+#include "EventReceiver.hpp"
+#include "EventStream.hpp"
+#include "EventTraits.hpp"
+#include "Executor.hpp"
+#include "IndexDeduplicator.hpp"
+#include "LargePages.hpp"
+#include "StringConverter.hpp"
+#include "SymbolSubscription.hpp"
+#include "SymbolTable.hpp"
 #include "TimeAndSale.hpp"
+#include "TimeAndSaleCache.hpp"
+#include "TimeAndSaleColumns.hpp"
+#include "TimeAndSaleData.hpp"
+#include "TimeAndSaleHistory.hpp"
+#include "TimeAndSaleTape.hpp"
+#include "TimeAndSaleView.hpp"
+#include "TimeSeriesStore.hpp"
 
 namespace dxf {
 
 struct SimpleTimeAndSaleDataProvider {
-  using ResultType = std::unordered_map<std::string, std::vector<TimeAndSale>>;
+  // The events of one symbol in the own monotonic arena: the growth of the vector is a pointer bump and the whole
+  // memory is released at once with the object. The large blocks of the arena are the large page buffers (see
+  // LargePages).
+  class ArenaEvents final {
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
+    // Destroyed before the arena
+    std::pmr::vector<TimeAndSale> events_;
+
+   public:
+    // The size of the first block of the arena (the next ones grow geometrically)
+    static constexpr std::size_t INITIAL_ARENA_SIZE = 64 * 1024;
+
+    ArenaEvents()
+        : arena_{std::make_unique<std::pmr::monotonic_buffer_resource>(INITIAL_ARENA_SIZE, LargePages::getResource())},
+          events_{arena_.get()} {}
+
+    // The moved vector keeps the allocator of the moved arena, the moved-from object must not be used
+    ArenaEvents(ArenaEvents &&) noexcept = default;
+    ArenaEvents &operator=(ArenaEvents &&) = delete;
+
+    [[nodiscard]] std::pmr::vector<TimeAndSale> &getEvents() { return events_; }
+
+    [[nodiscard]] const std::pmr::vector<TimeAndSale> &getEvents() const { return events_; }
+  };
+
+  using ResultType = SymbolMap<std::vector<TimeAndSale>>;
   using ResultFutureType = std::future<ResultType>;
+  using ColumnsResultType = SymbolMap<TimeAndSaleColumns>;
+  using ColumnsResultFutureType = std::future<ColumnsResultType>;
+  using DataResultType = SymbolMap<std::vector<TimeAndSaleData>>;
+  using DataResultFutureType = std::future<DataResultType>;
+  using ArenaResultType = SymbolMap<ArenaEvents>;
+  using ArenaResultFutureType = std::future<ArenaResultType>;
+  using HistoryResultType = SymbolMap<TimeAndSaleHistory>;
+  using HistoryResultFutureType = std::future<HistoryResultType>;
+  using StoreResultType = SymbolMap<TimeSeriesStore<TimeAndSale>>;
+  using StoreResultFutureType = std::future<StoreResultType>;
+  // The paths of the tapes of the symbols (see runTape)
+  using TapeResultType = SymbolMap<std::string>;
+  using TapeResultFutureType = std::future<TapeResultType>;
+  // The receiver of the events of the streaming mode
+  using SinkType = std::function<void(TimeAndSale &&)>;
+  // The receiver of the views of the events (see runStreamingViews)
+  using ViewSinkType = std::function<void(const TimeAndSaleView &)>;
+  // The receiver of the groups of the events of many symbols (see runStreamingGroups): symbolIndexes[i] is the position
+  // of the symbol of the events[i] in the requested symbols (EventReceiver::UNKNOWN_SYMBOL - not requested). The events
+  // can be moved.
+  using GroupSinkType =
+    std::function<void(std::span<const std::size_t> symbolIndexes, std::span<TimeAndSale> events)>;
+
+  // The early completion of the fetch (see EventReceiver::HistoryCompletion)
+  using HistoryCompletion = EventReceiver::HistoryCompletion;
+
+  // The predicate on the raw events that is evaluated before the conversion (see EventFilter), e.g.
+  // FilterType{}.whereIn(&dxf_time_and_sale_t::scope, {dxf_osc_order})
+  using FilterType = EventFilter<dxf_time_and_sale_t>;
 
   SimpleTimeAndSaleDataProvider() = default;
 
-  static ResultFutureType run(const std::string &address, const std::vector<std::string> &symbols, int timeout = 0) {
-    return std::async(std::launch::async, [address, symbols, timeout]() {
-      struct Impl {
-        std::atomic<bool> disconnected_ = false;
-        std::mutex eventsMutex_{};
-        ResultType events_{};
-        std::mutex cvMutex_{};
-        std::condition_variable cv_{};
-      } impl;
-
-      dxf_connection_t con = nullptr;
-      auto res = dxf_create_connection(
-        address.c_str(),
-        [](dxf_connection_t c, void *data) {
-          static_cast<Impl *>(data)->disconnected_ = true;
-          static_cast<Impl *>(data)->cv_.notify_one();
+ private:
+  static constexpr std::size_t UNKNOWN_SYMBOL = EventReceiver::UNKNOWN_SYMBOL;
+
+  using IndexedSinkType = EventReceiver::SinkType<dxf_time_and_sale_t>;
+  using BatchSinkType = EventReceiver::BatchSinkType<dxf_time_and_sale_t>;
+  using StopSignal = EventReceiver::StopSignal;
+
+  // Sorts the events by the index and the time and removes the duplicates (keeps the first one)
+  template <TimeSeriesEventLike E>
+  static void mergeEvents(std::vector<E> &events) {
+    // The keys are sorted instead of the events. The position is the last key, so the first event of the duplicates
+    // is kept.
+    std::vector<std::tuple<std::uint64_t, std::uint64_t, std::size_t>> keys{};
+
+    keys.reserve(events.size());
+
+    for (std::size_t i = 0; i < events.size(); i++) {
+      keys.emplace_back(EventTraits<E>::getIndex(events[i]), EventTraits<E>::getTime(events[i]), i);
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<E> mergedEvents{};
+
+    mergedEvents.reserve(keys.size());
+
+    for (std::size_t i = 0; i < keys.size(); i++) {
+      if (i == 0 || std::get<0>(keys[i]) != std::get<0>(keys[i - 1]) ||
+          std::get<1>(keys[i]) != std::get<1>(keys[i - 1])) {
+        mergedEvents.push_back(std::move(events[std::get<2>(keys[i])]));
+      }
+    }
+
+    events = std::move(mergedEvents);
+  }
+
+  // Receives the TimeAndSale events (see EventReceiver::receive)
+  static bool receive(const std::string &address, const std::vector<std::string> &symbols,
+                      const IndexedSinkType &sink, int timeout, ConnectionPool *pool,
+                      const std::optional<HistoryCompletion> &completion, StopSignal *stopSignal = nullptr,
+                      dxf_long_t fromTime = 0, std::size_t lane = 0, FilterType filter = {}) {
+    return EventReceiver::receive<dxf_time_and_sale_t>(DXF_ET_TIME_AND_SALE, true, address, symbols, sink, timeout,
+                                                       pool, completion, stopSignal, fromTime, lane, std::move(filter));
+  }
+
+  // Receives the arrays of the TimeAndSale events without the waiting thread (see EventReceiver::receiveBatchesAsync)
+  static std::function<void()> receiveBatchesAsync(Executor &executor, const std::string &address,
+                                                   const std::vector<std::string> &symbols, BatchSinkType sink,
+                                                   int timeout, ConnectionPool *pool,
+                                                   std::optional<HistoryCompletion> completion,
+                                                   std::function<void(bool)> onDone, FilterType filter = {}) {
+    return EventReceiver::receiveBatchesAsync<dxf_time_and_sale_t>(
+      executor, DXF_ET_TIME_AND_SALE, true, address, symbols, std::move(sink), timeout, pool, std::move(completion),
+      std::move(onDone), std::move(filter));
+  }
+
+  // Appends the events of the requested symbol to the ones of the symbol that were received as unknown (see
+  // EventsCollector::takeResult)
+  template <typename E, typename Allocator>
+  static void appendEvents(std::vector<E, Allocator> &target, std::vector<E, Allocator> &&source) {
+    std::move(source.begin(), source.end(), std::back_inserter(target));
+  }
+
+  // The events of the source arena are moved to the target one
+  static void appendEvents(ArenaEvents &target, ArenaEvents &&source) {
+    appendEvents(target.getEvents(), std::move(source.getEvents()));
+  }
+
+  // The merged events of the source store are appended to the target one (the target orders them by its flush)
+  static void appendEvents(TimeSeriesStore<TimeAndSale> &target, TimeSeriesStore<TimeAndSale> &&source) {
+    source.flush();
+
+    for (std::size_t i = 0; i < source.getChunksNumber(); i++) {
+      for (const auto &event : source.getChunk(i)) {
+        target.append(event);
+      }
+    }
+  }
+
+  // The events of the run. The slot of every requested symbol is assigned before the subscription, so the events are
+  // added to its slot without the global lock and the symbol lookup. Storage is the container of the events of one
+  // symbol (e.g. std::vector<TimeAndSale>), the receiver adds the events to it by the add, and the storages of the
+  // slots are moved to the result (or appended by the appendEvents if the symbol was received as unknown too).
+  template <typename Storage = std::vector<TimeAndSale>>
+  class EventsCollector final {
+    struct Slot {
+      std::mutex mutex{};
+      Storage storage{};
+      bool isAdded = false;
+    };
+
+    std::vector<std::string> symbols_;
+    std::vector<Slot> slots_;
+    std::mutex unknownEventsMutex_{};
+    SymbolMap<Storage> result_{};
+
+   public:
+    explicit EventsCollector(std::vector<std::string> symbols)
+        : symbols_{std::move(symbols)}, slots_(symbols_.size()) {}
+
+    // Calls the addTo(Storage&) with the storage of the symbol under its lock
+    template <typename AddTo>
+    void add(std::size_t symbolIndex, const Symbol &symbol, AddTo &&addTo) {
+      if (symbolIndex != UNKNOWN_SYMBOL) {
+        auto &slot = slots_[symbolIndex];
+        std::lock_guard guard(slot.mutex);
+
+        slot.isAdded = true;
+        addTo(slot.storage);
+      } else {
+        std::lock_guard guard(unknownEventsMutex_);
+
+        addTo(result_.try_emplace(symbol).first->second);
+      }
+    }
+
+    // Must be called after the receive
+    SymbolMap<Storage> takeResult() {
+      for (std::size_t i = 0; i < symbols_.size(); i++) {
+        if (!slots_[i].isAdded) {
+          continue;
+        }
+
+        // The storage isn't moved if the symbol is already in the result
+        auto [found, isInserted] = result_.try_emplace(Symbol::valueOf(symbols_[i]), std::move(slots_[i].storage));
+
+        if (!isInserted) {
+          appendEvents(found->second, std::move(slots_[i].storage));
+        }
+      }
+
+      return std::move(result_);
+    }
+  };
+
+  // Collects the events without the waiting thread, onResult is called on the executor (see run with the executor)
+  static void runAsync(Executor &executor, const std::string &address, const std::vector<std::string> &symbols,
+                       int timeout, ConnectionPool *pool, std::optional<HistoryCompletion> completion,
+                       std::function<void(ResultType)> onResult) {
+    auto collector = std::make_shared<EventsCollector<>>(symbols);
+
+    receiveBatchesAsync(
+      executor, address, symbols,
+      [collector](std::size_t symbolIndex, const Symbol &symbol, const dxf_time_and_sale_t *tnss, std::size_t count) {
+        collector->add(symbolIndex, symbol, [&symbol, tnss, count](std::vector<TimeAndSale> &events) {
+          for (std::size_t i = 0; i < count; i++) {
+            events.emplace_back(symbol, tnss[i]);
+          }
+        });
+      },
+      timeout, pool, std::move(completion),
+      [collector, onResult = std::move(onResult)](bool) { onResult(collector->takeResult()); });
+  }
+
+  // Receives the arrays of the TimeAndSale events (see EventReceiver::receiveBatches)
+  static bool receiveBatches(const std::string &address, const std::vector<std::string> &symbols,
+                             const BatchSinkType &sink, int timeout, ConnectionPool *pool,
+                             const std::optional<HistoryCompletion> &completion, FilterType filter = {}) {
+    return EventReceiver::receiveBatches<dxf_time_and_sale_t>(DXF_ET_TIME_AND_SALE, true, address, symbols, sink,
+                                                              timeout, pool, completion, nullptr, 0, 0,
+                                                              std::move(filter));
+  }
+
+ public:
+  // Collects all events of the symbols until the disconnect or the timeout (ms, 0 - no timeout). pool - the pool that
+  // shares the connection with the other runs (nullptr - the run has its own connection); it must outlive the run.
+  // completion - complete the run as soon as all symbols are caught up (see HistoryCompletion). filter - only the
+  // accepted events are converted and collected (see FilterType).
+  static ResultFutureType run(const std::string &address, const std::vector<std::string> &symbols, int timeout = 0,
+                              ConnectionPool *pool = nullptr,
+                              std::optional<HistoryCompletion> completion = std::nullopt, FilterType filter = {}) {
+    return std::async(std::launch::async, [address, symbols, timeout, pool, completion = std::move(completion),
+                                           filter = std::move(filter)]() {
+      EventsCollector<> collector{symbols};
+
+      receive(
+        address, symbols,
+        [&collector](std::size_t symbolIndex, const Symbol &symbol, const dxf_time_and_sale_t &tns) {
+          collector.add(symbolIndex, symbol,
+                        [&symbol, &tns](std::vector<TimeAndSale> &events) { events.emplace_back(symbol, tns); });
+        },
+        timeout, pool, completion, nullptr, 0, 0, filter);
+
+      return collector.takeResult();
+    });
+  }
+
+  // The same as run, but no thread waits for the events (see EventReceiver::receiveBatchesAsync): the executor runs
+  // only the start and the completion of the run, so any number of the concurrent runs needs only its threads. The
+  // executor must outlive the run.
+  static ResultFutureType run(Executor &executor, const std::string &address, const std::vector<std::string> &symbols,
+                              int timeout = 0, ConnectionPool *pool = nullptr,
+                              std::optional<HistoryCompletion> completion = std::nullopt) {
+    auto result = std::make_shared<std::promise<ResultType>>();
+    auto future = result->get_future();
+
+    runAsync(executor, address, symbols, timeout, pool, std::move(completion),
+             [result](ResultType events) { result->set_value(std::move(events)); });
+
+    return future;
+  }
+
+  // The awaitable run for the coroutines (see Task, startTask):
+  //
+  //   auto events = co_await SimpleTimeAndSaleDataProvider::fetch(executor, address, symbols);
+  //
+  // The coroutine is resumed on the executor when the run is finished, no thread waits for the events. The arguments
+  // are the same as the run ones.
+  static CallbackAwaitable<ResultType> fetch(Executor &executor, const std::string &address,
+                                             const std::vector<std::string> &symbols, int timeout = 0,
+                                             ConnectionPool *pool = nullptr,
+                                             std::optional<HistoryCompletion> completion = std::nullopt) {
+    return CallbackAwaitable<ResultType>{[&executor, address, symbols, timeout, pool,
+                                          completion = std::move(completion)](
+                                           std::function<void(ResultType)> onResult) mutable {
+      runAsync(executor, address, symbols, timeout, pool, std::move(completion), std::move(onResult));
+    }};
+  }
+
+  // The stream of the events for the coroutines (see EventStream):
+  //
+  //   auto stream = SimpleTimeAndSaleDataProvider::subscribe(executor, address, symbols);
+  //
+  //   while (auto timeAndSale = co_await stream->next()) { ... }
+  //
+  // The subscription is closed after the disconnect, the timeout, the completion or the stream->close(). backpressure -
+  // the bound of the events the consumer hasn't taken and the policy of the overflow (see EventStream; the CONFLATE
+  // policy keeps the latest event of every symbol). The other arguments are the same as the run ones.
+  static std::shared_ptr<EventStream<TimeAndSale>> subscribe(
+    Executor &executor, const std::string &address, const std::vector<std::string> &symbols, int timeout = 0,
+    ConnectionPool *pool = nullptr, std::optional<HistoryCompletion> completion = std::nullopt,
+    BackpressureConfig backpressure = {}) {
+    auto stream = std::make_shared<EventStream<TimeAndSale>>(executor, backpressure, [](const TimeAndSale &event) {
+      // The symbols are interned, so the events of one symbol share the name
+      return reinterpret_cast<std::size_t>(event.getSharedEventSymbol().get());
+    });
+
+    stream->setStop(receiveBatchesAsync(
+      executor, address, symbols,
+      [stream](std::size_t, const Symbol &symbol, const dxf_time_and_sale_t *tnss, std::size_t count) {
+        for (std::size_t i = 0; i < count; i++) {
+          stream->push(TimeAndSale(symbol, tnss[i]));
+        }
+      },
+      timeout, pool, std::move(completion), [stream](bool isReceived) { stream->finish(isReceived); }));
+
+    return stream;
+  }
+
+  // Collects all events of the symbols as the plain structs (see TimeAndSaleData) instead of the TimeAndSale objects
+  // with the virtual interfaces. The arguments are the same as the run ones.
+  static DataResultFutureType runData(const std::string &address, const std::vector<std::string> &symbols,
+                                      int timeout = 0, ConnectionPool *pool = nullptr,
+                                      std::optional<HistoryCompletion> completion = std::nullopt) {
+    return std::async(std::launch::async, [address, symbols, timeout, pool, completion = std::move(completion)]() {
+      EventsCollector<std::vector<TimeAndSaleData>> collector{symbols};
+
+      receive(
+        address, symbols,
+        [&collector](std::size_t symbolIndex, const Symbol &symbol, const dxf_time_and_sale_t &tns) {
+          collector.add(symbolIndex, symbol, [&symbol, &tns](std::vector<TimeAndSaleData> &events) {
+            events.push_back(TimeAndSaleData::create(symbol, tns));
+          });
+        },
+        timeout, pool, completion);
+
+      return collector.takeResult();
+    });
+  }
+
+  // Collects the projections of all events of the symbols (see project): the compact struct of the consumer is filled
+  // from the members of the C API events it declares, without the TimeAndSale objects and their strings, e.g.
+  //
+  //   struct Trade {
+  //     double price;
+  //     double size;
+  //
+  //     using Projection = project<&dxf_time_and_sale_t::price, &dxf_time_and_sale_t::size>;
+  //   };
+  //
+  //   auto trades = SimpleTimeAndSaleDataProvider::runProjected<Trade>(address, symbols).get();
+  //
+  // The arguments are the same as the run ones.
+  template <ProjectedFrom<dxf_time_and_sale_t> Event>
+  static std::future<SymbolMap<std::vector<Event>>> runProjected(
+    const std::string &address, const std::vector<std::string> &symbols, int timeout = 0,
+    ConnectionPool *pool = nullptr, std::optional<HistoryCompletion> completion = std::nullopt,
+    FilterType filter = {}) {
+    return std::async(std::launch::async, [address, symbols, timeout, pool, completion = std::move(completion),
+                                           filter = std::move(filter)]() {
+      EventsCollector<std::vector<Event>> collector{symbols};
+
+      receiveBatches(
+        address, symbols,
+        [&collector](std::size_t symbolIndex, const Symbol &symbol, const dxf_time_and_sale_t *tnss,
+                     std::size_t count) {
+          collector.add(symbolIndex, symbol,
+                        [tnss, count](std::vector<Event> &events) { Event::Projection::append(tnss, count, events); });
         },
-        nullptr, nullptr, nullptr, static_cast<void *>(&impl), &con);
+        timeout, pool, completion, filter);
+
+      return collector.takeResult();
+    });
+  }
+
+  // Collects all events of the symbols to the arenas (see ArenaEvents): every symbol has its own arena, so the
+  // allocations of the concurrent fetches don't contend in the global allocator. The arguments are the same as the run
+  // ones.
+  static ArenaResultFutureType runArena(const std::string &address, const std::vector<std::string> &symbols,
+                                        int timeout = 0, ConnectionPool *pool = nullptr,
+                                        std::optional<HistoryCompletion> completion = std::nullopt) {
+    return std::async(std::launch::async, [address, symbols, timeout, pool, completion = std::move(completion)]() {
+      EventsCollector<ArenaEvents> collector{symbols};
+
+      receive(
+        address, symbols,
+        [&collector](std::size_t symbolIndex, const Symbol &symbol, const dxf_time_and_sale_t &tns) {
+          collector.add(symbolIndex, symbol,
+                        [&symbol, &tns](ArenaEvents &events) { events.getEvents().emplace_back(symbol, tns); });
+        },
+        timeout, pool, completion);
+
+      return collector.takeResult();
+    });
+  }
+
+  // Collects all events of the symbols to the time series stores (see TimeSeriesStore): the events are ordered by the
+  // time and the index, the removed events (REMOVE_EVENT) are dropped, and the stores answer the time range queries
+  // without the scan. The arguments are the same as the run ones.
+  static StoreResultFutureType runStore(const std::string &address, const std::vector<std::string> &symbols,
+                                        int timeout = 0, ConnectionPool *pool = nullptr,
+                                        std::optional<HistoryCompletion> completion = std::nullopt) {
+    return std::async(std::launch::async, [address, symbols, timeout, pool, completion = std::move(completion)]() {
+      EventsCollector<TimeSeriesStore<TimeAndSale>> collector{symbols};
+
+      receive(
+        address, symbols,
+        [&collector](std::size_t symbolIndex, const Symbol &symbol, const dxf_time_and_sale_t &tns) {
+          collector.add(symbolIndex, symbol, [&symbol, &tns](TimeSeriesStore<TimeAndSale> &store) {
+            store.append(TimeAndSale(symbol, tns));
+          });
+        },
+        timeout, pool, completion);
+
+      auto result = collector.takeResult();
+
+      for (auto &[symbol, store] : result) {
+        store.flush();
+      }
+
+      return result;
+    });
+  }
+
+  // Fetches the symbols from all addresses in parallel (e.g. the redundant endpoints) and merges the events: the events
+  // of every symbol are sorted by the index and the time, the event that arrives from several endpoints is kept once
+  // (the later copies are dropped at ingest by the index, before the conversion, see IndexDeduplicator).
+  // With the completion the symbol is caught up as soon as the fastest endpoint delivers its history, and the fetch is
+  // completed when all symbols are caught up; onSymbolCompleted is called once per symbol, from the connection thread
+  // of that endpoint. The other arguments are the same as the run ones.
+  static ResultFutureType runMerged(const std::vector<std::string> &addresses, const std::vector<std::string> &symbols,
+                                    int timeout = 0, ConnectionPool *pool = nullptr,
+                                    std::optional<HistoryCompletion> completion = std::nullopt) {
+    return std::async(std::launch::async, [addresses, symbols, timeout, pool, completion = std::move(completion)]() {
+      struct Slot {
+        std::mutex mutex{};
+        std::vector<TimeAndSale> events{};
+        IndexDeduplicator seenIndexes{};
+      };
+
+      std::vector<Slot> slots(symbols.size());
+      std::mutex unknownEventsMutex{};
+      ResultType events{};
+      SymbolMap<IndexDeduplicator> unknownSeenIndexes{};
+      StopSignal stopSignal{};
+      // The symbols that are caught up by any endpoint
+      std::mutex completedSymbolsMutex{};
+      std::unordered_set<std::string> completedSymbols{};
+      auto uniqueSymbolsNumber = std::unordered_set<std::string>(symbols.begin(), symbols.end()).size();
+      std::optional<HistoryCompletion> endpointCompletion{};
+
+      if (completion) {
+        endpointCompletion = HistoryCompletion{
+          completion->liveLag, [&completion, &completedSymbolsMutex, &completedSymbols, uniqueSymbolsNumber,
+                                &stopSignal](const std::string &symbol) {
+            bool isLast = false;
+
+            {
+              std::lock_guard guard(completedSymbolsMutex);
+
+              if (!completedSymbols.insert(symbol).second) {
+                return;
+              }
+
+              isLast = completedSymbols.size() == uniqueSymbolsNumber;
+            }
+
+            if (completion->onSymbolCompleted) {
+              completion->onSymbolCompleted(symbol);
+            }
 
-      if (res == DXF_FAILURE) {
-        return impl.events_;
+            if (isLast) {
+              stopSignal.stop();
+            }
+          }};
       }
 
-      dxf_subscription_t sub = nullptr;
-      res = dxf_create_subscription_timed(con, DXF_ET_TIME_AND_SALE, 0, &sub);
+      IndexedSinkType sink = [&slots, &unknownEventsMutex, &events, &unknownSeenIndexes](
+                               std::size_t symbolIndex, const Symbol &symbol, const dxf_time_and_sale_t &tns) {
+        auto index = static_cast<std::uint64_t>(tns.index);
+
+        if (symbolIndex != UNKNOWN_SYMBOL) {
+          std::lock_guard guard(slots[symbolIndex].mutex);
+
+          if (slots[symbolIndex].seenIndexes.insert(index)) {
+            slots[symbolIndex].events.emplace_back(symbol, tns);
+          }
+        } else {
+          std::lock_guard guard(unknownEventsMutex);
+
+          if (unknownSeenIndexes[symbol].insert(index)) {
+            events[symbol].emplace_back(symbol, tns);
+          }
+        }
+      };
+
+      std::vector<std::future<bool>> receives{};
 
-      if (res == DXF_FAILURE) {
-        return impl.events_;
+      for (const auto &address : addresses) {
+        receives.push_back(std::async(std::launch::async, [&, address]() {
+          return receive(address, symbols, sink, timeout, pool, endpointCompletion, &stopSignal);
+        }));
       }
 
-      dxf_attach_event_listener(
-        sub,
-        [](int eventType, dxf_const_string_t symbolName, const dxf_event_data_t *eventData, int, void *userData) {
-          if (eventType == DXF_ET_TIME_AND_SALE) {
-            const auto *tns = reinterpret_cast<const dxf_time_and_sale_t *>(eventData);
-            auto *implPtr = static_cast<Impl *>(userData);
-            auto symbol = StringConverter::wStringToUtf8(std::wstring(symbolName));
-            auto timeAndSale = TimeAndSale(symbol, *tns);
+      for (auto &r : receives) {
+        r.wait();
+      }
+
+      for (std::size_t i = 0; i < symbols.size(); i++) {
+        if (!slots[i].events.empty()) {
+          auto &symbolEvents = events[Symbol::valueOf(symbols[i])];
+
+          std::move(slots[i].events.begin(), slots[i].events.end(), std::back_inserter(symbolEvents));
+        }
+      }
 
-            std::lock_guard guard(implPtr->eventsMutex_);
-            if (auto found = implPtr->events_.find(symbol); found != implPtr->events_.end()) {
-              found->second.emplace_back(timeAndSale);
+      for (auto &[symbol, symbolEvents] : events) {
+        mergeEvents(symbolEvents);
+      }
+
+      return events;
+    });
+  }
+
+  // Fetches the history of the time range [fromTime, toTime) (ms) by the windows of the equal length in parallel: every
+  // window has its own time subscription from its start and its own connection (the lane of the pooled connection,
+  // see ConnectionPool::acquire), so the windows are received, converted and collected by the different threads. The
+  // window keeps only the events of its range and is completed as soon as all its symbols are caught up (the timeout
+  // is the upper bound). The events of every symbol are stitched by the index and the time, the event that is
+  // received by several windows (e.g. at the window boundary) is kept once.
+  //
+  // The time subscription of the C API has no end time: every window receives the events newer than its start, and
+  // the ones of the later windows are dropped before the conversion. The windows speed up the large backfills whose
+  // bottleneck is the decoding and the conversion of the events, not the network.
+  static ResultFutureType runPartitioned(const std::string &address, const std::vector<std::string> &symbols,
+                                         std::int64_t fromTime, std::int64_t toTime, std::size_t windowsNumber,
+                                         int timeout = 0, ConnectionPool *pool = nullptr) {
+    return std::async(std::launch::async, [address, symbols, fromTime, toTime, windowsNumber, timeout, pool]() {
+      struct Window {
+        std::int64_t start = 0;
+        std::int64_t end = 0;
+        // The events of the requested symbols and the unknown ones (the window is filled by its connection thread)
+        std::vector<std::vector<TimeAndSale>> events{};
+        ResultType unknownEvents{};
+      };
+
+      auto length = (std::max)(toTime - fromTime, std::int64_t{0});
+      // The windows are at least 1 ms long
+      auto number = (std::clamp)(static_cast<std::int64_t>(windowsNumber), std::int64_t{1},
+                                 (std::max)(length, std::int64_t{1}));
+      std::vector<Window> windows(static_cast<std::size_t>(number));
+
+      for (std::int64_t i = 0; i < number; i++) {
+        auto &window = windows[static_cast<std::size_t>(i)];
+
+        window.start = fromTime + length * i / number;
+        window.end = fromTime + length * (i + 1) / number;
+        window.events.resize(symbols.size());
+      }
+
+      // The window is completed by the snapshot of its symbols, the live events are not in its range
+      std::optional<HistoryCompletion> completion{HistoryCompletion{}};
+      std::vector<std::future<bool>> receives{};
+
+      for (std::size_t i = 0; i < windows.size(); i++) {
+        receives.push_back(std::async(std::launch::async, [&, i]() {
+          auto &window = windows[i];
+          IndexedSinkType sink = [&window](std::size_t symbolIndex, const Symbol &symbol,
+                                           const dxf_time_and_sale_t &tns) {
+            auto time = static_cast<std::int64_t>(tns.time);
+
+            if (time < window.start || time >= window.end) {
+              return;
+            }
+
+            if (symbolIndex != UNKNOWN_SYMBOL) {
+              window.events[symbolIndex].emplace_back(symbol, tns);
             } else {
-              implPtr->events_[symbol] = {timeAndSale};
+              window.unknownEvents[symbol].emplace_back(symbol, tns);
+            }
+          };
+
+          return receive(address, symbols, sink, timeout, pool, completion, nullptr, window.start, i);
+        }));
+      }
+
+      for (auto &r : receives) {
+        r.wait();
+      }
+
+      ResultType events{};
+
+      for (auto &window : windows) {
+        for (std::size_t i = 0; i < symbols.size(); i++) {
+          if (!window.events[i].empty()) {
+            auto &symbolEvents = events[Symbol::valueOf(symbols[i])];
+
+            std::move(window.events[i].begin(), window.events[i].end(), std::back_inserter(symbolEvents));
+          }
+        }
+
+        for (auto &[symbol, symbolEvents] : window.unknownEvents) {
+          std::move(symbolEvents.begin(), symbolEvents.end(), std::back_inserter(events[symbol]));
+        }
+      }
+
+      for (auto &[symbol, symbolEvents] : events) {
+        mergeEvents(symbolEvents);
+      }
+
+      return events;
+    });
+  }
+
+  // The streaming mode: passes every event to the sink as it arrives instead of collecting the events, so the memory
+  // doesn't grow with the history and the processing overlaps with the download. The sink is called on the connection
+  // thread, one event at a time; a slow sink slows down the reading. The future is ready after the disconnect or the
+  // timeout (ms, 0 - no timeout) and returns false if the connection or the subscription can't be created. pool,
+  // completion, filter - see run.
+  static std::future<bool> runStreaming(const std::string &address, const std::vector<std::string> &symbols,
+                                        SinkType sink, int timeout = 0, ConnectionPool *pool = nullptr,
+                                        std::optional<HistoryCompletion> completion = std::nullopt,
+                                        FilterType filter = {}) {
+    return std::async(std::launch::async, [address, symbols, sink = std::move(sink), timeout, pool,
+                                           completion = std::move(completion), filter = std::move(filter)]() {
+      return receive(
+        address, symbols,
+        [&sink](std::size_t, const Symbol &symbol, const dxf_time_and_sale_t &tns) {
+          sink(TimeAndSale(symbol, tns));
+        },
+        timeout, pool, completion, nullptr, 0, 0, filter);
+    });
+  }
+
+  // The streaming mode without the conversion: passes the view of every C API event to the sink (see TimeAndSaleView).
+  // The view is valid only during the sink call; the fields are converted on access and the view can be converted to
+  // the TimeAndSale (toTimeAndSale) if the event is kept. The other arguments are the same as the runStreaming ones.
+  static std::future<bool> runStreamingViews(const std::string &address, const std::vector<std::string> &symbols,
+                                             ViewSinkType sink, int timeout = 0, ConnectionPool *pool = nullptr,
+                                             std::optional<HistoryCompletion> completion = std::nullopt,
+                                             FilterType filter = {}) {
+    return std::async(std::launch::async, [address, symbols, sink = std::move(sink), timeout, pool,
+                                           completion = std::move(completion), filter = std::move(filter)]() {
+      return receive(
+        address, symbols,
+        [&sink](std::size_t, const Symbol &symbol, const dxf_time_and_sale_t &tns) {
+          sink(TimeAndSaleView(symbol, tns));
+        },
+        timeout, pool, completion, nullptr, 0, 0, filter);
+    });
+  }
+
+  // The streaming mode of the projections (see runProjected): passes the projections of the events of every listener
+  // call to the sink at once. The span is valid only during the sink call (the buffer is reused by the next call). The
+  // other arguments are the same as the runStreaming ones.
+  template <ProjectedFrom<dxf_time_and_sale_t> Event>
+  static std::future<bool> runStreamingProjected(
+    const std::string &address, const std::vector<std::string> &symbols,
+    std::function<void(const Symbol &, std::span<const Event>)> sink, int timeout = 0, ConnectionPool *pool = nullptr,
+    std::optional<HistoryCompletion> completion = std::nullopt, FilterType filter = {}) {
+    return std::async(std::launch::async, [address, symbols, sink = std::move(sink), timeout, pool,
+                                           completion = std::move(completion), filter = std::move(filter)]() {
+      std::vector<Event> buffer{};
+
+      return receiveBatches(
+        address, symbols,
+        [&sink, &buffer](std::size_t, const Symbol &symbol, const dxf_time_and_sale_t *tnss, std::size_t count) {
+          buffer.resize(count);
+          Event::Projection::to(tnss, count, buffer.data());
+          sink(symbol, std::span<const Event>{buffer.data(), count});
+        },
+        timeout, pool, completion, filter);
+    });
+  }
+
+  // The same as runStreaming, but no thread waits for the events (see run with the executor). The sink is called on
+  // the connection thread, the future is ready after the subscription is closed.
+  static std::future<bool> runStreaming(Executor &executor, const std::string &address,
+                                        const std::vector<std::string> &symbols, SinkType sink, int timeout = 0,
+                                        ConnectionPool *pool = nullptr,
+                                        std::optional<HistoryCompletion> completion = std::nullopt,
+                                        FilterType filter = {}) {
+    auto result = std::make_shared<std::promise<bool>>();
+    auto future = result->get_future();
+
+    receiveBatchesAsync(
+      executor, address, symbols,
+      [sink = std::move(sink)](std::size_t, const Symbol &symbol, const dxf_time_and_sale_t *tnss, std::size_t count) {
+        for (std::size_t i = 0; i < count; i++) {
+          sink(TimeAndSale(symbol, tnss[i]));
+        }
+      },
+      timeout, pool, std::move(completion), [result](bool isReceived) { result->set_value(isReceived); },
+      std::move(filter));
+
+    return future;
+  }
+
+  // The same as runStreamingViews, but no thread waits for the events (see run with the executor)
+  static std::future<bool> runStreamingViews(Executor &executor, const std::string &address,
+                                             const std::vector<std::string> &symbols, ViewSinkType sink,
+                                             int timeout = 0, ConnectionPool *pool = nullptr,
+                                             std::optional<HistoryCompletion> completion = std::nullopt,
+                                             FilterType filter = {}) {
+    auto result = std::make_shared<std::promise<bool>>();
+    auto future = result->get_future();
+
+    receiveBatchesAsync(
+      executor, address, symbols,
+      [sink = std::move(sink)](std::size_t, const Symbol &symbol, const dxf_time_and_sale_t *tnss, std::size_t count) {
+        for (std::size_t i = 0; i < count; i++) {
+          sink(TimeAndSaleView(symbol, tnss[i]));
+        }
+      },
+      timeout, pool, std::move(completion), [result](bool isReceived) { result->set_value(isReceived); },
+      std::move(filter));
+
+    return future;
+  }
+
+  // The streaming mode of the groups: the events of all symbols that arrive while the previous group is processed are
+  // passed to the sink by one call (the symbol indexes are parallel to the events, see GroupSinkType), so the sink of
+  // many symbols isn't called per symbol. The connection thread only converts and appends the events; the sink is
+  // called on the executor, one group at a time and in the arrival order, and the buffers of the groups are reused.
+  // The future is ready after the last group is passed. The other arguments are the same as the runStreaming ones.
+  static std::future<bool> runStreamingGroups(Executor &executor, const std::string &address,
+                                              const std::vector<std::string> &symbols, GroupSinkType sink,
+                                              int timeout = 0, ConnectionPool *pool = nullptr,
+                                              std::optional<HistoryCompletion> completion = std::nullopt) {
+    struct Grouping {
+      Executor *executor = nullptr;
+      GroupSinkType sink{};
+      std::promise<bool> result{};
+      std::mutex mutex{};
+      // The group being collected (under the mutex)
+      std::vector<std::size_t> symbolIndexes{};
+      std::vector<TimeAndSale> events{};
+      // The delivery task is posted or running
+      bool isDelivering = false;
+      std::optional<bool> isReceived{};
+
+      // Passes the groups until there are no events, the only delivery task runs at a time
+      void deliver() {
+        std::vector<std::size_t> groupSymbolIndexes{};
+        std::vector<TimeAndSale> groupEvents{};
+
+        while (true) {
+          {
+            std::lock_guard guard(mutex);
+
+            groupSymbolIndexes.clear();
+            groupEvents.clear();
+            std::swap(groupSymbolIndexes, symbolIndexes);
+            std::swap(groupEvents, events);
+
+            if (groupEvents.empty()) {
+              isDelivering = false;
+
+              if (isReceived) {
+                result.set_value(*isReceived);
+              }
+
+              return;
+            }
+          }
+
+          sink(groupSymbolIndexes, groupEvents);
+        }
+      }
+    };
+
+    auto grouping = std::make_shared<Grouping>();
+    auto future = grouping->result.get_future();
+
+    grouping->executor = &executor;
+    grouping->sink = std::move(sink);
+
+    receiveBatchesAsync(
+      executor, address, symbols,
+      [grouping](std::size_t symbolIndex, const Symbol &symbol, const dxf_time_and_sale_t *tnss, std::size_t count) {
+        std::lock_guard guard(grouping->mutex);
+
+        for (std::size_t i = 0; i < count; i++) {
+          grouping->symbolIndexes.push_back(symbolIndex);
+          grouping->events.emplace_back(symbol, tnss[i]);
+        }
+
+        if (!grouping->isDelivering) {
+          grouping->isDelivering = true;
+          grouping->executor->post([grouping] { grouping->deliver(); });
+        }
+      },
+      timeout, pool, std::move(completion), [grouping](bool isReceived) {
+        std::lock_guard guard(grouping->mutex);
+
+        // The subscription is closed, the last group is passed by the running delivery
+        grouping->isReceived = isReceived;
+
+        if (!grouping->isDelivering) {
+          grouping->result.set_value(isReceived);
+        }
+      });
+
+    return future;
+  }
+
+  // Collects all events of the symbols to the columns (see TimeAndSaleColumns) without creating the TimeAndSale
+  // objects, the arrays of the listener are converted at once (see TimeAndSaleBatchConverter). The arguments are the
+  // same as the run ones.
+  static ColumnsResultFutureType runColumnar(const std::string &address, const std::vector<std::string> &symbols,
+                                             int timeout = 0, ConnectionPool *pool = nullptr,
+                                             std::optional<HistoryCompletion> completion = std::nullopt,
+                                             FilterType filter = {}) {
+    return std::async(std::launch::async, [address, symbols, timeout, pool, completion = std::move(completion),
+                                           filter = std::move(filter)]() {
+      struct Slot {
+        std::mutex mutex{};
+        TimeAndSaleColumns columns{};
+      };
+
+      std::vector<Slot> slots(symbols.size());
+      std::mutex unknownEventsMutex{};
+      ColumnsResultType result{};
+
+      receiveBatches(
+        address, symbols,
+        [&slots, &unknownEventsMutex, &result](std::size_t symbolIndex,
+                                               const Symbol &symbol,
+                                               const dxf_time_and_sale_t *tns, std::size_t count) {
+          if (symbolIndex != UNKNOWN_SYMBOL) {
+            std::lock_guard guard(slots[symbolIndex].mutex);
+
+            slots[symbolIndex].columns.append(tns, count);
+          } else {
+            std::lock_guard guard(unknownEventsMutex);
+
+            result[symbol].append(tns, count);
+          }
+        },
+        timeout, pool, completion, filter);
+
+      for (std::size_t i = 0; i < symbols.size(); i++) {
+        if (!slots[i].columns.isEmpty() && result.find(symbols[i]) == result.end()) {
+          result.emplace(Symbol::valueOf(symbols[i]), std::move(slots[i].columns));
+        }
+      }
+
+      return result;
+    });
+  }
+
+  // Collects all events of the symbols with the bounded memory: when the buffered events take more than memoryBudget
+  // bytes, the largest per-symbol buffers are appended to the spill file (spillPath, empty - the temporary file) and
+  // the history reads them back from the memory-mapped file on access (see TimeAndSaleHistory). The file is removed
+  // when the last history is destroyed. If the file can't be written, the events are kept in memory. The other
+  // arguments are the same as the run ones.
+  static HistoryResultFutureType runSpilled(const std::string &address, const std::vector<std::string> &symbols,
+                                            std::size_t memoryBudget, std::string spillPath = {}, int timeout = 0,
+                                            ConnectionPool *pool = nullptr,
+                                            std::optional<HistoryCompletion> completion = std::nullopt) {
+    return std::async(std::launch::async, [address, symbols, memoryBudget, spillPath = std::move(spillPath), timeout,
+                                           pool, completion = std::move(completion)]() {
+      // The budget is shared by all symbols, so the buffers are guarded by one mutex
+      std::mutex mutex{};
+      TimeAndSaleSpillWriter writer{memoryBudget, spillPath};
+      SymbolMap<std::size_t> unknownBuffers{};
+
+      for (const auto &symbol : symbols) {
+        writer.addBuffer(Symbol::valueOf(symbol).getSharedName());
+      }
+
+      receive(
+        address, symbols,
+        [&mutex, &writer, &unknownBuffers](std::size_t symbolIndex, const Symbol &symbol,
+                                           const dxf_time_and_sale_t &tns) {
+          std::lock_guard guard(mutex);
+
+          if (symbolIndex == UNKNOWN_SYMBOL) {
+            auto found = unknownBuffers.find(symbol);
+
+            symbolIndex = found != unknownBuffers.end() ? found->second
+                                                        : unknownBuffers.emplace(symbol, writer.addBuffer(symbol.getSharedName()))
+                                                            .first->second;
+          }
+
+          writer.append(symbolIndex, tns);
+        },
+        timeout, pool, completion);
+
+      HistoryResultType result{};
+
+      for (auto &history : writer.finish()) {
+        if (!history.isEmpty() || !history.isComplete()) {
+          auto symbol = Symbol::valueOf(*history.getSymbol());
+
+          result.emplace(symbol, std::move(history));
+        }
+      }
+
+      return result;
+    });
+  }
+
+  // Writes the events of every symbol to the tape file in the directory (see TimeAndSaleTape, the file name is
+  // TimeAndSaleTape::getFileName), the directory is created if it doesn't exist. The events are written as they arrive,
+  // so the memory doesn't grow with the history. tickSize - the tick size of the prices (0 - unknown). Returns the paths
+  // of the complete tapes; the symbols without the events or whose files can't be written are not in the result. The
+  // other arguments are the same as the run ones.
+  static TapeResultFutureType runTape(const std::string &address, const std::vector<std::string> &symbols,
+                                      std::string directory, double tickSize = 0.0, int timeout = 0,
+                                      ConnectionPool *pool = nullptr,
+                                      std::optional<HistoryCompletion> completion = std::nullopt) {
+    return std::async(std::launch::async, [address, symbols, directory = std::move(directory), tickSize, timeout, pool,
+                                           completion = std::move(completion)]() {
+      struct Tape {
+        std::string path{};
+        std::unique_ptr<TimeAndSaleTapeWriter> writer{};
+        bool isFailed = false;
+
+        void append(const std::string &symbol, const std::string &directory, double tickSize,
+                    const dxf_time_and_sale_t *tns, std::size_t count) {
+          if (isFailed) {
+            return;
+          }
+
+          if (!writer) {
+            path = (std::filesystem::path(directory) / TimeAndSaleTape::getFileName(symbol)).string();
+            writer = TimeAndSaleTapeWriter::open(path, symbol, tickSize);
+
+            if (!writer) {
+              isFailed = true;
+
+              return;
             }
           }
+
+          writer->append(tns, count);
+        }
+      };
+
+      struct Slot {
+        std::mutex mutex{};
+        Tape tape{};
+      };
+
+      std::error_code ec{};
+
+      std::filesystem::create_directories(directory, ec);
+
+      std::vector<Slot> slots(symbols.size());
+      std::mutex unknownTapesMutex{};
+      SymbolMap<Tape> unknownTapes{};
+
+      receiveBatches(
+        address, symbols,
+        [&slots, &unknownTapesMutex, &unknownTapes, &directory, tickSize](
+          std::size_t symbolIndex, const Symbol &symbol, const dxf_time_and_sale_t *tns,
+          std::size_t count) {
+          if (symbolIndex != UNKNOWN_SYMBOL) {
+            std::lock_guard guard(slots[symbolIndex].mutex);
+
+            slots[symbolIndex].tape.append(symbol.getName(), directory, tickSize, tns, count);
+          } else {
+            std::lock_guard guard(unknownTapesMutex);
+
+            unknownTapes[symbol].append(symbol.getName(), directory, tickSize, tns, count);
+          }
         },
-        static_cast<void *>(&impl));
+        timeout, pool, completion);
+
+      TapeResultType result{};
+      auto finish = [&result](const Symbol &symbol, Tape &tape) {
+        if (tape.writer && tape.writer->finish() && result.find(symbol) == result.end()) {
+          result.emplace(symbol, tape.path);
+        }
+      };
+
+      for (std::size_t i = 0; i < symbols.size(); i++) {
+        finish(Symbol::valueOf(symbols[i]), slots[i].tape);
+      }
+
+      for (auto &[symbol, tape] : unknownTapes) {
+        finish(symbol, tape);
+      }
+
+      return result;
+    });
+  }
+
+  // Fetches the history of the symbols from the fromTime through the on-disk cache (see TimeAndSaleCache): the cached
+  // history of the symbol is read from its segments, and only the tail after the last cached event is fetched (from
+  // the time of that event, so the later events of the same millisecond are not lost). The fetched tail is written to
+  // the new segment of the symbol as it arrives and is kept when the symbol is caught up (its snapshot is delivered);
+  // the symbols without the cached history are fetched from the fromTime. The tails of the different times are fetched
+  // in parallel, the events of the symbols that are not requested are not cached. Returns the events in the time range
+  // [fromTime, toTime), merged by the index and the time without the duplicates. The cache must outlive the run. The
+  // other arguments are the same as the run ones.
+  static ResultFutureType runCached(const std::string &address, const std::vector<std::string> &symbols,
+                                    const TimeAndSaleCache &cache, std::int64_t fromTime = 0,
+                                    std::int64_t toTime = (std::numeric_limits<std::int64_t>::max)(), int timeout = 0,
+                                    ConnectionPool *pool = nullptr) {
+    return std::async(std::launch::async, [address, symbols, &cache, fromTime, toTime, timeout, pool]() {
+      struct Slot {
+        std::vector<TimeAndSale> events{};
+        // The new segment (the temporary file until the symbol is caught up)
+        std::unique_ptr<TimeAndSaleTapeWriter> writer{};
+        bool isFailed = false;
+        bool isCompleted = false;
+      };
+
+      ResultType events{};
+      std::vector<Slot> slots(symbols.size());
+      // The positions of the (unique) symbols by the time their tails start from
+      std::map<std::int64_t, std::vector<std::size_t>> fetches{};
+      std::unordered_set<std::string_view> uniqueSymbols{};
+
+      for (std::size_t i = 0; i < symbols.size(); i++) {
+        if (!uniqueSymbols.insert(symbols[i]).second) {
+          continue;
+        }
 
-      std::vector<std::wstring> wSymbols(symbols.size());
-      std::transform(symbols.begin(), symbols.end(), wSymbols.begin(),
-                     [](auto s) { return StringConverter::utf8ToWString(s); });
+        auto symbol = Symbol::valueOf(symbols[i]);
+        auto chain = TimeAndSaleCache::getChain(cache.getSegments(symbols[i]), fromTime);
+        auto startTime = fromTime;
 
-      for (const auto &ws : wSymbols) {
-        res = dxf_add_symbol(sub, ws.c_str());
+        // The symbol of the unreadable segment is fetched again from the fromTime
+        if (!chain.empty() && TimeAndSaleCache::read(chain, symbol, fromTime, toTime, events[symbol])) {
+          startTime = chain.back().lastEventTime;
+        }
 
-        if (res == DXF_FAILURE) {
-          return impl.events_;
+        if (startTime < toTime) {
+          fetches[startTime].push_back(i);
         }
       }
 
-      {
-        std::unique_lock lk(impl.cvMutex_);
-        if (timeout == 0) {
-          impl.cv_.wait(lk, [&impl] {
-            bool disconnected = impl.disconnected_;
+      auto fetchTail = [&](std::int64_t startTime, const std::vector<std::size_t> &symbolIndexes) {
+        std::vector<std::string> tailSymbols{};
+        std::unordered_map<std::string, std::size_t> positions{};
 
-            return disconnected;
-          });
-        } else {
-          impl.cv_.wait_for(lk, std::chrono::milliseconds(timeout), [&impl] {
-            bool disconnected = impl.disconnected_;
+        for (auto i : symbolIndexes) {
+          tailSymbols.push_back(symbols[i]);
+          positions.emplace(symbols[i], i);
+        }
 
-            return disconnected;
-          });
+        // The sink and the completion are called by the connection thread of the fetch only
+        std::optional<HistoryCompletion> completion{HistoryCompletion{
+          std::chrono::milliseconds(0),
+          [&slots, &positions](const std::string &symbol) { slots[positions.at(symbol)].isCompleted = true; }}};
+        IndexedSinkType sink = [&](std::size_t symbolIndex, const Symbol &symbol, const dxf_time_and_sale_t &tns) {
+          auto time = static_cast<std::int64_t>(tns.time);
+
+          if (symbolIndex == UNKNOWN_SYMBOL || time < startTime) {
+            return;
+          }
+
+          auto &slot = slots[symbolIndexes[symbolIndex]];
+
+          if (!slot.writer && !slot.isFailed) {
+            slot.writer = TimeAndSaleTapeWriter::open(cache.getTemporaryPath(symbol.getName(), startTime),
+                                                      symbol.getName());
+            slot.isFailed = !slot.writer;
+          }
+
+          if (slot.writer) {
+            slot.writer->append(tns);
+          }
+
+          if (time < toTime) {
+            slot.events.emplace_back(symbol, tns);
+          }
+        };
+
+        receive(address, tailSymbols, sink, timeout, pool, completion, nullptr, startTime);
+
+        for (auto i : symbolIndexes) {
+          auto &slot = slots[i];
+
+          if (!slot.writer) {
+            continue;
+          }
+
+          auto isWritten = slot.writer->finish();
+
+          slot.writer.reset();
+
+          if (isWritten && slot.isCompleted) {
+            cache.commitSegment(symbols[i], startTime);
+          } else {
+            cache.discardSegment(symbols[i], startTime);
+          }
+        }
+      };
+
+      std::vector<std::future<void>> tails{};
+
+      for (const auto &[startTime, symbolIndexes] : fetches) {
+        tails.push_back(std::async(std::launch::async, fetchTail, startTime, std::cref(symbolIndexes)));
+      }
+
+      for (auto &tail : tails) {
+        tail.wait();
+      }
+
+      for (std::size_t i = 0; i < symbols.size(); i++) {
+        if (!slots[i].events.empty()) {
+          auto &symbolEvents = events[Symbol::valueOf(symbols[i])];
+
+          std::move(slots[i].events.begin(), slots[i].events.end(), std::back_inserter(symbolEvents));
         }
       }
 
-      dxf_close_subscription(sub);
-      dxf_close_connection(con);
+      for (auto &[symbol, symbolEvents] : events) {
+        mergeEvents(symbolEvents);
+      }
+
+      std::erase_if(events, [](const auto &entry) { return entry.second.empty(); });
 
-      return impl.events_;
+      return events;
     });
   }
 };
 
-}
\ No newline at end of file
+}  // namespace dxf
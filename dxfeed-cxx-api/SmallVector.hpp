@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace dxf {
+
+// The vector that keeps up to InlineCapacity elements in place (the short lists such as the handlers of one connection
+// or the leases of one stop signal), so the object that holds it doesn't allocate until the list grows. The longer
+// lists are kept on the heap, the capacity grows twice (or to the size of the bulk append at once).
+template <typename T, std::size_t InlineCapacity>
+class SmallVector final {
+  static_assert(InlineCapacity > 0, "The inline capacity must be positive");
+
+  alignas(T) std::byte inline_[InlineCapacity * sizeof(T)];
+  T* data_;
+  std::size_t size_ = 0;
+  std::size_t capacity_ = InlineCapacity;
+
+  T* getInlineData() { return std::launder(reinterpret_cast<T*>(inline_)); }
+
+  [[nodiscard]] bool isInline() const { return data_ == reinterpret_cast<const T*>(inline_); }
+
+  // Moves the elements to the heap block of the capacity
+  void reallocate(std::size_t capacity) {
+    auto data = std::allocator<T>{}.allocate(capacity);
+
+    std::uninitialized_move(data_, data_ + size_, data);
+    std::destroy(data_, data_ + size_);
+    deallocate();
+    data_ = data;
+    capacity_ = capacity;
+  }
+
+  void deallocate() {
+    if (!isInline()) {
+      std::allocator<T>{}.deallocate(data_, capacity_);
+    }
+  }
+
+  void grow(std::size_t size) {
+    if (size > capacity_) {
+      reallocate((std::max)(size, capacity_ * 2));
+    }
+  }
+
+  // Takes the elements of the other vector (the heap block is taken as is)
+  void take(SmallVector& other) {
+    if (other.isInline()) {
+      std::uninitialized_move(other.data_, other.data_ + other.size_, data_);
+      std::destroy(other.data_, other.data_ + other.size_);
+    } else {
+      data_ = other.data_;
+      capacity_ = other.capacity_;
+      other.data_ = other.getInlineData();
+      other.capacity_ = InlineCapacity;
+    }
+
+    size_ = other.size_;
+    other.size_ = 0;
+  }
+
+ public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  SmallVector() : data_{getInlineData()} {}
+
+  SmallVector(std::initializer_list<T> values) : SmallVector() { append(values.begin(), values.end()); }
+
+  SmallVector(const SmallVector& other) : SmallVector() { append(other.begin(), other.end()); }
+
+  SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) : SmallVector() { take(other); }
+
+  SmallVector& operator=(const SmallVector& other) {
+    if (this != &other) {
+      clear();
+      append(other.begin(), other.end());
+    }
+
+    return *this;
+  }
+
+  SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (this != &other) {
+      clear();
+      deallocate();
+      data_ = getInlineData();
+      capacity_ = InlineCapacity;
+      take(other);
+    }
+
+    return *this;
+  }
+
+  ~SmallVector() {
+    clear();
+    deallocate();
+  }
+
+  // The capacity hint of the bulk additions
+  void reserve(std::size_t capacity) {
+    if (capacity > capacity_) {
+      reallocate(capacity);
+    }
+  }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    if (size_ == capacity_) {
+      // The argument may refer to the element, so it's constructed before the elements are moved
+      T value(std::forward<Args>(args)...);
+
+      grow(size_ + 1);
+
+      return *std::construct_at(data_ + size_++, std::move(value));
+    }
+
+    return *std::construct_at(data_ + size_++, std::forward<Args>(args)...);
+  }
+
+  void push_back(const T& value) { emplace_back(value); }
+
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+
+  // Appends the range at once (one growth of the capacity)
+  template <typename It>
+  void append(It first, It last) {
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>) {
+      grow(size_ + static_cast<std::size_t>(std::distance(first, last)));
+    }
+
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  void pop_back() { std::destroy_at(data_ + --size_); }
+
+  iterator erase(const_iterator position) {
+    auto result = data_ + (position - data_);
+
+    std::move(result + 1, end(), result);
+    pop_back();
+
+    return result;
+  }
+
+  // Removes the elements that satisfy the predicate. Returns the number of the removed elements.
+  template <typename Predicate>
+  std::size_t eraseIf(Predicate predicate) {
+    auto newEnd = std::remove_if(begin(), end(), predicate);
+    auto removedNumber = static_cast<std::size_t>(end() - newEnd);
+
+    std::destroy(newEnd, end());
+    size_ -= removedNumber;
+
+    return removedNumber;
+  }
+
+  // Keeps the capacity
+  void clear() {
+    std::destroy(data_, data_ + size_);
+    size_ = 0;
+  }
+
+  void swap(SmallVector& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    SmallVector temp{std::move(other)};
+
+    other = std::move(*this);
+    *this = std::move(temp);
+  }
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+
+  [[nodiscard]] bool empty() const { return size_ == 0; }
+
+  [[nodiscard]] std::size_t capacity() const { return capacity_; }
+
+  // The elements are kept in place (no heap block is allocated)
+  [[nodiscard]] bool isInlined() const { return isInline(); }
+
+  T* data() { return data_; }
+
+  const T* data() const { return data_; }
+
+  T& operator[](std::size_t i) { return data_[i]; }
+
+  const T& operator[](std::size_t i) const { return data_[i]; }
+
+  T& back() { return data_[size_ - 1]; }
+
+  iterator begin() { return data_; }
+
+  iterator end() { return data_ + size_; }
+
+  const_iterator begin() const { return data_; }
+
+  const_iterator end() const { return data_ + size_; }
+};
+
+}  // namespace dxf
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace dxf {
+
+// The compact binary capture of the order snapshot data chunks (the snapshot listener calls).
+//
+// Format (native byte order):
+//   header: "PLBC" (4 bytes), version (uint32)
+//   chunk:  new snapshot (uint8), records count (uint32), records
+//   record: index (int64), time (int64), price (double), size (double), event flags (uint32), side (uint8)
+//
+// Only the fields that are used by the PriceLevelBook are captured.
+struct SnapshotDataCapture {
+  static constexpr char MAGIC[4] = {'P', 'L', 'B', 'C'};
+  static constexpr std::uint32_t VERSION = 1;
+};
+
+class SnapshotDataWriter final {
+  std::FILE* file_;
+  std::vector<unsigned char> buffer_{};
+
+  template <typename T>
+  void put(T value) {
+    auto position = buffer_.size();
+
+    buffer_.resize(position + sizeof(T));
+    std::memcpy(buffer_.data() + position, &value, sizeof(T));
+  }
+
+ public:
+  // The file is owned by the caller
+  explicit SnapshotDataWriter(std::FILE* file) : file_{file} {
+    std::fwrite(SnapshotDataCapture::MAGIC, 1, sizeof(SnapshotDataCapture::MAGIC), file_);
+    std::fwrite(&SnapshotDataCapture::VERSION, sizeof(SnapshotDataCapture::VERSION), 1, file_);
+  }
+
+  // Returns false if the chunk can't be written
+  bool write(const dxf_snapshot_data_ptr_t snapshotData, int newSnapshot) {
+    auto orders = snapshotData->event_type == dx_eid_order ? reinterpret_cast<const dxf_order_t*>(snapshotData->records)
+                                                           : nullptr;
+    auto recordsCount = orders != nullptr ? static_cast<std::uint32_t>(snapshotData->records_count) : 0U;
+
+    buffer_.clear();
+    put(static_cast<std::uint8_t>(newSnapshot != 0));
+    put(recordsCount);
+
+    for (std::uint32_t i = 0; i < recordsCount; i++) {
+      put(static_cast<std::int64_t>(orders[i].index));
+      put(static_cast<std::int64_t>(orders[i].time));
+      put(orders[i].price);
+      put(orders[i].size);
+      put(static_cast<std::uint32_t>(orders[i].event_flags));
+      put(static_cast<std::uint8_t>(orders[i].side));
+    }
+
+    return std::fwrite(buffer_.data(), 1, buffer_.size(), file_) == buffer_.size();
+  }
+};
+
+class SnapshotDataReader final {
+  std::FILE* file_;
+  bool isValid_;
+
+  template <typename T>
+  bool get(T& value) {
+    return std::fread(&value, sizeof(T), 1, file_) == 1;
+  }
+
+ public:
+  // The file is owned by the caller
+  explicit SnapshotDataReader(std::FILE* file) : file_{file}, isValid_{false} {
+    char magic[sizeof(SnapshotDataCapture::MAGIC)]{};
+    std::uint32_t version = 0;
+
+    isValid_ = std::fread(magic, 1, sizeof(magic), file_) == sizeof(magic) &&
+               std::memcmp(magic, SnapshotDataCapture::MAGIC, sizeof(magic)) == 0 && get(version) &&
+               version == SnapshotDataCapture::VERSION;
+  }
+
+  // Returns false if the file is not a capture of the supported version
+  [[nodiscard]] bool isValid() const { return isValid_; }
+
+  // Reads the next chunk. Returns false at the end of the file (or if the chunk is truncated)
+  bool read(std::vector<dxf_order_t>& orders, bool& newSnapshot) {
+    std::uint8_t newSnapshotFlag = 0;
+    std::uint32_t recordsCount = 0;
+
+    if (!isValid_ || !get(newSnapshotFlag) || !get(recordsCount)) {
+      return false;
+    }
+
+    newSnapshot = newSnapshotFlag != 0;
+    orders.assign(recordsCount, dxf_order_t{});
+
+    for (auto& order : orders) {
+      std::int64_t index = 0;
+      std::int64_t time = 0;
+      std::uint32_t eventFlags = 0;
+      std::uint8_t side = 0;
+
+      if (!get(index) || !get(time) || !get(order.price) || !get(order.size) || !get(eventFlags) || !get(side)) {
+        return false;
+      }
+
+      order.index = index;
+      order.time = time;
+      order.event_flags = eventFlags;
+      order.side = static_cast<dxf_order_side_t>(side);
+    }
+
+    return true;
+  }
+};
+
+// The columnar history of the book: the captured order records of all chunks (see SnapshotDataReader) with the number
+// of the chunk and its new snapshot flag, e.g. for the export to Arrow (see ArrowBatch::fromColumns)
+struct SnapshotDataColumns {
+  std::vector<std::uint32_t> chunk{};
+  // 1 - the record is in the chunk of the new snapshot
+  std::vector<std::uint8_t> newSnapshot{};
+  std::vector<std::int64_t> index{};
+  std::vector<std::int64_t> time{};
+  std::vector<double> price{};
+  std::vector<double> size{};
+  std::vector<std::uint32_t> eventFlags{};
+  std::vector<std::int32_t> side{};
+  std::uint32_t chunksNumber = 0;
+
+  [[nodiscard]] std::size_t getSize() const { return index.size(); }
+
+  void append(const std::vector<dxf_order_t>& orders, bool isNewSnapshot) {
+    for (const auto& order : orders) {
+      chunk.push_back(chunksNumber);
+      newSnapshot.push_back(isNewSnapshot ? 1 : 0);
+      index.push_back(static_cast<std::int64_t>(order.index));
+      time.push_back(static_cast<std::int64_t>(order.time));
+      price.push_back(order.price);
+      size.push_back(order.size);
+      eventFlags.push_back(static_cast<std::uint32_t>(order.event_flags));
+      side.push_back(static_cast<std::int32_t>(order.side));
+    }
+
+    chunksNumber++;
+  }
+
+  // Reads the rest chunks of the capture
+  static SnapshotDataColumns read(SnapshotDataReader& reader) {
+    SnapshotDataColumns result{};
+    std::vector<dxf_order_t> orders{};
+    bool isNewSnapshot = false;
+
+    while (reader.read(orders, isNewSnapshot)) {
+      result.append(orders, isNewSnapshot);
+    }
+
+    return result;
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "LargePages.hpp"
+#include "WaitStrategy.hpp"
+
+namespace dxf {
+
+// The bounded lock-free single-producer single-consumer ring of the preallocated slots. The slots are filled and read
+// in place, so the slot contents (e.g. vectors) keep their capacity between the uses.
+//
+// Producer:
+//   auto slot = ring.acquire();   // blocks while the ring is full
+//   fill(*slot);
+//   ring.publish();
+//
+// Consumer:
+//   auto& slot = ring.front();    // blocks while the ring is empty
+//   process(slot);
+//   ring.pop();
+template <typename T>
+class SpscRing final {
+  static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+  // The large rings are the large page buffers (see LargePages)
+  std::vector<T, LargePageAllocator<T>> slots_;
+  std::size_t mask_;
+
+  // The number of the read slots. Written by the consumer only.
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> head_{};
+  // The number of the published slots. Written by the producer only.
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> tail_{};
+  // The number of the times the producer has found the ring full.
+  alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> overflowsNumber_{};
+
+ public:
+  // capacity - the number of the slots (rounded up to the power of 2)
+  explicit SpscRing(std::size_t capacity)
+      : slots_(std::bit_ceil((std::max)(capacity, std::size_t{2}))), mask_{slots_.size() - 1} {}
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  [[nodiscard]] std::size_t capacity() const { return slots_.size(); }
+
+  // Producer. Returns the next free slot. If the ring is full, counts the overflow and waits for the consumer.
+  T* acquire() {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    auto head = head_.load(std::memory_order_acquire);
+
+    if (tail - head == slots_.size()) {
+      overflowsNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      do {
+        head_.wait(head, std::memory_order_acquire);
+        head = head_.load(std::memory_order_acquire);
+      } while (tail - head == slots_.size());
+    }
+
+    return &slots_[tail & mask_];
+  }
+
+  // Producer. Returns the next free slot or nullptr if the ring is full (the overflow is not counted).
+  T* tryAcquire() {
+    auto tail = tail_.load(std::memory_order_relaxed);
+
+    if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+      return nullptr;
+    }
+
+    return &slots_[tail & mask_];
+  }
+
+  // Producer. Makes the slot returned by the acquire() or tryAcquire() visible to the consumer.
+  void publish() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    tail_.notify_one();
+  }
+
+  // Consumer. Returns the oldest published slot. Waits if the ring is empty.
+  T& front() {
+    auto head = head_.load(std::memory_order_relaxed);
+
+    tail_.wait(head, std::memory_order_acquire);
+
+    return slots_[head & mask_];
+  }
+
+  // Consumer. Returns the oldest published slot. Busy-polls the empty ring for the spin time, then waits.
+  T& front(std::chrono::nanoseconds spin) {
+    auto head = head_.load(std::memory_order_relaxed);
+
+    spinUntil(spin, [this, head] { return tail_.load(std::memory_order_acquire) != head; });
+
+    return front();
+  }
+
+  // Consumer. Returns the oldest published slot. Waits for the empty ring by the strategy (the spin, the yield, the
+  // park).
+  T& front(WaitStrategy& strategy) {
+    auto head = head_.load(std::memory_order_relaxed);
+
+    strategy.wait([this, head] { return tail_.load(std::memory_order_acquire) != head; },
+                  [this, head] { tail_.wait(head, std::memory_order_acquire); });
+
+    return slots_[head & mask_];
+  }
+
+  // Consumer. Returns the oldest published slot or nullptr if the ring is empty.
+  T* tryFront() {
+    auto head = head_.load(std::memory_order_relaxed);
+
+    if (tail_.load(std::memory_order_acquire) == head) {
+      return nullptr;
+    }
+
+    return &slots_[head & mask_];
+  }
+
+  // Consumer. Releases the slot returned by the front() or tryFront().
+  void pop() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    head_.notify_one();
+  }
+
+  // The number of the published slots that are not popped yet (the head is read first, so it's never ahead of the tail)
+  [[nodiscard]] std::size_t size() const {
+    auto head = head_.load(std::memory_order_acquire);
+
+    return static_cast<std::size_t>(tail_.load(std::memory_order_acquire) - head);
+  }
+
+  [[nodiscard]] std::uint64_t getOverflowsNumber() const { return overflowsNumber_.load(std::memory_order_relaxed); }
+};
+
+// Wakes the consumer that serves several rings. The producers call notify() after the publish().
+//
+// Consumer:
+//   auto seen = signal.get();
+//   if (!pollAllRings()) signal.wait(seen);
+class WorkSignal final {
+  std::atomic<std::uint64_t> counter_{};
+
+ public:
+  [[nodiscard]] std::uint64_t get() const { return counter_.load(std::memory_order_acquire); }
+
+  void notify() {
+    counter_.fetch_add(1, std::memory_order_release);
+    counter_.notify_one();
+  }
+
+  // Waits until the notify() is called after the get() that returned the seen value
+  void wait(std::uint64_t seen) const { counter_.wait(seen, std::memory_order_acquire); }
+
+  // The same as wait, but busy-polls for the spin time first
+  void wait(std::uint64_t seen, std::chrono::nanoseconds spin) const {
+    if (!spinUntil(spin, [this, seen] { return counter_.load(std::memory_order_acquire) != seen; })) {
+      wait(seen);
+    }
+  }
+
+  // The same as wait, but spins and yields by the strategy first
+  void wait(std::uint64_t seen, WaitStrategy& strategy) const {
+    strategy.wait([this, seen] { return counter_.load(std::memory_order_acquire) != seen; },
+                  [this, seen] { wait(seen); });
+  }
+};
+
+}  // namespace dxf
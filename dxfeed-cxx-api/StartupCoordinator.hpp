@@ -0,0 +1,398 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ConnectionPool.hpp"
+#include "EventReceiver.hpp"
+#include "Metrics.hpp"
+#include "PriceLevelBook.hpp"
+#include "PriceLevelBookManager.hpp"
+
+namespace dxf {
+
+// The startup state of one tracked item (the book, the symbol of the subscription)
+enum class ReadinessState : int {
+  // Nothing is received yet
+  PENDING = 0,
+  // The first event (the snapshot data chunk) is received, the snapshot is not complete
+  FIRST_EVENT = 1,
+  // The snapshot is complete (the book is applied, the symbol is caught up)
+  READY = 2
+};
+
+// The copy of the startup progress (see ReadinessTracker::getStats)
+struct ReadinessStats {
+  std::size_t itemsNumber = 0;
+  // The items that have received the first event (the ready ones included)
+  std::size_t firstEventItemsNumber = 0;
+  std::size_t readyItemsNumber = 0;
+  // The ready future is resolved and the time from the tracker creation to it
+  bool isReady = false;
+  std::chrono::nanoseconds readyTime{0};
+
+  // The share of the ready items [0, 1]. 1 if there are no items.
+  [[nodiscard]] double getReadyRatio() const {
+    return itemsNumber == 0 ? 1.0 : static_cast<double>(readyItemsNumber) / static_cast<double>(itemsNumber);
+  }
+};
+
+// The readiness of the items that are subscribed at the startup: every item goes from PENDING to FIRST_EVENT to READY
+// once (the later events are ignored), so the service is brought into the rotation as soon as the data is complete
+// instead of sleeping on a fixed timeout. The items are added before the seal, the ready future is resolved after the
+// seal when the readyThreshold share of the items is ready. The items are marked by any thread.
+class ReadinessTracker final {
+  using Clock = std::chrono::steady_clock;
+
+ public:
+  class Item final {
+    friend class ReadinessTracker;
+
+    ReadinessTracker* tracker_;
+    std::string name_;
+    std::atomic<int> state_{static_cast<int>(ReadinessState::PENDING)};
+    // The time from the tracker creation (-1 - not yet)
+    std::atomic<std::int64_t> firstEventNanos_{-1};
+    std::atomic<std::int64_t> readyNanos_{-1};
+
+   public:
+    Item(ReadinessTracker* tracker, std::string name) : tracker_{tracker}, name_{std::move(name)} {}
+
+    Item(const Item&) = delete;
+    Item& operator=(const Item&) = delete;
+
+    [[nodiscard]] const std::string& getName() const { return name_; }
+
+    [[nodiscard]] ReadinessState getState() const {
+      return static_cast<ReadinessState>(state_.load(std::memory_order_acquire));
+    }
+
+    // The time from the tracker creation to the first event and to the ready state (-1 ns - not yet)
+    [[nodiscard]] std::chrono::nanoseconds getTimeToFirstEvent() const {
+      return std::chrono::nanoseconds{firstEventNanos_.load(std::memory_order_relaxed)};
+    }
+
+    [[nodiscard]] std::chrono::nanoseconds getTimeToReady() const {
+      return std::chrono::nanoseconds{readyNanos_.load(std::memory_order_relaxed)};
+    }
+
+    void markFirstEvent() { tracker_->advance(*this, ReadinessState::FIRST_EVENT); }
+
+    // Implies the first event
+    void markReady() { tracker_->advance(*this, ReadinessState::READY); }
+  };
+
+ private:
+  Clock::time_point startTime_;
+  double readyThreshold_;
+  // Guards the items (the addresses of the items are stable), the seal and the promise
+  mutable std::mutex mutex_;
+  std::deque<Item> items_;
+  bool isSealed_;
+  bool isResolved_;
+  std::promise<void> promise_;
+  std::shared_future<void> future_;
+  std::atomic<std::size_t> itemsNumber_;
+  std::atomic<std::size_t> firstEventItemsNumber_;
+  std::atomic<std::size_t> readyItemsNumber_;
+  std::atomic<std::int64_t> readyNanos_;
+
+  [[nodiscard]] std::int64_t getElapsedNanos() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime_).count();
+  }
+
+  // Called under the mutex
+  void resolveIfReady() {
+    if (!isSealed_ || isResolved_) {
+      return;
+    }
+
+    auto requiredNumber = static_cast<std::size_t>(std::ceil(readyThreshold_ * static_cast<double>(items_.size())));
+
+    if (readyItemsNumber_.load(std::memory_order_acquire) < requiredNumber) {
+      return;
+    }
+
+    isResolved_ = true;
+    readyNanos_.store(getElapsedNanos(), std::memory_order_relaxed);
+    promise_.set_value();
+  }
+
+  void advance(Item& item, ReadinessState state) {
+    auto target = static_cast<int>(state);
+    auto current = item.state_.load(std::memory_order_acquire);
+
+    // The fast path of the repeated events
+    while (current < target) {
+      if (!item.state_.compare_exchange_weak(current, target, std::memory_order_acq_rel)) {
+        continue;
+      }
+
+      auto now = getElapsedNanos();
+
+      if (current == static_cast<int>(ReadinessState::PENDING)) {
+        item.firstEventNanos_.store(now, std::memory_order_relaxed);
+        firstEventItemsNumber_.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      if (state == ReadinessState::READY) {
+        item.readyNanos_.store(now, std::memory_order_relaxed);
+        readyItemsNumber_.fetch_add(1, std::memory_order_acq_rel);
+
+        std::lock_guard<std::mutex> lk(mutex_);
+
+        resolveIfReady();
+      }
+
+      return;
+    }
+  }
+
+ public:
+  // readyThreshold - the share of the ready items (0, 1] that resolves the ready future (e.g. 0.99 - the service starts
+  // without the few symbols that have no data)
+  explicit ReadinessTracker(double readyThreshold = 1.0)
+      : startTime_{Clock::now()},
+        readyThreshold_{readyThreshold},
+        mutex_{},
+        items_{},
+        isSealed_{false},
+        isResolved_{false},
+        promise_{},
+        future_{promise_.get_future().share()},
+        itemsNumber_{0},
+        firstEventItemsNumber_{0},
+        readyItemsNumber_{0},
+        readyNanos_{0} {}
+
+  ReadinessTracker(const ReadinessTracker&) = delete;
+  ReadinessTracker& operator=(const ReadinessTracker&) = delete;
+
+  // Adds the pending item. The item lives as long as the tracker.
+  Item& add(std::string name) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto& item = items_.emplace_back(this, std::move(name));
+
+    itemsNumber_.fetch_add(1, std::memory_order_relaxed);
+
+    return item;
+  }
+
+  // All items are added: the ready future can be resolved
+  void seal() {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    isSealed_ = true;
+    resolveIfReady();
+  }
+
+  // Adds the items of the books (named "<symbol>#<source>") and returns the config that marks them (see
+  // PriceLevelBookConfig::onReadiness, the onReadiness of the config is called too). The books are created with the
+  // returned config.
+  PriceLevelBookConfig trackBooks(const PriceLevelBookConfig& config, const std::vector<std::string>& symbols,
+                                  const std::string& source) {
+    auto items = std::make_shared<std::unordered_map<std::string, Item*>>();
+
+    // The duplicated symbol is one item
+    for (const auto& symbol : symbols) {
+      if (!items->contains(symbol)) {
+        items->emplace(symbol, &add(symbol + "#" + source));
+      }
+    }
+
+    auto result = config;
+
+    result.onReadiness = [items, onReadiness = config.onReadiness](const PriceLevelBook& book, bool isReady) {
+      if (auto found = items->find(book.getSymbol()); found != items->end()) {
+        if (isReady) {
+          found->second->markReady();
+        } else {
+          found->second->markFirstEvent();
+        }
+      }
+
+      if (onReadiness) {
+        onReadiness(book, isReady);
+      }
+    };
+
+    return result;
+  }
+
+  // Adds the items of the symbols of the subscription (named "<kind>:<symbol>", e.g. "Quote:AAPL") and returns the
+  // completion that marks them (see EventReceiver::HistoryCompletion)
+  EventReceiver::HistoryCompletion trackSymbols(const std::vector<std::string>& symbols, const std::string& kind,
+                                                std::chrono::milliseconds liveLag = std::chrono::milliseconds{0}) {
+    auto items = std::make_shared<std::unordered_map<std::string, Item*>>();
+
+    // The duplicated symbol is one item
+    for (const auto& symbol : symbols) {
+      if (!items->contains(symbol)) {
+        items->emplace(symbol, &add(kind + ":" + symbol));
+      }
+    }
+
+    return {liveLag,
+            [items](const std::string& symbol) {
+              if (auto found = items->find(symbol); found != items->end()) {
+                found->second->markReady();
+              }
+            },
+            [items](const std::string& symbol) {
+              if (auto found = items->find(symbol); found != items->end()) {
+                found->second->markFirstEvent();
+              }
+            }};
+  }
+
+  // Is resolved once, after the seal, when the readyThreshold share of the items is ready
+  [[nodiscard]] std::shared_future<void> getReadyFuture() const { return future_; }
+
+  // Returns true if the ready future is resolved within the timeout
+  bool waitReady(std::chrono::milliseconds timeout) const {
+    return future_.wait_for(timeout) == std::future_status::ready;
+  }
+
+  [[nodiscard]] bool isReady() const { return waitReady(std::chrono::milliseconds{0}); }
+
+  [[nodiscard]] ReadinessStats getStats() const {
+    auto isReady = this->isReady();
+
+    return {itemsNumber_.load(std::memory_order_relaxed), firstEventItemsNumber_.load(std::memory_order_relaxed),
+            readyItemsNumber_.load(std::memory_order_relaxed), isReady,
+            std::chrono::nanoseconds{isReady ? readyNanos_.load(std::memory_order_relaxed) : 0}};
+  }
+
+  // The names of the items that are not ready (at most maxNumber), e.g. to log what delays the startup
+  [[nodiscard]] std::vector<std::string> getPendingItems(std::size_t maxNumber = 100) const {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::vector<std::string> result{};
+
+    for (const auto& item : items_) {
+      if (result.size() >= maxNumber) {
+        break;
+      }
+
+      if (item.getState() != ReadinessState::READY) {
+        result.push_back(item.getName());
+      }
+    }
+
+    return result;
+  }
+
+  // Writes the startup progress as the metrics dxf_startup_*
+  void collectMetrics(MetricsWriter& writer, const MetricLabels& labels = {}) const {
+    auto stats = getStats();
+
+    writer.gauge("dxf_startup_items", "The number of the items tracked at the startup", labels,
+                 static_cast<double>(stats.itemsNumber));
+    writer.gauge("dxf_startup_first_event_items", "The number of the items that have received the first event", labels,
+                 static_cast<double>(stats.firstEventItemsNumber));
+    writer.gauge("dxf_startup_ready_items", "The number of the items whose snapshot is complete", labels,
+                 static_cast<double>(stats.readyItemsNumber));
+    writer.gauge("dxf_startup_ready_percent", "The share of the ready items in percents", labels,
+                 stats.getReadyRatio() * 100.0);
+    writer.gauge("dxf_startup_ready", "1 if the startup readiness threshold is reached", labels,
+                 stats.isReady ? 1.0 : 0.0);
+    writer.gauge("dxf_startup_ready_seconds", "The time from the startup to the readiness", labels,
+                 std::chrono::duration<double>(stats.readyTime).count());
+  }
+};
+
+// Brings the service up as fast as the data allows: pre-opens the connections of the pool (so the subscriptions don't
+// wait for the connects one by one), creates the books and the subscriptions in bulk and tracks their readiness (see
+// ReadinessTracker). The pool must outlive the coordinator, the connections are kept open while it lives.
+class StartupCoordinator final {
+  ConnectionPool& pool_;
+  ReadinessTracker tracker_;
+  std::mutex mutex_;
+  std::deque<std::pair<std::string, ConnectionPool::Lease>> leases_;
+
+ public:
+  explicit StartupCoordinator(ConnectionPool& pool, double readyThreshold = 1.0)
+      : pool_{pool}, tracker_{readyThreshold}, mutex_{}, leases_{} {}
+
+  StartupCoordinator(const StartupCoordinator&) = delete;
+  StartupCoordinator& operator=(const StartupCoordinator&) = delete;
+
+  // Opens the connections to the addresses (lanesNumber per address, see ConnectionPool::acquire). Returns false if
+  // any of them can't be opened.
+  bool connect(const std::vector<std::string>& addresses, std::size_t lanesNumber = 1) {
+    auto result = true;
+
+    for (const auto& address : addresses) {
+      for (std::size_t lane = 0; lane < lanesNumber; lane++) {
+        auto lease = pool_.acquire(address, lane);
+
+        result = result && lease.isValid();
+
+        std::lock_guard<std::mutex> lk(mutex_);
+
+        leases_.emplace_back(address, std::move(lease));
+      }
+    }
+
+    return result;
+  }
+
+  // The connection opened by the connect (the first lane) or nullptr
+  [[nodiscard]] dxf_connection_t getConnection(const std::string& address) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    for (const auto& [leaseAddress, lease] : leases_) {
+      if (leaseAddress == address && lease.isValid()) {
+        return lease.getConnection();
+      }
+    }
+
+    return nullptr;
+  }
+
+  // Creates the tracked books of the symbols in bulk (in the order of the priorities, see
+  // PriceLevelBookManager::create)
+  std::vector<PriceLevelBook*> createBooks(PriceLevelBookManager& manager, const std::vector<std::string>& symbols,
+                                           const std::string& source, std::size_t levelsNumber,
+                                           const PriceLevelBookConfig& config = {},
+                                           const std::vector<int>& priorities = {}) {
+    auto trackedConfig = tracker_.trackBooks(config, symbols, source);
+
+    if (priorities.empty()) {
+      return manager.create(symbols, source, levelsNumber, trackedConfig);
+    }
+
+    return manager.create(symbols, source, levelsNumber, trackedConfig, priorities);
+  }
+
+  // The completion of the tracked symbols of the subscription (see ReadinessTracker::trackSymbols)
+  EventReceiver::HistoryCompletion trackSymbols(const std::vector<std::string>& symbols, const std::string& kind,
+                                                std::chrono::milliseconds liveLag = std::chrono::milliseconds{0}) {
+    return tracker_.trackSymbols(symbols, kind, liveLag);
+  }
+
+  // All books and subscriptions are created
+  void seal() { tracker_.seal(); }
+
+  [[nodiscard]] ReadinessTracker& getTracker() { return tracker_; }
+
+  [[nodiscard]] std::shared_future<void> getReadyFuture() const { return tracker_.getReadyFuture(); }
+
+  bool waitReady(std::chrono::milliseconds timeout) const { return tracker_.waitReady(timeout); }
+
+  [[nodiscard]] ReadinessStats getStats() const { return tracker_.getStats(); }
+};
+
+}  // namespace dxf
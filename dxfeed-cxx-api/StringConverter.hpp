@@ -1,53 +1,432 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
 #include <string>
+#include <string_view>
 
-#ifdef _MSC_FULL_VER
-#pragma warning(push)
-#pragma warning(disable : 4244)
-#endif
-
-#include <codecvt>
+#include "CpuFeatures.hpp"
 
 namespace dxf {
 
+namespace detail {
+
+// The table of the single char conversions of the ASCII chars
+template <typename Char>
+constexpr std::array<Char, 0x80> makeAsciiTable() {
+  std::array<Char, 0x80> table{};
+
+  for (std::size_t i = 0; i < table.size(); i++) {
+    table[i] = static_cast<Char>(i);
+  }
+
+  return table;
+}
+
+}  // namespace detail
+
+// The stateless (thread-safe) conversions between UTF-8 and the wide strings: UTF-16 if the wchar_t is 16-bit
+// (Windows), UTF-32 if it's 32-bit (the surrogate pairs of the 32-bit wide strings are accepted too). The runs of the
+// ASCII chars are converted by 16 (or 8 wide) chars at once with SSE2 on x86-64 and NEON on AArch64. The invalid string
+// is converted to the empty one. The transient conversions (lookups, formatting) can write into the caller buffers, the
+// reusable strings or the thread-local views instead of the new strings.
 struct StringConverter {
-  static std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> wstringConvert;
+ private:
+  static constexpr bool IS_WCHAR_UTF16 = sizeof(wchar_t) == 2;
 
-  static std::wstring utf8ToWString(const std::string &utf8) noexcept {
-    try {
-      return wstringConvert.from_bytes(utf8);
-    } catch (...) {
-      return {};
+  static constexpr std::array<char, 0x80> ASCII_CHARS = detail::makeAsciiTable<char>();
+  static constexpr std::array<wchar_t, 0x80> ASCII_WCHARS = detail::makeAsciiTable<wchar_t>();
+
+  static bool isSurrogate(std::uint32_t c) { return c >= 0xD800U && c <= 0xDFFFU; }
+
+  static void putWChars(wchar_t*& out, std::uint32_t codePoint) {
+    if (IS_WCHAR_UTF16 && codePoint >= 0x10000U) {
+      codePoint -= 0x10000U;
+      *out++ = static_cast<wchar_t>(0xD800U + (codePoint >> 10U));
+      *out++ = static_cast<wchar_t>(0xDC00U + (codePoint & 0x3FFU));
+    } else {
+      *out++ = static_cast<wchar_t>(codePoint);
     }
   }
 
-  static std::wstring utf8ToWString(const char *utf8) noexcept {
-    if (utf8 == nullptr) {
-      return {};
+  static void putUtf8(char*& out, std::uint32_t codePoint) {
+    if (codePoint < 0x80U) {
+      *out++ = static_cast<char>(codePoint);
+    } else if (codePoint < 0x800U) {
+      *out++ = static_cast<char>(0xC0U | (codePoint >> 6U));
+      *out++ = static_cast<char>(0x80U | (codePoint & 0x3FU));
+    } else if (codePoint < 0x10000U) {
+      *out++ = static_cast<char>(0xE0U | (codePoint >> 12U));
+      *out++ = static_cast<char>(0x80U | ((codePoint >> 6U) & 0x3FU));
+      *out++ = static_cast<char>(0x80U | (codePoint & 0x3FU));
+    } else {
+      *out++ = static_cast<char>(0xF0U | (codePoint >> 18U));
+      *out++ = static_cast<char>(0x80U | ((codePoint >> 12U) & 0x3FU));
+      *out++ = static_cast<char>(0x80U | ((codePoint >> 6U) & 0x3FU));
+      *out++ = static_cast<char>(0x80U | (codePoint & 0x3FU));
+    }
+  }
+
+  // Decodes the non-ASCII sequence. Returns false if the sequence is invalid (overlong, truncated, a surrogate or out of
+  // the range).
+  static bool decodeUtf8(const unsigned char*& in, const unsigned char* end, std::uint32_t& codePoint) {
+    auto c = *in;
+    std::size_t length = 0;
+    std::uint32_t minCodePoint = 0;
+
+    if (c >= 0xC2U && c <= 0xDFU) {
+      length = 2;
+      codePoint = c & 0x1FU;
+      minCodePoint = 0x80U;
+    } else if (c >= 0xE0U && c <= 0xEFU) {
+      length = 3;
+      codePoint = c & 0x0FU;
+      minCodePoint = 0x800U;
+    } else if (c >= 0xF0U && c <= 0xF4U) {
+      length = 4;
+      codePoint = c & 0x07U;
+      minCodePoint = 0x10000U;
+    } else {
+      return false;
     }
 
-    try {
-      return wstringConvert.from_bytes(utf8);
-    } catch (...) {
-      return {};
+    if (static_cast<std::size_t>(end - in) < length) {
+      return false;
     }
+
+    for (std::size_t i = 1; i < length; i++) {
+      if ((in[i] & 0xC0U) != 0x80U) {
+        return false;
+      }
+
+      codePoint = (codePoint << 6U) | (in[i] & 0x3FU);
+    }
+
+    if (codePoint < minCodePoint || codePoint > 0x10FFFFU || isSurrogate(codePoint)) {
+      return false;
+    }
+
+    in += length;
+
+    return true;
   }
 
-  static wchar_t utf8ToWChar(char c) noexcept {
-    if (c == '\0') {
-      return L'\0';
+  // The maximal lengths of the conversion results: every UTF-8 sequence is not shorter than its wide chars, the wide
+  // char takes 3 bytes (4 per the UTF-16 surrogate pair or the UTF-32 char)
+  static std::size_t maxWStringSize(std::size_t utf8Size) { return utf8Size; }
+
+  static std::size_t maxUtf8Size(std::size_t wStringSize) { return wStringSize * (IS_WCHAR_UTF16 ? 3 : 4); }
+
+  // Returns the end of the converted chars or nullptr if the string is invalid or the buffer is too small
+  static wchar_t* convertUtf8(const char* utf8, std::size_t size, wchar_t* out, wchar_t* outEnd) noexcept {
+    const auto* in = reinterpret_cast<const unsigned char*>(utf8);
+    const auto* end = in + size;
+
+    while (in != end) {
+#ifdef DXFCXX_CPU_X86
+      while (end - in >= 16 && outEnd - out >= 16) {
+        auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+
+        if (_mm_movemask_epi8(bytes) != 0) {
+          break;
+        }
+
+        auto zero = _mm_setzero_si128();
+        auto low = _mm_unpacklo_epi8(bytes, zero);
+        auto high = _mm_unpackhi_epi8(bytes, zero);
+
+        if constexpr (IS_WCHAR_UTF16) {
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(out), low);
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), high);
+        } else {
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(low, zero));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi16(low, zero));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpacklo_epi16(high, zero));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 12), _mm_unpackhi_epi16(high, zero));
+        }
+
+        in += 16;
+        out += 16;
+      }
+
+      if (in == end) {
+        break;
+      }
+#elif defined(DXFCXX_CPU_NEON)
+      while (end - in >= 16 && outEnd - out >= 16) {
+        auto bytes = vld1q_u8(in);
+
+        if (vmaxvq_u8(bytes) >= 0x80U) {
+          break;
+        }
+
+        auto low = vmovl_u8(vget_low_u8(bytes));
+        auto high = vmovl_high_u8(bytes);
+
+        if constexpr (IS_WCHAR_UTF16) {
+          vst1q_u16(reinterpret_cast<std::uint16_t*>(out), low);
+          vst1q_u16(reinterpret_cast<std::uint16_t*>(out + 8), high);
+        } else {
+          vst1q_u32(reinterpret_cast<std::uint32_t*>(out), vmovl_u16(vget_low_u16(low)));
+          vst1q_u32(reinterpret_cast<std::uint32_t*>(out + 4), vmovl_high_u16(low));
+          vst1q_u32(reinterpret_cast<std::uint32_t*>(out + 8), vmovl_u16(vget_low_u16(high)));
+          vst1q_u32(reinterpret_cast<std::uint32_t*>(out + 12), vmovl_high_u16(high));
+        }
+
+        in += 16;
+        out += 16;
+      }
+
+      if (in == end) {
+        break;
+      }
+#endif
+
+      if (out == outEnd) {
+        return nullptr;
+      }
+
+      if (*in < 0x80U) {
+        *out++ = static_cast<wchar_t>(*in++);
+
+        continue;
+      }
+
+      std::uint32_t codePoint = 0;
+
+      if (!decodeUtf8(in, end, codePoint)) {
+        return nullptr;
+      }
+
+      if (IS_WCHAR_UTF16 && codePoint >= 0x10000U && outEnd - out < 2) {
+        return nullptr;
+      }
+
+      putWChars(out, codePoint);
     }
 
-    return utf8ToWString(std::string(1, c))[0];
+    return out;
   }
 
-  static std::string wStringToUtf8(const std::wstring &utf16) noexcept {
+  // Returns the end of the converted bytes or nullptr if the string is invalid or the buffer is too small
+  static char* convertWString(const wchar_t* wString, std::size_t size, char* out, char* outEnd) noexcept {
+    const auto* in = wString;
+    const auto* end = in + size;
+
+    while (in != end) {
+#ifdef DXFCXX_CPU_X86
+      while (end - in >= 8 && outEnd - out >= 8) {
+        __m128i packed{};
+
+        if constexpr (IS_WCHAR_UTF16) {
+          auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+
+          if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(chars, _mm_set1_epi16(static_cast<short>(0xFF80))),
+                                                _mm_setzero_si128())) != 0xFFFF) {
+            break;
+          }
+
+          packed = _mm_packus_epi16(chars, chars);
+        } else {
+          auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+          auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4));
+          auto nonAscii = _mm_and_si128(_mm_or_si128(low, high), _mm_set1_epi32(static_cast<int>(0xFFFFFF80U)));
+
+          if (_mm_movemask_epi8(_mm_cmpeq_epi32(nonAscii, _mm_setzero_si128())) != 0xFFFF) {
+            break;
+          }
+
+          auto words = _mm_packs_epi32(low, high);
+
+          packed = _mm_packus_epi16(words, words);
+        }
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), packed);
+        in += 8;
+        out += 8;
+      }
+
+      if (in == end) {
+        break;
+      }
+#elif defined(DXFCXX_CPU_NEON)
+      while (end - in >= 8 && outEnd - out >= 8) {
+        uint16x8_t chars{};
+
+        if constexpr (IS_WCHAR_UTF16) {
+          chars = vld1q_u16(reinterpret_cast<const std::uint16_t*>(in));
+
+          if (vmaxvq_u16(chars) >= 0x80U) {
+            break;
+          }
+        } else {
+          auto low = vld1q_u32(reinterpret_cast<const std::uint32_t*>(in));
+          auto high = vld1q_u32(reinterpret_cast<const std::uint32_t*>(in + 4));
+
+          if (vmaxvq_u32(vorrq_u32(low, high)) >= 0x80U) {
+            break;
+          }
+
+          chars = vcombine_u16(vmovn_u32(low), vmovn_u32(high));
+        }
+
+        vst1_u8(reinterpret_cast<std::uint8_t*>(out), vmovn_u16(chars));
+        in += 8;
+        out += 8;
+      }
+
+      if (in == end) {
+        break;
+      }
+#endif
+
+      auto codePoint = static_cast<std::uint32_t>(*in++);
+
+      if (codePoint >= 0xD800U && codePoint <= 0xDBFFU) {
+        auto low = in != end ? static_cast<std::uint32_t>(*in) : 0U;
+
+        if (low < 0xDC00U || low > 0xDFFFU) {
+          return nullptr;
+        }
+
+        codePoint = 0x10000U + ((codePoint - 0xD800U) << 10U) + (low - 0xDC00U);
+        in++;
+      } else if (isSurrogate(codePoint) || codePoint > 0x10FFFFU) {
+        return nullptr;
+      }
+
+      auto length = codePoint < 0x80U ? 1 : codePoint < 0x800U ? 2 : codePoint < 0x10000U ? 3 : 4;
+
+      if (outEnd - out < length) {
+        return nullptr;
+      }
+
+      putUtf8(out, codePoint);
+    }
+
+    return out;
+  }
+
+  // Reuses the capacity of the result. The result is cleared if the string is invalid or the memory can't be allocated
+  // (the failed allocation isn't thrown, as the conversions are noexcept).
+  static bool convertUtf8(const char* utf8, std::size_t size, std::wstring& result) noexcept {
     try {
-      return wstringConvert.to_bytes(utf16);
+      result.resize(maxWStringSize(size));
     } catch (...) {
+      result.clear();
+
+      return false;
+    }
+
+    auto* end = convertUtf8(utf8, size, result.data(), result.data() + result.size());
+
+    result.resize(end != nullptr ? static_cast<std::size_t>(end - result.data()) : 0);
+
+    return end != nullptr;
+  }
+
+  static bool convertWString(const wchar_t* wString, std::size_t size, std::string& result) noexcept {
+    try {
+      result.resize(maxUtf8Size(size));
+    } catch (...) {
+      result.clear();
+
+      return false;
+    }
+
+    auto* end = convertWString(wString, size, result.data(), result.data() + result.size());
+
+    result.resize(end != nullptr ? static_cast<std::size_t>(end - result.data()) : 0);
+
+    return end != nullptr;
+  }
+
+  // The per-thread buffers of the views. They grow to the longest converted string and are never shrunk.
+  static std::wstring& wStringScratch() {
+    thread_local std::wstring scratch{};
+
+    return scratch;
+  }
+
+  static std::string& utf8Scratch() {
+    thread_local std::string scratch{};
+
+    return scratch;
+  }
+
+ public:
+  // The result of the conversion into the caller buffer that doesn't fit or is invalid
+  static constexpr std::size_t INVALID_SIZE = static_cast<std::size_t>(-1);
+
+  // The results of the single char conversion of the non-ASCII char: the ASCII SUB and the replacement char (the
+  // single byte or the wide char can't be converted without the rest of the string)
+  static constexpr char INVALID_CHAR = '\x1A';
+  static constexpr wchar_t INVALID_WCHAR = L'\uFFFD';
+
+  static std::wstring utf8ToWString(const std::string &utf8) noexcept {
+    return utf8ToWString(std::string_view{utf8});
+  }
+
+  static std::wstring utf8ToWString(std::string_view utf8) noexcept {
+    std::wstring result{};
+
+    convertUtf8(utf8.data(), utf8.size(), result);
+
+    return result;
+  }
+
+  static std::wstring utf8ToWString(const char *utf8) noexcept {
+    if (utf8 == nullptr) {
       return {};
     }
+
+    return utf8ToWString(std::string_view{utf8});
+  }
+
+  // Converts into the reusable string (doesn't allocate if the string has enough capacity). Returns false and clears the
+  // result if the string is invalid.
+  static bool utf8ToWString(std::string_view utf8, std::wstring &result) noexcept {
+    return convertUtf8(utf8.data(), utf8.size(), result);
+  }
+
+  // Converts into the caller buffer (the result isn't null-terminated). Returns the number of the written chars or the
+  // INVALID_SIZE if the string is invalid or doesn't fit. The buffer of the utf8.size() chars always fits.
+  static std::size_t utf8ToWString(std::string_view utf8, wchar_t *buffer, std::size_t size) noexcept {
+    auto* end = convertUtf8(utf8.data(), utf8.size(), buffer, buffer + size);
+
+    return end != nullptr ? static_cast<std::size_t>(end - buffer) : INVALID_SIZE;
+  }
+
+  // Converts into the thread-local buffer. The view is valid until the next utf8ToWStringView call of the thread. The
+  // invalid string is converted to the empty view.
+  static std::wstring_view utf8ToWStringView(std::string_view utf8) noexcept {
+    auto& scratch = wStringScratch();
+
+    convertUtf8(utf8.data(), utf8.size(), scratch);
+
+    return scratch;
+  }
+
+  // Returns the INVALID_WCHAR if the char isn't ASCII (the single byte is valid UTF-8 only if it's ASCII)
+  static constexpr wchar_t utf8ToWChar(char c) noexcept {
+    auto byte = static_cast<unsigned char>(c);
+
+    return byte < 0x80U ? ASCII_WCHARS[byte] : INVALID_WCHAR;
+  }
+
+  static std::string wStringToUtf8(const std::wstring &utf16) noexcept {
+    return wStringToUtf8(std::wstring_view{utf16});
+  }
+
+  static std::string wStringToUtf8(std::wstring_view utf16) noexcept {
+    std::string result{};
+
+    convertWString(utf16.data(), utf16.size(), result);
+
+    return result;
   }
 
   static std::string wStringToUtf8(const wchar_t *utf16) noexcept {
@@ -55,26 +434,39 @@ struct StringConverter {
       return {};
     }
 
-    try {
-      return wstringConvert.to_bytes(utf16);
-    } catch (...) {
-      return {};
-    }
+    return wStringToUtf8(std::wstring_view{utf16});
   }
 
-  static char wCharToUtf8(wchar_t c) noexcept {
-    if (c == L'\0') {
-      return '\0';
-    }
+  // Converts into the reusable string (doesn't allocate if the string has enough capacity). Returns false and clears the
+  // result if the string is invalid.
+  static bool wStringToUtf8(std::wstring_view utf16, std::string &result) noexcept {
+    return convertWString(utf16.data(), utf16.size(), result);
+  }
+
+  // Converts into the caller buffer (the result isn't null-terminated). Returns the number of the written bytes or the
+  // INVALID_SIZE if the string is invalid or doesn't fit. The buffer of the 4 * utf16.size() bytes always fits.
+  static std::size_t wStringToUtf8(std::wstring_view utf16, char *buffer, std::size_t size) noexcept {
+    auto* end = convertWString(utf16.data(), utf16.size(), buffer, buffer + size);
 
-    return wStringToUtf8(std::wstring(1, c))[0];
+    return end != nullptr ? static_cast<std::size_t>(end - buffer) : INVALID_SIZE;
   }
-};
 
-std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> StringConverter::wstringConvert{};
+  // Converts into the thread-local buffer. The view is valid until the next wStringToUtf8View call of the thread. The
+  // invalid string is converted to the empty view.
+  static std::string_view wStringToUtf8View(std::wstring_view utf16) noexcept {
+    auto& scratch = utf8Scratch();
 
-}
+    convertWString(utf16.data(), utf16.size(), scratch);
 
-#ifdef _MSC_FULL_VER
-#pragma warning(pop)
-#endif
+    return scratch;
+  }
+
+  // Returns the INVALID_CHAR if the char isn't ASCII (all the exchange codes are ASCII)
+  static constexpr char wCharToUtf8(wchar_t c) noexcept {
+    auto codePoint = static_cast<std::uint32_t>(c);
+
+    return codePoint < 0x80U ? ASCII_CHARS[codePoint] : INVALID_CHAR;
+  }
+};
+
+}  // namespace dxf
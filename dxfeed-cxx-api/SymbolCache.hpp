@@ -0,0 +1,207 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The cache of the decoded symbols of one reader (e.g. the event listener of one connection): the raw encoded symbol
+// (the penta code cipher, the bytes of the UTF-8 or the wide name as they are delivered) is mapped straight to the
+// resolved entry, i.e. the interned symbol and its value (e.g. the position of the subscribed symbol). The hit skips
+// the decoding, the code point hashing and the locks of the SymbolTable: the key is hashed by the 8-byte words and
+// compared by the bytes. In practice a few thousand symbols take almost all the traffic, so the hit rate is close to
+// 100%.
+//
+// The open-addressing table with the linear probing grows up to the maxCapacity slots, then it's cleared when it's half
+// full (the working set is re-populated by the misses). The cache is not thread-safe, the statistics may be read from
+// any thread.
+class SymbolCache final {
+ public:
+  static constexpr std::size_t DEFAULT_MAX_CAPACITY = 1U << 14U;
+
+  struct Entry {
+    Symbol symbol{};
+    std::size_t value = 0;
+  };
+
+  struct Stats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    // The number of the clears of the full cache
+    std::uint64_t resets = 0;
+
+    [[nodiscard]] double getHitRate() const {
+      return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses);
+    }
+  };
+
+ private:
+  static constexpr std::size_t MIN_CAPACITY = 64;
+  static constexpr std::uint64_t HASH_PRIME = 0x9E3779B97F4A7C15ULL;
+
+  // The kinds of the keys, so the equal bytes of the different encodings are the different keys
+  enum class KeyKind : std::uint8_t { NONE, CIPHER, UTF8, WIDE };
+
+  struct Slot {
+    std::size_t hash = 0;
+    KeyKind kind = KeyKind::NONE;
+    std::string key{};
+    Entry entry{};
+  };
+
+  std::size_t maxCapacity_;
+  std::vector<Slot> slots_;
+  std::size_t size_ = 0;
+  // Written by the reader only, so the increments are not the atomic read-modify-writes
+  std::atomic<std::uint64_t> hits_{0};
+  std::atomic<std::uint64_t> misses_{0};
+  std::atomic<std::uint64_t> resets_{0};
+
+  static void increment(std::atomic<std::uint64_t>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  static std::size_t hashBytes(const char* data, std::size_t size) {
+    auto hash = static_cast<std::uint64_t>(size) * HASH_PRIME;
+
+    for (; size >= sizeof(std::uint64_t); data += sizeof(std::uint64_t), size -= sizeof(std::uint64_t)) {
+      std::uint64_t word = 0;
+
+      std::memcpy(&word, data, sizeof(word));
+      hash = (hash ^ word) * HASH_PRIME;
+    }
+
+    if (size > 0) {
+      std::uint64_t word = 0;
+
+      std::memcpy(&word, data, size);
+      hash = (hash ^ word) * HASH_PRIME;
+    }
+
+    return static_cast<std::size_t>(hash ^ (hash >> 32U));
+  }
+
+  void rehash(std::size_t capacity) {
+    std::vector<Slot> slots(capacity);
+
+    for (auto& slot : slots_) {
+      if (slot.kind != KeyKind::NONE) {
+        auto i = slot.hash & (capacity - 1);
+
+        while (slots[i].kind != KeyKind::NONE) {
+          i = (i + 1) & (capacity - 1);
+        }
+
+        slots[i] = std::move(slot);
+      }
+    }
+
+    slots_ = std::move(slots);
+  }
+
+  template <typename Resolve>
+  const Entry& get(KeyKind kind, const char* data, std::size_t size, Resolve&& resolve) {
+    auto hash = hashBytes(data, size);
+    auto mask = slots_.size() - 1;
+    auto i = hash & mask;
+
+    for (; slots_[i].kind != KeyKind::NONE; i = (i + 1) & mask) {
+      const auto& slot = slots_[i];
+
+      if (slot.hash == hash && slot.kind == kind && slot.key.size() == size &&
+          std::memcmp(slot.key.data(), data, size) == 0) {
+        increment(hits_);
+
+        return slot.entry;
+      }
+    }
+
+    increment(misses_);
+
+    // Keeps the load factor at most 1/2 for the new key
+    if ((size_ + 1) * 2 > slots_.size()) {
+      if (slots_.size() < maxCapacity_) {
+        rehash(slots_.size() * 2);
+      } else {
+        clear();
+        increment(resets_);
+      }
+
+      mask = slots_.size() - 1;
+      i = hash & mask;
+
+      while (slots_[i].kind != KeyKind::NONE) {
+        i = (i + 1) & mask;
+      }
+    }
+
+    auto& slot = slots_[i];
+
+    slot.hash = hash;
+    slot.kind = kind;
+    slot.key.assign(data, size);
+    slot.entry = std::forward<Resolve>(resolve)();
+    size_++;
+
+    return slot.entry;
+  }
+
+ public:
+  // The maxCapacity is rounded up to the power of 2
+  explicit SymbolCache(std::size_t maxCapacity = DEFAULT_MAX_CAPACITY)
+      : maxCapacity_{MIN_CAPACITY}, slots_(MIN_CAPACITY) {
+    while (maxCapacity_ < maxCapacity) {
+      maxCapacity_ <<= 1U;
+    }
+  }
+
+  SymbolCache(const SymbolCache&) = delete;
+  SymbolCache& operator=(const SymbolCache&) = delete;
+
+  // Returns the entry of the wide name. The resolve() is called on the miss only and returns the Entry (e.g. the
+  // interned symbol and its position). The reference is valid until the next get or clear.
+  template <typename Resolve>
+  const Entry& get(std::wstring_view wSymbol, Resolve&& resolve) {
+    return get(KeyKind::WIDE, reinterpret_cast<const char*>(wSymbol.data()), wSymbol.size() * sizeof(wchar_t),
+               std::forward<Resolve>(resolve));
+  }
+
+  // Returns the entry of the UTF-8 name (the raw bytes, e.g. the symbol of the QTP record)
+  template <typename Resolve>
+  const Entry& get(std::string_view symbol, Resolve&& resolve) {
+    return get(KeyKind::UTF8, symbol.data(), symbol.size(), std::forward<Resolve>(resolve));
+  }
+
+  // Returns the entry of the penta code cipher, so the cipher is decoded on the miss only
+  template <typename Resolve>
+  const Entry& get(std::uint64_t cipher, Resolve&& resolve) {
+    return get(KeyKind::CIPHER, reinterpret_cast<const char*>(&cipher), sizeof(cipher),
+               std::forward<Resolve>(resolve));
+  }
+
+  // Removes the entries (e.g. when the values are changed), the statistics are kept
+  void clear() {
+    for (auto& slot : slots_) {
+      slot = Slot{};
+    }
+
+    size_ = 0;
+  }
+
+  [[nodiscard]] std::size_t getSize() const { return size_; }
+
+  [[nodiscard]] Stats getStats() const {
+    return {hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed),
+            resets_.load(std::memory_order_relaxed)};
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The index of the interned symbols (e.g. the symbols of the subscription and their positions): the open-addressing
+// hash table with the linear probing. The lookup by the wide name (the listener symbol) is O(1): the cached hash of the
+// interned symbol is compared before the name, so the names are compared only on the hash match.
+//
+// The writers (add, remove) are serialized by the mutex, the readers (find) don't lock: the slots are atomic and are
+// never moved while the table is in use. The removed symbol keeps its slot (the value is NOT_FOUND), so the re-added
+// symbol takes it again. The table grows (and drops the removed symbols) only with the distinct symbols, as the
+// SymbolTable does; the previous tables are kept until the index is destroyed, because the readers may still probe
+// them (their total size is less than the size of the current one).
+class SymbolIndex final {
+ public:
+  static constexpr std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+
+ private:
+  static constexpr std::size_t MIN_CAPACITY = 16;
+
+  struct Slot {
+    // nullptr - the free slot
+    std::atomic<const Symbol::Data*> symbol{nullptr};
+    std::atomic<std::size_t> value{NOT_FOUND};
+  };
+
+  struct Table {
+    std::size_t mask;
+    std::unique_ptr<Slot[]> slots;
+
+    explicit Table(std::size_t capacity) : mask{capacity - 1}, slots{new Slot[capacity]} {}
+  };
+
+  std::mutex mutex_{};
+  std::atomic<const Table*> table_{nullptr};
+  // The current table is the last one (used by the writers only)
+  std::vector<std::unique_ptr<Table>> tables_{};
+  // The occupied slots of the current table (with the removed symbols)
+  std::size_t usedSlotsNumber_ = 0;
+  std::atomic<std::size_t> size_{0};
+
+  // Returns the slot of the symbol or the free slot where it should be added
+  static Slot& findSlot(const Table& table, const Symbol::Data* data) {
+    for (auto i = data->hash & table.mask;; i = (i + 1) & table.mask) {
+      auto* symbol = table.slots[i].symbol.load(std::memory_order_relaxed);
+
+      if (symbol == data || symbol == nullptr) {
+        return table.slots[i];
+      }
+    }
+  }
+
+  // Finds the value by the hash and the name comparison (the readers)
+  template <typename Name>
+  [[nodiscard]] std::size_t findByName(Name name) const {
+    const auto* table = table_.load(std::memory_order_acquire);
+
+    if (table == nullptr) {
+      return NOT_FOUND;
+    }
+
+    auto hash = Symbol::hashOf(name);
+
+    for (auto i = hash & table->mask;; i = (i + 1) & table->mask) {
+      auto* symbol = table->slots[i].symbol.load(std::memory_order_acquire);
+
+      if (symbol == nullptr) {
+        return NOT_FOUND;
+      }
+
+      if (symbol->hash == hash && Symbol{symbol} == name) {
+        return table->slots[i].value.load(std::memory_order_acquire);
+      }
+    }
+  }
+
+  // Called under the mutex. Keeps the load factor at most 1/2 after the addition of the symbolsNumber symbols.
+  void reserve(std::size_t symbolsNumber) {
+    const auto* table = table_.load(std::memory_order_relaxed);
+
+    if (table != nullptr && (usedSlotsNumber_ + symbolsNumber) * 2 <= table->mask + 1) {
+      return;
+    }
+
+    auto capacity = MIN_CAPACITY;
+
+    while (capacity < (size_.load(std::memory_order_relaxed) + symbolsNumber) * 2) {
+      capacity <<= 1U;
+    }
+
+    auto newTable = std::make_unique<Table>(capacity);
+
+    usedSlotsNumber_ = 0;
+
+    if (table != nullptr) {
+      for (std::size_t i = 0; i <= table->mask; i++) {
+        auto* symbol = table->slots[i].symbol.load(std::memory_order_relaxed);
+        auto value = table->slots[i].value.load(std::memory_order_relaxed);
+
+        if (symbol != nullptr && value != NOT_FOUND) {
+          auto& slot = findSlot(*newTable, symbol);
+
+          slot.value.store(value, std::memory_order_relaxed);
+          slot.symbol.store(symbol, std::memory_order_relaxed);
+          usedSlotsNumber_++;
+        }
+      }
+    }
+
+    table_.store(newTable.get(), std::memory_order_release);
+    tables_.push_back(std::move(newTable));
+  }
+
+  // Called under the mutex, the table is reserved
+  bool addReserved(const Symbol& symbol, std::size_t value) {
+    auto& slot = findSlot(*tables_.back(), symbol.data_);
+
+    if (slot.symbol.load(std::memory_order_relaxed) == nullptr) {
+      // The value is published before the symbol, so the reader that finds the symbol sees the value
+      slot.value.store(value, std::memory_order_release);
+      slot.symbol.store(symbol.data_, std::memory_order_release);
+      usedSlotsNumber_++;
+    } else if (slot.value.load(std::memory_order_relaxed) == NOT_FOUND) {
+      slot.value.store(value, std::memory_order_release);
+    } else {
+      return false;
+    }
+
+    size_.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+ public:
+  SymbolIndex() = default;
+
+  SymbolIndex(const SymbolIndex&) = delete;
+  SymbolIndex& operator=(const SymbolIndex&) = delete;
+
+  // Returns false if the symbol is already in the index (its value is not changed). The value must not be NOT_FOUND.
+  bool add(const Symbol& symbol, std::size_t value) {
+    std::lock_guard guard(mutex_);
+
+    reserve(1);
+
+    return addReserved(symbol, value);
+  }
+
+  // The bulk addition: the symbols[i] is added with the value firstValue + i (the table is grown at most once). The
+  // duplicates keep the value of their first position. Returns the number of the added symbols.
+  std::size_t add(std::span<const Symbol> symbols, std::size_t firstValue = 0) {
+    std::lock_guard guard(mutex_);
+    std::size_t result = 0;
+
+    reserve(symbols.size());
+
+    for (std::size_t i = 0; i < symbols.size(); i++) {
+      result += addReserved(symbols[i], firstValue + i) ? 1 : 0;
+    }
+
+    return result;
+  }
+
+  // Returns false if the symbol is not in the index
+  bool remove(const Symbol& symbol) {
+    std::lock_guard guard(mutex_);
+
+    if (tables_.empty()) {
+      return false;
+    }
+
+    auto& slot = findSlot(*tables_.back(), symbol.data_);
+
+    if (slot.symbol.load(std::memory_order_relaxed) == nullptr ||
+        slot.value.load(std::memory_order_relaxed) == NOT_FOUND) {
+      return false;
+    }
+
+    slot.value.store(NOT_FOUND, std::memory_order_release);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+
+    return true;
+  }
+
+  // Returns the number of the removed symbols
+  std::size_t remove(std::span<const Symbol> symbols) {
+    std::size_t result = 0;
+
+    for (const auto& symbol : symbols) {
+      result += remove(symbol) ? 1 : 0;
+    }
+
+    return result;
+  }
+
+  // The value of the symbol or NOT_FOUND. Doesn't lock and doesn't intern the name.
+  [[nodiscard]] std::size_t find(std::wstring_view wSymbol) const { return findByName(wSymbol); }
+
+  [[nodiscard]] std::size_t find(std::string_view symbol) const { return findByName(symbol); }
+
+  // The interned symbols are compared by the pointers only
+  [[nodiscard]] std::size_t find(const Symbol& symbol) const {
+    const auto* table = table_.load(std::memory_order_acquire);
+
+    if (table == nullptr) {
+      return NOT_FOUND;
+    }
+
+    for (auto i = symbol.data_->hash & table->mask;; i = (i + 1) & table->mask) {
+      auto* data = table->slots[i].symbol.load(std::memory_order_acquire);
+
+      if (data == nullptr) {
+        return NOT_FOUND;
+      }
+
+      if (data == symbol.data_) {
+        return table->slots[i].value.load(std::memory_order_acquire);
+      }
+    }
+  }
+
+  [[nodiscard]] std::size_t getSize() const { return size_.load(std::memory_order_relaxed); }
+
+  [[nodiscard]] bool isEmpty() const { return getSize() == 0; }
+};
+
+}  // namespace dxf
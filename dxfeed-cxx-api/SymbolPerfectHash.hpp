@@ -0,0 +1,435 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "SymbolIndex.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The minimal perfect hash of the symbol universe (e.g. the distinct symbols of the day's IPF file, see the `perfect`
+// mode of the collision-detector): every symbol of the universe has its own position in [0, size) that is computed in
+// O(1) without the probing and the collisions, the other names are rejected by one comparison.
+//
+// The keys are the hashes of Symbol::hashOf, so the interned symbols are looked up by their cached hashes and the UTF-8
+// and the wide names are looked up without the conversion. The hash and displace scheme (PTHash): the mixed key falls
+// into one of the size / 4 buckets, the pilot of the bucket (found by the build, ~1 byte per symbol) displaces the keys
+// of the bucket to the free positions of the table of size / 0.98 positions, and the positions past the size are
+// remapped to the free ones below it. Every position keeps the hash and the name of its symbol for the check.
+//
+// The hash is immutable after the build or the load, so the lookups are thread-safe.
+//
+// Format of the file (native byte order):
+//   header:  "DXPH" (4 bytes), version (uint32), symbols (uint64), table size (uint64), buckets (uint64)
+//   pilots:  the pilots of the buckets (uint32)
+//   remap:   the positions of the table past the symbols (uint32, table size - symbols)
+//   hashes:  the hashes of the symbols by the positions (uint64)
+//   names:   the offsets of the names in the bytes (uint64, symbols + 1), the bytes
+class SymbolPerfectHash final {
+ public:
+  static constexpr std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+  static constexpr char MAGIC[4] = {'D', 'X', 'P', 'H'};
+  static constexpr std::uint32_t VERSION = 1;
+
+ private:
+  static constexpr std::uint64_t KEYS_PER_BUCKET = 4;
+  static constexpr double LOAD_FACTOR = 0.98;
+  static constexpr std::uint32_t MAX_PILOT = 1U << 24U;
+  static constexpr std::uint64_t PILOT_PRIME = 0x9E3779B97F4A7C15ULL;
+
+  std::uint64_t tableSize_ = 0;
+  std::vector<std::uint32_t> pilots_{};
+  // The free positions below the size for the positions past it
+  std::vector<std::uint32_t> remap_{};
+  std::vector<std::uint64_t> hashes_{};
+  std::vector<std::uint64_t> offsets_{0};
+  std::string names_{};
+
+  // The finalizer of MurmurHash3
+  static std::uint64_t mix(std::uint64_t x) {
+    x = (x ^ (x >> 33U)) * 0xFF51AFD7ED558CCDULL;
+    x = (x ^ (x >> 33U)) * 0xC4CEB9FE1A85EC53ULL;
+
+    return x ^ (x >> 33U);
+  }
+
+  // Maps the high 32 bits of the uniform value to [0, range), the range is less than 2^32
+  static std::uint64_t reduce(std::uint64_t x, std::uint64_t range) { return ((x >> 32U) * range) >> 32U; }
+
+  [[nodiscard]] static std::uint64_t getTablePosition(std::uint64_t key, std::uint32_t pilot,
+                                                      std::uint64_t tableSize) {
+    return reduce(mix(key ^ (pilot * PILOT_PRIME)), tableSize);
+  }
+
+  [[nodiscard]] bool isSameName(std::size_t position, std::string_view symbol) const {
+    return getSymbol(position) == symbol;
+  }
+
+  // The code points of the names are compared, as the Symbol does it
+  [[nodiscard]] bool isSameName(std::size_t position, std::wstring_view wSymbol) const {
+    auto name = getSymbol(position);
+    std::size_t i = 0;
+    std::size_t j = 0;
+
+    while (i < name.size() && j < wSymbol.size()) {
+      if (Symbol::nextCodePoint(name, i) != Symbol::nextCodePoint(wSymbol, j)) {
+        return false;
+      }
+    }
+
+    return i == name.size() && j == wSymbol.size();
+  }
+
+  template <typename Name>
+  [[nodiscard]] std::size_t findByHash(std::uint64_t hash, Name name) const {
+    if (hashes_.empty()) {
+      return NOT_FOUND;
+    }
+
+    auto key = mix(hash);
+    auto position = getTablePosition(key, pilots_[reduce(key, pilots_.size())], tableSize_);
+
+    if (position >= hashes_.size()) {
+      position = remap_[position - hashes_.size()];
+    }
+
+    return hashes_[position] == hash && isSameName(position, name) ? static_cast<std::size_t>(position) : NOT_FOUND;
+  }
+
+ public:
+  SymbolPerfectHash() = default;
+
+  // Builds the hash of the distinct symbols. Returns std::nullopt if two symbols have the same hash (e.g. the
+  // duplicates) or there are 2^32 symbols or more.
+  static std::optional<SymbolPerfectHash> build(std::span<const std::string_view> symbols) {
+    SymbolPerfectHash result{};
+    auto size = static_cast<std::uint64_t>(symbols.size());
+
+    if (size == 0) {
+      return result;
+    }
+
+    if (size >= std::numeric_limits<std::uint32_t>::max()) {
+      return std::nullopt;
+    }
+
+    auto bucketsNumber = size / KEYS_PER_BUCKET + 1;
+    auto tableSize = std::max(size, static_cast<std::uint64_t>(static_cast<double>(size) / LOAD_FACTOR) + 1);
+    std::vector<std::uint64_t> keys(size);
+
+    for (std::size_t i = 0; i < size; i++) {
+      keys[i] = mix(Symbol::hashOf(symbols[i]));
+    }
+
+    // The symbols are grouped by the buckets, the same keys are adjacent
+    std::vector<std::uint32_t> order(size);
+
+    std::iota(order.begin(), order.end(), 0U);
+    std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+      auto bucketA = reduce(keys[a], bucketsNumber);
+      auto bucketB = reduce(keys[b], bucketsNumber);
+
+      return bucketA != bucketB ? bucketA < bucketB : keys[a] < keys[b];
+    });
+
+    // The bounds of the buckets in the order, the largest buckets are placed first
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> buckets{};
+
+    for (std::uint32_t i = 0; i < size;) {
+      auto end = i + 1;
+
+      while (end < size && reduce(keys[order[end]], bucketsNumber) == reduce(keys[order[i]], bucketsNumber)) {
+        if (keys[order[end]] == keys[order[end - 1]]) {
+          return std::nullopt;
+        }
+
+        end++;
+      }
+
+      buckets.emplace_back(i, end);
+      i = end;
+    }
+
+    std::stable_sort(buckets.begin(), buckets.end(),
+                     [](const auto& a, const auto& b) { return a.second - a.first > b.second - b.first; });
+
+    std::vector<bool> isTaken(tableSize, false);
+    std::vector<std::uint64_t> positions(size);
+    std::vector<std::uint64_t> bucketPositions{};
+
+    result.pilots_.resize(bucketsNumber, 0);
+
+    for (const auto& [begin, end] : buckets) {
+      for (std::uint32_t pilot = 0;; pilot++) {
+        if (pilot == MAX_PILOT) {
+          return std::nullopt;
+        }
+
+        bucketPositions.clear();
+
+        for (auto i = begin; i < end; i++) {
+          auto position = getTablePosition(keys[order[i]], pilot, tableSize);
+
+          if (isTaken[position] ||
+              std::find(bucketPositions.begin(), bucketPositions.end(), position) != bucketPositions.end()) {
+            break;
+          }
+
+          bucketPositions.push_back(position);
+        }
+
+        if (bucketPositions.size() == end - begin) {
+          for (auto i = begin; i < end; i++) {
+            positions[order[i]] = bucketPositions[i - begin];
+            isTaken[bucketPositions[i - begin]] = true;
+          }
+
+          result.pilots_[reduce(keys[order[begin]], bucketsNumber)] = pilot;
+
+          break;
+        }
+      }
+    }
+
+    // There are as many taken positions past the size as the free ones below it
+    result.remap_.resize(tableSize - size, 0);
+
+    for (std::uint64_t position = size, free = 0; position < tableSize; position++) {
+      if (isTaken[position]) {
+        while (isTaken[free]) {
+          free++;
+        }
+
+        result.remap_[position - size] = static_cast<std::uint32_t>(free++);
+      }
+    }
+
+    std::vector<std::uint32_t> symbolsByPosition(size);
+
+    for (std::uint32_t i = 0; i < size; i++) {
+      auto position = positions[i];
+
+      symbolsByPosition[position < size ? position : result.remap_[position - size]] = i;
+    }
+
+    result.tableSize_ = tableSize;
+    result.hashes_.reserve(size);
+    result.offsets_.reserve(size + 1);
+
+    for (auto i : symbolsByPosition) {
+      result.hashes_.push_back(Symbol::hashOf(symbols[i]));
+      result.names_ += symbols[i];
+      result.offsets_.push_back(result.names_.size());
+    }
+
+    return result;
+  }
+
+  // Returns std::nullopt if there is no file or the file is not a hash of the supported version
+  static std::optional<SymbolPerfectHash> load(const std::string& path) {
+    auto file = MappedFile::open(path, false);
+
+    if (!file) {
+      return std::nullopt;
+    }
+
+    auto data = static_cast<const char*>(file->getData());
+    auto size = file->getSize();
+    std::size_t position = 0;
+    auto get = [&](void* value, std::size_t valueSize) {
+      if (size - position < valueSize) {
+        return false;
+      }
+
+      std::memcpy(value, data + position, valueSize);
+      position += valueSize;
+
+      return true;
+    };
+
+    char magic[sizeof(MAGIC)]{};
+    std::uint32_t version = 0;
+    std::uint64_t symbols = 0;
+    std::uint64_t tableSize = 0;
+    std::uint64_t buckets = 0;
+
+    if (!get(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(magic)) != 0 ||
+        !get(&version, sizeof(version)) || version != VERSION || !get(&symbols, sizeof(symbols)) ||
+        !get(&tableSize, sizeof(tableSize)) || !get(&buckets, sizeof(buckets)) || symbols > size ||
+        tableSize < symbols || tableSize - symbols > size || buckets > size || (symbols != 0 && buckets == 0)) {
+      return std::nullopt;
+    }
+
+    SymbolPerfectHash result{};
+
+    result.tableSize_ = tableSize;
+    result.pilots_.resize(buckets);
+    result.remap_.resize(tableSize - symbols);
+    result.hashes_.resize(symbols);
+    result.offsets_.resize(symbols + 1);
+
+    if (!get(result.pilots_.data(), buckets * sizeof(std::uint32_t)) ||
+        !get(result.remap_.data(), result.remap_.size() * sizeof(std::uint32_t)) ||
+        !std::all_of(result.remap_.begin(), result.remap_.end(), [&](auto p) { return p < symbols; }) ||
+        !get(result.hashes_.data(), symbols * sizeof(std::uint64_t)) ||
+        !get(result.offsets_.data(), (symbols + 1) * sizeof(std::uint64_t)) || result.offsets_.front() != 0 ||
+        !std::is_sorted(result.offsets_.begin(), result.offsets_.end()) || size - position < result.offsets_.back()) {
+      return std::nullopt;
+    }
+
+    result.names_.assign(data + position, result.offsets_.back());
+
+    return result;
+  }
+
+  // Writes the hash to the temporary file that replaces the file, so the hash is never partially written. Returns
+  // false if the file can't be written.
+  [[nodiscard]] bool save(const std::string& path) const {
+    auto temporaryPath = path + ".tmp";
+    auto* f = std::fopen(temporaryPath.c_str(), "wb");
+
+    if (f == nullptr) {
+      return false;
+    }
+
+    auto put = [f](const void* value, std::size_t valueSize) {
+      return valueSize == 0 || std::fwrite(value, 1, valueSize, f) == valueSize;
+    };
+
+    auto symbols = static_cast<std::uint64_t>(hashes_.size());
+    auto buckets = static_cast<std::uint64_t>(pilots_.size());
+    auto isValid = put(MAGIC, sizeof(MAGIC)) && put(&VERSION, sizeof(VERSION)) && put(&symbols, sizeof(symbols)) &&
+                   put(&tableSize_, sizeof(tableSize_)) && put(&buckets, sizeof(buckets)) &&
+                   put(pilots_.data(), pilots_.size() * sizeof(std::uint32_t)) &&
+                   put(remap_.data(), remap_.size() * sizeof(std::uint32_t)) &&
+                   put(hashes_.data(), hashes_.size() * sizeof(std::uint64_t)) &&
+                   put(offsets_.data(), offsets_.size() * sizeof(std::uint64_t)) && put(names_.data(), names_.size());
+
+    isValid = std::fclose(f) == 0 && isValid;
+
+    if (!isValid) {
+      std::remove(temporaryPath.c_str());
+
+      return false;
+    }
+
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+  }
+
+  // The position of the symbol or NOT_FOUND. Doesn't lock and doesn't intern the name.
+  [[nodiscard]] std::size_t find(std::string_view symbol) const { return findByHash(Symbol::hashOf(symbol), symbol); }
+
+  [[nodiscard]] std::size_t find(std::wstring_view wSymbol) const {
+    return findByHash(Symbol::hashOf(wSymbol), wSymbol);
+  }
+
+  // The cached hash of the interned symbol is used
+  [[nodiscard]] std::size_t find(const Symbol& symbol) const {
+    return findByHash(symbol.getHash(), std::string_view{symbol.getName()});
+  }
+
+  // The name of the symbol at the position
+  [[nodiscard]] std::string_view getSymbol(std::size_t position) const {
+    return std::string_view(names_).substr(offsets_[position], offsets_[position + 1] - offsets_[position]);
+  }
+
+  [[nodiscard]] std::size_t getSize() const { return hashes_.size(); }
+
+  // The bytes of the function itself (the pilots and the remap), without the hashes and the names of the check
+  [[nodiscard]] std::size_t getFunctionSize() const {
+    return (pilots_.size() + remap_.size()) * sizeof(std::uint32_t);
+  }
+};
+
+// The dense ids of the symbols of the universe and of the symbols added intraday: the symbols of the perfect hash have
+// their positions as the ids, the other symbols get the next ids (the size of the universe, + 1, ...) by add and are
+// kept by the SymbolIndex (the hash table with the probing). The lookups don't lock, the additions are serialized.
+//
+// Usage:
+//   auto universe = SymbolPerfectHash::load("symbols.phf");
+//   SymbolUniverseIndex index{universe ? std::move(*universe) : SymbolPerfectHash{}};
+//
+//   auto id = index.add(symbol);  // e.g. on the subscription of the new symbol
+//   ... index.find(L"AAPL") ...
+class SymbolUniverseIndex final {
+ public:
+  static constexpr std::size_t NOT_FOUND = SymbolPerfectHash::NOT_FOUND;
+
+ private:
+  SymbolPerfectHash universe_;
+  SymbolIndex addedSymbols_{};
+  std::mutex mutex_{};
+  std::atomic<std::size_t> size_;
+
+  template <typename Name>
+  [[nodiscard]] std::size_t findByName(Name name) const {
+    auto id = universe_.find(name);
+
+    return id != NOT_FOUND || addedSymbols_.isEmpty() ? id : addedSymbols_.find(name);
+  }
+
+ public:
+  explicit SymbolUniverseIndex(SymbolPerfectHash universe = {})
+      : universe_{std::move(universe)}, size_{universe_.getSize()} {}
+
+  SymbolUniverseIndex(const SymbolUniverseIndex&) = delete;
+  SymbolUniverseIndex& operator=(const SymbolUniverseIndex&) = delete;
+
+  // The id of the symbol or NOT_FOUND. Doesn't lock and doesn't intern the name.
+  [[nodiscard]] std::size_t find(std::string_view symbol) const { return findByName(symbol); }
+
+  [[nodiscard]] std::size_t find(std::wstring_view wSymbol) const { return findByName(wSymbol); }
+
+  [[nodiscard]] std::size_t find(const Symbol& symbol) const { return findByName(symbol); }
+
+  // Returns the id of the symbol: the symbol that is not in the index gets the next id
+  std::size_t add(const Symbol& symbol) {
+    if (auto id = find(symbol); id != NOT_FOUND) {
+      return id;
+    }
+
+    std::lock_guard guard(mutex_);
+
+    if (auto id = addedSymbols_.find(symbol); id != NOT_FOUND) {
+      return id;
+    }
+
+    auto id = size_.load(std::memory_order_relaxed);
+
+    addedSymbols_.add(symbol, id);
+    size_.store(id + 1, std::memory_order_relaxed);
+
+    return id;
+  }
+
+  [[nodiscard]] const SymbolPerfectHash& getUniverse() const { return universe_; }
+
+  [[nodiscard]] std::size_t getUniverseSize() const { return universe_.getSize(); }
+
+  // The number of the symbols added intraday
+  [[nodiscard]] std::size_t getAddedSize() const { return addedSymbols_.getSize(); }
+
+  // The number of the ids
+  [[nodiscard]] std::size_t getSize() const { return size_.load(std::memory_order_relaxed); }
+};
+
+}  // namespace dxf
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "StringConverter.hpp"
+#include "SymbolTable.hpp"
+
+namespace dxf {
+
+// The bulk symbol operations of the subscription: the symbols are passed to the C API in the batches
+// (dxf_add_symbols), so the subscription of a large universe takes a few calls instead of one call per symbol. The
+// UTF-8 symbols are interned and passed by their wide names kept by the SymbolTable, so the symbol is converted once
+// per process and not by every subscription.
+struct SymbolSubscription {
+  // The maximum number of the symbols per C API call
+  static constexpr std::size_t BATCH_SIZE = 10000;
+
+  static std::vector<std::wstring> toWSymbols(const std::vector<std::string>& symbols) {
+    std::vector<std::wstring> result(symbols.size());
+
+    std::transform(symbols.begin(), symbols.end(), result.begin(),
+                   [](const auto& s) { return StringConverter::utf8ToWString(s); });
+
+    return result;
+  }
+
+  // Calls the f(dxf_const_string_t*, int) for the batches of the symbols. Returns false if any call fails.
+  template <typename F>
+  static bool forEachBatch(const std::vector<std::wstring>& wSymbols, F&& f) {
+    std::vector<dxf_const_string_t> batch{};
+
+    batch.reserve((std::min)(wSymbols.size(), BATCH_SIZE));
+
+    for (std::size_t start = 0; start < wSymbols.size(); start += BATCH_SIZE) {
+      auto end = (std::min)(start + BATCH_SIZE, wSymbols.size());
+
+      batch.clear();
+
+      for (auto i = start; i < end; i++) {
+        batch.push_back(wSymbols[i].c_str());
+      }
+
+      if (f(batch.data(), static_cast<int>(batch.size())) == DXF_FAILURE) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // The interned symbols are passed by their wide names (see Symbol::getWideName), so nothing is converted or copied
+  template <typename F>
+  static bool forEachBatch(const std::vector<Symbol>& symbols, F&& f) {
+    std::vector<dxf_const_string_t> batch{};
+
+    batch.reserve((std::min)(symbols.size(), BATCH_SIZE));
+
+    for (std::size_t start = 0; start < symbols.size(); start += BATCH_SIZE) {
+      auto end = (std::min)(start + BATCH_SIZE, symbols.size());
+
+      batch.clear();
+
+      for (auto i = start; i < end; i++) {
+        batch.push_back(symbols[i].getWideName().c_str());
+      }
+
+      if (f(batch.data(), static_cast<int>(batch.size())) == DXF_FAILURE) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  static std::vector<Symbol> toSymbols(const std::vector<std::string>& symbols) {
+    std::vector<Symbol> result{};
+
+    result.reserve(symbols.size());
+
+    for (const auto& symbol : symbols) {
+      result.push_back(Symbol::valueOf(symbol));
+    }
+
+    return result;
+  }
+
+  // Returns false if any batch can't be added
+  static bool addSymbols(dxf_subscription_t subscription, const std::vector<std::wstring>& wSymbols) {
+    return forEachBatch(wSymbols, [subscription](dxf_const_string_t* batch, int size) {
+      return dxf_add_symbols(subscription, batch, size);
+    });
+  }
+
+  static bool addSymbols(dxf_subscription_t subscription, const std::vector<std::string>& symbols) {
+    return addSymbols(subscription, toSymbols(symbols));
+  }
+
+  static bool addSymbols(dxf_subscription_t subscription, const std::vector<Symbol>& symbols) {
+    return forEachBatch(symbols, [subscription](dxf_const_string_t* batch, int size) {
+      return dxf_add_symbols(subscription, batch, size);
+    });
+  }
+
+  // Returns false if any batch can't be removed
+  static bool removeSymbols(dxf_subscription_t subscription, const std::vector<std::wstring>& wSymbols) {
+    return forEachBatch(wSymbols, [subscription](dxf_const_string_t* batch, int size) {
+      return dxf_remove_symbols(subscription, batch, size);
+    });
+  }
+
+  static bool removeSymbols(dxf_subscription_t subscription, const std::vector<std::string>& symbols) {
+    return removeSymbols(subscription, toSymbols(symbols));
+  }
+
+  static bool removeSymbols(dxf_subscription_t subscription, const std::vector<Symbol>& symbols) {
+    return forEachBatch(symbols, [subscription](dxf_const_string_t* batch, int size) {
+      return dxf_remove_symbols(subscription, batch, size);
+    });
+  }
+};
+
+// The symbol set of the subscription that is replaced as a whole (e.g. the universe recomputed periodically). The
+// setSymbols subscribes only the difference with the current set: the sets are sorted by the ids of the interned
+// symbols and merged, then the new symbols are added and the old ones are removed by the batches. The symbols of both
+// sets are not touched, so none of their events are lost.
+//
+// Usage:
+//   SymbolSubscriptionSet set{subscription};
+//
+//   set.setSymbols({"AAPL", "IBM"});
+//   set.setSymbols({"IBM", "MSFT"});  // Adds MSFT, removes AAPL
+class SymbolSubscriptionSet final {
+  dxf_subscription_t subscription_;
+  // The subscribed symbols sorted by the ids
+  std::vector<Symbol> symbols_{};
+  std::vector<Symbol> next_{};
+  std::vector<Symbol> added_{};
+  std::vector<Symbol> removed_{};
+
+  static void sortById(std::vector<Symbol>& symbols) {
+    std::sort(symbols.begin(), symbols.end(), [](const Symbol& a, const Symbol& b) { return a.getId() < b.getId(); });
+    symbols.erase(std::unique(symbols.begin(), symbols.end()), symbols.end());
+  }
+
+ public:
+  // The symbols of the subscription are changed only by this set
+  explicit SymbolSubscriptionSet(dxf_subscription_t subscription) : subscription_{subscription} {}
+
+  // Replaces the symbols of the subscription by the given ones (the duplicates are ignored). Returns false if any
+  // batch fails: the set keeps the symbols that may still be subscribed, so the next call corrects the subscription.
+  bool setSymbols(std::vector<Symbol> symbols) {
+    auto byId = [](const Symbol& a, const Symbol& b) { return a.getId() < b.getId(); };
+
+    sortById(symbols);
+    added_.clear();
+    removed_.clear();
+    std::set_difference(symbols.begin(), symbols.end(), symbols_.begin(), symbols_.end(), std::back_inserter(added_),
+                        byId);
+    std::set_difference(symbols_.begin(), symbols_.end(), symbols.begin(), symbols.end(),
+                        std::back_inserter(removed_), byId);
+
+    auto isAdded = SymbolSubscription::addSymbols(subscription_, added_);
+
+    // The added symbols may be subscribed partially: they are kept until they are removed
+    next_.clear();
+    std::set_union(symbols_.begin(), symbols_.end(), added_.begin(), added_.end(), std::back_inserter(next_), byId);
+    std::swap(symbols_, next_);
+
+    if (!isAdded || !SymbolSubscription::removeSymbols(subscription_, removed_)) {
+      return false;
+    }
+
+    std::swap(symbols_, symbols);
+
+    return true;
+  }
+
+  bool setSymbols(const std::vector<std::string>& symbols) {
+    return setSymbols(SymbolSubscription::toSymbols(symbols));
+  }
+
+  // Removes all symbols of the subscription
+  bool clear() { return setSymbols(std::vector<Symbol>{}); }
+
+  // The subscribed symbols sorted by the ids
+  [[nodiscard]] const std::vector<Symbol>& getSymbols() const { return symbols_; }
+
+  // The symbols added and removed by the last setSymbols
+  [[nodiscard]] const std::vector<Symbol>& getAddedSymbols() const { return added_; }
+
+  [[nodiscard]] const std::vector<Symbol>& getRemovedSymbols() const { return removed_; }
+};
+
+}  // namespace dxf
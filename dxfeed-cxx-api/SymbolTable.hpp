@@ -0,0 +1,351 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "StringConverter.hpp"
+
+namespace dxf {
+
+// The interned symbol: the pointer to the entry of the SymbolTable with the compact id, the cached hash and the shared
+// UTF-8 name. The copy is the copy of the pointer, the symbols are equal if the entries are the same, and the maps
+// keyed by the symbols (see SymbolHash) don't hash the names. The events keep the shared name, so the copies of the
+// symbol don't allocate. The wide name of the C API calls is converted once per symbol (see getWideName).
+class Symbol final {
+  friend class SymbolTable;
+  friend class SymbolIndex;
+  friend class SymbolPerfectHash;
+
+ public:
+  struct Data {
+    std::uint32_t id = 0;
+    std::size_t hash = 0;
+    std::shared_ptr<const std::string> name{};
+    // The wide name (the key of the table), is set once by the first wide lookup or getWideName
+    mutable std::atomic<const std::wstring*> wName{nullptr};
+  };
+
+ private:
+  const Data* data_;
+
+  explicit Symbol(const Data* data) : data_{data} {}
+
+  static constexpr std::uint64_t HASH_OFFSET = 14695981039346656037ULL;
+  static constexpr std::uint64_t HASH_PRIME = 1099511628211ULL;
+
+  static void hashCodePoint(std::uint64_t& hash, std::uint32_t codePoint) {
+    for (unsigned shift = 0; shift < 32; shift += 8) {
+      hash = (hash ^ ((codePoint >> shift) & 0xFFU)) * HASH_PRIME;
+    }
+  }
+
+  // The code points of the UTF-8 name (the invalid byte is the code point 0xDC00 + byte)
+  static std::uint32_t nextCodePoint(std::string_view s, std::size_t& i) {
+    auto c = static_cast<unsigned char>(s[i++]);
+
+    if (c < 0x80U) {
+      return c;
+    }
+
+    auto length = c >= 0xF0U ? 3U : c >= 0xE0U ? 2U : c >= 0xC0U ? 1U : 0U;
+
+    if (length == 0 || i + length > s.size()) {
+      return 0xDC00U + c;
+    }
+
+    std::uint32_t codePoint = c & (0x3FU >> length);
+
+    for (std::size_t j = 0; j < length; j++) {
+      auto next = static_cast<unsigned char>(s[i + j]);
+
+      if ((next & 0xC0U) != 0x80U) {
+        return 0xDC00U + c;
+      }
+
+      codePoint = (codePoint << 6U) | (next & 0x3FU);
+    }
+
+    i += length;
+
+    return codePoint;
+  }
+
+  // The code points of the UTF-16 (or UTF-32 if the wchar_t is 32-bit) name. The surrogate pairs are combined in both
+  // cases (see StringConverter).
+  static std::uint32_t nextCodePoint(std::wstring_view s, std::size_t& i) {
+    auto c = static_cast<std::uint32_t>(s[i++]);
+
+    if (c >= 0xD800U && c <= 0xDBFFU && i < s.size()) {
+      auto low = static_cast<std::uint32_t>(s[i]);
+
+      if (low >= 0xDC00U && low <= 0xDFFFU) {
+        i++;
+
+        return 0x10000U + ((c - 0xD800U) << 10U) + (low - 0xDC00U);
+      }
+    }
+
+    return c;
+  }
+
+  template <typename StringView>
+  static std::size_t hashCodePoints(StringView s) {
+    auto hash = HASH_OFFSET;
+
+    for (std::size_t i = 0; i < s.size();) {
+      hashCodePoint(hash, nextCodePoint(s, i));
+    }
+
+    return static_cast<std::size_t>(hash);
+  }
+
+ public:
+  // The empty symbol
+  Symbol();
+
+  // Interns the symbol (see SymbolTable)
+  static Symbol valueOf(std::string_view symbol);
+
+  static Symbol valueOf(std::wstring_view wSymbol);
+
+  // The hash of the name (the same for the UTF-8 and the wide names of the symbol)
+  static std::size_t hashOf(std::string_view symbol) { return hashCodePoints(symbol); }
+
+  static std::size_t hashOf(std::wstring_view wSymbol) { return hashCodePoints(wSymbol); }
+
+  [[nodiscard]] std::uint32_t getId() const { return data_->id; }
+
+  [[nodiscard]] std::size_t getHash() const { return data_->hash; }
+
+  [[nodiscard]] const std::string& getName() const { return *data_->name; }
+
+  [[nodiscard]] const std::shared_ptr<const std::string>& getSharedName() const { return data_->name; }
+
+  // The null-terminated wide name of the C API calls (the subscriptions and the snapshots). Is converted once per
+  // symbol and kept by the table, so the repeated calls don't convert or allocate. The invalid UTF-8 symbol has the
+  // empty wide name.
+  [[nodiscard]] const std::wstring& getWideName() const;
+
+  [[nodiscard]] bool isEmpty() const { return data_->name->empty(); }
+
+  friend bool operator==(const Symbol& a, const Symbol& b) { return a.data_ == b.data_; }
+
+  friend bool operator==(const Symbol& a, std::string_view b) { return *a.data_->name == b; }
+
+  friend bool operator==(const Symbol& a, std::wstring_view b) {
+    std::string_view name{*a.data_->name};
+    std::size_t i = 0;
+    std::size_t j = 0;
+
+    while (i < name.size() && j < b.size()) {
+      if (nextCodePoint(name, i) != nextCodePoint(b, j)) {
+        return false;
+      }
+    }
+
+    return i == name.size() && j == b.size();
+  }
+
+  template <typename OutStream>
+  friend OutStream& operator<<(OutStream& os, const Symbol& symbol) {
+    os << symbol.getName();
+
+    return os;
+  }
+};
+
+// The hash of the maps keyed by the symbols. The maps with the std::equal_to<> are searched by the std::string_view or
+// the dxf_const_string_t without the interning (e.g. map.find("AAPL")).
+struct SymbolHash {
+  using is_transparent = void;
+
+  std::size_t operator()(const Symbol& symbol) const { return symbol.getHash(); }
+
+  std::size_t operator()(std::string_view symbol) const { return Symbol::hashOf(symbol); }
+
+  std::size_t operator()(std::wstring_view wSymbol) const { return Symbol::hashOf(wSymbol); }
+};
+
+// The map keyed by the symbols
+template <typename T>
+using SymbolMap = std::unordered_map<Symbol, T, SymbolHash, std::equal_to<>>;
+
+// The process-wide table of the interned symbols. Every distinct symbol is converted and allocated once, the symbols
+// are never removed (the set of the symbols is small), so the entries are never moved. The id 0 is the empty symbol.
+class SymbolTable final {
+  struct NameHash {
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view symbol) const { return std::hash<std::string_view>{}(symbol); }
+
+    std::size_t operator()(std::wstring_view wSymbol) const { return std::hash<std::wstring_view>{}(wSymbol); }
+  };
+
+  mutable std::mutex mutex_{};
+  std::unordered_map<std::wstring, const Symbol::Data*, NameHash, std::equal_to<>> wIds_{};
+  std::unordered_map<std::string, const Symbol::Data*, NameHash, std::equal_to<>> ids_{};
+  std::deque<Symbol::Data> symbols_{};
+  // The wide name of the invalid UTF-8 symbols
+  const std::wstring invalidWName_{};
+  const Symbol::Data* emptySymbol_;
+
+  SymbolTable() : emptySymbol_{add(std::wstring{}, std::string{})} {}
+
+  const Symbol::Data* add(std::wstring wSymbol, std::string symbol) {
+    auto& data = symbols_.emplace_back();
+
+    data.id = static_cast<std::uint32_t>(symbols_.size() - 1);
+    data.hash = Symbol::hashOf(symbol);
+    data.name = std::make_shared<const std::string>(symbol);
+
+    // The invalid UTF-8 symbol has no wide name, the bulk interned one gets it on the first wide lookup
+    if (!wSymbol.empty() || symbol.empty()) {
+      addWideName(data, std::move(wSymbol));
+    }
+
+    ids_.emplace(std::move(symbol), &data);
+
+    return &data;
+  }
+
+  // Called under the mutex. The first wide name of the symbol is kept.
+  const std::wstring& addWideName(const Symbol::Data& data, std::wstring wSymbol) {
+    auto& wName = wIds_.emplace(std::move(wSymbol), &data).first->first;
+    const std::wstring* expected = nullptr;
+
+    data.wName.compare_exchange_strong(expected, &wName, std::memory_order_release, std::memory_order_relaxed);
+
+    return *data.wName.load(std::memory_order_relaxed);
+  }
+
+ public:
+  static SymbolTable& getInstance() {
+    static SymbolTable instance{};
+
+    return instance;
+  }
+
+  // Doesn't allocate if the symbol is already interned
+  Symbol intern(std::wstring_view wSymbol) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (auto found = wIds_.find(wSymbol); found != wIds_.end()) {
+      return Symbol{found->second};
+    }
+
+    auto symbol = StringConverter::wStringToUtf8View(wSymbol);
+
+    if (auto found = ids_.find(symbol); found != ids_.end()) {
+      addWideName(*found->second, std::wstring(wSymbol));
+
+      return Symbol{found->second};
+    }
+
+    return Symbol{add(std::wstring(wSymbol), std::string(symbol))};
+  }
+
+  // Doesn't convert the symbol if it's already interned (and doesn't allocate if it's interned by the wide name)
+  Symbol intern(std::string_view symbol) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    if (auto found = ids_.find(symbol); found != ids_.end()) {
+      return Symbol{found->second};
+    }
+
+    auto wSymbol = StringConverter::utf8ToWStringView(symbol);
+
+    if (!wSymbol.empty()) {
+      if (auto found = wIds_.find(wSymbol); found != wIds_.end()) {
+        return Symbol{found->second};
+      }
+    }
+
+    return Symbol{add(std::wstring(wSymbol), std::string(symbol))};
+  }
+
+  // The bulk interning (e.g. of the symbol universe) by one lock. The new symbols are added without the wide names,
+  // they are converted on the first wide lookup instead (see intern(std::wstring_view)).
+  std::vector<Symbol> intern(const std::vector<std::string_view>& symbols) {
+    std::vector<Symbol> result{};
+
+    result.reserve(symbols.size());
+
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    ids_.reserve(ids_.size() + symbols.size());
+
+    for (auto symbol : symbols) {
+      auto found = ids_.find(symbol);
+
+      result.push_back(Symbol{found != ids_.end() ? found->second : add(std::wstring{}, std::string(symbol))});
+    }
+
+    return result;
+  }
+
+  // Converts the UTF-8 name once (see Symbol::getWideName)
+  const std::wstring& getWideName(const Symbol& symbol) {
+    std::lock_guard<std::mutex> lk(mutex_);
+    const auto& data = *symbol.data_;
+
+    if (auto wName = data.wName.load(std::memory_order_relaxed); wName != nullptr) {
+      return *wName;
+    }
+
+    auto wSymbol = StringConverter::utf8ToWStringView(*data.name);
+
+    if (wSymbol.empty()) {
+      data.wName.store(&invalidWName_, std::memory_order_release);
+
+      return invalidWName_;
+    }
+
+    return addWideName(data, std::wstring(wSymbol));
+  }
+
+  // The empty symbol (the id 0)
+  [[nodiscard]] Symbol getEmptySymbol() const { return Symbol{emptySymbol_}; }
+
+  // Returns nullptr if there is no such id
+  [[nodiscard]] std::shared_ptr<const std::string> getSymbol(std::uint32_t id) const {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return id < symbols_.size() ? symbols_[id].name : nullptr;
+  }
+
+  [[nodiscard]] std::size_t getSize() const {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return symbols_.size();
+  }
+};
+
+inline Symbol::Symbol() : Symbol{SymbolTable::getInstance().getEmptySymbol()} {}
+
+inline Symbol Symbol::valueOf(std::string_view symbol) { return SymbolTable::getInstance().intern(symbol); }
+
+inline Symbol Symbol::valueOf(std::wstring_view wSymbol) { return SymbolTable::getInstance().intern(wSymbol); }
+
+inline const std::wstring& Symbol::getWideName() const {
+  if (auto wName = data_->wName.load(std::memory_order_acquire); wName != nullptr) {
+    return *wName;
+  }
+
+  return SymbolTable::getInstance().getWideName(*this);
+}
+
+}  // namespace dxf
+
+template <>
+struct std::hash<dxf::Symbol> {
+  std::size_t operator()(const dxf::Symbol& symbol) const noexcept { return symbol.getHash(); }
+};
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+#include "SpscRing.hpp"
+#include "ThreadPlacement.hpp"
+
+namespace dxf {
+
+struct TextExportConfig {
+  // The number of the records the producer may queue (rounded up to the power of 2). The records that don't fit are
+  // dropped and counted, the producer never waits.
+  std::size_t queueCapacity = 1U << 16U;
+
+  // The size of the formatted text that is written at once
+  std::size_t batchSize = 4U << 20U;
+
+  // The formatted text is written at least this often when the records are rare
+  std::chrono::milliseconds flushInterval{100};
+
+  // Linux only. The file is written with O_DIRECT (the page cache is bypassed): the aligned blocks of the batches are
+  // written, the tail is written with the cache at the close.
+  bool directIo = false;
+
+  // The first line(s) of the file (e.g. the CSV header)
+  std::string header{};
+};
+
+// The asynchronous text export (e.g. the CSV dumps of the full-rate feeds): the producer (one thread, e.g. the thread
+// of the book) only copies the binary record to the ring, the background thread formats the records by the formatter
+// into the large buffer and writes it by the large sequential writes. The formatting and the I/O never run on the
+// thread of the feed.
+//
+// Usage:
+//   struct Row { std::int64_t time; double price; double size; };
+//
+//   auto exporter = AsyncTextExport<Row>::open("rows.csv", [](fmt::memory_buffer& out, const Row& row) {
+//     fmt::format_to(std::back_inserter(out), FMT_COMPILE("{},{},{}\n"), row.time, row.price, row.size);
+//   }, {.header = "time,price,size\n"});
+//
+//   exporter->push({time, price, size});  // The feed thread
+//   exporter->close();
+template <typename Record, typename Formatter = void (*)(fmt::memory_buffer&, const Record&)>
+class AsyncTextExport final {
+  static_assert(std::is_trivially_copyable_v<Record>, "The records are copied to the ring as is");
+
+  static constexpr std::size_t DIRECT_IO_ALIGNMENT = 4096;
+  static constexpr std::chrono::milliseconds IDLE_SLEEP{1};
+
+  struct Slot {
+    Record record{};
+    bool isStop = false;
+  };
+
+  struct AlignedDeleter {
+    void operator()(char* data) const { ::operator delete[](data, std::align_val_t{DIRECT_IO_ALIGNMENT}); }
+  };
+
+  Formatter formatter_;
+  std::size_t batchSize_;
+  std::chrono::milliseconds flushInterval_;
+  SpscRing<Slot> ring_;
+#ifdef _WIN32
+  std::FILE* file_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+  bool isDirect_ = false;
+  // The aligned copy of the text of the direct writes
+  std::unique_ptr<char[], AlignedDeleter> alignedBuffer_{};
+  fmt::memory_buffer text_{};
+  std::thread thread_{};
+  bool isClosed_ = false;
+  std::atomic<bool> isFailed_{false};
+  std::atomic<std::uint64_t> exportedNumber_{0};
+  std::atomic<std::uint64_t> droppedNumber_{0};
+  std::atomic<std::uint64_t> writtenBytes_{0};
+
+  AsyncTextExport(Formatter formatter, const TextExportConfig& config)
+      : formatter_{std::move(formatter)},
+        batchSize_{((std::max)(config.batchSize, DIRECT_IO_ALIGNMENT) + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT *
+                   DIRECT_IO_ALIGNMENT},
+        flushInterval_{config.flushInterval},
+        ring_{config.queueCapacity} {}
+
+  bool writeFully(const char* data, std::size_t size) {
+    while (size != 0) {
+#ifdef _WIN32
+      auto written = std::fwrite(data, 1, size, file_);
+
+      if (written == 0) {
+        return false;
+      }
+#else
+      auto written = ::write(fd_, data, size);
+
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+
+        return false;
+      }
+#endif
+
+      data += written;
+      size -= static_cast<std::size_t>(written);
+      writtenBytes_.fetch_add(static_cast<std::uint64_t>(written), std::memory_order_relaxed);
+    }
+
+    return true;
+  }
+
+  // Writes the text (the direct I/O: its aligned part, or all of it if it's the last write)
+  void writeText(bool isLast) {
+    if (text_.size() == 0 || isFailed_.load(std::memory_order_relaxed)) {
+      text_.clear();
+
+      return;
+    }
+
+    if (!isDirect_) {
+      if (!writeFully(text_.data(), text_.size())) {
+        isFailed_.store(true, std::memory_order_relaxed);
+      }
+
+      text_.clear();
+
+      return;
+    }
+
+#ifdef O_DIRECT
+    std::size_t written = 0;
+    auto alignedSize = text_.size() / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+
+    while (written < alignedSize) {
+      auto size = (std::min)(alignedSize - written, batchSize_);
+
+      std::memcpy(alignedBuffer_.get(), text_.data() + written, size);
+
+      if (!writeFully(alignedBuffer_.get(), size)) {
+        isFailed_.store(true, std::memory_order_relaxed);
+        text_.clear();
+
+        return;
+      }
+
+      written += size;
+    }
+
+    // The tail isn't aligned: it's kept for the next write or written with the cache
+    auto tailSize = text_.size() - written;
+
+    std::memmove(text_.data(), text_.data() + written, tailSize);
+    text_.resize(tailSize);
+
+    if (isLast && tailSize != 0) {
+      ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) & ~O_DIRECT);
+
+      if (!writeFully(text_.data(), text_.size())) {
+        isFailed_.store(true, std::memory_order_relaxed);
+      }
+
+      text_.clear();
+    }
+#endif
+  }
+
+  void run() {
+    ThreadPlacement::setCurrentThreadName("dxf-text-export");
+
+    auto lastWriteTime = std::chrono::steady_clock::now();
+
+    while (true) {
+      auto* slot = ring_.tryFront();
+
+      if (slot == nullptr) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (text_.size() != 0 && now - lastWriteTime >= flushInterval_) {
+          writeText(false);
+          lastWriteTime = now;
+        }
+
+        std::this_thread::sleep_for(IDLE_SLEEP);
+
+        continue;
+      }
+
+      if (slot->isStop) {
+        ring_.pop();
+
+        break;
+      }
+
+      formatter_(text_, slot->record);
+      ring_.pop();
+      exportedNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      if (text_.size() >= batchSize_) {
+        writeText(false);
+        lastWriteTime = std::chrono::steady_clock::now();
+      }
+    }
+
+    writeText(true);
+  }
+
+  bool openFile(const std::string& path, bool directIo) {
+#ifdef _WIN32
+    (void)directIo;
+    file_ = std::fopen(path.c_str(), "wb");
+
+    if (file_ != nullptr) {
+      std::setvbuf(file_, nullptr, _IONBF, 0);
+    }
+
+    return file_ != nullptr;
+#else
+    auto flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+#ifdef O_DIRECT
+    if (directIo) {
+      fd_ = ::open(path.c_str(), flags | O_DIRECT, 0644);
+      isDirect_ = fd_ >= 0;
+    }
+#else
+    (void)directIo;
+#endif
+
+    // The file systems without the direct I/O (e.g. tmpfs) are written with the cache
+    if (fd_ < 0) {
+      fd_ = ::open(path.c_str(), flags, 0644);
+    }
+
+    if (isDirect_) {
+      alignedBuffer_.reset(static_cast<char*>(::operator new[](batchSize_, std::align_val_t{DIRECT_IO_ALIGNMENT})));
+    }
+
+    return fd_ >= 0;
+#endif
+  }
+
+  bool closeFile() {
+#ifdef _WIN32
+    auto result = std::fclose(file_) == 0;
+
+    file_ = nullptr;
+
+    return result;
+#else
+    auto result = ::close(fd_) == 0;
+
+    fd_ = -1;
+
+    return result;
+#endif
+  }
+
+ public:
+  AsyncTextExport(const AsyncTextExport&) = delete;
+  AsyncTextExport& operator=(const AsyncTextExport&) = delete;
+
+  ~AsyncTextExport() { close(); }
+
+  // Creates the file (replaces the existing one) and starts the thread of the export. formatter - the
+  // f(fmt::memory_buffer&, const Record&) that appends the text of the record (e.g. by the FMT_COMPILE format).
+  // Returns nullptr if the file can't be created.
+  static std::unique_ptr<AsyncTextExport> open(const std::string& path, Formatter formatter,
+                                               const TextExportConfig& config = {}) {
+    auto exporter = std::unique_ptr<AsyncTextExport>(new AsyncTextExport(std::move(formatter), config));
+
+    if (!exporter->openFile(path, config.directIo)) {
+      return nullptr;
+    }
+
+    exporter->text_.append(config.header);
+    exporter->thread_ = std::thread(&AsyncTextExport::run, exporter.get());
+
+    return exporter;
+  }
+
+  // The producer. Copies the record to the ring. Returns false if the ring is full (the record is dropped).
+  bool push(const Record& record) {
+    auto* slot = ring_.tryAcquire();
+
+    if (slot == nullptr) {
+      droppedNumber_.fetch_add(1, std::memory_order_relaxed);
+
+      return false;
+    }
+
+    slot->record = record;
+    slot->isStop = false;
+    ring_.publish();
+
+    return true;
+  }
+
+  // The producer. Formats and writes the queued records, stops the thread and closes the file. Returns false if the
+  // file can't be written.
+  bool close() {
+    if (isClosed_) {
+      return !isFailed_.load(std::memory_order_relaxed);
+    }
+
+    isClosed_ = true;
+    ring_.acquire()->isStop = true;
+    ring_.publish();
+    thread_.join();
+
+    if (!closeFile()) {
+      isFailed_.store(true, std::memory_order_relaxed);
+    }
+
+    return !isFailed_.load(std::memory_order_relaxed);
+  }
+
+  // The number of the formatted records
+  [[nodiscard]] std::uint64_t getExportedNumber() const { return exportedNumber_.load(std::memory_order_relaxed); }
+
+  // The number of the records dropped because the ring was full
+  [[nodiscard]] std::uint64_t getDroppedNumber() const { return droppedNumber_.load(std::memory_order_relaxed); }
+
+  [[nodiscard]] std::uint64_t getWrittenBytes() const { return writtenBytes_.load(std::memory_order_relaxed); }
+
+  // Returns true if the file is written with O_DIRECT
+  [[nodiscard]] bool isDirectIo() const { return isDirect_; }
+
+  [[nodiscard]] bool isFailed() const { return isFailed_.load(std::memory_order_relaxed); }
+};
+
+}  // namespace dxf
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+
+namespace dxf {
+
+// The placement of the thread: the CPUs it may run on, the scheduling policy and the priority. The socket threads of
+// the connections (ConnectionPool), the threads of the executor (Executor), of the async books
+// (PriceLevelBookConfig::workerPlacement) and of the book shards (PriceLevelBookManager) apply it when they start, so
+// the scheduler doesn't move them between the sockets.
+struct ThreadPlacement {
+  enum class Policy {
+    // The policy of the thread is not changed
+    DEFAULT,
+    // The normal time-sharing policy (SCHED_OTHER), the priority is the nice value on Linux
+    NORMAL,
+    // The real-time policies (SCHED_FIFO, SCHED_RR), the priority is 1-99. Need the permissions (e.g. CAP_SYS_NICE).
+    FIFO,
+    ROUND_ROBIN
+  };
+
+  // The CPUs (empty - any)
+  std::vector<unsigned> cpus{};
+  Policy policy = Policy::DEFAULT;
+  // On Windows: the thread priority (THREAD_PRIORITY_*, -2 - 2, 15 - time critical) of any policy but DEFAULT
+  int priority = 0;
+  // The time the consumer threads (of the async books, of the book shards and of the dispatcher shards) busy-poll their
+  // empty queues before they block (0 - they block at once). Isn't applied by the applyToCurrentThread: the consumers
+  // read it (see WaitStrategy), as the yield and the adaptiveSpin.
+  std::chrono::microseconds spin{0};
+  // The time the consumer threads yield the CPU to the other threads after the spin before they block
+  std::chrono::microseconds yield{0};
+  // The maximum spin of the adaptive wait (0 - the spin is fixed): the spin is tuned by the observed wait times
+  std::chrono::microseconds adaptiveSpin{0};
+
+  // There is nothing to apply to the thread
+  [[nodiscard]] bool isEmpty() const { return cpus.empty() && policy == Policy::DEFAULT; }
+
+  // Parses the CPU list in the Linux format (e.g. "0-3,8,10-11"). Returns std::nullopt if the list is invalid.
+  static std::optional<std::vector<unsigned>> parseCpuList(std::string_view list) {
+    std::vector<unsigned> result{};
+
+    while (!list.empty()) {
+      auto end = std::min(list.find(','), list.size());
+      auto range = list.substr(0, end);
+      auto dash = range.find('-');
+      unsigned first = 0;
+      unsigned last = 0;
+      auto parse = [](std::string_view s, unsigned& value) {
+        auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+
+        return ec == std::errc{} && ptr == s.data() + s.size();
+      };
+
+      if (!parse(range.substr(0, dash), first) ||
+          !parse(dash == std::string_view::npos ? range : range.substr(dash + 1), last) || last < first) {
+        return std::nullopt;
+      }
+
+      for (auto cpu = first; cpu <= last; cpu++) {
+        result.push_back(cpu);
+      }
+
+      list.remove_prefix(std::min(end + 1, list.size()));
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+  }
+
+  // The CPUs of the NUMA node (Linux only, empty if unknown)
+  static std::vector<unsigned> getNumaNodeCpus(unsigned node) {
+    std::ifstream file{"/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"};
+    std::string list{};
+
+    if (!file || !std::getline(file, list)) {
+      return {};
+    }
+
+    while (!list.empty() && (list.back() == '\n' || list.back() == '\r' || list.back() == ' ')) {
+      list.pop_back();
+    }
+
+    return parseCpuList(list).value_or(std::vector<unsigned>{});
+  }
+
+  // The number of the NUMA nodes (Linux only, 0 if unknown). The nodes are numbered from 0.
+  static unsigned getNumaNodesNumber() {
+    unsigned result = 0;
+
+    while (!getNumaNodeCpus(result).empty()) {
+      result++;
+    }
+
+    return result;
+  }
+
+  // The placements of the threads on every NUMA node (e.g. the shards of the PriceLevelBookManager): threadsPerNode
+  // threads (0 - one per CPU of the node) of every node, pinned to the CPUs of their node, with the policy, the
+  // priority and the waits of the base. Empty if the nodes are unknown.
+  static std::vector<ThreadPlacement> getNumaPlacements(std::size_t threadsPerNode, const ThreadPlacement& base) {
+    std::vector<ThreadPlacement> result{};
+
+    for (unsigned node = 0;; node++) {
+      auto cpus = getNumaNodeCpus(node);
+
+      if (cpus.empty()) {
+        break;
+      }
+
+      auto placement = base;
+
+      placement.cpus = cpus;
+      result.insert(result.end(), threadsPerNode != 0 ? threadsPerNode : cpus.size(), placement);
+    }
+
+    return result;
+  }
+
+  static std::vector<ThreadPlacement> getNumaPlacements(std::size_t threadsPerNode = 0) {
+    return getNumaPlacements(threadsPerNode, ThreadPlacement{});
+  }
+
+  // Parses the placement of the "<key>=<value>[;<key>=<value>...]" format. The keys: cpus (the CPU list, e.g. 0-3,8),
+  // numa (the NUMA node, its CPUs are added to the cpus), policy (normal, fifo, rr), priority, spin, yield and adaptive
+  // (the maximum adaptive spin) in microseconds. Returns std::nullopt if the placement is invalid.
+  static std::optional<ThreadPlacement> parse(std::string_view spec) {
+    ThreadPlacement result{};
+
+    while (!spec.empty()) {
+      auto end = std::min(spec.find(';'), spec.size());
+      auto item = spec.substr(0, end);
+      auto equals = item.find('=');
+
+      spec.remove_prefix(std::min(end + 1, spec.size()));
+
+      if (item.empty()) {
+        continue;
+      }
+
+      if (equals == std::string_view::npos) {
+        return std::nullopt;
+      }
+
+      auto key = item.substr(0, equals);
+      auto value = item.substr(equals + 1);
+
+      if (key == "cpus") {
+        auto cpus = parseCpuList(value);
+
+        if (!cpus) {
+          return std::nullopt;
+        }
+
+        result.cpus.insert(result.cpus.end(), cpus->begin(), cpus->end());
+      } else if (key == "numa") {
+        unsigned node = 0;
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), node);
+        auto cpus = ec == std::errc{} && ptr == value.data() + value.size() ? getNumaNodeCpus(node)
+                                                                            : std::vector<unsigned>{};
+
+        if (cpus.empty()) {
+          return std::nullopt;
+        }
+
+        result.cpus.insert(result.cpus.end(), cpus.begin(), cpus.end());
+      } else if (key == "policy") {
+        if (value == "normal") {
+          result.policy = Policy::NORMAL;
+        } else if (value == "fifo") {
+          result.policy = Policy::FIFO;
+        } else if (value == "rr") {
+          result.policy = Policy::ROUND_ROBIN;
+        } else {
+          return std::nullopt;
+        }
+      } else if (key == "priority") {
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result.priority);
+
+        if (ec != std::errc{} || ptr != value.data() + value.size()) {
+          return std::nullopt;
+        }
+      } else if (key == "spin" || key == "yield" || key == "adaptive") {
+        unsigned time = 0;
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), time);
+
+        if (ec != std::errc{} || ptr != value.data() + value.size()) {
+          return std::nullopt;
+        }
+
+        (key == "spin" ? result.spin : key == "yield" ? result.yield : result.adaptiveSpin) =
+          std::chrono::microseconds{time};
+      } else {
+        return std::nullopt;
+      }
+    }
+
+    std::sort(result.cpus.begin(), result.cpus.end());
+    result.cpus.erase(std::unique(result.cpus.begin(), result.cpus.end()), result.cpus.end());
+
+    return result;
+  }
+
+  // Applies the placement to the calling thread. Returns false if any part can't be applied (e.g. the real-time
+  // policy without the permissions, the unsupported platform).
+  bool applyToCurrentThread() const {
+    auto isApplied = true;
+
+#ifdef _WIN32
+    if (!cpus.empty()) {
+      DWORD_PTR mask = 0;
+
+      for (auto cpu : cpus) {
+        if (cpu < sizeof(DWORD_PTR) * 8) {
+          mask |= DWORD_PTR{1} << cpu;
+        }
+      }
+
+      isApplied = mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+    }
+
+    if (policy != Policy::DEFAULT) {
+      isApplied = SetThreadPriority(GetCurrentThread(), priority) != 0 && isApplied;
+    }
+#elif defined(__linux__)
+    if (!cpus.empty()) {
+      cpu_set_t set{};
+
+      CPU_ZERO(&set);
+
+      for (auto cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+          CPU_SET(cpu, &set);
+        }
+      }
+
+      isApplied = CPU_COUNT(&set) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+    if (policy == Policy::NORMAL) {
+      sched_param param{};
+
+      isApplied = pthread_setschedparam(pthread_self(), SCHED_OTHER, &param) == 0 && isApplied;
+      // The nice value of the thread (Linux threads have their own nice values)
+      isApplied = (priority == 0 || setpriority(PRIO_PROCESS, 0, priority) == 0) && isApplied;
+    } else if (policy == Policy::FIFO || policy == Policy::ROUND_ROBIN) {
+      sched_param param{};
+
+      param.sched_priority = priority;
+      isApplied =
+        pthread_setschedparam(pthread_self(), policy == Policy::FIFO ? SCHED_FIFO : SCHED_RR, &param) == 0 &&
+        isApplied;
+    }
+#else
+    isApplied = isEmpty();
+#endif
+
+    return isApplied;
+  }
+
+  // Names the current thread (Linux only, up to 15 chars), so its role is seen by the tools (top, perf, gdb) and by
+  // PerfCounters. The C++ processing threads of the API are named "dxf-...". Returns false if the name isn't set.
+  static bool setCurrentThreadName(std::string_view name) {
+#if defined(__linux__)
+    char buffer[16]{};
+
+    name.copy(buffer, sizeof(buffer) - 1);
+
+    return pthread_setname_np(pthread_self(), buffer) == 0;
+#else
+    (void)name;
+
+    return false;
+#endif
+  }
+};
+
+}  // namespace dxf
@@ -3,12 +3,19 @@
 #include <DXFeed.h>
 
 #include <cstdint>
+#include <limits>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 
+#include "EventTraits.hpp"
+#include "InlineString.hpp"
 #include "MarketEvent.hpp"
 #include "OrderScope.hpp"
 #include "OrderSide.hpp"
 #include "StringConverter.hpp"
+#include "SymbolTable.hpp"
 #include "TimeSeriesEvent.hpp"
 
 namespace dxf {
@@ -16,6 +23,11 @@ namespace dxf {
 enum class TimeAndSaleType : int { NEW = 0, CORRECTION = 1, CANCEL = 2 };
 
 class TimeAndSale final : public MarketEvent, public TimeSeriesEvent<std::string> {
+ public:
+  // The string of the short fields (the sale conditions, the buyer and the seller): up to 14 chars are kept in place
+  using ShortString = InlineString<14>;
+
+ private:
   std::uint32_t eventFlags_{};
   std::uint64_t index_{};
   std::uint64_t time_{};
@@ -24,10 +36,10 @@ class TimeAndSale final : public MarketEvent, public TimeSeriesEvent<std::string
   double size_{std::numeric_limits<double>::quiet_NaN()};
   double bidPrice_{std::numeric_limits<double>::quiet_NaN()};
   double askPrice_{std::numeric_limits<double>::quiet_NaN()};
-  std::string exchangeSaleConditions_{};
+  ShortString exchangeSaleConditions_{};
   std::int32_t flags_{};
-  std::string buyer_{};
-  std::string seller_{};
+  ShortString buyer_{};
+  ShortString seller_{};
   OrderSide side_{};
   TimeAndSaleType type_{};
   bool isValidTick_ = false;
@@ -39,10 +51,24 @@ class TimeAndSale final : public MarketEvent, public TimeSeriesEvent<std::string
  public:
   TimeAndSale() = default;
 
+  // The destructor is declared, so the moves must be declared too (otherwise the vectors copy the events on growth)
+  TimeAndSale(const TimeAndSale &) = default;
+  TimeAndSale(TimeAndSale &&) noexcept = default;
+  TimeAndSale &operator=(const TimeAndSale &) = default;
+  TimeAndSale &operator=(TimeAndSale &&) noexcept = default;
+
   explicit TimeAndSale(const std::string &eventSymbol) : MarketEvent(eventSymbol) {}
 
   explicit TimeAndSale(const std::string &eventSymbol, const dxf_time_and_sale_t &tns)
-      : MarketEvent(eventSymbol),
+      : TimeAndSale(std::make_shared<const std::string>(eventSymbol), tns) {}
+
+  // The event of the interned symbol (shares its name)
+  explicit TimeAndSale(const Symbol &eventSymbol, const dxf_time_and_sale_t &tns)
+      : TimeAndSale(eventSymbol.getSharedName(), tns) {}
+
+  // The event of the shared (e.g. interned) symbol
+  explicit TimeAndSale(std::shared_ptr<const std::string> eventSymbol, const dxf_time_and_sale_t &tns)
+      : MarketEvent(std::move(eventSymbol)),
         eventFlags_{tns.event_flags},
         index_{static_cast<uint64_t>(tns.index)},
         time_{static_cast<uint64_t>(tns.time)},
@@ -51,10 +77,10 @@ class TimeAndSale final : public MarketEvent, public TimeSeriesEvent<std::string
         size_{tns.size},
         bidPrice_{tns.bid_price},
         askPrice_{tns.ask_price},
-        exchangeSaleConditions_(StringConverter::wStringToUtf8(tns.exchange_sale_conditions)),
+        exchangeSaleConditions_(ShortString::fromUtf16(tns.exchange_sale_conditions)),
         flags_{tns.raw_flags},
-        buyer_(StringConverter::wStringToUtf8(tns.buyer)),
-        seller_(StringConverter::wStringToUtf8(tns.seller)),
+        buyer_(ShortString::fromUtf16(tns.buyer)),
+        seller_(ShortString::fromUtf16(tns.seller)),
         side_{static_cast<OrderSide>(tns.side)},
         type_{static_cast<TimeAndSaleType>(tns.type)},
         isValidTick_{static_cast<bool>(tns.is_valid_tick)},
@@ -67,6 +93,10 @@ class TimeAndSale final : public MarketEvent, public TimeSeriesEvent<std::string
 
   void setEventSymbol(const std::string &eventSymbol) override { MarketEvent::setEventSymbol(eventSymbol); }
 
+  void setEventSymbol(std::shared_ptr<const std::string> eventSymbol) {
+    MarketEvent::setEventSymbol(std::move(eventSymbol));
+  }
+
   uint64_t getEventTime() override { return MarketEvent::getEventTime(); }
 
   void setEventTime(std::uint64_t eventTime) override { MarketEvent::setEventTime(eventTime); }
@@ -103,9 +133,9 @@ class TimeAndSale final : public MarketEvent, public TimeSeriesEvent<std::string
 
   void setAskPrice(double askPrice) { askPrice_ = askPrice; }
 
-  [[nodiscard]] const std::string &getExchangeSaleConditions() const { return exchangeSaleConditions_; }
+  [[nodiscard]] std::string_view getExchangeSaleConditions() const { return exchangeSaleConditions_; }
 
-  void setExchangeSaleConditions(const std::string &exchangeSaleConditions) {
+  void setExchangeSaleConditions(std::string_view exchangeSaleConditions) {
     exchangeSaleConditions_ = exchangeSaleConditions;
   }
 
@@ -113,13 +143,13 @@ class TimeAndSale final : public MarketEvent, public TimeSeriesEvent<std::string
 
   void setFlags(int32_t flags) { flags_ = flags; }
 
-  [[nodiscard]] const std::string &getBuyer() const { return buyer_; }
+  [[nodiscard]] std::string_view getBuyer() const { return buyer_; }
 
-  void setBuyer(const std::string &buyer) { buyer_ = buyer; }
+  void setBuyer(std::string_view buyer) { buyer_ = buyer; }
 
-  [[nodiscard]] const std::string &getSeller() const { return seller_; }
+  [[nodiscard]] std::string_view getSeller() const { return seller_; }
 
-  void setSeller(const std::string &seller) { seller_ = seller; }
+  void setSeller(std::string_view seller) { seller_ = seller; }
 
   [[nodiscard]] OrderSide getSide() const { return side_; }
 
@@ -152,4 +182,16 @@ class TimeAndSale final : public MarketEvent, public TimeSeriesEvent<std::string
   ~TimeAndSale() override = default;
 };
 
-}
\ No newline at end of file
+
+// The class is final, so the calls are not virtual. The getters of IndexedEvent are not const, but don't modify the
+// event.
+template <>
+struct EventTraits<TimeAndSale> {
+  static std::uint64_t getIndex(const TimeAndSale &e) { return const_cast<TimeAndSale &>(e).getIndex(); }
+
+  static std::uint32_t getEventFlags(const TimeAndSale &e) { return const_cast<TimeAndSale &>(e).getEventFlags(); }
+
+  static std::uint64_t getTime(const TimeAndSale &e) { return e.getTime(); }
+};
+
+}  // namespace dxf
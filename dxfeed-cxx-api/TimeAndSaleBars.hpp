@@ -0,0 +1,488 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "EventTraits.hpp"
+#include "SymbolTable.hpp"
+#include "TimeAndSale.hpp"
+#include "TimeAndSaleColumns.hpp"
+
+namespace dxf {
+
+// The OHLCV bar of the trades of one period: [time, time + period)
+struct TradeBar {
+  // The start of the period (ms)
+  std::int64_t time = 0;
+  double open = std::numeric_limits<double>::quiet_NaN();
+  double high = std::numeric_limits<double>::quiet_NaN();
+  double low = std::numeric_limits<double>::quiet_NaN();
+  double close = std::numeric_limits<double>::quiet_NaN();
+  double volume = 0.0;
+  // The sum of the price * size
+  double turnover = 0.0;
+  std::uint64_t count = 0;
+
+  // The volume-weighted average price (NaN if the volume is 0)
+  [[nodiscard]] double getVwap() const {
+    return volume != 0.0 ? turnover / volume : std::numeric_limits<double>::quiet_NaN();
+  }
+};
+
+// The incremental aggregation of the TimeAndSale streams to the bars of several periods (e.g. 1s, 1m and 5m) per
+// symbol: the open, the high, the low and the close, the volume, the VWAP and the number of the trades.
+//
+// The trades of the retention window (from the latest trade time back) are kept ordered by the index, so the
+// CORRECTION (the trade of the same index is replaced), the CANCEL and the REMOVE_EVENT (the trade is removed) and the
+// late trades rebuild the bars they touch from the kept trades; the open and the close are the first and the last
+// trades of the bar by the index. The changes of the trades that are out of the window are ignored (expiredNumber).
+// The trades without the price or the size (NaN) are ignored.
+//
+// The batch of the new trades that follow the kept ones (the usual case of the stream) is merged by the runs of the
+// trades of the same bar: the sums, the minimum and the maximum of the run are the independent lanes, so the loops are
+// vectorized by the compiler (the same as TimeAndSaleColumns::getVwap). The rest is applied trade by trade.
+//
+// Usage:
+//   TimeAndSaleBarAggregator bars{{1000, 60000, 300000}, 3600000};
+//
+//   bars.update(symbol, tns, count);   // e.g. in the EventReceiver::receiveBatchesAsync handler
+//   auto minute = bars.getLatestBar(symbol, 1);
+//
+// Not thread-safe: one thread updates and reads the aggregator (e.g. the symbols are sharded by the threads).
+class TimeAndSaleBarAggregator final {
+ public:
+  struct Stats {
+    std::uint64_t tradesNumber = 0;
+    // The trades merged by the batch runs
+    std::uint64_t batchedNumber = 0;
+    std::uint64_t correctionsNumber = 0;
+    // The CANCEL and the REMOVE_EVENT trades
+    std::uint64_t removalsNumber = 0;
+    // The trades with the index before the latest one
+    std::uint64_t lateNumber = 0;
+    // The changes of the trades that are out of the retention window or unknown
+    std::uint64_t expiredNumber = 0;
+    // The bars rebuilt from the kept trades
+    std::uint64_t rebuildsNumber = 0;
+  };
+
+ private:
+  using Flags = EventFlags::Flags;
+
+  struct Trade {
+    std::int64_t index;
+    std::int64_t time;
+    double price;
+    double size;
+  };
+
+  // The bars of one period, ordered by the time
+  struct Series {
+    std::int64_t period;
+    std::deque<TradeBar> bars{};
+  };
+
+  struct SymbolState {
+    std::deque<Trade> trades{};
+    std::vector<Series> series{};
+    std::int64_t latestTime = std::numeric_limits<std::int64_t>::min();
+  };
+
+  // The columns of the trades of the batch (the rows of TimeAndSaleColumns or of the converted listener data)
+  struct TradeColumns {
+    const std::int64_t* time;
+    const std::int64_t* index;
+    const double* price;
+    const double* size;
+    const TimeAndSaleType* type;
+    const std::uint32_t* eventFlags;
+  };
+
+  std::vector<std::int64_t> periods_;
+  std::int64_t retention_;
+  // By the id of the interned symbol
+  std::vector<std::unique_ptr<SymbolState>> states_{};
+  Stats stats_{};
+
+  // The scratch columns of the listener data (the capacity is kept)
+  std::vector<std::int64_t> time_{};
+  std::vector<std::int64_t> index_{};
+  std::vector<double> price_{};
+  std::vector<double> size_{};
+  std::vector<TimeAndSaleType> type_{};
+  std::vector<std::uint32_t> eventFlags_{};
+
+  static std::int64_t getBarTime(std::int64_t time, std::int64_t period) {
+    auto result = time / period * period;
+
+    return result > time ? result - period : result;
+  }
+
+  static bool isValid(double price, double size) { return !std::isnan(price) && !std::isnan(size); }
+
+  SymbolState& getState(const Symbol& symbol) {
+    auto id = symbol.getId();
+
+    if (id >= states_.size()) {
+      states_.resize(static_cast<std::size_t>(id) + 1);
+    }
+
+    auto& state = states_[id];
+
+    if (!state) {
+      state = std::make_unique<SymbolState>();
+
+      for (auto period : periods_) {
+        state->series.push_back(Series{period});
+      }
+    }
+
+    return *state;
+  }
+
+  [[nodiscard]] const SymbolState* findState(const Symbol& symbol) const {
+    auto id = symbol.getId();
+
+    return id < states_.size() ? states_[id].get() : nullptr;
+  }
+
+  // Returns the bar of the time (creates it in the order if there is none)
+  static std::deque<TradeBar>::iterator getBar(Series& series, std::int64_t barTime) {
+    if (!series.bars.empty() && series.bars.back().time == barTime) {
+      return std::prev(series.bars.end());
+    }
+
+    auto found = std::lower_bound(series.bars.begin(), series.bars.end(), barTime,
+                                  [](const TradeBar& bar, std::int64_t time) { return bar.time < time; });
+
+    if (found != series.bars.end() && found->time == barTime) {
+      return found;
+    }
+
+    return series.bars.insert(found, TradeBar{barTime});
+  }
+
+  // Merges the trade that follows the trades of the bar
+  static void merge(TradeBar& bar, double price, double size) {
+    if (bar.count == 0) {
+      bar.open = bar.high = bar.low = price;
+    } else {
+      bar.high = (std::max)(bar.high, price);
+      bar.low = (std::min)(bar.low, price);
+    }
+
+    bar.close = price;
+    bar.volume += size;
+    bar.turnover += price * size;
+    bar.count++;
+  }
+
+  // Merges the run of the trades of the same bar that follow its trades. The independent lanes of the sums, the
+  // minimums and the maximums are vectorized.
+  static void mergeRun(TradeBar& bar, const double* price, const double* size, std::size_t count) {
+    double volumes[4]{};
+    double turnovers[4]{};
+    double lows[4]{price[0], price[0], price[0], price[0]};
+    double highs[4]{price[0], price[0], price[0], price[0]};
+    std::size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+      for (std::size_t lane = 0; lane < 4; lane++) {
+        volumes[lane] += size[i + lane];
+        turnovers[lane] += price[i + lane] * size[i + lane];
+        lows[lane] = lows[lane] < price[i + lane] ? lows[lane] : price[i + lane];
+        highs[lane] = highs[lane] > price[i + lane] ? highs[lane] : price[i + lane];
+      }
+    }
+
+    for (; i < count; i++) {
+      volumes[0] += size[i];
+      turnovers[0] += price[i] * size[i];
+      lows[0] = lows[0] < price[i] ? lows[0] : price[i];
+      highs[0] = highs[0] > price[i] ? highs[0] : price[i];
+    }
+
+    auto low = (std::min)((std::min)(lows[0], lows[1]), (std::min)(lows[2], lows[3]));
+    auto high = (std::max)((std::max)(highs[0], highs[1]), (std::max)(highs[2], highs[3]));
+
+    if (bar.count == 0) {
+      bar.open = price[0];
+      bar.low = low;
+      bar.high = high;
+    } else {
+      bar.low = (std::min)(bar.low, low);
+      bar.high = (std::max)(bar.high, high);
+    }
+
+    bar.close = price[count - 1];
+    bar.volume += (volumes[0] + volumes[1]) + (volumes[2] + volumes[3]);
+    bar.turnover += (turnovers[0] + turnovers[1]) + (turnovers[2] + turnovers[3]);
+    bar.count += count;
+  }
+
+  // Rebuilds the bars of the time of every period from the kept trades (the empty bars are removed)
+  void rebuild(SymbolState& state, std::int64_t time) {
+    for (auto& series : state.series) {
+      auto barTime = getBarTime(time, series.period);
+      auto bar = getBar(series, barTime);
+
+      *bar = TradeBar{barTime};
+
+      for (const auto& trade : state.trades) {
+        if (trade.time >= barTime && trade.time - barTime < series.period) {
+          merge(*bar, trade.price, trade.size);
+        }
+      }
+
+      if (bar->count == 0) {
+        series.bars.erase(bar);
+      }
+
+      stats_.rebuildsNumber++;
+    }
+  }
+
+  std::deque<Trade>::iterator findTrade(SymbolState& state, std::int64_t index) {
+    auto found = std::lower_bound(state.trades.begin(), state.trades.end(), index,
+                                  [](const Trade& trade, std::int64_t i) { return trade.index < i; });
+
+    return found != state.trades.end() && found->index == index ? found : state.trades.end();
+  }
+
+  // Drops the trades and the bars that are out of the retention window
+  void expire(SymbolState& state) {
+    auto cutoff = state.latestTime - retention_;
+
+    while (!state.trades.empty() && state.trades.front().time < cutoff) {
+      state.trades.pop_front();
+    }
+
+    for (auto& series : state.series) {
+      while (!series.bars.empty() && series.bars.front().time + series.period <= cutoff) {
+        series.bars.pop_front();
+      }
+    }
+  }
+
+  bool isExpired(const SymbolState& state, std::int64_t time) const {
+    return state.latestTime != std::numeric_limits<std::int64_t>::min() && time < state.latestTime - retention_;
+  }
+
+  // Applies the trade by its type and flags
+  void apply(SymbolState& state, std::int64_t time, std::int64_t index, double price, double size,
+             TimeAndSaleType type, std::uint32_t eventFlags) {
+    auto isRemoval = (eventFlags & Flags::REMOVE_EVENT) != 0 || type == TimeAndSaleType::CANCEL;
+
+    if (isRemoval || type == TimeAndSaleType::CORRECTION) {
+      isRemoval ? stats_.removalsNumber++ : stats_.correctionsNumber++;
+
+      auto found = findTrade(state, index);
+
+      if (found == state.trades.end()) {
+        // The correction of the unknown trade within the window is the new trade
+        if (isRemoval || isExpired(state, time) || !isValid(price, size)) {
+          stats_.expiredNumber++;
+
+          return;
+        }
+      } else {
+        auto oldTime = found->time;
+
+        if (isRemoval || !isValid(price, size)) {
+          state.trades.erase(found);
+        } else {
+          *found = Trade{index, time, price, size};
+        }
+
+        rebuild(state, oldTime);
+
+        if (!isRemoval && time != oldTime) {
+          rebuild(state, time);
+        }
+
+        return;
+      }
+    }
+
+    if (!isValid(price, size) || isExpired(state, time)) {
+      return;
+    }
+
+    stats_.tradesNumber++;
+
+    if (state.trades.empty() || index > state.trades.back().index) {
+      state.trades.push_back(Trade{index, time, price, size});
+
+      for (auto& series : state.series) {
+        merge(*getBar(series, getBarTime(time, series.period)), price, size);
+      }
+    } else {
+      // The late trade or the repeated index: the bars are rebuilt in the order of the indexes
+      auto position = std::lower_bound(state.trades.begin(), state.trades.end(), index,
+                                       [](const Trade& trade, std::int64_t i) { return trade.index < i; });
+      auto oldTime = time;
+
+      if (position->index == index) {
+        oldTime = position->time;
+        *position = Trade{index, time, price, size};
+      } else {
+        state.trades.insert(position, Trade{index, time, price, size});
+      }
+
+      stats_.lateNumber++;
+      rebuild(state, time);
+
+      if (oldTime != time) {
+        rebuild(state, oldTime);
+      }
+    }
+
+    state.latestTime = (std::max)(state.latestTime, time);
+  }
+
+  // The batch can be merged by the runs: the new valid trades that follow the kept ones by the index
+  [[nodiscard]] bool isAppendable(const SymbolState& state, const TradeColumns& trades, std::size_t count) const {
+    auto lastIndex = state.trades.empty() ? std::numeric_limits<std::int64_t>::min() : state.trades.back().index;
+    auto isAppendable = true;
+
+    for (std::size_t i = 0; i < count; i++) {
+      isAppendable &= trades.type[i] == TimeAndSaleType::NEW && (trades.eventFlags[i] & Flags::REMOVE_EVENT) == 0 &&
+                      trades.index[i] > lastIndex && isValid(trades.price[i], trades.size[i]) &&
+                      !isExpired(state, trades.time[i]);
+      lastIndex = trades.index[i];
+    }
+
+    return isAppendable;
+  }
+
+  void updateColumns(SymbolState& state, const TradeColumns& trades, std::size_t count) {
+    if (count == 0) {
+      return;
+    }
+
+    if (!isAppendable(state, trades, count)) {
+      for (std::size_t i = 0; i < count; i++) {
+        apply(state, trades.time[i], trades.index[i], trades.price[i], trades.size[i], trades.type[i],
+              trades.eventFlags[i]);
+      }
+
+      expire(state);
+
+      return;
+    }
+
+    for (std::size_t i = 0; i < count; i++) {
+      state.trades.push_back(Trade{trades.index[i], trades.time[i], trades.price[i], trades.size[i]});
+      state.latestTime = (std::max)(state.latestTime, trades.time[i]);
+    }
+
+    for (auto& series : state.series) {
+      std::size_t runStart = 0;
+
+      while (runStart < count) {
+        auto barTime = getBarTime(trades.time[runStart], series.period);
+        auto runEnd = runStart + 1;
+
+        while (runEnd < count && trades.time[runEnd] >= barTime && trades.time[runEnd] - barTime < series.period) {
+          runEnd++;
+        }
+
+        mergeRun(*getBar(series, barTime), trades.price + runStart, trades.size + runStart, runEnd - runStart);
+        runStart = runEnd;
+      }
+    }
+
+    stats_.tradesNumber += count;
+    stats_.batchedNumber += count;
+    expire(state);
+  }
+
+ public:
+  // periods - the periods of the bars (ms, positive), retention - the time window of the kept trades and bars (ms)
+  TimeAndSaleBarAggregator(std::vector<std::int64_t> periods, std::int64_t retention)
+      : periods_{std::move(periods)}, retention_{retention} {}
+
+  TimeAndSaleBarAggregator(const TimeAndSaleBarAggregator&) = delete;
+  TimeAndSaleBarAggregator& operator=(const TimeAndSaleBarAggregator&) = delete;
+
+  void update(const Symbol& symbol, const TimeAndSale& tns) {
+    auto& state = getState(symbol);
+
+    apply(state, static_cast<std::int64_t>(tns.getTime()),
+          static_cast<std::int64_t>(EventTraits<TimeAndSale>::getIndex(tns)), tns.getPrice(), tns.getSize(),
+          tns.getType(), EventTraits<TimeAndSale>::getEventFlags(tns));
+    expire(state);
+  }
+
+  // Updates by the listener data of the symbol: the fields are converted to the columns at once
+  void update(const Symbol& symbol, const dxf_time_and_sale_t* tns, std::size_t count) {
+    time_.resize(count);
+    index_.resize(count);
+    price_.resize(count);
+    size_.resize(count);
+    type_.resize(count);
+    eventFlags_.resize(count);
+
+    for (std::size_t i = 0; i < count; i++) {
+      time_[i] = static_cast<std::int64_t>(tns[i].time);
+      index_[i] = static_cast<std::int64_t>(tns[i].index);
+      price_[i] = tns[i].price;
+      size_[i] = tns[i].size;
+      type_[i] = static_cast<TimeAndSaleType>(tns[i].raw_flags & TimeAndSaleBatchConverter::TYPE_MASK);
+      eventFlags_[i] = static_cast<std::uint32_t>(tns[i].event_flags);
+    }
+
+    updateColumns(
+      getState(symbol),
+      TradeColumns{time_.data(), index_.data(), price_.data(), size_.data(), type_.data(), eventFlags_.data()}, count);
+  }
+
+  // Updates by the rows [first, first + count) of the columnar storage of the symbol
+  void update(const Symbol& symbol, const TimeAndSaleColumns& columns, std::size_t first, std::size_t count) {
+    updateColumns(getState(symbol),
+                  TradeColumns{columns.time.data() + first, columns.index.data() + first, columns.price.data() + first,
+                               columns.size.data() + first, columns.type.data() + first,
+                               columns.eventFlags.data() + first},
+                  count);
+  }
+
+  [[nodiscard]] const std::vector<std::int64_t>& getPeriods() const { return periods_; }
+
+  // The kept bars of the period (by its position in the periods), ordered by the time. The last one may be open.
+  [[nodiscard]] std::vector<TradeBar> getBars(const Symbol& symbol, std::size_t periodIndex) const {
+    const auto* state = findState(symbol);
+
+    if (state == nullptr || periodIndex >= state->series.size()) {
+      return {};
+    }
+
+    const auto& bars = state->series[periodIndex].bars;
+
+    return {bars.begin(), bars.end()};
+  }
+
+  [[nodiscard]] std::optional<TradeBar> getLatestBar(const Symbol& symbol, std::size_t periodIndex) const {
+    const auto* state = findState(symbol);
+
+    if (state == nullptr || periodIndex >= state->series.size() || state->series[periodIndex].bars.empty()) {
+      return std::nullopt;
+    }
+
+    return state->series[periodIndex].bars.back();
+  }
+
+  [[nodiscard]] const Stats& getStats() const { return stats_; }
+};
+
+}  // namespace dxf
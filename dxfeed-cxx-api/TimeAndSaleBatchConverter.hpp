@@ -0,0 +1,309 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "CpuFeatures.hpp"
+#include "OrderScope.hpp"
+#include "OrderSide.hpp"
+#include "StringConverter.hpp"
+#include "TimeAndSale.hpp"
+
+namespace dxf {
+
+enum class BatchConversionStrategy : int {
+  // The loop over the events
+  SCALAR = 0,
+  // 4 or 8 events per the gather of the field (x86-64 with AVX2)
+  AVX2 = 1,
+  // 8 events per the unpacking of the flags and the packing of the narrow columns (AArch64)
+  NEON = 2
+};
+
+// The columns of the batch (see TimeAndSaleBatchConverter): every pointer is the first element of the count elements
+struct TimeAndSaleBatchColumns {
+  std::int64_t* time = nullptr;
+  std::int64_t* index = nullptr;
+  double* price = nullptr;
+  double* size = nullptr;
+  double* bidPrice = nullptr;
+  double* askPrice = nullptr;
+  std::uint32_t* eventFlags = nullptr;
+  std::int32_t* flags = nullptr;
+  OrderSide* side = nullptr;
+  TimeAndSaleType* type = nullptr;
+  OrderScope* scope = nullptr;
+  // The VALID_TICK, ETH_TRADE and SPREAD_LEG bits (see TimeAndSaleColumns)
+  std::uint8_t* attributes = nullptr;
+  char* tradeThroughExempt = nullptr;
+  char* exchangeCode = nullptr;
+};
+
+// Converts the array of the C API events (the listener data) to the columns at once. The side, the type, the
+// attributes and the trade through exempt are unpacked from the raw flags (the C API fields are derived from them the
+// same way):
+//
+// 15..8 - trade through exempt, 6..5 - side, 4 - spread leg, 3 - ETH, 2 - valid tick, 1..0 - type
+//
+// The strings are not converted (see TimeAndSaleColumns::append). The vector strategy gathers every field from the
+// events with the stride of the struct (AVX2) or unpacks the flags of the events by the lanes (NEON); it's selected at
+// run time by the CPU feature detection.
+struct TimeAndSaleBatchConverter {
+  static constexpr std::int32_t TYPE_MASK = 0x3;
+  static constexpr int ATTRIBUTES_SHIFT = 2;
+  static constexpr std::int32_t ATTRIBUTES_MASK = 0x7;
+  static constexpr int SIDE_SHIFT = 5;
+  static constexpr std::int32_t SIDE_MASK = 0x3;
+  static constexpr int TTE_SHIFT = 8;
+  static constexpr std::int32_t TTE_MASK = 0xFF;
+
+ private:
+  // The 32-bit gathers of the flags, the enums and the 64-bit ones of the time and the index
+  static constexpr bool IS_GATHER_SUPPORTED =
+    sizeof(dxf_event_flags_t) == 4 && sizeof(dxf_int_t) == 4 && sizeof(dxf_order_scope_t) == 4 &&
+    sizeof(dxf_long_t) == 8 && sizeof(dxf_double_t) == 8 && sizeof(dxf_time_and_sale_t) * 8 < (1U << 31);
+
+  static std::atomic<BatchConversionStrategy>& strategy() {
+    static std::atomic<BatchConversionStrategy> strategy{getSupportedStrategy()};
+
+    return strategy;
+  }
+
+  static void convertScalar(const dxf_time_and_sale_t* tns, std::size_t count, const TimeAndSaleBatchColumns& out) {
+    for (std::size_t i = 0; i < count; i++) {
+      auto flags = static_cast<std::int32_t>(tns[i].raw_flags);
+
+      out.time[i] = static_cast<std::int64_t>(tns[i].time);
+      out.index[i] = static_cast<std::int64_t>(tns[i].index);
+      out.price[i] = tns[i].price;
+      out.size[i] = tns[i].size;
+      out.bidPrice[i] = tns[i].bid_price;
+      out.askPrice[i] = tns[i].ask_price;
+      out.eventFlags[i] = static_cast<std::uint32_t>(tns[i].event_flags);
+      out.flags[i] = flags;
+      out.side[i] = static_cast<OrderSide>((flags >> SIDE_SHIFT) & SIDE_MASK);
+      out.type[i] = static_cast<TimeAndSaleType>(flags & TYPE_MASK);
+      out.scope[i] = static_cast<OrderScope>(tns[i].scope);
+      out.attributes[i] = static_cast<std::uint8_t>((flags >> ATTRIBUTES_SHIFT) & ATTRIBUTES_MASK);
+      out.tradeThroughExempt[i] = static_cast<char>((flags >> TTE_SHIFT) & TTE_MASK);
+      out.exchangeCode[i] = StringConverter::wCharToUtf8(tns[i].exchange_code);
+    }
+  }
+
+#ifdef DXFCXX_CPU_X86
+  template <typename T>
+  static const T* getField(const dxf_time_and_sale_t* tns, std::size_t offset) {
+    return reinterpret_cast<const T*>(reinterpret_cast<const char*>(tns) + offset);
+  }
+
+  // The gathers of the field of the 4 or 8 events (the masked ones with the zero source, so the lanes are defined)
+  DXFCXX_TARGET_AVX2 static __m256d gatherDoubles(const dxf_time_and_sale_t* tns, std::size_t offset,
+                                                  __m128i offsets) {
+    auto zero = _mm256_setzero_pd();
+
+    return _mm256_mask_i32gather_pd(zero, getField<double>(tns, offset), offsets, _mm256_cmp_pd(zero, zero, _CMP_EQ_OQ),
+                                    1);
+  }
+
+  DXFCXX_TARGET_AVX2 static __m256i gatherLongs(const dxf_time_and_sale_t* tns, std::size_t offset, __m128i offsets) {
+    return _mm256_mask_i32gather_epi64(_mm256_setzero_si256(), getField<long long>(tns, offset), offsets,
+                                       _mm256_set1_epi64x(-1), 1);
+  }
+
+  DXFCXX_TARGET_AVX2 static __m256i gatherInts(const dxf_time_and_sale_t* tns, std::size_t offset, __m256i offsets) {
+    return _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), getField<int>(tns, offset), offsets,
+                                       _mm256_set1_epi32(-1), 1);
+  }
+
+  // Packs the 8 32-bit lanes (0..255) to the 8 bytes
+  DXFCXX_TARGET_AVX2 static void storeBytes(void* out, __m256i lanes) {
+    auto words = _mm_packus_epi32(_mm256_castsi256_si128(lanes), _mm256_extracti128_si256(lanes, 1));
+
+    _mm_storel_epi64(static_cast<__m128i*>(out), _mm_packus_epi16(words, words));
+  }
+
+  DXFCXX_TARGET_AVX2 static void convertAvx2(const dxf_time_and_sale_t* tns, std::size_t count,
+                                             const TimeAndSaleBatchColumns& out) {
+    constexpr int STRIDE = static_cast<int>(sizeof(dxf_time_and_sale_t));
+    // The 16-bit wchar_t is read with the next 2 bytes of the struct (the padding before the price)
+    constexpr std::int32_t CHAR_MASK = sizeof(dxf_char_t) == 2 ? 0xFFFF : -1;
+    const auto offsets4 = _mm_setr_epi32(0, STRIDE, 2 * STRIDE, 3 * STRIDE);
+    const auto offsets8 =
+      _mm256_setr_epi32(0, STRIDE, 2 * STRIDE, 3 * STRIDE, 4 * STRIDE, 5 * STRIDE, 6 * STRIDE, 7 * STRIDE);
+    std::size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+      for (std::size_t half = 0; half < 8; half += 4) {
+        const auto* events = tns + i + half;
+        auto position = i + half;
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.time + position),
+                            gatherLongs(events, offsetof(dxf_time_and_sale_t, time), offsets4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.index + position),
+                            gatherLongs(events, offsetof(dxf_time_and_sale_t, index), offsets4));
+        _mm256_storeu_pd(out.price + position, gatherDoubles(events, offsetof(dxf_time_and_sale_t, price), offsets4));
+        _mm256_storeu_pd(out.size + position, gatherDoubles(events, offsetof(dxf_time_and_sale_t, size), offsets4));
+        _mm256_storeu_pd(out.bidPrice + position,
+                         gatherDoubles(events, offsetof(dxf_time_and_sale_t, bid_price), offsets4));
+        _mm256_storeu_pd(out.askPrice + position,
+                         gatherDoubles(events, offsetof(dxf_time_and_sale_t, ask_price), offsets4));
+      }
+
+      const auto* events = tns + i;
+      auto flags = gatherInts(events, offsetof(dxf_time_and_sale_t, raw_flags), offsets8);
+      auto exchangeCodes = _mm256_and_si256(gatherInts(events, offsetof(dxf_time_and_sale_t, exchange_code), offsets8),
+                                            _mm256_set1_epi32(CHAR_MASK));
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.eventFlags + i),
+                          gatherInts(events, offsetof(dxf_time_and_sale_t, event_flags), offsets8));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.flags + i), flags);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.scope + i),
+                          gatherInts(events, offsetof(dxf_time_and_sale_t, scope), offsets8));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.side + i),
+                          _mm256_and_si256(_mm256_srli_epi32(flags, SIDE_SHIFT), _mm256_set1_epi32(SIDE_MASK)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out.type + i),
+                          _mm256_and_si256(flags, _mm256_set1_epi32(TYPE_MASK)));
+      storeBytes(out.attributes + i,
+                 _mm256_and_si256(_mm256_srli_epi32(flags, ATTRIBUTES_SHIFT), _mm256_set1_epi32(ATTRIBUTES_MASK)));
+      storeBytes(out.tradeThroughExempt + i,
+                 _mm256_and_si256(_mm256_srli_epi32(flags, TTE_SHIFT), _mm256_set1_epi32(TTE_MASK)));
+
+      // The ASCII codes are packed, the other ones are converted one by one
+      if (_mm256_testz_si256(exchangeCodes, _mm256_set1_epi32(~0x7F)) != 0) {
+        storeBytes(out.exchangeCode + i, exchangeCodes);
+      } else {
+        for (std::size_t j = i; j < i + 8; j++) {
+          out.exchangeCode[j] = StringConverter::wCharToUtf8(tns[j].exchange_code);
+        }
+      }
+    }
+
+    if (i < count) {
+      convertScalar(tns + i, count - i,
+                    TimeAndSaleBatchColumns{out.time + i, out.index + i, out.price + i, out.size + i,
+                                            out.bidPrice + i, out.askPrice + i, out.eventFlags + i, out.flags + i,
+                                            out.side + i, out.type + i, out.scope + i, out.attributes + i,
+                                            out.tradeThroughExempt + i, out.exchangeCode + i});
+    }
+  }
+#elif defined(DXFCXX_CPU_NEON)
+  // Packs the 8 32-bit lanes (0..255) to the 8 bytes
+  static void storeBytes(void* out, uint32x4_t low, uint32x4_t high) {
+    vst1_u8(static_cast<std::uint8_t*>(out), vmovn_u16(vcombine_u16(vmovn_u32(low), vmovn_u32(high))));
+  }
+
+  // NEON has no gathers: the wide fields of the 8 events are copied by the loads and the stores of the lanes, the raw
+  // flags and the exchange codes are collected into the vectors, and the flags are unpacked by 4 lanes at once
+  static void convertNeon(const dxf_time_and_sale_t* tns, std::size_t count, const TimeAndSaleBatchColumns& out) {
+    std::size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+      std::uint32_t rawFlags[8]{};
+      std::uint32_t exchangeCodes[8]{};
+
+      for (std::size_t j = 0; j < 8; j++) {
+        const auto& event = tns[i + j];
+
+        out.time[i + j] = static_cast<std::int64_t>(event.time);
+        out.index[i + j] = static_cast<std::int64_t>(event.index);
+        out.price[i + j] = event.price;
+        out.size[i + j] = event.size;
+        out.bidPrice[i + j] = event.bid_price;
+        out.askPrice[i + j] = event.ask_price;
+        out.eventFlags[i + j] = static_cast<std::uint32_t>(event.event_flags);
+        out.scope[i + j] = static_cast<OrderScope>(event.scope);
+        rawFlags[j] = static_cast<std::uint32_t>(event.raw_flags);
+        exchangeCodes[j] = static_cast<std::uint32_t>(event.exchange_code);
+      }
+
+      uint32x4_t flags[2] = {vld1q_u32(rawFlags), vld1q_u32(rawFlags + 4)};
+      uint32x4_t attributes[2]{};
+      uint32x4_t tradeThroughExempt[2]{};
+
+      for (std::size_t half = 0; half < 2; half++) {
+        auto position = i + half * 4;
+
+        vst1q_u32(reinterpret_cast<std::uint32_t*>(out.flags + position), flags[half]);
+        vst1q_u32(reinterpret_cast<std::uint32_t*>(out.side + position),
+                  vandq_u32(vshrq_n_u32(flags[half], SIDE_SHIFT), vdupq_n_u32(SIDE_MASK)));
+        vst1q_u32(reinterpret_cast<std::uint32_t*>(out.type + position),
+                  vandq_u32(flags[half], vdupq_n_u32(TYPE_MASK)));
+        attributes[half] = vandq_u32(vshrq_n_u32(flags[half], ATTRIBUTES_SHIFT), vdupq_n_u32(ATTRIBUTES_MASK));
+        tradeThroughExempt[half] = vandq_u32(vshrq_n_u32(flags[half], TTE_SHIFT), vdupq_n_u32(TTE_MASK));
+      }
+
+      storeBytes(out.attributes + i, attributes[0], attributes[1]);
+      storeBytes(out.tradeThroughExempt + i, tradeThroughExempt[0], tradeThroughExempt[1]);
+
+      auto codesLow = vld1q_u32(exchangeCodes);
+      auto codesHigh = vld1q_u32(exchangeCodes + 4);
+
+      // The ASCII codes are packed, the other ones are converted one by one
+      if (vmaxvq_u32(vorrq_u32(codesLow, codesHigh)) < 0x80U) {
+        storeBytes(out.exchangeCode + i, codesLow, codesHigh);
+      } else {
+        for (std::size_t j = i; j < i + 8; j++) {
+          out.exchangeCode[j] = StringConverter::wCharToUtf8(tns[j].exchange_code);
+        }
+      }
+    }
+
+    if (i < count) {
+      convertScalar(tns + i, count - i,
+                    TimeAndSaleBatchColumns{out.time + i, out.index + i, out.price + i, out.size + i,
+                                            out.bidPrice + i, out.askPrice + i, out.eventFlags + i, out.flags + i,
+                                            out.side + i, out.type + i, out.scope + i, out.attributes + i,
+                                            out.tradeThroughExempt + i, out.exchangeCode + i});
+    }
+  }
+#endif
+
+ public:
+  // Returns the best strategy that is supported by the CPU
+  static BatchConversionStrategy getSupportedStrategy() {
+#ifdef DXFCXX_CPU_X86
+    return IS_GATHER_SUPPORTED && CpuFeatures::hasAvx2() ? BatchConversionStrategy::AVX2
+                                                         : BatchConversionStrategy::SCALAR;
+#elif defined(DXFCXX_CPU_NEON)
+    return BatchConversionStrategy::NEON;
+#else
+    return BatchConversionStrategy::SCALAR;
+#endif
+  }
+
+  [[nodiscard]] static BatchConversionStrategy getStrategy() { return strategy().load(std::memory_order_relaxed); }
+
+  // Selects the strategy (e.g. to compare them). The unsupported strategy is replaced by SCALAR.
+  static void setStrategy(BatchConversionStrategy newStrategy) {
+    if (newStrategy != BatchConversionStrategy::SCALAR && newStrategy != getSupportedStrategy()) {
+      newStrategy = BatchConversionStrategy::SCALAR;
+    }
+
+    strategy().store(newStrategy, std::memory_order_relaxed);
+  }
+
+  static void convert(const dxf_time_and_sale_t* tns, std::size_t count, const TimeAndSaleBatchColumns& out) {
+#ifdef DXFCXX_CPU_X86
+    if constexpr (IS_GATHER_SUPPORTED) {
+      if (getStrategy() == BatchConversionStrategy::AVX2) {
+        convertAvx2(tns, count, out);
+
+        return;
+      }
+    }
+#elif defined(DXFCXX_CPU_NEON)
+    if (getStrategy() == BatchConversionStrategy::NEON) {
+      convertNeon(tns, count, out);
+
+      return;
+    }
+#endif
+
+    convertScalar(tns, count, out);
+  }
+};
+
+}  // namespace dxf
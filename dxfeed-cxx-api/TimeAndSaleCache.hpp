@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "SymbolTable.hpp"
+#include "TimeAndSale.hpp"
+#include "TimeAndSaleTape.hpp"
+
+namespace dxf {
+
+// The on-disk cache of the TimeAndSale history (see SimpleTimeAndSaleDataProvider::runCached). The history of the
+// symbol is kept as the segments: the tapes (TimeAndSaleTape.hpp) of the fetches, every one has the events from its
+// start time to its last event. The name of the segment is the tape file name of the symbol with the start time (e.g.
+// "%2FESZ21%3AXCME.1638316800000.tns"). The segment is written to the temporary file and renamed when the history of
+// the symbol is complete, so the cache never has the partial history.
+class TimeAndSaleCache final {
+  static constexpr std::string_view TAPE_SUFFIX = ".tns";
+  static constexpr std::string_view TEMPORARY_SUFFIX = ".tmp";
+
+  std::string directory_;
+
+  static std::string getPrefix(const std::string& symbol) {
+    auto fileName = TimeAndSaleTape::getFileName(symbol);
+
+    fileName.resize(fileName.size() - TAPE_SUFFIX.size());
+
+    return fileName + ".";
+  }
+
+ public:
+  // The tape of one fetch of the symbol
+  struct Segment {
+    std::string path{};
+    // The time the history of the segment starts at (the time of the subscription)
+    std::int64_t startTime = 0;
+    std::int64_t lastEventTime = 0;
+  };
+
+  // The directory is created if it doesn't exist
+  explicit TimeAndSaleCache(std::string directory) : directory_{std::move(directory)} {
+    std::error_code ec{};
+
+    std::filesystem::create_directories(directory_, ec);
+  }
+
+  [[nodiscard]] const std::string& getDirectory() const { return directory_; }
+
+  // The path of the segment of the symbol that starts at the startTime
+  [[nodiscard]] std::string getSegmentPath(const std::string& symbol, std::int64_t startTime) const {
+    auto fileName = getPrefix(symbol) + std::to_string(startTime) + std::string{TAPE_SUFFIX};
+
+    return (std::filesystem::path(directory_) / fileName).string();
+  }
+
+  // The path of the segment that is being written (see commitSegment)
+  [[nodiscard]] std::string getTemporaryPath(const std::string& symbol, std::int64_t startTime) const {
+    return getSegmentPath(symbol, startTime) + std::string{TEMPORARY_SUFFIX};
+  }
+
+  // Renames the written temporary segment to the segment. Returns false if it can't be renamed (the temporary file is
+  // removed).
+  bool commitSegment(const std::string& symbol, std::int64_t startTime) const {
+    std::error_code ec{};
+
+    std::filesystem::rename(getTemporaryPath(symbol, startTime), getSegmentPath(symbol, startTime), ec);
+
+    if (ec) {
+      discardSegment(symbol, startTime);
+
+      return false;
+    }
+
+    return true;
+  }
+
+  // Removes the temporary segment (e.g. the history of the symbol is not complete)
+  void discardSegment(const std::string& symbol, std::int64_t startTime) const {
+    std::error_code ec{};
+
+    std::filesystem::remove(getTemporaryPath(symbol, startTime), ec);
+  }
+
+  // The segments of the symbol sorted by the start time. The tapes that can't be read and the empty ones are skipped.
+  [[nodiscard]] std::vector<Segment> getSegments(const std::string& symbol) const {
+    auto prefix = getPrefix(symbol);
+    std::vector<Segment> result{};
+    std::error_code ec{};
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory_, ec)) {
+      auto name = entry.path().filename().string();
+
+      if (name.size() <= prefix.size() + TAPE_SUFFIX.size() || !name.starts_with(prefix) ||
+          !name.ends_with(TAPE_SUFFIX)) {
+        continue;
+      }
+
+      // The symbols with the dots (e.g. "BRK.A") don't match the segments of the other symbols: the rest is digits
+      auto startTime = std::string_view{name}.substr(prefix.size(), name.size() - prefix.size() - TAPE_SUFFIX.size());
+
+      if (startTime.size() > 18 ||
+          !std::all_of(startTime.begin(), startTime.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        continue;
+      }
+
+      auto reader = TimeAndSaleTapeReader::open(entry.path().string());
+
+      if (!reader || reader->isEmpty()) {
+        continue;
+      }
+
+      Segment segment{entry.path().string(), std::stoll(std::string{startTime}),
+                      (std::numeric_limits<std::int64_t>::min)()};
+
+      for (const auto& block : reader->getBlocks()) {
+        segment.lastEventTime = (std::max)(segment.lastEventTime, block.maxTime);
+      }
+
+      result.push_back(std::move(segment));
+    }
+
+    std::sort(result.begin(), result.end(), [](const Segment& a, const Segment& b) {
+      return a.startTime < b.startTime;
+    });
+
+    return result;
+  }
+
+  // The segments (of the getSegments ones) that have the history from the fromTime without the gaps: the first one
+  // starts at or before the fromTime, every next one starts at or before the last event of the previous ones. The
+  // history after the last event of the chain (the tail) isn't cached. The empty result - the fromTime isn't cached.
+  [[nodiscard]] static std::vector<Segment> getChain(const std::vector<Segment>& segments, std::int64_t fromTime) {
+    std::vector<Segment> result{};
+    auto coveredTime = fromTime;
+
+    for (const auto& segment : segments) {
+      if (segment.startTime <= coveredTime && segment.lastEventTime >= coveredTime) {
+        result.push_back(segment);
+        coveredTime = segment.lastEventTime;
+      }
+    }
+
+    return result;
+  }
+
+  // Appends the events of the segments in the time range [fromTime, toTime) to the events (the same events of the
+  // overlapping segments are appended several times, see SimpleTimeAndSaleDataProvider::mergeEvents). Returns false if
+  // a tape can't be read or is corrupt.
+  static bool read(const std::vector<Segment>& segments, const Symbol& symbol, std::int64_t fromTime,
+                   std::int64_t toTime, std::vector<TimeAndSale>& events) {
+    for (const auto& segment : segments) {
+      auto reader = TimeAndSaleTapeReader::open(segment.path);
+
+      if (!reader || !reader->forEachRecordInTimeRange(fromTime, toTime, [&](const TimeAndSaleRecord& record) {
+            events.push_back(reader->getEvent(record, symbol.getSharedName()));
+          })) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+}  // namespace dxf
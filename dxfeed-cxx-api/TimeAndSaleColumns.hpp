@@ -0,0 +1,256 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "OrderScope.hpp"
+#include "OrderSide.hpp"
+#include "StringConverter.hpp"
+#include "TimeAndSale.hpp"
+#include "TimeAndSaleBatchConverter.hpp"
+
+namespace dxf {
+
+// The dictionary of the strings of the columns. The string is converted once, the rows keep the ids. The id 0 is the
+// empty string.
+class StringDictionary final {
+  struct WStringHash {
+    using is_transparent = void;
+
+    std::size_t operator()(std::wstring_view s) const { return std::hash<std::wstring_view>{}(s); }
+  };
+
+  std::unordered_map<std::wstring, std::uint32_t, WStringHash, std::equal_to<>> ids_{};
+  std::vector<std::string> strings_{std::string{}};
+
+  std::uint32_t encodeNonEmpty(dxf_const_string_t wString) {
+    std::wstring_view view{wString};
+
+    if (auto found = ids_.find(view); found != ids_.end()) {
+      return found->second;
+    }
+
+    auto id = static_cast<std::uint32_t>(strings_.size());
+
+    strings_.push_back(StringConverter::wStringToUtf8(wString));
+    ids_.emplace(std::wstring(view), id);
+
+    return id;
+  }
+
+ public:
+  // The check of the empty string (the most of the fields) is inlined
+  std::uint32_t encode(dxf_const_string_t wString) {
+    if (wString == nullptr || wString[0] == L'\0') {
+      return 0;
+    }
+
+    return encodeNonEmpty(wString);
+  }
+
+  [[nodiscard]] const std::string& decode(std::uint32_t id) const { return strings_[id]; }
+
+  [[nodiscard]] std::size_t getSize() const { return strings_.size(); }
+};
+
+// The columnar storage of the TimeAndSale events of one symbol: every field is a separate vector, the strings are
+// dictionary encoded. The scans over the numeric columns (e.g. getVolume and getVwap) read only the needed columns
+// and are vectorized by the compiler. The row can be converted to the TimeAndSale (getEvent).
+struct TimeAndSaleColumns {
+  // The bits of the attributes column
+  static constexpr std::uint8_t VALID_TICK = 1;
+  static constexpr std::uint8_t ETH_TRADE = 2;
+  static constexpr std::uint8_t SPREAD_LEG = 4;
+
+  std::vector<std::int64_t> time{};
+  std::vector<std::int64_t> index{};
+  std::vector<double> price{};
+  std::vector<double> size{};
+  std::vector<double> bidPrice{};
+  std::vector<double> askPrice{};
+  std::vector<std::uint32_t> eventFlags{};
+  std::vector<std::int32_t> flags{};
+  std::vector<char> exchangeCode{};
+  std::vector<char> tradeThroughExempt{};
+  std::vector<OrderSide> side{};
+  std::vector<TimeAndSaleType> type{};
+  std::vector<OrderScope> scope{};
+  std::vector<std::uint8_t> attributes{};
+  // The ids in the strings dictionary
+  std::vector<std::uint32_t> exchangeSaleConditions{};
+  std::vector<std::uint32_t> buyer{};
+  std::vector<std::uint32_t> seller{};
+  StringDictionary strings{};
+
+  [[nodiscard]] std::size_t getSize() const { return time.size(); }
+
+  [[nodiscard]] bool isEmpty() const { return time.empty(); }
+
+  void reserve(std::size_t capacity) {
+    time.reserve(capacity);
+    index.reserve(capacity);
+    price.reserve(capacity);
+    size.reserve(capacity);
+    bidPrice.reserve(capacity);
+    askPrice.reserve(capacity);
+    eventFlags.reserve(capacity);
+    flags.reserve(capacity);
+    exchangeCode.reserve(capacity);
+    tradeThroughExempt.reserve(capacity);
+    side.reserve(capacity);
+    type.reserve(capacity);
+    scope.reserve(capacity);
+    attributes.reserve(capacity);
+    exchangeSaleConditions.reserve(capacity);
+    buyer.reserve(capacity);
+    seller.reserve(capacity);
+  }
+
+  void append(const dxf_time_and_sale_t& tns) {
+    time.push_back(static_cast<std::int64_t>(tns.time));
+    index.push_back(static_cast<std::int64_t>(tns.index));
+    price.push_back(tns.price);
+    size.push_back(tns.size);
+    bidPrice.push_back(tns.bid_price);
+    askPrice.push_back(tns.ask_price);
+    eventFlags.push_back(static_cast<std::uint32_t>(tns.event_flags));
+    flags.push_back(static_cast<std::int32_t>(tns.raw_flags));
+    exchangeCode.push_back(StringConverter::wCharToUtf8(tns.exchange_code));
+    tradeThroughExempt.push_back(StringConverter::wCharToUtf8(tns.trade_through_exempt));
+    side.push_back(static_cast<OrderSide>(tns.side));
+    type.push_back(static_cast<TimeAndSaleType>(tns.type));
+    scope.push_back(static_cast<OrderScope>(tns.scope));
+    attributes.push_back(static_cast<std::uint8_t>((tns.is_valid_tick ? VALID_TICK : 0) |
+                                                   (tns.is_eth_trade ? ETH_TRADE : 0) |
+                                                   (tns.is_spread_leg ? SPREAD_LEG : 0)));
+    exchangeSaleConditions.push_back(strings.encode(tns.exchange_sale_conditions));
+    buyer.push_back(strings.encode(tns.buyer));
+    seller.push_back(strings.encode(tns.seller));
+  }
+
+  // Appends the array of the events (e.g. the listener data) at once: the columns are resized once and the numeric
+  // fields, the exchange codes and the raw flags bits are converted by the TimeAndSaleBatchConverter
+  void append(const dxf_time_and_sale_t* tns, std::size_t count) {
+    if (count == 0) {
+      return;
+    }
+
+    auto first = getSize();
+    auto newSize = first + count;
+
+    time.resize(newSize);
+    index.resize(newSize);
+    price.resize(newSize);
+    size.resize(newSize);
+    bidPrice.resize(newSize);
+    askPrice.resize(newSize);
+    eventFlags.resize(newSize);
+    flags.resize(newSize);
+    exchangeCode.resize(newSize);
+    tradeThroughExempt.resize(newSize);
+    side.resize(newSize);
+    type.resize(newSize);
+    scope.resize(newSize);
+    attributes.resize(newSize);
+    exchangeSaleConditions.resize(newSize);
+    buyer.resize(newSize);
+    seller.resize(newSize);
+
+    TimeAndSaleBatchConverter::convert(
+      tns, count,
+      TimeAndSaleBatchColumns{time.data() + first, index.data() + first, price.data() + first, size.data() + first,
+                              bidPrice.data() + first, askPrice.data() + first, eventFlags.data() + first,
+                              flags.data() + first, side.data() + first, type.data() + first, scope.data() + first,
+                              attributes.data() + first, tradeThroughExempt.data() + first,
+                              exchangeCode.data() + first});
+
+    for (std::size_t i = 0; i < count; i++) {
+      exchangeSaleConditions[first + i] = strings.encode(tns[i].exchange_sale_conditions);
+      buyer[first + i] = strings.encode(tns[i].buyer);
+      seller[first + i] = strings.encode(tns[i].seller);
+    }
+  }
+
+  // Returns the sum of the sizes
+  [[nodiscard]] double getVolume() const {
+    // The independent sums of the lanes can be vectorized without the reassociation of the additions
+    double sums[4]{};
+    std::size_t i = 0;
+
+    for (; i + 4 <= size.size(); i += 4) {
+      for (std::size_t lane = 0; lane < 4; lane++) {
+        sums[lane] += size[i + lane];
+      }
+    }
+
+    for (; i < size.size(); i++) {
+      sums[0] += size[i];
+    }
+
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+  }
+
+  // Returns the volume-weighted average price (NaN if the volume is 0)
+  [[nodiscard]] double getVwap() const {
+    double turnovers[4]{};
+    double volumes[4]{};
+    std::size_t i = 0;
+
+    for (; i + 4 <= price.size(); i += 4) {
+      for (std::size_t lane = 0; lane < 4; lane++) {
+        turnovers[lane] += price[i + lane] * size[i + lane];
+        volumes[lane] += size[i + lane];
+      }
+    }
+
+    for (; i < price.size(); i++) {
+      turnovers[0] += price[i] * size[i];
+      volumes[0] += size[i];
+    }
+
+    auto turnover = (turnovers[0] + turnovers[1]) + (turnovers[2] + turnovers[3]);
+    auto volume = (volumes[0] + volumes[1]) + (volumes[2] + volumes[3]);
+
+    return volume != 0.0 ? turnover / volume : std::numeric_limits<double>::quiet_NaN();
+  }
+
+  // Converts the row to the event
+  [[nodiscard]] TimeAndSale getEvent(std::size_t row, std::shared_ptr<const std::string> symbol) const {
+    TimeAndSale result{};
+
+    result.setEventSymbol(std::move(symbol));
+    result.setTime(static_cast<std::uint64_t>(time[row]));
+    result.setIndex(static_cast<std::uint64_t>(index[row]));
+    result.setPrice(price[row]);
+    result.setSize(size[row]);
+    result.setBidPrice(bidPrice[row]);
+    result.setAskPrice(askPrice[row]);
+    result.setEventFlags(eventFlags[row]);
+    result.setFlags(flags[row]);
+    result.setExchangeCode(exchangeCode[row]);
+    result.setTradeThroughExempt(tradeThroughExempt[row]);
+    result.setSide(side[row]);
+    result.setType(type[row]);
+    result.setScope(scope[row]);
+    result.setIsValidTick((attributes[row] & VALID_TICK) != 0);
+    result.setIsEthTrade((attributes[row] & ETH_TRADE) != 0);
+    result.setIsSpreadLeg((attributes[row] & SPREAD_LEG) != 0);
+    result.setExchangeSaleConditions(strings.decode(exchangeSaleConditions[row]));
+    result.setBuyer(strings.decode(buyer[row]));
+    result.setSeller(strings.decode(seller[row]));
+
+    return result;
+  }
+};
+
+}  // namespace dxf
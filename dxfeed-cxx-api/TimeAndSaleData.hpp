@@ -0,0 +1,148 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "EventCodec.hpp"
+#include "EventTraits.hpp"
+#include "OrderScope.hpp"
+#include "OrderSide.hpp"
+#include "TimeAndSale.hpp"
+
+namespace dxf {
+
+// The plain (aggregate, non-virtual) TimeAndSale event. The fields are accessed directly or via EventTraits, so the
+// loops over the events are inlined. It can be converted to and from the TimeAndSale, which implements the virtual
+// interfaces.
+struct TimeAndSaleData {
+  // The immutable symbol shared by the events (see SymbolTable)
+  std::shared_ptr<const std::string> eventSymbol{};
+  std::uint64_t eventTime{};
+  std::uint32_t eventFlags{};
+  std::uint64_t index{};
+  std::uint64_t time{};
+  char exchangeCode{};
+  double price{std::numeric_limits<double>::quiet_NaN()};
+  double size{std::numeric_limits<double>::quiet_NaN()};
+  double bidPrice{std::numeric_limits<double>::quiet_NaN()};
+  double askPrice{std::numeric_limits<double>::quiet_NaN()};
+  TimeAndSale::ShortString exchangeSaleConditions{};
+  std::int32_t flags{};
+  TimeAndSale::ShortString buyer{};
+  TimeAndSale::ShortString seller{};
+  OrderSide side{};
+  TimeAndSaleType type{};
+  bool isValidTick = false;
+  bool isEthTrade = false;
+  char tradeThroughExempt{};
+  bool isSpreadLeg = false;
+  OrderScope scope{};
+
+  using CEventType = dxf_time_and_sale_t;
+  static constexpr int EVENT_TYPE = DXF_ET_TIME_AND_SALE;
+  static constexpr bool IS_TIME_SERIES = true;
+
+  static constexpr auto FIELDS = std::make_tuple(
+    field(&TimeAndSaleData::eventFlags, &dxf_time_and_sale_t::event_flags),
+    field(&TimeAndSaleData::index, &dxf_time_and_sale_t::index),
+    field(&TimeAndSaleData::time, &dxf_time_and_sale_t::time),
+    field(&TimeAndSaleData::exchangeCode, &dxf_time_and_sale_t::exchange_code),
+    field(&TimeAndSaleData::price, &dxf_time_and_sale_t::price),
+    field(&TimeAndSaleData::size, &dxf_time_and_sale_t::size),
+    field(&TimeAndSaleData::bidPrice, &dxf_time_and_sale_t::bid_price),
+    field(&TimeAndSaleData::askPrice, &dxf_time_and_sale_t::ask_price),
+    field(&TimeAndSaleData::exchangeSaleConditions, &dxf_time_and_sale_t::exchange_sale_conditions),
+    field(&TimeAndSaleData::flags, &dxf_time_and_sale_t::raw_flags),
+    field(&TimeAndSaleData::buyer, &dxf_time_and_sale_t::buyer),
+    field(&TimeAndSaleData::seller, &dxf_time_and_sale_t::seller),
+    field(&TimeAndSaleData::side, &dxf_time_and_sale_t::side),
+    field(&TimeAndSaleData::type, &dxf_time_and_sale_t::type),
+    field(&TimeAndSaleData::isValidTick, &dxf_time_and_sale_t::is_valid_tick),
+    field(&TimeAndSaleData::isEthTrade, &dxf_time_and_sale_t::is_eth_trade),
+    field(&TimeAndSaleData::tradeThroughExempt, &dxf_time_and_sale_t::trade_through_exempt),
+    field(&TimeAndSaleData::isSpreadLeg, &dxf_time_and_sale_t::is_spread_leg),
+    field(&TimeAndSaleData::scope, &dxf_time_and_sale_t::scope));
+
+  static TimeAndSaleData create(std::shared_ptr<const std::string> eventSymbol, const dxf_time_and_sale_t& tns) {
+    return EventCodec<TimeAndSaleData>::decode(std::move(eventSymbol), tns);
+  }
+
+  static TimeAndSaleData create(const Symbol& eventSymbol, const dxf_time_and_sale_t& tns) {
+    return EventCodec<TimeAndSaleData>::decode(eventSymbol, tns);
+  }
+
+  static TimeAndSaleData create(TimeAndSale& timeAndSale) {
+    return {timeAndSale.getSharedEventSymbol(),
+            timeAndSale.getEventTime(),
+            timeAndSale.getEventFlags(),
+            timeAndSale.getIndex(),
+            timeAndSale.getTime(),
+            timeAndSale.getExchangeCode(),
+            timeAndSale.getPrice(),
+            timeAndSale.getSize(),
+            timeAndSale.getBidPrice(),
+            timeAndSale.getAskPrice(),
+            timeAndSale.getExchangeSaleConditions(),
+            timeAndSale.getFlags(),
+            timeAndSale.getBuyer(),
+            timeAndSale.getSeller(),
+            timeAndSale.getSide(),
+            timeAndSale.getType(),
+            timeAndSale.isValidTick1(),
+            timeAndSale.isEthTrade1(),
+            timeAndSale.getTradeThroughExempt(),
+            timeAndSale.isSpreadLeg1(),
+            timeAndSale.getScope()};
+  }
+
+  [[nodiscard]] const std::string& getEventSymbol() const {
+    static const std::string emptySymbol{};
+
+    return eventSymbol ? *eventSymbol : emptySymbol;
+  }
+
+  [[nodiscard]] TimeAndSale toTimeAndSale() const {
+    TimeAndSale result{};
+
+    result.setEventSymbol(eventSymbol);
+    result.setEventTime(eventTime);
+    result.setEventFlags(eventFlags);
+    result.setIndex(index);
+    result.setTime(time);
+    result.setExchangeCode(exchangeCode);
+    result.setPrice(price);
+    result.setSize(size);
+    result.setBidPrice(bidPrice);
+    result.setAskPrice(askPrice);
+    result.setExchangeSaleConditions(exchangeSaleConditions);
+    result.setFlags(flags);
+    result.setBuyer(buyer);
+    result.setSeller(seller);
+    result.setSide(side);
+    result.setType(type);
+    result.setIsValidTick(isValidTick);
+    result.setIsEthTrade(isEthTrade);
+    result.setTradeThroughExempt(tradeThroughExempt);
+    result.setIsSpreadLeg(isSpreadLeg);
+    result.setScope(scope);
+
+    return result;
+  }
+};
+
+template <>
+struct EventTraits<TimeAndSaleData> {
+  static std::uint64_t getIndex(const TimeAndSaleData& e) { return e.index; }
+
+  static std::uint32_t getEventFlags(const TimeAndSaleData& e) { return e.eventFlags; }
+
+  static std::uint64_t getTime(const TimeAndSaleData& e) { return e.time; }
+};
+
+}  // namespace dxf
@@ -0,0 +1,374 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "EventTraits.hpp"
+#include "MappedFile.hpp"
+#include "OrderScope.hpp"
+#include "OrderSide.hpp"
+#include "StringConverter.hpp"
+#include "TimeAndSale.hpp"
+#include "TimeAndSaleColumns.hpp"
+
+namespace dxf {
+
+// The fixed-size record of the TimeAndSale in the spill file. The strings are the ids in the dictionary of the run.
+struct TimeAndSaleRecord {
+  std::int64_t time;
+  std::int64_t index;
+  double price;
+  double size;
+  double bidPrice;
+  double askPrice;
+  std::uint32_t eventFlags;
+  std::int32_t flags;
+  std::uint32_t exchangeSaleConditions;
+  std::uint32_t buyer;
+  std::uint32_t seller;
+  char exchangeCode;
+  char tradeThroughExempt;
+  std::uint8_t side;
+  std::uint8_t type;
+  std::uint8_t scope;
+  // The bits are the TimeAndSaleColumns attributes ones
+  std::uint8_t attributes;
+
+  static TimeAndSaleRecord create(const dxf_time_and_sale_t& tns, StringDictionary& strings) {
+    return {static_cast<std::int64_t>(tns.time),
+            static_cast<std::int64_t>(tns.index),
+            tns.price,
+            tns.size,
+            tns.bid_price,
+            tns.ask_price,
+            static_cast<std::uint32_t>(tns.event_flags),
+            static_cast<std::int32_t>(tns.raw_flags),
+            strings.encode(tns.exchange_sale_conditions),
+            strings.encode(tns.buyer),
+            strings.encode(tns.seller),
+            StringConverter::wCharToUtf8(tns.exchange_code),
+            StringConverter::wCharToUtf8(tns.trade_through_exempt),
+            static_cast<std::uint8_t>(tns.side),
+            static_cast<std::uint8_t>(tns.type),
+            static_cast<std::uint8_t>(tns.scope),
+            static_cast<std::uint8_t>((tns.is_valid_tick ? TimeAndSaleColumns::VALID_TICK : 0) |
+                                      (tns.is_eth_trade ? TimeAndSaleColumns::ETH_TRADE : 0) |
+                                      (tns.is_spread_leg ? TimeAndSaleColumns::SPREAD_LEG : 0))};
+  }
+};
+
+static_assert(std::is_trivially_copyable_v<TimeAndSaleRecord>);
+
+template <>
+struct EventTraits<TimeAndSaleRecord> {
+  static std::uint64_t getIndex(const TimeAndSaleRecord& e) { return static_cast<std::uint64_t>(e.index); }
+
+  static std::uint32_t getEventFlags(const TimeAndSaleRecord& e) { return e.eventFlags; }
+
+  static std::uint64_t getTime(const TimeAndSaleRecord& e) { return static_cast<std::uint64_t>(e.time); }
+};
+
+// The history of the TimeAndSale events of one symbol: the chunks spilled to the file followed by the records that are
+// still in memory. The spilled records are read from the memory-mapped file on access, so only the touched pages are
+// loaded.
+class TimeAndSaleHistory final {
+  friend class TimeAndSaleSpillWriter;
+
+ public:
+  // The spilled chunk: the byte offset in the file and the number of the records
+  struct Chunk {
+    std::size_t offset;
+    std::size_t size;
+  };
+
+ private:
+  std::shared_ptr<const std::string> symbol_{};
+  std::shared_ptr<const MappedFile> file_{};
+  std::shared_ptr<const StringDictionary> strings_{};
+  std::vector<Chunk> chunks_{};
+  // The positions of the first records of the chunks
+  std::vector<std::size_t> chunkStarts_{};
+  std::size_t spilledSize_ = 0;
+  std::vector<TimeAndSaleRecord> records_{};
+  bool isComplete_ = true;
+
+  [[nodiscard]] TimeAndSaleRecord readRecord(const Chunk& chunk, std::size_t position) const {
+    TimeAndSaleRecord result;
+
+    std::memcpy(&result,
+                static_cast<const char*>(file_->getData()) + chunk.offset + position * sizeof(TimeAndSaleRecord),
+                sizeof(TimeAndSaleRecord));
+
+    return result;
+  }
+
+ public:
+  TimeAndSaleHistory() = default;
+
+  [[nodiscard]] const std::shared_ptr<const std::string>& getSymbol() const { return symbol_; }
+
+  [[nodiscard]] std::size_t getSize() const { return spilledSize_ + records_.size(); }
+
+  [[nodiscard]] bool isEmpty() const { return getSize() == 0; }
+
+  // Returns the number of the records in the spill file
+  [[nodiscard]] std::size_t getSpilledSize() const { return spilledSize_; }
+
+  [[nodiscard]] const std::vector<Chunk>& getChunks() const { return chunks_; }
+
+  // Returns false if the spill file can't be mapped and the spilled records are lost
+  [[nodiscard]] bool isComplete() const { return isComplete_; }
+
+  [[nodiscard]] TimeAndSaleRecord getRecord(std::size_t position) const {
+    if (position >= spilledSize_) {
+      return records_[position - spilledSize_];
+    }
+
+    auto chunk = static_cast<std::size_t>(
+      std::upper_bound(chunkStarts_.begin(), chunkStarts_.end(), position) - chunkStarts_.begin() - 1);
+
+    return readRecord(chunks_[chunk], position - chunkStarts_[chunk]);
+  }
+
+  // Passes every record to the f in order. The sequential read of the chunks is the fastest way to scan the history.
+  template <typename F>
+  void forEachRecord(F&& f) const {
+    for (const auto& chunk : chunks_) {
+      for (std::size_t i = 0; i < chunk.size; i++) {
+        f(readRecord(chunk, i));
+      }
+    }
+
+    for (const auto& record : records_) {
+      f(record);
+    }
+  }
+
+  [[nodiscard]] const std::string& getString(std::uint32_t id) const { return strings_->decode(id); }
+
+  // Converts the record to the event
+  [[nodiscard]] TimeAndSale getEvent(std::size_t position) const {
+    auto record = getRecord(position);
+    TimeAndSale result{};
+
+    result.setEventSymbol(symbol_);
+    result.setTime(static_cast<std::uint64_t>(record.time));
+    result.setIndex(static_cast<std::uint64_t>(record.index));
+    result.setPrice(record.price);
+    result.setSize(record.size);
+    result.setBidPrice(record.bidPrice);
+    result.setAskPrice(record.askPrice);
+    result.setEventFlags(record.eventFlags);
+    result.setFlags(record.flags);
+    result.setExchangeCode(record.exchangeCode);
+    result.setTradeThroughExempt(record.tradeThroughExempt);
+    result.setSide(static_cast<OrderSide>(record.side));
+    result.setType(static_cast<TimeAndSaleType>(record.type));
+    result.setScope(static_cast<OrderScope>(record.scope));
+    result.setIsValidTick((record.attributes & TimeAndSaleColumns::VALID_TICK) != 0);
+    result.setIsEthTrade((record.attributes & TimeAndSaleColumns::ETH_TRADE) != 0);
+    result.setIsSpreadLeg((record.attributes & TimeAndSaleColumns::SPREAD_LEG) != 0);
+    result.setExchangeSaleConditions(getString(record.exchangeSaleConditions));
+    result.setBuyer(getString(record.buyer));
+    result.setSeller(getString(record.seller));
+
+    return result;
+  }
+};
+
+// The writer of the histories with the bounded memory. When the memory of the buffered records exceeds the budget, the
+// largest buffers are appended to the spill file as the chunks until the half of the budget is used. Not thread-safe.
+class TimeAndSaleSpillWriter final {
+  struct Buffer {
+    std::shared_ptr<const std::string> symbol{};
+    std::vector<TimeAndSaleRecord> records{};
+    std::vector<TimeAndSaleHistory::Chunk> chunks{};
+    std::size_t spilledSize = 0;
+  };
+
+  std::size_t memoryBudget_;
+  std::string path_;
+  std::FILE* file_ = nullptr;
+  std::size_t fileSize_ = 0;
+  // The capacity of the buffers in bytes
+  std::size_t bufferedBytes_ = 0;
+  bool isSpillFailed_ = false;
+  std::vector<Buffer> buffers_{};
+  std::shared_ptr<StringDictionary> strings_ = std::make_shared<StringDictionary>();
+
+  static std::string createTemporaryPath() {
+    static std::atomic<std::uint64_t> counter{0};
+
+    auto name = "dxf-tns-spill-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "-" +
+                std::to_string(counter++) + ".bin";
+    std::error_code ec{};
+    auto directory = std::filesystem::temp_directory_path(ec);
+
+    return ec ? name : (directory / name).string();
+  }
+
+  bool spill(Buffer& buffer) {
+    if (file_ == nullptr) {
+      file_ = std::fopen(path_.c_str(), "wb");
+
+      if (file_ == nullptr) {
+        return false;
+      }
+    }
+
+    auto bytes = buffer.records.size() * sizeof(TimeAndSaleRecord);
+
+    if (std::fwrite(buffer.records.data(), 1, bytes, file_) != bytes) {
+      return false;
+    }
+
+    buffer.chunks.push_back({fileSize_, buffer.records.size()});
+    buffer.spilledSize += buffer.records.size();
+    fileSize_ += bytes;
+    bufferedBytes_ -= buffer.records.capacity() * sizeof(TimeAndSaleRecord);
+    // Releases the memory (clear keeps the capacity)
+    std::vector<TimeAndSaleRecord>{}.swap(buffer.records);
+
+    return true;
+  }
+
+  void spillLargest() {
+    std::vector<Buffer*> buffers{};
+
+    for (auto& buffer : buffers_) {
+      if (!buffer.records.empty()) {
+        buffers.push_back(&buffer);
+      }
+    }
+
+    std::sort(buffers.begin(), buffers.end(),
+              [](const Buffer* a, const Buffer* b) { return a->records.size() > b->records.size(); });
+
+    for (auto* buffer : buffers) {
+      if (bufferedBytes_ <= memoryBudget_ / 2) {
+        return;
+      }
+
+      if (!spill(*buffer)) {
+        // The records stay in memory
+        isSpillFailed_ = true;
+
+        return;
+      }
+    }
+  }
+
+ public:
+  // memoryBudget - the memory of the buffered records in bytes, path - the spill file (empty - the temporary file). The
+  // file is removed when the last history is destroyed.
+  explicit TimeAndSaleSpillWriter(std::size_t memoryBudget, std::string path = {})
+      : memoryBudget_{memoryBudget}, path_{path.empty() ? createTemporaryPath() : std::move(path)} {}
+
+  TimeAndSaleSpillWriter(const TimeAndSaleSpillWriter&) = delete;
+  TimeAndSaleSpillWriter& operator=(const TimeAndSaleSpillWriter&) = delete;
+
+  ~TimeAndSaleSpillWriter() {
+    if (file_ != nullptr) {
+      std::fclose(file_);
+      std::remove(path_.c_str());
+    }
+  }
+
+  // Returns the index of the new buffer
+  std::size_t addBuffer(std::shared_ptr<const std::string> symbol) {
+    buffers_.push_back(Buffer{std::move(symbol)});
+
+    return buffers_.size() - 1;
+  }
+
+  void append(std::size_t bufferIndex, const dxf_time_and_sale_t& tns) {
+    auto& records = buffers_[bufferIndex].records;
+    auto capacity = records.capacity();
+
+    records.push_back(TimeAndSaleRecord::create(tns, *strings_));
+
+    if (records.capacity() == capacity) {
+      return;
+    }
+
+    bufferedBytes_ += (records.capacity() - capacity) * sizeof(TimeAndSaleRecord);
+
+    if (bufferedBytes_ > memoryBudget_ && !isSpillFailed_) {
+      spillLargest();
+    }
+  }
+
+  // Returns false if the spill file can't be written (the records are kept in memory since)
+  [[nodiscard]] bool isSpillFailed() const { return isSpillFailed_; }
+
+  [[nodiscard]] std::size_t getSpilledBytes() const { return fileSize_; }
+
+  // Returns the histories of the buffers (in the order of the addBuffer calls). The writer must not be used after.
+  std::vector<TimeAndSaleHistory> finish() {
+    std::shared_ptr<const MappedFile> file{};
+
+    if (file_ != nullptr) {
+      auto closed = std::fclose(file_) == 0;
+
+      file_ = nullptr;
+
+      if (closed) {
+        file = MappedFile::open(path_, true);
+      }
+
+      if (!file) {
+        std::remove(path_.c_str());
+      }
+    }
+
+    std::vector<TimeAndSaleHistory> result(buffers_.size());
+
+    for (std::size_t i = 0; i < buffers_.size(); i++) {
+      auto& history = result[i];
+      auto& buffer = buffers_[i];
+
+      history.symbol_ = std::move(buffer.symbol);
+      history.strings_ = strings_;
+      history.records_ = std::move(buffer.records);
+
+      if (buffer.chunks.empty()) {
+        continue;
+      }
+
+      if (!file) {
+        history.isComplete_ = false;
+
+        continue;
+      }
+
+      history.file_ = file;
+      history.chunks_ = std::move(buffer.chunks);
+      history.spilledSize_ = buffer.spilledSize;
+      history.chunkStarts_.reserve(history.chunks_.size());
+
+      std::size_t start = 0;
+
+      for (const auto& chunk : history.chunks_) {
+        history.chunkStarts_.push_back(start);
+        start += chunk.size;
+      }
+    }
+
+    return result;
+  }
+};
+
+}  // namespace dxf
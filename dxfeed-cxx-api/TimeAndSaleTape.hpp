@@ -0,0 +1,780 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "OrderScope.hpp"
+#include "OrderSide.hpp"
+#include "TimeAndSale.hpp"
+#include "TimeAndSaleBatchConverter.hpp"
+#include "TimeAndSaleColumns.hpp"
+#include "TimeAndSaleHistory.hpp"
+
+namespace dxf {
+
+// The compact binary file of the TimeAndSale history of one symbol (the tape). The file is read by the memory mapping
+// and the events are decoded from the blocks without the copying of the file.
+//
+// Format (native byte order):
+//   header:     "TNST" (4 bytes), version (uint32), price scale (double), symbol length (uint32), symbol (UTF-8)
+//   blocks:     the encoded events, every block is decoded independently (the previous values start from zeros)
+//   dictionary: (8-byte aligned) strings number (uint32), then the length (uint32) and UTF-8 bytes of every string
+//   index:      (8-byte aligned) the Block of every block
+//   footer:     dictionary offset, index offset, blocks number, events number (uint64), "TNST" (4 bytes), padding
+//
+// The event: the mask of the fields that are different from the previous event (varint), the time delta (zigzag
+// varint), the index and the changed fields. The index of the TimeAndSale is the time sequence (the seconds and the
+// milliseconds of the time and the 22-bit sequence), so only the sequence is stored (varint) unless the index doesn't
+// match the time (RAW_INDEX, the index delta). The prices are the deltas of the price ticks (the price is the ticks
+// divided by the price scale) or the doubles (RAW_*) if the price isn't a whole number of ticks (e.g. NaN). The size is
+// the varint if it's a whole non-negative number. The flags, the event flags and the strings ids are varints, the
+// exchange code and the scope are bytes. The side, the type, the attributes and the trade through exempt are unpacked
+// from the raw flags (see TimeAndSaleBatchConverter).
+struct TimeAndSaleTape {
+  static constexpr char MAGIC[4] = {'T', 'N', 'S', 'T'};
+  static constexpr std::uint32_t VERSION = 1;
+  static constexpr std::size_t DEFAULT_BLOCK_SIZE = 4096;
+  // The block is written when it is this long even if it has fewer events
+  static constexpr std::size_t MAX_BLOCK_LENGTH = 1U << 30U;
+  // The 1e-8 ticks when the tick size is unknown
+  static constexpr double DEFAULT_PRICE_SCALE = 1e8;
+
+  // The bits of the fields mask (the frequent ones fit in the first byte)
+  static constexpr std::uint32_t PRICE = 1U << 0U;
+  static constexpr std::uint32_t SIZE = 1U << 1U;
+  static constexpr std::uint32_t BID_PRICE = 1U << 2U;
+  static constexpr std::uint32_t ASK_PRICE = 1U << 3U;
+  static constexpr std::uint32_t FLAGS = 1U << 4U;
+  static constexpr std::uint32_t EXCHANGE_CODE = 1U << 5U;
+  static constexpr std::uint32_t EXCHANGE_SALE_CONDITIONS = 1U << 6U;
+  static constexpr std::uint32_t RAW_PRICE = 1U << 7U;
+  static constexpr std::uint32_t RAW_SIZE = 1U << 8U;
+  static constexpr std::uint32_t RAW_BID_PRICE = 1U << 9U;
+  static constexpr std::uint32_t RAW_ASK_PRICE = 1U << 10U;
+  static constexpr std::uint32_t EVENT_FLAGS = 1U << 11U;
+  static constexpr std::uint32_t SCOPE = 1U << 12U;
+  static constexpr std::uint32_t BUYER = 1U << 13U;
+  static constexpr std::uint32_t SELLER = 1U << 14U;
+  static constexpr std::uint32_t RAW_INDEX = 1U << 15U;
+
+  static constexpr std::uint64_t SEQUENCE_MASK = (1ULL << 22U) - 1;
+
+  // The block of the events: the byte offset in the file, the length, the number of the events and the time range
+  struct Block {
+    std::uint64_t offset;
+    std::uint32_t size;
+    std::uint32_t eventsNumber;
+    std::int64_t minTime;
+    std::int64_t maxTime;
+  };
+
+  struct Footer {
+    std::uint64_t dictionaryOffset;
+    std::uint64_t indexOffset;
+    std::uint64_t blocksNumber;
+    std::uint64_t eventsNumber;
+    char magic[4];
+    std::uint32_t padding;
+  };
+
+  static_assert(std::is_trivially_copyable_v<Block> && sizeof(Block) == 32 && sizeof(Footer) == 40,
+                "The layout is fixed");
+
+  // The previous values of the block
+  struct State {
+    std::int64_t time = 0;
+    std::int64_t index = 0;
+    std::int64_t priceTicks[3]{};
+    double prices[3]{};
+    double size = 0.0;
+    std::uint32_t eventFlags = 0;
+    std::int32_t flags = 0;
+    char exchangeCode = 0;
+    std::uint8_t scope = 0;
+    std::uint32_t strings[3]{};
+  };
+
+  // The index of the event with the time and the sequence (see the format)
+  static std::int64_t getTimeSequence(std::int64_t time, std::uint64_t sequence) {
+    return static_cast<std::int64_t>((static_cast<std::uint64_t>(time / 1000) << 32U) |
+                                     (static_cast<std::uint64_t>(time % 1000) << 22U) | (sequence & SEQUENCE_MASK));
+  }
+
+  static std::uint64_t toZigzag(std::int64_t value) {
+    return (static_cast<std::uint64_t>(value) << 1U) ^ static_cast<std::uint64_t>(value >> 63);
+  }
+
+  static std::int64_t fromZigzag(std::uint64_t value) {
+    return static_cast<std::int64_t>(value >> 1U) ^ -static_cast<std::int64_t>(value & 1U);
+  }
+
+  static bool isSame(double a, double b) { return std::bit_cast<std::uint64_t>(a) == std::bit_cast<std::uint64_t>(b); }
+
+  // The file name of the tape of the symbol: the chars other than the letters, the digits, '.', '-' and '_' are
+  // replaced by "%XX" (e.g. "/ESZ21:XCME" -> "%2FESZ21%3AXCME.tns")
+  static std::string getFileName(const std::string& symbol) {
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    std::string result{};
+
+    for (auto c : symbol) {
+      auto u = static_cast<unsigned char>(c);
+
+      if ((u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') || u == '.' || u == '-' ||
+          u == '_') {
+        result += c;
+      } else {
+        result += '%';
+        result += HEX[u >> 4U];
+        result += HEX[u & 0xFU];
+      }
+    }
+
+    return result + ".tns";
+  }
+};
+
+// The writer of the tape. The events are appended in the order they are received (e.g. from the newest one) and are
+// written to the file block by block. Not thread-safe.
+class TimeAndSaleTapeWriter final {
+  std::FILE* file_;
+  double priceScale_;
+  std::size_t blockSize_;
+  std::uint64_t fileSize_ = 0;
+  std::uint64_t eventsNumber_ = 0;
+  bool isFailed_ = false;
+  bool isFinished_ = false;
+  std::vector<unsigned char> buffer_{};
+  std::vector<TimeAndSaleTape::Block> blocks_{};
+  TimeAndSaleTape::Block block_{};
+  TimeAndSaleTape::State state_{};
+  StringDictionary strings_{};
+
+  TimeAndSaleTapeWriter(std::FILE* file, double priceScale, std::size_t blockSize)
+      : file_{file}, priceScale_{priceScale}, blockSize_{blockSize} {}
+
+  template <typename T>
+  void put(T value) {
+    auto position = buffer_.size();
+
+    buffer_.resize(position + sizeof(T));
+    std::memcpy(buffer_.data() + position, &value, sizeof(T));
+  }
+
+  void putVarint(std::uint64_t value) {
+    while (value >= 0x80U) {
+      buffer_.push_back(static_cast<unsigned char>(value | 0x80U));
+      value >>= 7U;
+    }
+
+    buffer_.push_back(static_cast<unsigned char>(value));
+  }
+
+  bool writeBuffer() {
+    if (!isFailed_ && std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+      isFailed_ = true;
+    }
+
+    fileSize_ += buffer_.size();
+    buffer_.clear();
+
+    return !isFailed_;
+  }
+
+  void padBuffer() {
+    while ((fileSize_ + buffer_.size()) % 8 != 0) {
+      buffer_.push_back(0);
+    }
+  }
+
+  // Returns true if the price is the whole number of the ticks
+  [[nodiscard]] bool toTicks(double price, std::int64_t& ticks) const {
+    auto scaled = price * priceScale_;
+
+    // NaN and the values out of the exact integers range are not converted
+    if (!(std::fabs(scaled) < 9007199254740992.0)) {
+      return false;
+    }
+
+    ticks = std::llround(scaled);
+
+    return static_cast<double>(ticks) / priceScale_ == price;
+  }
+
+  void encodePrice(int field, double price, std::uint32_t changedBit, std::uint32_t rawBit, std::uint32_t& mask,
+                   std::int64_t& ticksDelta) {
+    if (TimeAndSaleTape::isSame(price, state_.prices[field])) {
+      return;
+    }
+
+    std::int64_t ticks = 0;
+
+    if (toTicks(price, ticks)) {
+      mask |= changedBit;
+      ticksDelta = ticks - state_.priceTicks[field];
+      state_.priceTicks[field] = ticks;
+    } else {
+      mask |= changedBit | rawBit;
+    }
+
+    state_.prices[field] = price;
+  }
+
+  void flushBlock() {
+    if (block_.eventsNumber == 0) {
+      return;
+    }
+
+    block_.offset = fileSize_;
+    block_.size = static_cast<std::uint32_t>(buffer_.size());
+    blocks_.push_back(block_);
+    writeBuffer();
+    block_ = {};
+    state_ = {};
+  }
+
+ public:
+  TimeAndSaleTapeWriter(const TimeAndSaleTapeWriter&) = delete;
+  TimeAndSaleTapeWriter& operator=(const TimeAndSaleTapeWriter&) = delete;
+
+  ~TimeAndSaleTapeWriter() { finish(); }
+
+  // Creates the file. tickSize - the tick size of the prices (0 - unknown, the 1e-8 ticks), blockSize - the number of
+  // the events of the block. Returns nullptr if the file can't be created.
+  static std::unique_ptr<TimeAndSaleTapeWriter> open(const std::string& path, const std::string& symbol,
+                                                     double tickSize = 0.0,
+                                                     std::size_t blockSize = TimeAndSaleTape::DEFAULT_BLOCK_SIZE) {
+    auto file = std::fopen(path.c_str(), "wb");
+
+    if (file == nullptr) {
+      return nullptr;
+    }
+
+    auto priceScale = tickSize > 0.0 ? 1.0 / tickSize : TimeAndSaleTape::DEFAULT_PRICE_SCALE;
+    auto writer = std::unique_ptr<TimeAndSaleTapeWriter>(
+      new TimeAndSaleTapeWriter(file, priceScale, blockSize > 0 ? blockSize : TimeAndSaleTape::DEFAULT_BLOCK_SIZE));
+
+    writer->buffer_.insert(writer->buffer_.end(), std::begin(TimeAndSaleTape::MAGIC), std::end(TimeAndSaleTape::MAGIC));
+    writer->put(TimeAndSaleTape::VERSION);
+    writer->put(priceScale);
+    writer->put(static_cast<std::uint32_t>(symbol.size()));
+    writer->buffer_.insert(writer->buffer_.end(), symbol.begin(), symbol.end());
+    writer->writeBuffer();
+
+    return writer;
+  }
+
+  void append(const dxf_time_and_sale_t& tns) {
+    auto record = TimeAndSaleRecord::create(tns, strings_);
+    std::uint32_t mask = 0;
+    std::int64_t ticksDeltas[3]{};
+    auto sequence = static_cast<std::uint64_t>(record.index) & TimeAndSaleTape::SEQUENCE_MASK;
+
+    if (record.time < 0 || TimeAndSaleTape::getTimeSequence(record.time, sequence) != record.index) {
+      mask |= TimeAndSaleTape::RAW_INDEX;
+    }
+
+    encodePrice(0, record.price, TimeAndSaleTape::PRICE, TimeAndSaleTape::RAW_PRICE, mask, ticksDeltas[0]);
+    encodePrice(1, record.bidPrice, TimeAndSaleTape::BID_PRICE, TimeAndSaleTape::RAW_BID_PRICE, mask, ticksDeltas[1]);
+    encodePrice(2, record.askPrice, TimeAndSaleTape::ASK_PRICE, TimeAndSaleTape::RAW_ASK_PRICE, mask, ticksDeltas[2]);
+
+    if (!TimeAndSaleTape::isSame(record.size, state_.size)) {
+      mask |= record.size >= 0.0 && record.size < 9007199254740992.0 && std::trunc(record.size) == record.size &&
+                  !std::signbit(record.size)
+                ? TimeAndSaleTape::SIZE
+                : TimeAndSaleTape::SIZE | TimeAndSaleTape::RAW_SIZE;
+    }
+
+    mask |= record.flags != state_.flags ? TimeAndSaleTape::FLAGS : 0U;
+    mask |= record.eventFlags != state_.eventFlags ? TimeAndSaleTape::EVENT_FLAGS : 0U;
+    mask |= record.exchangeCode != state_.exchangeCode ? TimeAndSaleTape::EXCHANGE_CODE : 0U;
+    mask |= record.scope != state_.scope ? TimeAndSaleTape::SCOPE : 0U;
+    mask |= record.exchangeSaleConditions != state_.strings[0] ? TimeAndSaleTape::EXCHANGE_SALE_CONDITIONS : 0U;
+    mask |= record.buyer != state_.strings[1] ? TimeAndSaleTape::BUYER : 0U;
+    mask |= record.seller != state_.strings[2] ? TimeAndSaleTape::SELLER : 0U;
+
+    putVarint(mask);
+    putVarint(TimeAndSaleTape::toZigzag(record.time - state_.time));
+
+    if ((mask & TimeAndSaleTape::RAW_INDEX) != 0) {
+      putVarint(TimeAndSaleTape::toZigzag(record.index - state_.index));
+    } else {
+      putVarint(sequence);
+    }
+
+    const double prices[3] = {record.price, record.bidPrice, record.askPrice};
+    constexpr std::uint32_t PRICE_BITS[3][2] = {{TimeAndSaleTape::PRICE, TimeAndSaleTape::RAW_PRICE},
+                                                {TimeAndSaleTape::BID_PRICE, TimeAndSaleTape::RAW_BID_PRICE},
+                                                {TimeAndSaleTape::ASK_PRICE, TimeAndSaleTape::RAW_ASK_PRICE}};
+
+    for (int field = 0; field < 3; field++) {
+      if ((mask & PRICE_BITS[field][1]) != 0) {
+        put(prices[field]);
+      } else if ((mask & PRICE_BITS[field][0]) != 0) {
+        putVarint(TimeAndSaleTape::toZigzag(ticksDeltas[field]));
+      }
+    }
+
+    if ((mask & TimeAndSaleTape::RAW_SIZE) != 0) {
+      put(record.size);
+    } else if ((mask & TimeAndSaleTape::SIZE) != 0) {
+      putVarint(static_cast<std::uint64_t>(record.size));
+    }
+
+    if ((mask & TimeAndSaleTape::FLAGS) != 0) {
+      putVarint(static_cast<std::uint32_t>(record.flags));
+    }
+
+    if ((mask & TimeAndSaleTape::EVENT_FLAGS) != 0) {
+      putVarint(record.eventFlags);
+    }
+
+    if ((mask & TimeAndSaleTape::EXCHANGE_CODE) != 0) {
+      buffer_.push_back(static_cast<unsigned char>(record.exchangeCode));
+    }
+
+    if ((mask & TimeAndSaleTape::SCOPE) != 0) {
+      buffer_.push_back(record.scope);
+    }
+
+    if ((mask & TimeAndSaleTape::EXCHANGE_SALE_CONDITIONS) != 0) {
+      putVarint(record.exchangeSaleConditions);
+    }
+
+    if ((mask & TimeAndSaleTape::BUYER) != 0) {
+      putVarint(record.buyer);
+    }
+
+    if ((mask & TimeAndSaleTape::SELLER) != 0) {
+      putVarint(record.seller);
+    }
+
+    state_.time = record.time;
+    state_.index = record.index;
+    state_.size = record.size;
+    state_.flags = record.flags;
+    state_.eventFlags = record.eventFlags;
+    state_.exchangeCode = record.exchangeCode;
+    state_.scope = record.scope;
+    state_.strings[0] = record.exchangeSaleConditions;
+    state_.strings[1] = record.buyer;
+    state_.strings[2] = record.seller;
+
+    if (block_.eventsNumber == 0) {
+      block_.minTime = record.time;
+      block_.maxTime = record.time;
+    } else {
+      block_.minTime = (std::min)(block_.minTime, record.time);
+      block_.maxTime = (std::max)(block_.maxTime, record.time);
+    }
+
+    block_.eventsNumber++;
+    eventsNumber_++;
+
+    if (block_.eventsNumber >= blockSize_ || buffer_.size() >= TimeAndSaleTape::MAX_BLOCK_LENGTH) {
+      flushBlock();
+    }
+  }
+
+  // Appends the array of the events (e.g. the listener data)
+  void append(const dxf_time_and_sale_t* tns, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      append(tns[i]);
+    }
+  }
+
+  [[nodiscard]] std::uint64_t getEventsNumber() const { return eventsNumber_; }
+
+  // Returns true if the file can't be written
+  [[nodiscard]] bool isFailed() const { return isFailed_; }
+
+  // Writes the last block, the dictionary, the index and the footer and closes the file. Returns false if the file
+  // can't be written (the file is not a valid tape).
+  bool finish() {
+    if (isFinished_) {
+      return !isFailed_;
+    }
+
+    isFinished_ = true;
+    flushBlock();
+
+    padBuffer();
+    writeBuffer();
+
+    TimeAndSaleTape::Footer footer{fileSize_, 0, blocks_.size(), eventsNumber_, {}, 0};
+
+    put(static_cast<std::uint32_t>(strings_.getSize()));
+
+    for (std::size_t id = 0; id < strings_.getSize(); id++) {
+      const auto& s = strings_.decode(static_cast<std::uint32_t>(id));
+
+      put(static_cast<std::uint32_t>(s.size()));
+      buffer_.insert(buffer_.end(), s.begin(), s.end());
+    }
+
+    padBuffer();
+    writeBuffer();
+    footer.indexOffset = fileSize_;
+
+    for (const auto& block : blocks_) {
+      put(block);
+    }
+
+    std::memcpy(footer.magic, TimeAndSaleTape::MAGIC, sizeof(footer.magic));
+    put(footer);
+    writeBuffer();
+
+    if (std::fclose(file_) != 0) {
+      isFailed_ = true;
+    }
+
+    file_ = nullptr;
+
+    return !isFailed_;
+  }
+};
+
+// The reader of the tape. The file is mapped and the blocks are decoded on the iteration, so the reload of the history
+// takes the time of the sequential read of the file.
+class TimeAndSaleTapeReader final {
+  std::unique_ptr<MappedFile> file_;
+  std::string symbol_{};
+  double priceScale_ = TimeAndSaleTape::DEFAULT_PRICE_SCALE;
+  std::uint64_t eventsNumber_ = 0;
+  std::vector<TimeAndSaleTape::Block> blocks_{};
+  std::vector<std::string_view> strings_{};
+
+  explicit TimeAndSaleTapeReader(std::unique_ptr<MappedFile> file) : file_{std::move(file)} {}
+
+  [[nodiscard]] const unsigned char* getData() const { return static_cast<const unsigned char*>(file_->getData()); }
+
+  // The bounds-checked reader of the block
+  struct Cursor {
+    const unsigned char* position;
+    const unsigned char* end;
+    bool isValid = true;
+
+    template <typename T>
+    T get() {
+      T value{};
+
+      if (static_cast<std::size_t>(end - position) < sizeof(T)) {
+        isValid = false;
+
+        return value;
+      }
+
+      std::memcpy(&value, position, sizeof(T));
+      position += sizeof(T);
+
+      return value;
+    }
+
+    std::uint64_t getVarint() {
+      std::uint64_t value = 0;
+
+      for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (position == end) {
+          isValid = false;
+
+          return 0;
+        }
+
+        auto byte = *position++;
+
+        value |= static_cast<std::uint64_t>(byte & 0x7FU) << shift;
+
+        if ((byte & 0x80U) == 0) {
+          return value;
+        }
+      }
+
+      isValid = false;
+
+      return value;
+    }
+  };
+
+  bool load() {
+    auto size = file_->getSize();
+    Cursor header{getData(), getData() + size};
+
+    if (size < sizeof(TimeAndSaleTape::MAGIC) + sizeof(TimeAndSaleTape::Footer) ||
+        std::memcmp(getData(), TimeAndSaleTape::MAGIC, sizeof(TimeAndSaleTape::MAGIC)) != 0) {
+      return false;
+    }
+
+    header.position += sizeof(TimeAndSaleTape::MAGIC);
+
+    auto version = header.get<std::uint32_t>();
+
+    priceScale_ = header.get<double>();
+
+    auto symbolLength = header.get<std::uint32_t>();
+
+    if (!header.isValid || version != TimeAndSaleTape::VERSION ||
+        static_cast<std::size_t>(header.end - header.position) < symbolLength) {
+      return false;
+    }
+
+    symbol_.assign(reinterpret_cast<const char*>(header.position), symbolLength);
+
+    TimeAndSaleTape::Footer footer{};
+
+    std::memcpy(&footer, getData() + size - sizeof(footer), sizeof(footer));
+
+    auto footerOffset = size - sizeof(footer);
+
+    // The dictionary is followed by the index
+    if (std::memcmp(footer.magic, TimeAndSaleTape::MAGIC, sizeof(footer.magic)) != 0 ||
+        footer.dictionaryOffset > footer.indexOffset || footer.indexOffset > footerOffset ||
+        footer.blocksNumber > (footerOffset - footer.indexOffset) / sizeof(TimeAndSaleTape::Block)) {
+      return false;
+    }
+
+    eventsNumber_ = footer.eventsNumber;
+    blocks_.resize(footer.blocksNumber);
+
+    if (!blocks_.empty()) {
+      std::memcpy(blocks_.data(), getData() + footer.indexOffset, blocks_.size() * sizeof(TimeAndSaleTape::Block));
+    }
+
+    for (const auto& block : blocks_) {
+      if (block.offset > footer.dictionaryOffset || block.size > footer.dictionaryOffset - block.offset) {
+        return false;
+      }
+    }
+
+    Cursor dictionary{getData() + footer.dictionaryOffset, getData() + footer.indexOffset};
+    auto stringsNumber = dictionary.get<std::uint32_t>();
+
+    for (std::uint32_t i = 0; i < stringsNumber && dictionary.isValid; i++) {
+      auto length = dictionary.get<std::uint32_t>();
+
+      if (static_cast<std::size_t>(dictionary.end - dictionary.position) < length) {
+        return false;
+      }
+
+      strings_.emplace_back(reinterpret_cast<const char*>(dictionary.position), length);
+      dictionary.position += length;
+    }
+
+    return dictionary.isValid;
+  }
+
+  [[nodiscard]] double decodePrice(Cursor& cursor, std::uint32_t mask, std::uint32_t changedBit, std::uint32_t rawBit,
+                                   std::int64_t& ticks, double price) const {
+    if ((mask & rawBit) != 0) {
+      return cursor.get<double>();
+    }
+
+    if ((mask & changedBit) != 0) {
+      ticks += TimeAndSaleTape::fromZigzag(cursor.getVarint());
+
+      return static_cast<double>(ticks) / priceScale_;
+    }
+
+    return price;
+  }
+
+ public:
+  // Maps the tape. Returns nullptr if the file can't be mapped or it's not a complete tape of the supported version
+  static std::unique_ptr<TimeAndSaleTapeReader> open(const std::string& path) {
+    auto file = MappedFile::open(path, false);
+
+    if (!file) {
+      return nullptr;
+    }
+
+    auto reader = std::unique_ptr<TimeAndSaleTapeReader>(new TimeAndSaleTapeReader(std::move(file)));
+
+    return reader->load() ? std::move(reader) : nullptr;
+  }
+
+  [[nodiscard]] const std::string& getSymbol() const { return symbol_; }
+
+  // The number of the price ticks in the price unit
+  [[nodiscard]] double getPriceScale() const { return priceScale_; }
+
+  [[nodiscard]] std::uint64_t getSize() const { return eventsNumber_; }
+
+  [[nodiscard]] bool isEmpty() const { return eventsNumber_ == 0; }
+
+  [[nodiscard]] const std::vector<TimeAndSaleTape::Block>& getBlocks() const { return blocks_; }
+
+  // Returns the string of the id of the record (the empty string if there is no such id)
+  [[nodiscard]] std::string_view getString(std::uint32_t id) const {
+    return id < strings_.size() ? strings_[id] : std::string_view{};
+  }
+
+  // Passes every record of the block to the f in the order of the writing. Returns false if the block is corrupt.
+  template <typename F>
+  bool forEachRecordInBlock(std::size_t blockIndex, F&& f) const {
+    const auto& block = blocks_[blockIndex];
+    Cursor cursor{getData() + block.offset, getData() + block.offset + block.size};
+    TimeAndSaleTape::State state{};
+    TimeAndSaleRecord record{};
+
+    for (std::uint32_t i = 0; i < block.eventsNumber; i++) {
+      auto mask = static_cast<std::uint32_t>(cursor.getVarint());
+
+      state.time += TimeAndSaleTape::fromZigzag(cursor.getVarint());
+
+      if ((mask & TimeAndSaleTape::RAW_INDEX) != 0) {
+        state.index += TimeAndSaleTape::fromZigzag(cursor.getVarint());
+      } else {
+        state.index = TimeAndSaleTape::getTimeSequence(state.time, cursor.getVarint());
+      }
+
+      state.prices[0] = decodePrice(cursor, mask, TimeAndSaleTape::PRICE, TimeAndSaleTape::RAW_PRICE,
+                                    state.priceTicks[0], state.prices[0]);
+      state.prices[1] = decodePrice(cursor, mask, TimeAndSaleTape::BID_PRICE, TimeAndSaleTape::RAW_BID_PRICE,
+                                    state.priceTicks[1], state.prices[1]);
+      state.prices[2] = decodePrice(cursor, mask, TimeAndSaleTape::ASK_PRICE, TimeAndSaleTape::RAW_ASK_PRICE,
+                                    state.priceTicks[2], state.prices[2]);
+
+      if ((mask & TimeAndSaleTape::RAW_SIZE) != 0) {
+        state.size = cursor.get<double>();
+      } else if ((mask & TimeAndSaleTape::SIZE) != 0) {
+        state.size = static_cast<double>(cursor.getVarint());
+      }
+
+      if ((mask & TimeAndSaleTape::FLAGS) != 0) {
+        state.flags = static_cast<std::int32_t>(static_cast<std::uint32_t>(cursor.getVarint()));
+      }
+
+      if ((mask & TimeAndSaleTape::EVENT_FLAGS) != 0) {
+        state.eventFlags = static_cast<std::uint32_t>(cursor.getVarint());
+      }
+
+      if ((mask & TimeAndSaleTape::EXCHANGE_CODE) != 0) {
+        state.exchangeCode = static_cast<char>(cursor.get<std::uint8_t>());
+      }
+
+      if ((mask & TimeAndSaleTape::SCOPE) != 0) {
+        state.scope = cursor.get<std::uint8_t>();
+      }
+
+      if ((mask & TimeAndSaleTape::EXCHANGE_SALE_CONDITIONS) != 0) {
+        state.strings[0] = static_cast<std::uint32_t>(cursor.getVarint());
+      }
+
+      if ((mask & TimeAndSaleTape::BUYER) != 0) {
+        state.strings[1] = static_cast<std::uint32_t>(cursor.getVarint());
+      }
+
+      if ((mask & TimeAndSaleTape::SELLER) != 0) {
+        state.strings[2] = static_cast<std::uint32_t>(cursor.getVarint());
+      }
+
+      if (!cursor.isValid) {
+        return false;
+      }
+
+      record.time = state.time;
+      record.index = state.index;
+      record.price = state.prices[0];
+      record.size = state.size;
+      record.bidPrice = state.prices[1];
+      record.askPrice = state.prices[2];
+      record.eventFlags = state.eventFlags;
+      record.flags = state.flags;
+      record.exchangeSaleConditions = state.strings[0];
+      record.buyer = state.strings[1];
+      record.seller = state.strings[2];
+      record.exchangeCode = state.exchangeCode;
+      record.tradeThroughExempt = static_cast<char>((state.flags >> TimeAndSaleBatchConverter::TTE_SHIFT) &
+                                                    TimeAndSaleBatchConverter::TTE_MASK);
+      record.side = static_cast<std::uint8_t>((state.flags >> TimeAndSaleBatchConverter::SIDE_SHIFT) &
+                                              TimeAndSaleBatchConverter::SIDE_MASK);
+      record.type = static_cast<std::uint8_t>(state.flags & TimeAndSaleBatchConverter::TYPE_MASK);
+      record.scope = state.scope;
+      record.attributes = static_cast<std::uint8_t>((state.flags >> TimeAndSaleBatchConverter::ATTRIBUTES_SHIFT) &
+                                                    TimeAndSaleBatchConverter::ATTRIBUTES_MASK);
+
+      f(static_cast<const TimeAndSaleRecord&>(record));
+    }
+
+    return true;
+  }
+
+  // Passes every record to the f(const TimeAndSaleRecord&) in the order of the writing. The strings are the ids (see
+  // getString). Returns false if the file is corrupt (the records of the corrupt block are not passed).
+  template <typename F>
+  bool forEachRecord(F&& f) const {
+    for (std::size_t i = 0; i < blocks_.size(); i++) {
+      if (!forEachRecordInBlock(i, f)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Passes the records in the time range [fromTime, toTime) to the f, the blocks out of the range are skipped by the
+  // index. Returns false if the file is corrupt.
+  template <typename F>
+  bool forEachRecordInTimeRange(std::int64_t fromTime, std::int64_t toTime, F&& f) const {
+    for (std::size_t i = 0; i < blocks_.size(); i++) {
+      if (blocks_[i].maxTime < fromTime || blocks_[i].minTime >= toTime) {
+        continue;
+      }
+
+      if (!forEachRecordInBlock(i, [&f, fromTime, toTime](const TimeAndSaleRecord& record) {
+            if (record.time >= fromTime && record.time < toTime) {
+              f(record);
+            }
+          })) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Converts the record to the event
+  [[nodiscard]] TimeAndSale getEvent(const TimeAndSaleRecord& record,
+                                     std::shared_ptr<const std::string> symbol = nullptr) const {
+    TimeAndSale result{};
+
+    result.setEventSymbol(symbol ? std::move(symbol) : std::make_shared<const std::string>(symbol_));
+    result.setTime(static_cast<std::uint64_t>(record.time));
+    result.setIndex(static_cast<std::uint64_t>(record.index));
+    result.setPrice(record.price);
+    result.setSize(record.size);
+    result.setBidPrice(record.bidPrice);
+    result.setAskPrice(record.askPrice);
+    result.setEventFlags(record.eventFlags);
+    result.setFlags(record.flags);
+    result.setExchangeCode(record.exchangeCode);
+    result.setTradeThroughExempt(record.tradeThroughExempt);
+    result.setSide(static_cast<OrderSide>(record.side));
+    result.setType(static_cast<TimeAndSaleType>(record.type));
+    result.setScope(static_cast<OrderScope>(record.scope));
+    result.setIsValidTick((record.attributes & TimeAndSaleColumns::VALID_TICK) != 0);
+    result.setIsEthTrade((record.attributes & TimeAndSaleColumns::ETH_TRADE) != 0);
+    result.setIsSpreadLeg((record.attributes & TimeAndSaleColumns::SPREAD_LEG) != 0);
+    result.setExchangeSaleConditions(std::string(getString(record.exchangeSaleConditions)));
+    result.setBuyer(std::string(getString(record.buyer)));
+    result.setSeller(std::string(getString(record.seller)));
+
+    return result;
+  }
+};
+
+}  // namespace dxf
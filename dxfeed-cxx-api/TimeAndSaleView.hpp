@@ -0,0 +1,94 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "EventTraits.hpp"
+#include "OrderScope.hpp"
+#include "OrderSide.hpp"
+#include "StringConverter.hpp"
+#include "SymbolTable.hpp"
+#include "TimeAndSale.hpp"
+
+namespace dxf {
+
+// The non-owning view of the C API TimeAndSale event. It is valid only during the listener call. The fields are read
+// from the C struct on access and the strings are converted only when they are requested, so the filters that read a
+// few fields don't pay for the conversion of the rest. toTimeAndSale returns the owning event.
+class TimeAndSaleView final {
+  const std::shared_ptr<const std::string>* symbol_;
+  const dxf_time_and_sale_t* tns_;
+
+ public:
+  // symbol - the shared symbol of the event (e.g. interned), it must outlive the view
+  TimeAndSaleView(const std::shared_ptr<const std::string>& symbol, const dxf_time_and_sale_t& tns)
+      : symbol_{&symbol}, tns_{&tns} {}
+
+  // The view of the event of the interned symbol
+  TimeAndSaleView(const Symbol& symbol, const dxf_time_and_sale_t& tns) : TimeAndSaleView(symbol.getSharedName(), tns) {}
+
+  [[nodiscard]] const std::string& getEventSymbol() const { return **symbol_; }
+
+  [[nodiscard]] const std::shared_ptr<const std::string>& getSharedEventSymbol() const { return *symbol_; }
+
+  [[nodiscard]] const dxf_time_and_sale_t& getRaw() const { return *tns_; }
+
+  [[nodiscard]] std::uint32_t getEventFlags() const { return tns_->event_flags; }
+
+  [[nodiscard]] std::uint64_t getIndex() const { return static_cast<std::uint64_t>(tns_->index); }
+
+  [[nodiscard]] std::uint64_t getTime() const { return static_cast<std::uint64_t>(tns_->time); }
+
+  [[nodiscard]] char getExchangeCode() const { return StringConverter::wCharToUtf8(tns_->exchange_code); }
+
+  [[nodiscard]] double getPrice() const { return tns_->price; }
+
+  [[nodiscard]] double getSize() const { return tns_->size; }
+
+  [[nodiscard]] double getBidPrice() const { return tns_->bid_price; }
+
+  [[nodiscard]] double getAskPrice() const { return tns_->ask_price; }
+
+  [[nodiscard]] TimeAndSale::ShortString getExchangeSaleConditions() const {
+    return TimeAndSale::ShortString::fromUtf16(tns_->exchange_sale_conditions);
+  }
+
+  [[nodiscard]] std::int32_t getFlags() const { return tns_->raw_flags; }
+
+  [[nodiscard]] TimeAndSale::ShortString getBuyer() const { return TimeAndSale::ShortString::fromUtf16(tns_->buyer); }
+
+  [[nodiscard]] TimeAndSale::ShortString getSeller() const {
+    return TimeAndSale::ShortString::fromUtf16(tns_->seller);
+  }
+
+  [[nodiscard]] OrderSide getSide() const { return static_cast<OrderSide>(tns_->side); }
+
+  [[nodiscard]] TimeAndSaleType getType() const { return static_cast<TimeAndSaleType>(tns_->type); }
+
+  [[nodiscard]] bool isValidTick() const { return tns_->is_valid_tick != 0; }
+
+  [[nodiscard]] bool isEthTrade() const { return tns_->is_eth_trade != 0; }
+
+  [[nodiscard]] char getTradeThroughExempt() const { return StringConverter::wCharToUtf8(tns_->trade_through_exempt); }
+
+  [[nodiscard]] bool isSpreadLeg() const { return tns_->is_spread_leg != 0; }
+
+  [[nodiscard]] OrderScope getScope() const { return static_cast<OrderScope>(tns_->scope); }
+
+  // Converts all fields to the owning event
+  [[nodiscard]] TimeAndSale toTimeAndSale() const { return TimeAndSale(*symbol_, *tns_); }
+};
+
+template <>
+struct EventTraits<TimeAndSaleView> {
+  static std::uint64_t getIndex(const TimeAndSaleView& e) { return e.getIndex(); }
+
+  static std::uint32_t getEventFlags(const TimeAndSaleView& e) { return e.getEventFlags(); }
+
+  static std::uint64_t getTime(const TimeAndSaleView& e) { return e.getTime(); }
+};
+
+}  // namespace dxf
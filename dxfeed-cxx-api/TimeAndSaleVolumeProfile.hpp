@@ -0,0 +1,573 @@
+#pragma once
+
+#include <DXFeed.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "EventTraits.hpp"
+#include "OrderSide.hpp"
+#include "SymbolTable.hpp"
+#include "TimeAndSale.hpp"
+#include "TimeAndSaleColumns.hpp"
+
+namespace dxf {
+
+// The traded volume at one price, split by the aggressor side
+struct VolumeAtPrice {
+  double price = std::numeric_limits<double>::quiet_NaN();
+  // The volumes of the trades of the buy, the sell and the undefined aggressor side
+  double buyVolume = 0.0;
+  double sellVolume = 0.0;
+  double undefinedVolume = 0.0;
+  std::uint64_t count = 0;
+
+  [[nodiscard]] double getVolume() const { return buyVolume + sellVolume + undefinedVolume; }
+
+  // The buy volume minus the sell volume
+  [[nodiscard]] double getDelta() const { return buyVolume - sellVolume; }
+};
+
+// The volume profile of one symbol: the traded volumes at the prices by the tick. The volumes are kept in the flat
+// array indexed by the tick from the lowest traded one, so the trade changes its cell in O(1) and the profile of the
+// session stays in the cache. The array grows from the first trade price to both sides (at least twice at a time, so
+// the walk of the price is amortized O(1)) up to the maximum number of the ticks; the trades that are farther from the
+// traded range are not added (see add).
+//
+// The profiles of the sessions (e.g. of the days) are merged into the composite one by merge, the prices are re-ticked
+// if the tick sizes are different.
+class VolumeProfile final {
+  struct Cell {
+    // By the OrderSide
+    double volumes[3]{};
+    std::uint64_t count = 0;
+  };
+
+  double tickSize_;
+  std::size_t maxTicks_;
+  // The tick of the cells_[0]
+  std::int64_t firstTick_ = 0;
+  std::vector<Cell> cells_{};
+  Cell total_{};
+
+  static std::size_t getSideIndex(OrderSide side) {
+    return side == OrderSide::BUY ? 1 : side == OrderSide::SELL ? 2 : 0;
+  }
+
+  [[nodiscard]] VolumeAtPrice toVolumeAtPrice(std::int64_t tick, const Cell& cell) const {
+    return {static_cast<double>(tick) * tickSize_, cell.volumes[1], cell.volumes[2], cell.volumes[0], cell.count};
+  }
+
+  // Grows the array to the tick. Returns false if the range would exceed the maximum number of the ticks.
+  bool reserve(std::int64_t tick) {
+    if (cells_.empty()) {
+      firstTick_ = tick;
+      cells_.resize(1);
+
+      return true;
+    }
+
+    auto size = static_cast<std::int64_t>(cells_.size());
+    auto lastTick = firstTick_ + size - 1;
+
+    if (tick >= firstTick_ && tick <= lastTick) {
+      return true;
+    }
+
+    auto needed = (std::max)(tick, lastTick) - (std::min)(tick, firstTick_) + 1;
+
+    if (needed > static_cast<std::int64_t>(maxTicks_)) {
+      return false;
+    }
+
+    auto newSize = (std::min)((std::max)(needed, size * 2), static_cast<std::int64_t>(maxTicks_));
+
+    if (tick < firstTick_) {
+      cells_.insert(cells_.begin(), static_cast<std::size_t>(newSize - size), Cell{});
+      firstTick_ = lastTick - newSize + 1;
+    } else {
+      cells_.resize(static_cast<std::size_t>(newSize));
+    }
+
+    return true;
+  }
+
+  static void addTo(Cell& cell, std::size_t sideIndex, double size, std::int64_t countDelta) {
+    cell.volumes[sideIndex] += size;
+    cell.count += static_cast<std::uint64_t>(countDelta);
+
+    // The sums of the additions and the removals are not exact
+    if (cell.count == 0) {
+      cell.volumes[0] = cell.volumes[1] = cell.volumes[2] = 0.0;
+    }
+  }
+
+ public:
+  // tickSize - the price step of the cells (positive), maxTicks - the maximum number of the cells
+  explicit VolumeProfile(double tickSize = 0.01, std::size_t maxTicks = std::size_t{1} << 18)
+      : tickSize_{tickSize > 0.0 ? tickSize : 0.01}, maxTicks_{(std::max)(maxTicks, std::size_t{1})} {}
+
+  [[nodiscard]] double getTickSize() const { return tickSize_; }
+
+  [[nodiscard]] std::int64_t toTick(double price) const { return std::llround(price / tickSize_); }
+
+  // Adds the trade (count = 1) or removes it (count = -1, e.g. the cancel of the added trade: the same tick, size and
+  // side). Returns false if the price is not finite or out of the range of the maximum number of the ticks.
+  bool add(std::int64_t tick, double size, OrderSide side, std::int64_t count = 1) {
+    if (!reserve(tick)) {
+      return false;
+    }
+
+    auto sideIndex = getSideIndex(side);
+    auto signedSize = count < 0 ? -size : size;
+
+    addTo(cells_[static_cast<std::size_t>(tick - firstTick_)], sideIndex, signedSize, count);
+    addTo(total_, sideIndex, signedSize, count);
+
+    return true;
+  }
+
+  bool add(double price, double size, OrderSide side) {
+    if (!std::isfinite(price) || std::isnan(size)) {
+      return false;
+    }
+
+    return add(toTick(price), size, side);
+  }
+
+  // Adds the volumes of the other profile (e.g. of the previous session), O(the ticks of the other profile). The
+  // prices of the other profile are mapped to the ticks of this one. Returns false if some prices are out of the range
+  // (their volumes are not added).
+  bool merge(const VolumeProfile& other) {
+    auto isMerged = true;
+
+    for (std::size_t i = 0; i < other.cells_.size(); i++) {
+      const auto& cell = other.cells_[i];
+
+      if (cell.count == 0) {
+        continue;
+      }
+
+      auto tick = toTick(static_cast<double>(other.firstTick_ + static_cast<std::int64_t>(i)) * other.tickSize_);
+
+      if (!reserve(tick)) {
+        isMerged = false;
+
+        continue;
+      }
+
+      auto& target = cells_[static_cast<std::size_t>(tick - firstTick_)];
+
+      for (std::size_t side = 0; side < 3; side++) {
+        target.volumes[side] += cell.volumes[side];
+        total_.volumes[side] += cell.volumes[side];
+      }
+
+      target.count += cell.count;
+      total_.count += cell.count;
+    }
+
+    return isMerged;
+  }
+
+  void clear() {
+    cells_.clear();
+    total_ = {};
+  }
+
+  [[nodiscard]] bool isEmpty() const { return total_.count == 0; }
+
+  // The volumes of all prices
+  [[nodiscard]] VolumeAtPrice getTotal() const { return toVolumeAtPrice(0, total_); }
+
+  // The volumes at the price (zero if there are no trades)
+  [[nodiscard]] VolumeAtPrice getVolumeAt(double price) const {
+    auto tick = toTick(price);
+
+    if (cells_.empty() || tick < firstTick_ || tick - firstTick_ >= static_cast<std::int64_t>(cells_.size())) {
+      return toVolumeAtPrice(tick, {});
+    }
+
+    return toVolumeAtPrice(tick, cells_[static_cast<std::size_t>(tick - firstTick_)]);
+  }
+
+  // The prices with the trades, from the lowest one
+  [[nodiscard]] std::vector<VolumeAtPrice> getLevels() const {
+    std::vector<VolumeAtPrice> result{};
+
+    for (std::size_t i = 0; i < cells_.size(); i++) {
+      if (cells_[i].count != 0) {
+        result.push_back(toVolumeAtPrice(firstTick_ + static_cast<std::int64_t>(i), cells_[i]));
+      }
+    }
+
+    return result;
+  }
+
+  // The price of the largest volume, the point of control (NaN if there are no trades)
+  [[nodiscard]] double getPointOfControl() const {
+    auto price = std::numeric_limits<double>::quiet_NaN();
+    auto maxVolume = -std::numeric_limits<double>::infinity();
+
+    for (std::size_t i = 0; i < cells_.size(); i++) {
+      const auto& volumes = cells_[i].volumes;
+      auto volume = volumes[0] + volumes[1] + volumes[2];
+
+      if (cells_[i].count != 0 && volume > maxVolume) {
+        maxVolume = volume;
+        price = static_cast<double>(firstTick_ + static_cast<std::int64_t>(i)) * tickSize_;
+      }
+    }
+
+    return price;
+  }
+
+  // The lowest and the highest prices of the value area: the range around the point of control that is extended by
+  // the larger of the next prices of both sides until it has the share (e.g. 0.7) of the volume. NaNs if there are no
+  // trades.
+  [[nodiscard]] std::pair<double, double> getValueArea(double share = 0.7) const {
+    auto pointOfControl = getPointOfControl();
+
+    if (std::isnan(pointOfControl)) {
+      return {pointOfControl, pointOfControl};
+    }
+
+    auto volumeOf = [this](std::size_t i) {
+      const auto& volumes = cells_[i].volumes;
+
+      return volumes[0] + volumes[1] + volumes[2];
+    };
+    auto target = getTotal().getVolume() * share;
+    auto low = static_cast<std::size_t>(toTick(pointOfControl) - firstTick_);
+    auto high = low;
+    auto volume = volumeOf(low);
+
+    while (volume < target && (low > 0 || high + 1 < cells_.size())) {
+      auto lowVolume = low > 0 ? volumeOf(low - 1) : -1.0;
+      auto highVolume = high + 1 < cells_.size() ? volumeOf(high + 1) : -1.0;
+
+      if (highVolume >= lowVolume) {
+        volume += volumeOf(++high);
+      } else {
+        volume += volumeOf(--low);
+      }
+    }
+
+    return {static_cast<double>(firstTick_ + static_cast<std::int64_t>(low)) * tickSize_,
+            static_cast<double>(firstTick_ + static_cast<std::int64_t>(high)) * tickSize_};
+  }
+
+  // The bytes of the cells
+  [[nodiscard]] std::size_t getMemoryUsage() const { return cells_.capacity() * sizeof(Cell); }
+};
+
+// The incremental volume profiles (see VolumeProfile) of the TimeAndSale streams per symbol: every trade changes the
+// volume of its price and its aggressor side in O(1), so the profile isn't rebuilt by the rescan of the history.
+//
+// The trades of the correction window (from the latest trade time back) are kept by the index with their ticks, sizes
+// and sides, so the CORRECTION (the trade of the same index is replaced), the CANCEL and the REMOVE_EVENT (the trade is
+// removed) subtract the volume of the kept trade exactly. The changes of the trades that are out of the window are
+// ignored (expiredNumber). The trades without the price or the size (NaN) are ignored.
+//
+// The session is closed by closeSession: its profile is returned (e.g. to be merged into the composite profile of the
+// week by VolumeProfile::merge) and the next trades start the new one.
+//
+// Usage:
+//   TimeAndSaleVolumeProfileAggregator profiles{0.01, 3600000};
+//
+//   profiles.update(symbol, tns, count);   // e.g. in the EventReceiver::receiveBatchesAsync handler
+//   auto pointOfControl = profiles.getProfile(symbol)->getPointOfControl();
+//
+//   composite.merge(profiles.closeSession(symbol));
+//
+// Not thread-safe: one thread updates and reads the aggregator (e.g. the symbols are sharded by the threads, or the
+// groups of SimpleTimeAndSaleDataProvider::runStreamingGroups are passed one at a time).
+class TimeAndSaleVolumeProfileAggregator final {
+ public:
+  struct Stats {
+    std::uint64_t tradesNumber = 0;
+    std::uint64_t correctionsNumber = 0;
+    // The CANCEL and the REMOVE_EVENT trades
+    std::uint64_t removalsNumber = 0;
+    // The trades with the index before the latest one
+    std::uint64_t lateNumber = 0;
+    // The changes of the trades that are out of the correction window or unknown
+    std::uint64_t expiredNumber = 0;
+    // The trades out of the price range of the profile (see VolumeProfile)
+    std::uint64_t outOfRangeNumber = 0;
+  };
+
+ private:
+  using Flags = EventFlags::Flags;
+
+  struct Trade {
+    std::int64_t index;
+    std::int64_t time;
+    std::int64_t tick;
+    double size;
+    OrderSide side;
+  };
+
+  struct SymbolState {
+    VolumeProfile profile;
+    std::deque<Trade> trades{};
+    std::int64_t latestTime = std::numeric_limits<std::int64_t>::min();
+  };
+
+  // The columns of the trades of the batch (the rows of TimeAndSaleColumns or of the converted listener data)
+  struct TradeColumns {
+    const std::int64_t* time;
+    const std::int64_t* index;
+    const double* price;
+    const double* size;
+    const OrderSide* side;
+    const TimeAndSaleType* type;
+    const std::uint32_t* eventFlags;
+  };
+
+  double tickSize_;
+  std::int64_t correctionWindow_;
+  std::size_t maxTicks_;
+  // By the id of the interned symbol
+  std::vector<std::unique_ptr<SymbolState>> states_{};
+  Stats stats_{};
+
+  // The scratch columns of the listener data (the capacity is kept)
+  std::vector<std::int64_t> time_{};
+  std::vector<std::int64_t> index_{};
+  std::vector<double> price_{};
+  std::vector<double> size_{};
+  std::vector<OrderSide> side_{};
+  std::vector<TimeAndSaleType> type_{};
+  std::vector<std::uint32_t> eventFlags_{};
+
+  static bool isValid(double price, double size) { return std::isfinite(price) && !std::isnan(size); }
+
+  SymbolState& getState(const Symbol& symbol) {
+    auto id = symbol.getId();
+
+    if (id >= states_.size()) {
+      states_.resize(static_cast<std::size_t>(id) + 1);
+    }
+
+    auto& state = states_[id];
+
+    if (!state) {
+      state = std::make_unique<SymbolState>(SymbolState{VolumeProfile{tickSize_, maxTicks_}});
+    }
+
+    return *state;
+  }
+
+  [[nodiscard]] const SymbolState* findState(const Symbol& symbol) const {
+    auto id = symbol.getId();
+
+    return id < states_.size() ? states_[id].get() : nullptr;
+  }
+
+  static std::deque<Trade>::iterator findPosition(SymbolState& state, std::int64_t index) {
+    return std::lower_bound(state.trades.begin(), state.trades.end(), index,
+                            [](const Trade& trade, std::int64_t i) { return trade.index < i; });
+  }
+
+  std::deque<Trade>::iterator findTrade(SymbolState& state, std::int64_t index) {
+    auto found = findPosition(state, index);
+
+    return found != state.trades.end() && found->index == index ? found : state.trades.end();
+  }
+
+  // Drops the kept trades that are out of the correction window (their volumes stay in the profile)
+  void expire(SymbolState& state) const {
+    auto cutoff = state.latestTime - correctionWindow_;
+
+    while (!state.trades.empty() && state.trades.front().time < cutoff) {
+      state.trades.pop_front();
+    }
+  }
+
+  bool isExpired(const SymbolState& state, std::int64_t time) const {
+    return state.latestTime != std::numeric_limits<std::int64_t>::min() && time < state.latestTime - correctionWindow_;
+  }
+
+  // Adds the volume of the new trade to the profile. Returns false if it's out of the price range.
+  bool addTrade(SymbolState& state, const Trade& trade) {
+    if (!state.profile.add(trade.tick, trade.size, trade.side)) {
+      stats_.outOfRangeNumber++;
+
+      return false;
+    }
+
+    return true;
+  }
+
+  // Applies the trade by its type and flags
+  void apply(SymbolState& state, std::int64_t time, std::int64_t index, double price, double size, OrderSide side,
+             TimeAndSaleType type, std::uint32_t eventFlags) {
+    auto isRemoval = (eventFlags & Flags::REMOVE_EVENT) != 0 || type == TimeAndSaleType::CANCEL;
+    auto found = state.trades.end();
+
+    if (isRemoval || type == TimeAndSaleType::CORRECTION) {
+      isRemoval ? stats_.removalsNumber++ : stats_.correctionsNumber++;
+      found = findTrade(state, index);
+
+      // The correction of the unknown trade within the window is the new trade
+      if (found == state.trades.end() && (isRemoval || isExpired(state, time) || !isValid(price, size))) {
+        stats_.expiredNumber++;
+
+        return;
+      }
+    } else if (!isValid(price, size) || isExpired(state, time)) {
+      return;
+    } else if (!state.trades.empty() && index <= state.trades.back().index) {
+      // The late trade or the repeated index (replaces the kept trade)
+      stats_.lateNumber++;
+      found = findTrade(state, index);
+    }
+
+    if (found != state.trades.end()) {
+      state.profile.add(found->tick, found->size, found->side, -1);
+
+      if (isRemoval || !isValid(price, size)) {
+        state.trades.erase(found);
+
+        return;
+      }
+
+      *found = Trade{index, time, state.profile.toTick(price), size, side};
+
+      if (!addTrade(state, *found)) {
+        state.trades.erase(found);
+      }
+
+      state.latestTime = (std::max)(state.latestTime, time);
+
+      return;
+    }
+
+    stats_.tradesNumber++;
+
+    Trade trade{index, time, state.profile.toTick(price), size, side};
+
+    if (!addTrade(state, trade)) {
+      return;
+    }
+
+    if (state.trades.empty() || index > state.trades.back().index) {
+      state.trades.push_back(trade);
+    } else {
+      state.trades.insert(findPosition(state, index), trade);
+    }
+
+    state.latestTime = (std::max)(state.latestTime, time);
+  }
+
+  void updateColumns(SymbolState& state, const TradeColumns& trades, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      apply(state, trades.time[i], trades.index[i], trades.price[i], trades.size[i], trades.side[i], trades.type[i],
+            trades.eventFlags[i]);
+    }
+
+    expire(state);
+  }
+
+ public:
+  // tickSize - the price step of the profiles (positive), correctionWindow - the time window of the trades that can be
+  // corrected or cancelled (ms), maxTicks - the maximum number of the prices of the profile of the symbol
+  TimeAndSaleVolumeProfileAggregator(double tickSize, std::int64_t correctionWindow,
+                                     std::size_t maxTicks = std::size_t{1} << 18)
+      : tickSize_{tickSize}, correctionWindow_{correctionWindow}, maxTicks_{maxTicks} {}
+
+  TimeAndSaleVolumeProfileAggregator(const TimeAndSaleVolumeProfileAggregator&) = delete;
+  TimeAndSaleVolumeProfileAggregator& operator=(const TimeAndSaleVolumeProfileAggregator&) = delete;
+
+  // Sets the tick size of the profile of the symbol (e.g. of the instrument profile). Applies only to the empty
+  // profile: before the first trade or after closeSession.
+  bool setTickSize(const Symbol& symbol, double tickSize) {
+    auto& state = getState(symbol);
+
+    if (!state.profile.isEmpty()) {
+      return false;
+    }
+
+    state.profile = VolumeProfile{tickSize, maxTicks_};
+
+    return true;
+  }
+
+  void update(const Symbol& symbol, const TimeAndSale& tns) {
+    auto& state = getState(symbol);
+
+    apply(state, static_cast<std::int64_t>(tns.getTime()),
+          static_cast<std::int64_t>(EventTraits<TimeAndSale>::getIndex(tns)), tns.getPrice(), tns.getSize(),
+          tns.getSide(), tns.getType(), EventTraits<TimeAndSale>::getEventFlags(tns));
+    expire(state);
+  }
+
+  // Updates by the listener data of the symbol: the fields are converted to the columns at once
+  void update(const Symbol& symbol, const dxf_time_and_sale_t* tns, std::size_t count) {
+    time_.resize(count);
+    index_.resize(count);
+    price_.resize(count);
+    size_.resize(count);
+    side_.resize(count);
+    type_.resize(count);
+    eventFlags_.resize(count);
+
+    for (std::size_t i = 0; i < count; i++) {
+      time_[i] = static_cast<std::int64_t>(tns[i].time);
+      index_[i] = static_cast<std::int64_t>(tns[i].index);
+      price_[i] = tns[i].price;
+      size_[i] = tns[i].size;
+      side_[i] = static_cast<OrderSide>(tns[i].side);
+      type_[i] = static_cast<TimeAndSaleType>(tns[i].raw_flags & TimeAndSaleBatchConverter::TYPE_MASK);
+      eventFlags_[i] = static_cast<std::uint32_t>(tns[i].event_flags);
+    }
+
+    updateColumns(getState(symbol),
+                  TradeColumns{time_.data(), index_.data(), price_.data(), size_.data(), side_.data(), type_.data(),
+                               eventFlags_.data()},
+                  count);
+  }
+
+  // Updates by the rows [first, first + count) of the columnar storage of the symbol (e.g. of
+  // SimpleTimeAndSaleDataProvider::runColumnar)
+  void update(const Symbol& symbol, const TimeAndSaleColumns& columns, std::size_t first, std::size_t count) {
+    updateColumns(getState(symbol),
+                  TradeColumns{columns.time.data() + first, columns.index.data() + first, columns.price.data() + first,
+                               columns.size.data() + first, columns.side.data() + first, columns.type.data() + first,
+                               columns.eventFlags.data() + first},
+                  count);
+  }
+
+  // The profile of the current session of the symbol (nullptr if there were no trades)
+  [[nodiscard]] const VolumeProfile* getProfile(const Symbol& symbol) const {
+    const auto* state = findState(symbol);
+
+    return state != nullptr ? &state->profile : nullptr;
+  }
+
+  // Returns the profile of the current session of the symbol and starts the new session: the next trades are added to
+  // the empty profile of the same tick size, the kept trades are dropped (the changes of the trades of the closed
+  // session are not applied).
+  VolumeProfile closeSession(const Symbol& symbol) {
+    auto& state = getState(symbol);
+    auto tickSize = state.profile.getTickSize();
+    auto result = std::move(state.profile);
+
+    state.profile = VolumeProfile{tickSize, maxTicks_};
+    state.trades.clear();
+
+    return result;
+  }
+
+  [[nodiscard]] const Stats& getStats() const { return stats_; }
+};
+
+}  // namespace dxf
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "EventTraits.hpp"
+
+namespace dxf {
+
+// The in-memory store of the time series events ordered by the time and the index. The events are kept in the
+// chunks of up to ChunkSize events with the summaries (the time and the index ranges), so the time range is found
+// with the binary search over the chunks and the scan by the index skips the chunks without the matching events.
+//
+// The events are appended as they arrive. The events that are not after the last stored one (e.g. the history that
+// is delivered from the newest event) are kept aside and merged by flush(); the queries see only the merged events.
+// The event with the REMOVE_EVENT flag is not stored, it removes the stored event with the same time and index.
+template <TimeSeriesEventLike Event, std::size_t ChunkSize = 4096>
+class TimeSeriesStore final {
+  static_assert(ChunkSize > 0, "The chunk size must be positive");
+
+  using Traits = EventTraits<Event>;
+  using Key = std::tuple<std::uint64_t, std::uint64_t>;
+
+ public:
+  // The summary of the chunk: the time range is [minTime, maxTime], the index range is [minIndex, maxIndex]
+  struct ChunkSummary {
+    std::uint64_t minTime = 0;
+    std::uint64_t maxTime = 0;
+    std::uint64_t minIndex = 0;
+    std::uint64_t maxIndex = 0;
+  };
+
+ private:
+  struct Chunk {
+    std::vector<Event> events{};
+    ChunkSummary summary{};
+
+    void updateSummary() {
+      summary.minTime = Traits::getTime(events.front());
+      summary.maxTime = Traits::getTime(events.back());
+      summary.minIndex = std::numeric_limits<std::uint64_t>::max();
+      summary.maxIndex = 0;
+
+      for (const auto& e : events) {
+        summary.minIndex = (std::min)(summary.minIndex, static_cast<std::uint64_t>(Traits::getIndex(e)));
+        summary.maxIndex = (std::max)(summary.maxIndex, static_cast<std::uint64_t>(Traits::getIndex(e)));
+      }
+    }
+  };
+
+  std::vector<Chunk> chunks_{};
+  std::size_t size_ = 0;
+  // The events that are appended out of order and the removals that wait for them
+  std::vector<Event> pendingEvents_{};
+  std::vector<Key> pendingRemovals_{};
+
+  static Key getKey(const Event& e) { return {Traits::getTime(e), Traits::getIndex(e)}; }
+
+  static bool isLess(const Event& a, const Event& b) { return getKey(a) < getKey(b); }
+
+  // Appends the event that is not before the last one
+  void appendLast(Event&& event) {
+    if (chunks_.empty() || chunks_.back().events.size() >= ChunkSize) {
+      chunks_.emplace_back();
+      chunks_.back().events.reserve(ChunkSize);
+    }
+
+    auto& chunk = chunks_.back();
+    auto index = static_cast<std::uint64_t>(Traits::getIndex(event));
+
+    if (chunk.events.empty()) {
+      chunk.summary = {Traits::getTime(event), Traits::getTime(event), index, index};
+    } else {
+      chunk.summary.maxTime = Traits::getTime(event);
+      chunk.summary.minIndex = (std::min)(chunk.summary.minIndex, index);
+      chunk.summary.maxIndex = (std::max)(chunk.summary.maxIndex, index);
+    }
+
+    chunk.events.push_back(std::move(event));
+    size_++;
+  }
+
+  // The position of the first chunk whose last event is not before the key
+  [[nodiscard]] std::size_t findChunk(const Key& key) const {
+    auto found = std::partition_point(chunks_.begin(), chunks_.end(),
+                                      [&key](const Chunk& chunk) { return getKey(chunk.events.back()) < key; });
+
+    return static_cast<std::size_t>(found - chunks_.begin());
+  }
+
+  void remove(const Key& key) {
+    auto chunkIndex = findChunk(key);
+
+    if (chunkIndex == chunks_.size()) {
+      return;
+    }
+
+    auto& events = chunks_[chunkIndex].events;
+    auto found = std::partition_point(events.begin(), events.end(), [&key](const Event& e) { return getKey(e) < key; });
+
+    if (found == events.end() || getKey(*found) != key) {
+      return;
+    }
+
+    events.erase(found);
+    size_--;
+
+    if (events.empty()) {
+      chunks_.erase(chunks_.begin() + static_cast<std::ptrdiff_t>(chunkIndex));
+    } else {
+      chunks_[chunkIndex].updateSummary();
+    }
+  }
+
+  // The spans of the events of the chunks in the time range [fromTime, toTime)
+  template <typename F>
+  void forEachSpan(std::uint64_t fromTime, std::uint64_t toTime, F&& f) const {
+    if (fromTime >= toTime) {
+      return;
+    }
+
+    auto isBeforeFrom = [fromTime](const Event& e) { return Traits::getTime(e) < fromTime; };
+    auto isBeforeTo = [toTime](const Event& e) { return Traits::getTime(e) < toTime; };
+    auto chunk = std::partition_point(chunks_.begin(), chunks_.end(),
+                                      [fromTime](const Chunk& c) { return c.summary.maxTime < fromTime; });
+
+    for (; chunk != chunks_.end() && chunk->summary.minTime < toTime; ++chunk) {
+      const auto& events = chunk->events;
+      auto first = chunk->summary.minTime >= fromTime
+                     ? events.begin()
+                     : std::partition_point(events.begin(), events.end(), isBeforeFrom);
+      auto last =
+        chunk->summary.maxTime < toTime ? events.end() : std::partition_point(first, events.end(), isBeforeTo);
+
+      if (first != last) {
+        f(std::span<const Event>(&*first, static_cast<std::size_t>(last - first)));
+      }
+    }
+  }
+
+ public:
+  TimeSeriesStore() = default;
+
+  // Appends the event (see the class description) or removes the stored event if the event has the REMOVE_EVENT flag
+  void append(Event event) {
+    if (EventFlags::isRemoveEvent(event)) {
+      if (pendingEvents_.empty()) {
+        remove(getKey(event));
+      } else {
+        pendingRemovals_.push_back(getKey(event));
+      }
+
+      return;
+    }
+
+    if (!pendingEvents_.empty() || (!chunks_.empty() && isLess(event, chunks_.back().events.back()))) {
+      pendingEvents_.push_back(std::move(event));
+
+      return;
+    }
+
+    appendLast(std::move(event));
+  }
+
+  // Merges the events that are appended out of order and applies the removals that wait for them. The chunks after
+  // the first pending event are rebuilt.
+  void flush() {
+    if (pendingEvents_.empty()) {
+      return;
+    }
+
+    std::stable_sort(pendingEvents_.begin(), pendingEvents_.end(), isLess);
+
+    auto firstChunk = findChunk(getKey(pendingEvents_.front()));
+    std::vector<Event> tail{};
+
+    for (auto chunk = chunks_.begin() + static_cast<std::ptrdiff_t>(firstChunk); chunk != chunks_.end(); ++chunk) {
+      std::move(chunk->events.begin(), chunk->events.end(), std::back_inserter(tail));
+      size_ -= chunk->events.size();
+    }
+
+    chunks_.erase(chunks_.begin() + static_cast<std::ptrdiff_t>(firstChunk), chunks_.end());
+
+    // The stored events come first, so the merge is stable
+    std::vector<Event> merged{};
+
+    merged.reserve(tail.size() + pendingEvents_.size());
+    std::merge(std::make_move_iterator(tail.begin()), std::make_move_iterator(tail.end()),
+               std::make_move_iterator(pendingEvents_.begin()), std::make_move_iterator(pendingEvents_.end()),
+               std::back_inserter(merged), isLess);
+    pendingEvents_.clear();
+
+    // The events are after the last event of the kept chunks
+    for (auto& event : merged) {
+      appendLast(std::move(event));
+    }
+
+    for (const auto& key : pendingRemovals_) {
+      remove(key);
+    }
+
+    pendingRemovals_.clear();
+  }
+
+  // The number of the merged events
+  [[nodiscard]] std::size_t getSize() const { return size_; }
+
+  [[nodiscard]] bool isEmpty() const { return size_ == 0; }
+
+  // Returns true if there are no events that wait for flush()
+  [[nodiscard]] bool isFlushed() const { return pendingEvents_.empty(); }
+
+  [[nodiscard]] std::size_t getChunksNumber() const { return chunks_.size(); }
+
+  [[nodiscard]] const ChunkSummary& getChunkSummary(std::size_t chunkIndex) const {
+    return chunks_[chunkIndex].summary;
+  }
+
+  [[nodiscard]] std::span<const Event> getChunk(std::size_t chunkIndex) const { return chunks_[chunkIndex].events; }
+
+  // Returns the events in the time range [fromTime, toTime) as the spans of the chunks (in the order of the time)
+  [[nodiscard]] std::vector<std::span<const Event>> findTimeRange(std::uint64_t fromTime, std::uint64_t toTime) const {
+    std::vector<std::span<const Event>> result{};
+
+    forEachSpan(fromTime, toTime, [&result](std::span<const Event> span) { result.push_back(span); });
+
+    return result;
+  }
+
+  // Calls f(const Event&) for every event in the time range [fromTime, toTime) in the order of the time
+  template <typename F>
+  void forEachInTimeRange(std::uint64_t fromTime, std::uint64_t toTime, F&& f) const {
+    forEachSpan(fromTime, toTime, [&f](std::span<const Event> span) {
+      for (const auto& e : span) {
+        f(e);
+      }
+    });
+  }
+
+  // Calls f(const Event&) for every event with the index greater than the index (in the order of the time). The chunks
+  // without such events are skipped by their summaries.
+  template <typename F>
+  void forEachAfterIndex(std::uint64_t index, F&& f) const {
+    for (const auto& chunk : chunks_) {
+      if (chunk.summary.maxIndex <= index) {
+        continue;
+      }
+
+      for (const auto& e : chunk.events) {
+        if (static_cast<std::uint64_t>(Traits::getIndex(e)) > index) {
+          f(e);
+        }
+      }
+    }
+  }
+
+  // Calls f(std::span<const Event>) for the events of every chunk in the time range [fromTime, toTime) on the
+  // threadsNumber threads (0 - the number of the hardware threads). The spans are passed concurrently and in no
+  // particular order, f must be thread-safe.
+  template <typename F>
+  void parallelForEachChunk(std::uint64_t fromTime, std::uint64_t toTime, F f, std::size_t threadsNumber = 0) const {
+    auto spans = findTimeRange(fromTime, toTime);
+
+    if (threadsNumber == 0) {
+      threadsNumber = (std::max)(1U, std::thread::hardware_concurrency());
+    }
+
+    threadsNumber = (std::min)(threadsNumber, spans.size());
+
+    if (threadsNumber <= 1) {
+      for (const auto& span : spans) {
+        f(span);
+      }
+
+      return;
+    }
+
+    std::vector<std::future<void>> workers{};
+
+    for (std::size_t t = 0; t < threadsNumber; t++) {
+      workers.push_back(std::async(std::launch::async, [&spans, &f, t, threadsNumber] {
+        for (std::size_t i = t; i < spans.size(); i += threadsNumber) {
+          f(spans[i]);
+        }
+      }));
+    }
+
+    for (auto& worker : workers) {
+      worker.get();
+    }
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
+#include "TscClock.hpp"
+
+// The maximum compiled trace level (see dxf::TraceLevel). 0 - the tracing is compiled out completely.
+#ifndef DXFCXX_TRACE_LEVEL
+#define DXFCXX_TRACE_LEVEL 0
+#endif
+
+namespace dxf {
+
+enum class TraceLevel : int {
+  // Per incoming snapshot data chunk
+  TRANSACTION = 1,
+  // Per record
+  RECORD = 2
+};
+
+enum class TraceEvent : std::uint32_t {
+  // records count, new snapshot
+  SNAPSHOT_DATA = 0,
+  // index, price, size, side
+  ORDER = 1,
+};
+
+struct TraceRecord {
+  // 0 - the record is being written
+  std::atomic<std::uint64_t> sequence{};
+  std::uint64_t timestamp{};
+  TraceEvent event{};
+  std::uint64_t args[4]{};
+};
+
+// The lossy multi-producer ring of the binary trace records. The producers never block: the oldest records are
+// overwritten. The records are formatted only when the ring is dumped.
+class TraceRing final {
+  std::unique_ptr<TraceRecord[]> records_;
+  std::size_t mask_;
+  std::atomic<std::uint64_t> head_{};
+
+  template <typename T>
+  static std::uint64_t toArg(T value) {
+    if constexpr (std::is_floating_point_v<T>) {
+      return std::bit_cast<std::uint64_t>(static_cast<double>(value));
+    } else {
+      return static_cast<std::uint64_t>(value);
+    }
+  }
+
+ public:
+  // capacity - the number of the records (rounded up to the power of 2)
+  explicit TraceRing(std::size_t capacity)
+      : records_{new TraceRecord[std::bit_ceil(capacity)]}, mask_{std::bit_ceil(capacity) - 1} {}
+
+  template <typename... Args>
+  void write(TraceEvent event, Args... args) {
+    static_assert(sizeof...(Args) <= 4);
+
+    auto sequence = head_.fetch_add(1, std::memory_order_relaxed) + 1;
+    auto& record = records_[sequence & mask_];
+
+    record.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    record.timestamp = static_cast<std::uint64_t>(TscClock::nowNanos());
+    record.event = event;
+
+    std::size_t i = 0;
+    ((record.args[i++] = toArg(args)), ...);
+
+    record.sequence.store(sequence, std::memory_order_release);
+  }
+
+  // Formats the records that are present in the ring (from the oldest to the newest one). Not thread-safe with
+  // respect to other dumps.
+  void dump(std::FILE* file) const {
+    auto head = head_.load(std::memory_order_acquire);
+    auto capacity = mask_ + 1;
+    auto first = head > capacity ? head - capacity + 1 : 1;
+
+    for (auto sequence = first; sequence <= head; sequence++) {
+      const auto& record = records_[sequence & mask_];
+
+      if (record.sequence.load(std::memory_order_acquire) != sequence) {
+        continue;
+      }
+
+      switch (record.event) {
+        case TraceEvent::SNAPSHOT_DATA:
+          fmt::print(file, "{} SD:cnt={},new={}\n", record.timestamp, record.args[0], record.args[1] != 0);
+          break;
+        case TraceEvent::ORDER:
+          fmt::print(file, "{} O:ind={},pr={},sz={},sd={}\n", record.timestamp,
+                     static_cast<std::int64_t>(record.args[0]), std::bit_cast<double>(record.args[1]),
+                     std::bit_cast<double>(record.args[2]), record.args[3] == 1 ? "buy" : "sell");
+          break;
+      }
+    }
+  }
+};
+
+// The process-wide trace facility.
+//
+// Usage:
+//   trace<TraceLevel::RECORD>(TraceEvent::ORDER, order.index, order.price, order.size, order.side);
+//
+// The call compiles to nothing if the level is greater than DXFCXX_TRACE_LEVEL. Otherwise, it costs an atomic load
+// until the tracing is enabled by Trace::enable.
+struct Trace {
+  static constexpr bool isCompiled(TraceLevel level) { return static_cast<int>(level) <= DXFCXX_TRACE_LEVEL; }
+
+  static void enable(std::size_t capacity = 1 << 20) {
+    std::lock_guard<std::mutex> lock(mutex());
+
+    if (!ring()) {
+      ring() = std::make_unique<TraceRing>(capacity);
+    }
+
+    enabled().store(true, std::memory_order_release);
+  }
+
+  static void disable() { enabled().store(false, std::memory_order_release); }
+
+  [[nodiscard]] static bool isEnabled() { return enabled().load(std::memory_order_acquire); }
+
+  static void dump(std::FILE* file) {
+    std::lock_guard<std::mutex> lock(mutex());
+
+    if (ring()) {
+      ring()->dump(file);
+    }
+  }
+
+  template <typename... Args>
+  static void write(TraceEvent event, Args... args) {
+    // The ring is never released after it was created
+    ring()->write(event, args...);
+  }
+
+ private:
+  static std::atomic<bool>& enabled() {
+    static std::atomic<bool> enabled{false};
+
+    return enabled;
+  }
+
+  static std::unique_ptr<TraceRing>& ring() {
+    static std::unique_ptr<TraceRing> ring{};
+
+    return ring;
+  }
+
+  static std::mutex& mutex() {
+    static std::mutex mutex{};
+
+    return mutex;
+  }
+};
+
+template <TraceLevel level, typename... Args>
+inline void trace(TraceEvent event, Args... args) {
+  if constexpr (Trace::isCompiled(level)) {
+    if (Trace::isEnabled()) {
+      Trace::write(event, args...);
+    }
+  }
+}
+
+}  // namespace dxf
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "TscClock.hpp"
+
+// 1 - the pipeline records the sampled spans when the span tracing is enabled at run time (the disabled tracing costs
+// an atomic load per transaction). 0 - the spans are compiled out completely.
+#ifndef DXFCXX_TRACE_SPANS
+#define DXFCXX_TRACE_SPANS 1
+#endif
+
+namespace dxf {
+
+enum class SpanKind : std::uint32_t {
+  // The listener call of the snapshot data chunk (the processing or the queueing of the chunk)
+  SNAPSHOT_DATA = 0,
+  // From the listener call to the start of the processing (the queue wait of the async mode)
+  QUEUE_WAIT = 1,
+  // The processing of the chunk under the lock of the book (includes the spans below)
+  PROCESS = 2,
+  // The conversion of the order records to the price level updates (accumulateOrders and takeUpdates)
+  CONVERT = 3,
+  // The application of the updates to the levels (applyUpdates) and the publishing
+  APPLY = 4,
+  // The handlers of the book
+  ON_NEW_BOOK = 5,
+  ON_INCREMENTAL_CHANGE = 6,
+  ON_BOOK_UPDATE = 7,
+  ON_BOOK_UPDATE_VIEW = 8,
+  // The EventDispatcher: the copy and the queueing of the listener batch, the handler of the batch
+  DISPATCH = 9,
+  HANDLER = 10
+};
+
+// The sampled transaction: the spans of one flow are linked by the arrows in the trace viewer, across the threads
+struct SpanFlow {
+  // 0 - the transaction is not sampled
+  std::uint64_t id = 0;
+  // The time the flow was sampled or handed over to the other thread (the steady clock nanoseconds), i.e. the start of
+  // its queue wait (see SpanTracer::handOver)
+  std::uint64_t startNanos = 0;
+
+  explicit operator bool() const { return id != 0; }
+};
+
+struct SpanRecord {
+  // 0 - the record is being written
+  std::atomic<std::uint64_t> sequence{};
+  std::uint64_t startNanos{};
+  std::uint64_t durationNanos{};
+  std::uint64_t flowId{};
+  // The number of the records or the events
+  std::uint64_t count{};
+  SpanKind kind{};
+};
+
+// The lossy ring of the spans of one thread: one writer (the thread), the oldest spans are overwritten. The spans are
+// formatted only when they are exported.
+class SpanBuffer final {
+  std::unique_ptr<SpanRecord[]> records_;
+  std::size_t mask_;
+  std::atomic<std::uint64_t> head_{};
+  std::uint32_t threadId_;
+
+ public:
+  // capacity - the number of the spans (rounded up to the power of 2)
+  SpanBuffer(std::size_t capacity, std::uint32_t threadId)
+      : records_{new SpanRecord[std::bit_ceil(capacity)]}, mask_{std::bit_ceil(capacity) - 1}, threadId_{threadId} {}
+
+  [[nodiscard]] std::uint32_t getThreadId() const { return threadId_; }
+
+  void write(SpanKind kind, std::uint64_t startNanos, std::uint64_t endNanos, std::uint64_t flowId,
+             std::uint64_t count) {
+    auto sequence = head_.load(std::memory_order_relaxed) + 1;
+    auto& record = records_[sequence & mask_];
+
+    record.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    record.startNanos = startNanos;
+    record.durationNanos = endNanos > startNanos ? endNanos - startNanos : 0;
+    record.flowId = flowId;
+    record.count = count;
+    record.kind = kind;
+    record.sequence.store(sequence, std::memory_order_release);
+    head_.store(sequence, std::memory_order_release);
+  }
+
+  // Calls the f(const SpanRecord&) for the spans that are present in the buffer (from the oldest to the newest one)
+  template <typename F>
+  void forEach(F&& f) const {
+    auto head = head_.load(std::memory_order_acquire);
+    auto capacity = mask_ + 1;
+    auto first = head > capacity ? head - capacity + 1 : 1;
+
+    for (auto sequence = first; sequence <= head; sequence++) {
+      const auto& record = records_[sequence & mask_];
+
+      if (record.sequence.load(std::memory_order_acquire) != sequence) {
+        continue;
+      }
+
+      f(record);
+    }
+  }
+};
+
+// The process-wide sampled span tracing of the pipeline. Every thread writes its spans to its own buffer without the
+// locks, 1 of every N transactions of the thread is sampled (its spans on all the threads are recorded), so the tracing
+// can stay enabled in production. The buffers are exported in the Chrome trace event format (chrome://tracing,
+// https://ui.perfetto.dev).
+//
+// Usage:
+//   SpanTracer::enable(100);                 // 1 of 100 transactions
+//
+//   auto flow = SpanTracer::sample();         // the start of the transaction
+//   {
+//     SpanScope span{SpanKind::CONVERT, flow};
+//     ...
+//   }
+//
+//   SpanTracer::exportChromeTrace(file);
+struct SpanTracer {
+  static constexpr bool isCompiled() { return DXFCXX_TRACE_SPANS != 0; }
+
+  // sampleEvery - the sampling period (1 - every transaction). bufferCapacity - the spans kept per thread (used by the
+  // buffers of the threads that write their first span after the call).
+  static void enable(std::uint32_t sampleEvery = 1000, std::size_t bufferCapacity = 1 << 16) {
+    std::lock_guard<std::mutex> lock(state().mutex);
+
+    state().bufferCapacity = bufferCapacity;
+    state().sampleEvery.store((std::max)(sampleEvery, std::uint32_t{1}), std::memory_order_relaxed);
+    state().enabled.store(true, std::memory_order_release);
+  }
+
+  // The recorded spans are kept for the export
+  static void disable() { state().enabled.store(false, std::memory_order_release); }
+
+  [[nodiscard]] static bool isEnabled() {
+    if constexpr (isCompiled()) {
+      return state().enabled.load(std::memory_order_relaxed);
+    } else {
+      return false;
+    }
+  }
+
+  static std::uint64_t nowNanos() { return static_cast<std::uint64_t>(TscClock::nowNanos()); }
+
+  // Starts the transaction: returns the flow if it's sampled (1 of every N calls of the thread), the empty flow
+  // otherwise
+  static SpanFlow sample() {
+    if (!isEnabled()) {
+      return {};
+    }
+
+    thread_local std::uint32_t counter = 0;
+
+    if (++counter < state().sampleEvery.load(std::memory_order_relaxed)) {
+      return {};
+    }
+
+    counter = 0;
+
+    return {state().nextFlowId.fetch_add(1, std::memory_order_relaxed) + 1, nowNanos()};
+  }
+
+  // The copy of the flow that is handed over to the other thread now (e.g. queued), its queue wait starts now
+  static SpanFlow handOver(const SpanFlow& flow) { return {flow.id, startOf(flow)}; }
+
+  // The start of the span of the flow (0 if the flow is not sampled, so the clock is not read)
+  static std::uint64_t startOf(const SpanFlow& flow) {
+    if constexpr (isCompiled()) {
+      return flow ? nowNanos() : 0;
+    } else {
+      return 0;
+    }
+  }
+
+  // Records the span of the sampled flow from the start (see startOf) to now
+  static void recordSince(SpanKind kind, const SpanFlow& flow, std::uint64_t startNanos, std::uint64_t count = 0) {
+    if constexpr (isCompiled()) {
+      if (flow) {
+        getThreadBuffer().write(kind, startNanos, nowNanos(), flow.id, count);
+      }
+    }
+  }
+
+  // Records the span of the sampled flow on the current thread
+  static void record(SpanKind kind, const SpanFlow& flow, std::uint64_t startNanos, std::uint64_t endNanos,
+                     std::uint64_t count = 0) {
+    if constexpr (isCompiled()) {
+      if (flow) {
+        getThreadBuffer().write(kind, startNanos, endNanos, flow.id, count);
+      }
+    }
+  }
+
+  // Writes the spans of all the threads as the JSON object of the Chrome trace event format: the complete events of
+  // the spans (microseconds) and the flow events that link the spans of one transaction.
+  static void exportChromeTrace(std::FILE* file) {
+    static constexpr std::array<const char*, 11> NAMES{
+      "snapshotData", "queueWait",        "process",  "convert", "apply", "onNewBook", "onIncrementalChange",
+      "onBookUpdate", "onBookUpdateView", "dispatch", "handler"};
+
+    struct Span {
+      std::uint32_t threadId;
+      std::uint64_t startNanos;
+      std::uint64_t durationNanos;
+      std::uint64_t flowId;
+      std::uint64_t count;
+      SpanKind kind;
+    };
+
+    std::vector<Span> spans{};
+
+    {
+      std::lock_guard<std::mutex> lock(state().mutex);
+
+      for (const auto& buffer : state().buffers) {
+        buffer->forEach([&spans, threadId = buffer->getThreadId()](const SpanRecord& record) {
+          spans.push_back(
+            {threadId, record.startNanos, record.durationNanos, record.flowId, record.count, record.kind});
+        });
+      }
+    }
+
+    // The timestamps are relative to the first span
+    std::uint64_t origin = spans.empty() ? 0 : spans.front().startNanos;
+
+    for (const auto& span : spans) {
+      origin = (std::min)(origin, span.startNanos);
+    }
+
+    // The flow steps are bound to the spans of the flow in the order of their starts
+    std::stable_sort(spans.begin(), spans.end(), [](const Span& left, const Span& right) {
+      return left.flowId != right.flowId ? left.flowId < right.flowId : left.startNanos < right.startNanos;
+    });
+
+    // The flow arrows go through the first span of the transaction on every thread it has visited: the arrow starts
+    // ('s') at the first one, steps ('t') through the next ones and ends ('f') at the last one
+    std::vector<char> flowPhases(spans.size(), '\0');
+    std::size_t lastPoint = 0;
+
+    for (std::size_t i = 0; i < spans.size(); i++) {
+      auto isFlowStart = i == 0 || spans[i - 1].flowId != spans[i].flowId;
+
+      if (isFlowStart) {
+        flowPhases[i] = 's';
+        lastPoint = i;
+      } else if (spans[i].threadId != spans[lastPoint].threadId) {
+        flowPhases[i] = 't';
+        lastPoint = i;
+      }
+
+      auto isFlowEnd = i + 1 == spans.size() || spans[i + 1].flowId != spans[i].flowId;
+
+      if (isFlowEnd) {
+        // The flow of one thread has no arrow
+        flowPhases[lastPoint] = flowPhases[lastPoint] == 's' ? '\0' : 'f';
+      }
+    }
+
+    auto toMicros = [origin](std::uint64_t nanos) { return static_cast<double>(nanos - origin) / 1000.0; };
+
+    fmt::print(file, "{{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    for (std::size_t i = 0; i < spans.size(); i++) {
+      const auto& span = spans[i];
+
+      fmt::print(file,
+                 "{}{{\"name\":\"{}\",\"cat\":\"dxf\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},"
+                 "\"dur\":{:.3f},\"args\":{{\"flow\":{},\"count\":{}}}}}",
+                 i == 0 ? "" : ",\n", NAMES[static_cast<std::size_t>(span.kind) % NAMES.size()], span.threadId,
+                 toMicros(span.startNanos), static_cast<double>(span.durationNanos) / 1000.0, span.flowId, span.count);
+
+      if (flowPhases[i] != '\0') {
+        fmt::print(file,
+                   ",\n{{\"name\":\"transaction\",\"cat\":\"dxf\",\"ph\":\"{}\",\"id\":{},\"pid\":1,\"tid\":{},"
+                   "\"ts\":{:.3f}{}}}",
+                   flowPhases[i], span.flowId, span.threadId, toMicros(span.startNanos),
+                   flowPhases[i] == 's' ? "" : ",\"bp\":\"e\"");
+      }
+    }
+
+    fmt::print(file, "\n]}}\n");
+  }
+
+ private:
+  struct State {
+    std::atomic<bool> enabled{false};
+    std::atomic<std::uint32_t> sampleEvery{1000};
+    std::atomic<std::uint64_t> nextFlowId{0};
+    // Guards the buffers and the capacity. The buffers of the finished threads are kept for the export.
+    std::mutex mutex{};
+    std::size_t bufferCapacity = 1 << 16;
+    std::vector<std::shared_ptr<SpanBuffer>> buffers{};
+  };
+
+  static State& state() {
+    static State state{};
+
+    return state;
+  }
+
+  static SpanBuffer& getThreadBuffer() {
+    thread_local std::shared_ptr<SpanBuffer> buffer = [] {
+      std::lock_guard<std::mutex> lock(state().mutex);
+      auto result =
+        std::make_shared<SpanBuffer>(state().bufferCapacity, static_cast<std::uint32_t>(state().buffers.size() + 1));
+
+      state().buffers.push_back(result);
+
+      return result;
+    }();
+
+    return *buffer;
+  }
+};
+
+// Records the span of the sampled flow from the construction to the destruction. Does nothing if the flow is empty.
+class SpanScope final {
+  SpanKind kind_;
+  SpanFlow flow_;
+  std::uint64_t startNanos_ = 0;
+  std::uint64_t count_;
+
+ public:
+  SpanScope(SpanKind kind, const SpanFlow& flow, std::uint64_t count = 0) : kind_{kind}, flow_{flow}, count_{count} {
+    if constexpr (SpanTracer::isCompiled()) {
+      if (flow_) {
+        startNanos_ = SpanTracer::nowNanos();
+      }
+    }
+  }
+
+  SpanScope(const SpanScope&) = delete;
+  SpanScope& operator=(const SpanScope&) = delete;
+
+  ~SpanScope() {
+    if constexpr (SpanTracer::isCompiled()) {
+      if (flow_) {
+        SpanTracer::record(kind_, flow_, startNanos_, SpanTracer::nowNanos(), count_);
+      }
+    }
+  }
+};
+
+}  // namespace dxf
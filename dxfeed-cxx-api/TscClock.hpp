@@ -0,0 +1,224 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#include "CpuFeatures.hpp"
+
+#ifndef DXFCXX_TSC_CLOCK
+#define DXFCXX_TSC_CLOCK 1
+#endif
+
+namespace dxf {
+
+// The cheap clock of the instrumentation (the latency histograms, the trace records, the spans and the event lags):
+// the nanoseconds of the steady clock computed from the invariant TSC (rdtsc on x86, CNTVCT_EL0 on ARM64) by one
+// multiplication, a few ns instead of the tens of ns of the clock_gettime or QueryPerformanceCounter call.
+//
+// The rate of the counter is measured against the steady clock at the first use (2 ms) and corrected every second by
+// the reading thread: the rate is measured again on the interval since the first use, and the difference with the
+// steady clock is slewed out over the next second (by at most 1% of the rate), so the time is continuous and follows
+// the steady clock. The larger differences (e.g. after the suspend) are stepped. The wall clock time is the steady time
+// plus the offset of the system clock measured at the correction.
+//
+// If the CPU has no invariant TSC or DXFCXX_TSC_CLOCK is 0, the clocks of std::chrono are read.
+//
+// Usage:
+//   auto start = TscClock::nowNanos();
+//   ...
+//   histogram.record(TscClock::nowNanos() - start);
+class TscClock final {
+  static constexpr std::int64_t CORRECTION_INTERVAL_NANOS = 1'000'000'000;
+  static constexpr std::int64_t CALIBRATION_NANOS = 2'000'000;
+  static constexpr double MAX_SLEW = 0.01;
+
+  struct State {
+    bool isTsc = false;
+    // The first sample, the rate is measured from it
+    std::uint64_t firstTicks = 0;
+    std::int64_t firstNanos = 0;
+    // The seqlock of the conversion (odd - the conversion is being changed)
+    std::atomic<std::uint64_t> sequence{0};
+    std::atomic<std::uint64_t> baseTicks{0};
+    std::atomic<std::int64_t> baseNanos{0};
+    std::atomic<double> nanosPerTick{0.0};
+    // The ticks of the next correction
+    std::atomic<std::uint64_t> correctionTicks{0};
+    std::atomic<std::int64_t> wallOffsetNanos{0};
+    std::atomic_flag isCorrecting{};
+
+    State() {
+      wallOffsetNanos.store(systemNanos() - steadyNanos(), std::memory_order_relaxed);
+
+      if (DXFCXX_TSC_CLOCK == 0 || !CpuFeatures::hasInvariantTsc()) {
+        return;
+      }
+
+      sample(firstTicks, firstNanos);
+
+      std::uint64_t ticks = 0;
+      std::int64_t nanos = 0;
+
+      do {
+        sample(ticks, nanos);
+      } while (nanos - firstNanos < CALIBRATION_NANOS);
+
+      if (ticks <= firstTicks) {
+        return;
+      }
+
+      auto rate = static_cast<double>(nanos - firstNanos) / static_cast<double>(ticks - firstTicks);
+
+      baseTicks.store(ticks, std::memory_order_relaxed);
+      baseNanos.store(nanos, std::memory_order_relaxed);
+      nanosPerTick.store(rate, std::memory_order_relaxed);
+      correctionTicks.store(ticks + static_cast<std::uint64_t>(CORRECTION_INTERVAL_NANOS / rate),
+                            std::memory_order_relaxed);
+      isTsc = true;
+    }
+  };
+
+  static State& state() {
+    static State instance{};
+
+    return instance;
+  }
+
+  static std::int64_t steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+  }
+
+  static std::int64_t systemNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+      .count();
+  }
+
+  // The ticks at the middle of the read of the steady clock
+  static void sample(std::uint64_t& ticks, std::int64_t& nanos) {
+    auto before = readTicks();
+
+    nanos = steadyNanos();
+    ticks = before + (readTicks() - before) / 2;
+  }
+
+  static std::int64_t convert(const State& s, std::uint64_t ticks) {
+    while (true) {
+      auto sequence = s.sequence.load(std::memory_order_acquire);
+      auto baseTicks = s.baseTicks.load(std::memory_order_relaxed);
+      auto baseNanos = s.baseNanos.load(std::memory_order_relaxed);
+      auto nanosPerTick = s.nanosPerTick.load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      if ((sequence & 1U) == 0 && s.sequence.load(std::memory_order_relaxed) == sequence) {
+        // The ticks read before the concurrent correction may precede its base
+        auto delta = static_cast<std::int64_t>(ticks - baseTicks);
+
+        return baseNanos + static_cast<std::int64_t>(static_cast<double>(delta) * nanosPerTick);
+      }
+    }
+  }
+
+  // One thread corrects the conversion, the others keep the current one
+  static void correct(State& s) {
+    if (s.isCorrecting.test_and_set(std::memory_order_acquire)) {
+      return;
+    }
+
+    std::uint64_t ticks = 0;
+    std::int64_t nanos = 0;
+
+    sample(ticks, nanos);
+
+    auto current = convert(s, ticks);
+    auto difference = nanos - current;
+    auto slew = static_cast<double>(difference) / static_cast<double>(CORRECTION_INTERVAL_NANOS);
+
+    // The counter has been reset (e.g. by the suspend) or has drifted too far: the time is stepped
+    if (ticks <= s.firstTicks || std::abs(slew) > MAX_SLEW) {
+      if (ticks <= s.firstTicks) {
+        s.firstTicks = ticks;
+        s.firstNanos = nanos;
+      }
+
+      current = nanos;
+      slew = 0.0;
+    }
+
+    auto rate = ticks > s.firstTicks + 1000 ? static_cast<double>(nanos - s.firstNanos) /
+                                                static_cast<double>(ticks - s.firstTicks)
+                                            : s.nanosPerTick.load(std::memory_order_relaxed);
+    auto sequence = s.sequence.load(std::memory_order_relaxed);
+
+    s.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.baseTicks.store(ticks, std::memory_order_relaxed);
+    s.baseNanos.store(current, std::memory_order_relaxed);
+    s.nanosPerTick.store(rate * (1.0 + slew), std::memory_order_relaxed);
+    s.sequence.store(sequence + 2, std::memory_order_release);
+    s.wallOffsetNanos.store(systemNanos() - steadyNanos(), std::memory_order_relaxed);
+    s.correctionTicks.store(ticks + static_cast<std::uint64_t>(CORRECTION_INTERVAL_NANOS / rate),
+                            std::memory_order_relaxed);
+    s.isCorrecting.clear(std::memory_order_release);
+  }
+
+ public:
+  // The raw counter (0 if there is none)
+  static std::uint64_t readTicks() {
+#if defined(DXFCXX_CPU_X86)
+    return __rdtsc();
+#elif defined(DXFCXX_CPU_ARM64) && (defined(__GNUC__) || defined(__clang__))
+    std::uint64_t ticks = 0;
+
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+
+    return ticks;
+#else
+    return 0;
+#endif
+  }
+
+  // The time is computed from the counter (otherwise the std::chrono clocks are read)
+  static bool isTsc() { return state().isTsc; }
+
+  // The measured frequency of the counter (0 - there is no counter)
+  static double getFrequency() {
+    auto& s = state();
+
+    return s.isTsc ? 1e9 / s.nanosPerTick.load(std::memory_order_relaxed) : 0.0;
+  }
+
+  // The nanoseconds of the steady clock
+  static std::int64_t nowNanos() {
+    auto& s = state();
+
+    if (!s.isTsc) {
+      return steadyNanos();
+    }
+
+    auto ticks = readTicks();
+
+    if (ticks >= s.correctionTicks.load(std::memory_order_relaxed)) {
+      correct(s);
+    }
+
+    return convert(s, ticks);
+  }
+
+  static std::chrono::steady_clock::time_point now() {
+    return std::chrono::steady_clock::time_point{
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds{nowNanos()})};
+  }
+
+  // The nanoseconds of the wall clock (since the epoch)
+  static std::int64_t currentTimeNanos() {
+    auto nanos = nowNanos();
+
+    return nanos + state().wallOffsetNanos.load(std::memory_order_relaxed);
+  }
+};
+
+}  // namespace dxf
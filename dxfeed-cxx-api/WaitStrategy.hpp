@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "CpuFeatures.hpp"
+#include "ThreadPlacement.hpp"
+
+namespace dxf {
+
+// Busy-polls the isReady for the spin time (the wake-up of the blocked thread takes the tens of microseconds, the
+// spinning one sees the data at once, but burns its CPU). Returns true if the isReady has returned true.
+template <typename Predicate>
+inline bool spinUntil(std::chrono::nanoseconds spin, Predicate isReady) {
+  if (spin.count() <= 0) {
+    return false;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + spin;
+
+  // The clock is read every 64 polls
+  for (std::uint32_t i = 1;; i++) {
+    if (isReady()) {
+      return true;
+    }
+
+#if defined(DXFCXX_CPU_X86)
+    _mm_pause();
+#elif defined(DXFCXX_CPU_ARM64) && defined(_MSC_VER)
+    __yield();
+#elif defined(DXFCXX_CPU_ARM64)
+    asm volatile("yield");
+#endif
+
+    if (i % 64 == 0 && std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+  }
+}
+
+// Yields the CPU to the other threads (std::this_thread::yield) until the isReady returns true or the yield time
+// passes. Returns true if the isReady has returned true.
+template <typename Predicate>
+inline bool yieldUntil(std::chrono::nanoseconds yield, Predicate isReady) {
+  if (yield.count() <= 0) {
+    return false;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + yield;
+
+  while (true) {
+    if (isReady()) {
+      return true;
+    }
+
+    std::this_thread::yield();
+
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return isReady();
+    }
+  }
+}
+
+// The counters of the waits of one WaitStrategy
+struct WaitStats {
+  // The waits that have ended in the spin, in the yield and in the park phases
+  std::uint64_t spinWakeupsNumber = 0;
+  std::uint64_t yieldWakeupsNumber = 0;
+  std::uint64_t parksNumber = 0;
+  // The time spent in the phases
+  std::chrono::nanoseconds spinTime{0};
+  std::chrono::nanoseconds yieldTime{0};
+  std::chrono::nanoseconds parkTime{0};
+  // The current spin time (changes in the adaptive mode)
+  std::chrono::nanoseconds spin{0};
+};
+
+// The wait of the consumer thread for the new data of its empty queue: it busy-polls for the spin time (sees the data
+// at once, but burns the CPU), then yields the CPU to the other threads for the yield time, then parks (blocks by the
+// std::atomic::wait, i.e. the futex on Linux and the WaitOnAddress on Windows, the wake-up takes the tens of
+// microseconds). The times and the wake-ups of every phase are counted (see getStats), so the budgets can be chosen by
+// the measurements.
+//
+// The adaptive mode (the maximum spin is set) tunes the spin from the moving average of the observed wait times (the
+// times from the start of the wait until the data arrives): the spin is twice the average, but not more than the
+// maximum, and not less than 1/8 of it, so the short waits are still observed after the long ones. When the average
+// is above the maximum (the data is rare), the spin drops to the minimum, so the idle consumer doesn't burn its CPU.
+//
+// Usage:
+//   WaitStrategy waiting{placement};  // ThreadPlacement::spin, yield and adaptiveSpin
+//
+//   waiting.wait([&] { return counter.load() != seen; }, [&] { counter.wait(seen); });
+//
+// One thread waits, the stats are read by any thread.
+class WaitStrategy final {
+  // The weight of the new wait time in the moving average is 1/2^AVERAGE_SHIFT
+  static constexpr int AVERAGE_SHIFT = 3;
+  // The minimal adaptive spin is the maximal one divided by it
+  static constexpr std::int64_t MIN_SPIN_DIVIDER = 8;
+
+  std::chrono::nanoseconds yield_{0};
+  // The maximum of the adaptive spin (0 - the spin is fixed)
+  std::chrono::nanoseconds maxSpin_{0};
+  // The moving average of the wait times (ns). Changed by the waiting thread only.
+  std::int64_t averageWait_ = 0;
+  std::atomic<std::int64_t> spinNanos_{0};
+  std::atomic<std::uint64_t> spinWakeupsNumber_{0};
+  std::atomic<std::uint64_t> yieldWakeupsNumber_{0};
+  std::atomic<std::uint64_t> parksNumber_{0};
+  std::atomic<std::int64_t> spinTimeNanos_{0};
+  std::atomic<std::int64_t> yieldTimeNanos_{0};
+  std::atomic<std::int64_t> parkTimeNanos_{0};
+
+  static std::int64_t toNanos(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+  }
+
+  // Adds the wait time to the moving average and tunes the spin by it
+  void adapt(std::int64_t waitNanos) {
+    if (maxSpin_.count() <= 0) {
+      return;
+    }
+
+    averageWait_ += (waitNanos - averageWait_) >> AVERAGE_SHIFT;
+
+    auto maxSpin = maxSpin_.count();
+    auto minSpin = maxSpin / MIN_SPIN_DIVIDER;
+    auto spin = averageWait_ > maxSpin ? minSpin : std::clamp(averageWait_ * 2, minSpin, maxSpin);
+
+    spinNanos_.store(spin, std::memory_order_relaxed);
+  }
+
+ public:
+  WaitStrategy() = default;
+
+  explicit WaitStrategy(const ThreadPlacement& placement) { configure(placement); }
+
+  WaitStrategy(const WaitStrategy&) = delete;
+  WaitStrategy& operator=(const WaitStrategy&) = delete;
+
+  // Sets the spin, the yield and the maximum adaptive spin times of the placement (see ThreadPlacement). Is called
+  // before the first wait.
+  void configure(const ThreadPlacement& placement) {
+    yield_ = placement.yield;
+    maxSpin_ = placement.adaptiveSpin;
+    averageWait_ = maxSpin_.count() / 2;
+    spinNanos_.store(maxSpin_.count() > 0 ? maxSpin_.count() : std::chrono::nanoseconds{placement.spin}.count(),
+                     std::memory_order_relaxed);
+  }
+
+  // Waits until the isReady returns true: spins, yields, and then calls the park (e.g. the std::atomic::wait of the
+  // value the isReady checks). The park returns when the data has arrived or may have arrived: the caller checks its
+  // queue after the wait. The wait of the ready data isn't counted.
+  template <typename Predicate, typename Park>
+  void wait(Predicate isReady, Park park) {
+    if (isReady()) {
+      return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (spinUntil(std::chrono::nanoseconds{spinNanos_.load(std::memory_order_relaxed)}, isReady)) {
+      auto waitNanos = toNanos(std::chrono::steady_clock::now() - start);
+
+      spinWakeupsNumber_.fetch_add(1, std::memory_order_relaxed);
+      spinTimeNanos_.fetch_add(waitNanos, std::memory_order_relaxed);
+      adapt(waitNanos);
+
+      return;
+    }
+
+    auto yieldStart = std::chrono::steady_clock::now();
+
+    spinTimeNanos_.fetch_add(toNanos(yieldStart - start), std::memory_order_relaxed);
+
+    if (yieldUntil(yield_, isReady)) {
+      auto end = std::chrono::steady_clock::now();
+
+      yieldWakeupsNumber_.fetch_add(1, std::memory_order_relaxed);
+      yieldTimeNanos_.fetch_add(toNanos(end - yieldStart), std::memory_order_relaxed);
+      adapt(toNanos(end - start));
+
+      return;
+    }
+
+    auto parkStart = yieldStart;
+
+    if (yield_.count() > 0) {
+      parkStart = std::chrono::steady_clock::now();
+      yieldTimeNanos_.fetch_add(toNanos(parkStart - yieldStart), std::memory_order_relaxed);
+    }
+
+    park();
+
+    auto end = std::chrono::steady_clock::now();
+
+    parksNumber_.fetch_add(1, std::memory_order_relaxed);
+    parkTimeNanos_.fetch_add(toNanos(end - parkStart), std::memory_order_relaxed);
+    adapt(toNanos(end - start));
+  }
+
+  [[nodiscard]] WaitStats getStats() const {
+    return {spinWakeupsNumber_.load(std::memory_order_relaxed),
+            yieldWakeupsNumber_.load(std::memory_order_relaxed),
+            parksNumber_.load(std::memory_order_relaxed),
+            std::chrono::nanoseconds{spinTimeNanos_.load(std::memory_order_relaxed)},
+            std::chrono::nanoseconds{yieldTimeNanos_.load(std::memory_order_relaxed)},
+            std::chrono::nanoseconds{parkTimeNanos_.load(std::memory_order_relaxed)},
+            std::chrono::nanoseconds{spinNanos_.load(std::memory_order_relaxed)}};
+  }
+};
+
+}  // namespace dxf
@@ -0,0 +1,18 @@
+#include "PriceLevelBookEngine.hpp"
+
+namespace dxf {
+
+// The engines of the PriceLevelBook (see PriceLevelBook::Engine) are instantiated once here. The users of the library
+// see the extern declarations (DXFCXX_EXTERN_TEMPLATES), so their translation units don't instantiate them again.
+template class PriceLevelBookEngine<MultiIndexPriceLevelLadder>;
+template class PriceLevelBookEngine<FlatPriceLevelLadder>;
+template class PriceLevelBookEngine<FixedDepthPriceLevelLadder<5>::Type>;
+template class PriceLevelBookEngine<FixedDepthPriceLevelLadder<10>::Type>;
+template class PriceLevelBookEngine<FixedDepthPriceLevelLadder<20>::Type>;
+template class PriceLevelBookEngine<MultiIndexPriceLevelLadder, TickPriceModel>;
+template class PriceLevelBookEngine<FlatPriceLevelLadder, TickPriceModel>;
+template class PriceLevelBookEngine<FixedDepthPriceLevelLadder<5>::Type, TickPriceModel>;
+template class PriceLevelBookEngine<FixedDepthPriceLevelLadder<10>::Type, TickPriceModel>;
+template class PriceLevelBookEngine<FixedDepthPriceLevelLadder<20>::Type, TickPriceModel>;
+
+}  // namespace dxf
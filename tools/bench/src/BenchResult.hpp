@@ -0,0 +1,707 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dxf {
+
+// The machine-readable results of bench: the JSON writer and parser (only what the result files need), the summary
+// statistics of the interval series and the comparison of two result files.
+namespace bench {
+
+constexpr std::string_view RESULT_SCHEMA = "dxfeed-c-api-test-tools/bench-result";
+constexpr int RESULT_SCHEMA_VERSION = 1;
+
+// Writes the JSON document. The commas are put by the writer, so the calls are just the structure.
+class JsonWriter {
+  std::string out_{};
+  // The "no values yet" flags of the open objects and arrays
+  std::vector<bool> isFirst_{};
+  bool afterKey_ = false;
+
+  void separate() {
+    if (afterKey_) {
+      afterKey_ = false;
+
+      return;
+    }
+
+    if (!isFirst_.empty()) {
+      if (!isFirst_.back()) {
+        out_ += ',';
+      }
+
+      isFirst_.back() = false;
+    }
+  }
+
+  void writeString(std::string_view value) {
+    out_ += '"';
+
+    for (auto c : value) {
+      switch (c) {
+        case '"':
+          out_ += "\\\"";
+          break;
+        case '\\':
+          out_ += "\\\\";
+          break;
+        case '\n':
+          out_ += "\\n";
+          break;
+        case '\r':
+          out_ += "\\r";
+          break;
+        case '\t':
+          out_ += "\\t";
+          break;
+        default:
+          if (static_cast<unsigned char>(c) < 0x20) {
+            out_ += fmt::format("\\u{:04x}", static_cast<unsigned>(c));
+          } else {
+            out_ += c;
+          }
+      }
+    }
+
+    out_ += '"';
+  }
+
+ public:
+  [[nodiscard]] const std::string& getResult() const { return out_; }
+
+  JsonWriter& beginObject() {
+    separate();
+    out_ += '{';
+    isFirst_.push_back(true);
+
+    return *this;
+  }
+
+  JsonWriter& endObject() {
+    out_ += '}';
+    isFirst_.pop_back();
+
+    return *this;
+  }
+
+  JsonWriter& beginArray() {
+    separate();
+    out_ += '[';
+    isFirst_.push_back(true);
+
+    return *this;
+  }
+
+  JsonWriter& endArray() {
+    out_ += ']';
+    isFirst_.pop_back();
+
+    return *this;
+  }
+
+  JsonWriter& key(std::string_view name) {
+    separate();
+    writeString(name);
+    out_ += ':';
+    afterKey_ = true;
+
+    return *this;
+  }
+
+  JsonWriter& value(std::string_view v) {
+    separate();
+    writeString(v);
+
+    return *this;
+  }
+
+  JsonWriter& value(const char* v) { return value(std::string_view{v}); }
+
+  JsonWriter& value(bool v) {
+    separate();
+    out_ += v ? "true" : "false";
+
+    return *this;
+  }
+
+  // NaN and the infinities are written as null
+  JsonWriter& value(double v) {
+    separate();
+    out_ += std::isfinite(v) ? fmt::format("{}", v) : std::string{"null"};
+
+    return *this;
+  }
+
+  JsonWriter& value(std::uint64_t v) {
+    separate();
+    out_ += fmt::format("{}", v);
+
+    return *this;
+  }
+
+  JsonWriter& null() {
+    separate();
+    out_ += "null";
+
+    return *this;
+  }
+};
+
+// The parsed JSON value. The members of the object keep their order.
+struct JsonValue {
+  enum class Type { NULL_VALUE, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+  Type type = Type::NULL_VALUE;
+  bool boolean = false;
+  double number = 0.0;
+  std::string string{};
+  std::vector<JsonValue> array{};
+  std::vector<std::pair<std::string, JsonValue>> object{};
+
+  // Returns nullptr if the value is not an object or has no member
+  [[nodiscard]] const JsonValue* find(std::string_view name) const {
+    for (const auto& [memberName, member] : object) {
+      if (memberName == name) {
+        return &member;
+      }
+    }
+
+    return nullptr;
+  }
+
+  // The number of the member (NaN if there is no member or it's not a number)
+  [[nodiscard]] double getNumber(std::string_view name) const {
+    auto* member = find(name);
+
+    return member != nullptr && member->type == Type::NUMBER ? member->number : std::nan("");
+  }
+
+  [[nodiscard]] std::string getString(std::string_view name) const {
+    auto* member = find(name);
+
+    return member != nullptr && member->type == Type::STRING ? member->string : std::string{};
+  }
+};
+
+class JsonParser {
+  std::string_view text_;
+  std::size_t position_ = 0;
+
+  void skipSpaces() {
+    while (position_ < text_.size() && std::string_view{" \n\r\t"}.find(text_[position_]) != std::string_view::npos) {
+      position_++;
+    }
+  }
+
+  bool consume(std::string_view token) {
+    if (text_.substr(position_, token.size()) != token) {
+      return false;
+    }
+
+    position_ += token.size();
+
+    return true;
+  }
+
+  static void appendUtf8(std::string& out, std::uint32_t codePoint) {
+    if (codePoint < 0x80U) {
+      out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800U) {
+      out += static_cast<char>(0xC0U | (codePoint >> 6U));
+      out += static_cast<char>(0x80U | (codePoint & 0x3FU));
+    } else if (codePoint < 0x10000U) {
+      out += static_cast<char>(0xE0U | (codePoint >> 12U));
+      out += static_cast<char>(0x80U | ((codePoint >> 6U) & 0x3FU));
+      out += static_cast<char>(0x80U | (codePoint & 0x3FU));
+    } else {
+      out += static_cast<char>(0xF0U | (codePoint >> 18U));
+      out += static_cast<char>(0x80U | ((codePoint >> 12U) & 0x3FU));
+      out += static_cast<char>(0x80U | ((codePoint >> 6U) & 0x3FU));
+      out += static_cast<char>(0x80U | (codePoint & 0x3FU));
+    }
+  }
+
+  bool parseHex4(std::uint32_t& result) {
+    if (position_ + 4 > text_.size()) {
+      return false;
+    }
+
+    result = 0;
+
+    for (int i = 0; i < 4; i++) {
+      auto c = text_[position_++];
+
+      result <<= 4U;
+
+      if (c >= '0' && c <= '9') {
+        result |= static_cast<std::uint32_t>(c - '0');
+      } else if (c >= 'a' && c <= 'f') {
+        result |= static_cast<std::uint32_t>(c - 'a' + 10);
+      } else if (c >= 'A' && c <= 'F') {
+        result |= static_cast<std::uint32_t>(c - 'A' + 10);
+      } else {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool parseString(std::string& result) {
+    if (!consume("\"")) {
+      return false;
+    }
+
+    while (position_ < text_.size()) {
+      auto c = text_[position_++];
+
+      if (c == '"') {
+        return true;
+      }
+
+      if (c != '\\') {
+        result += c;
+
+        continue;
+      }
+
+      if (position_ >= text_.size()) {
+        return false;
+      }
+
+      switch (text_[position_++]) {
+        case '"':
+          result += '"';
+          break;
+        case '\\':
+          result += '\\';
+          break;
+        case '/':
+          result += '/';
+          break;
+        case 'b':
+          result += '\b';
+          break;
+        case 'f':
+          result += '\f';
+          break;
+        case 'n':
+          result += '\n';
+          break;
+        case 'r':
+          result += '\r';
+          break;
+        case 't':
+          result += '\t';
+          break;
+        case 'u': {
+          std::uint32_t codePoint = 0;
+
+          if (!parseHex4(codePoint)) {
+            return false;
+          }
+
+          // The surrogate pair
+          if (codePoint >= 0xD800U && codePoint < 0xDC00U && consume("\\u")) {
+            std::uint32_t low = 0;
+
+            if (!parseHex4(low)) {
+              return false;
+            }
+
+            codePoint = 0x10000U + ((codePoint - 0xD800U) << 10U) + (low - 0xDC00U);
+          }
+
+          appendUtf8(result, codePoint);
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+
+    return false;
+  }
+
+  bool parseNumber(double& result) {
+    auto start = position_;
+
+    while (position_ < text_.size() &&
+           std::string_view{"+-0123456789.eE"}.find(text_[position_]) != std::string_view::npos) {
+      position_++;
+    }
+
+    if (start == position_) {
+      return false;
+    }
+
+    auto number = std::string{text_.substr(start, position_ - start)};
+    char* end = nullptr;
+
+    result = std::strtod(number.c_str(), &end);
+
+    return end == number.c_str() + number.size();
+  }
+
+  bool parseValue(JsonValue& result) {
+    skipSpaces();
+
+    if (position_ >= text_.size()) {
+      return false;
+    }
+
+    switch (text_[position_]) {
+      case '{': {
+        position_++;
+        result.type = JsonValue::Type::OBJECT;
+        skipSpaces();
+
+        if (consume("}")) {
+          return true;
+        }
+
+        do {
+          skipSpaces();
+
+          auto& member = result.object.emplace_back();
+
+          if (!parseString(member.first)) {
+            return false;
+          }
+
+          skipSpaces();
+
+          if (!consume(":") || !parseValue(member.second)) {
+            return false;
+          }
+
+          skipSpaces();
+        } while (consume(","));
+
+        return consume("}");
+      }
+      case '[': {
+        position_++;
+        result.type = JsonValue::Type::ARRAY;
+        skipSpaces();
+
+        if (consume("]")) {
+          return true;
+        }
+
+        do {
+          if (!parseValue(result.array.emplace_back())) {
+            return false;
+          }
+
+          skipSpaces();
+        } while (consume(","));
+
+        return consume("]");
+      }
+      case '"':
+        result.type = JsonValue::Type::STRING;
+
+        return parseString(result.string);
+      case 't':
+        result.type = JsonValue::Type::BOOLEAN;
+        result.boolean = true;
+
+        return consume("true");
+      case 'f':
+        result.type = JsonValue::Type::BOOLEAN;
+
+        return consume("false");
+      case 'n':
+        return consume("null");
+      default:
+        result.type = JsonValue::Type::NUMBER;
+
+        return parseNumber(result.number);
+    }
+  }
+
+ public:
+  // Returns std::nullopt if the text is not a JSON document
+  static std::optional<JsonValue> parse(std::string_view text) {
+    JsonParser parser{};
+    JsonValue result{};
+
+    parser.text_ = text;
+
+    if (!parser.parseValue(result)) {
+      return std::nullopt;
+    }
+
+    parser.skipSpaces();
+
+    return parser.position_ == text.size() ? std::optional<JsonValue>{std::move(result)} : std::nullopt;
+  }
+};
+
+// The summary statistics of the series (the NaN values are skipped)
+struct SeriesStats {
+  std::size_t count = 0;
+  double mean = std::nan("");
+  // The sample standard deviation
+  double stddev = std::nan("");
+  double min = std::nan("");
+  double median = std::nan("");
+  double max = std::nan("");
+
+  static SeriesStats of(const std::vector<double>& series) {
+    std::vector<double> values{};
+
+    std::copy_if(series.begin(), series.end(), std::back_inserter(values), [](double v) { return !std::isnan(v); });
+
+    SeriesStats result{};
+
+    result.count = values.size();
+
+    if (values.empty()) {
+      return result;
+    }
+
+    std::sort(values.begin(), values.end());
+
+    double sum = 0.0;
+
+    for (auto v : values) {
+      sum += v;
+    }
+
+    result.mean = sum / static_cast<double>(values.size());
+
+    double squares = 0.0;
+
+    for (auto v : values) {
+      squares += (v - result.mean) * (v - result.mean);
+    }
+
+    result.stddev = values.size() > 1 ? std::sqrt(squares / static_cast<double>(values.size() - 1)) : 0.0;
+    result.min = values.front();
+    result.max = values.back();
+    result.median = values.size() % 2 == 1
+                      ? values[values.size() / 2]
+                      : (values[values.size() / 2 - 1] + values[values.size() / 2]) / 2.0;
+
+    return result;
+  }
+
+  void write(JsonWriter& writer) const {
+    writer.beginObject();
+    writer.key("count").value(static_cast<std::uint64_t>(count));
+    writer.key("mean").value(mean);
+    writer.key("stddev").value(stddev);
+    writer.key("min").value(min);
+    writer.key("median").value(median);
+    writer.key("max").value(max);
+    writer.endObject();
+  }
+};
+
+// The least-squares line of the series of the points (x, y), e.g. the trend of the metric of the soak run by the hours
+// (the points with the NaN y are skipped). The slope is NaN if there are less than 2 points with the different x.
+struct LinearTrend {
+  std::size_t count = 0;
+  double slope = std::nan("");
+  double intercept = std::nan("");
+  // The mean of the y
+  double mean = std::nan("");
+
+  static LinearTrend of(const std::vector<double>& xs, const std::vector<double>& ys) {
+    LinearTrend result{};
+    double sumX = 0.0;
+    double sumY = 0.0;
+
+    for (std::size_t i = 0; i < xs.size() && i < ys.size(); i++) {
+      if (!std::isnan(ys[i])) {
+        sumX += xs[i];
+        sumY += ys[i];
+        result.count++;
+      }
+    }
+
+    if (result.count == 0) {
+      return result;
+    }
+
+    auto meanX = sumX / static_cast<double>(result.count);
+
+    result.mean = sumY / static_cast<double>(result.count);
+
+    double covariance = 0.0;
+    double variance = 0.0;
+
+    for (std::size_t i = 0; i < xs.size() && i < ys.size(); i++) {
+      if (!std::isnan(ys[i])) {
+        covariance += (xs[i] - meanX) * (ys[i] - result.mean);
+        variance += (xs[i] - meanX) * (xs[i] - meanX);
+      }
+    }
+
+    if (variance > 0.0) {
+      result.slope = covariance / variance;
+      result.intercept = result.mean - result.slope * meanX;
+    }
+
+    return result;
+  }
+};
+
+// Welch's t-test of the means of two series: the difference is significant at the 95% level (two-sided) if |t| is
+// greater than the critical value of the Student distribution with the Welch-Satterthwaite degrees of freedom
+struct WelchTest {
+  double t = 0.0;
+  double degreesOfFreedom = 0.0;
+  bool isSignificant = false;
+
+  static double getCriticalValue(double degreesOfFreedom) {
+    static constexpr std::array<double, 30> CRITICAL_VALUES{
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131,
+      2.120,  2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+    if (degreesOfFreedom < 1.0) {
+      return CRITICAL_VALUES[0];
+    }
+
+    auto index = static_cast<std::size_t>(degreesOfFreedom) - 1;
+
+    return index < CRITICAL_VALUES.size() ? CRITICAL_VALUES[index] : 1.96;
+  }
+
+  static WelchTest of(const SeriesStats& a, const SeriesStats& b) {
+    WelchTest result{};
+
+    if (a.count < 2 || b.count < 2) {
+      return result;
+    }
+
+    auto va = a.stddev * a.stddev / static_cast<double>(a.count);
+    auto vb = b.stddev * b.stddev / static_cast<double>(b.count);
+
+    // Both series are constant: any difference is significant
+    if (va + vb == 0.0) {
+      result.isSignificant = a.mean != b.mean;
+      result.t = a.mean == b.mean ? 0.0 : std::copysign(std::numeric_limits<double>::infinity(), b.mean - a.mean);
+
+      return result;
+    }
+
+    result.t = (b.mean - a.mean) / std::sqrt(va + vb);
+    result.degreesOfFreedom = (va + vb) * (va + vb) /
+                              (va * va / static_cast<double>(a.count - 1) + vb * vb / static_cast<double>(b.count - 1));
+    result.isSignificant = std::abs(result.t) > getCriticalValue(result.degreesOfFreedom);
+
+    return result;
+  }
+};
+
+// The series of the interval member (the first interval, the subscription burst, is skipped). The member path is
+// "name" or "object.name".
+inline std::vector<double> getIntervalSeries(const JsonValue& result, std::string_view path) {
+  std::vector<double> series{};
+  auto* intervals = result.find("intervals");
+
+  if (intervals == nullptr) {
+    return series;
+  }
+
+  auto separator = path.find('.');
+
+  for (std::size_t i = 1; i < intervals->array.size(); i++) {
+    const auto& interval = intervals->array[i];
+
+    if (separator == std::string_view::npos) {
+      series.push_back(interval.getNumber(path));
+    } else if (auto* object = interval.find(path.substr(0, separator))) {
+      series.push_back(object->getNumber(path.substr(separator + 1)));
+    } else {
+      series.push_back(std::nan(""));
+    }
+  }
+
+  return series;
+}
+
+// Compares the interval series of the candidate result with the baseline one and prints the table. The change is a
+// regression if it is statistically significant, worse and greater than the threshold (percent). Returns the number of
+// the regressions.
+inline std::size_t compareResults(const JsonValue& baseline, const JsonValue& candidate, double threshold) {
+  struct Metric {
+    const char* name;
+    const char* path;
+    // The throughput is better when it's higher, the latencies and the costs when they're lower
+    bool isHigherBetter;
+  };
+
+  static constexpr std::array<Metric, 6> METRICS{{
+    {"events per second", "total", true},
+    {"latency p50 ms", "latency.p50Ms", false},
+    {"latency p99 ms", "latency.p99Ms", false},
+    {"latency p99.9 ms", "latency.p999Ms", false},
+    {"cpu us/event", "cpuUsPerEvent", false},
+    {"allocations/event", "allocationsPerEvent", false},
+  }};
+
+  for (const auto* name : {"libraryVersion", "host", "endpoint"}) {
+    auto* baselineMetadata = baseline.find("metadata");
+    auto* candidateMetadata = candidate.find("metadata");
+    auto baselineValue = baselineMetadata != nullptr ? baselineMetadata->getString(name) : std::string{};
+    auto candidateValue = candidateMetadata != nullptr ? candidateMetadata->getString(name) : std::string{};
+
+    fmt::print("{:<16} {} -> {}\n", name, baselineValue, candidateValue);
+  }
+
+  fmt::print("\n{:<20} {:>14} {:>14} {:>9} {:>8} {:>12}\n", "Metric", "baseline", "candidate", "change", "t",
+             "verdict");
+
+  std::size_t regressions = 0;
+
+  for (const auto& metric : METRICS) {
+    auto a = SeriesStats::of(getIntervalSeries(baseline, metric.path));
+    auto b = SeriesStats::of(getIntervalSeries(candidate, metric.path));
+
+    if (a.count == 0 || b.count == 0) {
+      continue;
+    }
+
+    auto test = WelchTest::of(a, b);
+    auto change = a.mean != 0.0 ? (b.mean - a.mean) / std::abs(a.mean) * 100.0 : 0.0;
+    auto isWorse = metric.isHigherBetter ? change < -threshold : change > threshold;
+    auto isBetter = metric.isHigherBetter ? change > threshold : change < -threshold;
+    const char* verdict = "same";
+
+    if (test.isSignificant && isWorse) {
+      verdict = "REGRESSION";
+      regressions++;
+    } else if (test.isSignificant && isBetter) {
+      verdict = "improvement";
+    } else if (isWorse || isBetter) {
+      verdict = "noise";
+    }
+
+    fmt::print("{:<20} {:>14.3f} {:>14.3f} {:>+8.1f}% {:>8.2f} {:>12}\n", metric.name, a.mean, b.mean, change, test.t,
+               verdict);
+  }
+
+  return regressions;
+}
+
+}  // namespace bench
+
+}  // namespace dxf
@@ -5,107 +5,1840 @@
 #include <fmt/chrono.h>
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <sstream>
 #include <thread>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
+#ifdef _WIN32
+#include <cstdlib>
+#else
+#include <unistd.h>
+#endif
+
+#include "BenchResult.hpp"
+#include "Error.hpp"
+#include "EventCodec.hpp"
+#include "IpfSymbolUniverse.hpp"
+#include "LargePages.hpp"
+#include "LatencyStats.hpp"
+#include "MarketEvents.hpp"
+#include "PerfCounters.hpp"
+#include "PriceLevelBook.hpp"
+#include "ResourceUsage.hpp"
+#include "ShutdownBatch.hpp"
+#include "SimpleTimeAndSaleDataProvider.hpp"
 #include "StringConverter.hpp"
+#include "SymbolSubscription.hpp"
+#include "SymbolTable.hpp"
+#include "ThreadPlacement.hpp"
+#include "TimeAndSaleData.hpp"
+#include "TscClock.hpp"
+
+// The version of the C API library (the git description of the submodule, set by CMake)
+#ifndef DXFEED_C_API_VERSION
+#define DXFEED_C_API_VERSION "unknown"
+#endif
+
+inline std::string formatLocalTimestampWithMillis(long long timestamp) {
+  long long ms = timestamp % 1000;
+
+  return fmt::format("{:%Y-%m-%d %H:%M:%S}.{:0>3}", fmt::localtime(static_cast<std::time_t>(timestamp / 1000)), ms);
+}
+
+// The supported event types (the per-type counters are indexed as this array)
+struct EventTypeInfo {
+  const char* name;
+  int mask;
+};
+
+constexpr std::array<EventTypeInfo, 7> EVENT_TYPES{{
+  {"Trade", DXF_ET_TRADE},
+  {"Quote", DXF_ET_QUOTE},
+  {"Summary", DXF_ET_SUMMARY},
+  {"Profile", DXF_ET_PROFILE},
+  {"Order", DXF_ET_ORDER},
+  {"TimeAndSale", DXF_ET_TIME_AND_SALE},
+  {"Candle", DXF_ET_CANDLE},
+}};
+
+std::size_t eventTypeIndex(int eventType) {
+  for (std::size_t i = 0; i < EVENT_TYPES.size(); i++) {
+    if (EVENT_TYPES[i].mask == eventType) {
+      return i;
+    }
+  }
+
+  return EVENT_TYPES.size();
+}
+
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// The allocations are counted only with the `allocations` option (the hooks below are always linked, without the
+// option they only check the flag)
+std::atomic<bool> countAllocations = false;
+
+// The allocation counters are striped by the threads, so the threads of the connections don't share the cache lines
+// (unless there are more threads than the stripes)
+struct alignas(CACHE_LINE_SIZE) AllocationCounter {
+  std::atomic<std::uint64_t> value = 0;
+};
+
+std::array<AllocationCounter, 64> allocationCounters{};
+std::atomic<std::size_t> nextAllocationCounter = 0;
+
+void countAllocation() {
+  // The flag is checked first, so the thread local isn't touched by the allocations of the startup
+  if (!countAllocations.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  thread_local auto& counter =
+    allocationCounters[nextAllocationCounter.fetch_add(1, std::memory_order_relaxed) % allocationCounters.size()];
+
+  counter.value.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint64_t getAllocationsNumber() {
+  std::uint64_t result = 0;
+
+  for (const auto& counter : allocationCounters) {
+    result += counter.value.load(std::memory_order_relaxed);
+  }
+
+  return result;
+}
+
+#ifdef __GLIBC__
+// The interposer of the allocation functions of the C library: the executable's malloc is called by the C API library
+// and by the operator new of the C++ library too
+extern "C" {
+void* __libc_malloc(std::size_t size) noexcept;
+void* __libc_calloc(std::size_t number, std::size_t size) noexcept;
+void* __libc_realloc(void* p, std::size_t size) noexcept;
+
+void* malloc(std::size_t size) noexcept {
+  countAllocation();
+
+  return __libc_malloc(size);
+}
+
+void* calloc(std::size_t number, std::size_t size) noexcept {
+  countAllocation();
+
+  return __libc_calloc(number, size);
+}
+
+void* realloc(void* p, std::size_t size) noexcept {
+  countAllocation();
+
+  return __libc_realloc(p, size);
+}
+}
+#else
+// Without the malloc interposer, only the allocations of the C++ code are counted (the default operator delete
+// releases the memory with std::free)
+void* operator new(std::size_t size) {
+  countAllocation();
+
+  if (auto* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+
+  throw std::bad_alloc{};
+}
+#endif
+
+// The counter of one writer: increased by the relaxed load and store (no atomic read-modify-write), read by the relaxed
+// loads of the reporter
+void increase(std::atomic<std::size_t>& counter, std::size_t delta) {
+  counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+// The counters of one connection. The events of the connection are received by its one thread that is the only writer
+// of the counters. Aligned to the cache line, so the threads of the connections don't share the lines.
+struct alignas(CACHE_LINE_SIZE) ConnectionStats {
+  std::array<std::atomic<std::size_t>, EVENT_TYPES.size()> eventCounters{};
+  // The events of the symbols that are not in the subscribed list (e.g. the normalized candle symbols)
+  std::atomic<std::size_t> otherSymbolsEventCounter = 0;
+  // The offset of the local clock from the server clock in nanoseconds, estimated by the heartbeats (0 - no correction)
+  std::atomic<std::int64_t> clockOffset = 0;
+  // The latencies from the event time to the listener call
+  dxf::LatencyHistogram latencyHistogram{};
+  // The sequence check of the events of the subscribed symbols (see SequenceState)
+  std::atomic<std::size_t> gaps = 0;
+  std::atomic<std::size_t> duplicates = 0;
+  std::atomic<std::size_t> outOfOrderEvents = 0;
+
+  [[nodiscard]] std::size_t getEventCounter() const {
+    std::size_t result = 0;
+
+    for (const auto& counter : eventCounters) {
+      result += counter.load(std::memory_order_relaxed);
+    }
+
+    return result;
+  }
+};
+
+// The counters of the subscribed symbol. The map of the symbols is filled before the subscription, so the listeners
+// only find the symbols. Every symbol is subscribed by one connection, so its thread is the only writer.
+struct alignas(CACHE_LINE_SIZE) SymbolStats {
+  std::atomic<std::size_t> eventCounter = 0;
+};
+
+dxf::SymbolMap<SymbolStats> symbolStats{};
+
+// The last event of the symbol and the type: the key is the (time, sequence) packed as the TimeAndSale index (the
+// seconds, the milliseconds and the 22-bit sequence), 0 - no events yet. The next event of the live stream has the
+// greater key and the next sequence: the equal key is the duplicate, the less one is out of order, the other sequence
+// is the gap (the feed is expected to number the events of the symbol contiguously, as feed-server does).
+struct SequenceState {
+  std::uint64_t key = 0;
+};
+
+constexpr std::uint64_t SEQUENCE_MASK = 0x3FFFFF;
+
+// The states of the subscribed symbols indexed by the symbol id * the number of the types + the type index. Is sized
+// before the subscription, every symbol is written by the thread of its connection only.
+std::vector<SequenceState> sequenceStates{};
+std::atomic<bool> stop = false;
+
+// The hardware counters of the threads (the `perf` option), nullptr - they aren't counted
+std::unique_ptr<dxf::PerfCounters> perfCounters{};
+
+constexpr std::array<const char*, dxf::PerfCounters::SCOPES_NUMBER> PERF_SCOPE_NAMES{"library", "processing"};
+
+std::string getPerfCountersCsvHeader() {
+  std::string result{};
+
+  for (const auto* name : PERF_SCOPE_NAMES) {
+    result += fmt::format(",{0} IPC,{0} cycles/event,{0} instructions/event,{0} cache misses/event,{0} branch "
+                          "misses/event",
+                          name);
+  }
+
+  return result;
+}
+
+// Attaches the new threads, prints the hardware counters of the interval per event of every scope (the library threads
+// and the C++ processing threads) and returns their CSV values. The previous are the totals of the previous interval.
+std::string reportPerfCounters(std::array<dxf::PerfCounterValues, dxf::PerfCounters::SCOPES_NUMBER>& previous,
+                               double events) {
+  std::string result{};
+  auto perEvent = [events](std::uint64_t value) { return static_cast<double>(value) / events; };
+
+  perfCounters->attachNewThreads();
+
+  for (std::size_t i = 0; i < PERF_SCOPE_NAMES.size(); i++) {
+    auto scope = static_cast<dxf::PerfCounters::Scope>(i);
+    auto values = perfCounters->read(scope);
+    auto interval = values.since(previous[i]);
+    auto threadsNumber = perfCounters->getThreadsNumber(scope);
+
+    previous[i] = values;
+    result += fmt::format(",{:.3f},{:.1f},{:.1f},{:.3f},{:.3f}", interval.getIpc(), perEvent(interval.cycles),
+                          perEvent(interval.instructions), perEvent(interval.cacheMisses),
+                          perEvent(interval.branchMisses));
+
+    if (threadsNumber != 0) {
+      fmt::print("Perf {} ({} threads): IPC {:.3f}, {:.1f} cycles/event, {:.1f} instructions/event, {:.3f} cache "
+                 "misses/event, {:.3f} branch misses/event\n",
+                 PERF_SCOPE_NAMES[i], threadsNumber, interval.getIpc(), perEvent(interval.cycles),
+                 perEvent(interval.instructions), perEvent(interval.cacheMisses), perEvent(interval.branchMisses));
+    }
+  }
+
+  return result;
+}
+
+// The wall clock of the lags of the events (see TscClock)
+std::int64_t nowNanos() { return dxf::TscClock::currentTimeNanos(); }
+
+// Prints the last error of the thread if the C API call has failed. The error isn't copied, and it is counted (see
+// ErrorCounters), so the failures of the calls in the loops don't allocate.
+bool checkCall(bool isSucceeded, std::string_view call) {
+  if (isSucceeded) {
+    return true;
+  }
+
+  fmt::memory_buffer buffer{};
+
+  dxf::ErrorCode::getLast().formatTo(std::back_inserter(buffer));
+  fmt::print(stderr, "{} failed: {}\n", call, std::string_view{buffer.data(), buffer.size()});
+
+  return false;
+}
+
+// The server time of the heartbeat is the time of its sending, so the server clock is ahead by the half of the RTT
+// (microseconds) on receipt
+void onServerHeartbeat(dxf_connection_t, dxf_long_t serverMillis, dxf_int_t, dxf_int_t connectionRtt, void* userData) {
+  static_cast<ConnectionStats*>(userData)->clockOffset.store(
+    nowNanos() - (serverMillis * 1000000 + static_cast<std::int64_t>(connectionRtt) * 1000 / 2),
+    std::memory_order_relaxed);
+}
+
+void checkSequence(SequenceState& state, std::uint64_t key, ConnectionStats& stats) {
+  if (state.key != 0) {
+    if (key == state.key) {
+      increase(stats.duplicates, 1);
+
+      return;
+    }
+
+    if (key < state.key) {
+      increase(stats.outOfOrderEvents, 1);
+
+      return;
+    }
+
+    if (((key - state.key) & SEQUENCE_MASK) != 1) {
+      increase(stats.gaps, 1);
+    }
+  }
+
+  state.key = key;
+}
+
+// Decodes the events (see EventCodec) and checks the sequences of the stream events (the orders and the candles are
+// not ordered by the time)
+template <typename Event>
+void processEvents(const dxf_event_data_t* data, int dataCount, SequenceState* sequenceState,
+                   ConnectionStats& stats) {
+  const auto* cEvents = reinterpret_cast<const typename Event::CEventType*>(data);
+  // The local delivery time on the server clock
+  auto deliveryTime = nowNanos() - stats.clockOffset.load(std::memory_order_relaxed);
+
+  for (int i = 0; i < dataCount; i++) {
+    auto event = dxf::EventCodec<Event>::decode(nullptr, cEvents[i]);
+
+    if (sequenceState != nullptr) {
+      if constexpr (std::is_same_v<Event, dxf::TimeAndSaleData>) {
+        checkSequence(*sequenceState, event.index, stats);
+      } else if constexpr (requires { event.sequence; } && !std::is_same_v<Event, dxf::Order> &&
+                           !std::is_same_v<Event, dxf::Candle>) {
+        checkSequence(*sequenceState,
+                      ((event.time / 1000) << 32U) | ((event.time % 1000) << 22U) |
+                        (static_cast<std::uint64_t>(event.sequence) & SEQUENCE_MASK),
+                      stats);
+      }
+    }
+
+    // The time of the candle is the start of its period
+    if constexpr (requires { event.time; } && !std::is_same_v<Event, dxf::Candle>) {
+      auto latency = deliveryTime - static_cast<std::int64_t>(event.time) * 1000000;
+
+      stats.latencyHistogram.record(static_cast<std::uint64_t>(latency < 0 ? 0 : latency));
+    }
+  }
+}
+
+void onEvents(int eventType, dxf_const_string_t symbolName, const dxf_event_data_t* data, int dataCount,
+              void* userData) {
+  auto& stats = *static_cast<ConnectionStats*>(userData);
+  auto typeIndex = eventTypeIndex(eventType);
+
+  // The events after the stop are not counted, so the totals don't wait for the close of the connections
+  if (typeIndex == EVENT_TYPES.size() || stop.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  auto found = symbolStats.find(std::wstring_view{symbolName});
+  auto stateIndex = found != symbolStats.end() ? found->first.getId() * EVENT_TYPES.size() + typeIndex
+                                               : sequenceStates.size();
+  auto* sequenceState = stateIndex < sequenceStates.size() ? &sequenceStates[stateIndex] : nullptr;
+
+  switch (eventType) {
+    case DXF_ET_TRADE:
+      processEvents<dxf::Trade>(data, dataCount, sequenceState, stats);
+      break;
+    case DXF_ET_QUOTE:
+      processEvents<dxf::Quote>(data, dataCount, sequenceState, stats);
+      break;
+    case DXF_ET_SUMMARY:
+      processEvents<dxf::Summary>(data, dataCount, sequenceState, stats);
+      break;
+    case DXF_ET_PROFILE:
+      processEvents<dxf::Profile>(data, dataCount, sequenceState, stats);
+      break;
+    case DXF_ET_ORDER:
+      processEvents<dxf::Order>(data, dataCount, sequenceState, stats);
+      break;
+    case DXF_ET_TIME_AND_SALE:
+      processEvents<dxf::TimeAndSaleData>(data, dataCount, sequenceState, stats);
+      break;
+    case DXF_ET_CANDLE:
+      processEvents<dxf::Candle>(data, dataCount, sequenceState, stats);
+      break;
+    default:
+      break;
+  }
+
+  increase(stats.eventCounters[typeIndex], static_cast<std::size_t>(dataCount));
+  increase(found != symbolStats.end() ? found->second.eventCounter : stats.otherSymbolsEventCounter,
+           static_cast<std::size_t>(dataCount));
+}
+
+std::vector<std::string> splitList(const std::string& list) {
+  auto result = std::vector<std::string>{};
+
+  for (auto position = std::string::size_type{0}; position != std::string::npos;) {
+    auto next = list.find(',', position);
+
+    result.push_back(list.substr(position, next == std::string::npos ? next : next - position));
+    position = next == std::string::npos ? next : next + 1;
+  }
+
+  return result;
+}
+
+// Reads the distinct symbols of the IPF file: "<file>[@<filter>]" (see IpfSymbolFilter::parse)
+std::vector<std::string> readIpfSymbols(const std::string& argument) {
+  auto separator = argument.rfind('@');
+  auto filter = separator == std::string::npos ? dxf::IpfSymbolFilter{}
+                                               : dxf::IpfSymbolFilter::parse(argument.substr(separator + 1));
+  auto universe = dxf::IpfSymbolUniverse::load(argument.substr(0, separator), filter);
+
+  return universe ? universe->getNames() : std::vector<std::string>{};
+}
+
+// The layers of the components mode: the C API listener call, the conversion of the C++ layer and the user handler
+constexpr std::array<const char*, 3> LAYER_NAMES{"library callback", "C++ conversion", "user callback"};
+
+enum Layer : std::size_t { LIBRARY_CALLBACK = 0, CONVERSION = 1, USER_CALLBACK = 2 };
+
+// The counters and the latencies of the layers of one connection (written by its thread only) or of one async book
+// (the library callback is written by the socket thread, the other layers by the worker of the book). The latency of
+// the library callback is from the event time, the latencies of the conversion and of the user callback are their
+// durations.
+struct alignas(CACHE_LINE_SIZE) LayerStats {
+  std::array<std::atomic<std::size_t>, LAYER_NAMES.size()> counters{};
+  std::array<dxf::LatencyHistogram, LAYER_NAMES.size()> latencies{};
+  // The time of the last snapshot data chunk (PriceLevelBook)
+  std::atomic<std::chrono::steady_clock::time_point> receiveTime{};
+  double checksum = 0.0;
+
+  void record(Layer layer, std::size_t count, std::int64_t latency) {
+    increase(counters[layer], count);
+    latencies[layer].record(static_cast<std::uint64_t>(latency < 0 ? 0 : latency));
+  }
+};
+
+std::int64_t nanosSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Prints and writes in CSV the rates and the latencies of the layers every second until the isDone returns true
+template <typename IsDone>
+void reportLayers(const std::vector<LayerStats>& layerStats, const std::string& fileName, IsDone&& isDone) {
+  using namespace std::chrono_literals;
+
+  auto getLatencies = [&layerStats](std::size_t layer) {
+    dxf::LatencyHistogramSnapshot result{};
+
+    for (const auto& stats : layerStats) {
+      result.merge(stats.latencies[layer].getSnapshot());
+    }
+
+    return result;
+  };
+
+  std::ofstream of{fileName};
+  std::array<std::size_t, LAYER_NAMES.size()> previousCounters{};
+  std::array<dxf::LatencyHistogramSnapshot, LAYER_NAMES.size()> previousLatencies{};
+  std::array<dxf::PerfCounterValues, dxf::PerfCounters::SCOPES_NUMBER> previousPerfCounters{};
+  auto start = std::chrono::system_clock::now();
+
+  of << "time";
+
+  for (const auto* name : LAYER_NAMES) {
+    of << fmt::format(",{0} per second,{0} p50 us,{0} p99 us,{0} max us", name);
+  }
+
+  if (perfCounters) {
+    of << getPerfCountersCsvHeader();
+  }
+
+  of << std::endl;
+
+  while (!isDone()) {
+    std::this_thread::sleep_for(10ms);
+
+    auto current = std::chrono::system_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(current - start).count();
+
+    if (elapsed < 1000) {
+      continue;
+    }
+
+    auto nowString = formatLocalTimestampWithMillis(
+      std::chrono::duration_cast<std::chrono::milliseconds>(current.time_since_epoch()).count());
+    auto toMicros = [](std::uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1e3; };
+
+    double libraryEvents = 1.0;
+
+    fmt::print("{}\n", nowString);
+    of << nowString;
+
+    for (std::size_t layer = 0; layer < LAYER_NAMES.size(); layer++) {
+      std::size_t counter = 0;
+
+      for (const auto& stats : layerStats) {
+        counter += stats.counters[layer].load(std::memory_order_relaxed);
+      }
+
+      auto rate = static_cast<double>(counter - previousCounters[layer]) * 1000.0 / static_cast<double>(elapsed);
+      auto latencies = getLatencies(layer);
+      auto interval = latencies.since(previousLatencies[layer]);
+
+      previousCounters[layer] = counter;
+      previousLatencies[layer] = latencies;
+      fmt::print("  {:<16}: {:>10.0f} per second, p50 {:.3f} us, p99 {:.3f} us, max {:.3f} us\n", LAYER_NAMES[layer],
+                 rate, toMicros(interval.getPercentile(50.0)), toMicros(interval.getPercentile(99.0)),
+                 toMicros(interval.max));
+      of << fmt::format(",{:0.0f},{:.3f},{:.3f},{:.3f}", rate, toMicros(interval.getPercentile(50.0)),
+                        toMicros(interval.getPercentile(99.0)), toMicros(interval.max));
+
+      // The events of the hardware counters are the records of the library callbacks
+      if (layer == LIBRARY_CALLBACK) {
+        libraryEvents = (std::max)(rate * static_cast<double>(elapsed) / 1000.0, 1.0);
+      }
+    }
+
+    if (perfCounters) {
+      of << reportPerfCounters(previousPerfCounters, libraryEvents);
+    }
+
+    of << std::endl;
+    start = current;
+  }
+}
+
+// The user callback of the components mode: reads the changes (the sizes of the levels)
+void readChanges(const dxf::PriceLevelChanges& changes, LayerStats& stats) {
+  for (const auto& level : changes.asks) {
+    stats.checksum += level.size;
+  }
+
+  for (const auto& level : changes.bids) {
+    stats.checksum += level.size;
+  }
+}
+
+// Drives a PriceLevelBook of every symbol (distributed among the connections) for the duration. The library callback
+// is the snapshot data chunk (the latency from the time of its last order), the conversion is from the chunk to the
+// handler call (the conversion and the application of the orders), the user callback is the handler. The placement is
+// applied to the socket threads of the connections (the books are processed on them, or on the worker threads of the
+// books if they are async).
+void runPriceLevelBooks(const char* endpoint, const std::vector<std::string>& symbols, const std::string& source,
+                        std::size_t levelsNumber, std::size_t connectionsNumber, std::chrono::seconds duration,
+                        const dxf::ThreadPlacement& placement, bool isAsync, const std::string& fileName) {
+  auto layerStats = std::vector<LayerStats>(isAsync ? symbols.size() : connectionsNumber);
+  auto connections = std::vector<dxf_connection_t>(connectionsNumber);
+  auto books = std::vector<std::unique_ptr<dxf::PriceLevelBook>>{};
+
+  for (std::size_t i = 0; i < connectionsNumber; i++) {
+    dxf_create_connection(
+      endpoint, nullptr, nullptr,
+      [](dxf_connection_t, void* data) {
+        if (!static_cast<const dxf::ThreadPlacement*>(data)->applyToCurrentThread()) {
+          std::cerr << "Can't apply the placement to the socket thread\n";
+        }
+      },
+      nullptr, const_cast<dxf::ThreadPlacement*>(&placement), &connections[i]);
+  }
+
+  for (std::size_t i = 0; i < symbols.size(); i++) {
+    auto& stats = layerStats[isAsync ? i : i % connectionsNumber];
+    dxf::PriceLevelBookConfig config{};
+
+    config.storage = dxf::PriceLevelStorage::FLAT;
+    config.async = isAsync;
+    config.onSnapshotData = [&stats](const dxf_snapshot_data_ptr_t snapshotData, int) {
+      stats.receiveTime.store(std::chrono::steady_clock::now(), std::memory_order_relaxed);
+
+      if (snapshotData->records_count == 0 || snapshotData->event_type != dx_eid_order) {
+        return;
+      }
+
+      auto* orders = reinterpret_cast<const dxf_order_t*>(snapshotData->records);
+
+      stats.record(LIBRARY_CALLBACK, static_cast<std::size_t>(snapshotData->records_count),
+                   nowNanos() - static_cast<std::int64_t>(orders[snapshotData->records_count - 1].time) * 1000000);
+    };
+
+    auto book = dxf::PriceLevelBook::create(connections[i % connectionsNumber], symbols[i], source, levelsNumber,
+                                            config);
+
+    if (!book->isValid()) {
+      std::cerr << "Can't create the book of " << symbols[i] << "\n";
+
+      continue;
+    }
+
+    auto onChanges = [&stats](auto&& readLevels) {
+      stats.record(CONVERSION, 1, nanosSince(stats.receiveTime.load(std::memory_order_relaxed)));
+
+      auto start = std::chrono::steady_clock::now();
+
+      readLevels();
+      stats.record(USER_CALLBACK, 1, nanosSince(start));
+    };
+
+    book->setOnNewBook([&stats, onChanges](const dxf::PriceLevelChanges& changes) {
+      onChanges([&] { readChanges(changes, stats); });
+    });
+    book->setOnIncrementalChange([&stats, onChanges](const dxf::PriceLevelChangesSet& changesSet) {
+      onChanges([&] {
+        readChanges(changesSet.additions, stats);
+        readChanges(changesSet.updates, stats);
+        readChanges(changesSet.removals, stats);
+      });
+    });
+    books.push_back(std::move(book));
+  }
+
+  fmt::print("PriceLevelBook: books: {}, source: {}, levels: {}, connections: {}, duration: {} s{}\n", books.size(),
+             source, levelsNumber, connectionsNumber, duration.count(), isAsync ? ", async" : "");
+
+  auto deadline = std::chrono::steady_clock::now() + duration;
+
+  reportLayers(layerStats, fileName, [deadline] { return std::chrono::steady_clock::now() >= deadline; });
+  dxf::ShutdownBatch{}.addOwned(std::move(books)).addConnections(connections).close();
+}
+
+// Drives the SimpleTimeAndSaleDataProvider streaming of the symbols for the duration. The library callback is the
+// listener call of the provider (the latency from the event time), the conversion is the TimeAndSale construction
+// (TimeAndSaleView::toTimeAndSale, as in runStreaming), the user callback is the sink.
+void runTimeAndSaleProvider(const char* endpoint, const std::vector<std::string>& symbols,
+                            std::chrono::seconds duration, const std::string& fileName) {
+  auto layerStats = std::vector<LayerStats>(1);
+  auto& stats = layerStats[0];
+  auto sink = [&stats](const dxf::TimeAndSale& tns) { stats.checksum += tns.getSize(); };
+
+  fmt::print("SimpleTimeAndSaleDataProvider: symbols: {}, duration: {} s\n", symbols.size(), duration.count());
+
+  auto result = dxf::SimpleTimeAndSaleDataProvider::runStreamingViews(
+    endpoint, symbols,
+    [&stats, &sink](const dxf::TimeAndSaleView& view) {
+      stats.record(LIBRARY_CALLBACK, 1, nowNanos() - static_cast<std::int64_t>(view.getTime()) * 1000000);
+
+      auto start = std::chrono::steady_clock::now();
+      auto tns = view.toTimeAndSale();
+      auto converted = std::chrono::steady_clock::now();
+
+      stats.record(CONVERSION, 1, std::chrono::duration_cast<std::chrono::nanoseconds>(converted - start).count());
+      sink(tns);
+      stats.record(USER_CALLBACK, 1, nanosSince(converted));
+    },
+    static_cast<int>(duration.count() * 1000));
+
+  reportLayers(layerStats, fileName, [&result] {
+    return result.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+  });
+
+  if (!result.get()) {
+    std::cerr << "Can't create the connection or the subscription\n";
+  }
+}
+
+// The result of one trial of the sweep (the sums of the processes of the trial)
+struct TrialResult {
+  std::size_t events = 0;
+  // The events per second (the sum of the rates of the processes)
+  double rate = 0.0;
+  std::uint64_t cpuNanos = 0;
+  dxf::LatencyHistogramSnapshot latencies{};
+};
+
+// Runs the connections (every one subscribes all the symbols by every of the subscriptions, so the load grows with
+// the number of the connections) for the warm-up second and the duration. The events, the CPU time of the process and
+// the latencies are measured after the warm-up.
+TrialResult runTrial(const char* endpoint, int eventTypesMask, const std::vector<std::string>& symbols,
+                     std::size_t connectionsNumber, std::size_t subscriptionsNumber, bool useHeartbeat,
+                     std::chrono::seconds duration) {
+  auto connectionStats = std::vector<ConnectionStats>(connectionsNumber);
+  auto connections = std::vector<dxf_connection_t>(connectionsNumber);
+
+  for (std::size_t i = 0; i < connectionsNumber; i++) {
+    if (!checkCall(dxf_create_connection(endpoint, nullptr, nullptr, nullptr, nullptr, nullptr, &connections[i]) !=
+                     DXF_FAILURE,
+                   "dxf_create_connection")) {
+      continue;
+    }
+
+    if (useHeartbeat) {
+      dxf_set_on_server_heartbeat_notifier(connections[i], onServerHeartbeat, &connectionStats[i]);
+    }
+
+    for (std::size_t j = 0; j < subscriptionsNumber; j++) {
+      dxf_subscription_t sub = nullptr;
+
+      if (!checkCall(dxf_create_subscription(connections[i], eventTypesMask, &sub) != DXF_FAILURE,
+                     "dxf_create_subscription")) {
+        continue;
+      }
+
+      dxf_attach_event_listener(sub, onEvents, &connectionStats[i]);
+      checkCall(dxf::SymbolSubscription::addSymbols(sub, symbols), "dxf_add_symbols");
+    }
+  }
+
+  auto getEvents = [&connectionStats] {
+    std::size_t result = 0;
+
+    for (const auto& stats : connectionStats) {
+      result += stats.getEventCounter();
+    }
+
+    return result;
+  };
+
+  auto getLatencies = [&connectionStats] {
+    dxf::LatencyHistogramSnapshot result{};
+
+    for (const auto& stats : connectionStats) {
+      result.merge(stats.latencyHistogram.getSnapshot());
+    }
+
+    return result;
+  };
+
+  std::this_thread::sleep_for(std::chrono::seconds{1});
+
+  auto eventsBefore = getEvents();
+  auto usageBefore = dxf::ResourceUsage::sample();
+  auto latenciesBefore = getLatencies();
+  auto start = std::chrono::steady_clock::now();
+
+  std::this_thread::sleep_for(duration);
+
+  TrialResult result{};
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  result.events = getEvents() - eventsBefore;
+  result.rate = static_cast<double>(result.events) / seconds;
+  result.cpuNanos = dxf::ResourceUsage::sample().getCpuNanos() - usageBefore.getCpuNanos();
+  result.latencies = getLatencies().since(latenciesBefore);
+  dxf::ShutdownBatch{}.addConnections(connections).close();
+
+  return result;
+}
+
+// The result of the trial of the child process of the sweep, one line: "trial <events> <rate> <CPU ns> <latencies
+// count> <latencies sum> <latencies max>" and the "<bucket>:<count>" pairs of the non-empty buckets
+std::string formatTrialResult(const TrialResult& result) {
+  auto line = fmt::format("trial {} {} {} {} {} {}", result.events, result.rate, result.cpuNanos,
+                          result.latencies.count, result.latencies.sum, result.latencies.max);
+
+  for (std::size_t i = 0; i < result.latencies.counts.size(); i++) {
+    if (result.latencies.counts[i] != 0) {
+      line += fmt::format(" {}:{}", i, result.latencies.counts[i]);
+    }
+  }
+
+  return line;
+}
+
+// Returns false if the line is not the result of the trial
+bool parseTrialResult(const std::string& line, TrialResult& result) {
+  std::istringstream input{line};
+  std::string tag{};
+
+  if (!(input >> tag >> result.events >> result.rate >> result.cpuNanos >> result.latencies.count >>
+        result.latencies.sum >> result.latencies.max) ||
+      tag != "trial") {
+    return false;
+  }
+
+  std::size_t bucket = 0;
+  char separator = 0;
+  std::uint64_t count = 0;
+
+  while (input >> bucket >> separator >> count) {
+    if (bucket < result.latencies.counts.size()) {
+      result.latencies.counts[bucket] = count;
+    }
+  }
+
+  return true;
+}
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+// Runs the trial in the child processes (bench ... trial=<seconds>, one connection each) at the same time and sums
+// their results
+TrialResult runTrialProcesses(const std::string& command, std::size_t processesNumber) {
+  auto pipes = std::vector<std::FILE*>{};
+
+  for (std::size_t i = 0; i < processesNumber; i++) {
+    if (auto* pipe = popen(command.c_str(), "r")) {
+      pipes.push_back(pipe);
+    }
+  }
+
+  TrialResult result{};
+
+  for (auto* pipe : pipes) {
+    std::string output{};
+    char buffer[4096];
+
+    while (std::fgets(buffer, sizeof(buffer), pipe) != nullptr) {
+      output += buffer;
+    }
+
+    pclose(pipe);
+
+    std::istringstream lines{output};
+    TrialResult processResult{};
+
+    for (std::string line; std::getline(lines, line);) {
+      if (parseTrialResult(line, processResult)) {
+        result.events += processResult.events;
+        result.rate += processResult.rate;
+        result.cpuNanos += processResult.cpuNanos;
+        result.latencies.merge(processResult.latencies);
+
+        break;
+      }
+    }
+  }
+
+  return result;
+}
+
+// Runs the trials with 1, 2, 4 ... maxConnections connections (in this process or in the child processes) and prints
+// and writes in CSV the scaling table
+void runSweep(const std::string& executable, const char* endpoint, const std::string& eventTypesArgument,
+              const std::string& symbolsArgument, int eventTypesMask, const std::vector<std::string>& symbols,
+              std::size_t maxConnections, std::size_t subscriptionsNumber, bool useProcesses, bool useHeartbeat,
+              std::chrono::seconds duration, const std::string& fileName) {
+  auto connectionNumbers = std::vector<std::size_t>{};
+
+  for (std::size_t n = 1; n < maxConnections; n *= 2) {
+    connectionNumbers.push_back(n);
+  }
+
+  connectionNumbers.push_back(maxConnections);
+
+  std::ofstream of{fileName};
+  auto toMillis = [](std::uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1e6; };
+
+  of << "connections,processes,subscriptions per connection,events per second,events per second per connection,"
+        "cpu us/event,latency p50 ms,latency p99 ms,latency p99.9 ms,latency max ms"
+     << std::endl;
+  fmt::print("Sweep: {} subscriptions per connection, {} s per trial, {}\n", subscriptionsNumber, duration.count(),
+             useProcesses ? "one connection per process" : "one process");
+  fmt::print("{:>11} {:>9} {:>14} {:>14} {:>12} {:>10} {:>10} {:>10} {:>10}\n", "connections", "processes",
+             "events/s", "events/s/conn", "cpu us/event", "p50 ms", "p99 ms", "p99.9 ms", "max ms");
+
+  for (auto connectionsNumber : connectionNumbers) {
+    auto result =
+      useProcesses
+        ? runTrialProcesses(fmt::format("\"{}\" \"{}\" \"{}\" \"{}\" trial={} subscriptions={}{}", executable, endpoint,
+                                        eventTypesArgument, symbolsArgument, duration.count(), subscriptionsNumber,
+                                        useHeartbeat ? " heartbeat" : ""),
+                            connectionsNumber)
+        : runTrial(endpoint, eventTypesMask, symbols, connectionsNumber, subscriptionsNumber, useHeartbeat, duration);
+    auto processesNumber = useProcesses ? connectionsNumber : 1;
+    auto cpuPerEvent =
+      static_cast<double>(result.cpuNanos) / 1e3 / static_cast<double>((std::max)(result.events, std::size_t{1}));
+    auto line = fmt::format("{},{},{},{:0.0f},{:0.0f},{:.3f},{:.3f},{:.3f},{:.3f},{:.3f}", connectionsNumber,
+                            processesNumber, subscriptionsNumber, result.rate,
+                            result.rate / static_cast<double>(connectionsNumber), cpuPerEvent,
+                            toMillis(result.latencies.getPercentile(50.0)),
+                            toMillis(result.latencies.getPercentile(99.0)),
+                            toMillis(result.latencies.getPercentile(99.9)), toMillis(result.latencies.max));
+
+    fmt::print("{:>11} {:>9} {:>14.0f} {:>14.0f} {:>12.3f} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f}\n",
+               connectionsNumber, processesNumber, result.rate, result.rate / static_cast<double>(connectionsNumber),
+               cpuPerEvent, toMillis(result.latencies.getPercentile(50.0)),
+               toMillis(result.latencies.getPercentile(99.0)), toMillis(result.latencies.getPercentile(99.9)),
+               toMillis(result.latencies.max));
+    of << line << std::endl;
+  }
+}
+
+// The totals of the sequence check of the connections
+struct SequenceCheck {
+  std::size_t gaps = 0;
+  std::size_t duplicates = 0;
+  std::size_t outOfOrderEvents = 0;
+};
+
+SequenceCheck getSequenceCheck(const std::vector<ConnectionStats>& connectionStats) {
+  SequenceCheck result{};
+
+  for (const auto& stats : connectionStats) {
+    result.gaps += stats.gaps.load(std::memory_order_relaxed);
+    result.duplicates += stats.duplicates.load(std::memory_order_relaxed);
+    result.outOfOrderEvents += stats.outOfOrderEvents.load(std::memory_order_relaxed);
+  }
+
+  return result;
+}
+
+void writeSequenceCheck(dxf::bench::JsonWriter& writer, const SequenceCheck& sequenceCheck) {
+  writer.beginObject();
+  writer.key("gaps").value(static_cast<std::uint64_t>(sequenceCheck.gaps));
+  writer.key("duplicates").value(static_cast<std::uint64_t>(sequenceCheck.duplicates));
+  writer.key("outOfOrder").value(static_cast<std::uint64_t>(sequenceCheck.outOfOrderEvents));
+  writer.endObject();
+}
+
+// The limits of the slopes of the trends of the soak run (per hour)
+struct SoakLimits {
+  // The growth of the RSS and of the live heap (MiB)
+  double rssMiB = 64.0;
+  double heapMiB = 32.0;
+  // The growth of the fragmentation of the heap (percentage points)
+  double fragmentation = 5.0;
+  // The growth of the p99 latency and the drop of the throughput (% of their means)
+  double p99Percent = 25.0;
+  double ratePercent = 10.0;
+
+  // Parses the "<metric>:<limit>[,<metric>:<limit>...]" (rss, heap, fragmentation, p99, rate). Returns false if the
+  // metric is unknown.
+  bool parse(const std::string& list) {
+    for (const auto& item : splitList(list)) {
+      auto separator = item.find(':');
+
+      if (separator == std::string::npos) {
+        return false;
+      }
+
+      auto name = item.substr(0, separator);
+      auto limit = std::stod(item.substr(separator + 1));
+
+      if (name == "rss") {
+        rssMiB = limit;
+      } else if (name == "heap") {
+        heapMiB = limit;
+      } else if (name == "fragmentation") {
+        fragmentation = limit;
+      } else if (name == "p99") {
+        p99Percent = limit;
+      } else if (name == "rate") {
+        ratePercent = limit;
+      } else {
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+// The options of the soak mode
+struct SoakConfig {
+  std::chrono::seconds duration{3600};
+  // The metrics are sampled once per bucket
+  std::chrono::seconds bucket{60};
+  // Every churn interval the share of the symbols of every connection is removed from its subscription and added back,
+  // and the same share of the books is closed and recreated. 0 - no churn.
+  std::chrono::seconds churnInterval{30};
+  double churnShare = 0.1;
+  // The books of the first symbols (0 - no books)
+  std::size_t booksNumber = 0;
+  std::string source = "NTV";
+  std::size_t levelsNumber = 10;
+  SoakLimits limits{};
+};
 
-inline std::string formatLocalTimestampWithMillis(long long timestamp) {
-  long long ms = timestamp % 1000;
+// The metrics of one bucket of the soak run
+struct SoakBucket {
+  std::string time{};
+  // The time of the end of the bucket since the start
+  double hours = 0.0;
+  double rate = 0.0;
+  dxf::LatencyHistogramSnapshot latencies{};
+  double cpuUsPerEvent = 0.0;
+  double rssMiB = 0.0;
+  dxf::AllocatorUsage allocator{};
+  std::size_t churnsNumber = 0;
+};
 
-  return fmt::format("{:%Y-%m-%d %H:%M:%S}.{:0>3}", fmt::localtime(static_cast<std::time_t>(timestamp / 1000)), ms);
+// Runs the connections for the duration with the periodic churn of the subscriptions and the books, samples the
+// metrics of every bucket (printed and written in CSV) and fits the trends of the buckets by the least squares (without
+// the first bucket, the subscription burst). The slow leaks, the fragmentation and the latency creep are the slopes
+// over their limits. Returns 1 if there is such drift, 0 otherwise.
+int runSoak(const char* endpoint, int eventTypesMask, const std::vector<std::vector<std::string>>& connectionSymbols,
+            bool useHeartbeat, const SoakConfig& config, const std::string& startTimeString) {
+  auto connectionsNumber = connectionSymbols.size();
+  auto connectionStats = std::vector<ConnectionStats>(connectionsNumber);
+  auto connections = std::vector<dxf_connection_t>(connectionsNumber);
+  auto subscriptions = std::vector<dxf_subscription_t>(connectionsNumber);
+
+  for (std::size_t i = 0; i < connectionsNumber; i++) {
+    if (!checkCall(dxf_create_connection(endpoint, nullptr, nullptr, nullptr, nullptr, nullptr, &connections[i]) !=
+                     DXF_FAILURE,
+                   "dxf_create_connection")) {
+      continue;
+    }
+
+    if (useHeartbeat) {
+      dxf_set_on_server_heartbeat_notifier(connections[i], onServerHeartbeat, &connectionStats[i]);
+    }
+
+    if (!checkCall(dxf_create_subscription(connections[i], eventTypesMask, &subscriptions[i]) != DXF_FAILURE,
+                   "dxf_create_subscription")) {
+      continue;
+    }
+
+    dxf_attach_event_listener(subscriptions[i], onEvents, &connectionStats[i]);
+    checkCall(dxf::SymbolSubscription::addSymbols(subscriptions[i], connectionSymbols[i]), "dxf_add_symbols");
+  }
+
+  // The book of the symbol and the connection it's recreated on
+  struct SoakBook {
+    std::string symbol{};
+    dxf_connection_t connection = nullptr;
+    std::unique_ptr<dxf::PriceLevelBook> book{};
+  };
+
+  auto books = std::vector<SoakBook>{};
+
+  for (std::size_t i = 0; books.size() < config.booksNumber; i++) {
+    auto connectionIndex = i % connectionsNumber;
+    auto symbolIndex = i / connectionsNumber;
+
+    if (symbolIndex >= connectionSymbols[0].size()) {
+      break;
+    }
+
+    if (symbolIndex < connectionSymbols[connectionIndex].size() && connections[connectionIndex] != nullptr) {
+      books.push_back({connectionSymbols[connectionIndex][symbolIndex], connections[connectionIndex], nullptr});
+    }
+  }
+
+  auto createBook = [&config](SoakBook& soakBook) {
+    soakBook.book.reset();
+    soakBook.book =
+      dxf::PriceLevelBook::create(soakBook.connection, soakBook.symbol, config.source, config.levelsNumber);
+  };
+
+  for (auto& soakBook : books) {
+    createBook(soakBook);
+  }
+
+  auto getChurnedNumber = [&config](std::size_t size) {
+    return size == 0 || config.churnShare <= 0.0
+             ? std::size_t{0}
+             : std::clamp(static_cast<std::size_t>(static_cast<double>(size) * config.churnShare), std::size_t{1},
+                          size);
+  };
+
+  // The churn goes round the symbols and the books
+  auto churnOffsets = std::vector<std::size_t>(connectionsNumber);
+  std::size_t bookOffset = 0;
+  auto churn = [&] {
+    for (std::size_t i = 0; i < connectionsNumber; i++) {
+      const auto& symbols = connectionSymbols[i];
+      auto churnedNumber = getChurnedNumber(symbols.size());
+
+      if (subscriptions[i] == nullptr || churnedNumber == 0) {
+        continue;
+      }
+
+      auto churned = std::vector<std::string>{};
+
+      for (std::size_t j = 0; j < churnedNumber; j++) {
+        churned.push_back(symbols[(churnOffsets[i] + j) % symbols.size()]);
+      }
+
+      churnOffsets[i] = (churnOffsets[i] + churnedNumber) % symbols.size();
+      checkCall(dxf::SymbolSubscription::removeSymbols(subscriptions[i], churned), "dxf_remove_symbols");
+      checkCall(dxf::SymbolSubscription::addSymbols(subscriptions[i], churned), "dxf_add_symbols");
+    }
+
+    auto churnedBooksNumber = getChurnedNumber(books.size());
+
+    for (std::size_t j = 0; j < churnedBooksNumber; j++) {
+      createBook(books[(bookOffset + j) % books.size()]);
+    }
+
+    bookOffset = books.empty() ? 0 : (bookOffset + churnedBooksNumber) % books.size();
+  };
+
+  auto getEvents = [&connectionStats] {
+    std::size_t result = 0;
+
+    for (const auto& stats : connectionStats) {
+      result += stats.getEventCounter();
+    }
+
+    return result;
+  };
+
+  auto getLatencies = [&connectionStats] {
+    dxf::LatencyHistogramSnapshot result{};
+
+    for (const auto& stats : connectionStats) {
+      result.merge(stats.latencyHistogram.getSnapshot());
+    }
+
+    return result;
+  };
+
+  auto toMillis = [](std::uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1e6; };
+  auto toMiB = [](std::uint64_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+  std::ofstream of{fmt::format("bench--{}-soak.csv", startTimeString)};
+
+  of << "time,hours,events per second,latency p50 ms,latency p99 ms,latency p99.9 ms,latency max ms,cpu us/event,"
+        "rss MiB,heap MiB,heap in use MiB,fragmentation %,churns"
+     << std::endl;
+  fmt::print("Soak: {} s, buckets of {} s, churn of {:.0f}% every {} s, books: {}\n", config.duration.count(),
+             config.bucket.count(), config.churnShare * 100.0, config.churnInterval.count(), books.size());
+
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + config.duration;
+  auto nextBucket = start + config.bucket;
+  auto nextChurn = config.churnInterval.count() > 0 ? start + config.churnInterval
+                                                    : std::chrono::steady_clock::time_point::max();
+  auto bucketStart = start;
+  auto previousEvents = getEvents();
+  auto previousLatencies = getLatencies();
+  auto previousUsage = dxf::ResourceUsage::sample();
+  auto buckets = std::vector<SoakBucket>{};
+  std::size_t churnsNumber = 0;
+
+  while (true) {
+    auto now = std::chrono::steady_clock::now();
+
+    if (now < nextBucket) {
+      if (now >= deadline) {
+        break;
+      }
+
+      if (now >= nextChurn) {
+        churn();
+        churnsNumber++;
+        nextChurn += config.churnInterval;
+      }
+
+      std::this_thread::sleep_for((std::min)({nextBucket, nextChurn, deadline}) - now);
+
+      continue;
+    }
+
+    auto events = getEvents();
+    auto latencies = getLatencies();
+    auto usage = dxf::ResourceUsage::sample();
+    auto seconds = std::chrono::duration<double>(now - bucketStart).count();
+    auto eventsNumber = static_cast<double>((std::max)(events - previousEvents, std::size_t{1}));
+    auto& bucket = buckets.emplace_back();
+
+    bucket.time = formatLocalTimestampWithMillis(
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count());
+    bucket.hours = std::chrono::duration<double>(now - start).count() / 3600.0;
+    bucket.rate = static_cast<double>(events - previousEvents) / seconds;
+    bucket.latencies = latencies.since(previousLatencies);
+    bucket.cpuUsPerEvent = static_cast<double>(usage.getCpuNanos() - previousUsage.getCpuNanos()) / 1000.0 /
+                           eventsNumber;
+    bucket.rssMiB = toMiB(usage.residentBytes);
+    bucket.allocator = dxf::AllocatorUsage::sample();
+    bucket.churnsNumber = churnsNumber;
+    previousEvents = events;
+    previousLatencies = latencies;
+    previousUsage = usage;
+    bucketStart = now;
+    // The bucket that is late (e.g. by the long churn) doesn't make the empty ones
+    nextBucket = (std::max)(nextBucket + config.bucket, now + config.bucket / 2);
+
+    fmt::print("{} (+{:.2f} h): {:0.0f} events per second, latency p50 {:.3f} ms, p99 {:.3f} ms, p99.9 {:.3f} ms, "
+               "max {:.3f} ms, cpu {:.3f} us/event, RSS {:.1f} MiB, heap {:.1f} MiB (in use {:.1f} MiB, "
+               "fragmentation {:.1f}%), churns: {}\n",
+               bucket.time, bucket.hours, bucket.rate, toMillis(bucket.latencies.getPercentile(50.0)),
+               toMillis(bucket.latencies.getPercentile(99.0)), toMillis(bucket.latencies.getPercentile(99.9)),
+               toMillis(bucket.latencies.max), bucket.cpuUsPerEvent, bucket.rssMiB, toMiB(bucket.allocator.heapBytes),
+               toMiB(bucket.allocator.inUseBytes), bucket.allocator.getFragmentation(), churnsNumber);
+    of << fmt::format("{},{:.4f},{:0.0f},{:.3f},{:.3f},{:.3f},{:.3f},{:.3f},{:.1f},{:.1f},{:.1f},{:.2f},{}",
+                      bucket.time, bucket.hours, bucket.rate, toMillis(bucket.latencies.getPercentile(50.0)),
+                      toMillis(bucket.latencies.getPercentile(99.0)), toMillis(bucket.latencies.getPercentile(99.9)),
+                      toMillis(bucket.latencies.max), bucket.cpuUsPerEvent, bucket.rssMiB,
+                      toMiB(bucket.allocator.heapBytes), toMiB(bucket.allocator.inUseBytes),
+                      bucket.allocator.getFragmentation(), churnsNumber)
+       << std::endl;
+  }
+
+  auto ownedBooks = std::vector<std::unique_ptr<dxf::PriceLevelBook>>{};
+
+  for (auto& soakBook : books) {
+    ownedBooks.push_back(std::move(soakBook.book));
+  }
+
+  auto closed = dxf::ShutdownBatch{}
+                  .addStop([] { stop = true; })
+                  .addOwned(std::move(ownedBooks))
+                  .addConnections(connections)
+                  .closeAsync();
+
+  // The trends of the buckets after the first one (the subscription burst)
+  auto first = buckets.size() > 2 ? std::size_t{1} : std::size_t{0};
+  auto getTrend = [&buckets, first](auto&& getValue) {
+    std::vector<double> hours{};
+    std::vector<double> values{};
+
+    for (auto i = first; i < buckets.size(); i++) {
+      hours.push_back(buckets[i].hours);
+      values.push_back(getValue(buckets[i]));
+    }
+
+    return dxf::bench::LinearTrend::of(hours, values);
+  };
+
+  // The slopes per hour: the growths in MiB and percentage points, the latency growth and the throughput drop in % of
+  // their means
+  struct Drift {
+    const char* name;
+    const char* unit;
+    double slope;
+    double limit;
+  };
+
+  auto toPercent = [](const dxf::bench::LinearTrend& trend) {
+    return trend.mean > 0.0 ? trend.slope * 100.0 / trend.mean : std::nan("");
+  };
+  auto isAllocatorSupported = !buckets.empty() && buckets.front().allocator.isSupported;
+  auto drifts = std::vector<Drift>{
+    {"rss", "MiB/h", getTrend([](const SoakBucket& b) { return b.rssMiB; }).slope, config.limits.rssMiB},
+    {"heap", "MiB/h",
+     isAllocatorSupported ? getTrend([&toMiB](const SoakBucket& b) { return toMiB(b.allocator.inUseBytes); }).slope
+                          : std::nan(""),
+     config.limits.heapMiB},
+    {"fragmentation", "points/h",
+     isAllocatorSupported ? getTrend([](const SoakBucket& b) { return b.allocator.getFragmentation(); }).slope
+                          : std::nan(""),
+     config.limits.fragmentation},
+    {"p99", "%/h",
+     toPercent(getTrend([&toMillis](const SoakBucket& b) { return toMillis(b.latencies.getPercentile(99.0)); })),
+     config.limits.p99Percent},
+    {"rate", "% drop/h", -toPercent(getTrend([](const SoakBucket& b) { return b.rate; })), config.limits.ratePercent}};
+  std::ofstream trendsOf{fmt::format("bench--{}-soak-trends.csv", startTimeString)};
+  std::size_t driftsNumber = 0;
+
+  trendsOf << "metric,slope,unit,limit,drift" << std::endl;
+  fmt::print("\nTrends of {} buckets:\n", buckets.size() - first);
+
+  for (const auto& drift : drifts) {
+    // NaN - not enough buckets or not measured
+    auto isDrift = drift.slope > drift.limit;
+
+    driftsNumber += isDrift ? 1 : 0;
+    fmt::print("  {:<14} {:>10} {:<9} (limit {}){}\n", drift.name,
+               std::isnan(drift.slope) ? std::string{"n/a"} : fmt::format("{:+.3f}", drift.slope), drift.unit,
+               drift.limit, isDrift ? " DRIFT" : "");
+    trendsOf << fmt::format("{},{:.4f},{},{},{}", drift.name, drift.slope, drift.unit, drift.limit, isDrift ? 1 : 0)
+             << std::endl;
+  }
+
+  fmt::print("\n{} drift(s)\n", driftsNumber);
+  closed.wait();
+
+  return driftsNumber == 0 ? 0 : 1;
 }
 
-std::atomic<std::size_t> eventCounter = 0;
-std::atomic<bool> check = true;
-std::atomic<bool> stop = false;
+// The interval of the result file
+struct IntervalResult {
+  std::string time{};
+  double total = 0.0;
+  // The rates of the subscribed event types
+  std::vector<double> rates{};
+  dxf::LatencyHistogramSnapshot latencies{};
+  double cpuUsPerEvent = 0.0;
+  // NaN without the `allocations` option
+  double allocationsPerEvent = 0.0;
+  double rssMiB = 0.0;
+  // The totals since the start
+  SequenceCheck sequenceCheck{};
+};
+
+std::string getHostName() {
+#ifdef _WIN32
+  const auto* name = std::getenv("COMPUTERNAME");
+
+  return name != nullptr ? name : "";
+#else
+  char name[256]{};
+
+  return gethostname(name, sizeof(name) - 1) == 0 ? name : "";
+#endif
+}
+
+void writeLatencies(dxf::bench::JsonWriter& writer, const dxf::LatencyHistogramSnapshot& latencies) {
+  auto toMillis = [](std::uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1e6; };
+
+  writer.beginObject();
+  writer.key("count").value(latencies.count);
+  writer.key("p50Ms").value(toMillis(latencies.getPercentile(50.0)));
+  writer.key("p99Ms").value(toMillis(latencies.getPercentile(99.0)));
+  writer.key("p999Ms").value(toMillis(latencies.getPercentile(99.9)));
+  writer.key("maxMs").value(toMillis(latencies.max));
+  writer.endObject();
+}
+
+// Writes the result file: the metadata of the run, the intervals and the summary statistics (see BenchResult.hpp)
+void writeResult(const std::string& fileName, const std::string& startTime, const char* endpoint,
+                 const std::vector<std::size_t>& eventTypes, const std::vector<std::string>& symbols,
+                 std::size_t connectionsNumber, bool useHeartbeat, const std::vector<IntervalResult>& intervals,
+                 std::size_t totalEvents, double seconds, const dxf::LatencyHistogramSnapshot& latencies,
+                 const SequenceCheck& sequenceCheck) {
+  dxf::bench::JsonWriter writer{};
+
+  writer.beginObject();
+  writer.key("schema").value(dxf::bench::RESULT_SCHEMA);
+  writer.key("schemaVersion").value(static_cast<std::uint64_t>(dxf::bench::RESULT_SCHEMA_VERSION));
+
+  writer.key("metadata").beginObject();
+  writer.key("libraryVersion").value(DXFEED_C_API_VERSION);
+  writer.key("host").value(getHostName());
+  writer.key("startTime").value(startTime);
+  writer.key("endpoint").value(endpoint);
+  writer.key("eventTypes").beginArray();
+
+  for (auto typeIndex : eventTypes) {
+    writer.value(EVENT_TYPES[typeIndex].name);
+  }
+
+  writer.endArray();
+  writer.key("symbols").beginArray();
+
+  for (const auto& symbol : symbols) {
+    writer.value(symbol);
+  }
+
+  writer.endArray();
+  writer.key("connections").value(static_cast<std::uint64_t>(connectionsNumber));
+  writer.key("heartbeat").value(useHeartbeat);
+  writer.key("allocations").value(countAllocations.load());
+  writer.endObject();
+
+  writer.key("intervals").beginArray();
+
+  for (const auto& interval : intervals) {
+    writer.beginObject();
+    writer.key("time").value(interval.time);
+    writer.key("total").value(interval.total);
+    writer.key("types").beginObject();
+
+    for (std::size_t i = 0; i < eventTypes.size(); i++) {
+      writer.key(EVENT_TYPES[eventTypes[i]].name).value(interval.rates[i]);
+    }
+
+    writer.endObject();
+    writer.key("latency");
+    writeLatencies(writer, interval.latencies);
+    writer.key("cpuUsPerEvent").value(interval.cpuUsPerEvent);
+    writer.key("allocationsPerEvent").value(interval.allocationsPerEvent);
+    writer.key("rssMiB").value(interval.rssMiB);
+    writer.key("sequenceCheck");
+    writeSequenceCheck(writer, interval.sequenceCheck);
+    writer.endObject();
+  }
+
+  writer.endArray();
+
+  auto getSeries = [&intervals](auto&& getValue) {
+    std::vector<double> series{};
+
+    for (const auto& interval : intervals) {
+      series.push_back(getValue(interval));
+    }
+
+    return series;
+  };
+
+  writer.key("summary").beginObject();
+  writer.key("durationSeconds").value(seconds);
+  writer.key("events").value(static_cast<std::uint64_t>(totalEvents));
+  writer.key("eventsPerSecond");
+  dxf::bench::SeriesStats::of(getSeries([](const IntervalResult& i) { return i.total; })).write(writer);
+  writer.key("cpuUsPerEvent");
+  dxf::bench::SeriesStats::of(getSeries([](const IntervalResult& i) { return i.cpuUsPerEvent; })).write(writer);
+  writer.key("latency");
+  writeLatencies(writer, latencies);
+  writer.key("sequenceCheck");
+  writeSequenceCheck(writer, sequenceCheck);
+  writer.endObject();
+  writer.endObject();
+
+  std::ofstream{fileName} << writer.getResult() << std::endl;
+}
+
+// bench compare <baseline.json> <candidate.json> [threshold=<percent>]. Returns the exit code: 0 - no regressions,
+// 1 - regressions, 2 - the files can't be read.
+int compare(int argc, char* argv[]) {
+  auto read = [](const char* fileName) -> std::optional<dxf::bench::JsonValue> {
+    std::ifstream f{fileName};
+    std::string text{std::istreambuf_iterator<char>{f}, std::istreambuf_iterator<char>{}};
+    auto result = dxf::bench::JsonParser::parse(text);
+
+    if (!result || result->getString("schema") != dxf::bench::RESULT_SCHEMA) {
+      std::cerr << "Not a bench result: " << fileName << "\n";
+
+      return std::nullopt;
+    }
+
+    return result;
+  };
+
+  auto baseline = read(argv[2]);
+  auto candidate = read(argv[3]);
+  double threshold = 5.0;
+
+  for (int i = 4; i < argc; i++) {
+    auto option = std::string(argv[i]);
+
+    if (option.starts_with("threshold=")) {
+      threshold = std::stod(option.substr(10));
+    }
+  }
+
+  if (!baseline || !candidate) {
+    return 2;
+  }
+
+  auto regressions = dxf::bench::compareResults(*baseline, *candidate, threshold);
+
+  fmt::print("\n{} regression(s) (threshold {}%)\n", regressions, threshold);
+
+  return regressions == 0 ? 0 : 1;
+}
 
 int main(int argc, char* argv[]) {
+  if (argc >= 4 && std::string(argv[1]) == "compare") {
+    return compare(argc, argv);
+  }
+
   if (argc < 4) {
-    std::cout << "Usage:\n  bench <endpoint> <event type> <symbol>\n\n";
+    std::cout << "Usage:\n  bench <endpoint> <event type>[,<event type>...] <symbol>[,<symbol>...] | "
+                 "ipf=<file>[@<filter>] [heartbeat] [connections=<number>] [allocations] [perf]\n"
+                 "  bench <endpoint> PriceLevelBook <symbol>[,<symbol>...] | ipf=<file>[@<filter>] [source=<source>] "
+                 "[levels=<number>] [connections=<number>] [duration=<seconds>] [placement=<placement>] "
+                 "[largepages=<config>] [async] [perf]\n"
+                 "  bench <endpoint> TimeAndSaleProvider <symbol>[,<symbol>...] | ipf=<file>[@<filter>] "
+                 "[duration=<seconds>] [largepages=<config>] [perf]\n"
+                 "  bench <endpoint> <event type>[,<event type>...] <symbol>[,<symbol>...] | ipf=<file>[@<filter>] "
+                 "sweep=<number of connections> [subscriptions=<number>] [processes] [duration=<seconds>] "
+                 "[heartbeat]\n"
+                 "  bench <endpoint> <event type>[,<event type>...] <symbol>[,<symbol>...] | ipf=<file>[@<filter>] "
+                 "soak=<seconds> [bucket=<seconds>] [churn=<seconds>] [churnshare=<percent>] [books=<number>] "
+                 "[source=<source>] [levels=<number>] [drift=<metric>:<limit>[,<metric>:<limit>...]] "
+                 "[connections=<number>] [heartbeat]\n"
+                 "  bench compare <baseline.json> <candidate.json> [threshold=<percent>]\n\n";
 
     return 0;
   }
 
-  auto eventTypeStringToMask = std::unordered_map<std::string, unsigned>{
-    {"Trade", DXF_ET_TRADE},
-    {"TRADE", DXF_ET_TRADE},
-    {"Quote", DXF_ET_QUOTE},
-    {"QUOTE", DXF_ET_QUOTE},
-    {"Summary", DXF_ET_SUMMARY},
-    {"SUMMARY", DXF_ET_SUMMARY},
-    {"Profile", DXF_ET_PROFILE},
-    {"PROFILE", DXF_ET_PROFILE},
-    {"Order", DXF_ET_ORDER},
-    {"ORDER", DXF_ET_ORDER},
-    {"TimeAndSale", DXF_ET_TIME_AND_SALE},
-    {"TIME_AND_SALE", DXF_ET_TIME_AND_SALE},
+  auto eventTypeStringToIndex = std::unordered_map<std::string, std::size_t>{
+    {"Trade", 0},
+    {"TRADE", 0},
+    {"Quote", 1},
+    {"QUOTE", 1},
+    {"Summary", 2},
+    {"SUMMARY", 2},
+    {"Profile", 3},
+    {"PROFILE", 3},
+    {"Order", 4},
+    {"ORDER", 4},
+    {"TimeAndSale", 5},
+    {"TIME_AND_SALE", 5},
+    {"Candle", 6},
+    {"CANDLE", 6},
   };
 
   auto endpoint = argv[1];
-  auto eventType = argv[2];
-  auto symbol = argv[3];
+  auto symbolsArgument = std::string(argv[3]);
+  auto symbols = symbolsArgument.starts_with("ipf=") ? readIpfSymbols(symbolsArgument.substr(4))
+                                                     : splitList(symbolsArgument);
 
-  dxf_connection_t connection = nullptr;
-  dxf_create_connection(endpoint, nullptr, nullptr, nullptr, nullptr, nullptr, &connection);
-  dxf_subscription_t sub = nullptr;
-  dxf_create_subscription(connection, static_cast<int>(eventTypeStringToMask[eventType]), &sub);
-  dxf_attach_event_listener(
-    sub,
-    [](int eventType, dxf_const_string_t, const dxf_event_data_t* data, int dataCount, void*) {
-      static long previousPrice = 0;
+  if (symbols.empty()) {
+    std::cerr << "No symbols: " << symbolsArgument << "\n";
 
-      if (eventType != DXF_ET_TIME_AND_SALE) return;
+    return 1;
+  }
 
-      auto timeAndSales = reinterpret_cast<const dxf_time_and_sale_t*>(data);
+  bool useHeartbeat = false;
+  std::size_t connectionsNumber = 1;
+  std::string source = "NTV";
+  std::size_t levelsNumber = 10;
+  // The duration of the components mode (60 s by default) or of every trial of the sweep (10 s by default)
+  auto duration = std::chrono::seconds{0};
+  std::size_t sweepConnectionsNumber = 0;
+  std::size_t subscriptionsNumber = 1;
+  bool useProcesses = false;
+  // The trial of the child process of the sweep (seconds, 0 - not a child)
+  auto trialDuration = std::chrono::seconds{0};
+  // The placement of the socket threads of the PriceLevelBook mode
+  dxf::ThreadPlacement placement{};
+  bool isAsync = false;
+  bool usePerfCounters = false;
+  // The soak mode (the duration is not 0)
+  auto soakConfig = SoakConfig{};
+  auto isSoak = false;
 
-      for (std::size_t i = 0; i < dataCount; i++) {
-        const auto& tns = timeAndSales[i];
-        auto price = static_cast<long>(tns.price);
+  for (int i = 4; i < argc; i++) {
+    auto option = std::string(argv[i]);
 
-        if (previousPrice != 0) {
-          if (price - previousPrice > 1) {
-            check = false;
-          }
-        }
+    if (option == "heartbeat") {
+      useHeartbeat = true;
+    } else if (option.starts_with("connections=")) {
+      connectionsNumber = (std::max)(std::stoull(option.substr(12)), 1ULL);
+    } else if (option == "allocations") {
+      countAllocations = true;
+    } else if (option.starts_with("source=")) {
+      source = option.substr(7);
+    } else if (option.starts_with("levels=")) {
+      levelsNumber = std::stoull(option.substr(7));
+    } else if (option.starts_with("duration=")) {
+      duration = std::chrono::seconds{std::stoll(option.substr(9))};
+    } else if (option.starts_with("sweep=")) {
+      sweepConnectionsNumber = (std::max)(std::stoull(option.substr(6)), 1ULL);
+    } else if (option.starts_with("subscriptions=")) {
+      subscriptionsNumber = (std::max)(std::stoull(option.substr(14)), 1ULL);
+    } else if (option == "processes") {
+      useProcesses = true;
+    } else if (option == "async") {
+      isAsync = true;
+    } else if (option == "perf") {
+      usePerfCounters = true;
+    } else if (option.starts_with("soak=")) {
+      soakConfig.duration = std::chrono::seconds{std::stoll(option.substr(5))};
+      isSoak = soakConfig.duration.count() > 0;
+    } else if (option.starts_with("bucket=")) {
+      soakConfig.bucket = std::chrono::seconds{(std::max)(std::stoll(option.substr(7)), 1LL)};
+    } else if (option.starts_with("churn=")) {
+      soakConfig.churnInterval = std::chrono::seconds{std::stoll(option.substr(6))};
+    } else if (option.starts_with("churnshare=")) {
+      soakConfig.churnShare = std::stod(option.substr(11)) / 100.0;
+    } else if (option.starts_with("books=")) {
+      soakConfig.booksNumber = std::stoull(option.substr(6));
+    } else if (option.starts_with("drift=")) {
+      if (!soakConfig.limits.parse(option.substr(6))) {
+        std::cerr << "Invalid drift limits: " << option.substr(6) << "\n";
 
-        eventCounter++;
-        previousPrice = price;
+        return 1;
       }
-    },
-    nullptr);
+    } else if (option.starts_with("trial=")) {
+      trialDuration = std::chrono::seconds{std::stoll(option.substr(6))};
+    } else if (option.starts_with("placement=")) {
+      auto parsedPlacement = dxf::ThreadPlacement::parse(option.substr(10));
+
+      if (!parsedPlacement) {
+        std::cerr << "Invalid placement: " << option.substr(10) << "\n";
+
+        return 1;
+      }
+
+      placement = std::move(*parsedPlacement);
+    } else if (option.starts_with("largepages=")) {
+      auto largePageConfig = dxf::LargePageConfig::parse(option.substr(11));
+
+      if (!largePageConfig) {
+        std::cerr << "Invalid large page config: " << option.substr(11) << "\n";
+
+        return 1;
+      }
+
+      // Before the rings and the arenas are allocated
+      dxf::LargePages::configure(*largePageConfig);
+    }
+  }
+
+  if (usePerfCounters) {
+    if (dxf::PerfCounters::isSupported()) {
+      perfCounters = std::make_unique<dxf::PerfCounters>();
+      // The main thread, the threads of the C API and of the C++ API are created later
+      perfCounters->ignoreExistingThreads();
+    } else {
+      std::cerr << "The hardware counters are not available (perf_event_open), the perf option is ignored\n";
+    }
+  }
+
+  // The components mode: the layers of the C++ API instead of the event types
+  auto component = std::string(argv[2]);
+
+  if (component == "PriceLevelBook" || component == "TimeAndSaleProvider") {
+    auto fileName = fmt::format(
+      "bench--{}-layers.csv",
+      formatLocalTimestampWithMillis(
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()));
+
+    if (component == "PriceLevelBook") {
+      runPriceLevelBooks(endpoint, symbols, source, levelsNumber, connectionsNumber,
+                         duration.count() == 0 ? std::chrono::seconds{60} : duration, placement, isAsync, fileName);
+    } else {
+      runTimeAndSaleProvider(endpoint, symbols, duration.count() == 0 ? std::chrono::seconds{60} : duration,
+                             fileName);
+    }
+
+    auto largePageStats = dxf::LargePages::getStats();
+
+    fmt::print("Large buffers: {} mapped, {} explicit huge pages, {} fallbacks, {} lock failures\n",
+               largePageStats.allocationsNumber, largePageStats.explicitNumber, largePageStats.fallbacksNumber,
+               largePageStats.lockFailuresNumber);
+
+    return 0;
+  }
+
+  auto eventTypes = std::vector<std::size_t>{};
+  int eventTypesMask = 0;
+
+  for (const auto& eventType : splitList(argv[2])) {
+    auto found = eventTypeStringToIndex.find(eventType);
+
+    if (found == eventTypeStringToIndex.end()) {
+      std::cerr << "Unknown event type: " << eventType << "\n";
+
+      return 1;
+    }
+
+    if ((eventTypesMask & EVENT_TYPES[found->second].mask) == 0) {
+      eventTypes.push_back(found->second);
+      eventTypesMask |= EVENT_TYPES[found->second].mask;
+    }
+  }
+
+  if (trialDuration.count() > 0 || sweepConnectionsNumber != 0) {
+    // The per-symbol counters of the listener
+    for (const auto& symbol : symbols) {
+      symbolStats.try_emplace(dxf::Symbol::valueOf(std::string_view{symbol}));
+    }
+
+    if (trialDuration.count() > 0) {
+      fmt::print("{}\n", formatTrialResult(runTrial(endpoint, eventTypesMask, symbols, 1, subscriptionsNumber,
+                                                    useHeartbeat, trialDuration)));
+    } else {
+      runSweep(argv[0], endpoint, argv[2], symbolsArgument, eventTypesMask, symbols, sweepConnectionsNumber,
+               subscriptionsNumber, useProcesses, useHeartbeat,
+               duration.count() == 0 ? std::chrono::seconds{10} : duration,
+               fmt::format("bench--{}-sweep.csv",
+                           formatLocalTimestampWithMillis(std::chrono::duration_cast<std::chrono::seconds>(
+                                                            std::chrono::system_clock::now().time_since_epoch())
+                                                            .count())));
+    }
+
+    return 0;
+  }
+
+  // The symbols are distributed among the connections
+  auto connectionSymbols = std::vector<std::vector<std::string>>(connectionsNumber);
+
+  for (const auto& symbol : symbols) {
+    if (symbolStats.try_emplace(dxf::Symbol::valueOf(std::string_view{symbol})).second) {
+      connectionSymbols[(symbolStats.size() - 1) % connectionsNumber].push_back(symbol);
+    }
+  }
+
+  sequenceStates.resize(dxf::SymbolTable::getInstance().getSize() * EVENT_TYPES.size());
+
+  if (isSoak) {
+    soakConfig.source = source;
+    soakConfig.levelsNumber = levelsNumber;
+
+    return runSoak(endpoint, eventTypesMask, connectionSymbols, useHeartbeat, soakConfig,
+                   formatLocalTimestampWithMillis(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                    std::chrono::system_clock::now().time_since_epoch())
+                                                    .count()));
+  }
+
+  fmt::print("Event types: {}, symbols: {}, connections: {}\n", eventTypes.size(), symbolStats.size(),
+             connectionsNumber);
+
+  auto connectionStats = std::vector<ConnectionStats>(connectionsNumber);
+  auto connections = std::vector<dxf_connection_t>(connectionsNumber);
+
+  for (std::size_t i = 0; i < connectionsNumber; i++) {
+    if (!checkCall(dxf_create_connection(endpoint, nullptr, nullptr, nullptr, nullptr, nullptr, &connections[i]) !=
+                     DXF_FAILURE,
+                   "dxf_create_connection")) {
+      continue;
+    }
+
+    if (useHeartbeat) {
+      dxf_set_on_server_heartbeat_notifier(connections[i], onServerHeartbeat, &connectionStats[i]);
+    }
+
+    dxf_subscription_t sub = nullptr;
+
+    if (!checkCall(dxf_create_subscription(connections[i], eventTypesMask, &sub) != DXF_FAILURE,
+                   "dxf_create_subscription")) {
+      continue;
+    }
 
-  auto wSymbol = dxf::StringConverter::utf8ToWString(symbol);
-  dxf_add_symbol(sub, wSymbol.c_str());
+    dxf_attach_event_listener(sub, onEvents, &connectionStats[i]);
+    checkCall(dxf::SymbolSubscription::addSymbols(sub, connectionSymbols[i]), "dxf_add_symbols");
+  }
+
+  auto getLatencies = [&connectionStats] {
+    dxf::LatencyHistogramSnapshot result{};
+
+    for (const auto& stats : connectionStats) {
+      result.merge(stats.latencyHistogram.getSnapshot());
+    }
 
-  auto th = std::thread([] {
+    return result;
+  };
+
+  auto startTime = std::chrono::system_clock::now();
+  auto startTimeString = formatLocalTimestampWithMillis(
+    std::chrono::duration_cast<std::chrono::seconds>(startTime.time_since_epoch()).count());
+
+  auto intervals = std::vector<IntervalResult>{};
+  auto th = std::thread([&eventTypes, &connectionStats, &getLatencies, startTime, &startTimeString, &intervals] {
     using namespace std::chrono_literals;
 
-    auto start = std::chrono::system_clock::now();
+    auto start = startTime;
+    std::ofstream of{fmt::format("bench--{}.csv", startTimeString)};
+    // The monotonic totals of the previous interval (per type and per connection)
+    std::array<std::size_t, EVENT_TYPES.size()> previousCounters{};
+    auto previousConnectionCounters = std::vector<std::size_t>(connectionStats.size());
+    auto previousLatencies = getLatencies();
+    auto firstUsage = dxf::ResourceUsage::sample();
+    auto previousUsage = firstUsage;
+    auto previousAllocations = getAllocationsNumber();
+    std::array<dxf::PerfCounterValues, dxf::PerfCounters::SCOPES_NUMBER> previousPerfCounters{};
+
+    if (perfCounters) {
+      perfCounters->ignoreCurrentThread();
+    }
+
+    of << "time,total";
+
+    for (auto typeIndex : eventTypes) {
+      of << "," << EVENT_TYPES[typeIndex].name;
+    }
+
+    if (connectionStats.size() > 1) {
+      for (std::size_t i = 0; i < connectionStats.size(); i++) {
+        of << ",connection " << i + 1;
+      }
+    }
+
+    of << ",latency p50 ms,latency p99 ms,latency p99.9 ms,latency max ms";
+    of << ",cpu us/event,cpu %,allocations/event,context switches/1000 events,rss MiB,rss growth MiB";
+    of << ",gaps,duplicates,out of order";
 
-    std::ofstream of{
-      fmt::format("bench--{}.csv",
-                  formatLocalTimestampWithMillis(
-                    std::chrono::duration_cast<std::chrono::seconds>(start.time_since_epoch()).count()))};
+    if (perfCounters) {
+      of << getPerfCountersCsvHeader();
+    }
+
+    of << std::endl;
 
     while (!stop) {
       auto current = std::chrono::system_clock::now();
       auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(current - start).count();
 
       if (elapsed >= 1000) {
-        auto avg = static_cast<double>(eventCounter) * 1000.0 / static_cast<double>(elapsed);
-        eventCounter = 0;
-
         auto nowString = formatLocalTimestampWithMillis(
           std::chrono::duration_cast<std::chrono::milliseconds>(current.time_since_epoch()).count());
+        auto toRate = [elapsed](std::size_t delta) {
+          return static_cast<double>(delta) * 1000.0 / static_cast<double>(elapsed);
+        };
+        auto rates = std::vector<double>{};
+        double total = 0.0;
+
+        for (auto typeIndex : eventTypes) {
+          std::size_t counter = 0;
+
+          for (const auto& stats : connectionStats) {
+            counter += stats.eventCounters[typeIndex].load(std::memory_order_relaxed);
+          }
+
+          rates.push_back(toRate(counter - previousCounters[typeIndex]));
+          total += rates.back();
+          previousCounters[typeIndex] = counter;
+        }
+
         fmt::print("{}\n", nowString);
-        fmt::print("Current speed: {:0.0f} events per second\n", avg);
-        fmt::print("Event check: {}\n", check);
-        of << nowString << "," << fmt::format("{:0.0f}", avg) << std::endl;
+        fmt::print("Current speed: {:0.0f} events per second\n", total);
+        of << nowString << "," << fmt::format("{:0.0f}", total);
+
+        for (std::size_t i = 0; i < eventTypes.size(); i++) {
+          fmt::print("  {}: {:0.0f} events per second\n", EVENT_TYPES[eventTypes[i]].name, rates[i]);
+          of << "," << fmt::format("{:0.0f}", rates[i]);
+        }
+
+        if (connectionStats.size() > 1) {
+          for (std::size_t i = 0; i < connectionStats.size(); i++) {
+            auto counter = connectionStats[i].getEventCounter();
+            auto rate = toRate(counter - previousConnectionCounters[i]);
+
+            previousConnectionCounters[i] = counter;
+            fmt::print("  connection #{}: {:0.0f} events per second\n", i + 1, rate);
+            of << "," << fmt::format("{:0.0f}", rate);
+          }
+        }
+
+        auto latencies = getLatencies();
+        auto interval = latencies.since(previousLatencies);
+        auto toMillis = [](std::uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1e6; };
+
+        previousLatencies = latencies;
+        fmt::print("Latency: p50 {:.3f} ms, p99 {:.3f} ms, p99.9 {:.3f} ms, max {:.3f} ms (clock offset {:.3f} ms)\n",
+                   toMillis(interval.getPercentile(50.0)), toMillis(interval.getPercentile(99.0)),
+                   toMillis(interval.getPercentile(99.9)), toMillis(interval.max),
+                   static_cast<double>(connectionStats[0].clockOffset.load(std::memory_order_relaxed)) / 1e6);
+        of << fmt::format(",{:.3f},{:.3f},{:.3f},{:.3f}", toMillis(interval.getPercentile(50.0)),
+                          toMillis(interval.getPercentile(99.0)), toMillis(interval.getPercentile(99.9)),
+                          toMillis(interval.max));
+
+        // The costs of the interval per received event (the whole process: the C API threads, the listeners and this
+        // thread)
+        auto usage = dxf::ResourceUsage::sample();
+        auto allocations = getAllocationsNumber();
+        auto events = (std::max)(total * static_cast<double>(elapsed) / 1000.0, 1.0);
+        auto cpuNanos = static_cast<double>(usage.getCpuNanos() - previousUsage.getCpuNanos());
+        auto toMiB = [](std::uint64_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+        auto cpuPerEvent = cpuNanos / 1000.0 / events;
+        auto cpuPercent = cpuNanos / 1e4 / static_cast<double>(elapsed);
+        auto allocationsPerEvent = static_cast<double>(allocations - previousAllocations) / events;
+        auto contextSwitchesPerEvent =
+          static_cast<double>(usage.getContextSwitches() - previousUsage.getContextSwitches()) * 1000.0 / events;
+        auto rssGrowth = toMiB(usage.residentBytes) - toMiB(firstUsage.residentBytes);
+
+        previousUsage = usage;
+        previousAllocations = allocations;
+        fmt::print("Resources: cpu {:.3f} us/event ({:.1f}%), {} allocations/event, {:.3f} context switches/1000 "
+                   "events, RSS {:.1f} MiB ({:+.1f} MiB)\n",
+                   cpuPerEvent, cpuPercent,
+                   countAllocations ? fmt::format("{:.3f}", allocationsPerEvent) : std::string{"n/a"},
+                   contextSwitchesPerEvent, toMiB(usage.residentBytes), rssGrowth);
+        auto sequenceCheck = getSequenceCheck(connectionStats);
+
+        fmt::print("Sequence check: {} gaps, {} duplicates, {} out of order\n", sequenceCheck.gaps,
+                   sequenceCheck.duplicates, sequenceCheck.outOfOrderEvents);
+        of << fmt::format(",{:.3f},{:.1f},{},{:.3f},{:.1f},{:.1f}", cpuPerEvent, cpuPercent,
+                          countAllocations ? fmt::format("{:.3f}", allocationsPerEvent) : std::string{},
+                          contextSwitchesPerEvent, toMiB(usage.residentBytes), rssGrowth)
+           << fmt::format(",{},{},{}", sequenceCheck.gaps, sequenceCheck.duplicates, sequenceCheck.outOfOrderEvents);
+
+        if (perfCounters) {
+          of << reportPerfCounters(previousPerfCounters, events);
+        }
+
+        of << std::endl;
+        intervals.push_back({nowString, total, rates, interval, cpuPerEvent,
+                             countAllocations ? allocationsPerEvent : std::nan(""), toMiB(usage.residentBytes),
+                             sequenceCheck});
 
         start = current;
       }
@@ -115,7 +1848,70 @@ int main(int argc, char* argv[]) {
   });
 
   std::cin.get();
-  dxf_close_connection(connection);
-  stop = true;
+
+  // The connections are closed in the background while the totals are written
+  auto closed = dxf::ShutdownBatch{}.addStop([] { stop = true; }).addConnections(connections).closeAsync();
+
   th.join();
-}
\ No newline at end of file
+
+  // The totals of the run: the average speed of every type and connection and the events of every symbol
+  auto seconds = std::chrono::duration<double>(std::chrono::system_clock::now() - startTime).count();
+  std::size_t totalEvents = 0;
+  std::size_t otherSymbolsEvents = 0;
+
+  for (auto typeIndex : eventTypes) {
+    std::size_t counter = 0;
+
+    for (const auto& stats : connectionStats) {
+      counter += stats.eventCounters[typeIndex].load(std::memory_order_relaxed);
+    }
+
+    totalEvents += counter;
+    fmt::print("{}: {} events, {:0.0f} events per second\n", EVENT_TYPES[typeIndex].name, counter,
+               static_cast<double>(counter) / seconds);
+  }
+
+  for (std::size_t i = 0; i < connectionStats.size(); i++) {
+    auto counter = connectionStats[i].getEventCounter();
+
+    otherSymbolsEvents += connectionStats[i].otherSymbolsEventCounter.load(std::memory_order_relaxed);
+
+    if (connectionStats.size() > 1) {
+      fmt::print("Connection #{}: {} events, {:0.0f} events per second\n", i + 1, counter,
+                 static_cast<double>(counter) / seconds);
+    }
+  }
+
+  fmt::print("Total: {} events, {:0.0f} events per second\n", totalEvents, static_cast<double>(totalEvents) / seconds);
+
+  auto latencies = getLatencies();
+
+  fmt::print("Latency: p50 {:.3f} ms, p99 {:.3f} ms, p99.9 {:.3f} ms, max {:.3f} ms\n",
+             static_cast<double>(latencies.getPercentile(50.0)) / 1e6,
+             static_cast<double>(latencies.getPercentile(99.0)) / 1e6,
+             static_cast<double>(latencies.getPercentile(99.9)) / 1e6, static_cast<double>(latencies.max) / 1e6);
+
+  auto sequenceCheck = getSequenceCheck(connectionStats);
+
+  fmt::print("Sequence check: {} gaps, {} duplicates, {} out of order\n", sequenceCheck.gaps, sequenceCheck.duplicates,
+             sequenceCheck.outOfOrderEvents);
+
+  std::ofstream symbolsOf{fmt::format("bench--{}-symbols.csv", startTimeString)};
+  std::size_t symbolsWithEvents = 0;
+
+  symbolsOf << "symbol,events" << std::endl;
+
+  for (const auto& [symbol, stats] : symbolStats) {
+    auto counter = stats.eventCounter.load(std::memory_order_relaxed);
+
+    symbolsWithEvents += counter != 0 ? 1 : 0;
+    symbolsOf << symbol.getName() << "," << counter << "\n";
+  }
+
+  symbolsOf << "<other>," << otherSymbolsEvents << std::endl;
+  fmt::print("Symbols with events: {} of {} (the events of the other symbols: {})\n", symbolsWithEvents,
+             symbolStats.size(), otherSymbolsEvents);
+  writeResult(fmt::format("bench--{}.json", startTimeString), startTimeString, endpoint, eventTypes, symbols,
+              connectionsNumber, useHeartbeat, intervals, totalEvents, seconds, latencies, sequenceCheck);
+  closed.wait();
+}
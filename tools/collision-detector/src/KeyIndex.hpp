@@ -0,0 +1,193 @@
+#pragma once
+
+#include <MappedFile.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dxf {
+
+// The persistent index of the snapshot keys of the symbols: the sorted symbols and the keys of the record types and the
+// sources of every symbol sorted by the key. The keys of the new symbols are looked up by the binary search, so the
+// index is updated without the computation of the keys of the known symbols.
+//
+// Format (native byte order):
+//   header:  "CDKI" (4 bytes), version (uint32), records (uint32), sources (uint32), symbols (uint64), entries (uint64)
+//   records: the record ids (uint32)
+//   sources: size (uint32), bytes
+//   symbols: the offsets of the symbols in the bytes (uint64, symbols + 1), the bytes
+//   entries: key (uint64), symbol (uint32), record (uint16), source (uint16)
+class KeyIndex final {
+ public:
+  static constexpr char MAGIC[4] = {'C', 'D', 'K', 'I'};
+  static constexpr std::uint32_t VERSION = 1;
+
+  struct Entry {
+    std::uint64_t key;
+    std::uint32_t symbol;
+    std::uint16_t record;
+    std::uint16_t source;
+  };
+
+  static_assert(sizeof(Entry) == 16);
+
+ private:
+  std::vector<std::uint32_t> records_{};
+  std::vector<std::string> sources_{};
+  std::vector<std::uint64_t> offsets_{0};
+  std::string symbols_{};
+  std::vector<Entry> entries_{};
+
+ public:
+  KeyIndex(std::vector<std::uint32_t> records, std::vector<std::string> sources)
+      : records_{std::move(records)}, sources_{std::move(sources)} {}
+
+  [[nodiscard]] const std::vector<std::uint32_t>& getRecords() const { return records_; }
+
+  [[nodiscard]] const std::vector<std::string>& getSources() const { return sources_; }
+
+  [[nodiscard]] std::size_t getSymbolsSize() const { return offsets_.size() - 1; }
+
+  [[nodiscard]] std::string_view getSymbol(std::size_t index) const {
+    return std::string_view(symbols_).substr(offsets_[index], offsets_[index + 1] - offsets_[index]);
+  }
+
+  // The entries sorted by the key
+  [[nodiscard]] const std::vector<Entry>& getEntries() const { return entries_; }
+
+  // The symbols must be added in the sorted order
+  void addSymbol(std::string_view symbol) {
+    symbols_ += symbol;
+    offsets_.push_back(symbols_.size());
+  }
+
+  // The entries must be sorted by the key
+  void setEntries(std::vector<Entry> entries) { entries_ = std::move(entries); }
+
+  // Returns std::nullopt if there is no file or the file is not an index of the supported version
+  static std::optional<KeyIndex> load(const std::string& path) {
+    auto file = MappedFile::open(path, false);
+
+    if (!file) {
+      return std::nullopt;
+    }
+
+    auto data = static_cast<const char*>(file->getData());
+    auto size = file->getSize();
+    std::size_t position = 0;
+    auto get = [&](void* value, std::size_t valueSize) {
+      if (size - position < valueSize) {
+        return false;
+      }
+
+      std::memcpy(value, data + position, valueSize);
+      position += valueSize;
+
+      return true;
+    };
+
+    char magic[sizeof(MAGIC)]{};
+    std::uint32_t version = 0;
+    std::uint32_t records = 0;
+    std::uint32_t sources = 0;
+    std::uint64_t symbols = 0;
+    std::uint64_t entries = 0;
+
+    if (!get(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(magic)) != 0 ||
+        !get(&version, sizeof(version)) || version != VERSION || !get(&records, sizeof(records)) ||
+        !get(&sources, sizeof(sources)) || !get(&symbols, sizeof(symbols)) || !get(&entries, sizeof(entries)) ||
+        records > size || sources > size || symbols > size || entries > size) {
+      return std::nullopt;
+    }
+
+    KeyIndex result{std::vector<std::uint32_t>(records), std::vector<std::string>(sources)};
+
+    if (!get(result.records_.data(), records * sizeof(std::uint32_t))) {
+      return std::nullopt;
+    }
+
+    for (auto& source : result.sources_) {
+      std::uint32_t sourceSize = 0;
+
+      if (!get(&sourceSize, sizeof(sourceSize)) || size - position < sourceSize) {
+        return std::nullopt;
+      }
+
+      source.assign(data + position, sourceSize);
+      position += sourceSize;
+    }
+
+    result.offsets_.resize(symbols + 1);
+
+    if (!get(result.offsets_.data(), (symbols + 1) * sizeof(std::uint64_t)) ||
+        !std::is_sorted(result.offsets_.begin(), result.offsets_.end()) || size - position < result.offsets_.back()) {
+      return std::nullopt;
+    }
+
+    result.symbols_.assign(data + position, result.offsets_.back());
+    position += result.offsets_.back();
+    result.entries_.resize(entries);
+
+    if (!get(result.entries_.data(), entries * sizeof(Entry)) ||
+        !std::all_of(result.entries_.begin(), result.entries_.end(), [&](const Entry& entry) {
+          return entry.symbol < symbols && entry.record < records && entry.source < sources;
+        })) {
+      return std::nullopt;
+    }
+
+    return result;
+  }
+
+  // Writes the index to the temporary file that replaces the file, so the index is never partially written. Returns
+  // false if the file can't be written.
+  [[nodiscard]] bool save(const std::string& path) const {
+    auto temporaryPath = path + ".tmp";
+    auto* f = std::fopen(temporaryPath.c_str(), "wb");
+
+    if (f == nullptr) {
+      return false;
+    }
+
+    auto put = [f](const void* value, std::size_t valueSize) {
+      return valueSize == 0 || std::fwrite(value, 1, valueSize, f) == valueSize;
+    };
+
+    auto records = static_cast<std::uint32_t>(records_.size());
+    auto sources = static_cast<std::uint32_t>(sources_.size());
+    auto symbols = static_cast<std::uint64_t>(getSymbolsSize());
+    auto entries = static_cast<std::uint64_t>(entries_.size());
+    auto isValid = put(MAGIC, sizeof(MAGIC)) && put(&VERSION, sizeof(VERSION)) && put(&records, sizeof(records)) &&
+                   put(&sources, sizeof(sources)) && put(&symbols, sizeof(symbols)) &&
+                   put(&entries, sizeof(entries)) && put(records_.data(), records * sizeof(std::uint32_t));
+
+    for (const auto& source : sources_) {
+      auto sourceSize = static_cast<std::uint32_t>(source.size());
+
+      isValid = isValid && put(&sourceSize, sizeof(sourceSize)) && put(source.data(), source.size());
+    }
+
+    isValid = isValid && put(offsets_.data(), offsets_.size() * sizeof(std::uint64_t)) &&
+              put(symbols_.data(), symbols_.size()) && put(entries_.data(), entries_.size() * sizeof(Entry));
+    isValid = std::fclose(f) == 0 && isValid;
+
+    if (!isValid) {
+      std::remove(temporaryPath.c_str());
+
+      return false;
+    }
+
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+  }
+};
+
+}  // namespace dxf
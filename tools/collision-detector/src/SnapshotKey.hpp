@@ -0,0 +1,45 @@
+#pragma once
+
+#include <DXFeed.h>
+#include <EventData.h>
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+// The copy of the snapshot key of the C API (the hash collisions of the keys are detected by the collision-detector,
+// the key is measured by the microbench)
+
+inline dxf_ulong_t dx_symbol_name_hasher(dxf_const_string_t symbol_name) {
+  return static_cast<dxf_ulong_t>(std::hash<std::wstring>{}(symbol_name));
+}
+
+// The same hash without the temporary wstring (the hashes of the string and of the string_view are equal)
+inline dxf_ulong_t dx_symbol_name_hasher(std::wstring_view symbol_name) {
+  return static_cast<dxf_ulong_t>(std::hash<std::wstring_view>{}(symbol_name));
+}
+
+#define SNAPSHOT_KEY_SOURCE_MASK 0xFFFFFFu
+
+// The layout of the key (the symbol hash is computed once for all the record ids and the sources of the symbol)
+inline dxf_ulong_t dx_snapshot_key_of_hashes(dx_record_info_id_t record_info_id, dxf_ulong_t symbol_hash,
+                                             dxf_ulong_t order_source_hash) {
+  return ((dxf_ulong_t)record_info_id << 56u) |
+    ((dxf_ulong_t)symbol_hash << 24u) |
+    (order_source_hash & SNAPSHOT_KEY_SOURCE_MASK);
+}
+
+inline dxf_ulong_t dx_new_snapshot_key(dx_record_info_id_t record_info_id, dxf_const_string_t symbol,
+                                       dxf_const_string_t order_source) {
+  dxf_ulong_t symbol_hash = dx_symbol_name_hasher(symbol);
+  dxf_ulong_t order_source_hash = (order_source == nullptr ? 0u : dx_symbol_name_hasher(order_source));
+  return dx_snapshot_key_of_hashes(record_info_id, symbol_hash, order_source_hash);
+}
+
+// The key of the symbol view (the not null-terminated symbol of the parsed IPF file)
+inline dxf_ulong_t dx_new_snapshot_key(dx_record_info_id_t record_info_id, std::wstring_view symbol,
+                                       dxf_const_string_t order_source) {
+  dxf_ulong_t symbol_hash = dx_symbol_name_hasher(symbol);
+  dxf_ulong_t order_source_hash = (order_source == nullptr ? 0u : dx_symbol_name_hasher(order_source));
+  return dx_snapshot_key_of_hashes(record_info_id, symbol_hash, order_source_hash);
+}
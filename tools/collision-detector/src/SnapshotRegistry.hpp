@@ -0,0 +1,165 @@
+#pragma once
+
+#include <DXFeed.h>
+#include <EventData.h>
+#include <SymbolTable.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dxf {
+
+// The registry of the snapshots keyed by the collision-free snapshot keys (the replacement of the hashed keys of the
+// snapshot registry of the C API, see SnapshotKey.hpp). The key is the record id (8 bits), the interned id of the
+// symbol (32 bits, see SymbolTable) and the id of the order source (24 bits), so two different books never share the
+// key. The snapshots are stored in the open-addressing table (the linear probing, the power of two capacity, the load
+// factor is at most 1/2), so the lookup is O(1). Not thread-safe (the registry of the C API is guarded by the caller).
+template <typename Snapshot>
+class SnapshotRegistry final {
+  static constexpr std::uint64_t EMPTY_KEY = ~std::uint64_t{0};
+  static constexpr std::uint32_t MAX_SOURCE_ID = 0xFFFFFFU;
+
+  struct Slot {
+    std::uint64_t key = EMPTY_KEY;
+    Snapshot* snapshot = nullptr;
+  };
+
+  std::unordered_map<std::wstring, std::uint32_t> sourceIds_{};
+  std::vector<Slot> slots_;
+  std::size_t size_ = 0;
+
+  // The Fibonacci hashing of the key (the ids are dense, so the low bits of the key are not spread)
+  [[nodiscard]] std::size_t indexOf(std::uint64_t key) const {
+    return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32U) & (slots_.size() - 1);
+  }
+
+  void grow() {
+    std::vector<Slot> slots(slots_.size() * 2);
+
+    slots_.swap(slots);
+
+    for (const auto& slot : slots) {
+      if (slot.key != EMPTY_KEY) {
+        auto index = indexOf(slot.key);
+
+        while (slots_[index].key != EMPTY_KEY) {
+          index = (index + 1) & (slots_.size() - 1);
+        }
+
+        slots_[index] = slot;
+      }
+    }
+  }
+
+ public:
+  explicit SnapshotRegistry(std::size_t initialCapacity = 64)
+      : slots_(std::bit_ceil(std::max<std::size_t>(initialCapacity, 2))) {}
+
+  // The id of the order source (0 - no source). Returns std::nullopt if there are too many sources.
+  std::optional<std::uint32_t> getSourceId(std::wstring_view source) {
+    if (source.empty()) {
+      return 0;
+    }
+
+    std::wstring wSource{source};
+
+    if (auto found = sourceIds_.find(wSource); found != sourceIds_.end()) {
+      return found->second;
+    }
+
+    if (sourceIds_.size() >= MAX_SOURCE_ID) {
+      return std::nullopt;
+    }
+
+    auto id = static_cast<std::uint32_t>(sourceIds_.size() + 1);
+
+    sourceIds_.emplace(std::move(wSource), id);
+
+    return id;
+  }
+
+  // The key of the interned symbol and of the order source (empty - no source). Returns std::nullopt if there are too
+  // many sources.
+  std::optional<std::uint64_t> getKey(dx_record_info_id_t recordId, const Symbol& symbol, std::wstring_view source) {
+    auto sourceId = getSourceId(source);
+
+    if (!sourceId) {
+      return std::nullopt;
+    }
+
+    return (static_cast<std::uint64_t>(recordId) << 56U) | (static_cast<std::uint64_t>(symbol.getId()) << 24U) |
+           *sourceId;
+  }
+
+  // Returns false if the key is already registered
+  bool add(std::uint64_t key, Snapshot* snapshot) {
+    if ((size_ + 1) * 2 > slots_.size()) {
+      grow();
+    }
+
+    auto index = indexOf(key);
+
+    for (; slots_[index].key != EMPTY_KEY; index = (index + 1) & (slots_.size() - 1)) {
+      if (slots_[index].key == key) {
+        return false;
+      }
+    }
+
+    slots_[index] = Slot{key, snapshot};
+    size_++;
+
+    return true;
+  }
+
+  // Returns nullptr if the key is not registered
+  [[nodiscard]] Snapshot* find(std::uint64_t key) const {
+    for (auto index = indexOf(key); slots_[index].key != EMPTY_KEY; index = (index + 1) & (slots_.size() - 1)) {
+      if (slots_[index].key == key) {
+        return slots_[index].snapshot;
+      }
+    }
+
+    return nullptr;
+  }
+
+  // Returns false if the key is not registered. The next slots of the probe sequence are shifted back (no tombstones).
+  bool remove(std::uint64_t key) {
+    auto mask = slots_.size() - 1;
+    auto index = indexOf(key);
+
+    for (; slots_[index].key != key; index = (index + 1) & mask) {
+      if (slots_[index].key == EMPTY_KEY) {
+        return false;
+      }
+    }
+
+    for (auto next = (index + 1) & mask; slots_[next].key != EMPTY_KEY; next = (next + 1) & mask) {
+      auto home = indexOf(slots_[next].key);
+
+      // The slot can be moved to the hole if its home is not in the (hole, next] cyclic range
+      if (((next - home) & mask) >= ((next - index) & mask)) {
+        slots_[index] = slots_[next];
+        index = next;
+      }
+    }
+
+    slots_[index] = Slot{};
+    size_--;
+
+    return true;
+  }
+
+  [[nodiscard]] std::size_t getSize() const { return size_; }
+
+  [[nodiscard]] std::size_t getCapacity() const { return slots_.size(); }
+};
+
+}  // namespace dxf
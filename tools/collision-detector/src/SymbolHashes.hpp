@@ -0,0 +1,342 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
+
+namespace dxf {
+
+// The candidate hash functions of the snapshot key symbols (the zero seed and the default secrets). The symbols of the
+// C API are wide strings, so the bytes of the wide string are hashed.
+namespace hashes {
+
+namespace detail {
+
+inline std::uint64_t read64(const std::uint8_t* p) {
+  std::uint64_t result{};
+
+  std::memcpy(&result, p, sizeof(result));
+
+  return result;
+}
+
+inline std::uint32_t read32(const std::uint8_t* p) {
+  std::uint32_t result{};
+
+  std::memcpy(&result, p, sizeof(result));
+
+  return result;
+}
+
+inline std::uint64_t rotl64(std::uint64_t value, unsigned bits) { return (value << bits) | (value >> (64U - bits)); }
+
+inline std::uint32_t swap32(std::uint32_t value) {
+  return ((value << 24U) & 0xFF000000U) | ((value << 8U) & 0x00FF0000U) | ((value >> 8U) & 0x0000FF00U) |
+         ((value >> 24U) & 0x000000FFU);
+}
+
+inline std::uint64_t swap64(std::uint64_t value) {
+  return (static_cast<std::uint64_t>(swap32(static_cast<std::uint32_t>(value))) << 32U) |
+         swap32(static_cast<std::uint32_t>(value >> 32U));
+}
+
+// The 128-bit product of the 64-bit values: the low and the high halves
+inline void multiply128(std::uint64_t a, std::uint64_t b, std::uint64_t& low, std::uint64_t& high) {
+#ifdef __SIZEOF_INT128__
+  auto product = static_cast<unsigned __int128>(a) * b;
+
+  low = static_cast<std::uint64_t>(product);
+  high = static_cast<std::uint64_t>(product >> 64U);
+#else
+  auto aLow = a & 0xFFFFFFFFU;
+  auto aHigh = a >> 32U;
+  auto bLow = b & 0xFFFFFFFFU;
+  auto bHigh = b >> 32U;
+  auto lowLow = aLow * bLow;
+  auto highLow = aHigh * bLow;
+  auto lowHigh = aLow * bHigh;
+  auto highHigh = aHigh * bHigh;
+  auto cross = (lowLow >> 32U) + (highLow & 0xFFFFFFFFU) + lowHigh;
+
+  low = (cross << 32U) | (lowLow & 0xFFFFFFFFU);
+  high = (highLow >> 32U) + (cross >> 32U) + highHigh;
+#endif
+}
+
+inline std::uint64_t multiplyFold64(std::uint64_t a, std::uint64_t b) {
+  std::uint64_t low{};
+  std::uint64_t high{};
+
+  multiply128(a, b, low, high);
+
+  return low ^ high;
+}
+
+}  // namespace detail
+
+// The current hash of the C API key (dx_symbol_name_hasher)
+inline std::uint64_t stdHash(std::wstring_view symbol) {
+  return static_cast<std::uint64_t>(std::hash<std::wstring_view>{}(symbol));
+}
+
+// The 64-bit FNV-1a
+inline std::uint64_t fnv1a(const void* data, std::size_t size) {
+  auto p = static_cast<const std::uint8_t*>(data);
+  std::uint64_t result = 0xCBF29CE484222325ULL;
+
+  for (std::size_t i = 0; i < size; i++) {
+    result = (result ^ p[i]) * 0x100000001B3ULL;
+  }
+
+  return result;
+}
+
+// The wyhash (the final version 4) with the default secret
+inline std::uint64_t wyhash(const void* data, std::size_t size) {
+  using namespace detail;
+
+  static constexpr std::uint64_t SECRET[4] = {0x2D358DCCAA6C78A5ULL, 0x8BB84B93962EACC9ULL, 0x4B33A62ED433D4A3ULL,
+                                              0x4D5A2DA51DE1AA47ULL};
+  auto mix = [](std::uint64_t a, std::uint64_t b) { return multiplyFold64(a, b); };
+  auto p = static_cast<const std::uint8_t*>(data);
+  auto seed = mix(SECRET[0], SECRET[1]);
+  std::uint64_t a = 0;
+  std::uint64_t b = 0;
+
+  if (size <= 16) {
+    if (size >= 4) {
+      auto shift = (size >> 3U) << 2U;
+
+      a = (static_cast<std::uint64_t>(read32(p)) << 32U) | read32(p + shift);
+      b = (static_cast<std::uint64_t>(read32(p + size - 4)) << 32U) | read32(p + size - 4 - shift);
+    } else if (size > 0) {
+      a = (static_cast<std::uint64_t>(p[0]) << 16U) | (static_cast<std::uint64_t>(p[size >> 1U]) << 8U) | p[size - 1];
+    }
+  } else {
+    auto i = size;
+
+    if (i > 48) {
+      auto see1 = seed;
+      auto see2 = seed;
+
+      do {
+        seed = mix(read64(p) ^ SECRET[1], read64(p + 8) ^ seed);
+        see1 = mix(read64(p + 16) ^ SECRET[2], read64(p + 24) ^ see1);
+        see2 = mix(read64(p + 32) ^ SECRET[3], read64(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+
+      seed ^= see1 ^ see2;
+    }
+
+    while (i > 16) {
+      seed = mix(read64(p) ^ SECRET[1], read64(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+
+    a = read64(p + i - 16);
+    b = read64(p + i - 8);
+  }
+
+  a ^= SECRET[1];
+  b ^= seed;
+  multiply128(a, b, a, b);
+
+  return mix(a ^ SECRET[0] ^ size, b ^ SECRET[1]);
+}
+
+// The 64-bit XXH3 with the default secret
+class Xxh3 {
+  static constexpr std::uint64_t PRIME32_1 = 0x9E3779B1U;
+  static constexpr std::uint64_t PRIME32_2 = 0x85EBCA77U;
+  static constexpr std::uint64_t PRIME32_3 = 0xC2B2AE3DU;
+  static constexpr std::uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+  static constexpr std::uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+  static constexpr std::uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+  static constexpr std::uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+  static constexpr std::uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+  static constexpr std::uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+  static constexpr std::uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+  static constexpr std::size_t STRIPE_SIZE = 64;
+  static constexpr std::size_t SECRET_SIZE = 192;
+  static constexpr std::size_t STRIPES_PER_BLOCK = (SECRET_SIZE - STRIPE_SIZE) / 8;
+  static constexpr std::size_t BLOCK_SIZE = STRIPE_SIZE * STRIPES_PER_BLOCK;
+
+  static constexpr std::array<std::uint8_t, SECRET_SIZE> SECRET = {
+      0xB8, 0xFE, 0x6C, 0x39, 0x23, 0xA4, 0x4B, 0xBE, 0x7C, 0x01, 0x81, 0x2C, 0xF7, 0x21, 0xAD, 0x1C, 0xDE, 0xD4, 0x6D,
+      0xE9, 0x83, 0x90, 0x97, 0xDB, 0x72, 0x40, 0xA4, 0xA4, 0xB7, 0xB3, 0x67, 0x1F, 0xCB, 0x79, 0xE6, 0x4E, 0xCC, 0xC0,
+      0xE5, 0x78, 0x82, 0x5A, 0xD0, 0x7D, 0xCC, 0xFF, 0x72, 0x21, 0xB8, 0x08, 0x46, 0x74, 0xF7, 0x43, 0x24, 0x8E, 0xE0,
+      0x35, 0x90, 0xE6, 0x81, 0x3A, 0x26, 0x4C, 0x3C, 0x28, 0x52, 0xBB, 0x91, 0xC3, 0x00, 0xCB, 0x88, 0xD0, 0x65, 0x8B,
+      0x1B, 0x53, 0x2E, 0xA3, 0x71, 0x64, 0x48, 0x97, 0xA2, 0x0D, 0xF9, 0x4E, 0x38, 0x19, 0xEF, 0x46, 0xA9, 0xDE, 0xAC,
+      0xD8, 0xA8, 0xFA, 0x76, 0x3F, 0xE3, 0x9C, 0x34, 0x3F, 0xF9, 0xDC, 0xBB, 0xC7, 0xC7, 0x0B, 0x4F, 0x1D, 0x8A, 0x51,
+      0xE0, 0x4B, 0xCD, 0xB4, 0x59, 0x31, 0xC8, 0x9F, 0x7E, 0xC9, 0xD9, 0x78, 0x73, 0x64, 0xEA, 0xC5, 0xAC, 0x83, 0x34,
+      0xD3, 0xEB, 0xC3, 0xC5, 0x81, 0xA0, 0xFF, 0xFA, 0x13, 0x63, 0xEB, 0x17, 0x0D, 0xDD, 0x51, 0xB7, 0xF0, 0xDA, 0x49,
+      0xD3, 0x16, 0x55, 0x26, 0x29, 0xD4, 0x68, 0x9E, 0x2B, 0x16, 0xBE, 0x58, 0x7D, 0x47, 0xA1, 0xFC, 0x8F, 0xF8, 0xB8,
+      0xD1, 0x7A, 0xD0, 0x31, 0xCE, 0x45, 0xCB, 0x3A, 0x8F, 0x95, 0x16, 0x04, 0x28, 0xAF, 0xD7, 0xFB, 0xCA, 0xBB, 0x4B,
+      0x40, 0x7E};
+
+  static const std::uint8_t* secret(std::size_t offset) { return SECRET.data() + offset; }
+
+  static std::uint64_t avalanche64(std::uint64_t h) {
+    h ^= h >> 33U;
+    h *= PRIME64_2;
+    h ^= h >> 29U;
+    h *= PRIME64_3;
+
+    return h ^ (h >> 32U);
+  }
+
+  static std::uint64_t avalanche(std::uint64_t h) {
+    h ^= h >> 37U;
+    h *= PRIME_MX1;
+
+    return h ^ (h >> 32U);
+  }
+
+  static std::uint64_t rrmxmx(std::uint64_t h, std::uint64_t size) {
+    h ^= detail::rotl64(h, 49) ^ detail::rotl64(h, 24);
+    h *= PRIME_MX2;
+    h ^= (h >> 35U) + size;
+    h *= PRIME_MX2;
+
+    return h ^ (h >> 28U);
+  }
+
+  static std::uint64_t mix16(const std::uint8_t* p, const std::uint8_t* s) {
+    return detail::multiplyFold64(detail::read64(p) ^ detail::read64(s), detail::read64(p + 8) ^ detail::read64(s + 8));
+  }
+
+  static void accumulateStripe(std::array<std::uint64_t, 8>& acc, const std::uint8_t* p, const std::uint8_t* s) {
+    for (std::size_t i = 0; i < 8; i++) {
+      auto value = detail::read64(p + 8 * i);
+      auto key = value ^ detail::read64(s + 8 * i);
+
+      acc[i ^ 1U] += value;
+      acc[i] += (key & 0xFFFFFFFFU) * (key >> 32U);
+    }
+  }
+
+  static void scramble(std::array<std::uint64_t, 8>& acc, const std::uint8_t* s) {
+    for (std::size_t i = 0; i < 8; i++) {
+      acc[i] = (acc[i] ^ (acc[i] >> 47U) ^ detail::read64(s + 8 * i)) * PRIME32_1;
+    }
+  }
+
+  static std::uint64_t hashLong(const std::uint8_t* p, std::size_t size) {
+    std::array<std::uint64_t, 8> acc = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+                                        PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+    auto blocks = (size - 1) / BLOCK_SIZE;
+
+    for (std::size_t block = 0; block < blocks; block++) {
+      for (std::size_t stripe = 0; stripe < STRIPES_PER_BLOCK; stripe++) {
+        accumulateStripe(acc, p + block * BLOCK_SIZE + stripe * STRIPE_SIZE, secret(stripe * 8));
+      }
+
+      scramble(acc, secret(SECRET_SIZE - STRIPE_SIZE));
+    }
+
+    auto stripes = ((size - 1) - blocks * BLOCK_SIZE) / STRIPE_SIZE;
+
+    for (std::size_t stripe = 0; stripe < stripes; stripe++) {
+      accumulateStripe(acc, p + blocks * BLOCK_SIZE + stripe * STRIPE_SIZE, secret(stripe * 8));
+    }
+
+    // The last stripe
+    accumulateStripe(acc, p + size - STRIPE_SIZE, secret(SECRET_SIZE - STRIPE_SIZE - 7));
+
+    auto result = size * PRIME64_1;
+
+    for (std::size_t i = 0; i < 4; i++) {
+      result += detail::multiplyFold64(acc[2 * i] ^ detail::read64(secret(11 + 16 * i)),
+                                       acc[2 * i + 1] ^ detail::read64(secret(11 + 16 * i + 8)));
+    }
+
+    return avalanche(result);
+  }
+
+ public:
+  static std::uint64_t hash(const void* data, std::size_t size) {
+    using namespace detail;
+
+    auto p = static_cast<const std::uint8_t*>(data);
+
+    if (size == 0) {
+      return avalanche64(read64(secret(56)) ^ read64(secret(64)));
+    }
+
+    if (size <= 3) {
+      auto combined = (static_cast<std::uint32_t>(p[0]) << 16U) | (static_cast<std::uint32_t>(p[size >> 1U]) << 24U) |
+                      p[size - 1] | (static_cast<std::uint32_t>(size) << 8U);
+
+      return avalanche64(combined ^ static_cast<std::uint64_t>(read32(secret(0)) ^ read32(secret(4))));
+    }
+
+    if (size <= 8) {
+      auto value = read32(p + size - 4) + (static_cast<std::uint64_t>(read32(p)) << 32U);
+
+      return rrmxmx(value ^ (read64(secret(8)) ^ read64(secret(16))), size);
+    }
+
+    if (size <= 16) {
+      auto low = read64(p) ^ (read64(secret(24)) ^ read64(secret(32)));
+      auto high = read64(p + size - 8) ^ (read64(secret(40)) ^ read64(secret(48)));
+
+      return avalanche(size + swap64(low) + high + multiplyFold64(low, high));
+    }
+
+    if (size <= 128) {
+      auto result = size * PRIME64_1;
+
+      if (size > 32) {
+        if (size > 64) {
+          if (size > 96) {
+            result += mix16(p + 48, secret(96));
+            result += mix16(p + size - 64, secret(112));
+          }
+
+          result += mix16(p + 32, secret(64));
+          result += mix16(p + size - 48, secret(80));
+        }
+
+        result += mix16(p + 16, secret(32));
+        result += mix16(p + size - 32, secret(48));
+      }
+
+      result += mix16(p, secret(0));
+      result += mix16(p + size - 16, secret(16));
+
+      return avalanche(result);
+    }
+
+    if (size <= 240) {
+      auto result = size * PRIME64_1;
+
+      for (std::size_t i = 0; i < 8; i++) {
+        result += mix16(p + 16 * i, secret(16 * i));
+      }
+
+      result = avalanche(result);
+
+      for (std::size_t i = 8; i < size / 16; i++) {
+        result += mix16(p + 16 * i, secret(16 * (i - 8) + 3));
+      }
+
+      // The minimal secret size (136) minus 17
+      result += mix16(p + size - 16, secret(136 - 17));
+
+      return avalanche(result);
+    }
+
+    return hashLong(p, size);
+  }
+};
+
+inline std::uint64_t xxh3(const void* data, std::size_t size) { return Xxh3::hash(data, size); }
+
+}  // namespace hashes
+
+}  // namespace dxf
@@ -2,91 +2,902 @@
 #include <EventData.h>
 #include <fmt/chrono.h>
 #include <fmt/format.h>
+#include <IpfSymbolUniverse.hpp>
+#include <MappedFile.hpp>
 #include <StringConverter.hpp>
+#include <SymbolPerfectHash.hpp>
 
-#include <atomic>
+#include "KeyIndex.hpp"
+#include "SnapshotKey.hpp"
+#include "SnapshotRegistry.hpp"
+#include "SymbolHashes.hpp"
+
+#include <algorithm>
+#include <bit>
 #include <chrono>
-#include <codecvt>
-#include <future>
+#include <cmath>
+#include <cstdint>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
 #include <iostream>
-#include <limits>
-#include <locale>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <thread>
-#include <unordered_map>
 #include <utility>
 #include <vector>
-#include <fstream>
 
-dxf_ulong_t dx_symbol_name_hasher(dxf_const_string_t symbol_name) {
-  return static_cast<dxf_ulong_t>(std::hash<std::wstring>{}(symbol_name));
+// Returns the line after the position (the end of the data if there is no next line)
+inline const char* skipLine(const char* begin, const char* end) {
+  auto newline = static_cast<const char*>(std::memchr(begin, '\n', static_cast<std::size_t>(end - begin)));
+
+  return newline == nullptr ? end : newline + 1;
 }
 
-#define SNAPSHOT_KEY_SOURCE_MASK 0xFFFFFFu
+// Splits the data into the line-aligned chunks: every chunk (except the first one) begins after the newline. Returns
+// the bounds of the chunks (the number of the chunks + 1).
+std::vector<const char*> splitLines(const char* data, std::size_t size, std::size_t numberOfChunks) {
+  std::vector<const char*> result{data};
+
+  for (std::size_t i = 1; i < numberOfChunks; i++) {
+    auto bound = std::max(result.back(), data + size * i / numberOfChunks);
+
+    result.push_back(bound == data ? data : skipLine(bound - 1, data + size));
+  }
+
+  result.push_back(data + size);
 
-dxf_ulong_t dx_new_snapshot_key(dx_record_info_id_t record_info_id, dxf_const_string_t symbol,
-                                dxf_const_string_t order_source) {
-  dxf_ulong_t symbol_hash = dx_symbol_name_hasher(symbol);
-  dxf_ulong_t order_source_hash = (order_source == nullptr ? 0u : dx_symbol_name_hasher(order_source));
-  return ((dxf_ulong_t)record_info_id << 56u) |
-    ((dxf_ulong_t)symbol_hash << 24u) |
-    (order_source_hash & SNAPSHOT_KEY_SOURCE_MASK);
+  return result;
 }
 
-int main(int argc, char *argv[]) {
-  if (argc < 2) {
-    std::cout << "Usage:\n  collision-detector <ipf-file-path>\n\n";
+// Runs the function for every chunk on its own thread
+template <typename F>
+void forEachChunk(const std::vector<const char*>& bounds, F&& f) {
+  std::vector<std::thread> threads{};
 
-    return 0;
+  for (std::size_t i = 0; i + 1 < bounds.size(); i++) {
+    threads.emplace_back([&f, &bounds, i] { f(i, bounds[i], bounds[i + 1]); });
   }
 
-  std::string ipfFile = argv[1];
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
 
-  std::unordered_map<dxf_ulong_t, std::vector<std::string>> stats{};
+// Runs the function for the equal parts [begin, end) of the [0, size) on the threads
+template <typename F>
+void forEachRange(std::size_t size, std::size_t numberOfThreads, F&& f) {
+  std::vector<std::thread> threads{};
 
-  std::ifstream f{ipfFile};
+  for (std::size_t i = 0; i < numberOfThreads; i++) {
+    threads.emplace_back([&f, i, begin = size * i / numberOfThreads, end = size * (i + 1) / numberOfThreads] {
+      f(i, begin, end);
+    });
+  }
 
-  auto counter = 0ULL;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
 
-  for (std::string line; std::getline(f, line); ) {
-    if (line.empty() || line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+// Sorts the parts of the values on the threads, then merges the sorted parts by pairs (the pairs of the same level are
+// merged in parallel)
+void parallelSort(std::vector<std::uint64_t>& values, std::size_t numberOfThreads) {
+  std::vector<std::size_t> runs{0};
 
-    auto found = line.find_first_of(',');
+  forEachRange(values.size(), numberOfThreads, [&values](std::size_t, std::size_t begin, std::size_t end) {
+    std::sort(values.begin() + static_cast<std::ptrdiff_t>(begin), values.begin() + static_cast<std::ptrdiff_t>(end));
+  });
 
-    if (found == std::string::npos) continue;
+  for (std::size_t i = 1; i <= numberOfThreads; i++) {
+    runs.push_back(values.size() * i / numberOfThreads);
+  }
 
-    auto start = found + 1;
+  while (runs.size() > 2) {
+    std::vector<std::size_t> merged{0};
+    std::vector<std::thread> threads{};
 
-    if (start == line.size()) continue;
+    for (std::size_t i = 2; i < runs.size(); i += 2) {
+      threads.emplace_back([&values, first = runs[i - 2], middle = runs[i - 1], last = runs[i]] {
+        std::inplace_merge(values.begin() + static_cast<std::ptrdiff_t>(first),
+                           values.begin() + static_cast<std::ptrdiff_t>(middle),
+                           values.begin() + static_cast<std::ptrdiff_t>(last));
+      });
+      merged.push_back(runs[i]);
+    }
 
-    found = line.find_first_of(",\n\r", start);
+    for (auto& thread : threads) {
+      thread.join();
+    }
 
-    auto end = (found == std::string::npos) ? line.size() - 1 : found - 1;
+    if (runs.size() % 2 == 0) {
+      merged.push_back(runs.back());
+    }
 
-    counter++;
-    auto symbol = line.substr(start, end - start + 1);
-    auto wSymbol = dxf::StringConverter::utf8ToWString(symbol);
-    auto key = dx_new_snapshot_key(dx_rid_candle, wSymbol.c_str(), nullptr);
+    runs = std::move(merged);
+  }
+}
+
+// The number of the colliding values and the pairs of the equal values of the sorted values
+std::pair<std::size_t, std::size_t> countCollisions(const std::vector<std::uint64_t>& sortedValues) {
+  std::size_t values = 0;
+  std::size_t pairs = 0;
+
+  for (std::size_t i = 0; i < sortedValues.size();) {
+    auto next = i + 1;
+
+    while (next < sortedValues.size() && sortedValues[next] == sortedValues[i]) {
+      next++;
+    }
+
+    if (auto run = next - i; run > 1) {
+      values += run;
+      pairs += run * (run - 1) / 2;
+    }
+
+    i = next;
+  }
+
+  return {values, pairs};
+}
+
+// The symbols of the file (in the order of the file)
+std::vector<std::string_view> collectSymbols(const std::vector<const char*>& bounds) {
+  std::vector<std::vector<std::string_view>> tables(bounds.size() - 1);
+
+  forEachChunk(bounds, [&tables](std::size_t i, const char* begin, const char* end) {
+    dxf::IpfSymbolUniverse::forEachSymbol(std::string_view(begin, static_cast<std::size_t>(end - begin)),
+                                          [&table = tables[i]](std::string_view symbol) { table.push_back(symbol); });
+  });
+
+  std::vector<std::string_view> result{};
+
+  for (const auto& table : tables) {
+    result.insert(result.end(), table.begin(), table.end());
+  }
+
+  return result;
+}
 
-    if (stats.contains(key)) {
-      stats[key].emplace_back(symbol);
+// The distinct symbols (sorted)
+std::vector<std::string_view> getDistinctSymbols(std::vector<std::string_view> symbols) {
+  auto result = std::move(symbols);
+
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+
+  return result;
+}
+
+// Reads the lines of the input by the blocks on the calling thread and parses the blocks on the threads, so the
+// reading (and the decompression of the input command) and the parsing overlap. The symbols of every block are copied
+// to the arena of the block, so only the symbols of the input are kept in memory. Returns false if the input can't be
+// read.
+bool streamSymbols(std::FILE* input, std::size_t numberOfThreads, std::vector<std::string>& arenas,
+                   std::vector<std::string_view>& symbols) {
+  static constexpr std::size_t BLOCK_SIZE = 4 << 20;
+
+  struct Block {
+    std::size_t index;
+    std::string data;
+  };
+
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  std::deque<Block> blocks{};
+  bool isFinished = false;
+  // The arenas and the symbol ranges (the offset and the size in the arena) of the blocks
+  std::vector<std::vector<std::pair<std::size_t, std::size_t>>> ranges{};
+  std::vector<std::thread> threads{};
+
+  for (std::size_t i = 0; i < numberOfThreads; i++) {
+    threads.emplace_back([&] {
+      while (true) {
+        std::unique_lock<std::mutex> lk(mutex);
+
+        cv.wait(lk, [&] { return !blocks.empty() || isFinished; });
+
+        if (blocks.empty()) {
+          return;
+        }
+
+        auto block = std::move(blocks.front());
+
+        blocks.pop_front();
+        lk.unlock();
+        cv.notify_all();
+
+        std::string arena{};
+        std::vector<std::pair<std::size_t, std::size_t>> blockRanges{};
+
+        dxf::IpfSymbolUniverse::forEachSymbol(block.data, [&](std::string_view symbol) {
+          blockRanges.emplace_back(arena.size(), symbol.size());
+          arena += symbol;
+        });
+
+        lk.lock();
+
+        if (arenas.size() <= block.index) {
+          arenas.resize(block.index + 1);
+          ranges.resize(block.index + 1);
+        }
+
+        arenas[block.index] = std::move(arena);
+        ranges[block.index] = std::move(blockRanges);
+      }
+    });
+  }
+
+  std::string carry{};
+  bool isValid = true;
+
+  for (std::size_t index = 0;; index++) {
+    auto data = std::move(carry);
+    auto size = data.size();
+
+    carry.clear();
+    data.resize(size + BLOCK_SIZE);
+
+    auto read = std::fread(data.data() + size, 1, BLOCK_SIZE, input);
+
+    data.resize(size + read);
+
+    if (read == 0) {
+      isValid = std::ferror(input) == 0;
+    } else if (auto newline = data.rfind('\n'); newline == std::string::npos) {
+      // The line is longer than the block
+      carry = std::move(data);
+      index--;
+
+      continue;
     } else {
-      stats[key] = {symbol};
+      carry.assign(data, newline + 1);
+      data.resize(newline + 1);
+    }
+
+    if (!data.empty()) {
+      std::unique_lock<std::mutex> lk(mutex);
+
+      // The number of the blocks in memory is limited
+      cv.wait(lk, [&] { return blocks.size() < 2 * numberOfThreads; });
+      blocks.push_back(Block{index, std::move(data)});
+      lk.unlock();
+      cv.notify_all();
+    }
+
+    if (read == 0) {
+      break;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(mutex);
+
+    isFinished = true;
+  }
+
+  cv.notify_all();
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (std::size_t i = 0; i < arenas.size(); i++) {
+    for (auto [offset, size] : ranges[i]) {
+      symbols.emplace_back(arenas[i].data() + offset, size);
     }
   }
 
-  std::cout << counter << "\n\n";
+  return isValid;
+}
+
+// Quotes the argument of the shell command
+std::string quote(std::string_view argument) {
+#ifdef _WIN32
+  return "\"" + std::string(argument) + "\"";
+#else
+  std::string result = "'";
+
+  for (auto c : argument) {
+    result += c == '\'' ? std::string("'\\''") : std::string(1, c);
+  }
+
+  return result + "'";
+#endif
+}
+
+// The command that writes the uncompressed input to the stdout: the HTTP(S) URL is fetched by the curl, the gzip and
+// the zstd inputs (by the compression or by the extension) are decompressed by the gzip and the zstd. The stdin ("-")
+// is inherited by the command. Returns the empty command if the input is the plain file.
+std::string getInputCommand(const std::string& input, std::string_view compression) {
+  auto isUrl = input.starts_with("http://") || input.starts_with("https://");
+  auto isStdin = input == "-";
+
+  if (compression.empty()) {
+    compression = input.ends_with(".gz") ? "gzip" : input.ends_with(".zst") ? "zstd" : "none";
+  }
+
+  auto decompressor = compression == "gzip" ? std::string("gzip -dc") : compression == "zstd" ? "zstd -dc" : "";
+
+  if (isUrl) {
+    return "curl -sSfL " + quote(input) + (decompressor.empty() ? "" : " | " + decompressor);
+  }
+
+  if (isStdin) {
+    return decompressor.empty() ? "" : decompressor;
+  }
+
+  return decompressor.empty() ? "" : decompressor + " " + quote(input);
+}
 
-  for (auto [k, v] : stats) {
-    if (v.size() > 1) {
-      std::cout << k << ":\n  ";
+// The record types of the snapshots
+struct RecordType {
+  std::string_view name;
+  dx_record_info_id_t id;
+};
+
+static constexpr RecordType RECORD_TYPES[] = {
+    {"Trade", dx_rid_trade},
+    {"Quote", dx_rid_quote},
+    {"Summary", dx_rid_summary},
+    {"Profile", dx_rid_profile},
+    {"MarketMaker", dx_rid_market_maker},
+    {"Order", dx_rid_order},
+    {"TimeAndSale", dx_rid_time_and_sale},
+    {"Candle", dx_rid_candle},
+    {"SpreadOrder", dx_rid_spread_order},
+    {"Greeks", dx_rid_greeks},
+    {"Series", dx_rid_series},
+};
+
+// Splits the comma-separated list (the empty list has one empty item)
+std::vector<std::string> splitList(std::string_view list) {
+  std::vector<std::string> result{};
+
+  for (std::size_t begin = 0;;) {
+    auto end = list.find(',', begin);
+
+    result.emplace_back(list.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin));
+
+    if (end == std::string_view::npos) {
+      return result;
+    }
+
+    begin = end + 1;
+  }
+}
+
+// Detects the collisions of the keys of the cartesian product of the record types, the sources (the empty source is
+// the nullptr) and the symbols. The keys are built and sorted in parallel, the duplicates are the runs of
+// the equal keys of the sorted keys (8 bytes per key), then the members of the colliding keys are found by the second
+// pass over the product. Prints the number of the keys and the colliding keys with their members.
+void detectCollisions(const std::vector<std::string_view>& symbols, const std::vector<RecordType>& records,
+                      const std::vector<std::string>& sources, std::size_t numberOfThreads) {
+  auto n = symbols.size();
+  std::vector<dxf_ulong_t> symbolHashes(n);
+  std::vector<dxf_ulong_t> sourceHashes{};
+
+  forEachRange(n, numberOfThreads, [&symbols, &symbolHashes](std::size_t, std::size_t begin, std::size_t end) {
+    for (auto i = begin; i < end; i++) {
+      symbolHashes[i] = dx_symbol_name_hasher(dxf::StringConverter::utf8ToWStringView(symbols[i]));
+    }
+  });
+
+  for (const auto& source : sources) {
+    sourceHashes.push_back(
+        source.empty() ? 0 : dx_symbol_name_hasher(std::wstring_view(dxf::StringConverter::utf8ToWString(source))));
+  }
+
+  // The index of the product is (record * sources + source) * symbols + symbol
+  auto keyOf = [&](std::size_t index) {
+    auto combination = index / n;
+
+    return dx_snapshot_key_of_hashes(records[combination / sources.size()].id, symbolHashes[index % n],
+                                     sourceHashes[combination % sources.size()]);
+  };
+  auto size = n * records.size() * sources.size();
+  std::vector<std::uint64_t> keys(size);
+
+  forEachRange(size, numberOfThreads, [&keys, &keyOf](std::size_t, std::size_t begin, std::size_t end) {
+    for (auto i = begin; i < end; i++) {
+      keys[i] = keyOf(i);
+    }
+  });
 
-      for (const auto& s : v) {
-        std::cout << s << ",";
+  parallelSort(keys, numberOfThreads);
+
+  std::vector<std::uint64_t> collidingKeys{};
+
+  for (std::size_t i = 1; i < keys.size(); i++) {
+    if (keys[i] == keys[i - 1] && (collidingKeys.empty() || collidingKeys.back() != keys[i])) {
+      collidingKeys.push_back(keys[i]);
+    }
+  }
+
+  std::vector<std::uint64_t>{}.swap(keys);
+
+  // The members of the colliding keys in the order of the product
+  std::vector<std::vector<std::pair<std::uint64_t, std::size_t>>> tables(numberOfThreads);
+
+  forEachRange(size, numberOfThreads, [&](std::size_t thread, std::size_t begin, std::size_t end) {
+    for (auto i = begin; i < end; i++) {
+      if (auto key = keyOf(i); std::binary_search(collidingKeys.begin(), collidingKeys.end(), key)) {
+        tables[thread].emplace_back(key, i);
       }
+    }
+  });
+
+  std::vector<std::pair<std::uint64_t, std::size_t>> members{};
+
+  for (const auto& table : tables) {
+    members.insert(members.end(), table.begin(), table.end());
+  }
+
+  std::stable_sort(members.begin(), members.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+  auto isProduct = records.size() > 1 || sources.size() > 1;
+
+  std::cout << size << "\n\n";
+
+  for (std::size_t i = 0; i < members.size(); i++) {
+    if (i == 0 || members[i].first != members[i - 1].first) {
+      std::cout << (i == 0 ? "" : "\n") << members[i].first << ":\n  ";
+    }
+
+    auto [key, index] = members[i];
+    auto combination = index / n;
+
+    // The record and the source are printed only if there are several of them: <record>/<source>/<symbol>
+    if (isProduct) {
+      std::cout << records[combination / sources.size()].name << "/" << sources[combination % sources.size()] << "/";
+    }
+
+    std::cout << symbols[index % n] << ",";
+  }
+
+  if (!members.empty()) {
+    std::cout << "\n";
+  }
+}
+
+// Checks the keys of the new symbols against the persistent key index (see KeyIndex) and updates the index: the keys
+// of the removed symbols are removed and the keys of the new symbols are added, so only the keys of the new symbols are
+// computed. The index of the other record types or sources is rebuilt. Prints the numbers of the symbols and the keys
+// of the new symbols that collide with the other keys. Returns false if the index can't be written.
+bool updateKeyIndex(const std::vector<std::string_view>& allSymbols, const std::vector<RecordType>& records,
+                    const std::vector<std::string>& sources, const std::string& path) {
+  static constexpr auto REMOVED = ~std::uint32_t{0};
+
+  auto start = std::chrono::steady_clock::now();
+  auto symbols = getDistinctSymbols(allSymbols);
+  std::vector<std::uint32_t> recordIds{};
+
+  for (const auto& record : records) {
+    recordIds.push_back(static_cast<std::uint32_t>(record.id));
+  }
+
+  auto old = dxf::KeyIndex::load(path);
+
+  if (old && (old->getRecords() != recordIds || old->getSources() != sources)) {
+    std::cout << "The index of the other record types or sources is rebuilt\n";
+    old.reset();
+  }
+
+  auto oldSize = old ? old->getSymbolsSize() : 0;
+  dxf::KeyIndex index{recordIds, sources};
+  // The new indexes of the symbols of the old index (or REMOVED)
+  std::vector<std::uint32_t> newIndexes(oldSize, REMOVED);
+  std::vector<std::uint32_t> addedSymbols{};
 
-      std::cout << "\n";
+  // Both symbol lists are sorted
+  for (std::size_t i = 0, j = 0; i < symbols.size(); i++) {
+    index.addSymbol(symbols[i]);
+
+    while (j < oldSize && old->getSymbol(j) < symbols[i]) {
+      j++;
+    }
+
+    if (j < oldSize && old->getSymbol(j) == symbols[i]) {
+      newIndexes[j++] = static_cast<std::uint32_t>(i);
+    } else {
+      addedSymbols.push_back(static_cast<std::uint32_t>(i));
     }
   }
-}
\ No newline at end of file
+
+  std::vector<dxf::KeyIndex::Entry> keptEntries{};
+  std::vector<dxf::KeyIndex::Entry> addedEntries{};
+  std::vector<dxf_ulong_t> sourceHashes{};
+
+  if (old) {
+    for (const auto& entry : old->getEntries()) {
+      if (newIndexes[entry.symbol] != REMOVED) {
+        keptEntries.push_back(dxf::KeyIndex::Entry{entry.key, newIndexes[entry.symbol], entry.record, entry.source});
+      }
+    }
+  }
+
+  for (const auto& source : sources) {
+    sourceHashes.push_back(
+        source.empty() ? 0 : dx_symbol_name_hasher(std::wstring_view(dxf::StringConverter::utf8ToWString(source))));
+  }
+
+  for (auto symbol : addedSymbols) {
+    auto symbolHash = dx_symbol_name_hasher(dxf::StringConverter::utf8ToWStringView(symbols[symbol]));
+
+    for (std::size_t record = 0; record < records.size(); record++) {
+      for (std::size_t source = 0; source < sources.size(); source++) {
+        addedEntries.push_back(dxf::KeyIndex::Entry{
+            dx_snapshot_key_of_hashes(records[record].id, symbolHash, sourceHashes[source]), symbol,
+            static_cast<std::uint16_t>(record), static_cast<std::uint16_t>(source)});
+      }
+    }
+  }
+
+  auto byKey = [](const dxf::KeyIndex::Entry& a, const dxf::KeyIndex::Entry& b) { return a.key < b.key; };
+
+  std::stable_sort(addedEntries.begin(), addedEntries.end(), byKey);
+
+  // The keys of the new symbols that are the keys of the kept symbols or of the other new symbols
+  std::vector<std::uint64_t> collidingKeys{};
+
+  for (std::size_t i = 0; i < addedEntries.size(); i++) {
+    auto key = addedEntries[i].key;
+
+    if (!collidingKeys.empty() && collidingKeys.back() == key) {
+      continue;
+    }
+
+    if ((i + 1 < addedEntries.size() && addedEntries[i + 1].key == key) ||
+        std::binary_search(keptEntries.begin(), keptEntries.end(), addedEntries[i], byKey)) {
+      collidingKeys.push_back(key);
+    }
+  }
+
+  std::vector<dxf::KeyIndex::Entry> entries(keptEntries.size() + addedEntries.size());
+
+  std::merge(keptEntries.begin(), keptEntries.end(), addedEntries.begin(), addedEntries.end(), entries.begin(), byKey);
+
+  auto milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  fmt::print("symbols: {} (added {}, removed {}), keys: {}, new colliding keys: {}, time: {:.1f} ms\n\n",
+             symbols.size(), addedSymbols.size(), oldSize - (symbols.size() - addedSymbols.size()), entries.size(),
+             collidingKeys.size(), milliseconds);
+
+  for (auto key : collidingKeys) {
+    auto [first, last] = std::equal_range(entries.begin(), entries.end(), dxf::KeyIndex::Entry{key, 0, 0, 0}, byKey);
+
+    std::cout << key << ":\n  ";
+
+    for (auto entry = first; entry != last; ++entry) {
+      std::cout << records[entry->record].name << "/" << sources[entry->source] << "/" << symbols[entry->symbol] << ",";
+    }
+
+    std::cout << "\n";
+  }
+
+  index.setEntries(std::move(entries));
+
+  if (!index.save(path)) {
+    std::cerr << "Can't write the index: " << path << "\n";
+
+    return false;
+  }
+
+  return true;
+}
+
+// Evaluates the candidate hashes of the snapshot key over the distinct symbols of the file: the collisions of the key
+// (the hash in the key layout of the C API) and of the full 64-bit hash, the expected number of the colliding pairs of
+// the key bits and the hashing throughput.
+void compareHashes(const std::vector<std::string_view>& allSymbols) {
+  auto symbols = getDistinctSymbols(allSymbols);
+
+  // The wide symbols are stored contiguously, so the throughput is not the throughput of the allocator
+  std::vector<wchar_t> buffer{};
+  std::vector<std::size_t> offsets{0};
+
+  for (auto symbol : symbols) {
+    auto wSymbol = dxf::StringConverter::utf8ToWStringView(symbol);
+
+    buffer.insert(buffer.end(), wSymbol.begin(), wSymbol.end());
+    offsets.push_back(buffer.size());
+  }
+
+  std::vector<std::wstring_view> wSymbols{};
+
+  for (std::size_t i = 0; i < symbols.size(); i++) {
+    wSymbols.emplace_back(buffer.data() + offsets[i], offsets[i + 1] - offsets[i]);
+  }
+
+  // The hash bits 40..63 are shifted out of the key and the bits 32..39 are ORed with the record id
+  auto recordId = static_cast<dxf_ulong_t>(dx_rid_candle);
+  auto keyBits = 40 - std::popcount(recordId & 0xFFU);
+  auto n = static_cast<double>(wSymbols.size());
+  auto expectedPairs = n * std::max(n - 1, 0.0) / 2 / std::ldexp(1.0, keyBits);
+  auto bytes = static_cast<double>(buffer.size() * sizeof(wchar_t));
+
+  struct Candidate {
+    std::string_view name;
+    std::uint64_t (*hash)(std::wstring_view);
+  };
+
+  static constexpr Candidate CANDIDATES[] = {
+      {"std::hash", dxf::hashes::stdHash},
+      {"FNV-1a", [](std::wstring_view s) { return dxf::hashes::fnv1a(s.data(), s.size() * sizeof(wchar_t)); }},
+      {"wyhash", [](std::wstring_view s) { return dxf::hashes::wyhash(s.data(), s.size() * sizeof(wchar_t)); }},
+      {"XXH3", [](std::wstring_view s) { return dxf::hashes::xxh3(s.data(), s.size() * sizeof(wchar_t)); }},
+  };
+
+  fmt::print("symbols: {} (distinct), key bits: {}, expected colliding pairs: {:.3f}\n\n", wSymbols.size(), keyBits,
+             expectedPairs);
+
+  if (wSymbols.empty()) {
+    return;
+  }
+
+  fmt::print("{:<10} {:>10} {:>10} {:>12} {:>12} {:>10} {:>12} {:>18}\n", "hash", "ns/symbol", "MB/s", "key symbols",
+             "key pairs", "obs/exp", "hash pairs", "checksum");
+
+  for (const auto& candidate : CANDIDATES) {
+    // At least 200 ms of the hashing. The sum of the hashes is printed, so the hashing is not optimized out.
+    std::uint64_t checksum = 0;
+    std::size_t passes = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::duration{};
+
+    do {
+      for (auto symbol : wSymbols) {
+        checksum += candidate.hash(symbol);
+      }
+
+      passes++;
+      elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(200));
+
+    auto seconds = std::chrono::duration<double>(elapsed).count();
+    std::vector<std::uint64_t> hashes{};
+    std::vector<std::uint64_t> keys{};
+
+    for (auto symbol : wSymbols) {
+      auto hash = candidate.hash(symbol);
+
+      hashes.push_back(hash);
+      keys.push_back(dx_snapshot_key_of_hashes(dx_rid_candle, hash, 0));
+    }
+
+    std::sort(hashes.begin(), hashes.end());
+    std::sort(keys.begin(), keys.end());
+
+    auto [keySymbols, keyPairs] = countCollisions(keys);
+    auto hashPairs = countCollisions(hashes).second;
+
+    fmt::print("{:<10} {:>10.2f} {:>10.1f} {:>12} {:>12} {:>10.3f} {:>12} {:>18x}\n", candidate.name,
+               seconds * 1e9 / (n * static_cast<double>(passes)), bytes * static_cast<double>(passes) / seconds / 1e6,
+               keySymbols, keyPairs, expectedPairs > 0 ? static_cast<double>(keyPairs) / expectedPairs : 0.0,
+               hashPairs, checksum);
+  }
+}
+
+// Registers the snapshot of every distinct symbol of the file by the collision-free key (see SnapshotRegistry) and
+// checks that every key is unique and is found with the exact symbol. Returns false if there are collisions.
+bool checkInternedKeys(const std::vector<std::string_view>& allSymbols) {
+  auto symbols = getDistinctSymbols(allSymbols);
+  dxf::SnapshotRegistry<const std::string_view> registry{symbols.size() * 2};
+  std::vector<std::uint64_t> keys{};
+  std::size_t collisions = 0;
+  std::size_t mismatches = 0;
+
+  // The symbols are interned by the UTF-8 names (the invalid UTF-8 symbols have no wide names)
+  for (const auto& symbol : symbols) {
+    auto key = *registry.getKey(dx_rid_candle, dxf::Symbol::valueOf(symbol), {});
+
+    keys.push_back(key);
+
+    if (!registry.add(key, &symbol)) {
+      collisions++;
+      std::cout << key << ":\n  " << *registry.find(key) << "," << symbol << ",\n";
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = 0; i < symbols.size(); i++) {
+    auto snapshot = registry.find(keys[i]);
+
+    if (snapshot == nullptr || *snapshot != symbols[i]) {
+      mismatches++;
+    }
+  }
+
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  fmt::print("symbols: {} (distinct), collisions: {}, mismatches: {}, registry capacity: {}, lookup: {:.2f} "
+             "ns/symbol\n",
+             symbols.size(), collisions, mismatches, registry.getCapacity(),
+             symbols.empty() ? 0.0 : seconds * 1e9 / static_cast<double>(symbols.size()));
+
+  return collisions == 0 && mismatches == 0;
+}
+
+// Builds the minimal perfect hash of the distinct symbols (see SymbolPerfectHash), checks that every symbol is found at
+// its own position and writes the hash to the file (if it's set). Returns false if the hash can't be built or written.
+bool buildPerfectHash(const std::vector<std::string_view>& allSymbols, const std::string& path) {
+  auto symbols = getDistinctSymbols(allSymbols);
+  auto start = std::chrono::steady_clock::now();
+  auto hash = dxf::SymbolPerfectHash::build(symbols);
+  auto buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if (!hash) {
+    std::cout << "The perfect hash can't be built: the symbols have the same 64-bit hashes\n";
+
+    return false;
+  }
+
+  std::vector<bool> isUsed(symbols.size(), false);
+  std::size_t mismatches = 0;
+
+  start = std::chrono::steady_clock::now();
+
+  for (auto symbol : symbols) {
+    auto position = hash->find(symbol);
+
+    if (position >= symbols.size() || isUsed[position]) {
+      mismatches++;
+    } else {
+      isUsed[position] = true;
+    }
+  }
+
+  auto lookupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  auto perSymbol = [&](double value) { return symbols.empty() ? 0.0 : value / static_cast<double>(symbols.size()); };
+
+  fmt::print("symbols: {} (distinct), mismatches: {}, build: {:.3f} s, function: {:.2f} bits/symbol, lookup: {:.2f} "
+             "ns/symbol\n",
+             symbols.size(), mismatches, buildSeconds, perSymbol(static_cast<double>(hash->getFunctionSize()) * 8.0),
+             perSymbol(lookupSeconds * 1e9));
+
+  if (mismatches != 0) {
+    return false;
+  }
+
+  if (!path.empty() && !hash->save(path)) {
+    std::cerr << "Can't write the file: " << path << "\n";
+
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cout << "Usage:\n  collision-detector <ipf> [<number of threads>] [records=<record types>] "
+                 "[sources=<sources>] [compression=<gzip|zstd|none>] [index=<file>]\n"
+                 "  collision-detector hashes <ipf> [<number of threads>] [compression=<gzip|zstd|none>]\n"
+                 "  collision-detector interned <ipf> [<number of threads>] [compression=<gzip|zstd|none>]\n"
+                 "  collision-detector perfect <ipf> [<number of threads>] [compression=<gzip|zstd|none>] "
+                 "[phf=<file>]\n\n"
+                 "<ipf> - the file path, the HTTP(S) URL or - (stdin)\n\n";
+
+    return 0;
+  }
+
+  std::string_view mode = argc > 2 ? argv[1] : "";
+  auto isHashesMode = mode == "hashes";
+  auto isInternedMode = mode == "interned";
+  auto isPerfectMode = mode == "perfect";
+  auto argumentIndex = isHashesMode || isInternedMode || isPerfectMode ? 2 : 1;
+  std::string ipfFile = argv[argumentIndex];
+  unsigned long numberOfThreads = std::thread::hardware_concurrency();
+  std::vector<RecordType> records{{"Candle", dx_rid_candle}};
+  std::vector<std::string> sources{""};
+  std::string compression{};
+  std::string indexFile{};
+  std::string perfectHashFile{};
+
+  for (auto i = argumentIndex + 1; i < argc; i++) {
+    std::string_view argument = argv[i];
+
+    if (argument.starts_with("records=")) {
+      records.clear();
+
+      for (const auto& name : splitList(argument.substr(8))) {
+        auto found = std::find_if(std::begin(RECORD_TYPES), std::end(RECORD_TYPES),
+                                  [&name](const RecordType& type) { return type.name == name; });
+
+        if (name == "all") {
+          records.assign(std::begin(RECORD_TYPES), std::end(RECORD_TYPES));
+        } else if (found != std::end(RECORD_TYPES)) {
+          records.push_back(*found);
+        } else {
+          std::cerr << "Unknown record type: " << name << "\n";
+
+          return 1;
+        }
+      }
+    } else if (argument.starts_with("sources=")) {
+      sources = splitList(argument.substr(8));
+    } else if (argument.starts_with("compression=")) {
+      compression = argument.substr(12);
+    } else if (argument.starts_with("index=")) {
+      indexFile = argument.substr(6);
+    } else if (argument.starts_with("phf=")) {
+      perfectHashFile = argument.substr(4);
+    } else {
+      numberOfThreads = std::stoul(argv[i]);
+    }
+  }
+
+  numberOfThreads = std::max(numberOfThreads, 1UL);
+
+  auto command = getInputCommand(ipfFile, compression);
+  std::unique_ptr<dxf::MappedFile> file{};
+  std::vector<std::string> arenas{};
+  std::vector<std::string_view> symbols{};
+
+  if (command.empty() && ipfFile != "-") {
+    file = dxf::MappedFile::open(ipfFile, false);
+
+    if (!file) {
+      std::cerr << "Can't open the file: " << ipfFile << "\n";
+
+      return 1;
+    }
+
+    symbols = collectSymbols(splitLines(static_cast<const char*>(file->getData()), file->getSize(), numberOfThreads));
+  } else if (command.empty()) {
+    if (!streamSymbols(stdin, numberOfThreads, arenas, symbols)) {
+      std::cerr << "Can't read the stdin\n";
+
+      return 1;
+    }
+  } else {
+#ifdef _WIN32
+    auto input = _popen(command.c_str(), "rb");
+#else
+    auto input = popen(command.c_str(), "r");
+#endif
+
+    if (input == nullptr) {
+      std::cerr << "Can't run the command: " << command << "\n";
+
+      return 1;
+    }
+
+    auto isValid = streamSymbols(input, numberOfThreads, arenas, symbols);
+#ifdef _WIN32
+    auto status = _pclose(input);
+#else
+    auto status = pclose(input);
+#endif
+
+    if (!isValid || status != 0) {
+      std::cerr << "The command failed: " << command << "\n";
+
+      return 1;
+    }
+  }
+
+  if (isHashesMode) {
+    compareHashes(symbols);
+
+    return 0;
+  }
+
+  if (isInternedMode) {
+    return checkInternedKeys(symbols) ? 0 : 1;
+  }
+
+  if (isPerfectMode) {
+    return buildPerfectHash(symbols, perfectHashFile) ? 0 : 1;
+  }
+
+  if (!indexFile.empty()) {
+    return updateKeyIndex(symbols, records, sources, indexFile) ? 0 : 1;
+  }
+
+  detectCollisions(symbols, records, sources, numberOfThreads);
+}
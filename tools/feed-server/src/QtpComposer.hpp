@@ -0,0 +1,244 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace dxf {
+
+// The composer of the binary QTP messages that are sent by the feed server: the protocol and the records descriptions,
+// the heartbeats and the data messages. The encodings follow the binary QTP format that is read by the BinaryQTPParser
+// of the C API (the compact ints, the UTF strings, the decimals of the compact int with the power in the lowest 4 bits).
+// The symbols are always written as the UTF strings (no penta codes) and the records have no event flags.
+namespace qtp {
+
+enum class MessageType : int {
+  HEARTBEAT = 0,
+  DESCRIBE_PROTOCOL = 1,
+  DESCRIBE_RECORDS = 2,
+  TICKER_DATA = 10,
+  TICKER_ADD_SUBSCRIPTION = 11,
+  TICKER_REMOVE_SUBSCRIPTION = 12,
+  STREAM_DATA = 15,
+  STREAM_ADD_SUBSCRIPTION = 16,
+  STREAM_REMOVE_SUBSCRIPTION = 17,
+  HISTORY_DATA = 20,
+  HISTORY_ADD_SUBSCRIPTION = 21,
+  HISTORY_REMOVE_SUBSCRIPTION = 22
+};
+
+// The serial types of the fields (the type id in the lowest 4 bits and the representation flag)
+enum class FieldType : int {
+  UTF_CHAR = 2,
+  COMPACT_INT = 8,
+  UTF_CHAR_ARRAY = 10,
+  DECIMAL = 8 | 0x10,
+  SHORT_STRING = 8 | 0x20,
+  TIME_SECONDS = 8 | 0x30,
+  SEQUENCE = 8 | 0x40
+};
+
+struct FieldDescription {
+  std::string_view name;
+  FieldType type;
+};
+
+struct RecordDescription {
+  std::int32_t id;
+  std::string_view name;
+  std::vector<FieldDescription> fields;
+};
+
+// The bytes of the messages
+class Output {
+  std::vector<std::uint8_t> data_{};
+
+ public:
+  [[nodiscard]] const std::vector<std::uint8_t>& getData() const { return data_; }
+
+  [[nodiscard]] std::size_t getSize() const { return data_.size(); }
+
+  void clear() { data_.clear(); }
+
+  void writeByte(std::uint32_t value) { data_.push_back(static_cast<std::uint8_t>(value)); }
+
+  void writeShort(std::uint32_t value) {
+    writeByte(value >> 8U);
+    writeByte(value);
+  }
+
+  void writeInt(std::uint32_t value) {
+    writeShort(value >> 16U);
+    writeShort(value);
+  }
+
+  // 1-5 bytes, the number of the leading one bits of the first byte is the number of the following bytes
+  void writeCompactInt(std::int32_t value) {
+    auto bits = static_cast<std::uint32_t>(value);
+
+    if (value >= -0x40 && value < 0x40) {
+      writeByte(bits & 0x7FU);
+    } else if (value >= -0x2000 && value < 0x2000) {
+      writeShort((bits & 0x3FFFU) | 0x8000U);
+    } else if (value >= -0x100000 && value < 0x100000) {
+      writeByte(((bits >> 16U) & 0x1FU) | 0xC0U);
+      writeShort(bits);
+    } else if (value >= -0x08000000 && value < 0x08000000) {
+      writeInt((bits & 0x0FFFFFFFU) | 0xE0000000U);
+    } else {
+      writeByte(0xF0U);
+      writeInt(bits);
+    }
+  }
+
+  void writeUtfChar(std::uint32_t codePoint) {
+    if (codePoint < 0x80U) {
+      writeByte(codePoint);
+    } else if (codePoint < 0x800U) {
+      writeByte(0xC0U | (codePoint >> 6U));
+      writeByte(0x80U | (codePoint & 0x3FU));
+    } else {
+      writeByte(0xE0U | (codePoint >> 12U));
+      writeByte(0x80U | ((codePoint >> 6U) & 0x3FU));
+      writeByte(0x80U | (codePoint & 0x3FU));
+    }
+  }
+
+  // The compact length and the UTF-8 bytes (the strings of the server are ASCII, so the length in bytes and in chars
+  // are the same)
+  void writeUtfString(std::string_view value) {
+    writeCompactInt(static_cast<std::int32_t>(value.size()));
+
+    for (auto c : value) {
+      writeByte(static_cast<std::uint8_t>(c));
+    }
+  }
+
+  // The mantissa and the power of ten of the legacy decimal: the power code 9 is the integer, every next code is the
+  // next decimal digit after the point. The prices of the server have the cents precision.
+  void writeDecimal(double value) {
+    auto cents = static_cast<std::int64_t>(value * 100.0 + (value < 0 ? -0.5 : 0.5));
+
+    if (cents % 100 == 0) {
+      writeCompactInt(static_cast<std::int32_t>((cents / 100) << 4U) | 9);
+    } else {
+      writeCompactInt(static_cast<std::int32_t>(cents << 4U) | 11);
+    }
+  }
+
+  void append(const Output& other) { data_.insert(data_.end(), other.data_.begin(), other.data_.end()); }
+};
+
+// Composes the messages to the output: every message is the compact length, the compact type and the body. The body is
+// composed to the separate buffer, so its length is known before it's appended.
+class Composer {
+  Output output_{};
+  Output body_{};
+  MessageType messageType_{};
+
+ public:
+  static constexpr std::uint32_t MAGIC = 0x44585033;  // DXP3
+
+  [[nodiscard]] const Output& getOutput() const { return output_; }
+
+  void clear() { output_.clear(); }
+
+  Output& beginMessage(MessageType messageType) {
+    messageType_ = messageType;
+    body_.clear();
+
+    return body_;
+  }
+
+  // The types are less than 0x40, so the compact type is 1 byte
+  void endMessage() {
+    output_.writeCompactInt(static_cast<std::int32_t>(1 + body_.getSize()));
+    output_.writeCompactInt(static_cast<std::int32_t>(messageType_));
+    output_.append(body_);
+  }
+
+  // The empty message
+  void composeHeartbeat() { output_.writeCompactInt(0); }
+
+  void composeDescribeProtocol(const std::vector<MessageType>& sendMessages,
+                               const std::vector<MessageType>& receiveMessages) {
+    auto& body = beginMessage(MessageType::DESCRIBE_PROTOCOL);
+    auto writeMessages = [&body](const std::vector<MessageType>& messages) {
+      body.writeCompactInt(static_cast<std::int32_t>(messages.size()));
+
+      for (auto messageType : messages) {
+        body.writeCompactInt(static_cast<std::int32_t>(messageType));
+        body.writeUtfString(getName(messageType));
+        // No properties
+        body.writeCompactInt(0);
+      }
+    };
+
+    body.writeInt(MAGIC);
+    // No properties
+    body.writeCompactInt(0);
+    writeMessages(sendMessages);
+    writeMessages(receiveMessages);
+    endMessage();
+  }
+
+  void composeDescribeRecords(const std::vector<RecordDescription>& records) {
+    auto& body = beginMessage(MessageType::DESCRIBE_RECORDS);
+
+    for (const auto& record : records) {
+      body.writeCompactInt(record.id);
+      body.writeUtfString(record.name);
+      body.writeCompactInt(static_cast<std::int32_t>(record.fields.size()));
+
+      for (const auto& field : record.fields) {
+        body.writeUtfString(field.name);
+        body.writeCompactInt(static_cast<std::int32_t>(field.type));
+      }
+    }
+
+    endMessage();
+  }
+
+  // The record header of the data message body: the UTF string symbol and the record id. The field values follow.
+  static void writeRecordHeader(Output& body, std::string_view symbol, std::int32_t recordId) {
+    body.writeByte(0xF8U);
+    body.writeUtfString(symbol);
+    body.writeCompactInt(recordId);
+  }
+
+  static std::string_view getName(MessageType messageType) {
+    switch (messageType) {
+      case MessageType::HEARTBEAT:
+        return "HEARTBEAT";
+      case MessageType::DESCRIBE_PROTOCOL:
+        return "DESCRIBE_PROTOCOL";
+      case MessageType::DESCRIBE_RECORDS:
+        return "DESCRIBE_RECORDS";
+      case MessageType::TICKER_DATA:
+        return "TICKER_DATA";
+      case MessageType::TICKER_ADD_SUBSCRIPTION:
+        return "TICKER_ADD_SUBSCRIPTION";
+      case MessageType::TICKER_REMOVE_SUBSCRIPTION:
+        return "TICKER_REMOVE_SUBSCRIPTION";
+      case MessageType::STREAM_DATA:
+        return "STREAM_DATA";
+      case MessageType::STREAM_ADD_SUBSCRIPTION:
+        return "STREAM_ADD_SUBSCRIPTION";
+      case MessageType::STREAM_REMOVE_SUBSCRIPTION:
+        return "STREAM_REMOVE_SUBSCRIPTION";
+      case MessageType::HISTORY_DATA:
+        return "HISTORY_DATA";
+      case MessageType::HISTORY_ADD_SUBSCRIPTION:
+        return "HISTORY_ADD_SUBSCRIPTION";
+      case MessageType::HISTORY_REMOVE_SUBSCRIPTION:
+        return "HISTORY_REMOVE_SUBSCRIPTION";
+    }
+
+    return "";
+  }
+};
+
+}  // namespace qtp
+
+}  // namespace dxf
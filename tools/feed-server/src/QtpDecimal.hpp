@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace dxf {
+
+namespace qtp {
+
+// The conversions of the decimals of the DECIMAL fields (as they are decoded by the RecordDecoder): the mantissa in the
+// high 28 bits and the power code in the low 4 bits. The code 9 is the integer, the codes 1 - 8 are the 8 - 1 zeros
+// after the mantissa, the codes 10 - 15 are the 1 - 6 digits after the point. The code 0 is the special value: NaN
+// (the mantissa 0), +Inf (the positive mantissa) or -Inf (the negative one).
+//
+// The wide decimals (the 64-bit decimals of the newer feeds) have the mantissa in the high 56 bits and the rank in the
+// low 8 bits: the rank 128 is the integer, every next rank is the next digit after the point, every previous one is the
+// next zero after the mantissa. The rank 0 is the special value as the code 0 of the decimal.
+
+// The number of the digits after the point by the power code (negative - the zeros after the mantissa)
+inline constexpr std::array<std::int32_t, 16> DECIMAL_DIGITS = {0, -8, -7, -6, -5, -4, -3, -2, -1, 0, 1, 2, 3, 4, 5, 6};
+
+namespace detail {
+
+inline constexpr double exactPowerOf10(std::int32_t power) {
+  double result = 1.0;
+
+  for (std::int32_t i = 0; i < power; i++) {
+    result *= 10.0;
+  }
+
+  return result;
+}
+
+// The multiplier and the divisor of the power code: one of them is 1, so the value is the mantissa * multiplier /
+// divisor without the branches (the exact powers of ten give the correctly rounded results)
+inline constexpr std::array<double, 16> DECIMAL_MULTIPLIERS = [] {
+  std::array<double, 16> result{};
+
+  for (std::size_t code = 0; code < result.size(); code++) {
+    result[code] = DECIMAL_DIGITS[code] < 0 ? exactPowerOf10(-DECIMAL_DIGITS[code]) : 1.0;
+  }
+
+  return result;
+}();
+
+inline constexpr std::array<double, 16> DECIMAL_DIVISORS = [] {
+  std::array<double, 16> result{};
+
+  for (std::size_t code = 0; code < result.size(); code++) {
+    result[code] = DECIMAL_DIGITS[code] > 0 ? exactPowerOf10(DECIMAL_DIGITS[code]) : 1.0;
+  }
+
+  return result;
+}();
+
+// The exact powers of ten of the doubles (up to 1e22)
+inline constexpr std::array<double, 23> POWERS_OF_10 = [] {
+  std::array<double, 23> result{};
+
+  for (std::size_t i = 0; i < result.size(); i++) {
+    result[i] = exactPowerOf10(static_cast<std::int32_t>(i));
+  }
+
+  return result;
+}();
+
+// The powers of ten of the tick conversions (up to 10^18)
+inline constexpr std::array<std::int64_t, 19> INT_POWERS_OF_10 = [] {
+  std::array<std::int64_t, 19> result{1};
+
+  for (std::size_t i = 1; i < result.size(); i++) {
+    result[i] = result[i - 1] * 10;
+  }
+
+  return result;
+}();
+
+inline double toSpecialValue(std::int64_t mantissa) {
+  return mantissa == 0 ? std::numeric_limits<double>::quiet_NaN()
+         : mantissa > 0 ? std::numeric_limits<double>::infinity()
+                        : -std::numeric_limits<double>::infinity();
+}
+
+}  // namespace detail
+
+// Converts the decimal by the power computed for every value (the reference of the table-driven conversion)
+inline double decimalToDoublePow(std::int32_t decimal) {
+  auto code = static_cast<std::uint32_t>(decimal) & 0x0FU;
+  auto mantissa = decimal >> 4;
+
+  if (code == 0) {
+    return detail::toSpecialValue(mantissa);
+  }
+
+  auto digits = DECIMAL_DIGITS[code];
+
+  return digits > 0 ? mantissa / std::pow(10.0, digits) : mantissa * std::pow(10.0, -digits);
+}
+
+// Converts the decimal by the multiplier and the divisor of the power code. The special values are the only branch.
+inline double decimalToDouble(std::int32_t decimal) {
+  auto code = static_cast<std::uint32_t>(decimal) & 0x0FU;
+  auto mantissa = decimal >> 4;
+
+  if (code == 0) [[unlikely]] {
+    return detail::toSpecialValue(mantissa);
+  }
+
+  return static_cast<double>(mantissa) * detail::DECIMAL_MULTIPLIERS[code] / detail::DECIMAL_DIVISORS[code];
+}
+
+// Converts the decimal to the whole number of the ticks of the 10^-precision size (e.g. the cents for the precision
+// 2) without the doubles: the mantissa is scaled by the integer power of ten. Returns false if the decimal is the
+// special value, it's not the whole number of the ticks or the ticks overflow. The precision is 0 - 18.
+inline bool decimalToTicks(std::int32_t decimal, std::int32_t precision, std::int64_t& ticks) {
+  auto code = static_cast<std::uint32_t>(decimal) & 0x0FU;
+  std::int64_t mantissa = decimal >> 4;
+
+  if (code == 0 || precision < 0 || precision >= static_cast<std::int32_t>(detail::INT_POWERS_OF_10.size())) {
+    return false;
+  }
+
+  auto scale = precision - DECIMAL_DIGITS[code];
+
+  if (scale < 0) {
+    auto divisor = detail::INT_POWERS_OF_10[static_cast<std::size_t>(-scale)];
+
+    if (mantissa % divisor != 0) {
+      return false;
+    }
+
+    ticks = mantissa / divisor;
+
+    return true;
+  }
+
+  // The 28-bit mantissa is scaled by up to 10^26, so the large scales are checked by the bound
+  if (scale >= static_cast<std::int32_t>(detail::INT_POWERS_OF_10.size())) {
+    if (mantissa != 0) {
+      return false;
+    }
+
+    ticks = 0;
+
+    return true;
+  }
+
+  auto multiplier = detail::INT_POWERS_OF_10[static_cast<std::size_t>(scale)];
+
+  if (mantissa > std::numeric_limits<std::int64_t>::max() / multiplier ||
+      mantissa < std::numeric_limits<std::int64_t>::min() / multiplier) {
+    return false;
+  }
+
+  ticks = mantissa * multiplier;
+
+  return true;
+}
+
+// Converts the wide decimal by the table of the exact powers of ten (the ranks beyond 10^22 are converted by the power
+// computed for the value)
+inline double wideDecimalToDouble(std::int64_t wideDecimal) {
+  auto rank = static_cast<std::int32_t>(static_cast<std::uint64_t>(wideDecimal) & 0xFFU);
+  auto mantissa = wideDecimal >> 8;
+
+  if (rank == 0) [[unlikely]] {
+    return detail::toSpecialValue(mantissa);
+  }
+
+  // The digits after the point
+  auto digits = rank - 128;
+  auto value = static_cast<double>(mantissa);
+
+  if (digits >= static_cast<std::int32_t>(detail::POWERS_OF_10.size()) ||
+      -digits >= static_cast<std::int32_t>(detail::POWERS_OF_10.size())) [[unlikely]] {
+    return digits > 0 ? value / std::pow(10.0, digits) : value * std::pow(10.0, -digits);
+  }
+
+  return digits > 0 ? value / detail::POWERS_OF_10[static_cast<std::size_t>(digits)]
+                    : value * detail::POWERS_OF_10[static_cast<std::size_t>(-digits)];
+}
+
+}  // namespace qtp
+
+}  // namespace dxf
@@ -0,0 +1,408 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <cstdlib>
+#endif
+
+#include "QtpComposer.hpp"
+
+namespace dxf {
+
+namespace qtp {
+
+// The number of the bytes of the compact int by its first byte (the number of the leading one bits + 1, 5 for 0xF0+)
+inline constexpr std::array<std::uint8_t, 256> COMPACT_INT_SIZES = [] {
+  std::array<std::uint8_t, 256> result{};
+
+  for (std::size_t b = 0; b < result.size(); b++) {
+    result[b] = b < 0x80 ? 1 : b < 0xC0 ? 2 : b < 0xE0 ? 3 : b < 0xF0 ? 4 : 5;
+  }
+
+  return result;
+}();
+
+// The bytes of the unaligned load of the fast compact int decoding
+inline constexpr std::size_t COMPACT_INT_LOAD_SIZE = 8;
+
+// Reads the compact int byte by byte. The bytes must be available.
+inline std::int32_t readCompactIntBytewise(const std::uint8_t*& data) {
+  std::uint32_t first = *data++;
+
+  if (first < 0x80U) {
+    return static_cast<std::int32_t>(first << 25U) >> 25;
+  }
+
+  if (first < 0xC0U) {
+    return static_cast<std::int32_t>(((first << 8U) | *data++) << 18U) >> 18;
+  }
+
+  if (first < 0xE0U) {
+    auto value = (first << 16U) | (static_cast<std::uint32_t>(data[0]) << 8U) | data[1];
+
+    data += 2;
+
+    return static_cast<std::int32_t>(value << 11U) >> 11;
+  }
+
+  if (first < 0xF0U) {
+    auto value = (first << 24U) | (static_cast<std::uint32_t>(data[0]) << 16U) |
+                 (static_cast<std::uint32_t>(data[1]) << 8U) | data[2];
+
+    data += 3;
+
+    return static_cast<std::int32_t>(value << 4U) >> 4;
+  }
+
+  auto value = (static_cast<std::uint32_t>(data[0]) << 24U) | (static_cast<std::uint32_t>(data[1]) << 16U) |
+               (static_cast<std::uint32_t>(data[2]) << 8U) | data[3];
+
+  data += 4;
+
+  return static_cast<std::int32_t>(value);
+}
+
+// Reads the compact int by one unaligned load of 8 bytes: the size is classified by the table, the big-endian bytes
+// are swapped and shifted to the value. COMPACT_INT_LOAD_SIZE bytes must be available.
+inline std::int32_t readCompactIntFast(const std::uint8_t*& data) {
+  std::uint64_t bytes = 0;
+
+  std::memcpy(&bytes, data, sizeof(bytes));
+
+#ifdef _MSC_VER
+  bytes = _byteswap_uint64(bytes);
+#else
+  bytes = __builtin_bswap64(bytes);
+#endif
+
+  auto size = COMPACT_INT_SIZES[*data];
+
+  data += size;
+
+  if (size == 5) {
+    return static_cast<std::int32_t>(static_cast<std::uint32_t>(bytes >> 24U));
+  }
+
+  // The size bits of the prefix are shifted out, the 7, 14, 21 or 28 value bits are sign extended from the top
+  return static_cast<std::int32_t>(static_cast<std::int64_t>(bytes << size) >> (64U - 7U * size));
+}
+
+// The input of the message body. The reads return false at the end of the body (the input is not changed then).
+class Input {
+  const std::uint8_t* data_;
+  const std::uint8_t* end_;
+
+ public:
+  explicit Input(std::span<const std::uint8_t> data) : data_{data.data()}, end_{data.data() + data.size()} {}
+
+  [[nodiscard]] std::size_t getRemaining() const { return static_cast<std::size_t>(end_ - data_); }
+
+  [[nodiscard]] bool isEnd() const { return data_ == end_; }
+
+  bool readByte(std::uint32_t& value) {
+    if (isEnd()) {
+      return false;
+    }
+
+    value = *data_++;
+
+    return true;
+  }
+
+  bool readCompactInt(std::int32_t& value) {
+    if (getRemaining() >= COMPACT_INT_LOAD_SIZE) {
+      value = readCompactIntFast(data_);
+
+      return true;
+    }
+
+    if (isEnd() || getRemaining() < COMPACT_INT_SIZES[*data_]) {
+      return false;
+    }
+
+    value = readCompactIntBytewise(data_);
+
+    return true;
+  }
+
+  // The compact int without the check of the bounds (see RecordDecoder)
+  std::int32_t readCompactIntUnchecked() { return readCompactIntFast(data_); }
+
+  bool readUtfChar(std::int32_t& value) {
+    if (isEnd()) {
+      return false;
+    }
+
+    std::uint32_t first = *data_;
+    std::size_t size = first < 0x80U ? 1 : first < 0xE0U ? 2 : 3;
+
+    if (getRemaining() < size) {
+      return false;
+    }
+
+    value = static_cast<std::int32_t>(readUtfCharUnchecked());
+
+    return true;
+  }
+
+  std::uint32_t readUtfCharUnchecked() {
+    std::uint32_t first = *data_++;
+
+    if (first < 0x80U) {
+      return first;
+    }
+
+    if (first < 0xE0U) {
+      return ((first & 0x1FU) << 6U) | (*data_++ & 0x3FU);
+    }
+
+    auto value = ((first & 0x0FU) << 12U) | ((data_[0] & 0x3FU) << 6U) | (data_[1] & 0x3FU);
+
+    data_ += 2;
+
+    return value;
+  }
+
+  // The compact length (-1 - the null string) and the bytes (the strings of the feed are ASCII, see Output)
+  bool readUtfString(std::string_view& value) {
+    auto position = data_;
+    std::int32_t length = 0;
+
+    if (!readCompactInt(length)) {
+      return false;
+    }
+
+    if (length < 0) {
+      value = {};
+
+      return true;
+    }
+
+    if (getRemaining() < static_cast<std::size_t>(length)) {
+      data_ = position;
+
+      return false;
+    }
+
+    value = {reinterpret_cast<const char*>(data_), static_cast<std::size_t>(length)};
+    data_ += length;
+
+    return true;
+  }
+};
+
+// The decoder of the records of the data messages by the descriptions of the DESCRIBE_RECORDS message. The field
+// values are decoded as the ints (the compact ints, the decimals, the times and the sequences as they are on the wire,
+// the code points of the chars, 0 for the strings).
+//
+// The bounds of the buffer are checked once per record if the record has no strings and the rest of the message has
+// the maximum size of the record: the fields are decoded by the unchecked fast reads then.
+class RecordDecoder final {
+ public:
+  struct Record {
+    std::int32_t id = 0;
+    std::string name{};
+    std::vector<FieldType> fields{};
+    // The maximum size of the fields (0 - the record has the strings, the fields are checked one by one)
+    std::size_t maxSize = 0;
+  };
+
+  // The record of the layout (see decodeBatch)
+  template <std::size_t N>
+  struct RecordValues {
+    std::string_view symbol{};
+    std::array<std::int32_t, N> values{};
+  };
+
+ private:
+  // By the id (the empty name - the record is not described)
+  std::vector<Record> records_{};
+  std::vector<std::int32_t> values_{};
+
+  bool readFieldsChecked(Input& input, const Record& record) {
+    for (std::size_t i = 0; i < record.fields.size(); i++) {
+      std::string_view string{};
+      auto isRead = record.fields[i] == FieldType::UTF_CHAR         ? input.readUtfChar(values_[i])
+                    : record.fields[i] == FieldType::UTF_CHAR_ARRAY ? input.readUtfString(string)
+                                                                    : input.readCompactInt(values_[i]);
+
+      if (!isRead) {
+        return false;
+      }
+
+      if (record.fields[i] == FieldType::UTF_CHAR_ARRAY) {
+        values_[i] = 0;
+      }
+    }
+
+    return true;
+  }
+
+  template <FieldType Type>
+  static std::int32_t readFieldUnchecked(Input& input) {
+    if constexpr (Type == FieldType::UTF_CHAR) {
+      return static_cast<std::int32_t>(input.readUtfCharUnchecked());
+    } else {
+      return input.readCompactIntUnchecked();
+    }
+  }
+
+  // The symbols of the feed are always the UTF strings (see Composer::writeRecordHeader)
+  static bool readRecordHeader(Input& input, std::string_view& symbol, std::int32_t& id) {
+    std::uint32_t symbolEncoding = 0;
+
+    return input.readByte(symbolEncoding) && symbolEncoding == 0xF8U && input.readUtfString(symbol) &&
+           input.readCompactInt(id);
+  }
+
+  void readFieldsUnchecked(Input& input, const Record& record) {
+    for (std::size_t i = 0; i < record.fields.size(); i++) {
+      values_[i] = record.fields[i] == FieldType::UTF_CHAR ? static_cast<std::int32_t>(input.readUtfCharUnchecked())
+                                                           : input.readCompactIntUnchecked();
+    }
+  }
+
+ public:
+  [[nodiscard]] const Record* findRecord(std::int32_t id) const {
+    return id >= 0 && static_cast<std::size_t>(id) < records_.size() && !records_[id].name.empty() ? &records_[id]
+                                                                                                    : nullptr;
+  }
+
+  // Adds the records of the DESCRIBE_RECORDS body. Returns false if the body can't be decoded (the records before the
+  // error are added).
+  bool describe(Input input) {
+    while (!input.isEnd()) {
+      std::int32_t id = 0;
+      std::string_view name{};
+      std::int32_t fieldsNumber = 0;
+
+      if (!input.readCompactInt(id) || id < 0 || id > 0xFFFF || !input.readUtfString(name) || name.empty() ||
+          !input.readCompactInt(fieldsNumber) || fieldsNumber < 0) {
+        return false;
+      }
+
+      Record record{id, std::string{name}};
+
+      for (std::int32_t i = 0; i < fieldsNumber; i++) {
+        std::string_view fieldName{};
+        std::int32_t type = 0;
+
+        if (!input.readUtfString(fieldName) || !input.readCompactInt(type)) {
+          return false;
+        }
+
+        auto fieldType = static_cast<FieldType>(type);
+
+        if ((type & 0x0F) != static_cast<int>(FieldType::COMPACT_INT) && fieldType != FieldType::UTF_CHAR &&
+            fieldType != FieldType::UTF_CHAR_ARRAY) {
+          // The unsupported serial type
+          return false;
+        }
+
+        record.fields.push_back(fieldType);
+        record.maxSize += fieldType == FieldType::UTF_CHAR ? 3 : 5;
+      }
+
+      if (std::find(record.fields.begin(), record.fields.end(), FieldType::UTF_CHAR_ARRAY) != record.fields.end()) {
+        record.maxSize = 0;
+      }
+
+      if (record.fields.size() > values_.size()) {
+        values_.resize(record.fields.size());
+      }
+
+      if (static_cast<std::size_t>(id) >= records_.size()) {
+        records_.resize(static_cast<std::size_t>(id) + 1);
+      }
+
+      records_[id] = std::move(record);
+    }
+
+    return true;
+  }
+
+  // Decodes the records of the data message body and calls the onRecord(const Record&, std::string_view symbol,
+  // std::span<const std::int32_t> values) for each of them. isBulk - false to check the bounds per field (for the
+  // comparison). Returns false if the body has the unknown record or the unsupported symbol encoding (the symbols of
+  // the feed are always the UTF strings, see Composer::writeRecordHeader).
+  template <typename OnRecord>
+  bool decodeData(Input input, OnRecord&& onRecord, bool isBulk = true) {
+    while (!input.isEnd()) {
+      std::string_view symbol{};
+      std::int32_t id = 0;
+
+      if (!readRecordHeader(input, symbol, id)) {
+        return false;
+      }
+
+      const auto* record = findRecord(id);
+
+      if (record == nullptr) {
+        return false;
+      }
+
+      if (isBulk && record->maxSize != 0 && input.getRemaining() >= record->maxSize + COMPACT_INT_LOAD_SIZE) {
+        readFieldsUnchecked(input, *record);
+      } else if (!readFieldsChecked(input, *record)) {
+        return false;
+      }
+
+      onRecord(*record, symbol, std::span<const std::int32_t>{values_.data(), record->fields.size()});
+    }
+
+    return true;
+  }
+
+  // Decodes the body of the data message of the records of one type by the layout known at compile time (the serial
+  // types of the fields, no strings): the fields are read by the unrolled code instead of the dispatch by the
+  // description, and the records are appended to the batch (the vector is reused by the caller, so its capacity is
+  // kept between the messages). Returns false if the description of the record doesn't match the layout or the body
+  // has the other records (the batch has the records before them).
+  template <FieldType... Types>
+  bool decodeBatch(Input input, std::int32_t id, std::vector<RecordValues<sizeof...(Types)>>& batch) {
+    static_assert(((Types != FieldType::UTF_CHAR_ARRAY) && ...), "The strings are not supported by the layouts");
+
+    constexpr std::array<FieldType, sizeof...(Types)> fields{Types...};
+    constexpr std::size_t maxSize = ((Types == FieldType::UTF_CHAR ? 3 : 5) + ... + 0);
+    const auto* record = findRecord(id);
+
+    if (record == nullptr || !std::equal(record->fields.begin(), record->fields.end(), fields.begin(), fields.end())) {
+      return false;
+    }
+
+    while (!input.isEnd()) {
+      std::string_view symbol{};
+      std::int32_t recordId = 0;
+
+      if (!readRecordHeader(input, symbol, recordId) || recordId != id) {
+        return false;
+      }
+
+      if (input.getRemaining() >= maxSize + COMPACT_INT_LOAD_SIZE) {
+        // The elements of the braced list are read in the order
+        batch.push_back({symbol, {readFieldUnchecked<Types>(input)...}});
+      } else if (readFieldsChecked(input, *record)) {
+        auto& values = batch.emplace_back(RecordValues<sizeof...(Types)>{symbol});
+
+        std::copy_n(values_.begin(), values.values.size(), values.values.begin());
+      } else {
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+}  // namespace qtp
+
+}  // namespace dxf
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "LargePages.hpp"
+
+namespace dxf {
+
+namespace qtp {
+
+// The message of the receive ring: the body is in place, split into two parts if it wraps around the end of the ring
+struct MessageView {
+  // -1 - the empty heartbeat (no type)
+  int type = -1;
+  std::span<const std::uint8_t> first{};
+  std::span<const std::uint8_t> second{};
+
+  [[nodiscard]] std::size_t getSize() const { return first.size() + second.size(); }
+};
+
+// The receive ring of the QTP stream: the socket writes directly into the ring (getWritableSpace, commit) and the
+// messages are framed in place (forEachMessage). The partial message stays in the ring until the rest is received and
+// wraps around the end of the ring, so the received bytes are never copied or compacted into the separate parse buffer.
+//
+// The message that doesn't fit the ring can't be framed: the framing stops (isSynchronized) and the received bytes are
+// only dropped.
+class ReceiveRing final {
+  // The large page buffer (see LargePages)
+  std::vector<std::uint8_t, LargePageAllocator<std::uint8_t>> data_;
+  std::size_t mask_;
+  // The positions grow infinitely, the offsets in the ring are masked
+  std::uint64_t readPosition_ = 0;
+  std::uint64_t writePosition_ = 0;
+  bool isSynchronized_ = true;
+
+  [[nodiscard]] std::uint8_t getByte(std::uint64_t position) const {
+    return data_[static_cast<std::size_t>(position) & mask_];
+  }
+
+  // Reads the compact int at the position. Returns false if the int is not received yet.
+  bool readCompactInt(std::uint64_t& position, std::int32_t& value) const {
+    if (position == writePosition_) {
+      return false;
+    }
+
+    auto first = getByte(position);
+    std::size_t size = first < 0x80U ? 1 : first < 0xC0U ? 2 : first < 0xE0U ? 3 : first < 0xF0U ? 4 : 5;
+
+    if (writePosition_ - position < size) {
+      return false;
+    }
+
+    std::uint32_t bits = first;
+
+    if (size == 5) {
+      bits = 0;
+    }
+
+    for (std::size_t i = 1; i < size; i++) {
+      bits = (bits << 8U) | getByte(position + i);
+    }
+
+    // The sign extension of the 7, 14, 21 and 28 bits
+    auto shift = size == 5 ? 0U : 32U - 7U * static_cast<unsigned>(size);
+
+    value = static_cast<std::int32_t>(bits << shift) >> shift;
+    position += size;
+
+    return true;
+  }
+
+ public:
+  // The capacity is rounded up to the power of two
+  explicit ReceiveRing(std::size_t capacity) : data_{}, mask_{} {
+    std::size_t size = 1;
+
+    while (size < capacity) {
+      size <<= 1U;
+    }
+
+    data_.resize(size);
+    mask_ = size - 1;
+  }
+
+  [[nodiscard]] std::size_t getCapacity() const { return data_.size(); }
+
+  [[nodiscard]] bool isSynchronized() const { return isSynchronized_; }
+
+  // The contiguous free space for the next receive (up to the end of the ring, the rest is received by the next one)
+  [[nodiscard]] std::span<std::uint8_t> getWritableSpace() {
+    auto offset = static_cast<std::size_t>(writePosition_) & mask_;
+    auto free = data_.size() - static_cast<std::size_t>(writePosition_ - readPosition_);
+
+    return {data_.data() + offset, (std::min)(free, data_.size() - offset)};
+  }
+
+  // The received bytes of the writable space
+  void commit(std::size_t size) { writePosition_ += size; }
+
+  // Calls the onMessage(const MessageView&) for every received message and releases its bytes. Returns the number of
+  // the messages.
+  template <typename OnMessage>
+  std::size_t forEachMessage(OnMessage&& onMessage) {
+    std::size_t result = 0;
+
+    while (isSynchronized_) {
+      auto position = readPosition_;
+      std::int32_t length = 0;
+
+      if (!readCompactInt(position, length)) {
+        break;
+      }
+
+      if (length < 0 || position - readPosition_ + static_cast<std::uint64_t>(length) > data_.size()) {
+        isSynchronized_ = false;
+
+        break;
+      }
+
+      if (writePosition_ - position < static_cast<std::uint64_t>(length)) {
+        break;
+      }
+
+      auto end = position + static_cast<std::uint64_t>(length);
+      MessageView message{};
+
+      if (length > 0) {
+        std::int32_t type = 0;
+
+        if (!readCompactInt(position, type) || position > end) {
+          isSynchronized_ = false;
+
+          break;
+        }
+
+        message.type = type;
+
+        auto offset = static_cast<std::size_t>(position) & mask_;
+        auto size = static_cast<std::size_t>(end - position);
+        auto firstSize = (std::min)(size, data_.size() - offset);
+
+        message.first = {data_.data() + offset, firstSize};
+        message.second = {data_.data(), size - firstSize};
+      }
+
+      onMessage(static_cast<const MessageView&>(message));
+      readPosition_ = end;
+      result++;
+    }
+
+    if (!isSynchronized_) {
+      readPosition_ = writePosition_;
+    }
+
+    return result;
+  }
+};
+
+}  // namespace qtp
+
+}  // namespace dxf
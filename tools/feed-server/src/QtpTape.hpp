@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace dxf {
+
+namespace qtp {
+
+// The tape of the raw QTP bytes received from the server (as they are read from the socket, the messages may be split
+// between the chunks).
+//
+// Format (native byte order):
+//   header: "QTPT" (4 bytes), version (uint32)
+//   chunk:  receive time (int64, nanoseconds since the epoch), size (uint32), bytes
+struct Tape {
+  static constexpr char MAGIC[4] = {'Q', 'T', 'P', 'T'};
+  static constexpr std::uint32_t VERSION = 1;
+};
+
+class TapeWriter final {
+  std::FILE* file_;
+
+ public:
+  // The file is owned by the caller
+  explicit TapeWriter(std::FILE* file) : file_{file} {
+    std::fwrite(Tape::MAGIC, 1, sizeof(Tape::MAGIC), file_);
+    std::fwrite(&Tape::VERSION, sizeof(Tape::VERSION), 1, file_);
+  }
+
+  // Returns false if the chunk can't be written
+  bool write(std::int64_t receiveTime, const void* data, std::uint32_t size) {
+    return std::fwrite(&receiveTime, sizeof(receiveTime), 1, file_) == 1 &&
+           std::fwrite(&size, sizeof(size), 1, file_) == 1 && std::fwrite(data, 1, size, file_) == size;
+  }
+};
+
+class TapeReader final {
+  std::FILE* file_;
+  bool isValid_;
+
+  template <typename T>
+  bool get(T& value) {
+    return std::fread(&value, sizeof(T), 1, file_) == 1;
+  }
+
+ public:
+  // The file is owned by the caller
+  explicit TapeReader(std::FILE* file) : file_{file}, isValid_{false} {
+    char magic[sizeof(Tape::MAGIC)]{};
+    std::uint32_t version = 0;
+
+    isValid_ = std::fread(magic, 1, sizeof(magic), file_) == sizeof(magic) &&
+               std::memcmp(magic, Tape::MAGIC, sizeof(magic)) == 0 && get(version) && version == Tape::VERSION;
+  }
+
+  // Returns false if the file is not a tape of the supported version
+  [[nodiscard]] bool isValid() const { return isValid_; }
+
+  // Reads the next chunk. Returns false at the end of the file (or if the chunk is truncated)
+  bool read(std::int64_t& receiveTime, std::vector<std::uint8_t>& data) {
+    std::uint32_t size = 0;
+
+    if (!isValid_ || !get(receiveTime) || !get(size)) {
+      return false;
+    }
+
+    data.resize(size);
+
+    return std::fread(data.data(), 1, size, file_) == size;
+  }
+};
+
+}  // namespace qtp
+
+}  // namespace dxf
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <poll.h>
+#endif
+
+namespace dxf {
+
+namespace tls {
+
+// The text of the last OpenSSL error of the thread (and clears the error queue)
+inline std::string getLastError() {
+  std::string result{};
+  char text[256]{};
+
+  for (auto code = ERR_get_error(); code != 0; code = ERR_get_error()) {
+    ERR_error_string_n(code, text, sizeof(text));
+    result += result.empty() ? text : std::string("; ") + text;
+  }
+
+  return result.empty() ? std::string("unknown TLS error") : result;
+}
+
+// The OpenSSL context of the connections of one side. The connections of the context try the kernel TLS offload (kTLS,
+// SSL_OP_ENABLE_KTLS): after the handshake the symmetric crypto of the connection is handed to the kernel if the
+// kernel (the tls module) and the cipher support it, otherwise OpenSSL does it in the user space.
+class Context final {
+  SSL_CTX* context_;
+
+  explicit Context(SSL_CTX* context) : context_{context} {}
+
+  static std::unique_ptr<Context> create(const SSL_METHOD* method, bool isTls12Only) {
+    auto* context = SSL_CTX_new(method);
+
+    if (context == nullptr) {
+      return nullptr;
+    }
+
+    SSL_CTX_set_min_proto_version(context, TLS1_2_VERSION);
+
+    // The older OpenSSL versions (before 3.2) offload the receive of TLS 1.2 only
+    if (isTls12Only) {
+      SSL_CTX_set_max_proto_version(context, TLS1_2_VERSION);
+    }
+
+#ifdef SSL_OP_ENABLE_KTLS
+    SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+#endif
+
+    // The reads take the whole received records from the socket at once
+    SSL_CTX_set_read_ahead(context, 1);
+
+    return std::unique_ptr<Context>(new Context(context));
+  }
+
+ public:
+  Context(const Context&) = delete;
+  Context& operator=(const Context&) = delete;
+
+  ~Context() { SSL_CTX_free(context_); }
+
+  // The context of the client connections. caFile - the PEM certificates that verify the server (empty - the server is
+  // not verified). Returns nullptr if the certificates can't be loaded.
+  static std::unique_ptr<Context> createClient(const std::string& caFile, bool isTls12Only = false) {
+    auto result = create(TLS_client_method(), isTls12Only);
+
+    if (result == nullptr || caFile.empty()) {
+      return result;
+    }
+
+    if (SSL_CTX_load_verify_locations(result->context_, caFile.c_str(), nullptr) != 1) {
+      return nullptr;
+    }
+
+    SSL_CTX_set_verify(result->context_, SSL_VERIFY_PEER, nullptr);
+
+    return result;
+  }
+
+  // The context of the server connections with the PEM certificate chain and the private key. Returns nullptr if they
+  // can't be loaded.
+  static std::unique_ptr<Context> createServer(const std::string& certificateFile, const std::string& keyFile,
+                                               bool isTls12Only = false) {
+    auto result = create(TLS_server_method(), isTls12Only);
+
+    if (result == nullptr ||
+        SSL_CTX_use_certificate_chain_file(result->context_, certificateFile.c_str()) != 1 ||
+        SSL_CTX_use_PrivateKey_file(result->context_, keyFile.c_str(), SSL_FILETYPE_PEM) != 1) {
+      return nullptr;
+    }
+
+    return result;
+  }
+
+  // The context of the server connections with the generated self-signed certificate of the localhost (EC P-256), e.g.
+  // for the loopback benchmarks
+  static std::unique_ptr<Context> createSelfSignedServer(bool isTls12Only = false) {
+    auto result = create(TLS_server_method(), isTls12Only);
+    auto* key = EVP_EC_gen("P-256");
+    auto* certificate = X509_new();
+    auto isCreated = result != nullptr && key != nullptr && certificate != nullptr;
+
+    if (isCreated) {
+      auto* name = X509_get_subject_name(certificate);
+
+      X509_set_version(certificate, 2);
+      ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+      X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+      X509_gmtime_adj(X509_getm_notAfter(certificate), 24 * 60 * 60);
+      X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1,
+                                 -1, 0);
+      X509_set_issuer_name(certificate, name);
+      isCreated = X509_set_pubkey(certificate, key) == 1 && X509_sign(certificate, key, EVP_sha256()) != 0 &&
+                  SSL_CTX_use_certificate(result->context_, certificate) == 1 &&
+                  SSL_CTX_use_PrivateKey(result->context_, key) == 1;
+    }
+
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+
+    return isCreated ? std::move(result) : nullptr;
+  }
+
+  [[nodiscard]] SSL_CTX* get() const { return context_; }
+};
+
+// The TLS connection over the connected blocking socket (the socket is not owned). The receive decrypts directly into
+// the span of the caller (e.g. the writable space of the receive ring): the kernel does it with kTLS, otherwise
+// OpenSSL decrypts the records of its read buffer into the span, so there is no copy into the separate parse buffer.
+//
+// The receive and the send may be called from the different threads: the calls of OpenSSL are serialized, the receive
+// waits for the data of the socket without the lock.
+class Connection final {
+  SSL* ssl_;
+  int socket_;
+  std::mutex mutex_{};
+
+  Connection(SSL* ssl, int socket) : ssl_{ssl}, socket_{socket} {}
+
+  static std::unique_ptr<Connection> create(const Context& context, int socket, const std::string& serverName,
+                                            bool isServer) {
+    auto* ssl = SSL_new(context.get());
+
+    if (ssl == nullptr) {
+      return nullptr;
+    }
+
+    auto result = std::unique_ptr<Connection>(new Connection(ssl, socket));
+
+    SSL_set_fd(ssl, socket);
+
+    if (!isServer && !serverName.empty()) {
+      SSL_set_tlsext_host_name(ssl, serverName.c_str());
+      SSL_set1_host(ssl, serverName.c_str());
+    }
+
+    if ((isServer ? SSL_accept(ssl) : SSL_connect(ssl)) != 1) {
+      return nullptr;
+    }
+
+    return result;
+  }
+
+  // The bytes of the socket that OpenSSL has already read (the decrypted or the encrypted ones)
+  [[nodiscard]] bool hasBufferedBytes() {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    return SSL_has_pending(ssl_) != 0;
+  }
+
+  // Waits until the socket is readable (the timeout in ms, -1 - infinite). Returns false on the timeout.
+  [[nodiscard]] bool waitReadable(int timeout) const {
+#ifdef _WIN32
+    WSAPOLLFD descriptor{static_cast<SOCKET>(socket_), POLLIN, 0};
+
+    return WSAPoll(&descriptor, 1, timeout) > 0;
+#else
+    pollfd descriptor{socket_, POLLIN, 0};
+
+    return poll(&descriptor, 1, timeout) > 0;
+#endif
+  }
+
+ public:
+  Connection(const Connection&) = delete;
+  Connection& operator=(const Connection&) = delete;
+
+  ~Connection() { SSL_free(ssl_); }
+
+  // Makes the client handshake. serverName - the name for SNI and the verification of the certificate (if the context
+  // verifies it). Returns nullptr if the handshake fails.
+  static std::unique_ptr<Connection> connect(const Context& context, int socket, const std::string& serverName) {
+    return create(context, socket, serverName, false);
+  }
+
+  // Makes the server handshake. Returns nullptr if the handshake fails.
+  static std::unique_ptr<Connection> accept(const Context& context, int socket) {
+    return create(context, socket, {}, true);
+  }
+
+  // The receive is decrypted by the kernel
+  [[nodiscard]] bool isKernelReceive() const {
+#ifdef BIO_get_ktls_recv
+    return BIO_get_ktls_recv(SSL_get_rbio(ssl_)) != 0;
+#else
+    return false;
+#endif
+  }
+
+  // The send is encrypted by the kernel
+  [[nodiscard]] bool isKernelSend() const {
+#ifdef BIO_get_ktls_send
+    return BIO_get_ktls_send(SSL_get_wbio(ssl_)) != 0;
+#else
+    return false;
+#endif
+  }
+
+  [[nodiscard]] std::string getDescription() const {
+    return std::string(SSL_get_version(ssl_)) + " " + SSL_get_cipher_name(ssl_) +
+           (isKernelReceive() ? ", kTLS receive" : "") + (isKernelSend() ? ", kTLS send" : "");
+  }
+
+  // Receives the decrypted bytes into the span: blocks until the first bytes, then reads the records that are already
+  // received until the socket is drained or the span is full (see receiveAvailable of the plain socket). Returns the
+  // size (<= 0 - the close or the error) and adds the number of the reads to the receivesNumber.
+  std::ptrdiff_t receive(std::span<std::uint8_t> space, std::uint64_t& receivesNumber) {
+    std::size_t result = 0;
+
+    while (result < space.size()) {
+      // The first bytes are waited for without the lock, the rest are read only if they are buffered or received
+      if (!hasBufferedBytes() && !waitReadable(result == 0 ? -1 : 0)) {
+        break;
+      }
+
+      std::lock_guard<std::mutex> lk(mutex_);
+      auto size = SSL_read(ssl_, space.data() + result, static_cast<int>(space.size() - result));
+
+      receivesNumber++;
+
+      if (size <= 0) {
+        return result == 0 ? -1 : static_cast<std::ptrdiff_t>(result);
+      }
+
+      result += static_cast<std::size_t>(size);
+    }
+
+    return static_cast<std::ptrdiff_t>(result);
+  }
+
+  // Sends all the bytes. Returns false if the connection is closed.
+  bool sendAll(const std::uint8_t* data, std::size_t size) {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    while (size != 0) {
+      auto sent = SSL_write(ssl_, data, static_cast<int>(size));
+
+      if (sent <= 0) {
+        return false;
+      }
+
+      data += sent;
+      size -= static_cast<std::size_t>(sent);
+    }
+
+    return true;
+  }
+
+  // Sends the close_notify alert (the socket is shut down by the owner)
+  void shutdown() {
+    std::lock_guard<std::mutex> lk(mutex_);
+
+    SSL_shutdown(ssl_);
+  }
+};
+
+}  // namespace tls
+
+}  // namespace dxf
@@ -0,0 +1,1323 @@
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include "LatencyStats.hpp"
+#include "QtpComposer.hpp"
+#include "QtpInput.hpp"
+#include "QtpReceiveRing.hpp"
+#include "QtpTape.hpp"
+
+// 1 - the capture proxy can connect to the upstream server by TLS (OpenSSL)
+#ifndef FEED_SERVER_TLS
+#define FEED_SERVER_TLS 0
+#endif
+
+#if FEED_SERVER_TLS
+#include "TlsTransport.hpp"
+#endif
+
+#ifdef _WIN32
+using SocketType = SOCKET;
+
+const SocketType INVALID_SOCKET_VALUE = INVALID_SOCKET;
+
+void closeSocket(SocketType s) { closesocket(s); }
+
+void shutdownSocket(SocketType s) { shutdown(s, SD_BOTH); }
+#else
+using SocketType = int;
+
+const SocketType INVALID_SOCKET_VALUE = -1;
+
+void closeSocket(SocketType s) { close(s); }
+
+void shutdownSocket(SocketType s) { shutdown(s, SHUT_RDWR); }
+#endif
+
+// The disconnected client is detected by the result of the send instead of the SIGPIPE
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
+// Sends all the bytes. Returns false if the client is disconnected.
+bool sendAll(SocketType s, const std::uint8_t* data, std::size_t size) {
+  std::size_t sent = 0;
+
+  while (sent < size) {
+    auto result = send(s, reinterpret_cast<const char*>(data + sent), static_cast<int>(size - sent), SEND_FLAGS);
+
+    if (result <= 0) {
+      return false;
+    }
+
+    sent += static_cast<std::size_t>(result);
+  }
+
+  return true;
+}
+
+bool sendAll(SocketType s, const std::vector<std::uint8_t>& data) { return sendAll(s, data.data(), data.size()); }
+
+// The reactor of the client sockets: one thread waits for the data of all the clients (epoll on Linux, poll elsewhere)
+// and calls the handlers of the clients, so the mostly idle clients don't need the reader thread per client.
+class Reactor final {
+ public:
+  // Gets the received bytes (empty - the client is disconnected). Returns false to stop the reading. It's called on the
+  // thread of the reactor, so it must not block for long.
+  using HandlerType = std::function<bool(std::span<const std::uint8_t>)>;
+
+ private:
+  // The wait timeout: the poll picks up the added sockets and the stop
+  static constexpr int WAIT_TIMEOUT_MS = 100;
+
+  struct Entry {
+    HandlerType handler;
+    std::promise<void> stopped{};
+  };
+
+  std::mutex mutex_{};
+  std::unordered_map<SocketType, std::shared_ptr<Entry>> entries_{};
+  std::atomic<bool> stop_{false};
+#ifdef __linux__
+  int epoll_ = epoll_create1(0);
+#endif
+  std::thread thread_{};
+
+  // Returns false if the reading is stopped
+  static bool read(SocketType socket, Entry& entry) {
+    std::array<std::uint8_t, 4096> buffer{};
+    auto size = recv(socket, reinterpret_cast<char*>(buffer.data()), static_cast<int>(buffer.size()), 0);
+
+    if (size <= 0) {
+      entry.handler({});
+
+      return false;
+    }
+
+    return entry.handler({buffer.data(), static_cast<std::size_t>(size)});
+  }
+
+  void remove(SocketType socket) {
+    std::shared_ptr<Entry> entry{};
+
+    {
+      std::lock_guard guard(mutex_);
+
+#ifdef __linux__
+      epoll_ctl(epoll_, EPOLL_CTL_DEL, socket, nullptr);
+#endif
+
+      auto found = entries_.find(socket);
+
+      if (found == entries_.end()) {
+        return;
+      }
+
+      entry = std::move(found->second);
+      entries_.erase(found);
+    }
+
+    entry->stopped.set_value();
+  }
+
+  std::shared_ptr<Entry> find(SocketType socket) {
+    std::lock_guard guard(mutex_);
+    auto found = entries_.find(socket);
+
+    return found == entries_.end() ? nullptr : found->second;
+  }
+
+  void run() {
+#ifdef __linux__
+    std::array<epoll_event, 64> events{};
+
+    while (!stop_) {
+      auto eventsNumber = epoll_wait(epoll_, events.data(), static_cast<int>(events.size()), WAIT_TIMEOUT_MS);
+
+      for (int i = 0; i < eventsNumber; i++) {
+        auto socket = static_cast<SocketType>(events[i].data.fd);
+        auto entry = find(socket);
+
+        if (entry && !read(socket, *entry)) {
+          remove(socket);
+        }
+      }
+    }
+#else
+    std::vector<pollfd> descriptors{};
+
+    while (!stop_) {
+      descriptors.clear();
+
+      {
+        std::lock_guard guard(mutex_);
+
+        for (const auto& [socket, entry] : entries_) {
+          descriptors.push_back(pollfd{socket, POLLIN, 0});
+        }
+      }
+
+      if (descriptors.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{WAIT_TIMEOUT_MS});
+
+        continue;
+      }
+
+#ifdef _WIN32
+      auto eventsNumber = WSAPoll(descriptors.data(), static_cast<ULONG>(descriptors.size()), WAIT_TIMEOUT_MS);
+#else
+      auto eventsNumber = poll(descriptors.data(), descriptors.size(), WAIT_TIMEOUT_MS);
+#endif
+
+      for (std::size_t i = 0; eventsNumber > 0 && i < descriptors.size(); i++) {
+        if (descriptors[i].revents == 0) {
+          continue;
+        }
+
+        auto entry = find(descriptors[i].fd);
+
+        if (entry && !read(descriptors[i].fd, *entry)) {
+          remove(descriptors[i].fd);
+        }
+      }
+    }
+#endif
+  }
+
+ public:
+  Reactor() : thread_{[this] { run(); }} {}
+
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+
+  ~Reactor() {
+    stop_ = true;
+    thread_.join();
+#ifdef __linux__
+    close(epoll_);
+#endif
+  }
+
+  // Starts the reading of the socket. The future is ready when the reading is stopped (the disconnect or the handler),
+  // then the socket can be closed.
+  std::future<void> add(SocketType socket, HandlerType handler) {
+    auto entry = std::make_shared<Entry>(Entry{std::move(handler)});
+    auto result = entry->stopped.get_future();
+    std::lock_guard guard(mutex_);
+
+    entries_[socket] = std::move(entry);
+
+#ifdef __linux__
+    epoll_event event{};
+
+    event.events = EPOLLIN;
+    event.data.fd = socket;
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, socket, &event);
+#endif
+
+    return result;
+  }
+};
+
+// Reads the data of the client by the reactor (if any) or by the thread of the client and calls the handler (see
+// Reactor::HandlerType). The future is ready when the reading is stopped.
+std::future<void> readClient(Reactor* reactor, SocketType client, Reactor::HandlerType handler) {
+  if (reactor != nullptr) {
+    return reactor->add(client, std::move(handler));
+  }
+
+  return std::async(std::launch::async, [client, handler = std::move(handler)] {
+    std::array<std::uint8_t, 4096> buffer{};
+
+    for (;;) {
+      auto size = recv(client, reinterpret_cast<char*>(buffer.data()), static_cast<int>(buffer.size()), 0);
+
+      if (size <= 0) {
+        handler({});
+
+        return;
+      }
+
+      if (!handler({buffer.data(), static_cast<std::size_t>(size)})) {
+        return;
+      }
+    }
+  });
+}
+
+// Reads and ignores the data of the client (the subscription, the heartbeats) until it's disconnected
+std::future<void> drainClient(Reactor* reactor, SocketType client, std::atomic<bool>& isConnected) {
+  return readClient(reactor, client, [&isConnected](std::span<const std::uint8_t> data) {
+    if (data.empty()) {
+      isConnected = false;
+    }
+
+    return true;
+  });
+}
+
+std::int64_t nowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+    .count();
+}
+
+enum RecordId : std::int32_t { TRADE = 0, QUOTE = 1, TIME_AND_SALE = 2, ORDER = 3 };
+
+// The records as the C API describes them (the names of the fields are matched by the C API)
+const std::vector<dxf::qtp::RecordDescription> RECORDS{
+  {TRADE,
+   "Trade",
+   {{"Last.Time", dxf::qtp::FieldType::TIME_SECONDS},
+    {"Last.Sequence", dxf::qtp::FieldType::SEQUENCE},
+    {"Last.Exchange", dxf::qtp::FieldType::UTF_CHAR},
+    {"Last.Price", dxf::qtp::FieldType::DECIMAL},
+    {"Last.Size", dxf::qtp::FieldType::DECIMAL}}},
+  {QUOTE,
+   "Quote",
+   {{"Sequence", dxf::qtp::FieldType::SEQUENCE},
+    {"Bid.Time", dxf::qtp::FieldType::TIME_SECONDS},
+    {"Bid.Exchange", dxf::qtp::FieldType::UTF_CHAR},
+    {"Bid.Price", dxf::qtp::FieldType::DECIMAL},
+    {"Bid.Size", dxf::qtp::FieldType::DECIMAL},
+    {"Ask.Time", dxf::qtp::FieldType::TIME_SECONDS},
+    {"Ask.Exchange", dxf::qtp::FieldType::UTF_CHAR},
+    {"Ask.Price", dxf::qtp::FieldType::DECIMAL},
+    {"Ask.Size", dxf::qtp::FieldType::DECIMAL}}},
+  {TIME_AND_SALE,
+   "TimeAndSale",
+   {{"Time", dxf::qtp::FieldType::TIME_SECONDS},
+    {"Sequence", dxf::qtp::FieldType::SEQUENCE},
+    {"Exchange", dxf::qtp::FieldType::UTF_CHAR},
+    {"Price", dxf::qtp::FieldType::DECIMAL},
+    {"Size", dxf::qtp::FieldType::DECIMAL},
+    {"Bid.Price", dxf::qtp::FieldType::DECIMAL},
+    {"Ask.Price", dxf::qtp::FieldType::DECIMAL},
+    {"ExchangeSaleConditions", dxf::qtp::FieldType::SHORT_STRING},
+    {"Flags", dxf::qtp::FieldType::COMPACT_INT},
+    {"Buyer", dxf::qtp::FieldType::UTF_CHAR_ARRAY},
+    {"Seller", dxf::qtp::FieldType::UTF_CHAR_ARRAY}}},
+  {ORDER,
+   "Order",
+   {{"Index", dxf::qtp::FieldType::COMPACT_INT},
+    {"Time", dxf::qtp::FieldType::TIME_SECONDS},
+    {"Sequence", dxf::qtp::FieldType::SEQUENCE},
+    {"Price", dxf::qtp::FieldType::DECIMAL},
+    {"Size", dxf::qtp::FieldType::DECIMAL},
+    {"Count", dxf::qtp::FieldType::COMPACT_INT},
+    {"Flags", dxf::qtp::FieldType::COMPACT_INT}}},
+};
+
+struct FeedConfig {
+  std::vector<std::string> symbols{};
+  // The records of the types that are sent (the indexes are the record ids)
+  std::vector<RecordId> recordIds{};
+  // Records per second, 0 - as fast as possible
+  std::uint64_t rate = 0;
+  std::size_t recordsPerMessage = 100;
+};
+
+// The synthetic state of the symbol: the price walks by the cents, the records of every type are numbered contiguously
+struct SymbolState {
+  double price = 100.0;
+  std::array<std::int32_t, 4> sequences{};
+  std::int32_t nextOrderIndex = 0;
+};
+
+// Generates the records of the symbols in turn. Every message has the records of one type.
+class FeedGenerator {
+  const FeedConfig& config_;
+  std::vector<SymbolState> states_;
+  std::size_t nextSymbol_ = 0;
+  std::mt19937_64 rng_{42};
+
+  static dxf::qtp::MessageType getMessageType(RecordId recordId) {
+    switch (recordId) {
+      case TIME_AND_SALE:
+        return dxf::qtp::MessageType::STREAM_DATA;
+      case ORDER:
+        return dxf::qtp::MessageType::HISTORY_DATA;
+      default:
+        return dxf::qtp::MessageType::TICKER_DATA;
+    }
+  }
+
+  void writeRecord(dxf::qtp::Output& body, RecordId recordId, std::int32_t seconds, std::int32_t millis) {
+    auto& state = states_[nextSymbol_];
+    const auto& symbol = config_.symbols[nextSymbol_];
+    // The milliseconds of the time in the highest bits of the sequence
+    auto sequence = (millis << 22) | (state.sequences[recordId]++ & 0x3FFFFF);
+    auto size = static_cast<double>(1 + rng_() % 100);
+
+    nextSymbol_ = (nextSymbol_ + 1) % states_.size();
+    state.price = (std::max)(1.0, state.price + static_cast<double>(static_cast<int>(rng_() % 3) - 1) * 0.01);
+    dxf::qtp::Composer::writeRecordHeader(body, symbol, recordId);
+
+    switch (recordId) {
+      case TRADE:
+        body.writeCompactInt(seconds);
+        body.writeCompactInt(sequence);
+        body.writeUtfChar('Q');
+        body.writeDecimal(state.price);
+        body.writeDecimal(size);
+        break;
+      case QUOTE:
+        body.writeCompactInt(sequence);
+        body.writeCompactInt(seconds);
+        body.writeUtfChar('Q');
+        body.writeDecimal(state.price - 0.01);
+        body.writeDecimal(size);
+        body.writeCompactInt(seconds);
+        body.writeUtfChar('Q');
+        body.writeDecimal(state.price + 0.01);
+        body.writeDecimal(size);
+        break;
+      case TIME_AND_SALE:
+        body.writeCompactInt(seconds);
+        body.writeCompactInt(sequence);
+        body.writeUtfChar('Q');
+        body.writeDecimal(state.price);
+        body.writeDecimal(size);
+        body.writeDecimal(state.price - 0.01);
+        body.writeDecimal(state.price + 0.01);
+        // No sale conditions, the flags, the null buyer and seller
+        body.writeCompactInt(0);
+        body.writeCompactInt(0);
+        body.writeCompactInt(-1);
+        body.writeCompactInt(-1);
+        break;
+      case ORDER: {
+        // The new orders of the 1000 indexes per symbol, so the older orders are replaced. The side is in the bits 2-3
+        // of the flags (1 - buy, 2 - sell), the scope is in the bits 0-1 (3 - order).
+        auto isBuy = (rng_() & 1U) == 0;
+
+        body.writeCompactInt(state.nextOrderIndex++ % 1000);
+        body.writeCompactInt(seconds);
+        body.writeCompactInt(sequence);
+        body.writeDecimal(isBuy ? state.price - 0.01 * static_cast<double>(1 + rng_() % 10)
+                                : state.price + 0.01 * static_cast<double>(1 + rng_() % 10));
+        body.writeDecimal(size);
+        body.writeCompactInt(1);
+        body.writeCompactInt(((isBuy ? 1 : 2) << 2) | 3);
+        break;
+      }
+    }
+  }
+
+ public:
+  explicit FeedGenerator(const FeedConfig& config) : config_{config}, states_(config.symbols.size()) {}
+
+  // Composes the message of the records of the type. Returns the number of the records.
+  std::size_t composeMessage(dxf::qtp::Composer& composer, RecordId recordId) {
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+                 .count();
+    auto seconds = static_cast<std::int32_t>(now / 1000);
+    auto millis = static_cast<std::int32_t>(now % 1000);
+    auto& body = composer.beginMessage(getMessageType(recordId));
+
+    for (std::size_t i = 0; i < config_.recordsPerMessage; i++) {
+      writeRecord(body, recordId, seconds, millis);
+    }
+
+    composer.endMessage();
+
+    return config_.recordsPerMessage;
+  }
+};
+
+// The records of the synthetic feed or the bytes of the capture and the replay
+std::atomic<std::uint64_t> sentCounter{0};
+
+// Sends the descriptions, then the records until the client is disconnected. The data of the client (the
+// subscription, the heartbeats) is read and ignored: all the symbols are sent.
+void serveClient(SocketType client, const FeedConfig& config, Reactor* reactor) {
+  dxf::qtp::Composer composer{};
+
+  composer.composeDescribeProtocol(
+    {dxf::qtp::MessageType::HEARTBEAT, dxf::qtp::MessageType::DESCRIBE_PROTOCOL,
+     dxf::qtp::MessageType::DESCRIBE_RECORDS, dxf::qtp::MessageType::TICKER_DATA, dxf::qtp::MessageType::STREAM_DATA,
+     dxf::qtp::MessageType::HISTORY_DATA},
+    {dxf::qtp::MessageType::HEARTBEAT, dxf::qtp::MessageType::DESCRIBE_PROTOCOL,
+     dxf::qtp::MessageType::DESCRIBE_RECORDS, dxf::qtp::MessageType::TICKER_ADD_SUBSCRIPTION,
+     dxf::qtp::MessageType::TICKER_REMOVE_SUBSCRIPTION, dxf::qtp::MessageType::STREAM_ADD_SUBSCRIPTION,
+     dxf::qtp::MessageType::STREAM_REMOVE_SUBSCRIPTION, dxf::qtp::MessageType::HISTORY_ADD_SUBSCRIPTION,
+     dxf::qtp::MessageType::HISTORY_REMOVE_SUBSCRIPTION});
+  composer.composeDescribeRecords(RECORDS);
+
+  std::atomic<bool> isConnected = sendAll(client, composer.getOutput().getData());
+  auto reader = drainClient(reactor, client, isConnected);
+
+  FeedGenerator generator{config};
+  auto start = std::chrono::steady_clock::now();
+  auto lastHeartbeat = start;
+  std::uint64_t records = 0;
+
+  while (isConnected) {
+    composer.clear();
+
+    for (auto recordId : config.recordIds) {
+      records += generator.composeMessage(composer, recordId);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (now - lastHeartbeat >= std::chrono::seconds{1}) {
+      composer.composeHeartbeat();
+      lastHeartbeat = now;
+    }
+
+    if (!sendAll(client, composer.getOutput().getData())) {
+      break;
+    }
+
+    sentCounter += config.recordIds.size() * config.recordsPerMessage;
+
+    // The records are sent in time with the rate
+    if (config.rate != 0) {
+      std::this_thread::sleep_until(start + std::chrono::nanoseconds{records * 1000000000ULL / config.rate});
+    }
+  }
+
+  shutdownSocket(client);
+  reader.wait();
+  closeSocket(client);
+}
+
+// Connects to the <host>:<port> address. receiveBufferSize - SO_RCVBUF of the socket (0 - the system default), it is
+// set before the connection so the TCP window scale follows it. Returns INVALID_SOCKET_VALUE if the connection fails.
+SocketType connectTo(const std::string& address, int receiveBufferSize = 0) {
+  auto separator = address.rfind(':');
+
+  if (separator == std::string::npos) {
+    return INVALID_SOCKET_VALUE;
+  }
+
+  auto host = address.substr(0, separator);
+  auto port = address.substr(separator + 1);
+  addrinfo hints{};
+  addrinfo* addresses = nullptr;
+
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+    return INVALID_SOCKET_VALUE;
+  }
+
+  auto result = INVALID_SOCKET_VALUE;
+
+  for (auto* a = addresses; a != nullptr && result == INVALID_SOCKET_VALUE; a = a->ai_next) {
+    result = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+
+    if (result != INVALID_SOCKET_VALUE && receiveBufferSize > 0) {
+      setsockopt(result, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&receiveBufferSize),
+                 sizeof(receiveBufferSize));
+    }
+
+    if (result != INVALID_SOCKET_VALUE && connect(result, a->ai_addr, static_cast<int>(a->ai_addrlen)) != 0) {
+      closeSocket(result);
+      result = INVALID_SOCKET_VALUE;
+    }
+  }
+
+  freeaddrinfo(addresses);
+
+  return result;
+}
+
+struct CaptureConfig {
+  std::string upstreamAddress{};
+  // SO_RCVBUF of the upstream socket (0 - the system default)
+  int receiveBufferSize = 0;
+  // The size of the receive ring, it bounds the bytes read per wakeup
+  std::size_t ringSize = 1U << 20U;
+  // The tape times are the kernel receive timestamps of the upstream socket (SO_TIMESTAMPNS, Linux)
+  bool useKernelTimestamps = false;
+#if FEED_SERVER_TLS
+  // If set, the upstream connection is TLS (see dxf::tls::Connection)
+  std::shared_ptr<dxf::tls::Context> tlsContext{};
+#endif
+};
+
+// Enables the kernel receive timestamps of the socket (the time the data has been received by the network stack, see
+// receiveAvailable). Returns false if they are not supported.
+bool enableReceiveTimestamps(SocketType socket) {
+#ifdef SO_TIMESTAMPNS
+  int isEnabled = 1;
+
+  return setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPNS, &isEnabled, sizeof(isEnabled)) == 0;
+#else
+  static_cast<void>(socket);
+
+  return false;
+#endif
+}
+
+// Receives into the span by one call. The receiveTime is the kernel receive timestamp of the received data (ns since
+// the epoch) if they are enabled (enableReceiveTimestamps), otherwise 0.
+std::ptrdiff_t receiveTimestamped(SocketType socket, std::span<std::uint8_t> space, std::int64_t& receiveTime) {
+  receiveTime = 0;
+
+#ifdef SO_TIMESTAMPNS
+  iovec buffer{space.data(), space.size()};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(timespec))];
+  msghdr message{};
+
+  message.msg_iov = &buffer;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  auto size = recvmsg(socket, &message, 0);
+
+  for (auto header = CMSG_FIRSTHDR(&message); size > 0 && header != nullptr; header = CMSG_NXTHDR(&message, header)) {
+    if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_TIMESTAMPNS) {
+      timespec time{};
+
+      std::memcpy(&time, CMSG_DATA(header), sizeof(time));
+      receiveTime = static_cast<std::int64_t>(time.tv_sec) * 1'000'000'000 + time.tv_nsec;
+    }
+  }
+
+  return size;
+#else
+  return recv(socket, reinterpret_cast<char*>(space.data()), static_cast<int>(space.size()), 0);
+#endif
+}
+
+// Receives the available bytes of the socket into the span: blocks until the first bytes, then reads without blocking
+// until the socket is drained or the span is full, so the burst is read by the few calls and processed once. Returns
+// the size (<= 0 - the disconnect or the error) and adds the number of the calls to the receivesNumber. The
+// receiveTime is the kernel receive timestamp of the first read (0 - the timestamps are not enabled).
+std::ptrdiff_t receiveAvailable(SocketType socket, std::span<std::uint8_t> space, std::uint64_t& receivesNumber,
+                                std::int64_t& receiveTime) {
+  auto size = receiveTimestamped(socket, space, receiveTime);
+
+  receivesNumber++;
+
+  if (size <= 0) {
+    return size;
+  }
+
+  std::size_t result = static_cast<std::size_t>(size);
+
+#ifdef MSG_DONTWAIT
+  while (result < space.size()) {
+    size = recv(socket, reinterpret_cast<char*>(space.data() + result), static_cast<int>(space.size() - result),
+                MSG_DONTWAIT);
+    receivesNumber++;
+
+    if (size <= 0) {
+      // Drained (EAGAIN), the disconnect is returned by the next blocking call
+      break;
+    }
+
+    result += static_cast<std::size_t>(size);
+  }
+#endif
+
+  return static_cast<std::ptrdiff_t>(result);
+}
+
+// Forwards the bytes of the client to the upstream server and the bytes of the server back to the client. The bytes
+// of the server are written to the tape with the time of their receipt.
+void captureClient(SocketType client, const CaptureConfig& config, const std::string& tapeFileName, Reactor* reactor) {
+  const auto& upstreamAddress = config.upstreamAddress;
+  auto upstream = connectTo(upstreamAddress, config.receiveBufferSize);
+  auto* file = upstream != INVALID_SOCKET_VALUE ? std::fopen(tapeFileName.c_str(), "wb") : nullptr;
+
+  if (file == nullptr) {
+    std::cerr << "Can't connect to " << upstreamAddress << " or create the tape " << tapeFileName << "\n";
+
+    if (upstream != INVALID_SOCKET_VALUE) {
+      closeSocket(upstream);
+    }
+
+    closeSocket(client);
+
+    return;
+  }
+
+#if FEED_SERVER_TLS
+  // The bytes of the server are decrypted into the ring (by the kernel with kTLS)
+  std::unique_ptr<dxf::tls::Connection> tls{};
+
+  if (config.tlsContext != nullptr) {
+    tls = dxf::tls::Connection::connect(*config.tlsContext, static_cast<int>(upstream),
+                                        upstreamAddress.substr(0, upstreamAddress.rfind(':')));
+
+    if (tls == nullptr) {
+      std::cerr << "TLS handshake with " << upstreamAddress << " failed: " << dxf::tls::getLastError() << "\n";
+      std::fclose(file);
+      closeSocket(upstream);
+      closeSocket(client);
+
+      return;
+    }
+
+    fmt::print("TLS: {}\n", tls->getDescription());
+  }
+
+  auto sendUpstream = [upstream, tls = tls.get()](std::span<const std::uint8_t> data) {
+    return tls != nullptr ? tls->sendAll(data.data(), data.size()) : sendAll(upstream, data.data(), data.size());
+  };
+#else
+  auto sendUpstream = [upstream](std::span<const std::uint8_t> data) {
+    return sendAll(upstream, data.data(), data.size());
+  };
+#endif
+
+  fmt::print("Capturing {} to {}\n", upstreamAddress, tapeFileName);
+
+  auto forwarder = readClient(reactor, client, [upstream, sendUpstream](std::span<const std::uint8_t> data) {
+    if (data.empty() || !sendUpstream(data)) {
+      shutdownSocket(upstream);
+
+      return false;
+    }
+
+    return true;
+  });
+
+  dxf::qtp::TapeWriter writer{file};
+  // The server bytes are received into the ring and framed in place (the message counts of the capture)
+  dxf::qtp::ReceiveRing ring{config.ringSize};
+  std::array<std::uint64_t, 64> messageCounts{};
+  std::uint64_t otherMessagesNumber = 0;
+  // The records of the data messages are decoded by the descriptions of the server
+  dxf::qtp::RecordDecoder decoder{};
+  std::vector<std::uint64_t> recordCounts{};
+  std::uint64_t undecodedMessagesNumber = 0;
+  // The body of the message that wraps around the end of the ring
+  std::vector<std::uint8_t> wrappedBody{};
+  std::uint64_t receivesNumber = 0;
+  std::uint64_t receivedBytes = 0;
+  // The delays from the kernel receipt of the batch to the end of its processing (forwarded, written and framed)
+#if FEED_SERVER_TLS
+  // OpenSSL reads the socket, the control messages are not received
+  auto useKernelTimestamps = config.useKernelTimestamps && tls == nullptr && enableReceiveTimestamps(upstream);
+#else
+  auto useKernelTimestamps = config.useKernelTimestamps && enableReceiveTimestamps(upstream);
+#endif
+  dxf::LatencyHistogram processingDelays{};
+
+  if (config.useKernelTimestamps && !useKernelTimestamps) {
+    std::cerr << "The kernel receive timestamps are not supported, the tape has the times of the reads\n";
+  }
+
+  for (;;) {
+    auto space = ring.getWritableSpace();
+    std::int64_t kernelTime = 0;
+#if FEED_SERVER_TLS
+    auto size = tls != nullptr ? tls->receive(space, receivesNumber)
+                               : receiveAvailable(upstream, space, receivesNumber, kernelTime);
+#else
+    auto size = receiveAvailable(upstream, space, receivesNumber, kernelTime);
+#endif
+
+    if (size <= 0) {
+      break;
+    }
+
+    auto receiveTime = kernelTime != 0 ? kernelTime : nowNanos();
+
+    writer.write(receiveTime, space.data(), static_cast<std::uint32_t>(size));
+
+    if (!sendAll(client, space.data(), static_cast<std::size_t>(size))) {
+      break;
+    }
+
+    ring.commit(static_cast<std::size_t>(size));
+    receivedBytes += static_cast<std::uint64_t>(size);
+    ring.forEachMessage([&](const dxf::qtp::MessageView& message) {
+      auto index = static_cast<std::size_t>(message.type + 1);
+
+      if (index < messageCounts.size()) {
+        messageCounts[index]++;
+      } else {
+        otherMessagesNumber++;
+      }
+
+      auto type = static_cast<dxf::qtp::MessageType>(message.type);
+
+      if (type != dxf::qtp::MessageType::DESCRIBE_RECORDS && type != dxf::qtp::MessageType::TICKER_DATA &&
+          type != dxf::qtp::MessageType::STREAM_DATA && type != dxf::qtp::MessageType::HISTORY_DATA) {
+        return;
+      }
+
+      auto body = message.first;
+
+      if (!message.second.empty()) {
+        wrappedBody.assign(message.first.begin(), message.first.end());
+        wrappedBody.insert(wrappedBody.end(), message.second.begin(), message.second.end());
+        body = wrappedBody;
+      }
+
+      auto isDecoded =
+        type == dxf::qtp::MessageType::DESCRIBE_RECORDS
+          ? decoder.describe(dxf::qtp::Input{body})
+          : decoder.decodeData(dxf::qtp::Input{body}, [&recordCounts](const auto& record, auto, auto) {
+              auto id = static_cast<std::size_t>(record.id);
+
+              if (id >= recordCounts.size()) {
+                recordCounts.resize(id + 1);
+              }
+
+              recordCounts[id]++;
+            });
+
+      if (!isDecoded) {
+        undecodedMessagesNumber++;
+      }
+    });
+    sentCounter += static_cast<std::uint64_t>(size);
+
+    if (kernelTime != 0) {
+      processingDelays.record(static_cast<std::uint64_t>((std::max)(nowNanos() - kernelTime, std::int64_t{0})));
+    }
+  }
+
+  fmt::print("Captured messages of {}:", tapeFileName);
+
+  for (std::size_t index = 0; index < messageCounts.size(); index++) {
+    if (messageCounts[index] == 0) {
+      continue;
+    }
+
+    auto type = static_cast<int>(index) - 1;
+    auto name = type < 0 ? std::string_view{"EMPTY_HEARTBEAT"}
+                         : dxf::qtp::Composer::getName(static_cast<dxf::qtp::MessageType>(type));
+
+    fmt::print(" {}={}", name.empty() ? std::to_string(type) : std::string{name}, messageCounts[index]);
+  }
+
+  fmt::print("{}{}\n", otherMessagesNumber == 0 ? "" : fmt::format(" other={}", otherMessagesNumber),
+             ring.isSynchronized() ? "" : " (the framing is lost: the message is larger than the ring)");
+  fmt::print("Decoded records:");
+
+  for (std::size_t id = 0; id < recordCounts.size(); id++) {
+    if (recordCounts[id] != 0) {
+      fmt::print(" {}={}", decoder.findRecord(static_cast<std::int32_t>(id))->name, recordCounts[id]);
+    }
+  }
+
+  fmt::print("{}\n",
+             undecodedMessagesNumber == 0 ? "" : fmt::format(" (undecoded messages: {})", undecodedMessagesNumber));
+  if (auto delays = processingDelays.getSnapshot(); delays.count != 0) {
+    fmt::print("Kernel receive to processed: p50 {} ns, p99 {} ns, p99.9 {} ns, max {} ns of {} reads\n",
+               delays.getPercentile(50.0), delays.getPercentile(99.0), delays.getPercentile(99.9), delays.max,
+               delays.count);
+  }
+
+  fmt::print("Received {} bytes by {} calls ({:.1f} calls per MB)\n", receivedBytes, receivesNumber,
+             receivedBytes == 0 ? 0.0 : static_cast<double>(receivesNumber) * 1048576.0 / receivedBytes);
+
+#if FEED_SERVER_TLS
+  if (tls != nullptr) {
+    tls->shutdown();
+  }
+#endif
+
+  shutdownSocket(client);
+  shutdownSocket(upstream);
+  forwarder.wait();
+  std::fclose(file);
+#if FEED_SERVER_TLS
+  tls.reset();
+#endif
+  closeSocket(upstream);
+  closeSocket(client);
+}
+
+// Sends the chunks of the tape at the original pacing divided by the speed (0 - as fast as possible). Then sends the
+// heartbeats until the client is disconnected.
+void replayClient(SocketType client, const std::string& tapeFileName, double speed, Reactor* reactor) {
+  auto* file = std::fopen(tapeFileName.c_str(), "rb");
+
+  if (file == nullptr) {
+    std::cerr << "Can't open the tape " << tapeFileName << "\n";
+    closeSocket(client);
+
+    return;
+  }
+
+  dxf::qtp::TapeReader reader{file};
+  std::atomic<bool> isConnected = reader.isValid();
+  auto drainer = drainClient(reactor, client, isConnected);
+  std::vector<std::uint8_t> chunk{};
+  std::int64_t receiveTime = 0;
+  std::int64_t firstReceiveTime = 0;
+  std::uint64_t chunks = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  if (!reader.isValid()) {
+    std::cerr << "Not a tape: " << tapeFileName << "\n";
+  }
+
+  while (isConnected && reader.read(receiveTime, chunk)) {
+    if (chunks++ == 0) {
+      firstReceiveTime = receiveTime;
+    }
+
+    if (speed > 0.0) {
+      std::this_thread::sleep_until(
+        start + std::chrono::nanoseconds{static_cast<std::int64_t>(static_cast<double>(receiveTime - firstReceiveTime) /
+                                                                   speed)});
+    }
+
+    if (!sendAll(client, chunk)) {
+      isConnected = false;
+
+      break;
+    }
+
+    sentCounter += chunk.size();
+  }
+
+  std::fclose(file);
+
+  if (isConnected) {
+    fmt::print("Replayed {} chunks in {:.3f} s\n", chunks,
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  dxf::qtp::Composer composer{};
+
+  composer.composeHeartbeat();
+
+  while (isConnected && sendAll(client, composer.getOutput().getData())) {
+    std::this_thread::sleep_for(std::chrono::seconds{1});
+  }
+
+  shutdownSocket(client);
+  drainer.wait();
+  closeSocket(client);
+}
+
+// Listens the port of the loopback interface. Returns INVALID_SOCKET_VALUE if the port can't be listened.
+SocketType listenLoopback(std::uint16_t port) {
+  auto server = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+
+  if (server == INVALID_SOCKET_VALUE) {
+    return server;
+  }
+
+  setsockopt(server, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+  sockaddr_in address{};
+
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+
+  if (bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(server, 16) != 0) {
+    closeSocket(server);
+
+    return INVALID_SOCKET_VALUE;
+  }
+
+  return server;
+}
+
+#if FEED_SERVER_TLS
+// The receive side of one run of the transport benchmark
+struct TransportBenchResult {
+  double seconds = 0.0;
+  std::uint64_t bytes = 0;
+  std::uint64_t messages = 0;
+  std::uint64_t receives = 0;
+  std::string description{};
+};
+
+// Sends the chunk of the messages chunksNumber times to the client of the listener and receives the stream into the
+// receive ring (framed in place) as the capture proxy does. The connection is TLS if the contexts are set.
+TransportBenchResult runTransport(SocketType listener, std::uint16_t port, const std::vector<std::uint8_t>& chunk,
+                                  std::size_t chunksNumber, const dxf::tls::Context* serverContext,
+                                  const dxf::tls::Context* clientContext) {
+  std::promise<void> received{};
+  auto sender = std::async(std::launch::async, [&, isReceived = received.get_future()] {
+    auto client = accept(listener, nullptr, nullptr);
+
+    if (client == INVALID_SOCKET_VALUE) {
+      return;
+    }
+
+    auto tls = serverContext != nullptr ? dxf::tls::Connection::accept(*serverContext, static_cast<int>(client))
+                                        : nullptr;
+
+    for (std::size_t i = 0; i < chunksNumber && (serverContext == nullptr || tls != nullptr); i++) {
+      if (!(tls != nullptr ? tls->sendAll(chunk.data(), chunk.size()) : sendAll(client, chunk))) {
+        break;
+      }
+    }
+
+    // The unread bytes of the receiver are not reset by the close
+    isReceived.wait();
+    tls.reset();
+    closeSocket(client);
+  });
+
+  TransportBenchResult result{};
+  auto upstream = connectTo(fmt::format("127.0.0.1:{}", port));
+  auto tls = clientContext != nullptr && upstream != INVALID_SOCKET_VALUE
+               ? dxf::tls::Connection::connect(*clientContext, static_cast<int>(upstream), "localhost")
+               : nullptr;
+  auto total = static_cast<std::uint64_t>(chunk.size()) * chunksNumber;
+  dxf::qtp::ReceiveRing ring{1U << 20U};
+  auto start = std::chrono::steady_clock::now();
+
+  while (upstream != INVALID_SOCKET_VALUE && (clientContext == nullptr || tls != nullptr) && result.bytes < total) {
+    auto space = ring.getWritableSpace();
+    std::int64_t kernelTime = 0;
+    auto size = tls != nullptr ? tls->receive(space, result.receives)
+                               : receiveAvailable(upstream, space, result.receives, kernelTime);
+
+    if (size <= 0) {
+      break;
+    }
+
+    ring.commit(static_cast<std::size_t>(size));
+    result.bytes += static_cast<std::uint64_t>(size);
+    result.messages += ring.forEachMessage([](const dxf::qtp::MessageView&) {});
+  }
+
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.description = tls != nullptr ? tls->getDescription() : std::string("plain TCP");
+  received.set_value();
+  sender.wait();
+  tls.reset();
+
+  if (upstream != INVALID_SOCKET_VALUE) {
+    closeSocket(upstream);
+  }
+
+  return result;
+}
+
+// Compares the receive of the synthetic stream over the loopback by the plain TCP and by TLS (with the kernel offload
+// if the kernel supports it)
+int runTlsBench(std::uint16_t port, std::size_t megabytes, bool isTls12Only) {
+  FeedConfig feed{};
+
+  for (std::size_t i = 0; i < 100; i++) {
+    feed.symbols.push_back(fmt::format("SYM{}", i));
+  }
+
+  feed.recordIds = {TRADE, QUOTE, TIME_AND_SALE, ORDER};
+
+  // The chunk of about 1 MB of the complete messages is sent repeatedly
+  FeedGenerator generator{feed};
+  dxf::qtp::Composer composer{};
+
+  while (composer.getOutput().getSize() < (1U << 20U)) {
+    for (auto recordId : feed.recordIds) {
+      generator.composeMessage(composer, recordId);
+    }
+  }
+
+  const auto& chunk = composer.getOutput().getData();
+  auto chunksNumber = (std::max)(megabytes * 1048576 / chunk.size(), std::size_t{1});
+  auto listener = listenLoopback(port);
+  auto serverContext = dxf::tls::Context::createSelfSignedServer(isTls12Only);
+  auto clientContext = dxf::tls::Context::createClient({}, isTls12Only);
+
+  if (listener == INVALID_SOCKET_VALUE || serverContext == nullptr || clientContext == nullptr) {
+    std::cerr << "Can't listen the port " << port << " or create the TLS contexts\n";
+
+    return 1;
+  }
+
+  fmt::print("{:<48} {:>10} {:>12} {:>14} {:>12}\n", "Transport", "MB/s", "messages/s", "calls per MB", "MB");
+
+  auto report = [&](const TransportBenchResult& result) {
+    auto mb = static_cast<double>(result.bytes) / 1048576.0;
+
+    fmt::print("{:<48} {:>10.1f} {:>12.0f} {:>14.1f} {:>12.1f}\n", result.description, mb / result.seconds,
+               static_cast<double>(result.messages) / result.seconds,
+               mb == 0.0 ? 0.0 : static_cast<double>(result.receives) / mb, mb);
+  };
+
+  report(runTransport(listener, port, chunk, chunksNumber, nullptr, nullptr));
+  report(runTransport(listener, port, chunk, chunksNumber, serverContext.get(), clientContext.get()));
+  closeSocket(listener);
+
+  return 0;
+}
+#endif
+
+// The mode of the server and its options
+struct ServerConfig {
+  enum class Mode { SYNTHETIC, CAPTURE, REPLAY, TLS_BENCH };
+
+  Mode mode = Mode::SYNTHETIC;
+  FeedConfig feed{};
+  CaptureConfig capture{};
+  std::string tapeFileName{};
+  // The speed of the replay: 1 - the original pacing, 0 - as fast as possible
+  double speed = 1.0;
+  // The data of the clients is read by the shared reactor instead of the thread per client
+  bool isReactorUsed = false;
+  // The TLS versions are limited to TLS 1.2 (the receive offload of the older OpenSSL versions)
+  bool isTls12Only = false;
+  // The size of the stream of the TLS benchmark
+  std::size_t benchMegabytes = 1024;
+};
+
+int main(int argc, char* argv[]) {
+  if (argc < 3 || std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help") {
+    std::cout << "Usage:\n  feed-server <port> <number of symbols> [rate=<records per second>] "
+                 "[types=<type>[,<type>...]] [records=<records per message>] [reactor]\n"
+                 "  feed-server <port> capture=<host>:<port> <tape file> [rcvbuf=<bytes>] [ring=<bytes>] "
+                 "[timestamps] [tls] [tls-ca=<file>] [tls12] [reactor]\n"
+                 "  feed-server <port> replay=<tape file> [speed=<N>|speed=max] [reactor]\n"
+                 "  feed-server <port> tls-bench [mb=<megabytes>] [tls12]\n\n";
+
+    return 0;
+  }
+
+  auto port = static_cast<std::uint16_t>(std::stoul(argv[1]));
+  auto modeArgument = std::string(argv[2]);
+  ServerConfig config{};
+
+  config.isReactorUsed = std::find(argv + 3, argv + argc, std::string("reactor")) != argv + argc;
+  config.isTls12Only = std::find(argv + 3, argv + argc, std::string("tls12")) != argv + argc;
+
+  if (modeArgument.starts_with("capture=")) {
+    if (argc < 4) {
+      std::cerr << "No tape file\n";
+
+      return 1;
+    }
+
+    config.mode = ServerConfig::Mode::CAPTURE;
+    config.capture.upstreamAddress = modeArgument.substr(8);
+    config.tapeFileName = argv[3];
+
+    for (int i = 4; i < argc; i++) {
+      auto option = std::string(argv[i]);
+
+      if (option.starts_with("rcvbuf=")) {
+        config.capture.receiveBufferSize = std::stoi(option.substr(7));
+      } else if (option.starts_with("ring=")) {
+        config.capture.ringSize = (std::max)(std::stoull(option.substr(5)), 4096ULL);
+      } else if (option == "timestamps") {
+        config.capture.useKernelTimestamps = true;
+      } else if (option == "tls" || option.starts_with("tls-ca=")) {
+#if FEED_SERVER_TLS
+        auto caFile = option == "tls" ? std::string{} : option.substr(7);
+
+        config.capture.tlsContext = dxf::tls::Context::createClient(caFile, config.isTls12Only);
+
+        if (config.capture.tlsContext == nullptr) {
+          std::cerr << "Can't create the TLS context: " << dxf::tls::getLastError() << "\n";
+
+          return 1;
+        }
+#else
+        std::cerr << "feed-server is built without TLS\n";
+
+        return 1;
+#endif
+      }
+    }
+  } else if (modeArgument == "tls-bench") {
+    config.mode = ServerConfig::Mode::TLS_BENCH;
+
+    for (int i = 3; i < argc; i++) {
+      auto option = std::string(argv[i]);
+
+      if (option.starts_with("mb=")) {
+        config.benchMegabytes = (std::max)(std::stoull(option.substr(3)), 1ULL);
+      }
+    }
+  } else if (modeArgument.starts_with("replay=")) {
+    config.mode = ServerConfig::Mode::REPLAY;
+    config.tapeFileName = modeArgument.substr(7);
+
+    for (int i = 3; i < argc; i++) {
+      auto option = std::string(argv[i]);
+
+      if (option == "speed=max") {
+        config.speed = 0.0;
+      } else if (option.starts_with("speed=")) {
+        config.speed = (std::max)(std::stod(option.substr(6)), 0.001);
+      }
+    }
+  } else {
+    auto symbolsNumber = (std::max)(std::stoull(modeArgument), 1ULL);
+
+    for (std::size_t i = 0; i < symbolsNumber; i++) {
+      config.feed.symbols.push_back(fmt::format("SYM{}", i));
+    }
+
+    config.feed.recordIds = {TRADE, QUOTE, TIME_AND_SALE, ORDER};
+
+    for (int i = 3; i < argc; i++) {
+      auto option = std::string(argv[i]);
+
+      if (option.starts_with("rate=")) {
+        config.feed.rate = std::stoull(option.substr(5));
+      } else if (option.starts_with("records=")) {
+        config.feed.recordsPerMessage = (std::max)(std::stoull(option.substr(8)), 1ULL);
+      } else if (option.starts_with("types=")) {
+        config.feed.recordIds.clear();
+
+        for (const auto& record : RECORDS) {
+          if (option.find(record.name, 6) != std::string::npos) {
+            config.feed.recordIds.push_back(static_cast<RecordId>(record.id));
+          }
+        }
+      }
+    }
+
+    if (config.feed.recordIds.empty()) {
+      std::cerr << "No record types\n";
+
+      return 1;
+    }
+  }
+
+#ifdef _WIN32
+  WSADATA wsaData{};
+
+  WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+
+#if FEED_SERVER_TLS && !defined(_WIN32)
+  // OpenSSL writes the socket without MSG_NOSIGNAL
+  std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+  if (config.mode == ServerConfig::Mode::TLS_BENCH) {
+#if FEED_SERVER_TLS
+    return runTlsBench(port, config.benchMegabytes, config.isTls12Only);
+#else
+    std::cerr << "feed-server is built without TLS\n";
+
+    return 1;
+#endif
+  }
+
+  auto reactor = config.isReactorUsed ? std::make_unique<Reactor>() : nullptr;
+  auto server = listenLoopback(port);
+
+  if (server == INVALID_SOCKET_VALUE) {
+    std::cerr << "Can't listen the port " << port << "\n";
+
+    return 1;
+  }
+
+  switch (config.mode) {
+    case ServerConfig::Mode::SYNTHETIC:
+      fmt::print("Listening 127.0.0.1:{}, symbols: SYM0..SYM{}, record types: {}, rate: {}\n", port,
+                 config.feed.symbols.size() - 1, config.feed.recordIds.size(),
+                 config.feed.rate == 0 ? std::string("max") : std::to_string(config.feed.rate));
+      break;
+    case ServerConfig::Mode::CAPTURE:
+      fmt::print("Listening 127.0.0.1:{}, capturing {} to {}\n", port, config.capture.upstreamAddress,
+                 config.tapeFileName);
+      break;
+    case ServerConfig::Mode::REPLAY:
+      fmt::print("Listening 127.0.0.1:{}, replaying {} at {}\n", port, config.tapeFileName,
+                 config.speed == 0.0 ? std::string("max speed") : fmt::format("{}x speed", config.speed));
+      break;
+    case ServerConfig::Mode::TLS_BENCH:
+      break;
+  }
+
+  auto reporter = std::thread([unit = config.mode == ServerConfig::Mode::SYNTHETIC ? "records" : "bytes"] {
+    std::uint64_t previous = 0;
+
+    while (true) {
+      std::this_thread::sleep_for(std::chrono::seconds{1});
+
+      auto current = sentCounter.load();
+
+      if (current != previous) {
+        fmt::print("Sent: {} {} per second\n", current - previous, unit);
+      }
+
+      previous = current;
+    }
+  });
+
+  reporter.detach();
+
+  for (std::size_t clientsNumber = 0;;) {
+    auto client = accept(server, nullptr, nullptr);
+
+    if (client == INVALID_SOCKET_VALUE) {
+      continue;
+    }
+
+    int noDelay = 1;
+
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+    fmt::print("Client connected\n");
+
+    // The tapes of the next clients of the capture are numbered: <tape file>.2, <tape file>.3, ...
+    auto tapeFileName =
+      ++clientsNumber == 1 ? config.tapeFileName : fmt::format("{}.{}", config.tapeFileName, clientsNumber);
+
+    std::thread([client, &config, tapeFileName, reactor = reactor.get()] {
+      switch (config.mode) {
+        case ServerConfig::Mode::SYNTHETIC:
+          serveClient(client, config.feed, reactor);
+          break;
+        case ServerConfig::Mode::CAPTURE:
+          captureClient(client, config.capture, tapeFileName, reactor);
+          break;
+        case ServerConfig::Mode::REPLAY:
+          replayClient(client, config.tapeFileName, config.speed, reactor);
+          break;
+        case ServerConfig::Mode::TLS_BENCH:
+          break;
+      }
+
+      fmt::print("Client disconnected\n");
+    }).detach();
+  }
+}
@@ -0,0 +1,310 @@
+#include <DXFeed.h>
+#include <fmt/format.h>
+
+#include <IpfSymbolUniverse.hpp>
+#include <MulticastFeed.hpp>
+#include <PriceLevelBook.hpp>
+#include <SymbolSubscription.hpp>
+#include <SymbolTable.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+std::vector<std::string> splitList(const std::string &list) {
+  std::vector<std::string> result{};
+  std::size_t begin = 0;
+
+  while (begin <= list.size()) {
+    auto end = std::min(list.find(',', begin), list.size());
+
+    if (end > begin) {
+      result.emplace_back(list.substr(begin, end - begin));
+    }
+
+    begin = end + 1;
+  }
+
+  return result;
+}
+
+std::vector<std::string> readSymbols(const std::string &argument) {
+  if (!argument.starts_with("ipf=")) {
+    return splitList(argument);
+  }
+
+  auto file = argument.substr(4);
+  auto separator = file.rfind('@');
+  auto filter =
+    separator == std::string::npos ? dxf::IpfSymbolFilter{} : dxf::IpfSymbolFilter::parse(file.substr(separator + 1));
+  auto universe = dxf::IpfSymbolUniverse::load(file.substr(0, separator), filter);
+
+  return universe ? universe->getNames() : std::vector<std::string>{};
+}
+
+// Parses the <address>:<port> of the group 0 and the options that are common to both modes
+bool parseConfig(const std::string &groupAddress, int argc, char *argv[], int firstOption,
+                 dxf::MulticastFeedConfig &config, std::vector<std::string> &sources, std::size_t &levelsNumber,
+                 bool &withQuotes, bool &withTrades) {
+  auto separator = groupAddress.rfind(':');
+
+  if (separator == std::string::npos) {
+    return false;
+  }
+
+  config.groupAddress = groupAddress.substr(0, separator);
+  config.port = static_cast<std::uint16_t>(std::stoi(groupAddress.substr(separator + 1)));
+
+  for (int i = firstOption; i < argc; i++) {
+    auto option = std::string(argv[i]);
+
+    if (option.rfind("groups=", 0) == 0) {
+      config.groupsNumber = static_cast<std::uint32_t>(std::stoul(option.substr(7)));
+    } else if (option.rfind("sources=", 0) == 0) {
+      sources = splitList(option.substr(8));
+    } else if (option.rfind("interface=", 0) == 0) {
+      config.interfaceAddress = option.substr(10);
+    } else if (option.rfind("ttl=", 0) == 0) {
+      config.ttl = std::stoi(option.substr(4));
+    } else if (option.rfind("requests=", 0) == 0) {
+      config.requestPort = static_cast<std::uint16_t>(std::stoi(option.substr(9)));
+    } else if (option.rfind("publisher=", 0) == 0) {
+      auto publisher = option.substr(10);
+      auto portSeparator = publisher.rfind(':');
+
+      config.publisherAddress = publisher.substr(0, portSeparator);
+
+      if (portSeparator != std::string::npos) {
+        config.requestPort = static_cast<std::uint16_t>(std::stoi(publisher.substr(portSeparator + 1)));
+      }
+    } else if (option.rfind("levels=", 0) == 0) {
+      levelsNumber = std::stoull(option.substr(7));
+    } else if (option == "quotes") {
+      withQuotes = true;
+    } else if (option == "trades") {
+      withTrades = true;
+    }
+  }
+
+  return true;
+}
+
+// The book of the upstream connection that is relayed
+struct RelayedBook {
+  dxf::MulticastPublisher *publisher;
+  std::string symbol;
+  std::string source;
+  dxf_snapshot_t snapshot = nullptr;
+};
+
+int publish(const std::string &endpoint, const std::vector<std::string> &symbols,
+            const dxf::MulticastFeedConfig &config, const std::vector<std::string> &sources, bool withQuotes,
+            bool withTrades) {
+  dxf::MulticastPublisher publisher{config};
+
+  if (!publisher.isOpen()) {
+    std::cerr << "Can't open the multicast sockets: " << config.groupAddress << ":" << config.port << "\n";
+
+    return 1;
+  }
+
+  dxf_connection_t connection = nullptr;
+
+  if (dxf_create_connection(endpoint.c_str(), nullptr, nullptr, nullptr, nullptr, nullptr, &connection) ==
+      DXF_FAILURE) {
+    std::cerr << "Can't connect to " << endpoint << "\n";
+
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<RelayedBook>> books{};
+
+  for (const auto &symbol : symbols) {
+    for (const auto &source : sources) {
+      auto &book = books.emplace_back(new RelayedBook{&publisher, symbol, source});
+      const auto &wSymbol = dxf::Symbol::valueOf(symbol).getWideName();
+
+      if (dxf_create_order_snapshot(connection, wSymbol.c_str(), source.c_str(), 0, &book->snapshot) ==
+          DXF_FAILURE) {
+        std::cerr << "Can't create the order snapshot: " << symbol << "@" << source << "\n";
+        books.pop_back();
+
+        continue;
+      }
+
+      dxf_attach_snapshot_inc_listener(
+        book->snapshot,
+        [](const dxf_snapshot_data_ptr_t snapshot_data, int new_snapshot, void *user_data) {
+          auto *relayed = static_cast<RelayedBook *>(user_data);
+
+          relayed->publisher->publishOrders(relayed->symbol, relayed->source,
+                                            static_cast<const dxf_order_t *>(snapshot_data->records),
+                                            snapshot_data->records_count, new_snapshot != 0);
+          relayed->publisher->flush();
+        },
+        book.get());
+    }
+  }
+
+  dxf_subscription_t subscription = nullptr;
+  auto eventTypes = (withQuotes ? DXF_ET_QUOTE : 0) | (withTrades ? DXF_ET_TRADE : 0);
+
+  if (eventTypes != 0) {
+    if (dxf_create_subscription(connection, eventTypes, &subscription) == DXF_FAILURE) {
+      std::cerr << "Can't create the subscription of the quotes and the trades\n";
+    } else {
+      dxf_attach_event_listener(
+        subscription,
+        [](int event_type, dxf_const_string_t symbol_name, const dxf_event_data_t *data, int data_count,
+           void *user_data) {
+          auto *relayPublisher = static_cast<dxf::MulticastPublisher *>(user_data);
+          const auto &symbol = dxf::Symbol::valueOf(std::wstring_view{symbol_name}).getName();
+
+          for (int i = 0; i < data_count; i++) {
+            if (event_type == DXF_ET_QUOTE) {
+              relayPublisher->publishQuote(symbol, reinterpret_cast<const dxf_quote_t *>(data)[i]);
+            } else if (event_type == DXF_ET_TRADE) {
+              relayPublisher->publishTrade(symbol, reinterpret_cast<const dxf_trade_t *>(data)[i]);
+            }
+          }
+
+          relayPublisher->flush();
+        },
+        &publisher);
+      dxf::SymbolSubscription::addSymbols(subscription, symbols);
+    }
+  }
+
+  std::atomic<bool> stop{false};
+  std::thread printer([&] {
+    while (!stop.load(std::memory_order_relaxed)) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+
+      auto stats = publisher.getStats();
+
+      fmt::print("Packets: {}, records: {}, skipped: {}, retransmitted: {}, unavailable: {}, snapshots: {}\n",
+                 stats.packetsNumber, stats.recordsNumber, stats.skippedNumber, stats.retransmittedNumber,
+                 stats.unavailableNumber, stats.snapshotsNumber);
+    }
+  });
+
+  std::cin.get();
+  stop.store(true, std::memory_order_relaxed);
+  printer.join();
+
+  if (subscription != nullptr) {
+    dxf_close_subscription(subscription);
+  }
+
+  for (const auto &book : books) {
+    dxf_close_snapshot(book->snapshot);
+  }
+
+  dxf_close_connection(connection);
+
+  return 0;
+}
+
+int receive(const std::vector<std::string> &symbols, const dxf::MulticastFeedConfig &config,
+            const std::vector<std::string> &sources, std::size_t levelsNumber) {
+  dxf::MulticastReceiver receiver{config, symbols};
+  std::vector<dxf::PriceLevelBook *> books{};
+  std::atomic<std::uint64_t> quotesNumber{0};
+  std::atomic<std::uint64_t> tradesNumber{0};
+
+  for (const auto &symbol : symbols) {
+    for (const auto &source : sources) {
+      books.push_back(receiver.createBook(symbol, source, levelsNumber));
+    }
+  }
+
+  receiver.setQuoteSink([&quotesNumber](std::size_t, const dxf::Symbol &, const dxf_quote_t *, std::size_t count) {
+    quotesNumber.fetch_add(count, std::memory_order_relaxed);
+  });
+  receiver.setTradeSink([&tradesNumber](std::size_t, const dxf::Symbol &, const dxf_trade_t *, std::size_t count) {
+    tradesNumber.fetch_add(count, std::memory_order_relaxed);
+  });
+
+  if (!receiver.start()) {
+    std::cerr << "Can't join the multicast groups: " << config.groupAddress << ":" << config.port << "\n";
+
+    return 1;
+  }
+
+  std::atomic<bool> stop{false};
+  std::thread printer([&] {
+    while (!stop.load(std::memory_order_relaxed)) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+
+      auto stats = receiver.getStats();
+
+      fmt::print("Packets: {}, records: {}, quotes: {}, trades: {}, gaps: {}, retransmitted: {}, lost: {}, "
+                 "snapshot requests: {}, dropped: {}\n",
+                 stats.packetsNumber, stats.recordsNumber, quotesNumber.load(std::memory_order_relaxed),
+                 tradesNumber.load(std::memory_order_relaxed), stats.gapsNumber, stats.retransmittedNumber,
+                 stats.lostNumber, stats.snapshotRequestsNumber, stats.droppedNumber);
+
+      if (!books.empty()) {
+        auto top = books.front()->getTopOfBook();
+
+        fmt::print("  {}@{}: bid {:.6g} x {:.6g}, ask {:.6g} x {:.6g}\n", books.front()->getSymbol(),
+                   books.front()->getSource(), top.bid.price, top.bid.size, top.ask.price, top.ask.size);
+      }
+    }
+  });
+
+  std::cin.get();
+  stop.store(true, std::memory_order_relaxed);
+  printer.join();
+  receiver.stop();
+
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  auto mode = argc > 1 ? std::string(argv[1]) : std::string();
+
+  if ((mode != "publish" || argc < 5) && (mode != "receive" || argc < 4)) {
+    std::cout << "Usage:\n"
+                 "  mc-relay publish <endpoint> <symbol>[,<symbol>...] | ipf=<file>[@<filter>] <group address>:<port> "
+                 "[groups=<N>] [sources=<source>[,<source>...]] [interface=<address>] [ttl=<N>] "
+                 "[requests=<port>] [quotes] [trades]\n"
+                 "  mc-relay receive <group address>:<port> <symbol>[,<symbol>...] | ipf=<file>[@<filter>] "
+                 "[groups=<N>] [sources=<source>[,<source>...]] [interface=<address>] "
+                 "[publisher=<host>[:<port>]] [levels=<N>]\n\n";
+
+    return 0;
+  }
+
+  auto config = dxf::MulticastFeedConfig{};
+  auto sources = std::vector<std::string>{"NTV"};
+  std::size_t levelsNumber = 10;
+  auto withQuotes = false;
+  auto withTrades = false;
+  auto isPublisher = mode == "publish";
+  auto symbols = readSymbols(argv[3]);
+
+  if (symbols.empty()) {
+    std::cerr << "No symbols: " << argv[3] << "\n";
+
+    return 1;
+  }
+
+  if (!parseConfig(argv[isPublisher ? 4 : 2], argc, argv, isPublisher ? 5 : 4, config, sources, levelsNumber,
+                   withQuotes, withTrades)) {
+    std::cerr << "Invalid group address: " << argv[isPublisher ? 4 : 2] << "\n";
+
+    return 1;
+  }
+
+  if (isPublisher) {
+    return publish(argv[2], symbols, config, sources, withQuotes, withTrades);
+  }
+
+  return receive(symbols, config, sources, levelsNumber);
+}
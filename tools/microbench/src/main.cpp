@@ -0,0 +1,1241 @@
+#include <DXFeed.h>
+#include <EventData.h>
+#include <fmt/format.h>
+
+#include <CandleSymbol.hpp>
+#include <EventDispatcher.hpp>
+#include <EventProjection.hpp>
+#include <EventRing.hpp>
+#include <MemoryPool.hpp>
+#include <Metrics.hpp>
+#include <MpscQueue.hpp>
+#include <PriceLevelBook.hpp>
+#include <PriceLevelBookEngine.hpp>
+#include <RecordBufferPool.hpp>
+#include <RegionalBook.hpp>
+#include <StringConverter.hpp>
+#include <SymbolCache.hpp>
+#include <SymbolIndex.hpp>
+#include <SymbolPerfectHash.hpp>
+#include <SymbolTable.hpp>
+#include <TimeAndSale.hpp>
+#include <TimeAndSaleBars.hpp>
+#include <TimeAndSaleData.hpp>
+#include <TimeAndSaleVolumeProfile.hpp>
+#include <TscClock.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "QtpDecimal.hpp"
+#include "QtpInput.hpp"
+#include "SnapshotKey.hpp"
+
+// The number of the heap allocations made by the process (the allocations/op of the benchmarks)
+std::atomic<std::uint64_t> allocationsNumber{0};
+
+void* operator new(std::size_t size) {
+  allocationsNumber.fetch_add(1, std::memory_order_relaxed);
+
+  if (auto* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+
+  throw std::bad_alloc{};
+}
+
+// The default operator delete releases the memory with std::free
+
+struct Measurement {
+  double seconds = 0.0;
+  std::uint64_t allocations = 0;
+  std::size_t operations = 0;
+};
+
+// The sum of the results of the operations (printed, so the operations are not optimized out)
+std::size_t checksum = 0;
+
+// Runs the operation (op(i) returns a number that is added to the checksum) the 1/10 of the iterations to warm up (the
+// caches, the thread-local buffers), then measures the iterations
+template <typename Op>
+Measurement measure(std::size_t iterations, Op&& op) {
+  for (std::size_t i = 0; i < iterations / 10; i++) {
+    checksum += op(i);
+  }
+
+  auto allocationsBefore = allocationsNumber.load(std::memory_order_relaxed);
+  auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = 0; i < iterations; i++) {
+    checksum += op(i);
+  }
+
+  Measurement result{};
+
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.allocations = allocationsNumber.load(std::memory_order_relaxed) - allocationsBefore;
+  result.operations = iterations;
+
+  return result;
+}
+
+// The allocation budgets of the hot paths: the maximum allocations/op of the benchmark. The budget file has the lines
+// "<maximum allocations/op> <benchmark name>" (the name is the rest of the line, "#" starts the comment).
+using AllocationBudgets = std::map<std::string, double, std::less<>>;
+
+bool loadAllocationBudgets(const std::string& fileName, AllocationBudgets& budgets) {
+  std::ifstream file{fileName};
+
+  if (!file) {
+    return false;
+  }
+
+  for (std::string line{}; std::getline(file, line);) {
+    auto begin = line.find_first_not_of(" \t\r");
+
+    if (begin == std::string::npos || line[begin] == '#') {
+      continue;
+    }
+
+    auto end = line.find_first_of(" \t", begin);
+    auto nameBegin = end == std::string::npos ? std::string::npos : line.find_first_not_of(" \t", end);
+
+    if (nameBegin == std::string::npos) {
+      return false;
+    }
+
+    auto nameEnd = line.find_last_not_of(" \t\r");
+
+    try {
+      budgets[line.substr(nameBegin, nameEnd + 1 - nameBegin)] = std::stod(line.substr(begin, end - begin));
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+class Microbench {
+  std::string filter_;
+  std::size_t iterations_;
+  AllocationBudgets budgets_;
+  // The budgets that are exceeded (or not measured) by the run
+  std::vector<std::string> violations_{};
+  std::vector<std::string> reportedNames_{};
+
+ public:
+  Microbench(std::string filter, std::size_t iterations, AllocationBudgets budgets = {})
+      : filter_{std::move(filter)}, iterations_{iterations}, budgets_{std::move(budgets)} {}
+
+  [[nodiscard]] bool isEnabled(std::string_view name) const {
+    return filter_.empty() || name.find(filter_) != std::string_view::npos;
+  }
+
+  [[nodiscard]] std::size_t getIterations() const { return iterations_; }
+
+  // Prints the measurement and checks its allocation budget (if any)
+  void report(const std::string& name, const Measurement& measurement) {
+    auto operations = static_cast<double>(measurement.operations == 0 ? 1 : measurement.operations);
+    auto allocationsPerOp = static_cast<double>(measurement.allocations) / operations;
+    auto budget = budgets_.find(name);
+
+    fmt::print("{:<40} {:>12} {:>12.1f} {:>12.3f}", name, measurement.operations,
+               measurement.seconds * 1e9 / operations, allocationsPerOp);
+    reportedNames_.push_back(name);
+
+    if (budget == budgets_.end()) {
+      fmt::print("\n");
+
+      return;
+    }
+
+    // The budgets are the allocations/op, so the last digit of the printed value is not compared
+    auto isExceeded = allocationsPerOp > budget->second + 0.0005;
+
+    fmt::print(" {:>12.3f}{}\n", budget->second, isExceeded ? " FAIL" : "");
+
+    if (isExceeded) {
+      violations_.push_back(fmt::format("{}: {:.3f} allocs/op > {:.3f}", name, allocationsPerOp, budget->second));
+    }
+  }
+
+  // Prints that the benchmark can't run on this CPU (e.g. the kernel of the other architecture), its budget is not
+  // checked
+  void reportUnsupported(const std::string& name) {
+    fmt::print("{:<40} {:>12}\n", name, "unsupported");
+    reportedNames_.push_back(name);
+  }
+
+  template <typename Op>
+  void run(const std::string& name, Op&& op) {
+    if (isEnabled(name)) {
+      report(name, measure(iterations_, std::forward<Op>(op)));
+    }
+  }
+
+  // Returns the exceeded budgets and the budgets of the enabled benchmarks that were not run (e.g. renamed)
+  [[nodiscard]] std::vector<std::string> getViolations() const {
+    auto result = violations_;
+
+    for (const auto& [name, budget] : budgets_) {
+      if (isEnabled(name) && std::find(reportedNames_.begin(), reportedNames_.end(), name) == reportedNames_.end()) {
+        result.push_back(fmt::format("{}: not measured", name));
+      }
+    }
+
+    return result;
+  }
+};
+
+void benchStringConverter(Microbench& bench) {
+  const std::vector<std::pair<std::string, std::string>> strings{
+    {"symbol", "AAPL"},
+    {"candle symbol", "AAPL{=5m,tho=true,a=s,price=bid}"},
+    {"non-ASCII", "Привет, мир! €100"},
+  };
+
+  for (const auto& [kind, utf8] : strings) {
+    auto wString = dxf::StringConverter::utf8ToWString(utf8);
+    std::wstring reusedWString{};
+    std::string reusedString{};
+
+    bench.run("utf8ToWString/" + kind,
+              [&utf8 = utf8](std::size_t) { return dxf::StringConverter::utf8ToWString(utf8).size(); });
+    bench.run("utf8ToWString(reused)/" + kind, [&utf8 = utf8, &reusedWString](std::size_t) {
+      return static_cast<std::size_t>(dxf::StringConverter::utf8ToWString(utf8, reusedWString));
+    });
+    bench.run("utf8ToWStringView/" + kind,
+              [&utf8 = utf8](std::size_t) { return dxf::StringConverter::utf8ToWStringView(utf8).size(); });
+    bench.run("wStringToUtf8/" + kind,
+              [&wString](std::size_t) { return dxf::StringConverter::wStringToUtf8(wString).size(); });
+    bench.run("wStringToUtf8(reused)/" + kind, [&wString, &reusedString](std::size_t) {
+      return static_cast<std::size_t>(dxf::StringConverter::wStringToUtf8(wString, reusedString));
+    });
+    bench.run("wStringToUtf8View/" + kind,
+              [&wString](std::size_t) { return dxf::StringConverter::wStringToUtf8View(wString).size(); });
+  }
+
+  bench.run("wCharToUtf8", [](std::size_t i) {
+    return static_cast<std::size_t>(dxf::StringConverter::wCharToUtf8(static_cast<wchar_t>(L'A' + (i & 15U))));
+  });
+}
+
+// The compact trade of the consumer that needs only the price, the size and the time (see dxf::project)
+struct ProjectedTrade {
+  double price;
+  double size;
+  dxf_long_t time;
+
+  using Projection = dxf::project<&dxf_time_and_sale_t::price, &dxf_time_and_sale_t::size, &dxf_time_and_sale_t::time>;
+};
+
+void benchTimeAndSale(Microbench& bench) {
+  dxf_time_and_sale_t tns{};
+
+  tns.index = 1;
+  tns.time = 1600000000000;
+  tns.exchange_code = L'Q';
+  tns.price = 100.25;
+  tns.size = 100;
+  tns.bid_price = 100.0;
+  tns.ask_price = 100.5;
+  tns.exchange_sale_conditions = L"@TI";
+  tns.buyer = L"";
+  tns.seller = L"";
+  tns.trade_through_exempt = L'X';
+
+  std::string symbol = "AAPL";
+  auto internedSymbol = dxf::Symbol::valueOf(std::string_view{symbol});
+
+  bench.run("TimeAndSale(std::string)", [&](std::size_t i) {
+    tns.index = static_cast<dxf_long_t>(i);
+
+    return static_cast<std::size_t>(dxf::TimeAndSale(symbol, tns).getIndex());
+  });
+  bench.run("TimeAndSale(Symbol)", [&](std::size_t i) {
+    tns.index = static_cast<dxf_long_t>(i);
+
+    return static_cast<std::size_t>(dxf::TimeAndSale(internedSymbol, tns).getIndex());
+  });
+  bench.run("TimeAndSale(projected)", [&](std::size_t i) {
+    tns.time = static_cast<dxf_long_t>(i);
+
+    return static_cast<std::size_t>(ProjectedTrade::Projection::to<ProjectedTrade>(tns).time);
+  });
+}
+
+// Generates the synthetic order flow around the price of 100.0: the first transaction is the snapshot, the rest are
+// the incremental updates (additions, modifications and removals of orders)
+std::vector<std::vector<dxf_order_t>> generateOrderFlow(std::size_t transactionsNumber,
+                                                        std::size_t recordsPerTransaction,
+                                                        std::size_t snapshotOrdersNumber) {
+  std::mt19937_64 rng{42};
+  std::geometric_distribution<int> distanceDistribution{0.1};
+  std::uniform_int_distribution<int> sizeDistribution{1, 100};
+  std::uniform_int_distribution<int> actionDistribution{0, 99};
+
+  std::vector<dxf_order_t> liveOrders{};
+  dxf_long_t nextIndex = 1;
+
+  auto newOrder = [&]() {
+    dxf_order_t order{};
+    auto side = (rng() & 1) == 0 ? dxf_osd_buy : dxf_osd_sell;
+    auto distance = 1 + distanceDistribution(rng);
+
+    order.index = nextIndex++;
+    order.side = side;
+    order.price = side == dxf_osd_buy ? 100.0 - distance * 0.01 : 100.0 + distance * 0.01;
+    order.size = sizeDistribution(rng);
+
+    return order;
+  };
+
+  std::vector<std::vector<dxf_order_t>> flow(1);
+
+  for (std::size_t i = 0; i < snapshotOrdersNumber; i++) {
+    liveOrders.push_back(newOrder());
+    flow[0].push_back(liveOrders.back());
+  }
+
+  for (std::size_t t = 0; t < transactionsNumber; t++) {
+    auto& transaction = flow.emplace_back();
+
+    for (std::size_t r = 0; r < recordsPerTransaction; r++) {
+      auto action = actionDistribution(rng);
+
+      if (liveOrders.empty() || action < 40) {
+        liveOrders.push_back(newOrder());
+        transaction.push_back(liveOrders.back());
+      } else {
+        auto position = static_cast<std::size_t>(rng() % liveOrders.size());
+        auto order = liveOrders[position];
+
+        if (action < 70) {
+          order.size = sizeDistribution(rng);
+          liveOrders[position] = order;
+        } else {
+          order.event_flags = dxf_ef_remove_event;
+          liveOrders[position] = liveOrders.back();
+          liveOrders.pop_back();
+        }
+
+        transaction.push_back(order);
+      }
+    }
+  }
+
+  return flow;
+}
+
+// Measures the convert and the apply steps of every incremental transaction separately (the op is the transaction)
+template <typename Engine>
+void benchPriceLevelBookEngine(Microbench& bench, const std::string& name,
+                               const std::vector<std::vector<dxf_order_t>>& flow) {
+  if (!bench.isEnabled(name)) {
+    return;
+  }
+
+  Engine engine{10};
+  Measurement convert{};
+  Measurement apply{};
+
+  engine.applyUpdates(engine.convertToUpdates(flow[0].data(), flow[0].size()));
+
+  for (std::size_t i = 1; i < flow.size(); i++) {
+    auto allocationsBefore = allocationsNumber.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+    const auto& updates = engine.convertToUpdates(flow[i].data(), flow[i].size());
+    auto converted = std::chrono::steady_clock::now();
+    auto allocationsConverted = allocationsNumber.load(std::memory_order_relaxed);
+    const auto& changes = engine.applyUpdates(updates);
+    auto applied = std::chrono::steady_clock::now();
+
+    convert.seconds += std::chrono::duration<double>(converted - start).count();
+    convert.allocations += allocationsConverted - allocationsBefore;
+    apply.seconds += std::chrono::duration<double>(applied - converted).count();
+    apply.allocations += allocationsNumber.load(std::memory_order_relaxed) - allocationsConverted;
+    checksum += changes.additions.asks.size() + changes.additions.bids.size() + changes.updates.asks.size() +
+                changes.updates.bids.size() + changes.removals.asks.size() + changes.removals.bids.size();
+  }
+
+  convert.operations = apply.operations = flow.size() - 1;
+  bench.report(name + "/convertToUpdates", convert);
+  bench.report(name + "/applyUpdates", apply);
+}
+
+// The static listener of the book benchmark (unlike the std::function handlers, it never allocates)
+struct ChangesChecksumListener {
+  void onIncrementalChange(const dxf::PriceLevelChangesSet& changes) {
+    checksum += changes.additions.asks.size() + changes.additions.bids.size() + changes.updates.asks.size() +
+                changes.updates.bids.size() + changes.removals.asks.size() + changes.removals.bids.size();
+  }
+};
+
+// Replays the incremental transactions after the snapshot through PriceLevelBook::processSnapshotData (the synchronous
+// mode, the static listener): the steady state of the whole book path, the op is the transaction
+void benchPriceLevelBook(Microbench& bench, const std::vector<std::vector<dxf_order_t>>& flow) {
+  if (!bench.isEnabled("book/processSnapshotData")) {
+    return;
+  }
+
+  auto plb = dxf::PriceLevelBook::createDetached("", "", 10);
+  ChangesChecksumListener listener{};
+
+  plb->setListener(listener);
+
+  auto process = [&plb](const std::vector<dxf_order_t>& orders, bool newSnapshot) {
+    dxf_snapshot_data_t snapshotData{};
+
+    snapshotData.event_type = dx_eid_order;
+    snapshotData.records_count = orders.size();
+    snapshotData.records = const_cast<dxf_order_t*>(orders.data());
+    plb->processSnapshotData(&snapshotData, newSnapshot ? 1 : 0);
+  };
+
+  process(flow[0], true);
+
+  // The warm-up (the capacities of the buffers of the book)
+  for (std::size_t i = 1; i < flow.size() / 10; i++) {
+    process(flow[i], false);
+  }
+
+  auto allocationsBefore = allocationsNumber.load(std::memory_order_relaxed);
+  auto start = std::chrono::steady_clock::now();
+
+  for (std::size_t i = flow.size() / 10; i < flow.size(); i++) {
+    process(flow[i], false);
+  }
+
+  Measurement measurement{};
+
+  measurement.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  measurement.allocations = allocationsNumber.load(std::memory_order_relaxed) - allocationsBefore;
+  measurement.operations = flow.size() - flow.size() / 10;
+  bench.report("book/processSnapshotData", measurement);
+}
+
+// The compact ints of the mixed sizes (the op is the int), the decimals of the uniform and the mixed power codes (the
+// op is the decimal: the power computed per value vs the tables, the doubles vs the integer ticks) and the records of
+// the data message (the op is the message of 100 Quote-like records): the byte-by-byte reads with the bound checks per
+// field vs the table-driven reads of the unaligned loads with the bound check per record, the dispatch by the
+// description vs the batch of the layout
+void benchQtpDecoding(Microbench& bench) {
+  std::mt19937 rng{42};
+  dxf::qtp::Output ints{};
+
+  for (std::size_t i = 0; i < 65536; i++) {
+    ints.writeCompactInt(static_cast<std::int32_t>(rng()) >> (rng() % 32));
+  }
+
+  // The padding of the unaligned loads of the last ints
+  auto intsEnd = ints.getData().data() + ints.getSize();
+
+  ints.writeInt(0);
+  ints.writeInt(0);
+
+  auto runCompactInts = [&](const std::string& name, auto read) {
+    const auto* data = ints.getData().data();
+
+    bench.run(name, [&](std::size_t) {
+      if (data == intsEnd) {
+        data = ints.getData().data();
+      }
+
+      return static_cast<std::size_t>(read(data));
+    });
+  };
+
+  runCompactInts("qtp/readCompactInt(bytewise)", [](const std::uint8_t*& data) {
+    return dxf::qtp::readCompactIntBytewise(data);
+  });
+  runCompactInts("qtp/readCompactInt(table)", [](const std::uint8_t*& data) {
+    return dxf::qtp::readCompactIntFast(data);
+  });
+
+  // The decimals of the prices: the cents of one power code (uniform) and the mantissas of all the power codes (mixed)
+  std::vector<std::int32_t> uniformDecimals(65536);
+  std::vector<std::int32_t> mixedDecimals(uniformDecimals.size());
+  std::vector<std::int64_t> wideDecimals(uniformDecimals.size());
+
+  for (std::size_t i = 0; i < uniformDecimals.size(); i++) {
+    auto mantissa = static_cast<std::int32_t>(rng() % 1000000);
+
+    uniformDecimals[i] = (mantissa << 4U) | 11;
+    mixedDecimals[i] = (mantissa << 4U) | static_cast<std::int32_t>(1 + rng() % 15);
+    wideDecimals[i] = (static_cast<std::int64_t>(mantissa) << 8U) | static_cast<std::int64_t>(120 + rng() % 16);
+  }
+
+  auto runDecimals = [&](const std::string& name, const std::vector<std::int32_t>& decimals, auto convert) {
+    bench.run(name, [&](std::size_t i) {
+      return static_cast<std::size_t>(convert(decimals[i & (decimals.size() - 1)]));
+    });
+  };
+
+  for (const auto* decimals : {&uniformDecimals, &mixedDecimals}) {
+    std::string kind = decimals == &uniformDecimals ? "uniform" : "mixed";
+
+    runDecimals("qtp/decimalToDouble(pow," + kind + ")", *decimals, dxf::qtp::decimalToDoublePow);
+    runDecimals("qtp/decimalToDouble(table," + kind + ")", *decimals, dxf::qtp::decimalToDouble);
+    runDecimals("qtp/decimalToTicks(" + kind + ")", *decimals, [](std::int32_t decimal) {
+      std::int64_t ticks = 0;
+
+      return dxf::qtp::decimalToTicks(decimal, 6, ticks) ? ticks : 0;
+    });
+  }
+
+  bench.run("qtp/wideDecimalToDouble(table)", [&](std::size_t i) {
+    return static_cast<std::size_t>(dxf::qtp::wideDecimalToDouble(wideDecimals[i & (wideDecimals.size() - 1)]));
+  });
+
+  dxf::qtp::Composer composer{};
+
+  composer.composeDescribeRecords({{1,
+                                    "Quote",
+                                    {{"Sequence", dxf::qtp::FieldType::SEQUENCE},
+                                     {"Bid.Time", dxf::qtp::FieldType::TIME_SECONDS},
+                                     {"Bid.Exchange", dxf::qtp::FieldType::UTF_CHAR},
+                                     {"Bid.Price", dxf::qtp::FieldType::DECIMAL},
+                                     {"Bid.Size", dxf::qtp::FieldType::DECIMAL},
+                                     {"Ask.Time", dxf::qtp::FieldType::TIME_SECONDS},
+                                     {"Ask.Exchange", dxf::qtp::FieldType::UTF_CHAR},
+                                     {"Ask.Price", dxf::qtp::FieldType::DECIMAL},
+                                     {"Ask.Size", dxf::qtp::FieldType::DECIMAL}}}});
+
+  dxf::qtp::RecordDecoder decoder{};
+  const auto* message = composer.getOutput().getData().data();
+  // The length of the type and the body
+  auto length = static_cast<std::size_t>(dxf::qtp::readCompactIntBytewise(message));
+
+  dxf::qtp::readCompactIntBytewise(message);
+  decoder.describe(dxf::qtp::Input{std::span<const std::uint8_t>{message, length - 1}});
+
+  dxf::qtp::Output data{};
+
+  for (std::int32_t i = 0; i < 100; i++) {
+    dxf::qtp::Composer::writeRecordHeader(data, "SYM" + std::to_string(i % 10), 1);
+    data.writeCompactInt(i);
+    data.writeCompactInt(1600000000 + i);
+    data.writeUtfChar('Q');
+    data.writeDecimal(100.0 - 0.01 * i);
+    data.writeDecimal(100 + i);
+    data.writeCompactInt(1600000000 + i);
+    data.writeUtfChar('Q');
+    data.writeDecimal(100.0 + 0.01 * i);
+    data.writeDecimal(200 + i);
+  }
+
+  for (auto isBulk : {false, true}) {
+    bench.run(isBulk ? "qtp/decodeData(bulk)" : "qtp/decodeData(checked)", [&](std::size_t) {
+      std::size_t result = 0;
+
+      decoder.decodeData(
+        dxf::qtp::Input{data.getData()},
+        [&result](const auto&, auto, std::span<const std::int32_t> values) {
+          result += static_cast<std::size_t>(values[3]);
+        },
+        isBulk);
+
+      return result;
+    });
+  }
+
+  using dxf::qtp::FieldType;
+
+  std::vector<dxf::qtp::RecordDecoder::RecordValues<9>> batch{};
+
+  bench.run("qtp/decodeBatch(Quote)", [&](std::size_t) {
+    batch.clear();
+    decoder.decodeBatch<FieldType::SEQUENCE, FieldType::TIME_SECONDS, FieldType::UTF_CHAR, FieldType::DECIMAL,
+                        FieldType::DECIMAL, FieldType::TIME_SECONDS, FieldType::UTF_CHAR, FieldType::DECIMAL,
+                        FieldType::DECIMAL>(dxf::qtp::Input{data.getData()}, 1, batch);
+
+    std::size_t result = 0;
+
+    for (const auto& record : batch) {
+      result += static_cast<std::size_t>(record.values[3]);
+    }
+
+    return result;
+  });
+}
+
+// The queue of the tasks guarded by the mutex: the task per lock (as the Executor)
+class MutexTaskQueue final {
+  std::mutex mutex_{};
+  std::deque<std::function<void()>> tasks_{};
+
+ public:
+  void push(std::function<void()> task) {
+    std::lock_guard guard(mutex_);
+
+    tasks_.push_back(std::move(task));
+  }
+
+  // Runs the queued tasks. Returns the number of the tasks.
+  std::size_t dispatch() {
+    std::size_t result = 0;
+
+    for (;; result++) {
+      std::function<void()> task{};
+
+      {
+        std::lock_guard guard(mutex_);
+
+        if (tasks_.empty()) {
+          return result;
+        }
+
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+
+      task();
+    }
+  }
+};
+
+// The lock-free queue of the tasks: the batch of the tasks per exchange
+class LockFreeTaskQueue final {
+  dxf::MpscQueue<std::function<void()>> tasks_{};
+
+ public:
+  void push(std::function<void()> task) { tasks_.push(std::move(task)); }
+
+  std::size_t dispatch() {
+    return tasks_.popAll([](std::function<void()>& task) { task(); });
+  }
+};
+
+// The handoff of the tasks from the concurrent producers to the dispatching consumer (the op is the task: from the
+// enqueue of the first one to the dispatch of the last one)
+template <typename Queue>
+void benchTaskQueue(Microbench& bench, const std::string& name, std::size_t producersNumber) {
+  if (!bench.isEnabled(name)) {
+    return;
+  }
+
+  Queue queue{};
+  auto tasksNumber = bench.getIterations() / producersNumber * producersNumber;
+  std::atomic<bool> isStarted{false};
+  std::vector<std::thread> producers{};
+
+  for (std::size_t p = 0; p < producersNumber; p++) {
+    producers.emplace_back([&queue, &isStarted, tasksNumber, producersNumber] {
+      while (!isStarted.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+
+      for (std::size_t i = 0; i < tasksNumber / producersNumber; i++) {
+        queue.push([i] { checksum += i & 1U; });
+      }
+    });
+  }
+
+  auto allocationsBefore = allocationsNumber.load(std::memory_order_relaxed);
+  auto start = std::chrono::steady_clock::now();
+
+  isStarted.store(true, std::memory_order_release);
+
+  for (std::size_t dispatched = 0; dispatched < tasksNumber;) {
+    auto size = queue.dispatch();
+
+    if (size == 0) {
+      std::this_thread::yield();
+    }
+
+    dispatched += size;
+  }
+
+  Measurement measurement{};
+
+  measurement.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  measurement.allocations = allocationsNumber.load(std::memory_order_relaxed) - allocationsBefore;
+  measurement.operations = tasksNumber;
+
+  for (auto& producer : producers) {
+    producer.join();
+  }
+
+  bench.report(name, measurement);
+}
+
+void benchSnapshotKey(Microbench& bench) {
+  std::vector<std::wstring> symbols{L"AAPL", L"IBM", L"MSFT{=5m}", L"/ESZ21:XCME"};
+
+  bench.run("dx_new_snapshot_key", [&symbols](std::size_t i) {
+    return static_cast<std::size_t>(
+      dx_new_snapshot_key(dx_rid_candle, symbols[i & (symbols.size() - 1)].c_str(), nullptr));
+  });
+  bench.run("dx_new_snapshot_key(source)", [&symbols](std::size_t i) {
+    return static_cast<std::size_t>(
+      dx_new_snapshot_key(dx_rid_order, symbols[i & (symbols.size() - 1)].c_str(), L"NTV"));
+  });
+}
+
+// The lookups of the listener symbols (the wide names) in the subscription of 50000 symbols (the op is the lookup of the
+// random symbol): the binary search of the sorted names, the map of the interned symbols, the open-addressing index and
+// the cache of the resolved names
+void benchSymbolLookup(Microbench& bench) {
+  constexpr std::size_t SYMBOLS_NUMBER = 50000;
+
+  std::vector<dxf::Symbol> symbols{};
+  std::vector<std::wstring> wSymbols{};
+
+  for (std::size_t i = 0; i < SYMBOLS_NUMBER; i++) {
+    wSymbols.push_back(L"SYM" + std::to_wstring(i));
+    symbols.push_back(dxf::Symbol::valueOf(std::wstring_view{wSymbols.back()}));
+  }
+
+  std::vector<std::pair<std::wstring, std::size_t>> sortedSymbols{};
+  dxf::SymbolMap<std::size_t> symbolMap{};
+  dxf::SymbolIndex symbolIndex{};
+
+  for (std::size_t i = 0; i < SYMBOLS_NUMBER; i++) {
+    sortedSymbols.emplace_back(wSymbols[i], i);
+    symbolMap.emplace(symbols[i], i);
+  }
+
+  std::sort(sortedSymbols.begin(), sortedSymbols.end());
+  symbolIndex.add(symbols);
+
+  std::vector<std::string_view> names{};
+
+  for (const auto& symbol : symbols) {
+    names.push_back(symbol.getName());
+  }
+
+  auto perfectHash = dxf::SymbolPerfectHash::build(names);
+
+  std::vector<std::size_t> order(1U << 16U);
+  std::mt19937_64 rng{42};
+
+  for (auto& position : order) {
+    position = rng() % SYMBOLS_NUMBER;
+  }
+
+  auto getName = [&](std::size_t i) { return std::wstring_view{wSymbols[order[i & (order.size() - 1)]]}; };
+
+  bench.run("symbols/find(sorted)", [&](std::size_t i) {
+    auto name = getName(i);
+    auto found = std::lower_bound(sortedSymbols.begin(), sortedSymbols.end(), name,
+                                  [](const auto& entry, std::wstring_view s) { return entry.first < s; });
+
+    return found != sortedSymbols.end() && found->first == name ? found->second : 0;
+  });
+  bench.run("symbols/find(SymbolMap)", [&](std::size_t i) {
+    auto found = symbolMap.find(getName(i));
+
+    return found != symbolMap.end() ? found->second : 0;
+  });
+  bench.run("symbols/find(SymbolIndex)", [&](std::size_t i) { return symbolIndex.find(getName(i)); });
+  bench.run("symbols/find(SymbolPerfectHash)", [&](std::size_t i) { return perfectHash->find(getName(i)); });
+
+  // The wide name of the C API call (the subscription or the snapshot): converted by every call vs kept by the table
+  auto getSymbol = [&](std::size_t i) { return symbols[order[i & (order.size() - 1)]]; };
+
+  bench.run("symbols/wideName(convert)",
+            [&](std::size_t i) { return dxf::StringConverter::utf8ToWString(getSymbol(i).getName()).size(); });
+  bench.run("symbols/wideName(interned)", [&](std::size_t i) { return getSymbol(i).getWideName().size(); });
+
+  // The resolution of the event symbol as the EventReceiver does it: the cache of the wide names of the working set of
+  // 4096 symbols in front of the index (the hits) vs the interning of the wide name (the unknown symbols)
+  dxf::SymbolCache symbolCache{};
+
+  auto getHotName = [&](std::size_t i) { return std::wstring_view{wSymbols[order[i & (order.size() - 1)] & 4095U]}; };
+
+  bench.run("symbols/valueOf(wstring)", [&](std::size_t i) { return dxf::Symbol::valueOf(getHotName(i)).getHash(); });
+  bench.run("symbols/find(SymbolCache)", [&](std::size_t i) {
+    auto name = getHotName(i);
+
+    return symbolCache.get(name, [&] { return dxf::SymbolCache::Entry{{}, symbolIndex.find(name)}; }).value;
+  });
+
+  if (bench.isEnabled("symbols/find(SymbolCache)")) {
+    fmt::print("{:<40} hit rate: {:.4f}\n", "symbols/find(SymbolCache)", symbolCache.getStats().getHitRate());
+  }
+}
+
+// The regional quotes of 16 exchanges around the price of 100.0 (the op is the update of the random exchange with the
+// recomputation of the composite quote) with the scalar and the AVX2 reductions
+void benchRegionalBook(Microbench& bench) {
+  constexpr std::size_t EXCHANGES_NUMBER = 16;
+
+  struct RegionalQuote {
+    char exchangeCode;
+    double bidPrice;
+    double bidSize;
+    double askPrice;
+    double askSize;
+  };
+
+  std::vector<RegionalQuote> quotes(1U << 16U);
+  std::mt19937_64 rng{42};
+
+  for (auto& quote : quotes) {
+    auto distance = static_cast<double>(rng() % 4) * 0.01;
+
+    quote = {static_cast<char>('A' + rng() % EXCHANGES_NUMBER), 100.0 - distance, static_cast<double>(1 + rng() % 100),
+             100.01 + distance, static_cast<double>(1 + rng() % 100)};
+  }
+
+  auto run = [&](const std::string& name, dxf::RegionalBookStrategy strategy) {
+    if (!bench.isEnabled(name)) {
+      return;
+    }
+
+    dxf::RegionalBook::setStrategy(strategy);
+
+    if (dxf::RegionalBook::getStrategy() != strategy) {
+      bench.reportUnsupported(name);
+
+      return;
+    }
+
+    dxf::RegionalBook book{};
+
+    bench.run(name, [&](std::size_t i) {
+      const auto& quote = quotes[i & (quotes.size() - 1)];
+
+      return static_cast<std::size_t>(
+        book.update(quote.exchangeCode, quote.bidPrice, quote.bidSize, quote.askPrice, quote.askSize));
+    });
+  };
+
+  run("regional/update(scalar)", dxf::RegionalBookStrategy::SCALAR);
+  run("regional/update(avx2)", dxf::RegionalBookStrategy::AVX2);
+  run("regional/update(neon)", dxf::RegionalBookStrategy::NEON);
+  dxf::RegionalBook::setStrategy(dxf::RegionalBook::getSupportedStrategy());
+}
+
+// The attributes of the event candle symbols of 1000 base symbols with 4 periods (the op is the attributes of the
+// random candle symbol): the parse of the string vs the memoised attributes of the interned symbol
+void benchCandleSymbols(Microbench& bench) {
+  auto baseSymbols = std::vector<std::string>{};
+
+  for (std::size_t i = 0; i < 1000; i++) {
+    baseSymbols.push_back("SYM" + std::to_string(i));
+  }
+
+  auto candleSymbols = dxf::CandleSymbol::makeSymbols(baseSymbols, {"=m", "=5m", "=h,price=mark", "=d,tho=true"});
+  std::vector<dxf::Symbol> symbols{};
+  std::vector<std::size_t> order(1U << 16U);
+  std::mt19937_64 rng{42};
+
+  for (const auto& candleSymbol : candleSymbols) {
+    symbols.push_back(dxf::Symbol::valueOf(candleSymbol));
+  }
+
+  for (auto& position : order) {
+    position = rng() % candleSymbols.size();
+  }
+
+  bench.run("candles/parse", [&](std::size_t i) {
+    return static_cast<std::size_t>(
+      dxf::CandleSymbol::parse(candleSymbols[order[i & (order.size() - 1)]]).period.type);
+  });
+  bench.run("candles/valueOf(Symbol)", [&](std::size_t i) {
+    return static_cast<std::size_t>(dxf::CandleSymbol::valueOf(symbols[order[i & (order.size() - 1)]]).period.type);
+  });
+}
+
+// The aggregation of the trades of one symbol to the 1s, 1m and 5m bars (the op is the batch of 16 trades, 1-10 ms
+// apart): the trade by trade update vs the batch runs of the listener data
+void benchTradeBars(Microbench& bench) {
+  constexpr std::size_t BATCH_SIZE = 16;
+  std::vector<dxf_time_and_sale_t> trades(BATCH_SIZE * 1024);
+  std::mt19937_64 rng{42};
+  auto symbol = dxf::Symbol::valueOf(std::string_view{"AAPL"});
+  dxf_long_t time = 1600000000000;
+
+  for (auto& trade : trades) {
+    time += static_cast<dxf_long_t>(1 + rng() % 10);
+    trade.time = time;
+    trade.price = 100.0 + static_cast<double>(rng() % 100) * 0.01;
+    trade.size = static_cast<double>(1 + rng() % 100);
+  }
+
+  auto run = [&](const std::string& name, bool isBatched) {
+    dxf::TimeAndSaleBarAggregator bars{{1000, 60000, 300000}, 60000};
+    dxf_long_t index = 0;
+    dxf_long_t timeShift = 0;
+
+    bench.run(name, [&](std::size_t i) {
+      auto* batch = trades.data() + (i * BATCH_SIZE) % trades.size();
+
+      // The times and the indexes keep growing when the trades repeat
+      if (batch == trades.data() && i != 0) {
+        timeShift += trades.back().time - trades.front().time + 1;
+      }
+
+      for (std::size_t j = 0; j < BATCH_SIZE; j++) {
+        batch[j].index = ++index;
+      }
+
+      if (isBatched) {
+        for (std::size_t j = 0; j < BATCH_SIZE; j++) {
+          batch[j].time += timeShift;
+        }
+
+        bars.update(symbol, batch, BATCH_SIZE);
+
+        for (std::size_t j = 0; j < BATCH_SIZE; j++) {
+          batch[j].time -= timeShift;
+        }
+      } else {
+        for (std::size_t j = 0; j < BATCH_SIZE; j++) {
+          dxf::TimeAndSale trade{symbol, batch[j]};
+
+          trade.setTime(trade.getTime() + static_cast<std::uint64_t>(timeShift));
+          bars.update(symbol, trade);
+        }
+      }
+
+      return static_cast<std::size_t>(bars.getLatestBar(symbol, 0)->count);
+    });
+  };
+
+  run("bars/update(TimeAndSale)", false);
+  run("bars/update(batch)", true);
+}
+
+// The volume profile of one symbol by the batches of 16 trades of the 1000 prices around 100 (the op is the batch): the
+// incremental update of the flat array vs the rescan of the 256 latest trades to the map of the prices after every
+// batch
+void benchVolumeProfile(Microbench& bench) {
+  constexpr std::size_t BATCH_SIZE = 16;
+  constexpr std::size_t RESCAN_SIZE = 256;
+  std::vector<dxf_time_and_sale_t> trades(BATCH_SIZE * 1024);
+  std::mt19937_64 rng{42};
+  auto symbol = dxf::Symbol::valueOf(std::string_view{"AAPL"});
+  dxf_long_t time = 1600000000000;
+
+  for (auto& trade : trades) {
+    time += static_cast<dxf_long_t>(1 + rng() % 10);
+    trade.time = time;
+    trade.price = 95.0 + static_cast<double>(rng() % 1000) * 0.01;
+    trade.size = static_cast<double>(1 + rng() % 100);
+    trade.side = static_cast<dxf_order_side_t>(rng() % 3);
+  }
+
+  dxf::TimeAndSaleVolumeProfileAggregator profiles{0.01, 60000};
+  dxf_long_t index = 0;
+
+  bench.run("profile/update(batch)", [&](std::size_t i) {
+    auto* batch = trades.data() + (i * BATCH_SIZE) % trades.size();
+
+    for (std::size_t j = 0; j < BATCH_SIZE; j++) {
+      batch[j].index = ++index;
+      batch[j].time = time + index;
+    }
+
+    profiles.update(symbol, batch, BATCH_SIZE);
+
+    return static_cast<std::size_t>(profiles.getProfile(symbol)->getTotal().count);
+  });
+
+  std::deque<dxf_time_and_sale_t> latest{};
+
+  bench.run("profile/rescan(256 trades)", [&](std::size_t i) {
+    auto* batch = trades.data() + (i * BATCH_SIZE) % trades.size();
+    std::map<double, std::pair<double, double>> profile{};
+
+    latest.insert(latest.end(), batch, batch + BATCH_SIZE);
+
+    while (latest.size() > RESCAN_SIZE) {
+      latest.pop_front();
+    }
+
+    for (const auto& trade : latest) {
+      auto& volumes = profile[trade.price];
+
+      (trade.side == dxf_osd_buy ? volumes.first : volumes.second) += trade.size;
+    }
+
+    return profile.size();
+  });
+}
+
+// The cost of the connection thread to copy the batch of 16 trades of one of 64 symbols and queue it to one of the 4
+// shards of the EventDispatcher (the handlers run on the workers): as the TimeAndSale objects and as the projections
+void benchEventDispatcher(Microbench& bench) {
+  constexpr std::size_t BATCH_SIZE = 16;
+  constexpr std::size_t SYMBOLS_NUMBER = 64;
+
+  // The recycling of the event buffers of the batches (see RecordBufferPool)
+  dxf::RecordBufferPool<dxf::TimeAndSale> pool{64};
+
+  bench.run("dispatcher/buffers(acquire+release)", [&](std::size_t) {
+    auto buffer = pool.acquire(BATCH_SIZE);
+    auto capacity = buffer.capacity();
+
+    pool.release(std::move(buffer));
+
+    return capacity;
+  });
+
+  if (!bench.isEnabled("dispatcher/dispatch")) {
+    return;
+  }
+
+  std::vector<dxf::Symbol> symbols{};
+  std::vector<dxf_time_and_sale_t> trades(BATCH_SIZE);
+
+  for (std::size_t i = 0; i < SYMBOLS_NUMBER; i++) {
+    symbols.push_back(dxf::Symbol::valueOf("SYM" + std::to_string(i)));
+  }
+
+  for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+    trades[i].index = static_cast<dxf_long_t>(i);
+    trades[i].price = 100.0 + static_cast<double>(i) * 0.01;
+    trades[i].size = static_cast<double>(i + 1);
+    trades[i].exchange_sale_conditions = L"";
+    trades[i].buyer = L"";
+    trades[i].seller = L"";
+  }
+
+  std::atomic<std::uint64_t> handledNumber{0};
+  dxf::EventDispatcher<dxf_time_and_sale_t, dxf::TimeAndSale> dispatcher{
+    DXF_ET_TIME_AND_SALE, 4, [&handledNumber](const dxf::Symbol&, dxf::TimeAndSale*, std::size_t count) {
+      handledNumber.fetch_add(count, std::memory_order_relaxed);
+    }};
+
+  bench.run("dispatcher/dispatch(TimeAndSale)", [&](std::size_t i) {
+    dispatcher.dispatch(symbols[i % SYMBOLS_NUMBER], trades.data(), BATCH_SIZE);
+
+    return BATCH_SIZE;
+  });
+  dispatcher.flush();
+
+  dxf::EventDispatcher<dxf_time_and_sale_t, ProjectedTrade> projectedDispatcher{
+    DXF_ET_TIME_AND_SALE, 4, [&handledNumber](const dxf::Symbol&, ProjectedTrade*, std::size_t count) {
+      handledNumber.fetch_add(count, std::memory_order_relaxed);
+    }};
+
+  bench.run("dispatcher/dispatch(projected)", [&](std::size_t i) {
+    projectedDispatcher.dispatch(symbols[i % SYMBOLS_NUMBER], trades.data(), BATCH_SIZE);
+
+    return BATCH_SIZE;
+  });
+  projectedDispatcher.flush();
+
+  // The steady state: the workers keep up (the dispatch is flushed every 64 batches), so the event buffers are taken
+  // from the pools and only the nodes of the queues are allocated
+  bench.run("dispatcher/dispatch(steady)", [&](std::size_t i) {
+    dispatcher.dispatch(symbols[i % SYMBOLS_NUMBER], trades.data(), BATCH_SIZE);
+
+    if (i % 64 == 63) {
+      dispatcher.flush();
+    }
+
+    return BATCH_SIZE;
+  });
+  dispatcher.flush();
+  checksum += handledNumber.load();
+}
+
+// The conversion of the batches of 16 trades for 3 consumers: by 3 listeners (every one converts the same C events) vs
+// once to the slots of the EventRing that the 3 consumer threads read
+void benchEventRing(Microbench& bench) {
+  constexpr std::size_t BATCH_SIZE = 16;
+  constexpr std::size_t CONSUMERS_NUMBER = 3;
+  auto symbol = dxf::Symbol::valueOf(std::string_view{"AAPL"});
+  std::vector<dxf_time_and_sale_t> trades(BATCH_SIZE);
+
+  for (std::size_t i = 0; i < BATCH_SIZE; i++) {
+    trades[i].index = static_cast<dxf_long_t>(i);
+    trades[i].price = 100.0 + static_cast<double>(i) * 0.01;
+    trades[i].size = static_cast<double>(i + 1);
+    trades[i].exchange_sale_conditions = L"";
+    trades[i].buyer = L"NSDQ";
+    trades[i].seller = L"";
+  }
+
+  std::vector<std::vector<dxf::TimeAndSaleData>> listenerEvents(CONSUMERS_NUMBER);
+
+  bench.run("eventRing/convert per listener(3)", [&](std::size_t) {
+    std::size_t result = 0;
+
+    for (auto& events : listenerEvents) {
+      events.clear();
+
+      for (const auto& trade : trades) {
+        events.push_back(dxf::TimeAndSaleData::create(symbol, trade));
+      }
+
+      result += events.size();
+    }
+
+    return result;
+  });
+
+  // The ring that is smaller than the batch: the claim publishes the part of the batch to let the consumers free it
+  for (auto [name, capacity] : {std::pair{"eventRing/publish(3 consumers)", std::size_t{4096}},
+                                std::pair{"eventRing/publish(batch > ring)", BATCH_SIZE / 4}}) {
+    if (!bench.isEnabled(name)) {
+      continue;
+    }
+
+    dxf::EventRing<dxf::TimeAndSaleData> ring{capacity, CONSUMERS_NUMBER};
+    std::atomic<std::uint64_t> readNumber{0};
+    std::vector<std::thread> consumers{};
+
+    for (std::size_t i = 0; i < CONSUMERS_NUMBER; i++) {
+      consumers.emplace_back([&ring, &readNumber, i] {
+        auto consumer = ring.getConsumer(i);
+        std::uint64_t result = 0;
+
+        while (consumer.wait()) {
+          consumer.poll([&result](const dxf::TimeAndSaleData& event, bool) { result += event.index; });
+        }
+
+        readNumber.fetch_add(result);
+      });
+    }
+
+    bench.run(name, [&](std::size_t) {
+      ring.publish(symbol, trades.data(), BATCH_SIZE);
+
+      return BATCH_SIZE;
+    });
+    ring.close();
+
+    for (auto& consumer : consumers) {
+      consumer.join();
+    }
+
+    checksum += readNumber.load();
+  }
+}
+
+void benchMetrics(Microbench& bench) {
+  dxf::MetricsRegistry registry{};
+  auto& counter = registry.counter("bench_events_total", "The events");
+  auto& histogram = registry.histogram("bench_latency_nanoseconds", "The latencies");
+
+  bench.run("metrics/counter.increase", [&counter](std::size_t i) {
+    counter.increase(i & 15U);
+
+    return std::size_t{1};
+  });
+  bench.run("metrics/histogram.record", [&histogram](std::size_t i) {
+    histogram.record(i & 4095U);
+
+    return std::size_t{1};
+  });
+  checksum += counter.get() + histogram.getSnapshot().count;
+}
+
+// The timestamps of the instrumentation: the std::chrono clocks vs the TSC
+void benchClocks(Microbench& bench) {
+  std::int64_t sum = 0;
+
+  bench.run("clock/system_clock::now", [&sum](std::size_t) {
+    sum += std::chrono::system_clock::now().time_since_epoch().count();
+
+    return std::size_t{1};
+  });
+  bench.run("clock/steady_clock::now", [&sum](std::size_t) {
+    sum += std::chrono::steady_clock::now().time_since_epoch().count();
+
+    return std::size_t{1};
+  });
+  // The steady clock is read if the CPU has no invariant TSC
+  bench.run("clock/TscClock::nowNanos", [&sum](std::size_t) {
+    sum += dxf::TscClock::nowNanos();
+
+    return std::size_t{1};
+  });
+  checksum += static_cast<std::size_t>(sum);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+    std::cout << "Usage:\n  microbench [--budgets <allocation budgets file>] [<name filter> [<number of iterations>]]"
+                 "\n\n";
+
+    return 0;
+  }
+
+  AllocationBudgets budgets{};
+  int argIndex = 1;
+
+  if (argc > 2 && std::string(argv[1]) == "--budgets") {
+    if (!loadAllocationBudgets(argv[2], budgets)) {
+      std::cerr << "Can't load the allocation budgets: " << argv[2] << "\n";
+
+      return 1;
+    }
+
+    argIndex = 3;
+  }
+
+  Microbench bench{argc > argIndex ? argv[argIndex] : "",
+                   argc > argIndex + 1 ? std::stoull(argv[argIndex + 1]) : 1000000ULL, std::move(budgets)};
+
+  fmt::print("{:<40} {:>12} {:>12} {:>12}{}\n", "Benchmark", "ops", "ns/op", "allocs/op",
+             argIndex > 1 ? fmt::format(" {:>12}", "budget") : "");
+
+  benchStringConverter(bench);
+  benchTimeAndSale(bench);
+
+  if (bench.isEnabled("engine/multi_index") || bench.isEnabled("engine/flat") ||
+      bench.isEnabled("book/processSnapshotData")) {
+    auto flow = generateOrderFlow(bench.getIterations() / 10, 4, 10000);
+
+    benchPriceLevelBookEngine<dxf::PriceLevelBookEngine<dxf::MultiIndexPriceLevelLadder>>(bench, "engine/multi_index",
+                                                                                          flow);
+    benchPriceLevelBookEngine<dxf::PriceLevelBookEngine<dxf::FlatPriceLevelLadder>>(bench, "engine/flat", flow);
+    benchPriceLevelBook(bench, flow);
+  }
+
+  benchSnapshotKey(bench);
+  benchQtpDecoding(bench);
+  benchSymbolLookup(bench);
+  benchRegionalBook(bench);
+  benchCandleSymbols(bench);
+  benchTradeBars(bench);
+  benchVolumeProfile(bench);
+  benchEventDispatcher(bench);
+  benchEventRing(bench);
+  benchMetrics(bench);
+  benchClocks(bench);
+
+  for (std::size_t producersNumber : {1, 4}) {
+    benchTaskQueue<MutexTaskQueue>(bench, fmt::format("taskQueue/mutex/{}p", producersNumber), producersNumber);
+    benchTaskQueue<LockFreeTaskQueue>(bench, fmt::format("taskQueue/mpsc/{}p", producersNumber), producersNumber);
+    dxf::MemoryPool::setEnabled(true);
+    benchTaskQueue<LockFreeTaskQueue>(bench, fmt::format("taskQueue/mpsc(pool)/{}p", producersNumber),
+                                      producersNumber);
+    dxf::MemoryPool::setEnabled(false);
+  }
+
+  fmt::print("\nChecksum: {}\n", checksum);
+
+  auto violations = bench.getViolations();
+
+  if (!violations.empty()) {
+    fmt::print("\nThe allocation budgets are exceeded:\n");
+
+    for (const auto& violation : violations) {
+      fmt::print("  {}\n", violation);
+    }
+
+    return 1;
+  }
+}
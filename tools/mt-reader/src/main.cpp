@@ -1,39 +1,714 @@
 #include <DXFeed.h>
 #include <EventData.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <codecvt>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
 #include <future>
+#include <iomanip>
 #include <iostream>
 #include <limits>
 #include <locale>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <system_error>
 #include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
+#include <ApiConfig.hpp>
+#include <ArrowExport.hpp>
+#include <AsyncLog.hpp>
+#include <Coroutine.hpp>
+#include <Executor.hpp>
+#include <LatencyStats.hpp>
 #include <SimpleTimeAndSaleDataProvider.hpp>
+#include <ThreadPlacement.hpp>
+
+using Clock = std::chrono::steady_clock;
+
+// The bytes held by the heap allocations of the process and their peak (the memory check of the provider). The size of
+// the allocation is kept in the header before it (16 bytes, so the alignment of the allocation is kept).
+std::atomic<std::int64_t> heapBytes{0};
+std::atomic<std::int64_t> peakHeapBytes{0};
+
+constexpr std::size_t HEAP_HEADER_SIZE = 16;
+
+void *operator new(std::size_t size) {
+  if (auto *p = static_cast<char *>(std::malloc(size + HEAP_HEADER_SIZE))) {
+    auto bytes = heapBytes.fetch_add(static_cast<std::int64_t>(size), std::memory_order_relaxed) +
+                 static_cast<std::int64_t>(size);
+    auto peak = peakHeapBytes.load(std::memory_order_relaxed);
+
+    while (bytes > peak && !peakHeapBytes.compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {
+    }
+
+    *reinterpret_cast<std::size_t *>(p) = size;
+
+    return p + HEAP_HEADER_SIZE;
+  }
+
+  throw std::bad_alloc{};
+}
+
+void operator delete(void *p) noexcept {
+  if (p == nullptr) {
+    return;
+  }
+
+  auto *header = static_cast<char *>(p) - HEAP_HEADER_SIZE;
+
+  heapBytes.fetch_sub(static_cast<std::int64_t>(*reinterpret_cast<std::size_t *>(header)), std::memory_order_relaxed);
+  std::free(header);
+}
+
+void operator delete(void *p, std::size_t) noexcept { operator delete(p); }
+
+std::vector<std::string> splitList(const std::string &list) {
+  std::vector<std::string> result{};
+  std::size_t begin = 0;
+
+  while (begin <= list.size()) {
+    auto end = std::min(list.find(',', begin), list.size());
+
+    if (end > begin) {
+      result.emplace_back(list.substr(begin, end - begin));
+    }
+
+    begin = end + 1;
+  }
+
+  return result;
+}
+
+// The parameters of the stress run: every one of the threads runs the provider instances concurrently, the runs of
+// the next round start when all runs of the thread are finished.
+struct StressOptions {
+  std::vector<std::string> addresses{};
+  std::vector<std::string> symbols{};
+  std::size_t threadsNumber = 4;
+  std::size_t runsNumber = 4;
+  std::size_t roundsNumber = 1;
+  int timeout = 1000;
+  bool isDebug = false;
+  bool isPooled = false;
+  // The runs share the executor instead of the thread per run (0 threads - the number of the cores)
+  std::optional<std::size_t> executorThreadsNumber{};
+  // The placement of the socket threads of the pool and of the threads of the executor
+  dxf::ThreadPlacement placement{};
+  // The config of the C API (from the TOML file and the debug option)
+  dxf::ApiConfig config{};
+};
+
+// The results of the thread. The histograms are written by the thread only.
+struct StressThreadStats {
+  std::size_t runsNumber = 0;
+  std::size_t failedRunsNumber = 0;
+  std::uint64_t eventsNumber = 0;
+  Clock::duration wallTime{};
+  // From the start of the run to the first event (the connection and the subscription)
+  dxf::LatencyHistogram firstEventTimes{};
+  // From the start of the run to the ready future (the receiving, the closing of the subscription and the connection)
+  dxf::LatencyHistogram runTimes{};
+};
+
+// The state of the run shared with its sink
+struct StressRun {
+  Clock::time_point start{};
+  std::atomic<std::int64_t> firstEventTime{-1};
+  std::atomic<std::uint64_t> eventsNumber{0};
+  std::future<bool> result{};
+};
+
+std::uint64_t toNanos(Clock::duration duration) {
+  return static_cast<std::uint64_t>(std::max<std::int64_t>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), 0));
+}
+
+double toMillis(std::uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1000000.0; }
+
+void runStressThread(const StressOptions &options, std::size_t thread, dxf::ConnectionPool *pool,
+                     dxf::Executor *executor, StressThreadStats &stats) {
+  auto threadStart = Clock::now();
+
+  for (std::size_t round = 0; round < options.roundsNumber; round++) {
+    std::vector<std::unique_ptr<StressRun>> runs{};
+
+    for (std::size_t i = 0; i < options.runsNumber; i++) {
+      auto &address = options.addresses[(thread * options.runsNumber + i) % options.addresses.size()];
+      auto run = std::make_unique<StressRun>();
+
+      auto sink = [r = run.get()](const dxf::TimeAndSaleView &) {
+        if (r->eventsNumber.fetch_add(1, std::memory_order_relaxed) == 0) {
+          r->firstEventTime.store(static_cast<std::int64_t>(toNanos(Clock::now() - r->start)),
+                                  std::memory_order_relaxed);
+        }
+      };
+
+      run->start = Clock::now();
+
+      if (executor != nullptr) {
+        run->result = dxf::SimpleTimeAndSaleDataProvider::runStreamingViews(*executor, address, options.symbols, sink,
+                                                                            options.timeout, pool);
+      } else {
+        run->result =
+          dxf::SimpleTimeAndSaleDataProvider::runStreamingViews(address, options.symbols, sink, options.timeout, pool);
+      }
+
+      runs.push_back(std::move(run));
+    }
+
+    for (auto &run : runs) {
+      auto isSucceeded = run->result.get();
+
+      stats.runTimes.record(toNanos(Clock::now() - run->start));
+      stats.runsNumber++;
+      stats.failedRunsNumber += isSucceeded ? 0 : 1;
+      stats.eventsNumber += run->eventsNumber.load(std::memory_order_relaxed);
+
+      if (auto firstEventTime = run->firstEventTime.load(std::memory_order_relaxed); firstEventTime >= 0) {
+        stats.firstEventTimes.record(static_cast<std::uint64_t>(firstEventTime));
+      }
+    }
+  }
+
+  stats.wallTime = Clock::now() - threadStart;
+}
+
+void printTimes(const std::string &name, const dxf::LatencyHistogramSnapshot &times) {
+  std::cout << "  " << name << ": p50 = " << toMillis(times.getPercentile(50.0))
+            << " ms, p99 = " << toMillis(times.getPercentile(99.0)) << " ms, max = " << toMillis(times.max)
+            << " ms\n";
+}
+
+// The concurrency stress harness: the threads run the provider instances concurrently (the connections and the
+// subscriptions of the C API are created and closed at once) and the throughput and the waits are reported.
+void runStress(const StressOptions &options) {
+  // The logger is initialized only if the config enables it
+  if (options.config.apply()) {
+    options.config.initializeLogger("mt-reader.log");
+  }
+
+  if (options.isDebug) {
+    dxf::AsyncLog::enable("mt-reader-events.log");
+  }
+
+  std::unique_ptr<dxf::ConnectionPool> pool{};
+
+  if (options.isPooled) {
+    pool = std::make_unique<dxf::ConnectionPool>(options.addresses.size(), std::chrono::seconds(30), options.placement);
+  }
+
+  std::unique_ptr<dxf::Executor> executor{};
+
+  if (options.executorThreadsNumber) {
+    executor = std::make_unique<dxf::Executor>(*options.executorThreadsNumber, options.placement);
+  }
+
+  std::vector<std::unique_ptr<StressThreadStats>> stats{};
+  std::vector<std::thread> threads{};
+  auto start = Clock::now();
+
+  for (std::size_t thread = 0; thread < options.threadsNumber; thread++) {
+    stats.push_back(std::make_unique<StressThreadStats>());
+    threads.emplace_back(runStressThread, std::cref(options), thread, pool.get(), executor.get(),
+                         std::ref(*stats.back()));
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  auto wallTime = std::chrono::duration<double>(Clock::now() - start).count();
+  dxf::LatencyHistogramSnapshot firstEventTimes{};
+  dxf::LatencyHistogramSnapshot runTimes{};
+  std::uint64_t eventsNumber = 0;
+
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "threads: " << options.threadsNumber << ", runs per thread: " << options.runsNumber
+            << ", rounds: " << options.roundsNumber << ", timeout: " << options.timeout
+            << " ms, pool: " << (options.isPooled ? "yes" : "no") << ", executor threads: "
+            << (executor ? std::to_string(executor->getThreadsNumber()) : "no") << "\n";
+
+  for (std::size_t thread = 0; thread < stats.size(); thread++) {
+    const auto &s = *stats[thread];
+    auto seconds = std::chrono::duration<double>(s.wallTime).count();
+
+    std::cout << "thread " << thread << ": runs = " << s.runsNumber << ", failed = " << s.failedRunsNumber
+              << ", events = " << s.eventsNumber << ", events/s = "
+              << (seconds > 0.0 ? static_cast<double>(s.eventsNumber) / seconds : 0.0) << ", wall time = " << seconds
+              << " s\n";
+    firstEventTimes.merge(s.firstEventTimes.getSnapshot());
+    runTimes.merge(s.runTimes.getSnapshot());
+    eventsNumber += s.eventsNumber;
+  }
+
+  std::cout << "total: events = " << eventsNumber << ", events/s = "
+            << (wallTime > 0.0 ? static_cast<double>(eventsNumber) / wallTime : 0.0) << ", wall time = " << wallTime
+            << " s\n";
+  std::cout << "waits:\n";
+  printTimes("first event", firstEventTimes);
+  printTimes("run", runTimes);
+
+  if (pool) {
+    auto lockWaits = pool->getLockWaitStats();
+
+    std::cout << "  pool lock: locks = " << lockWaits.locksNumber << ", contended = " << lockWaits.contendedLocksNumber
+              << ", wait = " << toMillis(toNanos(lockWaits.waitTime)) << " ms\n";
+
+    // The connections are created outside the pool mutex, their times are not the lock waits
+    auto connects = pool->getConnectStats();
+
+    std::cout << "  pool connects: connects = " << connects.connectsNumber
+              << ", failed = " << connects.failedConnectsNumber
+              << ", connect time = " << toMillis(toNanos(connects.connectTime))
+              << " ms, waits for the connects = " << connects.connectWaitsNumber
+              << ", wait = " << toMillis(toNanos(connects.connectWaitTime)) << " ms\n";
+
+    for (const auto &[address, metrics] : pool->getMetrics()) {
+      std::cout << "  connection " << address << ": rtt = " << metrics.latestRtt.count()
+                << " us, average rtt = " << metrics.averageRtt.count() << " us, server lag = "
+                << metrics.serverLag.count() << " us, heartbeats = " << metrics.heartbeatsNumber
+                << ", messages = " << metrics.messagesNumber << ", events = " << metrics.eventsNumber
+                << ", since last message = " << metrics.sinceLastMessage.count() << " ms\n";
+    }
+  }
+
+  if (dxf::AsyncLog::isEnabled()) {
+    dxf::AsyncLog::disable();
+    std::cout << "log: dropped records = " << dxf::AsyncLog::getDroppedNumber() << "\n";
+  }
+}
+
+// The number of the events of the fetch (the coroutine is resumed when the fetch is finished)
+dxf::Task<std::size_t> fetchEventsNumber(dxf::Executor &executor, std::string address,
+                                         std::vector<std::string> symbols) {
+  auto events = co_await dxf::SimpleTimeAndSaleDataProvider::fetch(executor, address, symbols);
+  std::size_t result = 0;
+
+  for (const auto &[s, v] : events) {
+    result += v.size();
+  }
+
+  co_return result;
+}
+
+// The number of the events of the stream (the coroutine is resumed when the events arrive)
+dxf::Task<std::size_t> streamEventsNumber(dxf::Executor &executor, std::string address,
+                                          std::vector<std::string> symbols) {
+  auto stream = dxf::SimpleTimeAndSaleDataProvider::subscribe(executor, address, symbols);
+  std::size_t result = 0;
+
+  while (auto timeAndSale = co_await stream->next()) {
+    result++;
+  }
+
+  co_return result;
+}
+
+int runStressCommand(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cout << "Usage: mt-reader stress <address>[,<address>...] <symbol>[,<symbol>...] [threads=<number>] "
+                 "[runs=<number>] [rounds=<number>] [timeout=<ms>] [debug] [pool] [executor[=<number>]] "
+                 "[placement=<placement>] [config=<toml file>]\n";
+
+    return 1;
+  }
+
+  StressOptions options{splitList(argv[2]), splitList(argv[3])};
+
+  for (int i = 4; i < argc; i++) {
+    std::string_view argument{argv[i]};
+    auto number = [&argument](std::string_view prefix, auto &value, long long minimum = 1) {
+      if (!argument.starts_with(prefix)) {
+        return false;
+      }
+
+      value = static_cast<std::remove_reference_t<decltype(value)>>(
+        std::max(std::stoll(std::string(argument.substr(prefix.size()))), minimum));
+
+      return true;
+    };
+
+    if (argument == "debug") {
+      options.isDebug = true;
+    } else if (argument == "pool") {
+      options.isPooled = true;
+    } else if (argument.starts_with("placement=")) {
+      auto placement = dxf::ThreadPlacement::parse(argument.substr(std::string_view{"placement="}.size()));
+
+      if (!placement) {
+        std::cout << "Invalid placement: " << argument << "\n";
+
+        return 1;
+      }
+
+      options.placement = std::move(*placement);
+    } else if (argument.starts_with("config=")) {
+      std::string error{};
+      auto config = dxf::ApiConfig::load(std::string(argument.substr(std::string_view{"config="}.size())), &error);
+
+      if (!config) {
+        std::cout << "Invalid config: " << error << "\n";
+
+        return 1;
+      }
+
+      options.config = std::move(*config);
+    } else if (argument == "executor") {
+      options.executorThreadsNumber = 0;
+    } else if (argument.starts_with("executor=")) {
+      options.executorThreadsNumber = static_cast<std::size_t>(
+        std::max(std::stoll(std::string(argument.substr(std::string_view{"executor="}.size()))), 0LL));
+    } else if (!number("threads=", options.threadsNumber) && !number("runs=", options.runsNumber) &&
+               !number("rounds=", options.roundsNumber) && !number("timeout=", options.timeout, 0)) {
+      std::cout << "Unknown argument: " << argument << "\n";
+
+      return 1;
+    }
+  }
+
+  if (options.isDebug) {
+    options.config.set("logger.level", "\"debug\"");
+  }
+
+  if (options.addresses.empty() || options.symbols.empty()) {
+    std::cout << "No addresses or symbols\n";
+
+    return 1;
+  }
+
+  runStress(options);
+
+  return 0;
+}
+
+// Checks the peak memory of the provider run relative to the number of its events: the result is moved to the caller
+// and the events are built in place, so the peak heap of the run is the vectors of the events and their growth (the
+// old and the new buffers, 3 events per event at most) plus the fixed overhead of the run. The copies of the result
+// (or of the events) are over the bound, and the exit code is 1.
+int runMemoryCommand(int argc, char *argv[]) {
+  if (argc < 4) {
+    std::cout << "Usage: mt-reader memory <address> <symbol>[,<symbol>...] [bytes=<bytes per event>]\n";
+
+    return 1;
+  }
+
+  constexpr std::int64_t FIXED_OVERHEAD = 1 << 20;
+  auto bytesPerEvent = static_cast<std::int64_t>(3 * sizeof(dxf::TimeAndSale));
+
+  for (int i = 4; i < argc; i++) {
+    std::string_view argument{argv[i]};
+
+    if (argument.starts_with("bytes=")) {
+      bytesPerEvent = std::stoll(std::string(argument.substr(std::string_view{"bytes="}.size())));
+    } else {
+      std::cout << "Unknown argument: " << argument << "\n";
+
+      return 1;
+    }
+  }
+
+  auto symbols = splitList(argv[3]);
+  auto heapBefore = heapBytes.load(std::memory_order_relaxed);
+
+  peakHeapBytes.store(heapBefore, std::memory_order_relaxed);
+
+  auto result = dxf::SimpleTimeAndSaleDataProvider::run(argv[2], symbols).get();
+  auto heldBytes = heapBytes.load(std::memory_order_relaxed) - heapBefore;
+  auto peakBytes = peakHeapBytes.load(std::memory_order_relaxed) - heapBefore;
+  std::int64_t eventsNumber = 0;
+
+  for (const auto &[s, v] : result) {
+    eventsNumber += static_cast<std::int64_t>(v.size());
+  }
+
+  auto limit = eventsNumber * bytesPerEvent + FIXED_OVERHEAD;
+  auto perEvent = [eventsNumber](std::int64_t bytes) {
+    return eventsNumber > 0 ? static_cast<double>(bytes) / static_cast<double>(eventsNumber) : 0.0;
+  };
+
+  std::cout << "events = " << eventsNumber << ", held = " << heldBytes << " B (" << perEvent(heldBytes)
+            << " B/event), peak = " << peakBytes << " B (" << perEvent(peakBytes) << " B/event), limit = " << limit
+            << " B (" << bytesPerEvent << " B/event + " << FIXED_OVERHEAD << " B)\n";
+
+  if (peakBytes > limit) {
+    std::cout << "The peak memory of the run is over the limit\n";
+
+    return 1;
+  }
+
+  return 0;
+}
+
+// The trade of the projected mode: only the price and the size of the C API event are copied (see dxf::project)
+struct ProjectedTrade {
+  double price;
+  double size;
+
+  using Projection = dxf::project<&dxf_time_and_sale_t::price, &dxf_time_and_sale_t::size>;
+};
 
 int main(int argc, char *argv[]) {
+  if (argc > 1 && std::string_view{argv[1]} == "stress") {
+    return runStressCommand(argc, argv);
+  }
+
+  if (argc > 1 && std::string_view{argv[1]} == "memory") {
+    return runMemoryCommand(argc, argv);
+  }
+
+  if (argc < 3) {
+    std::cout << "Usage: mt-reader <path to file 1> <path to file 2>\n"
+                 "       mt-reader stress <address>[,<address>...] <symbol>[,<symbol>...] [threads=<number>] "
+                 "[runs=<number>] [rounds=<number>] [timeout=<ms>] [debug] [pool] [executor[=<number>]] "
+                 "[placement=<placement>] [config=<toml file>]\n"
+                 "       mt-reader memory <address> <symbol>[,<symbol>...] [bytes=<bytes per event>]\n";
+
+    return 1;
+  }
+
   dxf_load_config_from_string("logger.level = \"debug\"\n");
   dxf_initialize_logger_v2("mt-reader.log", true, true, true, false);
 
-  for (auto [s, v] : dxf::SimpleTimeAndSaleDataProvider::run(argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}).get()) {
+  // The runs share the live connections of the same address
+  dxf::ConnectionPool pool{};
+
+  for (const auto &[s, v] :
+       dxf::SimpleTimeAndSaleDataProvider::run(argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}, 0, &pool).get()) {
     std::cout << s << "[" << v.size() << "]\n";
   }
 
-  auto f = dxf::SimpleTimeAndSaleDataProvider::run(argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"});
-  auto f2 = dxf::SimpleTimeAndSaleDataProvider::run(argv[2], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"});
+  // The same run on the executor: no thread waits for the events
+  {
+    dxf::Executor executor{};
 
-  for (auto [s, v] : f.get()) {
+    for (const auto &[s, v] :
+         dxf::SimpleTimeAndSaleDataProvider::run(executor, argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}, 0,
+                                                 &pool)
+           .get()) {
+      std::cout << s << "[" << v.size() << "] executor\n";
+    }
+
+    // The coroutines on the same executor
+    std::cout << "fetched by the coroutine: "
+              << dxf::startTask(executor,
+                                fetchEventsNumber(executor, argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}))
+                   .get()
+              << ", streamed to the coroutine: "
+              << dxf::startTask(executor,
+                                streamEventsNumber(executor, argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}))
+                   .get()
+              << "\n";
+
+    // The groups of the events of all symbols by one sink call
+    std::size_t groupedEventsNumber = 0;
+    std::size_t groupsNumber = 0;
+
+    dxf::SimpleTimeAndSaleDataProvider::runStreamingGroups(
+      executor, argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"},
+      [&groupedEventsNumber, &groupsNumber](std::span<const std::size_t>, std::span<dxf::TimeAndSale> events) {
+        groupedEventsNumber += events.size();
+        groupsNumber++;
+      },
+      0, &pool)
+      .get();
+
+    std::cout << "streamed by the groups: " << groupedEventsNumber << " events, " << groupsNumber << " groups\n";
+  }
+
+  auto f = dxf::SimpleTimeAndSaleDataProvider::run(argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}, 0, &pool);
+  auto f2 = dxf::SimpleTimeAndSaleDataProvider::run(argv[2], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}, 0, &pool);
+
+  for (const auto &[s, v] : f.get()) {
     std::cout << s << "[" << v.size() << "]\n";
   }
 
-  for (auto [s, v] : f2.get()) {
+  for (const auto &[s, v] : f2.get()) {
     std::cout << s << "[" << v.size() << "]\n";
   }
 
+  // Both files at once: the events of every symbol are merged by the index and the duplicates are removed
+  auto merged = dxf::SimpleTimeAndSaleDataProvider::runMerged({argv[1], argv[2]},
+                                                              {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}, 0, &pool);
+
+  // The time range of the files (for the partitioned fetch)
+  auto fromTime = (std::numeric_limits<std::int64_t>::max)();
+  auto toTime = std::int64_t{0};
+
+  for (const auto &[s, v] : merged.get()) {
+    std::cout << s << "[" << v.size() << "] merged\n";
+
+    for (const auto &timeAndSale : v) {
+      fromTime = (std::min)(fromTime, static_cast<std::int64_t>(timeAndSale.getTime()));
+      toTime = (std::max)(toTime, static_cast<std::int64_t>(timeAndSale.getTime()) + 1);
+    }
+  }
+
+  // The first file by 4 time windows in parallel (the connections of the different lanes of the pool)
+  if (fromTime < toTime) {
+    auto partitioned = dxf::SimpleTimeAndSaleDataProvider::runPartitioned(
+      argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}, fromTime, toTime, 4, 0, &pool);
+
+    for (const auto &[s, v] : partitioned.get()) {
+      std::cout << s << "[" << v.size() << "] partitioned\n";
+    }
+  }
+
+  // The streaming mode: only the counters are kept
+  std::unordered_map<std::string, std::size_t> counts{};
+
+  dxf::SimpleTimeAndSaleDataProvider::runStreaming(
+    argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"},
+    [&counts](dxf::TimeAndSale &&timeAndSale) { counts[timeAndSale.getEventSymbol()]++; }, 0, &pool)
+    .get();
+
+  for (auto [s, n] : counts) {
+    std::cout << s << "[" << n << "]\n";
+  }
+
+  // The streaming mode without the conversion: only the sizes of the views are read
+  std::unordered_map<std::string, double> volumes{};
+
+  dxf::SimpleTimeAndSaleDataProvider::runStreamingViews(
+    argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"},
+    [&volumes](const dxf::TimeAndSaleView &view) { volumes[view.getEventSymbol()] += view.getSize(); }, 0, &pool)
+    .get();
+
+  for (auto [s, v] : volumes) {
+    std::cout << s << " volume = " << v << "\n";
+  }
+
+  // The same with the filter of the raw events: the events that are not the valid ticks are never wrapped
+  std::unordered_map<std::string, double> validVolumes{};
+
+  dxf::SimpleTimeAndSaleDataProvider::runStreamingViews(
+    argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"},
+    [&validVolumes](const dxf::TimeAndSaleView &view) { validVolumes[view.getEventSymbol()] += view.getSize(); }, 0,
+    &pool, std::nullopt,
+    dxf::SimpleTimeAndSaleDataProvider::FilterType{}.whereIn(&dxf_time_and_sale_t::is_valid_tick, {1}))
+    .get();
+
+  for (auto [s, v] : validVolumes) {
+    std::cout << s << " valid ticks volume = " << v << "\n";
+  }
+
+  // The projected mode: the compact trades are filled from the price and the size of the C API events only
+  auto projectedResult = dxf::SimpleTimeAndSaleDataProvider::runProjected<ProjectedTrade>(
+                           argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}, 0, &pool)
+                           .get();
+
+  for (const auto &[s, trades] : projectedResult) {
+    double volume = 0.0;
+    double turnover = 0.0;
+
+    for (const auto &trade : trades) {
+      volume += trade.size;
+      turnover += trade.price * trade.size;
+    }
+
+    std::cout << s << "[" << trades.size() << "] projected VWAP = " << (volume > 0.0 ? turnover / volume : 0.0)
+              << "\n";
+  }
+
+  // The columnar mode: the scans read only the needed columns. The columns are exported to the Arrow files as is.
+  auto columnsResult =
+    dxf::SimpleTimeAndSaleDataProvider::runColumnar(argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}, 0, &pool)
+      .get();
+  std::error_code arrowError{};
+
+  std::filesystem::create_directories("mt-reader-arrow", arrowError);
+
+  for (auto &[s, columns] : columnsResult) {
+    std::cout << s << "[" << columns.getSize() << "] volume = " << columns.getVolume()
+              << ", VWAP = " << columns.getVwap() << "\n";
+
+    auto arrowPath = "mt-reader-arrow/" + dxf::ArrowBatch::getFileName(s.getName());
+
+    if (!dxf::ArrowBatch::fromColumns(std::move(columns)).addMetadata("symbol", s.getName()).writeFile(arrowPath)) {
+      std::cout << s << " the Arrow file " << arrowPath << " can't be written\n";
+    }
+  }
+
+  // The indexed mode: the volume of the last hour of every symbol is found without the scan of the whole history
+  for (const auto &[s, store] :
+       dxf::SimpleTimeAndSaleDataProvider::runStore(argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}, 0, &pool)
+         .get()) {
+    if (store.isEmpty()) {
+      continue;
+    }
+
+    auto lastTime = store.getChunkSummary(store.getChunksNumber() - 1).maxTime;
+    auto fromTime = lastTime > 3600000 ? lastTime - 3600000 : 0;
+    double volume = 0.0;
+
+    store.forEachInTimeRange(fromTime, lastTime + 1,
+                             [&volume](const dxf::TimeAndSale &timeAndSale) { volume += timeAndSale.getSize(); });
+
+    std::cout << s << "[" << store.getSize() << "] last hour volume = " << volume << "\n";
+  }
+
+  // The bounded memory mode: the events over the budget are spilled to the temporary file
+  for (const auto &[s, history] :
+       dxf::SimpleTimeAndSaleDataProvider::runSpilled(argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}, 1 << 20,
+                                                      {}, 0, &pool)
+         .get()) {
+    double volume = 0.0;
+
+    history.forEachRecord([&volume](const dxf::TimeAndSaleRecord &record) { volume += record.size; });
+
+    std::cout << s << "[" << history.getSize() << ", spilled " << history.getSpilledSize() << "] volume = " << volume
+              << "\n";
+  }
+
+  // The tapes: the events are written to the binary files and reloaded from the memory-mapped files
+  for (const auto &[s, path] :
+       dxf::SimpleTimeAndSaleDataProvider::runTape(argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}, "mt-reader-tapes",
+                                                   0.0, 0, &pool)
+         .get()) {
+    auto start = std::chrono::steady_clock::now();
+    auto reader = dxf::TimeAndSaleTapeReader::open(path);
+    double volume = 0.0;
+
+    if (!reader || !reader->forEachRecord([&volume](const dxf::TimeAndSaleRecord &record) { volume += record.size; })) {
+      std::cout << s << " the tape " << path << " can't be read\n";
+
+      continue;
+    }
+
+    std::cout << s << "[" << reader->getSize() << "] volume = " << volume << ", reloaded in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+              << " ms\n";
+  }
+
+  // The cache: the first run fetches the whole history to the segments of the cache, the second one reads them and
+  // fetches only the tails after the last cached events
+  dxf::TimeAndSaleCache cache{"mt-reader-cache"};
+
+  for (auto pass : {"fetched", "cached"}) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (const auto &[s, v] :
+         dxf::SimpleTimeAndSaleDataProvider::runCached(argv[1], {"/ESZ21:XCME", "/FESX211217:XEUR", "AAPL"}, cache, 0,
+                                                       (std::numeric_limits<std::int64_t>::max)(), 0, &pool)
+           .get()) {
+      std::cout << s << "[" << v.size() << "] " << pass << "\n";
+    }
+
+    std::cout << pass << " in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+              << " ms\n";
+  }
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,1022 @@
+#define _SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING 1
+
+#include <DXFeed.h>
+#include <fmt/format.h>
+
+#include <ArrowExport.hpp>
+#include <GroupedPriceLevels.hpp>
+#include <LazyPriceLevelBook.hpp>
+#include <MarketByOrderBook.hpp>
+#include <OrderFlowGenerator.hpp>
+#include <OrderDataMap.hpp>
+#include <ParallelReplay.hpp>
+#include <PriceLevelBook.hpp>
+#include <PriceLevelBookCheckpoint.hpp>
+#include <PriceLevelBookEngine.hpp>
+#include <PriceLevelBookIntegrityChecker.hpp>
+#include <PriceLevelSearch.hpp>
+#include <SnapshotDataCapture.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// The number of the heap allocations made by the process. Used to check that the steady-state processing of the
+// transactions doesn't allocate.
+std::atomic<std::uint64_t> allocationsNumber{0};
+
+void* operator new(std::size_t size) {
+  allocationsNumber.fetch_add(1, std::memory_order_relaxed);
+
+  if (auto* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+
+  throw std::bad_alloc{};
+}
+
+// The default operator delete releases the memory with std::free
+
+// Generates a deterministic order flow around the price of 100.0 (OrderFlowGenerator with the default mix): the first
+// transaction is the snapshot, the rest are the incremental updates (additions, modifications and removals of orders).
+std::vector<std::vector<dxf_order_t>> generateOrderFlow(std::size_t transactionsNumber,
+                                                        std::size_t recordsPerTransaction,
+                                                        std::size_t snapshotOrdersNumber) {
+  dxf::OrderFlowConfig config{};
+
+  config.recordsPerTransaction = recordsPerTransaction;
+  config.snapshotOrdersNumber = snapshotOrdersNumber;
+
+  dxf::OrderFlowGenerator generator{config};
+  std::vector<std::vector<dxf_order_t>> flow{};
+
+  for (std::size_t i = 0; i <= transactionsNumber; i++) {
+    flow.push_back(generator.next().orders);
+  }
+
+  return flow;
+}
+
+struct BenchResult {
+  double seconds = 0.0;
+  double checksum = 0.0;
+  // The allocations made while processing the incremental transactions (the snapshot is excluded)
+  std::uint64_t allocations = 0;
+  // The allocations of the second half of the transactions (the steady state: the buffers have grown to the working
+  // size of the flow)
+  std::uint64_t steadyAllocations = 0;
+  // The memory held by the book at the end (PriceLevelBook::getMemoryUsage)
+  dxf::PriceLevelBookMemoryUsage memoryUsage{};
+};
+
+// How the benchmark reads the visible book after every transaction
+enum class BookAccess : int {
+  // The changes only
+  NONE = 0,
+  // getBook() copies (as for the OnBookUpdate handler)
+  COPY = 1,
+  // getBookView() (as for the OnBookUpdateView handler)
+  VIEW = 2,
+  // getAnalytics() of the 10 best levels (the incremental analytics instead of the book scan)
+  ANALYTICS = 3,
+  // getTopOfBook() only after the transactions that change it (as for the OnTopOfBookChange handler)
+  TOP_OF_BOOK = 4,
+  // The bucket changes of the grouped views of 0.25 and 1.0 changed by the level deltas (as for the OnGroupedChange
+  // handler)
+  GROUPED = 5,
+  // The full regroup of all levels into the buckets of 0.25 and 1.0 (the baseline of the grouped views)
+  REGROUP = 6
+};
+
+// The bucket sizes of the grouped views of the benchmark
+constexpr std::array<double, 2> BENCH_BUCKET_SIZES{0.25, 1.0};
+
+template <typename Engine>
+BenchResult run(Engine& engine, const std::vector<std::vector<dxf_order_t>>& flow,
+                BookAccess bookAccess = BookAccess::NONE) {
+  BenchResult result{};
+  std::vector<dxf::GroupedPriceLevels> views(BENCH_BUCKET_SIZES.begin(), BENCH_BUCKET_SIZES.end());
+  std::vector<dxf::PriceLevel> asks{};
+  std::vector<dxf::PriceLevel> bids{};
+  std::vector<dxf::PriceLevel> buckets{};
+  auto start = std::chrono::steady_clock::now();
+  std::uint64_t allocationsAfterSnapshot = 0;
+  std::uint64_t allocationsAfterWarmUp = 0;
+
+  for (std::size_t i = 0; i < flow.size(); i++) {
+    const auto& transaction = flow[i];
+    const auto& updates = engine.convertToUpdates(transaction.data(), transaction.size());
+
+    if (bookAccess == BookAccess::GROUPED) {
+      for (auto& view : views) {
+        engine.groupUpdates(view, updates);
+      }
+    }
+
+    const auto& changes = engine.applyUpdates(updates);
+
+    if (i == 0) {
+      allocationsAfterSnapshot = allocationsNumber.load(std::memory_order_relaxed);
+    }
+
+    if (i == flow.size() / 2) {
+      allocationsAfterWarmUp = allocationsNumber.load(std::memory_order_relaxed);
+    }
+
+    for (const auto& pl : changes.additions.asks) result.checksum += pl.price * pl.size;
+    for (const auto& pl : changes.additions.bids) result.checksum += pl.price * pl.size;
+    for (const auto& pl : changes.updates.asks) result.checksum += pl.price * pl.size;
+    for (const auto& pl : changes.updates.bids) result.checksum += pl.price * pl.size;
+    for (const auto& pl : changes.removals.asks) result.checksum -= pl.price;
+    for (const auto& pl : changes.removals.bids) result.checksum -= pl.price;
+
+    if (bookAccess == BookAccess::COPY) {
+      const auto& book = engine.getBook();
+
+      for (const auto& pl : book.asks) result.checksum += pl.size;
+      for (const auto& pl : book.bids) result.checksum += pl.size;
+    } else if (bookAccess == BookAccess::VIEW) {
+      auto view = engine.getBookView();
+
+      for (auto pl : view.asks) result.checksum += pl.size;
+      for (auto pl : view.bids) result.checksum += pl.size;
+    } else if (bookAccess == BookAccess::ANALYTICS) {
+      auto analytics = engine.getAnalytics();
+
+      result.checksum += analytics.askDepthSize + analytics.bidDepthSize + analytics.getSpread();
+    } else if (bookAccess == BookAccess::TOP_OF_BOOK && engine.isTopOfBookChanged()) {
+      const auto& topOfBook = engine.getTopOfBook();
+
+      result.checksum += topOfBook.ask.price * topOfBook.ask.size + topOfBook.bid.price * topOfBook.bid.size;
+    } else if (bookAccess == BookAccess::GROUPED) {
+      for (auto& view : views) {
+        const auto& bucketChanges = view.takeChanges();
+
+        for (const auto& pl : bucketChanges.additions.asks) result.checksum += pl.size;
+        for (const auto& pl : bucketChanges.additions.bids) result.checksum += pl.size;
+        for (const auto& pl : bucketChanges.updates.asks) result.checksum += pl.size;
+        for (const auto& pl : bucketChanges.updates.bids) result.checksum += pl.size;
+      }
+    } else if (bookAccess == BookAccess::REGROUP) {
+      engine.copyLadders(asks, bids);
+
+      for (auto bucketSize : BENCH_BUCKET_SIZES) {
+        dxf::GroupedPriceLevels::group(asks, false, bucketSize, buckets);
+
+        for (const auto& pl : buckets) result.checksum += pl.size;
+
+        dxf::GroupedPriceLevels::group(bids, true, bucketSize, buckets);
+
+        for (const auto& pl : buckets) result.checksum += pl.size;
+      }
+    }
+  }
+
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.allocations = allocationsNumber.load(std::memory_order_relaxed) - allocationsAfterSnapshot;
+  result.steadyAllocations = allocationsNumber.load(std::memory_order_relaxed) - allocationsAfterWarmUp;
+
+  return result;
+}
+
+// Applies the flow to the market-by-order book and reads the best levels of the sides after every transaction
+BenchResult runMarketByOrder(dxf::MarketByOrderEngine& engine, const std::vector<std::vector<dxf_order_t>>& flow) {
+  BenchResult result{};
+  auto start = std::chrono::steady_clock::now();
+  std::uint64_t allocationsAfterSnapshot = 0;
+  std::uint64_t allocationsAfterWarmUp = 0;
+
+  for (std::size_t i = 0; i < flow.size(); i++) {
+    engine.apply(flow[i].data(), flow[i].size());
+
+    if (i == 0) {
+      allocationsAfterSnapshot = allocationsNumber.load(std::memory_order_relaxed);
+    }
+
+    if (i == flow.size() / 2) {
+      allocationsAfterWarmUp = allocationsNumber.load(std::memory_order_relaxed);
+    }
+
+    if (auto bestAsk = engine.getLevel(false, 0)) result.checksum += bestAsk->price * bestAsk->size;
+    if (auto bestBid = engine.getLevel(true, 0)) result.checksum += bestBid->price * bestBid->size;
+  }
+
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.allocations = allocationsNumber.load(std::memory_order_relaxed) - allocationsAfterSnapshot;
+  result.steadyAllocations = allocationsNumber.load(std::memory_order_relaxed) - allocationsAfterWarmUp;
+
+  return result;
+}
+
+// Applies the flow to the lazy book and reads its best levels after every readInterval transactions (e.g. the
+// periodic risk check)
+BenchResult runLazy(dxf::LazyPriceLevelBookEngine& engine, const std::vector<std::vector<dxf_order_t>>& flow,
+                    std::size_t readInterval) {
+  BenchResult result{};
+  auto start = std::chrono::steady_clock::now();
+  std::uint64_t allocationsAfterSnapshot = 0;
+  std::uint64_t allocationsAfterWarmUp = 0;
+
+  for (std::size_t i = 0; i < flow.size(); i++) {
+    engine.apply(flow[i].data(), flow[i].size());
+
+    if (i == 0) {
+      allocationsAfterSnapshot = allocationsNumber.load(std::memory_order_relaxed);
+    }
+
+    if (i == flow.size() / 2) {
+      allocationsAfterWarmUp = allocationsNumber.load(std::memory_order_relaxed);
+    }
+
+    if (i % readInterval == 0) {
+      const auto& book = engine.getBook();
+
+      for (const auto& pl : book.asks) result.checksum += pl.size;
+      for (const auto& pl : book.bids) result.checksum += pl.size;
+    }
+  }
+
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.allocations = allocationsNumber.load(std::memory_order_relaxed) - allocationsAfterSnapshot;
+  result.steadyAllocations = allocationsNumber.load(std::memory_order_relaxed) - allocationsAfterWarmUp;
+
+  return result;
+}
+
+// Replays the order index operations of the engine (the lookup, then the insertion, the replacement or the removal)
+template <typename Find, typename Insert, typename Erase>
+BenchResult runOrderIndex(const std::vector<std::vector<dxf_order_t>>& flow, Find&& find, Insert&& insert,
+                          Erase&& erase) {
+  BenchResult result{};
+  auto start = std::chrono::steady_clock::now();
+  std::uint64_t allocationsAfterSnapshot = 0;
+  std::uint64_t allocationsAfterWarmUp = 0;
+
+  for (std::size_t i = 0; i < flow.size(); i++) {
+    for (const auto& order : flow[i]) {
+      auto found = find(order.index);
+
+      if ((order.event_flags & dxf_ef_remove_event) != 0) {
+        if (found != nullptr) {
+          result.checksum -= found->size;
+          erase(order.index);
+        }
+      } else if (found != nullptr) {
+        result.checksum += order.size - found->size;
+        *found = dxf::OrderData{order.index, order.price, order.size, order.side};
+      } else {
+        result.checksum += order.size;
+        insert(dxf::OrderData{order.index, order.price, order.size, order.side});
+      }
+    }
+
+    if (i == 0) {
+      allocationsAfterSnapshot = allocationsNumber.load(std::memory_order_relaxed);
+    }
+
+    if (i == flow.size() / 2) {
+      allocationsAfterWarmUp = allocationsNumber.load(std::memory_order_relaxed);
+    }
+  }
+
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.allocations = allocationsNumber.load(std::memory_order_relaxed) - allocationsAfterSnapshot;
+  result.steadyAllocations = allocationsNumber.load(std::memory_order_relaxed) - allocationsAfterWarmUp;
+
+  return result;
+}
+
+struct CapturedChunk {
+  std::vector<dxf_order_t> orders{};
+  bool newSnapshot = false;
+};
+
+void addChecksum(BenchResult& result, const dxf::PriceLevelChangesSet& changes) {
+  for (const auto& pl : changes.additions.asks) result.checksum += pl.price * pl.size;
+  for (const auto& pl : changes.additions.bids) result.checksum += pl.price * pl.size;
+  for (const auto& pl : changes.updates.asks) result.checksum += pl.price * pl.size;
+  for (const auto& pl : changes.updates.bids) result.checksum += pl.price * pl.size;
+  for (const auto& pl : changes.removals.asks) result.checksum -= pl.price;
+  for (const auto& pl : changes.removals.bids) result.checksum -= pl.price;
+}
+
+// The static listener (PriceLevelBook::setListener)
+struct ChecksumListener {
+  BenchResult& result;
+  std::size_t& updatesNumber;
+
+  void onIncrementalChange(const dxf::PriceLevelChangesSet& changes) {
+    updatesNumber++;
+    addChecksum(result, changes);
+  }
+};
+
+// Replays the captured chunks through the PriceLevelBook::processSnapshotData (the synchronous mode). The changes are
+// received by the std::function handler or by the static listener.
+BenchResult runReplay(const std::vector<CapturedChunk>& chunks, std::size_t numberOfLevels,
+                      const dxf::PriceLevelBookConfig& config, std::size_t& updatesNumber, bool useListener) {
+  BenchResult result{};
+  auto plb = dxf::PriceLevelBook::createDetached("", "", numberOfLevels, config);
+  ChecksumListener listener{result, updatesNumber};
+
+  updatesNumber = 0;
+
+  if (useListener) {
+    plb->setListener(listener);
+  } else {
+    plb->setOnIncrementalChange([&result, &updatesNumber](const dxf::PriceLevelChangesSet& changes) {
+      updatesNumber++;
+      addChecksum(result, changes);
+    });
+  }
+
+  auto allocationsBefore = allocationsNumber.load(std::memory_order_relaxed);
+  auto start = std::chrono::steady_clock::now();
+
+  for (const auto& chunk : chunks) {
+    dxf_snapshot_data_t snapshotData{};
+
+    snapshotData.event_type = dx_eid_order;
+    snapshotData.records_count = chunk.orders.size();
+    snapshotData.records = chunk.orders.data();
+    plb->processSnapshotData(&snapshotData, chunk.newSnapshot ? 1 : 0);
+  }
+
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.allocations = allocationsNumber.load(std::memory_order_relaxed) - allocationsBefore;
+  result.memoryUsage = plb->getMemoryUsage();
+
+  return result;
+}
+
+int replay(const std::string& fileName, std::size_t numberOfLevels, double tickSize) {
+  std::unique_ptr<std::FILE, decltype(&std::fclose)> file{std::fopen(fileName.c_str(), "rb"), &std::fclose};
+
+  if (!file) {
+    std::cerr << "Can't open the capture file: " << fileName << "\n";
+
+    return 1;
+  }
+
+  dxf::SnapshotDataReader reader{file.get()};
+
+  if (!reader.isValid()) {
+    std::cerr << "Unsupported capture file: " << fileName << "\n";
+
+    return 1;
+  }
+
+  std::vector<CapturedChunk> chunks{};
+  std::size_t recordsNumber = 0;
+  CapturedChunk chunk{};
+
+  while (reader.read(chunk.orders, chunk.newSnapshot)) {
+    recordsNumber += chunk.orders.size();
+    chunks.push_back(std::move(chunk));
+    chunk = CapturedChunk{};
+  }
+
+  fmt::print("Chunks: {}, records: {}, levels: {}\n\n", chunks.size(), recordsNumber, numberOfLevels);
+  fmt::print("{:<18} {:>14} {:>10} {:>12} {:>12} {:>20} {:>12} {:>12}\n", "Storage", "updates/s", "updates",
+             "ns/record", "allocs/upd", "checksum", "ladders KiB", "index KiB");
+
+  auto report = [&](const char* name, dxf::PriceLevelStorage storage, double tick, bool useListener = false,
+                    dxf::PriceLevelBookLockPolicy lockPolicy = dxf::PriceLevelBookLockPolicy::MUTEX) {
+    std::size_t updatesNumber = 0;
+    auto config = dxf::PriceLevelBookConfig{};
+
+    config.storage = storage;
+    config.tickSize = tick;
+    config.lockPolicy = lockPolicy;
+
+    auto result = runReplay(chunks, numberOfLevels, config, updatesNumber, useListener);
+
+    fmt::print("{:<18} {:>14.0f} {:>10} {:>12.1f} {:>12.2f} {:>20.6f} {:>12.1f} {:>12.1f}\n", name,
+               static_cast<double>(updatesNumber) / result.seconds, updatesNumber,
+               result.seconds * 1e9 / static_cast<double>((std::max)(recordsNumber, std::size_t{1})),
+               static_cast<double>(result.allocations) / static_cast<double>((std::max)(updatesNumber, std::size_t{1})),
+               result.checksum, static_cast<double>(result.memoryUsage.ladders) / 1024.0,
+               static_cast<double>(result.memoryUsage.orderIndex) / 1024.0);
+  };
+
+  report("multi_index", dxf::PriceLevelStorage::MULTI_INDEX, 0.0);
+  report("flat", dxf::PriceLevelStorage::FLAT, 0.0);
+  report("fixed", dxf::PriceLevelStorage::FIXED_DEPTH, 0.0);
+  report("multi_index/tick", dxf::PriceLevelStorage::MULTI_INDEX, tickSize);
+  report("flat/tick", dxf::PriceLevelStorage::FLAT, tickSize);
+  report("fixed/tick", dxf::PriceLevelStorage::FIXED_DEPTH, tickSize);
+  report("flat+listener", dxf::PriceLevelStorage::FLAT, 0.0, true);
+  report("flat+no lock", dxf::PriceLevelStorage::FLAT, 0.0, false, dxf::PriceLevelBookLockPolicy::NONE);
+
+  return 0;
+}
+
+// The symbol of the tape or the capture file name (see TimeAndSaleTape::getFileName): "%XX" -> the char
+std::string getFileSymbol(const std::string& stem) {
+  std::string result{};
+
+  for (std::size_t i = 0; i < stem.size(); i++) {
+    if (stem[i] == '%' && i + 2 < stem.size()) {
+      result += static_cast<char>(std::stoi(stem.substr(i + 1, 2), nullptr, 16));
+      i += 2;
+    } else {
+      result += stem[i];
+    }
+  }
+
+  return result;
+}
+
+// The counters of the shard (written by its thread only)
+struct alignas(64) ReplayShardStats {
+  std::uint64_t bookUpdates = 0;
+  double tradedVolume = 0.0;
+};
+
+// Replays the captures (<symbol>.plbc) through the detached books and the TnS tapes (<symbol>.tns) of the directory on
+// all cores (ParallelReplay): the symbols are sharded by the sizes of their files
+int replayDay(const std::string& directory, std::size_t shardsNumber, std::int64_t barrierInterval,
+              std::size_t numberOfLevels) {
+  std::map<std::string, std::vector<std::filesystem::path>> files{};
+  std::map<std::string, std::uint64_t> weights{};
+  std::error_code error{};
+
+  for (const auto& entry : std::filesystem::directory_iterator{directory, error}) {
+    auto extension = entry.path().extension().string();
+
+    if (!entry.is_regular_file() || (extension != ".plbc" && extension != ".tns")) {
+      continue;
+    }
+
+    auto symbol = getFileSymbol(entry.path().stem().string());
+
+    files[symbol].push_back(entry.path());
+    weights[symbol] += entry.file_size();
+  }
+
+  if (error || files.empty()) {
+    std::cerr << "No captures or tapes in the directory: " << directory << "\n";
+
+    return 1;
+  }
+
+  std::vector<dxf::ReplaySymbol> symbols{};
+
+  for (const auto& [symbol, weight] : weights) {
+    symbols.push_back({symbol, weight});
+  }
+
+  auto config = dxf::ParallelReplayConfig{shardsNumber, std::chrono::milliseconds{barrierInterval}};
+  std::vector<ReplayShardStats> stats(config.shardsNumber != 0 ? config.shardsNumber
+                                                               : (std::max)(std::thread::hardware_concurrency(), 1U));
+
+  auto result = dxf::ParallelReplay::run(
+    symbols,
+    [&](std::size_t shard, const std::string& symbol) {
+      auto& shardStats = stats[shard];
+      std::vector<std::unique_ptr<dxf::ReplayStream>> streams{};
+
+      for (const auto& path : files.at(symbol)) {
+        if (path.extension() == ".tns") {
+          streams.push_back(dxf::TimeAndSaleTapeReplayStream::open(
+            path.string(), [&shardStats](const dxf::TimeAndSaleTapeReader&, const dxf::TimeAndSaleRecord& record) {
+              shardStats.tradedVolume += record.size;
+            }));
+
+          continue;
+        }
+
+        // The book is used by the thread of the shard only
+        std::shared_ptr<dxf::PriceLevelBook> book = dxf::PriceLevelBook::createDetached(
+          symbol, "", numberOfLevels, dxf::PriceLevelBookConfig{.storage = dxf::PriceLevelStorage::FLAT,
+                                                          .lockPolicy = dxf::PriceLevelBookLockPolicy::NONE});
+
+        book->setOnIncrementalChange([&shardStats](const dxf::PriceLevelChangesSet&) { shardStats.bookUpdates++; });
+        streams.push_back(dxf::SnapshotCaptureReplayStream::open(
+          path.string(), [book](const dxf_snapshot_data_ptr_t snapshotData, int newSnapshot) {
+            book->processSnapshotData(snapshotData, newSnapshot);
+          }));
+      }
+
+      return streams;
+    },
+    config);
+
+  std::uint64_t bookUpdates = 0;
+  double tradedVolume = 0.0;
+
+  for (const auto& shardStats : stats) {
+    bookUpdates += shardStats.bookUpdates;
+    tradedVolume += shardStats.tradedVolume;
+  }
+
+  auto seconds = std::chrono::duration<double>(result.duration).count();
+
+  fmt::print("Symbols: {}, streams: {}, shards: {}, barriers: {}\n", symbols.size(), result.streamsNumber,
+             result.shardRecordsNumbers.size(), result.barriersNumber);
+  fmt::print("Records: {} in {:.3f} s ({:.0f} records/s), book updates: {}, traded volume: {}\n",
+             result.recordsNumber, seconds, static_cast<double>(result.recordsNumber) / (std::max)(seconds, 1e-9),
+             bookUpdates, tradedVolume);
+  fmt::print("Records of the shards: {}\n", fmt::join(result.shardRecordsNumbers, ", "));
+
+  return 0;
+}
+
+// Exports the order records of the capture file to the Arrow IPC file (one record batch, see SnapshotDataColumns)
+int exportToArrow(const std::string& fileName, const std::string& arrowFileName) {
+  std::unique_ptr<std::FILE, decltype(&std::fclose)> file{std::fopen(fileName.c_str(), "rb"), &std::fclose};
+
+  if (!file) {
+    std::cerr << "Can't open the capture file: " << fileName << "\n";
+
+    return 1;
+  }
+
+  dxf::SnapshotDataReader reader{file.get()};
+
+  if (!reader.isValid()) {
+    std::cerr << "Unsupported capture file: " << fileName << "\n";
+
+    return 1;
+  }
+
+  auto columns = dxf::SnapshotDataColumns::read(reader);
+  auto chunksNumber = columns.chunksNumber;
+  auto recordsNumber = columns.getSize();
+
+  if (!dxf::ArrowBatch::fromColumns(std::move(columns)).addMetadata("capture", fileName).writeFile(arrowFileName)) {
+    std::cerr << "Can't write the Arrow file: " << arrowFileName << "\n";
+
+    return 1;
+  }
+
+  fmt::print("Chunks: {}, records: {}, written to {}\n", chunksNumber, recordsNumber, arrowFileName);
+
+  return 0;
+}
+
+// Measures the restart of the book from its checkpoint: the book of the synthetic order flow writes the checkpoint,
+// then the new book restores it (PriceLevelBookConfig::checkpointDirectory) and its levels are compared with the
+// original book and with the ladders of the checkpoint. The apply of the full snapshot is measured for the comparison
+// (the time to receive the snapshot from the upstream is not included).
+int checkpoint(std::size_t snapshotOrdersNumber, std::size_t numberOfLevels) {
+  auto flow = generateOrderFlow(10000, 4, snapshotOrdersNumber);
+  auto directory = (std::filesystem::temp_directory_path() / "plb-bench-checkpoint").string();
+  auto config = dxf::PriceLevelBookConfig{.storage = dxf::PriceLevelStorage::FLAT};
+  auto seconds = [](auto start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+
+  std::filesystem::create_directories(directory);
+
+  auto feed = [](dxf::PriceLevelBook& book, const std::vector<dxf_order_t>& orders, bool newSnapshot) {
+    dxf_snapshot_data_t snapshotData{};
+
+    snapshotData.event_type = dx_eid_order;
+    snapshotData.records_count = orders.size();
+    snapshotData.records = orders.data();
+    book.processSnapshotData(&snapshotData, newSnapshot ? 1 : 0);
+  };
+
+  auto original = dxf::PriceLevelBook::createDetached("BENCH", "NTV", numberOfLevels, config);
+
+  for (std::size_t i = 0; i < flow.size(); i++) {
+    feed(*original, flow[i], i == 0);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  if (!original->writeCheckpoint(directory)) {
+    std::cerr << "Can't write the checkpoint to " << directory << "\n";
+
+    return 1;
+  }
+
+  auto writeSeconds = seconds(start);
+  auto path = (std::filesystem::path(directory) / dxf::PriceLevelBookCheckpoint::getFileName("BENCH", "NTV")).string();
+  auto fileSize = std::filesystem::file_size(path);
+
+  start = std::chrono::steady_clock::now();
+
+  auto fresh = dxf::PriceLevelBook::createDetached("BENCH", "NTV", numberOfLevels, config);
+
+  feed(*fresh, flow[0], true);
+
+  auto snapshotSeconds = seconds(start);
+
+  config.checkpointDirectory = directory;
+  start = std::chrono::steady_clock::now();
+
+  auto restored = dxf::PriceLevelBook::createDetached("BENCH", "NTV", numberOfLevels, config);
+  auto restoreSeconds = seconds(start);
+
+  dxf::PriceLevelChanges originalBook{};
+  dxf::PriceLevelChanges restoredBook{};
+  auto reader = dxf::PriceLevelBookCheckpointReader::open(path);
+
+  original->copyBook(originalBook);
+  restored->copyBook(restoredBook);
+
+  // The checkpoint has the whole ladders, the book - the visible levels
+  auto isSame = [](const std::vector<dxf::PriceLevel>& a, const auto& b) {
+    return a.size() <= b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const auto& x, const auto& y) {
+             return x.price == y.price && x.size == y.size && x.time == y.time;
+           });
+  };
+  auto isValid = restored->isStale() && reader && originalBook.asks.size() == restoredBook.asks.size() &&
+                 originalBook.bids.size() == restoredBook.bids.size() && isSame(originalBook.asks, restoredBook.asks) &&
+                 isSame(originalBook.bids, restoredBook.bids) && isSame(originalBook.asks, reader->getAsks()) &&
+                 isSame(originalBook.bids, reader->getBids());
+
+  fmt::print("Orders: {}, levels: {}, checkpoint: {} B\n\n", reader ? reader->getOrders().size() : 0, numberOfLevels,
+             fileSize);
+  fmt::print("{:<28} {:>12.3f} ms\n", "write checkpoint", writeSeconds * 1e3);
+  fmt::print("{:<28} {:>12.3f} ms\n", "restore checkpoint (stale)", restoreSeconds * 1e3);
+  fmt::print("{:<28} {:>12.3f} ms\n", "apply the full snapshot", snapshotSeconds * 1e3);
+  fmt::print("\nThe restored book {} the original one\n", isValid ? "matches" : "DOES NOT match");
+
+  std::filesystem::remove(path);
+
+  return isValid ? 0 : 1;
+}
+
+// Feeds the adversarial synthetic flow (OrderFlowConfig::adversarial: the moves, the side flips, the zero size and the
+// unknown removals, the mass cancels and the new snapshots) through PriceLevelBook::processSnapshotData and checks the
+// ladders of the book against the ones rebuilt from its orders after every 1000 transactions (the samples taken while
+// the checker is busy are skipped). The flow is generated on the fly, so its length is not limited by the memory.
+int stress(std::size_t transactionsNumber, std::size_t numberOfLevels, std::uint64_t seed) {
+  auto flowConfig = dxf::OrderFlowConfig::adversarial();
+
+  flowConfig.seed = seed;
+  fmt::print("Transactions: {}, levels: {}, seed: {}\n\n", transactionsNumber, numberOfLevels, seed);
+  fmt::print("{:<18} {:>14} {:>14} {:>12} {:>10} {:>8} {:>8} {:>11}\n", "Book", "tx/s", "records/s", "ns/record",
+             "snapshots", "checks", "skipped", "mismatches");
+
+  std::uint64_t mismatchesNumber = 0;
+
+  auto runBook = [&](const char* name, std::size_t bandTicks) {
+    dxf::PriceLevelBookIntegrityChecker checker{1000, std::chrono::milliseconds{0}, 4,
+                                                [name](const dxf::PriceLevelBookIntegrityMismatch& mismatch) {
+                                                  fmt::print("{}: the mismatch of the {} side at {} after {} tx\n",
+                                                             name, mismatch.isAsk ? "ask" : "bid", mismatch.position,
+                                                             mismatch.transactionsNumber);
+                                                }};
+    dxf::PriceLevelBookConfig config{};
+
+    config.storage = dxf::PriceLevelStorage::FLAT;
+    config.lockPolicy = dxf::PriceLevelBookLockPolicy::NONE;
+    config.tickSize = flowConfig.tickSize;
+    config.bandTicks = bandTicks;
+    config.integrityChecker = &checker;
+
+    auto book = dxf::PriceLevelBook::createDetached("STRESS", "NTV", numberOfLevels, config);
+    dxf::OrderFlowGenerator generator{flowConfig};
+    std::size_t recordsNumber = 0;
+    std::size_t snapshotsNumber = 0;
+    double seconds = 0.0;
+
+    for (std::size_t i = 0; i <= transactionsNumber; i++) {
+      const auto& chunk = generator.next();
+      auto snapshotData = chunk.toSnapshotData();
+      auto start = std::chrono::steady_clock::now();
+
+      book->processSnapshotData(&snapshotData, chunk.newSnapshot ? 1 : 0);
+      seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      recordsNumber += chunk.orders.size();
+      snapshotsNumber += chunk.newSnapshot ? 1 : 0;
+    }
+
+    checker.waitChecked();
+    mismatchesNumber += checker.getMismatchesNumber();
+    fmt::print("{:<18} {:>14.0f} {:>14.0f} {:>12.1f} {:>10} {:>8} {:>8} {:>11}\n", name,
+               static_cast<double>(transactionsNumber) / seconds, static_cast<double>(recordsNumber) / seconds,
+               seconds * 1e9 / static_cast<double>(recordsNumber), snapshotsNumber, checker.getChecksNumber(),
+               checker.getSkippedNumber(), checker.getMismatchesNumber());
+  };
+
+  runBook("book", 0);
+  runBook("book+band", 20);
+
+  return mismatchesNumber == 0 ? 0 : 1;
+}
+
+// Compares the search of the price position in the top of the ask side: std::lower_bound over the levels (the flat
+// ladder), the scalar and the vector PriceLevelSearch over the prices (the fixed-depth ladder).
+int search(std::size_t searchesNumber) {
+  std::mt19937_64 rng{42};
+
+  fmt::print("Searches: {}\n\n", searchesNumber);
+  fmt::print("{:<8} {:>14} {:>14} {:>14}\n", "Prices", "lower_bound ns", "scalar ns", "vector ns");
+
+  for (std::size_t pricesNumber : {8, 16, 32, 64}) {
+    std::vector<dxf::PriceLevel> levels{};
+    std::vector<double> prices{};
+
+    for (std::size_t i = 0; i < pricesNumber; i++) {
+      levels.push_back({100.0 + static_cast<double>(i) * 0.01, 1.0, 0});
+      prices.push_back(levels.back().price);
+    }
+
+    std::vector<double> queries(1024);
+
+    for (auto& query : queries) {
+      query = 100.0 + static_cast<double>(rng() % (pricesNumber + 2)) * 0.01 - 0.005;
+    }
+
+    std::size_t checksum = 0;
+
+    auto measure = [&](auto&& find) {
+      auto start = std::chrono::steady_clock::now();
+
+      for (std::size_t i = 0; i < searchesNumber; i++) {
+        checksum += find(queries[i & (queries.size() - 1)]);
+      }
+
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 /
+             static_cast<double>(searchesNumber);
+    };
+
+    auto lowerBoundTime = measure([&levels](double price) {
+      return static_cast<std::size_t>(std::lower_bound(levels.begin(), levels.end(), price,
+                                                       [](const dxf::PriceLevel& pl, double p) {
+                                                         return dxf::AskSide::isBetter(pl.price, p);
+                                                       }) -
+                                      levels.begin());
+    });
+
+    dxf::PriceLevelSearch::setStrategy(dxf::PriceLevelSearchStrategy::SCALAR);
+
+    auto scalarTime = measure([&prices](double price) {
+      return dxf::PriceLevelSearch::countBetter<dxf::AskSide>(prices.data(), prices.size(), price);
+    });
+
+    dxf::PriceLevelSearch::setStrategy(dxf::PriceLevelSearch::getSupportedStrategy());
+
+    auto vectorTime = measure([&prices](double price) {
+      return dxf::PriceLevelSearch::countBetter<dxf::AskSide>(prices.data(), prices.size(), price);
+    });
+
+    fmt::print("{:<8} {:>14.2f} {:>14.2f} {:>14.2f}   ({})\n", pricesNumber, lowerBoundTime, scalarTime, vectorTime,
+               checksum);
+  }
+
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 1 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
+    std::cout << "Usage:\n  plb-bench [--check-allocations] [<number of transactions> [<records per transaction> "
+                 "[<number of levels> [<snapshot orders>]]]]\n"
+                 "  plb-bench replay <capture file> [<number of levels> [<tick size>]]\n"
+                 "  plb-bench replay-day <directory> [<shards> [<barrier ms> [<number of levels>]]]\n"
+                 "  plb-bench export <capture file> <Arrow file>\n"
+                 "  plb-bench search [<number of searches>]\n"
+                 "  plb-bench checkpoint [<snapshot orders> [<number of levels>]]\n"
+                 "  plb-bench stress [<number of transactions> [<number of levels> [<seed>]]]\n\n";
+
+    return 0;
+  }
+
+  if (argc > 2 && std::string(argv[1]) == "replay") {
+    return replay(argv[2], argc > 3 ? std::stoull(argv[3]) : 10ULL, argc > 4 ? std::stod(argv[4]) : 0.01);
+  }
+
+  if (argc > 2 && std::string(argv[1]) == "replay-day") {
+    return replayDay(argv[2], argc > 3 ? std::stoull(argv[3]) : 0ULL, argc > 4 ? std::stoll(argv[4]) : 0LL,
+                     argc > 5 ? std::stoull(argv[5]) : 10ULL);
+  }
+
+  if (argc > 3 && std::string(argv[1]) == "export") {
+    return exportToArrow(argv[2], argv[3]);
+  }
+
+  if (argc > 1 && std::string(argv[1]) == "checkpoint") {
+    return checkpoint(argc > 2 ? std::stoull(argv[2]) : 100000ULL, argc > 3 ? std::stoull(argv[3]) : 10ULL);
+  }
+
+  if (argc > 1 && std::string(argv[1]) == "stress") {
+    return stress(argc > 2 ? std::stoull(argv[2]) : 1000000ULL, argc > 3 ? std::stoull(argv[3]) : 10ULL,
+                  argc > 4 ? std::stoull(argv[4]) : 42ULL);
+  }
+
+  if (argc > 1 && std::string(argv[1]) == "search") {
+    return search(argc > 2 ? std::stoull(argv[2]) : 10000000ULL);
+  }
+
+  // The steady-state processing of the allocation-free rows must not allocate (the rare growth of the buffers is
+  // amortized as by the 0 budgets of microbench): the rows that allocate fail the check
+  auto isAllocationCheck = argc > 1 && std::string(argv[1]) == "--check-allocations";
+  auto argIndex = isAllocationCheck ? 2 : 1;
+  auto transactionsNumber = argc > argIndex ? std::stoull(argv[argIndex]) : 100000ULL;
+  auto recordsPerTransaction = argc > argIndex + 1 ? std::stoull(argv[argIndex + 1]) : 4ULL;
+  auto numberOfLevels = argc > argIndex + 2 ? std::stoull(argv[argIndex + 2]) : 10ULL;
+  auto snapshotOrdersNumber = argc > argIndex + 3 ? std::stoull(argv[argIndex + 3]) : 10000ULL;
+
+  auto flow = generateOrderFlow(transactionsNumber, recordsPerTransaction, snapshotOrdersNumber);
+  std::size_t recordsNumber = 0;
+
+  for (const auto& transaction : flow) {
+    recordsNumber += transaction.size();
+  }
+
+  fmt::print("Transactions: {}, records: {}, levels: {}\n\n", flow.size(), recordsNumber, numberOfLevels);
+  fmt::print("{:<18} {:>14} {:>14} {:>12} {:>10} {:>20}\n", "Storage", "tx/s", "records/s", "ns/record", "allocs/tx",
+             "checksum");
+
+  // The rows that allocate in the steady state
+  std::vector<std::string> violations{};
+  auto steadyTransactionsNumber = (std::max)(flow.size() - flow.size() / 2 - 1, std::size_t{1});
+
+  // The node-based containers (the multi_index ladders, std::unordered_map) allocate the nodes of the new levels and
+  // orders, their rows are not allocation-free
+  auto report = [&](const char* name, const BenchResult& result, bool isAllocationFree = true) {
+    auto steadyAllocationsPerTx =
+      static_cast<double>(result.steadyAllocations) / static_cast<double>(steadyTransactionsNumber);
+    auto isFailed = isAllocationCheck && isAllocationFree && steadyAllocationsPerTx > 0.0005;
+
+    fmt::print("{:<18} {:>14.0f} {:>14.0f} {:>12.1f} {:>10.2f} {:>20.6f}{}\n", name,
+               static_cast<double>(flow.size()) / result.seconds, static_cast<double>(recordsNumber) / result.seconds,
+               result.seconds * 1e9 / static_cast<double>(recordsNumber),
+               static_cast<double>(result.allocations) / static_cast<double>(flow.size() - 1), result.checksum,
+               isFailed ? " FAIL" : "");
+
+    if (isFailed) {
+      violations.push_back(fmt::format("{}: {:.4f} allocs/tx in the steady state", name, steadyAllocationsPerTx));
+    }
+  };
+
+  {
+    dxf::PriceLevelBookEngine<dxf::MultiIndexPriceLevelLadder> engine{numberOfLevels};
+
+    report("multi_index", run(engine, flow), false);
+  }
+
+  {
+    dxf::PriceLevelBookEngine<dxf::FlatPriceLevelLadder> engine{numberOfLevels};
+
+    report("flat", run(engine, flow));
+  }
+
+  // The level by level apply of the large transactions instead of the merge
+  {
+    dxf::PriceLevelBookEngine<dxf::MultiIndexPriceLevelLadder> engine{numberOfLevels};
+
+    engine.setMergeThreshold(std::numeric_limits<std::size_t>::max());
+    report("multi_index/lookup", run(engine, flow), false);
+  }
+
+  {
+    dxf::PriceLevelBookEngine<dxf::FlatPriceLevelLadder> engine{numberOfLevels};
+
+    engine.setMergeThreshold(std::numeric_limits<std::size_t>::max());
+    report("flat/lookup", run(engine, flow));
+  }
+
+  {
+    dxf::PriceLevelBookEngine<dxf::MultiIndexPriceLevelLadder, dxf::TickPriceModel> engine{numberOfLevels, {0.01}};
+
+    report("multi_index/tick", run(engine, flow), false);
+  }
+
+  {
+    dxf::PriceLevelBookEngine<dxf::FlatPriceLevelLadder, dxf::TickPriceModel> engine{numberOfLevels, {0.01}};
+
+    report("flat/tick", run(engine, flow));
+  }
+
+  if (numberOfLevels == 5 || numberOfLevels == 10 || numberOfLevels == 20) {
+    auto runFixed = [&](auto depth) {
+      using Ladder = dxf::FixedDepthPriceLevelLadder<decltype(depth)::value>;
+
+      dxf::PriceLevelBookEngine<Ladder::template Type> engine{numberOfLevels};
+
+      report("fixed", run(engine, flow));
+    };
+
+    if (numberOfLevels == 5) {
+      runFixed(std::integral_constant<std::size_t, 5>{});
+    } else if (numberOfLevels == 10) {
+      runFixed(std::integral_constant<std::size_t, 10>{});
+    } else {
+      runFixed(std::integral_constant<std::size_t, 20>{});
+    }
+  }
+
+  {
+    dxf::PriceLevelBookEngine<dxf::FlatPriceLevelLadder> engine{numberOfLevels};
+
+    report("flat+book copy", run(engine, flow, BookAccess::COPY));
+  }
+
+  {
+    dxf::PriceLevelBookEngine<dxf::FlatPriceLevelLadder> engine{numberOfLevels};
+
+    report("flat+book view", run(engine, flow, BookAccess::VIEW));
+  }
+
+  {
+    dxf::PriceLevelBookEngine<dxf::FlatPriceLevelLadder> engine{numberOfLevels};
+
+    engine.setAnalyticsDepth(10);
+    report("flat+analytics", run(engine, flow, BookAccess::ANALYTICS));
+  }
+
+  {
+    dxf::PriceLevelBookEngine<dxf::FlatPriceLevelLadder> engine{numberOfLevels};
+
+    report("flat+top of book", run(engine, flow, BookAccess::TOP_OF_BOOK));
+  }
+
+  {
+    dxf::PriceLevelBookEngine<dxf::FlatPriceLevelLadder> engine{numberOfLevels};
+
+    report("flat+groups", run(engine, flow, BookAccess::GROUPED));
+  }
+
+  {
+    dxf::PriceLevelBookEngine<dxf::FlatPriceLevelLadder> engine{numberOfLevels};
+
+    report("flat+regroup", run(engine, flow, BookAccess::REGROUP));
+  }
+
+  {
+    dxf::PriceLevelBookEngine<dxf::MultiIndexPriceLevelLadder> engine{numberOfLevels};
+
+    // The 20 ticks around the best prices
+    engine.setPriceBand({20 * 0.01});
+    report("multi_index+band", run(engine, flow), false);
+  }
+
+  {
+    dxf::PriceLevelBookEngine<dxf::FlatPriceLevelLadder> engine{numberOfLevels};
+
+    engine.setPriceBand({20 * 0.01});
+    report("flat+band", run(engine, flow));
+  }
+
+  {
+    dxf::MarketByOrderEngine engine{};
+
+    report("market_by_order", runMarketByOrder(engine, flow));
+  }
+
+  {
+    dxf::LazyPriceLevelBookEngine engine{numberOfLevels};
+
+    engine.reserveOrders(snapshotOrdersNumber);
+    report("lazy+read/1000", runLazy(engine, flow, 1000));
+  }
+
+  fmt::print("\n{:<18} {:>14} {:>14} {:>12} {:>10} {:>20}\n", "Order index", "tx/s", "records/s", "ns/record",
+             "allocs/tx", "checksum");
+
+  {
+    std::unordered_map<dxf_long_t, dxf::OrderData> index{};
+
+    report("unordered_map", runOrderIndex(
+                              flow,
+                              [&index](dxf_long_t i) {
+                                auto found = index.find(i);
+
+                                return found == index.end() ? nullptr : &found->second;
+                              },
+                              [&index](const dxf::OrderData& data) { index[data.index] = data; },
+                              [&index](dxf_long_t i) { index.erase(i); }),
+           false);
+  }
+
+  {
+    dxf::OrderDataMap index{};
+
+    report("OrderDataMap", runOrderIndex(
+                             flow, [&index](dxf_long_t i) { return index.find(i); },
+                             [&index](const dxf::OrderData& data) { index.insert(data); },
+                             [&index](dxf_long_t i) { index.erase(i); }));
+  }
+
+  if (!violations.empty()) {
+    fmt::print("\nThe steady-state processing allocates:\n");
+
+    for (const auto& violation : violations) {
+      fmt::print("  {}\n", violation);
+    }
+
+    return 1;
+  }
+}
@@ -0,0 +1,77 @@
+#include <fmt/format.h>
+
+#include <SharedPriceLevelRing.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cout << "Usage:\n  plb-shm-reader <ring name> [<symbol>]\n\n";
+
+    return 0;
+  }
+
+  auto name = std::string(argv[1]);
+  auto symbol = argc > 2 ? std::string(argv[2]) : std::string();
+  auto subscriber = dxf::SharedPriceLevelSubscriber::open(name);
+
+  if (!subscriber) {
+    std::cerr << "Can't open the ring: " << name << "\n";
+
+    return 1;
+  }
+
+  std::atomic<bool> stop{false};
+  std::uint64_t booksNumber = 0;
+  std::uint64_t changesNumber = 0;
+
+  auto printRecord = [&](const dxf::SharedPriceLevelRecord &record) {
+    if (!symbol.empty() && record.symbol != symbol) {
+      return;
+    }
+
+    if (record.type == dxf::SharedPriceLevelRecordType::BOOK) {
+      booksNumber++;
+      fmt::print("#{} {}@{} book: {} asks, {} bids", record.sequence, record.symbol, record.source,
+                 record.book.asks.size(), record.book.bids.size());
+
+      if (!record.book.asks.empty()) {
+        fmt::print(", best ask {:.6g} x {:.6g}", record.book.asks[0].price, record.book.asks[0].size);
+      }
+
+      if (!record.book.bids.empty()) {
+        fmt::print(", best bid {:.6g} x {:.6g}", record.book.bids[0].price, record.book.bids[0].size);
+      }
+
+      fmt::print("\n");
+    } else {
+      changesNumber++;
+      fmt::print("#{} {}@{} changes: +{}/{} ~{}/{} -{}/{} (asks/bids)\n", record.sequence, record.symbol, record.source,
+                 record.additions.asks.size(), record.additions.bids.size(), record.updates.asks.size(),
+                 record.updates.bids.size(), record.removals.asks.size(), record.removals.bids.size());
+    }
+  };
+
+  std::thread reader([&] {
+    while (!stop.load(std::memory_order_relaxed)) {
+      auto result = subscriber->poll(printRecord);
+
+      if (result.isOverrun) {
+        fmt::print("Overrun: the records have been skipped, waiting for the next books\n");
+      }
+
+      if (result.recordsNumber == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+  });
+
+  std::cin.get();
+  stop.store(true, std::memory_order_relaxed);
+  reader.join();
+
+  fmt::print("Books: {}, changes: {}, overruns: {}\n", booksNumber, changesNumber, subscriber->getOverrunsNumber());
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+#include "LatencyStats.hpp"
+#include "PriceLevelBook.hpp"
+
+namespace dxf {
+
+// The displays of plb-tester that run on their own threads, so the terminal never stalls the thread of the book.
+namespace tester {
+
+// Runs the frame on its own thread every interval until it is destroyed
+class PeriodicThread {
+  std::chrono::milliseconds interval_;
+  std::mutex mutex_;
+  std::condition_variable stopCondition_;
+  bool stop_;
+  std::thread worker_;
+
+ protected:
+  explicit PeriodicThread(std::chrono::milliseconds interval)
+      : interval_{interval}, mutex_{}, stopCondition_{}, stop_{false}, worker_{} {}
+
+  // Called by the constructor of the derived class, so the frame doesn't see the partially constructed object
+  template <typename Frame>
+  void start(Frame frame) {
+    worker_ = std::thread([this, frame = std::move(frame)]() mutable {
+      std::unique_lock<std::mutex> lk(mutex_);
+
+      while (!stopCondition_.wait_for(lk, interval_, [this] { return stop_; })) {
+        frame();
+      }
+    });
+  }
+
+  // Called by the destructor of the derived class before its members are destroyed
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+
+      stop_ = true;
+    }
+
+    stopCondition_.notify_one();
+
+    if (worker_.joinable()) {
+      worker_.join();
+    }
+  }
+
+ public:
+  PeriodicThread(const PeriodicThread&) = delete;
+  PeriodicThread& operator=(const PeriodicThread&) = delete;
+  ~PeriodicThread() { stop(); }
+};
+
+// Draws the published best levels of the book (see PriceLevelBookConfig::publishedLevelsNumber) in the terminal at the
+// capped frame rate. The levels are read without blocking the book (PriceLevelBook::readPublishedLevels), the frame is
+// skipped if nothing is published since the previous one, and only the rows that differ from the drawn ones are
+// rewritten in place by the ANSI cursor moves, so the output is one write of the changed rows per frame at most.
+class BookRenderer final : public PeriodicThread {
+  // The title, the header and the separator
+  static constexpr std::size_t HEADER_ROWS_NUMBER = 3;
+
+  const PriceLevelBook& book_;
+  std::FILE* out_;
+  PriceLevelChanges levels_;
+  std::uint64_t publicationsNumber_;
+  std::vector<std::string> drawnRows_;
+  std::string frame_;
+  std::uint64_t framesNumber_;
+  std::uint64_t rowsNumber_;
+
+  static std::string formatLevel(const PriceLevel& pl) { return fmt::format("{:<18.6g} {:<18.6g}", pl.price, pl.size); }
+
+  void appendRow(std::size_t index, std::string row) {
+    if (index < drawnRows_.size() && drawnRows_[index] == row) {
+      return;
+    }
+
+    // Moves to the row, writes it and erases the rest of the line
+    fmt::format_to(std::back_inserter(frame_), "\x1b[{};1H{}\x1b[K", index + 1, row);
+    rowsNumber_++;
+
+    if (index < drawnRows_.size()) {
+      drawnRows_[index] = std::move(row);
+    } else {
+      drawnRows_.push_back(std::move(row));
+    }
+  }
+
+  void drawFrame() {
+    auto publicationsNumber = book_.readPublishedLevels(levels_);
+
+    if (publicationsNumber == publicationsNumber_) {
+      return;
+    }
+
+    publicationsNumber_ = publicationsNumber;
+    frame_.clear();
+
+    if (framesNumber_ == 0) {
+      frame_ += "\x1b[2J";
+    }
+
+    appendRow(0, fmt::format("{}#{}  updates: {}{}", book_.getSymbol(), book_.getSource(), publicationsNumber,
+                             book_.isStale() ? "  (stale)" : ""));
+    appendRow(1, fmt::format("{:<18} {:<18} | {:<18} {:<18}", " Ask", " Size", " Bid", " Size"));
+    appendRow(2, fmt::format("{:-^38}|{:-^38}", "-", "-"));
+
+    auto levelRowsNumber = (std::max)(levels_.asks.size(), levels_.bids.size());
+
+    for (std::size_t i = 0; i < levelRowsNumber; i++) {
+      auto ask = i < levels_.asks.size() ? formatLevel(levels_.asks[i]) : std::string(37, ' ');
+
+      auto bid = i < levels_.bids.size() ? " | " + formatLevel(levels_.bids[i]) : std::string{" |"};
+
+      appendRow(HEADER_ROWS_NUMBER + i, ask + bid);
+    }
+
+    // The rows of the levels that are gone
+    for (auto i = HEADER_ROWS_NUMBER + levelRowsNumber; i < drawnRows_.size(); i++) {
+      appendRow(i, std::string{});
+    }
+
+    drawnRows_.resize(HEADER_ROWS_NUMBER + levelRowsNumber);
+    fmt::format_to(std::back_inserter(frame_), "\x1b[{};1H", drawnRows_.size() + 1);
+    std::fwrite(frame_.data(), 1, frame_.size(), out_);
+    std::fflush(out_);
+    framesNumber_++;
+  }
+
+ public:
+  // frameRate - the maximum number of the frames per second
+  BookRenderer(const PriceLevelBook& book, std::size_t frameRate, std::FILE* out = stdout)
+      : PeriodicThread{std::chrono::milliseconds{1000 / (std::max)(frameRate, std::size_t{1})}},
+        book_{book},
+        out_{out},
+        levels_{},
+        publicationsNumber_{0},
+        drawnRows_{},
+        frame_{},
+        framesNumber_{0},
+        rowsNumber_{0} {
+#ifdef _WIN32
+    // The ANSI sequences of the Windows 10 console
+    auto console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+
+    if (GetConsoleMode(console, &mode)) {
+      SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    }
+#endif
+
+    start([this] { drawFrame(); });
+  }
+
+  ~BookRenderer() { stop(); }
+
+  // The numbers of the drawn frames and the rewritten rows. Can be called after the renderer is stopped.
+  [[nodiscard]] std::uint64_t getFramesNumber() const { return framesNumber_; }
+
+  [[nodiscard]] std::uint64_t getRowsNumber() const { return rowsNumber_; }
+};
+
+// Prints the rates of the data received by the book and the latencies of its processing (if the project is configured
+// with -DDXFCXX_LATENCY_STATS=1) of every interval instead of the book itself
+class BookStatsReporter final : public PeriodicThread {
+  const PriceLevelBook& book_;
+  std::FILE* out_;
+  std::chrono::steady_clock::time_point lastTime_;
+  std::uint64_t lastRecordsNumber_;
+  std::uint64_t lastSnapshotDataNumber_;
+  LatencyHistogramSnapshot lastApplyLatency_;
+  LatencyHistogramSnapshot lastEndToEndLatency_;
+
+  void report() {
+    auto now = std::chrono::steady_clock::now();
+    auto seconds = std::chrono::duration<double>(now - lastTime_).count();
+    auto recordsNumber = book_.getRecordsNumber();
+    auto snapshotDataNumber = book_.getSnapshotDataNumber();
+    std::string line = fmt::format("updates/s: {:.0f}, chunks/s: {:.0f}",
+                                   static_cast<double>(recordsNumber - lastRecordsNumber_) / seconds,
+                                   static_cast<double>(snapshotDataNumber - lastSnapshotDataNumber_) / seconds);
+
+    if constexpr (LatencyStats::isCompiled()) {
+      auto applyLatency = book_.getLatency(LatencyStage::APPLY);
+      auto endToEndLatency = book_.getLatency(LatencyStage::END_TO_END);
+      auto apply = applyLatency.since(lastApplyLatency_);
+      auto endToEnd = endToEndLatency.since(lastEndToEndLatency_);
+
+      fmt::format_to(std::back_inserter(line), ", apply p50 {} ns, p99 {} ns, max {} ns", apply.getPercentile(50.0),
+                     apply.getPercentile(99.0), apply.max);
+      fmt::format_to(std::back_inserter(line), ", end-to-end p50 {} ns, p99 {} ns", endToEnd.getPercentile(50.0),
+                     endToEnd.getPercentile(99.0));
+      lastApplyLatency_ = applyLatency;
+      lastEndToEndLatency_ = endToEndLatency;
+    }
+
+    fmt::print(out_, "{}\n", line);
+    std::fflush(out_);
+    lastTime_ = now;
+    lastRecordsNumber_ = recordsNumber;
+    lastSnapshotDataNumber_ = snapshotDataNumber;
+  }
+
+ public:
+  BookStatsReporter(const PriceLevelBook& book, std::chrono::milliseconds interval, std::FILE* out = stdout)
+      : PeriodicThread{interval},
+        book_{book},
+        out_{out},
+        lastTime_{std::chrono::steady_clock::now()},
+        lastRecordsNumber_{book.getRecordsNumber()},
+        lastSnapshotDataNumber_{book.getSnapshotDataNumber()},
+        lastApplyLatency_{},
+        lastEndToEndLatency_{} {
+    start([this] { report(); });
+  }
+
+  ~BookStatsReporter() { stop(); }
+};
+
+}  // namespace tester
+
+}  // namespace dxf
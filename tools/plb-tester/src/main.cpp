@@ -1,27 +1,162 @@
 #define _SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING 1
 
+#include <fmt/compile.h>
 #include <fmt/format.h>
 
+#include <ConnectionMetrics.hpp>
+#include <ConsolidatedPriceLevelBook.hpp>
+#include <DiagnosticsDump.hpp>
+#include <MetricsExport.hpp>
+#include <NativePriceLevelBook.hpp>
 #include <PriceLevelBook.hpp>
+#include <PriceLevelBookCheckpointer.hpp>
+#include <SharedPriceLevelRing.hpp>
+#include <ShutdownBatch.hpp>
+#include <SnapshotDataCapture.hpp>
+#include <StartupCoordinator.hpp>
+#include <TextExport.hpp>
+#include <Trace.hpp>
+#include <TraceSpans.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <utility>
+#include <vector>
+
+#include "BookDisplay.hpp"
+
+// The row of the CSV export: the level of the new book (N) or the addition (A), the update (U), the removal (R)
+struct CsvRow {
+  std::int64_t time;
+  double price;
+  double size;
+  char kind;
+  char side;
+};
+
+static void formatCsvRow(fmt::memory_buffer &out, const CsvRow &row) {
+  fmt::format_to(std::back_inserter(out), FMT_COMPILE("{},{},{},{},{}\n"), row.time, row.kind, row.side, row.price,
+                 row.size);
+}
 
 int main(int argc, char *argv[]) {
   if (argc < 5) {
-    std::cout << "Usage:\n  plb-tester <endpoint> <symbol> <source> <number of levels>\n\n";
+    std::cout << "Usage:\n  plb-tester <endpoint> <symbol> <source> <number of levels> [async | conflate] "
+                 "[backpressure=<block | conflate | disconnect>] [flat | fixed] [batch] [capture=<file>] "
+                 "[shm=<ring name>] [native] [metrics=<port>] [statsd=<host>:<port>] [spans=<N>] [ready=<timeout ms>] "
+                 "[checkpoint=<directory>] [tape=<directory>] [render[=<frames per second>] | stats] "
+                 "[integrity=<transactions>] [csv=<file>] [diagnostics=<directory>]\n\n";
 
     return 0;
   }
 
   auto endpoint = argv[1];
   auto symbol = argv[2];
-  auto source = argv[3];
+  auto sourceList = std::string(argv[3]);
   auto numberOfLevels = std::stoull(argv[4]);
+  auto config = dxf::PriceLevelBookConfig{};
+
+  std::unique_ptr<std::FILE, decltype(&std::fclose)> captureFile{nullptr, &std::fclose};
+  std::unique_ptr<dxf::SnapshotDataWriter> captureWriter{};
+  std::unique_ptr<dxf::SharedPriceLevelPublisher> publisher{};
+  auto isNative = false;
+  auto metricsPort = 0;
+  auto statsDAddress = std::string{};
+  auto readyTimeout = 0;
+  // 0 - print every change
+  std::size_t frameRate = 0;
+  auto isStatsMode = false;
+  std::size_t integrityInterval = 0;
+  std::unique_ptr<dxf::AsyncTextExport<CsvRow>> csvExport{};
+  auto diagnosticsDirectory = std::string{};
+
+  for (int i = 5; i < argc; i++) {
+    auto option = std::string(argv[i]);
+
+    if (option == "async" || option == "conflate") {
+      config.async = true;
+      config.conflate = option == "conflate";
+    } else if (option.rfind("backpressure=", 0) == 0) {
+      auto policy = option.substr(13);
+
+      config.async = true;
+      config.backpressurePolicy = policy == "disconnect" ? dxf::BackpressurePolicy::DISCONNECT
+                                  : policy == "conflate" ? dxf::BackpressurePolicy::CONFLATE
+                                                         : dxf::BackpressurePolicy::BLOCK;
+    } else if (option.rfind("metrics=", 0) == 0) {
+      metricsPort = std::stoi(option.substr(8));
+    } else if (option.rfind("spans=", 0) == 0) {
+      dxf::SpanTracer::enable(static_cast<std::uint32_t>(std::stoul(option.substr(6))));
+    } else if (option.rfind("checkpoint=", 0) == 0) {
+      config.checkpointDirectory = option.substr(11);
+    } else if (option.rfind("tape=", 0) == 0) {
+      config.tapeDirectory = option.substr(5);
+    } else if (option.rfind("ready=", 0) == 0) {
+      readyTimeout = std::stoi(option.substr(6));
+    } else if (option == "render" || option.rfind("render=", 0) == 0) {
+      frameRate = option.size() > 7 ? std::stoull(option.substr(7)) : 20;
+    } else if (option.rfind("integrity=", 0) == 0) {
+      integrityInterval = std::stoull(option.substr(10));
+    } else if (option == "stats") {
+      isStatsMode = true;
+    } else if (option.rfind("diagnostics=", 0) == 0) {
+      diagnosticsDirectory = option.substr(12);
+    } else if (option.rfind("statsd=", 0) == 0) {
+      statsDAddress = option.substr(7);
+    } else if (option == "native") {
+      isNative = true;
+    } else if (option == "batch") {
+      config.batchPendingTransactions = true;
+    } else if (option == "flat") {
+      config.storage = dxf::PriceLevelStorage::FLAT;
+    } else if (option == "fixed") {
+      config.storage = dxf::PriceLevelStorage::FIXED_DEPTH;
+    } else if (option.rfind("capture=", 0) == 0) {
+      captureFile.reset(std::fopen(option.substr(8).c_str(), "wb"));
+
+      if (!captureFile) {
+        std::cerr << "Can't open the capture file: " << option.substr(8) << "\n";
+
+        return 1;
+      }
+
+      captureWriter = std::make_unique<dxf::SnapshotDataWriter>(captureFile.get());
+      config.onSnapshotData = [writer = captureWriter.get()](const dxf_snapshot_data_ptr_t snapshotData,
+                                                             int newSnapshot) {
+        writer->write(snapshotData, newSnapshot);
+      };
+    } else if (option.rfind("csv=", 0) == 0) {
+      csvExport = dxf::AsyncTextExport<CsvRow>::open(option.substr(4), &formatCsvRow,
+                                                     {.header = "time,kind,side,price,size\n"});
+
+      if (!csvExport) {
+        std::cerr << "Can't open the CSV file: " << option.substr(4) << "\n";
+
+        return 1;
+      }
+    } else if (option.rfind("shm=", 0) == 0) {
+      publisher = dxf::SharedPriceLevelPublisher::create(option.substr(4), 64 * 1024 * 1024);
+
+      if (!publisher) {
+        std::cerr << "Can't create the shared memory ring: " << option.substr(4) << "\n";
+
+        return 1;
+      }
+    }
+  }
+
+  if constexpr (dxf::Trace::isCompiled(dxf::TraceLevel::TRANSACTION)) {
+    dxf::Trace::enable();
+  }
 
   dxf_connection_t connection = nullptr;
   dxf_create_connection(endpoint, nullptr, nullptr, nullptr, nullptr, nullptr, &connection);
-  auto plb = dxf::PriceLevelBook::create(connection, symbol, source, numberOfLevels);
-  plb->setOnNewBook([](const dxf::PriceLevelChanges &priceLevelChanges) {
+  auto onNewBook = [](const dxf::PriceLevelChanges &priceLevelChanges) {
     fmt::print("\n{:^77}\n", "The New Book");
     fmt::print("{:-^77}\n", "-");
     fmt::print("{:<18} {:<18} | {:<18} {:<18}\n", " Ask", " Size", " Bid", " Size");
@@ -39,9 +174,9 @@ int main(int argc, char *argv[]) {
         fmt::print("{:^38}\n", ' ');
       }
     }
-  });
+  };
 
-  plb->setOnBookUpdate([](const dxf::PriceLevelChanges &priceLevelChanges) {
+  auto onBookUpdate = [](const dxf::PriceLevelChanges &priceLevelChanges) {
     fmt::print("\n{:^77}\n", "The Book Update");
     fmt::print("{:-^77}\n", "-");
     fmt::print("{:<18} {:<18} | {:<18} {:<18}\n", " Ask", " Size", " Bid", " Size");
@@ -59,9 +194,9 @@ int main(int argc, char *argv[]) {
         fmt::print("{:^38}\n", ' ');
       }
     }
-  });
+  };
 
-  plb->setOnIncrementalChange([](const dxf::PriceLevelChangesSet &changesSet) {
+  auto onIncrementalChange = [](const dxf::PriceLevelChangesSet &changesSet) {
     if (!changesSet.additions.asks.empty() || !changesSet.additions.bids.empty()) {
       fmt::print("\n{:^77}\n", "Additions");
       fmt::print("{:-^77}\n", "-");
@@ -121,9 +256,307 @@ int main(int argc, char *argv[]) {
         }
       }
     }
+  };
+
+  auto sources = std::vector<std::string>{};
+
+  for (auto position = std::string::size_type{0}; position != std::string::npos;) {
+    auto next = sourceList.find(',', position);
+
+    sources.push_back(sourceList.substr(position, next == std::string::npos ? next : next - position));
+    position = next == std::string::npos ? next : next + 1;
+  }
+
+  if (isNative) {
+    auto nplb = dxf::NativePriceLevelBook::create(connection, symbol, sources, numberOfLevels);
+
+    nplb->setOnNewBook(onNewBook);
+    nplb->setOnBookUpdate(onBookUpdate);
+    nplb->setOnIncrementalChange(onIncrementalChange);
+
+    std::cin.get();
+
+    dxf_close_connection(connection);
+
+    return 0;
+  }
+
+  if (sources.size() > 1) {
+    auto cplb = dxf::ConsolidatedPriceLevelBook::create(connection, symbol, sources, numberOfLevels);
+
+    cplb->setOnBookUpdate(onBookUpdate);
+    cplb->setOnIncrementalChange(onIncrementalChange);
+
+    std::cin.get();
+
+    for (const auto &source : sources) {
+      auto sourceBook = cplb->getSourceBook(source);
+
+      fmt::print("Source {}: {} asks, {} bids\n", source, sourceBook.asks.size(), sourceBook.bids.size());
+    }
+
+    dxf_close_connection(connection);
+
+    return 0;
+  }
+
+  // The renderer reads the published levels
+  if (frameRate != 0 && config.publishedLevelsNumber == 0) {
+    config.publishedLevelsNumber = numberOfLevels != 0 ? numberOfLevels : 20;
+  }
+
+  // The checker outlives the book
+  std::unique_ptr<dxf::PriceLevelBookIntegrityChecker> integrityChecker{};
+  // The mismatched book is resynced (see PriceLevelBook::resync) until the exit
+  std::mutex resyncMutex{};
+  dxf::PriceLevelBook *resyncedBook = nullptr;
+
+  if (integrityInterval != 0) {
+    integrityChecker = std::make_unique<dxf::PriceLevelBookIntegrityChecker>(
+      integrityInterval, std::chrono::seconds{1}, 2,
+      [&resyncMutex, &resyncedBook](const dxf::PriceLevelBookIntegrityMismatch &mismatch) {
+        fmt::print(stderr, "Integrity mismatch of {}#{} at the transaction {}: {} level {} is {}@{}, rebuilt {}@{}\n",
+                   mismatch.symbol, mismatch.source, mismatch.transactionsNumber, mismatch.isAsk ? "ask" : "bid",
+                   mismatch.position, mismatch.incremental.size, mismatch.incremental.price, mismatch.rebuilt.size,
+                   mismatch.rebuilt.price);
+
+        std::lock_guard<std::mutex> lk(resyncMutex);
+
+        if (resyncedBook != nullptr && !resyncedBook->resync()) {
+          fmt::print(stderr, "Failed to resync {}#{}\n", mismatch.symbol, mismatch.source);
+        }
+      });
+    config.integrityChecker = integrityChecker.get();
+  }
+
+  // The book is ready when its first snapshot is applied
+  dxf::ReadinessTracker readiness{};
+  auto plb = dxf::PriceLevelBook::create(connection, symbol, sources[0], numberOfLevels,
+                                         readiness.trackBooks(config, {symbol}, sources[0]));
+
+  readiness.seal();
+
+  if (integrityChecker) {
+    std::lock_guard<std::mutex> lk(resyncMutex);
+
+    resyncedBook = plb.get();
+  }
+
+  std::unique_ptr<dxf::PriceLevelBookCheckpointer> checkpointer{};
+
+  if (!config.checkpointDirectory.empty()) {
+    if (plb->isStale()) {
+      fmt::print("Restored the checkpoint of {} ms ago (stale until the snapshot)\n",
+                 std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                     .count() -
+                   plb->getCheckpointTime());
+    }
+
+    checkpointer = std::make_unique<dxf::PriceLevelBookCheckpointer>(config.checkpointDirectory,
+                                                                     std::chrono::seconds{10});
+    checkpointer->add(*plb);
+  }
+
+  // The renderer and the stats reporter don't print on the thread of the book
+  std::unique_ptr<dxf::tester::BookRenderer> renderer{};
+  std::unique_ptr<dxf::tester::BookStatsReporter> statsReporter{};
+
+  if (isStatsMode) {
+    statsReporter = std::make_unique<dxf::tester::BookStatsReporter>(*plb, std::chrono::seconds{1});
+  } else if (frameRate != 0) {
+    renderer = std::make_unique<dxf::tester::BookRenderer>(*plb, frameRate);
+  } else if (csvExport) {
+    // The thread of the book only copies the rows, they are formatted and written by the thread of the export
+    auto pushLevels = [exporter = csvExport.get()](std::int64_t time, char kind, const dxf::PriceLevelChanges &levels) {
+      for (const auto &level : levels.asks) {
+        exporter->push({time, level.price, level.size, kind, 'A'});
+      }
+
+      for (const auto &level : levels.bids) {
+        exporter->push({time, level.price, level.size, kind, 'B'});
+      }
+    };
+
+    plb->setOnNewBook([pushLevels](const dxf::PriceLevelChanges &book) {
+      pushLevels(dxf::Clock::getDefault().currentTimeMillis(), 'N', book);
+    });
+    plb->setOnIncrementalChange([pushLevels](const dxf::PriceLevelChangesSet &changesSet) {
+      auto time = dxf::Clock::getDefault().currentTimeMillis();
+
+      pushLevels(time, 'A', changesSet.additions);
+      pushLevels(time, 'U', changesSet.updates);
+      pushLevels(time, 'R', changesSet.removals);
+    });
+  } else {
+    plb->setOnNewBook(onNewBook);
+    plb->setOnBookUpdate(onBookUpdate);
+    plb->setOnIncrementalChange(onIncrementalChange);
+  }
+
+  std::unique_ptr<dxf::SharedPriceLevelBookListener> publisherListener{};
+
+  if (publisher) {
+    publisherListener = std::make_unique<dxf::SharedPriceLevelBookListener>(*publisher, symbol, sources[0], 1000);
+    plb->setListener(*publisherListener);
+  }
+
+  // The exporters are stopped before the book is destroyed
+  dxf::MetricsRegistry registry{};
+  dxf::ConnectionMetrics connectionMetrics{};
+  std::unique_ptr<dxf::MetricsHttpServer> metricsServer{};
+  std::unique_ptr<dxf::StatsDExporter> statsDExporter{};
+  std::unique_ptr<dxf::DiagnosticsDump> diagnosticsDump{};
+
+  if (metricsPort != 0 || !statsDAddress.empty()) {
+#ifdef _WIN32
+    WSADATA wsaData{};
+
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+
+    connectionMetrics.attach(connection);
+    registry.addCollector([&plb](dxf::MetricsWriter &writer) { plb->collectMetrics(writer); });
+    registry.addCollector([&readiness](dxf::MetricsWriter &writer) { readiness.collectMetrics(writer); });
+
+    if (integrityChecker) {
+      registry.addCollector([&integrityChecker](dxf::MetricsWriter &writer) {
+        integrityChecker->collectMetrics(writer);
+      });
+    }
+
+    registry.addCollector([&connectionMetrics, endpoint](dxf::MetricsWriter &writer) {
+      connectionMetrics.collectMetrics(writer, {{"endpoint", endpoint}});
+    });
+    registry.addCollector(
+      [](dxf::MetricsWriter &writer) { dxf::ErrorCounters::getInstance().collectMetrics(writer); });
+  }
+
+  if (metricsPort != 0) {
+    metricsServer = std::make_unique<dxf::MetricsHttpServer>(registry, static_cast<std::uint16_t>(metricsPort));
+
+    if (!metricsServer->isListening()) {
+      std::cerr << "Can't listen the metrics port: " << metricsPort << "\n";
+    }
+
+    metricsServer->setDiagnostics([&plb] { return dxf::toJson(plb->getDiagnostics()); });
+  }
+
+  // The state of the book is dumped by `kill -USR1 <pid>` without stopping the feed
+  if (!diagnosticsDirectory.empty()) {
+    diagnosticsDump = std::make_unique<dxf::DiagnosticsDump>(
+      [&plb] { return dxf::toJson(plb->getDiagnostics()) + "\n"; }, diagnosticsDirectory, "plb-tester");
+
+    if (!dxf::DiagnosticsDump::installSignalHandler()) {
+      std::cerr << "Can't install the handler of the diagnostics signal\n";
+    }
+  }
+
+  if (auto separator = statsDAddress.rfind(':'); separator != std::string::npos) {
+    auto statsDPort = static_cast<std::uint16_t>(std::stoi(statsDAddress.substr(separator + 1)));
+
+    statsDExporter = std::make_unique<dxf::StatsDExporter>(registry, statsDAddress.substr(0, separator), statsDPort,
+                                                           std::chrono::seconds{10}, "plb_tester.");
+
+    if (!statsDExporter->isConnected()) {
+      std::cerr << "Can't resolve the StatsD address: " << statsDAddress << "\n";
+    }
+  }
+
+  auto isReady = true;
+
+  if (readyTimeout > 0) {
+    isReady = readiness.waitReady(std::chrono::milliseconds{readyTimeout});
+
+    if (isReady) {
+      fmt::print("Ready in {} ms\n",
+                 std::chrono::duration_cast<std::chrono::milliseconds>(readiness.getStats().readyTime).count());
+    } else {
+      fmt::print("Not ready in {} ms: {}\n", readyTimeout, fmt::join(readiness.getPendingItems(), ", "));
+    }
+  } else {
+    std::cin.get();
+  }
+
+  statsReporter.reset();
+  renderer.reset();
+
+  if (checkpointer) {
+    checkpointer->writeAll();
+    checkpointer->remove(*plb);
+  }
+
+  if (integrityChecker) {
+    {
+      std::lock_guard<std::mutex> lk(resyncMutex);
+
+      resyncedBook = nullptr;
+    }
+
+    fmt::print("Integrity checks: {}, mismatches: {}, skipped: {}, resyncs: {}\n", integrityChecker->getChecksNumber(),
+               integrityChecker->getMismatchesNumber(), integrityChecker->getSkippedNumber(), plb->getResyncsNumber());
+  }
+
+  // The connection is closed in the background while the statistics are printed
+  auto closed = dxf::ShutdownBatch{}.addStop([&plb] { plb->resetListener(); }).addConnection(connection).closeAsync();
+
+  auto memoryUsage = plb->getMemoryUsage();
+
+  fmt::print("Memory usage: ladders {} B, order index {} B, buffers {} B, total {} B\n", memoryUsage.ladders,
+             memoryUsage.orderIndex, memoryUsage.buffers, memoryUsage.getTotal());
+
+  if (config.async) {
+    fmt::print("Queue overflows: {}\n", plb->getQueueOverflowsNumber());
+    fmt::print("Conflated transactions: {}\n", plb->getConflatedTransactionsNumber());
+
+    auto backpressureStats = plb->getBackpressureStats();
+
+    fmt::print("Queue high-water mark: {}, blocked: {} ms, conflated chunks: {}, dropped records: {}{}\n",
+               backpressureStats.highWaterMark,
+               std::chrono::duration_cast<std::chrono::milliseconds>(backpressureStats.blockedTime).count(),
+               backpressureStats.conflatedNumber, backpressureStats.droppedNumber,
+               backpressureStats.isDisconnected ? " (disconnected)" : "");
+  }
+
+  if constexpr (dxf::LatencyStats::isCompiled()) {
+    const char* stageNames[] = {"receive", "convert", "apply", "onNewBook", "onIncrementalChange",
+                                "onBookUpdate", "onBookUpdateView", "end-to-end"};
+
+    for (int stage = 0; stage <= static_cast<int>(dxf::LatencyStage::END_TO_END); stage++) {
+      auto latency = plb->getLatency(static_cast<dxf::LatencyStage>(stage));
+
+      if (latency.count == 0) {
+        continue;
+      }
+
+      fmt::print("Latency {:<20}: count {}, p50 {} ns, p99 {} ns, p99.9 {} ns, max {} ns\n", stageNames[stage],
+                 latency.count, latency.getPercentile(50.0), latency.getPercentile(99.0),
+                 latency.getPercentile(99.9), latency.max);
+    }
+  }
+
+  // The traces are written after the close
+  closed.wait();
+
+  if (csvExport) {
+    csvExport->close();
+    fmt::print("CSV rows: {}, dropped: {}, written: {} B{}\n", csvExport->getExportedNumber(),
+               csvExport->getDroppedNumber(), csvExport->getWrittenBytes(), csvExport->isFailed() ? " (failed)" : "");
+  }
+
+  if constexpr (dxf::Trace::isCompiled(dxf::TraceLevel::TRANSACTION)) {
+    if (auto traceFile = std::fopen("plb-tester.trace", "w"); traceFile != nullptr) {
+      dxf::Trace::dump(traceFile);
+      std::fclose(traceFile);
+    }
+  }
 
-  });
+  if (dxf::SpanTracer::isEnabled()) {
+    if (auto traceFile = std::fopen("plb-tester.trace.json", "w"); traceFile != nullptr) {
+      dxf::SpanTracer::exportChromeTrace(traceFile);
+      std::fclose(traceFile);
+    }
+  }
 
-  std::cin.get();
-  dxf_close_connection(connection);
+  return isReady ? 0 : 1;
 }
\ No newline at end of file